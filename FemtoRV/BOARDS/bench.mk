@@ -13,14 +13,127 @@ BENCH.icarus:
          -o ../femtosoc_bench.vvp)
 	vvp femtosoc_bench.vvp
 
+# VERILATOR_THREADS=N builds a multithreaded model (verilator --threads N),
+# otherwise the model is built with --savable (not supported with --threads)
+# BENCH_ARGS: options of SIM/sim_main.cpp, e.g. BENCH_ARGS="--batch 1000"
+# or BENCH_ARGS="--save-at 5000000 boot.vsave" then "--restore boot.vsave"
+VERILATOR_THREADS ?=
 BENCH.verilator:
-	verilator -DBENCH_VERILATOR --top-module femtoRV32_bench \
+	verilator -DBENCH_VERILATOR $(if $(VERILATOR_THREADS),--threads $(VERILATOR_THREADS),--savable -CFLAGS -DSIM_SAVABLE) --top-module femtoRV32_bench \
          -IRTL -IRTL/PROCESSOR -IRTL/DEVICES -IRTL/PLL  \
-	 -CFLAGS '-I../SIM' -LDFLAGS '-lglfw -lGL' \
+	 -CFLAGS '-I../SIM' -LDFLAGS '-lglfw -lGL -pthread' \
          -FI FPU_funcs.h \
 	 --cc --exe SIM/sim_main.cpp SIM/FPU_funcs.cpp SIM/SSD1351.cpp RTL/femtosoc_bench.v
 	(cd obj_dir; make -f VfemtoRV32_bench.mk)	 
-	obj_dir/VfemtoRV32_bench
+	obj_dir/VfemtoRV32_bench $(BENCH_ARGS)
+
+# Bench with the FGA (RTL/DEVICES/FGA.v) emulated by a C++ model
+# (SIM/FGA.h): the FGA register, data and VRAM writes are forwarded to it
+# instead of simulating the pixel pipeline and the HDMI encoder, and the
+# framebuffer is displayed in a second window (or written to the
+# --headless dir). For the FGA firmwares, e.g. FIRMWARE/EXAMPLES/FGA_test.c
+BENCH.fga:
+	verilator -DBENCH_VERILATOR -DNRV_IO_FGA -DNRV_FGA_HOST --savable --top-module femtoRV32_bench \
+         -IRTL -IRTL/PROCESSOR -IRTL/DEVICES -IRTL/PLL  \
+	 -CFLAGS '-I../SIM -DSIM_SAVABLE -DSIM_FGA' -LDFLAGS '-lglfw -lGL -pthread' \
+         -FI FPU_funcs.h -FI FGA_host.h \
+	 --cc --exe SIM/sim_main.cpp SIM/FPU_funcs.cpp SIM/SSD1351.cpp SIM/FGA.cpp RTL/femtosoc_bench.v
+	(cd obj_dir; make -f VfemtoRV32_bench.mk)
+	obj_dir/VfemtoRV32_bench $(BENCH_ARGS)
+
+# Bench with an SD card and a mapped SPI flash emulated in C++
+# (SIM/SDCard.h, SIM/SPIFlash.h) and backed by host image files, to
+# measure the storage drivers (spi_sd.c, fat_io_lib, flash streaming), e.g.
+#   make -f BOARDS/bench.mk BENCH.storage SDCARD_IMAGE=sd.img SPI_FLASH_IMAGE=flash.bin
+# (the models are not saved by --save-at: the model is built without --savable)
+SDCARD_IMAGE ?=
+SPI_FLASH_IMAGE ?=
+BENCH.storage:
+	verilator -DBENCH_VERILATOR -DNRV_IO_SDCARD -DNRV_MAPPED_SPI_FLASH --top-module femtoRV32_bench \
+         -IRTL -IRTL/PROCESSOR -IRTL/DEVICES -IRTL/PLL  \
+	 -CFLAGS '-I../SIM -DSIM_SDCARD -DSIM_SPI_FLASH' -LDFLAGS '-lglfw -lGL -pthread' \
+         -FI FPU_funcs.h \
+	 --cc --exe SIM/sim_main.cpp SIM/FPU_funcs.cpp SIM/SSD1351.cpp \
+	 SIM/SPISlave.cpp SIM/SDCard.cpp SIM/SPIFlash.cpp RTL/femtosoc_bench.v
+	(cd obj_dir; make -f VfemtoRV32_bench.mk)
+	obj_dir/VfemtoRV32_bench $(if $(SDCARD_IMAGE),--sdcard $(SDCARD_IMAGE)) \
+	 $(if $(SPI_FLASH_IMAGE),--spi-flash $(SPI_FLASH_IMAGE)) $(BENCH_ARGS)
+
+# Superset model (RTL/CONFIGS/bench_superset_config.v): built once in
+# obj_dir_superset with all the devices that the harness emulates and
+# 2MB of RAM, the subset seen by the firmware is chosen at runtime by the
+# straps (SIM/straps.h) instead of rebuilding a model per configuration
+# (firmware.hex is read when the model starts), e.g.
+#   make -f BOARDS/bench.mk BENCH.superset SUPERSET_RAM=65536 SUPERSET_DEVICES=leds,uart,ssd1351
+# (the firmware should be configured with this subset)
+SUPERSET_RAM ?=
+SUPERSET_DEVICES ?=
+obj_dir_superset/VfemtoRV32_bench:
+	verilator -DBENCH_VERILATOR -DBENCH_SUPERSET --Mdir obj_dir_superset --top-module femtoRV32_bench \
+         -IRTL -IRTL/PROCESSOR -IRTL/DEVICES -IRTL/PLL  \
+	 -CFLAGS '-I../SIM -DSIM_SDCARD -DSIM_SPI_FLASH -DSIM_FGA -DSIM_STRAPS' -LDFLAGS '-lglfw -lGL -pthread' \
+         -FI FPU_funcs.h -FI FGA_host.h -FI straps.h \
+	 --cc --exe SIM/sim_main.cpp SIM/FPU_funcs.cpp SIM/SSD1351.cpp SIM/FGA.cpp \
+	 SIM/SPISlave.cpp SIM/SDCard.cpp SIM/SPIFlash.cpp SIM/straps.cpp RTL/femtosoc_bench.v
+	(cd obj_dir_superset; make -f VfemtoRV32_bench.mk)
+
+BENCH.superset: obj_dir_superset/VfemtoRV32_bench
+	obj_dir_superset/VfemtoRV32_bench $(if $(SUPERSET_RAM),--ram $(SUPERSET_RAM)) \
+	 $(if $(SUPERSET_DEVICES),--devices $(SUPERSET_DEVICES)) \
+	 $(if $(SDCARD_IMAGE),--sdcard $(SDCARD_IMAGE)) \
+	 $(if $(SPI_FLASH_IMAGE),--spi-flash $(SPI_FLASH_IMAGE)) $(BENCH_ARGS)
+
+# Lockstep checker (SIM/lockstep.h): the instructions retired by the core
+# (NRV_COMMIT_TRACE) are compared with the host ISS
+# (femtorv32_systemc/femtorv32_iss.cpp) running FIRMWARE/firmware.hex,
+# stops at the first divergence. Quark, Gracilis and Petitbateau.
+# LOCKSTEP_ARGS: e.g. LOCKSTEP_ARGS="--lockstep-from 1000000"
+LOCKSTEP_ARGS ?=
+BENCH.lockstep:
+	mkdir -p obj_dir
+	$(CC) -O2 -DSTANDALONE_FEMTOELF -IFIRMWARE/LIBFEMTORV32 \
+         -c FIRMWARE/LIBFEMTORV32/femto_elf.c -o obj_dir/femto_elf.o
+	verilator -DBENCH_VERILATOR -DNRV_COMMIT_TRACE --top-module femtoRV32_bench \
+         -IRTL -IRTL/PROCESSOR -IRTL/DEVICES -IRTL/PLL  \
+	 -CFLAGS '-I../SIM -I../femtorv32_systemc -I../FIRMWARE/LIBFEMTORV32 -DSIM_LOCKSTEP' \
+	 -LDFLAGS 'femto_elf.o -lglfw -lGL -pthread' \
+         -FI FPU_funcs.h -FI commit_trace.h \
+	 --cc --exe SIM/sim_main.cpp SIM/FPU_funcs.cpp SIM/SSD1351.cpp SIM/lockstep.cpp SIM/commit_trace.cpp \
+	 femtorv32_systemc/femtorv32_iss.cpp femtorv32_systemc/harness_memory.cpp femtorv32_systemc/branch_trace.cpp \
+	 RTL/femtosoc_bench.v
+	(cd obj_dir; make -f VfemtoRV32_bench.mk)
+	obj_dir/VfemtoRV32_bench --lockstep FIRMWARE/firmware.hex $(LOCKSTEP_ARGS) $(BENCH_ARGS)
+
+# Windowed waveform (SIM/sim_main.cpp --trace-window, see
+# femtorv32_systemc/wave_trace.h): only the cycles of the window are
+# written to the FST file, e.g. TRACE_WINDOW=bench.fst,pc=0x1234,cycles=500
+# or TRACE_WINDOW=bench.fst,from=2000000,signals=TOP.femtoRV32_bench.uut.processor
+TRACE_WINDOW ?= bench.fst,cycles=100000
+BENCH.trace:
+	verilator -DBENCH_VERILATOR -DNRV_COMMIT_TRACE --trace-fst --top-module femtoRV32_bench \
+         -IRTL -IRTL/PROCESSOR -IRTL/DEVICES -IRTL/PLL  \
+	 -CFLAGS '-I../SIM -I../femtorv32_systemc -DSIM_TRACE' -LDFLAGS '-lglfw -lGL -pthread' \
+         -FI FPU_funcs.h -FI commit_trace.h \
+	 --cc --exe SIM/sim_main.cpp SIM/FPU_funcs.cpp SIM/SSD1351.cpp SIM/commit_trace.cpp \
+	 femtorv32_systemc/wave_trace.cpp RTL/femtosoc_bench.v
+	(cd obj_dir; make -f VfemtoRV32_bench.mk)
+	obj_dir/VfemtoRV32_bench --trace-window $(TRACE_WINDOW) $(BENCH_ARGS)
+
+# FPU conformance sweep (SIM/fpu_sweep.cpp), for instance:
+#   make BENCH.fpu_sweep FPU_SWEEP_ARGS="-soft FSQRT FADD FMUL"
+FPU_SWEEP_ARGS ?= -list
+BENCH.fpu_sweep:
+	$(CXX) -O3 -march=native -pthread -ISIM SIM/fpu_sweep.cpp SIM/FPU_funcs.cpp -o fpu_sweep
+	./fpu_sweep $(FPU_SWEEP_ARGS)
+
+# Design space exploration of the iterative FRCP / FDIV / FSQRT
+# (SIM/fpu_explore.cpp): seed table size, Newton-Raphson iterations,
+# intermediate width, final correction, for instance:
+#   make BENCH.fpu_explore FPU_EXPLORE_ARGS="-seeds 6-10 -iters 1,2 FDIV FSQRT"
+FPU_EXPLORE_ARGS ?= FRCP FDIV FSQRT
+BENCH.fpu_explore:
+	$(CXX) -O3 -march=native -pthread -ISIM SIM/fpu_explore.cpp SIM/FPU_funcs.cpp -o fpu_explore
+	./fpu_explore $(FPU_EXPLORE_ARGS)
 
 BENCH.lint:
 	verilator -DBENCH --lint-only --top-module femtoRV32_bench \
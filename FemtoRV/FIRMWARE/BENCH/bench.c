@@ -0,0 +1,296 @@
+/*
+ * Cross-target benchmark suite: runs a fixed set of small integer kernels
+ * (they fit in the 64 KB of the tutorial pipelines, and do not need a libc)
+ * and prints one line of results per kernel, JSON or CSV (see bench.h).
+ * The output only uses putchar(), that all the targets have.
+ */
+
+#include "bench.h"
+
+/* Do not replace the loops with calls to memset() (not in the tutorial libs) */
+#pragma GCC optimize ("no-tree-loop-distribute-patterns")
+
+/*****************************************************************************/
+/* Output                                                                    */
+/*****************************************************************************/
+
+static void bench_puts(const char* s) {
+   while(*s) {
+      putchar(*(s++));
+   }
+}
+
+static void bench_putu(uint32_t x) {
+   char buffer[11];
+   char* p = buffer + sizeof(buffer);
+   *(--p) = '\0';
+   do {
+      *(--p) = '0' + x % 10;
+      x /= 10;
+   } while(x);
+   bench_puts(p);
+}
+
+/* x/1000 with three decimals */
+static void bench_put_milli(uint32_t x) {
+   uint32_t frac = x % 1000;
+   bench_putu(x / 1000);
+   putchar('.');
+   putchar('0' + frac / 100);
+   putchar('0' + (frac / 10) % 10);
+   putchar('0' + frac % 10);
+}
+
+#ifdef BENCH_CSV
+#define BENCH_UNKNOWN ""
+#else
+#define BENCH_UNKNOWN "null"
+#endif
+
+void bench_report(const bench_kernel* kernel, const bench_result* result) {
+#ifdef BENCH_CSV
+   static int header_done = 0;
+   if(!header_done) {
+      bench_puts("target,variant,kernel,iters,cycles,instret,cpi,score,ok\n");
+      header_done = 1;
+   }
+   bench_puts(BENCH_TARGET ","  BENCH_VARIANT ",");
+   bench_puts(kernel->name);                 putchar(',');
+   bench_putu(result->iters);                putchar(',');
+   bench_putu(result->cycles);               putchar(',');
+#else
+   bench_puts("{\"target\":\"" BENCH_TARGET "\",\"variant\":\"" BENCH_VARIANT "\",\"kernel\":\"");
+   bench_puts(kernel->name);
+   bench_puts("\",\"iters\":");              bench_putu(result->iters);
+   bench_puts(",\"cycles\":");               bench_putu(result->cycles);
+   bench_puts(",\"instret\":");
+#endif
+   if(result->instret != 0) {
+      bench_putu(result->instret);
+   } else {
+      bench_puts(BENCH_UNKNOWN);
+   }
+#ifdef BENCH_CSV
+   putchar(',');
+#else
+   bench_puts(",\"cpi\":");
+#endif
+   if(result->instret != 0) {
+      bench_put_milli((uint32_t)((uint64_t)result->cycles * 1000 / result->instret));
+   } else {
+      bench_puts(BENCH_UNKNOWN);
+   }
+#ifdef BENCH_CSV
+   putchar(',');                             bench_putu(result->score);
+   putchar(',');                             bench_putu(result->ok);
+   putchar('\n');
+#else
+   bench_puts(",\"score\":");                bench_putu(result->score);
+   bench_puts(",\"ok\":");                   bench_putu(result->ok);
+   bench_puts("}\n");
+#endif
+}
+
+/*****************************************************************************/
+/* Runner                                                                    */
+/*****************************************************************************/
+
+void bench_run(const bench_kernel* kernel, bench_result* result) {
+   int ok = (kernel->func() == kernel->expected); /* warm-up (caches) */
+   uint64_t c0 = bench_cycles();
+   uint64_t i0 = bench_instret();
+   for(int i=0; i<BENCH_ITERS; ++i) {
+      ok = ok && (kernel->func() == kernel->expected);
+   }
+   uint64_t i1 = bench_instret();
+   uint64_t c1 = bench_cycles();
+   result->iters   = BENCH_ITERS;
+   result->cycles  = (uint32_t)(c1 - c0);
+   result->instret = (uint32_t)(i1 - i0);
+   result->score   = result->cycles ?
+      (uint32_t)((uint64_t)BENCH_ITERS * 1000000000u / result->cycles) : 0;
+   result->ok      = ok;
+}
+
+/*****************************************************************************/
+/* Kernels                                                                   */
+/*****************************************************************************/
+
+static uint32_t lcg_state;
+
+static inline uint32_t lcg() {
+   lcg_state = lcg_state * 1664525u + 1013904223u;
+   return lcg_state;
+}
+
+/* Sieve of Eratosthenes, bitmap of the odd numbers below 16384 */
+#define SIEVE_N 16384
+static uint32_t sieve_bits[SIEVE_N/64];
+
+static uint32_t kernel_sieve(void) {
+   uint32_t count = 1; /* 2 */
+   for(int i=0; i<SIEVE_N/64; ++i) {
+      sieve_bits[i] = 0;
+   }
+   for(uint32_t n=3; n<SIEVE_N; n+=2) {
+      uint32_t k = n >> 1;
+      if(sieve_bits[k >> 5] & (1u << (k & 31))) {
+	 continue;
+      }
+      ++count;
+      for(uint32_t m=n*n; m<SIEVE_N; m+=2*n) {
+	 uint32_t j = m >> 1;
+	 sieve_bits[j >> 5] |= 1u << (j & 31);
+      }
+   }
+   return count;
+}
+
+/* Bitwise CRC-32 (no table) of 2 KB of pseudo-random bytes */
+static uint32_t kernel_crc32(void) {
+   uint32_t crc = 0xFFFFFFFF;
+   lcg_state = 1;
+   for(int i=0; i<2048; ++i) {
+      crc ^= lcg() >> 24;
+      for(int b=0; b<8; ++b) {
+	 crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+      }
+   }
+   return ~crc;
+}
+
+/* 16x16 integer matrix product */
+#define MAT_N 16
+static int32_t mat_A[MAT_N][MAT_N], mat_B[MAT_N][MAT_N], mat_C[MAT_N][MAT_N];
+
+static uint32_t kernel_matmul(void) {
+   uint32_t sum = 0;
+   lcg_state = 2;
+   for(int i=0; i<MAT_N; ++i) {
+      for(int j=0; j<MAT_N; ++j) {
+	 mat_A[i][j] = (int32_t)(lcg() >> 20) - 2048;
+	 mat_B[i][j] = (int32_t)(lcg() >> 20) - 2048;
+      }
+   }
+   for(int i=0; i<MAT_N; ++i) {
+      for(int j=0; j<MAT_N; ++j) {
+	 int32_t s = 0;
+	 for(int k=0; k<MAT_N; ++k) {
+	    s += mat_A[i][k] * mat_B[k][j];
+	 }
+	 mat_C[i][j] = s;
+	 sum = sum * 31 + (uint32_t)s;
+      }
+   }
+   return sum;
+}
+
+/* Mandelbrot set, 32x32 points, fixed point (12 bits), 64 iterations max */
+static uint32_t kernel_mandel(void) {
+   uint32_t total = 0;
+   for(int py=0; py<32; ++py) {
+      int32_t ci = (py - 16) * (4096*5/2/16);
+      for(int px=0; px<32; ++px) {
+	 int32_t cr = (px - 22) * (4096*5/2/16);
+	 int32_t zr = 0, zi = 0;
+	 int it = 0;
+	 while(it < 64) {
+	    int32_t zr2 = (zr * zr) >> 12;
+	    int32_t zi2 = (zi * zi) >> 12;
+	    if(zr2 + zi2 > 4*4096) {
+	       break;
+	    }
+	    zi = ((zr * zi) >> 11) + ci;
+	    zr = zr2 - zi2 + cr;
+	    ++it;
+	 }
+	 total += it;
+      }
+   }
+   return total;
+}
+
+/* Heapsort of 512 pseudo-random integers */
+#define SORT_N 512
+static int32_t sort_data[SORT_N];
+
+static void sift_down(int32_t* a, int root, int n) {
+   for(;;) {
+      int child = 2*root + 1;
+      if(child >= n) {
+	 return;
+      }
+      if(child + 1 < n && a[child+1] > a[child]) {
+	 ++child;
+      }
+      if(a[root] >= a[child]) {
+	 return;
+      }
+      int32_t t = a[root]; a[root] = a[child]; a[child] = t;
+      root = child;
+   }
+}
+
+static uint32_t kernel_sort(void) {
+   uint32_t sum = 0;
+   lcg_state = 3;
+   for(int i=0; i<SORT_N; ++i) {
+      sort_data[i] = (int32_t)lcg();
+   }
+   for(int i=SORT_N/2-1; i>=0; --i) {
+      sift_down(sort_data, i, SORT_N);
+   }
+   for(int n=SORT_N-1; n>0; --n) {
+      int32_t t = sort_data[0]; sort_data[0] = sort_data[n]; sort_data[n] = t;
+      sift_down(sort_data, 0, n);
+   }
+   for(int i=0; i<SORT_N; ++i) {
+      sum = sum * 31 + (uint32_t)sort_data[i];
+   }
+   return sum;
+}
+
+/* String copy and compare, byte by byte */
+static char str_buffer[2][256];
+
+static uint32_t kernel_string(void) {
+   uint32_t sum = 0;
+   lcg_state = 4;
+   for(int i=0; i<255; ++i) {
+      str_buffer[0][i] = 'a' + (lcg() >> 24) % 26;
+   }
+   str_buffer[0][255] = '\0';
+   for(int r=0; r<16; ++r) {
+      const char* src = str_buffer[0] + r;
+      char* dst = str_buffer[1];
+      while((*(dst++) = *(src++)) != '\0') {
+      }
+      const char* p = str_buffer[0] + r;
+      const char* q = str_buffer[1];
+      while(*p && *p == *q) {
+	 ++p; ++q;
+      }
+      sum = sum * 31 + (uint32_t)(p - str_buffer[0]) + (uint8_t)str_buffer[1][r];
+   }
+   return sum;
+}
+
+static const bench_kernel kernels[] = {
+   { "sieve",  kernel_sieve,  1900       },
+   { "crc32",  kernel_crc32,  0x57107803 },
+   { "matmul", kernel_matmul, 0xA781217C },
+   { "mandel", kernel_mandel, 6141       },
+   { "sort",   kernel_sort,   0xC64F091C },
+   { "string", kernel_string, 0x290E582B },
+};
+
+#define NB_KERNELS (sizeof(kernels)/sizeof(kernels[0]))
+
+int main() {
+   bench_result result;
+   for(unsigned int i=0; i<NB_KERNELS; ++i) {
+      bench_run(&kernels[i], &result);
+      bench_report(&kernels[i], &result);
+   }
+   return 0;
+}
@@ -0,0 +1,125 @@
+/*
+ * Cross-target benchmark suite (see README).
+ * The same kernels, measured the same way, and one line of results per
+ * kernel, so that the cores and SoCs can be compared by a script.
+ *
+ * Target, chosen by the Makefile:
+ *   (default)        FemtoRV FIRMWARE, cycles() of LIBFEMTORV32
+ *   BENCH_TUTORIAL   FROM_BLINKER_TO_RISCV cores, rdcycle()/rdinstret() (perf.h)
+ *   BENCH_LITEX      LiteX, timer0 uptime (or rdcycle if the SoC has no uptime)
+ *   BENCH_HOST       host build, to check the kernels (clock_gettime() ns)
+ * Options:
+ *   BENCH_CSV        CSV instead of JSON lines
+ *   BENCH_ITERS=n    timed runs of each kernel (default 1, after one warm-up run)
+ *   BENCH_VARIANT="" name of the CPU/SoC variant, copied in the results
+ *   BENCH_HAS_INSTRET=0/1 whether rdinstret can be read (default: 1 on the
+ *                    tutorial cores, 0 elsewhere, then instret and CPI are
+ *                    reported as unknown)
+ */
+
+#ifndef H__BENCH__H
+#define H__BENCH__H
+
+#include <stdint.h>
+
+#if defined(BENCH_HOST)
+
+#include <stdio.h>
+#include <time.h>
+#define BENCH_TARGET "host"
+static inline uint64_t bench_cycles() {
+   struct timespec t;
+   clock_gettime(CLOCK_MONOTONIC, &t);
+   return (uint64_t)t.tv_sec * 1000000000u + t.tv_nsec;
+}
+static inline uint64_t bench_instret() { return 0; }
+
+#elif defined(BENCH_TUTORIAL)
+
+#include "perf.h"
+extern int putchar(int c);
+#define BENCH_TARGET "tutorial"
+#ifndef BENCH_HAS_INSTRET
+#define BENCH_HAS_INSTRET 1
+#endif
+static inline uint64_t bench_cycles()  { return rdcycle();   }
+static inline uint64_t bench_instret() { return rdinstret(); }
+
+#elif defined(BENCH_LITEX)
+
+#include <stdio.h>
+#include <generated/csr.h>
+#define BENCH_TARGET "litex"
+static inline uint64_t bench_cycles() {
+#ifdef CSR_TIMER0_UPTIME_CYCLES_ADDR
+   timer0_uptime_latch_write(1);
+   return timer0_uptime_cycles_read();
+#else
+   uint32_t lo, hi, hi2;
+   do {
+      asm volatile ("rdcycleh %0" : "=r"(hi));
+      asm volatile ("rdcycle %0"  : "=r"(lo));
+      asm volatile ("rdcycleh %0" : "=r"(hi2));
+   } while(hi != hi2);
+   return ((uint64_t)hi << 32) | lo;
+#endif
+}
+
+#else /* FemtoRV FIRMWARE */
+
+#include <femtorv32.h>
+#define BENCH_TARGET "femtorv"
+static inline uint64_t bench_cycles() { return cycles(); }
+
+#endif
+
+#ifndef BENCH_HAS_INSTRET
+#define BENCH_HAS_INSTRET 0
+#endif
+
+#if BENCH_HAS_INSTRET && !defined(BENCH_TUTORIAL)
+static inline uint64_t bench_instret() {
+   uint32_t lo, hi, hi2;
+   do {
+      asm volatile ("rdinstreth %0" : "=r"(hi));
+      asm volatile ("rdinstret %0"  : "=r"(lo));
+      asm volatile ("rdinstreth %0" : "=r"(hi2));
+   } while(hi != hi2);
+   return ((uint64_t)hi << 32) | lo;
+}
+#elif !BENCH_HAS_INSTRET && !defined(BENCH_HOST)
+static inline uint64_t bench_instret() { return 0; }
+#endif
+
+#ifndef BENCH_ITERS
+#define BENCH_ITERS 1
+#endif
+
+#ifndef BENCH_VARIANT
+#define BENCH_VARIANT ""
+#endif
+
+/* A kernel returns a checksum of what it computed (compared with 'expected') */
+typedef uint32_t (*bench_kernel_func)(void);
+
+typedef struct {
+   const char*       name;
+   bench_kernel_func func;
+   uint32_t          expected;
+} bench_kernel;
+
+typedef struct {
+   uint32_t iters;
+   uint32_t cycles;   /* for the iters timed runs        */
+   uint32_t instret;  /* 0 if unknown                    */
+   uint32_t score;    /* runs per 10^9 cycles            */
+   int      ok;       /* all the checksums were expected */
+} bench_result;
+
+/* Runs a kernel (one warm-up run, then BENCH_ITERS timed runs) */
+void bench_run(const bench_kernel* kernel, bench_result* result);
+
+/* Outputs the line of results of a kernel (and the CSV header before the first one) */
+void bench_report(const bench_kernel* kernel, const bench_result* result);
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef __FIXED_H__
+#define __FIXED_H__
+
+#include <stdint.h>
+
+/*
+ * fixed<Q>: signed 32 bits number with Q fractional bits, that can be used
+ * as the scalar type T of vec<DIM,T> (geometry.h), for the cores without
+ * FPU. Constants written as floating point numbers (fixed<16>(0.5f)) are
+ * converted at compile time, products and quotients use 64 bits
+ * intermediate results.
+ */
+template <int Q> struct fixed {
+    struct raw_tag {};
+
+    constexpr fixed() : raw(0) {}
+    constexpr fixed(int x) : raw(int32_t(x) * (int32_t(1) << Q)) {}
+    constexpr fixed(float x) : raw(int32_t(x * float(int32_t(1) << Q) + (x < 0 ? -0.5f : 0.5f))) {}
+    constexpr fixed(double x) : raw(int32_t(x * double(int32_t(1) << Q) + (x < 0 ? -0.5 : 0.5))) {}
+    constexpr fixed(int32_t r, raw_tag) : raw(r) {}
+
+    static constexpr fixed from_raw(int32_t r) { return fixed(r, raw_tag()); }
+    static constexpr fixed max() { return from_raw(INT32_MAX); }
+
+    /* truncates towards zero, like the float to int conversion */
+    explicit constexpr operator int() const {
+        return raw >= 0 ? (raw >> Q) : -((-raw) >> Q);
+    }
+    explicit constexpr operator float() const {
+        return float(raw) / float(int32_t(1) << Q);
+    }
+
+    fixed& operator+=(fixed b) { raw += b.raw; return *this; }
+    fixed& operator-=(fixed b) { raw -= b.raw; return *this; }
+    fixed& operator*=(fixed b) { *this = *this * b; return *this; }
+    fixed& operator/=(fixed b) { *this = *this / b; return *this; }
+
+    friend constexpr fixed operator+(fixed a, fixed b) { return from_raw(a.raw + b.raw); }
+    friend constexpr fixed operator-(fixed a, fixed b) { return from_raw(a.raw - b.raw); }
+    friend constexpr fixed operator-(fixed a)          { return from_raw(-a.raw); }
+    friend constexpr fixed operator*(fixed a, fixed b) {
+        return from_raw(int32_t((int64_t(a.raw) * int64_t(b.raw)) >> Q));
+    }
+    friend constexpr fixed operator/(fixed a, fixed b) {
+        return from_raw(int32_t((int64_t(a.raw) << Q) / int64_t(b.raw)));
+    }
+
+    friend constexpr bool operator< (fixed a, fixed b) { return a.raw <  b.raw; }
+    friend constexpr bool operator> (fixed a, fixed b) { return a.raw >  b.raw; }
+    friend constexpr bool operator<=(fixed a, fixed b) { return a.raw <= b.raw; }
+    friend constexpr bool operator>=(fixed a, fixed b) { return a.raw >= b.raw; }
+    friend constexpr bool operator==(fixed a, fixed b) { return a.raw == b.raw; }
+    friend constexpr bool operator!=(fixed a, fixed b) { return a.raw != b.raw; }
+
+    int32_t raw;
+};
+
+template <int Q> inline fixed<Q> fabs(fixed<Q> x) {
+    return x.raw < 0 ? -x : x;
+}
+
+/* Bit by bit integer square root of raw << Q (0 for negative numbers) */
+template <int Q> inline fixed<Q> sqrt(fixed<Q> x) {
+    if(x.raw <= 0) {
+        return fixed<Q>();
+    }
+    uint64_t n = uint64_t(x.raw) << Q;
+    uint64_t result = 0;
+    uint64_t bit = uint64_t(1) << 62;
+    while(bit > n) {
+        bit >>= 2;
+    }
+    while(bit != 0) {
+        if(n >= result + bit) {
+            n -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return fixed<Q>::from_raw(int32_t(result));
+}
+
+/* x^e, e is truncated to an integer (enough for specular exponents) */
+template <int Q> inline fixed<Q> pow(fixed<Q> x, fixed<Q> e) {
+    int n = int(e);
+    fixed<Q> result(1);
+    while(n > 0) {
+        if(n & 1) {
+            result *= x;
+        }
+        x *= x;
+        n >>= 1;
+    }
+    return result;
+}
+
+#endif //__FIXED_H__
@@ -20,8 +20,8 @@ typedef vec<3, int  > Vec3i;
 typedef vec<4, float> Vec4f;
 
 template <typename T> struct vec<2,T> {
-    vec() : x(T()), y(T()) {}
-    vec(T X, T Y) : x(X), y(Y) {}
+    constexpr vec() : x(T()), y(T()) {}
+    constexpr vec(T X, T Y) : x(X), y(Y) {}
     template <class U> vec<2,T>(const vec<2,U> &v);
           T& operator[](const size_t i)       { assert(i<2); return i<=0 ? x : y; }
     const T& operator[](const size_t i) const { assert(i<2); return i<=0 ? x : y; }
@@ -29,18 +29,18 @@ template <typename T> struct vec<2,T> {
 };
 
 template <typename T> struct vec<3,T> {
-    vec() : x(T()), y(T()), z(T()) {}
-    vec(T X, T Y, T Z) : x(X), y(Y), z(Z) {}
+    constexpr vec() : x(T()), y(T()), z(T()) {}
+    constexpr vec(T X, T Y, T Z) : x(X), y(Y), z(Z) {}
           T& operator[](const size_t i)       { assert(i<3); return i<=0 ? x : (1==i ? y : z); }
     const T& operator[](const size_t i) const { assert(i<3); return i<=0 ? x : (1==i ? y : z); }
-    float norm() { return std::sqrt(x*x+y*y+z*z); }
+    T norm() const { using std::sqrt; return sqrt(x*x+y*y+z*z); } // sqrt(fixed) found by ADL
     vec<3,T> & normalize(T l=1) { *this = (*this)*(l/norm()); return *this; }
     T x,y,z;
 };
 
 template <typename T> struct vec<4,T> {
-    vec() : x(T()), y(T()), z(T()), w(T()) {}
-    vec(T X, T Y, T Z, T W) : x(X), y(Y), z(Z), w(W) {}
+    constexpr vec() : x(T()), y(T()), z(T()), w(T()) {}
+    constexpr vec(T X, T Y, T Z, T W) : x(X), y(Y), z(Z), w(W) {}
           T& operator[](const size_t i)       { assert(i<4); return i<=0 ? x : (1==i ? y : (2==i ? z : w)); }
     const T& operator[](const size_t i) const { assert(i<4); return i<=0 ? x : (1==i ? y : (2==i ? z : w)); }
     T x,y,z,w;
@@ -72,7 +72,73 @@ template<size_t DIM,typename T> vec<DIM,T> operator-(const vec<DIM,T> &lhs) {
     return lhs*T(-1);
 }
 
-template <typename T> vec<3,T> cross(vec<3,T> v1, vec<3,T> v2) {
+/*
+ * Unrolled versions for DIM = 2,3,4 (chosen instead of the generic ones
+ * above, that are more general): no loop and no operator[] (that tests
+ * the index), and constexpr.
+ */
+
+template <typename T> constexpr T operator*(const vec<2,T>& lhs, const vec<2,T>& rhs) {
+    return lhs.x*rhs.x + lhs.y*rhs.y;
+}
+
+template <typename T> constexpr T operator*(const vec<3,T>& lhs, const vec<3,T>& rhs) {
+    return lhs.x*rhs.x + lhs.y*rhs.y + lhs.z*rhs.z;
+}
+
+template <typename T> constexpr T operator*(const vec<4,T>& lhs, const vec<4,T>& rhs) {
+    return lhs.x*rhs.x + lhs.y*rhs.y + lhs.z*rhs.z + lhs.w*rhs.w;
+}
+
+template <typename T> constexpr vec<2,T> operator+(const vec<2,T>& lhs, const vec<2,T>& rhs) {
+    return vec<2,T>(lhs.x+rhs.x, lhs.y+rhs.y);
+}
+
+template <typename T> constexpr vec<3,T> operator+(const vec<3,T>& lhs, const vec<3,T>& rhs) {
+    return vec<3,T>(lhs.x+rhs.x, lhs.y+rhs.y, lhs.z+rhs.z);
+}
+
+template <typename T> constexpr vec<4,T> operator+(const vec<4,T>& lhs, const vec<4,T>& rhs) {
+    return vec<4,T>(lhs.x+rhs.x, lhs.y+rhs.y, lhs.z+rhs.z, lhs.w+rhs.w);
+}
+
+template <typename T> constexpr vec<2,T> operator-(const vec<2,T>& lhs, const vec<2,T>& rhs) {
+    return vec<2,T>(lhs.x-rhs.x, lhs.y-rhs.y);
+}
+
+template <typename T> constexpr vec<3,T> operator-(const vec<3,T>& lhs, const vec<3,T>& rhs) {
+    return vec<3,T>(lhs.x-rhs.x, lhs.y-rhs.y, lhs.z-rhs.z);
+}
+
+template <typename T> constexpr vec<4,T> operator-(const vec<4,T>& lhs, const vec<4,T>& rhs) {
+    return vec<4,T>(lhs.x-rhs.x, lhs.y-rhs.y, lhs.z-rhs.z, lhs.w-rhs.w);
+}
+
+template <typename T> constexpr vec<2,T> operator*(const vec<2,T>& lhs, const T& rhs) {
+    return vec<2,T>(lhs.x*rhs, lhs.y*rhs);
+}
+
+template <typename T> constexpr vec<3,T> operator*(const vec<3,T>& lhs, const T& rhs) {
+    return vec<3,T>(lhs.x*rhs, lhs.y*rhs, lhs.z*rhs);
+}
+
+template <typename T> constexpr vec<4,T> operator*(const vec<4,T>& lhs, const T& rhs) {
+    return vec<4,T>(lhs.x*rhs, lhs.y*rhs, lhs.z*rhs, lhs.w*rhs);
+}
+
+template <typename T> constexpr vec<2,T> operator-(const vec<2,T>& lhs) {
+    return vec<2,T>(-lhs.x, -lhs.y);
+}
+
+template <typename T> constexpr vec<3,T> operator-(const vec<3,T>& lhs) {
+    return vec<3,T>(-lhs.x, -lhs.y, -lhs.z);
+}
+
+template <typename T> constexpr vec<4,T> operator-(const vec<4,T>& lhs) {
+    return vec<4,T>(-lhs.x, -lhs.y, -lhs.z, -lhs.w);
+}
+
+template <typename T> constexpr vec<3,T> cross(vec<3,T> v1, vec<3,T> v2) {
     return vec<3,T>(v1.y*v2.z - v1.z*v2.y, v1.z*v2.x - v1.x*v2.z, v1.x*v2.y - v1.y*v2.x);
 }
 
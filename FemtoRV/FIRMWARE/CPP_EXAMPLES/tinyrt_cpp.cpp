@@ -1,4 +1,9 @@
 // This one does not work on the IceStick (6kB is not sufficient)
+//
+// Scalars are floats, or Q16.16 fixed point numbers (fixed.h) if
+// TINYRT_FIXED is defined (make tinyrt_cpp_fixed.elf), for the cores
+// without the F extension. Both versions display the rendering time,
+// to compare them on the same core.
 
 #define _USE_MATH_DEFINES
 #include <cmath>
@@ -11,59 +16,79 @@ extern "C" {
    #include <femtoGL.h>
 }
 
+#ifdef TINYRT_FIXED
+#include "fixed.h"
+typedef fixed<16> real;
+#define REAL_MAX   real::max()
+#define REAL_NAME  "fixed<16>"
+#define RAY_OFFSET real(4e-3f) // 1e-3 is only 65 units of the last place
+#else
+typedef float real;
+#define REAL_MAX   std::numeric_limits<float>::max()
+#define REAL_NAME  "float"
+#define RAY_OFFSET real(1e-3f)
+#endif
+
+typedef vec<3,real> Vec3r;
+typedef vec<4,real> Vec4r;
+
+using std::sqrt;
+using std::fabs;
+using std::pow;
+
 
 struct Light {
-    Light(const Vec3f &p, const float i) : position(p), intensity(i) {}
-    Vec3f position;
-    float intensity;
+    Light(const Vec3r &p, const real i) : position(p), intensity(i) {}
+    Vec3r position;
+    real intensity;
 };
 
 struct Material {
-    Material(const float r, const Vec4f &a, const Vec3f &color, const float spec) : refractive_index(r), albedo(a), diffuse_color(color), specular_exponent(spec) {}
+    Material(const real r, const Vec4r &a, const Vec3r &color, const real spec) : refractive_index(r), albedo(a), diffuse_color(color), specular_exponent(spec) {}
     Material() : refractive_index(1), albedo(1,0,0,0), diffuse_color(), specular_exponent() {}
-    float refractive_index;
-    Vec4f albedo;
-    Vec3f diffuse_color;
-    float specular_exponent;
+    real refractive_index;
+    Vec4r albedo;
+    Vec3r diffuse_color;
+    real specular_exponent;
 };
 
 struct Sphere {
-    Vec3f center;
-    float radius;
+    Vec3r center;
+    real radius;
     Material material;
 
-    Sphere(const Vec3f &c, const float r, const Material &m) : center(c), radius(r), material(m) {}
+    Sphere(const Vec3r &c, const real r, const Material &m) : center(c), radius(r), material(m) {}
 
-    bool ray_intersect(const Vec3f &orig, const Vec3f &dir, float &t0) const {
-        Vec3f L = center - orig;
-        float tca = L*dir;
-        float d2 = L*L - tca*tca;
+    bool ray_intersect(const Vec3r &orig, const Vec3r &dir, real &t0) const {
+        Vec3r L = center - orig;
+        real tca = L*dir;
+        real d2 = L*L - tca*tca;
         if (d2 > radius*radius) return false;
-        float thc = sqrtf(radius*radius - d2);
+        real thc = sqrt(radius*radius - d2);
         t0       = tca - thc;
-        float t1 = tca + thc;
-        if (t0 < 0) t0 = t1;
-        if (t0 < 0) return false;
+        real t1 = tca + thc;
+        if (t0 < real(0)) t0 = t1;
+        if (t0 < real(0)) return false;
         return true;
     }
 };
 
-Vec3f reflect(const Vec3f &I, const Vec3f &N) {
-    return I - N*2.f*(I*N);
+Vec3r reflect(const Vec3r &I, const Vec3r &N) {
+    return I - N*(real(2)*(I*N));
 }
 
-Vec3f refract(const Vec3f &I, const Vec3f &N, const float eta_t, const float eta_i=1.f) { // Snell's law
-    float cosi = - std::max(-1.f, std::min(1.f, I*N));
-    if (cosi<0) return refract(I, -N, eta_i, eta_t); // if the ray comes from the inside the object, swap the air and the media
-    float eta = eta_i / eta_t;
-    float k = 1 - eta*eta*(1 - cosi*cosi);
-    return k<0 ? Vec3f(1,0,0) : I*eta + N*(eta*cosi - sqrtf(k)); // k<0 = total reflection, no ray to refract. I refract it anyways, this has no physical meaning
+Vec3r refract(const Vec3r &I, const Vec3r &N, const real eta_t, const real eta_i=real(1)) { // Snell's law
+    real cosi = - std::max(real(-1), std::min(real(1), I*N));
+    if (cosi<real(0)) return refract(I, -N, eta_i, eta_t); // if the ray comes from the inside the object, swap the air and the media
+    real eta = eta_i / eta_t;
+    real k = real(1) - eta*eta*(real(1) - cosi*cosi);
+    return k<real(0) ? Vec3r(1,0,0) : I*eta + N*(eta*cosi - sqrt(k)); // k<0 = total reflection, no ray to refract. I refract it anyways, this has no physical meaning
 }
 
-bool scene_intersect(const Vec3f &orig, const Vec3f &dir, const std::vector<Sphere> &spheres, Vec3f &hit, Vec3f &N, Material &material) {
-    float spheres_dist = std::numeric_limits<float>::max();
+bool scene_intersect(const Vec3r &orig, const Vec3r &dir, const std::vector<Sphere> &spheres, Vec3r &hit, Vec3r &N, Material &material) {
+    real spheres_dist = REAL_MAX;
     for (size_t i=0; i < spheres.size(); i++) {
-        float dist_i;
+        real dist_i;
         if (spheres[i].ray_intersect(orig, dir, dist_i) && dist_i < spheres_dist) {
             spheres_dist = dist_i;
             hit = orig + dir*dist_i;
@@ -72,50 +97,50 @@ bool scene_intersect(const Vec3f &orig, const Vec3f &dir, const std::vector<Sphe
         }
     }
 
-    float checkerboard_dist = std::numeric_limits<float>::max();
-    if (fabs(dir.y)>1e-3)  {
-        float d = -(orig.y+4)/dir.y; // the checkerboard plane has equation y = -4
-        Vec3f pt = orig + dir*d;
-        if (d>0 && fabs(pt.x)<10 && pt.z<-10 && pt.z>-30 && d<spheres_dist) {
+    real checkerboard_dist = REAL_MAX;
+    if (fabs(dir.y)>real(1e-3f))  {
+        real d = -(orig.y+real(4))/dir.y; // the checkerboard plane has equation y = -4
+        Vec3r pt = orig + dir*d;
+        if (d>real(0) && fabs(pt.x)<real(10) && pt.z<real(-10) && pt.z>real(-30) && d<spheres_dist) {
             checkerboard_dist = d;
             hit = pt;
-            N = Vec3f(0,1,0);
-            material.diffuse_color = (int(.5*hit.x+1000) + int(.5*hit.z)) & 1 ? Vec3f(.3, .3, .3) : Vec3f(.3, .2, .1);
+            N = Vec3r(0,1,0);
+            material.diffuse_color = (int(real(.5f)*hit.x+real(1000)) + int(real(.5f)*hit.z)) & 1 ? Vec3r(.3f, .3f, .3f) : Vec3r(.3f, .2f, .1f);
         }
     }
-    return std::min(spheres_dist, checkerboard_dist)<1000;
+    return std::min(spheres_dist, checkerboard_dist)<real(1000);
 }
 
-Vec3f cast_ray(const Vec3f &orig, const Vec3f &dir, const std::vector<Sphere> &spheres, const std::vector<Light> &lights, size_t depth=0) {
-    Vec3f point, N;
+Vec3r cast_ray(const Vec3r &orig, const Vec3r &dir, const std::vector<Sphere> &spheres, const std::vector<Light> &lights, size_t depth=0) {
+    Vec3r point, N;
     Material material;
 
     if (depth>4 || !scene_intersect(orig, dir, spheres, point, N, material)) {
-        return Vec3f(0.2, 0.7, 0.8); // background color
+        return Vec3r(0.2f, 0.7f, 0.8f); // background color
     }
 
-    Vec3f reflect_dir = reflect(dir, N).normalize();
-    Vec3f refract_dir = refract(dir, N, material.refractive_index).normalize();
-    Vec3f reflect_orig = reflect_dir*N < 0 ? point - N*1e-3 : point + N*1e-3; // offset the original point to avoid occlusion by the object itself
-    Vec3f refract_orig = refract_dir*N < 0 ? point - N*1e-3 : point + N*1e-3;
-    Vec3f reflect_color = cast_ray(reflect_orig, reflect_dir, spheres, lights, depth + 1);
-    Vec3f refract_color = cast_ray(refract_orig, refract_dir, spheres, lights, depth + 1);
+    Vec3r reflect_dir = reflect(dir, N).normalize();
+    Vec3r refract_dir = refract(dir, N, material.refractive_index).normalize();
+    Vec3r reflect_orig = reflect_dir*N < real(0) ? point - N*RAY_OFFSET : point + N*RAY_OFFSET; // offset the original point to avoid occlusion by the object itself
+    Vec3r refract_orig = refract_dir*N < real(0) ? point - N*RAY_OFFSET : point + N*RAY_OFFSET;
+    Vec3r reflect_color = cast_ray(reflect_orig, reflect_dir, spheres, lights, depth + 1);
+    Vec3r refract_color = cast_ray(refract_orig, refract_dir, spheres, lights, depth + 1);
 
-    float diffuse_light_intensity = 0, specular_light_intensity = 0;
+    real diffuse_light_intensity = 0, specular_light_intensity = 0;
     for (size_t i=0; i<lights.size(); i++) {
-        Vec3f light_dir      = (lights[i].position - point).normalize();
-        float light_distance = (lights[i].position - point).norm();
+        Vec3r light_dir      = (lights[i].position - point).normalize();
+        real light_distance = (lights[i].position - point).norm();
 
-        Vec3f shadow_orig = light_dir*N < 0 ? point - N*1e-3 : point + N*1e-3; // checking if the point lies in the shadow of the lights[i]
-        Vec3f shadow_pt, shadow_N;
+        Vec3r shadow_orig = light_dir*N < real(0) ? point - N*RAY_OFFSET : point + N*RAY_OFFSET; // checking if the point lies in the shadow of the lights[i]
+        Vec3r shadow_pt, shadow_N;
         Material tmpmaterial;
         if (scene_intersect(shadow_orig, light_dir, spheres, shadow_pt, shadow_N, tmpmaterial) && (shadow_pt-shadow_orig).norm() < light_distance)
             continue;
 
-        diffuse_light_intensity  += lights[i].intensity * std::max(0.f, light_dir*N);
-        specular_light_intensity += powf(std::max(0.f, -reflect(-light_dir, N)*dir), material.specular_exponent)*lights[i].intensity;
+        diffuse_light_intensity  += lights[i].intensity * std::max(real(0), light_dir*N);
+        specular_light_intensity += pow(std::max(real(0), -reflect(-light_dir, N)*dir), material.specular_exponent)*lights[i].intensity;
     }
-    return material.diffuse_color * diffuse_light_intensity * material.albedo[0] + Vec3f(1., 1., 1.)*specular_light_intensity * material.albedo[1] + reflect_color*material.albedo[2] + refract_color*material.albedo[3];
+    return material.diffuse_color * (diffuse_light_intensity * material.albedo[0]) + Vec3r(1, 1, 1)*(specular_light_intensity * material.albedo[1]) + reflect_color*material.albedo[2] + refract_color*material.albedo[3];
 }
 
 const uint8_t dither[4][4] = {
@@ -125,30 +150,30 @@ const uint8_t dither[4][4] = {
   {15, 7,13, 5}
 };
 
-void set_pixel(int x, int y, float r, float g, float b) {
-   r = std::max(0.0f, std::min(1.0f, r));
-   g = std::max(0.0f, std::min(1.0f, g));
-   b = std::max(0.0f, std::min(1.0f, b));
+void set_pixel(int x, int y, real r, real g, real b) {
+   r = std::max(real(0), std::min(real(1), r));
+   g = std::max(real(0), std::min(real(1), g));
+   b = std::max(real(0), std::min(real(1), b));
    switch(FGA_mode) {
    case GL_MODE_OLED: {
-     uint8_t R = (uint8_t)(255.0f * r);
-     uint8_t G = (uint8_t)(255.0f * g);
-     uint8_t B = (uint8_t)(255.0f * b);
+     uint8_t R = (uint8_t)int(real(255) * r);
+     uint8_t G = (uint8_t)int(real(255) * g);
+     uint8_t B = (uint8_t)int(real(255) * b);
      GL_setpixel(x,y,GL_RGB(R,G,B));
    } break;
    case FGA_MODE_320x200x16bpp: {
-     uint8_t R = (uint8_t)(255.0f * r);
-     uint8_t G = (uint8_t)(255.0f * g);
-     uint8_t B = (uint8_t)(255.0f * b);
+     uint8_t R = (uint8_t)int(real(255) * r);
+     uint8_t G = (uint8_t)int(real(255) * g);
+     uint8_t B = (uint8_t)int(real(255) * b);
      FGA_setpixel(x,y,GL_RGB(R,G,B));     
    } break;
    case FGA_MODE_320x200x8bpp: {
-     float gray = 0.2126f * r + 0.7152f * g + 0.0722 * b;
-     FGA_setpixel(x,y,(uint16_t)(gray*255.0f));
+     real gray = real(0.2126f) * r + real(0.7152f) * g + real(0.0722f) * b;
+     FGA_setpixel(x,y,(uint16_t)int(gray*real(255)));
    } break;
    case FGA_MODE_640x400x4bpp: {
-     float gray = 0.2126f * r + 0.7152f * g + 0.0722 * b;
-     uint16_t GRAY = (uint16_t)(gray*255.0f);
+     real gray = real(0.2126f) * r + real(0.7152f) * g + real(0.0722f) * b;
+     uint16_t GRAY = (uint16_t)int(gray*real(255));
      uint16_t OFF = (GRAY & 15) > dither[x&3][y&3];
      FGA_setpixel(x,y,MIN((GRAY>>4)+OFF,15));
    } break;
@@ -156,35 +181,44 @@ void set_pixel(int x, int y, float r, float g, float b) {
 }
 
 
-void render(const std::vector<Sphere> &spheres, const std::vector<Light> &lights) {
-    const float fov      = M_PI/3.;
+// The primary rays are divided by the height of the image (the length of
+// dir_z would not fit in Q16.16 once squared by normalize()).
+// -0.8660254 = -1/(2*tan(fov/2)), with fov = M_PI/3.
+// Returns the rendering time in milliseconds, measured row by row
+// (the cycles counter of some cores wraps during a frame).
+uint32_t render(const std::vector<Sphere> &spheres, const std::vector<Light> &lights) {
+    const real dir_z = real(-0.8660254f);
+    const real h2 = real(2*int(GL_height));
+    uint32_t kcycles = 0;
     for (size_t j = 0; j<GL_height; j++) { // actual rendering loop
+        uint64_t row_cycles = cycles();
         for (size_t i = 0; i<GL_width; i++) {
-            float dir_x =  (i + 0.5) -  GL_width/2.;
-            float dir_y = -(j + 0.5) + GL_height/2.;    // this flips the image at the same time
-            float dir_z = -GL_height/(2.*tan(fov/2.));
-	    Vec3f RGB = cast_ray(Vec3f(0,0,0), Vec3f(dir_x, dir_y, dir_z).normalize(), spheres, lights);
+            real dir_x = real( 2*int(i) + 1 - int(GL_width))  / h2;
+            real dir_y = real(-2*int(j) - 1 + int(GL_height)) / h2; // this flips the image at the same time
+	    Vec3r RGB = cast_ray(Vec3r(0,0,0), Vec3r(dir_x, dir_y, dir_z).normalize(), spheres, lights);
 	    set_pixel(i,j,RGB.x,RGB.y,RGB.z);
         }
+        kcycles += (uint32_t)(cycles() - row_cycles) / 1000;
     }
+    return kcycles / FEMTORV32_FREQ;
 }
 
 int main() {
-    Material      ivory(1.0, Vec4f(0.6,  0.3, 0.1, 0.0), Vec3f(0.4, 0.4, 0.3),   50.);
-    Material      glass(1.5, Vec4f(0.0,  0.5, 0.1, 0.8), Vec3f(0.6, 0.7, 0.8),  125.);
-    Material red_rubber(1.0, Vec4f(0.9,  0.1, 0.0, 0.0), Vec3f(0.3, 0.1, 0.1),   10.);
-    Material     mirror(1.0, Vec4f(0.0, 10.0, 0.8, 0.0), Vec3f(1.0, 1.0, 1.0), 1425.);
+    Material      ivory(1.0, Vec4r(0.6,  0.3, 0.1, 0.0), Vec3r(0.4, 0.4, 0.3),   50.);
+    Material      glass(1.5, Vec4r(0.0,  0.5, 0.1, 0.8), Vec3r(0.6, 0.7, 0.8),  125.);
+    Material red_rubber(1.0, Vec4r(0.9,  0.1, 0.0, 0.0), Vec3r(0.3, 0.1, 0.1),   10.);
+    Material     mirror(1.0, Vec4r(0.0, 10.0, 0.8, 0.0), Vec3r(1.0, 1.0, 1.0), 1425.);
 
     std::vector<Sphere> spheres;
-    spheres.push_back(Sphere(Vec3f(-3,    0,   -16), 2,      ivory));
-    spheres.push_back(Sphere(Vec3f(-1.0, -1.5, -12), 2,      glass));
-    spheres.push_back(Sphere(Vec3f( 1.5, -0.5, -18), 3, red_rubber));
-    spheres.push_back(Sphere(Vec3f( 7,    5,   -18), 4,     mirror));
+    spheres.push_back(Sphere(Vec3r(-3,    0,   -16), 2,      ivory));
+    spheres.push_back(Sphere(Vec3r(-1.0, -1.5, -12), 2,      glass));
+    spheres.push_back(Sphere(Vec3r( 1.5, -0.5, -18), 3, red_rubber));
+    spheres.push_back(Sphere(Vec3r( 7,    5,   -18), 4,     mirror));
 
     std::vector<Light>  lights;
-    lights.push_back(Light(Vec3f(-20, 20,  20), 1.5));
-    lights.push_back(Light(Vec3f( 30, 50, -25), 1.8));
-    lights.push_back(Light(Vec3f( 30, 20,  30), 1.7));
+    lights.push_back(Light(Vec3r(-20, 20,  20), 1.5));
+    lights.push_back(Light(Vec3r( 30, 50, -25), 1.8));
+    lights.push_back(Light(Vec3r( 30, 20,  30), 1.7));
 
     GL_init(GL_MODE_CHOOSE);
     if(FGA_mode == FGA_MODE_320x200x8bpp ) {
@@ -198,7 +232,8 @@ int main() {
     }
 
     GL_clear();
-    render(spheres, lights);
+    uint32_t ms = render(spheres, lights);
+    printf("tinyrt_cpp (" REAL_NAME "): %d.%s%d s\n", ms/1000, ms%1000 >= 100 ? "" : (ms%1000 >= 10 ? "0" : "00"), ms%1000);
 
     return 0;
 }
@@ -0,0 +1,12 @@
+// Sends the multiplications and divisions of libgcc to the kernels chosen
+// at runtime by LIBFEMTORV32 (femto_dispatch.h): M instructions if the
+// core has them. Linked with --wrap for the five functions when
+// MULDIV_DISPATCH is defined (see makefile.inc).
+
+#include <femto_dispatch.h>
+
+uint32_t __wrap___mulsi3(uint32_t a, uint32_t b)  { return femto_kernels.mul(a, b);  }
+int32_t  __wrap___divsi3(int32_t a, int32_t b)    { return femto_kernels.div(a, b);  }
+uint32_t __wrap___udivsi3(uint32_t a, uint32_t b) { return femto_kernels.divu(a, b); }
+int32_t  __wrap___modsi3(int32_t a, int32_t b)    { return femto_kernels.rem(a, b);  }
+uint32_t __wrap___umodsi3(uint32_t a, uint32_t b) { return femto_kernels.remu(a, b); }
@@ -0,0 +1,18 @@
+// Replaces newlib's malloc() with the pool allocator of LIBFEMTORV32
+// (femto_alloc.h). Linked before libc.a when POOL_MALLOC is defined
+// (see makefile.inc). The _r variants are the ones called from inside
+// newlib (stdio buffers...), defining them keeps newlib's mallocr.o out.
+
+#include <femto_alloc.h>
+
+struct _reent;
+
+void* malloc(size_t size)                { return femto_malloc(size);          }
+void  free(void* ptr)                    { femto_free(ptr);                    }
+void* calloc(size_t nmemb, size_t size)  { return femto_calloc(nmemb, size);   }
+void* realloc(void* ptr, size_t size)    { return femto_realloc(ptr, size);    }
+
+void* _malloc_r(struct _reent* r, size_t size)               { return femto_malloc(size);        }
+void  _free_r(struct _reent* r, void* ptr)                   { femto_free(ptr);                  }
+void* _calloc_r(struct _reent* r, size_t nmemb, size_t size) { return femto_calloc(nmemb, size); }
+void* _realloc_r(struct _reent* r, void* ptr, size_t size)   { return femto_realloc(ptr, size);  }
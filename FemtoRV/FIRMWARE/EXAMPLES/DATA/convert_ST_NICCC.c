@@ -0,0 +1,369 @@
+/*
+ * Host program that converts scene1.dat (see scene_description.txt)
+ * into a stream for a given display (see ST_NICCC_gfx.c), so that the
+ * player does not need to decode, scale or rasterize anything:
+ *  - vertices are scaled for the display and polygons clipped,
+ *  - polygons are split into trapezoids (rows y..y+h-1, left and right
+ *    edges in 16.16 fixed point),
+ *  - colors are pre-encoded: palette index (colormapped modes, with the
+ *    palette changes as FGA command words) or RGB16 value (OLED and
+ *    FGA 320x200x16bpp, as sent to IO_GFX_DAT).
+ *
+ * Usage: convert_ST_NICCC target [scene1.dat] [scene1.gfx]
+ *   targets: oled (SSD1351, 128x128), ssd1331 (96x64),
+ *            320x200x16, 320x200x8, 640x400x4 (FGA modes)
+ * Then copy scene1.gfx to the SD card.
+ *
+ * File format: 32-bits little-endian words.
+ *   header:          NICCC_GFX_MAGIC, display mode (-1: OLED, else FGA mode).
+ *   palette:         FGA_CMD_SET_PALETTE_R/G/B command words, to be sent as is.
+ *   trapezoid:       NICCC_TRAPEZOID | color << 16, y | h << 16,
+ *                    x_left, x_right, dx_left, dx_right (16.16 fixed point).
+ *   end of frame:    NICCC_END_FRAME
+ *   end of stream:   NICCC_END_STREAM
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef unsigned char  uint8_t;
+typedef unsigned short uint16_t;
+typedef unsigned int   uint32_t;
+
+/* Keep in sync with LIBFEMTOGL/FGA.h and ST_NICCC_gfx.c */
+#define FGA_CMD_SET_PALETTE_R (128 | 1)
+#define FGA_CMD_SET_PALETTE_G (128 | 2)
+#define FGA_CMD_SET_PALETTE_B (128 | 3)
+#define FGA_CMD2(CMD,ARG1,ARG2) ((CMD) | ((ARG1) << 8) | ((ARG2) << 20))
+
+#define NICCC_GFX_MAGIC  0x4346494E /* "NIFC" */
+#define NICCC_TRAPEZOID  (128 | 32)
+#define NICCC_END_FRAME  (128 | 33)
+#define NICCC_END_STREAM (128 | 34)
+
+#define GL_MODE_OLED -1
+
+typedef struct {
+   const char* name;
+   int mode;         /* GL_MODE_OLED or FGA mode */
+   int width;
+   int height;
+   int shift;        /* ST-NICCC coordinates are multiplied by 2^shift */
+   int offset_x;
+   int offset_y;
+   int colormapped;
+} Target;
+
+Target targets[] = {
+   { "oled",       GL_MODE_OLED, 128, 128, -1,   0,   0, 0 },
+   { "ssd1331",    GL_MODE_OLED,  96,  64, -1, -16, -32, 0 },
+   { "320x200x16", 0,            320, 200,  0,   0,   0, 0 },
+   { "320x200x8",  1,            320, 200,  0,   0,   0, 1 },
+   { "640x400x4",  2,            640, 400,  1,   0,   0, 1 },
+};
+
+#define NB_TARGETS (int)(sizeof(targets)/sizeof(targets[0]))
+
+Target* target = NULL;
+
+uint8_t* data = NULL;   /* the whole ST-NICCC stream */
+long     data_size = 0;
+long     cur = 0;
+
+uint8_t next_byte() {
+   return (cur < data_size) ? data[cur++] : 0xfd;
+}
+
+uint16_t next_word() {
+   /* words are stored in big endian format */
+   uint16_t hi  = (uint16_t)next_byte();
+   uint16_t low = (uint16_t)next_byte();
+   return low | (hi << 8);
+}
+
+FILE* out = NULL;
+long nb_out_words = 0;
+long nb_trapezoids = 0;
+
+void out_word(uint32_t w) {
+   uint8_t b[4];
+   b[0] = w; b[1] = w >> 8; b[2] = w >> 16; b[3] = w >> 24;
+   fwrite(b, 1, 4, out);
+   ++nb_out_words;
+}
+
+/*************************************************************************/
+
+uint16_t cmap[16]; /* RGB16, as in ST_NICCC.c */
+
+static void map_vertex(int* x, int* y) {
+   if(target->shift > 0) {
+      *x <<= target->shift;
+      *y <<= target->shift;
+   } else if(target->shift < 0) {
+      *x >>= -target->shift;
+      *y >>= -target->shift;
+   }
+   *x += target->offset_x;
+   *y += target->offset_y;
+}
+
+/*
+ * Sutherland-Hodgman clipping of a convex polygon against one side
+ * (axis 0: x, 1: y, keeps coord >= bound if sign > 0, <= bound otherwise).
+ */
+static int clip_side(int nb, int* in, int* out, int axis, int bound, int sign) {
+   int nb_out = 0;
+   for(int i=0; i<nb; ++i) {
+      int j = (i+1) % nb;
+      int* P = in + 2*i;
+      int* Q = in + 2*j;
+      int P_in = sign*(P[axis] - bound) >= 0;
+      int Q_in = sign*(Q[axis] - bound) >= 0;
+      if(P_in) {
+	 out[2*nb_out] = P[0]; out[2*nb_out+1] = P[1]; ++nb_out;
+      }
+      if(P_in != Q_in) {
+	 int other = 1-axis;
+	 int t_num = bound - P[axis];
+	 int t_den = Q[axis] - P[axis];
+	 out[2*nb_out+axis]  = bound;
+	 out[2*nb_out+other] = P[other] + (Q[other]-P[other]) * t_num / t_den;
+	 ++nb_out;
+      }
+   }
+   return nb_out;
+}
+
+static int clip_poly(int nb, int* poly) {
+   int tmp[64];
+   nb = clip_side(nb, poly, tmp, 0, 0, 1);
+   nb = clip_side(nb, tmp, poly, 0, target->width-1, -1);
+   nb = clip_side(nb, poly, tmp, 1, 0, 1);
+   nb = clip_side(nb, tmp, poly, 1, target->height-1, -1);
+   return nb;
+}
+
+/* x of the edge P,Q at row y, 16.16 fixed point, rounded */
+static int edge_x(int* P, int* Q, int y) {
+   long long num = (long long)(Q[0]-P[0]) * (y - P[1]) * 65536;
+   return P[0]*65536 + (int)(num / (Q[1]-P[1])) + 32768;
+}
+
+static int edge_dx(int* P, int* Q) {
+   return (int)((long long)(Q[0]-P[0]) * 65536 / (Q[1]-P[1]));
+}
+
+static void out_trapezoid(
+   int color, int y, int h, int xl, int xr, int dxl, int dxr
+) {
+   out_word(NICCC_TRAPEZOID | (color << 16));
+   out_word(y | (h << 16));
+   out_word(xl);
+   out_word(xr);
+   out_word(dxl);
+   out_word(dxr);
+   ++nb_trapezoids;
+}
+
+/*
+ * Splits a convex polygon into trapezoids, one between each pair of
+ * consecutive vertex ordinates (rows miny..maxy included, as in
+ * GL_fill_poly()).
+ */
+static void emit_poly(int nb, int* poly, int color) {
+   int ys[64];
+   int nb_ys = 0;
+   for(int i=0; i<nb; ++i) {
+      int k = 0;
+      while(k < nb_ys && ys[k] < poly[2*i+1]) {
+	 ++k;
+      }
+      if(k < nb_ys && ys[k] == poly[2*i+1]) {
+	 continue;
+      }
+      memmove(ys+k+1, ys+k, (nb_ys-k)*sizeof(int));
+      ys[k] = poly[2*i+1];
+      ++nb_ys;
+   }
+
+   if(nb_ys == 1) { /* flat polygon */
+      int minx = poly[0], maxx = poly[0];
+      for(int i=1; i<nb; ++i) {
+	 if(poly[2*i] < minx) minx = poly[2*i];
+	 if(poly[2*i] > maxx) maxx = poly[2*i];
+      }
+      out_trapezoid(color, ys[0], 1, minx << 16, maxx << 16, 0, 0);
+      return;
+   }
+
+   for(int k=0; k+1<nb_ys; ++k) {
+      int y1 = ys[k];
+      int y2 = ys[k+1];
+      int h = y2 - y1 + (k+2 == nb_ys); /* last band includes its last row */
+
+      /* the two edges that cross the band */
+      int* E[2][2];
+      int nb_edges = 0;
+      for(int i=0; i<nb && nb_edges < 2; ++i) {
+	 int* P = poly + 2*i;
+	 int* Q = poly + 2*((i+1)%nb);
+	 if(P[1] > Q[1]) {
+	    int* T = P; P = Q; Q = T;
+	 }
+	 if(P[1] <= y1 && Q[1] >= y2 && P[1] != Q[1]) {
+	    E[nb_edges][0] = P;
+	    E[nb_edges][1] = Q;
+	    ++nb_edges;
+	 }
+      }
+      if(nb_edges != 2) {
+	 continue;
+      }
+      int xa  = edge_x(E[0][0], E[0][1], y1);
+      int xb  = edge_x(E[1][0], E[1][1], y1);
+      int dxa = edge_dx(E[0][0], E[0][1]);
+      int dxb = edge_dx(E[1][0], E[1][1]);
+      /* left edge: the leftmost one at mid-band */
+      if(2*xa + dxa*(y2-y1) > 2*xb + dxb*(y2-y1)) {
+	 int t = xa; xa = xb; xb = t;
+	 t = dxa; dxa = dxb; dxb = t;
+      }
+      out_trapezoid(color, y1, h, xa, xb, dxa, dxb);
+   }
+}
+
+/*************************************************************************/
+
+#define CLEAR_BIT   1
+#define PALETTE_BIT 2
+#define INDEXED_BIT 4
+
+/* returns 0 at last frame */
+int convert_frame() {
+   int X[255];
+   int Y[255];
+   int poly[64];
+
+   uint8_t frame_flags = next_byte();
+
+   if(frame_flags & PALETTE_BIT) {
+      uint16_t colors = next_word();
+      for(int b=15; b>=0; --b) {
+	 if(colors & (1 << b)) {
+	    int rgb = next_word();
+	    int b3 = (rgb & 0x007);
+	    int g3 = (rgb & 0x070) >> 4;
+	    int r3 = (rgb & 0x700) >> 8;
+	    cmap[15-b] = (b3 << 2) | (g3 << 8) | (r3 << 13);
+	    if(target->colormapped) {
+	       out_word(FGA_CMD2(FGA_CMD_SET_PALETTE_R, 15-b, r3 << 5));
+	       out_word(FGA_CMD2(FGA_CMD_SET_PALETTE_G, 15-b, g3 << 5));
+	       out_word(FGA_CMD2(FGA_CMD_SET_PALETTE_B, 15-b, b3 << 5));
+	    }
+	 }
+      }
+   }
+
+   if(frame_flags & INDEXED_BIT) {
+      uint8_t nb_vertices = next_byte();
+      for(int v=0; v<nb_vertices; ++v) {
+	 X[v] = next_byte();
+	 Y[v] = next_byte();
+	 map_vertex(&X[v], &Y[v]);
+      }
+   }
+
+   for(;;) {
+      uint8_t poly_desc = next_byte();
+      if(poly_desc == 0xff) {
+	 out_word(NICCC_END_FRAME);
+	 return 1;
+      }
+      if(poly_desc == 0xfe) {
+	 cur = (cur + 65535) & ~65535l;
+	 out_word(NICCC_END_FRAME);
+	 return 1;
+      }
+      if(poly_desc == 0xfd) {
+	 out_word(NICCC_END_FRAME);
+	 out_word(NICCC_END_STREAM);
+	 return 0;
+      }
+      uint8_t nvrtx = poly_desc & 15;
+      uint8_t poly_col = poly_desc >> 4;
+      for(int i=0; i<nvrtx; ++i) {
+	 if(frame_flags & INDEXED_BIT) {
+	    uint8_t index = next_byte();
+	    poly[2*i]   = X[index];
+	    poly[2*i+1] = Y[index];
+	 } else {
+	    poly[2*i]   = next_byte();
+	    poly[2*i+1] = next_byte();
+	    map_vertex(&poly[2*i], &poly[2*i+1]);
+	 }
+      }
+      int nb = clip_poly(nvrtx, poly);
+      if(nb >= 1) {
+	 emit_poly(nb, poly, target->colormapped ? poly_col : cmap[poly_col]);
+      }
+   }
+}
+
+int main(int argc, char** argv) {
+   if(argc < 2) {
+      fprintf(stderr,"usage: %s target [scene1.dat] [scene1.gfx]\n", argv[0]);
+      fprintf(stderr,"targets:");
+      for(int i=0; i<NB_TARGETS; ++i) {
+	 fprintf(stderr," %s", targets[i].name);
+      }
+      fprintf(stderr,"\n");
+      return 1;
+   }
+   for(int i=0; i<NB_TARGETS; ++i) {
+      if(!strcmp(argv[1], targets[i].name)) {
+	 target = &targets[i];
+      }
+   }
+   if(target == NULL) {
+      fprintf(stderr,"unknown target: %s\n", argv[1]);
+      return 1;
+   }
+   const char* in_name  = (argc > 2) ? argv[2] : "scene1.dat";
+   const char* out_name = (argc > 3) ? argv[3] : "scene1.gfx";
+
+   FILE* in = fopen(in_name,"rb");
+   if(in == NULL) {
+      fprintf(stderr,"could not open %s\n", in_name);
+      return 1;
+   }
+   fseek(in, 0, SEEK_END);
+   data_size = ftell(in);
+   fseek(in, 0, SEEK_SET);
+   data = (uint8_t*)malloc(data_size);
+   if(fread(data, 1, data_size, in) != (size_t)data_size) {
+      fprintf(stderr,"could not read %s\n", in_name);
+      return 1;
+   }
+   fclose(in);
+
+   out = fopen(out_name,"wb");
+   if(out == NULL) {
+      fprintf(stderr,"could not open %s\n", out_name);
+      return 1;
+   }
+   out_word(NICCC_GFX_MAGIC);
+   out_word((uint32_t)target->mode);
+   int frames = 1;
+   while(convert_frame()) {
+      ++frames;
+   }
+   fclose(out);
+   printf(
+      "%s: %d frames, %ld trapezoids, %ld bytes\n",
+      out_name, frames, nb_trapezoids, nb_out_words*4
+   );
+   free(data);
+   return 0;
+}
@@ -12,18 +12,161 @@
  * that needs to be stored on the SD card. 
  *
  * More details and links in C_EXAMPLES/DATA/notes.txt
+ *
+ * Benchmark mode (make ST_NICCC_bench.elf, or -DST_NICCC_BENCHMARK):
+ * plays the whole demo without waiting for the vertical blank, and
+ * prints the number of frames per second (reading the SD card, decoding
+ * and rasterizing the polygons).
+ *
+ * Trace mode (make ST_NICCC_trace.elf, benchmark with -DST_NICCC_TRACE):
+ * also records the frames, the SD card reads and the rasterization in an
+ * event trace (LIBFEMTORV32/femto_trace.h), printed after each pass of
+ * the demo, to be converted into a Chrome trace with TOOLS/femto_trace_json.
+ *
+ * Prefetch mode (make ST_NICCC_prefetch.elf, or -DST_NICCC_PREFETCH):
+ * a second task (LIBFEMTORV32/femto_task.h) reads the next block of the
+ * stream while the current one is decoded. It runs when the main task
+ * waits for the FGA, and the main task runs when it waits for the SD card.
  */
 
 #include <femtoGL.h>
+#ifndef ST_NICCC_TRACE
+#define NO_FEMTO_TRACE
+#endif
+#include <femto_trace.h>
+#include <femto_task.h>
+
+enum { TRACE_FRAME, TRACE_SDREAD, TRACE_RASTER, TRACE_NB };
+
+#ifdef ST_NICCC_TRACE
+static const char* trace_names[TRACE_NB] = { "frame", "SD read", "raster" };
+static femto_trace_event trace_events[2048];
+#endif
+
+/*
+ * The stream is read in blocks of STREAM_BLOCK_SIZE bytes (a multiple of
+ * the sector size, so that fread() reads whole sectors straight into the
+ * buffer), and decoded from the buffer with an inline cursor.
+ * There is no DMA (the CPU does the SPI transfers): the next block is read
+ * when the current one is exhausted, or, in prefetch mode, by another task
+ * into the other buffer, during the waits of the main task.
+ */
+#ifndef STREAM_BLOCK_SIZE
+#define STREAM_BLOCK_SIZE 4096
+#endif
 
 FILE* F = 0;
-int cur_byte_address = 0;
+int      stream_block_address = 0; // offset in the file of stream_block[0]
+#ifdef ST_NICCC_PREFETCH
+uint8_t  stream_buffers[2][STREAM_BLOCK_SIZE];
+uint8_t* stream_block = stream_buffers[0];
+uint8_t* stream_ptr = stream_buffers[0];
+uint8_t* stream_end = stream_buffers[0];
+#else
+uint8_t  stream_block[STREAM_BLOCK_SIZE];
+uint8_t* stream_ptr = stream_block;
+uint8_t* stream_end = stream_block;
+#endif
+
+#ifdef ST_NICCC_PREFETCH
+
+enum { PREFETCH_IDLE, PREFETCH_REQUESTED, PREFETCH_READY };
+
+static volatile int prefetch_state = PREFETCH_IDLE;
+static uint8_t* prefetch_buffer;
+static int      prefetch_address; // offset in the file of prefetch_buffer[0]
+static int      prefetch_n;
+static femto_task prefetch_task;
+static uint32_t prefetch_stack[1024]; // fread() goes deep into fat_io_lib
+
+static void prefetch_loop(void* arg) {
+    for(;;) {
+       while(prefetch_state != PREFETCH_REQUESTED) {
+	  femto_yield();
+       }
+       TRACE_BEGIN(TRACE_SDREAD);
+       prefetch_n = fread(prefetch_buffer, 1, STREAM_BLOCK_SIZE, F);
+       TRACE_END(TRACE_SDREAD);
+       prefetch_state = PREFETCH_READY;
+    }
+}
+
+static void prefetch_request(int address) {
+    prefetch_buffer = (stream_block == stream_buffers[0]) ? stream_buffers[1] : stream_buffers[0];
+    prefetch_address = address;
+    prefetch_state = PREFETCH_REQUESTED;
+}
+
+// Waits for the block being read (if any), and forgets it
+static void prefetch_cancel() {
+    while(prefetch_state == PREFETCH_REQUESTED) {
+       femto_yield();
+    }
+    prefetch_state = PREFETCH_IDLE;
+}
+
+#endif
 
-uint8_t next_byte() {
-    uint8_t result;
-    fread(&result, 1, 1, F);
-    ++cur_byte_address;
-    return result;
+void stream_reset() {
+    stream_block_address = 0;
+    stream_ptr = stream_block;
+    stream_end = stream_block;
+}
+
+void stream_read_block() {
+    stream_block_address += stream_end - stream_block;
+#ifdef ST_NICCC_PREFETCH
+    if(prefetch_state == PREFETCH_IDLE) {
+       prefetch_request(stream_block_address);
+    }
+    while(prefetch_state != PREFETCH_READY) {
+       femto_yield();
+    }
+    int n = prefetch_n;
+    stream_block = prefetch_buffer;
+    // Reads the next block while this one is decoded
+    prefetch_request(stream_block_address + (n > 0 ? n : 0));
+#else
+    TRACE_BEGIN(TRACE_SDREAD);
+    int n = fread(stream_block, 1, STREAM_BLOCK_SIZE, F);
+    TRACE_END(TRACE_SDREAD);
+#endif
+    if(n <= 0) { 
+       stream_block[0] = 0xfd; // truncated file: end of stream
+       n = 1;
+    }
+    stream_ptr = stream_block;
+    stream_end = stream_block + n;
+}
+
+/*
+ * Goes to the next 64kb block of the stream (if not already at the
+ * beginning of one).
+ */
+void stream_next_64k() {
+    int address = stream_block_address + (stream_ptr - stream_block);
+    address = (address + 65535) & ~65535;
+#ifdef ST_NICCC_PREFETCH
+    // The block being read can be the right one
+    if(prefetch_state != PREFETCH_IDLE && prefetch_address == address) {
+       stream_block_address = address;
+       stream_ptr = stream_block;
+       stream_end = stream_block;
+       return;
+    }
+    prefetch_cancel();
+#endif
+    fseek(F, address, SEEK_SET);
+    stream_block_address = address;
+    stream_ptr = stream_block;
+    stream_end = stream_block;
+}
+
+static inline uint8_t next_byte() {
+    if(stream_ptr == stream_end) {
+       stream_read_block();
+    }
+    return *(stream_ptr++);
 }
 
 uint16_t next_word() {
@@ -92,6 +235,13 @@ int wireframe = 0;
  *   See DATA/test_ST_NICCC.c for an example
  * program.
  */
+// Rasterizes the polygons batched since GL_begin_frame()
+static inline void end_frame() {
+    TRACE_BEGIN(TRACE_RASTER);
+    GL_end_frame();
+    TRACE_END(TRACE_RASTER);
+}
+
 int read_frame() {
     uint8_t frame_flags = next_byte();
 
@@ -117,7 +267,9 @@ int read_frame() {
 	}
     }
 
+#ifndef ST_NICCC_BENCHMARK
     GL_wait_vbl();
+#endif
     if(wireframe) {
        GL_clear();
     } else {
@@ -136,7 +288,9 @@ int read_frame() {
 	}
     }
 
-    // Draw frame's polygons
+    // Draw frame's polygons (batched, each row of the
+    // screen is sent once in GL_end_frame())
+    GL_begin_frame();
     for(;;) {
 	uint8_t poly_desc = next_byte();
 
@@ -148,13 +302,12 @@ int read_frame() {
 	}
 	if(poly_desc == 0xfe) {
 	   // Go to next 64kb block
-	   // (TODO: with fseek !)
-	   while(cur_byte_address & 65535) {
-	      next_byte();
-	   }
+	   stream_next_64k();
+	   end_frame();
 	   return 1; 
 	}
 	if(poly_desc == 0xfd) {
+	    end_frame();
 	    return 0; // end of stream
 	}
 	
@@ -174,7 +327,7 @@ int read_frame() {
 	       poly[2*i+1] = y;
 	    }
 	}
-        GL_fill_poly(nvrtx,poly,colormapped ? poly_col : cmap[poly_col]);
+        GL_poly(nvrtx,poly,colormapped ? poly_col : cmap[poly_col]);
         /*       
         if(FGA_mode == GL_MODE_OLED) {
 	   GL_fill_poly(nvrtx,poly,cmap[poly_col]);
@@ -183,6 +336,7 @@ int read_frame() {
 	}
 	*/ 
     }
+    end_frame();
     return 1; 
 }
 
@@ -198,21 +352,57 @@ int main() {
     }
    
     wireframe = 0;
+#ifdef ST_NICCC_TRACE
+    femto_trace_init(trace_events, sizeof(trace_events));
+#endif
+#ifdef ST_NICCC_PREFETCH
+    femto_task_start(
+       &prefetch_task, prefetch_loop, 0, prefetch_stack, sizeof(prefetch_stack)
+    );
+#endif
    
     for(;;) {
-        cur_byte_address = 0;
 	F = fopen("/scene1.dat","r");
+        stream_reset();
 	if(!F) {
 	    printf("Could not open scene1.dat\n");
 	    return -1;
 	}
         GL_clear();
 	GL_polygon_mode(wireframe ? GL_POLY_LINES: GL_POLY_FILL);	
+#ifdef ST_NICCC_BENCHMARK
+	int frames = 1;
+	uint64_t start = cycles();
+	for(;;) {
+	   TRACE_BEGIN(TRACE_FRAME);
+	   int more = read_frame();
+	   TRACE_END(TRACE_FRAME);
+	   if(!more) {
+	      break;
+	   }
+	   ++frames;
+	}
+	uint64_t elapsed = cycles() - start;
+	uint32_t mfps = (uint32_t)(
+	   (uint64_t)frames * 1000 * FEMTORV32_FREQ * 1000000 / elapsed
+	);
+	printf(
+	   "%s: %d frames, %d.%03d fps\n", wireframe ? "lines" : "fill",
+	   frames, mfps / 1000, mfps % 1000
+	);
+#ifdef ST_NICCC_TRACE
+	femto_trace_dump(trace_names, TRACE_NB);
+#endif
+#else
 	while(read_frame()) {
 	   // delay(50); // If GL_clear() is uncommented, uncomment as well
 	   //            // to reduce flickering.
 	}
+#endif
         wireframe = !wireframe;
+#ifdef ST_NICCC_PREFETCH
+	prefetch_cancel();
+#endif
 	fclose(F);
     }
 }
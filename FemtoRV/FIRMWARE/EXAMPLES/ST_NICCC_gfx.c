@@ -0,0 +1,168 @@
+/*
+ * Plays the ST-NICCC megademo from a stream converted on the host for
+ * the display (DATA/convert_ST_NICCC.c): the vertices are already scaled
+ * and clipped, the polygons split into trapezoids, and the colors encoded
+ * for IO_GFX_DAT (or as palette indices, with the palette changes as FGA
+ * commands). There is nothing left to decode: each row of a trapezoid
+ * is one FILLRECT command sent to the FGA (or one window and a burst of
+ * pixels on the OLED display).
+ *
+ * femtosoc options (femtosoc.v):
+ *   OLED display (NRV_IO_SSD1351)
+ *   FGA          (NRV_IO_FGA)
+ *   SDCard       (NRV_IO_SPI_SDCARD)
+ *
+ * On the host:
+ *   gcc DATA/convert_ST_NICCC.c -o convert_ST_NICCC
+ *   ./convert_ST_NICCC 320x200x8 DATA/scene1.dat scene1.gfx
+ * then copy scene1.gfx to the SD card. The display mode is the one
+ * the stream was converted for.
+ *
+ * Benchmark mode (make ST_NICCC_gfx_bench.elf, or -DST_NICCC_BENCHMARK):
+ * no VBL wait, prints the number of frames per second.
+ */
+
+#include <femtoGL.h>
+
+/* Keep in sync with DATA/convert_ST_NICCC.c */
+#define NICCC_GFX_MAGIC  0x4346494E
+#define NICCC_TRAPEZOID  (128 | 32)
+#define NICCC_END_FRAME  (128 | 33)
+#define NICCC_END_STREAM (128 | 34)
+
+/*
+ * The stream is read in blocks of STREAM_BLOCK_SIZE bytes (a multiple of
+ * the sector size), and decoded from the buffer with an inline cursor,
+ * as in ST_NICCC.c.
+ */
+#ifndef STREAM_BLOCK_SIZE
+#define STREAM_BLOCK_SIZE 4096
+#endif
+
+FILE* F = 0;
+uint32_t  stream_block[STREAM_BLOCK_SIZE/4];
+uint32_t* stream_ptr = stream_block;
+uint32_t* stream_end = stream_block;
+
+void stream_reset() {
+    stream_ptr = stream_block;
+    stream_end = stream_block;
+}
+
+void stream_read_block() {
+    int n = fread(stream_block, 1, STREAM_BLOCK_SIZE, F) / 4;
+    if(n <= 0) {
+       stream_block[0] = NICCC_END_STREAM; // truncated file: end of stream
+       n = 1;
+    }
+    stream_ptr = stream_block;
+    stream_end = stream_block + n;
+}
+
+static inline uint32_t next_word() {
+    if(stream_ptr == stream_end) {
+       stream_read_block();
+    }
+    return *(stream_ptr++);
+}
+
+/*
+ * Sends a FILLRECT to the FGA, without going through the command queue
+ * of FGA_fill_rect() (nothing to compute between two commands here).
+ */
+static inline void fill_rect(int x1, int y1, int x2, int y2, uint16_t color) {
+   if(FGA_mode == GL_MODE_OLED) {
+      GL_fill_rect(x1, y1, x2, y2, color);
+      return;
+   }
+   while(IO_IN(IO_FGA_CNTL) & FGA_BUSY_bit);
+   FGA_CMD2(FGA_CMD_SET_WWINDOW_X, x1, x2);
+   FGA_CMD2(FGA_CMD_SET_WWINDOW_Y, y1, y2);
+   FGA_CMD1(FGA_CMD_FILLRECT, color);
+}
+
+/*
+ * Rows y..y+h-1, x_left and x_right in 16.16 fixed point (rounded by the
+ * converter). Trapezoids with vertical sides are a single rectangle.
+ */
+static void draw_trapezoid(uint32_t desc) {
+   uint16_t color = desc >> 16;
+   uint32_t yh = next_word();
+   int y  = yh & 0xffff;
+   int h  = yh >> 16;
+   int xl  = (int)next_word();
+   int xr  = (int)next_word();
+   int dxl = (int)next_word();
+   int dxr = (int)next_word();
+   if(dxl == 0 && dxr == 0) {
+      fill_rect(xl >> 16, y, xr >> 16, y+h-1, color);
+      return;
+   }
+   for(int i=0; i<h; ++i) {
+      fill_rect(xl >> 16, y+i, xr >> 16, y+i, color);
+      xl += dxl;
+      xr += dxr;
+   }
+}
+
+/* returns 0 if last frame */
+int read_frame() {
+#ifndef ST_NICCC_BENCHMARK
+    GL_wait_vbl();
+#endif
+    for(;;) {
+       uint32_t w = next_word();
+       switch(w & 255) {
+       case NICCC_TRAPEZOID:
+	  draw_trapezoid(w);
+	  break;
+       case NICCC_END_FRAME:
+	  return 1;
+       case NICCC_END_STREAM:
+	  return 0;
+       default: // palette commands, ready to be sent to the FGA
+	  IO_OUT(IO_FGA_CNTL, w);
+	  break;
+       }
+    }
+}
+
+int main() {
+    if(filesystem_init()) {
+       return -1;
+    }
+
+    for(;;) {
+	F = fopen("/scene1.gfx","r");
+	if(!F) {
+	    printf("Could not open scene1.gfx\n");
+	    return -1;
+	}
+        stream_reset();
+	if(next_word() != NICCC_GFX_MAGIC) {
+	    printf("scene1.gfx: not a converted stream\n");
+	    return -1;
+	}
+	GL_init((int)next_word());
+	GL_clear();
+	if(FGA_mode != GL_MODE_OLED) {
+	    FGA_finish(); // fill_rect() bypasses the FGA command queue
+	}
+#ifdef ST_NICCC_BENCHMARK
+	int frames = 0;
+	uint64_t start = cycles();
+	while(read_frame()) {
+	   ++frames;
+	}
+	uint64_t elapsed = cycles() - start;
+	uint32_t mfps = (uint32_t)(
+	   (uint64_t)frames * 1000 * FEMTORV32_FREQ * 1000000 / elapsed
+	);
+	printf("%d frames, %d.%03d fps\n", frames, mfps / 1000, mfps % 1000);
+#else
+	while(read_frame()) {
+	}
+#endif
+	fclose(F);
+    }
+}
@@ -17,6 +17,10 @@
  *
  * More details and links in EXAMPLES/DATA/notes.txt
  *
+ * Benchmark mode (make ST_NICCC_spi_flash_bench.elf): plays the whole
+ * demo without displaying the frame counter, and displays the number of
+ * frames per second.
+ *
  * Demo compiles to 1118 4-bytes words RISC-V assembly
  * code (I'd like to reduce it to 1024, to make it a
  * 4K demo ! Anyway there is 640 Kb of polygon data in
@@ -61,9 +65,10 @@ void spi_reset() {
 
 /**
  * Reads one byte from the SPI flash, using the mapped SPI flash interface.
+ * Inline, the SPI flash is only accessed once per 32-bits word.
  */
 #define SPI_FLASH_BASE ((uint32_t*)(1 << 23))
-uint8_t next_spi_byte() {
+static inline uint8_t next_spi_byte() {
    uint8_t result;
    if(spi_word_addr != spi_addr >> 2) {
       spi_word_addr = spi_addr >> 2;
@@ -221,12 +226,25 @@ int main() {
         frame=0;
         spi_reset();
 	GL_polygon_mode(wireframe ? GL_POLY_LINES: GL_POLY_FILL);	
+#ifdef ST_NICCC_BENCHMARK
+	uint64_t start = cycles();
+	while(read_frame()) {
+            ++frame;
+	}
+	uint64_t elapsed = cycles() - start;
+	uint32_t mfps = (uint32_t)(
+	   (uint64_t)(frame+1) * 1000 * FEMTORV32_FREQ * 1000000 / elapsed
+	);
+	GL_tty_goto_xy(0,0);
+	printf("%d.%03d fps", mfps / 1000, mfps % 1000);
+#else
 	while(read_frame()) {
             print_frame(frame);
             ++frame;
 	    // delay(10); // If GL_clear() is uncommented, uncomment as well
 	    //            // to reduce flickering.
 	}
+#endif
 	wireframe = !wireframe;
     }
 }
@@ -8,15 +8,13 @@
 #include <femtoGL.h>
 
 /*
- * Generated by TOOLS/make_sintab.c
+ * 64 entries sine table, between -65536 and 65536 (femtoGLsin.h),
+ * SINTAB(i) = 65536*sin(2*pi*i/64)
  */
-int sintab[64] = {
-    0,6423,12785,19023,25079,30892,36409,41574,46340,50659,54490,57796,60546,62713,64275,
-    65219,65535,65219,64275,62713,60546,57796,54490,50659,46340,41574,36409,30892,25079,
-    19023,12785,6423,0,-6423,-12785,-19023,-25079,-30892,-36409,-41574,-46340,-50659,
-    -54490,-57796,-60546,-62713,-64275,-65219,-65535,-65219,-64275,-62713,-60546,-57796,
-    -54490,-50659,-46340,-41574,-36409,-30892,-25079,-19023,-12785,-6423
-};
+#define GL_SIN_BITS  4
+#define GL_SIN_SHIFT 16
+#include <femtoGLsin.h>
+#define SINTAB(i) GL_sin((i) << 10)
 
 int vertices[8][3] = {
     {-1024,-1024,-1024},
@@ -52,8 +50,8 @@ uint16_t colors[6] = {
 // the code segment size, then we got a stack crash
 // (we are really at the limit of the 6kB space...)
 void rot_z(int a, int in[8][3], int out[8][3]) {
-    int s = sintab[a & 63];
-    int c = sintab[(a+16) & 63];    
+    int s = SINTAB(a);
+    int c = SINTAB(a+16);    
     for(int i=0; i<8; ++i) {
 	int x = in[i][0];
 	int y = in[i][1];
@@ -64,8 +62,8 @@ void rot_z(int a, int in[8][3], int out[8][3]) {
 */
 
 void rot_x(int a, int in[8][3], int out[8][3]) {
-    int s = sintab[a & 63];    
-    int c = sintab[(a+16) & 63];    
+    int s = SINTAB(a);    
+    int c = SINTAB(a+16);    
     for(int i=0; i<8; ++i) {
 	int y = in[i][1];
 	int z = in[i][2];
@@ -75,8 +73,8 @@ void rot_x(int a, int in[8][3], int out[8][3]) {
 }
 
 void rot_y(int a, int in[8][3], int out[8][3]) {
-    int s = sintab[a & 63];    
-    int c = sintab[(a+16) & 63];    
+    int s = SINTAB(a);    
+    int c = SINTAB(a+16);    
     for(int i=0; i<8; ++i) {
 	int z = in[i][2];
 	int x = in[i][0];
@@ -110,7 +108,7 @@ int main() {
 	    init_points();
 	}
 	++frame;
-        int scaling = (sintab[frame&63]>>8)+400;
+        int scaling = (SINTAB(frame)>>8)+400;
 	
 	// Too big to fit in 6k, wireframe mode
 	// causes stack crash... (worked before,
@@ -57,6 +57,9 @@ static inline uint16_t GL_RGB_f(float r, float g, float b) {
 
 // ImGui contest resolution: 320x180
 // OLED screen resolution:   128x128
+// Like ImDrawList, addQuad() and addRectFilled() only record the primitives
+// (femtoGL display list, in integer pixel coordinates), they are culled and
+// drawn in scanline order by GL_end_frame(), after FX().
 void addQuad(ImVec2 A, ImVec2 B, ImVec2 C, ImVec2 D, uint32_t color) {
    uint16_t r = (uint16_t)(color & 255);
    color = color >> 8;
@@ -74,7 +77,7 @@ void addQuad(ImVec2 A, ImVec2 B, ImVec2 C, ImVec2 D, uint32_t color) {
    pts[5] = (int)C.y / 2 + offy;
    pts[6] = (int)D.x / 2 + offx;
    pts[7] = (int)D.y / 2 + offy;
-   GL_fill_poly(4, pts, GL_RGB(r,g,b));
+   GL_poly(4, pts, GL_RGB(r,g,b));
 }
 
 
@@ -90,29 +93,29 @@ void addRectFilled(ImVec2 A, ImVec2 B, uint32_t color) {
    int y1 = (int)A.y / 2 + offy;
    int x2 = (int)B.x / 2 + offx;
    int y2 = (int)B.y / 2 + offy;
-   x1 = (x1 < 0) ? 0 : x1;
-   x1 = (x1 > 127) ? 127 : x1;
-   y1 = (y1 < 0) ? 0 : y1;
-   y1 = (y1 > 127) ? 127 : y1;
-   x2 = (x2 < 0) ? 0 : x2;
-   x2 = (x2 > 127) ? 127 : x2;
-   y2 = (y2 < 0) ? 0 : y2;
-   y2 = (y2 > 127) ? 127 : y2;   
-   GL_fill_rect(x1,y1,x2,y2,GL_RGB(r,g,b));
+   GL_rect(x1,y1,x2,y2,GL_RGB(r,g,b)); /* clipped, culled if outside */
 }
 
 void FX(ImVec2 a, ImVec2 b, ImVec2 d, float t); 
 
+// On the OLED screen, frames are drawn in RAM, and GL_flush() sends
+// only what changed.
+static uint16_t backbuffer[GL_BACKBUFFER_SIZE];
+
 void main() {
    ImVec2 a = vec2(0,0);
    ImVec2 b = vec2(320,180);
    ImVec2 d = vec2(320,180);
    float  t = 0.0;
    GL_init(GL_MODE_CHOOSE_RGB);
+   GL_set_backbuffer(backbuffer);
    GL_clear();
 
    for(;;) {
+      GL_begin_frame();
       FX(a,b,d,t);
+      GL_end_frame();
+      GL_flush();
       t = t+0.1;
    }
 }
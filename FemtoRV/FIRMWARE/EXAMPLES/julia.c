@@ -41,12 +41,6 @@ unsigned short sq[] = {
  115,112,110,107,105,102,100,97,95,92,90,87,85,83,81,78,76,74,72,70,68,66,64,62,60,58,56,54,52,50,49,47,45,43,42,40,39,37,36,34,33,31,30,28,27,26,25,23,
  22,21,20,19,18,17,16,15,14,13,12,11,10,9,9,8,7,6,6,5,5,4,4,3,3,2,2,1,1,1,1,0,0,0,0,0,0,0,0};
 
-void main() RV32_FASTCODE;
-
-void main() {
-   GL_init(GL_MODE_CHOOSE);
-   GL_clear();
-   
 #define MASK   ((1<<(IP+1))-1)
 #define CLAMP  ((1<<(IP-1))-1)
 #define NEG    ((1<<(IP+1))  )
@@ -56,39 +50,98 @@ void main() {
 #define YCmin  10
 #define YCmax  (YCmin+40)
 
-  int x_c = (XCmin+XCmax)>>1; int x_c_i = 1;
-  int y_c = (YCmin+YCmax)>>1; int y_c_i = 3;
+int x_c = (XCmin+XCmax)>>1;
+int y_c = (YCmin+YCmax)>>1;
+
+// ==== number of iterations before escape (24: did not escape)
+// periodicity check: the point is saved at iterations 1,2,4,8...,
+// if it comes back to the saved point, it will never escape.
+static inline int julia_iter(int i, int j) {
+  int x_f  = i - 64;
+  int y_f  = j - 64;
+  int x_saved = x_f;
+  int y_saved = y_f;
+  int period = 1;
+  int k = 0;
+  int clr=0;
+  for ( ; clr<24 ; clr++) {
+    int a_f = x_f & MASK;
+    int b_f = y_f & MASK;
+    int u_f = sq[a_f];
+    int v_f = sq[b_f];
+    int c_f = (x_f+y_f) & MASK;
+    int s_f = sq[c_f];
+    int w_f = s_f - u_f - v_f;
+    x_f     = u_f - v_f + x_c; // + i_f; // use for Mandlebrot
+    y_f     = w_f       + y_c; // + j_f; // use for Mandlebrot
+    if (u_f + v_f > CUTOFF) {
+      break;
+    }
+    if (x_f == x_saved && y_f == y_saved) {
+      return 24;
+    }
+    if (++k == period) {
+      k = 0; period <<= 1;
+      x_saved = x_f; y_saved = y_f;
+    }
+  }
+  return clr;
+}
 
-  while (1) {
-    GL_write_window(0,0,127,127);
-    int j_f = -64;
-    int pix = 0;
-    for (int j = 0 ; j < 128 ; ++j) {
-      int i_f = -64;
-      for (int i = 0 ; i < 128 ; ++i) {
-        int x_f  = i_f;
-        int y_f  = j_f;
-        int clr=0; int clr8=32;
-        for ( ; clr<24 ; clr++,clr8+=8) {
-          int a_f = x_f & MASK;
-          int b_f = y_f & MASK;
-          int u_f = sq[a_f];
-          int v_f = sq[b_f];
-          int c_f = (x_f+y_f) & MASK;
-          int s_f = sq[c_f];
-          int w_f = s_f - u_f - v_f;
-          x_f     = u_f - v_f + x_c; // + i_f; // use for Mandlebrot
-          y_f     = w_f       + y_c; // + j_f; // use for Mandlebrot
-          if (u_f + v_f > CUTOFF) {
-            break;
-          }
-        }
-	GL_WRITE_DATA_UINT16((clr8 << 8) | clr);
-        pix += 1;
-        i_f += 1;
-      }
-      j_f += 1;
+#define julia_color(clr) ((((clr)*8+32) << 8) | (clr))
+
+void julia_pixels(int x1, int y1, int x2, int y2) RV32_FASTCODE;
+void julia_pixels(int x1, int y1, int x2, int y2) {
+  GL_write_window(x1,y1,x2,y2);
+  for (int j = y1 ; j <= y2 ; ++j) {
+    for (int i = x1 ; i <= x2 ; ++i) {
+      GL_WRITE_DATA_UINT16(julia_color(julia_iter(i,j)));
     }
+  }
+}
+
+// ==== Mariani-Silver subdivision (see mandelbrot.c): a rectangle with
+// the same number of iterations on its whole border is filled without
+// iterating, else it is split in four.
+#define JULIA_MIN_SIZE 4
+
+void julia_rect(int x1, int y1, int x2, int y2) RV32_FASTCODE;
+void julia_rect(int x1, int y1, int x2, int y2) {
+  if (x2 - x1 < JULIA_MIN_SIZE || y2 - y1 < JULIA_MIN_SIZE) {
+    julia_pixels(x1,y1,x2,y2);
+    return;
+  }
+  int clr = julia_iter(x1,y1);
+  int same = 1;
+  for (int i = x1 ; same && i <= x2 ; ++i) {
+    same = (julia_iter(i,y1) == clr) && (julia_iter(i,y2) == clr);
+  }
+  for (int j = y1+1 ; same && j < y2 ; ++j) {
+    same = (julia_iter(x1,j) == clr) && (julia_iter(x2,j) == clr);
+  }
+  if (same) {
+    GL_fill_rect(x1,y1,x2,y2,julia_color(clr));
+    return;
+  }
+  int xm = (x1 + x2) >> 1;
+  int ym = (y1 + y2) >> 1;
+  julia_rect(x1,   y1,   xm, ym);
+  julia_rect(xm+1, y1,   x2, ym);
+  julia_rect(x1,   ym+1, xm, y2);
+  julia_rect(xm+1, ym+1, x2, y2);
+}
+
+void main() RV32_FASTCODE;
+
+void main() {
+   GL_init(GL_MODE_CHOOSE);
+   GL_clear();
+
+  int x_c_i = 1;
+  int y_c_i = 3;
+
+  while (1) {
+    julia_rect(0,0,127,127);
 
     x_c += x_c_i;
     if (x_c < XCmin || x_c > XCmax) { x_c_i = - x_c_i; }
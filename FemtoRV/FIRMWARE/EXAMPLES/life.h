@@ -0,0 +1,95 @@
+/*
+ * Game of life, bit-parallel (SWAR): 32 cells per word, the 8 neighbours
+ * counted with bit-sliced adders (one bit of each count in one word), so
+ * that each step is a few tens of logical operations per 32 cells.
+ *
+ * The grid is a torus of (32*nwords) x height cells, row y in words
+ * [y*nwords, (y+1)*nwords), cell x in bit x%32 of word x/32 (the pixel
+ * order of FGA 1bpp mode). It is updated in place, with three rows of
+ * scratch (3*nwords words).
+ *
+ * Used by life_led_matrix.c (8x8 torus, each row repeated 4 times in a
+ * 32 bits word, a 32-periodic torus evolves as the 8x8 one) and by
+ * life_FGA.c (full-screen 1024x768 FGA 1bpp).
+ */
+
+#ifndef H__LIFE__H
+#define H__LIFE__H
+
+#include <stdint.h>
+
+typedef struct {
+   uint32_t* cells;   /* height rows of nwords words */
+   int       nwords;  /* width / 32 */
+   int       height;
+   uint32_t* scratch; /* 3*nwords words */
+} Life;
+
+/*
+ * Computes the next state of row B (above: A, below: C) in out.
+ * Full adders sum the three cells of the rows above and below, a half
+ * adder the two neighbours in the row. The 2-bit sums add up to
+ * ones + 2*(number of carries): the cell lives if there is exactly one
+ * carry (sum 2 or 3) and ones is set (3) or the cell is alive (2).
+ */
+static inline void life_row(
+   const uint32_t* A, const uint32_t* B, const uint32_t* C, uint32_t* out, int n
+) {
+   uint32_t a_prev = A[n-1], b_prev = B[n-1], c_prev = C[n-1];
+   uint32_t a = A[0], b = B[0], c = C[0];
+   for(int k=0; k<n; ++k) {
+      int kp = (k == n-1) ? 0 : k+1;
+      uint32_t a_next = A[kp], b_next = B[kp], c_next = C[kp];
+
+      /* the neighbours at x-1 (l) and x+1 (r) */
+      uint32_t al = (a << 1) | (a_prev >> 31), ar = (a >> 1) | (a_next << 31);
+      uint32_t bl = (b << 1) | (b_prev >> 31), br = (b >> 1) | (b_next << 31);
+      uint32_t cl = (c << 1) | (c_prev >> 31), cr = (c >> 1) | (c_next << 31);
+
+      uint32_t t;
+      t = al ^ a;  uint32_t as = t ^ ar; uint32_t ac = (al & a) | (t & ar);
+      uint32_t bs = bl ^ br;             uint32_t bc = bl & br;
+      t = cl ^ c;  uint32_t cs = t ^ cr; uint32_t cc = (cl & c) | (t & cr);
+
+      /* ones bit, and its carry (a fourth bit of weight 2) */
+      t = as ^ bs;
+      uint32_t ones = t ^ cs;
+      uint32_t dc = (as & bs) | (t & cs);
+
+      /* exactly one of ac, bc, cc, dc */
+      uint32_t x1 = ac ^ bc, x2 = cc ^ dc;
+      uint32_t one = (x1 ^ x2) & ~((ac & bc) | (cc & dc) | (x1 & x2));
+
+      out[k] = one & (ones | b);
+
+      a_prev = a; b_prev = b; c_prev = c;
+      a = a_next; b = b_next; c = c_next;
+   }
+}
+
+/* Copies n words */
+static inline void life_copy(uint32_t* to, const uint32_t* from, int n) {
+   for(int k=0; k<n; ++k) {
+      to[k] = from[k];
+   }
+}
+
+/* One generation, in place */
+static inline void life_step(Life* L) {
+   int n = L->nwords;
+   uint32_t* first = L->scratch;       /* row 0, before the step */
+   uint32_t* above = L->scratch + n;   /* row y-1, before the step */
+   uint32_t* row   = L->scratch + 2*n; /* row y, before the step */
+   uint32_t* last  = L->cells + (L->height-1)*n;
+   life_copy(first, L->cells, n);
+   life_copy(above, last, n);
+   for(int y=0; y<L->height; ++y) {
+      uint32_t* cur = L->cells + y*n;
+      const uint32_t* below = (y == L->height-1) ? first : cur + n;
+      life_copy(row, cur, n);
+      life_row(above, row, below, cur, n);
+      uint32_t* swap = above; above = row; row = swap;
+   }
+}
+
+#endif
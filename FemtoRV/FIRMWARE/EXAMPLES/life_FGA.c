@@ -0,0 +1,72 @@
+/*
+ * Game of life, full screen in FGA 1024x768 1bpp mode
+ * (bit-parallel implementation, see life.h).
+ *
+ * VRAM is write-only, so the cells are in RAM (96 KB), and each
+ * generation is copied to VRAM, 32 pixels per store. Prints the number
+ * of generations per second every 64 generations. Press a button to
+ * restart from a random grid.
+ *
+ * femtosoc options (femtosoc.v):
+ *   FGA (NRV_IO_FGA)
+ */
+
+#include <femtoGL.h>
+#include "life.h"
+
+#define WIDTH  1024
+#define HEIGHT 768
+#define NWORDS (WIDTH/32)
+
+uint32_t cells[NWORDS*HEIGHT];
+uint32_t scratch[3*NWORDS];
+Life life = { cells, NWORDS, HEIGHT, scratch };
+
+static uint32_t seed = 0x12345678;
+
+static uint32_t xorshift32() {
+   seed ^= seed << 13;
+   seed ^= seed >> 17;
+   seed ^= seed << 5;
+   return seed;
+}
+
+void randomize() {
+   for(int i=0; i<NWORDS*HEIGHT; ++i) {
+      // 25% of living cells
+      cells[i] = xorshift32() & xorshift32();
+   }
+}
+
+void show() {
+   uint32_t* vram = (uint32_t*)FGA_BASEMEM;
+   for(int i=0; i<NWORDS*HEIGHT; ++i) {
+      vram[i] = cells[i];
+   }
+}
+
+int main() {
+   if(!FEMTOSOC_HAS_DEVICE(IO_FGA_CNTL_bit)) {
+      printf("life_FGA: needs the FGA\n");
+      return -1;
+   }
+   GL_init(FGA_MODE_1024x768x1bpp);
+   seed ^= (uint32_t)cycles();
+   randomize();
+   for(;;) {
+      uint64_t start = cycles();
+      for(int gen=0; gen<64; ++gen) {
+	 show();
+	 life_step(&life);
+	 if(IO_IN(IO_BUTTONS)) {
+	    seed ^= (uint32_t)cycles();
+	    randomize();
+	 }
+      }
+      uint64_t elapsed = cycles() - start;
+      uint32_t mgps = (uint32_t)(
+	 (uint64_t)64 * 1000 * FEMTORV32_FREQ * 1000000 / elapsed
+      );
+      printf("%d.%03d generations/s\n", mgps / 1000, mgps % 1000);
+   }
+}
@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <femto_alloc.h>
 
 extern int femtosoc_tty_init();
 
@@ -12,5 +13,28 @@ int main() {
    free(p1);
    void* p3 = malloc(50);
    printf("p1=0x%x\n",p3);   
+
+   // Pool allocator (also used by malloc() with make POOL_MALLOC=1)
+   void* q1 = femto_malloc(10);
+   void* q2 = femto_malloc(100);
+   void* q3 = femto_malloc(3000);
+   femto_free(q2);
+   void* q4 = femto_malloc(90);
+   printf("q2=0x%x q4=0x%x (same block)\n",q2,q4);
+   femto_free(q1);
+   femto_free(q3);
+   femto_heap_print_stats();
+
+   // Arena, freed at each 'frame'
+   static uint8_t buffer[1024];
+   femto_arena arena;
+   femto_arena_init(&arena, buffer, sizeof(buffer));
+   for(int frame=0; frame<3; ++frame) {
+      femto_arena_reset(&arena);
+      void* a1 = femto_arena_alloc(&arena, 100);
+      void* a2 = femto_arena_alloc(&arena, 1000);
+      printf("frame %d: a1=0x%x a2=0x%x (NULL, full)\n",frame,a1,a2);
+   }
+   printf("arena peak: %d\n",arena.peak);
    exit(0);
 }
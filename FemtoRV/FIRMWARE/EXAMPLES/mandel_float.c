@@ -21,39 +21,91 @@
 #define dx 0.03125f
 #define dy 0.03125f
 
-void mandel() {
-   
-//   float dx = (xmax-xmin)/(float)H;
-//   float dy = (ymax-ymin)/(float)H;
-   
-   uint32_t total_ticks = 0;
-   GL_write_window(0,0,W-1,H-1);
-   float Ci = ymin;
-   for(int Y=0; Y<H; ++Y) {
-      float Cr = xmin;
-      for(int X=0; X<W; ++X) {
-	 printf("%d %d\n",X,Y);
-	 float Zr = Cr;
-	 float Zi = Ci;
-	 int iter = 15;
-	 while(iter > 0) {
-	     float Zrr = (Zr * Zr);
-	     float Zii = (Zi * Zi);
-	     float Zri = 2.0 * (Zr * Zi);
-	     Zr = Zrr - Zii + Cr;
-	     Zi = Zri + Ci;
-	     if(Zrr + Zii > 4.0) {
-		 break;
-	     }
-	     --iter;
-	 }
-	 GL_WRITE_DATA_UINT16((iter << 19)|(iter << 2));
-	 Cr += dx;
+/*
+ * Number of iterations left when Z escapes (0: in the set), with a
+ * periodicity check: Z is saved at iterations 1,2,4,8..., if it comes 
+ * back exactly to the saved value, the sequence never escapes.
+ */
+static inline int mandel_iter(int X, int Y) {
+   float Cr = xmin + X*dx;
+   float Ci = ymin + Y*dy;
+   float Zr = Cr;
+   float Zi = Ci;
+   float Zr_saved = Zr;
+   float Zi_saved = Zi;
+   int period = 1;
+   int k = 0;
+   int iter = 15;
+   while(iter > 0) {
+       float Zrr = (Zr * Zr);
+       float Zii = (Zi * Zi);
+       float Zri = 2.0 * (Zr * Zi);
+       Zr = Zrr - Zii + Cr;
+       Zi = Zri + Ci;
+       if(Zrr + Zii > 4.0) {
+	   break;
+       }
+       --iter;
+       if(Zr == Zr_saved && Zi == Zi_saved) {
+	   return 0;
+       }
+       if(++k == period) {
+	   k = 0;
+	   period <<= 1;
+	   Zr_saved = Zr;
+	   Zi_saved = Zi;
+       }
+   }
+   return iter;
+}
+
+#define mandel_color(iter) (((iter) << 19)|((iter) << 2))
+
+void mandel_pixels(int x1, int y1, int x2, int y2) {
+   GL_write_window(x1,y1,x2,y2);
+   for(int Y=y1; Y<=y2; ++Y) {
+      for(int X=x1; X<=x2; ++X) {
+	 GL_WRITE_DATA_UINT16(mandel_color(mandel_iter(X,Y)));
       }
-      Ci += dy;
    }
 }
 
+/*
+ * Mariani-Silver subdivision (see mandelbrot.c): a rectangle with the
+ * same number of iterations on its whole border is filled without
+ * iterating, else it is split in four.
+ */
+#define MANDEL_MIN_SIZE 4
+
+void mandel_rect(int x1, int y1, int x2, int y2) {
+   if(x2 - x1 < MANDEL_MIN_SIZE || y2 - y1 < MANDEL_MIN_SIZE) {
+      mandel_pixels(x1,y1,x2,y2);
+      return;
+   }
+   int iter = mandel_iter(x1,y1);
+   int same = 1;
+   for(int X=x1; same && X<=x2; ++X) {
+      same = (mandel_iter(X,y1) == iter) && (mandel_iter(X,y2) == iter);
+   }
+   for(int Y=y1+1; same && Y<y2; ++Y) {
+      same = (mandel_iter(x1,Y) == iter) && (mandel_iter(x2,Y) == iter);
+   }
+   if(same) {
+      GL_fill_rect(x1,y1,x2,y2,mandel_color(iter));
+      return;
+   }
+   int xm = (x1 + x2) >> 1;
+   int ym = (y1 + y2) >> 1;
+   mandel_rect(x1,   y1,   xm, ym);
+   mandel_rect(xm+1, y1,   x2, ym);
+   mandel_rect(x1,   ym+1, xm, y2);
+   mandel_rect(xm+1, ym+1, x2, y2);
+}
+
+void mandel() {
+   mandel_rect(0,0,W-1,H-1);
+}
+
 int main() {
    printf("Mandel float");
    for(;;) {
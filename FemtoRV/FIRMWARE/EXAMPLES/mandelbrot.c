@@ -23,39 +23,105 @@
 
 int indexed = 0;
 
-void mandel() RV32_FASTCODE;
-void mandel() {
-   GL_write_window(0,0,W-1,H-1);
-   int Ci = ymin;
-   for(int Y=0; Y<H; ++Y) {
-      int Cr = xmin;
-      for(int X=0; X<W; ++X) {
-	 int Zr = Cr;
-	 int Zi = Ci;
-	 int iter = 15;
-	 while(iter > 0) {
-	    int Zrr = (Zr * Zr) >> mandel_shift;
-	    int Zii = (Zi * Zi) >> mandel_shift;
-	    int Zri = (Zr * Zi) >> (mandel_shift - 1);
-	    Zr = Zrr - Zii + Cr;
-	    Zi = Zri + Ci;
-	    if(Zrr + Zii > norm_max) {
-	       break;
-	    }
-	    --iter;
-	 }
-	 if(indexed) {
-	    GL_WRITE_DATA_UINT16(iter==0?0:(iter%15)+1);
-	 } else {
-	    GL_WRITE_DATA_UINT16((iter << 19)|(iter << 2));
-	 }
-	  
-	 Cr += dx;
+int step_x; /* dx, dy, computed once (H is a variable) */
+int step_y;
+
+/*
+ * Number of iterations left when Z escapes (0: in the set).
+ * Periodicity check: Z is saved at iterations 1,2,4,8..., if it comes 
+ * back to the saved value, the sequence is periodic and never escapes
+ * (exactly, since the arithmetic is exact on integers).
+ */
+static inline int mandel_iter(int X, int Y) {
+   int Cr = xmin + X*step_x;
+   int Ci = ymin + Y*step_y;
+   int Zr = Cr;
+   int Zi = Ci;
+   int Zr_saved = Zr;
+   int Zi_saved = Zi;
+   int period = 1;
+   int k = 0;
+   int iter = 15;
+   while(iter > 0) {
+      int Zrr = (Zr * Zr) >> mandel_shift;
+      int Zii = (Zi * Zi) >> mandel_shift;
+      int Zri = (Zr * Zi) >> (mandel_shift - 1);
+      Zr = Zrr - Zii + Cr;
+      Zi = Zri + Ci;
+      if(Zrr + Zii > norm_max) {
+	 break;
+      }
+      --iter;
+      if(Zr == Zr_saved && Zi == Zi_saved) {
+	 return 0;
+      }
+      if(++k == period) {
+	 k = 0;
+	 period <<= 1;
+	 Zr_saved = Zr;
+	 Zi_saved = Zi;
+      }
+   }
+   return iter;
+}
+
+static inline uint16_t mandel_color(int iter) {
+   return indexed ? (iter==0?0:(iter%15)+1) : ((iter << 19)|(iter << 2));
+}
+
+void mandel_pixels(int x1, int y1, int x2, int y2) RV32_FASTCODE;
+void mandel_pixels(int x1, int y1, int x2, int y2) {
+   GL_write_window(x1,y1,x2,y2);
+   for(int Y=y1; Y<=y2; ++Y) {
+      for(int X=x1; X<=x2; ++X) {
+	 GL_WRITE_DATA_UINT16(mandel_color(mandel_iter(X,Y)));
       }
-      Ci += dy;
    }
 }
 
+/*
+ * Mariani-Silver subdivision: the sets of points that escape after the
+ * same number of iterations are connected and have no holes, so if all
+ * the pixels on the border of a rectangle have the same number of 
+ * iterations, the pixels inside have it too, and the rectangle is filled
+ * without iterating. Else it is split in four. Small rectangles are 
+ * computed pixel by pixel.
+ */
+#define MANDEL_MIN_SIZE 4
+
+void mandel_rect(int x1, int y1, int x2, int y2) RV32_FASTCODE;
+void mandel_rect(int x1, int y1, int x2, int y2) {
+   if(x2 - x1 < MANDEL_MIN_SIZE || y2 - y1 < MANDEL_MIN_SIZE) {
+      mandel_pixels(x1,y1,x2,y2);
+      return;
+   }
+   int iter = mandel_iter(x1,y1);
+   int same = 1;
+   for(int X=x1; same && X<=x2; ++X) {
+      same = (mandel_iter(X,y1) == iter) && (mandel_iter(X,y2) == iter);
+   }
+   for(int Y=y1+1; same && Y<y2; ++Y) {
+      same = (mandel_iter(x1,Y) == iter) && (mandel_iter(x2,Y) == iter);
+   }
+   if(same) {
+      GL_fill_rect(x1,y1,x2,y2,mandel_color(iter));
+      return;
+   }
+   int xm = (x1 + x2) >> 1;
+   int ym = (y1 + y2) >> 1;
+   mandel_rect(x1,   y1,   xm, ym);
+   mandel_rect(xm+1, y1,   x2, ym);
+   mandel_rect(x1,   ym+1, xm, y2);
+   mandel_rect(xm+1, ym+1, x2, y2);
+}
+
+void mandel() RV32_FASTCODE;
+void mandel() {
+   step_x = dx;
+   step_y = dy;
+   mandel_rect(0,0,W-1,H-1);
+}
+
 #ifdef FGA
 uint8_t palette[255][3];
 #endif
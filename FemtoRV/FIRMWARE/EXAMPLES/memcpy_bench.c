@@ -0,0 +1,198 @@
+// Measures memcpy() and memset() of LIBFEMTOC/missing (they are included
+// below, and replace the ones of libc in this program), in bytes per 100
+// cycles, for each size class and alignment, and compares with a byte loop.
+// Then the same for the word-at-a-time strlen(), strcmp() and strcpy()
+// (strncmp() and strncpy() use the same loops), with aligned strings.
+// Checks the results first (all the alignments, sizes 0 to 40).
+
+#include <femtorv32.h>
+#include "../LIBFEMTOC/missing/memcpy.c"
+#include "../LIBFEMTOC/missing/memset.c"
+#include "../LIBFEMTOC/missing/strlen.c"
+#include "../LIBFEMTOC/missing/strcmp.c"
+#include "../LIBFEMTOC/missing/strcpy.c"
+#include "../LIBFEMTOC/missing/strncmp.c"
+#include "../LIBFEMTOC/missing/strncpy.c"
+
+#define MAX_SIZE 1024
+#define REPEAT   4
+
+static uint8_t src_buf[MAX_SIZE + 8] __attribute__((aligned(4)));
+static uint8_t dst_buf[MAX_SIZE + 8] __attribute__((aligned(4)));
+
+static const int sizes[] = { 4, 16, 64, 256, 1024 };
+#define NB_SIZES (sizeof(sizes)/sizeof(sizes[0]))
+
+static void byte_copy(uint8_t* dst, const uint8_t* src, int len) {
+   while(len--) {
+      *dst++ = *src++;
+   }
+}
+
+static int byte_strlen(const char* s) {
+   int len = 0;
+   while(s[len]) {
+      ++len;
+   }
+   return len;
+}
+
+static int byte_strcmp(const char* s1, const char* s2) {
+   while(*s1 && *s1 == *s2) {
+      ++s1;
+      ++s2;
+   }
+   return *(const uint8_t*)s1 - *(const uint8_t*)s2;
+}
+
+static void byte_strcpy(char* dst, const char* src) {
+   while((*dst++ = *src++));
+}
+
+// The results of the string functions go there, and the benchmark loops
+// have a compiler barrier, so that the calls are not removed or hoisted.
+static volatile int sink;
+
+static int sign(int x) {
+   return (x > 0) - (x < 0);
+}
+
+// Strings of len bytes ('a' + i % 26) at src_buf+sa and dst_buf+da,
+// the one at dst_buf+da differs at index diff (if diff < len).
+static void make_strings(int sa, int da, int len, int diff) {
+   for(int i=0; i<len; ++i) {
+      src_buf[sa+i] = 'a' + i % 26;
+      dst_buf[da+i] = (i == diff) ? 'A' : 'a' + i % 26;
+   }
+   src_buf[sa+len] = 0;
+   dst_buf[da+len] = 0;
+}
+
+static int check_strings(void) {
+   int errors = 0;
+   for(int sa=0; sa<4; ++sa) {
+      for(int da=0; da<4; ++da) {
+	 for(int len=0; len<=40; ++len) {
+	    char* s = (char*)src_buf+sa;
+	    char* d = (char*)dst_buf+da;
+	    for(int diff=len-5; diff<=len; ++diff) {
+	       make_strings(sa, da, len, diff);
+	       errors += (sign(strcmp(s, d)) != sign(byte_strcmp(s, d)));
+	       for(int n=len-2; n<=len+2; ++n) {
+		  if(n >= 0) {
+		     int differs = (diff >= 0 && diff < n && diff < len);
+		     int expected = differs ? sign(byte_strcmp(s, d)) : 0;
+		     errors += (sign(strncmp(s, d, n)) != expected);
+		  }
+	       }
+	    }
+	    errors += (strlen(s) != len);
+	    for(int i=0; i<64; ++i) {
+	       dst_buf[i] = 0xAA;
+	    }
+	    strcpy(d, s);
+	    for(int i=0; i<64; ++i) {
+	       uint8_t expected = (i >= da && i <= da+len) ? src_buf[sa+i-da] : 0xAA;
+	       errors += (dst_buf[i] != expected);
+	    }
+	    for(int i=0; i<64; ++i) {
+	       dst_buf[i] = 0xAA;
+	    }
+	    strncpy(d, s, len/2+8);
+	    for(int i=0; i<64; ++i) {
+	       int j = i - da;
+	       uint8_t expected = (j < 0 || j >= len/2+8) ? 0xAA : (j < len ? src_buf[sa+j] : 0);
+	       errors += (dst_buf[i] != expected);
+	    }
+	 }
+      }
+   }
+   return errors;
+}
+
+static int check(void) {
+   int errors = 0;
+   for(int i=0; i<MAX_SIZE+8; ++i) {
+      src_buf[i] = (uint8_t)(i*7+1);
+   }
+   for(int sa=0; sa<4; ++sa) {
+      for(int da=0; da<4; ++da) {
+	 for(int len=0; len<=40; ++len) {
+	    for(int i=0; i<64; ++i) {
+	       dst_buf[i] = 0xAA;
+	    }
+	    memcpy(dst_buf+da, src_buf+sa, len);
+	    for(int i=0; i<64; ++i) {
+	       uint8_t expected = (i >= da && i < da+len) ? src_buf[sa+i-da] : 0xAA;
+	       errors += (dst_buf[i] != expected);
+	    }
+	    memset(dst_buf+da, sa+1, len);
+	    for(int i=0; i<64; ++i) {
+	       uint8_t expected = (i >= da && i < da+len) ? sa+1 : 0xAA;
+	       errors += (dst_buf[i] != expected);
+	    }
+	 }
+      }
+   }
+   return errors;
+}
+
+// bytes per 100 cycles
+static int rate(int bytes, uint64_t ticks) {
+   return ticks == 0 ? 0 : (int)((uint64_t)bytes * REPEAT * 100 / ticks);
+}
+
+int main() {
+   femtosoc_tty_init();
+
+   int errors = check();
+   printf("memcpy/memset check: %s (%d errors)\n", errors ? "FAILED" : "OK", errors);
+   errors = check_strings();
+   printf("string functions check: %s (%d errors)\n", errors ? "FAILED" : "OK", errors);
+
+   printf("bytes per 100 cycles\n");
+   printf("size   aligned  src+1  dst+1  byte loop  memset\n");
+   for(int s=0; s<NB_SIZES; ++s) {
+      int len = sizes[s];
+      int r[5];
+      for(int k=0; k<5; ++k) {
+	 uint64_t t0 = cycles();
+	 for(int rep=0; rep<REPEAT; ++rep) {
+	    switch(k) {
+	    case 0: memcpy(dst_buf, src_buf, len); break;
+	    case 1: memcpy(dst_buf, src_buf+1, len); break;
+	    case 2: memcpy(dst_buf+1, src_buf, len); break;
+	    case 3: byte_copy(dst_buf, src_buf, len); break;
+	    case 4: memset(dst_buf, k, len); break;
+	    }
+	 }
+	 r[k] = rate(len, cycles() - t0);
+      }
+      printf("%d\t%d\t%d\t%d\t%d\t%d\n", len, r[0], r[1], r[2], r[3], r[4]);
+   }
+
+   printf("string bytes per 100 cycles\n");
+   printf("size   strlen  byte   strcmp  byte   strcpy  byte\n");
+   for(int s=0; s<NB_SIZES; ++s) {
+      int len = sizes[s] - 1;
+      int r[6];
+      make_strings(0, 0, len, len);
+      for(int k=0; k<6; ++k) {
+	 uint64_t t0 = cycles();
+	 for(int rep=0; rep<REPEAT; ++rep) {
+	    switch(k) {
+	    case 0: sink = strlen((const char*)src_buf); break;
+	    case 1: sink = byte_strlen((const char*)src_buf); break;
+	    case 2: sink = strcmp((const char*)src_buf, (const char*)dst_buf); break;
+	    case 3: sink = byte_strcmp((const char*)src_buf, (const char*)dst_buf); break;
+	    case 4: strcpy((char*)dst_buf, (const char*)src_buf); break;
+	    case 5: byte_strcpy((char*)dst_buf, (const char*)src_buf); break;
+	    }
+	    __asm__ volatile("" ::: "memory");
+	 }
+	 r[k] = rate(len, cycles() - t0);
+      }
+      printf("%d\t%d\t%d\t%d\t%d\t%d\t%d\n", len, r[0], r[1], r[2], r[3], r[4], r[5]);
+   }
+   return 0;
+}
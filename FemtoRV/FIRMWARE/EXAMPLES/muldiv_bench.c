@@ -0,0 +1,115 @@
+// Compares the software multiply and divide of LIBFEMTOC/missing (mul.S,
+// div.S, linked with this program, see Makefile) with the one bit per
+// iteration versions they replaced (below, in C), for operands of
+// different sizes. Checks the results first.
+// Meant for cores without the M extension (make ARCH=rv32i ...): the
+// operations are explicit calls, there is no '*' '/' '%' in the program.
+
+#include <femtorv32.h>
+
+extern unsigned int __mulsi3(unsigned int a, unsigned int b);
+extern unsigned int __udivsi3(unsigned int a, unsigned int b);
+extern unsigned int __umodsi3(unsigned int a, unsigned int b);
+
+#define NB_OPS 16
+
+// shift-add, one bit per iteration (former mul.S)
+static unsigned int mul_bitwise(unsigned int a, unsigned int b) {
+   unsigned int result = 0;
+   while(b) {
+      if(b & 1) {
+	 result += a;
+      }
+      b >>= 1;
+      a <<= 1;
+   }
+   return result;
+}
+
+// restoring division, divisor aligned one bit per iteration (former div.S)
+static unsigned int udiv_bitwise(unsigned int a, unsigned int b) {
+   unsigned int bit = 1;
+   unsigned int q = 0;
+   if(b == 0) {
+      return 0xffffffff;
+   }
+   while(b < a && !(b & 0x80000000)) {
+      b <<= 1;
+      bit <<= 1;
+   }
+   while(bit) {
+      if(a >= b) {
+	 a -= b;
+	 q |= bit;
+      }
+      b >>= 1;
+      bit >>= 1;
+   }
+   return q;
+}
+
+static unsigned int seed = 12345;
+
+static unsigned int next_random(void) {
+   seed ^= seed << 13;
+   seed ^= seed >> 17;
+   seed ^= seed << 5;
+   return seed;
+}
+
+// a random number of 'bits' bits (at most), never 0
+static unsigned int random_operand(int bits) {
+   unsigned int x = bits >= 32 ? next_random() : (next_random() & ((1u << bits) - 1));
+   return x ? x : 1;
+}
+
+static unsigned int A[NB_OPS], B[NB_OPS], R[NB_OPS];
+
+typedef unsigned int (*op_func)(unsigned int, unsigned int);
+
+// cycles per operation, for the operands in A and B
+static int measure(op_func f) {
+   uint64_t t0 = cycles();
+   for(int i=0; i<NB_OPS; ++i) {
+      R[i] = f(A[i], B[i]);
+   }
+   return (int)((cycles() - t0) >> 4); // NB_OPS = 16
+}
+
+static int check(void) {
+   int errors = 0;
+   for(int i=0; i<1000; ++i) {
+      unsigned int a = random_operand(1 + (next_random() & 31));
+      unsigned int b = random_operand(1 + (next_random() & 31));
+      errors += (__mulsi3(a, b) != mul_bitwise(a, b));
+      unsigned int q = __udivsi3(a, b);
+      errors += (q != udiv_bitwise(a, b));
+      errors += (__umodsi3(a, b) != a - mul_bitwise(q, b));
+   }
+   return errors;
+}
+
+static const int sizes[] = { 4, 8, 12, 16, 24, 32 };
+#define NB_SIZES (sizeof(sizes)/sizeof(sizes[0]))
+
+int main() {
+   femtosoc_tty_init();
+
+   int errors = check();
+   printf("mul/div check: %s (%d errors)\n", errors ? "FAILED" : "OK", errors);
+
+   printf("cycles per operation (a: 32 bits, b: bits)\n");
+   printf("bits  mul old  mul new  div old  div new\n");
+   for(int s=0; s<NB_SIZES; ++s) {
+      for(int i=0; i<NB_OPS; ++i) {
+	 A[i] = random_operand(32);
+	 B[i] = random_operand(sizes[s]);
+      }
+      int mul_old = measure(mul_bitwise);
+      int mul_new = measure(__mulsi3);
+      int div_old = measure(udiv_bitwise);
+      int div_new = measure(__udivsi3);
+      printf("%d\t%d\t%d\t%d\t%d\n", sizes[s], mul_old, mul_new, div_old, div_new);
+   }
+   return 0;
+}
@@ -43,16 +43,13 @@ uint16_t cmap[8] = {
 };
 
 /*
- * Generated by TOOLS/make_sintab.c
+ * 64 entries sine table, between -256 and 256 (femtoGLsin.h),
+ * SINTAB(i) = 256*sin(2*pi*i/64)
  */
-
-int sintab[64] = {
-   0,25,49,74,97,120,142,162,181,197,212,225,236,244,251,254,
-   256,254,251,244,236,225,212,197,181,162,142,120,97,74,49,25,
-   0,-25,-49,-74,-97,-120,-142,-162,-181,-197,-212,-225,-236,-244,
-   -251,-254,-256,-254,-251,-244,-236,-225,-212,-197,-181,-162,
-   -142,-120,-97,-74,-49,-25
-};
+#define GL_SIN_BITS  4
+#define GL_SIN_SHIFT 8
+#include <femtoGLsin.h>
+#define SINTAB(i) GL_sin((i) << 10)
 
 
 void main() RV32_FASTCODE;
@@ -63,9 +60,9 @@ void main() {
     for(;;) {
 	GL_write_window(0,0,GL_width-1,GL_height-1);
        
-        int scaling = sintab[frame&63]+400;
-        int Ux = scaling*sintab[frame & 63];         
-        int Uy = scaling*sintab[(frame + 16) & 63];  
+        int scaling = SINTAB(frame)+400;
+        int Ux = scaling*SINTAB(frame);         
+        int Uy = scaling*SINTAB(frame + 16);  
         int Vx = -Uy;                                
         int Vy =  Ux;                                
 
@@ -0,0 +1,107 @@
+// Measures the SDCard driver (LIBFEMTORV32/spi_sd.c): throughput in KB/s
+// and latency percentiles of single block (CMD17/CMD24) and multiple
+// block (CMD18/CMD25, MULTI blocks) reads and writes, at the SPI rate
+// chosen by sd_init().
+// The blocks are at FIRST_BLOCK. A write writes back what was just read
+// there, so the content of the card does not change (read back and
+// checked after each write).
+
+#include <femtorv32.h>
+
+#define FIRST_BLOCK 32768  /* 16 MB from the start of the card */
+#define MULTI       8      /* blocks per multiple block transfer */
+#define NB_XFERS    64     /* transfers per test */
+
+static uint8_t buffer[MULTI * 512] __attribute__((aligned(4)));
+static uint8_t check[512] __attribute__((aligned(4)));
+static uint32_t latency[NB_XFERS];
+
+static void sort(uint32_t* t, int n) {
+   for(int i=1; i<n; ++i) {
+      uint32_t x = t[i];
+      int j;
+      for(j=i; j>0 && t[j-1] > x; --j) {
+	 t[j] = t[j-1];
+      }
+      t[j] = x;
+   }
+}
+
+static int cycles_to_us(uint32_t c) {
+   return (int)(c / FEMTORV32_FREQ);
+}
+
+// Prints throughput and latency percentiles (in microseconds) of
+// NB_XFERS transfers of nb_blocks blocks each.
+static void report(const char* name, int nb_blocks) {
+   uint64_t total = 0;
+   for(int i=0; i<NB_XFERS; ++i) {
+      total += latency[i];
+   }
+   sort(latency, NB_XFERS);
+   uint64_t bytes = (uint64_t)NB_XFERS * nb_blocks * 512;
+   int kbps = (int)(bytes * FEMTORV32_FREQ * 1000000 / 1024 / total);
+   printf("%s %d\t%d\t%d\t%d\t%d\t%d\n", name, nb_blocks, kbps,
+	  cycles_to_us(latency[0]),
+	  cycles_to_us(latency[NB_XFERS/2]),
+	  cycles_to_us(latency[NB_XFERS*9/10]),
+	  cycles_to_us(latency[NB_XFERS*99/100]));
+}
+
+// Checks that the nb_blocks blocks from block are the ones in buffer
+static int check_blocks(uint32_t block, int nb_blocks) {
+   int errors = 0;
+   for(int i=0; i<nb_blocks; ++i) {
+      errors += !sd_readsector(block + i, check, 1);
+      for(int j=0; j<512; ++j) {
+	 errors += (check[j] != buffer[i*512+j]);
+      }
+   }
+   return errors;
+}
+
+// Times NB_XFERS reads or writes (write = 1) of nb_blocks blocks each.
+static int run(int write, int nb_blocks) {
+   int errors = 0;
+   for(int i=0; i<NB_XFERS; ++i) {
+      uint32_t block = FIRST_BLOCK + i * nb_blocks;
+      uint64_t t0;
+      if(write) {
+	 errors += !sd_readsector(block, buffer, nb_blocks);
+	 t0 = cycles();
+	 errors += !sd_writesector(block, buffer, nb_blocks);
+	 latency[i] = (uint32_t)(cycles() - t0);
+	 errors += check_blocks(block, nb_blocks);
+      } else {
+	 t0 = cycles();
+	 errors += !sd_readsector(block, buffer, nb_blocks);
+	 latency[i] = (uint32_t)(cycles() - t0);
+      }
+   }
+   report(write ? "write" : "read", nb_blocks);
+   return errors;
+}
+
+int main() {
+   int errors = 0;
+   femtosoc_tty_init();
+
+   if(sd_init()) {
+      printf("Could not initialize SDCard\n");
+      return 1;
+   }
+   if(sd_clock_khz()) {
+      printf("SDCard OK, SPI clock %d kHz\n", sd_clock_khz());
+   } else {
+      printf("SDCard OK, bitbanging\n");
+   }
+
+   printf("blocks\tKB/s\tmin us\tp50 us\tp90 us\tp99 us\n");
+   errors += run(0, 1);
+   errors += run(0, MULTI);
+   errors += run(1, 1);
+   errors += run(1, MULTI);
+
+   printf("check: %s (%d errors)\n", errors ? "FAILED" : "OK", errors);
+   return 0;
+}
@@ -5,16 +5,13 @@
 #include <femtoGL.h>
 
 /*
- * Generated by TOOLS/make_sintab.c
+ * 64 entries sine table, between -256 and 256 (femtoGLsin.h),
+ * SINTAB(i) = 256*sin(2*pi*i/64)
  */
-
-int sintab[64] = {
-   0,25,49,74,97,120,142,162,181,197,212,225,236,244,251,254,
-   256,254,251,244,236,225,212,197,181,162,142,120,97,74,49,25,
-   0,-25,-49,-74,-97,-120,-142,-162,-181,-197,-212,-225,-236,-244,
-   -251,-254,-256,-254,-251,-244,-236,-225,-212,-197,-181,-162,
-   -142,-120,-97,-74,-49,-25
-};
+#define GL_SIN_BITS  4
+#define GL_SIN_SHIFT 8
+#include <femtoGLsin.h>
+#define SINTAB(i) GL_sin((i) << 10)
 
 int main() {
     GL_init(GL_MODE_CHOOSE_RGB);
@@ -28,10 +25,10 @@ int main() {
 	    GL_clear();
 	}
 	int a = frame << 1;
-        int scaling = sintab[(frame >> 2)&63]+400;
+        int scaling = SINTAB(frame >> 2)+400;
 	
-	int Ux = (sintab[a & 63] * scaling) >> 12;
-        int Uy = (sintab[(a + 16) & 63] * scaling) >> 12;
+	int Ux = (SINTAB(a) * scaling) >> 12;
+        int Uy = (SINTAB(a + 16) * scaling) >> 12;
 	int Vx = -Uy;
 	int Vy =  Ux;
 	
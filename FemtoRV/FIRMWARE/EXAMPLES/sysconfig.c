@@ -9,6 +9,10 @@ void show_config() {
     printf(" Femtorv32 core\n");
     printf(" freq:   %d MHz\n",   FEMTORV32_FREQ);
     printf(" counter bits: %d\n", FEMTORV32_COUNTER_BITS);
+    printf(" ISA:    rv32i%s%s%s\n",
+	   FEMTORV32_HAS_EXTENSION(FEMTORV32_CPUINFO_M_bit) ? "m" : "",
+	   FEMTORV32_HAS_EXTENSION(FEMTORV32_CPUINFO_F_bit) ? "f" : "",
+	   FEMTORV32_HAS_EXTENSION(FEMTORV32_CPUINFO_C_bit) ? "c" : "");
     printf("  \n");
     printf("[RAM]\n");
     printf("  %d bytes\n", IO_IN(IO_HW_CONFIG_RAM));
@@ -11,8 +11,80 @@
 
 typedef int BOOL;
 
-static inline float max(float x, float y) { return x>y?x:y; }
-static inline float min(float x, float y) { return x<y?x:y; }
+// Scalars are floats, or Q16.16 fixed point numbers if TINYRAYTRACER_FIXED
+// is defined (for the cores without the F extension, where each float
+// operation is a call to libgcc's soft-float). Constants are written R(...),
+// products rmul(), quotients rdiv().
+// #define TINYRAYTRACER_FIXED (or make tinyraytracer_fixed.elf)
+
+#ifdef TINYRAYTRACER_FIXED
+
+typedef int32_t real;
+#define R(x)     ((real)((x)*65536.0f)) // constants only (converted by gcc)
+#define REAL_MAX 0x7fffffff
+
+// offset of the origins of secondary rays (bigger than in floating point, to
+// stay above the rounding errors on the hit points, else glass gets noisy)
+#define RAY_OFFSET R(4e-3)
+
+static inline real rmul(real a, real b) { return (real)(((int64_t)a*b) >> 16); }
+static inline real rdiv(real a, real b) { return (real)(((int64_t)a << 16) / b); }
+static inline real rabs(real a)         { return a < 0 ? -a : a; }
+static inline int  rtoi(real a)         { return a < 0 ? -((-a) >> 16) : (a >> 16); }
+
+// 1/sqrt(x), with the Newton iterations of DOOM_approx_inv_sqrt()
+// (SIM/FPU_funcs.cpp), started from a linear approximation on [1,4)
+// instead of the bits of the float.
+static real rinvsqrt(real x) {
+   int shift = 0;
+   if(x <= 0) {
+      return REAL_MAX;
+   }
+   while(x >= R(4)) { x >>= 2; ++shift; } // x * 4^shift = original x
+   while(x <  R(1)) { x <<= 2; --shift; }
+   real y  = R(1) - rmul(x - R(1), R(1.0f/6.0f));
+   real x2 = x >> 1;
+   for(int i=0; i<3; ++i) {
+      y = rmul(y, R(1.5f) - rmul(x2, rmul(y,y)));
+   }
+   return (shift >= 0) ? (y >> shift) : (y << -shift);
+}
+
+static inline real rsqrt(real x) {
+   return (x <= 0) ? 0 : rmul(x, rinvsqrt(x));
+}
+
+// x^e for integer e (specular exponents)
+static real rpow(real x, real e) {
+   real result = R(1);
+   for(int n = e >> 16; n != 0; n >>= 1) {
+      if(n & 1) {
+	 result = rmul(result, x);
+      }
+      x = rmul(x,x);
+   }
+   return result;
+}
+
+#else
+
+typedef float real;
+#define R(x)     ((real)(x))
+#define REAL_MAX 1e30f
+#define RAY_OFFSET R(1e-3)
+
+static inline real rmul(real a, real b) { return a*b;       }
+static inline real rdiv(real a, real b) { return a/b;       }
+static inline real rabs(real a)         { return fabsf(a);  }
+static inline int  rtoi(real a)         { return (int)a;    }
+static inline real rinvsqrt(real x)     { return 1.0f/sqrtf(x); }
+static inline real rsqrt(real x)        { return sqrtf(x);  }
+static inline real rpow(real x, real e) { return powf(x,e); }
+
+#endif
+
+static inline real max(real x, real y) { return x>y?x:y; }
+static inline real min(real x, real y) { return x<y?x:y; }
 
 /*******************************************************************/
 
@@ -29,7 +101,12 @@ static inline float min(float x, float y) { return x<y?x:y; }
 //   stats_begin_frame()
 //   stats_begin_pixel()
 //   stats_end_pixel()
+//   stats_end_pass()
 //   stats_end_frame()
+//
+// With graphics_progressive, graphics_fill_rect() is also used (the
+// version below calls graphics_set_pixel(), replace it with a faster
+// one if your platform has it).
 
 
 // Size of the screen
@@ -37,6 +114,15 @@ static inline float min(float x, float y) { return x<y?x:y; }
 #define graphics_width  GL_width
 #define graphics_height GL_height
 
+// Progressive rendering: the image is first computed every 8th pixel
+// and displayed as 8x8 blocks, then refined to 4x4, 2x2 and 1x1 blocks.
+// Each pass only computes the pixels that the previous ones did not
+// compute, so that the total number of rays is the same as in raster
+// order, but a usable picture is there much sooner on slow cores.
+// Comment-out to render in raster order.
+#define graphics_progressive
+#define graphics_progressive_step 8
+
 // Replace with your own stuff to initialize graphics
 static inline void graphics_init() {
     GL_init(GL_MODE_CHOOSE);
@@ -83,49 +169,71 @@ const uint8_t dither[4][4] = {
   {15, 7,13, 5}
 };
 
-// Replace with your own code.
-void graphics_set_pixel(int x, int y, float r, float g, float b) {
+// Converts a color component to [0,255] / a color to a gray level.
+static inline uint8_t color_to_byte(real x) {
+   return (uint8_t)rtoi(255 * max(0, min(R(1), x)));
+}
+
+static inline uint16_t color_to_gray(real r, real g, real b) {
+#ifdef TINYRAYTRACER_FIXED
+   return (54*color_to_byte(r) + 183*color_to_byte(g) + 19*color_to_byte(b)) >> 8;
+#else
    r = max(0.0f, min(1.0f, r));
    g = max(0.0f, min(1.0f, g));
    b = max(0.0f, min(1.0f, b));
+   float gray = 0.2126f * r + 0.7152f * g + 0.0722 * b;
+   return (uint16_t)(gray*255.0f);
+#endif
+}
+
+// Replace with your own code.
+void graphics_set_pixel(int x, int y, real r, real g, real b) {
    switch(FGA_mode) {
       case GL_MODE_OLED: {
-	uint8_t R = (uint8_t)(255.0f * r);
-	uint8_t G = (uint8_t)(255.0f * g);
-	uint8_t B = (uint8_t)(255.0f * b);
+	uint8_t R = color_to_byte(r);
+	uint8_t G = color_to_byte(g);
+	uint8_t B = color_to_byte(b);
 	GL_setpixel(x,y,GL_RGB(R,G,B));
       } break;
       case FGA_MODE_320x200x16bpp: {
-	uint8_t R = (uint8_t)(255.0f * r);
-	uint8_t G = (uint8_t)(255.0f * g);
-	uint8_t B = (uint8_t)(255.0f * b);
+	uint8_t R = color_to_byte(r);
+	uint8_t G = color_to_byte(g);
+	uint8_t B = color_to_byte(b);
 	FGA_setpixel(x,y,GL_RGB(R,G,B));     
       } break;
       case FGA_MODE_320x200x8bpp: {
-	float gray = 0.2126f * r + 0.7152f * g + 0.0722 * b;
-	FGA_setpixel(x,y,(uint16_t)(gray*255.0f));
+	FGA_setpixel(x,y,color_to_gray(r,g,b));
       } break;
       case FGA_MODE_640x400x4bpp: {
-	float gray = 0.2126f * r + 0.7152f * g + 0.0722 * b;
-	uint16_t GRAY = (uint16_t)(gray*255.0f);
+	uint16_t GRAY = color_to_gray(r,g,b);
 	uint16_t OFF = (GRAY & 15) > dither[x&3][y&3];
 	FGA_setpixel(x,y,MIN((GRAY>>4)+OFF,15));
       } break;
       case FGA_MODE_800x600x2bpp: {
-	float gray = 0.2126f * r + 0.7152f * g + 0.0722 * b;
-	uint16_t GRAY = (uint16_t)(gray*255.0f);
+	uint16_t GRAY = color_to_gray(r,g,b);
 	uint16_t OFF = (GRAY & 15) > dither[x&3][y&3];
 	FGA_setpixel(x,y,MIN((GRAY>>4)+OFF,15)>>2);
       } break;
       case FGA_MODE_1024x768x1bpp: {
-	float gray = 0.2126f * r + 0.7152f * g + 0.0722 * b;
-	uint16_t GRAY = (uint16_t)(gray*255.0f);
+	uint16_t GRAY = color_to_gray(r,g,b);
 	uint16_t OFF = (GRAY & 15) > dither[x&3][y&3];
 	FGA_setpixel(x,y,MIN((GRAY>>4)+OFF,15)>>3);
       } break;
    }
 }
 
+// Displays a block of pixels of the same color (progressive rendering).
+// Replace with your own code if you have something faster.
+static inline void graphics_fill_rect(
+   int x, int y, int w, int h, real r, real g, real b
+) {
+   for(int j=y; j<y+h && j<graphics_height; ++j) {
+      for(int i=x; i<x+w && i<graphics_width; ++i) {
+	 graphics_set_pixel(i,j,r,g,b);
+      }
+   }
+}
+
 uint32_t frame_ticks;
 uint64_t pixel_ticks;
 
@@ -152,6 +260,16 @@ static inline stats_end_pixel() {
   frame_ticks += (uint32_t)pixel_ticks/1000;  
 }
 
+// Ends statistics collection for a pass of progressive rendering,
+// and displays the number of rays per second so far (rays is the
+// number of primary rays since the beginning of the frame).
+// Leave emtpy if not needed.
+static inline stats_end_pass(int step, uint32_t rays) {
+  uint32_t rays_per_s = frame_ticks ?
+     (uint32_t)((uint64_t)rays * FEMTORV32_FREQ * 1000 / frame_ticks) : 0;
+  printf("%dx%d: %d rays/s\n", step, step, rays_per_s);
+}
+
 // Ends statistics collection for current frame
 // and displays result.
 // Leave emtpy if not needed.
@@ -171,16 +289,16 @@ static inline stats_end_frame() {
 // Normally you will not need to modify anything beyond that point.
 /*******************************************************************/
 
-typedef struct { float x,y,z; }   vec3;
-typedef struct { float x,y,z,w; } vec4;
+typedef struct { real x,y,z; }   vec3;
+typedef struct { real x,y,z,w; } vec4;
 
-static inline vec3 make_vec3(float x, float y, float z) {
+static inline vec3 make_vec3(real x, real y, real z) {
   vec3 V;
   V.x = x; V.y = y; V.z = z;
   return V;
 }
 
-static inline vec4 make_vec4(float x, float y, float z, float w) {
+static inline vec4 make_vec4(real x, real y, real z, real w) {
   vec4 V;
   V.x = x; V.y = y; V.z = z; V.w = w;
   return V;
@@ -198,30 +316,30 @@ static inline vec3 vec3_sub(vec3 U, vec3 V) {
   return make_vec3(U.x-V.x, U.y-V.y, U.z-V.z);
 }
 
-static inline float vec3_dot(vec3 U, vec3 V) {
-  return U.x*V.x+U.y*V.y+U.z*V.z;
+static inline real vec3_dot(vec3 U, vec3 V) {
+  return rmul(U.x,V.x)+rmul(U.y,V.y)+rmul(U.z,V.z);
 }
 
-static inline vec3 vec3_scale(float s, vec3 U) {
-  return make_vec3(s*U.x, s*U.y, s*U.z);
+static inline vec3 vec3_scale(real s, vec3 U) {
+  return make_vec3(rmul(s,U.x), rmul(s,U.y), rmul(s,U.z));
 }
 
-static inline float vec3_length(vec3 U) {
-  return sqrtf(U.x*U.x+U.y*U.y+U.z*U.z);
+static inline real vec3_length(vec3 U) {
+  return rsqrt(vec3_dot(U,U));
 }
 
 static inline vec3 vec3_normalize(vec3 U) {
-  return vec3_scale(1.0f/vec3_length(U),U);
+  return vec3_scale(rinvsqrt(vec3_dot(U,U)),U);
 }
 
 /*************************************************************************/
 
 typedef struct Light {
     vec3 position;
-    float intensity;
+    real intensity;
 } Light;
 
-Light make_Light(vec3 position, float intensity) {
+Light make_Light(vec3 position, real intensity) {
   Light L;
   L.position = position;
   L.intensity = intensity;
@@ -231,13 +349,13 @@ Light make_Light(vec3 position, float intensity) {
 /*************************************************************************/
 
 typedef struct {
-    float refractive_index;
+    real  refractive_index;
     vec4  albedo;
     vec3  diffuse_color;
-    float specular_exponent;
+    real  specular_exponent;
 } Material;
 
-Material make_Material(float r, vec4 a, vec3 color, float spec) {
+Material make_Material(real r, vec4 a, vec3 color, real spec) {
   Material M;
   M.refractive_index = r;
   M.albedo = a;
@@ -248,8 +366,8 @@ Material make_Material(float r, vec4 a, vec3 color, float spec) {
 
 Material make_Material_default() {
   Material M;
-  M.refractive_index = 1;
-  M.albedo = make_vec4(1,0,0,0);
+  M.refractive_index = R(1);
+  M.albedo = make_vec4(R(1),0,0,0);
   M.diffuse_color = make_vec3(0,0,0);
   M.specular_exponent = 0;
   return M;
@@ -259,11 +377,11 @@ Material make_Material_default() {
 
 typedef struct {
   vec3 center;
-  float radius;
+  real radius;
   Material material;
 } Sphere;
 
-Sphere make_Sphere(vec3 c, float r, Material M) {
+Sphere make_Sphere(vec3 c, real r, Material M) {
   Sphere S;
   S.center = c;
   S.radius = r;
@@ -271,44 +389,121 @@ Sphere make_Sphere(vec3 c, float r, Material M) {
   return S;
 }
 
-BOOL Sphere_ray_intersect(Sphere* S, vec3 orig, vec3 dir, float* t0) {
+BOOL Sphere_ray_intersect(Sphere* S, vec3 orig, vec3 dir, real* t0) {
   vec3 L = vec3_sub(S->center, orig);
-  float tca = vec3_dot(L,dir);
-  float d2 = vec3_dot(L,L) - tca*tca;
-  float r2 = S->radius*S->radius;
+  real tca = vec3_dot(L,dir);
+  real d2 = vec3_dot(L,L) - rmul(tca,tca);
+  real r2 = rmul(S->radius,S->radius);
   if (d2 > r2) return 0;
-  float thc = sqrtf(r2 - d2);
+  real thc = rsqrt(r2 - d2);
   *t0       = tca - thc;
-  float t1 = tca + thc;
+  real t1 = tca + thc;
   if (*t0 < 0) *t0 = t1;
   if (*t0 < 0) return 0;
   return 1;
 }
 
+/*************************************************************************/
+
+// Bounding spheres, one around each group of two consecutive spheres:
+// a ray that misses it skips the two sphere tests (in this scene, a bounding
+// sphere around all the spheres would be hit by nearly all the rays that
+// hit the checkerboard, so there is no root).
+// Compile with -DRAYSTONES_STRICT to test every sphere for every ray,
+// as in the original tinyraytracer (and keep raystones scores comparable).
+
+typedef struct {
+  vec3 center;
+  real radius;
+  int first;   // index of the first sphere in the group
+  int count;   // number of spheres in the group
+} Bounds;
+
+#define MAX_BOUNDS_GROUPS 4
+#define BOUNDS_GROUP_SIZE 2
+
+Bounds scene_bounds_groups[MAX_BOUNDS_GROUPS];
+int    nb_bounds_groups = 0;
+
+Bounds make_Bounds(Sphere* spheres, int first, int count) {
+  Bounds B;
+  B.center = make_vec3(0,0,0);
+  for(int i=first; i<first+count; ++i) {
+    B.center = vec3_add(B.center, spheres[i].center);
+  }
+  B.center = vec3_scale(rdiv(R(1), count*R(1)), B.center);
+  B.radius = 0;
+  for(int i=first; i<first+count; ++i) {
+    B.radius = max(
+       B.radius,
+       vec3_length(vec3_sub(spheres[i].center,B.center)) + spheres[i].radius
+    );
+  }
+  B.first = first;
+  B.count = count;
+  return B;
+}
+
+void scene_init_bounds(Sphere* spheres, int nb_spheres) {
+  nb_bounds_groups = 0;
+  for(int i=0; i<nb_spheres; i+=BOUNDS_GROUP_SIZE) {
+    scene_bounds_groups[nb_bounds_groups++] = make_Bounds(
+       spheres, i, min(BOUNDS_GROUP_SIZE, nb_spheres-i)
+    );
+  }
+}
+
+// Conservative: returns 0 only if the ray cannot hit anything inside
+// the bounding sphere nearer than max_dist (dir is normalized).
+BOOL Bounds_ray_hit(Bounds* B, vec3 orig, vec3 dir, real max_dist) {
+  vec3 L = vec3_sub(B->center, orig);
+  real tca = vec3_dot(L,dir);
+  real L2 = vec3_dot(L,L);
+  real r2 = rmul(B->radius,B->radius);
+  if (L2 - rmul(tca,tca) > r2) return 0;  // the line misses the bounding sphere
+  if (L2 > r2 && tca < 0) return 0;  // behind, and the origin is outside
+  return (tca - B->radius) < max_dist;
+}
+
+/*************************************************************************/
+
 vec3 reflect(vec3 I, vec3 N) {
-  return vec3_sub(I, vec3_scale(2.f*vec3_dot(I,N),N));
+  return vec3_sub(I, vec3_scale(2*vec3_dot(I,N),N));
 }
 
-vec3 refract(vec3 I, vec3 N, float eta_t, float eta_i /* =1.f */) {
+vec3 refract(vec3 I, vec3 N, real eta_t, real eta_i /* =1.f */) {
   // Snell's law
-  float cosi = -max(-1.f, min(1.f, vec3_dot(I,N)));
+  real cosi = -max(R(-1), min(R(1), vec3_dot(I,N)));
   // if the ray comes from the inside the object, swap the air and the media  
   if (cosi<0) return refract(I, vec3_neg(N), eta_i, eta_t); 
-    float eta = eta_i / eta_t;
-    float k = 1 - eta*eta*(1 - cosi*cosi);
+    real eta = rdiv(eta_i, eta_t);
+    real k = R(1) - rmul(rmul(eta,eta), R(1) - rmul(cosi,cosi));
     // k<0 = total reflection, no ray to refract.
     // I refract it anyways, this has no physical meaning
-    return k<0 ? make_vec3(1,0,0)
-              : vec3_add(vec3_scale(eta,I),vec3_scale((eta*cosi - sqrtf(k)),N));
+    return k<0 ? make_vec3(R(1),0,0)
+              : vec3_add(vec3_scale(eta,I),vec3_scale((rmul(eta,cosi) - rsqrt(k)),N));
 }
 
 BOOL scene_intersect(
    vec3 orig, vec3 dir, Sphere* spheres, int nb_spheres,
    vec3* hit, vec3* N, Material* material
 ) {
-  float spheres_dist = 1e30;
+  real spheres_dist = REAL_MAX;
+#ifdef RAYSTONES_STRICT
   for(int i=0; i<nb_spheres; ++i) {
-    float dist_i;
+#else
+  for(int g=0; g<nb_bounds_groups; ++g) {
+    if(
+       scene_bounds_groups[g].count > 1 &&
+       !Bounds_ray_hit(&scene_bounds_groups[g], orig, dir, spheres_dist)
+    ) {
+      continue;
+    }
+    int first = scene_bounds_groups[g].first;
+    int last  = first + scene_bounds_groups[g].count;
+    for(int i=first; i<last; ++i) {
+#endif
+    real dist_i;
     if(
        Sphere_ray_intersect(&spheres[i], orig, dir, &dist_i) &&
        (dist_i < spheres_dist)
@@ -318,22 +513,60 @@ BOOL scene_intersect(
       *N = vec3_normalize(vec3_sub(*hit, spheres[i].center));
       *material = spheres[i].material;
     }
+#ifndef RAYSTONES_STRICT
+    }
+#endif
   }
-  float checkerboard_dist = 1e30;
-  if (fabs(dir.y)>1e-3)  {
-    float d = -(orig.y+4)/dir.y; // the checkerboard plane has equation y = -4
+  real checkerboard_dist = REAL_MAX;
+  if (rabs(dir.y)>R(1e-3))  {
+    real d = rdiv(-(orig.y+R(4)),dir.y); // the checkerboard plane has equation y = -4
     vec3 pt = vec3_add(orig, vec3_scale(d,dir));
-    if (d>0 && fabs(pt.x)<10 && pt.z<-10 && pt.z>-30 && d<spheres_dist) {
+    if (d>0 && rabs(pt.x)<R(10) && pt.z<R(-10) && pt.z>R(-30) && d<spheres_dist) {
       checkerboard_dist = d;
       *hit = pt;
-      *N = make_vec3(0,1,0);
+      *N = make_vec3(0,R(1),0);
       material->diffuse_color =
-	(((int)(.5*hit->x+1000) + (int)(.5*hit->z)) & 1)
-	             ? make_vec3(.3, .3, .3)
-	             : make_vec3(.3, .2, .1);
+	((rtoi(rmul(R(.5),hit->x)+R(1000)) + rtoi(rmul(R(.5),hit->z))) & 1)
+	             ? make_vec3(R(.3), R(.3), R(.3))
+	             : make_vec3(R(.3), R(.2), R(.1));
+    }
+  }
+  return min(spheres_dist, checkerboard_dist)<R(1000);
+}
+
+// Shadow rays: any hit nearer than max_dist (and than 1000, as in
+// scene_intersect()) is an occluder, stops at the first one.
+BOOL scene_occluded(
+   vec3 orig, vec3 dir, Sphere* spheres, int nb_spheres, real max_dist
+) {
+  max_dist = min(max_dist, R(1000));
+  if (rabs(dir.y)>R(1e-3))  {
+    real d = rdiv(-(orig.y+R(4)),dir.y); // the checkerboard plane has equation y = -4
+    vec3 pt = vec3_add(orig, vec3_scale(d,dir));
+    if (d>0 && d<max_dist && rabs(pt.x)<R(10) && pt.z<R(-10) && pt.z>R(-30)) {
+      return 1;
+    }
+  }
+  for(int g=0; g<nb_bounds_groups; ++g) {
+    if(
+       scene_bounds_groups[g].count > 1 &&
+       !Bounds_ray_hit(&scene_bounds_groups[g], orig, dir, max_dist)
+    ) {
+      continue;
+    }
+    int first = scene_bounds_groups[g].first;
+    int last  = first + scene_bounds_groups[g].count;
+    for(int i=first; i<last; ++i) {
+      real dist_i;
+      if(
+	 Sphere_ray_intersect(&spheres[i], orig, dir, &dist_i) &&
+	 (dist_i < max_dist)
+      ) {
+	return 1;
+      }
     }
   }
-  return min(spheres_dist, checkerboard_dist)<1000;
+  return 0;
 }
 
 vec3 cast_ray(
@@ -346,25 +579,25 @@ vec3 cast_ray(
     depth>2 ||
     !scene_intersect(orig, dir, spheres, nb_spheres, &point, &N, &material)
   ) {
-    float s = 0.5*(dir.y + 1.0);
+    real s = rmul(R(0.5),dir.y + R(1));
     return vec3_add(
-	vec3_scale(s,make_vec3(0.2, 0.7, 0.8)),
-        vec3_scale(s,make_vec3(0.0, 0.0, 0.5))
+	vec3_scale(s,make_vec3(R(0.2), R(0.7), R(0.8))),
+        vec3_scale(s,make_vec3(R(0.0), R(0.0), R(0.5)))
     );
   }
 
   vec3 reflect_dir=vec3_normalize(reflect(dir, N));
-  vec3 refract_dir=vec3_normalize(refract(dir,N,material.refractive_index,1));
+  vec3 refract_dir=vec3_normalize(refract(dir,N,material.refractive_index,R(1)));
   
   // offset the original point to avoid occlusion by the object itself 
   vec3 reflect_orig =
     vec3_dot(reflect_dir,N) < 0
-               ? vec3_sub(point,vec3_scale(1e-3,N))
-               : vec3_add(point,vec3_scale(1e-3,N)); 
+               ? vec3_sub(point,vec3_scale(RAY_OFFSET,N))
+               : vec3_add(point,vec3_scale(RAY_OFFSET,N)); 
   vec3 refract_orig =
     vec3_dot(refract_dir,N) < 0
-               ? vec3_sub(point,vec3_scale(1e-3,N))
-               : vec3_add(point,vec3_scale(1e-3,N));
+               ? vec3_sub(point,vec3_scale(RAY_OFFSET,N))
+               : vec3_add(point,vec3_scale(RAY_OFFSET,N));
   vec3 reflect_color = cast_ray(
        reflect_orig, reflect_dir, spheres, nb_spheres,
        lights, nb_lights, depth + 1
@@ -374,16 +607,17 @@ vec3 cast_ray(
        lights, nb_lights, depth + 1
   );
   
-  float diffuse_light_intensity = 0, specular_light_intensity = 0;
+  real diffuse_light_intensity = 0, specular_light_intensity = 0;
   for (int i=0; i<nb_lights; i++) {
     vec3  light_dir = vec3_normalize(vec3_sub(lights[i].position,point));
-    float light_distance = vec3_length(vec3_sub(lights[i].position,point));
+    real  light_distance = vec3_length(vec3_sub(lights[i].position,point));
 
     vec3 shadow_orig =
       vec3_dot(light_dir,N) < 0
-                ? vec3_sub(point,vec3_scale(1e-3,N))
-                : vec3_add(point,vec3_scale(1e-3,N)) ;
+                ? vec3_sub(point,vec3_scale(RAY_OFFSET,N))
+                : vec3_add(point,vec3_scale(RAY_OFFSET,N)) ;
     // checking if the point lies in the shadow of the lights[i]
+#ifdef RAYSTONES_STRICT
     vec3 shadow_pt, shadow_N;
     Material tmpmaterial;
     if (
@@ -394,24 +628,29 @@ vec3 cast_ray(
   	 vec3_length(vec3_sub(shadow_pt,shadow_orig)) < light_distance
 	     )
     ) continue ;
+#else
+    if (
+       scene_occluded(shadow_orig, light_dir, spheres, nb_spheres, light_distance)
+    ) continue ;
+#endif
     
     diffuse_light_intensity  +=
-                  lights[i].intensity * max(0.f, vec3_dot(light_dir,N));
+                  rmul(lights[i].intensity, max(0, vec3_dot(light_dir,N)));
      
-    float abc = max(
-	           0.f, vec3_dot(vec3_neg(reflect(vec3_neg(light_dir), N)),dir)
+    real abc = max(
+	           0, vec3_dot(vec3_neg(reflect(vec3_neg(light_dir), N)),dir)
 	        );
-    float def = material.specular_exponent;
-    if(abc > 0.0f && def > 0.0f) {
-      specular_light_intensity += powf(abc,def)*lights[i].intensity;
+    real def = material.specular_exponent;
+    if(abc > 0 && def > 0) {
+      specular_light_intensity += rmul(rpow(abc,def),lights[i].intensity);
     }
   }
   vec3 result = vec3_scale(
-      diffuse_light_intensity * material.albedo.x, material.diffuse_color
+      rmul(diffuse_light_intensity, material.albedo.x), material.diffuse_color
   );
   result = vec3_add(
-       result, vec3_scale(specular_light_intensity * material.albedo.y,
-       make_vec3(1,1,1))
+       result, vec3_scale(rmul(specular_light_intensity, material.albedo.y),
+       make_vec3(R(1),R(1),R(1)))
   );
   result = vec3_add(result, vec3_scale(material.albedo.z, reflect_color));
   result = vec3_add(result, vec3_scale(material.albedo.w, refract_color));
@@ -419,26 +658,74 @@ vec3 cast_ray(
 }
 
 
-void render(Sphere* spheres, int nb_spheres, Light* lights, int nb_lights) {
+static inline vec3 render_pixel(
+    int i, int j, Sphere* spheres, int nb_spheres, Light* lights, int nb_lights
+) {
+   stats_begin_pixel();
+#ifdef TINYRAYTRACER_FIXED
+   // same direction as below, divided by graphics_height (to stay in range)
+   real dir_x = ((2*i + 1 - graphics_width) * 32768) / graphics_height;
+   real dir_y = ((graphics_height - 2*j - 1) * 32768) / graphics_height;
+   real dir_z = -R(0.8660254f); // 1/(2*tan(fov/2))
+#else
    const float fov  = M_PI/3.;
+   float dir_x =  (i + 0.5) - graphics_width/2.;
+   float dir_y = -(j + 0.5) + graphics_height/2.; // this flips the image.
+   float dir_z = -graphics_height/(2.*tan(fov/2.));
+#endif
+   vec3 C = cast_ray(
+      make_vec3(0,0,0), vec3_normalize(make_vec3(dir_x, dir_y, dir_z)),
+      spheres, nb_spheres, lights, nb_lights, 0
+   );
+   stats_end_pixel();
+   return C;
+}
+
+#ifdef graphics_progressive
+
+// Pass 'step' computes the pixels (i,j) that are multiples of step,
+// except the ones that are multiples of 2*step (computed by the previous
+// pass), and displays each of them as a block of step x step pixels
+// (that the next passes will overwrite, except the top-left pixel).
+void render(Sphere* spheres, int nb_spheres, Light* lights, int nb_lights) {
+   uint32_t rays = 0;
+   stats_begin_frame();
+   for(int step = graphics_progressive_step; step >= 1; step /= 2) {
+      int first_pass = (step == graphics_progressive_step);
+      for (int j = 0; j<graphics_height; j += step) {
+	 for (int i = 0; i<graphics_width; i += step) {
+	    if(!first_pass && !(i & step) && !(j & step)) {
+	       continue;
+	    }
+	    vec3 C = render_pixel(i,j,spheres,nb_spheres,lights,nb_lights);
+	    if(step == 1) {
+	       graphics_set_pixel(i,j,C.x,C.y,C.z);
+	    } else {
+	       graphics_fill_rect(i,j,step,step,C.x,C.y,C.z);
+	    }
+	    ++rays;
+	 }
+      }
+      stats_end_pass(step, rays);
+   }
+   stats_end_frame();
+}
+
+#else
+
+void render(Sphere* spheres, int nb_spheres, Light* lights, int nb_lights) {
    stats_begin_frame();
    for (int j = 0; j<graphics_height; j++) { // actual rendering loop
       for (int i = 0; i<graphics_width; i++) {
-	stats_begin_pixel();
-	float dir_x =  (i + 0.5) - graphics_width/2.;
-	float dir_y = -(j + 0.5) + graphics_height/2.; // this flips the image.
-	float dir_z = -graphics_height/(2.*tan(fov/2.));
-	vec3 C = cast_ray(
-	   make_vec3(0,0,0), vec3_normalize(make_vec3(dir_x, dir_y, dir_z)),
-	   spheres, nb_spheres, lights, nb_lights, 0
-	);
+	vec3 C = render_pixel(i,j,spheres,nb_spheres,lights,nb_lights);
 	graphics_set_pixel(i,j,C.x,C.y,C.z);
-	stats_end_pixel();
       }
    }
    stats_end_frame();
 }
 
+#endif
+
 int nb_spheres = 4;
 Sphere spheres[4];
 
@@ -447,32 +734,57 @@ Light lights[3];
 
 void init_scene() {
     Material ivory = make_Material(
-       1.0, make_vec4(0.6,  0.3, 0.1, 0.0), make_vec3(0.4, 0.4, 0.3),   50.
+       R(1.0), make_vec4(R(0.6), R(0.3), R(0.1), R(0.0)),
+       make_vec3(R(0.4), R(0.4), R(0.3)), R(50.)
     );
     Material glass = make_Material(
-       1.5, make_vec4(0.0,  0.5, 0.1, 0.8), make_vec3(0.6, 0.7, 0.8),  125.
+       R(1.5), make_vec4(R(0.0), R(0.5), R(0.1), R(0.8)),
+       make_vec3(R(0.6), R(0.7), R(0.8)), R(125.)
     );
     Material red_rubber = make_Material(
-       1.0, make_vec4(0.9,  0.1, 0.0, 0.0), make_vec3(0.3, 0.1, 0.1),   10.
+       R(1.0), make_vec4(R(0.9), R(0.1), R(0.0), R(0.0)),
+       make_vec3(R(0.3), R(0.1), R(0.1)), R(10.)
     );
     Material mirror = make_Material(
-       1.0, make_vec4(0.0, 10.0, 0.8, 0.0), make_vec3(1.0, 1.0, 1.0),  142.
+       R(1.0), make_vec4(R(0.0), R(10.0), R(0.8), R(0.0)),
+       make_vec3(R(1.0), R(1.0), R(1.0)), R(142.)
     );
 
-    spheres[0] = make_Sphere(make_vec3(-3,    0,   -16), 2,      ivory);
-    spheres[1] = make_Sphere(make_vec3(-1.0, -1.5, -12), 2,      glass);
-    spheres[2] = make_Sphere(make_vec3( 1.5, -0.5, -18), 3, red_rubber);
-    spheres[3] = make_Sphere(make_vec3( 7,    5,   -18), 4,     mirror);
+    spheres[0] = make_Sphere(make_vec3(R(-3),   R(0),    R(-16)), R(2),      ivory);
+    spheres[1] = make_Sphere(make_vec3(R(-1.0), R(-1.5), R(-12)), R(2),      glass);
+    spheres[2] = make_Sphere(make_vec3(R( 1.5), R(-0.5), R(-18)), R(3), red_rubber);
+    spheres[3] = make_Sphere(make_vec3(R( 7),   R(5),    R(-18)), R(4),     mirror);
+
+    scene_init_bounds(spheres, nb_spheres);
 
-    lights[0] = make_Light(make_vec3(-20, 20,  20), 1.5);
-    lights[1] = make_Light(make_vec3( 30, 50, -25), 1.8);
-    lights[2] = make_Light(make_vec3( 30, 20,  30), 1.7);
+    lights[0] = make_Light(make_vec3(R(-20), R(20), R( 20)), R(1.5));
+    lights[1] = make_Light(make_vec3(R( 30), R(50), R(-25)), R(1.8));
+    lights[2] = make_Light(make_vec3(R( 30), R(20), R( 30)), R(1.7));
 }
 
+// Sampling profile of the rendering (make tinyraytracer_pcprof.elf), printed
+// at the end, for TOOLS/femto_pcprof (needs gracilis and NRV_IO_TIMER)
+#ifdef TINYRAYTRACER_PCPROF
+#include <femto_pcprof.h>
+extern void _start();
+extern char _end;
+static uint32_t pcprof_buckets[4096];
+#endif
+
 int main() {
     init_scene();
     graphics_init();
+#ifdef TINYRAYTRACER_PCPROF
+    femto_pcprof_init(pcprof_buckets, 4096, (uint32_t)&_start, (uint32_t)&_end);
+    if(!femto_pcprof_start(FEMTORV32_FREQ * 100)) { // 10 KHz
+       printf("No timer (NRV_IO_TIMER), no profile\n");
+    }
+#endif
     render(spheres, nb_spheres, lights, nb_lights);
+#ifdef TINYRAYTRACER_PCPROF
+    femto_pcprof_stop();
+    femto_pcprof_dump();
+#endif
     graphics_terminate();
     return 0;
 }
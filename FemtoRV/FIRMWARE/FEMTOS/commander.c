@@ -21,6 +21,12 @@ void print_elf_error(int errcode) {
     case ELF32_READ_ERROR:
       printf("\nRead err\n");
       break;
+    case ELF32_DECOMPRESS_ERROR:
+      printf("\nCorrupted elz\n");
+      break;
+    case ELF32_CHECKSUM_ERROR:
+      printf("\nBad fxe CRC\n");
+      break;
     default:
       printf("\nUnknown err\n");
       break;
@@ -37,72 +43,185 @@ char cwd[PATH_LEN];
 int is_executable(const char* filename) {
     int l = strlen(filename);
     return
-      (l >= 4 && !strcmp(filename + l - 4, ".bin")) ||
-      (l >= 4 && !strcmp(filename + l - 4, ".elf")) ;
+      (l >= 4 && !strcmp(filename + l - 4, ".fxe")) ||
+      (l >= 4 && !strcmp(filename + l - 4, ".elf")) ||
+      (l >= 4 && !strcmp(filename + l - 4, ".elz")) ;
 }
 
 /*
- * \param[in] from the index to start display from
- * \param[in] sel the index of the currently selected file
- * \returns the total number of files 
+ * Directory cache: the executables of cwd, listed once. The globals
+ * persist across resets (BSS is not cleared), so the cache is kept,
+ * with a magic number and a checksum of the directory sectors it was
+ * listed from: it is re-listed only when they changed.
  */
-int refresh(int from, int sel) {
-    GL_tty_goto_xy(0,0);
-    GL_clear();
+
+#define DIR_CACHE_MAGIC     0x43524944 /* "DIRC" */
+#define DIR_CACHE_MAX_FILES 128
+#define DIR_CACHE_NAMES     4096
+
+typedef struct {
+    uint32_t magic;
+    uint32_t cluster;                    /* first cluster of the directory   */
+    uint32_t nb_sectors;                 /* number of sectors listed         */
+    uint32_t checksum;                   /* of these sectors                 */
+    int      nb_files;
+    uint16_t name[DIR_CACHE_MAX_FILES];  /* offsets of the names in names[]  */
+    char     names[DIR_CACHE_NAMES];
+} DirCache;
+
+DirCache dir_cache;
+
+uint32_t dir_checksum(uint32_t cluster, uint32_t nb_sectors) {
+    uint32_t sector[FAT_SECTOR_SIZE/4];
+    uint32_t sum = nb_sectors;
+    for(uint32_t i=0; i<nb_sectors; ++i) {
+        if(!fatfs_sector_reader(fl_get_fs(), cluster, i, (uint8*)sector)) {
+	    return ~sum;
+	}
+	for(int j=0; j<FAT_SECTOR_SIZE/4; ++j) {
+	    sum = ((sum << 5) | (sum >> 27)) + sector[j];
+	}
+    }
+    return sum;
+}
+
+void dir_cache_list() {
     FL_DIR dirstat;
-    int cur = 0;
-    int result = 0;
+    int pos = 0;
+    dir_cache.magic = 0;
+    dir_cache.nb_files = 0;
     if (fl_opendir(cwd, &dirstat)) {
         struct fs_dir_ent dirent;
         while (fl_readdir(&dirstat, &dirent) == 0) {
 	   if (/*!dirent.is_dir &&*/ !is_executable(dirent.filename)) {
 	      continue;
 	   }
-	   if(cur >= from && cur < from + LINES) {
-	      if(cur == sel) {
-		 GL_set_fg(0,0,0);
-		 GL_set_bg(255,255,255);
-	      }
-	      char current[PATH_LEN];
-	      int l = strlen(dirent.filename);
-	      strncpy(current, dirent.filename,MIN(l-4,14));
-	      current[14] = '.';
-	      current[15] = '\0';
-	      current[l-4] = '\0';
-	      printf("%s\n",current);
-	      if(cur == sel) {
-		 GL_set_bg(0,0,0);
-		 GL_set_fg(255,255,255);
-	      }		
+	   int l = strlen(dirent.filename) + 1;
+	   if(
+	      dir_cache.nb_files == DIR_CACHE_MAX_FILES ||
+	      pos + l > DIR_CACHE_NAMES
+	   ) {
+	      continue; /* does not fit, not listed */
 	   }
-	   ++cur;
+	   dir_cache.name[dir_cache.nb_files++] = pos;
+	   strcpy(dir_cache.names + pos, dirent.filename);
+	   pos += l;
         }
+	/* the listing stopped in dirstat.sector */
+	dir_cache.cluster = dirstat.cluster;
+	dir_cache.nb_sectors = dirstat.sector + 1;
         fl_closedir(&dirstat);
+	dir_cache.checksum = dir_checksum(dir_cache.cluster, dir_cache.nb_sectors);
+	dir_cache.magic = DIR_CACHE_MAGIC;
     }
-    return cur;
+}
+
+/* 
+ * Re-lists the directory if it is not the one in the cache or if 
+ * its sectors changed.
+ */
+void dir_cache_validate() {
+    FL_DIR dirstat;
+    if(dir_cache.magic == DIR_CACHE_MAGIC && fl_opendir(cwd, &dirstat)) {
+        fl_closedir(&dirstat);
+	if(
+	   dirstat.cluster == dir_cache.cluster &&
+	   dir_checksum(dir_cache.cluster, dir_cache.nb_sectors) == dir_cache.checksum
+	) {
+	   return;
+	}
+    }
+    dir_cache_list();
+}
+
+const char* dir_cache_filename(int i) {
+    return dir_cache.names + dir_cache.name[i];
+}
+
+void dir_cache_path(int i, char* buff) {
+    strcpy(buff, cwd);
+    strcpy(buff+strlen(buff), dir_cache_filename(i));
+}
+
+/*
+ * \brief The name of a file in the list, without extension, 
+ *  truncated to 15 chars.
+ * \param[in] i the index of the file
+ * \param[out] buff the name to display
+ */
+void list_item(int i, char* buff) {
+    const char* filename = dir_cache_filename(i);
+    int l = strlen(filename);
+    strncpy(buff, filename, MIN(l-4,14));
+    buff[14] = '.';
+    buff[15] = '\0';
+    if(l-4 < 15) {
+       buff[l-4] = '\0';
+    }
+}
+
+/* The file list, redraws only what changed (see GUI_list_show()) */
+GUIList list;
+
+/*
+ * Preload: once the selection has not moved for PRELOAD_DELAY_MS, the 
+ * selected program is loaded, one part each time the main loop is idle
+ * (see elf32_preload_step()), so that it is often already there when 
+ * the user selects it. Loading writes where the program runs, above 
+ * the commander, as exec() does.
+ */
+
+#define PRELOAD_DELAY_MS 200
+
+Elf32Preload preload;
+int preload_sel = -1;        /* the file of preload, -1 if none */
+uint64_t last_move = 0;      /* when the selection moved        */
+
+void preload_reset() {
+    elf32_preload_abort(&preload);
+    preload_sel = -1;
+    last_move = cycles();
+}
+
+void preload_update(int sel) {
+    char buff[PATH_LEN];
+    if(sel < 0 || sel >= dir_cache.nb_files) {
+        return;
+    }
+    if(sel == preload_sel) {
+        elf32_preload_step(&preload);
+	return;
+    }
+    if(cycles() - last_move < (uint64_t)PRELOAD_DELAY_MS * 1000 * FEMTORV32_FREQ) {
+        return;
+    }
+    elf32_preload_abort(&preload);
+    preload_sel = sel;
+    dir_cache_path(sel, buff);
+    elf32_preload_start(&preload, buff);
 }
 
 void call_exec(int sel) {
     char buff[PATH_LEN];
-    FL_DIR dirstat;
-    int cur = 0;
     int errcode;
-    if (fl_opendir(cwd, &dirstat)) {
-        struct fs_dir_ent dirent;
-        while (fl_readdir(&dirstat, &dirent) == 0) {
-	    if (is_executable(dirent.filename)) {
-		if(cur == sel && is_executable(dirent.filename)) {
-		    strcpy(buff, cwd);
-		    strcpy(buff+strlen(buff), dirent.filename);
-		    errcode = exec(buff, 0, NULL);
-		    print_elf_error(errcode);
-		    exit(0); // workaround for executables that do not call exit().
-		}
-		++cur;
-            }
-        }
-        fl_closedir(&dirstat);
+    if(sel < 0 || sel >= dir_cache.nb_files) {
+        return;
+    }
+    if(sel == preload_sel && preload.status == ELF32_OK) {
+        while(!preload.done && preload.status == ELF32_OK) {
+	    elf32_preload_step(&preload);
+	}
+	errcode = preload.status;
+	if(errcode == ELF32_OK) {
+	    errcode = exec_loaded(&preload.info, 0, NULL);
+	}
+    } else {
+        preload_reset();
+        dir_cache_path(sel, buff);
+	errcode = exec(buff, 0, NULL);
     }
+    print_elf_error(errcode);
+    exit(0); // workaround for executables that do not call exit().
 }
 
 /* declared as globals so that they are persistent. */
@@ -161,8 +280,17 @@ int shell_exec(int argc, char* argv[]) {
      printf("\n");
      strcpy(buff,cwd);
      strcpy(buff+strlen(buff),argv[0]);
-     strcpy(buff+strlen(buff),".elf");     
+     /* the flat executable, else the compressed one, else the elf */
+     strcpy(buff+strlen(buff),".fxe");
      int errcode = exec(buff, argc, argv);
+     if(errcode == ELF32_FILE_NOT_FOUND) {
+       strcpy(buff+strlen(buff)-4,".elz");
+       errcode = exec(buff, argc, argv);
+     }
+     if(errcode == ELF32_FILE_NOT_FOUND) {
+       strcpy(buff+strlen(buff)-4,".elf");
+       errcode = exec(buff, argc, argv);
+     }
      print_elf_error(errcode);
   }
   return 1; 
@@ -240,7 +368,11 @@ int main() {
     if(filesystem_init() != 0) {
        return -1;
     }
-    nb = refresh(from,sel);
+    /* globals persist across resets, but not the file opened by preload */
+    preload.file = NULL;
+    preload_reset();
+    dir_cache_validate();
+    nb = dir_cache.nb_files;
     /* 
      * Re-constrain sel and nb in case SDCard was
      * changed between two invocations.
@@ -253,7 +385,8 @@ int main() {
     }
     from = MIN(from, sel);
     from = MAX(from, sel-LINES+1);
-    nb = refresh(from,sel);   
+    GUI_list_init(&list, list_item, nb, 0, LINES);
+    GUI_list_show(&list, from, sel);
    
     for(;;) {
 	int btn = GUI_button();
@@ -261,7 +394,16 @@ int main() {
 	    case 2: sel--; break;
 	    case 3: sel++; break;
 	    case 5: call_exec(sel); break;
-   	    case 4: shell(); break;
+   	    case 4: 
+	       shell(); 
+	       /* the shell may have run programs, and changed the files */
+	       preload_reset();
+	       dir_cache_validate();
+	       nb = dir_cache.nb_files;
+	       /* and GL_tty_init() cleared the screen */
+	       GUI_list_init(&list, list_item, nb, 0, LINES);
+	       break;
+	    case -1: preload_update(sel); break;
 	}
         if(sel < 0) {
 	   sel = 0;    
@@ -270,9 +412,10 @@ int main() {
 	   sel = nb-1; 
 	}
 	if(btn != 0 && btn != -1) {
+	   last_move = cycles();
 	   from = MIN(from, sel);
 	   from = MAX(from, sel-LINES+1);
-	   nb = refresh(from,sel);
+	   GUI_list_show(&list, from, sel);
 	}
     }
 }
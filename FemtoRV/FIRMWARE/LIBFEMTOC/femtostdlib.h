@@ -4,7 +4,7 @@
 #include <femtorv32.h>
 
 /* My light weight replacement function for printf() */
-extern int printf(const char *fmt,...); /* supports %s, %d, %x */
+extern int printf(const char *fmt,...); /* supports %d %u %x %c %s, width, '-' and '0' flags */
 
 /* Uncomment if using functions in 'missing' subdirectory
 void* memset(void *s, int c, size_t n);
@@ -16,6 +16,13 @@ size_t strlen(const char* p);
 extern int random();
 */
 
+/*
+ * Non-zero if one of the bytes of the 32 bits word w is zero (used by the
+ * word-at-a-time string functions in 'missing'). The highest bit of the
+ * first zero byte is set, the ones of the following bytes may be set too.
+ */
+#define HAS_ZERO_BYTE(w) (((w) - 0x01010101u) & ~(w) & 0x80808080u)
+
 /* Specialized print functions (but one can use printf() instead) */
 extern void print_string(const char* s);
 extern void print_dec(int val);
@@ -3,13 +3,17 @@
 // Number of leading zero bits
 // (I do not know where the source of this function is, did not find
 //  it in riscv-glibc)
+// Binary search (5 steps instead of up to 32 iterations), div.S has the
+// same one in assembly (CLZ macro).
 int __clzsi2(unsigned int x) {
-   unsigned int mask = (1 << 31);
-   for(int i=0; i<32; ++i) {
-      if(x & mask) {
-	 return i;
-      }
-      mask = mask >> 1;
+   int n = 0;
+   if(x == 0) {
+      return 32;
    }
-   return 32;
+   if(!(x >> 16)) { n += 16; x <<= 16; }
+   if(!(x >> 24)) { n +=  8; x <<=  8; }
+   if(!(x >> 28)) { n +=  4; x <<=  4; }
+   if(!(x >> 30)) { n +=  2; x <<=  2; }
+   if(!(x >> 31)) { n +=  1;           }
+   return n;
 }
@@ -1,44 +1,80 @@
 #include "../femtostdlib.h"
 
-/* 
+/*
  * Needed to prevent the compiler from recognizing memcpy in the
  * body of memcpy and replacing it with a call to memcpy
- * (infinite recursion) 
- */ 
+ * (infinite recursion)
+ */
 #pragma GCC optimize ("no-tree-loop-distribute-patterns")
 
+/*
+ * Copies word by word whenever it can: the destination is aligned first
+ * (at most 3 bytes), then if the source is aligned too, 8 words are copied
+ * per iteration, else aligned words of the source are read and shifted
+ * and merged (little endian) into the words of the destination, 4 by
+ * iteration. Only the last 0-3 bytes (and the small copies) are copied
+ * byte by byte. Reading whole aligned source words may read up to 3 bytes
+ * around the source, always in the same word as a byte of the source.
+ * In RAM on the IceStick (RV32_FASTCODE).
+ */
+void* memcpy(void * dst, void const * src, size_t len) RV32_FASTCODE;
 void* memcpy(void * dst, void const * src, size_t len) {
-   uint32_t * plDst = (uint32_t *) dst;
-   uint32_t const * plSrc = (uint32_t const *) src;
+   uint8_t* pcDst = (uint8_t *) dst;
+   uint8_t const* pcSrc = (uint8_t const *) src;
 
-   // If source and destination are aligned,
-   // copy 32s bit by 32 bits.
-   if (!((uint32_t)src & 3) && !((uint32_t)dst & 3)) {
-      while (len >= 4) {
-	 *plDst++ = *plSrc++;
-	 len -= 4;
+   if(len >= 8) {
+      while((uint32_t)pcDst & 3) {
+	 *pcDst++ = *pcSrc++;
+	 --len;
       }
+
+      uint32_t * plDst = (uint32_t *) pcDst;
+      uint32_t shift = ((uint32_t)pcSrc & 3) << 3;
+      size_t nb_words = len >> 2;
+      len &= 3;
+      pcSrc += nb_words << 2;
+
+      if(shift == 0) {
+	 uint32_t const * plSrc = (uint32_t const *)(pcSrc - (nb_words << 2));
+	 for(; nb_words >= 8; nb_words -= 8) {
+	    uint32_t w0 = plSrc[0], w1 = plSrc[1], w2 = plSrc[2], w3 = plSrc[3];
+	    uint32_t w4 = plSrc[4], w5 = plSrc[5], w6 = plSrc[6], w7 = plSrc[7];
+	    plDst[0] = w0; plDst[1] = w1; plDst[2] = w2; plDst[3] = w3;
+	    plDst[4] = w4; plDst[5] = w5; plDst[6] = w6; plDst[7] = w7;
+	    plSrc += 8;
+	    plDst += 8;
+	 }
+	 while(nb_words--) {
+	    *plDst++ = *plSrc++;
+	 }
+      } else {
+	 uint32_t rshift = shift;
+	 uint32_t lshift = 32 - shift;
+	 uint32_t const * plSrc = (uint32_t const *)
+	    (((uint32_t)pcSrc - (nb_words << 2)) & ~3);
+	 uint32_t w = *plSrc++;
+	 for(; nb_words >= 4; nb_words -= 4) {
+	    uint32_t w1 = plSrc[0], w2 = plSrc[1], w3 = plSrc[2], w4 = plSrc[3];
+	    plDst[0] = (w  >> rshift) | (w1 << lshift);
+	    plDst[1] = (w1 >> rshift) | (w2 << lshift);
+	    plDst[2] = (w2 >> rshift) | (w3 << lshift);
+	    plDst[3] = (w3 >> rshift) | (w4 << lshift);
+	    w = w4;
+	    plSrc += 4;
+	    plDst += 4;
+	 }
+	 while(nb_words--) {
+	    uint32_t w1 = *plSrc++;
+	    *plDst++ = (w >> rshift) | (w1 << lshift);
+	    w = w1;
+	 }
+      }
+      pcDst = (uint8_t *) plDst;
    }
 
-   uint8_t* pcDst = (uint8_t *) plDst;
-   uint8_t const* pcSrc = (uint8_t const *) plSrc;
-   
    while (len--) {
       *pcDst++ = *pcSrc++;
    }
-   
-   return dst;
-}
-
 
-/*
- * Equivalent (slower) version
-void* memcpy(void* dest, const void* src, size_t n) {
-   char *csrc  = (char *)src; 
-   char *cdest = (char *)dest; 
-   for (size_t i=0; i<n; i++) {
-      cdest[i] = csrc[i];
-   }
+   return dst;
 }
- */
-
@@ -1,22 +1,47 @@
 #include "../femtostdlib.h"
 
-/* 
+/*
  * Needed to prevent the compiler from recognizing memset in the
  * body of memset and replacing it with a call to memset
- * (infinite recursion) 
- */ 
+ * (infinite recursion)
+ */
 #pragma GCC optimize ("no-tree-loop-distribute-patterns")
 
 /*
- * Super-slow memset function.
- * TODO: write word by word.
- */ 
+ * Aligns the destination (at most 3 bytes), then writes the byte replicated
+ * in a word, 8 words per iteration, and the last 0-3 bytes.
+ * In RAM on the IceStick (RV32_FASTCODE).
+ */
+void* memset(void* s, int c, size_t n) RV32_FASTCODE;
 void* memset(void* s, int c, size_t n) {
    uint8_t* p = (uint8_t*)s;
-   for(size_t i=0; i<n; ++i) {
-       *p = (uint8_t)c;
-       p++;
+
+   if(n >= 8) {
+      uint32_t w = (uint8_t)c;
+      w |= w << 8;
+      w |= w << 16;
+
+      while((uint32_t)p & 3) {
+	 *p++ = (uint8_t)c;
+	 --n;
+      }
+
+      uint32_t* pw = (uint32_t*)p;
+      size_t nb_words = n >> 2;
+      n &= 3;
+      for(; nb_words >= 8; nb_words -= 8) {
+	 pw[0] = w; pw[1] = w; pw[2] = w; pw[3] = w;
+	 pw[4] = w; pw[5] = w; pw[6] = w; pw[7] = w;
+	 pw += 8;
+      }
+      while(nb_words--) {
+	 *pw++ = w;
+      }
+      p = (uint8_t*)pw;
+   }
+
+   while(n--) {
+      *p++ = (uint8_t)c;
    }
    return s;
 }
-
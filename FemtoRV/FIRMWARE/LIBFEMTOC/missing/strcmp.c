@@ -1,9 +1,37 @@
 #include "../femtostdlib.h"
 
+/*
+ * When both strings have the same alignment, compares byte by byte until
+ * they are aligned (at most 3 bytes), then word by word while the words
+ * are equal and have no zero byte, and the bytes of the last words.
+ * Else compares byte by byte. Reading whole aligned words may read up to
+ * 3 bytes after the end of a string, always in the same word as its last
+ * byte. In RAM on the IceStick (RV32_FASTCODE).
+ */
+int strcmp (const char *p1, const char *p2) RV32_FASTCODE;
 int strcmp (const char *p1, const char *p2)  {
    const unsigned char *s1 = (const unsigned char *) p1;
    const unsigned char *s2 = (const unsigned char *) p2;
    unsigned char c1, c2;
+
+   if((((uint32_t)s1 ^ (uint32_t)s2) & 3) == 0) {
+      while((uint32_t)s1 & 3) {
+	 c1 = *s1++;
+	 c2 = *s2++;
+	 if(c1 == '\0' || c1 != c2) {
+	    return c1 - c2;
+	 }
+      }
+      const uint32_t* w1 = (const uint32_t*)s1;
+      const uint32_t* w2 = (const uint32_t*)s2;
+      while(*w1 == *w2 && !HAS_ZERO_BYTE(*w1)) {
+	 ++w1;
+	 ++w2;
+      }
+      s1 = (const unsigned char *)w1;
+      s2 = (const unsigned char *)w2;
+   }
+
    do {
       c1 = (unsigned char) *s1++;
       c2 = (unsigned char) *s2++;
@@ -1,7 +1,31 @@
 #include "../femtostdlib.h"
 
+/*
+ * Reads the string byte by byte until it is aligned (at most 3 bytes),
+ * then word by word until a word has a zero byte, and finds it in the
+ * word. Reading whole aligned words may read up to 3 bytes after the end
+ * of the string, always in the same word as its last byte.
+ * In RAM on the IceStick (RV32_FASTCODE).
+ */
+size_t strlen(const char *str) RV32_FASTCODE;
 size_t strlen(const char *str) {
-   for (size_t len = 0;;++len) if (str[len]==0) return len;
-}
+   const char* p = str;
+
+   while((uint32_t)p & 3) {
+      if(*p == 0) {
+	 return p - str;
+      }
+      ++p;
+   }
 
+   const uint32_t* pw = (const uint32_t*)p;
+   while(!HAS_ZERO_BYTE(*pw)) {
+      ++pw;
+   }
 
+   p = (const char*)pw;
+   while(*p) {
+      ++p;
+   }
+   return p - str;
+}
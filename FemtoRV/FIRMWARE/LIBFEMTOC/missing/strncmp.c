@@ -1,6 +1,32 @@
-#include <femtorv32.h>
+#include "../femtostdlib.h"
 
+/*
+ * Same as strcmp() (word by word when both strings have the same
+ * alignment), stopping after n bytes.
+ * In RAM on the IceStick (RV32_FASTCODE).
+ */
+int strncmp( const char * s1, const char * s2, size_t n ) RV32_FASTCODE;
 int strncmp( const char * s1, const char * s2, size_t n ) {
+    if ((((uint32_t)s1 ^ (uint32_t)s2) & 3) == 0) {
+	while ( n && ((uint32_t)s1 & 3) ) {
+	    if ( !*s1 || ( *s1 != *s2 ) ) {
+		return ( *(unsigned char *)s1 - *(unsigned char *)s2 );
+	    }
+	    ++s1;
+	    ++s2;
+	    --n;
+	}
+	const uint32_t* w1 = (const uint32_t*)s1;
+	const uint32_t* w2 = (const uint32_t*)s2;
+	while ( n >= 4 && *w1 == *w2 && !HAS_ZERO_BYTE(*w1) ) {
+	    ++w1;
+	    ++w2;
+	    n -= 4;
+	}
+	s1 = (const char*)w1;
+	s2 = (const char*)w2;
+    }
+
     while ( n && *s1 && ( *s1 == *s2 ) ) {
 	++s1;
 	++s2;
@@ -1,13 +1,37 @@
 #include "../femtostdlib.h"
 
+/*
+ * Same as strcpy() (word by word when the source and the destination have
+ * the same alignment), stopping after n bytes. The rest of the n bytes is
+ * filled with zeroes by memset().
+ * In RAM on the IceStick (RV32_FASTCODE).
+ */
+char* strncpy(char *dest, const char *src, size_t n) RV32_FASTCODE;
 char* strncpy(char *dest, const char *src, size_t n) {
-   size_t i;
-   for (i = 0; i < n && src[i] != '\0'; i++) {
+   size_t i = 0;
+
+   if((((uint32_t)dest ^ (uint32_t)src) & 3) == 0) {
+      for(; i < n && ((uint32_t)(src + i) & 3); i++) {
+	 if((dest[i] = src[i]) == '\0') {
+	    break;
+	 }
+      }
+      if(i < n && ((uint32_t)(src + i) & 3) == 0) {
+	 for(; i + 4 <= n; i += 4) {
+	    uint32_t w = *(const uint32_t*)(src + i);
+	    if(HAS_ZERO_BYTE(w)) {
+	       break;
+	    }
+	    *(uint32_t*)(dest + i) = w;
+	 }
+      }
+   }
+
+   for (; i < n && src[i] != '\0'; i++) {
        dest[i] = src[i];
    }
-   for ( ; i < n; i++) {
-       dest[i] = '\0';
+   if (i < n) {
+       memset(dest + i, 0, n - i);
    }
    return dest;
 }
-
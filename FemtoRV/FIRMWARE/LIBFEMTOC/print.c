@@ -3,9 +3,11 @@
 /* print_dec, print_hex taken from picorv32 */
 
 void print_string(const char* s) {
-   for(const char* p = s; *p; ++p) {
-      putchar(*p);
+   const char* p = s;
+   while(*p) {
+      ++p;
    }
+   putchars(s, p - s);
 }
 
 int puts(const char* s) {
@@ -1,26 +1,171 @@
 #include <femtostdlib.h>
 #include <stdarg.h>
 
+/*
+ * The output is rendered in a buffer on the stack, and sent as whole
+ * strings to putchars() (that is, to the putsfunc of the current tty,
+ * see set_putsfunc()), instead of one putchar() per character.
+ *
+ * Supports %d %i %u %x %X %p %c %s %%, with a width (or '*'), the
+ * '-' (left-justify) and '0' (pad with zeroes) flags. The 'l' modifier
+ * is accepted and ignored (long is 32 bits).
+ */
+
+#define PRINTF_BUFFER_SIZE 64
+
+typedef struct {
+   char buffer[PRINTF_BUFFER_SIZE];
+   int  len;
+   int  total;
+} printf_state;
+
+static void printf_flush(printf_state* state) {
+   if(state->len != 0) {
+      putchars(state->buffer, state->len);
+      state->total += state->len;
+      state->len = 0;
+   }
+}
+
+static void printf_putc(printf_state* state, char c) {
+   if(state->len == PRINTF_BUFFER_SIZE) {
+      printf_flush(state);
+   }
+   state->buffer[state->len++] = c;
+}
+
+static void printf_pad(printf_state* state, char c, int n) {
+   while(n-- > 0) {
+      printf_putc(state, c);
+   }
+}
+
+/*
+ * Outputs a field of len chars (s) with sign (0 if none), padded
+ * to width. Zero padding goes between the sign and the digits.
+ */
+static void printf_field(
+   printf_state* state, const char* s, int len, char sign,
+   int width, int left, int zero
+) {
+   int pad = width - len - (sign != 0);
+   if(!left && !zero) {
+      printf_pad(state, ' ', pad);
+   }
+   if(sign) {
+      printf_putc(state, sign);
+   }
+   if(!left && zero) {
+      printf_pad(state, '0', pad);
+   }
+   while(len-- > 0) {
+      printf_putc(state, *(s++));
+   }
+   if(left) {
+      printf_pad(state, ' ', pad);
+   }
+}
+
 int printf(const char *fmt,...)
 {
     va_list ap;
+    printf_state state;
+    char digits[12];
+
+    state.len = 0;
+    state.total = 0;
 
     for(va_start(ap, fmt);*fmt;fmt++)
     {
-        if(*fmt=='%')
-        {
-            fmt++;
-                 if(*fmt=='s') print_string(va_arg(ap,char *));
-            else if(*fmt=='x') print_hex(va_arg(ap,int));
-            else if(*fmt=='d') print_dec(va_arg(ap,int));
-            else if(*fmt=='c') putchar(va_arg(ap,int));	   
-            else putchar(*fmt);
-        }
-        else putchar(*fmt);
+        if(*fmt != '%') {
+	    printf_putc(&state, *fmt);
+	    continue;
+	}
+        fmt++;
+
+        int left = 0;
+        int zero = 0;
+        for(;;fmt++) {
+	         if(*fmt=='-') left = 1;
+	    else if(*fmt=='0') zero = 1;
+	    else break;
+	}
+
+        int width = 0;
+        if(*fmt=='*') {
+	    width = va_arg(ap,int);
+	    if(width < 0) {
+	        left = 1;
+	        width = -width;
+	    }
+	    fmt++;
+	} else {
+	    while(*fmt >= '0' && *fmt <= '9') {
+	        width = width*10 + (*fmt - '0');
+	        fmt++;
+	    }
+	}
+
+        while(*fmt=='l') {
+	    fmt++;
+	}
+
+        char*        p    = digits + sizeof(digits);
+        char         sign = 0;
+        unsigned int val;
+        switch(*fmt) {
+	case 'd':
+	case 'i': {
+	    int ival = va_arg(ap,int);
+	    val = (unsigned int)ival;
+	    if(ival < 0) {
+	        sign = '-';
+	        val = -val;
+	    }
+	    do { *(--p) = '0' + val % 10; val /= 10; } while(val);
+	} break;
+	case 'u':
+	    val = va_arg(ap,unsigned int);
+	    do { *(--p) = '0' + val % 10; val /= 10; } while(val);
+	    break;
+	case 'p':
+	case 'x':
+	case 'X': {
+	    const char* hex = (*fmt=='x') ? "0123456789abcdef" : "0123456789ABCDEF";
+	    val = va_arg(ap,unsigned int);
+	    do { *(--p) = hex[val & 15]; val >>= 4; } while(val);
+	} break;
+	case 'c':
+	    *(--p) = (char)va_arg(ap,int);
+	    zero = 0;
+	    break;
+	case 's': {
+	    const char* s = va_arg(ap,char *);
+	    int len = 0;
+	    if(s == 0) {
+	        s = "(null)";
+	    }
+	    while(s[len]) {
+	        len++;
+	    }
+	    printf_field(&state, s, len, 0, width, left, 0);
+	    continue;
+	}
+	case '\0':
+	    fmt--; /* trailing '%', stop at the end of the string */
+	    continue;
+	default: /* '%%' and unknown conversions: output the char */
+	    *(--p) = *fmt;
+	    zero = 0;
+	    break;
+	}
+        printf_field(
+	    &state, p, digits + sizeof(digits) - p, sign, width, left, zero
+	);
     }
 
     va_end(ap);
+    printf_flush(&state);
 
-    return 0;
+    return state.total;
 }
-
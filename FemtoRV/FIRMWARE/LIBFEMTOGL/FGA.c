@@ -1,11 +1,5 @@
 #include <femtoGL.h>
-
-extern int GL_clip(
-    int nb_pts, int** poly, 
-    int xmin, int ymin, int xmax, int ymax
-);
-
-#define BIG 16384;
+#include <femto_task.h>
 
 #define WIDTH  FGA_width
 #define HEIGHT FGA_height
@@ -17,19 +11,100 @@ static inline void FGA_fill_rect_fast(
       return;
    }
    FGA_CMD2(FGA_CMD_SET_WWINDOW_X, x1, x2);
-   FGA_CMD2(FGA_CMD_SET_WWINDOW_Y, y1, y2);
+   FGA_CMD2(FGA_CMD_SET_WWINDOW_Y, y1 + FGA_draw_y0, y2 + FGA_draw_y0);
    FGA_CMD1(FGA_CMD_FILLRECT, color);
 }
 
+/* The waits for the FGA let the other tasks run (femto_task.h) */
 static inline FGA_wait_GPU() {
-   while(IO_IN(IO_FGA_CNTL) & FGA_BUSY_bit);
+   while(IO_IN(IO_FGA_CNTL) & FGA_BUSY_bit) {
+      femto_yield();
+   }
+}
+
+/*
+ * Command queue: the FILLRECT commands are queued, and sent to the FGA
+ * each time it is not busy (FGA_submit()), so that the CPU can compute
+ * the next spans (or polygons) while the FGA fills. A span that continues
+ * the last queued one (same x1,x2 and color, next row) is merged with it.
+ */
+
+#define FGA_QUEUE_SIZE 64 /* power of two */
+#define FGA_QUEUE_MASK (FGA_QUEUE_SIZE-1)
+
+typedef struct {
+   uint16_t x1;
+   uint16_t y1;
+   uint16_t x2;
+   uint16_t y2;
+   uint16_t color;
+} FGA_Rect;
+
+static FGA_Rect fga_queue[FGA_QUEUE_SIZE];
+static int fga_queue_head = 0; /* next command to be sent */
+static int fga_queue_tail = 0; /* next free slot */
+
+int FGA_submit() {
+   while(
+      fga_queue_head != fga_queue_tail &&
+      !(IO_IN(IO_FGA_CNTL) & FGA_BUSY_bit)
+   ) {
+      if(FGA_flip_pending) {
+	 break; /* the draw page is still displayed */
+      }
+      FGA_Rect* R = &fga_queue[fga_queue_head];
+      fga_queue_head = (fga_queue_head + 1) & FGA_QUEUE_MASK;
+      FGA_fill_rect_fast(R->x1, R->y1, R->x2, R->y2, R->color);
+   }
+   return (fga_queue_tail - fga_queue_head) & FGA_QUEUE_MASK;
+}
+
+void FGA_finish() {
+   if(fga_queue_head != fga_queue_tail) {
+      FGA_wait_flip();
+   }
+   while(FGA_submit()) {
+      femto_yield();
+   }
+   FGA_wait_GPU();
+}
+
+static void FGA_queue_rect(
+    uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, uint16_t color
+) {
+   if(x2 < x1) {
+      return;
+   }
+   if(fga_queue_head != fga_queue_tail) {
+      FGA_Rect* last = &fga_queue[(fga_queue_tail - 1) & FGA_QUEUE_MASK];
+      if(
+	 last->x1 == x1 && last->x2 == x2 && last->color == color &&
+	 last->y2 + 1 == y1
+      ) {
+	 last->y2 = y2;
+	 FGA_submit();
+	 return;
+      }
+   }
+   while(((fga_queue_tail + 1) & FGA_QUEUE_MASK) == fga_queue_head) {
+      FGA_wait_flip();
+      FGA_submit();
+      femto_yield();
+   }
+   FGA_Rect* R = &fga_queue[fga_queue_tail];
+   R->x1 = x1;
+   R->y1 = y1;
+   R->x2 = x2;
+   R->y2 = y2;
+   R->color = color;
+   fga_queue_tail = (fga_queue_tail + 1) & FGA_QUEUE_MASK;
+   FGA_submit();
 }
 
 void FGA_fill_rect(
     uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, uint16_t color
 ) {
-   FGA_fill_rect_fast(x1, y1, x2, y2, color);
-   FGA_wait_GPU();
+   FGA_queue_rect(x1, y1, x2, y2, color);
 }
 
 void FGA_clear() {
@@ -37,7 +112,10 @@ void FGA_clear() {
 }
 
 void FGA_wait_vbl() {
-   while(!(IO_IN(IO_FGA_CNTL) & FGA_VBL_bit));
+   FGA_finish();
+   while(!(IO_IN(IO_FGA_CNTL) & FGA_VBL_bit)) {
+      femto_yield();
+   }
 }
 
 
@@ -60,11 +138,13 @@ void FGA_wait_vbl() {
 // that on our own).
 static inline void FGA_setpixel_fast(int x, int y, uint16_t color) {
   FGA_CMD2(FGA_CMD_SET_WWINDOW_X, x, x);
-  FGA_CMD2(FGA_CMD_SET_WWINDOW_Y, y, y);
+  FGA_CMD2(FGA_CMD_SET_WWINDOW_Y, y + FGA_draw_y0, y + FGA_draw_y0);
   IO_OUT(IO_FGA_DAT,color);
 }
 
 void FGA_setpixel(int x, int y, uint16_t color) {
+   FGA_finish();
+   FGA_wait_flip();
    FGA_setpixel_fast(x,y,color);
 }
 
@@ -116,7 +196,10 @@ void FGA_line(int x1, int y1, int x2, int y2, uint16_t color) {
 	}
     }
     
-    /* Bresenham line drawing. */
+    /* 
+     * Bresenham line drawing, by runs: the pixels of the line on the
+     * same row (or column for steep lines) are a single FILLRECT.
+     */
     dy = y2 - y1;
     sy = 1;
     if(dy < 0) {
@@ -135,145 +218,128 @@ void FGA_line(int x1, int y1, int x2, int y2, uint16_t color) {
     y = y1;
     if(dy > dx) {
 	int ex = (dx << 1) - dy;
+	int run_y = y;
 	for(int u=0; u<dy; u++) {
-	    FGA_setpixel_fast(x,y,color);
 	    y += sy;
 	    while(ex >= 0)  {
-		FGA_setpixel_fast(x,y,color);		
+		FGA_queue_rect(x, MIN(run_y,y), x, MAX(run_y,y), color);
 		x += sx;
+		run_y = y;
 		ex -= dy << 1;
 	    }
 	    ex += dx << 1;
 	}
+	if(run_y != y) {
+	    FGA_queue_rect(x, MIN(run_y,y-sy), x, MAX(run_y,y-sy), color);
+	}
     } else {
 	int ey = (dy << 1) - dx;
+	int run_x = x;
 	for(int u=0; u<dx; u++) {
-	    FGA_setpixel_fast(x,y,color);
 	    x += sx;
 	    while(ey >= 0) {
-		FGA_setpixel_fast(x,y,color);
+		FGA_queue_rect(MIN(run_x,x), y, MAX(run_x,x), y, color);
 		y += sy;
+		run_x = x;
 		ey -= dx << 1;
 	    }
 	    ey += dy << 1;
 	}
+	if(run_x != x) {
+	    FGA_queue_rect(MIN(run_x,x-sx), y, MAX(run_x,x-sx), y, color);
+	}
     }
 }
 
-void FGA_fill_poly(int nb_pts, int* points, uint16_t color) {
+/*
+ * Direct VRAM writes, with the pixels packed as the FGA stores them
+ * (pixel i of a word in bits [i*bpp, (i+1)*bpp) ), 32/bpp pixels
+ * per processor store instead of one per FGA_DAT write. VRAM is
+ * write-only, so the bytes are either fully written or not at all: 
+ * for bpp < 8, x and width need to be aligned on bytes.
+ */
+
+static inline void FGA_store_word(uint32_t* ptr, uint32_t word, uint32_t wmask) {
+   if(wmask == 0xffffffff) {
+      *ptr = word;
+      return;
+   }
+   uint8_t* byte_ptr = (uint8_t*)ptr;
+   for(int i=0; i<4; ++i) {
+      if((wmask >> (i*8)) & 255) {
+	 byte_ptr[i] = (uint8_t)(word >> (i*8));
+      }
+   }
+}
 
-    uint16_t x_left[HEIGHT];
-    uint16_t x_right[HEIGHT];
-
-    /* Determine clockwise, miny, maxy */
-    int clockwise = 0;
-    int minx =  BIG;
-    int maxx = -BIG;
-    int miny =  BIG;
-    int maxy = -BIG;
-    for(int i1=0; i1<nb_pts; ++i1) {
-	int i2=(i1==nb_pts-1) ? 0 : i1+1;
-	int i3=(i2==nb_pts-1) ? 0 : i2+1;
-	int x1 = points[2*i1];
-	int y1 = points[2*i1+1];
-	int dx1 = points[2*i2]   - x1;
-	int dy1 = points[2*i2+1] - y1;
-	int dx2 = points[2*i3]   - x1;
-	int dy2 = points[2*i3+1] - y1;
-	clockwise += dx1 * dy2 - dx2 * dy1;
-	minx = MIN(minx,x1);
-	maxx = MAX(maxx,x1);
-	miny = MIN(miny,y1);
-	maxy = MAX(maxy,y1);
-    }
+void FGA_blit(int X, int Y, int width, int height, const uint16_t* pixels) {
+   int bpp = FGA_bpp();
+   if(
+      bpp == 0 || X < 0 || Y < 0 ||
+      X + width > FGA_width || Y + height > FGA_height ||
+      (bpp < 8 && ((X | width) & ((8/bpp) - 1)))
+   ) {
+      FGA_write_window(X,Y,X+width-1,Y+height-1);
+      for(int i=0; i<width*height; ++i) {
+	 IO_OUT(IO_FGA_DAT, pixels[i]);
+      }
+      return;
+   }
+   
+   /* Direct VRAM writes are ignored while the FGA is busy. */
+   FGA_finish();
+   FGA_wait_flip();
+   
+   int      pix_per_word = 32 / bpp;
+   uint32_t pix_mask = (bpp == 16) ? 0xffff : (1u << bpp) - 1;
+   uint32_t pix_address = (Y + FGA_draw_y0) * FGA_width + X;
+   for(int y=0; y<height; ++y) {
+      uint32_t* word_ptr = (uint32_t*)FGA_BASEMEM + pix_address / pix_per_word;
+      int       shift = (pix_address % pix_per_word) * bpp;
+      uint32_t  word  = 0;
+      uint32_t  wmask = 0;
+      for(int x=0; x<width; ++x) {
+	 word  |= (*(pixels++) & pix_mask) << shift;
+	 wmask |= pix_mask << shift;
+	 shift += bpp;
+	 if(shift == 32) {
+	    FGA_store_word(word_ptr, word, wmask);
+	    ++word_ptr;
+	    shift = 0;
+	    word  = 0;
+	    wmask = 0;
+	 }
+      }
+      if(wmask != 0) {
+	 FGA_store_word(word_ptr, word, wmask);
+      }
+      pix_address += FGA_width;
+   }
+}
 
-    if((gl_culling_mode == GL_FRONT_FACE) && (clockwise < 0)) {
-	return;
-    }
+static void FGA_fill_span(int y, int x1, int x2, void* data) {
+    FGA_queue_rect(x1, y, x2, y, *(uint16_t*)data);
+}
 
-    if((gl_culling_mode == GL_BACK_FACE) && (clockwise > 0)) {
+void FGA_fill_poly(int nb_pts, int* points, uint16_t color) {
+    if(GL_poly_culled(nb_pts, points)) {
 	return;
     }
-    
-    if((minx < 0) || (miny < 0) || (maxx >= WIDTH) || (maxy >= HEIGHT)) {
-	nb_pts = GL_clip(nb_pts, &points, 0, 0, WIDTH-1, HEIGHT-1);
-	miny =  BIG;
-	maxy = -BIG;
-	for(int i1=0; i1<nb_pts; ++i1) {
-	    int x1 = points[2*i1];
-	    int y1 = points[2*i1+1];
-	    miny = MIN(miny,y1);
-	    maxy = MAX(maxy,y1);
-	}
-    }
-    
-    /* Determine x_left and x_right for each scaline */
-    for(int i1=0; i1<nb_pts; ++i1) {
-	int i2=(i1==nb_pts-1) ? 0 : i1+1;
-
-	int x1 = points[2*i1];
-	int y1 = points[2*i1+1];
-	int x2 = points[2*i2];
-	int y2 = points[2*i2+1];
-
-	if(gl_polygon_mode == GL_POLY_LINES) {
-	    FGA_line(x1,y1,x2,y2,color);
-	    continue;
-	}
 
-        uint16_t* x_buffer = ((clockwise > 0) ^ (y2 > y1)) ? x_left : x_right;
-	int dx = x2 - x1;
-	int sx = 1;
-	int dy = y2 - y1;
-	int sy = 1;
-	int x = x1;
-	int y = y1;
-	int ex;
-	
-	if(dx < 0) {
-	    sx = -1;
-	    dx = -dx;
-	}
-	
-	if(dy < 0) {
-	    sy = -1;
-	    dy = -dy;
-	}
-
-	if(y1 == y2) {
-	   x_left[y1]  = MIN(x1,x2);
-	   x_right[y1] = MAX(x1,x2);
-	   continue;
-	}
-
-	ex = (dx << 1) - dy;
-
-	for(int u=0; u <= dy; ++u) {
-	    x_buffer[y] = x;
-	    y += sy;
-	    while(ex >= 0) {
-		x += sx;
-		ex -= dy << 1;
-	    }
-	    ex += dx << 1;
+    if(gl_polygon_mode == GL_POLY_LINES) {
+	for(int i1=0; i1<nb_pts; ++i1) {
+	    int i2=(i1==nb_pts-1) ? 0 : i1+1;
+	    FGA_line(points[2*i1],points[2*i1+1],points[2*i2],points[2*i2+1],color);
 	}
+	return;
     }
 
-    if(gl_polygon_mode == GL_POLY_LINES) {    
-        return;
-    }
-
-    for(int y = miny; y <= maxy; ++y) {
-	int x1 = x_left[y];
-	int x2 = x_right[y];
-	/* 
-	 * By waiting *before* instead of *after*, we can overlap
-	 * fetchting next x1,x2 and drawing the line (negligible in
-	 * fact, but better than nothing.
-	 */
-        FGA_wait_GPU();       
-        FGA_fill_rect_fast(x1,y,x2,y, color);
-    }
-    FGA_wait_GPU();
+    /* 
+     * Queued: returns before the FGA is done, the next polygon is
+     * computed while the FGA fills this one.
+     */
+    poly_raster(
+	nb_pts, points, 0, 0, WIDTH-1, HEIGHT-1, FGA_fill_span, &color
+    );
 }
 
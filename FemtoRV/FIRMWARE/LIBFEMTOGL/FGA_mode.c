@@ -1,19 +1,64 @@
 #include <femtoGL.h>
+#include <femto_task.h>
 
 int      FGA_mode = -1;
 uint16_t FGA_width;
 uint16_t FGA_height;
 
+int          FGA_nb_pages = 1;
+int          FGA_draw_page = 0;
+int          FGA_display_page = 0;
+uint16_t     FGA_draw_y0 = 0;
+volatile int FGA_flip_pending = 0;
+
+#define FGA_VRAM_BITS (128*1024*8)
+
 static void FGA_setmode_internal(int width, int height, int colormode, int displaymode) {
+  int bpp = 1 << (colormode & 7);
+  FGA_nb_pages = FGA_VRAM_BITS / (width * height * bpp);
+  FGA_draw_page = 0;
+  FGA_display_page = 0;
+  FGA_draw_y0 = 0;
+  FGA_flip_pending = 0;
   FGA_SET_REG(FGA_REG_RESOLUTION, width | (height << 12));
   FGA_SET_REG(FGA_REG_COLORMODE, colormode);
   FGA_SET_REG(FGA_REG_DISPLAYMODE, displaymode);
   FGA_SET_REG(FGA_REG_ORIGIN, 0);
-  FGA_SET_REG(FGA_REG_WRAP, width*height);
+  // The scanout goes back to pixel 0 after the last page
+  FGA_SET_REG(FGA_REG_WRAP, FGA_nb_pages*width*height);
   FGA_width  = width;
   FGA_height = height;
 }
 
+void FGA_wait_flip_vbl() {
+   while(!(IO_IN(IO_FGA_CNTL) & FGA_VBL_bit)) {
+      femto_yield();
+   }
+   FGA_flip_pending = 0;
+}
+
+void FGA_set_draw_page(int page) {
+   if(page < 0 || page >= FGA_nb_pages) {
+      return;
+   }
+   FGA_finish();
+   FGA_draw_page = page;
+   FGA_draw_y0 = page * FGA_height;
+}
+
+void FGA_flip() {
+   FGA_finish();
+   FGA_wait_flip();
+   FGA_SET_REG(FGA_REG_ORIGIN, FGA_draw_page * FGA_width * FGA_height);
+   FGA_display_page = FGA_draw_page;
+   if(FGA_nb_pages > 1) {
+      // The new draw page is scanned until the end of the frame
+      FGA_draw_page = (FGA_draw_page + 1) % FGA_nb_pages;
+      FGA_draw_y0 = FGA_draw_page * FGA_height;
+      FGA_flip_pending = 1;
+   }
+}
+
 void FGA_setmode(int mode) {
    if(!FEMTOSOC_HAS_DEVICE(IO_FGA_CNTL_bit)) {
       return;
@@ -49,8 +94,10 @@ void FGA_setmode(int mode) {
 }
 
 void FGA_write_window(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2) {
+  FGA_finish();
+  FGA_wait_flip();
   FGA_CMD2(FGA_CMD_SET_WWINDOW_X, x1, x2);
-  FGA_CMD2(FGA_CMD_SET_WWINDOW_Y, y1, y2);  
+  FGA_CMD2(FGA_CMD_SET_WWINDOW_Y, y1 + FGA_draw_y0, y2 + FGA_draw_y0);  
 }
 
 int FGA_bpp() {
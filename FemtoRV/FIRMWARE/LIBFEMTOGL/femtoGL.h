@@ -3,6 +3,7 @@
 
 #include <femtorv32.h>
 #include <FGA.h>
+#include <poly_raster.h>
 
 /* Font maps */
 extern uint16_t* font_8x16;   /*  8 half-words per char. Each half-word corresponds to a column.   */
@@ -33,8 +34,45 @@ void GL_wait_vbl();
 void GL_fill_rect(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, uint16_t color) RV32_FASTCODE;
 void GL_setpixel(int x, int y, uint16_t color) RV32_FASTCODE;
 void GL_line(int x1, int y1, int x2, int y3, uint16_t color) RV32_FASTCODE;
+void GL_hline(int x1, int x2, int y, uint16_t color); /* x1..x2 included, clipped */
+void GL_vline(int x, int y1, int y2, uint16_t color); /* y1..y2 included, clipped */
 void GL_fill_poly(int nb_pts, int* points, uint16_t color) RV32_FASTCODE;
 
+/* 
+ * Returns 1 if a polygon is culled by the current culling mode 
+ * (GL_culling_mode()). Polygons are rasterized by poly_raster() (shared with
+ * the LiteX framebuffer), GL_fill_poly() and GL_poly() send its spans.
+ */
+int GL_poly_culled(int nb_pts, int* points);
+
+/* 
+ * Display list of polygons (OLED): GL_poly() records the spans of the polygons 
+ * of a frame in per-scanline buckets, GL_end_frame() draws them in scanline 
+ * order (in the order of submission for each scanline), and sends each row 
+ * once, with a single window command per run of covered pixels.
+ * GL_rect() records a filled rectangle (x1..x2 , y1..y2 included).
+ * Primitives outside the screen are culled. In GL_POLY_LINES mode, GL_poly()
+ * draws the queued primitives, then the outline directly.
+ * Other modes (FGA framebuffer) draw the primitives directly.
+ */
+void GL_begin_frame();
+void GL_poly(int nb_pts, int* points, uint16_t color);
+void GL_rect(int x1, int y1, int x2, int y2, uint16_t color);
+void GL_end_frame();
+
+/*
+ * Back buffer (OLED): with a back buffer of GL_width*GL_height pixels, all
+ * primitives draw in RAM, and GL_flush() sends only the 8x8 tiles that changed
+ * (a pixel written with the value it already has does not count as a change).
+ * GL_set_backbuffer(NULL) goes back to direct drawing. Ignored in FGA modes.
+ */
+#define GL_BACKBUFFER_SIZE (OLED_WIDTH*OLED_HEIGHT) /* in pixels */
+extern uint16_t* GL_backbuffer;
+void GL_set_backbuffer(uint16_t* buffer);
+void GL_flush();
+void GL_backbuffer_window(int x1, int y1, int x2, int y2);
+void GL_backbuffer_write(uint16_t RGB) RV32_FASTCODE;
+
 
 extern int      FGA_mode;
 extern uint16_t FGA_width;
@@ -48,6 +86,48 @@ extern void FGA_line(int x1, int y1, int x2, int y3, uint16_t color);
 extern void FGA_fill_rect(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, uint16_t color);
 extern void FGA_fill_poly(int nb_pts, int* points, uint16_t color);
 
+/* 
+ * FGA_fill_rect() and FGA_fill_poly() queue their FILLRECT commands, and 
+ * return before the FGA is done. FGA_submit() sends the queued commands 
+ * while the FGA is not busy (non-blocking, returns the number of commands 
+ * still in the queue), FGA_finish() waits until all of them are done 
+ * (called by the other FGA functions, and by FGA_wait_vbl()).
+ */ 
+extern int  FGA_submit();
+extern void FGA_finish();
+
+/* 
+ * Writes a block of width*height pixels (colors or palette indices), packed
+ * in words and written directly to VRAM in the current FGA mode (4 pixels 
+ * per store in 8bpp, 8 in 4bpp). Falls back to FGA_DAT writes when the block
+ * is not aligned on bytes (bpp < 8) or not completely on the screen.
+ */
+extern void FGA_blit(int x, int y, int width, int height, const uint16_t* pixels);
+
+/*
+ * Page flipping: when VRAM holds more than one frame (FGA_nb_pages, 2 in
+ * 320x200x8bpp), the primitives draw in the draw page while the display
+ * page is shown. FGA_flip() shows the draw page (the ORIGIN register is
+ * taken by the FGA at the start of the next frame) and draws next in the
+ * other page, without waiting: the drawing commands stay queued until the
+ * vertical blank, when the old page is no longer scanned (FGA_wait_flip()).
+ * With a single page, FGA_flip() does nothing but FGA_finish().
+ */
+extern int          FGA_nb_pages;
+extern int          FGA_draw_page;
+extern int          FGA_display_page;
+extern uint16_t     FGA_draw_y0;      /* first row of the draw page in VRAM */
+extern volatile int FGA_flip_pending; /* draw page still scanned */
+extern void FGA_set_draw_page(int page);
+extern void FGA_flip();
+extern void FGA_wait_flip_vbl();
+
+static inline void FGA_wait_flip() {
+   if(FGA_flip_pending) {
+      FGA_wait_flip_vbl();
+   }
+}
+
 #define GL_POLY_LINES 1
 #define GL_POLY_FILL  2
 extern int gl_polygon_mode;
@@ -67,10 +147,12 @@ void MAX7219_tty_init();      /* Initializes led matrix and redirects output to
 
 
 typedef void (*GLFontFunc)(int x, int y, char c);
+typedef void (*GLFontExpandFunc)(char c, uint16_t* pixels); /* width*height pixels, GL_fg/GL_bg */
 typedef struct {
    GLFontFunc func;
    uint8_t width;
    uint8_t height;
+   GLFontExpandFunc expand;
 } GLFont;
 
 extern const GLFont Font8x16;
@@ -78,14 +160,40 @@ extern const GLFont Font8x8;
 extern const GLFont Font5x6;
 extern const GLFont Font3x5;
 
+/*
+ * The same fonts, drawn as rectangles (femtoGLtext_spans.c): in the FGA
+ * modes, the FGA fills them, faster than the blit of the pixels. The
+ * glyph cache blits the cached pixels: use it with them on the OLED only.
+ */
+extern const GLFont Font8x16_spans;
+extern const GLFont Font8x8_spans;
+extern const GLFont Font5x6_spans;
+extern const GLFont Font3x5_spans;
+
 extern GLFont* GL_current_font;
 
 void GL_set_font(GLFont* font);
 void GL_tty_init(int mode); /* Initializes OLED screen and redirects output to it.    */
 void GL_tty_goto_xy(int X, int Y);
+void GL_tty_set_start_line(int Y); /* Scanline shown at the top (hardware scroll) */
 int  GL_putchar(int c);
+int  GL_putchars(const char* s, int len);
 void GL_putchar_xy(int x, int y, char c);
 
+/* 
+ * Glyph cache: GL_putchar_xy() keeps the expanded pixels of the glyphs 
+ * (direct-mapped by character), and draws a cached glyph as one window and 
+ * one burst of writes. Invalidated when GL_fg or GL_bg changes. 
+ * GL_set_glyph_cache(NULL,0) deactivates it (default).
+ */
+#define GL_GLYPH_MAX_PIXELS (8*16)
+typedef struct {
+   const GLFont* font;
+   char c;
+   uint16_t pixels[GL_GLYPH_MAX_PIXELS];
+} GLGlyph;
+void GL_set_glyph_cache(GLGlyph* glyphs, int nb_glyphs);
+
 void FGA_setmode(int mode);
 
 /* 
@@ -106,6 +214,29 @@ static inline void FGA_setpalette(int index, uint8_t R, uint8_t G, uint8_t B) {
 /* Simple "GUI" functions */
 int GUI_prompt(char* title, char** options);
 
+/* 
+ * Menu list, used by GUI_prompt() and FemtOS commander: moving the 
+ * selection only redraws the two items that changed. When the list 
+ * takes the whole OLED screen (first_line = 0, nb_lines text lines 
+ * as high as the screen), item i stays on line i % nb_lines and the 
+ * display start line scrolls the window, so that moving the window 
+ * by one item only draws the item that enters it. Items are drawn 
+ * with GL_putchar_xy() (and the glyph cache if there is one).
+ */
+typedef void (*GUIItemFunc)(int i, char* buff); /* text of item i, at most 31 chars */
+typedef struct {
+   GUIItemFunc item;
+   int nb_items;
+   int first_line;  /* text line of the first item on the screen */
+   int nb_lines;    /* number of items shown */
+   int from;        /* first item shown, -1 if not drawn yet     */
+   int sel;         /* selected item, as drawn                    */
+} GUIList;
+void GUI_list_init(
+   GUIList* list, GUIItemFunc item, int nb_items, int first_line, int nb_lines
+);
+void GUI_list_show(GUIList* list, int from, int sel);
+
 /* Low-level */
 
 /* Converts three R,G,B components (between 0 and 255) into a 16 bits color value for the OLED screen or FGA. */
@@ -119,13 +250,25 @@ int GUI_prompt(char* title, char** options);
  */ 
 
 #define IO_GFX_DAT (IO_SSD1351_DAT16 | IO_FGA_DAT) 
-#define GL_WRITE_DATA_UINT16(RGB) IO_OUT(IO_GFX_DAT,(RGB))
+#define GL_WRITE_DATA_UINT16(RGB) GL_write_data(RGB)
 #define GL_WRITE_DATA_RGB(R,G,B)  GL_WRITE_DATA_UINT16(GL_RGB(R,G,B))
 
 void FGA_write_window(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2);
 
+static inline void GL_write_data(uint16_t RGB) {
+   if(GL_backbuffer != 0) {
+      GL_backbuffer_write(RGB);
+      return;
+   }
+   IO_OUT(IO_GFX_DAT,RGB);
+}
+
 #ifdef FGA
 static inline void GL_write_window(int x1, int y1, int x2, int y2) {
+   if(GL_backbuffer != 0) {
+      GL_backbuffer_window(x1,y1,x2,y2);
+      return;
+   }
 # if defined(SSD1351) || defined(SSD1331)
    if(FGA_mode == -1) {
       oled_write_window(x1,y1,x2,y2);
@@ -135,6 +278,10 @@ static inline void GL_write_window(int x1, int y1, int x2, int y2) {
 }
 #else
 static inline void GL_write_window(int x1, int y1, int x2, int y2) {
+   if(GL_backbuffer != 0) {
+      GL_backbuffer_window(x1,y1,x2,y2);
+      return;
+   }
    oled_write_window(x1,y1,x2,y2);
 }
 #endif
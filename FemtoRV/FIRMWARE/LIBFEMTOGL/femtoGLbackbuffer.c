@@ -0,0 +1,103 @@
+#include <femtoGL.h>
+
+/*
+ * Back buffer, see GL_set_backbuffer() / GL_flush() in femtoGL.h.
+ * GL_write_window() and GL_WRITE_DATA_UINT16() are redirected here, and
+ * emulate the window / auto-increment of the OLED controller in RAM.
+ * Dirty bits: one 16 bits word per row of 8x8 tiles, one bit per tile.
+ */
+
+#define GL_BB_TILE_SHIFT 3
+#define GL_BB_TILES_Y    16
+
+uint16_t* GL_backbuffer = 0;
+
+static uint16_t  gl_bb_dirty[GL_BB_TILES_Y];
+static uint16_t* gl_bb_ptr;
+static int gl_bb_x;
+static int gl_bb_y;
+static int gl_bb_x1, gl_bb_y1, gl_bb_x2, gl_bb_y2;
+
+void GL_set_backbuffer(uint16_t* buffer) {
+#ifdef FGA
+   if(FGA_mode != GL_MODE_OLED) {
+      buffer = 0;
+   }
+#endif
+   GL_backbuffer = buffer;
+   if(buffer != 0) {
+      /* We do not know what is on the screen: everything is dirty */
+      memset(buffer, 0, GL_width*GL_height*sizeof(uint16_t));
+      memset(gl_bb_dirty, 0xff, sizeof(gl_bb_dirty));
+      GL_backbuffer_window(0,0,GL_width-1,GL_height-1);
+   }
+}
+
+void GL_backbuffer_window(int x1, int y1, int x2, int y2) {
+   gl_bb_x1 = MAX(x1,0);
+   gl_bb_y1 = MAX(y1,0);
+   gl_bb_x2 = MIN(x2,GL_width-1);
+   gl_bb_y2 = MIN(y2,GL_height-1);
+   gl_bb_x = gl_bb_x1;
+   gl_bb_y = gl_bb_y1;
+   gl_bb_ptr = GL_backbuffer + gl_bb_y * GL_width + gl_bb_x;
+}
+
+void GL_backbuffer_write(uint16_t RGB) {
+   if(gl_bb_x2 < gl_bb_x1 || gl_bb_y2 < gl_bb_y1) {
+      return;
+   }
+   if(*gl_bb_ptr != RGB) {
+      *gl_bb_ptr = RGB;
+      gl_bb_dirty[gl_bb_y >> GL_BB_TILE_SHIFT] |= 1 << (gl_bb_x >> GL_BB_TILE_SHIFT);
+   }
+   ++gl_bb_ptr;
+   ++gl_bb_x;
+   if(gl_bb_x > gl_bb_x2) {
+      /* Same as the OLED controller: next row, wraps at end of window */
+      gl_bb_x = gl_bb_x1;
+      ++gl_bb_y;
+      if(gl_bb_y > gl_bb_y2) {
+	 gl_bb_y = gl_bb_y1;
+      }
+      gl_bb_ptr = GL_backbuffer + gl_bb_y * GL_width + gl_bb_x;
+   }
+}
+
+void GL_flush() {
+   if(GL_backbuffer == 0) {
+      return;
+   }
+   int tiles_y = (GL_height + (1 << GL_BB_TILE_SHIFT) - 1) >> GL_BB_TILE_SHIFT;
+   for(int ty=0; ty<tiles_y; ++ty) {
+      uint32_t dirty = gl_bb_dirty[ty];
+      gl_bb_dirty[ty] = 0;
+      int tx = 0;
+      while(dirty != 0) {
+	 /* Find the next run of dirty tiles, and send it as one rectangle */
+	 while(!(dirty & 1)) {
+	    dirty >>= 1;
+	    ++tx;
+	 }
+	 int tx1 = tx;
+	 while(dirty & 1) {
+	    dirty >>= 1;
+	    ++tx;
+	 }
+	 int x1 = tx1 << GL_BB_TILE_SHIFT;
+	 int y1 = ty  << GL_BB_TILE_SHIFT;
+	 int x2 = MIN(tx << GL_BB_TILE_SHIFT, GL_width)  - 1;
+	 int y2 = MIN((ty+1) << GL_BB_TILE_SHIFT, GL_height) - 1;
+	 if(x1 > x2) {
+	    break;
+	 }
+	 oled_write_window(x1,y1,x2,y2);
+	 for(int y=y1; y<=y2; ++y) {
+	    uint16_t* p = GL_backbuffer + y * GL_width;
+	    for(int x=x1; x<=x2; ++x) {
+	       IO_OUT(IO_SSD1351_DAT16,p[x]);
+	    }
+	 }
+      }
+   }
+}
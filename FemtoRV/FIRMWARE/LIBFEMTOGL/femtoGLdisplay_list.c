@@ -0,0 +1,212 @@
+#include <femtoGL.h>
+
+/*
+ * Display list of polygons, see GL_begin_frame() / GL_poly() / GL_end_frame()
+ * in femtoGL.h. The spans of the polygons are stored in one list per scanline
+ * (in the order of submission), then each row is composed in a row buffer, and
+ * only the covered pixels are sent, once (no overdraw on the SPI bus). When a
+ * run of pixels starts where the previous window continues (same x range, next
+ * row), no window command is sent. Polygons and rectangles that are entirely
+ * outside the screen are culled before anything else.
+ */
+
+#ifndef GL_DISPLAY_LIST_SPANS
+#define GL_DISPLAY_LIST_SPANS 2048
+#endif
+
+#define GL_DL_WIDTH  128
+#define GL_DL_HEIGHT 128
+
+typedef struct {
+   uint8_t  x1;
+   uint8_t  x2;
+   uint16_t color;
+   uint16_t next;  /* index + 1 of the next span of the scanline, 0 if last */
+} GL_Span;
+
+static GL_Span  gl_dl_spans[GL_DISPLAY_LIST_SPANS];
+static uint16_t gl_dl_first[GL_DL_HEIGHT]; /* index + 1, 0 if empty */
+static uint16_t gl_dl_last[GL_DL_HEIGHT];
+static int      gl_dl_nb_spans = 0;
+static int      gl_dl_miny = GL_DL_HEIGHT;
+static int      gl_dl_maxy = -1;
+
+static void gl_dl_reset() {
+   for(int y=gl_dl_miny; y<=gl_dl_maxy; ++y) {
+      gl_dl_first[y] = 0;
+   }
+   gl_dl_nb_spans = 0;
+   gl_dl_miny = GL_DL_HEIGHT;
+   gl_dl_maxy = -1;
+}
+
+static void gl_dl_draw() {
+   uint16_t row[GL_DL_WIDTH];
+   uint8_t  covered[GL_DL_WIDTH];
+   int win_x1 = -1; /* the open window continues at (win_x1, win_y) */
+   int win_x2 = -1;
+   int win_y  = -1;
+
+   memset(covered, 0, sizeof(covered));
+
+   for(int y=gl_dl_miny; y<=gl_dl_maxy; ++y) {
+      int xmin = GL_DL_WIDTH;
+      int xmax = -1;
+
+      /* Compose the row (later polygons over earlier ones) */
+      for(int s=gl_dl_first[y]; s != 0; s=gl_dl_spans[s-1].next) {
+	 GL_Span* span = &gl_dl_spans[s-1];
+	 for(int x=span->x1; x<=span->x2; ++x) {
+	    row[x] = span->color;
+	    covered[x] = 1;
+	 }
+	 xmin = MIN(xmin, span->x1);
+	 xmax = MAX(xmax, span->x2);
+      }
+
+      /* Send the runs of covered pixels */
+      int x = xmin;
+      while(x <= xmax) {
+	 if(!covered[x]) {
+	    ++x;
+	    continue;
+	 }
+	 int x1 = x;
+	 while(x <= xmax && covered[x]) {
+	    covered[x] = 0;
+	    ++x;
+	 }
+	 int x2 = x-1;
+	 if(x1 != win_x1 || x2 != win_x2 || y != win_y) {
+	    GL_write_window(x1,y,x2,GL_height-1);
+	    win_x1 = x1;
+	    win_x2 = x2;
+	 }
+	 win_y = y+1;
+	 for(int xx=x1; xx<=x2; ++xx) {
+	    GL_WRITE_DATA_UINT16(row[xx]);
+	 }
+      }
+   }
+}
+
+/* Appends the span x1..x2 (clipped) to scanline y */
+static void gl_dl_add_span(int y, int x1, int x2, uint16_t color) {
+   GL_Span* span = &gl_dl_spans[gl_dl_nb_spans];
+   span->x1 = x1;
+   span->x2 = x2;
+   span->color = color;
+   span->next = 0;
+   ++gl_dl_nb_spans;
+   if(gl_dl_first[y] == 0) {
+      gl_dl_first[y] = gl_dl_nb_spans;
+   } else {
+      gl_dl_spans[gl_dl_last[y]-1].next = gl_dl_nb_spans;
+   }
+   gl_dl_last[y] = gl_dl_nb_spans;
+   gl_dl_miny = MIN(gl_dl_miny, y);
+   gl_dl_maxy = MAX(gl_dl_maxy, y);
+}
+
+/* Makes room for nb_spans spans (draws what we have if full, keeps the order) */
+static void gl_dl_reserve(int nb_spans) {
+   if(gl_dl_nb_spans + nb_spans > GL_DISPLAY_LIST_SPANS) {
+      gl_dl_draw();
+      gl_dl_reset();
+   }
+}
+
+static void gl_dl_span(int y, int x1, int x2, void* data) {
+   gl_dl_add_span(y, x1, x2, *(uint16_t*)data);
+}
+
+void GL_begin_frame() {
+   gl_dl_reset();
+}
+
+void GL_poly(int nb_pts, int* points, uint16_t color) {
+   int miny, maxy;
+
+#ifdef FGA
+   if(FGA_mode != GL_MODE_OLED) {
+      FGA_fill_poly(nb_pts, points, color);
+      return;
+   }
+#endif
+
+   if(GL_width > GL_DL_WIDTH || GL_height > GL_DL_HEIGHT) {
+      GL_fill_poly(nb_pts, points, color);
+      return;
+   }
+
+   /* Outlines are drawn directly: draw what is queued first (keeps the order) */
+   if(gl_polygon_mode == GL_POLY_LINES) {
+      gl_dl_draw();
+      gl_dl_reset();
+      GL_fill_poly(nb_pts, points, color);
+      return;
+   }
+
+   /* Cull what is entirely outside the screen */
+   int minx = points[0], maxx = points[0];
+   miny = points[1];
+   maxy = points[1];
+   for(int i=1; i<nb_pts; ++i) {
+      minx = MIN(minx, points[2*i]);
+      maxx = MAX(maxx, points[2*i]);
+      miny = MIN(miny, points[2*i+1]);
+      maxy = MAX(maxy, points[2*i+1]);
+   }
+   if(maxx < 0 || maxy < 0 || minx >= GL_width || miny >= GL_height) {
+      return;
+   }
+
+   if(GL_poly_culled(nb_pts, points)) {
+      return;
+   }
+
+   gl_dl_reserve(MIN(maxy, GL_height-1) - MAX(miny, 0) + 1);
+
+   poly_raster(
+      nb_pts, points, 0, 0, GL_width-1, GL_height-1, gl_dl_span, &color
+   );
+}
+
+void GL_rect(int x1, int y1, int x2, int y2, uint16_t color) {
+   if(x2 < x1) {
+      int tmp = x1; x1 = x2; x2 = tmp;
+   }
+   if(y2 < y1) {
+      int tmp = y1; y1 = y2; y2 = tmp;
+   }
+   if(x2 < 0 || y2 < 0 || x1 >= GL_width || y1 >= GL_height) {
+      return;
+   }
+   x1 = MAX(x1, 0);
+   y1 = MAX(y1, 0);
+   x2 = MIN(x2, GL_width-1);
+   y2 = MIN(y2, GL_height-1);
+
+#ifdef FGA
+   if(FGA_mode != GL_MODE_OLED) {
+      FGA_fill_rect(x1, y1, x2, y2, color);
+      return;
+   }
+#endif
+
+   if(GL_width > GL_DL_WIDTH || GL_height > GL_DL_HEIGHT) {
+      GL_fill_rect(x1, y1, x2, y2, color);
+      return;
+   }
+
+   gl_dl_reserve(y2 - y1 + 1);
+
+   for(int y=y1; y<=y2; ++y) {
+      gl_dl_add_span(y, x1, x2, color);
+   }
+}
+
+void GL_end_frame() {
+   gl_dl_draw();
+   gl_dl_reset();
+}
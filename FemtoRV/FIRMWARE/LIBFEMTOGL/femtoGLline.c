@@ -11,6 +11,26 @@
 #define YMIN 0
 #define YMAX (GL_height-1)
 
+/* Pixels x1..x2 (in any order) of row y, no clipping */
+static inline void GL_hline_fast(int x1, int x2, int y, uint16_t color) {
+    int xmin = MIN(x1,x2);
+    int xmax = MAX(x1,x2);
+    GL_write_window(xmin,y,xmax,y);
+    for(int x=xmin; x<=xmax; ++x) {
+	GL_WRITE_DATA_UINT16(color);
+    }
+}
+
+/* Pixels y1..y2 (in any order) of column x, no clipping */
+static inline void GL_vline_fast(int x, int y1, int y2, uint16_t color) {
+    int ymin = MIN(y1,y2);
+    int ymax = MAX(y1,y2);
+    GL_write_window(x,ymin,x,ymax);
+    for(int y=ymin; y<=ymax; ++y) {
+	GL_WRITE_DATA_UINT16(color);
+    }
+}
+
 #define code(x,y) ((x) < XMIN) | (((x) > XMAX)<<1) | (((y) < YMIN)<<2) | (((y) > YMAX)<<3) 
 
 void GL_line(int x1, int y1, int x2, int y2, uint16_t color) {
@@ -69,7 +89,11 @@ void GL_line(int x1, int y1, int x2, int y2, uint16_t color) {
 	}
     }
     
-    /* Bresenham line drawing. */
+    /* 
+     * Bresenham line drawing, by runs: the pixels of the line on the
+     * same row (or column for steep lines) are sent with a single 
+     * window command.
+     */
     dy = y2 - y1;
     sy = 1;
     if(dy < 0) {
@@ -88,27 +112,65 @@ void GL_line(int x1, int y1, int x2, int y2, uint16_t color) {
     y = y1;
     if(dy > dx) {
 	int ex = (dx << 1) - dy;
+	int run_y = y;
 	for(int u=0; u<dy; u++) {
-	    GL_setpixel(x,y,color);
 	    y += sy;
 	    while(ex >= 0)  {
-		GL_setpixel(x,y,color);		
+		GL_vline_fast(x, run_y, y, color);
 		x += sx;
+		run_y = y;
 		ex -= dy << 1;
 	    }
 	    ex += dx << 1;
 	}
+	if(run_y != y) {
+	    GL_vline_fast(x, run_y, y-sy, color);
+	}
     } else {
 	int ey = (dy << 1) - dx;
+	int run_x = x;
 	for(int u=0; u<dx; u++) {
-	    GL_setpixel(x,y,color);
 	    x += sx;
 	    while(ey >= 0) {
-		GL_setpixel(x,y,color);
+		GL_hline_fast(run_x, x, y, color);
 		y += sy;
+		run_x = x;
 		ey -= dx << 1;
 	    }
 	    ey += dy << 1;
 	}
+	if(run_x != x) {
+	    GL_hline_fast(run_x, x-sx, y, color);
+	}
+    }
+}
+
+void GL_hline(int x1, int x2, int y, uint16_t color) {
+    int xmin = MAX(MIN(x1,x2),XMIN);
+    int xmax = MIN(MAX(x1,x2),XMAX);
+    if(y < YMIN || y > YMAX || xmin > xmax) {
+	return;
+    }
+#ifdef FGA   
+    if(FGA_mode != -1) {
+      FGA_fill_rect(xmin, y, xmax, y, color);
+      return;
+    }
+#endif
+    GL_hline_fast(xmin, xmax, y, color);
+}
+
+void GL_vline(int x, int y1, int y2, uint16_t color) {
+    int ymin = MAX(MIN(y1,y2),YMIN);
+    int ymax = MIN(MAX(y1,y2),YMAX);
+    if(x < XMIN || x > XMAX || ymin > ymax) {
+	return;
+    }
+#ifdef FGA   
+    if(FGA_mode != -1) {
+      FGA_fill_rect(x, ymin, x, ymax, color);
+      return;
     }
+#endif
+    GL_vline_fast(x, ymin, ymax, color);
 }
@@ -0,0 +1,117 @@
+#ifndef H__FEMTOGLSIN__H
+#define H__FEMTOGLSIN__H
+
+/*
+ * Fixed point sine and cosine, without libm (and without soft floats on
+ * the cores that do not have the F extension).
+ *
+ * The table (a quarter of a period) is computed by the compiler from a
+ * polynomial, there is no generated file to keep in sync. Configure it
+ * before including this file:
+ *   GL_SIN_BITS:  log2 of the number of entries per quarter of a period,
+ *                 4 to 8 (default 6, that is 256 entries per period).
+ *   GL_SIN_SHIFT: the values are between -(1 << GL_SIN_SHIFT) and
+ *                 1 << GL_SIN_SHIFT (default 14).
+ *
+ * Angles are 16 bits binary angles: 65536 (GL_ANGLE_FULL) is a full
+ * turn, and they wrap around naturally. Between two entries of the table,
+ * the value is linearly interpolated. Angles that are multiples of
+ * GL_ANGLE_FULL >> (GL_SIN_BITS + 2) fall on table entries (for instance,
+ * with GL_SIN_BITS=4, GL_sin(i << 10) is the i-th value of the 64 entries
+ * sintab[] generated by TOOLS/make_sintab.c, rounded instead of truncated).
+ */
+
+#include <stdint.h>
+
+#ifndef GL_SIN_BITS
+#define GL_SIN_BITS 6
+#endif
+
+#ifndef GL_SIN_SHIFT
+#define GL_SIN_SHIFT 14
+#endif
+
+#if GL_SIN_BITS < 4 || GL_SIN_BITS > 8
+#error "GL_SIN_BITS should be between 4 and 8"
+#endif
+
+#define GL_ANGLE_FULL    65536
+#define GL_ANGLE_HALF    32768
+#define GL_ANGLE_QUARTER 16384
+
+#define GL_SIN_ONE  (1 << GL_SIN_SHIFT)
+#define GL_SIN_N    (1 << GL_SIN_BITS)
+
+/* bits of the angle between two entries of the table */
+#define GL_SIN_FRAC_BITS (14 - GL_SIN_BITS)
+
+#if GL_SIN_SHIFT > 14
+typedef int32_t gl_sin_t;
+#else
+typedef int16_t gl_sin_t;
+#endif
+
+/*
+ * sin(x) for x in [0,pi/2] (Horner form of the Taylor series up to x^11,
+ * error below 1e-7), only evaluated by the compiler.
+ */
+#define GL_SIN_X2_(x) ((x)*(x))
+#define GL_SIN_POLY_(x) ((x)*(1.0-GL_SIN_X2_(x)/6.0*(1.0-GL_SIN_X2_(x)/20.0*  \
+        (1.0-GL_SIN_X2_(x)/42.0*(1.0-GL_SIN_X2_(x)/72.0*                      \
+        (1.0-GL_SIN_X2_(x)/110.0))))))
+#define GL_SIN_ENTRY_(i) \
+   (gl_sin_t)(GL_SIN_ONE*GL_SIN_POLY_((double)(i)*(1.5707963267948966/GL_SIN_N))+0.5),
+
+#define GL_SIN_REP1_(i)   GL_SIN_ENTRY_(i)
+#define GL_SIN_REP4_(i)   GL_SIN_REP1_(i)    GL_SIN_REP1_((i)+1)                \
+                          GL_SIN_REP1_((i)+2)  GL_SIN_REP1_((i)+3)
+#define GL_SIN_REP16_(i)  GL_SIN_REP4_(i)    GL_SIN_REP4_((i)+4)                \
+                          GL_SIN_REP4_((i)+8)  GL_SIN_REP4_((i)+12)
+#define GL_SIN_REP32_(i)  GL_SIN_REP16_(i)   GL_SIN_REP16_((i)+16)
+#define GL_SIN_REP64_(i)  GL_SIN_REP16_(i)   GL_SIN_REP16_((i)+16)              \
+                          GL_SIN_REP16_((i)+32) GL_SIN_REP16_((i)+48)
+#define GL_SIN_REP128_(i) GL_SIN_REP64_(i)   GL_SIN_REP64_((i)+64)
+#define GL_SIN_REP256_(i) GL_SIN_REP64_(i)   GL_SIN_REP64_((i)+64)              \
+                          GL_SIN_REP64_((i)+128) GL_SIN_REP64_((i)+192)
+
+/*
+ * GL_SIN_N+2 entries: the one after pi/2 is only read by the
+ * interpolation at exactly pi/2 (multiplied by zero).
+ */
+static const gl_sin_t GL_sintab[GL_SIN_N+2] = {
+#if   GL_SIN_BITS == 4
+   GL_SIN_REP16_(0)
+#elif GL_SIN_BITS == 5
+   GL_SIN_REP32_(0)
+#elif GL_SIN_BITS == 6
+   GL_SIN_REP64_(0)
+#elif GL_SIN_BITS == 7
+   GL_SIN_REP128_(0)
+#else
+   GL_SIN_REP256_(0)
+#endif
+   GL_SIN_ENTRY_(GL_SIN_N)
+   GL_SIN_ENTRY_(GL_SIN_N-1)
+};
+
+/* sin(2*pi*angle/65536) * GL_SIN_ONE */
+static inline int GL_sin(uint32_t angle) {
+   uint32_t a = angle & (GL_ANGLE_QUARTER - 1);
+   if(angle & GL_ANGLE_QUARTER) {
+      a = GL_ANGLE_QUARTER - a;
+   }
+   uint32_t i = a >> GL_SIN_FRAC_BITS;
+   int s = GL_sintab[i];
+#if GL_SIN_FRAC_BITS > 0
+   int frac = a & ((1 << GL_SIN_FRAC_BITS) - 1);
+   s += ((GL_sintab[i+1] - s) * frac + (1 << (GL_SIN_FRAC_BITS-1))) >> GL_SIN_FRAC_BITS;
+#endif
+   return (angle & GL_ANGLE_HALF) ? -s : s;
+}
+
+/* cos(2*pi*angle/65536) * GL_SIN_ONE */
+static inline int GL_cos(uint32_t angle) {
+   return GL_sin(angle + GL_ANGLE_QUARTER);
+}
+
+#endif
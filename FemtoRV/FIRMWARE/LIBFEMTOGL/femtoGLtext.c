@@ -3,40 +3,76 @@
 
 /***********************************************************************/
 
-static void font_func_8x16(int X, int Y, char c) {
-   GL_write_window(X,Y,X+7,Y+15);   
+/* 
+ * Each font has a function that expands a glyph into its pixels 
+ * (for the current GL_fg and GL_bg), sent as a single burst by 
+ * font_draw(), or stored in the glyph cache (see GL_set_glyph_cache()).
+ */
+
+static void font_send(
+   const GLFont* font, int X, int Y, const uint16_t* pixels
+) {
+#ifdef FGA
+   /* FGA modes: packed pixels, written directly to VRAM */
+   if(FGA_mode != GL_MODE_OLED) {
+      FGA_blit(X, Y, font->width, font->height, pixels);
+      return;
+   }
+#endif
+   int nb_pixels = font->width * font->height;
+   GL_write_window(X,Y,X+font->width-1,Y+font->height-1);
+   for(int i=0; i<nb_pixels; ++i) {
+      GL_WRITE_DATA_UINT16(pixels[i]);
+   }
+}
+
+static void font_draw(const GLFont* font, int X, int Y, char c) {
+   uint16_t pixels[GL_GLYPH_MAX_PIXELS];
+   font->expand(c, pixels);
+   font_send(font, X, Y, pixels);
+}
+
+static void font_expand_8x16(char c, uint16_t* pixels) {
    uint16_t* car_ptr = font_8x16 + (int)c * 8;
    for(int row=0; row<16; ++row) {
       for(int col=0; col<8; ++col) {
 	 uint32_t BW = (car_ptr[col] & (1 << row)) ? 255 : 0;
-	 GL_WRITE_DATA_UINT16(BW ? GL_fg : GL_bg);
+	 *(pixels++) = BW ? GL_fg : GL_bg;
       }
    }
 }
 
+static void font_func_8x16(int X, int Y, char c) {
+   font_draw(&Font8x16, X, Y, c);
+}
+
 const GLFont Font8x16 = {
    font_func_8x16,
-   8,16
+   8,16,
+   font_expand_8x16
 };
 
-static void font_func_8x8(int X, int Y, char c) {
-   GL_write_window(X,Y,X+7,Y+7);   
+static void font_expand_8x8(char c, uint16_t* pixels) {
    uint8_t* car_ptr = font_8x8 + (int)c * 8;
    for(int row=0; row<8; ++row) {
       for(int col=0; col<8; ++col) {
 	 uint32_t BW = (car_ptr[col] & (1 << row)) ? 255 : 0;
-	 GL_WRITE_DATA_UINT16(BW ? GL_fg : GL_bg);
+	 *(pixels++) = BW ? GL_fg : GL_bg;
       }
    }
 }
 
+static void font_func_8x8(int X, int Y, char c) {
+   font_draw(&Font8x8, X, Y, c);
+}
+
 const GLFont Font8x8 = {
    font_func_8x8,
-   8,8
+   8,8,
+   font_expand_8x8
 };
 
-static void font_func_5x6(int X, int Y, char c) {
-   GL_write_window(X,Y,X+5,Y+7);
+static void font_expand_5x6(char c, uint16_t* pixels) {
    uint32_t chardata = font_5x6[c - ' '];
    // bit 30 indicates whether character needs to be shifted downwards by
    // two pixels (for instance, for letters 'p','q','g')
@@ -51,17 +87,22 @@ static void font_func_5x6(int X, int Y, char c) {
 	       }
 	       BW = (coldata & (1 << row)) ? 255 : 0;
 	   }
-	   GL_WRITE_DATA_UINT16(BW ? GL_fg : GL_bg);
+	   *(pixels++) = BW ? GL_fg : GL_bg;
        }
    }
 }
 
+static void font_func_5x6(int X, int Y, char c) {
+   font_draw(&Font5x6, X, Y, c);
+}
+
 const GLFont Font5x6 = {
    font_func_5x6,
-   6,8 /* yes, 6x8 for 5x6, some chars have legs */
+   6,8, /* yes, 6x8 for 5x6, some chars have legs */
+   font_expand_5x6
 };
 
-static void font_func_3x5(int X, int Y, char c) {
+static void font_expand_3x5(char c, uint16_t* pixels) {
    // In the pico8 font, small caps and big caps
    // are swapped (I don't know why). TODO: fix
    // the data instead, will be cleaner...
@@ -70,7 +111,6 @@ static void font_func_3x5(int X, int Y, char c) {
    } else if(c >= 'a' && c <= 'z') {
       c = c - 'a' + 'A';
    }
-   GL_write_window(X,Y,X+3,Y+5);
    uint16_t car_data = font_3x5[c - ' '];
    for(int row=0; row<6; ++row) {
       for(int col=0; col<4; ++col) {
@@ -79,14 +119,19 @@ static void font_func_3x5(int X, int Y, char c) {
 	      uint32_t coldata = (car_data >> (5 * col)) & 31;
 	      BW = (coldata & (1 << row)) ? 255 : 0;
 	  }
-          GL_WRITE_DATA_UINT16(BW ? GL_fg : GL_bg);	 
+	  *(pixels++) = BW ? GL_fg : GL_bg;
       }
    }
 }
 
+static void font_func_3x5(int X, int Y, char c) {
+   font_draw(&Font3x5, X, Y, c);
+}
+
 const GLFont Font3x5 = {
    font_func_3x5,
-   4,6 /* yes, 4x6 for 3x5, additional space. */
+   4,6, /* yes, 4x6 for 3x5, additional space. */
+   font_expand_3x5
 };
 
 GLFont* GL_current_font = &Font5x6;
@@ -97,6 +142,27 @@ void GL_set_font(GLFont* font) {
 
 /*****************************************************************************/
 
+static GLGlyph* glyph_cache = 0;
+static int      glyph_cache_size = 0;
+static uint16_t glyph_cache_fg;
+static uint16_t glyph_cache_bg;
+
+static void glyph_cache_invalidate() {
+   for(int i=0; i<glyph_cache_size; ++i) {
+      glyph_cache[i].font = 0;
+   }
+   glyph_cache_fg = GL_fg;
+   glyph_cache_bg = GL_bg;
+}
+
+void GL_set_glyph_cache(GLGlyph* glyphs, int nb_glyphs) {
+   glyph_cache = glyphs;
+   glyph_cache_size = (glyphs == 0) ? 0 : nb_glyphs;
+   glyph_cache_invalidate();
+}
+
+/*****************************************************************************/
+
 static int scrolling = 0; 
 static int cursor_X = 0;
 static int cursor_Y = 0;
@@ -107,6 +173,7 @@ void GL_tty_init(int mode) {
     GL_init(mode);
     GL_clear();
     set_putcharfunc(GL_putchar);
+    set_putsfunc(GL_putchars);
     cursor_X = 0;
     cursor_Y = 0;
     scrolling = 0;
@@ -125,9 +192,17 @@ void GL_tty_goto_xy(int X, int Y) {
  Using SSD1351 'display start line' command, we 
  can scroll the terminal without memorizing the 
  contents anywhere !    
+ Same thing with the FGA ORIGIN register: scrolling
+ only clears the new line, whatever the resolution.
+ The terminal uses a whole number of lines (when the
+ font height does not divide the screen height, the
+ remaining scanlines stay blank), so that the lines
+ and the display start line stay aligned when they 
+ wrap.
  */
 void GL_tty_scroll() {
-    if(cursor_Y >= GL_height) {
+    int page_height = GL_height - (GL_height % GL_current_font->height);
+    if(cursor_Y >= page_height) {
        scrolling = 1;
        cursor_Y = 0;
     }
@@ -138,13 +213,19 @@ void GL_tty_scroll() {
 	 0,cursor_Y,GL_width-1,cursor_Y+GL_current_font->height-1, GL_bg
     );
     display_start_line += GL_current_font->height;
-    if(display_start_line >= GL_height) {
+    if(display_start_line >= page_height) {
        display_start_line = 0;
     }
     oled1(0xA1, display_start_line);
     FGA_SET_REG(FGA_REG_ORIGIN, (display_start_line * FGA_width));
 }
 
+void GL_tty_set_start_line(int Y) {
+    display_start_line = Y;
+    oled1(0xA1, display_start_line);
+    FGA_SET_REG(FGA_REG_ORIGIN, (display_start_line * FGA_width));
+}
+
 int GL_putchar(int c) {
 
    if(last_char_was_CR) {
@@ -174,7 +255,29 @@ int GL_putchar(int c) {
    return c;
 }
 
+int GL_putchars(const char* s, int len) {
+   for(int i=0; i<len; ++i) {
+      GL_putchar(s[i]);
+   }
+   return len;
+}
+
 void GL_putchar_xy(int X, int Y, char c) {
-   GL_current_font->func(X,Y,c);
+   const GLFont* font = GL_current_font;
+   if(glyph_cache_size == 0) {
+      font->func(X,Y,c);
+      return;
+   }
+   /* GL_fg and GL_bg may be changed directly, test them here */
+   if(GL_fg != glyph_cache_fg || GL_bg != glyph_cache_bg) {
+      glyph_cache_invalidate();
+   }
+   GLGlyph* glyph = &glyph_cache[(uint8_t)c % glyph_cache_size];
+   if(glyph->font != font || glyph->c != c) {
+      font->expand(c, glyph->pixels);
+      glyph->font = font;
+      glyph->c = c;
+   }
+   font_send(font, X, Y, glyph->pixels);
 }
 		
@@ -0,0 +1,131 @@
+#include <femtoGL.h>
+
+/***********************************************************************/
+
+/*
+ * The fonts as rectangles of foreground pixels (generated by the font
+ * tools, make_font_xxx -spans, see TOOLS/FONT/font_spans.h for the
+ * format). In the FGA modes, a glyph is one FILLRECT of background and
+ * one per rectangle, queued to the FGA (no bit test, no VRAM write by
+ * the CPU), elsewhere the rectangles are expanded into the pixels of the
+ * glyph, sent as a single burst.
+ *
+ * In a separate file, so that the programs that do not use them do not
+ * link the tables.
+ */
+
+extern const uint16_t font_8x16_spans[];
+extern const uint16_t font_8x8_spans[];
+extern const uint16_t font_5x6_spans[];
+extern const uint16_t font_3x5_spans[];
+
+/* The rectangles of c, 2 bytes each, returns their number */
+static int glyph_spans(const uint16_t* spans, char c, const uint8_t** rects) {
+   int i = (uint8_t)c - spans[0];
+   if(i < 0 || i >= spans[1]) {
+      return 0;
+   }
+   *rects = (const uint8_t*)spans + spans[2+i];
+   return (spans[3+i] - spans[2+i]) / 2;
+}
+
+static void spans_expand(
+   const GLFont* font, const uint16_t* spans, char c, uint16_t* pixels
+) {
+   int nb_pixels = font->width * font->height;
+   for(int i=0; i<nb_pixels; ++i) {
+      pixels[i] = GL_bg;
+   }
+   const uint8_t* rects;
+   int nb = glyph_spans(spans, c, &rects);
+   for(int i=0; i<nb; ++i, rects += 2) {
+      int y = rects[0] & 15, h = (rects[0] >> 4) + 1;
+      int x = rects[1] & 15, w = (rects[1] >> 4) + 1;
+      uint16_t* row = pixels + y * font->width + x;
+      for(int yy=0; yy<h; ++yy, row += font->width) {
+	 for(int xx=0; xx<w; ++xx) {
+	    row[xx] = GL_fg;
+	 }
+      }
+   }
+}
+
+static void spans_draw(
+   const GLFont* font, const uint16_t* spans, int X, int Y, char c
+) {
+#ifdef FGA
+   if(FGA_mode != GL_MODE_OLED && GL_backbuffer == 0) {
+      GL_fill_rect(X, Y, X+font->width-1, Y+font->height-1, GL_bg);
+      const uint8_t* rects;
+      int nb = glyph_spans(spans, c, &rects);
+      for(int i=0; i<nb; ++i, rects += 2) {
+	 int y = Y + (rects[0] & 15), x = X + (rects[1] & 15);
+	 GL_fill_rect(x, y, x + (rects[1] >> 4), y + (rects[0] >> 4), GL_fg);
+      }
+      return;
+   }
+#endif
+   uint16_t pixels[GL_GLYPH_MAX_PIXELS];
+   spans_expand(font, spans, c, pixels);
+   int nb_pixels = font->width * font->height;
+   GL_write_window(X,Y,X+font->width-1,Y+font->height-1);
+   for(int i=0; i<nb_pixels; ++i) {
+      GL_WRITE_DATA_UINT16(pixels[i]);
+   }
+}
+
+static void font_expand_8x16_spans(char c, uint16_t* pixels) {
+   spans_expand(&Font8x16_spans, font_8x16_spans, c, pixels);
+}
+
+static void font_func_8x16_spans(int X, int Y, char c) {
+   spans_draw(&Font8x16_spans, font_8x16_spans, X, Y, c);
+}
+
+const GLFont Font8x16_spans = {
+   font_func_8x16_spans,
+   8,16,
+   font_expand_8x16_spans
+};
+
+static void font_expand_8x8_spans(char c, uint16_t* pixels) {
+   spans_expand(&Font8x8_spans, font_8x8_spans, c, pixels);
+}
+
+static void font_func_8x8_spans(int X, int Y, char c) {
+   spans_draw(&Font8x8_spans, font_8x8_spans, X, Y, c);
+}
+
+const GLFont Font8x8_spans = {
+   font_func_8x8_spans,
+   8,8,
+   font_expand_8x8_spans
+};
+
+static void font_expand_5x6_spans(char c, uint16_t* pixels) {
+   spans_expand(&Font5x6_spans, font_5x6_spans, c, pixels);
+}
+
+static void font_func_5x6_spans(int X, int Y, char c) {
+   spans_draw(&Font5x6_spans, font_5x6_spans, X, Y, c);
+}
+
+const GLFont Font5x6_spans = {
+   font_func_5x6_spans,
+   6,8,
+   font_expand_5x6_spans
+};
+
+static void font_expand_3x5_spans(char c, uint16_t* pixels) {
+   spans_expand(&Font3x5_spans, font_3x5_spans, c, pixels);
+}
+
+static void font_func_3x5_spans(int X, int Y, char c) {
+   spans_draw(&Font3x5_spans, font_3x5_spans, X, Y, c);
+}
+
+const GLFont Font3x5_spans = {
+   font_func_3x5_spans,
+   4,6,
+   font_expand_3x5_spans
+};
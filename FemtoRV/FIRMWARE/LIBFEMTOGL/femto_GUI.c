@@ -1,27 +1,101 @@
 #include <femtoGL.h>
 #include <keyboard.h>
 
-static int show_list(char* title, char** options, int sel) {
-    GL_tty_goto_xy(0,0);
-    GL_clear();
+/*
+ * The list scrolls with the display start line when it takes the whole
+ * OLED screen (then item i stays on text line i % nb_lines).
+ */
+static int list_scrolls(GUIList* list) {
+    return
+       list->first_line == 0 &&
+       GL_width == OLED_WIDTH && GL_height == OLED_HEIGHT &&
+       list->nb_lines * GL_current_font->height == GL_height;
+}
+
+static int list_visible(GUIList* list, int from, int i) {
+    return i >= from && i < from + list->nb_lines;
+}
+
+/* Draws item i (an empty line if there is no such item) on its line */
+static void list_draw(GUIList* list, int i) {
+    const GLFont* font = GL_current_font;
+    char buff[32];
+    int line = list_scrolls(list) ? 
+	          i % list->nb_lines : list->first_line + i - list->from;
+    int x = 0;
+    int y = line * font->height;
+    buff[0] = '\0';
+    if(i < list->nb_items) {
+       list->item(i, buff);
+       buff[31] = '\0';
+    }
+    if(i == list->sel) {
+       GL_set_fg(0,0,0);
+       GL_set_bg(255,255,255);
+    }
+    for(const char* c = buff; *c != '\0' && x + font->width <= GL_width; ++c) {
+       GL_putchar_xy(x, y, *c);
+       x += font->width;
+    }
     GL_set_bg(0,0,0);
-    GL_set_fg(200,200,200);
-    printf("%s\n\n",title);
-    int cur;
-    for(cur=0; options[cur]; ++cur) {
-       if(cur == sel) {
-	  GL_set_fg(0,0,0);
-	  GL_set_bg(255,255,255);
-       } 
-       printf("%s\n",options[cur]);
-       if(cur == sel) {
-	  GL_set_bg(0,0,0);
-	  GL_set_fg(255,255,255);
-       }		
+    GL_set_fg(255,255,255);
+    if(x < GL_width) {
+       GL_fill_rect(x, y, GL_width-1, y+font->height-1, GL_bg);
     }
-    return cur;
 }
 
+void GUI_list_init(
+   GUIList* list, GUIItemFunc item, int nb_items, int first_line, int nb_lines
+) {
+    list->item = item;
+    list->nb_items = nb_items;
+    list->first_line = first_line;
+    list->nb_lines = nb_lines;
+    list->from = -1;
+    list->sel = -1;
+}
+
+void GUI_list_show(GUIList* list, int from, int sel) {
+    int old_from = list->from;
+    int old_sel = list->sel;
+    from = MAX(from, 0);
+    list->from = from;
+    list->sel = sel;
+    
+    /* first time, or no hardware scroll: redraw the whole window */
+    if(old_from != from && (old_from == -1 || !list_scrolls(list))) {
+       if(list_scrolls(list)) {
+	  GL_tty_set_start_line((from % list->nb_lines) * GL_current_font->height);
+       }
+       for(int i=from; i<from+list->nb_lines; ++i) {
+	  list_draw(list, i);
+       }
+       return;
+    }
+
+    /* hardware scroll: draw the items that enter the window */
+    if(old_from != from) {
+       GL_tty_set_start_line((from % list->nb_lines) * GL_current_font->height);
+       for(int i=from; i<from+list->nb_lines; ++i) {
+	  if(!list_visible(list, old_from, i)) {
+	     list_draw(list, i);
+	  }
+       }
+    }
+
+    /* the two items that changed (if they were not drawn above) */
+    if(sel != old_sel) {
+       if(list_visible(list, from, old_sel) && list_visible(list, old_from, old_sel)) {
+	  list_draw(list, old_sel);
+       }
+       if(list_visible(list, from, sel) && list_visible(list, old_from, sel)) {
+	  list_draw(list, sel);
+       }
+    }
+}
+
+/*****************************************************************************/
+
 int GUI_button() {
     int key;
     int result = -1;
@@ -59,10 +133,31 @@ int GUI_button() {
     return result;
 }
 
+static char** prompt_options;
+
+static void prompt_item(int i, char* buff) {
+    const char* option = prompt_options[i];
+    int l;
+    for(l=0; l<31 && option[l] != '\0'; ++l) {
+       buff[l] = option[l];
+    }
+    buff[l] = '\0';
+}
+
 int GUI_prompt(char* title, char** options) {
+   GUIList list;
+   int nb_options = 0;
+   while(options[nb_options]) {
+      ++nb_options;
+   }
    GL_tty_init(GL_MODE_OLED);
+   GL_set_bg(0,0,0);
+   GL_set_fg(200,200,200);
+   printf("%s\n\n",title);
+   prompt_options = options;
    int sel = 0;
-   int nb_options = show_list(title, options, sel);   
+   GUI_list_init(&list, prompt_item, nb_options, 2, nb_options);
+   GUI_list_show(&list, 0, sel);
    for(;;) {
       int btn = GUI_button();
       switch(btn) {
@@ -73,7 +168,7 @@ int GUI_prompt(char* title, char** options) {
       sel = MAX(sel,0);
       sel = MIN(sel,nb_options-1);
       if(btn != 0 && btn != -1) {
-	 show_list(title, options, sel);
+	 GUI_list_show(&list, 0, sel);
       }
    }
 }
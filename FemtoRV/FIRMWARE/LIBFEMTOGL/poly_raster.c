@@ -0,0 +1,295 @@
+#include "poly_raster.h"
+
+#define PR_MIN(x,y) ((x) < (y) ? (x) : (y))
+#define PR_MAX(x,y) ((x) > (y) ? (x) : (y))
+#define PR_SGN(x)   (((x) > (0)) ? 1 : ((x) ? -1 : 0))
+
+/**
+ * \brief Clips a polygon by a half-plane.
+ * \param[in] number of vertices of the input polygon.
+ * \param[in] buff1 vertices of the input polygon.
+ * \param[out] buff2 vertices of the resulting polygon.
+ * \param[in] a , b , c equation of the half-plane: ax + by + c >= 0
+ * \return number of vertices in resulting polygon.
+ */
+static int clip_H(
+    int nb_pts, const int* buff1, int* buff2, int a, int b, int c
+) {
+    if(nb_pts == 0) {
+	return 0;
+    }
+
+    if(nb_pts == 1) {
+	if(a*buff1[0] + b*buff1[1] + c >= 0) {
+	    buff2[0] = buff1[0];
+	    buff2[1] = buff1[1];
+	    return 1;
+	} else {
+	    return 0;
+	}
+    }
+
+    int nb_result = 0;
+    int prev_x = buff1[2*(nb_pts-1)];
+    int prev_y = buff1[2*(nb_pts-1)+1];
+    int prev_status = PR_SGN(a*prev_x + b*prev_y +c);
+
+    for(int i=0; i<nb_pts; ++i) {
+	int x = buff1[2*i];
+	int y = buff1[2*i+1];
+	int status = PR_SGN(a*x + b*y + c);
+	if(status != prev_status && status != 0 && prev_status != 0) {
+
+	    /*
+	     * Remember, femtorv32 does not always have hardware mul,
+	     * so we replace the following code with two switches
+	     * (a and b take values in -1,0,1, no need to mul).
+	     * int t_num   = -a*prev_x-b*prev_y-c;
+	     * int t_denom = a*(x - prev_x) + b*(y - prev_y);
+	     */
+
+	    int t_num = -c;
+	    int t_denom = 0;
+
+	    switch(a) {
+	    case -1:
+		t_num += prev_x;
+		t_denom -= (x - prev_x);
+		break;
+	    case  1:
+		t_num -= prev_x;
+		t_denom += (x - prev_x);
+		break;
+	    }
+
+	    switch(b) {
+	    case -1:
+		t_num += prev_y;
+		t_denom -= (y - prev_y);
+		break;
+	    case  1:
+		t_num -= prev_y;
+		t_denom += (y - prev_y);
+		break;
+	    }
+
+	    int Ix = prev_x + t_num * (x - prev_x) / t_denom;
+	    int Iy = prev_y + t_num * (y - prev_y) / t_denom;
+	    buff2[2*nb_result]   = Ix;
+	    buff2[2*nb_result+1] = Iy;
+	    ++nb_result;
+	}
+	if(status >= 0) {
+	    buff2[2*nb_result]   = x;
+	    buff2[2*nb_result+1] = y;
+	    ++nb_result;
+	}
+	prev_x = x;
+	prev_y = y;
+	prev_status = status;
+    }
+
+    return nb_result;
+}
+
+/*
+ * One of the two chains of edges that go down from the top vertex,
+ * walking the vertices forward (dir = 1) or backward (dir = -1).
+ */
+typedef struct {
+    const int* points;
+    int nb_pts;
+    int dir;
+    int i2;        /* index of the last vertex of the current edge */
+    int left;      /* number of edges not visited yet */
+    int y1, y2;    /* first and last scanline of the current edge */
+    int x;         /* 16.16 x at the current scanline */
+    int dxdy;      /* 16.16 x increment per scanline */
+} PolyChain;
+
+static inline int poly_chain_next(const PolyChain* c, int i) {
+    i += c->dir;
+    if(i < 0) {
+	i = c->nb_pts-1;
+    } else if(i == c->nb_pts) {
+	i = 0;
+    }
+    return i;
+}
+
+static void poly_chain_init(
+    PolyChain* c, const int* points, int nb_pts, int top, int dir
+) {
+    c->points = points;
+    c->nb_pts = nb_pts;
+    c->dir = dir;
+    c->i2 = top;
+    c->left = nb_pts;
+    c->y1 = points[2*top+1];
+    c->y2 = c->y1;  /* flat: the first seek loads the first edge */
+    c->x = 0;
+    c->dxdy = 0;
+}
+
+/**
+ * \brief Moves a chain to the edge that covers scanline y.
+ * \details Flat edges are skipped (their extent is taken by
+ *  poly_chain_flat()). Computes x at y when a new edge is loaded,
+ *  else x was stepped by the previous scanline.
+ * \return 0 if the chain ends above y (goes up, or has no edge left)
+ */
+static int poly_chain_seek(PolyChain* c, int y) {
+    if(y <= c->y2 && c->y1 != c->y2) {
+	return 1;
+    }
+    int i1;
+    do {
+	if(c->left == 0) {
+	    return 0;
+	}
+	--c->left;
+	i1 = c->i2;
+	c->i2 = poly_chain_next(c, i1);
+	c->y1 = c->points[2*i1+1];
+	c->y2 = c->points[2*c->i2+1];
+	if(c->y2 < c->y1) {
+	    return 0;
+	}
+    } while(y > c->y2 || c->y1 == c->y2);
+    int x1 = c->points[2*i1];
+    int x2 = c->points[2*c->i2];
+    c->dxdy = ((x2 - x1) << 16) / (c->y2 - c->y1);
+    c->x = (x1 << 16) + 0x8000 + c->dxdy * (y - c->y1);
+    return 1;
+}
+
+/**
+ * \brief Extends [*xl,*xr] with the flat edges that follow the current
+ *  edge of a chain, if it ends at scanline y.
+ */
+static void poly_chain_flat(const PolyChain* c, int y, int* xl, int* xr) {
+    if(y != c->y2) {
+	return;
+    }
+    int i = c->i2;
+    for(int left = c->left; left > 0; --left) {
+	i = poly_chain_next(c, i);
+	if(c->points[2*i+1] != y) {
+	    return;
+	}
+	int x = c->points[2*i];
+	*xl = PR_MIN(*xl, x);
+	*xr = PR_MAX(*xr, x);
+    }
+}
+
+int poly_raster(
+    int nb_pts, const int* points,
+    int xmin, int ymin, int xmax, int ymax,
+    PolySpanFunc span, void* data
+) {
+    int buff1[2*POLY_RASTER_MAX_PTS];
+    int buff2[2*POLY_RASTER_MAX_PTS];
+
+    if(nb_pts == 0) {
+	return 0;
+    }
+
+    int minx = points[0], maxx = points[0];
+    int miny = points[1], maxy = points[1];
+    for(int i=1; i<nb_pts; ++i) {
+	minx = PR_MIN(minx, points[2*i]);
+	maxx = PR_MAX(maxx, points[2*i]);
+	miny = PR_MIN(miny, points[2*i+1]);
+	maxy = PR_MAX(maxy, points[2*i+1]);
+    }
+
+    if(maxx < xmin || maxy < ymin || minx > xmax || miny > ymax) {
+	return 0;
+    }
+
+    /*
+     * Polygons that exceed the guard band are clipped to it (keeps the
+     * 16.16 DDA in range), the other ones are only clipped by the spans.
+     */
+    int gx1 = xmin - POLY_GUARD_BAND;
+    int gy1 = ymin - POLY_GUARD_BAND;
+    int gx2 = xmax + POLY_GUARD_BAND;
+    int gy2 = ymax + POLY_GUARD_BAND;
+    if(minx < gx1 || miny < gy1 || maxx > gx2 || maxy > gy2) {
+	nb_pts = clip_H(nb_pts, points, buff1,  1, 0, -gx1);
+	nb_pts = clip_H(nb_pts, buff1,  buff2, -1, 0,  gx2);
+	nb_pts = clip_H(nb_pts, buff2,  buff1,  0, 1, -gy1);
+	nb_pts = clip_H(nb_pts, buff1,  buff2,  0,-1,  gy2);
+	if(nb_pts == 0) {
+	    return 0;
+	}
+	points = buff2;
+	miny = points[1];
+	maxy = points[1];
+	for(int i=1; i<nb_pts; ++i) {
+	    miny = PR_MIN(miny, points[2*i+1]);
+	    maxy = PR_MAX(maxy, points[2*i+1]);
+	}
+    }
+
+    /* Flat polygon: the chains have no edge to walk */
+    if(miny == maxy) {
+	minx = PR_MAX(minx, xmin);
+	maxx = PR_MIN(maxx, xmax);
+	if(minx <= maxx) {
+	    span(miny, minx, maxx, data);
+	}
+	return 1;
+    }
+
+    int top = 0;
+    for(int i=1; i<nb_pts; ++i) {
+	if(points[2*i+1] < points[2*top+1]) {
+	    top = i;
+	}
+    }
+
+    PolyChain a, b;
+    poly_chain_init(&a, points, nb_pts, top,  1);
+    poly_chain_init(&b, points, nb_pts, top, -1);
+
+    int y1 = PR_MAX(miny, ymin);
+    int y2 = PR_MIN(maxy, ymax);
+    for(int y=y1; y<=y2; ++y) {
+	if(!poly_chain_seek(&a, y) || !poly_chain_seek(&b, y)) {
+	    break;
+	}
+	int xl = a.x >> 16;
+	int xr = b.x >> 16;
+	if(xl > xr) {
+	    int tmp = xl; xl = xr; xr = tmp;
+	}
+	poly_chain_flat(&a, y, &xl, &xr);
+	poly_chain_flat(&b, y, &xl, &xr);
+	xl = PR_MAX(xl, xmin);
+	xr = PR_MIN(xr, xmax);
+	if(xl <= xr) {
+	    span(y, xl, xr, data);
+	}
+	a.x += a.dxdy;
+	b.x += b.dxdy;
+    }
+    return 1;
+}
+
+int poly_orientation(int nb_pts, const int* points) {
+    int clockwise = 0;
+    for(int i1=0; i1<nb_pts; ++i1) {
+	int i2=(i1==nb_pts-1) ? 0 : i1+1;
+	int i3=(i2==nb_pts-1) ? 0 : i2+1;
+	int x1 = points[2*i1];
+	int y1 = points[2*i1+1];
+	int dx1 = points[2*i2]   - x1;
+	int dy1 = points[2*i2+1] - y1;
+	int dx2 = points[2*i3]   - x1;
+	int dy2 = points[2*i3+1] - y1;
+	clockwise += dx1 * dy2 - dx2 * dy1;
+    }
+    return clockwise;
+}
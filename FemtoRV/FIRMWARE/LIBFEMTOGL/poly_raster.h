@@ -0,0 +1,51 @@
+#ifndef H__POLY_RASTER__H
+#define H__POLY_RASTER__H
+
+/*
+ * Polygon rasterizer shared by femtoGL (OLED and FGA, femtoGLfill_poly.c,
+ * FGA.c) and the LiteX framebuffer (LiteX/software/Libs/lite_fb.c). It does
+ * not depend on the target: the spans are sent to a callback, that fills
+ * them the way the target does (OLED window, FGA FILLRECT, LiteX blitter).
+ *
+ * - edges are walked with a 16.16 fixed point DDA (one division per edge,
+ *   no per-scanline table, so that there is no limit on the height)
+ * - guard band: the spans are clipped to the clip rectangle, and only the
+ *   polygons that exceed the clip rectangle by more than POLY_GUARD_BAND
+ *   pixels are clipped (Sutherland-Hodgman), the others are rasterized as is
+ * - convex polygons (more generally, polygons that have a single span per
+ *   scanline), either orientation, vertices in pixel coordinates
+ */
+
+#ifndef POLY_GUARD_BAND
+#define POLY_GUARD_BAND 1024
+#endif
+
+/* Max number of vertices of a polygon (+ 4 that clipping may add) */
+#define POLY_RASTER_MAX_PTS 20
+
+/* Called for each span x1..x2 (included, x1 <= x2, clipped) of scanline y */
+typedef void (*PolySpanFunc)(int y, int x1, int x2, void* data);
+
+/*
+ * \brief Rasterizes a polygon.
+ * \param[in] nb_pts number of vertices, at most POLY_RASTER_MAX_PTS - 4
+ * \param[in] points the 2*nb_pts coordinates of the vertices
+ * \param[in] xmin , ymin , xmax , ymax the clip rectangle (included)
+ * \param[in] span called for each span, in scanline order
+ * \param[in] data passed to span
+ * \return 0 if the polygon is outside the clip rectangle, 1 otherwise
+ */
+int poly_raster(
+    int nb_pts, const int* points,
+    int xmin, int ymin, int xmax, int ymax,
+    PolySpanFunc span, void* data
+);
+
+/*
+ * \brief Orientation of a polygon, for culling.
+ * \return > 0 if the polygon is clockwise on the screen (y axis pointing
+ *   down), < 0 if it is counterclockwise, 0 if it is degenerate.
+ */
+int poly_orientation(int nb_pts, const int* points);
+
+#endif
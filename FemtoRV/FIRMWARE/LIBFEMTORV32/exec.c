@@ -7,7 +7,14 @@ static int exec_elf(const char* filename, int argc, char** argv);
 
 int exec(const char* filename, int argc, char** argv) {
   int l = strlen(filename);
-  if(l > 4 && !strcmp(filename + l - 4, ".elf")) {
+  if(
+     l > 4 &&
+     (
+       !strcmp(filename + l - 4, ".elf") ||
+       !strcmp(filename + l - 4, ".elz") ||
+       !strcmp(filename + l - 4, ".fxe")
+     )
+  ) {
     return exec_elf(filename, argc, argv);
   }
   return 0;
@@ -15,7 +22,7 @@ int exec(const char* filename, int argc, char** argv) {
 
 /************************************************************************/
 
-typedef void (*funptr)(int argc, char** argv);
+typedef int (*funptr)(int argc, char** argv, uint32_t magic);
 
 int exec_elf(const char* filename, int argc, char** argv) {
   Elf32Info info;
@@ -27,18 +34,21 @@ int exec_elf(const char* filename, int argc, char** argv) {
     return errcode;
   }
 
+  return exec_loaded(&info, argc, argv);
+}
+
+int exec_loaded(const Elf32Info* info, int argc, char** argv) {
   LEDS(0);
   
-  // Now we can transfer execution to beginning of text segment.
-  // It where main() resides, so we can pass it argc and argv.
-  ((funptr)(info.text_address))(argc, argv);
-
-  // Note: there is also elf_header.e_entry = 0x101cc,
-  //             whereas text segment start = 0x10074
-  // Calling elf_header.e_entry does not work. 
-  // It is probably where crt0.S is implanted. It would be better
-  // to call it (but it did not work when I tried). There are
-  // complicated things to setup for argc/argv/envp to work.
+  // Now we can transfer execution to the entry point (_start in
+  // CRT/crt0_baremetal.S). With FEMTOS_EXEC_MAGIC in a2, _start keeps
+  // our stack, calls main(argc,argv) and returns here (instead of
+  // resetting sp to the end of RAM and calling exit()).
+  // ELF files without an entry point start at the text segment, where
+  // main() is supposed to reside.
+  ((funptr)(info->entry_address != 0 ? info->entry_address : info->text_address))(
+      argc, argv, FEMTOS_EXEC_MAGIC
+  );
   
   return 0;
 }
@@ -37,6 +37,7 @@
 #include "fat_write.h"
 #include "fat_string.h"
 #include "fat_misc.h"
+#include "fat_cache.h"
 
 //-----------------------------------------------------------------------------
 // fatfs_init: Load FAT Parameters
@@ -55,7 +56,11 @@ int fatfs_init(struct fatfs *fs)
     fs->currentsector.address = FAT32_INVALID_CLUSTER;
     fs->currentsector.dirty = 0;
 
-    fs->next_free_cluster = 0; // Invalid
+    fatfs_direntry_cache_init(fs);
+
+    fs->next_free_cluster = FSINFO_UNKNOWN;
+    fs->free_cluster_count = FSINFO_UNKNOWN;
+    fs->fs_info_dirty = 0;
 
     fatfs_fat_init(fs);
 
@@ -166,6 +171,7 @@ int fatfs_init(struct fatfs *fs)
     if (fs->sectors_per_cluster != 0)
     {
         count_of_clusters = data_sectors / fs->sectors_per_cluster;
+        fs->total_clusters = count_of_clusters;
 
         if(count_of_clusters < 4085)
             // Volume is FAT12
@@ -183,6 +189,9 @@ int fatfs_init(struct fatfs *fs)
         {
             // Volume is FAT32
             fs->fat_type = FAT_TYPE_32;
+
+            // Free space hints of the FSINFO sector
+            fatfs_read_fs_info(fs);
             return FAT_INIT_OK;
         }
     }
@@ -417,6 +426,9 @@ uint32 fatfs_get_file_entry(struct fatfs *fs, uint32 Cluster, char *name_to_find
     int dotRequired = 0;
     struct fat_dir_entry *directoryEntry;
 
+    if (fatfs_direntry_cache_get(fs, Cluster, name_to_find, sfEntry))
+        return 1;
+
     fatfs_lfn_cache_init(&lfn, 1);
 
     // Main cluster following loop
@@ -452,6 +464,7 @@ uint32 fatfs_get_file_entry(struct fatfs *fs, uint32 Cluster, char *name_to_find
                     if (fatfs_compare_names(long_filename, name_to_find))
                     {
                         memcpy(sfEntry,directoryEntry,sizeof(struct fat_dir_entry));
+                        fatfs_direntry_cache_set(fs, Cluster, name_to_find, sfEntry);
                         return 1;
                     }
 
@@ -493,6 +506,7 @@ uint32 fatfs_get_file_entry(struct fatfs *fs, uint32 Cluster, char *name_to_find
                     if (fatfs_compare_names(short_filename, name_to_find))
                     {
                         memcpy(sfEntry,directoryEntry,sizeof(struct fat_dir_entry));
+                        fatfs_direntry_cache_set(fs, Cluster, name_to_find, sfEntry);
                         return 1;
                     }
 
@@ -625,6 +639,8 @@ int fatfs_update_file_length(struct fatfs *fs, uint32 Cluster, char *shortname,
     if (!fs->disk_io.write_media)
         return 0;
 
+    fatfs_direntry_cache_invalidate(fs, Cluster);
+
     // Main cluster following loop
     while (1)
     {
@@ -695,6 +711,8 @@ int fatfs_mark_file_deleted(struct fatfs *fs, uint32 Cluster, char *shortname)
     if (!fs->disk_io.write_media)
         return 0;
 
+    fatfs_direntry_cache_invalidate(fs, Cluster);
+
     // Main cluster following loop
     while (1)
     {
@@ -48,6 +48,16 @@ struct fat_buffer
     struct fat_buffer       *next;
 };
 
+// Directory entry cache (see fat_cache.c)
+struct fat_direntry_cache
+{
+    uint32                  cluster;    // first cluster of the directory
+    uint32                  hash;       // of name
+    uint32                  age;        // last use, 0 if not used
+    char                    name[FAT_DIRENTRY_CACHE_NAME];
+    struct fat_dir_entry    entry;
+};
+
 typedef enum eFatType
 {
     FAT_TYPE_16,
@@ -66,7 +76,10 @@ struct fatfs
     uint16                  fs_info_sector;
     uint32                  lba_begin;
     uint32                  fat_sectors;
+    uint32                  total_clusters;
     uint32                  next_free_cluster;
+    uint32                  free_cluster_count;
+    int                     fs_info_dirty;
     uint16                  root_entry_count;
     uint16                  reserved_sectors;
     uint8                   num_of_fats;
@@ -85,6 +98,12 @@ struct fatfs
     // FAT Buffer
     struct fat_buffer        *fat_buffer_head;
     struct fat_buffer        fat_buffers[FAT_BUFFERS];
+
+#ifdef FAT_DIRENTRY_CACHE_ENTRIES
+    // Directory entry cache
+    struct fat_direntry_cache direntry_cache[FAT_DIRENTRY_CACHE_ENTRIES];
+    uint32                  direntry_cache_age;
+#endif
 };
 
 struct fs_dir_list_status
@@ -1,91 +1,239 @@
-//-----------------------------------------------------------------------------
-//-----------------------------------------------------------------------------
-//                            FAT16/32 File IO Library
-//                                    V2.6
-//                              Ultra-Embedded.com
-//                            Copyright 2003 - 2012
-//
-//                         Email: admin@ultra-embedded.com
-//
-//                                License: GPL
-//   If you would like a version with a more permissive license for use in
-//   closed source commercial applications please contact me for details.
-//-----------------------------------------------------------------------------
-//
-// This file is part of FAT File IO Library.
-//
-// FAT File IO Library is free software; you can redistribute it and/or modify
-// it under the terms of the GNU General Public License as published by
-// the Free Software Foundation; either version 2 of the License, or
-// (at your option) any later version.
-//
-// FAT File IO Library is distributed in the hope that it will be useful,
-// but WITHOUT ANY WARRANTY; without even the implied warranty of
-// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
-// GNU General Public License for more details.
-//
-// You should have received a copy of the GNU General Public License
-// along with FAT File IO Library; if not, write to the Free Software
-// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
-//-----------------------------------------------------------------------------
-//-----------------------------------------------------------------------------
-//#include <string.h>
-#include "fat_cache.h"
-
-// Per file cluster chain caching used to improve performance.
-// This does not have to be enabled for architectures with low
-// memory space.
-
-//-----------------------------------------------------------------------------
-// fatfs_cache_init:
-//-----------------------------------------------------------------------------
-int fatfs_cache_init(struct fatfs *fs, FL_FILE *file)
-{
-#ifdef FAT_CLUSTER_CACHE_ENTRIES
-    int i;
-
-    for (i=0;i<FAT_CLUSTER_CACHE_ENTRIES;i++)
-    {
-        file->cluster_cache_idx[i] = 0xFFFFFFFF; // Not used
-        file->cluster_cache_data[i] = 0;
-    }
-#endif
-
-    return 1;
-}
-//-----------------------------------------------------------------------------
-// fatfs_cache_get_next_cluster:
-//-----------------------------------------------------------------------------
-int fatfs_cache_get_next_cluster(struct fatfs *fs, FL_FILE *file, uint32 clusterIdx, uint32 *pNextCluster)
-{
-#ifdef FAT_CLUSTER_CACHE_ENTRIES
-    uint32 slot = clusterIdx % FAT_CLUSTER_CACHE_ENTRIES;
-
-    if (file->cluster_cache_idx[slot] == clusterIdx)
-    {
-        *pNextCluster = file->cluster_cache_data[slot];
-        return 1;
-    }
-#endif
-
-    return 0;
-}
-//-----------------------------------------------------------------------------
-// fatfs_cache_set_next_cluster:
-//-----------------------------------------------------------------------------
-int fatfs_cache_set_next_cluster(struct fatfs *fs, FL_FILE *file, uint32 clusterIdx, uint32 nextCluster)
-{
-#ifdef FAT_CLUSTER_CACHE_ENTRIES
-    uint32 slot = clusterIdx % FAT_CLUSTER_CACHE_ENTRIES;
-
-    if (file->cluster_cache_idx[slot] == clusterIdx)
-        file->cluster_cache_data[slot] = nextCluster;
-    else
-    {
-        file->cluster_cache_idx[slot] = clusterIdx;
-        file->cluster_cache_data[slot] = nextCluster;
-    }
-#endif
-
-    return 1;
-}
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//                            FAT16/32 File IO Library
+//                                    V2.6
+//                              Ultra-Embedded.com
+//                            Copyright 2003 - 2012
+//
+//                         Email: admin@ultra-embedded.com
+//
+//                                License: GPL
+//   If you would like a version with a more permissive license for use in
+//   closed source commercial applications please contact me for details.
+//-----------------------------------------------------------------------------
+//
+// This file is part of FAT File IO Library.
+//
+// FAT File IO Library is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// FAT File IO Library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with FAT File IO Library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+//#include <string.h>
+#include "fat_cache.h"
+
+// Per file cluster chain caching used to improve performance.
+// This does not have to be enabled for architectures with low
+// memory space.
+
+struct fat_cache_stats fatfs_cache_stats;
+
+//-----------------------------------------------------------------------------
+// fatfs_cache_init:
+//-----------------------------------------------------------------------------
+int fatfs_cache_init(struct fatfs *fs, FL_FILE *file)
+{
+#ifdef FAT_CLUSTER_CACHE_ENTRIES
+    int i;
+
+    for (i=0;i<FAT_CLUSTER_CACHE_ENTRIES;i++)
+    {
+        file->cluster_cache_idx[i] = 0xFFFFFFFF; // Not used
+        file->cluster_cache_data[i] = 0;
+    }
+#endif
+
+#if FAT_FILE_BUFFER_SECTORS > 1
+    file->buffer_address = 0xFFFFFFFF;
+    file->buffer_count = 0;
+    file->buffer_dirty = 0;
+#endif
+
+    return 1;
+}
+//-----------------------------------------------------------------------------
+// fatfs_cache_get_next_cluster:
+//-----------------------------------------------------------------------------
+int fatfs_cache_get_next_cluster(struct fatfs *fs, FL_FILE *file, uint32 clusterIdx, uint32 *pNextCluster)
+{
+#ifdef FAT_CLUSTER_CACHE_ENTRIES
+    uint32 slot = clusterIdx % FAT_CLUSTER_CACHE_ENTRIES;
+
+    if (file->cluster_cache_idx[slot] == clusterIdx)
+    {
+        *pNextCluster = file->cluster_cache_data[slot];
+        fatfs_cache_stats.cluster_hits++;
+        return 1;
+    }
+#endif
+
+    fatfs_cache_stats.cluster_misses++;
+    return 0;
+}
+//-----------------------------------------------------------------------------
+// fatfs_cache_set_next_cluster:
+//-----------------------------------------------------------------------------
+int fatfs_cache_set_next_cluster(struct fatfs *fs, FL_FILE *file, uint32 clusterIdx, uint32 nextCluster)
+{
+#ifdef FAT_CLUSTER_CACHE_ENTRIES
+    uint32 slot = clusterIdx % FAT_CLUSTER_CACHE_ENTRIES;
+
+    // Do not cache the end of the chain (it changes when the file grows)
+    if (nextCluster == FAT32_LAST_CLUSTER)
+        return 1;
+
+    if (file->cluster_cache_idx[slot] == clusterIdx)
+        file->cluster_cache_data[slot] = nextCluster;
+    else
+    {
+        file->cluster_cache_idx[slot] = clusterIdx;
+        file->cluster_cache_data[slot] = nextCluster;
+    }
+#endif
+
+    return 1;
+}
+//-----------------------------------------------------------------------------
+// fatfs_direntry_cache_hash: Hash of a name, 0 if it is too long to be cached
+//-----------------------------------------------------------------------------
+#ifdef FAT_DIRENTRY_CACHE_ENTRIES
+static uint32 fatfs_direntry_cache_hash(const char *name)
+{
+    uint32 hash = 2166136261u; // FNV-1a
+    int len = 0;
+
+    while (*name)
+    {
+        if (++len >= FAT_DIRENTRY_CACHE_NAME)
+            return 0;
+        hash = (hash ^ (uint8)*name++) * 16777619u;
+    }
+
+    return hash ? hash : 1;
+}
+#endif
+//-----------------------------------------------------------------------------
+// fatfs_direntry_cache_init: Forget all the directory entries
+//-----------------------------------------------------------------------------
+void fatfs_direntry_cache_init(struct fatfs *fs)
+{
+#ifdef FAT_DIRENTRY_CACHE_ENTRIES
+    int i;
+
+    for (i=0;i<FAT_DIRENTRY_CACHE_ENTRIES;i++)
+        fs->direntry_cache[i].age = 0;
+    fs->direntry_cache_age = 0;
+#endif
+}
+//-----------------------------------------------------------------------------
+// fatfs_direntry_cache_get: Entry of name in the directory starting at
+// dirCluster, if it is in the cache
+//-----------------------------------------------------------------------------
+int fatfs_direntry_cache_get(struct fatfs *fs, uint32 dirCluster, const char *name, struct fat_dir_entry *sfEntry)
+{
+#ifdef FAT_DIRENTRY_CACHE_ENTRIES
+    uint32 hash = fatfs_direntry_cache_hash(name);
+    int i;
+
+    if (hash)
+    {
+        for (i=0;i<FAT_DIRENTRY_CACHE_ENTRIES;i++)
+        {
+            struct fat_direntry_cache *pcur = &fs->direntry_cache[i];
+
+            if (pcur->age && pcur->hash == hash && pcur->cluster == dirCluster && !strcmp(pcur->name, name))
+            {
+                pcur->age = ++fs->direntry_cache_age;
+                memcpy(sfEntry, &pcur->entry, sizeof(struct fat_dir_entry));
+                fatfs_cache_stats.direntry_hits++;
+                return 1;
+            }
+        }
+    }
+#endif
+
+    fatfs_cache_stats.direntry_misses++;
+    return 0;
+}
+//-----------------------------------------------------------------------------
+// fatfs_direntry_cache_set: Keep the entry found for name, in place of the
+// least recently used one
+//-----------------------------------------------------------------------------
+void fatfs_direntry_cache_set(struct fatfs *fs, uint32 dirCluster, const char *name, const struct fat_dir_entry *sfEntry)
+{
+#ifdef FAT_DIRENTRY_CACHE_ENTRIES
+    uint32 hash = fatfs_direntry_cache_hash(name);
+    struct fat_direntry_cache *pcur = &fs->direntry_cache[0];
+    int i;
+
+    if (!hash)
+        return;
+
+    for (i=1;i<FAT_DIRENTRY_CACHE_ENTRIES;i++)
+        if (fs->direntry_cache[i].age < pcur->age)
+            pcur = &fs->direntry_cache[i];
+
+    pcur->cluster = dirCluster;
+    pcur->hash = hash;
+    pcur->age = ++fs->direntry_cache_age;
+    strcpy(pcur->name, name);
+    memcpy(&pcur->entry, sfEntry, sizeof(struct fat_dir_entry));
+#endif
+}
+//-----------------------------------------------------------------------------
+// fatfs_direntry_cache_invalidate: Forget the entries of the directory
+// starting at dirCluster (to be called when it is written)
+//-----------------------------------------------------------------------------
+void fatfs_direntry_cache_invalidate(struct fatfs *fs, uint32 dirCluster)
+{
+#ifdef FAT_DIRENTRY_CACHE_ENTRIES
+    int i;
+
+    for (i=0;i<FAT_DIRENTRY_CACHE_ENTRIES;i++)
+        if (fs->direntry_cache[i].cluster == dirCluster)
+            fs->direntry_cache[i].age = 0;
+#endif
+}
+//-----------------------------------------------------------------------------
+// fatfs_cache_reset_stats:
+//-----------------------------------------------------------------------------
+void fatfs_cache_reset_stats(void)
+{
+    memset(&fatfs_cache_stats, 0, sizeof(fatfs_cache_stats));
+}
+//-----------------------------------------------------------------------------
+// fatfs_cache_print_stats:
+//-----------------------------------------------------------------------------
+void fatfs_cache_print_stats(void)
+{
+    FAT_PRINTF(("fat_cache: %d FAT buffer(s) x %d sector(s), %d cluster cache entries, %d file buffer(s) x %d sector(s), %d directory entries\r\n",
+                FAT_BUFFERS, FAT_BUFFER_SECTORS,
+#ifdef FAT_CLUSTER_CACHE_ENTRIES
+                FAT_CLUSTER_CACHE_ENTRIES,
+#else
+                0,
+#endif
+                FAT_FILE_BUFFER_SECTORS > 1 ? FAT_FILE_BUFFERS : 0, FAT_FILE_BUFFER_SECTORS,
+#ifdef FAT_DIRENTRY_CACHE_ENTRIES
+                FAT_DIRENTRY_CACHE_ENTRIES
+#else
+                0
+#endif
+                ));
+    FAT_PRINTF(("  cluster chain: %d hits, %d misses\r\n", fatfs_cache_stats.cluster_hits, fatfs_cache_stats.cluster_misses));
+    FAT_PRINTF(("  FAT sectors:   %d hits, %d misses\r\n", fatfs_cache_stats.fat_hits, fatfs_cache_stats.fat_misses));
+    FAT_PRINTF(("  read-ahead:    %d hits, %d misses\r\n", fatfs_cache_stats.readahead_hits, fatfs_cache_stats.readahead_misses));
+    FAT_PRINTF(("  file data:     %d reads, %d sectors\r\n", fatfs_cache_stats.data_reads, fatfs_cache_stats.data_sectors));
+    FAT_PRINTF(("                 %d writes, %d sectors\r\n", fatfs_cache_stats.data_writes, fatfs_cache_stats.data_write_sectors));
+    FAT_PRINTF(("  directories:   %d hits, %d misses\r\n", fatfs_cache_stats.direntry_hits, fatfs_cache_stats.direntry_misses));
+}
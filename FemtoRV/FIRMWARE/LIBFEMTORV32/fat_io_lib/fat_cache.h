@@ -10,4 +10,33 @@ int fatfs_cache_init(struct fatfs *fs, FL_FILE *file);
 int fatfs_cache_get_next_cluster(struct fatfs *fs, FL_FILE *file, uint32 clusterIdx, uint32 *pNextCluster);
 int fatfs_cache_set_next_cluster(struct fatfs *fs, FL_FILE *file, uint32 clusterIdx, uint32 nextCluster);
 
+void fatfs_direntry_cache_init(struct fatfs *fs);
+int  fatfs_direntry_cache_get(struct fatfs *fs, uint32 dirCluster, const char *name, struct fat_dir_entry *sfEntry);
+void fatfs_direntry_cache_set(struct fatfs *fs, uint32 dirCluster, const char *name, const struct fat_dir_entry *sfEntry);
+void fatfs_direntry_cache_invalidate(struct fatfs *fs, uint32 dirCluster);
+
+//-----------------------------------------------------------------------------
+// Statistics (to tune the cache sizes in fat_opts.h)
+//-----------------------------------------------------------------------------
+struct fat_cache_stats
+{
+    uint32 cluster_hits;      // cluster chain cache
+    uint32 cluster_misses;
+    uint32 fat_hits;          // FAT sector buffers
+    uint32 fat_misses;
+    uint32 readahead_hits;    // file read-ahead buffer
+    uint32 readahead_misses;
+    uint32 data_reads;        // file data reads from the media...
+    uint32 data_sectors;      // ...and number of sectors read
+    uint32 data_writes;       // file data writes to the media...
+    uint32 data_write_sectors;// ...and number of sectors written
+    uint32 direntry_hits;     // directory entry cache
+    uint32 direntry_misses;
+};
+
+extern struct fat_cache_stats fatfs_cache_stats;
+
+void fatfs_cache_reset_stats(void);
+void fatfs_cache_print_stats(void);
+
 #endif
@@ -65,6 +65,15 @@
 #define PARTITION1_LBA_BEGIN_LOCATION   454
 #define PARTITION1_SIZE_LOCATION        458
 
+// FSINFO sector
+#define FSINFO_LEADSIG_POSITION         0
+#define FSINFO_LEADSIG_VALUE            0x41615252
+#define FSINFO_STRUCSIG_POSITION        484
+#define FSINFO_STRUCSIG_VALUE           0x61417272
+#define FSINFO_FREE_COUNT_POSITION      488
+#define FSINFO_NEXT_FREE_POSITION       492
+#define FSINFO_UNKNOWN                  0xFFFFFFFF
+
 #define FAT_DIR_ENTRY_SIZE              32
 #define FAT_SFN_SIZE_FULL               11
 #define FAT_SFN_SIZE_PARTIAL            8
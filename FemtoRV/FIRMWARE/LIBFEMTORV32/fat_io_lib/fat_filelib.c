@@ -50,6 +50,11 @@ static int                _filelib_valid = 0;
 static struct fatfs       _fs;
 static struct fat_list    _open_file_list;
 static struct fat_list    _free_file_list;
+#if FAT_FILE_BUFFER_SECTORS > 1
+static uint8              _file_buffers[FAT_FILE_BUFFERS][FAT_SECTOR_SIZE * FAT_FILE_BUFFER_SECTORS];
+static uint8             *_free_file_buffers[FAT_FILE_BUFFERS];
+static int                _free_file_buffer_count;
+#endif
 
 //-----------------------------------------------------------------------------
 // Macros
@@ -65,6 +70,9 @@ static struct fat_list    _free_file_list;
 // Local Functions
 //-----------------------------------------------------------------------------
 static void                _fl_init();
+#if FATFS_INC_WRITE_SUPPORT && FAT_FILE_BUFFER_SECTORS > 1
+static int                 _flush_write_behind(FL_FILE* file);
+#endif
 
 //-----------------------------------------------------------------------------
 // _allocate_file: Find a slot in the open files buffer for a new file
@@ -108,12 +116,34 @@ static int _check_file_open(FL_FILE* file)
 //-----------------------------------------------------------------------------
 static void _free_file(FL_FILE* file)
 {
+#if FAT_FILE_BUFFER_SECTORS > 1
+    // Give the multi-sector buffer back to the pool
+    if (file->buffer)
+    {
+        _free_file_buffers[_free_file_buffer_count++] = file->buffer;
+        file->buffer = NULL;
+    }
+#endif
+
     // Remove from open list
     fat_list_remove(&_open_file_list, &file->list_node);
 
     // Add to free list
     fat_list_insert_last(&_free_file_list, &file->list_node);
 }
+//-----------------------------------------------------------------------------
+// _get_file_buffer: Multi-sector buffer of the file, taken from the pool
+// the first time (NULL if the pool is empty)
+//-----------------------------------------------------------------------------
+#if FAT_FILE_BUFFER_SECTORS > 1
+static uint8* _get_file_buffer(FL_FILE* file)
+{
+    if (!file->buffer && _free_file_buffer_count)
+        file->buffer = _free_file_buffers[--_free_file_buffer_count];
+
+    return file->buffer;
+}
+#endif
 
 //-----------------------------------------------------------------------------
 //                                Low Level
@@ -562,6 +592,12 @@ static uint32 _read_sectors(FL_FILE* file, uint32 offset, uint8 *buffer, uint32
     if ((Sector + count) > _fs.sectors_per_cluster)
         count = _fs.sectors_per_cluster - Sector;
 
+#if FATFS_INC_WRITE_SUPPORT && FAT_FILE_BUFFER_SECTORS > 1
+    // Some of these sectors not written yet?
+    if (file->buffer_dirty && (offset < file->buffer_address + file->buffer_count) && (offset + count > file->buffer_address))
+        _flush_write_behind(file);
+#endif
+
     // Quick lookup for next link in the chain
     if (ClusterIdx == file->last_fat_lookup.ClusterIdx)
         Cluster = file->last_fat_lookup.CurrentCluster;
@@ -615,12 +651,50 @@ static uint32 _read_sectors(FL_FILE* file, uint32 offset, uint8 *buffer, uint32
     // Calculate sector address
     lba = fatfs_lba_of_cluster(&_fs, Cluster) + Sector;
 
+    fatfs_cache_stats.data_reads++;
+    fatfs_cache_stats.data_sectors += count;
+
     // Read sector of file
     if (fatfs_sector_read(&_fs, lba, buffer, count))
         return count;
     else
         return 0;
 }
+//-----------------------------------------------------------------------------
+// _read_sector_buffered: Read a sector of the file into file_data_sector,
+// through the file buffer (the following sectors of the cluster are read
+// at the same time, for the next sequential reads)
+//-----------------------------------------------------------------------------
+static uint32 _read_sector_buffered(FL_FILE* file, uint32 offset)
+{
+#if FAT_FILE_BUFFER_SECTORS > 1
+    if (_get_file_buffer(file))
+    {
+        // Not in the buffer?
+        if ((offset - file->buffer_address) >= file->buffer_count)
+        {
+#if FATFS_INC_WRITE_SUPPORT
+            // Write the sectors it keeps first
+            if (file->buffer_dirty && !_flush_write_behind(file))
+                return 0;
+#endif
+
+            fatfs_cache_stats.readahead_misses++;
+            file->buffer_address = offset;
+            file->buffer_count = _read_sectors(file, offset, file->buffer, FAT_FILE_BUFFER_SECTORS);
+            if (!file->buffer_count)
+                return 0;
+        }
+        else
+            fatfs_cache_stats.readahead_hits++;
+
+        memcpy(file->file_data_sector, file->buffer + (offset - file->buffer_address) * FAT_SECTOR_SIZE, FAT_SECTOR_SIZE);
+        return 1;
+    }
+#endif
+
+    return _read_sectors(file, offset, file->file_data_sector, 1);
+}
 
 //-----------------------------------------------------------------------------
 //                                External API
@@ -638,7 +712,19 @@ void fl_init(void)
 
     // Add all file objects to free list
     for (i=0;i<FATFS_MAX_OPEN_FILES;i++)
+    {
+#if FAT_FILE_BUFFER_SECTORS > 1
+        _files[i].buffer = NULL;
+#endif
         fat_list_insert_last(&_free_file_list, &_files[i].list_node);
+    }
+
+#if FAT_FILE_BUFFER_SECTORS > 1
+    // All the multi-sector buffers are free
+    for (i=0;i<FAT_FILE_BUFFERS;i++)
+        _free_file_buffers[i] = _file_buffers[i];
+    _free_file_buffer_count = FAT_FILE_BUFFERS;
+#endif
 
     _filelib_init = 1;
 }
@@ -814,6 +900,12 @@ static uint32 _write_sectors(FL_FILE* file, uint32 offset, uint8 *buf, uint32 co
     uint32 lba;
     uint32 TotalWriteCount = count;
 
+#if FAT_FILE_BUFFER_SECTORS > 1
+    // Invalidate read-ahead sectors
+    if (!file->buffer_dirty)
+        file->buffer_count = 0;
+#endif
+
     // Find values for Cluster index & sector within cluster
     ClusterIdx = offset / _fs.sectors_per_cluster;
     SectorNumber = offset - (ClusterIdx * _fs.sectors_per_cluster);
@@ -883,6 +975,9 @@ static uint32 _write_sectors(FL_FILE* file, uint32 offset, uint8 *buf, uint32 co
     // Calculate write address
     lba = fatfs_lba_of_cluster(&_fs, Cluster) + SectorNumber;
 
+    fatfs_cache_stats.data_writes++;
+    fatfs_cache_stats.data_write_sectors += count;
+
     if (fatfs_sector_write(&_fs, lba, buf, count))
         return count;
     else
@@ -890,6 +985,74 @@ static uint32 _write_sectors(FL_FILE* file, uint32 offset, uint8 *buf, uint32 co
 }
 #endif
 //-----------------------------------------------------------------------------
+// _flush_write_behind: Write the sectors kept in the file buffer (they
+// stay there, as read-ahead sectors)
+//-----------------------------------------------------------------------------
+#if FATFS_INC_WRITE_SUPPORT && FAT_FILE_BUFFER_SECTORS > 1
+static int _flush_write_behind(FL_FILE* file)
+{
+    uint32 done = 0;
+    uint32 count;
+
+    if (!file->buffer_dirty)
+        return 1;
+
+    // One write per cluster (_write_sectors stops at the end of a cluster)
+    while (done < file->buffer_count)
+    {
+        count = _write_sectors(file, file->buffer_address + done, file->buffer + done * FAT_SECTOR_SIZE, file->buffer_count - done);
+        if (!count)
+        {
+            file->buffer_count = 0;
+            file->buffer_dirty = 0;
+            return 0;
+        }
+        done += count;
+    }
+
+    file->buffer_dirty = 0;
+    return 1;
+}
+#endif
+//-----------------------------------------------------------------------------
+// _write_sector_buffered: Write file_data_sector to sector 'offset' of the
+// file, through the file buffer (consecutive sectors are written at once
+// when the buffer is full, or by fl_fflush)
+//-----------------------------------------------------------------------------
+#if FATFS_INC_WRITE_SUPPORT
+static uint32 _write_sector_buffered(FL_FILE* file, uint32 offset)
+{
+#if FAT_FILE_BUFFER_SECTORS > 1
+    if (_get_file_buffer(file))
+    {
+        // Read-ahead sectors are dropped, the sectors not written yet
+        // are written if this one does not follow them or if the buffer
+        // is full
+        if (!file->buffer_dirty)
+            file->buffer_count = 0;
+        else if ((offset != file->buffer_address + file->buffer_count) || (file->buffer_count == FAT_FILE_BUFFER_SECTORS))
+        {
+            if (!_flush_write_behind(file))
+                return 0;
+            file->buffer_count = 0;
+        }
+
+        if (!file->buffer_count)
+        {
+            file->buffer_address = offset;
+            file->buffer_dirty = 1;
+        }
+
+        memcpy(file->buffer + file->buffer_count * FAT_SECTOR_SIZE, file->file_data_sector, FAT_SECTOR_SIZE);
+        file->buffer_count++;
+        return 1;
+    }
+#endif
+
+    return _write_sectors(file, offset, file->file_data_sector, 1);
+}
+#endif
+//-----------------------------------------------------------------------------
 // fl_fflush: Flush un-written data to the file
 //-----------------------------------------------------------------------------
 int fl_fflush(void *f)
@@ -908,10 +1071,14 @@ int fl_fflush(void *f)
         if (file->file_data_dirty)
         {
             // Write back current sector before loading next
-            if (_write_sectors(file, file->file_data_address, file->file_data_sector, 1))
+            if (_write_sector_buffered(file, file->file_data_address))
                 file->file_data_dirty = 0;
         }
 
+#if FAT_FILE_BUFFER_SECTORS > 1
+        _flush_write_behind(file);
+#endif
+
         FL_UNLOCK(&_fs);
     }
 #endif
@@ -1076,7 +1243,7 @@ int fl_fread(void * buffer, int size, int length, void *f )
                     fl_fflush(file);
 
                 // Get LBA of sector offset within file
-                if (!_read_sectors(file, sector, file->file_data_sector, 1))
+                if (!_read_sector_buffered(file, sector))
                     // Read failed - out of range (probably)
                     break;
 
@@ -1127,6 +1294,9 @@ int fl_fseek( void *f, long offset, int origin )
 
     FL_LOCK(&_fs);
 
+    // Flush un-written data to file
+    fl_fflush(file);
+
     // Invalidate file buffer
     file->file_data_address = 0xFFFFFFFF;
     file->file_data_dirty = 0;
@@ -1303,6 +1473,11 @@ int fl_fwrite(const void * data, int size, int count, void *f )
                 file->file_data_dirty = 0;
             }
 
+#if FAT_FILE_BUFFER_SECTORS > 1
+            // Buffered sectors first (they may extend the cluster chain)
+            _flush_write_behind(file);
+#endif
+
             // Write as many sectors as possible
             sectorsWrote = _write_sectors(file, sector, (uint8*)(buffer + bytesWritten), (length - bytesWritten) / FAT_SECTOR_SIZE);
             copyCount = FAT_SECTOR_SIZE * sectorsWrote;
@@ -1332,9 +1507,12 @@ int fl_fwrite(const void * data, int size, int count, void *f )
             // Do we need to read a new sector?
             if (file->file_data_address != sector)
             {
-                // Flush un-written data to file
+                // Write back un-written data (write-behind)
                 if (file->file_data_dirty)
-                    fl_fflush(file);
+                {
+                    if (_write_sector_buffered(file, file->file_data_address))
+                        file->file_data_dirty = 0;
+                }
 
                 // If we plan to overwrite the whole sector, we don't need to read it first!
                 if (copyCount != FAT_SECTOR_SIZE)
@@ -1343,8 +1521,11 @@ int fl_fwrite(const void * data, int size, int count, void *f )
                     // reached, no valid data will be read in, but write will
                     // allocate some more space for new data.
 
-                    // Get LBA of sector offset within file
-                    if (!_read_sectors(file, sector, file->file_data_sector, 1))
+                    // Get LBA of sector offset within file (nothing to read
+                    // past the end of the file, e.g. in preallocated clusters)
+                    if ((sector * FAT_SECTOR_SIZE) >= file->filelength)
+                        memset(file->file_data_sector, 0x00, FAT_SECTOR_SIZE);
+                    else if (!_read_sectors(file, sector, file->file_data_sector, 1))
                         memset(file->file_data_sector, 0x00, FAT_SECTOR_SIZE);
                 }
 
@@ -1443,6 +1624,70 @@ int fl_remove( const char * filename )
 }
 #endif
 //-----------------------------------------------------------------------------
+// fl_preallocate: Reserve the clusters for the first 'size' bytes of a file
+// opened for writing (the length of the file does not change). The new
+// clusters follow the end of the chain on the disk when they are free,
+// and the writes up to 'size' do not need to allocate anything.
+//-----------------------------------------------------------------------------
+#if FATFS_INC_WRITE_SUPPORT
+int fl_preallocate(void *f, uint32 size)
+{
+    FL_FILE *file = (FL_FILE *)f;
+    uint32 clusterSize;
+    uint32 clusterCount;
+    uint32 cluster;
+    uint32 nextCluster;
+    uint32 i;
+    int res = 0;
+
+    // If first call to library, initialise
+    CHECK_FL_INIT();
+
+    if (!file)
+        return -1;
+
+    FL_LOCK(&_fs);
+
+    // No write permissions (or no cluster chain to extend)
+    if (!(file->flags & FILE_WRITE) || file->startcluster == 0)
+    {
+        FL_UNLOCK(&_fs);
+        return -1;
+    }
+
+    // Work out clusters needed
+    clusterSize = _fs.sectors_per_cluster * FAT_SECTOR_SIZE;
+    clusterCount = (size + clusterSize - 1) / clusterSize;
+
+    // Find the end of the chain (and count the clusters already there)
+    cluster = file->startcluster;
+    for (i = 1; ; i++)
+    {
+        if (!fatfs_cache_get_next_cluster(&_fs, file, i-1, &nextCluster))
+        {
+            nextCluster = fatfs_find_next_cluster(&_fs, cluster);
+            fatfs_cache_set_next_cluster(&_fs, file, i-1, nextCluster);
+        }
+
+        if (nextCluster == FAT32_LAST_CLUSTER)
+            break;
+
+        cluster = nextCluster;
+    }
+
+    // Add the missing ones
+    if (clusterCount > i)
+        if (!fatfs_add_free_space(&_fs, &cluster, clusterCount - i))
+            res = -1;
+
+    fatfs_fat_purge(&_fs);
+
+    FL_UNLOCK(&_fs);
+
+    return res;
+}
+#endif
+//-----------------------------------------------------------------------------
 // fl_createdirectory: Create a directory based on a path
 //-----------------------------------------------------------------------------
 #if FATFS_INC_WRITE_SUPPORT
@@ -1590,6 +1835,7 @@ int fl_is_dir(const char *path)
 #if FATFS_INC_FORMAT_SUPPORT
 int fl_format(uint32 volume_sectors, const char *name)
 {
+    fatfs_direntry_cache_init(&_fs);
     return fatfs_format(&_fs, volume_sectors, name);
 }
 #endif /*FATFS_INC_FORMAT_SUPPORT*/
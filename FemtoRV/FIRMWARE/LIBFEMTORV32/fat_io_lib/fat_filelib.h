@@ -59,6 +59,16 @@ typedef struct sFL_FILE
     uint32                  file_data_address;
     int                     file_data_dirty;
 
+#if FAT_FILE_BUFFER_SECTORS > 1
+    // Multi-sector buffer from the pool (NULL if none yet), with the
+    // sectors buffer_address to buffer_address + buffer_count - 1,
+    // read ahead or, if buffer_dirty, not written yet
+    uint8                   *buffer;
+    uint32                  buffer_address;
+    uint32                  buffer_count;
+    int                     buffer_dirty;
+#endif
+
     // File fopen flags
     uint8                   flags;
 #define FILE_READ           (1 << 0)
@@ -109,6 +119,7 @@ int                 fl_closedir(FL_DIR* dir);
 void                fl_listdirectory(const char *path);
 int                 fl_createdirectory(const char *path);
 int                 fl_is_dir(const char *path);
+int                 fl_preallocate(void *file, uint32 size);
 
 int                 fl_format(uint32 volume_sectors, const char *name);
 
@@ -185,6 +185,7 @@ static int fatfs_create_boot_sector(struct fatfs *fs, uint32 boot_sector_lba, ui
         // Count of sectors used by the FAT table (FAT16 only)
         total_clusters = (vol_sectors / fs->sectors_per_cluster) + 1;
         fs->fat_sectors = (total_clusters/(FAT_SECTOR_SIZE/2)) + 1;
+        fs->total_clusters = total_clusters;
         fs->currentsector.sector[22] = (uint8)((fs->fat_sectors >> 0) & 0xFF);
         fs->currentsector.sector[23] = (uint8)((fs->fat_sectors >> 8) & 0xFF);
 
@@ -275,6 +276,7 @@ static int fatfs_create_boot_sector(struct fatfs *fs, uint32 boot_sector_lba, ui
 
         total_clusters = (vol_sectors / fs->sectors_per_cluster) + 1;
         fs->fat_sectors = (total_clusters/(FAT_SECTOR_SIZE/4)) + 1;
+        fs->total_clusters = total_clusters;
 
         // BPB_FATSz32
         fs->currentsector.sector[36] = (uint8)((fs->fat_sectors>>0)&0xFF);
@@ -428,7 +430,9 @@ int fatfs_format_fat16(struct fatfs *fs, uint32 volume_sectors, const char *name
     fs->currentsector.address = FAT32_INVALID_CLUSTER;
     fs->currentsector.dirty = 0;
 
-    fs->next_free_cluster = 0; // Invalid
+    fs->next_free_cluster = FSINFO_UNKNOWN;
+    fs->free_cluster_count = FSINFO_UNKNOWN;
+    fs->fs_info_dirty = 0;
 
     fatfs_fat_init(fs);
 
@@ -477,7 +481,9 @@ int fatfs_format_fat32(struct fatfs *fs, uint32 volume_sectors, const char *name
     fs->currentsector.address = FAT32_INVALID_CLUSTER;
     fs->currentsector.dirty = 0;
 
-    fs->next_free_cluster = 0; // Invalid
+    fs->next_free_cluster = FSINFO_UNKNOWN;
+    fs->free_cluster_count = FSINFO_UNKNOWN;
+    fs->fs_info_dirty = 0;
 
     fatfs_fat_init(fs);
 
@@ -19,9 +19,13 @@
    #define FATFS_MAX_LONG_FILENAME          260
 #endif
 
-// Max open files (reduce to lower memory requirements)
-#ifndef FATFS_MAX_OPEN_FILES
-    #define FATFS_MAX_OPEN_FILES            2
+// Cache sizes: the defaults below depend on the board. Boards with an
+// SDCard (SDCARD, from FIRMWARE/config.mk, e.g. ULX3S) have enough RAM
+// for large caches, the others (e.g. IceStick) keep the minimum. Each
+// size can be overridden with -D in the firmware Makefile (all the files
+// that include fat_filelib.h need to see the same values).
+#if defined(SDCARD) && !defined(FAT_SMALL_CACHES)
+    #define FAT_LARGE_CACHES                1
 #endif
 
 // Number of sectors per FAT_BUFFER (min 1)
@@ -32,13 +36,68 @@
 // Max FAT sectors to buffer (min 1)
 // (mem used is FAT_BUFFERS * FAT_BUFFER_SECTORS * FAT_SECTOR_SIZE)
 #ifndef FAT_BUFFERS
-    #define FAT_BUFFERS                     1
+    #ifdef FAT_LARGE_CACHES
+        #define FAT_BUFFERS                 4
+    #else
+        #define FAT_BUFFERS                 1
+    #endif
 #endif
 
 // Size of cluster chain cache (can be undefined)
-// Mem used = FAT_CLUSTER_CACHE_ENTRIES * 4 * 2
+// Mem used = FAT_CLUSTER_CACHE_ENTRIES * 4 * 2 per open file
 // Improves access speed considerably
-//#define FAT_CLUSTER_CACHE_ENTRIES         128
+#if defined(FAT_LARGE_CACHES) && !defined(FAT_CLUSTER_CACHE_ENTRIES)
+    #define FAT_CLUSTER_CACHE_ENTRIES       128
+#endif
+
+// Max open files (reduce to lower memory requirements)
+// Mem used = about 2 * FATFS_MAX_LONG_FILENAME + FAT_SECTOR_SIZE per
+// open file, plus the cluster chain cache
+#ifndef FATFS_MAX_OPEN_FILES
+    #ifdef FAT_LARGE_CACHES
+        #define FATFS_MAX_OPEN_FILES        4
+    #else
+        #define FATFS_MAX_OPEN_FILES        2
+    #endif
+#endif
+
+// Number of sectors of the multi-sector file buffers (min 1, 1 means no
+// multi-sector buffers). The open files take them from a pool of
+// FAT_FILE_BUFFERS buffers at their first read or write, and give them
+// back when they are closed. A buffer keeps the sectors that follow the
+// one that is read (in the same cluster) for the next reads (read-ahead),
+// or the consecutive sectors that are written until it is full, or until
+// fl_fflush() / fl_fclose() (write-behind). The files opened when the
+// pool is empty read and write one sector at a time.
+#ifndef FAT_FILE_BUFFER_SECTORS
+    #ifdef FAT_LARGE_CACHES
+        #define FAT_FILE_BUFFER_SECTORS     8
+    #else
+        #define FAT_FILE_BUFFER_SECTORS     1
+    #endif
+#endif
+
+// Number of multi-sector file buffers in the pool (min 1)
+// Mem used = FAT_FILE_BUFFERS * FAT_FILE_BUFFER_SECTORS * FAT_SECTOR_SIZE,
+// if FAT_FILE_BUFFER_SECTORS is more than 1.
+#ifndef FAT_FILE_BUFFERS
+    #define FAT_FILE_BUFFERS                FATFS_MAX_OPEN_FILES
+#endif
+
+// Number of directory entries kept by the name lookups (can be
+// undefined). Opening again a file (or a path through the same
+// directories) does not scan the directories. The entries of a directory
+// are dropped when it is written.
+// Mem used = FAT_DIRENTRY_CACHE_ENTRIES * (FAT_DIRENTRY_CACHE_NAME + 44)
+#if defined(FAT_LARGE_CACHES) && !defined(FAT_DIRENTRY_CACHE_ENTRIES)
+    #define FAT_DIRENTRY_CACHE_ENTRIES      8
+#endif
+
+// Longest name (with the terminating zero) kept by the directory entry
+// cache, the lookups of longer names always scan the directory.
+#ifndef FAT_DIRENTRY_CACHE_NAME
+    #define FAT_DIRENTRY_CACHE_NAME         32
+#endif
 
 // Include support for writing files (1 / 0)?
 #ifndef FATFS_INC_WRITE_SUPPORT
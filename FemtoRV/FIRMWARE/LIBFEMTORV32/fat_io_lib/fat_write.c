@@ -36,6 +36,7 @@
 #include "fat_write.h"
 #include "fat_string.h"
 #include "fat_misc.h"
+#include "fat_cache.h"
 
 #if FATFS_INC_WRITE_SUPPORT
 //-----------------------------------------------------------------------------
@@ -48,14 +49,13 @@ int fatfs_add_free_space(struct fatfs *fs, uint32 *startCluster, uint32 clusters
     uint32 nextcluster;
     uint32 start = *startCluster;
 
-    // Set the next free cluster hint to unknown
-    if (fs->next_free_cluster != FAT32_LAST_CLUSTER)
-        fatfs_set_fs_info_next_free_cluster(fs, FAT32_LAST_CLUSTER);
-
     for (i=0;i<clusters;i++)
     {
-        // Start looking for free clusters from the beginning
-        if (fatfs_find_blank_cluster(fs, fs->rootdir_first_cluster, &nextcluster))
+        // Look for a free cluster after the end of the chain first (the
+        // file stays contiguous, and the FAT sectors around it are
+        // already buffered), else from the next free cluster hint
+        if (fatfs_find_blank_cluster(fs, start + 1, &nextcluster) ||
+            fatfs_find_free_cluster(fs, &nextcluster))
         {
             // Point last to this
             fatfs_fat_set_cluster(fs, start, nextcluster);
@@ -88,10 +88,6 @@ int fatfs_allocate_free_space(struct fatfs *fs, int newFile, uint32 *startCluste
     if (size==0)
         return 0;
 
-    // Set the next free cluster hint to unknown
-    if (fs->next_free_cluster != FAT32_LAST_CLUSTER)
-        fatfs_set_fs_info_next_free_cluster(fs, FAT32_LAST_CLUSTER);
-
     // Work out size and clusters
     clusterSize = fs->sectors_per_cluster * FAT_SECTOR_SIZE;
     clusterCount = (size / clusterSize);
@@ -103,7 +99,7 @@ int fatfs_allocate_free_space(struct fatfs *fs, int newFile, uint32 *startCluste
     // Allocated first link in the chain if a new file
     if (newFile)
     {
-        if (!fatfs_find_blank_cluster(fs, fs->rootdir_first_cluster, &nextcluster))
+        if (!fatfs_find_free_cluster(fs, &nextcluster))
             return 0;
 
         // If this is all that is needed then all done
@@ -230,7 +226,7 @@ static int fatfs_find_free_dir_offset(struct fatfs *fs, uint32 dirCluster, int e
             uint32 newCluster;
 
             // Get a new cluster for directory
-            if (!fatfs_find_blank_cluster(fs, fs->rootdir_first_cluster, &newCluster))
+            if (!fatfs_find_free_cluster(fs, &newCluster))
                 return 0;
 
             // Add cluster to end of directory tree
@@ -284,6 +280,11 @@ int fatfs_add_file_entry(struct fatfs *fs, uint32 dirCluster, char *filename, ch
     if (!fs->disk_io.write_media)
         return 0;
 
+    // The directory changes, and so does the one that may have
+    // used startCluster before
+    fatfs_direntry_cache_invalidate(fs, dirCluster);
+    fatfs_direntry_cache_invalidate(fs, startCluster);
+
 #if FATFS_INC_LFN_SUPPORT
     // How many LFN entries are required?
     // NOTE: We always request one LFN even if it would fit in a SFN!
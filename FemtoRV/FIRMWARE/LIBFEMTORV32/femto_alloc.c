@@ -0,0 +1,196 @@
+#include <femto_alloc.h>
+#include <femtorv32.h>
+#include <string.h>
+
+/*
+ * Each block starts with a header word, followed by the data (aligned on
+ * 8 bytes, so blocks start at 4 modulo 8, and their sizes are multiples
+ * of 8). The header is the class index (0 to FEMTO_POOL_NB_CLASSES-1),
+ * or the size of the block (header included) for big blocks. Free blocks
+ * have the next one of their list in their first data word.
+ * New blocks are cut from the end of the heap (the 'wilderness').
+ */
+
+#define BIG FEMTO_POOL_NB_CLASSES
+
+extern void* _sbrk(ptrdiff_t incr);
+
+typedef struct free_block {
+   struct free_block* next;
+} free_block;
+
+static free_block* free_lists[FEMTO_POOL_NB_CLASSES + 1];
+static uint8_t*    wilderness     = 0;
+static uint8_t*    wilderness_end = 0;
+static femto_heap_stats_t stats;
+
+static inline uint32_t* header(void* ptr) {
+   return (uint32_t*)ptr - 1;
+}
+
+static inline uint32_t block_size(uint32_t hdr) {
+   return (hdr < BIG) ? (16u << hdr) : hdr;
+}
+
+/* Smallest class that contains size bytes of data, BIG if none */
+static inline int size_class(size_t size) {
+   int cls = 0;
+   size += 4;
+   while(cls < BIG && (16u << cls) < size) {
+      ++cls;
+   }
+   return cls;
+}
+
+static uint8_t* wilderness_alloc(uint32_t nbytes) {
+   if(wilderness_end - wilderness < (int)nbytes) {
+      uint32_t incr = nbytes + 8;
+      if(incr < FEMTO_POOL_CHUNK_SIZE) {
+	 incr = FEMTO_POOL_CHUNK_SIZE;
+      }
+      uint8_t* chunk = (uint8_t*)_sbrk(incr);
+      if(chunk == (uint8_t*)-1 || chunk == 0) {
+	 return 0;
+      }
+      stats.heap_size += incr;
+      if(chunk != wilderness_end) {
+	 /* not contiguous with the previous chunk, what remains there is lost */
+	 wilderness = chunk;
+	 while(((uint32_t)wilderness & 7) != 4) {
+	    ++wilderness;
+	 }
+      }
+      wilderness_end = chunk + incr;
+   }
+   uint8_t* result = wilderness;
+   wilderness += nbytes;
+   return result;
+}
+
+void* femto_malloc(size_t size) {
+   int cls = size_class(size);
+   uint32_t hdr;
+   free_block* block;
+   if(cls < BIG) {
+      hdr = cls;
+      block = free_lists[cls];
+      if(block != 0) {
+	 free_lists[cls] = block->next;
+	 stats.nb_free[cls]--;
+      }
+   } else {
+      hdr = (size + 4 + 7) & ~7u;
+      /* first fit (big blocks are rare) */
+      free_block** prev = &free_lists[BIG];
+      for(block = *prev; block != 0; prev = &block->next, block = *prev) {
+	 if(*header(block) >= hdr) {
+	    *prev = block->next;
+	    hdr = *header(block);
+	    stats.nb_free[BIG]--;
+	    break;
+	 }
+      }
+   }
+   if(block == 0) {
+      uint8_t* mem = wilderness_alloc(block_size(hdr));
+      if(mem == 0) {
+	 return 0;
+      }
+      *(uint32_t*)mem = hdr;
+      block = (free_block*)(mem + 4);
+   }
+   stats.nb_used[cls]++;
+   stats.used_bytes += block_size(hdr);
+   if(stats.used_bytes > stats.peak_used_bytes) {
+      stats.peak_used_bytes = stats.used_bytes;
+   }
+   return block;
+}
+
+void femto_free(void* ptr) {
+   if(ptr == 0) {
+      return;
+   }
+   uint32_t hdr = *header(ptr);
+   int cls = (hdr < BIG) ? hdr : BIG;
+   free_block* block = (free_block*)ptr;
+   block->next = free_lists[cls];
+   free_lists[cls] = block;
+   stats.nb_used[cls]--;
+   stats.nb_free[cls]++;
+   stats.used_bytes -= block_size(hdr);
+}
+
+void* femto_calloc(size_t nmemb, size_t size) {
+   size_t nbytes = nmemb * size;
+   if(size != 0 && nbytes / size != nmemb) {
+      return 0;
+   }
+   void* result = femto_malloc(nbytes);
+   if(result != 0) {
+      memset(result, 0, nbytes);
+   }
+   return result;
+}
+
+void* femto_realloc(void* ptr, size_t size) {
+   if(ptr == 0) {
+      return femto_malloc(size);
+   }
+   if(size == 0) {
+      femto_free(ptr);
+      return 0;
+   }
+   uint32_t capacity = block_size(*header(ptr)) - 4;
+   if(size <= capacity) {
+      return ptr;
+   }
+   void* result = femto_malloc(size);
+   if(result != 0) {
+      memcpy(result, ptr, capacity);
+      femto_free(ptr);
+   }
+   return result;
+}
+
+void femto_heap_stats(femto_heap_stats_t* s) {
+   *s = stats;
+}
+
+void femto_heap_print_stats() {
+   printf("heap: %u bytes, used: %u (peak %u)\n",
+	  stats.heap_size, stats.used_bytes, stats.peak_used_bytes);
+   printf("size  used  free\n");
+   for(int cls=0; cls<BIG; ++cls) {
+      if(stats.nb_used[cls] != 0 || stats.nb_free[cls] != 0) {
+	 printf("%4u %5u %5u\n", 16u << cls, stats.nb_used[cls], stats.nb_free[cls]);
+      }
+   }
+   printf(" big %5u %5u\n", stats.nb_used[BIG], stats.nb_free[BIG]);
+}
+
+/*****************************************************************************/
+
+void femto_arena_init(femto_arena* arena, void* buffer, size_t size) {
+   /* aligns the start of the buffer on 8 bytes */
+   uint32_t skip = (8 - ((uint32_t)buffer & 7)) & 7;
+   if(skip > size) {
+      skip = size;
+   }
+   arena->base = (uint8_t*)buffer + skip;
+   arena->size = size - skip;
+   arena->used = 0;
+   arena->peak = 0;
+}
+
+void* femto_arena_alloc(femto_arena* arena, size_t size) {
+   uint32_t start = (arena->used + 7) & ~7u;
+   if(start > arena->size || size > arena->size - start) {
+      return 0;
+   }
+   arena->used = start + size;
+   if(arena->used > arena->peak) {
+      arena->peak = arena->used;
+   }
+   return arena->base + start;
+}
@@ -0,0 +1,65 @@
+/*
+ * Compact allocator, smaller and faster than newlib's malloc on the
+ * 64-128 KB RAM configs.
+ * - Pool: blocks of fixed size classes (16 to 2048 bytes, powers of two,
+ *   header included), each class has a free list: allocating and freeing
+ *   are O(1). Bigger blocks are kept in a first-fit list (not split).
+ *   Memory comes from _sbrk() (CRT/syscalls.c), and is never given back.
+ * - Arena: bump allocation in a buffer, everything freed at once, for
+ *   frame-scoped allocations.
+ * Linking with CRT/pool_malloc.o (make POOL_MALLOC=1) replaces malloc(),
+ * free(), calloc(), realloc() (and the newlib _r variants) with the pool.
+ */
+
+#ifndef H__FEMTO_ALLOC__H
+#define H__FEMTO_ALLOC__H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define FEMTO_POOL_NB_CLASSES   8     /* 16, 32, ... 2048 bytes        */
+#define FEMTO_POOL_MAX_BLOCK    2048
+#define FEMTO_POOL_CHUNK_SIZE   1024  /* heap grows by (at least) that */
+
+void* femto_malloc(size_t size);
+void  femto_free(void* ptr);
+void* femto_calloc(size_t nmemb, size_t size);
+void* femto_realloc(void* ptr, size_t size);
+
+typedef struct {
+   uint32_t heap_size;                             /* obtained from _sbrk()  */
+   uint32_t used_bytes;                            /* in allocated blocks    */
+   uint32_t peak_used_bytes;
+   uint32_t nb_used[FEMTO_POOL_NB_CLASSES + 1];    /* last one: big blocks   */
+   uint32_t nb_free[FEMTO_POOL_NB_CLASSES + 1];
+} femto_heap_stats_t;
+
+void femto_heap_stats(femto_heap_stats_t* stats);
+void femto_heap_print_stats();                     /* printf()s them         */
+
+/*
+ * Arena: femto_arena_alloc() returns 8-bytes aligned blocks, or NULL
+ * when the buffer is full. femto_arena_mark() / femto_arena_release()
+ * free everything allocated after the mark, femto_arena_reset()
+ * everything.
+ */
+typedef struct {
+   uint8_t* base;
+   uint32_t size;
+   uint32_t used;
+   uint32_t peak;
+} femto_arena;
+
+void     femto_arena_init(femto_arena* arena, void* buffer, size_t size);
+void*    femto_arena_alloc(femto_arena* arena, size_t size);
+static inline uint32_t femto_arena_mark(femto_arena* arena) {
+   return arena->used;
+}
+static inline void femto_arena_release(femto_arena* arena, uint32_t mark) {
+   arena->used = mark;
+}
+static inline void femto_arena_reset(femto_arena* arena) {
+   arena->used = 0;
+}
+
+#endif
@@ -0,0 +1,154 @@
+#include <femto_dispatch.h>
+#include <femtorv32.h>
+
+/*
+ * Nothing here may use '*', '/' or '%': compiled for rv32i, they are
+ * calls to libgcc, that CRT/muldiv_dispatch.o sends back here.
+ */
+
+/******************** rv32i *****************************************/
+
+/* The loop runs on the smaller operand (often small) */
+static uint32_t mul_i(uint32_t a, uint32_t b) {
+   uint32_t result = 0;
+   if(a < b) {
+      uint32_t tmp = a; a = b; b = tmp;
+   }
+   while(b) {
+      if(b & 1) {
+	 result += a;
+      }
+      a <<= 1;
+      b >>= 1;
+   }
+   return result;
+}
+
+/* Restoring division, one iteration per bit of the quotient */
+static uint32_t divmodu_i(uint32_t n, uint32_t d, uint32_t* r) {
+   uint32_t q = 0;
+   uint32_t bit = 1;
+   if(d == 0) {
+      *r = n;
+      return 0xffffffff;
+   }
+   while(d < n && !(d & 0x80000000)) {
+      d <<= 1;
+      bit <<= 1;
+   }
+   while(bit) {
+      if(n >= d) {
+	 n -= d;
+	 q |= bit;
+      }
+      d >>= 1;
+      bit >>= 1;
+   }
+   *r = n;
+   return q;
+}
+
+static uint32_t divu_i(uint32_t a, uint32_t b) {
+   uint32_t r;
+   return divmodu_i(a, b, &r);
+}
+
+static uint32_t remu_i(uint32_t a, uint32_t b) {
+   uint32_t r;
+   divmodu_i(a, b, &r);
+   return r;
+}
+
+/* Same results as the M instructions, including for b = 0 and overflow */
+static int32_t div_i(int32_t a, int32_t b) {
+   uint32_t r;
+   uint32_t q;
+   if(b == 0) {
+      return -1;
+   }
+   q = divmodu_i(a < 0 ? -(uint32_t)a : a, b < 0 ? -(uint32_t)b : b, &r);
+   return ((a ^ b) < 0) ? -q : q;
+}
+
+static int32_t rem_i(int32_t a, int32_t b) {
+   uint32_t r;
+   divmodu_i(a < 0 ? -(uint32_t)a : a, b < 0 ? -(uint32_t)b : b, &r);
+   return (a < 0) ? -r : r;
+}
+
+/******************** rv32im ****************************************/
+
+#ifdef __riscv_mul
+
+static uint32_t mul_m(uint32_t a, uint32_t b)  { return a * b; }
+static int32_t  div_m(int32_t a, int32_t b)    { return b ? a / b : -1; }
+static uint32_t divu_m(uint32_t a, uint32_t b) { return b ? a / b : 0xffffffff; }
+static int32_t  rem_m(int32_t a, int32_t b)    { return b ? a % b : a; }
+static uint32_t remu_m(uint32_t a, uint32_t b) { return b ? a % b : a; }
+
+#else
+
+/* The assembler does not take M instructions with -march=rv32i */
+#define M_INSN(funct3, result, a, b) \
+   asm(".insn r 0x33, " #funct3 ", 1, %0, %1, %2" : "=r"(result) : "r"(a), "r"(b))
+
+static uint32_t mul_m(uint32_t a, uint32_t b)  { uint32_t r; M_INSN(0, r, a, b); return r; }
+static int32_t  div_m(int32_t a, int32_t b)    { int32_t  r; M_INSN(4, r, a, b); return r; }
+static uint32_t divu_m(uint32_t a, uint32_t b) { uint32_t r; M_INSN(5, r, a, b); return r; }
+static int32_t  rem_m(int32_t a, int32_t b)    { int32_t  r; M_INSN(6, r, a, b); return r; }
+static uint32_t remu_m(uint32_t a, uint32_t b) { uint32_t r; M_INSN(7, r, a, b); return r; }
+
+#endif
+
+/******************** table *****************************************/
+
+/* Initial entries: fill the table, then forward the call */
+static uint32_t mul_first(uint32_t a, uint32_t b) {
+   femto_dispatch_init();
+   return femto_kernels.mul(a, b);
+}
+
+static int32_t div_first(int32_t a, int32_t b) {
+   femto_dispatch_init();
+   return femto_kernels.div(a, b);
+}
+
+static uint32_t divu_first(uint32_t a, uint32_t b) {
+   femto_dispatch_init();
+   return femto_kernels.divu(a, b);
+}
+
+static int32_t rem_first(int32_t a, int32_t b) {
+   femto_dispatch_init();
+   return femto_kernels.rem(a, b);
+}
+
+static uint32_t remu_first(uint32_t a, uint32_t b) {
+   femto_dispatch_init();
+   return femto_kernels.remu(a, b);
+}
+
+FemtoKernels femto_kernels = {
+   mul_first, div_first, divu_first, rem_first, remu_first
+};
+
+void femto_dispatch_init() {
+#ifdef __riscv_mul
+   int has_M = 1; /* this firmware does not run without M anyway */
+#else
+   int has_M = FEMTORV32_HAS_EXTENSION(FEMTORV32_CPUINFO_M_bit);
+#endif
+   if(has_M) {
+      femto_kernels.mul  = mul_m;
+      femto_kernels.div  = div_m;
+      femto_kernels.divu = divu_m;
+      femto_kernels.rem  = rem_m;
+      femto_kernels.remu = remu_m;
+   } else {
+      femto_kernels.mul  = mul_i;
+      femto_kernels.div  = div_i;
+      femto_kernels.divu = divu_i;
+      femto_kernels.rem  = rem_i;
+      femto_kernels.remu = remu_i;
+   }
+}
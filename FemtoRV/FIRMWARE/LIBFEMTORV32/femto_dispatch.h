@@ -0,0 +1,39 @@
+/*
+ * Kernels chosen at runtime from the hardware config, so that the same
+ * rv32i firmware runs at full speed on the cores that have more than
+ * rv32i. The ISA extensions are read from the CPUINFO register
+ * (FEMTORV32_HAS_EXTENSION(), femtorv32.h). The table is filled by
+ * femto_dispatch_init(), or else by the first call through it.
+ *
+ * - integer multiplication and division: M instructions if the core has
+ *   them, else shift and add / restoring division. Linking with
+ *   CRT/muldiv_dispatch.o (make MULDIV_DISPATCH=1) sends there all the
+ *   __mulsi3(), __divsi3() ... of libgcc, that is, all the '*', '/'
+ *   and '%' of a firmware compiled for rv32i (nothing changes for a
+ *   firmware compiled with M, the compiler then emits the instructions).
+ *
+ * The other feature-dependent code already tests the hardware config at
+ * runtime (FGA or OLED in LIBFEMTOGL, FEMTOSOC_HAS_DEVICE(), RAM size in
+ * IO_HW_CONFIG_RAM). F cannot be chosen at runtime: the float ABI
+ * (ilp32 or ilp32f) is fixed at compile time.
+ */
+
+#ifndef H__FEMTO_DISPATCH__H
+#define H__FEMTO_DISPATCH__H
+
+#include <stdint.h>
+
+typedef struct {
+   uint32_t (*mul)(uint32_t a, uint32_t b);
+   int32_t  (*div)(int32_t a, int32_t b);
+   uint32_t (*divu)(uint32_t a, uint32_t b);
+   int32_t  (*rem)(int32_t a, int32_t b);
+   uint32_t (*remu)(uint32_t a, uint32_t b);
+} FemtoKernels;
+
+extern FemtoKernels femto_kernels;
+
+/* Fills femto_kernels from the hardware config (can be called again) */
+void femto_dispatch_init();
+
+#endif
@@ -19,6 +19,7 @@ static int elf32_parse(const char* filename, Elf32Info* info);
 int elf32_load(const char* filename, Elf32Info* info) {
   info->base_address = NULL;
   info->text_address = 0;
+  info->entry_address = 0;
   info->max_address = 0;
   return elf32_parse(filename, info);
 }
@@ -26,6 +27,7 @@ int elf32_load(const char* filename, Elf32Info* info) {
 int elf32_load_at(const char* filename, Elf32Info* info, void* addr) {
   info->base_address = addr;
   info->text_address = 0;
+  info->entry_address = 0;
   info->max_address = 0;
   return elf32_parse(filename, info);
 }
@@ -33,6 +35,7 @@ int elf32_load_at(const char* filename, Elf32Info* info, void* addr) {
 int elf32_stat(const char* filename, Elf32Info* info) {
   info->base_address = NO_ADDRESS;
   info->text_address = 0;
+  info->entry_address = 0;
   info->max_address = 0;
   return elf32_parse(filename, info);
 }
@@ -85,6 +88,21 @@ typedef struct
   Elf32_Word	sh_entsize;		/* Entry size if section holds table */
 } Elf32_Shdr;
 
+typedef struct
+{
+  Elf32_Word	p_type;			/* Segment type */
+  Elf32_Off	p_offset;		/* Segment file offset */
+  Elf32_Addr	p_vaddr;		/* Segment virtual address */
+  Elf32_Addr	p_paddr;		/* Segment physical address */
+  Elf32_Word	p_filesz;		/* Segment size in file */
+  Elf32_Word	p_memsz;		/* Segment size in memory */
+  Elf32_Word	p_flags;		/* Segment flags */
+  Elf32_Word	p_align;		/* Segment alignment */
+} Elf32_Phdr;
+
+/* Segment types */
+#define PT_LOAD		  1		/* Loadable program segment */
+
 /* Section header type */
 #define SHT_NULL	  0		/* Section header table entry unused */
 #define SHT_PROGBITS	  1		/* Program data */
@@ -97,18 +115,234 @@ typedef struct
 
 /****************************************************************************/
 
-int elf32_parse(const char* filename, Elf32Info* info) {
+/*
+ * Loads the PT_LOAD segments, with one read per segment straight to
+ * its address, and clears their BSS part (p_memsz > p_filesz).
+ */
+static int elf32_load_segments(FILE* f, Elf32_Ehdr* elf_header, Elf32Info* info) {
+  Elf32_Phdr prog_header;
+  uint8_t* base_mem = (uint8_t*)(info->base_address);
+
+  for(int i=0; i<elf_header->e_phnum; ++i) {
+    fseek(f, elf_header->e_phoff + i*sizeof(prog_header), SEEK_SET);
+    if(fread(&prog_header, 1, sizeof(prog_header), f) != sizeof(prog_header)) {
+      return ELF32_READ_ERROR;
+    }
+    if(prog_header.p_type != PT_LOAD || prog_header.p_memsz == 0) {
+      continue;
+    }
+    if(prog_header.p_filesz != 0) {
+      fseek(f, prog_header.p_offset, SEEK_SET);
+      if(
+	 fread(
+	    base_mem + prog_header.p_vaddr, 1, prog_header.p_filesz, f
+	 ) != prog_header.p_filesz
+      ) {
+	return ELF32_READ_ERROR;
+      }
+    }
+    if(prog_header.p_memsz > prog_header.p_filesz) {
+      memset(
+	 base_mem + prog_header.p_vaddr + prog_header.p_filesz, 0,
+	 prog_header.p_memsz - prog_header.p_filesz
+      );
+    }
+  }
+  return ELF32_OK;
+}
+
+/*
+ * Decompresses an LZ4 block of csize bytes read from f, to dst (size
+ * bytes once decompressed). Literals are read straight to dst, matches
+ * are copied from the data already decompressed.
+ */
+static int elz_decompress(FILE* f, uint8_t* dst, uint32_t size, uint32_t csize) {
+  uint8_t* out = dst;
+  uint8_t* end = dst + size;
+  uint32_t in = 0;
+  while(in < csize) {
+    int token = getc(f);
+    uint32_t len;
+    uint32_t offset;
+    uint8_t* match;
+    int b;
+    if(token < 0) {
+      return ELF32_READ_ERROR;
+    }
+    ++in;
+
+    /* literals */
+    len = (uint32_t)token >> 4;
+    if(len == 15) {
+      do {
+	b = getc(f);
+	if(b < 0) {
+	  return ELF32_READ_ERROR;
+	}
+	++in;
+	len += b;
+      } while(b == 255);
+    }
+    if(len > (uint32_t)(end - out)) {
+      return ELF32_DECOMPRESS_ERROR;
+    }
+    if(len != 0) {
+      if(fread(out, 1, len, f) != len) {
+	return ELF32_READ_ERROR;
+      }
+      out += len;
+      in  += len;
+    }
+
+    /* the last sequence has no match */
+    if(in >= csize) {
+      break;
+    }
+
+    /* match */
+    b = getc(f);
+    offset = b;
+    b = getc(f);
+    if(b < 0) {
+      return ELF32_READ_ERROR;
+    }
+    offset |= (uint32_t)b << 8;
+    in += 2;
+    len = (uint32_t)token & 15;
+    if(len == 15) {
+      do {
+	b = getc(f);
+	if(b < 0) {
+	  return ELF32_READ_ERROR;
+	}
+	++in;
+	len += b;
+      } while(b == 255);
+    }
+    len += 4;
+    if(offset == 0 || offset > (uint32_t)(out - dst) || len > (uint32_t)(end - out)) {
+      return ELF32_DECOMPRESS_ERROR;
+    }
+    match = out - offset;
+    if(offset >= len) {
+      memcpy(out, match, len);
+      out += len;
+    } else {
+      /* overlapping match (repeated pattern) */
+      while(len--) {
+	*out++ = *match++;
+      }
+    }
+  }
+  return (out == end) ? ELF32_OK : ELF32_DECOMPRESS_ERROR;
+}
+
+/*
+ * Loads a compressed executable (see Elz_Header in femto_elf.h).
+ */
+static int elz_parse_file(FILE* f, Elf32Info* info) {
+  Elz_Header header;
+  Elz_Segment segment;
+  uint8_t* base_mem = (uint8_t*)(info->base_address);
+  int status;
+
+  if(fread(&header, 1, sizeof(header), f) != sizeof(header)) {
+    return ELF32_READ_ERROR;
+  }
+  info->entry_address = header.entry_address;
+  info->text_address  = header.text_address;
+  info->max_address   = header.max_address;
+
+  if(info->base_address == NO_ADDRESS) {
+    return ELF32_OK;
+  }
+
+  for(uint32_t i=0; i<header.nb_segments; ++i) {
+    LEDS(i);
+    if(fread(&segment, 1, sizeof(segment), f) != sizeof(segment)) {
+      return ELF32_READ_ERROR;
+    }
+    if(segment.filesz > segment.memsz) {
+      return ELF32_DECOMPRESS_ERROR;
+    }
+    status = elz_decompress(
+       f, base_mem + segment.vaddr, segment.filesz, segment.csize
+    );
+    if(status != ELF32_OK) {
+      return status;
+    }
+    if(segment.memsz > segment.filesz) {
+      memset(
+	 base_mem + segment.vaddr + segment.filesz, 0,
+	 segment.memsz - segment.filesz
+      );
+    }
+  }
+  return ELF32_OK;
+}
+
+/****************************************************************************/
+
+/* CRC-32 with a 16 entries table (two lookups per byte, no big table in RAM) */
+uint32_t fxe_crc32(const uint8_t* data, uint32_t size) {
+  static const uint32_t table[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+  };
+  uint32_t crc = 0xFFFFFFFF;
+  while(size--) {
+    crc ^= *data++;
+    crc = (crc >> 4) ^ table[crc & 15];
+    crc = (crc >> 4) ^ table[crc & 15];
+  }
+  return ~crc;
+}
+
+/*
+ * Loads a flat executable (see Fxe_Header in femto_elf.h): one read
+ * straight to the load address, then the BSS is cleared.
+ */
+static int fxe_parse_file(FILE* f, Elf32Info* info) {
+  Fxe_Header header;
+  uint8_t* base_mem = (uint8_t*)(info->base_address);
+
+  if(fread(&header, 1, sizeof(header), f) != sizeof(header)) {
+    return ELF32_READ_ERROR;
+  }
+  info->entry_address = header.entry_address;
+  info->text_address  = header.load_address;
+  info->max_address   = header.load_address + header.size + header.bss_size;
+
+  if(info->base_address == NO_ADDRESS) {
+    return ELF32_OK;
+  }
+
+  fseek(f, FXE_PAYLOAD_OFFSET, SEEK_SET);
+  if(fread(base_mem + header.load_address, 1, header.size, f) != header.size) {
+    return ELF32_READ_ERROR;
+  }
+  if(
+     header.crc != 0 &&
+     fxe_crc32(base_mem + header.load_address, header.size) != header.crc
+  ) {
+    return ELF32_CHECKSUM_ERROR;
+  }
+  memset(base_mem + header.load_address + header.size, 0, header.bss_size);
+  return ELF32_OK;
+}
+
+/****************************************************************************/
+
+static int elf32_parse_file(FILE* f, Elf32Info* info) {
   Elf32_Ehdr elf_header;
   Elf32_Shdr sec_header;
-  FILE* f = fopen(filename,"r");
+  int load_segments;
   uint8_t* base_mem = (uint8_t*)(info->base_address);
   
   info->text_address = 0;
 
-  if(f == NULL) {
-    return ELF32_FILE_NOT_FOUND;
-  }
-
   /* read elf header */
   if(fread(&elf_header, 1, sizeof(elf_header), f) != sizeof(elf_header)) {
     return ELF32_READ_ERROR;
@@ -123,13 +357,27 @@ int elf32_parse(const char* filename, Elf32Info* info) {
   if(elf_header.e_shentsize != sizeof(Elf32_Shdr)) {
     return ELF32_HEADER_SIZE_MISMATCH;
   }
+
+  /* sanity check */
+  if(elf_header.e_phnum != 0 && elf_header.e_phentsize != sizeof(Elf32_Phdr)) {
+    return ELF32_HEADER_SIZE_MISMATCH;
+  }
+
+  info->entry_address = elf_header.e_entry;
+
+  /* 
+   * If there are program headers, the sections are only scanned for
+   * the text and max addresses, and the segments are loaded afterwards
+   * (one read per segment). Else the sections are loaded one by one.
+   */
+  load_segments = (elf_header.e_phnum != 0);
   
   LEDS(8);
 
-  /* read all section headers */  
+  /* read all section headers (they are contiguous, no seek needed) */  
+  fseek(f,elf_header.e_shoff, SEEK_SET);
   for(int i=0; i<elf_header.e_shnum; ++i) {
     
-    fseek(f,elf_header.e_shoff + i*sizeof(sec_header), SEEK_SET);
     if(fread(&sec_header, 1, sizeof(sec_header), f) != sizeof(sec_header)) {
       return ELF32_READ_ERROR;
     }
@@ -154,31 +402,230 @@ int elf32_parse(const char* filename, Elf32Info* info) {
       sec_header.sh_addr + sec_header.sh_size
     );
 
+    if(load_segments || info->base_address == NO_ADDRESS) {
+      continue;
+    }
+
     /* PROGBIT, INI_ARRAY and FINI_ARRAY need to be loaded. */
     if(
        sec_header.sh_type == SHT_PROGBITS ||
        sec_header.sh_type == SHT_INIT_ARRAY ||
        sec_header.sh_type == SHT_FINI_ARRAY
     ) {
-	if(info->base_address != NO_ADDRESS) {
-	  fseek(f,sec_header.sh_offset, SEEK_SET);
-	  if(
-	     fread(
-		   base_mem + sec_header.sh_addr, 1,
-		   sec_header.sh_size, f
-	     ) != sec_header.sh_size
-	  ) {
-	    return ELF32_READ_ERROR;
-	  }
+	long next_sec_header = ftell(f);
+	fseek(f,sec_header.sh_offset, SEEK_SET);
+	if(
+	   fread(
+		 base_mem + sec_header.sh_addr, 1,
+		 sec_header.sh_size, f
+	   ) != sec_header.sh_size
+	) {
+	  return ELF32_READ_ERROR;
 	}
+	fseek(f,next_sec_header, SEEK_SET);
     }
 
     /* NOBITS need to be cleared. */    
-    if(sec_header.sh_type == SHT_NOBITS && info->base_address != NO_ADDRESS) {	
+    if(sec_header.sh_type == SHT_NOBITS) {	
       memset(base_mem + sec_header.sh_addr, 0, sec_header.sh_size);
     }
   }  
-  fclose(f);
+
+  if(load_segments && info->base_address != NO_ADDRESS) {
+    return elf32_load_segments(f, &elf_header, info);
+  }
   
   return ELF32_OK;
 }
+
+int elf32_parse(const char* filename, Elf32Info* info) {
+  int status;
+  uint32_t magic;
+  FILE* f = fopen(filename,"r");
+  if(f == NULL) {
+    return ELF32_FILE_NOT_FOUND;
+  }
+  /* Flat executable, compressed executable or ELF file ? */
+  if(fread(&magic, 1, sizeof(magic), f) != sizeof(magic)) {
+    fclose(f);
+    return ELF32_READ_ERROR;
+  }
+  fseek(f, 0, SEEK_SET);
+  if(magic == FXE_MAGIC) {
+    status = fxe_parse_file(f, info);
+  } else if(magic == ELZ_MAGIC) {
+    status = elz_parse_file(f, info);
+  } else {
+    status = elf32_parse_file(f, info);
+  }
+  fclose(f);
+  return status;
+}
+
+/****************************************************************************/
+
+static void elf32_preload_close(Elf32Preload* preload) {
+  if(preload->file != NULL) {
+    fclose((FILE*)preload->file);
+    preload->file = NULL;
+  }
+}
+
+static int elf32_preload_error(Elf32Preload* preload, int status) {
+  elf32_preload_close(preload);
+  preload->status = status;
+  return status;
+}
+
+int elf32_preload_start(Elf32Preload* preload, const char* filename) {
+  uint32_t magic;
+  FILE* f;
+  memset(preload, 0, sizeof(Elf32Preload));
+  f = fopen(filename,"r");
+  if(f == NULL) {
+    preload->status = ELF32_FILE_NOT_FOUND;
+    return preload->status;
+  }
+  preload->file = f;
+  if(fread(&magic, 1, sizeof(magic), f) != sizeof(magic)) {
+    return elf32_preload_error(preload, ELF32_READ_ERROR);
+  }
+  fseek(f, 0, SEEK_SET);
+  preload->elz = (magic == ELZ_MAGIC);
+  preload->fxe = (magic == FXE_MAGIC);
+  if(preload->fxe) {
+    /* the payload is read by the steps, then the BSS is cleared */
+    Fxe_Header header;
+    if(fread(&header, 1, sizeof(header), f) != sizeof(header)) {
+      return elf32_preload_error(preload, ELF32_READ_ERROR);
+    }
+    preload->info.entry_address = header.entry_address;
+    preload->info.text_address  = header.load_address;
+    preload->info.max_address   = header.load_address + header.size + header.bss_size;
+    preload->crc       = header.crc;
+    preload->offset    = FXE_PAYLOAD_OFFSET;
+    preload->vaddr     = header.load_address;
+    preload->remaining = header.size;
+  } else if(preload->elz) {
+    Elz_Header header;
+    if(fread(&header, 1, sizeof(header), f) != sizeof(header)) {
+      return elf32_preload_error(preload, ELF32_READ_ERROR);
+    }
+    preload->info.entry_address = header.entry_address;
+    preload->info.text_address  = header.text_address;
+    preload->info.max_address   = header.max_address;
+    preload->nb_segments        = header.nb_segments;
+  } else {
+    /* the sections give the text and max addresses (see elf32_parse_file()) */
+    Elf32_Ehdr elf_header;
+    preload->info.base_address = NO_ADDRESS;
+    preload->status = elf32_parse_file(f, &preload->info);
+    preload->info.base_address = NULL;
+    if(preload->status != ELF32_OK) {
+      return elf32_preload_error(preload, preload->status);
+    }
+    fseek(f, 0, SEEK_SET);
+    if(fread(&elf_header, 1, sizeof(elf_header), f) != sizeof(elf_header)) {
+      return elf32_preload_error(preload, ELF32_READ_ERROR);
+    }
+    preload->nb_segments = elf_header.e_phnum;
+    preload->phoff       = elf_header.e_phoff;
+  }
+  return ELF32_OK;
+}
+
+int elf32_preload_step(Elf32Preload* preload) {
+  FILE* f = (FILE*)preload->file;
+  uint8_t* base_mem = (uint8_t*)(preload->info.base_address);
+
+  if(preload->done || preload->status != ELF32_OK || f == NULL) {
+    return preload->status;
+  }
+
+  /* ELF without program headers: loaded by sections, all at once */
+  if(!preload->elz && !preload->fxe && preload->nb_segments == 0) {
+    fseek(f, 0, SEEK_SET);
+    preload->status = elf32_parse_file(f, &preload->info);
+    if(preload->status != ELF32_OK) {
+      return elf32_preload_error(preload, preload->status);
+    }
+    preload->done = 1;
+    elf32_preload_close(preload);
+    return ELF32_OK;
+  }
+
+  /* ELF segment being read */
+  if(preload->remaining != 0) {
+    uint32_t chunk = preload->remaining;
+    if(chunk > ELF32_PRELOAD_CHUNK) {
+      chunk = ELF32_PRELOAD_CHUNK;
+    }
+    fseek(f, preload->offset, SEEK_SET);
+    if(fread(base_mem + preload->vaddr, 1, chunk, f) != chunk) {
+      return elf32_preload_error(preload, ELF32_READ_ERROR);
+    }
+    preload->offset    += chunk;
+    preload->vaddr     += chunk;
+    preload->remaining -= chunk;
+  } else if(preload->segment < preload->nb_segments) {
+    if(preload->elz) {
+      Elz_Segment segment;
+      int status;
+      if(fread(&segment, 1, sizeof(segment), f) != sizeof(segment)) {
+	return elf32_preload_error(preload, ELF32_READ_ERROR);
+      }
+      if(segment.filesz > segment.memsz) {
+	return elf32_preload_error(preload, ELF32_DECOMPRESS_ERROR);
+      }
+      status = elz_decompress(
+	 f, base_mem + segment.vaddr, segment.filesz, segment.csize
+      );
+      if(status != ELF32_OK) {
+	return elf32_preload_error(preload, status);
+      }
+      if(segment.memsz > segment.filesz) {
+	memset(
+	   base_mem + segment.vaddr + segment.filesz, 0,
+	   segment.memsz - segment.filesz
+	);
+      }
+    } else {
+      Elf32_Phdr prog_header;
+      fseek(f, preload->phoff + preload->segment*sizeof(prog_header), SEEK_SET);
+      if(fread(&prog_header, 1, sizeof(prog_header), f) != sizeof(prog_header)) {
+	return elf32_preload_error(preload, ELF32_READ_ERROR);
+      }
+      if(prog_header.p_type == PT_LOAD && prog_header.p_memsz != 0) {
+	if(prog_header.p_memsz > prog_header.p_filesz) {
+	  memset(
+	     base_mem + prog_header.p_vaddr + prog_header.p_filesz, 0,
+	     prog_header.p_memsz - prog_header.p_filesz
+	  );
+	}
+	/* the data is read by the next steps */
+	preload->offset    = prog_header.p_offset;
+	preload->vaddr     = prog_header.p_vaddr;
+	preload->remaining = prog_header.p_filesz;
+      }
+    }
+    ++preload->segment;
+  }
+
+  if(preload->remaining == 0 && preload->segment >= preload->nb_segments) {
+    if(preload->fxe) {
+      uint32_t text = preload->info.text_address;
+      uint32_t size = preload->vaddr - text;
+      if(preload->crc != 0 && fxe_crc32(base_mem + text, size) != preload->crc) {
+	return elf32_preload_error(preload, ELF32_CHECKSUM_ERROR);
+      }
+      memset(base_mem + preload->vaddr, 0, preload->info.max_address - preload->vaddr);
+    }
+    preload->done = 1;
+    elf32_preload_close(preload);
+  }
+  return ELF32_OK;
+}
+
+void elf32_preload_abort(Elf32Preload* preload) {
+  elf32_preload_close(preload);
+}
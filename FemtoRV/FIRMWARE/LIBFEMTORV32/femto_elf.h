@@ -15,6 +15,7 @@ typedef uint32_t elf32_addr;
 typedef struct {
   void*      base_address; /* Base memory address (NULL on normal operation). */
   elf32_addr text_address; /* The address of the text segment.                */
+  elf32_addr entry_address;/* The entry point (e_entry).                      */
   elf32_addr max_address;  /* The maximum address of a segment.               */
 } Elf32Info;
 
@@ -22,6 +23,62 @@ typedef struct {
 #define ELF32_FILE_NOT_FOUND       1
 #define ELF32_HEADER_SIZE_MISMATCH 2
 #define ELF32_READ_ERROR           3
+#define ELF32_DECOMPRESS_ERROR     4
+#define ELF32_CHECKSUM_ERROR       5
+
+/*
+ * Compressed executables (.elz, made from ELF files by TOOLS/elz_pack):
+ * an Elz_Header, then for each PT_LOAD segment an Elz_Segment followed
+ * by the csize bytes of the segment data, compressed as one LZ4 block
+ * (filesz bytes once decompressed, then cleared up to memsz). The loader
+ * decompresses straight to the segment addresses, far less data is read
+ * from the SD card than with the ELF file. All fields are little endian.
+ * The functions below recognize them by their magic number.
+ */
+#define ELZ_MAGIC 0x315A4C45 /* "ELZ1" */
+
+typedef struct {
+  uint32_t magic;
+  uint32_t entry_address;
+  uint32_t text_address;
+  uint32_t max_address;
+  uint32_t nb_segments;
+} Elz_Header;
+
+typedef struct {
+  uint32_t vaddr;  /* Segment address                               */
+  uint32_t filesz; /* Size of the data (once decompressed)          */
+  uint32_t memsz;  /* Size in memory (filesz + bss)                 */
+  uint32_t csize;  /* Size of the compressed data, after the header */
+} Elz_Segment;
+
+/*
+ * Flat executables (.fxe, made from ELF files by TOOLS/fxe_pack): a
+ * Fxe_Header, padded to FXE_PAYLOAD_OFFSET bytes (so that the payload
+ * starts on a sector), then the size bytes of the program, already
+ * relocated at load_address, followed in memory by bss_size bytes
+ * cleared by the loader. Loading is one read straight to load_address
+ * and one memset(), no header to parse. The CRC-32 (the one of zlib) of
+ * the payload is checked after the read, unless it is 0 (fxe_pack
+ * -nocrc). All fields are little endian. The functions below recognize
+ * them by their magic number.
+ */
+#define FXE_MAGIC 0x31455846 /* "FXE1" */
+#define FXE_PAYLOAD_OFFSET 512
+
+typedef struct {
+  uint32_t magic;
+  uint32_t load_address;  /* Address of the payload (text address)   */
+  uint32_t entry_address; /* Entry point                              */
+  uint32_t size;          /* Size of the payload                      */
+  uint32_t bss_size;      /* Bytes cleared after the payload          */
+  uint32_t crc;           /* CRC-32 of the payload, 0: not checked    */
+} Fxe_Header;
+
+/**
+ * \brief CRC-32 (the one of zlib) of a block of memory.
+ */
+uint32_t fxe_crc32(const uint8_t* data, uint32_t size);
 
 /**
  * \brief Loads an ELF executable to RAM.
@@ -55,3 +112,60 @@ int elf32_load_at(const char* filename, Elf32Info* info, void* addr);
  */
 int elf32_stat(const char* filename, Elf32Info* info);
 
+
+/*
+ * Incremental loading: elf32_preload_start() reads the headers, then each
+ * elf32_preload_step() loads a part of the program (at most 
+ * ELF32_PRELOAD_CHUNK bytes of an ELF segment or of the payload of a
+ * flat executable, or a whole segment of a compressed executable), so
+ * that a program can be loaded while the caller does something else
+ * (FEMTOS/commander.c loads the selected program while the user
+ * navigates). ELF files without program headers
+ * are loaded by the first step.
+ */
+#define ELF32_PRELOAD_CHUNK 4096
+
+typedef struct {
+  void*      file;         /* FILE*, NULL when done (or on error)            */
+  Elf32Info  info;
+  int        status;       /* ELF32_OK, or the error code of the last step   */
+  int        done;         /* non-zero once everything is loaded             */
+  int        elz;          /* compressed executable                          */
+  int        fxe;          /* flat executable                                */
+  uint32_t   crc;          /* CRC-32 of the payload of a flat executable     */
+  uint32_t   nb_segments;  /* number of segments (or of program headers)     */
+  uint32_t   segment;      /* next segment (or program header)               */
+  uint32_t   phoff;        /* file offset of the program headers (ELF)       */
+  uint32_t   offset;       /* part of the current ELF segment still to read: */
+  uint32_t   vaddr;        /*   file offset, address                         */
+  uint32_t   remaining;    /*   and size                                     */
+} Elf32Preload;
+
+/**
+ * \brief Starts loading an executable (ELF or compressed) to RAM.
+ * \param[out] preload the state of the loading
+ * \param[in] filename the name of the file
+ * \return ELF32_OK or an error code.
+ */
+int elf32_preload_start(Elf32Preload* preload, const char* filename);
+
+/**
+ * \brief Loads the next part of the executable.
+ * \details Sets preload->done once the executable is loaded (and closes
+ *  the file). Does nothing if it is done or if there was an error.
+ * \return ELF32_OK or an error code.
+ */
+int elf32_preload_step(Elf32Preload* preload);
+
+/**
+ * \brief Stops loading, closes the file.
+ */
+void elf32_preload_abort(Elf32Preload* preload);
+
+/**
+ * \brief Runs an executable that is already loaded (see exec() in 
+ *  femtorv32.h).
+ * \param[in] info what elf32_load() or elf32_preload_step() returned
+ * \return 0 when the program returns.
+ */
+int exec_loaded(const Elf32Info* info, int argc, char** argv);
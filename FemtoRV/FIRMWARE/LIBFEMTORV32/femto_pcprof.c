@@ -0,0 +1,68 @@
+#include <femto_pcprof.h>
+#include <femtorv32.h>
+
+femto_pcprof_histogram femto_pcprof = { 0, 0, 0, 1, 0, 0 };
+
+static uint32_t femto_pcprof_period = 0;
+
+void femto_pcprof_init(uint32_t* buckets, uint32_t nb_buckets, uint32_t base, uint32_t end) {
+   uint32_t shift = 1; /* compressed instructions are 2 bytes */
+   while(shift < 31 && ((end - base - 1) >> shift) >= nb_buckets) {
+      ++shift;
+   }
+   femto_pcprof.buckets = buckets;
+   femto_pcprof.nb_buckets = (buckets == 0) ? 0 : nb_buckets;
+   femto_pcprof.base = base;
+   femto_pcprof.shift = shift;
+   for(uint32_t i = 0; i < femto_pcprof.nb_buckets; ++i) {
+      buckets[i] = 0;
+   }
+   femto_pcprof.outside = 0;
+   femto_pcprof.samples = 0;
+}
+
+int femto_pcprof_start(uint32_t period) {
+   if(!FEMTOSOC_HAS_DEVICE(IO_TIMER_bit) || period == 0) {
+      return 0;
+   }
+   femto_pcprof_period = period;
+   asm volatile ("csrw mtvec, %0" : : "r"(femto_pcprof_trap));
+   IO_OUT(IO_TIMER, period);
+   asm volatile ("csrsi mstatus, 8"); /* MIE */
+   return 1;
+}
+
+void femto_pcprof_stop() {
+   asm volatile ("csrci mstatus, 8");
+   if(FEMTOSOC_HAS_DEVICE(IO_TIMER_bit)) {
+      IO_OUT(IO_TIMER, 0);
+   }
+}
+
+/*
+ * Format (read by TOOLS/femto_pcprof):
+ *   #femto_pcprof begin <MHz> <period> <base> <shift> <samples> <outside>
+ *   <bucket address> <samples>
+ *   ...
+ *   #femto_pcprof end
+ * (addresses in hex, the other numbers in decimal)
+ */
+void femto_pcprof_dump() {
+   printf(
+      "#femto_pcprof begin %d %u %x %d %u %u\n",
+      FEMTORV32_FREQ, femto_pcprof_period, femto_pcprof.base,
+      femto_pcprof.shift, femto_pcprof.samples, femto_pcprof.outside
+   );
+   for(uint32_t i = 0; i < femto_pcprof.nb_buckets; ++i) {
+      if(femto_pcprof.buckets[i] != 0) {
+	 printf(
+	    "%x %u\n", femto_pcprof.base + (i << femto_pcprof.shift),
+	    femto_pcprof.buckets[i]
+	 );
+	 femto_pcprof.buckets[i] = 0;
+      }
+   }
+   printf("#femto_pcprof end\n");
+   femto_pcprof.outside = 0;
+   femto_pcprof.samples = 0;
+}
@@ -0,0 +1,70 @@
+/*
+ * Statistical PC profiler, for the cores with interrupts (gracilis)
+ * and a SoC with the timer (NRV_IO_TIMER, RTL/DEVICES/Timer.v).
+ *
+ * The timer interrupts the program every 'period' cycles, the trap
+ * handler (femto_pcprof_trap.S) increments the bucket of the histogram
+ * that contains mepc (the address of the interrupted instruction).
+ * After the measured run, femto_pcprof_dump() prints the histogram on
+ * the UART, and TOOLS/femto_pcprof attributes the buckets to the
+ * functions of the ELF executable (a flat profile, the same format as
+ * the .prof files of the simulators, that TOOLS/fastcode_place reads):
+ *
+ *   static uint32_t buckets[4096];
+ *   femto_pcprof_init(buckets, 4096, 0x10000, (uint32_t)&_end);
+ *   femto_pcprof_start(FEMTORV32_FREQ * 100); // 10 KHz
+ *   ...
+ *   femto_pcprof_stop();
+ *   femto_pcprof_dump();
+ *
+ * - the buckets cover [base, end[, their size is the smallest power of
+ *   two (2 bytes at least) that fits, the samples outside are counted;
+ * - the handler uses mtvec, the program cannot have its own interrupt
+ *   handler while profiling;
+ * - the handler takes a few tens of cycles, a period of a few thousand
+ *   cycles does not disturb the measured program much.
+ */
+
+#ifndef H__FEMTO_PCPROF__H
+#define H__FEMTO_PCPROF__H
+
+#include <stdint.h>
+
+/* The offsets of the fields are used by femto_pcprof_trap.S */
+typedef struct {
+   uint32_t* buckets;    /*  0 */
+   uint32_t  nb_buckets; /*  4 */
+   uint32_t  base;       /*  8 address of the first bucket */
+   uint32_t  shift;      /* 12 log2 of the size of a bucket, in bytes */
+   uint32_t  outside;    /* 16 samples outside of [base, end[ */
+   uint32_t  samples;    /* 20 total number of samples */
+} femto_pcprof_histogram;
+
+extern femto_pcprof_histogram femto_pcprof;
+
+/*
+ * Uses buckets[0..nb_buckets-1] for the histogram of [base, end[,
+ * and clears it.
+ */
+void femto_pcprof_init(uint32_t* buckets, uint32_t nb_buckets, uint32_t base, uint32_t end);
+
+/*
+ * Starts sampling, every period cycles.
+ * Returns 0 if the SoC has no timer (nothing happens then), 1 otherwise.
+ */
+int femto_pcprof_start(uint32_t period);
+
+/* Stops sampling */
+void femto_pcprof_stop();
+
+/*
+ * Prints the non-empty buckets on the UART (printf()), between a
+ * "#femto_pcprof begin" and a "#femto_pcprof end" line, then clears
+ * the histogram.
+ */
+void femto_pcprof_dump();
+
+/* The trap handler (femto_pcprof_trap.S), installed in mtvec */
+void femto_pcprof_trap();
+
+#endif
@@ -0,0 +1,172 @@
+#include <femtorv32.h>
+
+/*
+ * Buffered stdio, see femto_stdio.h
+ * One femto_FILE per file that fat_filelib can open.
+ */
+
+static femto_FILE femto_files[FATFS_MAX_OPEN_FILES];
+
+/*
+ * Gives the bytes still in the read buffer back to the file, so that
+ * the position of the FL_FILE is the logical position (before writing
+ * or seeking).
+ */
+static void femto_unread(femto_FILE* f) {
+  if(f->count > 0) {
+    fl_fseek(f->file, fl_ftell(f->file) - f->count, SEEK_SET);
+  }
+  f->count = 0;
+  f->ptr = f->buffer;
+}
+
+femto_FILE* femto_fopen(const char* path, const char* modifiers) {
+  femto_FILE* f = NULL;
+  for(int i=0; i<FATFS_MAX_OPEN_FILES; ++i) {
+    if(femto_files[i].file == NULL) {
+      f = &femto_files[i];
+      break;
+    }
+  }
+  if(f == NULL) {
+    return NULL;
+  }
+  f->file = fl_fopen(path, modifiers);
+  if(f->file == NULL) {
+    return NULL;
+  }
+  f->ptr = f->buffer;
+  f->count = 0;
+  return f;
+}
+
+int femto_fclose(femto_FILE* f) {
+  if(f == NULL || f->file == NULL) {
+    return -1;
+  }
+  fl_fclose(f->file);
+  f->file = NULL;
+  f->count = 0;
+  return 0;
+}
+
+int femto_fflush(femto_FILE* f) {
+  return fl_fflush(f->file);
+}
+
+int femto_fillbuf(femto_FILE* f) {
+  int n = fl_fread(f->buffer, 1, FEMTO_FILE_BUFFER_SIZE, f->file);
+  if(n <= 0) {
+    f->ptr = f->buffer;
+    f->count = 0;
+    return EOF;
+  }
+  f->ptr = f->buffer + 1;
+  f->count = n - 1;
+  return f->buffer[0];
+}
+
+int femto_fread_buffered(void* data, int size, int count, femto_FILE* f) {
+  uint8_t* dst = (uint8_t*)data;
+  int bytes = size * count;
+  int total = 0;
+
+  if(bytes <= 0) {
+    return 0;
+  }
+
+  /* What remains in the buffer */
+  if(f->count > 0) {
+    total = (bytes < f->count) ? bytes : f->count;
+    memcpy(dst, f->ptr, total);
+    f->ptr   += total;
+    f->count -= total;
+  }
+
+  /* Large reads go directly to the destination (whole sectors are
+   * read by fat_filelib without copy), small ones refill the buffer. */
+  while(total < bytes) {
+    int n;
+    if(bytes - total >= FEMTO_FILE_BUFFER_SIZE) {
+      n = fl_fread(dst + total, 1, bytes - total, f->file);
+      if(n <= 0) {
+	break;
+      }
+    } else {
+      if(femto_fillbuf(f) == EOF) {
+	break;
+      }
+      /* femto_fillbuf() consumed the first byte */
+      f->ptr--;
+      f->count++;
+      n = bytes - total;
+      if(n > f->count) {
+	n = f->count;
+      }
+      memcpy(dst + total, f->ptr, n);
+      f->ptr   += n;
+      f->count -= n;
+    }
+    total += n;
+  }
+  return (total == 0) ? -1 : total;
+}
+
+int femto_fwrite(const void* data, int size, int count, femto_FILE* f) {
+  femto_unread(f);
+  return fl_fwrite(data, size, count, f->file);
+}
+
+char* femto_fgets(char* s, int n, femto_FILE* f) {
+  int idx = 0;
+  if(n > 0) {
+    while(idx < n-1) {
+      int ch = femto_getc(f);
+      if(ch < 0) {
+	break;
+      }
+      s[idx++] = (char)ch;
+      if(ch == '\n') {
+	break;
+      }
+    }
+    if(idx > 0) {
+      s[idx] = '\0';
+    }
+  }
+  return (idx > 0) ? s : NULL;
+}
+
+int femto_fputc(int c, femto_FILE* f) {
+  femto_unread(f);
+  return fl_fputc(c, f->file);
+}
+
+int femto_fputs(const char* s, femto_FILE* f) {
+  femto_unread(f);
+  return fl_fputs(s, f->file);
+}
+
+int femto_fseek(femto_FILE* f, long offset, int origin) {
+  if(origin == SEEK_CUR) {
+    offset = femto_ftell(f) + offset;
+    origin = SEEK_SET;
+  }
+  f->count = 0;
+  f->ptr = f->buffer;
+  return fl_fseek(f->file, offset, origin);
+}
+
+int femto_fgetpos(femto_FILE* f, uint32_t* position) {
+  int result = fl_fgetpos(f->file, (uint32*)position);
+  *position -= f->count;
+  return result;
+}
+
+long femto_ftell(femto_FILE* f) {
+  return fl_ftell(f->file) - f->count;
+}
+
+int femto_feof(femto_FILE* f) {
+  return (f->count > 0) ? 0 : fl_feof(f->file);
+}
@@ -0,0 +1,99 @@
+/*
+ * Buffered stdio on top of the FAT file system (fat_io_lib).
+ * Each FILE has a read buffer of FEMTO_FILE_BUFFER_SIZE bytes, so that
+ * getc() and small fread() (e.g. fread(&byte,1,1,F) in ST_NICCC) are
+ * served inline, and only go to fat_filelib when the buffer is empty.
+ * Writes, seeks and ftell() see the logical position (the bytes still
+ * in the buffer are given back to the file first).
+ * The functions return the same values as the fl_xxx() functions of
+ * fat_filelib (fread() returns a number of bytes, -1 at end of file).
+ */
+
+#ifndef H__FEMTO_STDIO__H
+#define H__FEMTO_STDIO__H
+
+#include <stdint.h>
+#include <string.h>
+
+/* Size of the read buffer of each file (a multiple of the sector size) */
+#ifndef FEMTO_FILE_BUFFER_SIZE
+#define FEMTO_FILE_BUFFER_SIZE 512
+#endif
+
+/* 
+ * FL_FILE of fat_filelib (not included here, because fat_io_lib 
+ * includes femtorv32.h, that includes this file) 
+ */
+struct sFL_FILE;
+
+typedef struct {
+  struct sFL_FILE* file;   /* NULL if this entry is free                */
+  uint8_t*         ptr;    /* next byte in the buffer                     */
+  int              count;  /* number of bytes in the buffer, from ptr     */
+  uint8_t          buffer[FEMTO_FILE_BUFFER_SIZE];
+} femto_FILE;
+
+femto_FILE* femto_fopen(const char* path, const char* modifiers);
+int   femto_fclose(femto_FILE* f);
+int   femto_fflush(femto_FILE* f);
+int   femto_fillbuf(femto_FILE* f); /* refills the buffer, returns next byte or EOF */
+int   femto_fread_buffered(void* data, int size, int count, femto_FILE* f);
+int   femto_fwrite(const void* data, int size, int count, femto_FILE* f);
+char* femto_fgets(char* s, int n, femto_FILE* f);
+int   femto_fputc(int c, femto_FILE* f);
+int   femto_fputs(const char* s, femto_FILE* f);
+int   femto_fseek(femto_FILE* f, long offset, int origin);
+int   femto_fgetpos(femto_FILE* f, uint32_t* position);
+long  femto_ftell(femto_FILE* f);
+int   femto_feof(femto_FILE* f);
+
+#define femto_getc(f) \
+   ((f)->count > 0 ? ((f)->count--, (int)(*(f)->ptr++)) : femto_fillbuf(f))
+
+/**
+ * \brief Reads from a file, inline if the data is in the buffer.
+ * \return the number of bytes read, or -1 at end of file.
+ */
+static inline int femto_fread(void* data, int size, int count, femto_FILE* f) {
+  int bytes = size * count;
+  if(bytes > 0 && bytes <= f->count) {
+    if(bytes == 1) {
+      *(uint8_t*)data = *f->ptr;
+    } else {
+      memcpy(data, f->ptr, bytes);
+    }
+    f->ptr   += bytes;
+    f->count -= bytes;
+    return bytes;
+  }
+  return femto_fread_buffered(data, size, count, f);
+}
+
+#ifdef USE_FEMTO_STDIO_COMPAT_NAMES
+
+#undef getc
+#undef fgetc
+
+#define FILE            femto_FILE
+
+#define fopen(a,b)      femto_fopen(a, b)
+#define fclose(a)       femto_fclose(a)
+#define fflush(a)       femto_fflush(a)
+#define getc(a)         femto_getc(a)
+#define fgetc(a)        femto_getc(a)
+#define fgets(a,b,c)    femto_fgets(a, b, c)
+#define fputc(a,b)      femto_fputc(a, b)
+#define fputs(a,b)      femto_fputs(a, b)
+#define fwrite(a,b,c,d) femto_fwrite(a, b, c, d)
+#define fread(a,b,c,d)  femto_fread(a, b, c, d)
+#define fseek(a,b,c)    femto_fseek(a, b, c)
+#define fgetpos(a,b)    femto_fgetpos(a, b)
+#define ftell(a)        femto_ftell(a)
+#define feof(a)         femto_feof(a)
+#define remove(a)       fl_remove(a)
+#define mkdir(a)        fl_createdirectory(a)
+#define rmdir(a)        0
+
+#endif
+
+#endif
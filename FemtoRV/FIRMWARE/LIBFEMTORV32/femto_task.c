@@ -0,0 +1,112 @@
+#include <femto_task.h>
+
+/*
+ * Context switch: saves the callee-saved registers (ra, s0-s11, and
+ * fs0-fs11 with the ilp32f ABI) on the stack, the stack pointer in
+ * *save_sp, then restores the ones of the stack at new_sp (gp, the IO
+ * base, is the same for all the tasks).
+ */
+void femto_task_swap(uint32_t* save_sp, uint32_t new_sp);
+
+#ifdef __riscv_float_abi_single
+#define FEMTO_TASK_FRAME 112
+#define FEMTO_TASK_FLOAT(op)             \
+   "   " #op " fs0,  52(sp)          \n" \
+   "   " #op " fs1,  56(sp)          \n" \
+   "   " #op " fs2,  60(sp)          \n" \
+   "   " #op " fs3,  64(sp)          \n" \
+   "   " #op " fs4,  68(sp)          \n" \
+   "   " #op " fs5,  72(sp)          \n" \
+   "   " #op " fs6,  76(sp)          \n" \
+   "   " #op " fs7,  80(sp)          \n" \
+   "   " #op " fs8,  84(sp)          \n" \
+   "   " #op " fs9,  88(sp)          \n" \
+   "   " #op " fs10, 92(sp)          \n" \
+   "   " #op " fs11, 96(sp)          \n"
+#else
+#define FEMTO_TASK_FRAME 64
+#define FEMTO_TASK_FLOAT(op)
+#endif
+
+#define FEMTO_TASK_STR2(x) #x
+#define FEMTO_TASK_STR(x) FEMTO_TASK_STR2(x)
+
+#define FEMTO_TASK_INT(op)               \
+   "   " #op " ra,   0(sp)           \n" \
+   "   " #op " s0,   4(sp)           \n" \
+   "   " #op " s1,   8(sp)           \n" \
+   "   " #op " s2,  12(sp)           \n" \
+   "   " #op " s3,  16(sp)           \n" \
+   "   " #op " s4,  20(sp)           \n" \
+   "   " #op " s5,  24(sp)           \n" \
+   "   " #op " s6,  28(sp)           \n" \
+   "   " #op " s7,  32(sp)           \n" \
+   "   " #op " s8,  36(sp)           \n" \
+   "   " #op " s9,  40(sp)           \n" \
+   "   " #op " s10, 44(sp)           \n" \
+   "   " #op " s11, 48(sp)           \n"
+
+asm(
+   ".text                            \n"
+   ".global femto_task_swap          \n"
+   ".type femto_task_swap, @function \n"
+   "femto_task_swap:                 \n"
+   "   addi sp, sp, -" FEMTO_TASK_STR(FEMTO_TASK_FRAME) "\n"
+   FEMTO_TASK_INT(sw)
+   FEMTO_TASK_FLOAT(fsw)
+   "   sw sp, 0(a0)                  \n"
+   "   mv sp, a1                     \n"
+   FEMTO_TASK_INT(lw)
+   FEMTO_TASK_FLOAT(flw)
+   "   addi sp, sp, " FEMTO_TASK_STR(FEMTO_TASK_FRAME) "\n"
+   "   ret                           \n"
+);
+
+static femto_task femto_task_main = { 0, &femto_task_main, 0, 0, 0 };
+
+femto_task* femto_task_current = &femto_task_main;
+
+/* Where the first femto_task_swap() to a new task returns */
+static void femto_task_entry() {
+   femto_task* task = femto_task_current;
+   task->fun(task->arg);
+   task->done = 1;
+   /* Removes the task from the list, and never comes back */
+   femto_task* prev = task;
+   while(prev->next != task) {
+      prev = prev->next;
+   }
+   prev->next = task->next;
+   femto_task_current = task->next;
+   uint32_t dead_sp;
+   femto_task_swap(&dead_sp, femto_task_current->sp);
+}
+
+void femto_task_start(
+   femto_task* task, void (*fun)(void* arg), void* arg,
+   void* stack, size_t stack_size
+) {
+   uint32_t sp = ((uint32_t)stack + stack_size) & ~15u;
+   sp -= FEMTO_TASK_FRAME;
+   uint32_t* frame = (uint32_t*)sp;
+   for(int i = 0; i < FEMTO_TASK_FRAME/4; ++i) {
+      frame[i] = 0;
+   }
+   frame[0] = (uint32_t)femto_task_entry; /* ra */
+   task->sp = sp;
+   task->fun = fun;
+   task->arg = arg;
+   task->done = 0;
+   /* Runs after the current task */
+   task->next = femto_task_current->next;
+   femto_task_current->next = task;
+}
+
+void femto_task_switch() {
+   femto_task* task = femto_task_current;
+   if(task->next == task) {
+      return;
+   }
+   femto_task_current = task->next;
+   femto_task_swap(&task->sp, femto_task_current->sp);
+}
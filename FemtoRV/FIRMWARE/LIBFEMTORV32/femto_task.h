@@ -0,0 +1,70 @@
+/*
+ * Cooperative tasks (stackful coroutines), to overlap the waits for the
+ * devices with computations: while a task waits for the SD card (card
+ * latency, programming) or for the FGA (busy, vertical blank), the
+ * drivers call femto_yield(), and the other tasks run.
+ *
+ *   static femto_task reader;
+ *   static uint32_t reader_stack[512];
+ *   femto_task_start(&reader, read_next_block, 0, reader_stack, sizeof(reader_stack));
+ *   ...
+ *   while(!block_ready) femto_yield();
+ *
+ * - the tasks run in turn, each one until it calls femto_yield() (no
+ *   preemption, no locks needed between two yields);
+ * - femto_yield() returns at once when there is no other task, so the
+ *   yield points of the drivers cost nearly nothing to the programs
+ *   that do not use tasks;
+ * - a task ends when its function returns (femto_task_join() waits for
+ *   it), main() is a task as well;
+ * - the yields are in the waits that last long enough to do something
+ *   else (hundreds of cycles at least), not in the transfer of each
+ *   byte.
+ *
+ * See the ST_NICCC_prefetch.elf example (EXAMPLES/ST_NICCC.c).
+ */
+
+#ifndef H__FEMTO_TASK__H
+#define H__FEMTO_TASK__H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct femto_task {
+   uint32_t sp;              /* saved stack pointer (used by the context switch) */
+   struct femto_task* next;  /* circular list of the running tasks */
+   void (*fun)(void* arg);
+   void* arg;
+   volatile int done;
+} femto_task;
+
+/* The current task (initially the task of main()) */
+extern femto_task* femto_task_current;
+
+/*
+ * Starts fun(arg) in a new task, with stack (stack_size bytes), the new
+ * task runs at the next femto_yield().
+ */
+void femto_task_start(
+   femto_task* task, void (*fun)(void* arg), void* arg,
+   void* stack, size_t stack_size
+);
+
+/* Lets the other tasks run (slow path of femto_yield()) */
+void femto_task_switch();
+
+/* Lets the other tasks run, if any */
+static inline void femto_yield() {
+   if(femto_task_current->next != femto_task_current) {
+      femto_task_switch();
+   }
+}
+
+/* Lets the other tasks run until task is done */
+static inline void femto_task_join(femto_task* task) {
+   while(!task->done) {
+      femto_task_switch();
+   }
+}
+
+#endif
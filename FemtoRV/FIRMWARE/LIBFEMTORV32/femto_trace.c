@@ -0,0 +1,61 @@
+#include <femto_trace.h>
+#include <femtorv32.h>
+
+/* Until femto_trace_init(): all the events go to the same place */
+static femto_trace_event femto_trace_dummy;
+
+femto_trace_buffer femto_trace = { &femto_trace_dummy, 0, 0 };
+
+void femto_trace_init(void* buffer, size_t size) {
+   uint32_t nb_events = size / sizeof(femto_trace_event);
+   if(nb_events == 0) {
+      femto_trace.events = &femto_trace_dummy;
+      femto_trace.mask = 0;
+   } else {
+      while(nb_events & (nb_events - 1)) {
+	 nb_events &= nb_events - 1; /* keeps the highest bit */
+      }
+      femto_trace.events = (femto_trace_event*)buffer;
+      femto_trace.mask = nb_events - 1;
+   }
+   femto_trace.index = 0;
+}
+
+/*
+ * Format (read by TOOLS/femto_trace_json):
+ *   #femto_trace begin <MHz> <counter bits> <events> <dropped events>
+ *   B|E <id> <cycles since the previous event>
+ *   ...
+ *   N <id> <name>
+ *   ...
+ *   #femto_trace end
+ */
+void femto_trace_dump(const char* const* names, int nb_names) {
+   uint32_t count = femto_trace.index;
+   uint32_t capacity = (femto_trace.events == &femto_trace_dummy) ? 0 : femto_trace.mask + 1;
+   uint32_t first = (count > capacity) ? count - capacity : 0;
+   uint32_t bits = FEMTORV32_COUNTER_BITS;
+   uint32_t lap_mask = (bits >= 32) ? ~0u : (1u << bits) - 1;
+
+   printf(
+      "#femto_trace begin %d %d %u %u\n",
+      FEMTORV32_FREQ, bits, count - first, first
+   );
+   uint32_t previous = 0;
+   for(uint32_t i = first; i < count; ++i) {
+      const femto_trace_event* event = femto_trace.events + (i & femto_trace.mask);
+      uint32_t delta = (i == first) ? 0 : (event->cycle - previous) & lap_mask;
+      previous = event->cycle;
+      printf(
+	 "%c %u %u\n", (event->tag & FEMTO_TRACE_END_BIT) ? 'E' : 'B',
+	 event->tag & ~FEMTO_TRACE_END_BIT, delta
+      );
+   }
+   for(int id = 0; names != 0 && id < nb_names; ++id) {
+      if(names[id] != 0) {
+	 printf("N %d %s\n", id, names[id]);
+      }
+   }
+   printf("#femto_trace end\n");
+   femto_trace.index = 0;
+}
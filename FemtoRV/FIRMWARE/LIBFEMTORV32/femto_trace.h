@@ -0,0 +1,89 @@
+/*
+ * Event tracing to a RAM ring buffer, to time the phases of a program
+ * on the hardware without printing while it runs.
+ *
+ * TRACE_BEGIN(id) / TRACE_END(id) record (id, rdcycle) in the ring
+ * buffer given to femto_trace_init(), in a few instructions (no call,
+ * no test). When the buffer is full, the oldest events are overwritten.
+ * After the measured run, femto_trace_dump() prints the events on the
+ * UART, and TOOLS/femto_trace_json converts the captured text into a
+ * Chrome trace (chrome://tracing, https://ui.perfetto.dev):
+ *
+ *   static femto_trace_event events[1024];
+ *   femto_trace_init(events, sizeof(events));
+ *   ...
+ *   TRACE_BEGIN(TRACE_RENDER); render(); TRACE_END(TRACE_RENDER);
+ *   ...
+ *   femto_trace_dump(names, nb_names);
+ *
+ * - ids are small integers (0 to 2^31-1), names[id] names them in the
+ *   dump (names can be NULL);
+ * - the events can be nested (BEGIN/END pairs of different ids);
+ * - the cycle counter may be narrower than 32 bits (NRV_COUNTER_WIDTH,
+ *   FEMTORV32_COUNTER_BITS): the dump unwraps it, provided two
+ *   consecutive events are less than one lap apart;
+ * - before femto_trace_init(), the events go to a one-event dummy
+ *   buffer, so that traced code can run untraced;
+ * - compiling with -DNO_FEMTO_TRACE removes the macros.
+ *
+ * See the ST_NICCC_trace.elf example (EXAMPLES/ST_NICCC.c).
+ */
+
+#ifndef H__FEMTO_TRACE__H
+#define H__FEMTO_TRACE__H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define FEMTO_TRACE_END_BIT 0x80000000u
+
+typedef struct {
+   uint32_t tag;   /* id, FEMTO_TRACE_END_BIT set for TRACE_END */
+   uint32_t cycle; /* rdcycle */
+} femto_trace_event;
+
+typedef struct {
+   femto_trace_event* events;
+   uint32_t mask;  /* number of events - 1 (a power of two - 1) */
+   uint32_t index; /* number of events recorded since the last reset */
+} femto_trace_buffer;
+
+extern femto_trace_buffer femto_trace;
+
+/*
+ * Uses buffer (size bytes, rounded down to a power of two number of
+ * events) for the events, and resets the trace.
+ */
+void femto_trace_init(void* buffer, size_t size);
+
+/* Forgets the recorded events */
+static inline void femto_trace_reset() {
+   femto_trace.index = 0;
+}
+
+/*
+ * Prints the last recorded events on the UART (printf()), between a
+ * "#femto_trace begin" and a "#femto_trace end" line, followed by
+ * names[0..nb_names-1] (can be NULL), then resets the trace.
+ */
+void femto_trace_dump(const char* const* names, int nb_names);
+
+static inline void femto_trace_record(uint32_t tag) {
+   uint32_t cycle;
+   asm volatile ("rdcycle %0" : "=r"(cycle));
+   uint32_t index = femto_trace.index;
+   femto_trace_event* event = femto_trace.events + (index & femto_trace.mask);
+   event->tag = tag;
+   event->cycle = cycle;
+   femto_trace.index = index + 1;
+}
+
+#ifdef NO_FEMTO_TRACE
+#define TRACE_BEGIN(id)
+#define TRACE_END(id)
+#else
+#define TRACE_BEGIN(id) femto_trace_record((uint32_t)(id))
+#define TRACE_END(id)   femto_trace_record((uint32_t)(id) | FEMTO_TRACE_END_BIT)
+#endif
+
+#endif
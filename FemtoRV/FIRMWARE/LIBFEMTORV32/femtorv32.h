@@ -17,12 +17,13 @@
 #endif
 
 /* Standard library */
-extern int  printf(const char *fmt,...); /* supports %s, %d, %x */
+extern int  printf(const char *fmt,...); /* supports %d %u %x %c %s, width, '-' and '0' flags */
 extern void exit(int);
 extern void abort();
 extern int  getchar();
 extern int  putchar(int c);
 extern int  puts(const char* s);
+extern int  putchars(const char* s, int len); /* writes len chars at once (see set_putsfunc()) */
 
 /* Timing */
 extern uint64_t cycles();            /* gets the number of cycles since last reset       (needs NRV_COUNTERS_64) */
@@ -44,14 +45,19 @@ extern int exec(const char* filename, int argc, char** argv);
 					* Executes a program from the SDCard. 
 					* Returns a non-zero number on error.
 					* does not return on success !
-					* Supports risc-v elves (.elf) and
-					* flat binaries (.bin).
+					* Supports risc-v elves (.elf),
+					* compressed executables (.elz)
+					* and flat pre-relocated
+					* executables (.fxe), see
+					* femto_elf.h.
 					*/
 /* Virtual I/O */
 typedef int (*putcharfunc_t)(int);
 typedef int (*getcharfunc_t)(void);
 void set_putcharfunc(putcharfunc_t fptr);
 void set_getcharfunc(getcharfunc_t fptr);
+typedef int (*putsfunc_t)(const char* s, int len); /* writes len chars, returns len */
+void set_putsfunc(putsfunc_t fptr); /* call after set_putcharfunc(), that resets it */
 
 /* Specialized print functions (but one can use printf() instead) */
 extern void print_string(const char* s);
@@ -59,10 +65,14 @@ extern void print_dec(int val);
 extern void print_hex_digits(unsigned int val, int digits);
 extern void print_hex(unsigned int val);
 
+/* Passed in a2 by exec() to the entry point of the program (see CRT/crt0_baremetal.S) */
+#define FEMTOS_EXEC_MAGIC 0x0E1FE1F0
+
 /* SDCard */
 int sd_init(); /* Return 0 on success, non-zero on failure */
 int sd_readsector(uint32_t sector, uint8_t* buffer, uint32_t sector_count); /* 1:success, 0:failure*/
 int sd_writesector(uint32_t sector, uint8_t* buffer, uint32_t sector_count); /* 1:success, 0:failure*/
+int sd_clock_khz(); /* SPI clock chosen by sd_init() (shift register), 0 if bitbanging */
 
 
 /********************* Memory-mapped IO *******************************************************/
@@ -86,6 +96,7 @@ int sd_writesector(uint32_t sector, uint8_t* buffer, uint32_t sector_count); /*
 #define IO_BUTTONS           IO_BIT_TO_OFFSET(IO_BUTTONS_bit)
 #define IO_FGA_CNTL          IO_BIT_TO_OFFSET(IO_FGA_CNTL_bit)
 #define IO_FGA_DAT           IO_BIT_TO_OFFSET(IO_FGA_DAT_bit)    
+#define IO_TIMER             IO_BIT_TO_OFFSET(IO_TIMER_bit)
 #define IO_HW_CONFIG_RAM     IO_BIT_TO_OFFSET(IO_HW_CONFIG_RAM_bit)
 #define IO_HW_CONFIG_DEVICES IO_BIT_TO_OFFSET(IO_HW_CONFIG_DEVICES_bit)
 #define IO_HW_CONFIG_CPUINFO IO_BIT_TO_OFFSET(IO_HW_CONFIG_CPUINFO_bit)
@@ -98,6 +109,12 @@ int sd_writesector(uint32_t sector, uint8_t* buffer, uint32_t sector_count); /*
 #define FEMTORV32_FREQ           ((IO_IN(IO_HW_CONFIG_CPUINFO) >> 16) & 1023)
 #define FEMTORV32_COUNTER_BITS    (IO_IN(IO_HW_CONFIG_CPUINFO) & 127)
 
+/* ISA extensions of the core (RTL/DEVICES/HardwareConfig.v), all zero with older bitstreams */
+#define FEMTORV32_CPUINFO_M_bit 8
+#define FEMTORV32_CPUINFO_F_bit 9
+#define FEMTORV32_CPUINFO_C_bit 10
+#define FEMTORV32_HAS_EXTENSION(bit) (IO_IN(IO_HW_CONFIG_CPUINFO) & (1 << bit))
+
 
 /* SSD1331/SSD1351 Oled display on 4-wire SPI bus */
 
@@ -137,9 +154,11 @@ extern void MAX7219(uint32_t address, uint32_t value);
 /* Mapped SPI FLASH */
 #define SPI_FLASH_BASE ((void*)(1 << 23))
 
-/* FAT_IO_LIB */
-#define USE_FILELIB_STDIO_COMPAT_NAMES
+/* FAT_IO_LIB, with buffered stdio names (femto_stdio.h) */
+#define USE_FEMTO_STDIO_COMPAT_NAMES
 #define FAT_INLINE inline
 #include <fat_io_lib/fat_filelib.h>
+#include <fat_io_lib/fat_cache.h> /* fatfs_cache_print_stats() */
+#include <femto_stdio.h>
 
 #endif
@@ -0,0 +1,57 @@
+#include <flash_assets.h>
+#include <femtorv32.h>
+#include <string.h>
+
+/*
+ * The pack is read where it is, through the mapped SPI flash (each
+ * access is a SPI transfer, but there are only a few of them to find
+ * a file).
+ */
+
+static const FlashAssets_Header* pack = 0;
+static const FlashAssets_Entry*  entries = 0;
+
+int flash_assets_init(uint32_t flash_offset) {
+  const FlashAssets_Header* header;
+  pack = 0;
+  entries = 0;
+  if(!FEMTOSOC_HAS_DEVICE(IO_MAPPED_SPI_FLASH_bit)) {
+    return -1;
+  }
+  header = (const FlashAssets_Header*)((const uint8_t*)SPI_FLASH_BASE + flash_offset);
+  if(header->magic != FLASH_ASSETS_MAGIC) {
+    return -1;
+  }
+  pack = header;
+  entries = (const FlashAssets_Entry*)(header + 1);
+  return (int)header->nb_assets;
+}
+
+const void* flash_asset_data(int i, uint32_t* size) {
+  if(pack == 0 || i < 0 || (uint32_t)i >= pack->nb_assets) {
+    return 0;
+  }
+  if(size) {
+    *size = entries[i].size;
+  }
+  return (const uint8_t*)pack + entries[i].offset;
+}
+
+const char* flash_asset_name(int i) {
+  if(pack == 0 || i < 0 || (uint32_t)i >= pack->nb_assets) {
+    return 0;
+  }
+  return entries[i].name;
+}
+
+const void* flash_asset(const char* name, uint32_t* size) {
+  if(pack == 0) {
+    return 0;
+  }
+  for(int i=0; (uint32_t)i<pack->nb_assets; ++i) {
+    if(!strncmp(entries[i].name, name, FLASH_ASSETS_NAME_LEN)) {
+      return flash_asset_data(i, size);
+    }
+  }
+  return 0;
+}
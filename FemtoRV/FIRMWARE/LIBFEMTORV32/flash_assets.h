@@ -0,0 +1,63 @@
+/*
+ * Data files stored in the SPI flash, read in place through the mapped
+ * SPI flash (RTL/DEVICES/MappedSPIFlash.v, NRV_IO_MAPPED_SPI_FLASH):
+ * flash_asset() returns a const pointer to the data, nothing is copied
+ * to RAM.
+ *
+ * The files are packed on the host by TOOLS/flash_assets_pack, then the
+ * pack is written to the flash at FLASH_ASSETS_OFFSET:
+ *   TOOLS/flash_assets_pack scene1.dat font.bin -out assets.img
+ *   ICEStick: iceprog -o 1M assets.img
+ *   ULX3S:    ujprog -j flash -f 1048576 assets.img
+ *
+ * Pack format (little endian): a FlashAssets_Header, nb_assets
+ * FlashAssets_Entry, then the data of the files, each one starting on
+ * a 4 bytes boundary (so that it can be read as an array of words).
+ */
+
+#ifndef H__FLASH_ASSETS__H
+#define H__FLASH_ASSETS__H
+
+#include <stdint.h>
+
+#define FLASH_ASSETS_MAGIC    0x53534146 /* "FASS" */
+#define FLASH_ASSETS_NAME_LEN 24         /* including the terminal zero */
+
+/*
+ * Flash address of the pack (after the FPGA configuration, same place
+ * as the ST-NICCC data of ST_NICCC_spi_flash.c).
+ */
+#ifndef FLASH_ASSETS_OFFSET
+#define FLASH_ASSETS_OFFSET   (1024*1024)
+#endif
+
+typedef struct {
+  uint32_t magic;
+  uint32_t nb_assets;
+} FlashAssets_Header;
+
+typedef struct {
+  char     name[FLASH_ASSETS_NAME_LEN];
+  uint32_t offset; /* from the start of the pack */
+  uint32_t size;   /* in bytes                   */
+} FlashAssets_Entry;
+
+/*
+ * Finds the pack at flash address flash_offset. Returns the number of
+ * files in it, or -1 if the SoC has no mapped SPI flash or if there is
+ * no pack there.
+ */
+int flash_assets_init(uint32_t flash_offset);
+
+/*
+ * Returns a pointer to the data of a file of the pack (in the address
+ * space of the mapped SPI flash, read-only) and its size in *size (if
+ * size is not NULL), or NULL if there is no such file.
+ */
+const void* flash_asset(const char* name, uint32_t* size);
+
+/* Name, data and size of the i-th file of the pack (NULL if out of range) */
+const char* flash_asset_name(int i);
+const void* flash_asset_data(int i, uint32_t* size);
+
+#endif
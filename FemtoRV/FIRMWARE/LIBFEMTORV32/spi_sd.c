@@ -4,15 +4,33 @@
 // http://www.dejazzer.com/ee379/lecture_notes/lec12_sd_card.pdf (info on SDCards and FAT filesystem)
 
 #include <femtorv32.h>
+#include <femto_task.h>
 
-// For now, does software bitbanging.
-// TODO: a hardware shift register, will be cleaner...
+// Uses the shift register of the SDCard device (RTL/DEVICES/SDCard.v)
+// if present, one IO write and a few polling reads per byte. Else does
+// software bitbanging (older SDCard device, and chip select in both
+// cases).
+// The waits for the card (read latency, busy while programming) let the
+// other tasks run (femto_yield(), femto_task.h).
 
 #define MOSI_MASK 1
 #define CLK_MASK  2
 #define CSN_MASK  4
 
+#define SPI_HW_XFER     (1 << 8)    /* write: send wdata[7:0] */
+#define SPI_HW_DIVIDER  (1 << 9)    /* write: SPI clock divider = wdata[7:0] */
+#define SPI_HW_BUSY     (1 << 16)   /* read: transfer in progress */
+#define SPI_HW_PRESENT  (1u << 31)  /* read: shift register present */
+
+#define SPI_HW_INIT_KHZ 400         /* SPI clock during initialization */
+#define SPI_HW_MAX_KHZ  25000       /* fastest SPI clock tried by sd_calibrate() */
+
+#define SPI_MAX_DELAY   64          /* slowest bitbanging tried by sd_calibrate() */
+
 int spi_state = CSN_MASK;
+static int spi_hw = 0;
+static int spi_khz = 0;             /* SPI clock of the shift register */
+static int spi_delay = 0;           /* bitbanging half period, see CLK_DELAY() */
 
 static inline void CS_H() {
     spi_state |= CSN_MASK;
@@ -45,16 +63,37 @@ static inline void MOSI_L() {
 }
 
 static inline int MISO() {
-    return IO_IN(IO_SDCARD);
+    return IO_IN(IO_SDCARD) & 1;
+}
+
+// Sends d and returns the received byte, with the shift register
+static inline uint8_t spi_hw_transfer(uint8_t d) {
+    uint32_t status;
+    IO_OUT(IO_SDCARD, SPI_HW_XFER | d);
+    while((status = IO_IN(IO_SDCARD)) & SPI_HW_BUSY);
+    return (uint8_t)(status >> 8);
+}
+
+// Sets the SPI clock of the shift register to at most kHz
+static void spi_hw_set_clock(int kHz) {
+    int divider = (FEMTORV32_FREQ * 1000 + 2 * kHz - 1) / (2 * kHz) - 1;
+    if(divider < 0) {
+	divider = 0;
+    }
+    if(divider > 255) {
+	divider = 255;
+    }
+    IO_OUT(IO_SDCARD, SPI_HW_DIVIDER | divider);
+    spi_khz = FEMTORV32_FREQ * 1000 / (2 * (divider + 1));
 }
 
+// Bitbanging half period: spi_delay iterations of an empty loop, 0
+// (as fast as the IO writes go) unless sd_calibrate() found that the
+// card does not follow.
 static inline void CLK_DELAY() {
- // Place holder to limit bigbanging
- // frequency. 
- // Since FemtoRV runs at 80 MHz 
- // with 3 to 4 CPIs, there is very 
- // little chance that we reach 
- // SDCard maxfreq.
+    for(int i=spi_delay; i>0; --i) {
+	__asm__ __volatile__("");
+    }
 }
 
 static inline void DLY_US(int t) {
@@ -62,6 +101,10 @@ static inline void DLY_US(int t) {
 }
 
 void spi_send (uint8_t d) {
+    if(spi_hw) {
+	spi_hw_transfer(d);
+	return;
+    }
     if (d & 0x80) MOSI_H(); else MOSI_L();    // bit7 
     CK_H(); CLK_DELAY(); CK_L(); CLK_DELAY();
     if (d & 0x40) MOSI_H(); else MOSI_L();    // bit6 
@@ -82,6 +125,9 @@ void spi_send (uint8_t d) {
 
 uint8_t spi_receive () {
     uint8_t r;
+    if(spi_hw) {
+	return spi_hw_transfer(0xFF);
+    }
     MOSI_H();    // Send 0xFF while receiving 
     r = 0;   if (MISO()) r++;    // bit7 
     CK_H(); CLK_DELAY(); CK_L(); CLK_DELAY();
@@ -109,6 +155,12 @@ uint8_t spi_sendrecv(uint8_t cmd) {
 
 void spi_readblock(uint8_t *ptr, int length) {
     int i;
+    if(spi_hw) {
+	for (i=0;i<length;i++) {
+	    *ptr++ = spi_hw_transfer(0xFF);
+	}
+	return;
+    }
     for (i=0;i<length;i++) {
         *ptr++ = spi_receive();
     }
@@ -125,8 +177,11 @@ void spi_writeblock(uint8_t *ptr, int length) {
 #define CMD0_GO_IDLE_STATE              0
 #define CMD1_SEND_OP_COND               1
 #define CMD8_SEND_IF_COND               8
+#define CMD12_STOP_TRANSMISSION         12
 #define CMD17_READ_SINGLE_BLOCK         17
+#define CMD18_READ_MULTIPLE_BLOCK       18
 #define CMD24_WRITE_SINGLE_BLOCK        24
+#define CMD25_WRITE_MULTIPLE_BLOCK      25
 #define CMD32_ERASE_WR_BLK_START        32
 #define CMD33_ERASE_WR_BLK_END          33
 #define CMD38_ERASE                     38
@@ -146,6 +201,8 @@ void spi_writeblock(uint8_t *ptr, int length) {
 #define ACMD41_HOST_SUPPORTS_SDHC       0x40000000
 
 #define CMD_START_OF_BLOCK              0xFE
+#define CMD_START_OF_MULTIPLE_BLOCK     0xFC
+#define CMD_STOP_TRAN                   0xFD
 #define CMD_DATA_ACCEPTED               0x05
 
 static int sdhc_card = 0;
@@ -158,7 +215,9 @@ uint8_t sd_send_command(uint8_t cmd, uint32_t arg) {
     if(!sdhc_card) {
         switch (cmd) {
             case CMD17_READ_SINGLE_BLOCK:
+            case CMD18_READ_MULTIPLE_BLOCK:
             case CMD24_WRITE_SINGLE_BLOCK:
+            case CMD25_WRITE_MULTIPLE_BLOCK:
             case CMD32_ERASE_WR_BLK_START:
             case CMD33_ERASE_WR_BLK_END:
 		arg *= 512;
@@ -206,11 +265,95 @@ uint8_t sd_send_command(uint8_t cmd, uint32_t arg) {
     return response;
 }
 
+// CRC16 (CCITT, x^16+x^12+x^5+1) of the data blocks, that the card
+// sends after each block, also in SPI mode.
+static uint16_t sd_crc16(uint16_t crc, uint8_t d) {
+    crc ^= (uint16_t)d << 8;
+    for(int i=0; i<8; ++i) {
+	crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+    return crc;
+}
+
+// Reads block 0 and checks it against its CRC16, without a buffer.
+// Returns 1 if the block was received without error, 0 otherwise.
+static int sd_check_read() {
+    uint8_t response;
+    uint16_t crc = 0;
+    int retries = 0;
+    response = sd_send_command(CMD17_READ_SINGLE_BLOCK, 0);
+    if(response != 0x00) {
+	return 0;
+    }
+    while(spi_receive() != CMD_START_OF_BLOCK) {
+	if(retries > 5000) {
+	    return 0;
+	}
+	++retries;
+    }
+    for(int i=0; i<512; ++i) {
+	crc = sd_crc16(crc, spi_receive());
+    }
+    crc ^= (uint16_t)spi_receive() << 8;
+    crc ^= spi_receive();
+    spi_send(0xFF);
+    return crc == 0;
+}
+
+// Tries the SPI rates from the fastest one, and keeps the first one at
+// which a few reads of block 0 match their CRC. The shift register
+// halves its clock from SPI_HW_MAX_KHZ, bitbanging doubles spi_delay
+// from 0. Falls back to the initialization clock (shift register) or
+// to SPI_MAX_DELAY (bitbanging) if none of them does.
+static void sd_calibrate() {
+    int khz = SPI_HW_MAX_KHZ;
+    spi_delay = 0;
+    for(;;) {
+	int ok = 1;
+	if(spi_hw) {
+	    spi_hw_set_clock(khz);
+	}
+	for(int i=0; i<4 && ok; ++i) {
+	    ok = sd_check_read();
+	}
+	if(ok) {
+	    return;
+	}
+	// Let the card finish what it understood of the last command
+	for(int i=0; i<16; ++i) {
+	    spi_send(0xFF);
+	}
+	if(spi_hw) {
+	    khz /= 2;
+	    if(khz < 1000) {
+		spi_hw_set_clock(SPI_HW_INIT_KHZ);
+		return;
+	    }
+	} else {
+	    spi_delay = spi_delay ? 2 * spi_delay : 1;
+	    if(spi_delay > SPI_MAX_DELAY) {
+		spi_delay = SPI_MAX_DELAY;
+		return;
+	    }
+	}
+    }
+}
+
+int sd_clock_khz() {
+    return spi_hw ? spi_khz : 0;
+}
+
 int _sd_init() {
     int retries = 0;
     uint8_t response = 0xFF;
     uint8_t sd_version;
     delay(2);
+
+    spi_hw = (IO_IN(IO_SDCARD) & SPI_HW_PRESENT) != 0;
+    spi_delay = SPI_MAX_DELAY;
+    if(spi_hw) {
+	spi_hw_set_clock(SPI_HW_INIT_KHZ);
+    }
     
     CS_H();
     MOSI_H();
@@ -282,6 +425,8 @@ int _sd_init() {
        // Standard density only
        sdhc_card = 0;
     }
+
+    sd_calibrate();
     return 0;
 }
 
@@ -297,44 +442,173 @@ int sd_init() {
     return result;
 }
 
-int sd_readsector(uint32_t start_block, uint8_t *buffer, uint32_t sector_count) {
+// Waits for the start of block indicator, reads a 512 bytes block
+// and its (ignored) CRC. Returns 1 on success, 0 on timeout.
+static int sd_readblock(uint8_t *buffer) {
+    int retries = 0;
+    // Wait for start of block indicator
+    while(spi_receive() != CMD_START_OF_BLOCK) {
+	// Timeout
+	if(retries > 5000) {
+	    printf("sd_readsector: Timeout\n");
+	    return 0;
+	}
+	++retries;
+	femto_yield();
+    }
+
+    // Perform block read (512 bytes)
+    spi_readblock(buffer, 512);
+
+    // Ignore 16-bit CRC
+    spi_receive();
+    spi_receive();
+    return 1;
+}
+
+// Ends a CMD18 multiple block read. Returns 1 on success, 0 on failure.
+static int sd_stop_transmission() {
     uint8_t response;
-    uint32_t ctrl;
     int retries = 0;
-    int i;
+
+    spi_send(CMD12_STOP_TRANSMISSION | CMD_START_BITS);
+    spi_send(0);
+    spi_send(0);
+    spi_send(0);
+    spi_send(0);
+    spi_send(0xFF); // CRC is ignored in SPI mode 
+
+    // Skip the stuff byte (the end of the interrupted block), and wait
+    // for the R1 response
+    spi_receive();
+    while((response = spi_receive()) == 0xFF) {
+	if(retries > 500) {
+	    break;
+	}
+	++retries;
+    }
+    if(response != 0x00) {
+	printf("sd_readsector: Bad CMD12 response %x\n", response);
+	return 0;
+    }
+
+    // R1b: wait while busy (MISO held low)
+    retries = 0;
+    while(spi_receive() == 0) {
+	if(retries > 5000) {
+	    printf("sd_readsector: Timeout\n");
+	    return 0;
+	}
+	++retries;
+	femto_yield();
+    }
+    return 1;
+}
+
+int sd_readsector(uint32_t start_block, uint8_t *buffer, uint32_t sector_count) {
+    uint8_t response;
     if (sector_count == 0) {
         return 0;
     }
-    while (sector_count--) {
+
+    if (sector_count == 1) {
         // Request block read
-        response = sd_send_command(CMD17_READ_SINGLE_BLOCK, start_block++);
+        response = sd_send_command(CMD17_READ_SINGLE_BLOCK, start_block);
         if(response != 0x00) {
             printf("sd_readsector: Bad response %x\n", response);
             return 0;
         }
+	if(!sd_readblock(buffer)) {
+	    return 0;
+	}
+        // Additional 8 SPI clocks
+        spi_sendrecv(0xFF);
+	return 1;
+    }
 
-        // Wait for start of block indicator
-        while(spi_receive() != CMD_START_OF_BLOCK) {
-            // Timeout
-	    if(retries > 5000) {
-                printf("sd_readsector: Timeout\n");
-                return 0;
-            }
-	    ++retries;
-        }
+    // Several blocks: request a multiple block read, the card sends
+    // the blocks one after the other until CMD12
+    response = sd_send_command(CMD18_READ_MULTIPLE_BLOCK, start_block);
+    if(response != 0x00) {
+	printf("sd_readsector: Bad response %x\n", response);
+	return 0;
+    }
+    while (sector_count--) {
+	if(!sd_readblock(buffer)) {
+	    sd_stop_transmission();
+	    return 0;
+	}
+        buffer += 512;
+    }
+    if(!sd_stop_transmission()) {
+	return 0;
+    }
 
-        // Perform block read (512 bytes)
-        spi_readblock(buffer, 512);
+    // Additional 8 SPI clocks
+    spi_send(0xFF);
+    return 1;
+}
 
-        buffer += 512;
+// Waits while the card is busy programming (MISO held low).
+// Returns 1 on success, 0 on timeout.
+static int sd_wait_not_busy() {
+    int retries = 0;
+    while(spi_sendrecv(0xFF) == 0) {
+	if(retries > 5000) {
+	    printf("sd_writesector: Timeout\n");
+	    return 0;
+	}
+	++retries;
+	femto_yield();
+    }
+    return 1;
+}
 
-        // Ignore 16-bit CRC
-        spi_receive();
-        spi_receive();
+// Several blocks: one CMD25 multiple block write, each block is sent
+// after a start of block token (the card programs them while the next
+// ones arrive), and the stop token ends the transfer. Returns 1 on
+// success, 0 on failure.
+static int sd_writesectors(uint32_t start_block, uint8_t *buffer, uint32_t sector_count) {
+    uint8_t response;
 
-        // Additional 8 SPI clocks
-        spi_sendrecv(0xFF);
+    response = sd_send_command(CMD25_WRITE_MULTIPLE_BLOCK, start_block);
+    if(response != 0x00) {
+	printf("sd_writesector: Bad response %x\n", response);
+	return 0;
     }
+
+    while (sector_count--) {
+	spi_send(CMD_START_OF_MULTIPLE_BLOCK);
+	spi_writeblock(buffer, 512);
+	buffer += 512;
+
+	// Send CRC (ignored)
+	spi_send(0xff);
+	spi_send(0xff);
+
+	response = spi_receive();
+	if((response & 0x1f) != CMD_DATA_ACCEPTED) {
+	    printf("sd_writesector: Data rejected %x\n", response);
+	    spi_send(CMD_STOP_TRAN);
+	    spi_send(0xff);
+	    sd_wait_not_busy();
+	    return 0;
+	}
+
+	if(!sd_wait_not_busy()) {
+	    return 0;
+	}
+    }
+
+    // Stop token, then one byte before the card signals busy
+    spi_send(CMD_STOP_TRAN);
+    spi_send(0xff);
+    if(!sd_wait_not_busy()) {
+	return 0;
+    }
+
+    // Additional 8 SPI clocks
+    spi_send(0xff);
     return 1;
 }
 
@@ -343,6 +617,10 @@ int sd_writesector(uint32_t start_block, uint8_t *buffer, uint32_t sector_count)
     int retries = 0;
     int i;
 
+    if (sector_count > 1) {
+	return sd_writesectors(start_block, buffer, sector_count);
+    }
+
     while (sector_count--) {
         // Request block write
         response = sd_send_command(CMD24_WRITE_SINGLE_BLOCK, start_block++);
@@ -378,6 +656,7 @@ int sd_writesector(uint32_t start_block, uint8_t *buffer, uint32_t sector_count)
                 return 0;
             }
 	    ++retries;
+	    femto_yield();
         }
 
         // Additional 8 SPI clocks
@@ -393,6 +672,7 @@ int sd_writesector(uint32_t start_block, uint8_t *buffer, uint32_t sector_count)
                 return 0;
             }
 	    ++retries;
+	    femto_yield();
         }
     }
 
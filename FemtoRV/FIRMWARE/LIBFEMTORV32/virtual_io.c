@@ -2,12 +2,23 @@
 
 extern int UART_putchar(int);
 extern int UART_getchar();
+extern int UART_putchars(const char*, int);
 
 static putcharfunc_t putcharfunc = UART_putchar; 
 static getcharfunc_t getcharfunc = UART_getchar; 
+static putsfunc_t    putsfunc    = UART_putchars;
 
+/* 
+ * Also resets the putsfunc: a tty that only has a putchar()
+ * gets putchars() done by calling it for each char.
+ */
 void set_putcharfunc(putcharfunc_t f) {
    putcharfunc = f;
+   putsfunc = 0;
+}
+
+void set_putsfunc(putsfunc_t f) {
+   putsfunc = f;
 }
 
 void set_getcharfunc(getcharfunc_t f) {
@@ -18,6 +29,16 @@ int putchar(int c) {
    return (*putcharfunc)(c);
 }
 
+int putchars(const char* s, int len) {
+   if(putsfunc) {
+      return (*putsfunc)(s, len);
+   }
+   for(int i=0; i<len; ++i) {
+      (*putcharfunc)(s[i]);
+   }
+   return len;
+}
+
 int getchar() {
   return (*getcharfunc)();
 }
@@ -0,0 +1,295 @@
+/**
+ * Converts an ELF executable into a compressed executable (.elz),
+ * loaded by femto_elf.c (FemtOS exec()) and lite_elf.c (LiteOS run).
+ * Each PT_LOAD segment is compressed as one LZ4 block (see Elz_Header
+ * in LIBFEMTORV32/femto_elf.h for the format). ELF files without
+ * program headers are stored as a single segment, from the text
+ * address to the max address.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+
+#include <femto_elf.h>
+
+/*********************************************************************/
+
+/**
+ * \brief Reads a whole file
+ * \param[in] filename the name of the file
+ * \param[out] data the content of the file
+ * \retval true if the file could be read
+ * \retval false otherwise
+ */
+bool read_file(const std::string& filename, std::vector<uint8_t>& data) {
+    FILE* f = fopen(filename.c_str(), "rb");
+    if(f == nullptr) {
+	return false;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    data.resize(size_t(size));
+    bool result = (fread(data.data(), 1, data.size(), f) == data.size());
+    fclose(f);
+    return result;
+}
+
+/**
+ * \brief Gets a little-endian 32 bits word
+ */
+inline uint32_t get_word(const std::vector<uint8_t>& data, size_t addr) {
+    return uint32_t(data[addr])           |
+	   (uint32_t(data[addr+1]) << 8)  |
+	   (uint32_t(data[addr+2]) << 16) |
+	   (uint32_t(data[addr+3]) << 24) ;
+}
+
+/**
+ * \brief Gets a little-endian 16 bits word
+ */
+inline uint32_t get_half(const std::vector<uint8_t>& data, size_t addr) {
+    return uint32_t(data[addr]) | (uint32_t(data[addr+1]) << 8);
+}
+
+/**
+ * \brief Appends a little-endian 32 bits word
+ */
+inline void put_word(std::vector<uint8_t>& out, uint32_t w) {
+    out.push_back(uint8_t(w));
+    out.push_back(uint8_t(w >> 8));
+    out.push_back(uint8_t(w >> 16));
+    out.push_back(uint8_t(w >> 24));
+}
+
+/*********************************************************************/
+
+/**
+ * \brief Appends an LZ4 length extension (after a 15 in the token)
+ */
+void lz4_put_length(std::vector<uint8_t>& out, size_t len) {
+    while(len >= 255) {
+	out.push_back(255);
+	len -= 255;
+    }
+    out.push_back(uint8_t(len));
+}
+
+/**
+ * \brief Appends an LZ4 sequence
+ * \param[in] literals, nb_literals the bytes to be copied
+ * \param[in] offset, match_len the match that follows the literals,
+ *  match_len is 0 for the last sequence (literals only)
+ */
+void lz4_put_sequence(
+    std::vector<uint8_t>& out,
+    const uint8_t* literals, size_t nb_literals,
+    size_t offset, size_t match_len
+) {
+    size_t ml = (match_len == 0) ? 0 : match_len - 4;
+    uint8_t token = uint8_t(
+	((nb_literals >= 15 ? 15 : nb_literals) << 4) | (ml >= 15 ? 15 : ml)
+    );
+    out.push_back(token);
+    if(nb_literals >= 15) {
+	lz4_put_length(out, nb_literals - 15);
+    }
+    out.insert(out.end(), literals, literals + nb_literals);
+    if(match_len == 0) {
+	return;
+    }
+    out.push_back(uint8_t(offset));
+    out.push_back(uint8_t(offset >> 8));
+    if(ml >= 15) {
+	lz4_put_length(out, ml - 15);
+    }
+}
+
+/**
+ * \brief Compresses a buffer as an LZ4 block
+ * \details Greedy parsing with a hash table of the last position of
+ *  each 4-bytes sequence. Follows the end-of-block rules of the LZ4
+ *  format (last 5 bytes are literals, no match starts in the last
+ *  12 bytes), so that the blocks can also be decoded by lz4 tools.
+ */
+void lz4_compress(const uint8_t* src, size_t size, std::vector<uint8_t>& out) {
+    const size_t MIN_MATCH     = 4;
+    const size_t LAST_LITERALS = 5;
+    const size_t MF_LIMIT      = 12;
+    const size_t MAX_OFFSET    = 65535;
+    const int    HASH_BITS     = 16;
+
+    if(size == 0) {
+	return;
+    }
+
+    std::vector<int64_t> table(size_t(1) << HASH_BITS, -1);
+    size_t anchor = 0;
+    size_t i = 0;
+
+    while(size > MF_LIMIT && i < size - MF_LIMIT) {
+	uint32_t seq;
+	memcpy(&seq, src + i, 4);
+	uint32_t h = (seq * 2654435761u) >> (32 - HASH_BITS);
+	int64_t ref = table[h];
+	table[h] = int64_t(i);
+	if(
+	    ref < 0 || i - size_t(ref) > MAX_OFFSET ||
+	    memcmp(src + ref, src + i, MIN_MATCH)
+	) {
+	    ++i;
+	    continue;
+	}
+	size_t len = MIN_MATCH;
+	size_t max_len = size - LAST_LITERALS - i;
+	while(len < max_len && src[size_t(ref) + len] == src[i + len]) {
+	    ++len;
+	}
+	lz4_put_sequence(out, src + anchor, i - anchor, i - size_t(ref), len);
+	i += len;
+	anchor = i;
+    }
+    lz4_put_sequence(out, src + anchor, size - anchor, 0, 0);
+}
+
+/*********************************************************************/
+
+/**
+ * \brief A segment to be written in the .elz file
+ */
+struct Segment {
+    uint32_t vaddr;
+    uint32_t memsz;
+    std::vector<uint8_t> data;
+};
+
+/**
+ * \brief Gets the PT_LOAD segments of an ELF file
+ * \retval true on success
+ * \retval false if the program headers are invalid
+ */
+bool get_segments(
+    const std::vector<uint8_t>& elf, std::vector<Segment>& segments
+) {
+    const uint32_t PT_LOAD = 1;
+    if(elf.size() < 52) {
+	return false;
+    }
+    uint32_t phoff     = get_word(elf, 28);
+    uint32_t phentsize = get_half(elf, 42);
+    uint32_t phnum     = get_half(elf, 44);
+    for(uint32_t i=0; i<phnum; ++i) {
+	size_t ph = size_t(phoff) + size_t(i) * phentsize;
+	if(phentsize < 32 || ph + 32 > elf.size()) {
+	    return false;
+	}
+	if(get_word(elf, ph) != PT_LOAD) {
+	    continue;
+	}
+	uint32_t offset = get_word(elf, ph + 4);
+	uint32_t filesz = get_word(elf, ph + 16);
+	Segment S;
+	S.vaddr = get_word(elf, ph + 8);
+	S.memsz = get_word(elf, ph + 20);
+	if(S.memsz == 0) {
+	    continue;
+	}
+	if(size_t(offset) + filesz > elf.size() || filesz > S.memsz) {
+	    return false;
+	}
+	S.data.assign(elf.begin() + offset, elf.begin() + offset + filesz);
+	segments.push_back(S);
+    }
+    return true;
+}
+
+/*********************************************************************/
+
+int main(int argc, char** argv) {
+    std::string in_filename;
+    std::string out_filename;
+
+    if(argc == 4 && !strcmp(argv[2],"-out")) {
+	in_filename = argv[1];
+	out_filename = argv[3];
+    } else {
+	std::cerr << "usage: " << argv[0] << " in.elf -out out.elz"
+		  << std::endl;
+	return -1;
+    }
+
+    Elf32Info info;
+    if(elf32_stat(in_filename.c_str(), &info) != ELF32_OK) {
+	std::cerr << "Could not parse " << in_filename << std::endl;
+	return -1;
+    }
+
+    std::vector<uint8_t> elf;
+    if(!read_file(in_filename, elf)) {
+	std::cerr << "Could not read " << in_filename << std::endl;
+	return -1;
+    }
+
+    std::vector<Segment> segments;
+    if(!get_segments(elf, segments)) {
+	std::cerr << "Invalid program headers in " << in_filename << std::endl;
+	return -1;
+    }
+
+    // No program headers: load the sections and keep
+    // [text_address, max_address) as a single segment.
+    if(segments.empty() && info.max_address > info.text_address) {
+	std::vector<uint8_t> RAM(info.max_address, 0);
+	if(elf32_load_at(in_filename.c_str(), &info, RAM.data()) != ELF32_OK) {
+	    std::cerr << "Could not load " << in_filename << std::endl;
+	    return -1;
+	}
+	Segment S;
+	S.vaddr = info.text_address;
+	S.memsz = info.max_address - info.text_address;
+	S.data.assign(RAM.begin() + info.text_address, RAM.end());
+	segments.push_back(S);
+    }
+
+    std::vector<uint8_t> out;
+    put_word(out, ELZ_MAGIC);
+    put_word(out, info.entry_address);
+    put_word(out, info.text_address);
+    put_word(out, info.max_address);
+    put_word(out, uint32_t(segments.size()));
+
+    size_t total_size = 0;
+    for(const Segment& S: segments) {
+	std::vector<uint8_t> compressed;
+	lz4_compress(S.data.data(), S.data.size(), compressed);
+	put_word(out, S.vaddr);
+	put_word(out, uint32_t(S.data.size()));
+	put_word(out, S.memsz);
+	put_word(out, uint32_t(compressed.size()));
+	out.insert(out.end(), compressed.begin(), compressed.end());
+	total_size += S.data.size();
+    }
+
+    FILE* f = fopen(out_filename.c_str(), "wb");
+    if(
+	f == nullptr ||
+	fwrite(out.data(), 1, out.size(), f) != out.size()
+    ) {
+	std::cerr << "Could not write " << out_filename << std::endl;
+	if(f != nullptr) {
+	    fclose(f);
+	}
+	return -1;
+    }
+    fclose(f);
+
+    std::cout << "   segments: " << segments.size()
+	      << "  data: " << total_size << " bytes"
+	      << "  elf: " << elf.size() << " bytes"
+	      << "  elz: " << out.size() << " bytes" << std::endl;
+    return 0;
+}
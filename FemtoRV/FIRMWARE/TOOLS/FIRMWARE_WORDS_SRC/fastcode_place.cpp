@@ -0,0 +1,276 @@
+/**
+ * Profile-guided placement of functions in the .fastcode RAM section
+ * for the programs executed from SPI flash (IceStick).
+ * Reads a PC-sample histogram (the .prof flat profile of the simulators,
+ * femtorv32_systemc 'elf_run -p N', or any file with
+ * "samples function" lines, e.g. measured with the cycle counters),
+ * gets the size of the functions from the symbols of the ELF executable,
+ * and chooses the functions with the most samples per byte that fit in
+ * the budget. Generates a linker script fragment, included by
+ * CRT/spiflash_icestick.ld in the .data_and_fastcode section (the
+ * program needs to be compiled with -ffunction-sections, make
+ * FASTCODE_PROFILE=file.prof, see makefile.inc).
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+
+/*********************************************************************/
+
+/**
+ * \brief A function of the executable, with its profile
+ */
+struct Function {
+    std::string name;
+    uint32_t address = 0;
+    uint32_t size = 0;
+    uint64_t samples = 0;
+};
+
+/**
+ * \brief Reads a whole file
+ * \retval true if the file could be read
+ * \retval false otherwise
+ */
+bool read_file(const std::string& filename, std::vector<uint8_t>& data) {
+    FILE* f = fopen(filename.c_str(), "rb");
+    if(f == nullptr) {
+	return false;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    data.resize(size_t(size));
+    bool result = (fread(data.data(), 1, data.size(), f) == data.size());
+    fclose(f);
+    return result;
+}
+
+inline uint32_t get_word(const std::vector<uint8_t>& data, size_t addr) {
+    return uint32_t(data[addr])           |
+	   (uint32_t(data[addr+1]) << 8)  |
+	   (uint32_t(data[addr+2]) << 16) |
+	   (uint32_t(data[addr+3]) << 24) ;
+}
+
+inline uint32_t get_half(const std::vector<uint8_t>& data, size_t addr) {
+    return uint32_t(data[addr]) | (uint32_t(data[addr+1]) << 8);
+}
+
+/**
+ * \brief Gets the function symbols (STT_FUNC, with a size) of an
+ *  ELF32 executable
+ * \retval true on success
+ * \retval false if the file could not be read or has no symbols
+ */
+bool load_functions(
+    const std::string& filename, std::map<std::string, Function>& functions
+) {
+    const uint32_t SHT_SYMTAB = 2;
+    const uint32_t STT_FUNC   = 2;
+    std::vector<uint8_t> elf;
+    if(!read_file(filename, elf) || elf.size() < 52) {
+	return false;
+    }
+    uint32_t shoff     = get_word(elf, 32);
+    uint32_t shentsize = get_half(elf, 46);
+    uint32_t shnum     = get_half(elf, 48);
+    if(shentsize < 40 || size_t(shoff) + size_t(shnum) * shentsize > elf.size()) {
+	return false;
+    }
+    bool found = false;
+    for(uint32_t i=0; i<shnum; ++i) {
+	size_t sh = size_t(shoff) + size_t(i) * shentsize;
+	if(get_word(elf, sh + 4) != SHT_SYMTAB) {
+	    continue;
+	}
+	uint32_t symoff  = get_word(elf, sh + 16);
+	uint32_t symsize = get_word(elf, sh + 20);
+	uint32_t link    = get_word(elf, sh + 24);
+	if(link >= shnum) {
+	    return false;
+	}
+	size_t strsh = size_t(shoff) + size_t(link) * shentsize;
+	uint32_t stroff  = get_word(elf, strsh + 16);
+	uint32_t strsize = get_word(elf, strsh + 20);
+	if(
+	    size_t(symoff) + symsize > elf.size() ||
+	    size_t(stroff) + strsize > elf.size()
+	) {
+	    return false;
+	}
+	for(size_t s = symoff; s + 16 <= size_t(symoff) + symsize; s += 16) {
+	    uint32_t name  = get_word(elf, s);
+	    uint32_t value = get_word(elf, s + 4);
+	    uint32_t size  = get_word(elf, s + 8);
+	    uint8_t  info  = elf[s + 12];
+	    if((info & 15) != STT_FUNC || size == 0 || name >= strsize) {
+		continue;
+	    }
+	    Function F;
+	    F.name = std::string(
+		(const char*)&elf[stroff + name],
+		strnlen((const char*)&elf[stroff + name], strsize - name)
+	    );
+	    F.address = value;
+	    F.size = size;
+	    functions[F.name] = F;
+	    found = true;
+	}
+    }
+    return found;
+}
+
+/**
+ * \brief Reads a flat profile
+ * \details Lines starting with '#' are comments. Other lines end with
+ *  "samples function" (the .prof files of the simulators have the
+ *  percentage of time first).
+ * \retval true if the file could be read
+ * \retval false otherwise
+ */
+bool load_profile(
+    const std::string& filename, std::map<std::string, Function>& functions,
+    uint64_t& total_samples
+) {
+    std::ifstream in(filename);
+    if(!in) {
+	return false;
+    }
+    std::string line;
+    total_samples = 0;
+    while(std::getline(in, line)) {
+	if(line.empty() || line[0] == '#') {
+	    continue;
+	}
+	std::istringstream words(line);
+	std::vector<std::string> W;
+	std::string w;
+	while(words >> w) {
+	    W.push_back(w);
+	}
+	if(W.size() < 2) {
+	    continue;
+	}
+	uint64_t samples = strtoull(W[W.size()-2].c_str(), nullptr, 10);
+	total_samples += samples;
+	auto it = functions.find(W.back());
+	if(it != functions.end()) {
+	    it->second.samples += samples;
+	}
+    }
+    return true;
+}
+
+/*********************************************************************/
+
+int main(int argc, char** argv) {
+    std::string elf_filename;
+    std::string prof_filename;
+    std::string out_filename = "fastcode_profile.ld";
+    uint32_t budget = 2048;
+    uint32_t flash_base = 0x800000;  // functions below are already in RAM
+    bool cmdline_error = (argc < 3);
+
+    if(!cmdline_error) {
+	elf_filename = argv[1];
+	prof_filename = argv[2];
+    }
+    for(int i=3; i<argc && !cmdline_error; i+=2) {
+	if(i+1 >= argc) {
+	    cmdline_error = true;
+	} else if(!strcmp(argv[i],"-budget")) {
+	    budget = uint32_t(strtoul(argv[i+1], nullptr, 0));
+	} else if(!strcmp(argv[i],"-flash_base")) {
+	    flash_base = uint32_t(strtoul(argv[i+1], nullptr, 0));
+	} else if(!strcmp(argv[i],"-out")) {
+	    out_filename = argv[i+1];
+	} else {
+	    cmdline_error = true;
+	}
+    }
+
+    if(cmdline_error) {
+	std::cerr << "usage: " << argv[0]
+		  << " file.spiflash.elf file.prof <-budget bytes>"
+		  << " <-flash_base addr> <-out fastcode_profile.ld>"
+		  << std::endl;
+	return -1;
+    }
+
+    std::map<std::string, Function> functions;
+    if(!load_functions(elf_filename, functions)) {
+	std::cerr << "Could not read function symbols from "
+		  << elf_filename << std::endl;
+	return -1;
+    }
+
+    uint64_t total_samples = 0;
+    if(!load_profile(prof_filename, functions, total_samples)) {
+	std::cerr << "Could not read profile " << prof_filename << std::endl;
+	return -1;
+    }
+
+    // Candidates: executed from flash, and sampled. Sorted by samples
+    // per byte (the most time saved for the RAM consumed), and chosen
+    // greedily (the ones that do not fit are skipped, smaller ones after
+    // them may still fit).
+    std::vector<const Function*> candidates;
+    for(const auto& it: functions) {
+	const Function& F = it.second;
+	if(F.address >= flash_base && F.samples != 0) {
+	    candidates.push_back(&F);
+	}
+    }
+    std::sort(
+	candidates.begin(), candidates.end(),
+	[](const Function* A, const Function* B) {
+	    // A.samples / A.size > B.samples / B.size
+	    return A->samples * B->size > B->samples * A->size;
+	}
+    );
+
+    std::vector<const Function*> chosen;
+    uint32_t used = 0;
+    uint64_t chosen_samples = 0;
+    for(const Function* F: candidates) {
+	uint32_t size = (F->size + 3) & ~3u;
+	if(used + size <= budget) {
+	    chosen.push_back(F);
+	    used += size;
+	    chosen_samples += F->samples;
+	}
+    }
+
+    double percent = total_samples ?
+	100.0 * double(chosen_samples) / double(total_samples) : 0.0;
+
+    std::ofstream out(out_filename);
+    if(!out) {
+	std::cerr << "Could not write " << out_filename << std::endl;
+	return -1;
+    }
+    out << "/* Generated by TOOLS/fastcode_place from " << prof_filename
+	<< " */" << std::endl;
+    out << "/* " << chosen.size() << " functions, " << used << " / "
+	<< budget << " bytes, " << percent << "% of the samples */"
+	<< std::endl;
+    for(const Function* F: chosen) {
+	out << "*(.text." << F->name << ")  /* " << F->size << " bytes, "
+	    << F->samples << " samples */" << std::endl;
+    }
+
+    std::cout << "   fastcode: " << chosen.size() << " functions, "
+	      << used << " / " << budget << " bytes, "
+	      << percent << "% of the samples" << std::endl;
+    return 0;
+}
@@ -0,0 +1,322 @@
+/**
+ * Symbolizes the PC histograms printed by femto_pcprof_dump()
+ * (LIBFEMTORV32/femto_pcprof.h): attributes the samples of each bucket
+ * to the function of the ELF executable that contains the address of
+ * the bucket, and writes a flat profile, in the same format as the
+ * .prof files of the femtorv32_systemc simulators (that
+ * TOOLS/fastcode_place reads). The input is the text captured on the
+ * UART (e.g. with 'picocom ... | tee run.txt'), the lines outside of the
+ * "#femto_pcprof begin" / "#femto_pcprof end" blocks are ignored, the
+ * samples of all the blocks are summed.
+ *
+ * Usage: femto_pcprof prog.elf run.txt [-out prog.prof]
+ *  -out: output file (default: stdout)
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+
+/*********************************************************************/
+
+/**
+ * \brief A symbol of the executable
+ */
+struct Symbol {
+    std::string name;
+    uint32_t address = 0;
+    uint32_t size = 0; /* 0 for assembly labels: up to the next symbol */
+};
+
+/**
+ * \brief The samples of the femto_pcprof_dump() blocks
+ */
+struct Histogram {
+    uint32_t freq_MHz = 0;
+    uint32_t period = 0;
+    uint32_t shift = 0;
+    uint64_t samples = 0;
+    uint64_t outside = 0;
+    int nb_dumps = 0;
+    std::map<uint32_t, uint64_t> buckets; /* address -> samples */
+};
+
+/**
+ * \brief Reads a whole file
+ * \retval true if the file could be read
+ * \retval false otherwise
+ */
+bool read_file(const std::string& filename, std::vector<uint8_t>& data) {
+    FILE* f = fopen(filename.c_str(), "rb");
+    if(f == nullptr) {
+	return false;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    data.resize(size_t(size));
+    bool result = (fread(data.data(), 1, data.size(), f) == data.size());
+    fclose(f);
+    return result;
+}
+
+inline uint32_t get_word(const std::vector<uint8_t>& data, size_t addr) {
+    return uint32_t(data[addr])           |
+	   (uint32_t(data[addr+1]) << 8)  |
+	   (uint32_t(data[addr+2]) << 16) |
+	   (uint32_t(data[addr+3]) << 24) ;
+}
+
+inline uint32_t get_half(const std::vector<uint8_t>& data, size_t addr) {
+    return uint32_t(data[addr]) | (uint32_t(data[addr+1]) << 8);
+}
+
+/**
+ * \brief Gets the function symbols (STT_FUNC, and the STT_NOTYPE
+ *  global labels of the assembly files) of an ELF32 executable,
+ *  sorted by address
+ * \retval true on success
+ * \retval false if the file could not be read or has no symbols
+ */
+bool load_symbols(const std::string& filename, std::vector<Symbol>& symbols) {
+    const uint32_t SHT_SYMTAB = 2;
+    const uint32_t STT_NOTYPE = 0;
+    const uint32_t STT_FUNC   = 2;
+    const uint32_t STB_GLOBAL = 1;
+    const uint32_t SHN_UNDEF  = 0;
+    std::vector<uint8_t> elf;
+    if(!read_file(filename, elf) || elf.size() < 52) {
+	return false;
+    }
+    uint32_t shoff     = get_word(elf, 32);
+    uint32_t shentsize = get_half(elf, 46);
+    uint32_t shnum     = get_half(elf, 48);
+    if(shentsize < 40 || size_t(shoff) + size_t(shnum) * shentsize > elf.size()) {
+	return false;
+    }
+    for(uint32_t i=0; i<shnum; ++i) {
+	size_t sh = size_t(shoff) + size_t(i) * shentsize;
+	if(get_word(elf, sh + 4) != SHT_SYMTAB) {
+	    continue;
+	}
+	uint32_t symoff  = get_word(elf, sh + 16);
+	uint32_t symsize = get_word(elf, sh + 20);
+	uint32_t link    = get_word(elf, sh + 24);
+	if(link >= shnum) {
+	    return false;
+	}
+	size_t strsh = size_t(shoff) + size_t(link) * shentsize;
+	uint32_t stroff  = get_word(elf, strsh + 16);
+	uint32_t strsize = get_word(elf, strsh + 20);
+	if(
+	    size_t(symoff) + symsize > elf.size() ||
+	    size_t(stroff) + strsize > elf.size()
+	) {
+	    return false;
+	}
+	for(size_t s = symoff; s + 16 <= size_t(symoff) + symsize; s += 16) {
+	    uint32_t name  = get_word(elf, s);
+	    uint32_t value = get_word(elf, s + 4);
+	    uint32_t size  = get_word(elf, s + 8);
+	    uint8_t  info  = elf[s + 12];
+	    uint32_t shndx = get_half(elf, s + 14);
+	    bool is_function = ((info & 15) == STT_FUNC);
+	    bool is_label = ((info & 15) == STT_NOTYPE && (info >> 4) == STB_GLOBAL);
+	    if(!(is_function || is_label) || shndx == SHN_UNDEF || name >= strsize) {
+		continue;
+	    }
+	    Symbol S;
+	    S.name = std::string(
+		(const char*)&elf[stroff + name],
+		strnlen((const char*)&elf[stroff + name], strsize - name)
+	    );
+	    if(S.name.empty()) {
+		continue;
+	    }
+	    S.address = value;
+	    S.size = is_function ? size : 0;
+	    symbols.push_back(S);
+	}
+    }
+    /* Functions first at the same address, so that they win over labels */
+    std::sort(
+	symbols.begin(), symbols.end(),
+	[](const Symbol& a, const Symbol& b) {
+	    return (a.address != b.address) ? a.address < b.address : a.size > b.size;
+	}
+    );
+    return !symbols.empty();
+}
+
+/**
+ * \brief Gets the name of the function that contains an address
+ */
+std::string symbol(const std::vector<Symbol>& symbols, uint32_t addr) {
+    /* Last symbol with address <= addr */
+    auto it = std::upper_bound(
+	symbols.begin(), symbols.end(), addr,
+	[](uint32_t a, const Symbol& s) { return a < s.address; }
+    );
+    if(it != symbols.begin()) {
+	--it;
+	/* Labels without size (assembly) extend up to the next symbol */
+	if(it->size == 0 || addr < it->address + it->size) {
+	    return it->name;
+	}
+    }
+    char buff[16];
+    snprintf(buff, sizeof(buff), "0x%08x", addr);
+    return buff;
+}
+
+/**
+ * \brief Reads the femto_pcprof_dump() blocks of a UART capture
+ * \retval true if the file could be read
+ * \retval false otherwise, error is set
+ */
+bool read_dumps(const char* filename, Histogram& histogram, std::string& error) {
+    std::ifstream in(filename);
+    if(!in) {
+	error = std::string("could not open ") + filename;
+	return false;
+    }
+    std::string line;
+    bool in_dump = false;
+    for(int line_number = 1; std::getline(in, line); ++line_number) {
+	while(!line.empty() && (line.back() == '\r' || line.back() == '\n')) {
+	    line.pop_back();
+	}
+	/* The block can start after other text on the same line */
+	size_t begin = line.find("#femto_pcprof begin");
+	if(begin != std::string::npos) {
+	    unsigned MHz = 0, period = 0, base = 0, shift = 0, samples = 0, outside = 0;
+	    if(sscanf(
+		   line.c_str() + begin, "#femto_pcprof begin %u %u %x %u %u %u",
+		   &MHz, &period, &base, &shift, &samples, &outside
+	       ) != 6) {
+		error = std::string(filename) + ":" + std::to_string(line_number) + ": invalid header";
+		return false;
+	    }
+	    histogram.freq_MHz = MHz;
+	    histogram.period = period;
+	    histogram.shift = shift;
+	    histogram.samples += samples;
+	    histogram.outside += outside;
+	    ++histogram.nb_dumps;
+	    in_dump = true;
+	    continue;
+	}
+	if(!in_dump) {
+	    continue;
+	}
+	if(line.find("#femto_pcprof end") != std::string::npos) {
+	    in_dump = false;
+	    continue;
+	}
+	std::istringstream words(line);
+	uint32_t address = 0;
+	uint64_t samples = 0;
+	if(!(words >> std::hex >> address >> std::dec >> samples)) {
+	    error = std::string(filename) + ":" + std::to_string(line_number) + ": invalid bucket";
+	    return false;
+	}
+	histogram.buckets[address] += samples;
+    }
+    if(in_dump) {
+	error = std::string(filename) + ": truncated dump (no #femto_pcprof end)";
+	return false;
+    }
+    return true;
+}
+
+/**
+ * \brief Writes the flat profile (the format of the .prof files of
+ *  the simulators)
+ */
+void write_flat(std::ostream& out, const Histogram& histogram, const std::vector<Symbol>& symbols) {
+    std::map<std::string, uint64_t> per_function;
+    for(const auto& it: histogram.buckets) {
+	per_function[symbol(symbols, it.first)] += it.second;
+    }
+    if(histogram.outside != 0) {
+	per_function["<outside>"] += histogram.outside;
+    }
+    std::vector<std::pair<std::string, uint64_t>> sorted(per_function.begin(), per_function.end());
+    std::sort(
+	sorted.begin(), sorted.end(),
+	[](const std::pair<std::string, uint64_t>& a, const std::pair<std::string, uint64_t>& b) {
+	    return a.second > b.second;
+	}
+    );
+    char buff[64];
+    out << "# " << histogram.samples << " samples";
+    if(histogram.period != 0 && histogram.freq_MHz != 0) {
+	out << ", every " << histogram.period << " cycles at " << histogram.freq_MHz << " MHz";
+    }
+    out << ", " << (1u << histogram.shift) << " bytes buckets" << std::endl;
+    out << "#  %time     samples  function" << std::endl;
+    for(const auto& it: sorted) {
+	snprintf(
+	    buff, sizeof(buff), "%7.2f %12llu  ",
+	    histogram.samples ? 100.0 * double(it.second) / double(histogram.samples) : 0.0,
+	    (unsigned long long)it.second
+	);
+	out << buff << it.first << std::endl;
+    }
+}
+
+/*********************************************************************/
+
+int main(int argc, char** argv) {
+    const char* output = nullptr;
+    bool cmdline_error = (argc < 3);
+    for(int i=3; i<argc && !cmdline_error; i+=2) {
+	if(i+1 < argc && !strcmp(argv[i],"-out")) {
+	    output = argv[i+1];
+	} else {
+	    cmdline_error = true;
+	}
+    }
+    if(cmdline_error) {
+	std::cerr << "usage: " << argv[0] << " prog.elf run.txt [-out prog.prof]" << std::endl;
+	return 1;
+    }
+
+    std::vector<Symbol> symbols;
+    if(!load_symbols(argv[1], symbols)) {
+	std::cerr << argv[1] << ": could not read the symbols" << std::endl;
+	return 1;
+    }
+    Histogram histogram;
+    std::string error;
+    if(!read_dumps(argv[2], histogram, error)) {
+	std::cerr << error << std::endl;
+	return 1;
+    }
+    if(histogram.nb_dumps == 0) {
+	std::cerr << argv[2] << ": no #femto_pcprof block" << std::endl;
+	return 1;
+    }
+
+    if(output == nullptr) {
+	write_flat(std::cout, histogram, symbols);
+    } else {
+	std::ofstream out(output);
+	write_flat(out, histogram, symbols);
+	if(!out) {
+	    std::cerr << "could not write " << output << std::endl;
+	    return 1;
+	}
+    }
+    std::cerr << histogram.nb_dumps << " dumps, " << histogram.samples << " samples ("
+	      << histogram.outside << " outside)" << std::endl;
+    return 0;
+}
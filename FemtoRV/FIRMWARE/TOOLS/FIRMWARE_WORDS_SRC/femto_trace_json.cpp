@@ -0,0 +1,234 @@
+/**
+ * Converts the event traces printed by femto_trace_dump()
+ * (LIBFEMTORV32/femto_trace.h) into a Chrome trace (JSON "trace event"
+ * format), to be opened with chrome://tracing or https://ui.perfetto.dev.
+ * The input is the text captured on the UART (e.g. with
+ * 'picocom ... | tee run.txt'), the lines outside of the
+ * "#femto_trace begin" / "#femto_trace end" blocks are ignored. Each
+ * block (each call to femto_trace_dump()) becomes a process of the
+ * trace, with its time starting at 0.
+ *
+ * Usage: femto_trace_json run.txt [-freq MHz] [-out trace.json]
+ *  -freq MHz: frequency of the cycle counter (default: the one printed
+ *             by the dump, read from the hardware config)
+ *  -out:      output file (default: stdout)
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+
+/*********************************************************************/
+
+/**
+ * \brief An event of a dump
+ */
+struct TraceEvent {
+    bool end = false;
+    uint32_t id = 0;
+    uint64_t cycle = 0; /* since the first event of the dump */
+};
+
+/**
+ * \brief A femto_trace_dump() block
+ */
+struct TraceDump {
+    uint32_t freq_MHz = 0;
+    uint32_t dropped = 0;
+    std::vector<TraceEvent> events;
+    std::map<uint32_t, std::string> names;
+};
+
+/**
+ * \brief Reads the dumps of a UART capture
+ * \retval true if the file could be read
+ * \retval false otherwise, error is set
+ */
+bool read_dumps(const char* filename, std::vector<TraceDump>& dumps, std::string& error) {
+    std::ifstream in(filename);
+    if(!in) {
+	error = std::string("could not open ") + filename;
+	return false;
+    }
+    std::string line;
+    TraceDump* dump = nullptr;
+    uint64_t cycle = 0;
+    for(int line_number = 1; std::getline(in, line); ++line_number) {
+	while(!line.empty() && (line.back() == '\r' || line.back() == '\n')) {
+	    line.pop_back();
+	}
+	/* The block can start after other text on the same line */
+	size_t begin = line.find("#femto_trace begin");
+	if(begin != std::string::npos) {
+	    dumps.emplace_back();
+	    dump = &dumps.back();
+	    cycle = 0;
+	    unsigned bits = 0, nb_events = 0;
+	    if(sscanf(
+		   line.c_str() + begin, "#femto_trace begin %u %u %u %u",
+		   &dump->freq_MHz, &bits, &nb_events, &dump->dropped
+	       ) != 4) {
+		error = std::string(filename) + ":" + std::to_string(line_number) + ": invalid header";
+		return false;
+	    }
+	    continue;
+	}
+	if(dump == nullptr) {
+	    continue;
+	}
+	if(line.find("#femto_trace end") != std::string::npos) {
+	    dump = nullptr;
+	    continue;
+	}
+	std::istringstream words(line);
+	char kind = 0;
+	uint32_t id = 0;
+	if(!(words >> kind >> id)) {
+	    error = std::string(filename) + ":" + std::to_string(line_number) + ": invalid event";
+	    return false;
+	}
+	if(kind == 'N') {
+	    std::string name;
+	    std::getline(words >> std::ws, name);
+	    dump->names[id] = name;
+	    continue;
+	}
+	uint64_t delta = 0;
+	if((kind != 'B' && kind != 'E') || !(words >> delta)) {
+	    error = std::string(filename) + ":" + std::to_string(line_number) + ": invalid event";
+	    return false;
+	}
+	cycle += delta;
+	TraceEvent event;
+	event.end = (kind == 'E');
+	event.id = id;
+	event.cycle = cycle;
+	dump->events.push_back(event);
+    }
+    if(dump != nullptr) {
+	error = std::string(filename) + ": truncated dump (no #femto_trace end)";
+	return false;
+    }
+    return true;
+}
+
+/**
+ * \brief Writes a string as a JSON string
+ */
+void write_json_string(std::ostream& out, const std::string& s) {
+    out << '"';
+    for(char c: s) {
+	if(c == '"' || c == '\\') {
+	    out << '\\' << c;
+	} else if((unsigned char)(c) < 0x20) {
+	    char escaped[8];
+	    snprintf(escaped, sizeof(escaped), "\\u%04x", unsigned(c));
+	    out << escaped;
+	} else {
+	    out << c;
+	}
+    }
+    out << '"';
+}
+
+/**
+ * \brief Writes the dumps as a Chrome trace
+ * \details The ENDs without a BEGIN (the BEGIN was overwritten in the
+ *  ring buffer) are dropped.
+ */
+void write_chrome_trace(std::ostream& out, const std::vector<TraceDump>& dumps, uint32_t freq_MHz) {
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    const char* separator = "\n";
+    char ts[32];
+    for(size_t d = 0; d < dumps.size(); ++d) {
+	const TraceDump& dump = dumps[d];
+	uint32_t MHz = (freq_MHz != 0) ? freq_MHz : (dump.freq_MHz != 0 ? dump.freq_MHz : 1);
+	int pid = int(d) + 1;
+	out << separator << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid
+	    << ",\"tid\":1,\"args\":{\"name\":\"dump " << pid;
+	if(dump.dropped != 0) {
+	    out << " (" << dump.dropped << " events dropped)";
+	}
+	out << "\"}}";
+	separator = ",\n";
+	std::map<uint32_t, int> open;
+	for(const TraceEvent& event: dump.events) {
+	    if(event.end) {
+		if(open[event.id] == 0) {
+		    continue;
+		}
+		--open[event.id];
+	    } else {
+		++open[event.id];
+	    }
+	    auto name = dump.names.find(event.id);
+	    snprintf(ts, sizeof(ts), "%.3f", double(event.cycle) / double(MHz));
+	    out << separator << "{\"name\":";
+	    write_json_string(
+		out, name != dump.names.end() ? name->second : "event " + std::to_string(event.id)
+	    );
+	    out << ",\"ph\":\"" << (event.end ? 'E' : 'B') << "\",\"ts\":" << ts
+		<< ",\"pid\":" << pid << ",\"tid\":1}";
+	}
+    }
+    out << "\n]}\n";
+}
+
+/*********************************************************************/
+
+int main(int argc, char** argv) {
+    const char* input = nullptr;
+    const char* output = nullptr;
+    uint32_t freq_MHz = 0;
+    for(int i = 1; i < argc; ++i) {
+	if(!strcmp(argv[i], "-freq") && i+1 < argc) {
+	    freq_MHz = uint32_t(strtoul(argv[++i], nullptr, 0));
+	} else if(!strcmp(argv[i], "-out") && i+1 < argc) {
+	    output = argv[++i];
+	} else if(input == nullptr && argv[i][0] != '-') {
+	    input = argv[i];
+	} else {
+	    input = nullptr;
+	    break;
+	}
+    }
+    if(input == nullptr) {
+	std::cerr << "usage: " << argv[0] << " run.txt [-freq MHz] [-out trace.json]" << std::endl;
+	return 1;
+    }
+
+    std::vector<TraceDump> dumps;
+    std::string error;
+    if(!read_dumps(input, dumps, error)) {
+	std::cerr << error << std::endl;
+	return 1;
+    }
+    if(dumps.empty()) {
+	std::cerr << input << ": no #femto_trace block" << std::endl;
+	return 1;
+    }
+
+    size_t nb_events = 0;
+    for(const TraceDump& dump: dumps) {
+	nb_events += dump.events.size();
+    }
+    if(output == nullptr) {
+	write_chrome_trace(std::cout, dumps, freq_MHz);
+    } else {
+	std::ofstream out(output);
+	write_chrome_trace(out, dumps, freq_MHz);
+	if(!out) {
+	    std::cerr << "could not write " << output << std::endl;
+	    return 1;
+	}
+    }
+    std::cerr << dumps.size() << " dumps, " << nb_events << " events" << std::endl;
+    return 0;
+}
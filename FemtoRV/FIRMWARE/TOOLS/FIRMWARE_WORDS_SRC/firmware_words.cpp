@@ -16,26 +16,50 @@
 #include <vector>
 #include <cstring>
 #include <cstdint>
+#include <cstdio>
 
 #include <femto_elf.h>
 
 
 /*********************************************************************/
 
+/**
+ * \brief Table that converts a character into a nibble (half-byte)
+ * \details 0..9,A..F,a..f are mapped to their numeric value, all
+ *  other characters to 255.
+ */
+static unsigned char nibble_table[256];
+
+/**
+ * \brief Table that converts a byte into its two lowercase hexadecimal
+ *  digits
+ */
+static char hex_table[256][2];
+
+/**
+ * \brief Initializes nibble_table and hex_table
+ */
+void init_tables() {
+    static const char* digits = "0123456789abcdef";
+    memset(nibble_table, 255, sizeof(nibble_table));
+    for(int i=0; i<16; ++i) {
+	nibble_table[(unsigned char)digits[i]] = i;
+	nibble_table[(unsigned char)toupper(digits[i])] = i;
+    }
+    for(int i=0; i<256; ++i) {
+	hex_table[i][0] = digits[i >> 4];
+	hex_table[i][1] = digits[i & 15];
+    }
+}
+
 /**
  * \brief Converts a character into a nibble (half-byte)
  * \param[in] c one of 0..9,A..F,a..f
  * \return the numeric value as an unsigned char
  */
-unsigned char char_to_nibble(char c) {
-    unsigned char result;
-    if(c >= '0' && c <= '9') {
-	result = c - '0';
-    } else if(c >= 'A' && c <= 'F') {
-	result = c - 'A' + 10;
-    } else if(c >= 'a' && c <= 'f') {
-	result = c - 'a' + 10;
-    } else {
+inline unsigned char char_to_nibble(char c) {
+    unsigned char result = nibble_table[(unsigned char)c];
+    if(result == 255) {
 	std::cerr << "Invalid hexadecimal digit: " << c << std::endl;
 	exit(-1);
     }
@@ -43,14 +67,54 @@ unsigned char char_to_nibble(char c) {
 }
 
 /**
- * \brief Converts a two-characters string into a byte
- * \param[in] str a pointer to a two-characters array 
- * \details \p str needs to have exactly two characters and
- *          does not need to be null-terminated
- * \return the numeric value as an unsigned char
+ * \brief Loads a whole file into a vector of chars
+ * \param[in] filename the name of the file to be loaded
+ * \param[out] contents the bytes of the file
+ * \return false if the file could not be read
  */
-unsigned char string_to_byte(char* str) {
-    return (char_to_nibble(str[0]) << 4) | char_to_nibble(str[1]);
+bool read_file(const char* filename, std::vector<char>& contents) {
+    FILE* f = fopen(filename, "rb");
+    if(f == nullptr) {
+	return false;
+    }
+    contents.clear();
+    char buff[65536];
+    size_t n;
+    while((n = fread(buff, 1, sizeof(buff), f)) != 0) {
+	contents.insert(contents.end(), buff, buff+n);
+    }
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+/**
+ * \brief Writes a buffer into a file, unless the file already has
+ *  this content
+ * \details Leaving an unchanged file untouched keeps its timestamp, so
+ *  that what depends on it (e.g., synthesis with firmware.hex) is not
+ *  rebuilt by make.
+ * \param[in] filename the name of the file
+ * \param[in] data , size the bytes to be written
+ * \return false if the file could not be written
+ */
+bool write_file_if_changed(const char* filename, const char* data, size_t size) {
+    std::vector<char> previous;
+    if(
+	read_file(filename, previous) &&
+	previous.size() == size && 
+	(size == 0 || !memcmp(previous.data(), data, size))
+    ) {
+	std::cerr << "       (unchanged)" << std::endl;
+	return true;
+    }
+    FILE* f = fopen(filename, "wb");
+    if(f == nullptr) {
+	return false;
+    }
+    bool ok = (fwrite(data, 1, size, f) == size);
+    ok = (fclose(f) == 0) && ok;
+    return ok;
 }
 
 /**
@@ -138,34 +202,39 @@ int load_RAM_rawhex(const char* filename, std::vector<unsigned char>& RAM) {
     int address = 0;
     int lineno = 0;
     int max_address = 0;
-    std::ifstream in(filename);
-    if(!in) {
+    std::vector<char> in;
+    if(!read_file(filename, in)) {
 	std::cerr << "Could not open " << filename << std::endl;
 	return -1;
     }
-  
-    std::string line;
-    while(std::getline(in, line)) {
+    in.push_back('\0');
+
+    /* The whole file is parsed in place, line by line */
+    const char* line = in.data();
+    const char* end  = in.data() + in.size() - 1;
+    while(line < end) {
+	const char* eol = (const char*)memchr(line, '\n', end - line);
+	if(eol == nullptr) {
+	    eol = end;
+	}
 	++lineno;
 	if(line[0] == '@') {
-	    sscanf(line.c_str()+1,"%x",&address);
+	    sscanf(line+1,"%x",&address);
 	} else {
-	    std::string charbytes;
-	    for(int i=0; i<line.length(); ++i) {
-		if(line[i] != ' ' && std::isprint(line[i])) {
-		    charbytes.push_back(line[i]);
+	    /* Hex digits of the line, without spaces and control chars */
+	    int first_digit = -1;
+	    int nb_digits = 0;
+	    for(const char* p = line; p != eol; ++p) {
+		if(*p == ' ' || !std::isprint((unsigned char)*p)) {
+		    continue;
 		}
-	    }
-
-	    if(charbytes.size() % 2 != 0) {
-		std::cerr << "Line : " << lineno << std::endl;
-		std::cerr << " invalid number of characters"
-			  << std::endl;
-		return -1;
-	    }
-
-	    int i = 0;
-	    while(i < charbytes.size()) {
+		unsigned char nibble = char_to_nibble(*p);
+		if(first_digit == -1) {
+		    first_digit = nibble;
+		    ++nb_digits;
+		    continue;
+		}
+		++nb_digits;
 		if(address >= RAM_SIZE) {
 		    std::cerr << "Line : " << lineno << std::endl;
 		    std::cerr << " RAM size exceeded"
@@ -179,12 +248,19 @@ int load_RAM_rawhex(const char* filename, std::vector<unsigned char>& RAM) {
 		    return -1;
 		}
 		max_address = std::max(max_address, address);
-		RAM[address] = string_to_byte(&charbytes[i]);
+		RAM[address] = (first_digit << 4) | nibble;
 		OCC[address] = 255;
-		i += 2;
+		first_digit = -1;
 		address++;
 	    }
+	    if(nb_digits % 2 != 0) {
+		std::cerr << "Line : " << lineno << std::endl;
+		std::cerr << " invalid number of characters"
+			  << std::endl;
+		return -1;
+	    }
 	}
+	line = eol + 1;
     }
     return max_address;
 }
@@ -264,15 +340,29 @@ void save_RAM_hex(
     }
     
     std::cerr << "   SAVE HEX: " << filename << std::endl;    
-    std::ofstream out(filename);
+
+    /* 
+     * Each word is 8 hex digits and a space, with a newline after 
+     * every 4th word. The whole file is formatted in a preallocated 
+     * buffer, then written at once.
+     */
+    size_t nb_words = (to_addr > from_addr) ? (to_addr - from_addr + 3) / 4 : 0;
+    std::vector<char> out(nb_words * 10);
+    char* p = out.data();
     for(int i=from_addr; i<to_addr; i+=4) {
-	char buff[10];
-	sprintf(buff,"%.2x%.2x%.2x%.2x ",RAM[i+3],RAM[i+2],RAM[i+1],RAM[i]);
-	out << buff; 
+	for(int j=3; j>=0; --j) {
+	    *p++ = hex_table[RAM[i+j]][0];
+	    *p++ = hex_table[RAM[i+j]][1];
+	}
+	*p++ = ' ';
 	if(((i/4+1) % 4) == 0) {
-	    out << std::endl;
+	    *p++ = '\n';
 	}
     }
+    if(!write_file_if_changed(filename, out.data(), p - out.data())) {
+	std::cerr << "Could not write " << filename << std::endl;
+	exit(-1);
+    }
 }
 
 /**
@@ -291,9 +381,12 @@ void save_RAM_bin(
     std::cerr << "   SAVE BIN: " << filename << std::endl;
     printf("        from addr:0x%lx\n",(unsigned long)from_addr);
     printf("          to addr:0x%lx\n",(unsigned long)to_addr);    
-    FILE* f = fopen(filename,"wb");
-    fwrite(RAM.data()+from_addr, 1, to_addr+1-from_addr,f);
-    fclose(f);
+    if(!write_file_if_changed(
+	   filename, (const char*)RAM.data()+from_addr, to_addr+1-from_addr
+       )) {
+	std::cerr << "Could not write " << filename << std::endl;
+	exit(-1);
+    }
 }
 
 /**
@@ -347,6 +440,8 @@ int main(int argc, char** argv) {
 
     bool cmdline_error = false;
 
+    init_tables();
+
     std::string in_filename;
     std::string in_verilog_filename;
     std::string out_filename;
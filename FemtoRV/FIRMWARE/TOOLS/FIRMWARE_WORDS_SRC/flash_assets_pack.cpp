@@ -0,0 +1,128 @@
+/**
+ * Packs data files into an image to be written to the SPI flash, read
+ * in place by the programs through flash_asset() (see the format in
+ * LIBFEMTORV32/flash_assets.h). The files are stored under their name
+ * without the directory.
+ *
+ * Usage: flash_assets_pack file1 file2 ... -out assets.img
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <cstddef>
+
+#include <flash_assets.h>
+
+/*********************************************************************/
+
+/**
+ * \brief Reads a whole file
+ * \param[in] filename the name of the file
+ * \param[out] data the content of the file
+ * \retval true if the file could be read
+ * \retval false otherwise
+ */
+bool read_file(const std::string& filename, std::vector<uint8_t>& data) {
+    FILE* f = fopen(filename.c_str(), "rb");
+    if(f == nullptr) {
+	return false;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    data.resize(size_t(size));
+    bool result = (fread(data.data(), 1, data.size(), f) == data.size());
+    fclose(f);
+    return result;
+}
+
+/**
+ * \brief Writes a little-endian 32 bits word
+ */
+inline void set_word(std::vector<uint8_t>& out, size_t addr, uint32_t w) {
+    out[addr]   = uint8_t(w);
+    out[addr+1] = uint8_t(w >> 8);
+    out[addr+2] = uint8_t(w >> 16);
+    out[addr+3] = uint8_t(w >> 24);
+}
+
+/*********************************************************************/
+
+int main(int argc, char** argv) {
+    std::vector<std::string> inputs;
+    std::string output;
+
+    for(int i=1; i<argc; ++i) {
+	if(!strcmp(argv[i], "-out") && i+1 < argc) {
+	    output = argv[++i];
+	} else {
+	    inputs.push_back(argv[i]);
+	}
+    }
+
+    if(inputs.empty() || output == "") {
+	std::cerr << "usage: " << argv[0]
+		  << " file1 file2 ... -out assets.img" << std::endl;
+	return 1;
+    }
+
+    size_t toc_size =
+	sizeof(FlashAssets_Header) + inputs.size() * sizeof(FlashAssets_Entry);
+    std::vector<uint8_t> image(toc_size, 0);
+    set_word(image, 0, FLASH_ASSETS_MAGIC);
+    set_word(image, 4, uint32_t(inputs.size()));
+
+    for(size_t i=0; i<inputs.size(); ++i) {
+	std::vector<uint8_t> data;
+	if(!read_file(inputs[i], data)) {
+	    std::cerr << inputs[i] << ": could not read file" << std::endl;
+	    return 1;
+	}
+
+	std::string name = inputs[i];
+	size_t slash = name.find_last_of("/\\");
+	if(slash != std::string::npos) {
+	    name = name.substr(slash+1);
+	}
+	if(name.length() >= FLASH_ASSETS_NAME_LEN) {
+	    std::cerr << name << ": name longer than "
+		      << FLASH_ASSETS_NAME_LEN-1 << " chars" << std::endl;
+	    return 1;
+	}
+	for(size_t j=0; j<i; ++j) {
+	    const char* other =
+		(const char*)&image[sizeof(FlashAssets_Header) + j*sizeof(FlashAssets_Entry)];
+	    if(name == other) {
+		std::cerr << name << ": duplicate name" << std::endl;
+		return 1;
+	    }
+	}
+
+	// data starts on a 4 bytes boundary
+	while(image.size() & 3) {
+	    image.push_back(0);
+	}
+
+	size_t entry = sizeof(FlashAssets_Header) + i * sizeof(FlashAssets_Entry);
+	memcpy(&image[entry], name.c_str(), name.length());
+	set_word(image, entry + offsetof(FlashAssets_Entry, offset), uint32_t(image.size()));
+	set_word(image, entry + offsetof(FlashAssets_Entry, size),   uint32_t(data.size()));
+	image.insert(image.end(), data.begin(), data.end());
+
+	std::cout << name << ": " << data.size() << " bytes" << std::endl;
+    }
+
+    FILE* f = fopen(output.c_str(), "wb");
+    if(f == nullptr || fwrite(image.data(), 1, image.size(), f) != image.size()) {
+	std::cerr << output << ": could not write file" << std::endl;
+	return 1;
+    }
+    fclose(f);
+
+    std::cout << output << ": " << image.size() << " bytes" << std::endl;
+    return 0;
+}
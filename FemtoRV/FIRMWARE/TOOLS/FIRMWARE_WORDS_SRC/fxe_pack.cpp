@@ -0,0 +1,188 @@
+/**
+ * Converts an ELF executable into a flat pre-relocated executable (.fxe),
+ * loaded by femto_elf.c (FemtOS exec()) and lite_elf.c (LiteOS run) with
+ * a single read straight to the load address, followed by a BSS clear
+ * (see Fxe_Header in LIBFEMTORV32/femto_elf.h for the format). The
+ * payload goes from the lowest address of the program to its last
+ * non-zero byte, the zeroes after it (.bss and the end of .data) are
+ * cleared by the loader.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <algorithm>
+
+#include <femto_elf.h>
+
+/*********************************************************************/
+
+/**
+ * \brief Reads a whole file
+ * \param[in] filename the name of the file
+ * \param[out] data the content of the file
+ * \retval true if the file could be read
+ * \retval false otherwise
+ */
+bool read_file(const std::string& filename, std::vector<uint8_t>& data) {
+    FILE* f = fopen(filename.c_str(), "rb");
+    if(f == nullptr) {
+	return false;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    data.resize(size_t(size));
+    bool result = (fread(data.data(), 1, data.size(), f) == data.size());
+    fclose(f);
+    return result;
+}
+
+/**
+ * \brief Gets a little-endian 32 bits word
+ */
+inline uint32_t get_word(const std::vector<uint8_t>& data, size_t addr) {
+    return uint32_t(data[addr])           |
+	   (uint32_t(data[addr+1]) << 8)  |
+	   (uint32_t(data[addr+2]) << 16) |
+	   (uint32_t(data[addr+3]) << 24) ;
+}
+
+/**
+ * \brief Gets a little-endian 16 bits word
+ */
+inline uint32_t get_half(const std::vector<uint8_t>& data, size_t addr) {
+    return uint32_t(data[addr]) | (uint32_t(data[addr+1]) << 8);
+}
+
+/**
+ * \brief Appends a little-endian 32 bits word
+ */
+inline void put_word(std::vector<uint8_t>& out, uint32_t w) {
+    out.push_back(uint8_t(w));
+    out.push_back(uint8_t(w >> 8));
+    out.push_back(uint8_t(w >> 16));
+    out.push_back(uint8_t(w >> 24));
+}
+
+/**
+ * \brief Gets the lowest address of the PT_LOAD segments of an ELF file
+ * \param[in,out] addr unchanged if there is no program header
+ * \retval true on success
+ * \retval false if the program headers are invalid
+ */
+bool get_lowest_address(const std::vector<uint8_t>& elf, uint32_t& addr) {
+    const uint32_t PT_LOAD = 1;
+    if(elf.size() < 52) {
+	return false;
+    }
+    uint32_t phoff     = get_word(elf, 28);
+    uint32_t phentsize = get_half(elf, 42);
+    uint32_t phnum     = get_half(elf, 44);
+    bool found = false;
+    for(uint32_t i=0; i<phnum; ++i) {
+	size_t ph = size_t(phoff) + size_t(i) * phentsize;
+	if(phentsize < 32 || ph + 32 > elf.size()) {
+	    return false;
+	}
+	if(get_word(elf, ph) != PT_LOAD || get_word(elf, ph + 20) == 0) {
+	    continue;
+	}
+	uint32_t vaddr = get_word(elf, ph + 8);
+	if(!found || vaddr < addr) {
+	    addr = vaddr;
+	}
+	found = true;
+    }
+    return true;
+}
+
+/*********************************************************************/
+
+int main(int argc, char** argv) {
+    std::string in_filename;
+    std::string out_filename;
+    bool crc = true;
+
+    if((argc == 4 || argc == 5) && !strcmp(argv[2],"-out")) {
+	in_filename = argv[1];
+	out_filename = argv[3];
+	if(argc == 5) {
+	    crc = false;
+	}
+    }
+    if(in_filename.empty() || (argc == 5 && strcmp(argv[4], "-nocrc"))) {
+	std::cerr << "usage: " << argv[0] << " in.elf -out out.fxe [-nocrc]"
+		  << std::endl;
+	return -1;
+    }
+
+    Elf32Info info;
+    if(elf32_stat(in_filename.c_str(), &info) != ELF32_OK) {
+	std::cerr << "Could not parse " << in_filename << std::endl;
+	return -1;
+    }
+
+    std::vector<uint8_t> elf;
+    if(!read_file(in_filename, elf)) {
+	std::cerr << "Could not read " << in_filename << std::endl;
+	return -1;
+    }
+
+    uint32_t load_address = info.text_address;
+    if(!get_lowest_address(elf, load_address)) {
+	std::cerr << "Invalid program headers in " << in_filename << std::endl;
+	return -1;
+    }
+    if(load_address >= info.max_address) {
+	std::cerr << "Nothing to load in " << in_filename << std::endl;
+	return -1;
+    }
+
+    std::vector<uint8_t> RAM(info.max_address, 0);
+    if(elf32_load_at(in_filename.c_str(), &info, RAM.data()) != ELF32_OK) {
+	std::cerr << "Could not load " << in_filename << std::endl;
+	return -1;
+    }
+
+    // The zeroes at the end are cleared by the loader with the BSS
+    uint32_t end = info.max_address;
+    while(end > load_address && RAM[end-1] == 0) {
+	--end;
+    }
+    end = std::min((end + 3) & ~3u, info.max_address);
+    uint32_t size = end - load_address;
+
+    std::vector<uint8_t> out;
+    put_word(out, FXE_MAGIC);
+    put_word(out, load_address);
+    put_word(out, info.entry_address != 0 ? info.entry_address : info.text_address);
+    put_word(out, size);
+    put_word(out, info.max_address - end);
+    put_word(out, crc ? fxe_crc32(RAM.data() + load_address, size) : 0);
+    out.resize(FXE_PAYLOAD_OFFSET, 0);
+    out.insert(out.end(), RAM.begin() + load_address, RAM.begin() + end);
+
+    FILE* f = fopen(out_filename.c_str(), "wb");
+    if(
+	f == nullptr ||
+	fwrite(out.data(), 1, out.size(), f) != out.size()
+    ) {
+	std::cerr << "Could not write " << out_filename << std::endl;
+	if(f != nullptr) {
+	    fclose(f);
+	}
+	return -1;
+    }
+    fclose(f);
+
+    std::cout << "   load: 0x" << std::hex << load_address << std::dec
+	      << "  payload: " << size << " bytes"
+	      << "  bss: " << (info.max_address - end) << " bytes"
+	      << "  elf: " << elf.size() << " bytes"
+	      << "  fxe: " << out.size() << " bytes" << std::endl;
+    return 0;
+}
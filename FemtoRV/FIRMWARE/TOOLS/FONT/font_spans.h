@@ -0,0 +1,111 @@
+/*
+ * Span output of the font generators (make_font_xxx -spans): each glyph
+ * is a list of rectangles of foreground pixels, so that femtoGL draws it
+ * without testing the bits of each pixel (LIBFEMTOGL/femtoGLtext_spans.c):
+ * the FGA fills them (the background is one more rectangle), the OLED
+ * path expands them into the pixels of the glyph.
+ *
+ * The runs of a row are merged with the identical runs of the rows
+ * below (vertical strokes, 'l', 'I', '|' ... become one rectangle).
+ *
+ * Format (the table is 2-bytes aligned):
+ *   .half  first, count          first character, number of glyphs
+ *   .half  offset[count+1]       from the start of the table, the glyph
+ *                                of character first+i is in bytes
+ *                                [offset[i], offset[i+1])
+ *   .byte  y|(h-1)<<4, x|(w-1)<<4  for each rectangle (fonts up to 16x16)
+ */
+
+#include <stdio.h>
+
+#define SPANS_MAX_RECTS 256
+
+typedef int (*FontPixelFunc)(int c, int x, int y);
+
+/*
+ * Emits the rectangles of a glyph in rects (4 bytes each: x,y,w,h),
+ * returns their number.
+ */
+static int glyph_rects(
+   FontPixelFunc pixel, int c, int width, int height, unsigned char* rects
+) {
+   int covered[16][16] = {{0}};
+   int nb = 0;
+   for(int y=0; y<height; ++y) {
+      int x = 0;
+      while(x < width) {
+	 if(!pixel(c,x,y) || covered[y][x]) {
+	    ++x;
+	    continue;
+	 }
+	 int x2 = x;
+	 while(x2+1 < width && pixel(c,x2+1,y)) {
+	    ++x2;
+	 }
+	 /* extends down while the next row has exactly the same run */
+	 int y2 = y;
+	 while(y2+1 < height) {
+	    int same = (x == 0 || !pixel(c,x-1,y2+1)) &&
+		       (x2 == width-1 || !pixel(c,x2+1,y2+1));
+	    for(int xx=x; xx<=x2 && same; ++xx) {
+	       same = pixel(c,xx,y2+1);
+	    }
+	    if(!same) {
+	       break;
+	    }
+	    ++y2;
+	 }
+	 for(int yy=y; yy<=y2; ++yy) {
+	    for(int xx=x; xx<=x2; ++xx) {
+	       covered[yy][xx] = 1;
+	    }
+	 }
+	 rects[4*nb+0] = x;
+	 rects[4*nb+1] = y;
+	 rects[4*nb+2] = x2-x+1;
+	 rects[4*nb+3] = y2-y+1;
+	 ++nb;
+	 x = x2+1;
+      }
+   }
+   return nb;
+}
+
+static void print_spans(
+   const char* name, int first, int count, int width, int height,
+   FontPixelFunc pixel
+) {
+   unsigned char rects[4*SPANS_MAX_RECTS];
+   printf(
+      ".text\n"
+      ".globl %s\n"
+      "\n"
+      ".section .rodata\n"
+      ".align 2\n"
+      "%s:\n"
+      ".half %d, %d\n",
+      name, name, first, count
+   );
+   int offset = 4 + 2*(count+1);
+   for(int i=0; i<=count; ++i) {
+      printf(".half %d\n", offset);
+      if(i < count) {
+	 offset += 2*glyph_rects(pixel, first+i, width, height, rects);
+      }
+   }
+   for(int i=0; i<count; ++i) {
+      int nb = glyph_rects(pixel, first+i, width, height, rects);
+      if(nb == 0) {
+	 continue;
+      }
+      printf(".byte ");
+      for(int r=0; r<nb; ++r) {
+	 unsigned char* R = rects + 4*r;
+	 printf(
+	    "0x%02x,0x%02x%s",
+	    R[1] | ((R[3]-1) << 4), R[0] | ((R[2]-1) << 4),
+	    (r == nb-1) ? "\n" : ","
+	 );
+      }
+   }
+}
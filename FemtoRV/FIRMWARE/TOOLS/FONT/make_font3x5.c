@@ -1,5 +1,7 @@
 #include <stdio.h>
 #include "pico8_font3x5.xpm"
+#include <string.h>
+#include "font_spans.h"
 
 const int font_width  = 8;
 const int font_height = 8;
@@ -73,7 +75,26 @@ void print_string(const char* s) {
     }
 }
 
-int main() {
+// pixel of the 4x6 glyph drawn by femtoGL. In the pico8 font, small caps
+// and big caps are swapped, they are swapped back here.
+int font_pixel(int c, int x, int y) {
+    if(x >= 3 || y >= 5) {
+	return 0;
+    }
+    if(c >= 'A' && c <= 'Z') {
+	c = c - 'A' + 'a';
+    } else if(c >= 'a' && c <= 'z') {
+	c = c - 'a' + 'A';
+    }
+    return (get_font_column(c - ' ', x) >> y) & 1;
+}
+
+int main(int argc, char** argv) {
+    if(argc > 1 && !strcmp(argv[1],"-spans")) {
+	print_spans("font_3x5_spans", ' ', 16*6, 4, 6, font_pixel);
+	return 0;
+    }
+
 
     printf("# Generated by FIRMWARE/TOOLS/FONT/makefont.c\n");
     printf(".globl font_3x5\n");
@@ -1,5 +1,7 @@
 #include <stdio.h>
 #include "pico8_font5x6.xpm"
+#include <string.h>
+#include "font_spans.h"
 
 const int font_width  = 8;
 const int font_height = 11;
@@ -74,7 +76,31 @@ void print_char(char c) {
     printf("--------------------\n");
 }
 
-int main() {
+// pixel of the 6x8 glyph drawn by femtoGL (p,q,g ... shifted by two pixels,
+// see main(), the two lower rows are lost in the stored data)
+int font_pixel(int c, int x, int y) {
+    if(x >= 5) {
+	return 0;
+    }
+    int shifted = 0;
+    for(int col=0; col<5; ++col) {
+	if(get_font_column(c - ' ', col + 2) > 63) {
+	    shifted = 1;
+	}
+    }
+    int coldata = get_font_column(c - ' ', x + 2);
+    if(shifted) {
+	coldata = (coldata >> 2) << 2;
+    }
+    return (coldata >> y) & 1;
+}
+
+int main(int argc, char** argv) {
+    if(argc > 1 && !strcmp(argv[1],"-spans")) {
+	print_spans("font_5x6_spans", ' ', 16*6, 6, 8, font_pixel);
+	return 0;
+    }
+
 
     printf("# Generated by FIRMWARE/TOOLS/FONT/makefont.c\n");
     printf(".globl font_5x6\n");
@@ -1,5 +1,7 @@
 #include <stdio.h>
 #include "font8x16.xpm"
+#include <string.h>
+#include "font_spans.h"
 
 const int font_width  = 8;
 const int font_height = 16;
@@ -76,7 +78,16 @@ void gen_chars(int init_lineno, int first) {
 
 
 
-int main() {
+int font_pixel(int c, int x, int y) {
+   return (get_font_column(c,x) >> y) & 1;
+}
+
+int main(int argc, char** argv) {
+  if(argc > 1 && !strcmp(argv[1],"-spans")) {
+    print_spans("font_8x16_spans", 0, 255, font_width, font_height, font_pixel);
+    return 0;
+  }
+
   printf(
 	 ".text\n"
 	 ".globl font_8x16\n"
@@ -1,5 +1,7 @@
 #include <stdio.h>
 #include "font8x8.xpm"
+#include <string.h>
+#include "font_spans.h"
 
 const int font_width  = 8;
 const int font_height = 8;
@@ -75,7 +77,17 @@ void gen_chars(int init_lineno, int first) {
 
 
 
-int main() {
+// get_font_column() inverts every 4 columns, so does this one to get column x
+int font_pixel(int c, int x, int y) {
+   return (get_font_column(c, x - (x%4) + (3 - x%4)) >> y) & 1;
+}
+
+int main(int argc, char** argv) {
+   if(argc > 1 && !strcmp(argv[1],"-spans")) {
+      print_spans("font_8x8_spans", 0, 256, font_width, font_height, font_pixel);
+      return 0;
+   }
+
    int character = 0;
    printf ("font_8x8:\n");
    for(int init_lineno=0; init_lineno<16; ++init_lineno) {
@@ -0,0 +1,23 @@
+// Superset of the bench configurations, for the Verilator model of
+// BENCH.superset (BOARDS/bench.mk): all the devices that SIM/sim_main.cpp
+// can emulate, and the largest RAM (the FGA memory starts at 0x200000).
+// The model is compiled once, and the harness chooses at runtime which
+// devices and how much RAM HardwareConfig reports to the firmware
+// (--devices and --ram, see SIM/straps.h).
+
+`define NRV_IO_LEDS
+`define NRV_IO_UART
+`define NRV_IO_SSD1351
+`define NRV_IO_SDCARD
+`define NRV_MAPPED_SPI_FLASH
+`define NRV_IO_FGA
+`define NRV_FGA_HOST
+`define NRV_FREQ 1
+
+`define NRV_FEMTORV32_PETITBATEAU // RV32IMFC: runs the firmwares of all the cores
+
+`define NRV_RESET_ADDR 0
+`define NRV_RAM 2097152
+`define NRV_IO_HARDWARE_CONFIG
+`define NRV_SIM_STRAPS
+`define NRV_CONFIGURED
@@ -11,6 +11,7 @@
 `define NRV_IO_BUTTONS     // Mapped IO, buttons
 `define NRV_MAPPED_SPI_FLASH // SPI flash mapped in address space. Use with MINIRV32 to run code from SPI flash.
 `define NRV_IO_FGA // Femto Graphic Adapter (ULX3S only)
+//`define NRV_IO_TIMER     // Mapped IO, periodic timer interrupt (needs a core with interrupts, e.g. GRACILIS)
 
 /************************* Frequency ********************************************************************************/
 
@@ -20,6 +20,31 @@ module HardwareConfig(
    localparam counter_width = 32;
 `endif   
 
+// ISA extensions of the processor (from the NRV_ARCH string of the
+// processor file), to let the firmware choose its kernels at runtime.
+// Bits 8.. of CPUINFO (see FEMTORV32_CPUINFO_*_bit in femtorv32.h)
+function arch_has;
+   input [8*16-1:0] arch;
+   input [7:0]      ext;
+   reg   [8*16-1:0] a;
+   integer          i;
+   begin
+      arch_has = 0;
+      a = arch;
+      for(i=0; i<16; i=i+1) begin
+	 if(a[7:0] == ext) arch_has = 1; // 'r','v','3','2' never match
+	 a = a >> 8;
+      end
+   end
+endfunction
+
+localparam [7:0] NRV_ISA = {
+   5'b0,
+   arch_has(`NRV_ARCH, "c"),  // bit 10
+   arch_has(`NRV_ARCH, "f"),  // bit 9
+   arch_has(`NRV_ARCH, "m")   // bit 8
+};
+
    
 // configured devices
 localparam NRV_DEVICES = 0
@@ -50,10 +75,23 @@ localparam NRV_DEVICES = 0
 `ifdef NRV_IO_FGA
    | (1 << IO_FGA_CNTL_bit) | (1 << IO_FGA_DAT_bit)
 `endif			 
+`ifdef NRV_IO_TIMER
+   | (1 << IO_TIMER_bit)
+`endif
 ;
    
-   assign rdata = sel_memory  ? `NRV_RAM  :
-		  sel_devices ?  NRV_DEVICES :
-                  sel_cpuinfo ? (`NRV_FREQ << 16) | counter_width : 32'b0;
+`ifdef NRV_SIM_STRAPS
+   // Superset bench model: the harness removes devices and RAM from the
+   // configuration at runtime (SIM/straps.h)
+   wire [31:0] ram_bytes = $c32("sim_straps_ram(",`NRV_RAM,")");
+   wire [31:0] devices   = $c32("sim_straps_devices(",NRV_DEVICES,")");
+`else
+   wire [31:0] ram_bytes = `NRV_RAM;
+   wire [31:0] devices   = NRV_DEVICES;
+`endif
+   
+   assign rdata = sel_memory  ? ram_bytes :
+		  sel_devices ? devices   :
+                  sel_cpuinfo ? (`NRV_FREQ << 16) | (NRV_ISA << 8) | counter_width : 32'b0;
    
 endmodule
@@ -12,6 +12,7 @@ localparam IO_SDCARD_bit                = 8;  // RW write: bit 0: mosi  bit 1: c
 localparam IO_BUTTONS_bit               = 9;  // R  buttons state
 localparam IO_FGA_CNTL_bit              = 10; // RW write: send command  read: get VSync/HSync/MemBusy/X/Y state
 localparam IO_FGA_DAT_bit               = 11; // W  write: write pixel data
+localparam IO_TIMER_bit                 = 12; // RW period of the timer interrupt, in cycles (0: stopped)
 
 // The three constant hardware config registers, using the three last bits of IO address space
 localparam IO_HW_CONFIG_RAM_bit     = 17;  // R  total quantity of RAM, in bytes
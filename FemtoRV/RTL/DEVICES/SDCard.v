@@ -1,14 +1,25 @@
 // femtorv32, a minimalistic RISC-V RV32I core
 //       Bruno Levy, 2020-2021
 //
-// This file: driver for SDCard (does nearly nothing,
-// for now it is just an interface for software bitbanging,
-// see FIRMWARE/LIBFEMTORV32/spi_sd.c)
+// This file: driver for SDCard, SPI mode 0
+// (see FIRMWARE/LIBFEMTORV32/spi_sd.c)
 //
+// Write:
+//   wdata[9]=1: sets the SPI clock divider to wdata[7:0]
+//               (SPI clock = clk / (2*(divider+1)))
+//   wdata[8]=1: sends wdata[7:0] with the shift register
+//               (and receives a byte at the same time)
+//   otherwise : software bitbanging, wdata[2:0] = CS_N,CLK,MOSI
+// Read:
+//   bit 31    : 1 (shift register present, the first SDCard driver
+//               only had bitbanging and returns MISO alone)
+//   bit 16    : busy (a byte is being transferred)
+//   bits 15:8 : last received byte
+//   bit 0     : MISO
 
 module SDCard(
     input wire 	       clk,   // system clock
-    input wire 	       rstrb, // read strobe		
+    input wire 	       rstrb, // read strobe
     input wire 	       wstrb, // write strobe
     input wire 	       sel,   // select (read/write ignored if low)
     input wire [31:0]  wdata, // data to be written
@@ -19,22 +30,58 @@ module SDCard(
     output wire	       CS_N,
     output wire        CLK
 );
-   reg [2:0] state; // CS_N,CLK,MOSI
+   reg [2:0] state; // CS_N,CLK,MOSI (bitbanging)
+
+   reg [7:0] divider;
+   reg [7:0] div_count;
+   reg [7:0] shifter;  // MSB sent first, received bits enter at LSB
+   reg [3:0] bitcount; // 0 means idle
+   reg 	     sclk;
+   reg 	     miso_sample;
+
+   wire      sending = |bitcount;
 
    assign CS_N = state[2];
-   assign CLK  = state[1];
-   assign MOSI = state[0];
-   
+   assign CLK  = sending ? sclk       : state[1];
+   assign MOSI = sending ? shifter[7] : state[0];
+
    initial begin
       state = 3'b100;
+      divider = 8'd0;
+      bitcount = 4'd0;
+      sclk = 1'b0;
    end
-   
-   assign rdata = (sel ? {31'b0, MISO} : 32'b0);
-   
+
+   assign rdata = (sel ? {1'b1, 14'b0, sending, shifter, 7'b0, MISO} : 32'b0);
+
    always @(posedge clk) begin
       if(sel && wstrb) begin
-	 state <= wdata[2:0];
+	 if(wdata[9]) begin
+	    divider <= wdata[7:0];
+	 end else if(wdata[8]) begin
+	    shifter   <= wdata[7:0];
+	    bitcount  <= 4'd8;
+	    div_count <= 8'd0;
+	    sclk      <= 1'b0;
+	 end else begin
+	    state <= wdata[2:0];
+	 end
+      end else if(sending) begin
+	 if(div_count == divider) begin
+	    div_count <= 8'd0;
+	    sclk <= !sclk;
+	    if(!sclk) begin
+	       // rising edge: sample MISO
+	       miso_sample <= MISO;
+	    end else begin
+	       // falling edge: shift, next bit on MOSI
+	       shifter  <= {shifter[6:0], miso_sample};
+	       bitcount <= bitcount - 4'd1;
+	    end
+	 end else begin
+	    div_count <= div_count + 8'd1;
+	 end
       end
    end
-   
+
 endmodule
@@ -0,0 +1,43 @@
+// femtorv32, a minimalistic RISC-V RV32I core
+//       Bruno Levy, 2020-2021
+//
+// This file: periodic timer, the interrupt source of the cores
+// that have interrupts (NRV_INTERRUPTS, e.g. gracilis).
+// Writing N (in cycles) raises interrupt_request every N cycles
+// (a one-cycle pulse, the core remembers it until it can take it),
+// writing 0 stops it. Reading returns the programmed period.
+// Used by the sampling profiler (FIRMWARE/LIBFEMTORV32/femto_pcprof.h).
+
+module Timer(
+    input wire 	       clk,   // system clock
+    input wire 	       reset, // set to 0 to reset
+    input wire 	       wstrb, // write strobe
+    input wire 	       sel,   // select (read/write ignored if low)
+    input wire [31:0]  wdata, // data to be written
+    output wire [31:0] rdata, // read data
+    output reg         irq    // one-cycle interrupt request
+);
+
+   reg [31:0] period;
+   reg [31:0] count;
+
+   assign rdata = (sel ? period : 32'b0);
+
+   always @(posedge clk) begin
+      irq <= 1'b0;
+      if(!reset) begin
+	 period <= 0;
+	 count  <= 0;
+      end else if(sel && wstrb) begin
+	 period <= wdata;
+	 count  <= wdata;
+      end else if(period != 0) begin
+	 if(count <= 1) begin
+	    count <= period;
+	    irq   <= 1'b1;
+	 end else begin
+	    count <= count - 1;
+	 end
+      end
+   end
+endmodule
@@ -681,6 +681,34 @@ module FemtoRV32(
       end
    end
 
+   /***************************************************************************/
+   // Retired instructions (Verilator only): PC, destination register (0 if
+   // none, 32..63: floating point registers) and written value, sent to
+   // the lockstep checker of SIM/lockstep.cpp (make BENCH.lockstep).
+   /***************************************************************************/
+
+`ifdef NRV_COMMIT_TRACE
+   reg  [ADDR_WIDTH-1:0] commit_PC;   // PC of the instruction in WAIT_xxx states
+   reg                   commit_wait; // WAIT_xxx states entered from EXECUTE
+   wire commit = reset & (
+      state[EXECUTE_bit] & !needToWait |
+      commit_wait & (state[WAIT_ALU_OR_MEM_bit] | state[WAIT_ALU_OR_MEM_SKIP_bit]) & !aluBusy & !fpuBusy & !mem_rbusy & !mem_wbusy
+   );
+   /* verilator lint_off WIDTH */
+   wire [31:0] commit_pc = state[EXECUTE_bit] ? PC : commit_PC;
+   /* verilator lint_on WIDTH */
+   wire [5:0]  commit_rd = writeBack & (rdIsFP | |instr[11:7]) ? {rdIsFP,instr[11:7]} : 6'd0;
+   always @(posedge clk) begin
+      if(!reset) begin
+	 commit_wait <= 0;
+      end else if(state[EXECUTE_bit]) begin
+	 commit_PC   <= PC;
+	 commit_wait <= needToWait;
+      end
+      if(commit) $c("commit_trace(",commit_pc,",",commit_rd,",",writeBackData,");");
+   end
+`endif
+
 `ifdef BENCH
    initial begin
       cycles = 0;
@@ -21,6 +21,7 @@
 `include "DEVICES/SDCard.v"         // Driver for SDCard (just for bitbanging for now)
 `include "DEVICES/Buttons.v"        // Driver for the buttons
 `include "DEVICES/FGA.v"            // Femto Graphic Adapter
+`include "DEVICES/Timer.v"          // Periodic timer interrupt
 `include "DEVICES/HardwareConfig.v" // Constant registers to query hardware config.
 
 // The Ice40UP5K has ample quantities (128 KB) of single-ported RAM that can be
@@ -281,6 +282,25 @@ module femtosoc(
 `endif
    
 `ifdef NRV_IO_FGA
+`ifdef NRV_FGA_HOST
+   // Verilator bench: the FGA is emulated at the bus level by a C++ model
+   // (SIM/FGA.h), the writes are forwarded to it ($c, see SIM/FGA_host.h)
+   // and the pixel pipeline and HDMI encoder are not simulated.
+   // FGA_clocks is the time base of the emulated raster (REG_STATUS).
+   reg [63:0] FGA_clocks = 0;
+   always @(posedge clk) begin
+      FGA_clocks <= FGA_clocks + 1;
+      if(io_wstrb && io_word_address[IO_FGA_CNTL_bit])
+	$c("FGA_host_cntl(",mem_wdata,",",FGA_clocks,");");
+      if(io_wstrb && io_word_address[IO_FGA_DAT_bit])
+	$c("FGA_host_dat(",mem_wdata,",",FGA_clocks,");");
+      if(mem_address_is_ram && mem_address_is_vram && |mem_wmask)
+	$c("FGA_host_vram(",mem_address[16:0],",",mem_wdata,",",mem_wmask,",",FGA_clocks,");");
+   end
+   wire [31:0] FGA_rdata = (io_rstrb && io_word_address[IO_FGA_CNTL_bit]) ? 
+			   $c32("FGA_host_read(",FGA_clocks,")") : 32'b0;
+   assign gpdi_dp = 4'b0;
+`else
    wire [31:0] FGA_rdata;
    FGA graphic_adapter(
       .pclk(pclk), // board clock		       
@@ -299,6 +319,7 @@ module femtosoc(
       .sel_dat(io_word_address[IO_FGA_DAT_bit]),
       .rdata(FGA_rdata)		       
    );
+`endif
 `endif   
    
 `ifdef NRV_MAPPED_SPI_FLASH
@@ -480,10 +501,11 @@ HardwareConfig hwconfig(
    
 /********************* SPI SDCard  *********************************/
 /*
- * This one has an output register directly wired to the CLK,MOSI,CS_N
- * and an input register directly wired to MISO. The software driver
- * implements the SPI protocol by bit-banging (see FIRMWARE/LIBFEMTORV32/spi_sd.c).
- * One day I'll replace it with a hardware driver... if I have time !
+ * A shift register sends and receives one byte per write (SPI mode 0,
+ * programmable clock divider). It also has an output register directly
+ * wired to the CLK,MOSI,CS_N and an input register directly wired to 
+ * MISO, for software bit-banging (chip select, initialization, and 
+ * the fallback of the driver, see FIRMWARE/LIBFEMTORV32/spi_sd.c).
  * ... a generic SPI driver would be good to have also.
  */
 `ifdef NRV_IO_SDCARD
@@ -514,6 +536,25 @@ HardwareConfig hwconfig(
       .BUTTONS(buttons)		   
    );
 `endif
+
+/********************* Timer  ***************************************/
+/*
+ * Periodic interrupt request, for the cores that have interrupts
+ * (sampling profiler, FIRMWARE/LIBFEMTORV32/femto_pcprof.h).
+ */
+`ifdef NRV_IO_TIMER
+   wire [31:0] timer_rdata;
+   wire        timer_irq;
+   Timer timer(
+      .clk(clk),
+      .reset(reset),
+      .wstrb(io_wstrb),
+      .sel(io_word_address[IO_TIMER_bit]),
+      .wdata(io_wdata),
+      .rdata(timer_rdata),
+      .irq(timer_irq)
+   );
+`endif
    
 /************** io_rdata, io_rbusy and io_wbusy signals *************/
 
@@ -539,6 +580,9 @@ always @(posedge clk) begin
 `endif
 `ifdef NRV_IO_FGA
 	    | FGA_rdata
+`endif
+`ifdef NRV_IO_TIMER
+	    | timer_rdata
 `endif
 	    ;
 end
@@ -579,7 +623,11 @@ end
     .mem_rbusy(mem_rbusy),
     .mem_wbusy(mem_wbusy),
 `ifdef NRV_INTERRUPTS
+ `ifdef NRV_IO_TIMER
+    .interrupt_request(timer_irq),
+ `else
     .interrupt_request(1'b0),	      
+ `endif
 `endif     
     .reset(reset && !uart_brk)
   );
@@ -30,6 +30,12 @@
 module femtoRV32_bench(
     input pclk, 
     output oled_DIN, oled_CLK, oled_CS, oled_DC, oled_RST
+`ifdef NRV_IO_SDCARD
+   ,output sd_mosi, sd_cs_n, sd_clk, input sd_miso    // SIM/SDCard.h
+`endif
+`ifdef NRV_SPI_FLASH
+   ,output spi_mosi, spi_cs_n, spi_clk, input spi_miso // SIM/SPIFlash.h
+`endif
 );
 `else
 module femtoRV32_bench();
@@ -51,6 +57,14 @@ module femtoRV32_bench();
       .oled_CS(oled_CS),
       .oled_DC(oled_DC),      
       .oled_RST(oled_RST),
+`endif
+`ifdef VERILATOR
+`ifdef NRV_IO_SDCARD
+      .sd_mosi(sd_mosi), .sd_miso(sd_miso), .sd_cs_n(sd_cs_n), .sd_clk(sd_clk),
+`endif
+`ifdef NRV_SPI_FLASH
+      .spi_mosi(spi_mosi), .spi_miso(spi_miso), .spi_cs_n(spi_cs_n), .spi_clk(spi_clk),
+`endif
 `endif
       .D1(LEDs[0]),
       .D2(LEDs[1]),		 
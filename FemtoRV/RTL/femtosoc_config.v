@@ -32,7 +32,9 @@
 `include "CONFIGS/cmod_a7_config.v"
 `endif
 
-`ifdef BENCH_VERILATOR
+`ifdef BENCH_SUPERSET
+`include "CONFIGS/bench_superset_config.v"
+`elsif BENCH_VERILATOR
 `include "CONFIGS/bench_config.v"
 `endif
 
@@ -0,0 +1,387 @@
+#include "FGA.h"
+#include "FGA_host.h"
+#include <cstring>
+#include <chrono>
+#include <cerrno>
+#include <sys/stat.h>
+
+// Register and command codes (FGA.v, FIRMWARE/LIBFEMTOGL/FGA.h)
+enum {
+   REG_STATUS = 0, REG_RESOLUTION, REG_COLORMODE, REG_DISPLAYMODE,
+   REG_ORIGIN, REG_WRAP, REG_READREGID
+};
+
+enum {
+   CMD_SET_PALETTE_R = 1, CMD_SET_PALETTE_G, CMD_SET_PALETTE_B,
+   CMD_SET_WWINDOW_X, CMD_SET_WWINDOW_Y, CMD_FILLRECT
+};
+
+static const uint32_t MODE_16bpp = 4;
+
+FGA* fga_host = nullptr;
+
+void FGA_host_cntl(uint32_t value, uint64_t clocks) {
+  if(fga_host != nullptr) {
+    fga_host->write_cntl(value, clocks);
+  }
+}
+
+void FGA_host_dat(uint32_t value, uint64_t clocks) {
+  if(fga_host != nullptr) {
+    fga_host->write_dat(value, clocks);
+  }
+}
+
+void FGA_host_vram(uint32_t addr, uint32_t value, uint32_t wmask, uint64_t clocks) {
+  if(fga_host != nullptr) {
+    fga_host->write_vram(addr, value, wmask, clocks);
+  }
+}
+
+uint32_t FGA_host_read(uint64_t clocks) {
+  return fga_host != nullptr ? fga_host->read_cntl(clocks) : 0;
+}
+
+FGA::FGA(
+  double freq_MHz, const char* frame_dir, unsigned int frame_every
+) : frame_dir_(frame_dir), frame_every_(frame_every == 0 ? 1 : frame_every) {
+  memset(&display_, 0, sizeof(display_));
+  memset(&frame_display_, 0, sizeof(frame_display_));
+  dirty_ = false;
+  read_regid_ = REG_STATUS;
+  window_x1_ = 0; window_x2_ = 0; window_x_ = 0;
+  window_y1_ = 0; window_y2_ = 0; window_y_ = 0;
+  window_row_start_ = 0;
+  window_pixel_address_ = 0;
+  mem_busy_ = false;
+  freq_MHz_ = freq_MHz > 0.0 ? freq_MHz : 1.0;
+  pixels_per_clock_ = double(PIXEL_CLOCK) / freq_MHz_;
+  clocks_ = 0;
+  frame_ = 0;
+  frame_ready_ = false;
+  stop_ = false;
+  window_ = nullptr;
+  nb_frames_ = 0;
+  nb_frames_written_ = 0;
+  if(frame_dir_ != nullptr) {
+    if(mkdir(frame_dir_, 0777) != 0 && errno != EEXIST) {
+      perror(frame_dir_);
+      exit(-1);
+    }
+    return;
+  }
+  // glfwInit() does nothing if the SSD1351 emulator already did it,
+  // and it terminates GLFW (it is created first, destroyed last)
+  if(!glfwInit()) {
+    fprintf(stderr,"Could not initialize glfw\n");
+    exit(-1);
+  }
+  glfwWindowHint(GLFW_RESIZABLE,GL_FALSE);
+  window_ = glfwCreateWindow(WIDTH,HEIGHT,"FemtoRV32 FGA",nullptr,nullptr);
+  render_thread_ = std::thread(&FGA::render_loop, this);
+}
+
+FGA::~FGA() {
+  if(frame_dir_ != nullptr) {
+    return;
+  }
+  stop_ = true;
+  render_thread_.join();
+  glfwDestroyWindow(window_);
+}
+
+// Publishes the display once per simulated frame in which it changed
+void FGA::sync(uint64_t clocks) {
+  clocks_ = clocks;
+  uint64_t frame = uint64_t(double(clocks) * pixels_per_clock_) / (LINE_WIDTH * LINES);
+  if(frame != frame_) {
+    frame_ = frame;
+    if(dirty_) {
+      redraw();
+    }
+  }
+}
+
+void FGA::write_cntl(uint32_t value, uint64_t clocks) {
+  sync(clocks);
+  uint32_t arg24   = value >> 8;
+  uint32_t arg12_1 = (value >> 8) & 0xfff;
+  uint32_t arg12_2 = (value >> 20) & 0xfff;
+  if(value & 128) {
+    switch(value & 7) {
+    case CMD_SET_PALETTE_R:
+    case CMD_SET_PALETTE_G:
+    case CMD_SET_PALETTE_B: {
+      unsigned int shift = 8 * (CMD_SET_PALETTE_B - (value & 7));
+      uint32_t& entry = display_.palette[arg12_1 & 255];
+      entry = (entry & ~(255u << shift)) | ((arg12_2 & 255) << shift);
+      dirty_ = true;
+    } break;
+    case CMD_SET_WWINDOW_X:
+      window_x1_ = arg12_1;
+      window_x2_ = arg12_2;
+      window_x_  = arg12_1;
+      mem_busy_  = true;
+      break;
+    case CMD_SET_WWINDOW_Y:
+      window_y1_ = arg12_1;
+      window_y2_ = arg12_2;
+      window_y_  = arg12_1;
+      mem_busy_  = true;
+      window_row_start_ = (arg12_1 * display_.width + window_x1_) & 0xffffff;
+      window_pixel_address_ = window_row_start_;
+      break;
+    case CMD_FILLRECT:
+      // one pixel per clock in FGA.v, the whole rectangle here
+      while(mem_busy_) {
+	window_pixel(arg24 & 0xffff);
+	next_window_pixel();
+      }
+      break;
+    default:
+      break;
+    }
+    return;
+  }
+  switch(value & 7) {
+  case REG_RESOLUTION:
+    display_.width  = arg24 & 0xfff;
+    display_.height = (arg24 >> 12) & 0xfff;
+    break;
+  case REG_COLORMODE:
+    display_.bpp = arg24 & 7;
+    display_.colormapped = (arg24 >> 3) & 1;
+    break;
+  case REG_DISPLAYMODE:
+    display_.magnify = arg24 & 1;
+    break;
+  case REG_READREGID:
+    read_regid_ = arg24 & 7;
+    break;
+  case REG_ORIGIN:
+    display_.origin = arg24;
+    break;
+  case REG_WRAP:
+    display_.wrap = arg24;
+    break;
+  default:
+    return;
+  }
+  dirty_ = true;
+}
+
+void FGA::write_dat(uint32_t value, uint64_t clocks) {
+  sync(clocks);
+  if(mem_busy_) {
+    window_pixel(value & 0xffff);
+    next_window_pixel();
+  }
+}
+
+void FGA::write_vram(uint32_t addr, uint32_t value, uint32_t wmask, uint64_t clocks) {
+  sync(clocks);
+  // ignored while the window is written (as in FGA.v)
+  if(mem_busy_) {
+    return;
+  }
+  uint32_t& word = display_.VRAM[(addr >> 2) & 32767];
+  for(unsigned int byte=0; byte<4; ++byte) {
+    if(wmask & (1 << byte)) {
+      word = (word & ~(255u << (8*byte))) | (value & (255u << (8*byte)));
+    }
+  }
+  dirty_ = true;
+}
+
+uint32_t FGA::read_cntl(uint64_t clocks) {
+  sync(clocks);
+  switch(read_regid_) {
+  case REG_RESOLUTION:  return (display_.height << 12) | display_.width;
+  case REG_COLORMODE:   return (display_.colormapped << 3) | display_.bpp;
+  case REG_DISPLAYMODE: return display_.magnify;
+  case REG_ORIGIN:      return display_.origin;
+  case REG_WRAP:        return display_.wrap;
+  case REG_READREGID:   return read_regid_;
+  default:              break;
+  }
+  uint64_t pixel = uint64_t(double(clocks) * pixels_per_clock_);
+  uint32_t X = uint32_t(pixel % LINE_WIDTH);
+  uint32_t Y = uint32_t((pixel / LINE_WIDTH) % LINES);
+  bool draw_area = (X < WIDTH) && (Y < HEIGHT);
+  // same bits as FGA.v (vblank and hblank are for the 640x400 modes)
+  return (uint32_t(Y >= 400) << 31) | (uint32_t(X >= 640) << 30) |
+         (uint32_t(draw_area) << 29) | (uint32_t(mem_busy_) << 28) |
+         (X << 12) | Y;
+}
+
+// Writes one pixel at the current position of the write window
+void FGA::window_pixel(uint32_t color) {
+  // 1bpp for the undefined modes, as in FGA.v
+  unsigned int bpp_log = (display_.bpp <= MODE_16bpp) ? display_.bpp : 0;
+  unsigned int bits = 1u << bpp_log;
+  unsigned int pix_per_word_log = 5 - bpp_log;
+  uint32_t a = window_pixel_address_;
+  uint32_t& word = display_.VRAM[(a >> pix_per_word_log) & 32767];
+  unsigned int shift = (a & ((1u << pix_per_word_log) - 1)) * bits;
+  uint32_t mask = (1u << bits) - 1;
+  word = (word & ~(mask << shift)) | ((color & mask) << shift);
+  dirty_ = true;
+}
+
+// Advances in the write window, the last pixel clears mem_busy_
+void FGA::next_window_pixel() {
+  window_pixel_address_ = (window_pixel_address_ + 1) & 0xffffff;
+  uint32_t x = window_x_;
+  window_x_ = (window_x_ + 1) & 0xfff;
+  if(x == window_x2_) {
+    if(window_y_ == window_y2_) {
+      mem_busy_ = false;
+    } else {
+      window_y_ = (window_y_ + 1) & 0xfff;
+      window_x_ = window_x1_;
+      window_row_start_ = (window_row_start_ + display_.width) & 0xffffff;
+      window_pixel_address_ = window_row_start_;
+    }
+  }
+}
+
+// Generates the RGB888 image scanned by FGA.v (ORIGIN, WRAP, magnify,
+// palette in the colormapped modes, RGB565 otherwise), without the
+// latency of its pixel pipeline (magnified pixel X,Y is pixel X/2,Y/2)
+void FGA::render(const Display& D, unsigned char* rgb, bool bottom_up) {
+  unsigned int bpp_log = (D.bpp <= MODE_16bpp) ? D.bpp : 0;
+  unsigned int bits = 1u << bpp_log;
+  unsigned int pix_per_word_log = 5 - bpp_log;
+  uint32_t maxX = (D.magnify ? (D.width  << 1) : D.width)  & 0xfff;
+  uint32_t maxY = (D.magnify ? (D.height << 1) : D.height) & 0xfff;
+  uint32_t row_start = D.origin;
+  for(uint32_t Y=0; Y<HEIGHT; ++Y) {
+    if(Y != 0 && (!(Y & 1) || !D.magnify)) {
+      row_start = (row_start + D.width <= D.wrap) ? row_start + D.width : 0;
+    }
+    unsigned char* p = rgb + 3 * WIDTH * (bottom_up ? HEIGHT-1-Y : Y);
+    for(uint32_t X=0; X<WIDTH; ++X, p += 3) {
+      if(X >= maxX || Y >= maxY) {
+	p[0] = p[1] = p[2] = 0;
+	continue;
+      }
+      uint32_t pix = (row_start + (D.magnify ? X/2 : X)) & 0xffffff;
+      uint32_t word = (D.bpp <= MODE_16bpp) ?
+	D.VRAM[(pix >> pix_per_word_log) & 32767] : D.VRAM[0];
+      if(D.colormapped) {
+	uint32_t index = 0;
+	if(bits <= 8) {
+	  unsigned int shift = (pix & ((1u << pix_per_word_log) - 1)) * bits;
+	  index = (word >> shift) & ((1u << bits) - 1);
+	}
+	uint32_t color = D.palette[index];
+	p[0] = (unsigned char)(color >> 16);
+	p[1] = (unsigned char)(color >> 8);
+	p[2] = (unsigned char)color;
+      } else {
+	uint32_t color = (pix & 1) ? (word >> 16) : (word & 0xffff);
+	p[0] = (unsigned char)(((color >> 11) & 31) << 3);
+	p[1] = (unsigned char)(((color >> 5)  & 63) << 2);
+	p[2] = (unsigned char)(( color        & 31) << 3);
+      }
+    }
+  }
+}
+
+// Publishes the display state to the render thread (or writes it to
+// frame_dir_ in headless mode)
+void FGA::redraw() {
+  ++nb_frames_;
+  dirty_ = false;
+  if(frame_dir_ != nullptr) {
+    if(nb_frames_ % frame_every_ == 0) {
+      write_frame();
+    }
+    return;
+  }
+  std::lock_guard<std::mutex> lock(frame_mutex_);
+  memcpy(&frame_display_, &display_, sizeof(frame_display_));
+  frame_ready_ = true;
+}
+
+void FGA::render_loop() {
+  glfwMakeContextCurrent(window_);
+  glfwSwapInterval(0);
+  static Display display;
+  static unsigned char pixels[WIDTH*HEIGHT*3];
+  auto next_frame = std::chrono::steady_clock::now();
+  while(!stop_) {
+    next_frame += std::chrono::microseconds(1000000 / FRAME_RATE);
+    std::this_thread::sleep_until(next_frame);
+    {
+      std::lock_guard<std::mutex> lock(frame_mutex_);
+      if(!frame_ready_) {
+	continue;
+      }
+      memcpy(&display, &frame_display_, sizeof(display));
+      frame_ready_ = false;
+    }
+    render(display, pixels, true);
+    glRasterPos2f(-1.0f,-1.0f);
+    glDrawPixels(WIDTH, HEIGHT, GL_RGB, GL_UNSIGNED_BYTE, pixels);
+    glfwSwapBuffers(window_);
+  }
+  glfwMakeContextCurrent(nullptr);
+}
+
+void FGA::write_frame() {
+  static unsigned char pixels[WIDTH*HEIGHT*3];
+  char filename[1024];
+  snprintf(
+     filename, sizeof(filename), "%s/fga_%06llu.rgb",
+     frame_dir_, nb_frames_written_
+  );
+  FILE* f = fopen(filename, "wb");
+  if(f == nullptr) {
+    perror(filename);
+    return;
+  }
+  render(display_, pixels, false);
+  fwrite(pixels, 1, sizeof(pixels), f);
+  fclose(f);
+  ++nb_frames_written_;
+}
+
+#ifdef SIM_SAVABLE
+
+// Applies f(pointer, size) to all the state variables
+// (same order for save and restore)
+template <class F> void FGA::state(F f) {
+  f(&display_, sizeof(display_));
+  f(&read_regid_, sizeof(read_regid_));
+  f(&window_x1_, sizeof(window_x1_)); f(&window_x2_, sizeof(window_x2_));
+  f(&window_y1_, sizeof(window_y1_)); f(&window_y2_, sizeof(window_y2_));
+  f(&window_x_, sizeof(window_x_)); f(&window_y_, sizeof(window_y_));
+  f(&window_row_start_, sizeof(window_row_start_));
+  f(&window_pixel_address_, sizeof(window_pixel_address_));
+  f(&mem_busy_, sizeof(mem_busy_));
+  f(&clocks_, sizeof(clocks_));
+  f(&frame_, sizeof(frame_));
+}
+
+void FGA::save(VerilatedSerialize& os) {
+  state([&os](void* p, size_t size) { os.write(p, size); });
+}
+
+void FGA::restore(VerilatedDeserialize& is) {
+  state([&is](void* p, size_t size) { is.read(p, size); });
+  // display the restored state
+  redraw();
+}
+
+#endif
+
+void FGA::print_stats() const {
+  double sim_seconds = double(clocks_) / (freq_MHz_ * 1e6);
+  printf(
+     "FGA: %llu frames (%llu written) in %.3f simulated s, "
+     "%.2f frames per simulated second\n",
+     nb_frames_, nb_frames_written_, sim_seconds,
+     sim_seconds > 0.0 ? double(nb_frames_) / sim_seconds : 0.0
+  );
+}
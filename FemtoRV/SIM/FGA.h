@@ -0,0 +1,116 @@
+#include "verilated.h"
+#ifdef SIM_SAVABLE
+#include "verilated_save.h"
+#endif
+#include <GLFW/glfw3.h>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+// Emulates the Femto Graphics Adapter (RTL/DEVICES/FGA.v) at the bus
+// level: with NRV_FGA_HOST, femtosoc.v forwards the writes to IO_FGA_CNTL,
+// IO_FGA_DAT and FGA_BASEMEM to this model (FGA_host.h) instead of
+// simulating the pixel pipeline, GFX_hdmi.v and the TMDS encoders at the
+// pixel clock. The registers, the palette, the write window and FILLRECT
+// follow FGA.v, the raster position (REG_STATUS) is computed from the
+// clock count for the 800x600 physical mode.
+// Differences: FILLRECT completes immediately (membusy is never seen
+// during a fill), and the image is not shifted by the latency of the
+// pixel pipeline (the two hidden columns are displayed).
+// The 800x600 image is drawn like the SSD1351 emulator does: a render
+// thread draws at FRAME_RATE a copy of the display state published once
+// per simulated frame in which it changed. Headless mode (frame_dir !=
+// nullptr): one frame out of frame_every is written to frame_dir as raw
+// RGB888 (800x600, top row first, fga_NNNNNN.rgb).
+class FGA {
+ public:
+   FGA(
+      double freq_MHz,
+      const char* frame_dir = nullptr, unsigned int frame_every = 1
+   );
+   ~FGA();
+
+   void write_cntl(uint32_t value, uint64_t clocks);
+   void write_dat(uint32_t value, uint64_t clocks);
+   void write_vram(uint32_t addr, uint32_t value, uint32_t wmask, uint64_t clocks);
+   uint32_t read_cntl(uint64_t clocks);
+
+#ifdef SIM_SAVABLE
+ // Saves/restores the state of the emulated FGA (with the model,
+ // see sim_main.cpp --save-at/--restore)
+   void save(VerilatedSerialize& os);
+   void restore(VerilatedDeserialize& is);
+#endif
+
+ // Prints the number of frames and frames per simulated second
+   void print_stats() const;
+
+   // Physical mode (MODE_800x600 in FGA.v and GFX_modes.v)
+   static const unsigned int WIDTH       = 800;
+   static const unsigned int HEIGHT      = 600;
+   static const unsigned int LINE_WIDTH  = 800 + 40 + 128 + 88;
+   static const unsigned int LINES       = 600 + 1 + 4 + 23;
+   static const unsigned int PIXEL_CLOCK = 40; // MHz
+
+ private:
+   // What is visible: sent to the render thread
+   struct Display {
+      uint32_t VRAM[32768];
+      uint32_t palette[256];     // R[23:16] G[15:8] B[7:0]
+      uint32_t width, height;    // REG_RESOLUTION
+      uint32_t bpp;              // REG_COLORMODE, FGA.v MODE_xxbpp
+      uint32_t colormapped;
+      uint32_t magnify;          // REG_DISPLAYMODE
+      uint32_t origin;           // REG_ORIGIN, pixel address
+      uint32_t wrap;             // REG_WRAP, pixel address
+   };
+
+   static void render(const Display& D, unsigned char* rgb, bool bottom_up);
+
+   void window_pixel(uint32_t color);
+   void next_window_pixel();
+   void sync(uint64_t clocks);
+   void redraw();
+   void render_loop();
+   void write_frame();
+#ifdef SIM_SAVABLE
+   template <class F> void state(F f);
+#endif
+
+   static const unsigned int FRAME_RATE = 60;
+
+ private:
+   Display display_;
+   bool dirty_;
+
+   uint32_t read_regid_;
+   uint32_t window_x1_, window_x2_, window_y1_, window_y2_;
+   uint32_t window_x_, window_y_;
+   uint32_t window_row_start_;
+   uint32_t window_pixel_address_;
+   bool mem_busy_;
+
+   double freq_MHz_;
+   double pixels_per_clock_;
+   uint64_t clocks_;          // clock count of the last access
+   uint64_t frame_;           // simulated frame of the last access
+
+   // Last state published by redraw(), read by the render thread
+   std::mutex frame_mutex_;
+   Display frame_display_;
+   bool frame_ready_;
+
+   GLFWwindow* window_;
+   std::thread render_thread_;
+   std::atomic<bool> stop_;
+
+   // Headless mode
+   const char* frame_dir_;
+   unsigned int frame_every_;
+   unsigned long long nb_frames_;
+   unsigned long long nb_frames_written_;
+};
+
+// The model that receives the FGA_host_xxx() calls, set by sim_main.cpp
+extern FGA* fga_host;
@@ -0,0 +1,10 @@
+// Called by femtosoc.v compiled with -DNRV_FGA_HOST (Verilator $c) for
+// each access to the FGA, implemented by the host FGA model (FGA.cpp)
+#include <stdint.h>
+
+// clocks: cycles of the system clock since reset (time base of the raster)
+// addr: byte address in the graphic memory (FGA_BASEMEM offset, 128K)
+void FGA_host_cntl(uint32_t value, uint64_t clocks);
+void FGA_host_dat(uint32_t value, uint64_t clocks);
+void FGA_host_vram(uint32_t addr, uint32_t value, uint32_t wmask, uint64_t clocks);
+uint32_t FGA_host_read(uint64_t clocks);
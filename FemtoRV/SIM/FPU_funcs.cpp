@@ -7,9 +7,18 @@
 #include <algorithm>
 #include <iostream>
 #include <cstring>
+#include <mutex>
+#include <atomic>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 /*********************************************/
 
+// -DNO_FPU_LOG: no list of the FPU functions called on exit
+// (for the harnesses where stdout is the firmware output)
+#ifndef NO_FPU_LOG
 #define FPU_LOG
+#endif
 
 #ifdef FPU_LOG
 
@@ -22,6 +31,7 @@
 class FPULogger {
 public:
   void log(const char* p) {
+    std::lock_guard<std::mutex> lock(mutex_);
     funcs_.insert(std::string(p));
   }
   ~FPULogger() {
@@ -39,12 +49,19 @@ public:
   }
 private:
   std::set<std::string> funcs_;
+  std::mutex mutex_;
 };
 
 FPULogger logger;
-inline void L(const char* s) {
-  logger.log(s);
-}
+
+// Logs the first call only (a static flag per call site), so that
+// logging does not cost a std::set insertion per FPU instruction.
+#define L(s) do {                                                     \
+  static std::atomic<bool> logged_(false);                            \
+  if(!logged_.load(std::memory_order_relaxed) && !logged_.exchange(true)) { \
+    logger.log(s);                                                    \
+  }                                                                   \
+} while(0)
 
 #else
 #define L(x)
@@ -62,26 +79,12 @@ inline int test_bit(uint32_t x, int i) {
 
 // Count leading zeroes
 inline int clz(uint32_t x) {
-  int result = 0;
-  for(int i=31; i>=0; --i) {
-    if(test_bit(x,i)) {
-      return result;
-    }
-    ++result;
-  }
-  return result;
+  return (x == 0) ? 32 : __builtin_clz(x);
 }
 
 // Count leading zeroes
 inline int clz(uint64_t x) {
-  int result = 0;
-  for(int i=63; i>=0; --i) {
-    if(test_bit(x,i)) {
-      return result;
-    }
-    ++result;    
-  }
-  return result;
+  return (x == 0) ? 64 : __builtin_clzll(x);
 }
 
 
@@ -231,6 +234,13 @@ int32_t compress(uint32_t mant, int exp, int sign) {
 
 /*********************************************/
 
+// If false, check() does not print the mismatches
+static bool check_verbose = true;
+
+void set_check_verbose(bool verbose) {
+  check_verbose = verbose;
+}
+
 uint32_t check(
      const char* func,
      uint32_t rs1, uint32_t rs2, uint32_t rs3,
@@ -249,6 +259,9 @@ uint32_t check(
   // printf("CHECK%s\n",func);
   
   if(!(RESULT.is_zero() && CHECK.is_zero()) && result != chk) {
+    if(!check_verbose) {
+      return 0;
+    }
     printf("%s mismatch\n",func);
 
     if(int_arg) {
@@ -399,7 +412,7 @@ public:
 
 void normalize23(uint64_t& mant, int& exp) {
 
-  if(exp < -255 || exp > 255) {
+  if(check_verbose && (exp < -255 || exp > 255)) {
     printf("EXP OVERFLOW !!\n");
   }
   
@@ -634,7 +647,7 @@ uint32_t FSQRT_WITH_SOFT_FPU(uint32_t x) {
 uint32_t FSGNJ_WITH_SOFT_FPU(uint32_t x, uint32_t y) {
   IEEE754 X(x), Y(y);
   X.sign = Y.sign;
-  return Y.i;
+  return X.i;
 }
 
 uint32_t FSGNJN_WITH_SOFT_FPU(uint32_t x, uint32_t y) {
@@ -725,9 +738,25 @@ uint32_t FLE_WITH_SOFT_FPU(uint32_t x, uint32_t y) {
   return (decodef(x) <= decodef(y));
 }
 
+// One-hot class of x (RISC-V spec, FCLASS.S):
+// 0:-inf 1:-normal 2:-subnormal 3:-0 4:+0 5:+subnormal 6:+normal
+// 7:+inf 8:signaling NaN 9:quiet NaN
 uint32_t FCLASS_WITH_SOFT_FPU(uint32_t x) {
-  printf("FCLASS - not implemented yet\n");
-  return 0;
+  IEEE754 X(x);
+  if(X.is_NaN()) {
+    return (X.mant & (1u << 22)) ? (1u << 9) : (1u << 8);
+  }
+  int bit;
+  if(X.is_infty()) {
+    bit = 0;
+  } else if(X.is_normal()) {
+    bit = 1;
+  } else if(X.is_denormal()) {
+    bit = 2;
+  } else {
+    bit = 3;
+  }
+  return X.sign ? (1u << bit) : (1u << (7 - bit));
 }
 
 uint32_t FCVTSW_WITH_SOFT_FPU(uint32_t x) {
@@ -742,6 +771,10 @@ uint32_t FCVTSWU_WITH_SOFT_FPU(uint32_t x) {
 
 static int use_soft_fpu = 0;
 
+void set_use_soft_fpu(bool soft) {
+  use_soft_fpu = soft;
+}
+
 uint32_t FMADD(uint32_t x, uint32_t y, uint32_t z) {
   if(use_soft_fpu) {
     return FMADD_WITH_SOFT_FPU(x,y,z);
@@ -821,7 +854,7 @@ uint32_t FSGNJ(uint32_t x, uint32_t y) {
   L("FSGNJ");  
   IEEE754 X(x), Y(y);
   X.sign = Y.sign;
-  return Y.i;
+  return X.i;
 }
 
 uint32_t FSGNJN(uint32_t x, uint32_t y) {
@@ -905,8 +938,7 @@ uint32_t FCLASS(uint32_t x) {
     return FCLASS_WITH_SOFT_FPU(x);
   }
   L("FCLASS");             
-  printf("FCLASS - not implemented yet\n");
-  return 0;
+  return FCLASS_WITH_SOFT_FPU(x);
 }
 
 uint32_t FCVTSW(uint32_t x) {
@@ -1003,3 +1035,278 @@ uint32_t CHECK_FSGNJ(uint32_t result, uint32_t x, uint32_t y) { return 1; }
 uint32_t CHECK_FSGNJN(uint32_t result, uint32_t x, uint32_t y) { return 1; }
 uint32_t CHECK_FSGNJX(uint32_t result, uint32_t x, uint32_t y) { return 1; }
 uint32_t CHECK_FCLASS(uint32_t result, uint32_t x) { return 1; }
+
+/***********************************************************/
+
+// Batch checks, 4 operands at a time with SSE. The host FPU uses the
+// same rounding mode and flush-to-zero setting (set in MXCSR by
+// sim_main.cpp) for scalar and SSE operations, so the reference results
+// are the same as the ones of the scalar CHECK_XXX() functions. Only the
+// mismatching lanes go through check(), that prints them.
+
+// Returns the number of mismatches in the 4 lanes
+static inline uint32_t check_lanes(
+  const char* func, const uint32_t* result, const uint32_t* x,
+  const uint32_t* y, const uint32_t* chk, int nb_args
+) {
+#ifdef __SSE2__
+  // Fast path: all lanes are identical, or both are zero (any sign)
+  __m128i R   = _mm_loadu_si128((const __m128i*)result);
+  __m128i C   = _mm_loadu_si128((const __m128i*)chk);
+  __m128i abs = _mm_set1_epi32(0x7fffffff);
+  __m128i eq  = _mm_cmpeq_epi32(R,C);
+  __m128i zero = _mm_and_si128(
+     _mm_cmpeq_epi32(_mm_and_si128(R,abs),_mm_setzero_si128()),
+     _mm_cmpeq_epi32(_mm_and_si128(C,abs),_mm_setzero_si128())
+  );
+  if(_mm_movemask_epi8(_mm_or_si128(eq,zero)) == 0xFFFF) {
+    return 0;
+  }
+#endif
+  uint32_t nb_mismatches = 0;
+  for(int i=0; i<4; ++i) {
+    nb_mismatches += !check(
+       func, x[i], y == nullptr ? 0 : y[i], 0, result[i], chk[i], nb_args
+    );
+  }
+  return nb_mismatches;
+}
+
+#ifdef __SSE2__
+#define FPU_BATCH_OP2(name, sse_op)                                        \
+uint32_t CHECK_##name##_BATCH(                                             \
+  const uint32_t* result, const uint32_t* x, const uint32_t* y, size_t n   \
+) {                                                                        \
+  uint32_t nb_mismatches = 0;                                              \
+  size_t i = 0;                                                            \
+  for(; i+4 <= n; i += 4) {                                                \
+    uint32_t chk[4];                                                       \
+    _mm_storeu_ps(                                                         \
+       (float*)chk,                                                        \
+       sse_op(_mm_loadu_ps((const float*)(x+i)),                           \
+              _mm_loadu_ps((const float*)(y+i)))                           \
+    );                                                                     \
+    nb_mismatches += check_lanes(#name, result+i, x+i, y+i, chk, 2);       \
+  }                                                                        \
+  for(; i<n; ++i) {                                                        \
+    nb_mismatches += !CHECK_##name(result[i], x[i], y[i]);                 \
+  }                                                                        \
+  return nb_mismatches;                                                    \
+}
+#else
+#define FPU_BATCH_OP2(name, sse_op)                                        \
+uint32_t CHECK_##name##_BATCH(                                             \
+  const uint32_t* result, const uint32_t* x, const uint32_t* y, size_t n   \
+) {                                                                        \
+  uint32_t nb_mismatches = 0;                                              \
+  for(size_t i=0; i<n; ++i) {                                              \
+    nb_mismatches += !CHECK_##name(result[i], x[i], y[i]);                 \
+  }                                                                        \
+  return nb_mismatches;                                                    \
+}
+#endif
+
+FPU_BATCH_OP2(FADD, _mm_add_ps)
+FPU_BATCH_OP2(FSUB, _mm_sub_ps)
+FPU_BATCH_OP2(FMUL, _mm_mul_ps)
+FPU_BATCH_OP2(FDIV, _mm_div_ps)
+
+uint32_t CHECK_FSQRT_BATCH(const uint32_t* result, const uint32_t* x, size_t n) {
+  uint32_t nb_mismatches = 0;
+  size_t i = 0;
+#ifdef __SSE2__
+  for(; i+4 <= n; i += 4) {
+    uint32_t chk[4];
+    _mm_storeu_ps((float*)chk, _mm_sqrt_ps(_mm_loadu_ps((const float*)(x+i))));
+    nb_mismatches += check_lanes("FSQRT", result+i, x+i, nullptr, chk, 1);
+  }
+#endif
+  for(; i<n; ++i) {
+    nb_mismatches += !CHECK_FSQRT(result[i], x[i]);
+  }
+  return nb_mismatches;
+}
+
+/*****************************************************************/
+// Iterative FRCP / FDIV / FSQRT models (FPUIterConfig, see FPU_funcs.h)
+/*****************************************************************/
+
+typedef unsigned __int128 uint128_t;
+
+// Product of two fractions with width bits, truncated
+static inline uint64_t iter_mul(uint64_t x, uint64_t y, int width) {
+  return uint64_t((uint128_t(x) * uint128_t(y)) >> width);
+}
+
+// Seed table entry: 1/d (1/sqrt(d)) at the middle of the interval of
+// the index, seed_bits+2 bits, as a fraction with width bits.
+static uint64_t iter_seed(const FPUIterConfig& config, double mid, bool sqrt) {
+  double seed = sqrt ? 1.0 / std::sqrt(mid) : 1.0 / mid;
+  int bits = config.seed_bits + 2;
+  return uint64_t(std::llround(std::ldexp(seed, bits))) << (config.width - bits);
+}
+
+// Rounds a fraction with width bits to its first bits (the result has
+// 24 significant bits)
+static uint32_t iter_round(const FPUIterConfig& config, uint64_t q, int bits) {
+  int extra = config.width - bits;
+  uint64_t t = q >> extra;
+  if(!config.rtz) {
+    uint64_t half = uint64_t(1) << (extra-1);
+    uint64_t rest = q & ((half << 1) - 1);
+    if(rest > half || (rest == half && (t & 1))) {
+      ++t;
+    }
+  }
+  return uint32_t(t);
+}
+
+// Result from a 24 bits significand (renormalized if the approximation
+// moved it out of [2^23,2^24)) and a biased exponent.
+static uint32_t iter_pack(uint64_t t, int exp, int sign) {
+  while(t >= (uint64_t(1) << 24)) {
+    t >>= 1;
+    ++exp;
+  }
+  while(t != 0 && t < (uint64_t(1) << 23)) {
+    t <<= 1;
+    --exp;
+  }
+  if(t == 0 || exp <= 0) {
+    return uint32_t(sign) << 31;
+  }
+  if(exp >= 255) {
+    return (uint32_t(sign) << 31) | 0x7f800000;
+  }
+  return compress(uint32_t(t) & 0x7fffff, exp, sign);
+}
+
+// 1/d, d significand with 23 fraction bits, as a fraction with width bits
+static uint64_t iter_reciprocal(const FPUIterConfig& config, uint32_t D) {
+  int w = config.width;
+  uint32_t index = (D & 0x7fffff) >> (23 - config.seed_bits);
+  double mid = 1.0 + (double(index) + 0.5) / double(1 << config.seed_bits);
+  uint64_t x = iter_seed(config, mid, false);
+  uint64_t d = uint64_t(D) << (w - 23);
+  for(int i=0; i<config.iterations; ++i) {
+    uint64_t e = iter_mul(d, x, w);
+    uint64_t two = uint64_t(2) << w;
+    x = iter_mul(x, e < two ? two - e : 0, w);
+  }
+  return x;
+}
+
+uint32_t FDIV_ITER(const FPUIterConfig& config, uint32_t x_in, uint32_t y_in) {
+  uint32_t A, D;
+  int A_exp, D_exp, A_sign, D_sign;
+  expand(x_in, A, A_exp, A_sign);
+  expand(y_in, D, D_exp, D_sign);
+  int sign = A_sign ^ D_sign;
+
+  // A/D in [1,2): 23 fraction bits, in (0.5,1): 24
+  int bits = (A >= D) ? 23 : 24;
+  int exp = A_exp - D_exp + 127 - (bits - 23);
+
+  uint64_t r = iter_reciprocal(config, D);
+  uint64_t q = (A == (1u << 23)) ? r : iter_mul(uint64_t(A) << (config.width - 23), r, config.width);
+
+  if(!config.correction) {
+    return iter_pack(iter_round(config, q, bits), exp, sign);
+  }
+
+  // Remainder A*2^bits - t*D: moves t by one ulp if needed, then
+  // t is the quotient truncated, and the remainder gives the rounding.
+  int64_t t = int64_t(q >> (config.width - bits));
+  int64_t N = int64_t(A) << bits;
+  int64_t rem = N - t * int64_t(D);
+  if(rem < 0) {
+    --t;
+    rem += D;
+  } else if(rem >= int64_t(D)) {
+    ++t;
+    rem -= D;
+  }
+  if(!config.rtz && (2*rem > int64_t(D) || (2*rem == int64_t(D) && (t & 1)))) {
+    ++t;
+  }
+  return iter_pack(uint64_t(t), exp, sign);
+}
+
+uint32_t FRCP_ITER(const FPUIterConfig& config, uint32_t x) {
+  return FDIV_ITER(config, 0x3f800000 | (x & 0x80000000), x);
+}
+
+uint32_t FSQRT_ITER(const FPUIterConfig& config, uint32_t x_in) {
+  uint32_t M;
+  int M_exp, M_sign;
+  expand(x_in, M, M_exp, M_sign);
+  int w = config.width;
+
+  // x = X 2^(2e), X in [1,4) with 23 fraction bits
+  int e = M_exp - 127;
+  int odd = e & 1;
+  uint64_t X = uint64_t(M) << odd;
+  int exp = (e - odd) / 2 + 127;
+
+  uint32_t index = (M & 0x7fffff) >> (23 - config.seed_bits);
+  double mid = double(1 << odd) * (1.0 + (double(index) + 0.5) / double(1 << config.seed_bits));
+  uint64_t y = iter_seed(config, mid, true);
+  uint64_t xw = X << (w - 23);
+  for(int i=0; i<config.iterations; ++i) {
+    uint64_t e2 = iter_mul(xw, iter_mul(y, y, w), w);
+    uint64_t three = uint64_t(3) << w;
+    y = iter_mul(y, e2 < three ? three - e2 : 0, w) >> 1;
+  }
+  uint64_t s = iter_mul(xw, y, w);
+
+  if(!config.correction) {
+    return iter_pack(iter_round(config, s, 23), exp, M_sign);
+  }
+
+  // Remainder X*2^23 - t^2: t is the root truncated if 0 <= rem <= 2t,
+  // rounded up if rem > t (no ties for square roots).
+  int64_t t = int64_t(s >> (w - 23));
+  int64_t N = int64_t(X) << 23;
+  int64_t rem = N - t * t;
+  if(rem < 0) {
+    --t;
+    rem = N - t * t;
+  } else if(rem > 2*t) {
+    ++t;
+    rem = N - t * t;
+  }
+  if(!config.rtz && rem > t) {
+    ++t;
+  }
+  return iter_pack(uint64_t(t), exp, M_sign);
+}
+
+static int iter_mul_cycles(int width, int dsp_bits) {
+  if(dsp_bits <= 0) {
+    return 1;
+  }
+  int n = (width + dsp_bits - 1) / dsp_bits;
+  return n * n;
+}
+
+// Table lookup, Newton-Raphson, final multiply, correction, rounding
+static int iter_latency(const FPUIterConfig& config, int dsp_bits, int muls_per_iter, int final_muls) {
+  int mul = iter_mul_cycles(config.width, dsp_bits);
+  int latency = 1 + config.iterations * muls_per_iter * mul + final_muls * mul + 1;
+  if(config.correction) {
+    latency += iter_mul_cycles(24, dsp_bits) + 1;
+  }
+  return latency;
+}
+
+int FRCP_ITER_latency(const FPUIterConfig& config, int dsp_bits) {
+  return iter_latency(config, dsp_bits, 2, 0);
+}
+
+int FDIV_ITER_latency(const FPUIterConfig& config, int dsp_bits) {
+  return iter_latency(config, dsp_bits, 2, 1);
+}
+
+int FSQRT_ITER_latency(const FPUIterConfig& config, int dsp_bits) {
+  return iter_latency(config, dsp_bits, 3, 1);
+}
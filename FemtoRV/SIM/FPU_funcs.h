@@ -1,8 +1,16 @@
 // FPU: for now simulated / implemented in C++
 #include <stdint.h>
+#include <stddef.h>
 
 void print_float(uint32_t x);
 
+// Selects the implementation of FMADD()...FCVTSWU(): the C++ model of
+// the FPU algorithms (soft = true) or the host FPU (default)
+void set_use_soft_fpu(bool soft);
+
+// If false, CHECK_XXX() do not print the mismatches (default: true)
+void set_check_verbose(bool verbose);
+
 uint32_t FMADD(uint32_t x, uint32_t y, uint32_t z);
 uint32_t FMSUB(uint32_t x, uint32_t y, uint32_t z);
 uint32_t FNMADD(uint32_t x, uint32_t y, uint32_t z);
@@ -60,3 +68,54 @@ uint32_t CHECK_FLE(uint32_t result, uint32_t x, uint32_t y);
 uint32_t CHECK_FCLASS(uint32_t result, uint32_t x);
 uint32_t CHECK_FCVTSW(uint32_t result, uint32_t x);
 uint32_t CHECK_FCVTSWU(uint32_t result, uint32_t x);
+
+/*******************************************/
+
+// Batch versions of CHECK_XXX, for FPU conformance sweeps: check n
+// results at once (4 per SSE operation), print the mismatches and
+// return their number.
+
+uint32_t CHECK_FADD_BATCH(const uint32_t* result, const uint32_t* x, const uint32_t* y, size_t n);
+uint32_t CHECK_FSUB_BATCH(const uint32_t* result, const uint32_t* x, const uint32_t* y, size_t n);
+uint32_t CHECK_FMUL_BATCH(const uint32_t* result, const uint32_t* x, const uint32_t* y, size_t n);
+uint32_t CHECK_FDIV_BATCH(const uint32_t* result, const uint32_t* x, const uint32_t* y, size_t n);
+uint32_t CHECK_FSQRT_BATCH(const uint32_t* result, const uint32_t* x, size_t n);
+
+/*******************************************/
+
+// Parameterized models of the iterative FRCP / FDIV / FSQRT of a
+// hardware FPU, for the design space exploration of SIM/fpu_explore.cpp.
+// They only model the significand datapath: the operands and the result
+// are normal numbers, the exponent and the special cases are handled
+// outside of the iterations.
+//
+// - a seed table, indexed by the seed_bits first bits of the fraction
+//   (and the parity of the exponent for FSQRT), gives 1/d (1/sqrt(x))
+//   with seed_bits+2 bits
+// - iterations of Newton-Raphson, on width-bit fractions (truncated
+//   products): x <- x(2 - dx), 2 multiplies, for 1/d, and
+//   y <- y(3 - xy^2)/2, 3 multiplies, for 1/sqrt(x)
+// - one multiply by the dividend (by x for FSQRT)
+// - if correction, the remainder (one exact multiply-subtract) moves
+//   the quotient (root) by at most one ulp and selects the rounding,
+//   else the quotient is rounded from the extra bits of the
+//   approximation
+
+struct FPUIterConfig {
+  int  seed_bits;  // 2..16
+  int  iterations; // 0..4
+  int  width;      // 26..60
+  bool correction;
+  bool rtz;        // round towards zero, else to nearest even
+};
+
+uint32_t FRCP_ITER(const FPUIterConfig& config, uint32_t x);
+uint32_t FDIV_ITER(const FPUIterConfig& config, uint32_t x, uint32_t y);
+uint32_t FSQRT_ITER(const FPUIterConfig& config, uint32_t x);
+
+// Estimated latency in cycles: table lookup, multiplies of
+// ceil(width/dsp_bits)^2 cycles (one dsp_bits x dsp_bits multiplier,
+// 1 cycle if dsp_bits is 0), correction, rounding.
+int FRCP_ITER_latency(const FPUIterConfig& config, int dsp_bits);
+int FDIV_ITER_latency(const FPUIterConfig& config, int dsp_bits);
+int FSQRT_ITER_latency(const FPUIterConfig& config, int dsp_bits);
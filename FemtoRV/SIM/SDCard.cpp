@@ -0,0 +1,194 @@
+#include "SDCard.h"
+#include <cstdio>
+#include <cstring>
+
+// R1 response bits
+static const uint8_t R1_IDLE            = 0x01;
+static const uint8_t R1_ILLEGAL_COMMAND = 0x04;
+static const uint8_t R1_ADDRESS_ERROR   = 0x20;
+
+// Data tokens
+static const uint8_t START_BLOCK          = 0xfe;
+static const uint8_t START_MULTIPLE_BLOCK = 0xfc;
+static const uint8_t STOP_TRAN            = 0xfd;
+static const uint8_t DATA_ACCEPTED        = 0x05;
+
+SDCard::SDCard(CData& CLK, CData& CS_N, CData& MOSI, CData& MISO) :
+  SPISlave(CLK, CS_N, MOSI, MISO) {
+  state_ = IDLE;
+  idle_ = true;
+  app_cmd_ = false;
+  multiple_ = false;
+  cmd_len_ = 0;
+  block_ = 0;
+  out_pos_ = 0;
+  data_len_ = 0;
+  nb_commands_ = 0;
+  nb_blocks_read_ = 0;
+  nb_blocks_written_ = 0;
+  nb_bytes_ = 0;
+}
+
+bool SDCard::open(const char* filename) {
+  return image_.open(filename);
+}
+
+bool SDCard::block_ok(uint32_t block) const {
+  return (uint64_t(block) + 1) * BLOCK_SIZE <= image_.size();
+}
+
+// Replaces the bytes to be sent (the rest of a previous response is
+// dropped when a new command arrives)
+void SDCard::respond(std::initializer_list<uint8_t> bytes) {
+  out_.assign(bytes.begin(), bytes.end());
+  out_pos_ = 0;
+}
+
+// Queues a start of block token, the block and its (dummy) CRC
+void SDCard::send_block() {
+  const uint8_t* from = image_.data() + size_t(block_) * BLOCK_SIZE;
+  out_.push_back(START_BLOCK);
+  out_.insert(out_.end(), from, from + BLOCK_SIZE);
+  out_.push_back(0xff);
+  out_.push_back(0xff);
+  ++block_;
+  ++nb_blocks_read_;
+}
+
+void SDCard::command() {
+  ++nb_commands_;
+  uint8_t index = cmd_[0] & 63;
+  uint32_t arg =
+    (uint32_t(cmd_[1]) << 24) | (uint32_t(cmd_[2]) << 16) |
+    (uint32_t(cmd_[3]) << 8)  |  uint32_t(cmd_[4]);
+  bool app_cmd = app_cmd_;
+  app_cmd_ = false;
+  uint8_t r1 = idle_ ? R1_IDLE : 0;
+  // one byte (0xff) before the response
+  if(app_cmd && index == 41) {           // ACMD41: SD_SEND_OP_COND
+    idle_ = false;
+    respond({0xff, 0x00});
+    return;
+  }
+  switch(index) {
+  case 0:                                // GO_IDLE_STATE
+    idle_ = true;
+    state_ = IDLE;
+    respond({0xff, R1_IDLE});
+    break;
+  case 8:                                // SEND_IF_COND (R7, echoes the pattern)
+    respond({0xff, r1, 0x00, 0x00, uint8_t((arg >> 8) & 15), uint8_t(arg)});
+    break;
+  case 12:                               // STOP_TRANSMISSION (R1b)
+    state_ = IDLE;
+    respond({0xff, r1, 0x00});
+    break;
+  case 16:                               // SET_BLOCKLEN (always 512 for SDHC)
+    respond({0xff, r1});
+    break;
+  case 17:                               // READ_SINGLE_BLOCK
+  case 18:                               // READ_MULTIPLE_BLOCK
+    if(!block_ok(arg)) {
+      respond({0xff, uint8_t(r1 | R1_ADDRESS_ERROR)});
+      break;
+    }
+    respond({0xff, r1, 0xff});
+    block_ = arg;
+    send_block();
+    if(index == 18) {
+      state_ = READING;
+    }
+    break;
+  case 24:                               // WRITE_BLOCK
+  case 25:                               // WRITE_MULTIPLE_BLOCK
+    if(!block_ok(arg)) {
+      respond({0xff, uint8_t(r1 | R1_ADDRESS_ERROR)});
+      break;
+    }
+    respond({0xff, r1});
+    block_ = arg;
+    multiple_ = (index == 25);
+    state_ = WRITE_TOKEN;
+    break;
+  case 55:                               // APP_CMD
+    app_cmd_ = true;
+    respond({0xff, r1});
+    break;
+  case 58:                               // READ_OCR (R3): powered up, CCS (SDHC), 3.2-3.4V
+    respond({0xff, r1, 0xc0, 0xff, 0x80, 0x00});
+    break;
+  default:
+    respond({0xff, uint8_t(r1 | R1_ILLEGAL_COMMAND)});
+    break;
+  }
+}
+
+void SDCard::receive_block(uint8_t in) {
+  data_[data_len_++] = in;
+  if(data_len_ < sizeof(data_)) {
+    return;
+  }
+  data_len_ = 0;
+  if(!block_ok(block_)) {
+    // past the end of the image (CMD25): write error
+    out_.assign({0x0d});
+    out_pos_ = 0;
+    state_ = multiple_ ? WRITE_TOKEN : IDLE;
+    return;
+  }
+  memcpy(image_.data() + size_t(block_) * BLOCK_SIZE, data_, BLOCK_SIZE);
+  ++block_;
+  ++nb_blocks_written_;
+  // data response, then one busy byte
+  out_.assign({DATA_ACCEPTED, 0x00});
+  out_pos_ = 0;
+  state_ = multiple_ ? WRITE_TOKEN : IDLE;
+}
+
+uint8_t SDCard::transfer(uint8_t in) {
+  ++nb_bytes_;
+  switch(state_) {
+  case WRITE_TOKEN:
+    if(in == START_BLOCK || (multiple_ && in == START_MULTIPLE_BLOCK)) {
+      state_ = WRITE_DATA;
+      data_len_ = 0;
+    } else if(multiple_ && in == STOP_TRAN) {
+      // one byte, then busy
+      out_.assign({0xff, 0x00});
+      out_pos_ = 0;
+      state_ = IDLE;
+    }
+    break;
+  case WRITE_DATA:
+    receive_block(in);
+    break;
+  default:
+    // Commands: 01xxxxxx, 4 bytes of argument and the CRC
+    if(cmd_len_ != 0 || (in & 0xc0) == 0x40) {
+      cmd_[cmd_len_++] = in;
+      if(cmd_len_ == 6) {
+	cmd_len_ = 0;
+	command();
+      }
+    }
+    break;
+  }
+  if(out_pos_ < out_.size()) {
+    return out_[out_pos_++];
+  }
+  if(state_ == READING && block_ok(block_)) {
+    out_.clear();
+    out_pos_ = 0;
+    send_block();
+    return out_[out_pos_++];
+  }
+  return 0xff;
+}
+
+void SDCard::print_stats() const {
+  printf(
+     "SDCard: %llu commands, %llu blocks read, %llu blocks written, "
+     "%llu bytes transferred\n",
+     nb_commands_, nb_blocks_read_, nb_blocks_written_, nb_bytes_
+  );
+}
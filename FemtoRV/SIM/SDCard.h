@@ -0,0 +1,58 @@
+#include "SPISlave.h"
+#include <vector>
+
+// Emulates an SDHC card in SPI mode (for FIRMWARE/LIBFEMTORV32/spi_sd.c
+// and fat_io_lib), backed by a host image file (block n is at offset
+// 512*n). Commands: CMD0, CMD8, CMD12, CMD16, CMD17, CMD18, CMD24, CMD25,
+// CMD55, ACMD41 and CMD58, the others are rejected (illegal command).
+// The card answers immediately (one byte after the command, no busy
+// time after the writes), so that the measured time is the time of the
+// driver and of the SPI transfers. The CRCs are ignored.
+class SDCard : public SPISlave {
+ public:
+   SDCard(CData& CLK, CData& CS_N, CData& MOSI, CData& MISO);
+
+   // Returns false if the image cannot be mapped
+   bool open(const char* filename);
+
+ // Prints the transaction counters
+   void print_stats() const;
+
+ protected:
+   uint8_t transfer(uint8_t in) override;
+
+ private:
+   void command();
+   void respond(std::initializer_list<uint8_t> bytes);
+   bool block_ok(uint32_t block) const;
+   void send_block();
+   void receive_block(uint8_t in);
+
+   static const unsigned int BLOCK_SIZE = 512;
+
+   enum State {
+      IDLE,          // waiting for a command
+      READING,       // CMD18: sends the blocks until CMD12
+      WRITE_TOKEN,   // CMD24/CMD25: waiting for the start of block token
+      WRITE_DATA     // receiving the block and its CRC
+   };
+
+ private:
+   MappedImage image_;
+   State state_;
+   bool idle_;       // in idle state (R1 bit 0), until ACMD41
+   bool app_cmd_;    // the previous command was CMD55
+   bool multiple_;   // CMD25 (else CMD24)
+   uint8_t cmd_[6];
+   unsigned int cmd_len_;
+   uint32_t block_;  // next block read (CMD18) or written
+   std::vector<uint8_t> out_;  // bytes to be sent
+   size_t out_pos_;
+   uint8_t data_[BLOCK_SIZE + 2];
+   unsigned int data_len_;
+
+   unsigned long long nb_commands_;
+   unsigned long long nb_blocks_read_;
+   unsigned long long nb_blocks_written_;
+   unsigned long long nb_bytes_;
+};
@@ -0,0 +1,63 @@
+#include "SPIFlash.h"
+#include <cstdio>
+
+static const uint8_t CMD_READ      = 0x03;
+static const uint8_t CMD_FAST_READ = 0x0b;
+
+SPIFlash::SPIFlash(CData& CLK, CData& CS_N, CData& MOSI, CData& MISO) :
+  SPISlave(CLK, CS_N, MOSI, MISO) {
+  command_ = 0;
+  nb_bytes_in_ = 0;
+  address_ = 0;
+  nb_reads_ = 0;
+  nb_bytes_read_ = 0;
+}
+
+bool SPIFlash::open(const char* filename) {
+  return image_.open(filename);
+}
+
+void SPIFlash::select() {
+  command_ = 0;
+  nb_bytes_in_ = 0;
+  address_ = 0;
+}
+
+uint8_t SPIFlash::read_byte() {
+  ++nb_bytes_read_;
+  uint32_t address = address_;
+  address_ = (address_ + 1) & 0xffffff;
+  return (address < image_.size()) ? image_.data()[address] : 0xff;
+}
+
+// The data follows the 3 bytes of address (and the dummy byte of the
+// fast read), until CS_N goes high
+uint8_t SPIFlash::transfer(uint8_t in) {
+  unsigned int header = (command_ == CMD_FAST_READ) ? 5 : 4;
+  if(nb_bytes_in_ < header) {
+    if(nb_bytes_in_ == 0) {
+      command_ = in;
+      header = (command_ == CMD_FAST_READ) ? 5 : 4;
+    } else if(nb_bytes_in_ < 4) {
+      address_ = (address_ << 8) | in;
+    }
+    ++nb_bytes_in_;
+    if(nb_bytes_in_ < header) {
+      return 0xff;
+    }
+    if(command_ != CMD_READ && command_ != CMD_FAST_READ) {
+      return 0xff;
+    }
+    ++nb_reads_;
+  }
+  if(command_ != CMD_READ && command_ != CMD_FAST_READ) {
+    return 0xff;
+  }
+  return read_byte();
+}
+
+void SPIFlash::print_stats() const {
+  printf(
+     "SPIFlash: %llu reads, %llu bytes read\n", nb_reads_, nb_bytes_read_
+  );
+}
@@ -0,0 +1,33 @@
+#include "SPISlave.h"
+
+// Emulates the SPI flash read by RTL/DEVICES/MappedSPIFlash.v (single IO
+// versions: SPI_FLASH_READ, command 03h, and SPI_FLASH_FAST_READ,
+// command 0Bh with 8 dummy clocks), backed by a host image file at
+// address 0. The bytes past the end of the image read as 0xff (erased
+// flash). The other commands are ignored.
+class SPIFlash : public SPISlave {
+ public:
+   SPIFlash(CData& CLK, CData& CS_N, CData& MOSI, CData& MISO);
+
+   // Returns false if the image cannot be mapped
+   bool open(const char* filename);
+
+ // Prints the transaction counters
+   void print_stats() const;
+
+ protected:
+   void select() override;
+   uint8_t transfer(uint8_t in) override;
+
+ private:
+   uint8_t read_byte();
+
+ private:
+   MappedImage image_;
+   uint8_t command_;
+   unsigned int nb_bytes_in_;  // command, address and dummy bytes received
+   uint32_t address_;
+
+   unsigned long long nb_reads_;
+   unsigned long long nb_bytes_read_;
+};
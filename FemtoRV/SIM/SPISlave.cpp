@@ -0,0 +1,82 @@
+#include "SPISlave.h"
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+SPISlave::SPISlave(CData& CLK, CData& CS_N, CData& MOSI, CData& MISO) :
+  CLK_(CLK), CS_N_(CS_N), MOSI_(MOSI), MISO_(MISO) {
+  prev_CLK_ = 0;
+  prev_CS_N_ = 1;
+  in_ = 0;
+  in_bits_ = 0;
+  out_ = 0xff;
+  out_bits_ = 0;
+  MISO_ = 1;
+}
+
+void SPISlave::on_edge() {
+  if(prev_CS_N_ && !CS_N_) {
+    in_bits_ = 0;
+    out_bits_ = 0;
+    MISO_ = 1;
+    select();
+  }
+
+  if(!CS_N_ && CLK_ && !prev_CLK_) {
+    in_ = (uint8_t)((in_ << 1) | (MOSI_ & 1));
+    if(++in_bits_ == 8) {
+      in_bits_ = 0;
+      out_ = transfer(in_);
+      out_bits_ = 8;
+    }
+  }
+
+  if(!CS_N_ && !CLK_ && prev_CLK_ && out_bits_ != 0) {
+    --out_bits_;
+    MISO_ = (out_ >> out_bits_) & 1;
+  }
+
+  if(!prev_CS_N_ && CS_N_) {
+    MISO_ = 1;
+    deselect();
+  }
+
+  prev_CLK_ = CLK_;
+  prev_CS_N_ = CS_N_;
+}
+
+bool MappedImage::open(const char* filename) {
+  close();
+  int fd = ::open(filename, O_RDONLY);
+  if(fd < 0) {
+    perror(filename);
+    return false;
+  }
+  struct stat st;
+  if(fstat(fd, &st) != 0 || st.st_size == 0) {
+    fprintf(stderr, "%s: empty or unreadable image\n", filename);
+    ::close(fd);
+    return false;
+  }
+  void* p = mmap(
+    nullptr, size_t(st.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0
+  );
+  ::close(fd);
+  if(p == MAP_FAILED) {
+    perror(filename);
+    return false;
+  }
+  data_ = (uint8_t*)p;
+  size_ = size_t(st.st_size);
+  return true;
+}
+
+void MappedImage::close() {
+  if(data_ != nullptr) {
+    munmap(data_, size_);
+    data_ = nullptr;
+    size_ = 0;
+  }
+}
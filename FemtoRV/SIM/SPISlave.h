@@ -0,0 +1,72 @@
+#ifndef SPI_SLAVE_H
+#define SPI_SLAVE_H
+
+#include "verilated.h"
+#include <cstdint>
+#include <cstddef>
+
+// SPI slave in mode 0 (MOSI sampled on the rising edges of CLK, MISO
+// changed on the falling edges, MSB first), byte-level protocol
+// implemented by the derived classes (SDCard.h, SPIFlash.h).
+// Like SSD1351::eval(), eval() is called after each half clock and only
+// does work on CS_N/CLK edges.
+class SPISlave {
+ public:
+   SPISlave(CData& CLK, CData& CS_N, CData& MOSI, CData& MISO);
+   virtual ~SPISlave() {}
+
+   void eval() {
+      if(CLK_ == prev_CLK_ && CS_N_ == prev_CS_N_) {
+	 return;
+      }
+      on_edge();
+   }
+
+ protected:
+   // Called when CS_N goes low
+   virtual void select() {}
+
+   // Called for each byte received, returns the byte sent next
+   virtual uint8_t transfer(uint8_t in) = 0;
+
+   // Called when CS_N goes high
+   virtual void deselect() {}
+
+ private:
+   void on_edge();
+
+   CData& CLK_;
+   CData& CS_N_;
+   CData& MOSI_;
+   CData& MISO_;
+
+   CData prev_CLK_;
+   CData prev_CS_N_;
+   uint8_t in_;
+   unsigned int in_bits_;
+   uint8_t out_;
+   unsigned int out_bits_;
+};
+
+// Host image file of the storage models, mapped with mmap() (pages are
+// read from the file when touched, multi-gigabytes images are fine).
+// The mapping is private: the writes of the simulation do not modify the
+// file.
+class MappedImage {
+ public:
+   MappedImage() : data_(nullptr), size_(0) {}
+   ~MappedImage() { close(); }
+
+   // Returns false (and prints the error) if the file cannot be mapped
+   bool open(const char* filename);
+   void close();
+
+   uint8_t* data() const { return data_; }
+   size_t size() const { return size_; }
+
+ private:
+   uint8_t* data_;
+   size_t size_;
+};
+
+#endif
@@ -1,8 +1,16 @@
 #include "SSD1351.h"
+#include <cstring>
+#include <chrono>
+#include <cerrno>
+#include <sys/stat.h>
+
+unsigned char SSD1351::flip_table_[256];
 
 SSD1351::SSD1351(
- CData& DIN, CData& CLK, CData& CS, CData& DC, CData& RST
-) : DIN_(DIN), CLK_(CLK), CS_(CS), DC_(DC), RST_(RST) {
+ CData& DIN, CData& CLK, CData& CS, CData& DC, CData& RST,
+ const char* frame_dir, unsigned int frame_every
+) : DIN_(DIN), CLK_(CLK), CS_(CS), DC_(DC), RST_(RST),
+    frame_dir_(frame_dir), frame_every_(frame_every == 0 ? 1 : frame_every) {
   cur_word_ = 0;
   prev_word_ = 0;
   cur_bit_ = 0;
@@ -13,18 +21,54 @@ SSD1351::SSD1351(
   x1_ = 0; x2_ = 127;
   y1_ = 0; y2_ = 127;
   start_line_ = 0;
+  dirty_rows_ = 0;
+  frame_start_line_ = 0;
+  frame_ready_ = false;
+  stop_ = false;
+  window_ = nullptr;
+  frame_file_start_line_ = 0;
+  nb_frames_ = 0;
+  nb_frames_written_ = 0;
+  half_clocks_ = 0;
+  memset(framebuffer_, 0, sizeof(framebuffer_));
+  for(unsigned int x=0; x<256; ++x) {
+    unsigned int result=0;
+    for(unsigned int bit=0; bit<8; ++bit) {
+      if(x & (1 << bit)) {
+	result |= (1 << (7-bit));
+      }
+    }
+    flip_table_[x] = (unsigned char)result;
+  }
+  if(frame_dir_ != nullptr) {
+    if(mkdir(frame_dir_, 0777) != 0 && errno != EEXIST) {
+      perror(frame_dir_);
+      exit(-1);
+    }
+    return;
+  }
   if(!glfwInit()) {
     fprintf(stderr,"Could not initialize glfw\n");
     exit(-1);
   }
   glfwWindowHint(GLFW_RESIZABLE,GL_FALSE);
   window_  = glfwCreateWindow(512,512,"FemtoRV32 SSD1351",nullptr,nullptr);
-  glfwMakeContextCurrent(window_);
-  glfwSwapInterval(1);
-  glPixelZoom(4.0f,4.0f);
+  // GLFW windows are created by the main thread, the GL context is
+  // made current in the render thread.
+  render_thread_ = std::thread(&SSD1351::render_loop, this);
 }
 
-void SSD1351::eval() {
+SSD1351::~SSD1351() {
+  if(frame_dir_ != nullptr) {
+    return;
+  }
+  stop_ = true;
+  render_thread_.join();
+  glfwDestroyWindow(window_);
+  glfwTerminate();
+}
+
+void SSD1351::on_edge() {
   if(prev_CS_ && !CS_) {
     cur_word_ = 0;
     cur_bit_  = 0;
@@ -36,81 +80,198 @@ void SSD1351::eval() {
   }
   
   if(!prev_CS_ && CS_) {
-    if(!DC_) {
-      cur_command_ = flip(cur_word_,8);
-      cur_arg_index_ = 0;
-    } else {
+    end_of_word();
+  }
 
-      if(cur_arg_index_ < 2) {
-	cur_arg_[cur_arg_index_] = flip(cur_word_,8);
-	cur_arg_index_++;
-      }
+  prev_CLK_ = CLK_;
+  prev_CS_  = CS_;
+}
 
-      // set x range
-      if(cur_command_ == 0x15 && cur_arg_index_ == 2) {
-	x1_ = cur_arg_[0]; x2_ = cur_arg_[1]; x_ = x1_;
-      }
+// Decodes the word received between CS_ falling and rising edges
+void SSD1351::end_of_word() {
+  if(!DC_) {
+    // flush the pixels of the previous command
+    if(dirty_rows_ != 0) {
+      redraw();
+    }
+    cur_command_ = flip8(cur_word_);
+    cur_arg_index_ = 0;
+    return;
+  }
+
+  if(cur_arg_index_ < 2) {
+    cur_arg_[cur_arg_index_] = flip8(cur_word_);
+    cur_arg_index_++;
+  }
+
+  // set x range
+  if(cur_command_ == 0x15 && cur_arg_index_ == 2) {
+    x1_ = cur_arg_[0]; x2_ = cur_arg_[1]; x_ = x1_;
+  }
       
-      // set y range
-      if(cur_command_ == 0x75 && cur_arg_index_ == 2) {
-	y1_ = cur_arg_[0]; y2_ = cur_arg_[1]; y_ = y1_;
-      }
+  // set y range
+  if(cur_command_ == 0x75 && cur_arg_index_ == 2) {
+    y1_ = cur_arg_[0]; y2_ = cur_arg_[1]; y_ = y1_;
+  }
       
-      // set display start line
-      if(cur_command_ == 0xa1 && cur_arg_index_ == 1) {
-	start_line_ = cur_arg_[0];
-	redraw();
-      }
+  // set display start line
+  if(cur_command_ == 0xa1 && cur_arg_index_ == 1) {
+    start_line_ = cur_arg_[0];
+    redraw();
+  }
 
-      // draw pixels
-      if(cur_command_ == 0x5c) {
+  // draw pixels
+  if(cur_command_ == 0x5c) {
 	
-	if(cur_bit_ == 9) {
-	  if(fetch_next_half_) {
-	    fetch_next_half_ = false;
-	    cur_word_ = (cur_word_ << 8) | prev_word_;
-	  } else {
-	    prev_word_ = cur_word_;
-	    fetch_next_half_ = true;
-	    goto discard;
-	  }
-	}
+    if(cur_bit_ == 9) {
+      if(fetch_next_half_) {
+	fetch_next_half_ = false;
+	cur_word_ = (cur_word_ << 8) | prev_word_;
+      } else {
+	prev_word_ = cur_word_;
+	fetch_next_half_ = true;
+	return;
+      }
+    }
 	
-	if(x_ < 128 && y_ < 128) {
-	  framebuffer_[(127-y_)*128+x_] = flip(cur_word_,16);
-	} else {
-	  printf("OOB pixel: x=%d  y=%d\n",x_, y_);
-	}
-	++x_;
-	if(x_ > x2_) {
-	  ++y_;
-	  x_ = x1_;
-	  if(true || x2_ > 63 || y_ > y2_) {
-	    redraw();
-	  }
-	}
-      } 
+    if(x_ < 128 && y_ < 128) {
+      framebuffer_[(127-y_)*128+x_] = flip16(cur_word_);
+    } else {
+      printf("OOB pixel: x=%d  y=%d\n",x_, y_);
+    }
+    ++x_;
+    if(x_ > x2_) {
+      ++y_;
+      x_ = x1_;
+      // redraw once per batch of rows, or when the window is complete
+      ++dirty_rows_;
+      if(dirty_rows_ >= REDRAW_ROWS || y_ > y2_) {
+	redraw();
+      }
     }
   }
-
- discard:
-  prev_CLK_ = CLK_;
-  prev_CS_  = CS_;
 }
 
+// Publishes the framebuffer to the render thread. The lock is only
+// held by the render thread while it copies the frame.
 void SSD1351::redraw() {
-  glRasterPos2f(-1.0f,-1.0f);
-  if(start_line_ != 0) {
+  ++nb_frames_;
+  if(frame_dir_ != nullptr) {
+    if(start_line_ != frame_file_start_line_ || nb_frames_ % frame_every_ == 0) {
+      write_frame();
+      frame_file_start_line_ = start_line_;
+    }
+    dirty_rows_ = 0;
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+    memcpy(frame_, framebuffer_, sizeof(frame_));
+    frame_start_line_ = start_line_;
+    frame_ready_ = true;
+  }
+  dirty_rows_ = 0;
+}
+
+void SSD1351::render_loop() {
+  glfwMakeContextCurrent(window_);
+  glfwSwapInterval(0);
+  glPixelZoom(4.0f,4.0f);
+  static unsigned short pixels[128*128];
+  unsigned int start_line = 0;
+  auto next_frame = std::chrono::steady_clock::now();
+  while(!stop_) {
+    next_frame += std::chrono::microseconds(1000000 / FRAME_RATE);
+    std::this_thread::sleep_until(next_frame);
+    {
+      std::lock_guard<std::mutex> lock(frame_mutex_);
+      if(!frame_ready_) {
+	continue;
+      }
+      memcpy(pixels, frame_, sizeof(pixels));
+      start_line = frame_start_line_;
+      frame_ready_ = false;
+    }
+    glRasterPos2f(-1.0f,-1.0f);
+    if(start_line != 0) {
+      glDrawPixels(
+		   128, start_line, GL_RGB, GL_UNSIGNED_SHORT_5_6_5,
+		   pixels + 128 * (128-start_line) 
+		   );
+    }
+    glRasterPos2f(-1.0f,-1.0+2.0*float(start_line)/127.0);
     glDrawPixels(
-		 128, start_line_, GL_RGB, GL_UNSIGNED_SHORT_5_6_5,
-		 framebuffer_ + 128 * (128-start_line_) 
+		 128, 128-start_line, GL_RGB, GL_UNSIGNED_SHORT_5_6_5,
+		 pixels
 		 );
+    glfwSwapBuffers(window_);
+  }
+  glfwMakeContextCurrent(nullptr);
+}
+
+// Writes the displayed image (rows rotated by the display start line,
+// as drawn by render_loop()) to frame_dir_
+void SSD1351::write_frame() {
+  char filename[1024];
+  snprintf(
+     filename, sizeof(filename), "%s/frame_%06llu.rgb565",
+     frame_dir_, nb_frames_written_
+  );
+  FILE* f = fopen(filename, "wb");
+  if(f == nullptr) {
+    perror(filename);
+    return;
+  }
+  for(unsigned int row=0; row<128; ++row) {
+    // framebuffer_ is stored bottom row first
+    unsigned int from_bottom = 127-row;
+    unsigned int src = (from_bottom < start_line_) ?
+      128-start_line_+from_bottom : from_bottom-start_line_;
+    fwrite(framebuffer_ + 128*src, sizeof(unsigned short), 128, f);
   }
-  glRasterPos2f(-1.0f,-1.0+2.0*float(start_line_)/127.0);
-  glDrawPixels(
-	       128, 128-start_line_, GL_RGB, GL_UNSIGNED_SHORT_5_6_5,
-	       framebuffer_
-	       );
-  glfwSwapBuffers(window_);
+  fclose(f);
+  ++nb_frames_written_;
 }
 
+#ifdef SIM_SAVABLE
+
+// Applies f(pointer, size) to all the state variables
+// (same order for save and restore)
+template <class F> void SSD1351::state(F f) {
+  f(&prev_CLK_, sizeof(prev_CLK_));
+  f(&prev_CS_, sizeof(prev_CS_));
+  f(&prev_word_, sizeof(prev_word_));
+  f(&cur_word_, sizeof(cur_word_));
+  f(&cur_bit_, sizeof(cur_bit_));
+  f(&cur_command_, sizeof(cur_command_));
+  f(cur_arg_, sizeof(cur_arg_));
+  f(&cur_arg_index_, sizeof(cur_arg_index_));
+  f(framebuffer_, sizeof(framebuffer_));
+  f(&x_, sizeof(x_)); f(&x1_, sizeof(x1_)); f(&x2_, sizeof(x2_));
+  f(&y_, sizeof(y_)); f(&y1_, sizeof(y1_)); f(&y2_, sizeof(y2_));
+  f(&start_line_, sizeof(start_line_));
+  f(&fetch_next_half_, sizeof(fetch_next_half_));
+  f(&dirty_rows_, sizeof(dirty_rows_));
+}
+
+void SSD1351::save(VerilatedSerialize& os) {
+  state([&os](void* p, size_t size) { os.write(p, size); });
+}
+
+void SSD1351::restore(VerilatedDeserialize& is) {
+  state([&is](void* p, size_t size) { is.read(p, size); });
+  // display the restored framebuffer
+  redraw();
+}
+
+#endif
+
+void SSD1351::print_stats(double freq_MHz) const {
+  double sim_seconds = double(half_clocks_) / 2.0 / (freq_MHz * 1e6);
+  printf(
+     "SSD1351: %llu frames (%llu written) in %.3f simulated s, "
+     "%.2f frames per simulated second\n",
+     nb_frames_, nb_frames_written_, sim_seconds,
+     sim_seconds > 0.0 ? double(nb_frames_) / sim_seconds : 0.0
+  );
+}
@@ -1,28 +1,75 @@
 /*****************************************************************/
 #include "verilated.h"
+#ifdef SIM_SAVABLE
+#include "verilated_save.h"
+#endif
 #include <GLFW/glfw3.h>
+#include <thread>
+#include <mutex>
+#include <atomic>
 
 // Emulates the 128x128 OLED display
+// The window is drawn by a render thread at FRAME_RATE, from a copy of
+// the framebuffer published by redraw(), so that the simulation thread
+// does not wait for GL or vsync.
+// Headless mode (frame_dir != nullptr) does not use GLFW: one frame
+// out of frame_every, and each frame that changes the display start
+// line, is written to frame_dir as raw RGB565 (128x128, top row first,
+// frame_NNNNNN.rgb565).
 class SSD1351 {
  public:
    SSD1351(
-      CData& DIN, CData& CLK, CData& CS, CData& DC, CData& RST
+      CData& DIN, CData& CLK, CData& CS, CData& DC, CData& RST,
+      const char* frame_dir = nullptr, unsigned int frame_every = 1
    );
+   ~SSD1351();
 
-   void eval();
+ // Called after each half clock: only does work on CS_/CLK_ edges
+   void eval() {
+      ++half_clocks_;
+      if(CLK_ == prev_CLK_ && CS_ == prev_CS_) {
+	 return;
+      }
+      on_edge();
+   }
+
+#ifdef SIM_SAVABLE
+ // Saves/restores the state of the emulated display (with the model,
+ // see sim_main.cpp --save-at/--restore)
+   void save(VerilatedSerialize& os);
+   void restore(VerilatedDeserialize& is);
+#endif
+
+ // Prints the number of frames and frames per simulated second
+ // (freq_MHz: frequency of pclk)
+   void print_stats(double freq_MHz) const;
 
  private:
+  void on_edge();
+  void end_of_word();
   void redraw();
-  unsigned int flip(unsigned int x, unsigned int nb) {
-      unsigned int result=0;
-      for(unsigned int bit=0; bit<nb; ++bit) {
-	 if(x & (1 << bit)) {
-	    result |= (1 << (nb-1-bit));
-	 }
-      }
-      return result;
-   }
-  
+  void render_loop();
+  void write_frame();
+#ifdef SIM_SAVABLE
+  template <class F> void state(F f);
+#endif
+
+  // Reverses the order of the 8 (flip8) or 16 (flip16) LSBs of x
+  unsigned int flip8(unsigned int x) const {
+     return flip_table_[x & 255];
+  }
+  unsigned int flip16(unsigned int x) const {
+     return (flip_table_[x & 255] << 8) | flip_table_[(x >> 8) & 255];
+  }
+
+  // Rows of pixels accumulated in framebuffer_ before redrawing the window
+  static const unsigned int REDRAW_ROWS = 16;
+
+  static const unsigned int FRAME_RATE = 60;
+
+ private:
+   static unsigned char flip_table_[256];
+
  private:
    CData& DIN_;
    CData& CLK_;
@@ -48,4 +95,22 @@ class SSD1351 {
    unsigned int start_line_;
 
    bool fetch_next_half_;
+   unsigned int dirty_rows_;
+
+   // Last frame published by redraw(), read by the render thread
+   std::mutex frame_mutex_;
+   unsigned short frame_[128*128];
+   unsigned int frame_start_line_;
+   bool frame_ready_;
+
+   std::thread render_thread_;
+   std::atomic<bool> stop_;
+
+   // Headless mode
+   const char* frame_dir_;
+   unsigned int frame_every_;
+   unsigned int frame_file_start_line_;
+   unsigned long long nb_frames_;
+   unsigned long long nb_frames_written_;
+   unsigned long long half_clocks_;
 };
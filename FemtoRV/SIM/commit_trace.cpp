@@ -0,0 +1,18 @@
+#include "commit_trace.h"
+#ifdef SIM_LOCKSTEP
+#include "lockstep.h"
+#endif
+
+uint32_t commit_pc = 0;
+
+void commit_trace(uint32_t pc, uint32_t rd, uint32_t value) {
+   commit_pc = pc;
+#ifdef SIM_LOCKSTEP
+   if(lockstep != nullptr) {
+      lockstep->commit(pc, rd, value);
+   }
+#else
+   (void)rd;
+   (void)value;
+#endif
+}
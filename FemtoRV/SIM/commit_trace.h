@@ -0,0 +1,10 @@
+// Called by the NRV_COMMIT_TRACE block of the processor (Verilator $c) for
+// each retired instruction (commit_trace.cpp), forwarded to the lockstep
+// checker (lockstep.cpp) and used by the PC trigger of --trace-window
+#include <stdint.h>
+
+// rd: destination register, 0 if none, 32..63 for the floating point registers
+void commit_trace(uint32_t pc, uint32_t rd, uint32_t value);
+
+// PC of the last retired instruction
+extern uint32_t commit_pc;
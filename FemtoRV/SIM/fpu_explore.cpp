@@ -0,0 +1,404 @@
+/*****************************************************************/
+// Design space exploration of the iterative FRCP / FDIV / FSQRT of a
+// hardware FPU (FRCP_ITER(), FDIV_ITER(), FSQRT_ITER() in
+// FPU_funcs.cpp): for each combination of seed table size,
+// Newton-Raphson iterations, width of the intermediate fractions and
+// final correction, runs -n random operands and the edge cases of the
+// seed table (the boundaries and middles of its intervals, all-ones
+// and one-ulp fractions), compares the results with the correctly
+// rounded ones of the host FPU, and reports the max error in ulps, the
+// number of results that are not correctly rounded, and the estimated
+// latency in cycles (FPU_funcs.h). The lowest-latency configuration
+// that rounds all of them correctly is printed for each operation.
+//
+// Operands are normal numbers with normal results (the exponent and
+// the special cases are not in the iterations). Random operands only
+// depend on -seed, not on the number of threads.
+//
+// Usage: fpu_explore [-j threads] [-n count] [-seed s] [-rtz] [-dsp bits]
+//                    [-seeds list] [-iters list] [-widths list]
+//                    [-corr list] [-all] op...
+//        (op: FRCP FDIV FSQRT, list: 4,6,8 or 4-10)
+/*****************************************************************/
+
+#include "FPU_funcs.h"
+#include <fenv.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
+#include <cinttypes>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+// Operands processed by a thread at a time
+static const uint64_t CHUNK = 1 << 14;
+
+struct Operation {
+  const char* name;
+  int nb_args;
+  int (*latency)(const FPUIterConfig&, int);
+};
+
+static const Operation operations[] = {
+  { "FRCP",  1, FRCP_ITER_latency  },
+  { "FDIV",  2, FDIV_ITER_latency  },
+  { "FSQRT", 1, FSQRT_ITER_latency },
+};
+
+// splitmix64
+static inline uint64_t random64(uint64_t& state) {
+  uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+static inline uint32_t make_float(uint32_t frac, uint32_t exp) {
+  return (exp << 23) | (frac & 0x7fffff);
+}
+
+static inline float decode(uint32_t x) {
+  float result;
+  memcpy(&result, &x, sizeof(result));
+  return result;
+}
+
+static inline uint32_t encode(float x) {
+  uint32_t result;
+  memcpy(&result, &x, sizeof(result));
+  return result;
+}
+
+// Fractions that are edge cases for a seed table with seed_bits bits
+static std::vector<uint32_t> edge_fractions(int seed_bits) {
+  std::vector<uint32_t> result = { 0, 1, 0x7fffff, 0x7ffffe, 0x400000, 0x3fffff };
+  int shift = 23 - seed_bits;
+  for(uint32_t i=0; i < (1u << seed_bits); ++i) {
+    uint32_t start = i << shift;
+    result.push_back(start);
+    result.push_back(start + 1);
+    if(i != 0) {
+      result.push_back(start - 1);
+    }
+    if(shift > 0) {
+      result.push_back(start + (1u << (shift - 1)));
+    }
+  }
+  return result;
+}
+
+struct Stats {
+  uint64_t operands = 0;
+  uint64_t wrong = 0;
+  uint64_t max_ulp = 0;
+  uint32_t worst_x = 0;
+  uint32_t worst_y = 0;
+};
+
+class Explore {
+public:
+  Explore(const Operation& op, const FPUIterConfig& config, uint64_t count, uint64_t seed) :
+    op_(op), config_(config), count_(count), seed_(seed), next_chunk_(0),
+    edges_(edge_fractions(config.seed_bits)) {
+  }
+
+  void run(unsigned int nb_threads) {
+    std::vector<std::thread> threads;
+    for(unsigned int i=0; i<nb_threads; ++i) {
+      threads.emplace_back(&Explore::worker, this);
+    }
+    for(std::thread& t: threads) {
+      t.join();
+    }
+  }
+
+  const Stats& stats() const {
+    return stats_;
+  }
+
+private:
+  // Operand i: the edge cases (FDIV: as divisor, then as dividend),
+  // then the random ones
+  void operand(uint64_t i, uint64_t& state, uint32_t& x, uint32_t& y) const {
+    uint64_t nb_edges = edges_.size();
+    uint64_t r = random64(state);
+    uint32_t exp_x = 96 + uint32_t(r & 63);
+    uint32_t exp_y = 96 + uint32_t((r >> 6) & 63);
+    uint32_t frac_x = uint32_t(r >> 12);
+    uint32_t frac_y = uint32_t(r >> 40);
+    if(!strcmp(op_.name, "FSQRT")) {
+      exp_x = 1 + uint32_t(r % 254);
+    }
+    if(op_.nb_args == 1 && i < nb_edges) {
+      frac_x = edges_[size_t(i)];
+    } else if(op_.nb_args == 2 && i < nb_edges) {
+      frac_y = edges_[size_t(i)];
+    } else if(op_.nb_args == 2 && i < 2*nb_edges) {
+      frac_x = edges_[size_t(i - nb_edges)];
+    }
+    x = make_float(frac_x, exp_x);
+    y = make_float(frac_y, exp_y);
+  }
+
+  void evaluate(uint32_t x, uint32_t y, uint32_t& result, uint32_t& reference) const {
+    if(!strcmp(op_.name, "FRCP")) {
+      result = FRCP_ITER(config_, x);
+      reference = encode(float(1.0 / double(decode(x))));
+    } else if(!strcmp(op_.name, "FDIV")) {
+      result = FDIV_ITER(config_, x, y);
+      reference = encode(float(double(decode(x)) / double(decode(y))));
+    } else {
+      result = FSQRT_ITER(config_, x);
+      reference = encode(float(std::sqrt(double(decode(x)))));
+    }
+  }
+
+  void worker() {
+    // Double rounding through double is exact for these operations
+    fesetround(config_.rtz ? FE_TOWARDZERO : FE_TONEAREST);
+    uint64_t total = count_ + edges_.size() * uint64_t(op_.nb_args);
+    uint64_t nb_chunks = (total + CHUNK - 1) / CHUNK;
+    Stats local;
+    for(;;) {
+      uint64_t chunk = next_chunk_++;
+      if(chunk >= nb_chunks) {
+        break;
+      }
+      uint64_t first = chunk * CHUNK;
+      uint64_t last = std::min(first + CHUNK, total);
+      uint64_t state = seed_ ^ (chunk * 0xD1B54A32D192ED03ull);
+      for(uint64_t i=first; i<last; ++i) {
+        uint32_t x, y, result, reference;
+        operand(i, state, x, y);
+        evaluate(x, y, result, reference);
+        ++local.operands;
+        if(result != reference) {
+          ++local.wrong;
+          uint64_t ulp = uint64_t(std::abs(int64_t(result) - int64_t(reference)));
+          if(ulp > local.max_ulp) {
+            local.max_ulp = ulp;
+            local.worst_x = x;
+            local.worst_y = y;
+          }
+        }
+      }
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.operands += local.operands;
+    stats_.wrong += local.wrong;
+    if(local.max_ulp > stats_.max_ulp) {
+      stats_.max_ulp = local.max_ulp;
+      stats_.worst_x = local.worst_x;
+      stats_.worst_y = local.worst_y;
+    }
+  }
+
+  const Operation& op_;
+  FPUIterConfig config_;
+  uint64_t count_;
+  uint64_t seed_;
+  std::atomic<uint64_t> next_chunk_;
+  std::vector<uint32_t> edges_;
+  std::mutex mutex_;
+  Stats stats_;
+};
+
+struct Result {
+  FPUIterConfig config;
+  int latency;
+  Stats stats;
+};
+
+// "4,6,8" or "4-10" (or both: "2,4-6")
+static bool parse_list(const char* spec, int min, int max, std::vector<int>& list) {
+  list.clear();
+  std::string s(spec);
+  size_t start = 0;
+  for(;;) {
+    size_t comma = s.find(',', start);
+    std::string item = s.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+    int first, last;
+    char dash;
+    if(sscanf(item.c_str(), "%d%c%d", &first, &dash, &last) == 3 && dash == '-') {
+    } else if(sscanf(item.c_str(), "%d", &first) == 1) {
+      last = first;
+    } else {
+      return false;
+    }
+    if(first < min || last > max || first > last) {
+      return false;
+    }
+    for(int i=first; i<=last; ++i) {
+      list.push_back(i);
+    }
+    if(comma == std::string::npos) {
+      return true;
+    }
+    start = comma + 1;
+  }
+}
+
+static void print_result(const char* label, const Operation& op, const Result& R) {
+  printf(
+    "%-12s seed %2d iters %d width %2d %-7s %4d cycles  max %8" PRIu64 " ulp %12" PRIu64 " / %" PRIu64 " wrong",
+    label, R.config.seed_bits, R.config.iterations, R.config.width,
+    R.config.correction ? "corr" : "no-corr", R.latency,
+    R.stats.max_ulp, R.stats.wrong, R.stats.operands
+  );
+  if(R.stats.wrong != 0) {
+    if(op.nb_args == 2) {
+      printf("  (worst: %08x/%08x)", R.stats.worst_x, R.stats.worst_y);
+    } else {
+      printf("  (worst: %08x)", R.stats.worst_x);
+    }
+  }
+  printf("\n");
+}
+
+static void usage() {
+  fprintf(stderr, "Usage: fpu_explore [-j threads] [-n count] [-seed s] [-rtz] [-dsp bits]\n");
+  fprintf(stderr, "                   [-seeds list] [-iters list] [-widths list] [-corr list] [-all] op...\n");
+  fprintf(stderr, "  op:       FRCP FDIV FSQRT\n");
+  fprintf(stderr, "  -j:       number of threads (default: number of cores)\n");
+  fprintf(stderr, "  -n:       random operands per configuration (default: 2^20)\n");
+  fprintf(stderr, "  -seed:    seed of the random operands (default: 1)\n");
+  fprintf(stderr, "  -rtz:     round towards zero (default: to nearest even)\n");
+  fprintf(stderr, "  -dsp:     width of the hardware multiplier, 0: 1 cycle per multiply (default: 18)\n");
+  fprintf(stderr, "  -seeds:   seed table index bits (default: 4,6,8,10,12)\n");
+  fprintf(stderr, "  -iters:   Newton-Raphson iterations (default: 0-3)\n");
+  fprintf(stderr, "  -widths:  width of the intermediate fractions (default: 28,32,40,48,56)\n");
+  fprintf(stderr, "  -corr:    0: no final correction, 1: correction (default: 0,1)\n");
+  fprintf(stderr, "  -all:     prints all the configurations (default: the fewest wrong\n");
+  fprintf(stderr, "            results for each latency)\n");
+  fprintf(stderr, "  list:     4,6,8 or 4-10\n");
+}
+
+int main(int argc, char** argv) {
+  unsigned int nb_threads = std::thread::hardware_concurrency();
+  uint64_t count = 1 << 20;
+  uint64_t seed = 1;
+  bool rtz = false;
+  bool all = false;
+  int dsp_bits = 18;
+  std::vector<int> seeds = { 4, 6, 8, 10, 12 };
+  std::vector<int> iters = { 0, 1, 2, 3 };
+  std::vector<int> widths = { 28, 32, 40, 48, 56 };
+  std::vector<int> corrs = { 0, 1 };
+  std::vector<const Operation*> ops;
+
+  for(int i=1; i<argc; ++i) {
+    bool has_value = (i+1 < argc);
+    bool ok = true;
+    if(!strcmp(argv[i], "-j") && has_value) {
+      nb_threads = unsigned(strtoul(argv[++i], nullptr, 0));
+    } else if(!strcmp(argv[i], "-n") && has_value) {
+      count = strtoull(argv[++i], nullptr, 0);
+    } else if(!strcmp(argv[i], "-seed") && has_value) {
+      seed = strtoull(argv[++i], nullptr, 0);
+    } else if(!strcmp(argv[i], "-rtz")) {
+      rtz = true;
+    } else if(!strcmp(argv[i], "-all")) {
+      all = true;
+    } else if(!strcmp(argv[i], "-dsp") && has_value) {
+      dsp_bits = atoi(argv[++i]);
+    } else if(!strcmp(argv[i], "-seeds") && has_value) {
+      ok = parse_list(argv[++i], 2, 16, seeds);
+    } else if(!strcmp(argv[i], "-iters") && has_value) {
+      ok = parse_list(argv[++i], 0, 4, iters);
+    } else if(!strcmp(argv[i], "-widths") && has_value) {
+      ok = parse_list(argv[++i], 26, 60, widths);
+    } else if(!strcmp(argv[i], "-corr") && has_value) {
+      ok = parse_list(argv[++i], 0, 1, corrs);
+    } else {
+      const Operation* found = nullptr;
+      for(const Operation& op: operations) {
+        if(!strcmp(argv[i], op.name)) {
+          found = &op;
+        }
+      }
+      if(found == nullptr) {
+        fprintf(stderr, "fpu_explore: unknown operation or option: %s\n", argv[i]);
+        usage();
+        return 1;
+      }
+      ops.push_back(found);
+    }
+    if(!ok) {
+      fprintf(stderr, "fpu_explore: invalid list for %s: %s\n", argv[i-1], argv[i]);
+      usage();
+      return 1;
+    }
+  }
+  if(ops.empty()) {
+    usage();
+    return 1;
+  }
+  if(nb_threads == 0) {
+    nb_threads = 1;
+  }
+
+  printf(
+    "%s, %u threads, %" PRIu64 " random operands per configuration, %s\n",
+    rtz ? "round towards zero" : "round to nearest even", nb_threads, count,
+    dsp_bits > 0 ? (std::to_string(dsp_bits) + " bits multiplier").c_str() : "1 cycle multiplies"
+  );
+  int status = 0;
+  for(const Operation* op: ops) {
+    std::vector<Result> results;
+    for(int corr: corrs) {
+      for(int s: seeds) {
+        for(int it: iters) {
+          for(int w: widths) {
+            Result R;
+            R.config.seed_bits = s;
+            R.config.iterations = it;
+            R.config.width = w;
+            R.config.correction = (corr != 0);
+            R.config.rtz = rtz;
+            R.latency = op->latency(R.config, dsp_bits);
+            Explore explore(*op, R.config, count, seed);
+            explore.run(nb_threads);
+            R.stats = explore.stats();
+            results.push_back(R);
+          }
+        }
+      }
+    }
+    // By latency, then fewest wrong results, then smallest table
+    std::stable_sort(results.begin(), results.end(), [](const Result& a, const Result& b) {
+      if(a.latency != b.latency) {
+        return a.latency < b.latency;
+      }
+      if(a.stats.wrong != b.stats.wrong) {
+        return a.stats.wrong < b.stats.wrong;
+      }
+      return a.config.seed_bits < b.config.seed_bits;
+    });
+    const Result* best = nullptr;
+    uint64_t fewest_wrong = UINT64_MAX;
+    for(const Result& R: results) {
+      // Without -all: the configurations that have fewer wrong results
+      // than all the faster ones
+      if(all || R.stats.wrong < fewest_wrong) {
+        print_result(op->name, *op, R);
+      }
+      fewest_wrong = std::min(fewest_wrong, R.stats.wrong);
+      if(best == nullptr && R.stats.wrong == 0) {
+        best = &R;
+      }
+    }
+    if(best == nullptr) {
+      printf("%-12s no configuration rounds correctly\n", (std::string(op->name) + " best").c_str());
+      status = 2;
+    } else {
+      print_result((std::string(op->name) + " best").c_str(), *op, *best);
+    }
+    printf("\n");
+  }
+  return status;
+}
@@ -0,0 +1,281 @@
+/*****************************************************************/
+// FPU conformance sweep: checks the FPU functions of FPU_funcs.cpp
+// (the C++ model of the FPU algorithms with -soft, the host FPU
+// otherwise) against the CHECK_XXX() references, on all host cores.
+//
+// Unary operations (FSQRT, FCVTWS, FCVTWUS, FCVTSW, FCVTSWU) are swept
+// exhaustively over the 2^32 inputs, other operations over -n random
+// operand pairs (triples for the FMA family). Random operands only
+// depend on -seed, not on the number of threads.
+//
+// Usage: fpu_sweep [-soft] [-j threads] [-n count] [-seed s] op...
+//        fpu_sweep -list
+/*****************************************************************/
+
+#include "FPU_funcs.h"
+#include <fenv.h>
+#include <xmmintrin.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cinttypes>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+// Operands processed by a thread at a time
+static const uint64_t CHUNK = 1 << 16;
+
+// Mismatching operands printed per operation
+static const int MAX_SAMPLES = 10;
+
+struct Operation {
+  const char* name;
+  int nb_args;
+  uint32_t (*func1)(uint32_t);
+  uint32_t (*func2)(uint32_t, uint32_t);
+  uint32_t (*func3)(uint32_t, uint32_t, uint32_t);
+  uint32_t (*check1)(uint32_t, uint32_t);
+  uint32_t (*check2)(uint32_t, uint32_t, uint32_t);
+  uint32_t (*check3)(uint32_t, uint32_t, uint32_t, uint32_t);
+  // Batch check, nullptr if there is none
+  uint32_t (*batch1)(const uint32_t*, const uint32_t*, size_t);
+  uint32_t (*batch2)(const uint32_t*, const uint32_t*, const uint32_t*, size_t);
+};
+
+#define OP1(name, batch) { #name, 1, name, nullptr, nullptr, CHECK_##name, nullptr, nullptr, batch, nullptr }
+#define OP2(name, batch) { #name, 2, nullptr, name, nullptr, nullptr, CHECK_##name, nullptr, nullptr, batch }
+#define OP3(name)        { #name, 3, nullptr, nullptr, name, nullptr, nullptr, CHECK_##name, nullptr, nullptr }
+
+static const Operation operations[] = {
+  OP1(FSQRT, CHECK_FSQRT_BATCH),
+  OP1(FCVTWS, nullptr),
+  OP1(FCVTWUS, nullptr),
+  OP1(FCVTSW, nullptr),
+  OP1(FCVTSWU, nullptr),
+  OP2(FADD, CHECK_FADD_BATCH),
+  OP2(FSUB, CHECK_FSUB_BATCH),
+  OP2(FMUL, CHECK_FMUL_BATCH),
+  OP2(FDIV, CHECK_FDIV_BATCH),
+  OP2(FMIN, nullptr),
+  OP2(FMAX, nullptr),
+  OP2(FEQ, nullptr),
+  OP2(FLT, nullptr),
+  OP2(FLE, nullptr),
+  OP3(FMADD),
+  OP3(FMSUB),
+  OP3(FNMADD),
+  OP3(FNMSUB),
+};
+
+// splitmix64
+static inline uint64_t random64(uint64_t& state) {
+  uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+// Same floating point environment as sim_main.cpp. It is per-thread.
+static void setup_fp_env() {
+  fesetround(FE_TOWARDZERO);
+  _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+}
+
+class Sweep {
+public:
+  Sweep(const Operation& op, uint64_t count, uint64_t seed) :
+    op_(op), count_(count), seed_(seed), next_chunk_(0), mismatches_(0) {
+  }
+
+  void run(unsigned int nb_threads) {
+    std::vector<std::thread> threads;
+    for(unsigned int i=0; i<nb_threads; ++i) {
+      threads.emplace_back(&Sweep::worker, this);
+    }
+    for(std::thread& t: threads) {
+      t.join();
+    }
+  }
+
+  uint64_t mismatches() const {
+    return mismatches_;
+  }
+
+  void print_samples() const {
+    for(const std::string& s: samples_) {
+      printf("   %s\n", s.c_str());
+    }
+  }
+
+private:
+  void worker() {
+    setup_fp_env();
+    std::vector<uint32_t> x(CHUNK), y(CHUNK), z(CHUNK), result(CHUNK);
+    uint64_t nb_chunks = (count_ + CHUNK - 1) / CHUNK;
+    for(;;) {
+      uint64_t chunk = next_chunk_++;
+      if(chunk >= nb_chunks) {
+        return;
+      }
+      uint64_t first = chunk * CHUNK;
+      size_t n = size_t(std::min(CHUNK, count_ - first));
+      // Unary operations: exhaustive, binary/ternary: random
+      uint64_t state = seed_ ^ (chunk * 0xD1B54A32D192ED03ull);
+      for(size_t i=0; i<n; ++i) {
+        if(op_.nb_args == 1) {
+          x[i] = uint32_t(first + i);
+        } else {
+          uint64_t r = random64(state);
+          x[i] = uint32_t(r);
+          y[i] = uint32_t(r >> 32);
+          if(op_.nb_args == 3) {
+            z[i] = uint32_t(random64(state));
+          }
+        }
+      }
+      switch(op_.nb_args) {
+      case 1:
+        for(size_t i=0; i<n; ++i) { result[i] = op_.func1(x[i]); }
+        break;
+      case 2:
+        for(size_t i=0; i<n; ++i) { result[i] = op_.func2(x[i], y[i]); }
+        break;
+      default:
+        for(size_t i=0; i<n; ++i) { result[i] = op_.func3(x[i], y[i], z[i]); }
+        break;
+      }
+      // Batch check first (when available), then scalar checks to
+      // find the mismatching operands
+      if(op_.batch1 != nullptr && op_.batch1(result.data(), x.data(), n) == 0) {
+        continue;
+      }
+      if(op_.batch2 != nullptr && op_.batch2(result.data(), x.data(), y.data(), n) == 0) {
+        continue;
+      }
+      for(size_t i=0; i<n; ++i) {
+        bool ok;
+        switch(op_.nb_args) {
+        case 1:  ok = op_.check1(result[i], x[i]); break;
+        case 2:  ok = op_.check2(result[i], x[i], y[i]); break;
+        default: ok = op_.check3(result[i], x[i], y[i], z[i]); break;
+        }
+        if(!ok) {
+          add_mismatch(x[i], y[i], z[i], result[i]);
+        }
+      }
+    }
+  }
+
+  void add_mismatch(uint32_t x, uint32_t y, uint32_t z, uint32_t result) {
+    ++mismatches_;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(samples_.size() >= MAX_SAMPLES) {
+      return;
+    }
+    char buff[128];
+    switch(op_.nb_args) {
+    case 1:
+      snprintf(buff, sizeof(buff), "%s(%08x) = %08x", op_.name, x, result);
+      break;
+    case 2:
+      snprintf(buff, sizeof(buff), "%s(%08x,%08x) = %08x", op_.name, x, y, result);
+      break;
+    default:
+      snprintf(buff, sizeof(buff), "%s(%08x,%08x,%08x) = %08x", op_.name, x, y, z, result);
+      break;
+    }
+    samples_.push_back(buff);
+  }
+
+  const Operation& op_;
+  uint64_t count_;
+  uint64_t seed_;
+  std::atomic<uint64_t> next_chunk_;
+  std::atomic<uint64_t> mismatches_;
+  std::mutex mutex_;
+  std::vector<std::string> samples_;
+};
+
+static void usage() {
+  fprintf(stderr, "Usage: fpu_sweep [-soft] [-j threads] [-n count] [-seed s] op...\n");
+  fprintf(stderr, "       fpu_sweep -list\n");
+  fprintf(stderr, "  -soft:    check the C++ model of the FPU algorithms (default: host FPU)\n");
+  fprintf(stderr, "  -j:       number of threads (default: number of cores)\n");
+  fprintf(stderr, "  -n:       number of operands (default: 2^32 for unary ops, 2^28 otherwise)\n");
+  fprintf(stderr, "  -seed:    seed of the random operands (default: 1)\n");
+}
+
+int main(int argc, char** argv) {
+  unsigned int nb_threads = std::thread::hardware_concurrency();
+  uint64_t count = 0;
+  uint64_t seed = 1;
+  bool soft = false;
+  std::vector<const Operation*> ops;
+
+  for(int i=1; i<argc; ++i) {
+    if(!strcmp(argv[i], "-soft")) {
+      soft = true;
+    } else if(!strcmp(argv[i], "-j") && i+1 < argc) {
+      nb_threads = unsigned(strtoul(argv[++i], nullptr, 0));
+    } else if(!strcmp(argv[i], "-n") && i+1 < argc) {
+      count = strtoull(argv[++i], nullptr, 0);
+    } else if(!strcmp(argv[i], "-seed") && i+1 < argc) {
+      seed = strtoull(argv[++i], nullptr, 0);
+    } else if(!strcmp(argv[i], "-list")) {
+      for(const Operation& op: operations) {
+        printf("%s\n", op.name);
+      }
+      return 0;
+    } else {
+      const Operation* found = nullptr;
+      for(const Operation& op: operations) {
+        if(!strcmp(argv[i], op.name)) {
+          found = &op;
+        }
+      }
+      if(found == nullptr) {
+        fprintf(stderr, "fpu_sweep: unknown operation or option: %s\n", argv[i]);
+        usage();
+        return 1;
+      }
+      ops.push_back(found);
+    }
+  }
+  if(ops.empty()) {
+    usage();
+    return 1;
+  }
+  if(nb_threads == 0) {
+    nb_threads = 1;
+  }
+
+  set_use_soft_fpu(soft);
+  set_check_verbose(false);
+
+  printf("%s FPU, %u threads\n", soft ? "soft" : "host", nb_threads);
+  uint64_t total_mismatches = 0;
+  for(const Operation* op: ops) {
+    uint64_t n = count;
+    if(n == 0) {
+      n = (op->nb_args == 1) ? (1ull << 32) : (1ull << 28);
+    }
+    Sweep sweep(*op, n, seed);
+    auto start = std::chrono::steady_clock::now();
+    sweep.run(nb_threads);
+    double seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start
+    ).count();
+    printf(
+      "%-8s %12" PRIu64 " operands %12" PRIu64 " mismatches %8.2f s %10.2f Mop/s\n",
+      op->name, n, sweep.mismatches(), seconds,
+      seconds > 0.0 ? double(n) / seconds / 1e6 : 0.0
+    );
+    sweep.print_samples();
+    total_mismatches += sweep.mismatches();
+  }
+  return (total_mismatches == 0) ? 0 : 2;
+}
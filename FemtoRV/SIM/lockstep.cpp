@@ -0,0 +1,169 @@
+#include "lockstep.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+
+Lockstep* lockstep = nullptr;
+
+/*****************************************************************/
+
+// Destination register of an instruction (expanded if compressed):
+// 0 if none, 1..31 integer registers, 32..63 floating point registers
+// (same rule as rdIsFP in femtorv32_petitbateau.v)
+static uint32_t destination(uint32_t instr) {
+   uint32_t rd = (instr >> 7) & 31;
+   switch(instr & 127) {
+   case 0x03: // load
+   case 0x13: // ALU imm
+   case 0x17: // AUIPC
+   case 0x33: // ALU reg
+   case 0x37: // LUI
+   case 0x67: // JALR
+   case 0x6F: // JAL
+      return rd;
+   case 0x73: // CSRxx (not ECALL, EBREAK, MRET)
+      return ((instr >> 12) & 7) ? rd : 0;
+   case 0x07: // FLW
+   case 0x43: case 0x47: case 0x4B: case 0x4F: // F[N]MADD, F[N]MSUB
+      return 32 + rd;
+   case 0x53: { // FP: FEQ/FLT/FLE, FCVT.W.S, FMV.X.W/FCLASS write x
+      uint32_t funct4 = instr >> 28;
+      bool fp = !(funct4 & 8) || funct4 == 0xD || funct4 == 0xF;
+      return fp ? 32 + rd : rd;
+   }
+   }
+   return 0;
+}
+
+// true if the result of the instruction depends on timing
+static bool from_rtl(uint32_t instr, const uint32_t* x) {
+   uint32_t opcode = instr & 127;
+   if(opcode == 0x73) {
+      return ((instr >> 12) & 7) != 0;
+   }
+   if(opcode == 0x03 || opcode == 0x07) {
+      uint32_t addr = x[(instr >> 15) & 31] + uint32_t(int32_t(instr) >> 20);
+      return (addr & (1u << 22)) != 0; // IO page
+   }
+   return false;
+}
+
+static const char* reg_name(uint32_t rd) {
+   static char buff[2][8];
+   static int cur = 0;
+   cur = !cur;
+   if(rd == 0) {
+      return "-";
+   }
+   snprintf(buff[cur], sizeof(buff[cur]), "%c%u", rd < 32 ? 'x' : 'f', rd & 31);
+   return buff[cur];
+}
+
+/*****************************************************************/
+
+Lockstep::Lockstep(uint32_t ram_size) : memory_(ram_size), iss_(memory_) {
+   iss_.quiet_uart = true; // the RTL UART already prints
+   iss_.use_blocks = false;
+}
+
+bool Lockstep::load_hex(const char* filename) {
+   FILE* f = fopen(filename, "r");
+   if(f == nullptr) {
+      perror(filename);
+      return false;
+   }
+   uint32_t addr = 0;
+   char token[64];
+   while(fscanf(f, "%63s", token) == 1) {
+      if(token[0] == '@') {
+	 addr = uint32_t(strtoul(token+1, nullptr, 16)) * 4;
+      } else if(isxdigit((unsigned char)token[0])) {
+	 memory_.write_word(addr, uint32_t(strtoul(token, nullptr, 16)));
+	 addr += 4;
+      }
+   }
+   fclose(f);
+   iss_.reset();
+   return true;
+}
+
+void Lockstep::skip(uint64_t n) {
+   iss_.use_blocks = true;
+   FemtoRV32_ISS::StopReason reason = iss_.run(n);
+   iss_.use_blocks = false;
+   skipped_ = iss_.instret;
+   if(reason != FemtoRV32_ISS::RUNNING) {
+      printf(
+	 "Lockstep: ISS stopped (%s) after %llu instructions, while skipping\n",
+	 FemtoRV32_ISS::stop_reason_name(reason), (unsigned long long)skipped_
+      );
+   }
+}
+
+void Lockstep::commit(uint32_t pc, uint32_t rd, uint32_t value) {
+   if(stopped_) {
+      return;
+   }
+   ++commits_;
+   if(commits_ <= skipped_) {
+      return;
+   }
+
+   uint32_t iss_pc = iss_.pc;
+   uint32_t instr = 0;
+   uint32_t length = 0;
+   if(iss_pc != pc || !iss_.next_instruction(instr, length)) {
+      diverge("PC", pc, rd, value, iss_pc, instr, 0, 0);
+      return;
+   }
+   uint32_t iss_rd = destination(instr);
+   bool sync = (iss_rd != 0) && from_rtl(instr, iss_.x);
+
+   FemtoRV32_ISS::StopReason reason = iss_.run(1);
+   if(reason == FemtoRV32_ISS::HALTED) {
+      printf("Lockstep: both halted at PC=%08x\n", pc);
+      stopped_ = true;
+      return;
+   }
+   if(reason != FemtoRV32_ISS::RUNNING) {
+      diverge(FemtoRV32_ISS::stop_reason_name(reason), pc, rd, value, iss_pc, instr, iss_rd, 0);
+      return;
+   }
+
+   if(rd != iss_rd) {
+      diverge("destination register", pc, rd, value, iss_pc, instr, iss_rd, 0);
+      return;
+   }
+   if(iss_rd == 0) {
+      return;
+   }
+   uint32_t& iss_value = (iss_rd < 32) ? iss_.x[iss_rd] : iss_.f[iss_rd - 32];
+   if(sync) {
+      iss_value = value;
+      ++synced_;
+   } else if(iss_value != value) {
+      diverge("value", pc, rd, value, iss_pc, instr, iss_rd, iss_value);
+   }
+}
+
+void Lockstep::diverge(
+   const char* what, uint32_t pc, uint32_t rd, uint32_t value,
+   uint32_t iss_pc, uint32_t instr, uint32_t iss_rd, uint32_t iss_value
+) {
+   printf("Lockstep: divergence (%s) at commit %llu\n", what, (unsigned long long)commits_);
+   printf("   RTL: PC=%08x %s=%08x\n", pc, reg_name(rd), value);
+   printf("   ISS: PC=%08x %s=%08x instr=%08x\n", iss_pc, reg_name(iss_rd), iss_value, instr);
+   stopped_ = true;
+   diverged_ = true;
+}
+
+void Lockstep::print_stats() const {
+   printf(
+      "Lockstep: %llu instructions retired, %llu skipped, %llu checked, "
+      "%llu values taken from the RTL (CSR, IO loads)%s\n",
+      (unsigned long long)commits_, (unsigned long long)skipped_,
+      (unsigned long long)(commits_ > skipped_ ? commits_ - skipped_ : 0),
+      (unsigned long long)synced_,
+      diverged_ ? ", DIVERGED" : ""
+   );
+}
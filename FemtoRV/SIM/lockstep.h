@@ -0,0 +1,54 @@
+/*****************************************************************/
+#include "femtorv32_iss.h"
+#include "harness_memory.h"
+#include "commit_trace.h"
+
+// Lockstep checker: compares each instruction retired by the Verilated
+// core (commit_trace(), see NRV_COMMIT_TRACE in femtorv32_quark.v,
+// femtorv32_gracilis.v and femtorv32_petitbateau.v) with the host ISS
+// (femtorv32_systemc/femtorv32_iss.h) running the same firmware: PC,
+// destination register and written value. Stops at the first divergence,
+// with the RTL and ISS views of the instruction.
+//
+// The values that depend on timing are taken from the RTL: the result of
+// CSR reads (cycle counters) and of loads from the IO page are copied
+// into the ISS registers, so that both follow the same path (wait loops,
+// UART polling). The ISS does not model interrupts.
+//
+// skip(n) runs the first n instructions on the ISS alone (translated
+// blocks, hundreds of MIPS), and the first n RTL commits are only
+// counted. It supposes that these instructions do not depend on timing
+// (the check fails at commit n+1 otherwise).
+class Lockstep {
+ public:
+   explicit Lockstep(uint32_t ram_size);
+
+   // Loads the firmware read by the RTL ($readmemh, a word per token,
+   // optional @word_address), returns false if the file cannot be read
+   bool load_hex(const char* filename);
+
+   void skip(uint64_t n);
+
+   void commit(uint32_t pc, uint32_t rd, uint32_t value);
+
+   // Set after a divergence, or when both halted ('jal x0,0')
+   bool stopped() const { return stopped_; }
+   bool diverged() const { return diverged_; }
+
+   void print_stats() const;
+
+ private:
+   void diverge(const char* what, uint32_t pc, uint32_t rd, uint32_t value,
+		uint32_t iss_pc, uint32_t instr, uint32_t iss_rd, uint32_t iss_value);
+
+   HarnessMemory memory_;
+   FemtoRV32_ISS iss_;
+   uint64_t commits_ = 0;  // retired by the RTL
+   uint64_t skipped_ = 0;
+   uint64_t synced_ = 0;   // values copied from the RTL (CSR, IO loads)
+   bool stopped_ = false;
+   bool diverged_ = false;
+};
+
+// Receives commit_trace() (commit_trace.cpp), set by sim_main.cpp --lockstep
+extern Lockstep* lockstep;
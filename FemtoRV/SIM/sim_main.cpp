@@ -2,12 +2,205 @@
 #include "verilated.h"
 #include "FPU_funcs.h"
 #include "SSD1351.h"
+#ifdef SIM_SAVABLE
+#include "verilated_save.h"
+#endif
+#ifdef SIM_LOCKSTEP
+#include "lockstep.h"
+#endif
+#ifdef SIM_FGA
+#include "FGA.h"
+#endif
+#ifdef SIM_SDCARD
+#include "SDCard.h"
+#endif
+#ifdef SIM_SPI_FLASH
+#include "SPIFlash.h"
+#endif
+#ifdef SIM_STRAPS
+#include "straps.h"
+#endif
+#ifdef SIM_TRACE
+#include "verilated_fst_c.h"
+#include "commit_trace.h"
+#include "wave_trace.h"
+#endif
 #include <memory>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
 #include <fenv.h>
 #include <xmmintrin.h>
 
+// Options:
+//  --headless dir  no window, SSD1351 frames are written to dir
+//                  (and the FGA frames, see below)
+//  --frame-every N write one frame out of N (headless mode, default 1)
+//  --max-cycles N  stop after N cycles (default: run until $finish)
+//  --freq MHz      frequency of pclk for the statistics (default 1,
+//                  NRV_FREQ in RTL/CONFIGS/bench_config.v)
+//  --batch K       simulate K cycles between the $finish/max-cycles
+//                  checks (default 1). The SSD1351 is still evaluated
+//                  after each half clock: it needs to see every SPI edge
+//                  (and its eval() returns immediately between edges).
+//  --save-at N file  after N cycles, saves the state of the model and of
+//                  the SSD1351 to file, and exits
+//  --restore file  starts from a state saved by --save-at
+//                  (--save-at and --restore need a model compiled with
+//                  verilator --savable and -DSIM_SAVABLE, see bench.mk)
+//  --lockstep file.hex  compares the retired instructions with the host
+//                  ISS running file.hex (the FIRMWARE/firmware.hex of the
+//                  RTL), stops at the first divergence (needs a model
+//                  compiled with -DNRV_COMMIT_TRACE and -DSIM_LOCKSTEP,
+//                  see BENCH.lockstep in bench.mk, and SIM/lockstep.h)
+//  --lockstep-from N  runs the first N instructions on the ISS alone,
+//                  and only checks the following ones
+//  --lockstep-ram bytes  RAM of the ISS (default 65536, NRV_RAM in
+//                  RTL/CONFIGS/bench_config.v)
+//  --trace-window file[,from=N][,pc=ADDR][,cycles=M][,signals=scope+...]
+//                  FST waveform of a window of the simulation only (see
+//                  femtorv32_systemc/wave_trace.h), needs a model compiled
+//                  with --trace-fst and -DSIM_TRACE, and -DNRV_COMMIT_TRACE
+//                  for pc= (the PC of the retired instructions), see
+//                  BENCH.trace in bench.mk
+//  --sdcard image  the SD card (-DNRV_IO_SDCARD and -DSIM_SDCARD) is
+//                  emulated by SIM/SDCard.h with this image
+//  --spi-flash image  the mapped SPI flash (-DNRV_MAPPED_SPI_FLASH and
+//                  -DSIM_SPI_FLASH) is emulated by SIM/SPIFlash.h with
+//                  this image (see BENCH.storage in bench.mk)
+//  --ram bytes     RAM reported to the firmware by HardwareConfig
+//                  (default: NRV_RAM of the configuration)
+//  --devices list  devices reported by HardwareConfig, for instance
+//                  uart,ssd1351,sdcard (default: all the devices of the
+//                  configuration, but the SD card and the mapped SPI
+//                  flash only with an image)
+//                  (--ram and --devices need the superset model compiled
+//                  with -DSIM_STRAPS, see BENCH.superset in bench.mk and
+//                  SIM/straps.h)
+//
+// With a model compiled with -DNRV_IO_FGA -DNRV_FGA_HOST and -DSIM_FGA
+// (BENCH.fga in bench.mk), the FGA is emulated by SIM/FGA.h, displayed in
+// a second window (or written to the --headless dir)
 int main(int argc, char** argv, char** env) {
 
+   const char* frame_dir = nullptr;
+   unsigned int frame_every = 1;
+   unsigned long long max_cycles = 0;
+   double freq_MHz = 1.0;
+   unsigned int batch = 1;
+   unsigned long long save_at = 0;
+   const char* save_file = nullptr;
+   const char* restore_file = nullptr;
+   const char* lockstep_hex = nullptr;
+   unsigned long long lockstep_from = 0;
+   uint32_t lockstep_ram = 65536;
+   const char* trace_spec = nullptr;
+   const char* sdcard_image = nullptr;
+   const char* spi_flash_image = nullptr;
+   const char* ram_spec = nullptr;
+   const char* devices_spec = nullptr;
+   for(int i=1; i<argc; ++i) {
+      if(!strcmp(argv[i],"--headless") && i+1 < argc) {
+	 frame_dir = argv[++i];
+      } else if(!strcmp(argv[i],"--frame-every") && i+1 < argc) {
+	 frame_every = (unsigned int)strtoul(argv[++i], nullptr, 0);
+      } else if(!strcmp(argv[i],"--max-cycles") && i+1 < argc) {
+	 max_cycles = strtoull(argv[++i], nullptr, 0);
+      } else if(!strcmp(argv[i],"--freq") && i+1 < argc) {
+	 freq_MHz = atof(argv[++i]);
+      } else if(!strcmp(argv[i],"--batch") && i+1 < argc) {
+	 batch = (unsigned int)strtoul(argv[++i], nullptr, 0);
+	 if(batch == 0) {
+	    batch = 1;
+	 }
+      } else if(!strcmp(argv[i],"--save-at") && i+2 < argc) {
+	 save_at = strtoull(argv[++i], nullptr, 0);
+	 save_file = argv[++i];
+      } else if(!strcmp(argv[i],"--restore") && i+1 < argc) {
+	 restore_file = argv[++i];
+      } else if(!strcmp(argv[i],"--lockstep") && i+1 < argc) {
+	 lockstep_hex = argv[++i];
+      } else if(!strcmp(argv[i],"--lockstep-from") && i+1 < argc) {
+	 lockstep_from = strtoull(argv[++i], nullptr, 0);
+      } else if(!strcmp(argv[i],"--lockstep-ram") && i+1 < argc) {
+	 lockstep_ram = (uint32_t)strtoul(argv[++i], nullptr, 0);
+      } else if(!strcmp(argv[i],"--trace-window") && i+1 < argc) {
+	 trace_spec = argv[++i];
+      } else if(!strcmp(argv[i],"--sdcard") && i+1 < argc) {
+	 sdcard_image = argv[++i];
+      } else if(!strcmp(argv[i],"--spi-flash") && i+1 < argc) {
+	 spi_flash_image = argv[++i];
+      } else if(!strcmp(argv[i],"--ram") && i+1 < argc) {
+	 ram_spec = argv[++i];
+      } else if(!strcmp(argv[i],"--devices") && i+1 < argc) {
+	 devices_spec = argv[++i];
+      }
+   }
+
+#ifndef SIM_STRAPS
+   if(ram_spec != nullptr || devices_spec != nullptr) {
+      fprintf(stderr, "--ram/--devices: model not compiled with -DSIM_STRAPS\n");
+      return 1;
+   }
+#else
+   if(ram_spec != nullptr) {
+      sim_straps_ram_bytes = (uint32_t)strtoul(ram_spec, nullptr, 0);
+   }
+   if(devices_spec != nullptr) {
+      if(!sim_straps_parse_devices(devices_spec, sim_straps_device_mask)) {
+	 return 1;
+      }
+   } else {
+      // a device without its model would only answer garbage
+      if(sdcard_image == nullptr) {
+	 sim_straps_device_mask &= ~sim_straps_device_bits("sdcard");
+      }
+      if(spi_flash_image == nullptr) {
+	 sim_straps_device_mask &= ~sim_straps_device_bits("mapped_spi_flash");
+      }
+   }
+   sim_straps_print();
+#endif
+
+#ifndef SIM_LOCKSTEP
+   if(lockstep_hex != nullptr) {
+      fprintf(stderr, "--lockstep: model not compiled with -DSIM_LOCKSTEP\n");
+      return 1;
+   }
+#else
+   std::unique_ptr<Lockstep> checker;
+   if(lockstep_hex != nullptr) {
+      if(restore_file != nullptr) {
+	 fprintf(stderr, "--lockstep: cannot start from a restored state\n");
+	 return 1;
+      }
+      checker.reset(new Lockstep(lockstep_ram));
+      if(!checker->load_hex(lockstep_hex)) {
+	 return 1;
+      }
+      checker->skip(lockstep_from);
+      lockstep = checker.get();
+   }
+#endif
+
+#ifndef SIM_TRACE
+   if(trace_spec != nullptr) {
+      fprintf(stderr, "--trace-window: model not compiled with --trace-fst and -DSIM_TRACE\n");
+      return 1;
+   }
+#else
+   std::unique_ptr<WaveWindow> window;
+   if(trace_spec != nullptr) {
+      window.reset(new WaveWindow);
+      std::string error;
+      if(!window->parse(trace_spec, error)) {
+	 fprintf(stderr, "--trace-window: %s\n", error.c_str());
+	 return 1;
+      }
+      Verilated::traceEverOn(true);
+   }
+#endif
+
    // simplest rounding = ignore LSBs
    fesetround(FE_TOWARDZERO);
 
@@ -16,13 +209,177 @@ int main(int argc, char** argv, char** env) {
    
    VfemtoRV32_bench top;
    SSD1351 oled(
-      top.oled_DIN, top.oled_CLK, top.oled_CS, top.oled_DC, top.oled_RST
+      top.oled_DIN, top.oled_CLK, top.oled_CS, top.oled_DC, top.oled_RST,
+      frame_dir, frame_every
    );
+#ifdef SIM_FGA
+   FGA fga(freq_MHz, frame_dir, frame_every);
+   fga_host = &fga;
+#endif
+#ifdef SIM_SDCARD
+   std::unique_ptr<SDCard> sdcard;
+   if(sdcard_image != nullptr) {
+      sdcard.reset(new SDCard(top.sd_clk, top.sd_cs_n, top.sd_mosi, top.sd_miso));
+      if(!sdcard->open(sdcard_image)) {
+	 return 1;
+      }
+   }
+#define SDCARD_EVAL() if(sdcard) sdcard->eval()
+#else
+   if(sdcard_image != nullptr) {
+      fprintf(stderr, "--sdcard: model not compiled with -DNRV_IO_SDCARD -DSIM_SDCARD\n");
+      return 1;
+   }
+#define SDCARD_EVAL()
+#endif
+#ifdef SIM_SPI_FLASH
+   std::unique_ptr<SPIFlash> spi_flash;
+   if(spi_flash_image != nullptr) {
+      spi_flash.reset(new SPIFlash(top.spi_clk, top.spi_cs_n, top.spi_mosi, top.spi_miso));
+      if(!spi_flash->open(spi_flash_image)) {
+	 return 1;
+      }
+   }
+#define SPI_FLASH_EVAL() if(spi_flash) spi_flash->eval()
+#else
+   if(spi_flash_image != nullptr) {
+      fprintf(stderr, "--spi-flash: model not compiled with -DNRV_MAPPED_SPI_FLASH -DSIM_SPI_FLASH\n");
+      return 1;
+   }
+#define SPI_FLASH_EVAL()
+#endif
    top.pclk = 0;
+   unsigned long long cycles = 0;
+#ifndef SIM_SAVABLE
+   if(restore_file != nullptr || save_file != nullptr) {
+      fprintf(stderr, "--save-at/--restore: model not compiled with --savable\n");
+      return 1;
+   }
+#else
+   if(restore_file != nullptr) {
+      VerilatedRestore is;
+      is.open(restore_file);
+      if(!is.isOpen()) {
+	 perror(restore_file);
+	 return 1;
+      }
+      is >> top;
+      oled.restore(is);
+#ifdef SIM_FGA
+      fga.restore(is);
+#endif
+      is.read(&cycles, sizeof(cycles));
+      is.close();
+      printf("Restored %s (cycle %llu)\n", restore_file, cycles);
+   }
+#endif
+#ifdef SIM_TRACE
+   // The file is only opened when the window starts: the hierarchy is
+   // declared (and filtered by dumpvars) before, the time is 2*cycle
+   VerilatedFstC fst;
+   if(window) {
+      top.trace(&fst, 99);
+      for(const std::string& scope : window->signals) {
+	 fst.dumpvars(0, scope);
+      }
+   }
+   bool tracing = false;
+#endif
    while(!Verilated::gotFinish()) {
-      top.pclk = !top.pclk;
-      top.eval();
-      oled.eval();
+      for(unsigned int k=0; k<batch; ++k) {
+	 top.pclk = 1;
+	 top.eval();
+	 oled.eval();
+	 SDCARD_EVAL();
+	 SPI_FLASH_EVAL();
+#ifdef SIM_TRACE
+	 if(window) {
+	    tracing = window->update(cycles + k, commit_pc);
+	    if(tracing && !fst.isOpen()) {
+	       fst.open(window->file.c_str());
+	    }
+	    if(tracing) {
+	       fst.dump(2*(cycles + k));
+	    } else if(fst.isOpen()) {
+	       fst.close();
+	    }
+	 }
+#endif
+	 top.pclk = 0;
+	 top.eval();
+	 oled.eval();
+	 SDCARD_EVAL();
+	 SPI_FLASH_EVAL();
+#ifdef SIM_TRACE
+	 if(tracing) {
+	    fst.dump(2*(cycles + k) + 1);
+	 }
+#endif
+      }
+      cycles += batch;
+#ifdef SIM_SAVABLE
+      if(save_file != nullptr && cycles >= save_at) {
+	 VerilatedSave os;
+	 os.open(save_file);
+	 if(!os.isOpen()) {
+	    perror(save_file);
+	    return 1;
+	 }
+	 os << top;
+	 oled.save(os);
+#ifdef SIM_FGA
+	 fga.save(os);
+#endif
+	 os.write(&cycles, sizeof(cycles));
+	 os.close();
+	 printf("Saved %s (cycle %llu)\n", save_file, cycles);
+	 break;
+      }
+#endif
+      if(max_cycles != 0 && cycles >= max_cycles) {
+	 break;
+      }
+#ifdef SIM_LOCKSTEP
+      if(lockstep != nullptr && lockstep->stopped()) {
+	 break;
+      }
+#endif
+   }
+   oled.print_stats(freq_MHz);
+#ifdef SIM_SDCARD
+   if(sdcard) {
+      sdcard->print_stats();
+   }
+#endif
+#ifdef SIM_SPI_FLASH
+   if(spi_flash) {
+      spi_flash->print_stats();
+   }
+#endif
+#ifdef SIM_FGA
+   fga.print_stats();
+   fga_host = nullptr;
+#endif
+#ifdef SIM_TRACE
+   if(window) {
+      if(fst.isOpen()) {
+	 fst.close();
+      }
+      if(window->started()) {
+	 printf("Trace window: %s from cycle %llu\n",
+		window->file.c_str(), (unsigned long long)window->start_cycle());
+      } else {
+	 printf("Trace window: never started\n");
+      }
+   }
+#endif
+#ifdef SIM_LOCKSTEP
+   if(lockstep != nullptr) {
+      lockstep->print_stats();
+      bool diverged = lockstep->diverged();
+      lockstep = nullptr;
+      return diverged ? 1 : 0;
    }
+#endif
    return 0;
 }
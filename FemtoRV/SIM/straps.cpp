@@ -0,0 +1,81 @@
+#include "straps.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+uint32_t sim_straps_ram_bytes = 0;
+uint32_t sim_straps_device_mask = ~0u;
+
+// Bits of the devices in IO_HW_CONFIG_DEVICES (RTL/DEVICES/HardwareConfig_bits.v)
+static const struct {
+   const char* name;
+   uint32_t    bits;
+} devices[] = {
+   { "leds",             1u << 0 },
+   { "uart",             (1u << 1) | (1u << 2) },
+   { "ssd1351",          (1u << 3) | (1u << 4) | (1u << 5) },
+   { "max7219",          1u << 7 },
+   { "sdcard",           1u << 8 },
+   { "buttons",          1u << 9 },
+   { "fga",              (1u << 10) | (1u << 11) },
+   { "timer",            1u << 12 },
+   { "mapped_spi_flash", 1u << 20 }
+};
+
+uint32_t sim_straps_ram(uint32_t compiled) {
+   if(sim_straps_ram_bytes == 0 || sim_straps_ram_bytes > compiled) {
+      return compiled;
+   }
+   return sim_straps_ram_bytes;
+}
+
+uint32_t sim_straps_devices(uint32_t compiled) {
+   return compiled & sim_straps_device_mask;
+}
+
+uint32_t sim_straps_device_bits(const char* name) {
+   for(const auto& d : devices) {
+      if(!strcmp(name, d.name)) {
+	 return d.bits;
+      }
+   }
+   return 0;
+}
+
+bool sim_straps_parse_devices(const char* spec, uint32_t& mask) {
+   mask = 0;
+   std::string list(spec);
+   size_t start = 0;
+   for(;;) {
+      size_t comma = list.find(',', start);
+      std::string name = list.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+      uint32_t bits = sim_straps_device_bits(name.c_str());
+      if(bits == 0 && !name.empty() && name != "none") {
+	 fprintf(stderr, "--devices: unknown device %s (", name.c_str());
+	 for(const auto& d : devices) {
+	    fprintf(stderr, "%s%s", &d == &devices[0] ? "" : ",", d.name);
+	 }
+	 fprintf(stderr, ")\n");
+	 return false;
+      }
+      mask |= bits;
+      if(comma == std::string::npos) {
+	 return true;
+      }
+      start = comma + 1;
+   }
+}
+
+void sim_straps_print() {
+   if(sim_straps_ram_bytes != 0) {
+      printf("Straps: %u bytes of RAM, devices:", (unsigned int)sim_straps_ram_bytes);
+   } else {
+      printf("Straps: RAM of the configuration, devices:");
+   }
+   for(const auto& d : devices) {
+      if((sim_straps_device_mask & d.bits) == d.bits) {
+	 printf(" %s", d.name);
+      }
+   }
+   printf("\n");
+}
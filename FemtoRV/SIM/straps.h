@@ -0,0 +1,33 @@
+// Runtime straps of the superset bench model (RTL/CONFIGS/bench_superset_config.v,
+// BENCH.superset in BOARDS/bench.mk): the model is compiled once with all
+// the devices that the harness can emulate and the largest RAM, and the
+// harness chooses which of them the firmware sees. HardwareConfig.v,
+// compiled with -DNRV_SIM_STRAPS, calls the two functions below (Verilator
+// $c) instead of returning the constants of the configuration, so that a
+// firmware that tests FEMTOSOC_HAS_DEVICE() and IO_HW_CONFIG_RAM behaves
+// as on a board with this subset. The other devices are still in the
+// model (a firmware that does not test them can still access them).
+#include <stdint.h>
+
+// compiled: the value of the configuration (the straps only remove devices
+// and RAM from it)
+uint32_t sim_straps_ram(uint32_t compiled);
+uint32_t sim_straps_devices(uint32_t compiled);
+
+// Harness side (SIM/sim_main.cpp --ram and --devices options)
+
+// 0: the RAM of the configuration
+extern uint32_t sim_straps_ram_bytes;
+
+// Devices seen by the firmware (bits of IO_HW_CONFIG_DEVICES), default: all
+extern uint32_t sim_straps_device_mask;
+
+// Parses a comma-separated list of device names (leds,uart,ssd1351,...),
+// prints the names on error
+bool sim_straps_parse_devices(const char* spec, uint32_t& mask);
+
+// Bits of a device, 0 if unknown
+uint32_t sim_straps_device_bits(const char* name);
+
+// Prints the straps
+void sim_straps_print();
@@ -36,6 +36,8 @@
 #define GL_height 25
 #endif
 
+static inline void GL_tty_invalidate();
+
 /**
  * \brief Sets the current graphics position
  * \param[in] x typically in 0,79
@@ -146,6 +148,7 @@ static inline void GL_restore_default_colors() {
 static inline void GL_clear() {
     GL_restore_default_colors();
     printf("\033[2J"); // clear screen
+    GL_tty_invalidate();
 }
 
 /**
@@ -190,6 +193,194 @@ static inline void GL_swapbuffers() {
 #endif
 }
 
+/***************************************************************/
+
+/*
+ * Renderer used by GL_scan_RGB() and GL_scan_RGBf() (same as the one of
+ * tty_graphics.h):
+ * - the color escape sequences are only sent when the background or 
+ *   foreground color changes;
+ * - a character with two identical pixels is a space, or a full block if
+ *   the foreground color is already the right one;
+ * - the output is accumulated in a buffer, sent in one burst at the end
+ *   of each row (or when the buffer is full).
+ * With a shadow buffer (#define GL_TTY_SHADOW before #including GL_tty.h),
+ * the characters that did not change since the previous scan are skipped.
+ * It takes 8 bytes of RAM per character (GL_width x GL_height/2).
+ * #define GL_TTY_COLOR_MASK 0xF0 (for instance) quantizes the colors.
+ */
+
+#ifndef GL_TTY_BUFFER_SIZE
+#define GL_TTY_BUFFER_SIZE 256
+#endif
+
+#ifndef GL_TTY_COLOR_MASK
+#define GL_TTY_COLOR_MASK 0xFF
+#endif
+
+#define GL_TTY_NO_COLOR 0xFFFFFFFFu
+
+static char     GL_tty_buffer[GL_TTY_BUFFER_SIZE+1];
+static int      GL_tty_buffer_len = 0;
+static uint32_t GL_tty_fg = GL_TTY_NO_COLOR;
+static uint32_t GL_tty_bg = GL_TTY_NO_COLOR;
+static int      GL_tty_x  = 0;  // cursor, in characters
+static int      GL_tty_y  = 0;
+
+#ifdef GL_TTY_SHADOW
+static uint32_t GL_tty_shadow[(GL_height+1)/2][GL_width][2];
+static int      GL_tty_shadow_valid = 0;
+#endif
+
+/**
+ * \brief Forgets what is on the terminal (the next scan redraws everything).
+ * \details Called by GL_clear(), call it if something else was drawn in
+ *  the area of the scans.
+ */
+static inline void GL_tty_invalidate() {
+#ifdef GL_TTY_SHADOW
+    GL_tty_shadow_valid = 0;
+#endif
+}
+
+static inline void GL_tty_flush() {
+    GL_tty_buffer[GL_tty_buffer_len] = '\0';
+    printf("%s", GL_tty_buffer);
+    GL_tty_buffer_len = 0;
+}
+
+// Makes room for n characters in the buffer
+static inline void GL_tty_reserve(int n) {
+    if(GL_tty_buffer_len + n > GL_TTY_BUFFER_SIZE) {
+	GL_tty_flush();
+    }
+}
+
+static inline void GL_tty_put_string(const char* s) {
+    while(*s) {
+	GL_tty_buffer[GL_tty_buffer_len++] = *(s++);
+    }
+}
+
+static inline void GL_tty_put_uint(uint32_t x) {
+    char digits[10];
+    int n = 0;
+    do {
+	digits[n++] = '0' + x % 10;
+	x /= 10;
+    } while(x);
+    while(n) {
+	GL_tty_buffer[GL_tty_buffer_len++] = digits[--n];
+    }
+}
+
+// code = 38: foreground, 48: background
+static inline void GL_tty_put_color(int code, uint32_t rgb) {
+    GL_tty_reserve(20);
+    GL_tty_put_string(code == 38 ? "\033[38;2;" : "\033[48;2;");
+    GL_tty_put_uint((rgb >> 16) & 255);
+    GL_tty_put_string(";");
+    GL_tty_put_uint((rgb >> 8) & 255);
+    GL_tty_put_string(";");
+    GL_tty_put_uint(rgb & 255);
+    GL_tty_put_string("m");
+}
+
+static inline void GL_tty_set_fg(uint32_t rgb) {
+    if(rgb != GL_tty_fg) {
+	GL_tty_put_color(38, rgb);
+	GL_tty_fg = rgb;
+    }
+}
+
+static inline void GL_tty_set_bg(uint32_t rgb) {
+    if(rgb != GL_tty_bg) {
+	GL_tty_put_color(48, rgb);
+	GL_tty_bg = rgb;
+    }
+}
+
+// Moves the cursor to character x,y (0-based)
+static inline void GL_tty_move(int x, int y) {
+    if(x == GL_tty_x && y == GL_tty_y) {
+	return;
+    }
+    GL_tty_reserve(12);
+    GL_tty_put_string("\033[");
+    if(y == GL_tty_y && x > GL_tty_x) {
+	GL_tty_put_uint(x - GL_tty_x);
+	GL_tty_put_string("C");
+    } else {
+	GL_tty_put_uint(y+1);
+	GL_tty_put_string(";");
+	GL_tty_put_uint(x+1);
+	GL_tty_put_string("H");
+    }
+    GL_tty_x = x;
+    GL_tty_y = y;
+}
+
+static inline void GL_tty_scan_begin() {
+    // the program may have changed the colors since the last scan
+    GL_tty_fg = GL_TTY_NO_COLOR;
+    GL_tty_bg = GL_TTY_NO_COLOR;
+    GL_tty_reserve(3);
+    GL_tty_put_string("\033[H");
+    GL_tty_x = 0;
+    GL_tty_y = 0;
+}
+
+// Character x,y with top pixel rgb1 and bottom pixel rgb2
+static inline void GL_tty_scan_cell(int x, int y, uint32_t rgb1, uint32_t rgb2) {
+#ifdef GL_TTY_SHADOW
+    if(x < GL_width && y < (GL_height+1)/2) {
+	uint32_t* shadow = GL_tty_shadow[y][x];
+	if(GL_tty_shadow_valid && shadow[0] == rgb1 && shadow[1] == rgb2) {
+	    return;
+	}
+	shadow[0] = rgb1;
+	shadow[1] = rgb2;
+    }
+#endif
+    GL_tty_move(x,y);
+    if(rgb1 == rgb2) {
+	if(rgb1 == GL_tty_bg) {
+	    GL_tty_reserve(1);
+	    GL_tty_put_string(" ");
+	} else if(rgb1 == GL_tty_fg) {
+	    GL_tty_reserve(3);
+	    GL_tty_put_string("\xE2\x96\x88"); // full block
+	} else {
+	    GL_tty_set_bg(rgb1);
+	    GL_tty_reserve(1);
+	    GL_tty_put_string(" ");
+	}
+    } else {
+	GL_tty_set_bg(rgb1);
+	GL_tty_set_fg(rgb2);
+	GL_tty_reserve(3);
+	GL_tty_put_string("\xE2\x96\x83"); // lower block
+    }
+    ++GL_tty_x;
+}
+
+// Leaves the cursor below the image, with a black background and foreground
+static inline void GL_tty_scan_end(int height) {
+    GL_tty_set_fg(0);
+    GL_tty_set_bg(0);
+    GL_tty_move(0,(height+1)/2);
+    GL_tty_flush();
+#ifdef GL_TTY_SHADOW
+    GL_tty_shadow_valid = 1;
+#endif
+}
+
+#define GL_tty_pack_rgb(r,g,b) (                                        \
+    (((uint32_t)(r) & GL_TTY_COLOR_MASK) << 16) |                       \
+    (((uint32_t)(g) & GL_TTY_COLOR_MASK) << 8)  |                       \
+     ((uint32_t)(b) & GL_TTY_COLOR_MASK)                                \
+)
+
 typedef void (*GL_pixelfunc_RGB)(int x, int y, uint8_t* r, uint8_t* g, uint8_t* b);
 typedef void (*GL_pixelfunc_RGBf)(int x, int y, float* r, float* g, float* b);
 
@@ -199,24 +390,26 @@ typedef void (*GL_pixelfunc_RGBf)(int x, int y, float* r, float* g, float* b);
  * \param[in] do_pixel the user function to be called for each pixel 
  *  (a "shader"), that determines the (integer) components r,g,b of 
  *   the pixel's color.
- * \details Uses half-charater pixels.
+ * \details Uses half-charater pixels, sends only what changed (see the
+ *  renderer above).
  */
 static inline void GL_scan_RGB(
     int width, int height, GL_pixelfunc_RGB do_pixel
 ) {
     uint8_t r1, g1, b1;
     uint8_t r2, g2, b2;
-    GL_home(); 
+    GL_tty_scan_begin();
     for (int j = 0; j<height; j+=2) { 
 	for (int i = 0; i<width; i++) {
 	    do_pixel(i,j  , &r1, &g1, &b1);
 	    do_pixel(i,j+1, &r2, &g2, &b2);
-	    GL_set2pixelsRGBhere(r1,g1,b1,r2,g2,b2);
-	    if(i == width-1) {
-		GL_newline();
-	    }
+	    GL_tty_scan_cell(
+		i, j/2, GL_tty_pack_rgb(r1,g1,b1), GL_tty_pack_rgb(r2,g2,b2)
+	    );
 	}
+	GL_tty_flush();
     }
+    GL_tty_scan_end(height);
 }
 
 /**
@@ -237,7 +430,8 @@ static inline uint8_t GL_ftoi(float f) {
  * \param[in] do_pixel the user function to be called for each pixel 
  *  (a "shader"), that determines the (floating-point) components 
  *  fr,fg,fb of the pixel's color.
- * \details Uses half-charater pixels.
+ * \details Uses half-charater pixels, sends only what changed (see the
+ *  renderer above).
  */
 static inline void GL_scan_RGBf(
     int width, int height, GL_pixelfunc_RGBf do_pixel
@@ -246,7 +440,7 @@ static inline void GL_scan_RGBf(
     float fr2, fg2, fb2;
     uint8_t r1, g1, b1;
     uint8_t r2, g2, b2;
-    GL_home();
+    GL_tty_scan_begin();
     for (int j = 0; j<height; j+=2) { 
 	for (int i = 0; i<width; i++) {
 	    do_pixel(i,j  , &fr1, &fg1, &fb1);
@@ -257,12 +451,13 @@ static inline void GL_scan_RGBf(
 	    r2 = GL_ftoi(fr2);
 	    g2 = GL_ftoi(fg2);
 	    b2 = GL_ftoi(fb2);	    
-	    GL_set2pixelsRGBhere(r1,g1,b1,r2,g2,b2);
-	    if(i == width-1) {
-		GL_newline();
-	    }
+	    GL_tty_scan_cell(
+		i, j/2, GL_tty_pack_rgb(r1,g1,b1), GL_tty_pack_rgb(r2,g2,b2)
+	    );
 	}
+	GL_tty_flush();
     }
+    GL_tty_scan_end(height);
 }
 
 /***************************************************************/
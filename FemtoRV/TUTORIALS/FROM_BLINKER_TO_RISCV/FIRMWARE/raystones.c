@@ -32,7 +32,11 @@ static inline float min(float x, float y) { return x<y?x:y; }
 //   stats_begin_frame()
 //   stats_begin_pixel()
 //   stats_end_pixel()
+//   stats_end_pass()
 //   stats_end_frame()
+//
+// With graphics_progressive, graphics_fill_rect() and graphics_goto()
+// are also used.
 
 
 // Size of the screen
@@ -53,6 +57,15 @@ static int bench_run=0;
 // (comment-out if terminal does not support it)
 #define graphics_double_lines
 
+// Progressive rendering (not for the bench run): the image is first
+// computed every 8th pixel and displayed as 8x8 blocks, then refined
+// to 4x4, 2x2 and 1x1 blocks. Each pass only computes the pixels that
+// the previous ones did not compute (the total number of rays is the
+// same as in raster order).
+// Comment-out to render in raster order.
+#define graphics_progressive
+#define graphics_progressive_step 8
+
 // Replace with your own stuff to initialize graphics
 static inline void graphics_init() {
     printf("\033[48;5;16m"   // set background color black
@@ -120,6 +133,39 @@ void graphics_set_pixel(int x, int y, float r, float g, float b) {
 }
 
 
+// Moves the cursor to pixel (x,y) (progressive rendering)
+static inline void graphics_goto(int x, int y) {
+#ifdef graphics_double_lines
+   y /= 2;
+#endif
+   printf("\033[%d;%dH", y+1, x+1);
+}
+
+// Displays a block of pixels of the same color (progressive rendering).
+// With graphics_double_lines, y and h are even.
+static void graphics_fill_rect(
+   int x, int y, int w, int h, float r, float g, float b
+) {
+   uint8_t R = (uint8_t)(255.0f * max(0.0f, min(1.0f, r)));
+   uint8_t G = (uint8_t)(255.0f * max(0.0f, min(1.0f, g)));
+   uint8_t B = (uint8_t)(255.0f * max(0.0f, min(1.0f, b)));
+   if(x+w > graphics_width) {
+      w = graphics_width - x;
+   }
+#ifdef graphics_double_lines
+   int dy = 2;
+#else
+   int dy = 1;
+#endif
+   for(int j=y; j<y+h && j<graphics_height; j+=dy) {
+      graphics_goto(x,j);
+      printf("\033[48;2;%d;%d;%dm",(int)R,(int)G,(int)B);
+      for(int i=0; i<w; ++i) {
+	 printf(" ");
+      }
+   }
+}
+
 // Begins statistics collection for current pixel
 // Leave emtpy if not needed.
 // There are these two levels because on some
@@ -158,6 +204,18 @@ static inline stats_begin_frame() {
     cycles_start  = rdcycle();
 }
 
+// Ends statistics collection for a pass of progressive rendering, and
+// displays the number of rays per million cycles so far, below the image
+// (rays is the number of primary rays since the beginning of the frame).
+// Leave emtpy if not needed.
+static inline stats_end_pass(int step, uint32_t rays) {
+   uint64_t cycles = rdcycle() - cycles_start;
+   graphics_goto(0,graphics_height);
+   graphics_terminate();
+   printf("%dx%d: %d rays, rays/Mcycles=", step, step, rays);
+   printk(((uint64_t)rays*1000000000)/cycles);
+}
+
 // Ends statistics collection for current frame
 // and displays result.
 // Leave emtpy if not needed.
@@ -297,6 +355,70 @@ BOOL Sphere_ray_intersect(Sphere* S, vec3 orig, vec3 dir, float* t0) {
   return 1;
 }
 
+/*************************************************************************/
+
+// Bounding spheres, one around each group of two consecutive spheres:
+// a ray that misses it skips the two sphere tests (in this scene, a bounding
+// sphere around all the spheres would be hit by nearly all the rays that
+// hit the checkerboard, so there is no root).
+// Compile with -DRAYSTONES_STRICT to test every sphere for every ray,
+// as in the original tinyraytracer (and keep raystones scores comparable).
+
+typedef struct {
+  vec3 center;
+  float radius;
+  int first;   // index of the first sphere in the group
+  int count;   // number of spheres in the group
+} Bounds;
+
+#define MAX_BOUNDS_GROUPS 4
+#define BOUNDS_GROUP_SIZE 2
+
+Bounds scene_bounds_groups[MAX_BOUNDS_GROUPS];
+int    nb_bounds_groups = 0;
+
+Bounds make_Bounds(Sphere* spheres, int first, int count) {
+  Bounds B;
+  B.center = make_vec3(0,0,0);
+  for(int i=first; i<first+count; ++i) {
+    B.center = vec3_add(B.center, spheres[i].center);
+  }
+  B.center = vec3_scale(1.0f/(float)count, B.center);
+  B.radius = 0.0f;
+  for(int i=first; i<first+count; ++i) {
+    B.radius = max(
+       B.radius,
+       vec3_length(vec3_sub(spheres[i].center,B.center)) + spheres[i].radius
+    );
+  }
+  B.first = first;
+  B.count = count;
+  return B;
+}
+
+void scene_init_bounds(Sphere* spheres, int nb_spheres) {
+  nb_bounds_groups = 0;
+  for(int i=0; i<nb_spheres; i+=BOUNDS_GROUP_SIZE) {
+    scene_bounds_groups[nb_bounds_groups++] = make_Bounds(
+       spheres, i, min(BOUNDS_GROUP_SIZE, nb_spheres-i)
+    );
+  }
+}
+
+// Conservative: returns 0 only if the ray cannot hit anything inside
+// the bounding sphere nearer than max_dist (dir is normalized).
+BOOL Bounds_ray_hit(Bounds* B, vec3 orig, vec3 dir, float max_dist) {
+  vec3 L = vec3_sub(B->center, orig);
+  float tca = vec3_dot(L,dir);
+  float L2 = vec3_dot(L,L);
+  float r2 = B->radius*B->radius;
+  if (L2 - tca*tca > r2) return 0;  // the line misses the bounding sphere
+  if (L2 > r2 && tca < 0) return 0;  // behind, and the origin is outside
+  return (tca - B->radius) < max_dist;
+}
+
+/*************************************************************************/
+
 vec3 reflect(vec3 I, vec3 N) {
   return vec3_sub(I, vec3_scale(2.f*vec3_dot(I,N),N));
 }
@@ -319,7 +441,20 @@ BOOL scene_intersect(
    vec3* hit, vec3* N, Material* material
 ) {
   float spheres_dist = 1e30;
+#ifdef RAYSTONES_STRICT
   for(int i=0; i<nb_spheres; ++i) {
+#else
+  for(int g=0; g<nb_bounds_groups; ++g) {
+    if(
+       scene_bounds_groups[g].count > 1 &&
+       !Bounds_ray_hit(&scene_bounds_groups[g], orig, dir, spheres_dist)
+    ) {
+      continue;
+    }
+    int first = scene_bounds_groups[g].first;
+    int last  = first + scene_bounds_groups[g].count;
+    for(int i=first; i<last; ++i) {
+#endif
     float dist_i;
     if(
        Sphere_ray_intersect(&spheres[i], orig, dir, &dist_i) &&
@@ -330,6 +465,9 @@ BOOL scene_intersect(
       *N = vec3_normalize(vec3_sub(*hit, spheres[i].center));
       *material = spheres[i].material;
     }
+#ifndef RAYSTONES_STRICT
+    }
+#endif
   }
   float checkerboard_dist = 1e30;
   if (fabs(dir.y)>1e-3)  {
@@ -348,6 +486,41 @@ BOOL scene_intersect(
   return min(spheres_dist, checkerboard_dist)<1000;
 }
 
+// Shadow rays: any hit nearer than max_dist (and than 1000, as in
+// scene_intersect()) is an occluder, stops at the first one.
+BOOL scene_occluded(
+   vec3 orig, vec3 dir, Sphere* spheres, int nb_spheres, float max_dist
+) {
+  max_dist = min(max_dist, 1000);
+  if (fabs(dir.y)>1e-3)  {
+    float d = -(orig.y+4)/dir.y; // the checkerboard plane has equation y = -4
+    vec3 pt = vec3_add(orig, vec3_scale(d,dir));
+    if (d>0 && d<max_dist && fabs(pt.x)<10 && pt.z<-10 && pt.z>-30) {
+      return 1;
+    }
+  }
+  for(int g=0; g<nb_bounds_groups; ++g) {
+    if(
+       scene_bounds_groups[g].count > 1 &&
+       !Bounds_ray_hit(&scene_bounds_groups[g], orig, dir, max_dist)
+    ) {
+      continue;
+    }
+    int first = scene_bounds_groups[g].first;
+    int last  = first + scene_bounds_groups[g].count;
+    for(int i=first; i<last; ++i) {
+      float dist_i;
+      if(
+	 Sphere_ray_intersect(&spheres[i], orig, dir, &dist_i) &&
+	 (dist_i < max_dist)
+      ) {
+	return 1;
+      }
+    }
+  }
+  return 0;
+}
+
 vec3 cast_ray(
    vec3 orig, vec3 dir, Sphere* spheres, int nb_spheres,
    Light* lights, int nb_lights, int depth /* =0 */
@@ -396,6 +569,7 @@ vec3 cast_ray(
                 ? vec3_sub(point,vec3_scale(1e-3,N))
                 : vec3_add(point,vec3_scale(1e-3,N)) ;
     // checking if the point lies in the shadow of the lights[i]
+#ifdef RAYSTONES_STRICT
     vec3 shadow_pt, shadow_N;
     Material tmpmaterial;
     if (
@@ -406,6 +580,11 @@ vec3 cast_ray(
   	 vec3_length(vec3_sub(shadow_pt,shadow_orig)) < light_distance
 	     )
     ) continue ;
+#else
+    if (
+       scene_occluded(shadow_orig, light_dir, spheres, nb_spheres, light_distance)
+    ) continue ;
+#endif
     
     diffuse_light_intensity  +=
                   lights[i].intensity * max(0.f, vec3_dot(light_dir,N));
@@ -430,7 +609,7 @@ vec3 cast_ray(
   return result;
 }
 
-static inline void render_pixel(
+static inline vec3 render_pixel(
     int i, int j, Sphere* spheres, int nb_spheres, Light* lights, int nb_lights
 ) {
    const float fov  = M_PI/3.;
@@ -442,23 +621,105 @@ static inline void render_pixel(
        make_vec3(0,0,0), vec3_normalize(make_vec3(dir_x, dir_y, dir_z)),
        spheres, nb_spheres, lights, nb_lights, 0
    );
-   graphics_set_pixel(i,j,C.x,C.y,C.z);
    stats_end_pixel();
+   return C;
 }
 
+static inline void render_and_set_pixel(
+    int i, int j, Sphere* spheres, int nb_spheres, Light* lights, int nb_lights
+) {
+   vec3 C = render_pixel(i,j,spheres,nb_spheres,lights,nb_lights);
+   graphics_set_pixel(i,j,C.x,C.y,C.z);
+}
+
+#ifdef graphics_progressive
+
+// The samples at even (i,j) (computed by the passes with step >= 2),
+// reused by the last pass, that needs them to display two pixels per
+// character.
+#define PROGRESSIVE_MAX_WIDTH  120
+#define PROGRESSIVE_MAX_HEIGHT 60
+static uint8_t progressive_samples[PROGRESSIVE_MAX_HEIGHT/2][PROGRESSIVE_MAX_WIDTH/2][3];
+
+// Pass 'step' computes the pixels (i,j) that are multiples of step,
+// except the ones that are multiples of 2*step (computed by the previous
+// pass), and displays each of them as a block of step x step pixels.
+// The last pass (step 1) re-displays everything in raster order.
+void render_progressive(
+   Sphere* spheres, int nb_spheres, Light* lights, int nb_lights
+) {
+   uint32_t rays = 0;
+   stats_begin_frame();
+   for(int step = graphics_progressive_step; step >= 2; step /= 2) {
+      int first_pass = (step == graphics_progressive_step);
+      for (int j = 0; j<graphics_height; j += step) {
+	 for (int i = 0; i<graphics_width; i += step) {
+	    if(!first_pass && !(i & step) && !(j & step)) {
+	       continue;
+	    }
+	    vec3 C = render_pixel(i,j,spheres,nb_spheres,lights,nb_lights);
+	    uint8_t* sample = progressive_samples[j/2][i/2];
+	    sample[0] = (uint8_t)(255.0f * max(0.0f, min(1.0f, C.x)));
+	    sample[1] = (uint8_t)(255.0f * max(0.0f, min(1.0f, C.y)));
+	    sample[2] = (uint8_t)(255.0f * max(0.0f, min(1.0f, C.z)));
+	    graphics_fill_rect(i,j,step,step,C.x,C.y,C.z);
+	    ++rays;
+	 }
+      }
+      stats_end_pass(step, rays);
+   }
+#ifdef graphics_double_lines
+   const int dj = 2;
+#else
+   const int dj = 1;
+#endif
+   for (int j = 0; j<graphics_height; j += dj) {
+      graphics_goto(0,j);
+      for (int i = 0; i<graphics_width; i++) {
+	 for (int jj = j; jj < j+dj; jj++) {
+	    if(!(i & 1) && !(jj & 1)) {
+	       // +0.5: so that the conversion back to uint8_t gives the same value
+	       uint8_t* sample = progressive_samples[jj/2][i/2];
+	       graphics_set_pixel(
+		 i,jj,
+		 ((float)sample[0]+0.5f)/255.0f,
+		 ((float)sample[1]+0.5f)/255.0f,
+		 ((float)sample[2]+0.5f)/255.0f
+	       );
+	    } else {
+	       render_and_set_pixel(i,jj,spheres,nb_spheres,lights,nb_lights);
+	       ++rays;
+	    }
+	 }
+      }
+   }
+   stats_end_pass(1, rays);
+   stats_end_frame();
+}
+
+#endif
+
 void render(Sphere* spheres, int nb_spheres, Light* lights, int nb_lights) {
+#ifdef graphics_progressive
+   if(!bench_run &&
+      graphics_width  <= PROGRESSIVE_MAX_WIDTH &&
+      graphics_height <= PROGRESSIVE_MAX_HEIGHT) {
+      render_progressive(spheres, nb_spheres, lights, nb_lights);
+      return;
+   }
+#endif
    stats_begin_frame();
 #ifdef graphics_double_lines  
    for (int j = 0; j<graphics_height; j+=2) { 
       for (int i = 0; i<graphics_width; i++) {
-	  render_pixel(i,j  ,spheres,nb_spheres,lights,nb_lights);
-	  render_pixel(i,j+1,spheres,nb_spheres,lights,nb_lights);	  
+	  render_and_set_pixel(i,j  ,spheres,nb_spheres,lights,nb_lights);
+	  render_and_set_pixel(i,j+1,spheres,nb_spheres,lights,nb_lights);	  
       }
    }
 #else
    for (int j = 0; j<graphics_height; j++) { 
       for (int i = 0; i<graphics_width; i++) {
-	  render_pixel(i,j  ,spheres,nb_spheres,lights,nb_lights);
+	  render_and_set_pixel(i,j  ,spheres,nb_spheres,lights,nb_lights);
       }
    }
 #endif
@@ -490,6 +751,8 @@ void init_scene() {
     spheres[2] = make_Sphere(make_vec3( 1.5, -0.5, -18), 3, red_rubber);
     spheres[3] = make_Sphere(make_vec3( 7,    5,   -18), 4,     mirror);
 
+    scene_init_bounds(spheres, nb_spheres);
+
     lights[0] = make_Light(make_vec3(-20, 20,  20), 1.5);
     lights[1] = make_Light(make_vec3( 30, 50, -25), 1.8);
     lights[2] = make_Light(make_vec3( 30, 20,  30), 1.7);
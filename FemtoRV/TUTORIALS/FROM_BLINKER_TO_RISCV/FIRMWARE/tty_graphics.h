@@ -4,6 +4,8 @@
 #include <stdio.h>
 #include <stdint.h>
 
+static inline void tty_graphics_invalidate();
+
 /**
  * \brief Resets default tty colors (white foreground, black background)
  * \details It is useful to call this function once all graphics are finished,
@@ -28,6 +30,7 @@ static inline void tty_graphics_home() {
  */
 static inline void tty_graphics_clear() {
     printf("\033[2J");
+    tty_graphics_invalidate();
 }
 
 /**
@@ -101,6 +104,223 @@ static inline void tty_graphics_newline() {
     printf("\033[48;2;0;0;0m\n");
 }
 
+/*****************************************************************************/
+
+/*
+ * Renderer used by tty_graphics_scan() and tty_graphics_fscan():
+ * - the color escape sequences are only sent when the background or 
+ *   foreground color changes;
+ * - a character with two different pixels is a lower block (background:
+ *   top pixel, foreground: bottom pixel), a character with two identical
+ *   pixels is a space, or a full block if the foreground color is already 
+ *   the right one;
+ * - the output is accumulated in a buffer, sent in one burst at the end
+ *   of each row (or when the buffer is full).
+ * With a shadow buffer (#define TTY_GRAPHICS_SHADOW before #including 
+ * tty_graphics.h), the characters that did not change since the previous
+ * scan are skipped (the cursor jumps over them). It takes 8 bytes of RAM
+ * per character (TTY_GRAPHICS_MAX_WIDTH x TTY_GRAPHICS_MAX_HEIGHT/2),
+ * 16 KB for 80x50 pixels, too much for the 6 KB configs.
+ */
+
+#ifndef TTY_GRAPHICS_BUFFER_SIZE
+#define TTY_GRAPHICS_BUFFER_SIZE 256
+#endif
+
+#define TTY_GRAPHICS_NO_COLOR 0xFFFFFFFFu
+
+static char     tty_graphics_buffer[TTY_GRAPHICS_BUFFER_SIZE+1];
+static int      tty_graphics_buffer_len = 0;
+static uint32_t tty_graphics_cur_fg = TTY_GRAPHICS_NO_COLOR;
+static uint32_t tty_graphics_cur_bg = TTY_GRAPHICS_NO_COLOR;
+static int      tty_graphics_cur_x  = 0;  /* cursor, in characters */
+static int      tty_graphics_cur_y  = 0;
+
+#ifdef TTY_GRAPHICS_SHADOW
+#ifndef TTY_GRAPHICS_MAX_WIDTH
+#define TTY_GRAPHICS_MAX_WIDTH  80
+#endif
+#ifndef TTY_GRAPHICS_MAX_HEIGHT
+#define TTY_GRAPHICS_MAX_HEIGHT 50
+#endif
+static uint32_t tty_graphics_shadow[TTY_GRAPHICS_MAX_HEIGHT/2][TTY_GRAPHICS_MAX_WIDTH][2];
+static int      tty_graphics_shadow_width  = 0; /* of the last scan, 0 if invalid */
+static int      tty_graphics_shadow_height = 0;
+static int      tty_graphics_shadow_use    = 0; /* for the current scan */
+#endif
+
+/**
+ * \brief Forgets what is on the terminal (the next scan redraws everything).
+ * \details Called by tty_graphics_clear(), call it if something else was
+ *   drawn in the area of the scans.
+ */
+static inline void tty_graphics_invalidate() {
+#ifdef TTY_GRAPHICS_SHADOW
+    tty_graphics_shadow_width = 0;
+#endif
+}
+
+static inline void tty_graphics_flush() {
+    tty_graphics_buffer[tty_graphics_buffer_len] = '\0';
+    printf("%s", tty_graphics_buffer);
+    tty_graphics_buffer_len = 0;
+}
+
+/* Makes room for n characters in the buffer */
+static inline void tty_graphics_reserve(int n) {
+    if(tty_graphics_buffer_len + n > TTY_GRAPHICS_BUFFER_SIZE) {
+	tty_graphics_flush();
+    }
+}
+
+static inline void tty_graphics_put_string(const char* s) {
+    while(*s) {
+	tty_graphics_buffer[tty_graphics_buffer_len++] = *(s++);
+    }
+}
+
+static inline void tty_graphics_put_uint(uint32_t x) {
+    char digits[10];
+    int n = 0;
+    do {
+	digits[n++] = '0' + x % 10;
+	x /= 10;
+    } while(x);
+    while(n) {
+	tty_graphics_buffer[tty_graphics_buffer_len++] = digits[--n];
+    }
+}
+
+/* ESC[38;2;r;g;bm (foreground, code = 38) or ESC[48;2;r;g;bm (background, code = 48) */
+static inline void tty_graphics_put_color(int code, uint32_t rgb) {
+    tty_graphics_reserve(20);
+    tty_graphics_put_string(code == 38 ? "\033[38;2;" : "\033[48;2;");
+    tty_graphics_put_uint((rgb >> 16) & 255);
+    tty_graphics_put_string(";");
+    tty_graphics_put_uint((rgb >> 8) & 255);
+    tty_graphics_put_string(";");
+    tty_graphics_put_uint(rgb & 255);
+    tty_graphics_put_string("m");
+}
+
+static inline void tty_graphics_set_fg(uint32_t rgb) {
+    if(rgb != tty_graphics_cur_fg) {
+	tty_graphics_put_color(38, rgb);
+	tty_graphics_cur_fg = rgb;
+    }
+}
+
+static inline void tty_graphics_set_bg(uint32_t rgb) {
+    if(rgb != tty_graphics_cur_bg) {
+	tty_graphics_put_color(48, rgb);
+	tty_graphics_cur_bg = rgb;
+    }
+}
+
+/* Moves the cursor to character x,y (0-based) */
+static inline void tty_graphics_move(int x, int y) {
+    if(x == tty_graphics_cur_x && y == tty_graphics_cur_y) {
+	return;
+    }
+    tty_graphics_reserve(12);
+    tty_graphics_put_string("\033[");
+    if(y == tty_graphics_cur_y && x > tty_graphics_cur_x) {
+	tty_graphics_put_uint(x - tty_graphics_cur_x);
+	tty_graphics_put_string("C");
+    } else {
+	tty_graphics_put_uint(y+1);
+	tty_graphics_put_string(";");
+	tty_graphics_put_uint(x+1);
+	tty_graphics_put_string("H");
+    }
+    tty_graphics_cur_x = x;
+    tty_graphics_cur_y = y;
+}
+
+static inline void tty_graphics_scan_begin(int width, int height) {
+    /* the program may have changed the colors since the last scan */
+    tty_graphics_cur_fg = TTY_GRAPHICS_NO_COLOR;
+    tty_graphics_cur_bg = TTY_GRAPHICS_NO_COLOR;
+    tty_graphics_reserve(3);
+    tty_graphics_put_string("\033[H");
+    tty_graphics_cur_x = 0;
+    tty_graphics_cur_y = 0;
+#ifdef TTY_GRAPHICS_SHADOW
+    int rows = (height+1)/2;
+    tty_graphics_shadow_use = 
+	(width <= TTY_GRAPHICS_MAX_WIDTH && rows <= TTY_GRAPHICS_MAX_HEIGHT/2);
+    if(
+	tty_graphics_shadow_width  != width ||
+	tty_graphics_shadow_height != height
+    ) {
+	tty_graphics_shadow_width = 0;
+    }
+#endif
+}
+
+/* Character x,y with top pixel rgb1 and bottom pixel rgb2 */
+static inline void tty_graphics_scan_cell(int x, int y, uint32_t rgb1, uint32_t rgb2) {
+#ifdef TTY_GRAPHICS_SHADOW
+    if(tty_graphics_shadow_use) {
+	uint32_t* shadow = tty_graphics_shadow[y][x];
+	if(tty_graphics_shadow_width != 0 && shadow[0] == rgb1 && shadow[1] == rgb2) {
+	    return;
+	}
+	shadow[0] = rgb1;
+	shadow[1] = rgb2;
+    }
+#endif
+    tty_graphics_move(x,y);
+    if(rgb1 == rgb2) {
+	if(rgb1 == tty_graphics_cur_bg) {
+	    tty_graphics_reserve(1);
+	    tty_graphics_put_string(" ");
+	} else if(rgb1 == tty_graphics_cur_fg) {
+	    tty_graphics_reserve(3);
+	    tty_graphics_put_string("\xE2\x96\x88"); // full block
+	} else {
+	    tty_graphics_set_bg(rgb1);
+	    tty_graphics_reserve(1);
+	    tty_graphics_put_string(" ");
+	}
+    } else {
+	tty_graphics_set_bg(rgb1);
+	tty_graphics_set_fg(rgb2);
+	tty_graphics_reserve(3);
+	tty_graphics_put_string("\xE2\x96\x83"); // lower block
+    }
+    ++tty_graphics_cur_x;
+}
+
+/* Leaves the cursor below the image, with a black background and foreground */
+static inline void tty_graphics_scan_end(int width, int height) {
+    tty_graphics_set_fg(0);
+    tty_graphics_set_bg(0);
+    tty_graphics_move(0,(height+1)/2);
+    tty_graphics_flush();
+#ifdef TTY_GRAPHICS_SHADOW
+    if(tty_graphics_shadow_use) {
+	tty_graphics_shadow_width  = width;
+	tty_graphics_shadow_height = height;
+    }
+#endif
+}
+
+/*
+ * #define TTY_GRAPHICS_COLOR_MASK 0xF0 (for instance) before #including 
+ * tty_graphics.h quantizes the color components: neighboring characters
+ * more often have the same colors, and fewer escape sequences are sent.
+ */
+#ifndef TTY_GRAPHICS_COLOR_MASK
+#define TTY_GRAPHICS_COLOR_MASK 0xFF
+#endif
+
+#define tty_graphics_pack_rgb(r,g,b) (                                       \
+    (((uint32_t)(r) & TTY_GRAPHICS_COLOR_MASK) << 16) |                       \
+    (((uint32_t)(g) & TTY_GRAPHICS_COLOR_MASK) << 8)  |                       \
+     ((uint32_t)(b) & TTY_GRAPHICS_COLOR_MASK)                                \
+)
+
 typedef void (*tty_graphics_pixelfunc)(int x, int y, uint8_t* r, uint8_t* g, uint8_t* b);
 typedef void (*tty_graphics_fpixelfunc)(int x, int y, float* r, float* g, float* b);
 
@@ -109,22 +329,23 @@ typedef void (*tty_graphics_fpixelfunc)(int x, int y, float* r, float* g, float*
  * \param[in] width , height dimension of the image in square pixels
  * \param[in] do_pixel the user function to be called for each pixel (a "shader"), that
  *  determines the (integer) components r,g,b of the pixel's color.
- * \details Uses half-charater pixels.
+ * \details Uses half-charater pixels, sends only what changed (see the renderer above).
  */
 static inline void tty_graphics_scan(int width, int height, tty_graphics_pixelfunc do_pixel) {
     uint8_t r1, g1, b1;
     uint8_t r2, g2, b2;
-    tty_graphics_home();
+    tty_graphics_scan_begin(width, height);
     for (int j = 0; j<height; j+=2) { 
 	for (int i = 0; i<width; i++) {
 	    do_pixel(i,j  , &r1, &g1, &b1);
 	    do_pixel(i,j+1, &r2, &g2, &b2);
-	    tty_graphics_draw_two_pixels(r1,g1,b1,r2,g2,b2);
-	    if(i == width-1) {
-		tty_graphics_newline();
-	    }
+	    tty_graphics_scan_cell(
+		i, j/2, tty_graphics_pack_rgb(r1,g1,b1), tty_graphics_pack_rgb(r2,g2,b2)
+	    );
 	}
+	tty_graphics_flush();
     }
+    tty_graphics_scan_end(width, height);
 }
 
 /**
@@ -144,14 +365,14 @@ static inline uint8_t tty_graphics_ftoi(float f) {
  * \param[in] width , height dimension of the image in square pixels
  * \param[in] do_pixel the user function to be called for each pixel (a "shader"), that
  *  determines the (floating-point) components fr,fg,fb of the pixel's color.
- * \details Uses half-charater pixels.
+ * \details Uses half-charater pixels, sends only what changed (see the renderer above).
  */
 static inline void tty_graphics_fscan(int width, int height, tty_graphics_fpixelfunc do_pixel) {
     float fr1, fg1, fb1;
     float fr2, fg2, fb2;
     uint8_t r1, g1, b1;
     uint8_t r2, g2, b2;
-    tty_graphics_home();
+    tty_graphics_scan_begin(width, height);
     for (int j = 0; j<height; j+=2) { 
 	for (int i = 0; i<width; i++) {
 	    do_pixel(i,j  , &fr1, &fg1, &fb1);
@@ -162,12 +383,13 @@ static inline void tty_graphics_fscan(int width, int height, tty_graphics_fpixel
 	    r2 = tty_graphics_ftoi(fr2);
 	    g2 = tty_graphics_ftoi(fg2);
 	    b2 = tty_graphics_ftoi(fb2);	    
-	    tty_graphics_draw_two_pixels(r1,g1,b1,r2,g2,b2);
-	    if(i == width-1) {
-		tty_graphics_newline();
-	    }
+	    tty_graphics_scan_cell(
+		i, j/2, tty_graphics_pack_rgb(r1,g1,b1), tty_graphics_pack_rgb(r2,g2,b2)
+	    );
 	}
+	tty_graphics_flush();
     }
+    tty_graphics_scan_end(width, height);
 }
 
 #endif
@@ -1,3 +1,11 @@
+// Colors with 4 bits per component: about half as many bytes to send
+// (the gradients change everywhere at each frame). On the host, or with
+// enough RAM for it, TTY_GRAPHICS_SHADOW only sends the characters that
+// changed.
+#define TTY_GRAPHICS_COLOR_MASK 0xF0
+#ifdef __linux__
+#define TTY_GRAPHICS_SHADOW
+#endif
 #include "tty_graphics.h"
 #include <math.h>
 
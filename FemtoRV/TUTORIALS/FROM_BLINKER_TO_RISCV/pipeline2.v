@@ -402,8 +402,10 @@ module SOC (
    always @(posedge clk) begin
       if(uart_valid) begin
 //	 $display("UART: %c", IO_mem_wdata[7:0]);
+`ifndef UART_MODEL // UART_MODEL: the output is decoded by sim_main.cpp from TXD
 	 $write("%c", IO_mem_wdata[7:0] );
 	 $fflush(32'h8000_0001);
+`endif
       end
    end
 `endif   
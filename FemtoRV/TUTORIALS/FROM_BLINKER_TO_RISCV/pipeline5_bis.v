@@ -571,8 +571,10 @@ module SOC (
 `ifdef VERBOSE	 
 	 $display("UART: %c", IO_mem_wdata[7:0]);
 `else	 
+`ifndef UART_MODEL // UART_MODEL: the output is decoded by sim_main.cpp from TXD
 	 $write("%c", IO_mem_wdata[7:0] );
 	 $fflush(32'h8000_0001);
+`endif
 `endif	 
       end
    end
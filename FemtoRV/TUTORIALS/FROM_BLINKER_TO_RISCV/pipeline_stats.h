@@ -0,0 +1,162 @@
+// Pipeline hazard analytics for sim_main.cpp (-DPIPELINE_STATS):
+// where do the cycles lost in stalls and flushes come from ?
+// sample() is called once per clock cycle, after the rising edge, with
+// the pipeline control signals of the cores pipeline4.v ... pipelineZ.v
+// (made visible from C++ by pipeline_stats.vlt):
+//  - a data hazard (the instruction in D waits for the one in E) is a
+//    stall cycle, attributed to the stalled instruction (FD_PC), and
+//    classified with the instruction in E: load-use, CSR-use (rdcycle,
+//    rdinstret), load after store (pipeline9 and after), or any other
+//    data hazard (no register forwarding, pipeline4 and pipeline5);
+//  - a stall without data hazard waits for the multi-cycle ALU
+//    (RV32M, pipeline10 and after), attributed to the instruction in E;
+//  - a flush (D_flush: the instruction in E jumps somewhere else than
+//    the instructions fetched after it) costs two bubbles, attributed
+//    to the branch, JAL or JALR in E (DE_PC). The jumps predicted in D
+//    (pipeline7 and after) cost one bubble, that is not a flush, and
+//    that is not counted here.
+// report() writes the breakdown, then the PCs that lose the most cycles
+// for each kind of event, disassembled (riscv_disasm.h) and symbolized
+// with the functions of the ELF executable (pc_profile.h).
+
+#include "pc_profile.h"
+#include "riscv_disasm.h"
+#include <cstdio>
+#include <cstdint>
+#include <map>
+#include <vector>
+#include <algorithm>
+
+class PipelineStats {
+ public:
+   enum Kind {
+      LOAD_USE, CSR_USE, LOAD_AFTER_STORE, DATA_HAZARD, ALU_BUSY,
+      BRANCH_FLUSH, JAL_FLUSH, JALR_FLUSH, NB_KINDS
+   };
+
+   // Number of PCs listed for each kind of event
+   static const size_t TOP_PCS = 8;
+
+   void sample(
+      bool halt, bool data_hazard, bool D_stall, bool D_flush,
+      uint32_t FD_PC, uint32_t FD_instr, uint32_t DE_PC, uint32_t DE_instr
+   ) {
+      ++cycles_;
+      if(halt) {
+	 return;
+      }
+      // When the instruction in E jumps, the one in D is on the wrong
+      // path, and its data hazard does not matter.
+      if(D_flush) {
+	 uint32_t opcode = DE_instr & 0x7F;
+	 Kind kind = opcode == 0x6F ? JAL_FLUSH  :
+	             opcode == 0x67 ? JALR_FLUSH : BRANCH_FLUSH;
+	 add(kind, DE_PC, DE_instr, 2);
+      } else if(data_hazard) {
+	 add(hazard_kind(FD_instr, DE_instr), FD_PC, FD_instr, 1);
+      } else if(D_stall) {
+	 add(ALU_BUSY, DE_PC, DE_instr, 1);
+      }
+   }
+
+   // Returns false if the file cannot be written
+   bool write(const char* filename, const PCProfile& symbols, uint64_t instret) const {
+      FILE* f = fopen(filename, "w");
+      if(f == nullptr) {
+	 return false;
+      }
+      report(f, symbols, instret);
+      fclose(f);
+      return true;
+   }
+
+   void report(FILE* out, const PCProfile& symbols, uint64_t instret) const {
+      uint64_t lost = 0;
+      for(int k=0; k<NB_KINDS; ++k) {
+	 lost += lost_[k];
+      }
+      fprintf(out, "Pipeline hazards\n");
+      fprintf(out, "----------------\n");
+      fprintf(out, "cycles %llu, instret %llu, CPI %.3f, lost cycles %llu (%.1f%%)\n",
+	      (unsigned long long)cycles_, (unsigned long long)instret,
+	      instret == 0 ? 0.0 : double(cycles_)/double(instret),
+	      (unsigned long long)lost, percent(lost, cycles_));
+      fprintf(out, "%-18s %10s %12s %7s %7s\n", "event", "count", "lost cycles", "%cycles", "CPI");
+      for(int k=0; k<NB_KINDS; ++k) {
+	 fprintf(out, "%-18s %10llu %12llu %6.1f%% %7.3f\n", name(k),
+		 (unsigned long long)count_[k], (unsigned long long)lost_[k],
+		 percent(lost_[k], cycles_),
+		 instret == 0 ? 0.0 : double(lost_[k])/double(instret));
+      }
+      for(int k=0; k<NB_KINDS; ++k) {
+	 if(per_pc_[k].empty()) {
+	    continue;
+	 }
+	 std::vector<std::pair<uint32_t, uint64_t> > pcs(per_pc_[k].begin(), per_pc_[k].end());
+	 std::stable_sort(
+	    pcs.begin(), pcs.end(),
+	    [](const std::pair<uint32_t, uint64_t>& a, const std::pair<uint32_t, uint64_t>& b) {
+	       return a.second > b.second;
+	    }
+	 );
+	 fprintf(out, "\n%s: lost cycles per PC\n", name(k));
+	 char text[RISCV_DISASM_MAX];
+	 for(size_t i=0; i<pcs.size() && i<TOP_PCS; ++i) {
+	    riscv_disasm(text, instr_.at(pcs[i].first), pcs[i].first);
+	    fprintf(out, "  0x%08x %10llu %6.1f%%  %-28s %s\n", pcs[i].first,
+		    (unsigned long long)pcs[i].second, percent(pcs[i].second, lost_[k]),
+		    text, symbols.symbol(pcs[i].first).c_str());
+	 }
+      }
+   }
+
+ private:
+   static Kind hazard_kind(uint32_t D_instr, uint32_t E_instr) {
+      uint32_t E_opcode = E_instr & 0x7F;
+      uint32_t D_opcode = D_instr & 0x7F;
+      if(E_opcode == 0x03) {
+	 return LOAD_USE;
+      }
+      if(E_opcode == 0x73 && ((E_instr >> 12) & 7) != 0) {
+	 return CSR_USE;
+      }
+      if(D_opcode == 0x03 && E_opcode == 0x23) {
+	 return LOAD_AFTER_STORE;
+      }
+      return DATA_HAZARD;
+   }
+
+   void add(Kind kind, uint32_t pc, uint32_t instr, uint64_t cycles) {
+      // A stall lasts several cycles: one event, several lost cycles
+      if(kind != last_kind_ || pc != last_pc_ || cycles_ != last_cycle_ + 1 || cycles == 2) {
+	 ++count_[kind];
+      }
+      lost_[kind] += cycles;
+      per_pc_[kind][pc] += cycles;
+      instr_[pc] = instr;
+      last_kind_ = kind;
+      last_pc_ = pc;
+      last_cycle_ = cycles_;
+   }
+
+   static const char* name(int kind) {
+      static const char* names[NB_KINDS] = {
+	 "load-use", "CSR-use", "load after store", "data hazard", "ALU busy",
+	 "branch flush", "JAL flush", "JALR flush"
+      };
+      return names[kind];
+   }
+
+   static double percent(uint64_t x, uint64_t total) {
+      return total == 0 ? 0.0 : (100.0 * double(x)) / double(total);
+   }
+
+   uint64_t cycles_ = 0;
+   uint64_t count_[NB_KINDS] = {};
+   uint64_t lost_[NB_KINDS] = {};
+   std::map<uint32_t, uint64_t> per_pc_[NB_KINDS];
+   std::map<uint32_t, uint32_t> instr_; // last instruction seen at each PC
+   Kind last_kind_ = NB_KINDS;
+   uint32_t last_pc_ = 0;
+   uint64_t last_cycle_ = 0;
+};
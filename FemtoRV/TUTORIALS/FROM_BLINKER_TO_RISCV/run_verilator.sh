@@ -1,6 +1,29 @@
 (cd obj_dir; rm -f *.cpp *.o *.a VSOC)
-verilator -CFLAGS '-I../../../FIRMWARE/LIBFEMTORV32 -DSTANDALONE_FEMTOELF' -DBENCH -DBOARD_FREQ=10 -DCPU_FREQ=10 -DPASSTHROUGH_PLL -Wno-fatal \
-	  --top-module SOC -cc -exe sim_main.cpp ../../FIRMWARE/LIBFEMTORV32/femto_elf.c $1
+# VERILATOR_THREADS=N: multithreaded model (verilator --threads N)
+# SIM_ARGS: options of sim_main.cpp (e.g. SIM_ARGS="--batch 1000")
+# If the second argument is an ELF file, it is loaded directly in RAM
+# (no hex file)
+# The serial line is emulated by sim_main.cpp (uart_model.h)
+UART_MODEL="-DUART_MODEL -DCPU_FREQ=10"
+# PROFILE=N samples the PC every N cycles (needs an ELF file)
+# PIPELINE_STATS=firmware.elf counts the stalls and flushes of the
+# pipelined cores (pipeline4.v and after), per PC of firmware.elf
+case "$2" in
+   *.elf) ELF_LOADER="-DELF_LOADER"; ELF_VLT="sim_main.vlt";;
+esac
+if [ -n "$PROFILE" ]; then
+   ELF_LOADER="$ELF_LOADER -DPROFILER -I../../../femtorv32_systemc"
+   PROFILER_SOURCES="../../femtorv32_systemc/pc_profile.cpp"
+   SIM_ARGS="$SIM_ARGS --profile $PROFILE"
+fi
+if [ -n "$PIPELINE_STATS" ]; then
+   ELF_LOADER="$ELF_LOADER -DPIPELINE_STATS -I../../../femtorv32_systemc"
+   PROFILER_SOURCES="../../femtorv32_systemc/pc_profile.cpp ../../femtorv32_systemc/riscv_disasm.cpp"
+   ELF_VLT="$ELF_VLT pipeline_stats.vlt"
+   SIM_ARGS="$SIM_ARGS --pipeline-stats $PIPELINE_STATS"
+fi
+verilator ${VERILATOR_THREADS:+--threads $VERILATOR_THREADS} -CFLAGS "-I../../../FIRMWARE/LIBFEMTORV32 -DSTANDALONE_FEMTOELF $ELF_LOADER $UART_MODEL" -DBENCH -DUART_MODEL -DBOARD_FREQ=10 -DCPU_FREQ=10 -DPASSTHROUGH_PLL -Wno-fatal \
+	  --top-module SOC -cc -exe sim_main.cpp ../../FIRMWARE/LIBFEMTORV32/femto_elf.c $PROFILER_SOURCES $ELF_VLT $1
 (cd obj_dir; make -f VSOC.mk)
-obj_dir/VSOC $2
+obj_dir/VSOC $2 $SIM_ARGS
 
@@ -1,52 +1,206 @@
 #include "VSOC.h"
 #include "verilated.h"
+#if defined(ELF_LOADER) || defined(PIPELINE_STATS)
+#include "VSOC___024root.h"
+#endif
 #include "femto_elf.h"
+#ifdef UART_MODEL
+#include "uart_model.h"
+#endif
+#ifdef PROFILER
+#include "pc_profile.h"
+#include <string>
+#endif
+#ifdef PIPELINE_STATS
+#include "pipeline_stats.h"
+#include <string>
+#endif
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
 
+// Usage: VSOC [--batch K] [firmware.elf]
+//  firmware.elf: loaded into the RAM of the SOC, instead of the content
+//             initialized by $readmemh() (the model needs to be compiled
+//             with -DELF_LOADER and sim_main.vlt, that makes the RAM
+//             array visible from C++, run_verilator.sh does that when
+//             its second argument is an ELF file).
+// With -DUART_MODEL (run_verilator.sh), the serial line is emulated in
+// C++ (uart_model.h): characters sent on TXD go to stdout, characters
+// typed on stdin are sent to RXD.
+//  --profile N  samples the PC every N cycles, and writes a flat profile to
+//             firmware.elf.prof and a folded-stack file (one frame per
+//             sample, no call stack) to firmware.elf.folded (needs
+//             -DPROFILER and an ELF file, see run_verilator.sh)
+//  --pipeline-stats firmware.elf  counts the cycles lost in stalls and
+//             flushes by the cores pipeline4.v ... pipelineZ.v, per kind
+//             (load-use, data hazard, branch, JAL, JALR ...) and per PC,
+//             symbolized with the functions of firmware.elf (the program
+//             itself comes from PROGROM.hex and DATARAM.hex). The report
+//             is written to stdout and firmware.elf.hazards (needs
+//             -DPIPELINE_STATS and pipeline_stats.vlt, run_verilator.sh
+//             does that when PIPELINE_STATS=firmware.elf is set)
+//  --batch K  simulate K clock cycles between two checks of the LEDs
+//             (default 1: the LEDs are checked after each half clock).
+//             LEDs changes that last less than K cycles are not displayed.
+
+#ifdef UART_MODEL
+// Clock cycles per bit of corescore_emitter_uart (1 Mbaud): its counter
+// goes from CPU_FREQ down to -1
+#ifndef UART_CLOCKS_PER_BIT
+#define UART_CLOCKS_PER_BIT (CPU_FREQ+1)
+#endif
+#define UART_EVAL() uart.eval()
+#else
+#define UART_EVAL()
+#endif
 
 int main(int argc, char** argv, char** env) {
    VSOC top;
    top.CLK = 0;
-   CData prev_LEDS;
-   Elf32Info elf;
-   int elf_status;
-   // void* simulated_RAM = (void*)top.SOC__DOT__RAM__DOT__MEM;
+#ifdef UART_MODEL
+   UARTModel uart(top.TXD, top.RXD, UART_CLOCKS_PER_BIT);
+#endif
+   CData prev_LEDS = 0;
+   unsigned int batch = 1;
+   unsigned long long profile_period = 0;
+   const char* elf_file = nullptr;
+   const char* stats_elf_file = nullptr;
 
    // Call eval() so that readmemh()/initial bocks are executed
    // before anything else.
    top.eval();
 
+   for(int i=1; i<argc; ++i) {
+      if(!strcmp(argv[i],"--batch") && i+1 < argc) {
+	 batch = (unsigned int)strtoul(argv[++i], nullptr, 0);
+      } else if(!strcmp(argv[i],"--profile") && i+1 < argc) {
+	 profile_period = strtoull(argv[++i], nullptr, 0);
+      } else if(!strcmp(argv[i],"--pipeline-stats") && i+1 < argc) {
+	 stats_elf_file = argv[++i];
+      } else {
+	 elf_file = argv[i];
+      }
+   }
+
    // If ELF is specified on command line, load it into
    // simulated RAM. It will overwrite the RAM that was
    // previously initialized with readmemh().
-   /*
-   if(argc > 1) {
-       elf_status = elf32_load_at(argv[1],&elf,simulated_RAM);
-       if(elf_status != ELF32_OK) {
-	   switch(elf_status) {
-	   case ELF32_FILE_NOT_FOUND:
-	       printf("\nNot found\n");
-	       break;
-	   case ELF32_HEADER_SIZE_MISMATCH:
-	       printf("\nELF hdr mismatch\n");
-	       break;
-	   case ELF32_READ_ERROR:
-	       printf("\nRead err\n");
-	       break;
-	   default:
-	       printf("\nUnknown err\n");
-	       break;
-	   }
-	   exit(-1);
-       }
-   }
-   */
+   if(elf_file != nullptr) {
+#ifdef ELF_LOADER
+      void* simulated_RAM = (void*)&top.rootp->SOC__DOT__RAM__DOT__MEM[0];
+      size_t RAM_size = sizeof(top.rootp->SOC__DOT__RAM__DOT__MEM);
+      Elf32Info elf;
+      // Check the size first, elf32_load_at() does not know the size of the RAM
+      int elf_status = elf32_stat(elf_file,&elf);
+      if(elf_status == ELF32_OK && elf.max_address > RAM_size) {
+	 printf("\n%s does not fit in RAM (%d bytes)\n",elf_file,int(RAM_size));
+	 exit(-1);
+      }
+      if(elf_status == ELF32_OK) {
+	 elf_status = elf32_load_at(elf_file,&elf,simulated_RAM);
+      }
+      if(elf_status != ELF32_OK) {
+	 switch(elf_status) {
+	 case ELF32_FILE_NOT_FOUND:
+	    printf("\nNot found\n");
+	    break;
+	 case ELF32_HEADER_SIZE_MISMATCH:
+	    printf("\nELF hdr mismatch\n");
+	    break;
+	 case ELF32_READ_ERROR:
+	    printf("\nRead err\n");
+	    break;
+	 default:
+	    printf("\nUnknown err\n");
+	    break;
+	 }
+	 exit(-1);
+      }
+#else
+      printf("\nCompile with -DELF_LOADER to load ELF files\n");
+      exit(-1);
+#endif
+   }
+
+#ifdef PROFILER
+   PCProfile profile;
+   unsigned long long cycles = 0;
+   if(profile_period != 0) {
+      std::string error;
+      if(elf_file == nullptr || !profile.load_symbols(elf_file,error)) {
+	 printf("\nProfiler: %s\n", elf_file == nullptr ? "needs an ELF file" : error.c_str());
+	 exit(-1);
+      }
+   }
+#define PROFILER_SAMPLE()                                                \
+   if(profile_period != 0 && ++cycles % profile_period == 0) {           \
+      profile.sample(top.rootp->SOC__DOT__CPU__DOT__PC);                 \
+   }
+#else
+   if(profile_period != 0) {
+      printf("\nCompile with -DPROFILER to use --profile\n");
+      exit(-1);
+   }
+#define PROFILER_SAMPLE()
+#endif
+
+#ifdef PIPELINE_STATS
+   PipelineStats pipeline_stats;
+   PCProfile stats_symbols;
+   if(stats_elf_file != nullptr) {
+      std::string error;
+      if(!stats_symbols.load_symbols(stats_elf_file,error)) {
+	 printf("\nPipeline stats: %s\n", error.c_str());
+	 exit(-1);
+      }
+   }
+#define PIPELINE_STATS_SAMPLE()                                         \
+   if(stats_elf_file != nullptr) {                                      \
+      pipeline_stats.sample(                                            \
+	 top.rootp->SOC__DOT__CPU__DOT__halt,                           \
+	 top.rootp->SOC__DOT__CPU__DOT__dataHazard,                     \
+	 top.rootp->SOC__DOT__CPU__DOT__D_stall,                        \
+	 top.rootp->SOC__DOT__CPU__DOT__D_flush,                        \
+	 top.rootp->SOC__DOT__CPU__DOT__FD_PC,                          \
+	 top.rootp->SOC__DOT__CPU__DOT__FD_instr,                       \
+	 top.rootp->SOC__DOT__CPU__DOT__DE_PC,                          \
+	 top.rootp->SOC__DOT__CPU__DOT__DE_instr                        \
+      );                                                                \
+   }
+#else
+   if(stats_elf_file != nullptr) {
+      printf("\nCompile with -DPIPELINE_STATS to use --pipeline-stats\n");
+      exit(-1);
+   }
+#define PIPELINE_STATS_SAMPLE()
+#endif
 
    // Main simulation loop.
    while(!Verilated::gotFinish()) {
-      top.CLK = !top.CLK;
-      top.eval();
+      if(batch <= 1) {
+	 top.CLK = !top.CLK;
+	 top.eval();
+	 if(top.CLK) {
+	    UART_EVAL();
+	    PROFILER_SAMPLE();
+	    PIPELINE_STATS_SAMPLE();
+	 }
+      } else {
+	 for(unsigned int k=0; k<batch && !Verilated::gotFinish(); ++k) {
+	    top.CLK = 1;
+	    top.eval();
+	    UART_EVAL();
+	    PROFILER_SAMPLE();
+	    PIPELINE_STATS_SAMPLE();
+	    top.CLK = 0;
+	    top.eval();
+	 }
+      }
       if(prev_LEDS != top.LEDS) {
+#ifdef UART_MODEL
+	 uart.flush();
+#endif
 	 std::cout << "LEDS: ";
 	 for(int i=0; i<5; ++i) {
 	    std::cout << ((top.LEDS >> (4-i)) & 1);
@@ -55,5 +209,31 @@ int main(int argc, char** argv, char** env) {
       }
       prev_LEDS = top.LEDS;
    }
+#ifdef PROFILER
+   if(profile_period != 0) {
+      std::string flat_file = std::string(elf_file) + ".prof";
+      std::string folded_file = std::string(elf_file) + ".folded";
+      profile.write_flat(flat_file.c_str());
+      profile.write_folded(folded_file.c_str());
+      printf("\nProfile: %s %s\n", flat_file.c_str(), folded_file.c_str());
+   }
+#endif
+#ifdef PIPELINE_STATS
+   if(stats_elf_file != nullptr) {
+#ifdef UART_MODEL
+      uart.flush();
+#endif
+      std::string stats_file = std::string(stats_elf_file) + ".hazards";
+      uint64_t instret = top.rootp->SOC__DOT__CPU__DOT__instret;
+      printf("\n");
+      fflush(stdout);
+      pipeline_stats.report(stdout, stats_symbols, instret);
+      if(!pipeline_stats.write(stats_file.c_str(), stats_symbols, instret)) {
+	 printf("\nPipeline stats: %s cannot be written\n", stats_file.c_str());
+	 exit(-1);
+      }
+      printf("\nPipeline stats: %s\n", stats_file.c_str());
+   }
+#endif
    return 0;
 }
@@ -474,8 +474,10 @@ module SOC (
 `ifdef BENCH
    always @(posedge clk) begin
       if(uart_valid) begin
+`ifndef UART_MODEL // UART_MODEL: the output is decoded by sim_main.cpp from TXD
 	 $write("%c", mem_wdata[7:0] );
 	 $fflush(32'h8000_0001);
+`endif
       end
    end
 `endif   
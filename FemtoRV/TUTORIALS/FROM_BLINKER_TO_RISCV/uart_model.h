@@ -0,0 +1,136 @@
+// C++ model of the serial line of the SOC (8 data bits, no parity,
+// 1 stop bit), for sim_main.cpp:
+//  - decodes the bytes sent on TXD, and writes them to stdout by large
+//    blocks (when the buffer is full, after IDLE_FLUSH cycles without
+//    output, and on exit).
+//  - sends the characters typed on stdin to RXD.
+// eval() is called once per clock cycle, after the rising edge.
+
+#include "verilated.h"
+#include <poll.h>
+#include <unistd.h>
+
+class UARTModel {
+ public:
+   UARTModel(CData& TXD, CData& RXD, unsigned int clocks_per_bit) :
+      TXD_(TXD), RXD_(RXD), clocks_per_bit_(clocks_per_bit) {
+      RXD_ = 1;
+   }
+
+   ~UARTModel() {
+      flush();
+   }
+
+   void eval() {
+      eval_TX();
+      eval_RX();
+   }
+
+   void flush() {
+      if(out_size_ != 0) {
+	 ssize_t written = write(1, out_, out_size_);
+	 (void)written;
+	 out_size_ = 0;
+      }
+   }
+
+ private:
+   // Cycles without output after which the buffer is flushed
+   static const unsigned int IDLE_FLUSH = 1 << 20;
+
+   // Cycles between two polls of stdin
+   static const unsigned int POLL_INTERVAL = 1 << 12;
+
+   void eval_TX() {
+      if(tx_bit_ < 0) {
+	 // Start bit: falling edge of TXD. Sample the bits in their middle.
+	 if(prev_TXD_ && !TXD_) {
+	    tx_bit_ = 0;
+	    tx_count_ = clocks_per_bit_ + clocks_per_bit_/2;
+	    tx_byte_ = 0;
+	 } else if(out_size_ != 0 && ++idle_ >= IDLE_FLUSH) {
+	    flush();
+	 }
+      } else if(--tx_count_ == 0) {
+	 if(tx_bit_ < 8) {
+	    tx_byte_ |= (TXD_ & 1) << tx_bit_;
+	    ++tx_bit_;
+	    tx_count_ = clocks_per_bit_;
+	 } else {
+	    // Stop bit (the byte is discarded if it is not 1)
+	    if(TXD_) {
+	       out_[out_size_++] = char(tx_byte_);
+	       if(out_size_ == sizeof(out_)) {
+		  flush();
+	       }
+	       idle_ = 0;
+	    }
+	    tx_bit_ = -1;
+	 }
+      }
+      prev_TXD_ = TXD_;
+   }
+
+   void eval_RX() {
+      if(rx_count_ != 0) {
+	 --rx_count_;
+	 return;
+      }
+      if(rx_bit_ >= 0) {
+	 // bit 0: start, 1..8: data, 9: stop
+	 if(rx_bit_ == 0) {
+	    RXD_ = 0;
+	 } else if(rx_bit_ <= 8) {
+	    RXD_ = (in_[in_pos_] >> (rx_bit_-1)) & 1;
+	 } else {
+	    RXD_ = 1;
+	 }
+	 rx_count_ = clocks_per_bit_ - 1;
+	 if(++rx_bit_ == 10) {
+	    rx_bit_ = -1;
+	    ++in_pos_;
+	 }
+	 return;
+      }
+      if(in_pos_ == in_size_) {
+	 if(stdin_eof_ || ++poll_count_ < POLL_INTERVAL) {
+	    return;
+	 }
+	 poll_count_ = 0;
+	 struct pollfd fd = { 0, POLLIN, 0 };
+	 if(poll(&fd, 1, 0) <= 0) {
+	    return;
+	 }
+	 ssize_t n = read(0, in_, sizeof(in_));
+	 if(n <= 0) {
+	    stdin_eof_ = true;
+	    return;
+	 }
+	 in_size_ = (unsigned int)n;
+	 in_pos_ = 0;
+      }
+      rx_bit_ = 0;
+   }
+
+   CData& TXD_;
+   CData& RXD_;
+   unsigned int clocks_per_bit_;
+
+   // TX decoder, tx_bit_ = -1 when idle
+   CData prev_TXD_ = 0;
+   int tx_bit_ = -1;
+   unsigned int tx_count_ = 0;
+   unsigned int tx_byte_ = 0;
+   unsigned int idle_ = 0;
+   char out_[65536];
+   unsigned int out_size_ = 0;
+
+   // RX encoder, rx_bit_ = -1 when idle
+   int rx_bit_ = -1;
+   unsigned int rx_count_ = 0;
+   unsigned int poll_count_ = 0;
+   bool stdin_eof_ = false;
+   unsigned char in_[256];
+   unsigned int in_size_ = 0;
+   unsigned int in_pos_ = 0;
+};
@@ -0,0 +1,140 @@
+/*******************************************************************/
+// Trace-driven branch predictor models (see branch_predictor.h)
+/*******************************************************************/
+
+#include "branch_predictor.h"
+#include <cstdlib>
+#include <sstream>
+#include <vector>
+
+static bool parse_unsigned(const std::string& text, unsigned& value) {
+    char* end = nullptr;
+    unsigned long v = strtoul(text.c_str(), &end, 0);
+    value = unsigned(v);
+    return !text.empty() && *end == '\0' && v <= 0xFFFF;
+}
+
+bool PredictorConfig::parse(const std::string& text, std::string& error) {
+    spec = text;
+    std::string scheme_spec = text;
+    size_t plus = text.find('+');
+    ras_depth = 0;
+    if (plus != std::string::npos) {
+        scheme_spec = text.substr(0, plus);
+        std::string ras = text.substr(plus + 1);
+        if (ras.compare(0, 4, "ras:") != 0 || !parse_unsigned(ras.substr(4), ras_depth) ||
+            ras_depth == 0 || ras_depth > MAX_RAS_DEPTH) {
+            error = "invalid return address stack: " + ras + " (ras:1 ... ras:64)";
+            return false;
+        }
+    }
+
+    std::vector<std::string> fields;
+    std::istringstream in(scheme_spec);
+    std::string field;
+    while (std::getline(in, field, ':')) {
+        fields.push_back(field);
+    }
+    index_bits = 0;
+    history_bits = 0;
+    bool ok = !fields.empty();
+    if (ok && fields[0] == "none" && fields.size() == 1) {
+        scheme = SCHEME_NONE;
+        ok = (ras_depth == 0);
+    } else if (ok && fields[0] == "btfnt" && fields.size() == 1) {
+        scheme = SCHEME_BTFNT;
+    } else if (ok && fields[0] == "bimodal" && fields.size() == 2) {
+        scheme = SCHEME_BIMODAL;
+        ok = parse_unsigned(fields[1], index_bits);
+    } else if (ok && fields[0] == "gshare" && fields.size() == 3) {
+        scheme = SCHEME_GSHARE;
+        ok = parse_unsigned(fields[1], index_bits) && parse_unsigned(fields[2], history_bits) &&
+             history_bits >= 1 && history_bits <= index_bits;
+    } else {
+        ok = false;
+    }
+    if (ok && (scheme == SCHEME_BIMODAL || scheme == SCHEME_GSHARE)) {
+        ok = index_bits >= 1 && index_bits <= MAX_INDEX_BITS;
+    }
+    if (!ok) {
+        error = "invalid predictor: " + text +
+                " (none, btfnt, bimodal:N or gshare:N:H, optionally followed by +ras:D)";
+    }
+    return ok;
+}
+
+/*******************************************************************/
+
+PredictorStats simulate_predictor(const PredictorConfig& config, const BranchTrace& trace) {
+    PredictorStats stats;
+    stats.instret = trace.instret;
+
+    bool bht = (config.scheme == SCHEME_BIMODAL || config.scheme == SCHEME_GSHARE);
+    uint32_t index_mask = (1u << config.index_bits) - 1u;
+    uint32_t history_mask = (1u << config.history_bits) - 1u;
+    unsigned history_shift = config.index_bits - config.history_bits;
+    std::vector<uint8_t> BHT(bht ? size_t(1) << config.index_bits : 0, 1); // weakly not taken
+    uint32_t history = 0;
+
+    bool ras = (config.scheme != SCHEME_NONE && config.ras_depth != 0);
+    std::vector<uint32_t> RAS(ras ? config.ras_depth : 1, 0);
+
+    for (const BranchRecord& r : trace.records) {
+        switch (r.kind) {
+            case KIND_BRANCH: {
+                stats.branches++;
+                bool predict = false;
+                if (config.scheme == SCHEME_BTFNT) {
+                    predict = (r.target < r.pc);
+                } else if (bht) {
+                    uint32_t index = ((r.pc >> 2) ^ (history << history_shift)) & index_mask;
+                    uint8_t& counter = BHT[index];
+                    predict = (counter & 2) != 0;
+                    if (r.taken()) {
+                        counter = (counter == 3) ? 3 : counter + 1;
+                    } else {
+                        counter = (counter == 0) ? 0 : counter - 1;
+                    }
+                    if (config.scheme == SCHEME_GSHARE) {
+                        history = ((uint32_t(r.taken()) << (config.history_bits - 1)) | (history >> 1)) &
+                                  history_mask;
+                    }
+                }
+                if (predict != r.taken()) {
+                    stats.branch_misses++;
+                }
+                break;
+            }
+            case KIND_JAL:
+                stats.jals++;
+                if (config.scheme == SCHEME_NONE) {
+                    stats.jal_flushes++;
+                }
+                // Return address stack: push on 'jal ra' (shifts down,
+                // the deepest entry is lost)
+                if (ras && r.rd == 1) {
+                    for (size_t i = RAS.size() - 1; i > 0; i--) {
+                        RAS[i] = RAS[i - 1];
+                    }
+                    RAS[0] = r.pc + r.length();
+                }
+                break;
+            case KIND_JALR:
+                stats.jalrs++;
+                if (!ras || RAS[0] != r.target) {
+                    stats.jalr_misses++;
+                }
+                // Pop on 'jalr x0, 0(ra / t0)' (shifts up, the deepest
+                // entry is kept)
+                if (ras && r.rd == 0 && (r.rs1 == 1 || r.rs1 == 5)) {
+                    for (size_t i = 0; i + 1 < RAS.size(); i++) {
+                        RAS[i] = RAS[i + 1];
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return stats;
+}
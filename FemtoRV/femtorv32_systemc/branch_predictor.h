@@ -0,0 +1,82 @@
+/*******************************************************************/
+// Trace-driven branch predictor models (branch_sim).
+//
+// Replays a control-flow trace (branch_trace.h) through the predictors
+// of the pipeline tutorial (TUTORIALS/FROM_BLINKER_TO_RISCV), with the
+// costs of pipeline9.v and of the SystemC model (femtorv32_pipeline.h):
+// jumps and branches are predicted in D and resolved in E, a correct
+// prediction costs nothing, a misprediction flushes 2 instructions.
+//
+// Specification of a predictor: scheme[+ras:D]
+//  - none:          no prediction (pipeline4.v ... pipeline6.v): every
+//                   taken branch, JAL and JALR flushes;
+//  - btfnt:         backwards taken, forwards not taken (pipeline7.v),
+//                   JAL is predicted in D;
+//  - bimodal:N      BHT of 2^N 2-bits counters indexed by the PC;
+//  - gshare:N:H     same, indexed by PC ^ H bits of global history
+//                   (pipeline8.v, and pipeline9.v with a RAS: the
+//                   default of femtorv32_pipeline.h is gshare:12:9+ras:4);
+//  - +ras:D         return address stack of depth D (pipeline9.v
+//                   CONFIG_RAS): pushed by 'jal ra', popped by
+//                   'jalr x0, 0(ra / t0)', every JALR is predicted with
+//                   its top. Without it, JALR always flushes.
+// The BHT counters start weakly not taken, and are updated as soon as
+// the branch is replayed (the hardware updates them in E, after the
+// next branch may have been predicted).
+//
+// No SystemC dependency.
+/*******************************************************************/
+
+#ifndef BRANCH_PREDICTOR_H
+#define BRANCH_PREDICTOR_H
+
+#include <cstdint>
+#include <string>
+
+#include "branch_trace.h"
+
+enum PredictorScheme {
+    SCHEME_NONE    = 0,
+    SCHEME_BTFNT   = 1,
+    SCHEME_BIMODAL = 2,
+    SCHEME_GSHARE  = 3
+};
+
+struct PredictorConfig {
+    std::string spec;
+    PredictorScheme scheme = SCHEME_NONE;
+    unsigned index_bits = 0;
+    unsigned history_bits = 0;
+    unsigned ras_depth = 0;
+
+    static const unsigned MAX_INDEX_BITS = 24;
+    static const unsigned MAX_RAS_DEPTH = 64;
+
+    // Reads a specification (see above). Returns false and sets 'error'
+    // if it is invalid.
+    bool parse(const std::string& text, std::string& error);
+};
+
+struct PredictorStats {
+    uint64_t instret = 0;
+    uint64_t branches = 0;
+    uint64_t branch_misses = 0;
+    uint64_t jals = 0;
+    uint64_t jal_flushes = 0;           // scheme none only
+    uint64_t jalrs = 0;
+    uint64_t jalr_misses = 0;
+
+    static const unsigned FLUSH_CYCLES = 2;
+
+    uint64_t flushes() const { return branch_misses + jal_flushes + jalr_misses; }
+
+    // CPI of a pipeline whose CPI is base_cpi without the flushes
+    double cpi(double base_cpi) const {
+        return instret == 0 ? 0.0 : base_cpi + double(FLUSH_CYCLES * flushes()) / double(instret);
+    }
+};
+
+// Replays the trace through the predictor
+PredictorStats simulate_predictor(const PredictorConfig& config, const BranchTrace& trace);
+
+#endif // BRANCH_PREDICTOR_H
@@ -0,0 +1,109 @@
+/*******************************************************************/
+// Control-flow traces for the branch predictor simulator.
+/*******************************************************************/
+
+#include "branch_trace.h"
+#include "quark_trace.h"
+#include <cstring>
+
+static_assert(sizeof(BranchRecord) == 12, "BranchRecord must be packed");
+
+bool BranchTraceWriter::open(const char* filename, std::string& error) {
+    file_ = fopen(filename, "wb");
+    if (file_ == nullptr) {
+        error = std::string(filename) + ": cannot be written";
+        return false;
+    }
+    // Written again by close(), with the counts
+    BranchTraceHeader header = {};
+    ok_ = fwrite(&header, sizeof(header), 1, file_) == 1;
+    size_ = 0;
+    count_ = 0;
+    return true;
+}
+
+void BranchTraceWriter::flush() {
+    ok_ = ok_ && fwrite(buffer_, sizeof(BranchRecord), size_, file_) == size_;
+    count_ += size_;
+    size_ = 0;
+}
+
+bool BranchTraceWriter::close(uint64_t instret) {
+    if (file_ == nullptr) {
+        return false;
+    }
+    flush();
+    BranchTraceHeader header = {};
+    memcpy(header.magic, "NRVBRTRC", 8);
+    header.version = BRANCH_TRACE_VERSION;
+    header.count = count_;
+    header.instret = instret;
+    ok_ = ok_ && fseek(file_, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file_) == 1;
+    bool ok = (fclose(file_) == 0) && ok_;
+    file_ = nullptr;
+    return ok;
+}
+
+/*******************************************************************/
+
+static bool read_instruction_trace(FILE* f, const char* filename, BranchTrace& trace, std::string& error) {
+    TraceFileHeader header;
+    if (fread(&header, sizeof(header), 1, f) != 1 || header.version != TRACE_VERSION) {
+        error = std::string(filename) + ": unsupported instruction trace version";
+        return false;
+    }
+    std::vector<TraceRecord> records(header.count);
+    if (fread(records.data(), sizeof(TraceRecord), records.size(), f) != records.size()) {
+        error = std::string(filename) + ": truncated instruction trace";
+        return false;
+    }
+    // The last record has no successor: its branch (if any) is dropped
+    for (size_t i = 0; i + 1 < records.size(); i++) {
+        const TraceRecord& r = records[i];
+        uint32_t opcode = r.instr & 0x7F;
+        if (opcode != 0x63 && opcode != 0x6F && opcode != 0x67) {
+            continue;
+        }
+        BranchRecord b = BranchRecord::make(r.pc, r.instr, 4, records[i + 1].pc);
+        trace.records.push_back(b);
+    }
+    trace.instret = records.empty() ? 0 : records.size() - 1;
+    return true;
+}
+
+bool read_branch_trace(const char* filename, BranchTrace& trace, std::string& error) {
+    FILE* f = fopen(filename, "rb");
+    if (f == nullptr) {
+        error = std::string(filename) + ": not found";
+        return false;
+    }
+    trace.name = filename;
+    trace.records.clear();
+    trace.instret = 0;
+
+    char magic[8];
+    bool ok = fread(magic, sizeof(magic), 1, f) == 1 && fseek(f, 0, SEEK_SET) == 0;
+    if (ok && memcmp(magic, "NRVTRACE", 8) == 0) {
+        ok = read_instruction_trace(f, filename, trace, error);
+    } else if (ok && memcmp(magic, "NRVBRTRC", 8) == 0) {
+        BranchTraceHeader header;
+        ok = fread(&header, sizeof(header), 1, f) == 1;
+        if (!ok || header.version != BRANCH_TRACE_VERSION) {
+            error = std::string(filename) + ": unsupported branch trace version";
+            ok = false;
+        } else {
+            trace.records.resize(size_t(header.count));
+            trace.instret = header.instret;
+            ok = fread(trace.records.data(), sizeof(BranchRecord), trace.records.size(), f) ==
+                 trace.records.size();
+            if (!ok) {
+                error = std::string(filename) + ": truncated branch trace";
+            }
+        }
+    } else {
+        error = std::string(filename) + ": not a branch or instruction trace";
+        ok = false;
+    }
+    fclose(f);
+    return ok;
+}
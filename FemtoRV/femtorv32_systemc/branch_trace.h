@@ -0,0 +1,128 @@
+/*******************************************************************/
+// Control-flow traces for the branch predictor simulator (branch_sim).
+//
+// One BranchRecord per executed conditional branch, JAL and JALR
+// (pc, target, taken, rd and rs1 for the return address stack).
+// Written by the host ISS (FemtoRV32_ISS::branch_trace, see iss_run
+// -b), or extracted from the instruction traces of the SystemC models
+// (quark_trace.h, -DNRV_TRACE) by read_branch_trace().
+//
+// File format (little-endian): BranchTraceHeader, followed by
+// header.count BranchRecords, in execution order.
+//
+// No SystemC dependency.
+/*******************************************************************/
+
+#ifndef BRANCH_TRACE_H
+#define BRANCH_TRACE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+enum BranchKind {
+    KIND_BRANCH = 0,
+    KIND_JAL    = 1,
+    KIND_JALR   = 2
+};
+
+struct BranchRecord {
+    uint32_t pc;       // address of the instruction
+    uint32_t target;   // jump target (taken or not for a branch)
+    uint8_t  kind;     // BranchKind
+    uint8_t  flags;    // BRANCH_TAKEN, BRANCH_COMPRESSED
+    uint8_t  rd;
+    uint8_t  rs1;
+
+    bool taken() const { return (flags & BRANCH_TAKEN) != 0; }
+    uint32_t length() const { return (flags & BRANCH_COMPRESSED) ? 2 : 4; }
+
+    // Record of a branch, JAL or JALR (expanded if compressed, 'length'
+    // is its size in memory) followed by the instruction at next_pc
+    static BranchRecord make(uint32_t pc, uint32_t instr, uint32_t length, uint32_t next_pc) {
+        uint32_t opcode = instr & 0x7F;
+        BranchRecord r;
+        r.pc = pc;
+        r.target = next_pc;
+        r.kind = uint8_t(opcode == 0x63 ? KIND_BRANCH : opcode == 0x6F ? KIND_JAL : KIND_JALR);
+        r.flags = uint8_t((next_pc != pc + length ? BRANCH_TAKEN : 0) |
+                          (length == 2 ? BRANCH_COMPRESSED : 0));
+        r.rd = uint8_t((instr >> 7) & 0x1F);
+        r.rs1 = uint8_t((instr >> 15) & 0x1F);
+        if (opcode == 0x63) {
+            int32_t Bimm = (int32_t(instr & 0x80000000) >> 19) | int32_t((instr & 0x80) << 4) |
+                           int32_t((instr >> 20) & 0x7E0) | int32_t((instr >> 7) & 0x1E);
+            r.target = pc + uint32_t(Bimm);
+        }
+        return r;
+    }
+
+    static const uint8_t BRANCH_TAKEN      = 1;
+    static const uint8_t BRANCH_COMPRESSED = 2;
+};
+
+struct BranchTraceHeader {
+    char     magic[8];  // "NRVBRTRC"
+    uint32_t version;   // BRANCH_TRACE_VERSION
+    uint32_t pad;
+    uint64_t count;     // number of records
+    uint64_t instret;   // number of instructions executed during the trace
+};
+
+static const uint32_t BRANCH_TRACE_VERSION = 1;
+
+// Trace in memory
+struct BranchTrace {
+    std::string name;
+    std::vector<BranchRecord> records;
+    uint64_t instret = 0;
+};
+
+// Reads a branch trace, or an instruction trace of the SystemC models
+// (the branches are extracted, the target of each one is the pc of the
+// next record). Returns false and sets 'error' on failure.
+bool read_branch_trace(const char* filename, BranchTrace& trace, std::string& error);
+
+// Writes the records to a file while the simulator runs
+class BranchTraceWriter {
+public:
+    ~BranchTraceWriter() { close(0); }
+
+    // Returns false and sets 'error' if the file cannot be written
+    bool open(const char* filename, std::string& error);
+
+    // Executed instruction (expanded if compressed, 'length' is its size
+    // in memory) and the address of the next one. Ignores everything but
+    // the conditional branches, JAL and JALR.
+    void record(uint32_t pc, uint32_t instr, uint32_t length, uint32_t next_pc) {
+        uint32_t opcode = instr & 0x7F;
+        if (opcode != 0x63 && opcode != 0x6F && opcode != 0x67) {
+            return;
+        }
+        buffer_[size_++] = BranchRecord::make(pc, instr, length, next_pc);
+        if (size_ == BUFFER_SIZE) {
+            flush();
+        }
+    }
+
+    // Writes the header with the number of executed instructions.
+    // Returns false if the file could not be written.
+    bool close(uint64_t instret);
+
+    bool is_open() const { return file_ != nullptr; }
+    uint64_t count() const { return count_ + size_; }
+
+private:
+    static const size_t BUFFER_SIZE = 4096;
+
+    void flush();
+
+    FILE* file_ = nullptr;
+    BranchRecord buffer_[BUFFER_SIZE];
+    size_t size_ = 0;
+    uint64_t count_ = 0;
+    bool ok_ = true;
+};
+
+#endif // BRANCH_TRACE_H
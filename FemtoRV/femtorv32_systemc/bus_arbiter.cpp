@@ -0,0 +1,84 @@
+#include "bus_arbiter.h"
+#include <iomanip>
+
+BusArbiter::BusArbiter(int nb_masters, ArbiterPolicy policy, std::unique_ptr<MemoryLatency> latency) :
+    masters_(size_t(nb_masters)), policy_(policy), latency_(std::move(latency)) {
+}
+
+bool BusArbiter::parse_policy(const std::string& spec, ArbiterPolicy& policy, std::string& error) {
+    if (spec == "rr") {
+        policy = ARBITER_ROUND_ROBIN;
+        return true;
+    }
+    if (spec == "prio") {
+        policy = ARBITER_PRIORITY;
+        return true;
+    }
+    error = "invalid arbitration policy: " + spec + " (rr, prio)";
+    return false;
+}
+
+const char* BusArbiter::policy_name(ArbiterPolicy policy) {
+    return (policy == ARBITER_ROUND_ROBIN) ? "round-robin" : "fixed priority";
+}
+
+void BusArbiter::request(int master, MemoryAccessType type, uint32_t addr) {
+    if (busy(master)) {
+        return;
+    }
+    Master& m = masters_[size_t(master)];
+    m.pending = true;
+    m.type = type;
+    m.addr = addr;
+}
+
+int BusArbiter::next_master() const {
+    int n = nb_masters();
+    int first = (policy_ == ARBITER_ROUND_ROBIN) ? last_granted_ + 1 : 0;
+    for (int i = 0; i < n; i++) {
+        int master = (first + i) % n;
+        if (masters_[size_t(master)].pending) {
+            return master;
+        }
+    }
+    return -1;
+}
+
+void BusArbiter::clock() {
+    cycles_++;
+    if (remaining_ != 0) {
+        remaining_--;
+        bus_cycles_++;
+        masters_[size_t(owner_)].stats.latency_cycles++;
+    } else {
+        int master = next_master();
+        if (master >= 0) {
+            Master& m = masters_[size_t(master)];
+            m.pending = false;
+            m.stats.grants++;
+            remaining_ = latency_ ? latency_->access(m.type, m.addr) : 0;
+            owner_ = master;
+            last_granted_ = master;
+            bus_cycles_++;
+        }
+    }
+    for (Master& m : masters_) {
+        if (m.pending) {
+            m.stats.arbitration_cycles++;
+        }
+    }
+}
+
+void BusArbiter::print_stats(std::ostream& out) const {
+    out << "Bus: " << policy_name(policy_) << ", "
+        << (latency_ ? latency_->description() : std::string("no wait cycle")) << std::endl;
+    for (int i = 0; i < nb_masters(); i++) {
+        const MasterStats& s = stats(i);
+        out << "  hart " << i << std::setw(12) << s.grants << " accesses "
+            << std::setw(12) << s.arbitration_cycles << " cycles waiting for the bus "
+            << std::setw(12) << s.latency_cycles << " for the memory" << std::endl;
+    }
+    out << "  bus busy " << std::fixed << std::setprecision(1)
+        << (cycles_ ? 100.0 * double(bus_cycles_) / double(cycles_) : 0.0)
+        << std::defaultfloat << "% of the cycles" << std::endl;
+}
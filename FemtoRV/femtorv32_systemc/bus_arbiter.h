@@ -0,0 +1,109 @@
+/*******************************************************************/
+// Shared memory bus of the multi-hart harness.
+//
+// N masters (the pin-level cores) share one memory port. The bus
+// serves one access per cycle, plus the wait cycles of the memory
+// latency model (memory_latency.h), during which it is held by the
+// master of the access. The requests of the other masters are kept
+// pending, and the arbiter holds their mem_rbusy / mem_wbusy high
+// until they are granted:
+//
+//  - rr:   round-robin, the search for the next master starts after
+//          the last one granted;
+//  - prio: fixed priority, master 0 first.
+//
+// Protocol (seen from a master, same as MemoryLatency::clock()): the
+// request is issued in a cycle, request() is called with it at the
+// clock edge that ends the cycle, then clock(), and the master waits
+// while busy() is true. Without contention and without a latency
+// model, the master never waits.
+//
+// No SystemC dependency.
+/*******************************************************************/
+
+#ifndef BUS_ARBITER_H
+#define BUS_ARBITER_H
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "memory_latency.h"
+
+enum ArbiterPolicy {
+    ARBITER_ROUND_ROBIN = 0,
+    ARBITER_PRIORITY    = 1
+};
+
+class BusArbiter {
+public:
+    // latency: null for no wait cycle (one access per cycle)
+    BusArbiter(int nb_masters, ArbiterPolicy policy, std::unique_ptr<MemoryLatency> latency);
+
+    // Parses "rr" or "prio". Returns false and sets 'error' otherwise.
+    static bool parse_policy(const std::string& spec, ArbiterPolicy& policy, std::string& error);
+    static const char* policy_name(ArbiterPolicy policy);
+
+    // Request issued by 'master' in the cycle that ends (ignored while
+    // the master is busy)
+    void request(int master, MemoryAccessType type, uint32_t addr);
+
+    // Clock edge: counts down the access on the bus, or grants the
+    // next pending request
+    void clock();
+
+    // Value of mem_rbusy / mem_wbusy of 'master' for the next cycle
+    bool busy(int master) const {
+        const Master& m = masters_[size_t(master)];
+        return m.pending || (owner_ == master && remaining_ != 0);
+    }
+
+    MemoryAccessType busy_type(int master) const {
+        return masters_[size_t(master)].type;
+    }
+
+    int nb_masters() const {
+        return int(masters_.size());
+    }
+
+    // Statistics
+    struct MasterStats {
+        uint64_t grants = 0;
+        uint64_t arbitration_cycles = 0; // cycles waited for the bus
+        uint64_t latency_cycles = 0;     // wait cycles of the memory
+    };
+    const MasterStats& stats(int master) const {
+        return masters_[size_t(master)].stats;
+    }
+    uint64_t cycles() const { return cycles_; }
+    uint64_t bus_cycles() const { return bus_cycles_; } // cycles with an access on the bus
+
+    const MemoryLatency* latency() const { return latency_.get(); }
+
+    // Policy, latency model, then grants and waits per master, and the
+    // bus utilization
+    void print_stats(std::ostream& out) const;
+
+private:
+    struct Master {
+        bool pending = false;
+        MemoryAccessType type = ACCESS_FETCH;
+        uint32_t addr = 0;
+        MasterStats stats;
+    };
+
+    int next_master() const;
+
+    std::vector<Master> masters_;
+    ArbiterPolicy policy_;
+    std::unique_ptr<MemoryLatency> latency_;
+    int owner_ = -1;          // master of the access on the bus
+    int last_granted_ = -1;
+    uint32_t remaining_ = 0;  // wait cycles left of the access on the bus
+    uint64_t cycles_ = 0;
+    uint64_t bus_cycles_ = 0;
+};
+
+#endif // BUS_ARBITER_H
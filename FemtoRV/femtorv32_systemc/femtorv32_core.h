@@ -0,0 +1,89 @@
+/*******************************************************************/
+// FemtoRV32 - common base of the pin-level SystemC cores
+//
+// The clock, reset and memory interface of femtorv32_quark.v (same
+// port names and types, so that a testbench binds every core the
+// same way), and the performance counters that all the cores fill:
+//
+//  - FemtoRV32_Quark (femtorv32_quark.h, and its native variant),
+//    multi-cycle: stalls are the cycles spent waiting for the memory
+//    or for the shifter, there are no flushes;
+//  - FemtoRV32_Pipeline (femtorv32_pipeline.h), 5 stages: stalls are
+//    the bubbles inserted for the hazards and the cycles frozen by a
+//    busy memory, flushes are the mispredicted jumps and branches.
+//
+// The counters are not the RDCYCLE / RDINSTRET CSRs of the cores:
+// the testbench may clear them, e.g. to measure one region of a
+// program.
+//
+// FemtoRV32_Pins and FemtoRV32_MemoryFunc are the same interface as
+// plain values and a C++ callback, for the cycle-stepping API of the
+// Quark (step(), without the SystemC scheduler).
+/*******************************************************************/
+
+#ifndef FEMTORV32_CORE_H
+#define FEMTORV32_CORE_H
+
+#include <systemc.h>
+#include <cstdint>
+#include <functional>
+
+struct FemtoRV32_PerfCounters {
+    uint64_t cycles = 0;   // clock cycles (out of reset)
+    uint64_t instret = 0;  // retired instructions
+    uint64_t stalls = 0;   // cycles in which no instruction could advance
+    uint64_t flushes = 0;  // times the wrong-path instructions were discarded
+
+    double CPI() const {
+        return instret ? double(cycles) / double(instret) : 0.0;
+    }
+
+    void clear() {
+        *this = FemtoRV32_PerfCounters();
+    }
+};
+
+// Values of the pins of a core driven by step() instead of signals
+struct FemtoRV32_Pins {
+    // Inputs of the core
+    bool     reset = false;      // active low, as the reset port
+    uint32_t mem_rdata = 0;
+    bool     mem_rbusy = false;
+    bool     mem_wbusy = false;
+
+    // Outputs of the core
+    uint32_t mem_addr = 0;
+    uint32_t mem_wdata = 0;
+    uint32_t mem_wmask = 0;
+    bool     mem_rstrb = false;
+};
+
+// Memory of a core driven by step(): called once per cycle, after the
+// outputs of the core settled, it does what the memory process of a
+// testbench does (reads when mem_rstrb, writes when mem_wmask != 0)
+// and sets mem_rdata / mem_rbusy / mem_wbusy for the next rising edge.
+using FemtoRV32_MemoryFunc = std::function<void(FemtoRV32_Pins&)>;
+
+struct FemtoRV32_Core : public sc_module {
+    // Ports
+    sc_in<bool> clk;
+    sc_in<bool> reset;
+
+    // Memory interface (data memory only for the pipelined cores,
+    // they fetch the instructions through their own port)
+    sc_out<sc_uint<32> > mem_addr;
+    sc_out<sc_uint<32> > mem_wdata;
+    sc_out<sc_uint<4> >  mem_wmask;
+    sc_in<sc_uint<32> >  mem_rdata;
+    sc_out<bool>         mem_rstrb;
+    sc_in<bool>          mem_rbusy;
+    sc_in<bool>          mem_wbusy;
+
+    // Performance counters
+    FemtoRV32_PerfCounters perf;
+
+protected:
+    explicit FemtoRV32_Core(const sc_module_name& name) : sc_module(name) {}
+};
+
+#endif // FEMTORV32_CORE_H
@@ -0,0 +1,1276 @@
+/*******************************************************************/
+// FemtoRV32 ISS - host instruction-set simulator (see femtorv32_iss.h)
+/*******************************************************************/
+
+#include "femtorv32_iss.h"
+#include "branch_trace.h"
+#include "memory_latency.h"
+#include "riscv_disasm.h"
+#include "HardwareConfig_bits.h"
+#include "../SIM/FPU_funcs.h"
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <fenv.h>
+#include <poll.h>
+#include <unistd.h>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#define IO_BIT(name) (1u << (2 + IO_##name##_bit))
+
+static const uint32_t HALT = 0x0000006F;   // jal x0, 0 (and c.j 0)
+static const uint32_t EBREAK_INSTR = 0x00100073;
+static const uint32_t ECALL_INSTR  = 0x00000073;
+
+// Reads of UART_DAT between two polls of stdin
+static const unsigned int UART_POLL_INTERVAL = 1 << 12;
+
+// FGA status bits (LIBFEMTOGL/FGA.h)
+static const uint32_t FGA_VBL_bit = 1u << 31;
+
+/*******************************************************************/
+
+static inline uint32_t bits(uint32_t x, int hi, int lo) {
+    return (x >> lo) & ((1u << (hi - lo + 1)) - 1u);
+}
+
+static inline uint32_t load16(const uint8_t* p) {
+    uint16_t v;
+    memcpy(&v, p, 2);
+    return v;
+}
+
+static inline uint32_t load32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+// Instruction encoders, for expand_compressed()
+static inline uint32_t enc_r(uint32_t funct7, uint32_t rs2, uint32_t rs1, uint32_t funct3, uint32_t rd, uint32_t opcode) {
+    return (funct7 << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode;
+}
+
+static inline uint32_t enc_i(int32_t imm, uint32_t rs1, uint32_t funct3, uint32_t rd, uint32_t opcode) {
+    return (uint32_t(imm & 0xFFF) << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode;
+}
+
+static inline uint32_t enc_s(int32_t imm, uint32_t rs2, uint32_t rs1, uint32_t funct3, uint32_t opcode) {
+    return (uint32_t((imm >> 5) & 0x7F) << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) |
+           (uint32_t(imm & 0x1F) << 7) | opcode;
+}
+
+static inline uint32_t enc_b(int32_t imm, uint32_t rs2, uint32_t rs1, uint32_t funct3) {
+    return (uint32_t((imm >> 12) & 1) << 31) | (uint32_t((imm >> 5) & 0x3F) << 25) |
+           (rs2 << 20) | (rs1 << 15) | (funct3 << 12) |
+           (uint32_t((imm >> 1) & 0xF) << 8) | (uint32_t((imm >> 11) & 1) << 7) | 0x63;
+}
+
+static inline uint32_t enc_j(int32_t imm, uint32_t rd) {
+    return (uint32_t((imm >> 20) & 1) << 31) | (uint32_t((imm >> 1) & 0x3FF) << 21) |
+           (uint32_t((imm >> 11) & 1) << 20) | (uint32_t((imm >> 12) & 0xFF) << 12) |
+           (rd << 7) | 0x6F;
+}
+
+// Sign-extends the low 'width' bits of x
+static inline int32_t sext(uint32_t x, int width) {
+    return int32_t(x << (32 - width)) >> (32 - width);
+}
+
+/*******************************************************************/
+
+FemtoRV32_ISS::FemtoRV32_ISS(HarnessMemory& memory, uint32_t reset_addr) :
+    memory(memory),
+    ram_base(memory.data()),
+    ram_size(uint32_t(memory.size())),
+    reset_addr(reset_addr),
+    code_pages((ram_size >> CODE_PAGE_BITS) + 1, 0) {
+    reset();
+}
+
+FemtoRV32_ISS::~FemtoRV32_ISS() {
+    flush_uart();
+}
+
+void FemtoRV32_ISS::reset() {
+    memset(x, 0, sizeof(x));
+    memset(f, 0, sizeof(f));
+    memset(csrs, 0, sizeof(csrs));
+    memset(oled, 0, sizeof(oled));
+    pc = reset_addr;
+    instret = 0;
+    invalidate_blocks();
+}
+
+void FemtoRV32_ISS::invalidate_blocks() {
+    blocks.clear();
+    std::fill(code_pages.begin(), code_pages.end(), 0);
+    invalidate_pending = false;
+}
+
+const char* FemtoRV32_ISS::stop_reason_name(StopReason reason) {
+    switch (reason) {
+        case RUNNING:             return "max instructions reached";
+        case HALTED:              return "halted";
+        case EBREAK:              return "ebreak";
+        case ECALL:               return "ecall";
+        case INVALID_INSTRUCTION: return "invalid instruction";
+        case INVALID_ACCESS:      return "invalid access";
+        case STOPPED:             return "stopped";
+    }
+    return "?";
+}
+
+FemtoRV32_ISS::StopReason FemtoRV32_ISS::run(uint64_t max_instructions) {
+    // Same floating point environment as SIM/sim_main.cpp (per thread),
+    // the one of the caller is restored on return
+    fenv_t caller_env;
+    fegetenv(&caller_env);
+    fesetround(FE_TOWARDZERO);
+#ifdef __SSE__
+    _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+#endif
+    StopReason stop = run_engine(max_instructions);
+    fesetenv(&caller_env);
+    return stop;
+}
+
+FemtoRV32_ISS::StopReason FemtoRV32_ISS::run_engine(uint64_t max_instructions) {
+    StopReason stop = RUNNING;
+    if (!use_blocks || icache != nullptr || dcache != nullptr || instr_trace != nullptr) {
+        for (uint64_t n = 0; n < max_instructions; n++) {
+            if (stop_pending()) {
+                return STOPPED;
+            }
+            if (!step(stop)) {
+                break;
+            }
+        }
+        return stop;
+    }
+
+    uint64_t end = (max_instructions > ~instret) ? ~0ull : instret + max_instructions;
+    Block* block = nullptr; // last executed block
+    while (instret < end) {
+        if (stop_pending()) {
+            return STOPPED;
+        }
+        if (invalidate_pending) {
+            ++nb_invalidations;
+            invalidate_blocks();
+            block = nullptr;
+        }
+        // Chained successor, or cache lookup / translation
+        Block* next = nullptr;
+        int slot = -1;
+        if (block != nullptr) {
+            slot = (pc == block->next_pc[0]) ? 0 : (pc == block->next_pc[1]) ? 1 : -1;
+            if (slot >= 0) {
+                next = block->next[slot];
+            }
+        }
+        if (next == nullptr) {
+            next = find_block(pc);
+            if (next == nullptr) {
+                step(stop); // reports the invalid fetch
+                return stop;
+            }
+            if (slot >= 0) {
+                block->next[slot] = next;
+            }
+        }
+        block = next;
+
+        // Last instructions before max_instructions: one at a time
+        if (block->nb_instructions > end - instret) {
+            while (instret < end) {
+                if (stop_pending()) {
+                    return STOPPED;
+                }
+                if (!step(stop)) {
+                    return stop;
+                }
+            }
+            return RUNNING;
+        }
+
+        const Op* op = block->ops.data();
+        do {
+            op = op->handler(*this, op);
+        } while (op != nullptr);
+        if (block_stop != RUNNING) {
+            stop = block_stop;
+            block_stop = RUNNING;
+            return stop;
+        }
+    }
+    return stop;
+}
+
+/*******************************************************************/
+
+bool FemtoRV32_ISS::fetch(uint32_t addr, uint32_t& instr, uint32_t& length) const {
+    // Fetches 32 bits at once, except for a compressed instruction at
+    // the very end of the RAM
+    if ((addr & 1) == 0 && addr + 4 <= ram_size && addr < ram_size) {
+        instr = load32(ram_base + addr);
+    } else if ((addr & 1) == 0 && addr + 2 == ram_size && (ram_base[addr] & 3) != 3) {
+        instr = load16(ram_base + addr);
+    } else {
+        return false;
+    }
+    if ((instr & 3) != 3) {
+        instr = expand_compressed(instr & 0xFFFF);
+        length = 2;
+    } else {
+        length = 4;
+    }
+    return true;
+}
+
+bool FemtoRV32_ISS::step(StopReason& stop) {
+    uint32_t instr, length;
+    if (!fetch(pc, instr, length)) {
+        fault_addr = pc;
+        stop = INVALID_ACCESS;
+        return false;
+    }
+    if (icache != nullptr) {
+        memory_wait_cycles += icache->access(ACCESS_FETCH, pc);
+    }
+    if (instr_trace != nullptr) {
+        uint32_t instr_pc = pc;
+        bool running = execute(instr, length, stop);
+        trace_instruction(instr_pc, instr);
+        return running;
+    }
+    return execute(instr, length, stop);
+}
+
+static char* put_hex8(char* p, uint32_t x) {
+    static const char HEX[] = "0123456789abcdef";
+    for (int i = 7; i >= 0; i--) {
+        *p++ = HEX[(x >> (4 * i)) & 15];
+    }
+    return p;
+}
+
+void FemtoRV32_ISS::trace_instruction(uint32_t instr_pc, uint32_t instr) {
+    // "pc  instr  disassembly  xN <- value", formatted without printf
+    char line[32 + RISCV_DISASM_MAX + 32];
+    char* p = put_hex8(line, instr_pc);
+    *p++ = ' ';
+    *p++ = ' ';
+    p = put_hex8(p, instr);
+    *p++ = ' ';
+    *p++ = ' ';
+    char* text = p;
+    p += riscv_disasm(text, instr, instr_pc);
+    int dest = riscv_disasm_dest(instr);
+    if (dest >= 0) {
+        while (p < text + 28) {
+            *p++ = ' ';
+        }
+        *p++ = ' ';
+        *p++ = ' ';
+        uint32_t reg = uint32_t(dest) & 31;
+        *p++ = (dest >= 32) ? 'f' : 'x';
+        if (reg >= 10) {
+            *p++ = char('0' + reg / 10);
+        }
+        *p++ = char('0' + reg % 10);
+        memcpy(p, " <- 0x", 6);
+        p = put_hex8(p + 6, (dest >= 32) ? f[reg] : x[reg]);
+    }
+    *p++ = '\n';
+    fwrite(line, 1, size_t(p - line), instr_trace);
+}
+
+bool FemtoRV32_ISS::execute(uint32_t instr, uint32_t length, StopReason& stop) {
+    uint32_t next_pc = pc + length;
+    uint32_t rd     = bits(instr, 11, 7);
+    uint32_t funct3 = bits(instr, 14, 12);
+    uint32_t rs1    = bits(instr, 19, 15);
+    uint32_t rs2    = bits(instr, 24, 20);
+    uint32_t funct7 = bits(instr, 31, 25);
+    int32_t  Iimm   = int32_t(instr) >> 20;
+    int32_t  Simm   = (int32_t(instr & 0xFE000000) >> 20) | int32_t(bits(instr, 11, 7));
+
+    bool ok = true;
+    switch (instr & 0x7F) {
+        case 0x37: // LUI
+            x[rd] = instr & 0xFFFFF000;
+            break;
+
+        case 0x17: // AUIPC
+            x[rd] = pc + (instr & 0xFFFFF000);
+            break;
+
+        case 0x6F: { // JAL
+            if (instr == HALT) {
+                stop = HALTED;
+                return false;
+            }
+            int32_t Jimm = (int32_t(instr & 0x80000000) >> 11) | int32_t(instr & 0xFF000) |
+                           int32_t((instr >> 9) & 0x800) | int32_t((instr >> 20) & 0x7FE);
+            x[rd] = next_pc;
+            next_pc = pc + uint32_t(Jimm);
+            break;
+        }
+
+        case 0x67: { // JALR
+            uint32_t target = (x[rs1] + uint32_t(Iimm)) & ~1u;
+            x[rd] = next_pc;
+            next_pc = target;
+            break;
+        }
+
+        case 0x63: { // Branch
+            int32_t Bimm = (int32_t(instr & 0x80000000) >> 19) | int32_t((instr & 0x80) << 4) |
+                           int32_t((instr >> 20) & 0x7E0) | int32_t((instr >> 7) & 0x1E);
+            uint32_t a = x[rs1], b = x[rs2];
+            bool taken;
+            switch (funct3) {
+                case BRANCH_BEQ:  taken = (a == b); break;
+                case BRANCH_BNE:  taken = (a != b); break;
+                case BRANCH_BLT:  taken = (int32_t(a) < int32_t(b)); break;
+                case BRANCH_BGE:  taken = (int32_t(a) >= int32_t(b)); break;
+                case BRANCH_BLTU: taken = (a < b); break;
+                case BRANCH_BGEU: taken = (a >= b); break;
+                default: ok = false; taken = false; break;
+            }
+            if (taken) {
+                next_pc = pc + uint32_t(Bimm);
+            }
+            break;
+        }
+
+        case 0x03: // Load
+        case 0x07: { // FLW
+            uint32_t addr = x[rs1] + uint32_t(Iimm);
+            uint32_t size = 1u << (funct3 & 3);
+            bool fp = (instr & 0x7F) == 0x07;
+            if ((funct3 & 3) == 3 || (fp && funct3 != LOAD_STORE_WORD) ||
+                ((funct3 & 4) && (funct3 & 3) == LOAD_STORE_WORD)) {
+                ok = false;
+                break;
+            }
+            uint32_t value;
+            if (is_io(addr)) {
+                value = io_read(addr);
+            } else {
+                const uint8_t* m = ram(addr, size);
+                if (m == nullptr) {
+                    fault_addr = addr;
+                    stop = INVALID_ACCESS;
+                    return false;
+                }
+                if (dcache != nullptr) {
+                    memory_wait_cycles += dcache->access(ACCESS_LOAD, addr);
+                }
+                switch (funct3) {
+                    case LOAD_STORE_BYTE:     value = uint32_t(int32_t(int8_t(m[0]))); break;
+                    case LOAD_STORE_HALF:     value = uint32_t(sext(load16(m), 16)); break;
+                    case LOAD_STORE_BYTE | 4: value = m[0]; break;
+                    case LOAD_STORE_HALF | 4: value = load16(m); break;
+                    default:                  value = load32(m); break;
+                }
+            }
+            if (fp) {
+                f[rd] = value;
+            } else {
+                x[rd] = value;
+            }
+            break;
+        }
+
+        case 0x23: // Store
+        case 0x27: { // FSW
+            uint32_t addr = x[rs1] + uint32_t(Simm);
+            bool fp = (instr & 0x7F) == 0x27;
+            if (funct3 > LOAD_STORE_WORD || (fp && funct3 != LOAD_STORE_WORD)) {
+                ok = false;
+                break;
+            }
+            uint32_t value = fp ? f[rs2] : x[rs2];
+            if (is_io(addr)) {
+                io_write(addr, value);
+                break;
+            }
+            uint32_t size = 1u << funct3;
+            uint8_t* m = ram(addr, size);
+            if (m == nullptr) {
+                fault_addr = addr;
+                stop = INVALID_ACCESS;
+                return false;
+            }
+            if (dcache != nullptr) {
+                memory_wait_cycles += dcache->access(ACCESS_STORE, addr);
+            }
+            memcpy(m, &value, size);
+            note_store(addr, size);
+            break;
+        }
+
+        case 0x13: { // ALU immediate
+            uint32_t a = x[rs1];
+            uint32_t shamt = rs2;
+            switch (funct3) {
+                case ALU_ADD_SUB: x[rd] = a + uint32_t(Iimm); break;
+                case ALU_SLT:     x[rd] = int32_t(a) < Iimm; break;
+                case ALU_SLTU:    x[rd] = a < uint32_t(Iimm); break;
+                case ALU_XOR:     x[rd] = a ^ uint32_t(Iimm); break;
+                case ALU_OR:      x[rd] = a | uint32_t(Iimm); break;
+                case ALU_AND:     x[rd] = a & uint32_t(Iimm); break;
+                case ALU_SLL:
+                    ok = (funct7 == 0x00);
+                    x[rd] = a << shamt;
+                    break;
+                case ALU_SRL_SRA:
+                    ok = (funct7 == 0x00 || funct7 == 0x20);
+                    x[rd] = (funct7 == 0x20) ? uint32_t(int32_t(a) >> shamt) : (a >> shamt);
+                    break;
+            }
+            break;
+        }
+
+        case 0x33: { // ALU register
+            uint32_t a = x[rs1], b = x[rs2];
+            if (funct7 == 0x01) { // M extension
+                switch (funct3) {
+                    case 0: x[rd] = a * b; break; // MUL
+                    case 1: x[rd] = uint32_t((int64_t(int32_t(a)) * int64_t(int32_t(b))) >> 32); break;
+                    case 2: x[rd] = uint32_t((int64_t(int32_t(a)) * int64_t(uint64_t(b))) >> 32); break;
+                    case 3: x[rd] = uint32_t((uint64_t(a) * uint64_t(b)) >> 32); break;
+                    case 4: // DIV
+                        if (b == 0) {
+                            x[rd] = 0xFFFFFFFF;
+                        } else if (a == 0x80000000 && b == 0xFFFFFFFF) {
+                            x[rd] = a;
+                        } else {
+                            x[rd] = uint32_t(int32_t(a) / int32_t(b));
+                        }
+                        break;
+                    case 5: x[rd] = (b == 0) ? 0xFFFFFFFF : a / b; break; // DIVU
+                    case 6: // REM
+                        if (b == 0) {
+                            x[rd] = a;
+                        } else if (a == 0x80000000 && b == 0xFFFFFFFF) {
+                            x[rd] = 0;
+                        } else {
+                            x[rd] = uint32_t(int32_t(a) % int32_t(b));
+                        }
+                        break;
+                    case 7: x[rd] = (b == 0) ? a : a % b; break; // REMU
+                }
+                break;
+            }
+            if (funct7 != 0x00 && !(funct7 == 0x20 && (funct3 == ALU_ADD_SUB || funct3 == ALU_SRL_SRA))) {
+                ok = false;
+                break;
+            }
+            switch (funct3) {
+                case ALU_ADD_SUB: x[rd] = (funct7 == 0x20) ? a - b : a + b; break;
+                case ALU_SLL:     x[rd] = a << (b & 31); break;
+                case ALU_SLT:     x[rd] = int32_t(a) < int32_t(b); break;
+                case ALU_SLTU:    x[rd] = a < b; break;
+                case ALU_XOR:     x[rd] = a ^ b; break;
+                case ALU_SRL_SRA:
+                    x[rd] = (funct7 == 0x20) ? uint32_t(int32_t(a) >> (b & 31)) : (a >> (b & 31));
+                    break;
+                case ALU_OR:      x[rd] = a | b; break;
+                case ALU_AND:     x[rd] = a & b; break;
+            }
+            break;
+        }
+
+        case 0x0F: // FENCE, FENCE.I
+            break;
+
+        case 0x73: { // SYSTEM
+            if (instr == EBREAK_INSTR) {
+                stop = EBREAK;
+                return false;
+            }
+            if (instr == ECALL_INSTR) {
+                stop = ECALL;
+                return false;
+            }
+            if (funct3 == 0 || funct3 == 4) {
+                ok = (instr == 0x10500073); // WFI
+                break;
+            }
+            // Zicsr
+            uint32_t csr = instr >> 20;
+            uint32_t src = (funct3 & 4) ? rs1 : x[rs1];
+            uint32_t old = csr_read(csr);
+            uint32_t value = old;
+            switch (funct3 & 3) {
+                case 1: value = src; break;
+                case 2: value = old | src; break;
+                case 3: value = old & ~src; break;
+            }
+            // Counters are read-only, csrrs/csrrc with x0 read only
+            if ((csr & 0xC00) != 0xC00 && ((funct3 & 3) == 1 || rs1 != 0)) {
+                csrs[csr] = value;
+            }
+            x[rd] = old;
+            break;
+        }
+
+        case 0x43: // FMADD
+        case 0x47: // FMSUB
+        case 0x4B: // FNMSUB
+        case 0x4F: { // FNMADD
+            if (bits(instr, 26, 25) != 0) {
+                ok = false;
+                break;
+            }
+            uint32_t rs3 = instr >> 27;
+            switch (instr & 0x7F) {
+                case 0x43: f[rd] = FMADD(f[rs1], f[rs2], f[rs3]); break;
+                case 0x47: f[rd] = FMSUB(f[rs1], f[rs2], f[rs3]); break;
+                case 0x4B: f[rd] = FNMSUB(f[rs1], f[rs2], f[rs3]); break;
+                default:   f[rd] = FNMADD(f[rs1], f[rs2], f[rs3]); break;
+            }
+            break;
+        }
+
+        case 0x53: { // OP-FP (the rounding mode field is ignored)
+            uint32_t a = f[rs1], b = f[rs2];
+            switch (funct7) {
+                case 0x00: f[rd] = FADD(a, b); break;
+                case 0x04: f[rd] = FSUB(a, b); break;
+                case 0x08: f[rd] = FMUL(a, b); break;
+                case 0x0C: f[rd] = FDIV(a, b); break;
+                case 0x2C: f[rd] = FSQRT(a); break;
+                case 0x10:
+                    switch (funct3) {
+                        case 0: f[rd] = FSGNJ(a, b); break;
+                        case 1: f[rd] = FSGNJN(a, b); break;
+                        case 2: f[rd] = FSGNJX(a, b); break;
+                        default: ok = false; break;
+                    }
+                    break;
+                case 0x14:
+                    switch (funct3) {
+                        case 0: f[rd] = FMIN(a, b); break;
+                        case 1: f[rd] = FMAX(a, b); break;
+                        default: ok = false; break;
+                    }
+                    break;
+                case 0x50:
+                    switch (funct3) {
+                        case 0: x[rd] = FLE(a, b); break;
+                        case 1: x[rd] = FLT(a, b); break;
+                        case 2: x[rd] = FEQ(a, b); break;
+                        default: ok = false; break;
+                    }
+                    break;
+                case 0x60:
+                    switch (rs2) {
+                        case 0: x[rd] = FCVTWS(a); break;
+                        case 1: x[rd] = FCVTWUS(a); break;
+                        default: ok = false; break;
+                    }
+                    break;
+                case 0x68:
+                    switch (rs2) {
+                        case 0: f[rd] = FCVTSW(x[rs1]); break;
+                        case 1: f[rd] = FCVTSWU(x[rs1]); break;
+                        default: ok = false; break;
+                    }
+                    break;
+                case 0x70:
+                    switch (funct3) {
+                        case 0: x[rd] = a; break; // FMV.X.W
+                        case 1: x[rd] = FCLASS(a); break;
+                        default: ok = false; break;
+                    }
+                    break;
+                case 0x78: f[rd] = x[rs1]; break; // FMV.W.X
+                default: ok = false; break;
+            }
+            break;
+        }
+
+        default:
+            ok = false;
+            break;
+    }
+
+    if (!ok) {
+        fault_instr = instr;
+        fault_addr = pc;
+        stop = INVALID_INSTRUCTION;
+        return false;
+    }
+    x[0] = 0;
+    if (branch_trace != nullptr) {
+        branch_trace->record(pc, instr, length, next_pc);
+    }
+    pc = next_pc;
+    ++instret;
+    return true;
+}
+
+/*******************************************************************/
+// Block translation engine
+
+// Handlers of the pre-decoded operations. During the execution of a
+// block, instret is the number of instructions retired before the block.
+struct ISSHandlers {
+    typedef FemtoRV32_ISS ISS;
+    typedef ISS::Op Op;
+
+    // Leaves the block before op (op is not executed)
+    static const Op* leave(ISS& iss, const Op* op, uint32_t pc) {
+        iss.pc = pc;
+        iss.instret += op->index;
+        return nullptr;
+    }
+
+    // Leaves the block after op
+    static const Op* leave_after(ISS& iss, const Op* op, uint32_t next_pc) {
+        iss.pc = next_pc;
+        iss.instret += op->index + 1u;
+        return nullptr;
+    }
+
+    static const Op* fault(ISS& iss, const Op* op, uint32_t addr) {
+        iss.fault_addr = addr;
+        iss.block_stop = ISS::INVALID_ACCESS;
+        return leave(iss, op, op->pc);
+    }
+
+    // End of a block that does not end with a jump or branch
+    static const Op* end(ISS& iss, const Op* op) {
+        return leave(iss, op, op->pc);
+    }
+
+    // Instructions without a dedicated handler: switch interpreter
+    static const Op* generic(ISS& iss, const Op* op) {
+        uint64_t instret = iss.instret;
+        iss.pc = op->pc;
+        iss.instret = instret + op->index;
+        ISS::StopReason stop;
+        if (!iss.execute(op->instr, op->length, stop)) {
+            iss.block_stop = stop;
+            return nullptr;
+        }
+        if (iss.invalidate_pending) {
+            return nullptr; // pc and instret are after the instruction
+        }
+        iss.instret = instret;
+        return op + 1;
+    }
+
+    static const Op* nop(ISS&, const Op* op) {
+        return op + 1;
+    }
+
+    // LUI and AUIPC (the value is resolved at translation)
+    static const Op* li(ISS& iss, const Op* op) {
+        iss.x[op->rd] = uint32_t(op->imm);
+        return op + 1;
+    }
+
+#define ISS_ALU_IMM(name, expr)                                  \
+    static const Op* name(ISS& iss, const Op* op) {              \
+        uint32_t a = iss.x[op->rs1];                             \
+        uint32_t b = uint32_t(op->imm);                          \
+        iss.x[op->rd] = (expr);                                  \
+        return op + 1;                                           \
+    }
+
+#define ISS_ALU_REG(name, expr)                                  \
+    static const Op* name(ISS& iss, const Op* op) {              \
+        uint32_t a = iss.x[op->rs1];                             \
+        uint32_t b = iss.x[op->rs2];                             \
+        iss.x[op->rd] = (expr);                                  \
+        return op + 1;                                           \
+    }
+
+    ISS_ALU_IMM(addi,  a + b)
+    ISS_ALU_IMM(slti,  int32_t(a) < int32_t(b))
+    ISS_ALU_IMM(sltiu, a < b)
+    ISS_ALU_IMM(xori,  a ^ b)
+    ISS_ALU_IMM(ori,   a | b)
+    ISS_ALU_IMM(andi,  a & b)
+    ISS_ALU_IMM(slli,  a << b)
+    ISS_ALU_IMM(srli,  a >> b)
+    ISS_ALU_IMM(srai,  uint32_t(int32_t(a) >> b))
+
+    ISS_ALU_REG(add,  a + b)
+    ISS_ALU_REG(sub,  a - b)
+    ISS_ALU_REG(sll,  a << (b & 31))
+    ISS_ALU_REG(slt,  int32_t(a) < int32_t(b))
+    ISS_ALU_REG(sltu, a < b)
+    ISS_ALU_REG(xor_, a ^ b)
+    ISS_ALU_REG(srl,  a >> (b & 31))
+    ISS_ALU_REG(sra,  uint32_t(int32_t(a) >> (b & 31)))
+    ISS_ALU_REG(or_,  a | b)
+    ISS_ALU_REG(and_, a & b)
+    ISS_ALU_REG(mul,  a * b)
+
+#undef ISS_ALU_IMM
+#undef ISS_ALU_REG
+
+#define ISS_LOAD(name, size, expr)                               \
+    static const Op* name(ISS& iss, const Op* op) {              \
+        uint32_t addr = iss.x[op->rs1] + uint32_t(op->imm);      \
+        uint32_t value;                                          \
+        if (ISS::is_io(addr)) {                                  \
+            value = iss.io_read(addr);                           \
+        } else {                                                 \
+            const uint8_t* m = iss.ram(addr, size);              \
+            if (m == nullptr) {                                  \
+                return fault(iss, op, addr);                     \
+            }                                                    \
+            value = (expr);                                      \
+        }                                                        \
+        iss.x[op->rd] = value;                                   \
+        iss.x[0] = 0;                                            \
+        return op + 1;                                           \
+    }
+
+    ISS_LOAD(lb,  1, uint32_t(int32_t(int8_t(m[0]))))
+    ISS_LOAD(lh,  2, uint32_t(sext(load16(m), 16)))
+    ISS_LOAD(lw,  4, load32(m))
+    ISS_LOAD(lbu, 1, m[0])
+    ISS_LOAD(lhu, 2, load16(m))
+
+#undef ISS_LOAD
+
+    // Stores leave the block if they modify translated code
+    template <uint32_t size> static const Op* store(ISS& iss, const Op* op) {
+        uint32_t addr = iss.x[op->rs1] + uint32_t(op->imm);
+        uint32_t value = iss.x[op->rs2];
+        if (ISS::is_io(addr)) {
+            iss.io_write(addr, value);
+            return op + 1;
+        }
+        uint8_t* m = iss.ram(addr, size);
+        if (m == nullptr) {
+            return fault(iss, op, addr);
+        }
+        memcpy(m, &value, size);
+        iss.note_store(addr, size);
+        if (iss.invalidate_pending) {
+            return leave_after(iss, op, op->pc + op->length);
+        }
+        return op + 1;
+    }
+
+    // Leaves the block after a jump or branch to next_pc
+    static const Op* jump(ISS& iss, const Op* op, uint32_t next_pc) {
+        if (iss.branch_trace != nullptr) {
+            iss.branch_trace->record(op->pc, op->instr, op->length, next_pc);
+        }
+        return leave_after(iss, op, next_pc);
+    }
+
+    static const Op* jal(ISS& iss, const Op* op) {
+        iss.x[op->rd] = op->pc + op->length;
+        iss.x[0] = 0;
+        return jump(iss, op, uint32_t(op->imm));
+    }
+
+    static const Op* jalr(ISS& iss, const Op* op) {
+        uint32_t target = (iss.x[op->rs1] + uint32_t(op->imm)) & ~1u;
+        iss.x[op->rd] = op->pc + op->length;
+        iss.x[0] = 0;
+        return jump(iss, op, target);
+    }
+
+#define ISS_BRANCH(name, cond)                                   \
+    static const Op* name(ISS& iss, const Op* op) {              \
+        uint32_t a = iss.x[op->rs1];                             \
+        uint32_t b = iss.x[op->rs2];                             \
+        return jump(iss, op, (cond) ? uint32_t(op->imm) : op->pc + op->length); \
+    }
+
+    ISS_BRANCH(beq,  a == b)
+    ISS_BRANCH(bne,  a != b)
+    ISS_BRANCH(blt,  int32_t(a) < int32_t(b))
+    ISS_BRANCH(bge,  int32_t(a) >= int32_t(b))
+    ISS_BRANCH(bltu, a < b)
+    ISS_BRANCH(bgeu, a >= b)
+
+#undef ISS_BRANCH
+};
+
+FemtoRV32_ISS::Op FemtoRV32_ISS::decode(uint32_t instr, uint32_t pc, uint32_t length, Block& block, bool& last) {
+    typedef ISSHandlers H;
+    Op op;
+    op.handler = H::generic;
+    op.instr   = instr;
+    op.pc      = pc;
+    op.imm     = 0;
+    op.rd      = uint8_t(bits(instr, 11, 7));
+    op.rs1     = uint8_t(bits(instr, 19, 15));
+    op.rs2     = uint8_t(bits(instr, 24, 20));
+    op.length  = uint8_t(length);
+    op.index   = uint16_t(block.ops.size());
+
+    uint32_t funct3 = bits(instr, 14, 12);
+    uint32_t funct7 = bits(instr, 31, 25);
+    int32_t  Iimm   = int32_t(instr) >> 20;
+    int32_t  Simm   = (int32_t(instr & 0xFE000000) >> 20) | int32_t(bits(instr, 11, 7));
+
+    switch (instr & 0x7F) {
+        case 0x37: // LUI
+        case 0x17: // AUIPC
+            op.imm = int32_t((instr & 0xFFFFF000) + (((instr & 0x7F) == 0x17) ? pc : 0));
+            op.handler = (op.rd == 0) ? H::nop : H::li;
+            break;
+
+        case 0x13: { // ALU immediate
+            static const Handler handlers[8] = {
+                H::addi, H::slli, H::slti, H::sltiu, H::xori, H::srli, H::ori, H::andi
+            };
+            op.imm = Iimm;
+            if (funct3 == ALU_SLL || funct3 == ALU_SRL_SRA) {
+                op.imm = int32_t(op.rs2);
+                if (funct7 != 0x00 && !(funct3 == ALU_SRL_SRA && funct7 == 0x20)) {
+                    break; // invalid: reported by the interpreter
+                }
+            }
+            op.handler = (funct3 == ALU_SRL_SRA && funct7 == 0x20) ? H::srai : handlers[funct3];
+            if (op.rd == 0) {
+                op.handler = H::nop;
+            }
+            break;
+        }
+
+        case 0x33: { // ALU register
+            static const Handler handlers[8] = {
+                H::add, H::sll, H::slt, H::sltu, H::xor_, H::srl, H::or_, H::and_
+            };
+            if (funct7 == 0x00) {
+                op.handler = handlers[funct3];
+            } else if (funct7 == 0x20 && funct3 == ALU_ADD_SUB) {
+                op.handler = H::sub;
+            } else if (funct7 == 0x20 && funct3 == ALU_SRL_SRA) {
+                op.handler = H::sra;
+            } else if (funct7 == 0x01 && funct3 == 0) {
+                op.handler = H::mul;
+            } else {
+                break; // other M instructions, or invalid
+            }
+            if (op.rd == 0) {
+                op.handler = H::nop;
+            }
+            break;
+        }
+
+        case 0x03: { // Load
+            static const Handler handlers[8] = {
+                H::lb, H::lh, H::lw, nullptr, H::lbu, H::lhu, nullptr, nullptr
+            };
+            op.imm = Iimm;
+            if (handlers[funct3] != nullptr) {
+                op.handler = handlers[funct3];
+            }
+            break;
+        }
+
+        case 0x23: { // Store
+            static const Handler handlers[8] = {
+                H::store<1>, H::store<2>, H::store<4>, nullptr, nullptr, nullptr, nullptr, nullptr
+            };
+            op.imm = Simm;
+            if (handlers[funct3] != nullptr) {
+                op.handler = handlers[funct3];
+            }
+            break;
+        }
+
+        case 0x6F: { // JAL (the halt loop is left to the interpreter)
+            last = true;
+            if (instr == HALT) {
+                break;
+            }
+            int32_t Jimm = (int32_t(instr & 0x80000000) >> 11) | int32_t(instr & 0xFF000) |
+                           int32_t((instr >> 9) & 0x800) | int32_t((instr >> 20) & 0x7FE);
+            op.imm = int32_t(pc + uint32_t(Jimm));
+            op.handler = H::jal;
+            block.next_pc[0] = uint32_t(op.imm);
+            break;
+        }
+
+        case 0x67: // JALR
+            last = true;
+            op.imm = Iimm;
+            op.handler = H::jalr;
+            break;
+
+        case 0x63: { // Branch
+            static const Handler handlers[8] = {
+                H::beq, H::bne, nullptr, nullptr, H::blt, H::bge, H::bltu, H::bgeu
+            };
+            last = true;
+            int32_t Bimm = (int32_t(instr & 0x80000000) >> 19) | int32_t((instr & 0x80) << 4) |
+                           int32_t((instr >> 20) & 0x7E0) | int32_t((instr >> 7) & 0x1E);
+            op.imm = int32_t(pc + uint32_t(Bimm));
+            if (handlers[funct3] != nullptr) {
+                op.handler = handlers[funct3];
+                block.next_pc[0] = uint32_t(op.imm);
+                block.next_pc[1] = pc + length;
+            }
+            break;
+        }
+
+        default: // F extension, SYSTEM, FENCE: interpreter
+            break;
+    }
+    return op;
+}
+
+FemtoRV32_ISS::Block* FemtoRV32_ISS::find_block(uint32_t pc) {
+    auto it = blocks.find(pc);
+    if (it != blocks.end()) {
+        return it->second.get();
+    }
+
+    std::unique_ptr<Block> block(new Block);
+    block->next_pc[0] = block->next_pc[1] = ~0u;
+    block->next[0] = block->next[1] = nullptr;
+    uint32_t addr = pc;
+    bool last = false;
+    while (!last && block->ops.size() < size_t(MAX_BLOCK_INSTRUCTIONS)) {
+        uint32_t instr, length;
+        if (!fetch(addr, instr, length)) {
+            break;
+        }
+        block->ops.push_back(decode(instr, addr, length, *block, last));
+        addr += length;
+    }
+    if (block->ops.empty()) {
+        return nullptr;
+    }
+    block->nb_instructions = uint32_t(block->ops.size());
+    if (!last) {
+        // Falls through to the next block
+        Op op;
+        memset(&op, 0, sizeof(op));
+        op.handler = ISSHandlers::end;
+        op.pc = addr;
+        op.index = uint16_t(block->ops.size());
+        block->ops.push_back(op);
+        block->next_pc[0] = addr;
+    }
+    for (uint32_t page = pc >> CODE_PAGE_BITS; page <= (addr - 1) >> CODE_PAGE_BITS; page++) {
+        code_pages[page] = 1;
+    }
+    ++nb_translated_blocks;
+    Block* result = block.get();
+    blocks[pc] = std::move(block);
+    return result;
+}
+
+/*******************************************************************/
+
+uint32_t FemtoRV32_ISS::expand_compressed(uint32_t c) {
+    uint32_t funct3 = bits(c, 15, 13);
+    uint32_t rd     = bits(c, 11, 7);   // also rs1
+    uint32_t rs2    = bits(c, 6, 2);
+    uint32_t rdp    = 8 + bits(c, 4, 2); // rd' / rs2'
+    uint32_t rs1p   = 8 + bits(c, 9, 7);
+    int32_t  imm6   = sext((bits(c, 12, 12) << 5) | bits(c, 6, 2), 6);
+
+    switch (c & 3) {
+        case 0: {
+            // offsets of C.LW/C.SW/C.FLW/C.FSW: uimm[5:3] = 12:10, [2] = 6, [6] = 5
+            int32_t lsimm = int32_t((bits(c, 12, 10) << 3) | (bits(c, 6, 6) << 2) | (bits(c, 5, 5) << 6));
+            switch (funct3) {
+                case 0: { // C.ADDI4SPN
+                    int32_t imm = int32_t((bits(c, 12, 11) << 4) | (bits(c, 10, 7) << 6) |
+                                          (bits(c, 6, 6) << 2) | (bits(c, 5, 5) << 3));
+                    return (imm == 0) ? 0 : enc_i(imm, 2, 0, rdp, 0x13);
+                }
+                case 2: return enc_i(lsimm, rs1p, 2, rdp, 0x03);      // C.LW
+                case 3: return enc_i(lsimm, rs1p, 2, rdp, 0x07);      // C.FLW
+                case 6: return enc_s(lsimm, rdp, rs1p, 2, 0x23);      // C.SW
+                case 7: return enc_s(lsimm, rdp, rs1p, 2, 0x27);      // C.FSW
+                default: return 0;
+            }
+        }
+        case 1:
+            switch (funct3) {
+                case 0: return enc_i(imm6, rd, 0, rd, 0x13);          // C.ADDI, C.NOP
+                case 1:                                               // C.JAL
+                case 5: {                                             // C.J
+                    // imm[11|4|9:8|10|6|7|3:1|5] = 12..2
+                    int32_t imm = sext((bits(c, 12, 12) << 11) | (bits(c, 11, 11) << 4) |
+                                       (bits(c, 10, 9) << 8) | (bits(c, 8, 8) << 10) |
+                                       (bits(c, 7, 7) << 6) | (bits(c, 6, 6) << 7) |
+                                       (bits(c, 5, 3) << 1) | (bits(c, 2, 2) << 5), 12);
+                    return enc_j(imm, funct3 == 1 ? 1 : 0);
+                }
+                case 2: return enc_i(imm6, 0, 0, rd, 0x13);           // C.LI
+                case 3:
+                    if (rd == 2) {                                    // C.ADDI16SP
+                        int32_t imm = sext((bits(c, 12, 12) << 9) | (bits(c, 6, 6) << 4) |
+                                           (bits(c, 5, 5) << 6) | (bits(c, 4, 3) << 7) |
+                                           (bits(c, 2, 2) << 5), 10);
+                        return (imm == 0) ? 0 : enc_i(imm, 2, 0, 2, 0x13);
+                    }
+                    // C.LUI
+                    return (imm6 == 0) ? 0 : ((uint32_t(imm6) << 12) | (rd << 7) | 0x37);
+                case 4:
+                    switch (bits(c, 11, 10)) {
+                        case 0: // C.SRLI
+                            return bits(c, 12, 12) ? 0 : enc_i(int32_t(rs2), rs1p, 5, rs1p, 0x13);
+                        case 1: // C.SRAI
+                            return bits(c, 12, 12) ? 0 : enc_i(int32_t(rs2 | 0x400), rs1p, 5, rs1p, 0x13);
+                        case 2: // C.ANDI
+                            return enc_i(imm6, rs1p, 7, rs1p, 0x13);
+                        default: {
+                            static const uint32_t funct3s[4] = { 0, 4, 6, 7 }; // SUB XOR OR AND
+                            if (bits(c, 12, 12)) {
+                                return 0;
+                            }
+                            uint32_t op = bits(c, 6, 5);
+                            return enc_r(op == 0 ? 0x20 : 0x00, rdp, rs1p, funct3s[op], rs1p, 0x33);
+                        }
+                    }
+                case 6:   // C.BEQZ
+                case 7: { // C.BNEZ
+                    // offset[8|4:3] = 12:10, [7:6|2:1|5] = 6:2
+                    int32_t imm = sext((bits(c, 12, 12) << 8) | (bits(c, 11, 10) << 3) |
+                                       (bits(c, 6, 5) << 6) | (bits(c, 4, 3) << 1) |
+                                       (bits(c, 2, 2) << 5), 9);
+                    return enc_b(imm, 0, rs1p, funct3 == 6 ? BRANCH_BEQ : BRANCH_BNE);
+                }
+            }
+            return 0;
+        case 2: {
+            // offsets of C.LWSP/C.FLWSP: uimm[5] = 12, [4:2] = 6:4, [7:6] = 3:2
+            int32_t lwsp = int32_t((bits(c, 12, 12) << 5) | (bits(c, 6, 4) << 2) | (bits(c, 3, 2) << 6));
+            // offsets of C.SWSP/C.FSWSP: uimm[5:2] = 12:9, [7:6] = 8:7
+            int32_t swsp = int32_t((bits(c, 12, 9) << 2) | (bits(c, 8, 7) << 6));
+            switch (funct3) {
+                case 0: // C.SLLI
+                    return bits(c, 12, 12) ? 0 : enc_i(int32_t(rs2), rd, 1, rd, 0x13);
+                case 2: return (rd == 0) ? 0 : enc_i(lwsp, 2, 2, rd, 0x03);   // C.LWSP
+                case 3: return enc_i(lwsp, 2, 2, rd, 0x07);                   // C.FLWSP
+                case 4:
+                    if (!bits(c, 12, 12)) {
+                        if (rs2 == 0) {                                       // C.JR
+                            return (rd == 0) ? 0 : enc_i(0, rd, 0, 0, 0x67);
+                        }
+                        return enc_r(0, rs2, 0, 0, rd, 0x33);                 // C.MV
+                    }
+                    if (rs2 == 0) {
+                        return (rd == 0) ? EBREAK_INSTR                       // C.EBREAK
+                                         : enc_i(0, rd, 0, 1, 0x67);          // C.JALR
+                    }
+                    return enc_r(0, rs2, rd, 0, rd, 0x33);                    // C.ADD
+                case 6: return enc_s(swsp, rs2, 2, 2, 0x23);                  // C.SWSP
+                case 7: return enc_s(swsp, rs2, 2, 2, 0x27);                  // C.FSWSP
+                default: return 0;
+            }
+        }
+    }
+    return 0;
+}
+
+/*******************************************************************/
+
+uint32_t FemtoRV32_ISS::csr_read(uint32_t csr) {
+    switch (csr) {
+        case 0xC00: // cycle
+        case 0xC01: // time
+        case 0xC02: // instret
+            return uint32_t(instret);
+        case 0xC80: // cycleh
+        case 0xC81: // timeh
+        case 0xC82: // instreth
+            return uint32_t(instret >> 32);
+        default:
+            return csrs[csr];
+    }
+}
+
+uint32_t FemtoRV32_ISS::io_read(uint32_t addr) {
+    if (addr & IO_BIT(UART_DAT)) {
+        int c = uart_getchar();
+        return (c < 0) ? 0 : (uint32_t(c) | 256);
+    }
+    if (addr & IO_BIT(LEDS)) {
+        return leds;
+    }
+    if (addr & IO_BIT(FGA_CNTL)) {
+        return FGA_VBL_bit;
+    }
+    if (addr & IO_BIT(HW_CONFIG_RAM)) {
+        return ram_size;
+    }
+    if (addr & IO_BIT(HW_CONFIG_DEVICES)) {
+        return (1u << IO_LEDS_bit) | (1u << IO_UART_DAT_bit) |
+               (1u << IO_SSD1351_CNTL_bit) | (1u << IO_SSD1351_CMD_bit) |
+               (1u << IO_SSD1351_DAT_bit) | (1u << IO_SSD1351_DAT16_bit);
+    }
+    if (addr & IO_BIT(HW_CONFIG_CPUINFO)) {
+        // M, F and C extensions (FEMTORV32_CPUINFO_*_bit), 64-bit counters
+        return (freq_MHz << 16) | (7 << 8) | 64;
+    }
+    return 0;
+}
+
+void FemtoRV32_ISS::io_write(uint32_t addr, uint32_t data) {
+    // The IO page is one-hot decoded: a write can select several devices
+    // (e.g. IO_GFX_DAT = IO_SSD1351_DAT16 | IO_FGA_DAT)
+    if (addr & IO_BIT(LEDS)) {
+        leds = data;
+        if (host_io != nullptr) {
+            host_io->leds_output(leds);
+        }
+        if (print_leds) {
+            flush_uart();
+            fprintf(stderr, "LEDS: 0x%x\n", leds);
+        }
+    }
+    if (addr & IO_BIT(UART_DAT)) {
+        uart_putchar(uint8_t(data));
+    }
+    if (addr & IO_BIT(SSD1351_CMD)) {
+        oled_command(uint8_t(data));
+    }
+    if (addr & IO_BIT(SSD1351_DAT)) {
+        oled_data(uint8_t(data));
+    }
+    if (addr & IO_BIT(SSD1351_DAT16)) {
+        oled_pixel(uint16_t(data));
+    }
+    if (addr & (IO_BIT(FGA_CNTL) | IO_BIT(FGA_DAT))) {
+        ++fga_writes;
+    }
+}
+
+/*******************************************************************/
+
+void FemtoRV32_ISS::uart_putchar(uint8_t c) {
+    if (host_io != nullptr) {
+        host_io->uart_output(c);
+        return;
+    }
+    if (quiet_uart) {
+        return;
+    }
+    uart_out[uart_out_size++] = char(c);
+    if (uart_out_size == sizeof(uart_out)) {
+        flush_uart();
+    }
+}
+
+void FemtoRV32_ISS::flush_uart() {
+    if (uart_out_size != 0) {
+        ssize_t written = write(1, uart_out, uart_out_size);
+        (void)written;
+        uart_out_size = 0;
+    }
+}
+
+int FemtoRV32_ISS::uart_getchar() {
+    if (host_io != nullptr) {
+        return host_io->uart_input();
+    }
+    if (uart_in_pos == uart_in_size) {
+        if (uart_eof || ++uart_poll_count < UART_POLL_INTERVAL) {
+            return -1;
+        }
+        uart_poll_count = 0;
+        // The firmware may be waiting for an answer to what it printed
+        flush_uart();
+        struct pollfd fd = { 0, POLLIN, 0 };
+        if (poll(&fd, 1, 0) <= 0) {
+            return -1;
+        }
+        ssize_t n = read(0, uart_in, sizeof(uart_in));
+        if (n <= 0) {
+            uart_eof = true;
+            return -1;
+        }
+        uart_in_size = size_t(n);
+        uart_in_pos = 0;
+    }
+    return uart_in[uart_in_pos++];
+}
+
+/*******************************************************************/
+
+void FemtoRV32_ISS::oled_command(uint8_t cmd) {
+    oled_cmd = cmd;
+    oled_nb_args = 0;
+    oled_write_ram = (cmd == 0x5C);
+    oled_half_pixel = false;
+}
+
+void FemtoRV32_ISS::oled_data(uint8_t data) {
+    if (oled_write_ram) {
+        // 8-bit pixel data: high byte first
+        if (!oled_half_pixel) {
+            oled_high = data;
+            oled_half_pixel = true;
+        } else {
+            oled_half_pixel = false;
+            oled_pixel(uint16_t((oled_high << 8) | data));
+        }
+        return;
+    }
+    if (oled_nb_args < 2) {
+        oled_args[oled_nb_args++] = data;
+    }
+    if (oled_cmd == 0x15 && oled_nb_args == 2) {
+        oled_x1 = oled_args[0] & 127;
+        oled_x2 = oled_args[1] & 127;
+        oled_x = oled_x1;
+    } else if (oled_cmd == 0x75 && oled_nb_args == 2) {
+        oled_y1 = oled_args[0] & 127;
+        oled_y2 = oled_args[1] & 127;
+        oled_y = oled_y1;
+    } else if (oled_cmd == 0xA1 && oled_nb_args == 1) {
+        oled_start_line = oled_args[0] & 127;
+    }
+}
+
+void FemtoRV32_ISS::oled_pixel(uint16_t pixel) {
+    oled[oled_y * OLED_WIDTH + oled_x] = pixel;
+    if (++oled_x > oled_x2) {
+        oled_x = oled_x1;
+        if (++oled_y > oled_y2) {
+            oled_y = oled_y1;
+        }
+    }
+}
+
+bool FemtoRV32_ISS::write_oled(const char* filename) const {
+    FILE* file = fopen(filename, "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool ok = true;
+    for (int y = 0; y < OLED_HEIGHT && ok; y++) {
+        int row = (y + oled_start_line) % OLED_HEIGHT;
+        ok = fwrite(oled + row * OLED_WIDTH, sizeof(uint16_t), OLED_WIDTH, file) == size_t(OLED_WIDTH);
+    }
+    return (fclose(file) == 0) && ok;
+}
+
+uint64_t FemtoRV32_ISS::oled_hash() const {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (int y = 0; y < OLED_HEIGHT; y++) {
+        const uint16_t* row = oled + ((y + oled_start_line) % OLED_HEIGHT) * OLED_WIDTH;
+        for (int x = 0; x < OLED_WIDTH; x++) {
+            for (int byte = 0; byte < 2; byte++) {
+                hash = (hash ^ uint8_t(row[x] >> (8 * byte))) * 0x100000001B3ull;
+            }
+        }
+    }
+    return hash;
+}
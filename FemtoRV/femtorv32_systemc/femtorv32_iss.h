@@ -0,0 +1,310 @@
+/*******************************************************************/
+// FemtoRV32 ISS - host instruction-set simulator
+//
+// Functional (not cycle-accurate) simulator of a RV32IMFC processor
+// with the femtosoc memory map, to run firmware much faster than the
+// SystemC and Verilator models. Decodes instructions with the funct3
+// codes of the Quark (femtorv32_quark_isa.h), and computes the F
+// extension with the C++ FPU model of the Verilator simulation
+// (SIM/FPU_funcs.cpp), so that both floating-point paths agree.
+//
+// Instruction set: RV32IMFC + Zicsr (cycle, time, instret and their
+// upper halves; other CSRs are plain read/write registers, there are
+// no traps nor interrupts). Unlike the Quark model, the ISS implements
+// the standard ISA (sign-extended B/J immediates, any base register
+// for word accesses). One instruction = one cycle.
+//
+// Devices (IO page, address bit 22, see FIRMWARE/LIBFEMTORV32/femtorv32.h):
+//  - LEDS: last written value, printed on stderr if print_leds is set.
+//  - UART: writes go to stdout (buffered, dropped if quiet_uart is set),
+//    reads return the characters typed on stdin (bit 8: data ready),
+//    never busy.
+//  - SSD1351: the commands 0x15 (columns), 0x75 (rows), 0x5C (write RAM)
+//    and 0xA1 (start line) of the OLED display, decoded into a 128x128
+//    RGB565 frame buffer (write_oled()).
+//  - FGA: accepted and counted, the status register always reports the
+//    vertical blanking (so that firmware waiting for it goes on).
+//  - HW_CONFIG: RAM size, devices, frequency, ISA extensions (M,F,C) and
+//    counter width.
+//
+// Execution engine: straight-line code is translated into blocks of
+// pre-decoded operations (a handler pointer and the resolved operands
+// per instruction, the block ends at the first jump or branch, or after
+// MAX_BLOCK_INSTRUCTIONS). Blocks are kept in a cache indexed by their
+// address, and chained to the blocks of their direct successors (branch
+// target and fall-through), so that loops run without cache lookups.
+// Stores to a RAM page that contains translated code (self-modifying
+// code, or code loaded by the firmware, e.g. exec.c) drop all the blocks.
+// Instructions without a dedicated handler (F extension, CSRs, division)
+// run through the switch interpreter, which is also used alone when
+// use_blocks is false, and to run the last instructions before
+// max_instructions exactly.
+//
+// Memory timing (cache_sweep): if icache / dcache are set, each fetch /
+// RAM load and store goes through a latency model (memory_latency.h,
+// e.g. an instruction cache, or the line buffer of the SPI flash read
+// in place), and memory_wait_cycles adds up their wait cycles to
+// estimate the cycles of a core with one instruction per cycle
+// (instret + memory_wait_cycles). The IO page is not timed. The models
+// see every access, so the interpreter is used alone while one is set.
+//
+// Instruction trace (iss_run -t): if instr_trace is set, each executed
+// instruction is written to it as a line of text (PC, instruction,
+// disassembly from riscv_disasm.h, value of the register written), with
+// the interpreter alone. Compressed instructions appear expanded.
+//
+// Stops on 'jal x0, 0' or 'c.j 0' (the end of the CRT), ebreak, ecall, or
+// an invalid instruction or access, or when request_stop() is called.
+//
+// Embedding (iss_matrix, libfemtorv32_iss.a): an instance has no global
+// state, it only uses its own memory (HarnessMemory, allocated on first
+// touch), and its host_io for the UART and the LEDs (the terminal if
+// null), so that one ISS per thread can run firmware in parallel. The
+// FPU settings of SIM/FPU_funcs.cpp (set_use_soft_fpu(),
+// set_check_verbose()) are process-wide, and must be set before the
+// threads start.
+//
+// No SystemC dependency.
+/*******************************************************************/
+
+#ifndef FEMTORV32_ISS_H
+#define FEMTORV32_ISS_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <atomic>
+
+#include "femtorv32_quark_isa.h"
+#include "harness_memory.h"
+
+class BranchTraceWriter;
+class MemoryLatency;
+
+// Host side of the UART and the LEDs (FemtoRV32_ISS::host_io), called
+// from the thread that runs the ISS. Without one, the UART is the
+// terminal (stdout, stdin).
+class ISSHostIO {
+public:
+    virtual ~ISSHostIO() {}
+
+    // Character written by the firmware
+    virtual void uart_output(uint8_t c) = 0;
+
+    // Next character typed, -1 if none
+    virtual int uart_input() { return -1; }
+
+    // Value written to the LEDs
+    virtual void leds_output(uint32_t leds) { (void)leds; }
+};
+
+class FemtoRV32_ISS {
+public:
+    enum StopReason {
+        RUNNING,          // max_instructions reached
+        HALTED,           // 'jal x0, 0' or 'c.j 0'
+        EBREAK,
+        ECALL,
+        INVALID_INSTRUCTION,
+        INVALID_ACCESS,   // outside the RAM and the IO page
+        STOPPED           // request_stop()
+    };
+
+    explicit FemtoRV32_ISS(HarnessMemory& memory, uint32_t reset_addr = DEFAULT_RESET_ADDR);
+    ~FemtoRV32_ISS();
+
+    FemtoRV32_ISS(const FemtoRV32_ISS&) = delete;
+    FemtoRV32_ISS& operator=(const FemtoRV32_ISS&) = delete;
+
+    void reset();
+
+    // Executes at most max_instructions instructions
+    StopReason run(uint64_t max_instructions);
+
+    // Makes run() return STOPPED before the next instruction, or at the
+    // end of the current translated block. Can be called from host_io,
+    // or from another thread (e.g. a timeout).
+    void request_stop() { stop_requested.store(true, std::memory_order_relaxed); }
+
+    static const char* stop_reason_name(StopReason reason);
+
+    // Writes the OLED frame buffer (raw RGB565, 128x128, top row first,
+    // same format as the Verilator headless mode). Returns false if the
+    // file cannot be written.
+    bool write_oled(const char* filename) const;
+
+    // FNV-1a 64-bit hash of the OLED frame buffer, in the byte order of
+    // write_oled(), to compare the display with an expected image
+    uint64_t oled_hash() const;
+
+    // Writes the buffered UART output to stdout (host_io receives the
+    // characters unbuffered)
+    void flush_uart();
+
+    // Instruction at pc (expanded if compressed), returns false if pc
+    // is outside the RAM. Used by the lockstep checker (SIM/lockstep.cpp).
+    bool next_instruction(uint32_t& instr, uint32_t& length) const {
+        return fetch(pc, instr, length);
+    }
+
+    // Drops the translated blocks (to be called if the host modifies the
+    // code in RAM between two calls of run())
+    void invalidate_blocks();
+
+    // Architectural state
+    uint32_t x[32];
+    uint32_t f[32];
+    uint32_t pc;
+    uint64_t instret = 0;
+
+    // Instruction and address that stopped the simulation
+    uint32_t fault_instr = 0;
+    uint32_t fault_addr = 0;
+
+    // Devices
+    uint32_t freq_MHz = 50;   // reported in HW_CONFIG_CPUINFO
+    uint32_t leds = 0;
+    bool print_leds = false;
+    bool quiet_uart = false;
+    ISSHostIO* host_io = nullptr;  // not owned
+    uint64_t fga_writes = 0;  // FGA register writes and pixels
+
+    // Control-flow trace (branch_trace.h, for branch_sim), written if
+    // not null: one record per executed branch, JAL and JALR
+    BranchTraceWriter* branch_trace = nullptr;
+
+    // Instruction trace (see above), not owned
+    FILE* instr_trace = nullptr;
+
+    // Memory timing (see above), not owned
+    MemoryLatency* icache = nullptr;
+    MemoryLatency* dcache = nullptr;
+    uint64_t memory_wait_cycles = 0;
+
+    // Execution engine (see above) and its statistics
+    bool use_blocks = true;
+    uint64_t nb_translated_blocks = 0;
+    uint64_t nb_invalidations = 0;
+
+private:
+    static const int OLED_WIDTH  = 128;
+    static const int OLED_HEIGHT = 128;
+
+    static const int MAX_BLOCK_INSTRUCTIONS = 64;
+    static const int CODE_PAGE_BITS = 10; // granularity of the code page flags
+
+    // Pre-decoded instruction. A handler returns the next operation of
+    // the block, or nullptr to leave the block (after setting pc, and
+    // advancing instret by the number of instructions executed).
+    struct Op;
+    typedef const Op* (*Handler)(FemtoRV32_ISS& iss, const Op* op);
+    struct Op {
+        Handler handler;
+        uint32_t instr;   // 32-bit instruction (expanded if compressed)
+        uint32_t pc;
+        int32_t imm;      // immediate, shift amount, or jump/branch target
+        uint8_t rd, rs1, rs2;
+        uint8_t length;   // 2 or 4
+        uint16_t index;   // position in the block
+    };
+    struct Block {
+        std::vector<Op> ops;
+        uint32_t nb_instructions;
+        // Direct successors (~0u if none), and their blocks when known
+        uint32_t next_pc[2];
+        Block* next[2];
+    };
+    friend struct ISSHandlers;
+
+    // run() in the floating point environment of the ISS
+    StopReason run_engine(uint64_t max_instructions);
+
+    // Writes the line of instr_trace of the instruction executed at pc
+    void trace_instruction(uint32_t instr_pc, uint32_t instr);
+
+    // Fetches the instruction at addr (expanded if compressed), returns
+    // false if addr is outside the RAM
+    bool fetch(uint32_t addr, uint32_t& instr, uint32_t& length) const;
+
+    // Executes one instruction at pc (switch interpreter), returns false
+    // and sets stop if the simulation stops
+    bool step(StopReason& stop);
+    bool execute(uint32_t instr, uint32_t length, StopReason& stop);
+
+    // Returns the block at pc (translated if needed), nullptr if pc
+    // cannot be fetched
+    Block* find_block(uint32_t pc);
+    Op decode(uint32_t instr, uint32_t pc, uint32_t length, Block& block, bool& last);
+
+    void note_store(uint32_t addr, uint32_t size) {
+        if (code_pages[addr >> CODE_PAGE_BITS] | code_pages[(addr + size - 1) >> CODE_PAGE_BITS]) {
+            invalidate_pending = true;
+        }
+    }
+
+    // C extension: returns the equivalent 32-bit instruction, 0 if invalid
+    static uint32_t expand_compressed(uint32_t instr);
+
+    // Returns a pointer to n bytes of RAM at addr, nullptr if outside
+    uint8_t* ram(uint32_t addr, uint32_t n) {
+        return (addr <= ram_size && n <= ram_size - addr) ? ram_base + addr : nullptr;
+    }
+
+    static bool is_io(uint32_t addr) { return (addr & (1u << 22)) != 0; }
+    uint32_t io_read(uint32_t addr);
+    void io_write(uint32_t addr, uint32_t data);
+    uint32_t csr_read(uint32_t csr);
+
+    void uart_putchar(uint8_t c);
+    int uart_getchar(); // -1 if no character is available
+    void oled_command(uint8_t cmd);
+    void oled_data(uint8_t data);
+    void oled_pixel(uint16_t pixel);
+
+    HarnessMemory& memory;
+    uint8_t* ram_base;
+    uint32_t ram_size;
+    uint32_t reset_addr;
+
+    uint32_t csrs[4096];
+
+    // Translated blocks, and a flag per RAM page that contains some
+    std::unordered_map<uint32_t, std::unique_ptr<Block>> blocks;
+    std::vector<uint8_t> code_pages;
+    bool invalidate_pending = false;
+    StopReason block_stop = RUNNING;
+    std::atomic<bool> stop_requested{false};
+
+    // Consumes a request_stop()
+    bool stop_pending() {
+        return stop_requested.load(std::memory_order_relaxed) &&
+               stop_requested.exchange(false, std::memory_order_relaxed);
+    }
+
+    // UART
+    char uart_out[65536];
+    size_t uart_out_size = 0;
+    unsigned char uart_in[256];
+    size_t uart_in_size = 0;
+    size_t uart_in_pos = 0;
+    unsigned int uart_poll_count = 0;
+    bool uart_eof = false;
+
+    // SSD1351
+    uint16_t oled[OLED_WIDTH * OLED_HEIGHT];
+    uint8_t oled_cmd = 0;
+    uint8_t oled_args[2];
+    int oled_nb_args = 0;
+    bool oled_write_ram = false;
+    bool oled_half_pixel = false; // 8-bit data: high byte received
+    uint8_t oled_high = 0;
+    int oled_x1 = 0, oled_x2 = OLED_WIDTH - 1;
+    int oled_y1 = 0, oled_y2 = OLED_HEIGHT - 1;
+    int oled_x = 0, oled_y = 0;
+    int oled_start_line = 0;
+};
+
+#endif // FEMTORV32_ISS_H
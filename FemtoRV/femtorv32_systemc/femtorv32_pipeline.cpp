@@ -0,0 +1,432 @@
+/*******************************************************************/
+// FemtoRV32 Pipeline - SystemC model of a 5-stages pipelined RV32I
+// Translated from TUTORIALS/FROM_BLINKER_TO_RISCV/pipeline9.v
+/*******************************************************************/
+
+#include "femtorv32_pipeline.h"
+
+// Bit-field helpers (same as in femtorv32_quark_native.cpp)
+static inline bool bit(uint32_t x, int i) {
+    return (x >> i) & 1u;
+}
+
+static inline uint32_t bits(uint32_t x, int hi, int lo) {
+    return (x >> lo) & ((hi - lo == 31) ? 0xFFFFFFFFu : ((1u << (hi - lo + 1)) - 1u));
+}
+
+static inline uint32_t sext12(uint32_t x) {
+    return uint32_t(int32_t(x << 20) >> 20);
+}
+
+// Immediates
+static inline uint32_t Uimm(uint32_t I) { return I & 0xFFFFF000u; }
+static inline uint32_t Iimm(uint32_t I) { return uint32_t(int32_t(I) >> 20); }
+static inline uint32_t Simm(uint32_t I) { return sext12((bits(I, 31, 25) << 5) | bits(I, 11, 7)); }
+
+static inline uint32_t Bimm(uint32_t I) {
+    return uint32_t(int32_t(
+        (bit(I, 31) << 31) | (bit(I, 7) << 30) | (bits(I, 30, 25) << 24) | (bits(I, 11, 8) << 20)
+    ) >> 19);
+}
+
+static inline uint32_t Jimm(uint32_t I) {
+    return uint32_t(int32_t(
+        (bit(I, 31) << 31) | (bits(I, 19, 12) << 23) | (bit(I, 20) << 22) | (bits(I, 30, 21) << 12)
+    ) >> 11);
+}
+
+// Opcodes (instr[6:2])
+enum {
+    OP_LOAD = 0x00, OP_ALUIMM = 0x04, OP_AUIPC = 0x05, OP_STORE = 0x08,
+    OP_ALUREG = 0x0C, OP_LUI = 0x0D, OP_BRANCH = 0x18, OP_JALR = 0x19,
+    OP_JAL = 0x1B, OP_SYSTEM = 0x1C
+};
+
+// 2-bits saturating counter of the BHT
+static inline uint8_t incdec_sat(uint8_t prev, bool dir) {
+    if (dir) {
+        return prev == 3 ? 3 : prev + 1;
+    }
+    return prev == 0 ? 0 : prev - 1;
+}
+
+/*******************************************************************/
+
+void FemtoRV32_Pipeline::clear_counters() {
+    perf.clear();
+    load_use_stalls = 0;
+    load_store_stalls = 0;
+    memory_stalls = 0;
+    branch_mispredictions = 0;
+    jalr_mispredictions = 0;
+    jal_flushes = 0;
+    branches = 0;
+    jalrs = 0;
+}
+
+void FemtoRV32_Pipeline::reset_state() {
+    PC = RESET_ADDR;
+    registerFile[0] = 0;
+    cycle = 0;
+    instret = 0;
+    FD = FD_Reg();
+    DE = DE_Reg();
+    EM = EM_Reg();
+    MW = MW_Reg();
+    if (bht_history_bits > bht_index_bits) {
+        bht_history_bits = bht_index_bits;
+    }
+    BHT.assign(size_t(1) << bht_index_bits, 1); // weakly not taken
+    branch_history = 0;
+    RAS.assign(ras_depth ? ras_depth : 1, 0);
+    halted_ = false;
+    halt_pending_ = false;
+}
+
+uint32_t FemtoRV32_Pipeline::BHT_index(uint32_t pc) const {
+    uint32_t mask = (1u << bht_index_bits) - 1u;
+    return (bits(pc, 31, 2) ^ (branch_history << (bht_index_bits - bht_history_bits))) & mask;
+}
+
+uint32_t FemtoRV32_Pipeline::alu(uint32_t in1, uint32_t in2) const {
+    switch (DE.funct3) {
+        case ALU_ADD_SUB: return (DE.funct7 && DE.isALUreg) ? in1 - in2 : in1 + in2;
+        case ALU_SLL:     return in1 << (in2 & 31);
+        case ALU_SLT:     return int32_t(in1) < int32_t(in2);
+        case ALU_SLTU:    return in1 < in2;
+        case ALU_XOR:     return in1 ^ in2;
+        case ALU_SRL_SRA: return DE.funct7 ? uint32_t(int32_t(in1) >> (in2 & 31)) : in1 >> (in2 & 31);
+        case ALU_OR:      return in1 | in2;
+        case ALU_AND:     return in1 & in2;
+    }
+    return 0;
+}
+
+/*******************************************************************/
+
+void FemtoRV32_Pipeline::evaluate() {
+    bool pc_predict = (prediction != PREDICT_NONE);
+    bool ras = pc_predict && return_address_stack && ras_depth != 0;
+
+    /*** D: Instruction decode ***/
+    uint32_t I = FD.instr;
+    uint32_t op = bits(I, 6, 2);
+    bool D_isJAL    = (op == OP_JAL);
+    bool D_isJALR   = (op == OP_JALR);
+    bool D_isBranch = (op == OP_BRANCH);
+    bool D_isLoad   = (op == OP_LOAD);
+    bool D_readsRs1 = !(D_isJAL || op == OP_LUI || op == OP_AUIPC);
+    bool D_readsRs2 = (op == OP_ALUREG || D_isBranch || op == OP_STORE || op == OP_SYSTEM);
+
+    w.D_BHTindex = BHT_index(FD.PC);
+    switch (prediction) {
+        case PREDICT_GSHARE: w.D_predictBranch = bit(BHT[w.D_BHTindex], 1); break;
+        case PREDICT_BTFNT:  w.D_predictBranch = bit(I, 31); break;
+        default:             w.D_predictBranch = false; break;
+    }
+
+    w.D_predictPC = pc_predict && !FD.nop &&
+                    (D_isJAL || (ras && D_isJALR) || (D_isBranch && w.D_predictBranch));
+    w.D_PCprediction = (ras && D_isJALR) ? RAS[0] : FD.PC + (D_isJAL ? Jimm(I) : Bimm(I));
+
+    // One bubble if the next instruction uses the result of a load or
+    // of a CSR read (latency 2), or for a load right after a store
+    // (the load reads the memory in E, the store writes it in M)
+    bool rs1Hazard = D_readsRs1 && (bits(I, 19, 15) == DE.rdId);
+    bool rs2Hazard = D_readsRs2 && (bits(I, 24, 20) == DE.rdId);
+    w.loadUseHazard = !FD.nop && (DE.isLoad || DE.isCSRRS) && (rs1Hazard || rs2Hazard);
+    w.dataHazard = w.loadUseHazard || (!FD.nop && D_isLoad && DE.isStore);
+
+    w.halt = halt_pending_ || DE.isEBREAK;
+
+    /*** E: Execute ***/
+    bool E_M_fwd_rs1 = EM.wbEnable && (EM.rdId == DE.rs1Id);
+    bool E_W_fwd_rs1 = MW.wbEnable && (MW.rdId == DE.rs1Id);
+    bool E_M_fwd_rs2 = EM.wbEnable && (EM.rdId == DE.rs2Id);
+    bool E_W_fwd_rs2 = MW.wbEnable && (MW.rdId == DE.rs2Id);
+
+    w.E_rs1 = E_M_fwd_rs1 ? EM.Eresult : E_W_fwd_rs1 ? MW.wbData : registerFile[DE.rs1Id];
+    w.E_rs2 = E_M_fwd_rs2 ? EM.Eresult : E_W_fwd_rs2 ? MW.wbData : registerFile[DE.rs2Id];
+
+    uint32_t E_aluIn2 = (DE.isALUreg || DE.isBranch) ? w.E_rs2 : DE.IorSimm;
+
+    switch (DE.funct3) {
+        case BRANCH_BEQ:  w.E_takeBranch = (w.E_rs1 == w.E_rs2); break;
+        case BRANCH_BNE:  w.E_takeBranch = (w.E_rs1 != w.E_rs2); break;
+        case BRANCH_BLT:  w.E_takeBranch = (int32_t(w.E_rs1) <  int32_t(w.E_rs2)); break;
+        case BRANCH_BGE:  w.E_takeBranch = (int32_t(w.E_rs1) >= int32_t(w.E_rs2)); break;
+        case BRANCH_BLTU: w.E_takeBranch = (w.E_rs1 <  w.E_rs2); break;
+        case BRANCH_BGEU: w.E_takeBranch = (w.E_rs1 >= w.E_rs2); break;
+        default:          w.E_takeBranch = false; break;
+    }
+
+    w.E_addr = w.E_rs1 + DE.IorSimm;
+    uint32_t E_JALRaddr = w.E_addr & ~1u;
+
+    if (pc_predict) {
+        bool jalrMiss = DE.isJALR && (!ras || DE.predictRA != E_JALRaddr);
+        w.E_correctPC = jalrMiss || (DE.isBranch && (w.E_takeBranch != DE.predictBranch));
+        w.E_PCcorrection = DE.isBranch ? DE.PCplus4orBimm : E_JALRaddr;
+    } else {
+        w.E_correctPC = DE.isJAL || DE.isJALR || (DE.isBranch && w.E_takeBranch);
+        w.E_PCcorrection = DE.isJALR ? E_JALRaddr : DE.PCplusBorJimm;
+    }
+
+    w.E_result = (DE.isJAL || DE.isJALR || DE.isLUI || DE.isAUIPC) ?
+                 DE.PCplus4orUimm : alu(w.E_rs1, E_aluIn2);
+
+    /*** F: Instruction fetch ***/
+    w.F_PC = w.D_predictPC  ? w.D_PCprediction :
+             EM.correctPC   ? EM.PCcorrection  :
+                              PC;
+}
+
+void FemtoRV32_Pipeline::update_outputs() {
+    imem_addr = w.F_PC;
+
+    if (EM.isStore) {
+        // M: store
+        bool isB = (bits(EM.funct3, 1, 0) == LOAD_STORE_BYTE);
+        bool isH = (bits(EM.funct3, 1, 0) == LOAD_STORE_HALF);
+        uint32_t a = EM.addr & 3;
+        uint32_t wmask = isB ? (1u << a) : isH ? (bit(EM.addr, 1) ? 0xCu : 0x3u) : 0xFu;
+        uint32_t data = isB ? (EM.rs2 & 0xFF) * 0x01010101u :
+                        isH ? (EM.rs2 & 0xFFFF) * 0x00010001u : EM.rs2;
+        mem_addr = EM.addr;
+        mem_wdata = data;
+        mem_wmask = sc_uint<4>(wmask);
+        mem_rstrb = false;
+    } else {
+        // E: load (address computed with the forwarded rs1)
+        mem_addr = w.E_addr;
+        mem_wdata = 0;
+        mem_wmask = 0;
+        mem_rstrb = DE.isLoad;
+    }
+}
+
+/*******************************************************************/
+
+void FemtoRV32_Pipeline::clock_process() {
+    if (!reset.read()) {
+        reset_state();
+        evaluate();
+        update_outputs();
+        return;
+    }
+
+    if (halted_) {
+        return;
+    }
+
+    perf.cycles++;
+
+    if (imem_rbusy.read() || (DE.isLoad && mem_rbusy.read()) || (EM.isStore && mem_wbusy.read())) {
+        cycle++;
+        perf.stalls++;
+        memory_stalls++;
+        return;
+    }
+
+    // The stages read the pipeline registers and the signals (w) of
+    // the cycle that ends, and are updated from the last one to the
+    // first one, so that each one reads its input register before
+    // the previous stage overwrites it.
+    bool retired = !MW.nop;
+    writeback_stage();
+    memory_stage();
+    execute_stage();
+    decode_stage();
+    fetch_stage();
+
+    cycle++;
+    if (retired) {
+        instret++;
+        perf.instret++;
+    }
+
+    evaluate();
+    update_outputs();
+}
+
+void FemtoRV32_Pipeline::writeback_stage() {
+    if (MW.wbEnable) {
+        registerFile[MW.rdId] = MW.wbData;
+    }
+    if (MW.isEBREAK) {
+        halted_ = true;
+    }
+}
+
+void FemtoRV32_Pipeline::memory_stage() {
+    bool isB = (bits(EM.funct3, 1, 0) == LOAD_STORE_BYTE);
+    bool isH = (bits(EM.funct3, 1, 0) == LOAD_STORE_HALF);
+    bool sext = !bit(EM.funct3, 2);
+
+    uint32_t LOAD_H = bit(EM.addr, 1) ? bits(EM.Mdata, 31, 16) : bits(EM.Mdata, 15, 0);
+    uint32_t LOAD_B = bit(EM.addr, 0) ? bits(LOAD_H, 15, 8) : bits(LOAD_H, 7, 0);
+    uint32_t Mdata  = isB ? (sext ? uint32_t(int32_t(int8_t(LOAD_B)))  : LOAD_B) :
+                      isH ? (sext ? uint32_t(int32_t(int16_t(LOAD_H))) : LOAD_H) :
+                            EM.Mdata;
+
+    // csrId: {instr[27], instr[21]}
+    uint32_t CSR_data = 0;
+    switch (EM.csrId) {
+        case 0: CSR_data = uint32_t(cycle);         break; // cycle
+        case 1: CSR_data = uint32_t(instret);       break; // instret
+        case 2: CSR_data = uint32_t(cycle >> 32);   break; // cycleh
+        case 3: CSR_data = uint32_t(instret >> 32); break; // instreth
+    }
+
+    MW.nop      = EM.nop;
+    MW.rdId     = EM.rdId;
+    MW.wbData   = EM.isLoad ? Mdata : EM.isCSRRS ? CSR_data : EM.Eresult;
+    MW.wbEnable = EM.wbEnable;
+    MW.isEBREAK = EM.isEBREAK;
+}
+
+void FemtoRV32_Pipeline::execute_stage() {
+    EM.nop       = DE.nop;
+    EM.rdId      = DE.rdId;
+    EM.funct3    = DE.funct3;
+    EM.csrId     = DE.csrId;
+    EM.rs2       = w.E_rs2;
+    EM.Eresult   = w.E_result;
+    EM.addr      = w.E_addr;
+    EM.Mdata     = mem_rdata.read().to_uint(); // word at E_addr (load)
+    EM.isLoad    = DE.isLoad;
+    EM.isStore   = DE.isStore;
+    EM.isCSRRS   = DE.isCSRRS;
+    EM.isEBREAK  = DE.isEBREAK;
+    EM.wbEnable  = DE.wbEnable && (DE.rdId != 0);
+    EM.correctPC = w.E_correctPC;
+    EM.PCcorrection = w.E_PCcorrection;
+
+    if (DE.isBranch) {
+        branches++;
+        if (prediction == PREDICT_GSHARE) {
+            uint32_t histo_mask = (1u << bht_history_bits) - 1u;
+            branch_history = ((uint32_t(w.E_takeBranch) << (bht_history_bits - 1)) |
+                              (branch_history >> 1)) & histo_mask;
+            BHT[DE.BHTindex] = incdec_sat(BHT[DE.BHTindex], w.E_takeBranch);
+        }
+    }
+    if (DE.isJALR) {
+        jalrs++;
+    }
+
+    if (w.E_correctPC) {
+        perf.flushes++;
+        if (DE.isBranch) {
+            branch_mispredictions++;
+        } else if (DE.isJALR) {
+            jalr_mispredictions++;
+        } else {
+            jal_flushes++;
+        }
+    }
+
+    if (DE.isEBREAK) {
+        halt_pending_ = true;
+    }
+}
+
+void FemtoRV32_Pipeline::decode_stage() {
+    bool D_stall = w.dataHazard || w.halt;
+    bool D_flush = w.E_correctPC;
+    bool E_flush = w.E_correctPC || w.dataHazard || w.halt;
+
+    if (w.dataHazard) {
+        perf.stalls++;
+        if (w.loadUseHazard) {
+            load_use_stalls++;
+        } else {
+            load_store_stalls++;
+        }
+    }
+
+    if (!D_stall) {
+        uint32_t I = FD.instr;
+        uint32_t op = bits(I, 6, 2);
+        bool isSYSTEM = (op == OP_SYSTEM);
+
+        DE.nop      = false;
+        DE.PC       = FD.PC;
+        DE.instr    = I;
+        DE.rdId     = bits(I, 11, 7);
+        DE.rs1Id    = bits(I, 19, 15);
+        DE.rs2Id    = bits(I, 24, 20);
+        DE.funct3   = bits(I, 14, 12);
+        DE.funct7   = bit(I, 30);
+        DE.csrId    = (bit(I, 27) << 1) | bit(I, 21);
+
+        DE.isALUreg = (op == OP_ALUREG);
+        DE.isALUimm = (op == OP_ALUIMM);
+        DE.isBranch = (op == OP_BRANCH);
+        DE.isJALR   = (op == OP_JALR);
+        DE.isJAL    = (op == OP_JAL);
+        DE.isAUIPC  = (op == OP_AUIPC);
+        DE.isLUI    = (op == OP_LUI);
+        DE.isLoad   = (op == OP_LOAD);
+        DE.isStore  = (op == OP_STORE);
+        DE.isCSRRS  = isSYSTEM && bit(I, 13);
+        DE.isEBREAK = isSYSTEM && !bit(I, 13);
+        DE.wbEnable = !(DE.isBranch || DE.isStore);
+
+        DE.IorSimm  = DE.isStore ? Simm(I) : Iimm(I);
+
+        DE.PCplus4orUimm = DE.isLUI   ? Uimm(I) :
+                           DE.isAUIPC ? FD.PC + Uimm(I) :
+                                        FD.PC + 4;
+        DE.PCplusBorJimm = FD.PC + (DE.isJAL ? Jimm(I) : Bimm(I));
+        DE.PCplus4orBimm = FD.PC + (w.D_predictBranch ? 4 : Bimm(I));
+        DE.predictBranch = w.D_predictBranch;
+        DE.BHTindex      = w.D_BHTindex;
+        DE.predictRA     = RAS[0];
+
+        // Return address stack: push on 'jal ra', pop on 'jalr x0, ra / t0'
+        if (return_address_stack && !FD.nop && !D_flush) {
+            if (DE.isJAL && DE.rdId == 1) {
+                for (size_t i = RAS.size() - 1; i > 0; i--) {
+                    RAS[i] = RAS[i - 1];
+                }
+                RAS[0] = FD.PC + 4;
+            }
+            if (DE.isJALR && DE.rdId == 0 && (DE.rs1Id == 1 || DE.rs1Id == 5)) {
+                for (size_t i = 0; i + 1 < RAS.size(); i++) {
+                    RAS[i] = RAS[i + 1];
+                }
+            }
+        }
+    }
+
+    if (E_flush || FD.nop) {
+        DE.nop      = true;
+        DE.isALUreg = false;
+        DE.isALUimm = false;
+        DE.isBranch = false;
+        DE.isJALR   = false;
+        DE.isJAL    = false;
+        DE.isAUIPC  = false;
+        DE.isLUI    = false;
+        DE.isLoad   = false;
+        DE.isStore  = false;
+        DE.isCSRRS  = false;
+        DE.isEBREAK = false;
+        DE.wbEnable = false;
+    }
+}
+
+void FemtoRV32_Pipeline::fetch_stage() {
+    bool F_stall = w.dataHazard || w.halt;
+
+    if (!F_stall) {
+        FD.instr = imem_rdata.read().to_uint(); // word at F_PC
+        FD.PC    = w.F_PC;
+        PC       = w.F_PC + 4;
+    }
+
+    if (!w.halt) {
+        FD.nop = w.E_correctPC;
+    }
+}
@@ -0,0 +1,193 @@
+/*******************************************************************/
+// FemtoRV32 Pipeline - SystemC model of a 5-stages pipelined RV32I
+//
+// Translated from TUTORIALS/FROM_BLINKER_TO_RISCV/pipeline9.v
+// (femtorv32-tordboyau, see PIPELINE.md): F, D, E, M, W stages,
+// register forwarding (M->E, W->E), one bubble after a load or a
+// CSR read used by the next instruction, and after a store followed
+// by a load, jumps and branches predicted in D and resolved in E
+// (2 instructions flushed on a misprediction).
+//
+// The three CONFIG_ macros of the Verilog version are run-time
+// settings here, so that their effect on the CPI can be compared
+// without recompiling (set them before sc_start()):
+//  - prediction: PREDICT_NONE (no D->F path, every taken jump or
+//    branch flushes), PREDICT_BTFNT (backwards taken, forwards not
+//    taken) or PREDICT_GSHARE (BHT of 2-bits counters indexed by
+//    PC ^ global history, bht_index_bits / bht_history_bits);
+//  - return_address_stack: predicts the target of the returns
+//    (JALR x0, 0(ra / t0)) with ras_depth entries.
+//
+// Interface: clk, reset and the memory interface of the Quark
+// (femtorv32_core.h) for the data, plus an instruction port
+// (imem_addr, imem_rdata, imem_rbusy), read every cycle. Both memories answer
+// within the cycle, the whole pipeline is frozen while mem_rbusy or
+// mem_wbusy is set (load in E, store in M) or while imem_rbusy is set.
+// The data port is unshared: the store in M and the load in E never
+// access it in the same cycle (load-after-store bubble).
+//
+// SYSTEM instructions: CSRRS reads cycle, instret and their upper
+// halves, anything else (EBREAK, ECALL) halts the core once the
+// instructions before it have retired (halted()).
+//
+// Internal state is plain uint32_t (like femtorv32_quark_native.h).
+// Besides perf (stalls, flushes, CPI), the model counts the causes of
+// the stalls and flushes (see below).
+/*******************************************************************/
+
+#ifndef FEMTORV32_PIPELINE_H
+#define FEMTORV32_PIPELINE_H
+
+#include <systemc.h>
+#include <vector>
+#include <cstdint>
+
+#include "femtorv32_core.h"
+#include "femtorv32_quark_isa.h"
+
+enum BranchPrediction {
+    PREDICT_NONE   = 0,
+    PREDICT_BTFNT  = 1,
+    PREDICT_GSHARE = 2
+};
+
+struct FemtoRV32_Pipeline : public FemtoRV32_Core {
+    // Ports: clk, reset and the data memory interface (femtorv32_core.h)
+
+    // Instruction memory interface
+    sc_out<sc_uint<32> > imem_addr;
+    sc_in<sc_uint<32> >  imem_rdata;
+    sc_in<bool>          imem_rbusy;
+
+    // Constructor
+    FemtoRV32_Pipeline(sc_module_name name) :
+        FemtoRV32_Core(name),
+        RESET_ADDR(DEFAULT_RESET_ADDR),
+        registerFile(32, 0u) {
+        reset_state();
+
+        SC_METHOD(clock_process);
+        sensitive << clk.pos();
+    }
+
+    // Parameters
+    const uint32_t RESET_ADDR;
+
+    // Configuration (before sc_start(), see above)
+    BranchPrediction prediction = PREDICT_GSHARE;
+    bool return_address_stack = true;  // ignored with PREDICT_NONE
+    unsigned ras_depth = 4;
+    unsigned bht_index_bits = 12;      // BHT of 1 << bht_index_bits entries
+    unsigned bht_history_bits = 9;     // <= bht_index_bits
+
+    // Causes of the stalls (perf.stalls is their sum)
+    uint64_t load_use_stalls = 0;      // load or CSR read, result used next
+    uint64_t load_store_stalls = 0;    // load right after a store
+    uint64_t memory_stalls = 0;        // pipeline frozen by a busy memory
+
+    // Causes of the flushes (perf.flushes is their sum)
+    uint64_t branch_mispredictions = 0;
+    uint64_t jalr_mispredictions = 0;
+    uint64_t jal_flushes = 0;          // PREDICT_NONE only
+
+    // Executed control-flow instructions
+    uint64_t branches = 0;
+    uint64_t jalrs = 0;
+
+    // Architectural state
+    uint32_t PC = 0;                   // next sequential fetch address
+    std::vector<uint32_t> registerFile;
+    uint64_t cycle = 0;                // CSRs
+    uint64_t instret = 0;
+
+    bool halted() const { return halted_; }
+
+    // Clears perf and the detailed counters above
+    void clear_counters();
+
+    // Pipeline registers (names of pipeline9.v)
+    struct FD_Reg {
+        uint32_t PC = 0;
+        uint32_t instr = 0;
+        bool nop = true;
+    } FD;
+
+    struct DE_Reg {
+        bool nop = true;
+        uint32_t PC = 0, instr = 0;
+        uint32_t rdId = 0, rs1Id = 0, rs2Id = 0;
+        uint32_t funct3 = 0, csrId = 0;
+        bool funct7 = false;           // instr[30]
+        uint32_t IorSimm = 0;
+        bool isALUreg = false, isALUimm = false, isBranch = false;
+        bool isJALR = false, isJAL = false, isAUIPC = false, isLUI = false;
+        bool isLoad = false, isStore = false, isCSRRS = false, isEBREAK = false;
+        bool wbEnable = false;
+        uint32_t PCplus4orUimm = 0;    // result of JAL, JALR, LUI, AUIPC
+        uint32_t PCplusBorJimm = 0;    // target of JAL, branch
+        uint32_t PCplus4orBimm = 0;    // branch, other path than predicted
+        bool predictBranch = false;
+        uint32_t predictRA = 0;        // RAS top when the JALR was decoded
+        uint32_t BHTindex = 0;
+    } DE;
+
+    struct EM_Reg {
+        bool nop = true;
+        uint32_t rdId = 0, funct3 = 0, csrId = 0;
+        uint32_t rs2 = 0, Eresult = 0, addr = 0, Mdata = 0;
+        bool isLoad = false, isStore = false, isCSRRS = false, isEBREAK = false;
+        bool wbEnable = false;
+        bool correctPC = false;
+        uint32_t PCcorrection = 0;
+    } EM;
+
+    struct MW_Reg {
+        bool nop = true;
+        uint32_t rdId = 0, wbData = 0;
+        bool wbEnable = false, isEBREAK = false;
+    } MW;
+
+    // Branch predictors
+    std::vector<uint8_t> BHT;
+    uint32_t branch_history = 0;
+    std::vector<uint32_t> RAS;
+
+    // Combinational signals, functions of the pipeline registers only
+    // (computed by evaluate(), after reset and after each clock edge)
+    struct Wires {
+        uint32_t F_PC;
+        bool D_predictPC;
+        uint32_t D_PCprediction;
+        bool D_predictBranch;
+        uint32_t D_BHTindex;
+        bool loadUseHazard;            // load or CSR read, result used next
+        bool dataHazard;               // loadUseHazard or load after store
+        bool halt;
+        uint32_t E_rs1, E_rs2;
+        uint32_t E_result, E_addr;
+        bool E_takeBranch;
+        bool E_correctPC;
+        uint32_t E_PCcorrection;
+    } w = {};
+
+    // Process declarations
+    void clock_process();
+
+    // Helper functions
+    void reset_state();
+    void evaluate();
+    void update_outputs();
+    void writeback_stage();
+    void memory_stage();
+    void execute_stage();
+    void decode_stage();
+    void fetch_stage();
+    uint32_t BHT_index(uint32_t pc) const;
+    uint32_t alu(uint32_t in1, uint32_t in2) const;
+
+private:
+    bool halted_ = false;
+    bool halt_pending_ = false;        // EBREAK executed, draining M and W
+};
+
+#endif // FEMTORV32_PIPELINE_H
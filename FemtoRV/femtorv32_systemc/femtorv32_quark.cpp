@@ -4,40 +4,52 @@
 /*******************************************************************/
 
 #include "femtorv32_quark.h"
-#include <iostream>
 
-// Constructor implementation is in header file
+// Constructor implementation is in header file. The member functions
+// are instantiated for the configurations listed at the end of the file.
 
-void FemtoRV32_Quark::clock_process() {
-    #ifdef DEBUG
-    std::cout << "  🔄 Clock process: reset=" << reset.read() << std::endl;
-    #endif
-    if (!reset.read()) {
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::clock_process() {
+    // A new instruction reaches the memory port through the decoder
+    switch (clock_edge()) {
+        case EDGE_INSTR: instr_latched.notify(); break;
+        case EDGE_STATE: state_changed.notify(); break;
+        default: break;
+    }
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+typename FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::Edge
+FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::clock_edge() {
+    if (!reset_in()) {
         // Reset state
-        #ifdef DEBUG
-        std::cout << "  🔄 Clock process: IN RESET" << std::endl;
-        #endif
         state = WAIT_ALU_OR_MEM;
         PC = RESET_ADDR;
         cycles = 0;
         aluShamt = 0;
         registerFile[0] = 0; // x0 is always zero
+        return EDGE_STATE;
     } else {
+        // Combinational signals sampled by the edge (before the cycle
+        // counter and the shifter change)
+        compute_control();
+        compute_writeback();
+
         // Update cycle counter
         cycles = cycles + 1;
+        perf.cycles++;
         
         // Update ALU shift register (matching Verilog logic)
         if (aluWr && funct3IsShift) {
             aluReg = aluIn1;
             aluShamt = aluIn2.range(4, 0);
+            if (functional_mode) {
+                functional_shift();
+            }
         } else if (aluShamt != 0) {
             // Shift operations (executed every clock cycle when aluShamt != 0)
             // This must run independently of the state machine, just like in Verilog
-#ifdef DEBUG
-            std::cout << "  🔍 SHIFT: aluShamt=" << aluShamt.to_uint() << " before shift" << std::endl;
-#endif
-#ifdef NRV_TWOLEVEL_SHIFTER
-            if (aluShamt.range(4, 2) != 0) {
+            if (TWOLEVEL_SHIFTER && aluShamt.range(4, 2) != 0) {
                 // Shift by 4
                 aluShamt = aluShamt - 4;
                 if (funct3 == ALU_SLL) {
@@ -45,14 +57,9 @@ void FemtoRV32_Quark::clock_process() {
                 } else {
                     // SRA or SRL
                     bool sign_bit = (funct3 == ALU_SRL_SRA) && instr[28] && aluReg[31];
-                    aluReg = (sign_bit, sign_bit, sign_bit, sign_bit, aluReg.range(31, 4));
+                    aluReg = (sc_uint<4>(sign_bit ? 0xF : 0x0), aluReg.range(31, 4));
                 }
-#ifdef DEBUG
-                std::cout << "  🔍 SHIFT: Shifted by 4, aluShamt=" << aluShamt.to_uint() << ", aluReg=0x" << std::hex << aluReg.to_uint() << std::dec << std::endl;
-#endif
-            } else
-#endif
-            {
+            } else {
                 // Shift by 1
                 aluShamt = aluShamt - 1;
                 if (funct3 == ALU_SLL) {
@@ -62,179 +69,216 @@ void FemtoRV32_Quark::clock_process() {
                     bool sign_bit = (funct3 == ALU_SRL_SRA) && instr[28] && aluReg[31];
                     aluReg = (sign_bit, aluReg.range(31, 1));
                 }
-#ifdef DEBUG
-                std::cout << "  🔍 SHIFT: Shifted by 1, aluShamt=" << aluShamt.to_uint() << ", aluReg=0x" << std::hex << aluReg.to_uint() << std::dec << std::endl;
-#endif
             }
         }
         
         // Update register file
-        // Note: writeBack is computed in combinational_process, so we need to check it here
-        // The writeBack signal should be true when we're in EXECUTE or WAIT_ALU_OR_MEM states
-        // and the instruction is not a branch or store
-        bool shouldWriteBack = !(isBranch || isStore) && 
-                              (state == EXECUTE || state == WAIT_ALU_OR_MEM);
-        
-        if (shouldWriteBack && rdId != 0) {
+        if (writeBack && rdId != 0) {
             registerFile[rdId] = writeBackData;
-            #ifdef DEBUG
-            std::cout << "  🔍 REG WRITE: x" << rdId.to_uint() << " = 0x" << std::hex << writeBackData.to_uint() << std::dec << std::endl;
-            #endif
+        }
+
+        // Instruction register (no register is written in WAIT_INSTR)
+        bool latched = (state == WAIT_INSTR && !mem_rbusy_in());
+        if (latched) {
+            latch_instruction();
+        }
+
+        if (state == EXECUTE) {
+            update_pc();
         }
         
         // State machine
-        #ifdef DEBUG
-        std::cout << "  🔄 Clock process: calling update_state(), current state=" << state << std::endl;
-        #endif
+        State old_state = state;
         update_state();
+
+        // Instruction trace (compiled out without NRV_TRACE)
+        if constexpr (QuarkTraceSink::enabled) {
+            if (old_state == EXECUTE) {
+                trace_pending = true;
+            }
+            if (state == FETCH_INSTR && trace_pending) {
+                bool rdWritten = writeBack && rdId != 0;
+                trace.record(cycles.to_uint(), trace_pc, full_instr.to_uint(),
+                             rdWritten ? rdId.to_uint() : 0, rdWritten ? writeBackData.to_uint() : 0);
+                trace_pending = false;
+            }
+        }
+
+        return latched ? EDGE_INSTR : (state != old_state) ? EDGE_STATE : EDGE_NONE;
     }
 }
 
-void FemtoRV32_Quark::combinational_process() {
-    // Decode instruction
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::decode_process() {
     decode_instruction();
-    
-    // Compute immediates
     compute_immediates();
-    
-    // Compute ALU
+    instr_decoded.notify();
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::alu_process() {
     compute_alu();
-    
-    // Compute branch predicate
     compute_branch_predicate();
-    
-    // Compute memory access
+    compute_pc_targets();
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::memory_port_process() {
     compute_memory_access();
+
+    // Request memory read for instruction fetch or load operations
+    bool rstrb = (state == FETCH_INSTR) || (state == EXECUTE && isLoad);
     
-    // Update PC
-    update_pc();
+    sc_uint<4> wmask = (state == EXECUTE && isStore) ? STORE_wmask : sc_uint<4>(0);
     
-    // Update control signals
+    // For instruction fetch, always use PC regardless of state
+    // For load/store operations, use loadstore_addr
+    sc_uint<32> addr = (state == WAIT_INSTR || state == FETCH_INSTR || 
+                        (state == EXECUTE && !isLoad && !isStore)) ? 
+                       PC : loadstore_addr;
+    
+    if (stepped) {
+        pins.mem_rstrb = rstrb;
+        pins.mem_wmask = wmask.to_uint();
+        pins.mem_addr = addr.to_uint();
+        pins.mem_wdata = rs2.to_uint();
+    } else {
+        mem_rstrb = rstrb;
+        mem_wmask = wmask;
+        mem_addr = addr;
+        mem_wdata = rs2;
+    }
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::set_memory(FemtoRV32_MemoryFunc func) {
+    stepped = true;
+    memory = std::move(func);
+
+    // Outputs out of construction (memory_port_process is initialized
+    // by the scheduler), and the inputs of the first edge
+    memory_port_process();
+    memory(pins);
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::step(uint64_t n) {
+    for (uint64_t i = 0; i < n; ++i) {
+        // The processes notified by clock_process, in the order of
+        // the delta cycles
+        Edge edge = clock_edge();
+        if (edge == EDGE_INSTR) {
+            decode_instruction();
+            compute_immediates();
+            alu_process();
+        }
+        if (edge != EDGE_NONE) {
+            memory_port_process();
+        }
+        memory(pins);
+    }
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::compute_control() {
     writeBack = !(isBranch || isStore) && 
                 (state == EXECUTE || state == WAIT_ALU_OR_MEM);
     
-    // Request memory read for instruction fetch or load operations
-    mem_rstrb = (state == FETCH_INSTR) || (state == EXECUTE && isLoad);
+    aluWr = (state == EXECUTE && isALU);
     
-    #ifdef DEBUG
-    if (mem_rstrb.read()) {
-        std::cout << "  🔍 MEM_RSTRB: Requesting memory read, state=" << state 
-                  << ", isLoad=" << isLoad << ", mem_addr=0x" << std::hex << mem_addr.read().to_uint() << std::dec << std::endl;
+    aluBusy = (aluShamt != 0);
+
+    if constexpr (IS_IO_ADDR) {
+        needToWait = isLoad || 
+                     (isStore && is_io_addr(mem_addr_out())) ||
+                     (isALU && funct3IsShift);
+    } else {
+        needToWait = isLoad || isStore || (isALU && funct3IsShift);
     }
-    #endif
-    
-    mem_wmask = (state == EXECUTE && isStore) ? STORE_wmask : sc_uint<4>(0);
-    
-    aluWr = (state == EXECUTE && isALU);
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::compute_writeback() {
+    // Load data processing (mem_rdata is only used here, at the edge)
+    sc_uint<32> rdata = mem_rdata_in();
+    LOAD_halfword = loadstore_addr[1] ? 
+                    rdata.range(31, 16) : 
+                    rdata.range(15, 0);
     
-    jumpToPCplusImm = isJAL || (isBranch && predicate);
+    LOAD_byte = loadstore_addr[0] ? 
+                LOAD_halfword.range(15, 8) : 
+                LOAD_halfword.range(7, 0);
     
-#ifdef NRV_IS_IO_ADDR
-    needToWait = isLoad || 
-                 (isStore && is_io_addr(mem_addr.read())) ||
-                 (isALU && funct3IsShift);
-#else
-    needToWait = isLoad || isStore || (isALU && funct3IsShift);
-#endif
+    LOAD_sign = !instr[12] && 
+                (mem_byteAccess ? LOAD_byte[7] : LOAD_halfword[15]);
     
-    // Assign outputs
-    // For instruction fetch, always use PC regardless of state
-    // For load/store operations, use loadstore_addr
-    mem_addr = (state == WAIT_INSTR || state == FETCH_INSTR || 
-                (state == EXECUTE && !isLoad && !isStore)) ? 
-               PC : loadstore_addr;
-               
-    #ifdef DEBUG
-    if (state == WAIT_INSTR || state == FETCH_INSTR) {
-        std::cout << "  🔍 MEM_ADDR: Instruction fetch, PC=0x" << std::hex << PC.to_uint() 
-                  << " → mem_addr=0x" << mem_addr.read().to_uint() << std::dec << std::endl;
+    LOAD_data = mem_byteAccess ? 
+                (sc_uint<24>(LOAD_sign), LOAD_byte) :
+                mem_halfwordAccess ? 
+                (sc_uint<16>(LOAD_sign), LOAD_halfword) :
+                rdata;
+
+    // Shifts read the shift register as it is at the edge
+    if (funct3IsShift) {
+        aluOut = aluReg;
     }
-    #endif
-    
-    mem_wdata = rs2;
-    
+
     writeBackData = (isSYSTEM ? cycles : sc_uint<32>(0)) |
                     (isLUI ? Uimm : sc_uint<32>(0)) |
                     (isALU ? aluOut : sc_uint<32>(0)) |
                     (isAUIPC ? PCplusImm : sc_uint<32>(0)) |
                     ((isJALR || isJAL) ? PCplus4 : sc_uint<32>(0)) |
                     (isLoad ? LOAD_data : sc_uint<32>(0));
-#ifdef DEBUG
-    if (isLUI || isAUIPC) {
-        std::cout << "  🔍 WRITEBACK: isLUI=" << isLUI << ", isAUIPC=" << isAUIPC << std::endl;
-        std::cout << "  🔍 WRITEBACK: Uimm=0x" << std::hex << Uimm.to_uint() << std::dec << std::endl;
-        std::cout << "  🔍 WRITEBACK: PCplusImm=0x" << std::hex << PCplusImm.to_uint() << std::dec << std::endl;
-        std::cout << "  🔍 WRITEBACK: writeBackData=0x" << std::hex << writeBackData.to_uint() << std::dec << std::endl;
-    }
-#endif
 }
 
-void FemtoRV32_Quark::decode_instruction() {
-    if (state == WAIT_INSTR && !mem_rbusy.read()) {
-        sc_uint<32> instruction = mem_rdata.read();
-        
-        // Fix SystemC signal truncation for instructions with leading zeros
-        // This happens when SystemC signals truncate 32-bit values to 16-bit
-        if (instruction.to_uint() < 0x10000) {
-            // This is likely a truncated instruction, try to reconstruct it
-            uint32_t opcode = instruction.to_uint() & 0x7F;
-            if (opcode == 0x17 || opcode == 0x37) {
-                // This is a U-type instruction (AUIPC or LUI) that got truncated
-                // For now, we'll handle this in compute_immediates() by detecting the truncation
-                #ifdef DEBUG
-                std::cout << "  🔧 DETECTED: Truncated U-type instruction 0x" << std::hex << instruction.to_uint() << std::dec << " (opcode=0x" << std::hex << opcode << std::dec << ")" << std::endl;
-                #endif
-            }
-        }
-        
-        #ifdef DEBUG
-        std::cout << "  🔍 DECODE: Loading instruction from memory" << std::endl;
-        std::cout << "  🔍 DECODE: PC=0x" << std::hex << PC.to_uint() << std::dec << std::endl;
-        std::cout << "  🔍 DECODE: mem_rdata=0x" << std::hex << instruction.to_uint() << std::dec << std::endl;
-        #endif
-        
-        // Extract instruction fields
-        rdId = instruction.range(11, 7);
-        rs1Id = instruction.range(19, 15);
-        rs2Id = instruction.range(24, 20);
-        funct3 = instruction.range(14, 12);
-        opcode = instruction.range(6, 0);
-        instr = instruction.range(31, 2); // Bits 0,1 ignored
-        full_instr = instruction; // Store full 32-bit instruction
-        
-        
-        
-        // Read register values
-        rs1 = registerFile[rs1Id];
-        rs2 = registerFile[rs2Id];
-        
-        // Decode instruction types
-        isLoad = (instruction.range(6, 2) == 0x00);
-        isALUimm = (instruction.range(6, 2) == 0x04);
-        isStore = (instruction.range(6, 2) == 0x08);
-        isALUreg = (instruction.range(6, 2) == 0x0C);
-        isSYSTEM = (instruction.range(6, 2) == 0x1C);
-        isJAL = instruction[3];
-        isJALR = (instruction.range(6, 2) == 0x19);
-        isLUI = (instruction.range(6, 2) == 0x0D);
-        isAUIPC = (instruction.range(6, 2) == 0x05);
-        isBranch = (instruction.range(6, 2) == 0x18);
-        
-        isALU = isALUimm || isALUreg;
-        
-        #ifdef DEBUG
-        std::cout << "  🔍 DECODE: opcode=0x" << std::hex << opcode.to_uint() << std::dec << std::endl;
-        std::cout << "  🔍 DECODE: funct3=0x" << std::hex << funct3.to_uint() << std::dec << std::endl;
-        std::cout << "  🔍 DECODE: rdId=" << rdId.to_uint() << ", rs1Id=" << rs1Id.to_uint() << ", rs2Id=" << rs2Id.to_uint() << std::endl;
-        std::cout << "  🔍 DECODE: isLoad=" << isLoad << ", isALU=" << isALU << ", isStore=" << isStore << std::endl;
-        #endif
-    } else {
-        // When not loading instruction, use current decoded values
-        // Don't re-decode invalid instructions - keep existing values
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::latch_instruction() {
+    sc_uint<32> instruction = mem_rdata_in();
+    instr = instruction.range(31, 2); // Bits 0,1 ignored
+    full_instr = instruction;         // Full 32-bit instruction for immediate decoding
+
+    // Read register values
+    rs1 = registerFile[instruction.range(19, 15)];
+    rs2 = registerFile[instruction.range(24, 20)];
+
+    if constexpr (QuarkTraceSink::enabled) {
+        trace_pc = PC.to_uint();
     }
 }
 
-void FemtoRV32_Quark::compute_immediates() {
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::decode_instruction() {
+    sc_uint<32> instruction = full_instr;
+    
+    // Extract instruction fields
+    rdId = instruction.range(11, 7);
+    rs1Id = instruction.range(19, 15);
+    rs2Id = instruction.range(24, 20);
+    funct3 = instruction.range(14, 12);
+    opcode = instruction.range(6, 0);
+    
+    // Decode instruction types
+    isLoad = (instruction.range(6, 2) == 0x00);
+    isALUimm = (instruction.range(6, 2) == 0x04);
+    isStore = (instruction.range(6, 2) == 0x08);
+    isALUreg = (instruction.range(6, 2) == 0x0C);
+    isSYSTEM = (instruction.range(6, 2) == 0x1C);
+    isJAL = instruction[3];
+    isJALR = (instruction.range(6, 2) == 0x19);
+    isLUI = (instruction.range(6, 2) == 0x0D);
+    isAUIPC = (instruction.range(6, 2) == 0x05);
+    isBranch = (instruction.range(6, 2) == 0x18);
+    
+    isALU = isALUimm || isALUreg;
+    funct3IsShift = (funct3 == ALU_SLL) || (funct3 == ALU_SRL_SRA);
+
+    // Memory access type
+    mem_byteAccess = (instr.range(13, 12) == 0);
+    mem_halfwordAccess = (instr.range(13, 12) == 1);
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::compute_immediates() {
     // U-type immediate (use full 32-bit instruction for correct immediate decoding)
     // Verilog: {instr[31], instr[30:12], {12{1'b0}}} -> 32-bit immediate with 12 LSBs zero
     
@@ -255,13 +299,6 @@ void FemtoRV32_Quark::compute_immediates() {
         // Normal U-type immediate calculation
         Uimm = (full_instr[31], full_instr.range(30, 12), sc_uint<12>(0));
     }
-#ifdef DEBUG
-    // Debug output for U-type instructions when truncation is detected
-    if ((opcode == 0x17 || opcode == 0x37) && instr_val < 0x10000) {
-        std::cout << "  🔍 U-TYPE: full_instr=0x" << std::hex << full_instr.to_uint() << std::dec << std::endl;
-        std::cout << "  🔍 U-TYPE: Uimm=0x" << std::hex << Uimm.to_uint() << std::dec << std::endl;
-    }
-#endif
     
     // I-type immediate (use full 32-bit instruction for correct immediate decoding)
     // Verilog: {{21{instr[31]}}, instr[30:20]} -> 32-bit sign-extended immediate
@@ -280,7 +317,8 @@ void FemtoRV32_Quark::compute_immediates() {
             instr.range(28, 19), sc_uint<1>(0));
 }
 
-void FemtoRV32_Quark::compute_alu() {
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::compute_alu() {
     // ALU inputs
     aluIn1 = rs1;
     aluIn2 = (isALUreg || isBranch) ? rs2 : Iimm;
@@ -319,15 +357,10 @@ void FemtoRV32_Quark::compute_alu() {
     } else if (funct3 == ALU_SLL || funct3 == ALU_SRL_SRA) {
         aluOut = aluReg; // Shift operations use aluReg
     }
-    
-    // Check if this is a shift operation
-    funct3IsShift = (funct3 == ALU_SLL) || (funct3 == ALU_SRL_SRA);
-    
-    // ALU busy signal
-    aluBusy = (aluShamt != 0);
 }
 
-void FemtoRV32_Quark::compute_branch_predicate() {
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::compute_branch_predicate() {
     predicate = (funct3 == BRANCH_BEQ && EQ) ||
                 (funct3 == BRANCH_BNE && !EQ) ||
                 (funct3 == BRANCH_BLT && LT) ||
@@ -336,34 +369,13 @@ void FemtoRV32_Quark::compute_branch_predicate() {
                 (funct3 == BRANCH_BGEU && !LTU);
 }
 
-void FemtoRV32_Quark::compute_memory_access() {
-    // Memory access type
-    mem_byteAccess = (instr.range(13, 12) == 0);
-    mem_halfwordAccess = (instr.range(13, 12) == 1);
-    
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::compute_memory_access() {
     // Load/store address
     loadstore_addr = rs1.range(ADDR_WIDTH-1, 0) + 
                      (isStore ? Simm.range(ADDR_WIDTH-1, 0) : 
                                 Iimm.range(ADDR_WIDTH-1, 0));
     
-    // Load data processing
-    LOAD_halfword = loadstore_addr[1] ? 
-                    mem_rdata.read().range(31, 16) : 
-                    mem_rdata.read().range(15, 0);
-    
-    LOAD_byte = loadstore_addr[0] ? 
-                LOAD_halfword.range(15, 8) : 
-                LOAD_halfword.range(7, 0);
-    
-    LOAD_sign = !instr[12] && 
-                (mem_byteAccess ? LOAD_byte[7] : LOAD_halfword[15]);
-    
-    LOAD_data = mem_byteAccess ? 
-                (sc_uint<24>(LOAD_sign), LOAD_byte) :
-                mem_halfwordAccess ? 
-                (sc_uint<16>(LOAD_sign), LOAD_halfword) :
-                mem_rdata.read();
-    
     // Store write mask
     if (mem_byteAccess) {
         if (loadstore_addr[1]) {
@@ -378,64 +390,59 @@ void FemtoRV32_Quark::compute_memory_access() {
     }
 }
 
-void FemtoRV32_Quark::update_state() {
-    #ifdef DEBUG
-    State old_state = state;
-    #endif
+// Functional mode: does all the steps of the shifter at once
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::functional_shift() {
+    uint32_t shamt = aluShamt.to_uint();
+    uint32_t nb_steps = TWOLEVEL_SHIFTER ? (shamt >> 2) + (shamt & 3) : shamt;
+    uint32_t value = aluReg.to_uint();
+    if (funct3 == ALU_SLL) {
+        value = value << shamt;
+    } else if (instr[28]) {
+        value = uint32_t(int32_t(value) >> shamt);
+    } else {
+        value = value >> shamt;
+    }
+    aluReg = value;
+    aluShamt = 0;
+    cycles = cycles + nb_steps;
+    perf.cycles += nb_steps;
+    perf.stalls += nb_steps;
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::update_state() {
     switch (state) {
         case WAIT_INSTR:
-            if (!mem_rbusy.read()) {
+            if (!mem_rbusy_in()) {
                 state = EXECUTE;
-                #ifdef DEBUG
-                std::cout << "  🔄 WAIT_INSTR → EXECUTE (mem_rbusy=" << mem_rbusy.read() << ")" << std::endl;
-                #endif
             } else {
-                #ifdef DEBUG
-                std::cout << "  🔄 WAIT_INSTR staying (mem_rbusy=" << mem_rbusy.read() << ")" << std::endl;
-                #endif
+                perf.stalls++;
             }
             break;
             
         case EXECUTE:
             state = needToWait ? WAIT_ALU_OR_MEM : FETCH_INSTR;
-            #ifdef DEBUG
-            std::cout << "  🔄 EXECUTE → " << (needToWait ? "WAIT_ALU_OR_MEM" : "FETCH_INSTR") 
-                      << " (needToWait=" << needToWait << ")" << std::endl;
-            #endif
+            perf.instret++;
             break;
             
         case WAIT_ALU_OR_MEM:
-            if (!aluBusy && !mem_rbusy.read() && !mem_wbusy.read()) {
+            if (!aluBusy && !mem_rbusy_in() && !mem_wbusy_in()) {
                 state = FETCH_INSTR;
-                #ifdef DEBUG
-                std::cout << "  🔄 WAIT_ALU_OR_MEM → FETCH_INSTR" << std::endl;
-                #endif
             } else {
-                #ifdef DEBUG
-                std::cout << "  🔄 WAIT_ALU_OR_MEM staying (aluBusy=" << aluBusy 
-                          << ", mem_rbusy=" << mem_rbusy.read() << ", mem_wbusy=" << mem_wbusy.read() << ")" << std::endl;
-                #endif
+                perf.stalls++;
             }
             break;
             
         case FETCH_INSTR:
         default:
             state = WAIT_INSTR;
-            #ifdef DEBUG
-            std::cout << "  🔄 FETCH_INSTR → WAIT_INSTR" << std::endl;
-            #endif
             break;
     }
-    
-    #ifdef DEBUG
-    if (old_state != state) {
-        std::cout << "  🔄 State transition: " << old_state << " → " << state 
-                  << " (PC=0x" << std::hex << PC.to_uint() << std::dec << ")" << std::endl;
-    }
-    #endif
 }
 
-void FemtoRV32_Quark::update_pc() {
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::compute_pc_targets() {
     PCplus4 = PC + 4;
     
     // Compute PC + immediate
@@ -447,36 +454,27 @@ void FemtoRV32_Quark::update_pc() {
         PCplusImm = PC + Bimm.range(ADDR_WIDTH-1, 0);
     }
     
-    if (state == EXECUTE) {
-        #ifdef DEBUG
-        std::cout << "  🔍 PC UPDATE: state=EXECUTE, PC=0x" << std::hex << PC.to_uint() << std::dec << std::endl;
-        std::cout << "  🔍 PC UPDATE: isJALR=" << isJALR << ", jumpToPCplusImm=" << jumpToPCplusImm << std::endl;
-        #endif
-        
-        if (isJALR) {
-            PC = (aluPlus.range(ADDR_WIDTH-1, 1), sc_uint<1>(0));
-            #ifdef DEBUG
-            std::cout << "  🔍 PC UPDATE: JALR → PC=0x" << std::hex << PC.to_uint() << std::dec << std::endl;
-            #endif
-        } else if (jumpToPCplusImm) {
-            PC = PCplusImm;
-            #ifdef DEBUG
-            std::cout << "  🔍 PC UPDATE: JUMP → PC=0x" << std::hex << PC.to_uint() << std::dec << std::endl;
-            #endif
-        } else {
-            PC = PCplus4;
-            #ifdef DEBUG
-            std::cout << "  🔍 PC UPDATE: PC+4 → PC=0x" << std::hex << PC.to_uint() << std::dec << std::endl;
-            #endif
-        }
+    jumpToPCplusImm = isJAL || (isBranch && predicate);
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::update_pc() {
+    if (isJALR) {
+        PC = (aluPlus.range(ADDR_WIDTH-1, 1), sc_uint<1>(0));
+    } else if (jumpToPCplusImm) {
+        PC = PCplusImm;
+    } else {
+        PC = PCplus4;
     }
 }
 
-void FemtoRV32_Quark::update_registers() {
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::update_registers() {
     // Register file updates are handled in clock_process
 }
 
-sc_uint<32> FemtoRV32_Quark::sign_extend(sc_uint<32> value, int bits) {
+template <QUARK_TEMPLATE_PARAMS>
+sc_uint<32> FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::sign_extend(sc_uint<32> value, int bits) {
     if (value[bits-1]) {
         return value | (sc_uint<32>(-1) << bits);
     } else {
@@ -484,7 +482,12 @@ sc_uint<32> FemtoRV32_Quark::sign_extend(sc_uint<32> value, int bits) {
     }
 }
 
-bool FemtoRV32_Quark::is_io_addr(sc_uint<32> /* addr */) {
+template <QUARK_TEMPLATE_PARAMS>
+bool FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::is_io_addr(sc_uint<32> /* addr */) {
     // Default implementation - can be overridden
     return false;
 }
+
+// Configurations compiled with the model (femtorv32_quark.h)
+template struct FemtoRV32_QuarkT<DEFAULT_RESET_ADDR, DEFAULT_ADDR_WIDTH, false, DEFAULT_IS_IO_ADDR>;
+template struct FemtoRV32_QuarkT<DEFAULT_RESET_ADDR, DEFAULT_ADDR_WIDTH, true, DEFAULT_IS_IO_ADDR>;
@@ -7,10 +7,22 @@
 //
 // Instruction set: RV32I + RDCYCLES
 //
-// Parameters:
+// Parameters (template parameters of FemtoRV32_QuarkT, so that the
+// address masks fold to constants and the unused paths compile away):
 //  Reset address can be defined using RESET_ADDR (default is 0).
 //  The ADDR_WIDTH parameter lets you define the width of the internal
 //  address bus (and address computation logic).
+//  TWOLEVEL_SHIFTER shifts by 4 then by 1 (default: NRV_TWOLEVEL_SHIFTER).
+//  IS_IO_ADDR: stores only wait for IO addresses, see is_io_addr()
+//  (default: NRV_IS_IO_ADDR).
+//  FemtoRV32_Quark is the default configuration. The configurations are
+//  instantiated at the end of femtorv32_quark.cpp.
+//
+// Macros:
+//  NRV_NATIVE_MODEL selects the plain uint32_t implementation of the
+//  same module (femtorv32_quark_native.h), much faster to simulate.
+//  NRV_TRACE records the retired instructions in a ring buffer
+//  (quark_trace.h, decoded by trace_dump).
 //
 // Bruno Levy, Matthias Koch, 2020-2021
 // SystemC Translation: 2024
@@ -22,9 +34,9 @@
 #include <systemc.h>
 #include <vector>
 
-// Default parameters
-#define DEFAULT_RESET_ADDR 0x00000000
-#define DEFAULT_ADDR_WIDTH 24
+#include "femtorv32_core.h"
+#include "femtorv32_quark_isa.h"
+#include "quark_trace.h"
 
 // State machine states
 enum State {
@@ -35,53 +47,41 @@ enum State {
     NB_STATES       = 4
 };
 
-// ALU function codes (funct3)
-enum ALUFunction {
-    ALU_ADD_SUB = 0,  // ADD, SUB, ADDI
-    ALU_SLL     = 1,  // SLL, SLLI
-    ALU_SLT     = 2,  // SLT, SLTI
-    ALU_SLTU    = 3,  // SLTU, SLTIU
-    ALU_XOR     = 4,  // XOR, XORI
-    ALU_SRL_SRA = 5,  // SRL, SRA, SRLI, SRAI
-    ALU_OR      = 6,  // OR, ORI
-    ALU_AND     = 7   // AND, ANDI
-};
+// Defaults of the shifter and IO template parameters
+#ifdef NRV_TWOLEVEL_SHIFTER
+#define DEFAULT_TWOLEVEL_SHIFTER true
+#else
+#define DEFAULT_TWOLEVEL_SHIFTER false
+#endif
 
-// Branch function codes (funct3)
-enum BranchFunction {
-    BRANCH_BEQ  = 0,  // BEQ
-    BRANCH_BNE  = 1,  // BNE
-    BRANCH_BLT  = 4,  // BLT
-    BRANCH_BGE  = 5,  // BGE
-    BRANCH_BLTU = 6,  // BLTU
-    BRANCH_BGEU = 7   // BGEU
-};
+#ifdef NRV_IS_IO_ADDR
+#define DEFAULT_IS_IO_ADDR true
+#else
+#define DEFAULT_IS_IO_ADDR false
+#endif
 
-// Load/Store function codes (funct3)
-enum LoadStoreFunction {
-    LOAD_STORE_BYTE  = 0,  // LB, LBU, SB
-    LOAD_STORE_HALF  = 1,  // LH, LHU, SH
-    LOAD_STORE_WORD  = 2   // LW, SW
-};
+#define QUARK_TEMPLATE_PARAMS \
+    uint32_t RESET_ADDR, int ADDR_WIDTH, bool TWOLEVEL_SHIFTER, bool IS_IO_ADDR
+#define QUARK_TEMPLATE_ARGS \
+    RESET_ADDR, ADDR_WIDTH, TWOLEVEL_SHIFTER, IS_IO_ADDR
+
+#ifdef NRV_NATIVE_MODEL
+// Fast path: same interface, internal state in plain uint32_t
+#include "femtorv32_quark_native.h"
+#else
+
+template <uint32_t RESET_ADDR = DEFAULT_RESET_ADDR,
+          int ADDR_WIDTH = DEFAULT_ADDR_WIDTH,
+          bool TWOLEVEL_SHIFTER = DEFAULT_TWOLEVEL_SHIFTER,
+          bool IS_IO_ADDR = DEFAULT_IS_IO_ADDR>
+struct FemtoRV32_QuarkT : public FemtoRV32_Core {
+    static_assert(ADDR_WIDTH >= 2 && ADDR_WIDTH <= 32, "ADDR_WIDTH must be in [2, 32]");
+
+    // Ports: clk, reset and the memory interface (femtorv32_core.h)
 
-SC_MODULE(FemtoRV32_Quark) {
-    // Ports
-    sc_in<bool> clk;
-    sc_in<bool> reset;
-    
-    // Memory interface
-    sc_out<sc_uint<32> > mem_addr;
-    sc_out<sc_uint<32> > mem_wdata;
-    sc_out<sc_uint<4> >  mem_wmask;
-    sc_in<sc_uint<32> >  mem_rdata;
-    sc_out<bool>         mem_rstrb;
-    sc_in<bool>          mem_rbusy;
-    sc_in<bool>          mem_wbusy;
-    
     // Constructor
-    SC_CTOR(FemtoRV32_Quark) : 
-        RESET_ADDR(DEFAULT_RESET_ADDR),
-        ADDR_WIDTH(DEFAULT_ADDR_WIDTH),
+    FemtoRV32_QuarkT(sc_module_name name) :
+        FemtoRV32_Core(name),
         PC(0),
         state(WAIT_ALU_OR_MEM),
         cycles(0),
@@ -89,18 +89,25 @@ SC_MODULE(FemtoRV32_Quark) {
         aluReg(0),
         aluShamt(0) {
         
-        // Register processes
+        // Register processes: the state is updated on the rising edge
+        // of clk, the clocked process then notifies the combinational
+        // processes whose inputs changed (a latched instruction is
+        // decoded, then reaches the ALU and the memory port)
         SC_METHOD(clock_process);
-        sensitive << clk;
-        
-        SC_METHOD(combinational_process);
-        sensitive << clk << reset << mem_rdata << mem_rbusy << mem_wbusy;
+        sensitive << clk.pos();
+
+        SC_METHOD(decode_process);
+        sensitive << instr_latched;
+        dont_initialize();
+
+        SC_METHOD(alu_process);
+        sensitive << instr_decoded;
+        dont_initialize();
+
+        SC_METHOD(memory_port_process);
+        sensitive << state_changed << instr_decoded;
     }
     
-    // Parameters
-    const sc_uint<32> RESET_ADDR;
-    const int ADDR_WIDTH;
-    
     // Internal signals and registers
     sc_uint<32> PC;
     sc_uint<30> instr;  // 30 bits (bits 0,1 ignored in RV32I)
@@ -114,6 +121,33 @@ SC_MODULE(FemtoRV32_Quark) {
     // ALU registers
     sc_uint<32> aluReg;
     sc_uint<5>  aluShamt;
+
+    // Functional mode: shifts complete in one evaluation instead of
+    // one (or four, TWOLEVEL_SHIFTER) bit per cycle, and the cycle
+    // counter is advanced by the number of cycles they would have taken.
+    // Register values are the same, but the timing of the memory
+    // interface is not cycle-accurate. Off by default.
+    bool functional_mode = false;
+
+    // Cycle-stepping API: the same processes, called directly instead of
+    // through the SystemC scheduler (no sc_signal, no delta cycle), for
+    // unit tests and co-simulation. set_memory() detaches the core from
+    // its ports (they are neither read nor written and need not be bound,
+    // do not sc_start() a design that contains the core), then each cycle
+    // of step() is a rising edge of clk: the clocked process, the
+    // combinational processes it would have triggered, and the memory
+    // callback. The core is held in reset while pins.reset is false.
+    void set_memory(FemtoRV32_MemoryFunc func);
+    void step(uint64_t n = 1);
+    FemtoRV32_Pins pins;
+    bool stepped = false;        // driven by step(), not by the ports
+    FemtoRV32_MemoryFunc memory;
+
+    // Instruction trace, one record per retired instruction (no-op
+    // unless compiled with -DNRV_TRACE, see quark_trace.h)
+    QuarkTraceSink trace;
+    uint32_t trace_pc = 0;       // address of the instruction being executed
+    bool trace_pending = false;  // instruction executed, not yet traced
     
     // Decoded instruction fields
     sc_uint<5>  rdId;
@@ -121,40 +155,41 @@ SC_MODULE(FemtoRV32_Quark) {
     sc_uint<5>  rs2Id;
     sc_uint<3>  funct3;
     sc_uint<7>  opcode;
-    sc_uint<32> rs1;
+    sc_uint<32> rs1;     // read from the register file with the instruction
     sc_uint<32> rs2;
     
     // Immediate values
     sc_uint<32> Uimm, Iimm, Simm, Bimm, Jimm;
     
     // Instruction type flags
-    bool isLoad, isALUimm, isStore, isALUreg, isSYSTEM;
-    bool isJAL, isJALR, isLUI, isAUIPC, isBranch, isALU;
+    bool isLoad = false, isALUimm = false, isStore = false, isALUreg = false, isSYSTEM = false;
+    bool isJAL = false, isJALR = false, isLUI = false, isAUIPC = false, isBranch = false;
+    bool isALU = false;
     
     // ALU signals
     sc_uint<32> aluIn1, aluIn2, aluOut;
     sc_uint<32> aluPlus;
     sc_uint<33> aluMinus;
-    bool LT, LTU, EQ;
-    bool aluBusy, aluWr;
-    bool funct3IsShift;
+    bool LT = false, LTU = false, EQ = false;
+    bool aluBusy = false, aluWr = false;
+    bool funct3IsShift = false;
     
     // Branch predicate
-    bool predicate;
+    bool predicate = false;
     
     // Memory access signals
-    bool mem_byteAccess, mem_halfwordAccess;
+    bool mem_byteAccess = false, mem_halfwordAccess = false;
     sc_uint<32> loadstore_addr;
     sc_uint<32> LOAD_data;
     sc_uint<16> LOAD_halfword;
     sc_uint<8>  LOAD_byte;
-    bool LOAD_sign;
+    bool LOAD_sign = false;
     sc_uint<4>  STORE_wmask;
     
     // Control signals
-    bool writeBack;
-    bool jumpToPCplusImm;
-    bool needToWait;
+    bool writeBack = false;
+    bool jumpToPCplusImm = false;
+    bool needToWait = false;
     
     // Address computation
     sc_uint<32> PCplus4, PCplusImm;
@@ -162,23 +197,61 @@ SC_MODULE(FemtoRV32_Quark) {
     // Write-back data
     sc_uint<32> writeBackData;
     
+    // Notified by clock_process (one delta cycle after the edge)
+    sc_event instr_latched;   // instruction register loaded
+    sc_event state_changed;   // other changes of state
+    sc_event instr_decoded;   // by decode_process
+
+    // What a rising edge changed (the processes to run after it)
+    enum Edge { EDGE_NONE, EDGE_STATE, EDGE_INSTR };
+
     // Process declarations
-    void clock_process();
-    void combinational_process();
+    void clock_process();        // registers, on the rising edge of clk
+    Edge clock_edge();           // body of clock_process, no notification
+    void decode_process();       // fields, flags, immediates
+    void alu_process();          // ALU, branch predicate, PC targets
+    void memory_port_process();  // mem_addr, mem_wdata, mem_wmask, mem_rstrb
     
+    // Memory interface: the ports, or pins when driven by step()
+    bool reset_in() const { return stepped ? pins.reset : reset.read(); }
+    bool mem_rbusy_in() const { return stepped ? pins.mem_rbusy : mem_rbusy.read(); }
+    bool mem_wbusy_in() const { return stepped ? pins.mem_wbusy : mem_wbusy.read(); }
+    uint32_t mem_rdata_in() const {
+        return stepped ? pins.mem_rdata : mem_rdata.read().to_uint();
+    }
+    uint32_t mem_addr_out() const {
+        return stepped ? pins.mem_addr : mem_addr.read().to_uint();
+    }
+
     // Helper functions
+    void latch_instruction();
     void decode_instruction();
     void compute_immediates();
     void compute_alu();
     void compute_branch_predicate();
+    void compute_pc_targets();
     void compute_memory_access();
+    void compute_control();
+    void compute_writeback();
     void update_state();
     void update_pc();
     void update_registers();
+    void functional_shift();
     
     // Utility functions
     sc_uint<32> sign_extend(sc_uint<32> value, int bits);
     bool is_io_addr(sc_uint<32> addr);
 };
 
+#endif // NRV_NATIVE_MODEL
+
+// Default configuration, and the other configurations compiled with the
+// model (add an explicit instantiation at the end of the .cpp to use
+// another one)
+using FemtoRV32_Quark = FemtoRV32_QuarkT<>;
+using FemtoRV32_Quark_TwoLevelShifter =
+    FemtoRV32_QuarkT<DEFAULT_RESET_ADDR, DEFAULT_ADDR_WIDTH, true, DEFAULT_IS_IO_ADDR>;
+using FemtoRV32_Quark_OneLevelShifter =
+    FemtoRV32_QuarkT<DEFAULT_RESET_ADDR, DEFAULT_ADDR_WIDTH, false, DEFAULT_IS_IO_ADDR>;
+
 #endif // FEMTORV32_QUARK_H
@@ -0,0 +1,45 @@
+/*******************************************************************/
+// FemtoRV32 Quark - instruction set definitions (funct3 decode codes,
+// default parameters), shared by the SystemC models and by the host
+// instruction-set simulator (femtorv32_iss.h).
+//
+// No SystemC dependency.
+/*******************************************************************/
+
+#ifndef FEMTORV32_QUARK_ISA_H
+#define FEMTORV32_QUARK_ISA_H
+
+// Default parameters
+#define DEFAULT_RESET_ADDR 0x00000000
+#define DEFAULT_ADDR_WIDTH 24
+
+// ALU function codes (funct3)
+enum ALUFunction {
+    ALU_ADD_SUB = 0,  // ADD, SUB, ADDI
+    ALU_SLL     = 1,  // SLL, SLLI
+    ALU_SLT     = 2,  // SLT, SLTI
+    ALU_SLTU    = 3,  // SLTU, SLTIU
+    ALU_XOR     = 4,  // XOR, XORI
+    ALU_SRL_SRA = 5,  // SRL, SRA, SRLI, SRAI
+    ALU_OR      = 6,  // OR, ORI
+    ALU_AND     = 7   // AND, ANDI
+};
+
+// Branch function codes (funct3)
+enum BranchFunction {
+    BRANCH_BEQ  = 0,  // BEQ
+    BRANCH_BNE  = 1,  // BNE
+    BRANCH_BLT  = 4,  // BLT
+    BRANCH_BGE  = 5,  // BGE
+    BRANCH_BLTU = 6,  // BLTU
+    BRANCH_BGEU = 7   // BGEU
+};
+
+// Load/Store function codes (funct3)
+enum LoadStoreFunction {
+    LOAD_STORE_BYTE  = 0,  // LB, LBU, SB
+    LOAD_STORE_HALF  = 1,  // LH, LHU, SH
+    LOAD_STORE_WORD  = 2   // LW, SW
+};
+
+#endif // FEMTORV32_QUARK_ISA_H
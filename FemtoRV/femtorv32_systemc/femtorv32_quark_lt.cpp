@@ -0,0 +1,247 @@
+/*******************************************************************/
+// FemtoRV32 Quark - SystemC TLM-2.0 loosely-timed model
+/*******************************************************************/
+
+#include "femtorv32_quark_lt.h"
+#include <cstring>
+#include <sstream>
+
+void FemtoRV32_Quark_LT::run() {
+    qk.reset();
+    for (;;) {
+        step();
+        if (qk.need_sync()) {
+            sync();
+        }
+    }
+}
+
+void FemtoRV32_Quark_LT::sync() {
+    qk.sync();
+    ++syncs;
+}
+
+int FemtoRV32_Quark_LT::instr_cycles(uint32_t instr, uint32_t rs2) {
+    // FETCH_INSTR, WAIT_INSTR, EXECUTE
+    int nb_cycles = 3;
+    uint32_t op = (instr >> 2) & 31;
+    uint32_t funct3 = (instr >> 12) & 7;
+    bool isALUimm = (op == 0x04);
+    bool isALUreg = (op == 0x0C);
+    bool isLoad   = (op == 0x00);
+    bool isStore  = (op == 0x08);
+    if (isLoad || isStore) {
+        // + WAIT_ALU_OR_MEM
+        nb_cycles += 1;
+    } else if ((isALUimm || isALUreg) && (funct3 == ALU_SLL || funct3 == ALU_SRL_SRA)) {
+        // + WAIT_ALU_OR_MEM, during which the shifter runs
+        uint32_t shamt = isALUreg ? (rs2 & 31) : ((instr >> 20) & 31);
+#ifdef NRV_TWOLEVEL_SHIFTER
+        shamt = (shamt >> 2) + (shamt & 3);
+#endif
+        nb_cycles += 1 + int(shamt);
+    }
+    return nb_cycles;
+}
+
+void FemtoRV32_Quark_LT::step() {
+    uint32_t instr = mem_read(PC, 4);
+
+    uint32_t rdId   = (instr >> 7)  & 31;
+    uint32_t rs1Id  = (instr >> 15) & 31;
+    uint32_t rs2Id  = (instr >> 20) & 31;
+    uint32_t funct3 = (instr >> 12) & 7;
+    uint32_t rs1 = registerFile[rs1Id];
+    uint32_t rs2 = registerFile[rs2Id];
+
+    // Immediates (sign-extended)
+    uint32_t Uimm = instr & 0xFFFFF000u;
+    uint32_t Iimm = uint32_t(int32_t(instr) >> 20);
+    uint32_t Simm = uint32_t(int32_t(instr & 0xFE000000u) >> 20) | ((instr >> 7) & 0x1F);
+    uint32_t Bimm = uint32_t(int32_t(instr & 0x80000000u) >> 19) | ((instr & 0x80) << 4) |
+                    ((instr >> 20) & 0x7E0) | ((instr >> 7) & 0x1E);
+    uint32_t Jimm = uint32_t(int32_t(instr & 0x80000000u) >> 11) | (instr & 0xFF000) |
+                    ((instr >> 9) & 0x800) | ((instr >> 20) & 0x7FE);
+
+    uint32_t PCplus4 = PC + 4;
+    uint32_t nextPC = PCplus4;
+    uint32_t writeBackData = 0;
+    bool writeBack = true;
+
+    switch ((instr >> 2) & 31) {
+        case 0x04:   // ALUimm
+        case 0x0C: { // ALUreg
+            bool isALUreg = (instr & 0x20) != 0;
+            uint32_t aluIn2 = isALUreg ? rs2 : Iimm;
+            uint32_t shamt = aluIn2 & 31;
+            switch (funct3) {
+                case ALU_ADD_SUB:
+                    writeBackData = (isALUreg && (instr & 0x40000000u)) ? rs1 - aluIn2 : rs1 + aluIn2;
+                    break;
+                case ALU_SLL:  writeBackData = rs1 << shamt; break;
+                case ALU_SLT:  writeBackData = int32_t(rs1) < int32_t(aluIn2); break;
+                case ALU_SLTU: writeBackData = rs1 < aluIn2; break;
+                case ALU_XOR:  writeBackData = rs1 ^ aluIn2; break;
+                case ALU_SRL_SRA:
+                    writeBackData = (instr & 0x40000000u) ? uint32_t(int32_t(rs1) >> shamt) : (rs1 >> shamt);
+                    break;
+                case ALU_OR:   writeBackData = rs1 | aluIn2; break;
+                case ALU_AND:  writeBackData = rs1 & aluIn2; break;
+            }
+            break;
+        }
+        case 0x18: { // Branch
+            bool predicate = false;
+            switch (funct3) {
+                case BRANCH_BEQ:  predicate = (rs1 == rs2); break;
+                case BRANCH_BNE:  predicate = (rs1 != rs2); break;
+                case BRANCH_BLT:  predicate = (int32_t(rs1) <  int32_t(rs2)); break;
+                case BRANCH_BGE:  predicate = (int32_t(rs1) >= int32_t(rs2)); break;
+                case BRANCH_BLTU: predicate = (rs1 <  rs2); break;
+                case BRANCH_BGEU: predicate = (rs1 >= rs2); break;
+            }
+            if (predicate) {
+                nextPC = PC + Bimm;
+            }
+            writeBack = false;
+            break;
+        }
+        case 0x1B:   // JAL
+            writeBackData = PCplus4;
+            nextPC = PC + Jimm;
+            break;
+        case 0x19:   // JALR
+            writeBackData = PCplus4;
+            nextPC = (rs1 + Iimm) & ~1u;
+            break;
+        case 0x0D:   // LUI
+            writeBackData = Uimm;
+            break;
+        case 0x05:   // AUIPC
+            writeBackData = PC + Uimm;
+            break;
+        case 0x00: { // Load
+            uint32_t addr = (rs1 + Iimm) & ADDR_MASK;
+            switch (funct3 & 3) {
+                case LOAD_STORE_BYTE:
+                    writeBackData = mem_read(addr, 1);
+                    if (!(funct3 & 4)) writeBackData = uint32_t(int32_t(int8_t(writeBackData)));
+                    break;
+                case LOAD_STORE_HALF:
+                    writeBackData = mem_read(addr, 2);
+                    if (!(funct3 & 4)) writeBackData = uint32_t(int32_t(int16_t(writeBackData)));
+                    break;
+                default:
+                    writeBackData = mem_read(addr, 4);
+                    break;
+            }
+            break;
+        }
+        case 0x08: { // Store
+            uint32_t addr = (rs1 + Simm) & ADDR_MASK;
+            unsigned int len = (funct3 & 3) == LOAD_STORE_BYTE ? 1 :
+                               (funct3 & 3) == LOAD_STORE_HALF ? 2 : 4;
+            mem_write(addr, rs2, len);
+            writeBack = false;
+            break;
+        }
+        case 0x1C:   // SYSTEM (RDCYCLES)
+            writeBackData = cycles;
+            break;
+        default:
+            writeBack = false;
+            break;
+    }
+
+    if (writeBack && rdId != 0) {
+        registerFile[rdId] = writeBackData;
+    }
+
+    PC = nextPC & ADDR_MASK;
+
+    int nb_cycles = instr_cycles(instr, rs2);
+    cycles += nb_cycles;
+    qk.inc(nb_cycles * CLK_PERIOD);
+    ++instret;
+}
+
+bool FemtoRV32_Quark_LT::is_io_addr(uint32_t addr) {
+    // Same as NRV_IS_IO_ADDR in RTL/femtosoc_config.v: |addr[23:22]
+    return (addr & (3u << 22)) != 0;
+}
+
+/*******************************************************************/
+
+bool FemtoRV32_Quark_LT::dmi_try(tlm::tlm_command cmd, uint32_t addr, unsigned int len) {
+    if (!dmi_valid ||
+        addr < dmi.get_start_address() ||
+        sc_dt::uint64(addr) + len - 1 > dmi.get_end_address()) {
+        return false;
+    }
+    return (cmd == tlm::TLM_READ_COMMAND) ? dmi.is_read_allowed() : dmi.is_write_allowed();
+}
+
+uint32_t FemtoRV32_Quark_LT::mem_read(uint32_t addr, unsigned int len) {
+    // Little-endian host assumed (like the RISC-V)
+    uint32_t data = 0;
+    if (dmi_try(tlm::TLM_READ_COMMAND, addr, len)) {
+        memcpy(&data, dmi.get_dmi_ptr() + (addr - dmi.get_start_address()), len);
+        qk.inc(dmi.get_read_latency());
+        ++dmi_accesses;
+    } else {
+        transport(tlm::TLM_READ_COMMAND, addr, reinterpret_cast<uint8_t*>(&data), len);
+    }
+    return data;
+}
+
+void FemtoRV32_Quark_LT::mem_write(uint32_t addr, uint32_t data, unsigned int len) {
+    if (dmi_try(tlm::TLM_WRITE_COMMAND, addr, len)) {
+        memcpy(dmi.get_dmi_ptr() + (addr - dmi.get_start_address()), &data, len);
+        qk.inc(dmi.get_write_latency());
+        ++dmi_accesses;
+    } else {
+        transport(tlm::TLM_WRITE_COMMAND, addr, reinterpret_cast<uint8_t*>(&data), len);
+    }
+}
+
+void FemtoRV32_Quark_LT::transport(
+    tlm::tlm_command cmd, uint32_t addr, uint8_t* data, unsigned int len
+) {
+    // IO devices see the accesses at the right time
+    if (is_io_addr(addr) && qk.get_local_time() != SC_ZERO_TIME) {
+        sync();
+        ++io_syncs;
+    }
+
+    trans.set_command(cmd);
+    trans.set_address(addr);
+    trans.set_data_ptr(data);
+    trans.set_data_length(len);
+    trans.set_streaming_width(len);
+    trans.set_byte_enable_ptr(nullptr);
+    trans.set_dmi_allowed(false);
+    trans.set_response_status(tlm::TLM_INCOMPLETE_RESPONSE);
+
+    sc_time delay = qk.get_local_time();
+    socket->b_transport(trans, delay);
+    qk.set(delay);
+    ++transport_accesses;
+
+    if (trans.is_response_error()) {
+        std::ostringstream msg;
+        msg << trans.get_response_string() << " at address 0x" << std::hex << addr
+            << " (PC=0x" << PC << ")";
+        SC_REPORT_ERROR("FemtoRV32_Quark_LT", msg.str().c_str());
+    }
+
+    if (trans.is_dmi_allowed() && !dmi_valid) {
+        dmi.init();
+        dmi_valid = socket->get_direct_mem_ptr(trans, dmi);
+    }
+}
+
+void FemtoRV32_Quark_LT::invalidate_direct_mem_ptr(sc_dt::uint64 start, sc_dt::uint64 end) {
+    if (dmi_valid && start <= dmi.get_end_address() && end >= dmi.get_start_address()) {
+        dmi_valid = false;
+    }
+}
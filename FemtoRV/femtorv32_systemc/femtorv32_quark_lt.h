@@ -0,0 +1,116 @@
+/*******************************************************************/
+// FemtoRV32 Quark - SystemC TLM-2.0 loosely-timed model
+//
+// Instruction-accurate version of the Quark for fast simulation of
+// complete systems. Instead of the pin-level mem_addr / mem_rdata /
+// mem_rstrb / mem_rbusy bundle, memory is accessed through a TLM-2.0
+// initiator socket (blocking transport), with direct memory interface
+// (DMI) pointers for RAM, and the processor runs ahead of SystemC
+// time (temporal decoupling, with a tlm_quantumkeeper). It only
+// synchronizes with the SystemC kernel when the quantum expires or
+// before accessing an IO address (is_io_addr()).
+//
+// Timing: each instruction advances the local time by the number of
+// cycles that the Verilog Quark takes to execute it (see
+// instr_cycles()), plus the latency annotated by the target.
+//
+// Instruction set: RV32I + RDCYCLES
+/*******************************************************************/
+
+#ifndef FEMTORV32_QUARK_LT_H
+#define FEMTORV32_QUARK_LT_H
+
+#include <systemc.h>
+#include <tlm.h>
+#include <tlm_utils/simple_initiator_socket.h>
+#include <tlm_utils/tlm_quantumkeeper.h>
+#include <vector>
+#include <cstdint>
+
+#include "femtorv32_quark.h" // DEFAULT_RESET_ADDR, DEFAULT_ADDR_WIDTH, funct3 enums
+
+SC_MODULE(FemtoRV32_Quark_LT) {
+    // Memory interface
+    tlm_utils::simple_initiator_socket<FemtoRV32_Quark_LT> socket;
+
+    FemtoRV32_Quark_LT(sc_module_name name,
+                       sc_time clk_period = sc_time(10, SC_NS),
+                       uint32_t reset_addr = DEFAULT_RESET_ADDR,
+                       int addr_width = DEFAULT_ADDR_WIDTH) :
+        sc_module(name),
+        socket("socket"),
+        CLK_PERIOD(clk_period),
+        RESET_ADDR(reset_addr),
+        ADDR_WIDTH(addr_width),
+        ADDR_MASK((addr_width >= 32) ? 0xFFFFFFFFu : ((1u << addr_width) - 1u)),
+        PC(reset_addr),
+        registerFile(32, 0) {
+        socket.register_invalidate_direct_mem_ptr(
+            this, &FemtoRV32_Quark_LT::invalidate_direct_mem_ptr
+        );
+        SC_THREAD(run);
+    }
+
+    // Parameters
+    const sc_time  CLK_PERIOD;
+    const uint32_t RESET_ADDR;
+    const int      ADDR_WIDTH;
+    const uint32_t ADDR_MASK;
+
+    // Architectural state
+    uint32_t PC;
+    std::vector<uint32_t> registerFile;
+    uint32_t cycles = 0;       // RDCYCLES counter
+    uint64_t instret = 0;      // number of retired instructions
+
+    // Statistics
+    uint64_t dmi_accesses = 0;
+    uint64_t transport_accesses = 0;
+    uint64_t syncs = 0;        // number of times the processor wait()ed
+    uint64_t io_syncs = 0;     // ... of which before an IO access
+
+    // Sets the maximum time the processors can run ahead of SystemC
+    // time (global to all TLM initiators). SC_ZERO_TIME synchronizes
+    // after each instruction. Call it before sc_start().
+    static void set_quantum(const sc_time& quantum) {
+        tlm_utils::tlm_quantumkeeper::set_global_quantum(quantum);
+    }
+
+    // Main loop: executes instructions, synchronizes with the SystemC
+    // kernel when the quantum expires.
+    void run();
+
+    // Executes one instruction at PC.
+    void step();
+
+    // Lets the local time catch up with SystemC time.
+    void sync();
+
+    // Time the processor is ahead of sc_time_stamp()
+    sc_time local_time() const {
+        return qk.get_local_time();
+    }
+
+    // Number of clock cycles taken by the Verilog Quark to execute instr.
+    static int instr_cycles(uint32_t instr, uint32_t rs2);
+
+    // Asserted if address is in IO space
+    bool is_io_addr(uint32_t addr);
+
+private:
+    // Memory accesses, through DMI when possible, else through b_transport().
+    // len is 1, 2 or 4, addr is naturally aligned.
+    uint32_t mem_read(uint32_t addr, unsigned int len);
+    void     mem_write(uint32_t addr, uint32_t data, unsigned int len);
+    void     transport(tlm::tlm_command cmd, uint32_t addr, uint8_t* data, unsigned int len);
+    bool     dmi_try(tlm::tlm_command cmd, uint32_t addr, unsigned int len);
+
+    void invalidate_direct_mem_ptr(sc_dt::uint64 start, sc_dt::uint64 end);
+
+    tlm_utils::tlm_quantumkeeper qk;
+    tlm::tlm_generic_payload trans;
+    tlm::tlm_dmi dmi;
+    bool dmi_valid = false;
+};
+
+#endif // FEMTORV32_QUARK_LT_H
@@ -0,0 +1,504 @@
+/*******************************************************************/
+// FemtoRV32 Quark - SystemC Implementation, "native" fast path
+// Same behavior as femtorv32_quark.cpp, computed with plain uint32_t.
+// Compile with -DNRV_NATIVE_MODEL (also for the testbench).
+/*******************************************************************/
+
+#include "femtorv32_quark.h"
+
+#ifndef NRV_NATIVE_MODEL
+#error "femtorv32_quark_native.cpp needs -DNRV_NATIVE_MODEL"
+#endif
+
+// Bit-field helpers, equivalent to sc_uint<>::operator[] and range()
+static inline bool bit(uint32_t x, int i) {
+    return (x >> i) & 1u;
+}
+
+static inline uint32_t bits(uint32_t x, int hi, int lo) {
+    return (x >> lo) & ((hi - lo == 31) ? 0xFFFFFFFFu : ((1u << (hi - lo + 1)) - 1u));
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::clock_process() {
+    // A new instruction reaches the memory port through the decoder
+    switch (clock_edge()) {
+        case EDGE_INSTR: instr_latched.notify(); break;
+        case EDGE_STATE: state_changed.notify(); break;
+        default: break;
+    }
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+typename FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::Edge
+FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::clock_edge() {
+    if (!reset_in()) {
+        // Reset state
+        state = WAIT_ALU_OR_MEM;
+        PC = RESET_ADDR;
+        cycles = 0;
+        aluShamt = 0;
+        registerFile[0] = 0; // x0 is always zero
+        return EDGE_STATE;
+    } else {
+        // Combinational signals sampled by the edge
+        compute_control();
+        compute_writeback();
+
+        // Update cycle counter
+        cycles = cycles + 1;
+        perf.cycles++;
+
+        // Update ALU shift register (matching Verilog logic)
+        if (aluWr && funct3IsShift) {
+            aluReg = aluIn1;
+            aluShamt = aluIn2 & 31u;
+            if (functional_mode) {
+                functional_shift();
+            }
+        } else if (aluShamt != 0) {
+            bool sign_bit = (funct3 == ALU_SRL_SRA) && bit(instr, 28) && bit(aluReg, 31);
+            if (TWOLEVEL_SHIFTER && bits(aluShamt, 4, 2) != 0) {
+                // Shift by 4
+                aluShamt = aluShamt - 4;
+                aluReg = (funct3 == ALU_SLL) ? (aluReg << 4) :
+                         ((sign_bit ? 0xF0000000u : 0u) | (aluReg >> 4));
+            } else {
+                // Shift by 1
+                aluShamt = aluShamt - 1;
+                aluReg = (funct3 == ALU_SLL) ? (aluReg << 1) :
+                         ((sign_bit ? 0x80000000u : 0u) | (aluReg >> 1));
+            }
+        }
+
+        // Update register file
+        if (writeBack && rdId != 0) {
+            registerFile[rdId] = writeBackData;
+        }
+
+        // Instruction register (no register is written in WAIT_INSTR)
+        bool latched = (state == WAIT_INSTR && !mem_rbusy_in());
+        if (latched) {
+            latch_instruction();
+        }
+
+        if (state == EXECUTE) {
+            update_pc();
+        }
+
+        // State machine
+        State old_state = state;
+        update_state();
+
+        // Instruction trace (compiled out without NRV_TRACE)
+        if constexpr (QuarkTraceSink::enabled) {
+            if (old_state == EXECUTE) {
+                trace_pending = true;
+            }
+            if (state == FETCH_INSTR && trace_pending) {
+                bool rdWritten = writeBack && rdId != 0;
+                trace.record(cycles.to_uint(), trace_pc, full_instr,
+                             rdWritten ? rdId : 0, rdWritten ? writeBackData : 0);
+                trace_pending = false;
+            }
+        }
+
+        return latched ? EDGE_INSTR : (state != old_state) ? EDGE_STATE : EDGE_NONE;
+    }
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::decode_process() {
+    decode_instruction();
+    instr_decoded.notify();
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::alu_process() {
+    compute_alu();
+    compute_branch_predicate();
+    compute_pc_targets();
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::memory_port_process() {
+    compute_memory_access();
+
+    // Request memory read for instruction fetch or load operations
+    bool rstrb = (state == FETCH_INSTR) || (state == EXECUTE && isLoad);
+
+    uint32_t wmask = (state == EXECUTE && isStore) ? STORE_wmask : 0u;
+
+#ifdef NRV_DECODE_CACHE
+    if (state == EXECUTE && isStore) {
+        decode_cache_invalidate(loadstore_addr);
+    }
+#endif
+
+    uint32_t addr = (state == WAIT_INSTR || state == FETCH_INSTR ||
+                     (state == EXECUTE && !isLoad && !isStore)) ?
+                    PC.value : loadstore_addr;
+
+    if (stepped) {
+        pins.mem_rstrb = rstrb;
+        pins.mem_wmask = wmask;
+        pins.mem_addr = addr;
+        pins.mem_wdata = rs2;
+    } else {
+        mem_rstrb = rstrb;
+        mem_wmask = sc_uint<4>(wmask);
+        mem_addr = sc_uint<32>(addr);
+        mem_wdata = sc_uint<32>(rs2);
+    }
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::set_memory(FemtoRV32_MemoryFunc func) {
+    stepped = true;
+    memory = std::move(func);
+
+    // Outputs out of construction (memory_port_process is initialized
+    // by the scheduler), and the inputs of the first edge
+    memory_port_process();
+    memory(pins);
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::step(uint64_t n) {
+    for (uint64_t i = 0; i < n; ++i) {
+        // The processes notified by clock_process, in the order of
+        // the delta cycles
+        Edge edge = clock_edge();
+        if (edge == EDGE_INSTR) {
+            decode_instruction();
+            alu_process();
+        }
+        if (edge != EDGE_NONE) {
+            memory_port_process();
+        }
+        memory(pins);
+    }
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::compute_control() {
+    writeBack = !(isBranch || isStore) &&
+                (state == EXECUTE || state == WAIT_ALU_OR_MEM);
+
+    aluWr = (state == EXECUTE && isALU);
+
+    aluBusy = (aluShamt != 0);
+
+    if constexpr (IS_IO_ADDR) {
+        needToWait = isLoad ||
+                     (isStore && is_io_addr(mem_addr_out())) ||
+                     (isALU && funct3IsShift);
+    } else {
+        needToWait = isLoad || isStore || (isALU && funct3IsShift);
+    }
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::compute_writeback() {
+    // Load data processing (mem_rdata is only used here, at the edge)
+    uint32_t rdata = mem_rdata_in();
+    LOAD_halfword = bit(loadstore_addr, 1) ? (rdata >> 16) : (rdata & 0xFFFF);
+    LOAD_byte     = bit(loadstore_addr, 0) ? (LOAD_halfword >> 8) : (LOAD_halfword & 0xFF);
+    LOAD_sign     = !bit(instr, 12) &&
+                    (mem_byteAccess ? bit(LOAD_byte, 7) : bit(LOAD_halfword, 15));
+    LOAD_data     = mem_byteAccess     ? ((uint32_t(LOAD_sign) << 8)  | LOAD_byte) :
+                    mem_halfwordAccess ? ((uint32_t(LOAD_sign) << 16) | LOAD_halfword) :
+                    rdata;
+
+    // Shifts read the shift register as it is at the edge
+    if (funct3IsShift) {
+        aluOut = aluReg;
+    }
+
+    writeBackData = (isSYSTEM ? cycles.value : 0u) |
+                    (isLUI ? Uimm : 0u) |
+                    (isALU ? aluOut : 0u) |
+                    (isAUIPC ? PCplusImm : 0u) |
+                    ((isJALR || isJAL) ? PCplus4 : 0u) |
+                    (isLoad ? LOAD_data : 0u);
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::latch_instruction() {
+    full_instr = mem_rdata_in();
+
+    // Read register values
+    rs1 = registerFile[bits(full_instr, 19, 15)];
+    rs2 = registerFile[bits(full_instr, 24, 20)];
+
+    if constexpr (QuarkTraceSink::enabled) {
+        trace_pc = PC;
+    }
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::decode_instruction() {
+    uint32_t instruction = full_instr;
+
+#ifdef NRV_DECODE_CACHE
+    DecodedInstr& entry = decode_cache[(PC >> 2) & (NRV_DECODE_CACHE_SIZE - 1)];
+    if (entry.valid && entry.pc == PC && entry.word == instruction) {
+        ++decode_cache_hits;
+    } else {
+        ++decode_cache_misses;
+        decode_word(instruction, entry);
+        entry.valid = true;
+        entry.pc = PC;
+    }
+    load_decoded(entry);
+#else
+    DecodedInstr decoded;
+    decode_word(instruction, decoded);
+    load_decoded(decoded);
+#endif
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::decode_word(uint32_t instruction, DecodedInstr& d) {
+    d.word = instruction;
+
+    // Extract instruction fields
+    d.rdId   = bits(instruction, 11, 7);
+    d.rs1Id  = bits(instruction, 19, 15);
+    d.rs2Id  = bits(instruction, 24, 20);
+    d.funct3 = bits(instruction, 14, 12);
+    d.opcode = bits(instruction, 6, 0);
+    d.instr  = instruction >> 2; // Bits 0,1 ignored
+    d.full_instr = instruction;
+
+    // Decode instruction types
+    uint32_t op = bits(instruction, 6, 2);
+    d.isLoad   = (op == 0x00);
+    d.isALUimm = (op == 0x04);
+    d.isStore  = (op == 0x08);
+    d.isALUreg = (op == 0x0C);
+    d.isSYSTEM = (op == 0x1C);
+    d.isJAL    = bit(instruction, 3);
+    d.isJALR   = (op == 0x19);
+    d.isLUI    = (op == 0x0D);
+    d.isAUIPC  = (op == 0x05);
+    d.isBranch = (op == 0x18);
+
+    d.isALU = d.isALUimm || d.isALUreg;
+    d.funct3IsShift = (d.funct3 == ALU_SLL) || (d.funct3 == ALU_SRL_SRA);
+
+    // Memory access type
+    d.mem_byteAccess     = (bits(d.instr, 13, 12) == 0);
+    d.mem_halfwordAccess = (bits(d.instr, 13, 12) == 1);
+
+    // The immediates only depend on the instruction word, computing
+    // them once here is equivalent to recomputing them at each evaluation
+    compute_immediates(d);
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::load_decoded(const DecodedInstr& d) {
+    rdId = d.rdId; rs1Id = d.rs1Id; rs2Id = d.rs2Id;
+    funct3 = d.funct3; opcode = d.opcode;
+    instr = d.instr; full_instr = d.full_instr;
+
+    Uimm = d.Uimm; Iimm = d.Iimm; Simm = d.Simm; Bimm = d.Bimm; Jimm = d.Jimm;
+
+    isLoad = d.isLoad; isALUimm = d.isALUimm; isStore = d.isStore;
+    isALUreg = d.isALUreg; isSYSTEM = d.isSYSTEM;
+    isJAL = d.isJAL; isJALR = d.isJALR; isLUI = d.isLUI; isAUIPC = d.isAUIPC;
+    isBranch = d.isBranch; isALU = d.isALU;
+    funct3IsShift = d.funct3IsShift;
+    mem_byteAccess = d.mem_byteAccess; mem_halfwordAccess = d.mem_halfwordAccess;
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::compute_immediates(DecodedInstr& d) {
+    uint32_t full = d.full_instr;
+    uint32_t op = full & 0x7F;
+
+    // U-type immediate, with the same handling of truncated U-type
+    // instructions as the sc_uint model
+    if ((op == 0x17 || op == 0x37) && full < 0x10000) {
+        d.Uimm = ((full >> 12) & 0xF) << 12;
+    } else {
+        d.Uimm = full & 0xFFFFF000u;
+    }
+
+    // I-type immediate
+    d.Iimm = (bit(full, 31) ? 0xFFFFF000u : 0u) | (full >> 20);
+
+    // S, B and J-type immediates: bit-exact copies of the sc_uint
+    // concatenations in femtorv32_quark.cpp
+    d.Simm = (uint32_t(bit(d.instr, 29)) << 11) |
+             (bits(d.instr, 28, 23) << 5) |
+              bits(d.instr, 9, 5);
+
+    d.Bimm = (uint32_t(bit(d.instr, 29)) << 12) |
+             (uint32_t(bit(d.instr, 5)) << 11) |
+             (bits(d.instr, 28, 23) << 5) |
+             (bits(d.instr, 9, 6) << 1);
+
+    d.Jimm = (uint32_t(bit(d.instr, 29)) << 20) |
+             (bits(d.instr, 17, 10) << 12) |
+             (uint32_t(bit(d.instr, 18)) << 11) |
+             (bits(d.instr, 28, 19) << 1);
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::compute_alu() {
+    // ALU inputs
+    aluIn1 = rs1;
+    aluIn2 = (isALUreg || isBranch) ? rs2 : Iimm;
+
+    // Adder
+    aluPlus = aluIn1 + aluIn2;
+
+    // Single 33 bits subtract for subtraction and all comparisons
+    aluMinus = (uint64_t(aluIn1) - uint64_t(aluIn2)) & 0x1FFFFFFFFull;
+    bool minus32 = (aluMinus >> 32) & 1u;
+    LT  = (bit(aluIn1, 31) ^ bit(aluIn2, 31)) ? bit(aluIn1, 31) : minus32;
+    LTU = minus32;
+    EQ  = (uint32_t(aluMinus) == 0);
+
+    // ALU output
+    switch (funct3) {
+        case ALU_ADD_SUB:
+            aluOut = (bit(instr, 28) && bit(instr, 3)) ? uint32_t(aluMinus) : aluPlus;
+            break;
+        case ALU_SLT:     aluOut = LT ? 1 : 0;          break;
+        case ALU_SLTU:    aluOut = LTU ? 1 : 0;         break;
+        case ALU_XOR:     aluOut = aluIn1 ^ aluIn2;     break;
+        case ALU_OR:      aluOut = aluIn1 | aluIn2;     break;
+        case ALU_AND:     aluOut = aluIn1 & aluIn2;     break;
+        case ALU_SLL:
+        case ALU_SRL_SRA: aluOut = aluReg;              break;
+        default:          aluOut = 0;                   break;
+    }
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::compute_branch_predicate() {
+    predicate = (funct3 == BRANCH_BEQ && EQ) ||
+                (funct3 == BRANCH_BNE && !EQ) ||
+                (funct3 == BRANCH_BLT && LT) ||
+                (funct3 == BRANCH_BGE && !LT) ||
+                (funct3 == BRANCH_BLTU && LTU) ||
+                (funct3 == BRANCH_BGEU && !LTU);
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::compute_memory_access() {
+    // Load/store address
+    loadstore_addr = (rs1 & ADDR_MASK) + ((isStore ? Simm : Iimm) & ADDR_MASK);
+
+    // Store write mask
+    if (mem_byteAccess) {
+        STORE_wmask = 1u << (loadstore_addr & 3);
+    } else if (mem_halfwordAccess) {
+        STORE_wmask = bit(loadstore_addr, 1) ? 0xC : 0x3;
+    } else {
+        STORE_wmask = 0xF;
+    }
+}
+
+// Functional mode: does all the steps of the shifter at once
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::functional_shift() {
+    uint32_t shamt = aluShamt;
+    uint32_t nb_steps = TWOLEVEL_SHIFTER ? (shamt >> 2) + (shamt & 3) : shamt;
+    if (funct3 == ALU_SLL) {
+        aluReg = aluReg << shamt;
+    } else if (bit(instr, 28)) {
+        aluReg = uint32_t(int32_t(aluReg) >> shamt);
+    } else {
+        aluReg = aluReg >> shamt;
+    }
+    aluShamt = 0;
+    cycles = cycles + nb_steps;
+    perf.cycles += nb_steps;
+    perf.stalls += nb_steps;
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::update_state() {
+    switch (state) {
+        case WAIT_INSTR:
+            if (!mem_rbusy_in()) {
+                state = EXECUTE;
+            } else {
+                perf.stalls++;
+            }
+            break;
+
+        case EXECUTE:
+            state = needToWait ? WAIT_ALU_OR_MEM : FETCH_INSTR;
+            perf.instret++;
+            break;
+
+        case WAIT_ALU_OR_MEM:
+            if (!aluBusy && !mem_rbusy_in() && !mem_wbusy_in()) {
+                state = FETCH_INSTR;
+            } else {
+                perf.stalls++;
+            }
+            break;
+
+        case FETCH_INSTR:
+        default:
+            state = WAIT_INSTR;
+            break;
+    }
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::compute_pc_targets() {
+    PCplus4 = PC + 4;
+
+    // Compute PC + immediate
+    uint32_t imm = isJAL ? Jimm : isAUIPC ? Uimm : Bimm;
+    PCplusImm = PC + (imm & ADDR_MASK);
+
+    jumpToPCplusImm = isJAL || (isBranch && predicate);
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::update_pc() {
+    if (isJALR) {
+        PC = aluPlus & ADDR_MASK & ~1u;
+    } else if (jumpToPCplusImm) {
+        PC = PCplusImm;
+    } else {
+        PC = PCplus4;
+    }
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::update_registers() {
+    // Register file updates are handled in clock_process
+}
+
+#ifdef NRV_DECODE_CACHE
+template <QUARK_TEMPLATE_PARAMS>
+void FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::decode_cache_invalidate(uint32_t addr) {
+    DecodedInstr& entry = decode_cache[(addr >> 2) & (NRV_DECODE_CACHE_SIZE - 1)];
+    if (entry.pc == (addr & ~3u)) {
+        entry.valid = false;
+    }
+}
+#endif
+
+template <QUARK_TEMPLATE_PARAMS>
+uint32_t FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::sign_extend(uint32_t value, int bits) {
+    return bit(value, bits - 1) ? (value | (0xFFFFFFFFu << bits)) : value;
+}
+
+template <QUARK_TEMPLATE_PARAMS>
+bool FemtoRV32_QuarkT<QUARK_TEMPLATE_ARGS>::is_io_addr(uint32_t /* addr */) {
+    // Default implementation - can be overridden
+    return false;
+}
+
+// Configurations compiled with the model (femtorv32_quark.h)
+template struct FemtoRV32_QuarkT<DEFAULT_RESET_ADDR, DEFAULT_ADDR_WIDTH, false, DEFAULT_IS_IO_ADDR>;
+template struct FemtoRV32_QuarkT<DEFAULT_RESET_ADDR, DEFAULT_ADDR_WIDTH, true, DEFAULT_IS_IO_ADDR>;
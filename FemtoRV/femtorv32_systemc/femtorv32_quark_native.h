@@ -0,0 +1,255 @@
+/*******************************************************************/
+// FemtoRV32 Quark - SystemC Implementation, "native" fast path
+//
+// Same module name, ports and cycle behavior as femtorv32_quark.h,
+// but all the internal state and arithmetic uses plain uint32_t.
+// sc_uint<> values only appear at the port boundary (mem_addr,
+// mem_wdata, mem_wmask, mem_rdata).
+//
+// Selected at compile time with -DNRV_NATIVE_MODEL (see the
+// *-native targets in the Makefile). Do not include directly,
+// include femtorv32_quark.h instead.
+//
+// The processes, their sensitivity lists and the order in which
+// the helper functions are evaluated are kept identical to the
+// sc_uint model, so that both models produce exactly the same
+// cycle-by-cycle behavior (and the same results in tests/). The
+// decoded instruction cache only replaces the work of decode_process.
+/*******************************************************************/
+
+#ifndef FEMTORV32_QUARK_NATIVE_H
+#define FEMTORV32_QUARK_NATIVE_H
+
+#ifndef FEMTORV32_QUARK_H
+#error "include femtorv32_quark.h instead of femtorv32_quark_native.h"
+#endif
+
+#include <cstdint>
+
+// Number of entries of the (direct-mapped) decoded instruction cache,
+// enabled with -DNRV_DECODE_CACHE. Must be a power of two.
+#ifndef NRV_DECODE_CACHE_SIZE
+#define NRV_DECODE_CACHE_SIZE 1024
+#endif
+
+// A plain 32-bit word with the to_uint() accessor of sc_uint<32>,
+// so that testbenches that peek at PC / registerFile compile with
+// both models.
+struct NativeWord {
+    uint32_t value;
+    NativeWord(uint32_t v = 0) : value(v) {}
+    operator uint32_t() const { return value; }
+    uint32_t to_uint() const { return value; }
+};
+
+// Everything that decode_instruction() derives from the instruction
+// word (fields, instruction type flags, access width and immediates).
+struct DecodedInstr {
+    bool valid = false;
+    uint32_t pc = 0;          // tag: address of the instruction
+    uint32_t word = 0;        // tag: raw instruction word
+    uint32_t instr = 0, full_instr = 0;
+    uint32_t rdId = 0, rs1Id = 0, rs2Id = 0, funct3 = 0, opcode = 0;
+    uint32_t Uimm = 0, Iimm = 0, Simm = 0, Bimm = 0, Jimm = 0;
+    bool isLoad = false, isALUimm = false, isStore = false, isALUreg = false, isSYSTEM = false;
+    bool isJAL = false, isJALR = false, isLUI = false, isAUIPC = false, isBranch = false, isALU = false;
+    bool funct3IsShift = false, mem_byteAccess = false, mem_halfwordAccess = false;
+};
+
+template <uint32_t RESET_ADDR = DEFAULT_RESET_ADDR,
+          int ADDR_WIDTH = DEFAULT_ADDR_WIDTH,
+          bool TWOLEVEL_SHIFTER = DEFAULT_TWOLEVEL_SHIFTER,
+          bool IS_IO_ADDR = DEFAULT_IS_IO_ADDR>
+struct FemtoRV32_QuarkT : public FemtoRV32_Core {
+    static_assert(ADDR_WIDTH >= 2 && ADDR_WIDTH <= 32, "ADDR_WIDTH must be in [2, 32]");
+
+    // Ports: clk, reset and the memory interface (femtorv32_core.h)
+
+    // Constructor
+    FemtoRV32_QuarkT(sc_module_name name) :
+        FemtoRV32_Core(name),
+        PC(0),
+        state(WAIT_ALU_OR_MEM),
+        cycles(0),
+        registerFile(32, 0),
+        aluReg(0),
+        aluShamt(0)
+#ifdef NRV_DECODE_CACHE
+        , decode_cache(NRV_DECODE_CACHE_SIZE)
+#endif
+    {
+        // Register processes (same order and sensitivity as the sc_uint model)
+        SC_METHOD(clock_process);
+        sensitive << clk.pos();
+
+        SC_METHOD(decode_process);
+        sensitive << instr_latched;
+        dont_initialize();
+
+        SC_METHOD(alu_process);
+        sensitive << instr_decoded;
+        dont_initialize();
+
+        SC_METHOD(memory_port_process);
+        sensitive << state_changed << instr_decoded;
+    }
+
+    // (1 << ADDR_WIDTH) - 1
+    static constexpr uint32_t ADDR_MASK =
+        (ADDR_WIDTH >= 32) ? 0xFFFFFFFFu : ((1u << (ADDR_WIDTH & 31)) - 1u);
+
+    // Internal signals and registers
+    NativeWord PC;
+    uint32_t instr = 0;       // 30 bits (bits 0,1 ignored in RV32I)
+    uint32_t full_instr = 0;  // Full 32-bit instruction for immediate decoding
+    State state;
+    NativeWord cycles;
+
+    // Register file
+    std::vector<NativeWord> registerFile;
+
+    // ALU registers
+    uint32_t aluReg;
+    uint32_t aluShamt;        // 5 bits
+
+    // Functional mode: shifts complete in one evaluation instead of
+    // one (or four, TWOLEVEL_SHIFTER) bit per cycle, and the cycle
+    // counter is advanced by the number of cycles they would have taken.
+    // Register values are the same, but the timing of the memory
+    // interface is not cycle-accurate. Off by default.
+    bool functional_mode = false;
+
+    // Cycle-stepping API: the same processes, called directly instead of
+    // through the SystemC scheduler (no sc_signal, no delta cycle), for
+    // unit tests and co-simulation. set_memory() detaches the core from
+    // its ports (they are neither read nor written and need not be bound,
+    // do not sc_start() a design that contains the core), then each cycle
+    // of step() is a rising edge of clk: the clocked process, the
+    // combinational processes it would have triggered, and the memory
+    // callback. The core is held in reset while pins.reset is false.
+    void set_memory(FemtoRV32_MemoryFunc func);
+    void step(uint64_t n = 1);
+    FemtoRV32_Pins pins;
+    bool stepped = false;        // driven by step(), not by the ports
+    FemtoRV32_MemoryFunc memory;
+
+    // Instruction trace, one record per retired instruction (no-op
+    // unless compiled with -DNRV_TRACE, see quark_trace.h)
+    QuarkTraceSink trace;
+    uint32_t trace_pc = 0;       // address of the instruction being executed
+    bool trace_pending = false;  // instruction executed, not yet traced
+
+    // Decoded instruction fields
+    uint32_t rdId = 0;
+    uint32_t rs1Id = 0;
+    uint32_t rs2Id = 0;
+    uint32_t funct3 = 0;
+    uint32_t opcode = 0;
+    uint32_t rs1 = 0;         // read from the register file with the instruction
+    uint32_t rs2 = 0;
+
+    // Immediate values
+    uint32_t Uimm = 0, Iimm = 0, Simm = 0, Bimm = 0, Jimm = 0;
+
+    // Instruction type flags
+    bool isLoad = false, isALUimm = false, isStore = false, isALUreg = false, isSYSTEM = false;
+    bool isJAL = false, isJALR = false, isLUI = false, isAUIPC = false, isBranch = false, isALU = false;
+
+    // ALU signals
+    uint32_t aluIn1 = 0, aluIn2 = 0, aluOut = 0;
+    uint32_t aluPlus = 0;
+    uint64_t aluMinus = 0;    // 33 bits
+    bool LT = false, LTU = false, EQ = false;
+    bool aluBusy = false, aluWr = false;
+    bool funct3IsShift = false;
+
+    // Branch predicate
+    bool predicate = false;
+
+    // Memory access signals
+    bool mem_byteAccess = false, mem_halfwordAccess = false;
+    uint32_t loadstore_addr = 0;
+    uint32_t LOAD_data = 0;
+    uint32_t LOAD_halfword = 0;
+    uint32_t LOAD_byte = 0;
+    bool LOAD_sign = false;
+    uint32_t STORE_wmask = 0;
+
+    // Control signals
+    bool writeBack = false;
+    bool jumpToPCplusImm = false;
+    bool needToWait = false;
+
+    // Address computation
+    uint32_t PCplus4 = 0, PCplusImm = 0;
+
+    // Write-back data
+    uint32_t writeBackData = 0;
+
+#ifdef NRV_DECODE_CACHE
+    // Decoded instruction cache, indexed and tagged by PC. An entry is
+    // also tagged by the raw instruction word, so that it can never be
+    // used for a stale instruction (for instance if the testbench writes
+    // to memory behind the back of the processor). Stores from the
+    // processor invalidate the entry of the word they write.
+    std::vector<DecodedInstr> decode_cache;
+    uint64_t decode_cache_hits = 0;
+    uint64_t decode_cache_misses = 0;
+
+    double decode_cache_hit_rate() const {
+        uint64_t total = decode_cache_hits + decode_cache_misses;
+        return total ? double(decode_cache_hits) / double(total) : 0.0;
+    }
+
+    void decode_cache_invalidate(uint32_t addr);
+#endif
+
+    // Notified by clock_process (one delta cycle after the edge)
+    sc_event instr_latched;   // instruction register loaded
+    sc_event state_changed;   // other changes of state
+    sc_event instr_decoded;   // by decode_process
+
+    // What a rising edge changed (the processes to run after it)
+    enum Edge { EDGE_NONE, EDGE_STATE, EDGE_INSTR };
+
+    // Process declarations
+    void clock_process();        // registers, on the rising edge of clk
+    Edge clock_edge();           // body of clock_process, no notification
+    void decode_process();       // fields, flags, immediates
+    void alu_process();          // ALU, branch predicate, PC targets
+    void memory_port_process();  // mem_addr, mem_wdata, mem_wmask, mem_rstrb
+
+    // Memory interface: the ports, or pins when driven by step()
+    bool reset_in() const { return stepped ? pins.reset : reset.read(); }
+    bool mem_rbusy_in() const { return stepped ? pins.mem_rbusy : mem_rbusy.read(); }
+    bool mem_wbusy_in() const { return stepped ? pins.mem_wbusy : mem_wbusy.read(); }
+    uint32_t mem_rdata_in() const {
+        return stepped ? pins.mem_rdata : mem_rdata.read().to_uint();
+    }
+    uint32_t mem_addr_out() const {
+        return stepped ? pins.mem_addr : mem_addr.read().to_uint();
+    }
+
+    // Helper functions
+    void latch_instruction();
+    void decode_instruction();
+    void decode_word(uint32_t instruction, DecodedInstr& d);
+    void compute_immediates(DecodedInstr& d);
+    void load_decoded(const DecodedInstr& d);
+    void compute_alu();
+    void compute_branch_predicate();
+    void compute_pc_targets();
+    void compute_memory_access();
+    void compute_control();
+    void compute_writeback();
+    void update_state();
+    void update_pc();
+    void update_registers();
+    void functional_shift();
+
+    // Utility functions
+    uint32_t sign_extend(uint32_t value, int bits);
+    bool is_io_addr(uint32_t addr);
+};
+
+#endif // FEMTORV32_QUARK_NATIVE_H
@@ -0,0 +1,99 @@
+/*******************************************************************/
+// Page-allocated RAM for the SystemC test harnesses.
+/*******************************************************************/
+
+#include "harness_memory.h"
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/mman.h>
+#include <unistd.h>
+
+extern "C" {
+#include <femto_elf.h>
+}
+
+HarnessMemory::HarnessMemory(size_t size_in_bytes) {
+    size_t page = size_t(sysconf(_SC_PAGESIZE));
+    nb_bytes = (size_in_bytes + page - 1) / page * page;
+    // Zero-filled pages, allocated by the kernel on first access
+    void* p = mmap(nullptr, nb_bytes, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED) {
+        perror("HarnessMemory: mmap");
+        exit(1);
+    }
+    base = static_cast<uint8_t*>(p);
+}
+
+HarnessMemory::~HarnessMemory() {
+    munmap(base, nb_bytes);
+}
+
+uint32_t HarnessMemory::read_word(uint32_t addr) const {
+    addr &= ~3u;
+    if (size_t(addr) + 4 > nb_bytes) {
+        return 0;
+    }
+    // Little-endian host assumed (like the RISC-V)
+    uint32_t result;
+    memcpy(&result, base + addr, 4);
+    return result;
+}
+
+void HarnessMemory::write_word(uint32_t addr, uint32_t data, uint32_t wmask) {
+    addr &= ~3u;
+    if (size_t(addr) + 4 > nb_bytes) {
+        return;
+    }
+    for (int i = 0; i < 4; i++) {
+        if (wmask & (1u << i)) {
+            base[addr + i] = uint8_t(data >> (i * 8));
+        }
+    }
+}
+
+void HarnessMemory::load(const std::vector<uint32_t>& words, uint32_t offset) {
+    if (size_t(offset) + words.size() * 4 > nb_bytes) {
+        fprintf(stderr, "HarnessMemory: program does not fit in memory\n");
+        exit(1);
+    }
+    memcpy(base + offset, words.data(), words.size() * 4);
+}
+
+bool HarnessMemory::load_elf(const char* filename, std::string& error,
+                             uint32_t* text_address, uint32_t* max_address) {
+    Elf32Info info;
+    // First pass: get the extent of the segments, so that a too large
+    // image does not write outside the mapping
+    int status = elf32_stat(filename, &info);
+    if (status == ELF32_OK) {
+        if (info.max_address > nb_bytes) {
+            error = std::string(filename) + ": segments end at " +
+                    std::to_string(info.max_address) + ", memory size is " +
+                    std::to_string(nb_bytes) + " bytes";
+            return false;
+        }
+        status = elf32_load_at(filename, &info, base);
+    }
+    switch (status) {
+        case ELF32_OK:
+            break;
+        case ELF32_FILE_NOT_FOUND:
+            error = std::string(filename) + ": file not found";
+            return false;
+        case ELF32_HEADER_SIZE_MISMATCH:
+            error = std::string(filename) + ": not a 32-bit ELF file";
+            return false;
+        default:
+            error = std::string(filename) + ": read error";
+            return false;
+    }
+    if (text_address != nullptr) {
+        *text_address = info.text_address;
+    }
+    if (max_address != nullptr) {
+        *max_address = info.max_address;
+    }
+    return true;
+}
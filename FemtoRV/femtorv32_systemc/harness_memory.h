@@ -0,0 +1,55 @@
+/*******************************************************************/
+// Page-allocated RAM for the SystemC test harnesses.
+//
+// The memory is an anonymous mmap(): pages are only allocated when
+// they are touched, so that a multi-megabyte RAM costs nothing until
+// the program uses it. ELF executables are loaded with femto_elf.c
+// (FIRMWARE/LIBFEMTORV32, compiled with -DSTANDALONE_FEMTOELF), that
+// reads the sections straight into the mapping (no intermediate
+// buffer), so that large images start instantly.
+//
+// Linux / POSIX only (mmap).
+/*******************************************************************/
+
+#ifndef HARNESS_MEMORY_H
+#define HARNESS_MEMORY_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+class HarnessMemory {
+public:
+    // size_in_bytes is rounded up to a multiple of the page size
+    explicit HarnessMemory(size_t size_in_bytes);
+    ~HarnessMemory();
+
+    HarnessMemory(const HarnessMemory&) = delete;
+    HarnessMemory& operator=(const HarnessMemory&) = delete;
+
+    uint8_t* data() { return base; }
+    const uint8_t* data() const { return base; }
+    size_t size() const { return nb_bytes; }
+
+    // Word accesses (addr is rounded down to a multiple of 4). Reads
+    // outside the memory return 0, writes outside the memory are ignored.
+    uint32_t read_word(uint32_t addr) const;
+    void write_word(uint32_t addr, uint32_t data, uint32_t wmask = 0xF);
+
+    // Copies 32-bit words to memory, starting from byte offset 'offset'
+    void load(const std::vector<uint32_t>& words, uint32_t offset = 0);
+
+    // Loads a statically linked ELF executable. Returns false and sets
+    // 'error' if the file cannot be read or does not fit in memory.
+    // text_address, if non-null, receives the address of the text segment,
+    // and max_address the highest address used by the segments.
+    bool load_elf(const char* filename, std::string& error,
+                  uint32_t* text_address = nullptr, uint32_t* max_address = nullptr);
+
+private:
+    uint8_t* base;
+    size_t nb_bytes;
+};
+
+#endif // HARNESS_MEMORY_H
@@ -0,0 +1,261 @@
+#include "memory_latency.h"
+#include <iomanip>
+#include <sstream>
+#include <cstdlib>
+
+static bool is_power_of_two(uint32_t x) {
+    return x != 0 && (x & (x - 1)) == 0;
+}
+
+// Splits "a,b,c" into integers (decimal or 0x hexadecimal)
+static bool parse_arguments(const std::string& args, std::vector<uint32_t>& values) {
+    values.clear();
+    if (args.empty()) {
+        return true;
+    }
+    std::istringstream in(args);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        char* end = nullptr;
+        unsigned long value = strtoul(item.c_str(), &end, 0);
+        if (item.empty() || *end != '\0' || value > 0xFFFFFFFFul) {
+            return false;
+        }
+        values.push_back(uint32_t(value));
+    }
+    return true;
+}
+
+std::unique_ptr<MemoryLatency> MemoryLatency::create(const std::string& spec, std::string& error) {
+    size_t colon = spec.find(':');
+    std::string kind = spec.substr(0, colon);
+    std::vector<uint32_t> v;
+    if (!parse_arguments(colon == std::string::npos ? "" : spec.substr(colon + 1), v)) {
+        error = "invalid memory latency arguments: " + spec;
+        return nullptr;
+    }
+    if (kind == "fixed" && (v.size() == 1 || v.size() == 2)) {
+        return std::make_unique<FixedLatency>(v[0], v.size() > 1 ? v[1] : v[0]);
+    }
+    if (kind == "sdram" && v.size() >= 2 && v.size() <= 4) {
+        uint32_t row_bytes = v.size() > 2 ? v[2] : 1024;
+        uint32_t banks = v.size() > 3 ? v[3] : 4;
+        if (!is_power_of_two(row_bytes) || !is_power_of_two(banks)) {
+            error = "SDRAM row size and number of banks must be powers of two: " + spec;
+            return nullptr;
+        }
+        return std::make_unique<SDRAMLatency>(v[0], v[1], row_bytes, banks);
+    }
+    if (kind == "flash" && v.size() >= 2 && v.size() <= 5) {
+        uint32_t line_bytes = v.size() > 2 ? v[2] : 4;
+        if (!is_power_of_two(line_bytes) || line_bytes < 4) {
+            error = "SPI flash line size must be a power of two, at least 4: " + spec;
+            return nullptr;
+        }
+        return std::make_unique<SPIFlashLatency>(
+            v[0], v[1], line_bytes, v.size() > 3 ? v[3] : 0, v.size() > 4 ? v[4] : 0
+        );
+    }
+    if (kind == "cache" && v.size() == 4) {
+        if (!is_power_of_two(v[0]) || !is_power_of_two(v[1]) || !is_power_of_two(v[2]) ||
+            v[2] < 4 || uint64_t(v[1]) * v[2] > v[0]) {
+            error = "cache size, ways and line size must be powers of two, with at least one set: " + spec;
+            return nullptr;
+        }
+        return std::make_unique<CacheLatency>(v[0], v[1], v[2], v[3]);
+    }
+    error = "invalid memory latency model: " + spec
+          + " (fixed:R[,W], sdram:H,M[,row_bytes[,banks]], flash:S,W[,line_bytes[,base[,size]]],"
+          + " cache:S,A,L,M)";
+    return nullptr;
+}
+
+void MemoryLatency::clear() {
+    for (int i = 0; i < NB_ACCESS_TYPES; i++) {
+        accesses[i] = 0;
+        wait_cycles[i] = 0;
+    }
+    remaining_ = 0;
+    busy_type_ = ACCESS_FETCH;
+}
+
+const char* MemoryLatency::access_type_name(MemoryAccessType type) {
+    switch (type) {
+        case ACCESS_FETCH: return "fetch";
+        case ACCESS_LOAD:  return "load";
+        case ACCESS_STORE: return "store";
+        default: break;
+    }
+    return "?";
+}
+
+void MemoryLatency::print_stats(std::ostream& out) const {
+    out << "Memory: " << description() << std::endl;
+    for (int i = 0; i < NB_ACCESS_TYPES; i++) {
+        MemoryAccessType type = MemoryAccessType(i);
+        double average = accesses[i] ? double(wait_cycles[i]) / double(accesses[i]) : 0.0;
+        out << "  " << std::left << std::setw(6) << access_type_name(type) << std::right
+            << std::setw(12) << accesses[i] << " accesses "
+            << std::setw(14) << wait_cycles[i] << " wait cycles ("
+            << std::fixed << std::setprecision(2) << average << std::defaultfloat
+            << " per access)" << std::endl;
+    }
+    print_model_stats(out);
+}
+
+/*******************************************************************/
+
+std::string FixedLatency::description() const {
+    std::ostringstream out;
+    out << "fixed latency, " << read_cycles_ << " cycles per read, "
+        << write_cycles_ << " per write";
+    return out.str();
+}
+
+uint32_t FixedLatency::latency(MemoryAccessType type, uint32_t) {
+    return (type == ACCESS_STORE) ? write_cycles_ : read_cycles_;
+}
+
+/*******************************************************************/
+
+SDRAMLatency::SDRAMLatency(uint32_t hit_cycles, uint32_t miss_cycles, uint32_t row_bytes, uint32_t banks) :
+    hit_cycles_(hit_cycles), miss_cycles_(miss_cycles), row_bytes_(row_bytes),
+    open_row_(banks, NO_ROW) {
+}
+
+void SDRAMLatency::clear() {
+    MemoryLatency::clear();
+    row_hits = 0;
+    row_misses = 0;
+    open_row_.assign(open_row_.size(), NO_ROW);
+}
+
+std::string SDRAMLatency::description() const {
+    std::ostringstream out;
+    out << "SDRAM, " << hit_cycles_ << " cycles on an open row, " << miss_cycles_
+        << " otherwise, " << open_row_.size() << " banks of " << row_bytes_ << " bytes rows";
+    return out.str();
+}
+
+uint32_t SDRAMLatency::latency(MemoryAccessType, uint32_t addr) {
+    uint32_t line = addr / row_bytes_;
+    uint32_t bank = line & uint32_t(open_row_.size() - 1);
+    uint32_t row = line / uint32_t(open_row_.size());
+    if (open_row_[bank] == row) {
+        row_hits++;
+        return hit_cycles_;
+    }
+    open_row_[bank] = row;
+    row_misses++;
+    return miss_cycles_;
+}
+
+void SDRAMLatency::print_model_stats(std::ostream& out) const {
+    uint64_t total = row_hits + row_misses;
+    out << "  row hits " << row_hits << ", misses " << row_misses << " ("
+        << std::fixed << std::setprecision(1)
+        << (total ? 100.0 * double(row_hits) / double(total) : 0.0)
+        << std::defaultfloat << "% hits)" << std::endl;
+}
+
+/*******************************************************************/
+
+SPIFlashLatency::SPIFlashLatency(
+    uint32_t setup_cycles, uint32_t word_cycles, uint32_t line_bytes, uint32_t base, uint32_t size
+) : setup_cycles_(setup_cycles), word_cycles_(word_cycles), line_bytes_(line_bytes),
+    base_(base), size_(size) {
+}
+
+void SPIFlashLatency::clear() {
+    MemoryLatency::clear();
+    line_hits = 0;
+    line_misses = 0;
+    line_valid_ = false;
+}
+
+std::string SPIFlashLatency::description() const {
+    std::ostringstream out;
+    out << "SPI flash, " << line_bytes_ << " bytes line buffer, "
+        << setup_cycles_ << " + " << word_cycles_ << " cycles per word on a miss";
+    if (size_ != 0) {
+        out << ", flash at 0x" << std::hex << base_ << "-0x" << (base_ + size_ - 1) << std::dec;
+    }
+    return out.str();
+}
+
+uint32_t SPIFlashLatency::latency(MemoryAccessType type, uint32_t addr) {
+    if (type == ACCESS_STORE || (size_ != 0 && (addr - base_) >= size_)) {
+        return 0;
+    }
+    uint32_t line = addr & ~(line_bytes_ - 1);
+    if (line_valid_ && line == line_addr_) {
+        line_hits++;
+        return 0;
+    }
+    line_valid_ = true;
+    line_addr_ = line;
+    line_misses++;
+    return setup_cycles_ + word_cycles_ * (line_bytes_ / 4);
+}
+
+void SPIFlashLatency::print_model_stats(std::ostream& out) const {
+    uint64_t total = line_hits + line_misses;
+    out << "  line buffer hits " << line_hits << ", misses " << line_misses << " ("
+        << std::fixed << std::setprecision(1)
+        << (total ? 100.0 * double(line_hits) / double(total) : 0.0)
+        << std::defaultfloat << "% hits)" << std::endl;
+}
+
+/*******************************************************************/
+
+CacheLatency::CacheLatency(uint32_t size_bytes, uint32_t ways, uint32_t line_bytes, uint32_t miss_cycles) :
+    size_bytes_(size_bytes), ways_(ways), line_bytes_(line_bytes), miss_cycles_(miss_cycles),
+    nb_sets_(size_bytes / (ways * line_bytes)), lines_(size_t(size_bytes / line_bytes), INVALID) {
+}
+
+void CacheLatency::clear() {
+    MemoryLatency::clear();
+    read_hits = 0;
+    read_misses = 0;
+    lines_.assign(lines_.size(), INVALID);
+}
+
+std::string CacheLatency::description() const {
+    std::ostringstream out;
+    out << "cache, " << size_bytes_ << " bytes, " << ways_ << " way(s), " << line_bytes_
+        << " bytes lines, " << miss_cycles_ << " cycles per miss";
+    return out.str();
+}
+
+uint32_t CacheLatency::latency(MemoryAccessType type, uint32_t addr) {
+    if (type == ACCESS_STORE) {
+        return 0;
+    }
+    uint32_t line = addr / line_bytes_;
+    uint32_t* set = &lines_[size_t(line & (nb_sets_ - 1)) * ways_];
+    uint32_t way = 0;
+    while (way < ways_ && set[way] != line) {
+        way++;
+    }
+    bool hit = (way < ways_);
+    if (hit) {
+        read_hits++;
+    } else {
+        read_misses++;
+        way = ways_ - 1; // least recently used
+    }
+    // Moves the line to the front (most recently used)
+    for (; way > 0; way--) {
+        set[way] = set[way - 1];
+    }
+    set[0] = line;
+    return hit ? 0 : miss_cycles_;
+}
+
+void CacheLatency::print_model_stats(std::ostream& out) const {
+    uint64_t total = read_hits + read_misses;
+    out << "  read hits " << read_hits << ", misses " << read_misses << " ("
+        << std::fixed << std::setprecision(1)
+        << (total ? 100.0 * double(read_hits) / double(total) : 0.0)
+        << std::defaultfloat << "% hits)" << std::endl;
+}
@@ -0,0 +1,225 @@
+/*******************************************************************/
+// Memory latency models for the pin-level harnesses.
+//
+// The harnesses answer the memory requests of the core within the
+// cycle. With a latency model, each read (instruction fetch or load)
+// and each write costs a number of wait cycles, during which the
+// harness keeps mem_rbusy / mem_wbusy high, so that a firmware can be
+// timed against the memory of a board before synthesis:
+//
+//  - fixed:R[,W]   R wait cycles per read, W per write (default R);
+//  - sdram:H,M[,row_bytes[,banks]]
+//                  one open row per bank, H cycles for an access to
+//                  the open row, M when another row must be opened
+//                  (precharge + activate), default row of 1024 bytes,
+//                  4 banks (the 16-bits wide SDRAM of the ULX3S:
+//                  column = addr[9:0], bank = addr[11:10]);
+//  - flash:S,W[,line_bytes[,base[,size]]]
+//                  SPI flash read in place (MappedSPIFlash.v) through
+//                  a line buffer: a read that misses the buffer costs
+//                  the command/address/dummy phase (S cycles) plus W
+//                  cycles per 32-bits word of the line. The default
+//                  line of 4 bytes is the femtosoc (one word per
+//                  transfer, 28 + 16 = 44 cycles in dual IO mode on
+//                  the IceStick). Reads outside [base, base + size)
+//                  (default: all reads) and writes cost nothing, like
+//                  the BRAM next to the flash.
+//  - cache:S,A,L,M  set-associative cache (LRU) of S bytes, A ways and
+//                  lines of L bytes (powers of two): a read that misses
+//                  costs M cycles (the refill of the line), a hit costs
+//                  nothing. Write-through without write allocate (the
+//                  instruction and data caches of VexRiscv): the writes
+//                  go to a write buffer and cost nothing.
+//
+// Latencies are counted in cycles of the core (for the Quark, in
+// evaluations of its state machine). The models count the accesses
+// and wait cycles per access type. The IO page is not timed by the
+// models (the harness answers it in the cycle).
+//
+// No SystemC dependency.
+/*******************************************************************/
+
+#ifndef MEMORY_LATENCY_H
+#define MEMORY_LATENCY_H
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+enum MemoryAccessType {
+    ACCESS_FETCH = 0,
+    ACCESS_LOAD  = 1,
+    ACCESS_STORE = 2,
+    NB_ACCESS_TYPES = 3
+};
+
+class MemoryLatency {
+public:
+    virtual ~MemoryLatency() {}
+
+    // Creates a model from a specification (see above). Returns null
+    // and sets 'error' if the specification is invalid.
+    static std::unique_ptr<MemoryLatency> create(const std::string& spec, std::string& error);
+
+    // Wait cycles of an access, and updates the statistics
+    uint32_t access(MemoryAccessType type, uint32_t addr) {
+        uint32_t result = latency(type, addr);
+        accesses[type]++;
+        wait_cycles[type] += result;
+        return result;
+    }
+
+    // Called by the harness at each cycle of the core, with the request
+    // issued in the cycle that ends (if any). Returns true while the
+    // memory is busy, i.e. the value of mem_rbusy (or mem_wbusy if
+    // busy_type() is ACCESS_STORE) for the next cycle.
+    bool clock(bool request, MemoryAccessType type, uint32_t addr) {
+        if (remaining_ != 0) {
+            remaining_--;
+        } else if (request) {
+            remaining_ = access(type, addr);
+            busy_type_ = type;
+        }
+        return remaining_ != 0;
+    }
+
+    MemoryAccessType busy_type() const {
+        return busy_type_;
+    }
+
+    // Statistics
+    uint64_t accesses[NB_ACCESS_TYPES] = {};
+    uint64_t wait_cycles[NB_ACCESS_TYPES] = {};
+
+    uint64_t total_wait_cycles() const {
+        return wait_cycles[ACCESS_FETCH] + wait_cycles[ACCESS_LOAD] + wait_cycles[ACCESS_STORE];
+    }
+
+    // Clears the statistics (and the state of the model)
+    virtual void clear();
+
+    // Name and parameters of the model, for the report
+    virtual std::string description() const = 0;
+
+    // Row, line or cache hits and misses (0 for the fixed latency)
+    virtual uint64_t hits() const { return 0; }
+    virtual uint64_t misses() const { return 0; }
+
+    // Accesses and wait cycles per access type, then the statistics
+    // of the model (row or line hits)
+    void print_stats(std::ostream& out) const;
+
+    static const char* access_type_name(MemoryAccessType type);
+
+protected:
+    virtual uint32_t latency(MemoryAccessType type, uint32_t addr) = 0;
+    virtual void print_model_stats(std::ostream&) const {}
+
+private:
+    uint32_t remaining_ = 0;
+    MemoryAccessType busy_type_ = ACCESS_FETCH;
+};
+
+class FixedLatency : public MemoryLatency {
+public:
+    FixedLatency(uint32_t read_cycles, uint32_t write_cycles) :
+        read_cycles_(read_cycles), write_cycles_(write_cycles) {}
+
+    std::string description() const override;
+
+protected:
+    uint32_t latency(MemoryAccessType type, uint32_t addr) override;
+
+private:
+    uint32_t read_cycles_;
+    uint32_t write_cycles_;
+};
+
+class SDRAMLatency : public MemoryLatency {
+public:
+    // row_bytes and banks: powers of two
+    SDRAMLatency(uint32_t hit_cycles, uint32_t miss_cycles, uint32_t row_bytes, uint32_t banks);
+
+    uint64_t row_hits = 0;
+    uint64_t row_misses = 0;
+
+    void clear() override;
+    std::string description() const override;
+    uint64_t hits() const override { return row_hits; }
+    uint64_t misses() const override { return row_misses; }
+
+protected:
+    uint32_t latency(MemoryAccessType type, uint32_t addr) override;
+    void print_model_stats(std::ostream& out) const override;
+
+private:
+    static constexpr uint32_t NO_ROW = ~0u;
+    uint32_t hit_cycles_;
+    uint32_t miss_cycles_;
+    uint32_t row_bytes_;
+    std::vector<uint32_t> open_row_; // per bank, NO_ROW after precharge
+};
+
+class SPIFlashLatency : public MemoryLatency {
+public:
+    // line_bytes: power of two, multiple of 4. Reads in [base, base + size)
+    // are timed (size 0: the whole address space).
+    SPIFlashLatency(
+        uint32_t setup_cycles, uint32_t word_cycles, uint32_t line_bytes,
+        uint32_t base = 0, uint32_t size = 0
+    );
+
+    uint64_t line_hits = 0;
+    uint64_t line_misses = 0;
+
+    void clear() override;
+    std::string description() const override;
+    uint64_t hits() const override { return line_hits; }
+    uint64_t misses() const override { return line_misses; }
+
+protected:
+    uint32_t latency(MemoryAccessType type, uint32_t addr) override;
+    void print_model_stats(std::ostream& out) const override;
+
+private:
+    uint32_t setup_cycles_;
+    uint32_t word_cycles_;
+    uint32_t line_bytes_;
+    uint32_t base_;
+    uint32_t size_;
+    bool line_valid_ = false;
+    uint32_t line_addr_ = 0;
+};
+
+class CacheLatency : public MemoryLatency {
+public:
+    // size_bytes, ways and line_bytes: powers of two, at least one set
+    CacheLatency(uint32_t size_bytes, uint32_t ways, uint32_t line_bytes, uint32_t miss_cycles);
+
+    // Reads only (the writes do not allocate)
+    uint64_t read_hits = 0;
+    uint64_t read_misses = 0;
+
+    void clear() override;
+    std::string description() const override;
+    uint64_t hits() const override { return read_hits; }
+    uint64_t misses() const override { return read_misses; }
+
+protected:
+    uint32_t latency(MemoryAccessType type, uint32_t addr) override;
+    void print_model_stats(std::ostream& out) const override;
+
+private:
+    static constexpr uint32_t INVALID = ~0u;
+    uint32_t size_bytes_;
+    uint32_t ways_;
+    uint32_t line_bytes_;
+    uint32_t miss_cycles_;
+    uint32_t nb_sets_;
+    // Per set, the line addresses of the ways, most recently used first
+    std::vector<uint32_t> lines_;
+};
+
+#endif // MEMORY_LATENCY_H
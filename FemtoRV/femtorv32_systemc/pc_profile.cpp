@@ -0,0 +1,131 @@
+/*******************************************************************/
+// Host-side PC sampling profiler for the simulators.
+/*******************************************************************/
+
+#include "pc_profile.h"
+#include <elf.h>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+bool PCProfile::load_symbols(const char* filename, std::string& error) {
+    FILE* f = fopen(filename, "rb");
+    if (f == nullptr) {
+        error = std::string(filename) + ": file not found";
+        return false;
+    }
+    std::vector<uint8_t> file;
+    uint8_t buff[65536];
+    size_t n;
+    while ((n = fread(buff, 1, sizeof(buff), f)) != 0) {
+        file.insert(file.end(), buff, buff + n);
+    }
+    fclose(f);
+
+    if (file.size() < sizeof(Elf32_Ehdr) || memcmp(file.data(), ELFMAG, SELFMAG) != 0 ||
+        file[EI_CLASS] != ELFCLASS32) {
+        error = std::string(filename) + ": not a 32-bit ELF file";
+        return false;
+    }
+    Elf32_Ehdr ehdr;
+    memcpy(&ehdr, file.data(), sizeof(ehdr));
+    if (size_t(ehdr.e_shoff) + size_t(ehdr.e_shnum) * sizeof(Elf32_Shdr) > file.size()) {
+        error = std::string(filename) + ": truncated file";
+        return false;
+    }
+    std::vector<Elf32_Shdr> sections(ehdr.e_shnum);
+    memcpy(sections.data(), file.data() + ehdr.e_shoff, ehdr.e_shnum * sizeof(Elf32_Shdr));
+
+    symbols.clear();
+    for (const Elf32_Shdr& sh : sections) {
+        if (sh.sh_type != SHT_SYMTAB || sh.sh_link >= sections.size()) {
+            continue;
+        }
+        const Elf32_Shdr& strtab = sections[sh.sh_link];
+        if (size_t(sh.sh_offset) + sh.sh_size > file.size() ||
+            size_t(strtab.sh_offset) + strtab.sh_size > file.size()) {
+            error = std::string(filename) + ": truncated file";
+            return false;
+        }
+        for (size_t i = 0; i < sh.sh_size / sizeof(Elf32_Sym); i++) {
+            Elf32_Sym sym;
+            memcpy(&sym, file.data() + sh.sh_offset + i * sizeof(Elf32_Sym), sizeof(sym));
+            if (ELF32_ST_TYPE(sym.st_info) != STT_FUNC || sym.st_name >= strtab.sh_size) {
+                continue;
+            }
+            const char* name = reinterpret_cast<const char*>(file.data() + strtab.sh_offset + sym.st_name);
+            symbols.push_back({ sym.st_value, sym.st_size, std::string(name, strnlen(name, strtab.sh_size - sym.st_name)) });
+        }
+    }
+    std::sort(symbols.begin(), symbols.end(),
+              [](const Symbol& a, const Symbol& b) { return a.address < b.address; });
+    return true;
+}
+
+std::string PCProfile::symbol(uint32_t addr) const {
+    // Last symbol with address <= addr
+    auto it = std::upper_bound(symbols.begin(), symbols.end(), addr,
+                               [](uint32_t a, const Symbol& s) { return a < s.address; });
+    if (it != symbols.begin()) {
+        --it;
+        // Symbols without size (assembly) extend up to the next one
+        if (it->size == 0 || addr < it->address + it->size) {
+            return it->name;
+        }
+    }
+    char buff[16];
+    snprintf(buff, sizeof(buff), "0x%08x", addr);
+    return buff;
+}
+
+bool PCProfile::write_flat(const char* filename) const {
+    std::map<std::string, uint64_t> per_function;
+    for (const auto& it : flat) {
+        per_function[symbol(it.first)] += it.second;
+    }
+    std::vector<std::pair<std::string, uint64_t>> sorted(per_function.begin(), per_function.end());
+    std::sort(sorted.begin(), sorted.end(),
+              [](const std::pair<std::string, uint64_t>& a, const std::pair<std::string, uint64_t>& b) {
+                  return a.second > b.second;
+              });
+    FILE* f = fopen(filename, "w");
+    if (f == nullptr) {
+        return false;
+    }
+    fprintf(f, "# %llu samples\n", (unsigned long long)nb_samples);
+    fprintf(f, "#  %%time     samples  function\n");
+    for (const auto& it : sorted) {
+        fprintf(f, "%7.2f %12llu  %s\n",
+                nb_samples ? 100.0 * double(it.second) / double(nb_samples) : 0.0,
+                (unsigned long long)it.second, it.first.c_str());
+    }
+    return fclose(f) == 0;
+}
+
+bool PCProfile::write_folded(const char* filename) const {
+    // Different stacks of addresses can give the same stack of functions
+    std::map<std::string, uint64_t> stacks;
+    for (const auto& it : folded) {
+        std::string line;
+        for (size_t i = 0; i < it.first.size(); i++) {
+            std::string name = symbol(it.first[i]);
+            // consecutive identical frames: samples of the caller itself
+            if (i + 1 == it.first.size() && i > 0 && name == symbol(it.first[i - 1])) {
+                break;
+            }
+            if (!line.empty()) {
+                line += ";";
+            }
+            line += name;
+        }
+        stacks[line] += it.second;
+    }
+    FILE* f = fopen(filename, "w");
+    if (f == nullptr) {
+        return false;
+    }
+    for (const auto& it : stacks) {
+        fprintf(f, "%s %llu\n", it.first.c_str(), (unsigned long long)it.second);
+    }
+    return fclose(f) == 0;
+}
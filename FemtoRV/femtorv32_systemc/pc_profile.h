@@ -0,0 +1,87 @@
+/*******************************************************************/
+// Host-side PC sampling profiler for the simulators.
+//
+// The harness calls retire() for each executed instruction (to follow
+// calls and returns in a shadow stack), and sample() every N cycles.
+// At the end, the samples are symbolized with the function symbols of
+// the ELF executable (.symtab), and written as:
+//  - a flat profile (samples per function, sorted), and
+//  - a folded-stack file ("main;render;trace 123" per line), that can
+//    be converted to a flame graph with flamegraph.pl.
+//
+// Calls are jal/jalr with rd = ra, returns are 'jalr x0, 0(ra)'. Code
+// that does not follow the calling convention gives approximate stacks
+// (the depth of the shadow stack is bounded by MAX_DEPTH).
+//
+// No SystemC dependency: can be used by the Verilator harnesses.
+/*******************************************************************/
+
+#ifndef PC_PROFILE_H
+#define PC_PROFILE_H
+
+#include <vector>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+
+class PCProfile {
+public:
+    static const size_t MAX_DEPTH = 256;
+
+    // Reads the function symbols of an ELF32 file. Returns false and
+    // sets 'error' if the file cannot be read.
+    bool load_symbols(const char* filename, std::string& error);
+
+    // Executed instruction (instr) at address pc
+    void retire(uint32_t pc, uint32_t instr) {
+        if (call_pending) {
+            call_pending = false;
+            if (stack.size() < MAX_DEPTH) {
+                stack.push_back(pc);
+            }
+        }
+        uint32_t opcode = instr & 0x7F;
+        uint32_t rd = (instr >> 7) & 0x1F;
+        if ((opcode == 0x6F || opcode == 0x67) && rd == 1) {
+            call_pending = true;
+        } else if (instr == 0x00008067 && !stack.empty()) { // ret
+            stack.pop_back();
+        }
+    }
+
+    // Samples the current PC (and the shadow stack)
+    void sample(uint32_t pc) {
+        ++flat[pc];
+        std::vector<uint32_t> key(stack);
+        key.push_back(pc);
+        ++folded[key];
+        ++nb_samples;
+    }
+
+    uint64_t size() const { return nb_samples; }
+
+    // Returns false if the file cannot be written
+    bool write_flat(const char* filename) const;
+    bool write_folded(const char* filename) const;
+
+    // Name of the function that contains addr ("0x..." if unknown)
+    std::string symbol(uint32_t addr) const;
+
+private:
+    struct Symbol {
+        uint32_t address;
+        uint32_t size;
+        std::string name;
+    };
+    std::vector<Symbol> symbols; // sorted by address
+
+    std::unordered_map<uint32_t, uint64_t> flat;
+    std::map<std::vector<uint32_t>, uint64_t> folded;
+    uint64_t nb_samples = 0;
+
+    std::vector<uint32_t> stack; // function entry points
+    bool call_pending = false;
+};
+
+#endif // PC_PROFILE_H
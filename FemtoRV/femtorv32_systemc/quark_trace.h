@@ -0,0 +1,109 @@
+/*******************************************************************/
+// Instruction trace of the FemtoRV32 Quark SystemC models.
+//
+// TraceSink<true> stores one binary record (cycle, PC, instr, rd,
+// value) per retired instruction in a preallocated ring buffer (the
+// last NRV_TRACE_SIZE instructions are kept), that can be written to
+// a file with dump() and pretty-printed with trace_dump.
+// TraceSink<false> is an empty class with inline no-op functions, so
+// that tracing costs nothing when disabled.
+//
+// The models use QuarkTraceSink, which is TraceSink<true> when
+// compiled with -DNRV_TRACE, TraceSink<false> otherwise.
+//
+// File format (little-endian): TraceFileHeader, followed by
+// header.count TraceRecords, oldest first.
+/*******************************************************************/
+
+#ifndef QUARK_TRACE_H
+#define QUARK_TRACE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+// Number of records kept in the ring buffer. Must be a power of two.
+#ifndef NRV_TRACE_SIZE
+#define NRV_TRACE_SIZE 65536
+#endif
+
+struct TraceRecord {
+    uint32_t cycle;   // value of the cycles counter when the instruction retired
+    uint32_t pc;      // address of the instruction
+    uint32_t instr;   // instruction word
+    uint32_t value;   // value written to rd
+    uint8_t  rd;      // destination register, 0 if none
+    uint8_t  pad[3];
+};
+
+struct TraceFileHeader {
+    char     magic[8];  // "NRVTRACE"
+    uint32_t version;   // TRACE_VERSION
+    uint32_t count;     // number of records in the file
+    uint64_t total;     // number of instructions traced (>= count if the buffer wrapped)
+};
+
+static const uint32_t TRACE_VERSION = 1;
+
+template <bool Enabled> class TraceSink;
+
+template <> class TraceSink<false> {
+public:
+    static constexpr bool enabled = false;
+    void record(uint32_t, uint32_t, uint32_t, uint32_t, uint32_t) {}
+    bool dump(const char*) const { return false; }
+};
+
+template <> class TraceSink<true> {
+public:
+    static constexpr bool enabled = true;
+    static const uint32_t SIZE = NRV_TRACE_SIZE;
+    static_assert((SIZE & (SIZE - 1)) == 0, "NRV_TRACE_SIZE must be a power of two");
+
+    TraceSink() : records(SIZE) {}
+
+    void record(uint32_t cycle, uint32_t pc, uint32_t instr, uint32_t rd, uint32_t value) {
+        TraceRecord& r = records[uint32_t(total) & (SIZE - 1)];
+        r.cycle = cycle;
+        r.pc = pc;
+        r.instr = instr;
+        r.value = value;
+        r.rd = uint8_t(rd);
+        ++total;
+    }
+
+    uint64_t size() const { return total; }
+
+    // Writes the records to a file (oldest first). Returns false on error.
+    bool dump(const char* filename) const {
+        FILE* f = fopen(filename, "wb");
+        if (f == nullptr) {
+            return false;
+        }
+        TraceFileHeader header;
+        memcpy(header.magic, "NRVTRACE", 8);
+        header.version = TRACE_VERSION;
+        header.count = uint32_t(total < SIZE ? total : SIZE);
+        header.total = total;
+        bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+        uint32_t first = uint32_t(total - header.count) & (SIZE - 1);
+        // Two contiguous chunks: [first, SIZE) then [0, ...)
+        uint32_t n1 = (header.count < SIZE - first) ? header.count : SIZE - first;
+        ok = ok && fwrite(&records[first], sizeof(TraceRecord), n1, f) == n1;
+        ok = ok && fwrite(&records[0], sizeof(TraceRecord), header.count - n1, f) == header.count - n1;
+        return (fclose(f) == 0) && ok;
+    }
+
+private:
+    std::vector<TraceRecord> records;
+    uint64_t total = 0;
+};
+
+#ifdef NRV_TRACE
+typedef TraceSink<true> QuarkTraceSink;
+#else
+typedef TraceSink<false> QuarkTraceSink;
+#endif
+
+#endif // QUARK_TRACE_H
@@ -0,0 +1,457 @@
+/*******************************************************************/
+// RV32IMF disassembler for the trace decoders and the profilers.
+/*******************************************************************/
+
+#include "riscv_disasm.h"
+
+// Operands of an instruction (x: integer register, f: float register)
+enum DisasmFormat {
+    FMT_NONE,       //
+    FMT_R,          // xd,xs1,xs2
+    FMT_I,          // xd,xs1,imm
+    FMT_SHIFT,      // xd,xs1,shamt
+    FMT_LUI,        // xd,0xuimm
+    FMT_AUIPC,      // xd,0xuimm <target>
+    FMT_LOAD,       // xd,imm(xs1)
+    FMT_STORE,      // xs2,imm(xs1)
+    FMT_BRANCH,     // xs1,xs2,target
+    FMT_JAL,        // xd,target
+    FMT_JALR,       // xd,xs1,imm
+    FMT_CSR,        // xd,csr,xs1
+    FMT_CSRI,       // xd,csr,uimm
+    FMT_FLOAD,      // fd,imm(xs1)
+    FMT_FSTORE,     // fs2,imm(xs1)
+    FMT_FR,         // fd,fs1,fs2
+    FMT_FR_RM,      // fd,fs1,fs2[,rm]
+    FMT_FR4_RM,     // fd,fs1,fs2,fs3[,rm]
+    FMT_F1_RM,      // fd,fs1[,rm]
+    FMT_XF,         // xd,fs1
+    FMT_XF_RM,      // xd,fs1[,rm]
+    FMT_XFF,        // xd,fs1,fs2
+    FMT_FX,         // fd,xs1
+    FMT_FX_RM       // fd,xs1[,rm]
+};
+
+struct DisasmEntry {
+    uint32_t mask;
+    uint32_t match;
+    const char* name;
+    DisasmFormat format;
+};
+
+// Sorted by major opcode (instr[6:2]), see opcode_entries()
+static const DisasmEntry DISASM_TABLE[] = {
+    // LOAD (0x03)
+    { 0x0000707F, 0x00000003, "lb",        FMT_LOAD   },
+    { 0x0000707F, 0x00001003, "lh",        FMT_LOAD   },
+    { 0x0000707F, 0x00002003, "lw",        FMT_LOAD   },
+    { 0x0000707F, 0x00004003, "lbu",       FMT_LOAD   },
+    { 0x0000707F, 0x00005003, "lhu",       FMT_LOAD   },
+    // LOAD-FP (0x07)
+    { 0x0000707F, 0x00002007, "flw",       FMT_FLOAD  },
+    // MISC-MEM (0x0F)
+    { 0x0000707F, 0x0000000F, "fence",     FMT_NONE   },
+    { 0x0000707F, 0x0000100F, "fence.i",   FMT_NONE   },
+    // OP-IMM (0x13)
+    { 0x0000707F, 0x00000013, "addi",      FMT_I      },
+    { 0xFE00707F, 0x00001013, "slli",      FMT_SHIFT  },
+    { 0x0000707F, 0x00002013, "slti",      FMT_I      },
+    { 0x0000707F, 0x00003013, "sltiu",     FMT_I      },
+    { 0x0000707F, 0x00004013, "xori",      FMT_I      },
+    { 0xFE00707F, 0x00005013, "srli",      FMT_SHIFT  },
+    { 0xFE00707F, 0x40005013, "srai",      FMT_SHIFT  },
+    { 0x0000707F, 0x00006013, "ori",       FMT_I      },
+    { 0x0000707F, 0x00007013, "andi",      FMT_I      },
+    // AUIPC (0x17)
+    { 0x0000007F, 0x00000017, "auipc",     FMT_AUIPC  },
+    // STORE (0x23)
+    { 0x0000707F, 0x00000023, "sb",        FMT_STORE  },
+    { 0x0000707F, 0x00001023, "sh",        FMT_STORE  },
+    { 0x0000707F, 0x00002023, "sw",        FMT_STORE  },
+    // STORE-FP (0x27)
+    { 0x0000707F, 0x00002027, "fsw",       FMT_FSTORE },
+    // OP (0x33)
+    { 0xFE00707F, 0x00000033, "add",       FMT_R      },
+    { 0xFE00707F, 0x40000033, "sub",       FMT_R      },
+    { 0xFE00707F, 0x00001033, "sll",       FMT_R      },
+    { 0xFE00707F, 0x00002033, "slt",       FMT_R      },
+    { 0xFE00707F, 0x00003033, "sltu",      FMT_R      },
+    { 0xFE00707F, 0x00004033, "xor",       FMT_R      },
+    { 0xFE00707F, 0x00005033, "srl",       FMT_R      },
+    { 0xFE00707F, 0x40005033, "sra",       FMT_R      },
+    { 0xFE00707F, 0x00006033, "or",        FMT_R      },
+    { 0xFE00707F, 0x00007033, "and",       FMT_R      },
+    { 0xFE00707F, 0x02000033, "mul",       FMT_R      },
+    { 0xFE00707F, 0x02001033, "mulh",      FMT_R      },
+    { 0xFE00707F, 0x02002033, "mulhsu",    FMT_R      },
+    { 0xFE00707F, 0x02003033, "mulhu",     FMT_R      },
+    { 0xFE00707F, 0x02004033, "div",       FMT_R      },
+    { 0xFE00707F, 0x02005033, "divu",      FMT_R      },
+    { 0xFE00707F, 0x02006033, "rem",       FMT_R      },
+    { 0xFE00707F, 0x02007033, "remu",      FMT_R      },
+    // LUI (0x37)
+    { 0x0000007F, 0x00000037, "lui",       FMT_LUI    },
+    // MADD, MSUB, NMSUB, NMADD (0x43 ... 0x4F), single precision
+    { 0x0600007F, 0x00000043, "fmadd.s",   FMT_FR4_RM },
+    { 0x0600007F, 0x00000047, "fmsub.s",   FMT_FR4_RM },
+    { 0x0600007F, 0x0000004B, "fnmsub.s",  FMT_FR4_RM },
+    { 0x0600007F, 0x0000004F, "fnmadd.s",  FMT_FR4_RM },
+    // OP-FP (0x53), single precision
+    { 0xFE00007F, 0x00000053, "fadd.s",    FMT_FR_RM  },
+    { 0xFE00007F, 0x08000053, "fsub.s",    FMT_FR_RM  },
+    { 0xFE00007F, 0x10000053, "fmul.s",    FMT_FR_RM  },
+    { 0xFE00007F, 0x18000053, "fdiv.s",    FMT_FR_RM  },
+    { 0xFFF0007F, 0x58000053, "fsqrt.s",   FMT_F1_RM  },
+    { 0xFE00707F, 0x20000053, "fsgnj.s",   FMT_FR     },
+    { 0xFE00707F, 0x20001053, "fsgnjn.s",  FMT_FR     },
+    { 0xFE00707F, 0x20002053, "fsgnjx.s",  FMT_FR     },
+    { 0xFE00707F, 0x28000053, "fmin.s",    FMT_FR     },
+    { 0xFE00707F, 0x28001053, "fmax.s",    FMT_FR     },
+    { 0xFFF0007F, 0xC0000053, "fcvt.w.s",  FMT_XF_RM  },
+    { 0xFFF0007F, 0xC0100053, "fcvt.wu.s", FMT_XF_RM  },
+    { 0xFFF0707F, 0xE0000053, "fmv.x.w",   FMT_XF     },
+    { 0xFFF0707F, 0xE0001053, "fclass.s",  FMT_XF     },
+    { 0xFE00707F, 0xA0002053, "feq.s",     FMT_XFF    },
+    { 0xFE00707F, 0xA0001053, "flt.s",     FMT_XFF    },
+    { 0xFE00707F, 0xA0000053, "fle.s",     FMT_XFF    },
+    { 0xFFF0007F, 0xD0000053, "fcvt.s.w",  FMT_FX_RM  },
+    { 0xFFF0007F, 0xD0100053, "fcvt.s.wu", FMT_FX_RM  },
+    { 0xFFF0707F, 0xF0000053, "fmv.w.x",   FMT_FX     },
+    // BRANCH (0x63)
+    { 0x0000707F, 0x00000063, "beq",       FMT_BRANCH },
+    { 0x0000707F, 0x00001063, "bne",       FMT_BRANCH },
+    { 0x0000707F, 0x00004063, "blt",       FMT_BRANCH },
+    { 0x0000707F, 0x00005063, "bge",       FMT_BRANCH },
+    { 0x0000707F, 0x00006063, "bltu",      FMT_BRANCH },
+    { 0x0000707F, 0x00007063, "bgeu",      FMT_BRANCH },
+    // JALR (0x67)
+    { 0x0000707F, 0x00000067, "jalr",      FMT_JALR   },
+    // JAL (0x6F)
+    { 0x0000007F, 0x0000006F, "jal",       FMT_JAL    },
+    // SYSTEM (0x73)
+    { 0xFFFFFFFF, 0x00000073, "ecall",     FMT_NONE   },
+    { 0xFFFFFFFF, 0x00100073, "ebreak",    FMT_NONE   },
+    { 0xFFFFFFFF, 0x30200073, "mret",      FMT_NONE   },
+    { 0xFFFFFFFF, 0x10500073, "wfi",       FMT_NONE   },
+    { 0x0000707F, 0x00001073, "csrrw",     FMT_CSR    },
+    { 0x0000707F, 0x00002073, "csrrs",     FMT_CSR    },
+    { 0x0000707F, 0x00003073, "csrrc",     FMT_CSR    },
+    { 0x0000707F, 0x00005073, "csrrwi",    FMT_CSRI   },
+    { 0x0000707F, 0x00006073, "csrrsi",    FMT_CSRI   },
+    { 0x0000707F, 0x00007073, "csrrci",    FMT_CSRI   }
+};
+
+static const size_t DISASM_TABLE_SIZE = sizeof(DISASM_TABLE) / sizeof(DISASM_TABLE[0]);
+
+// Range of the entries of each major opcode, computed once (the
+// initialization of a local static is thread-safe)
+struct OpcodeRange {
+    uint8_t first;
+    uint8_t end;
+};
+
+static const OpcodeRange* opcode_entries() {
+    struct Index {
+        OpcodeRange ranges[32];
+        Index() {
+            for (OpcodeRange& range : ranges) {
+                range.first = range.end = 0;
+            }
+            for (size_t i = 0; i < DISASM_TABLE_SIZE; i++) {
+                OpcodeRange& range = ranges[(DISASM_TABLE[i].match >> 2) & 31];
+                if (range.first == range.end) {
+                    range.first = uint8_t(i);
+                }
+                range.end = uint8_t(i + 1);
+            }
+        }
+    };
+    static const Index index;
+    return index.ranges;
+}
+
+static const DisasmEntry* lookup(uint32_t instr) {
+    if ((instr & 3) != 3) {
+        return nullptr;
+    }
+    const OpcodeRange& range = opcode_entries()[(instr >> 2) & 31];
+    for (uint32_t i = range.first; i < range.end; i++) {
+        if ((instr & DISASM_TABLE[i].mask) == DISASM_TABLE[i].match) {
+            return &DISASM_TABLE[i];
+        }
+    }
+    return nullptr;
+}
+
+static const char* csr_name(uint32_t csr) {
+    switch (csr) {
+        case 0x001: return "fflags";
+        case 0x002: return "frm";
+        case 0x003: return "fcsr";
+        case 0x300: return "mstatus";
+        case 0x301: return "misa";
+        case 0x304: return "mie";
+        case 0x305: return "mtvec";
+        case 0x340: return "mscratch";
+        case 0x341: return "mepc";
+        case 0x342: return "mcause";
+        case 0x343: return "mtval";
+        case 0x344: return "mip";
+        case 0xC00: return "cycle";
+        case 0xC01: return "time";
+        case 0xC02: return "instret";
+        case 0xC80: return "cycleh";
+        case 0xC81: return "timeh";
+        case 0xC82: return "instreth";
+    }
+    return nullptr;
+}
+
+// Text output, bounded by the longest instruction (no checks)
+class DisasmWriter {
+public:
+    explicit DisasmWriter(char* out) : begin_(out), p_(out) {}
+
+    void put(char c) { *p_++ = c; }
+
+    void put(const char* s) {
+        while (*s != '\0') {
+            *p_++ = *s++;
+        }
+    }
+
+    // Mnemonic, padded to 8 columns if operands follow
+    void mnemonic(const char* s, bool operands) {
+        put(s);
+        if (operands) {
+            do {
+                put(' ');
+            } while (p_ - begin_ < 8);
+        }
+    }
+
+    void udec(uint32_t x) {
+        char digits[10];
+        int n = 0;
+        do {
+            digits[n++] = char('0' + x % 10);
+            x /= 10;
+        } while (x != 0);
+        while (n > 0) {
+            put(digits[--n]);
+        }
+    }
+
+    void dec(int32_t x) {
+        if (x < 0) {
+            put('-');
+            udec(0u - uint32_t(x));
+        } else {
+            udec(uint32_t(x));
+        }
+    }
+
+    // 0x followed by min_digits hexadecimal digits or more
+    void hex(uint32_t x, int min_digits = 1) {
+        static const char HEX[] = "0123456789abcdef";
+        put('0');
+        put('x');
+        int digits = 8;
+        while (digits > min_digits && (x >> (4 * (digits - 1))) == 0) {
+            digits--;
+        }
+        for (int i = digits - 1; i >= 0; i--) {
+            put(HEX[(x >> (4 * i)) & 15]);
+        }
+    }
+
+    void xreg(uint32_t r) { put('x'); udec(r); }
+    void freg(uint32_t r) { put('f'); udec(r); }
+    void comma() { put(','); }
+
+    void csr(uint32_t csr) {
+        const char* name = csr_name(csr);
+        if (name != nullptr) {
+            put(name);
+        } else {
+            hex(csr);
+        }
+    }
+
+    // Rounding mode, if not dynamic
+    void rm(uint32_t rm) {
+        static const char* NAMES[7] = { "rne", "rtz", "rdn", "rup", "rmm", "rm5", "rm6" };
+        if (rm != 7) {
+            comma();
+            put(NAMES[rm]);
+        }
+    }
+
+    size_t finish() {
+        *p_ = '\0';
+        return size_t(p_ - begin_);
+    }
+
+private:
+    char* begin_;
+    char* p_;
+};
+
+static inline uint32_t bits(uint32_t x, int hi, int lo) {
+    return (x >> lo) & ((1u << (hi - lo + 1)) - 1);
+}
+
+size_t riscv_disasm(char* out, uint32_t instr, uint32_t pc) {
+    DisasmWriter w(out);
+    uint32_t rd  = bits(instr, 11, 7);
+    uint32_t rs1 = bits(instr, 19, 15);
+    uint32_t rs2 = bits(instr, 24, 20);
+    uint32_t rs3 = bits(instr, 31, 27);
+    uint32_t rm  = bits(instr, 14, 12);
+    int32_t Iimm = int32_t(instr) >> 20;
+    int32_t Simm = (int32_t(instr & 0xFE000000) >> 20) | int32_t(bits(instr, 11, 7));
+    int32_t Bimm = (int32_t(instr & 0x80000000) >> 19) | int32_t((instr << 4) & 0x800) |
+                   int32_t(bits(instr, 30, 25) << 5) | int32_t(bits(instr, 11, 8) << 1);
+    int32_t Jimm = (int32_t(instr & 0x80000000) >> 11) | int32_t(instr & 0xFF000) |
+                   int32_t((instr >> 9) & 0x800) | int32_t((instr >> 20) & 0x7FE);
+
+    // Pseudo-instructions
+    if (instr == 0x00000013) {
+        w.mnemonic("nop", false);
+        return w.finish();
+    }
+    if (instr == 0x00008067) {
+        w.mnemonic("ret", false);
+        return w.finish();
+    }
+    if ((instr & 0xFFF) == 0x06F) { // jal x0
+        w.mnemonic("j", true);
+        w.hex(pc + uint32_t(Jimm));
+        return w.finish();
+    }
+    if ((instr & 0xFF07F) == 0x02073) { // csrrs rd, csr, x0
+        uint32_t csr = instr >> 20;
+        if ((csr & 0xF7F) <= 0xC02 && (csr & 0xF7F) >= 0xC00) {
+            w.put("rd");
+            w.mnemonic(csr_name(csr), true);
+            w.xreg(rd);
+            return w.finish();
+        }
+    }
+
+    const DisasmEntry* entry = lookup(instr);
+    if (entry == nullptr) {
+        w.mnemonic(".word", true);
+        w.hex(instr, 8);
+        return w.finish();
+    }
+    w.mnemonic(entry->name, entry->format != FMT_NONE);
+    switch (entry->format) {
+        case FMT_NONE:
+            break;
+        case FMT_R:
+            w.xreg(rd); w.comma(); w.xreg(rs1); w.comma(); w.xreg(rs2);
+            break;
+        case FMT_I:
+        case FMT_JALR:
+            w.xreg(rd); w.comma(); w.xreg(rs1); w.comma(); w.dec(Iimm);
+            break;
+        case FMT_SHIFT:
+            w.xreg(rd); w.comma(); w.xreg(rs1); w.comma(); w.udec(rs2);
+            break;
+        case FMT_LUI:
+            w.xreg(rd); w.comma(); w.hex(instr >> 12);
+            break;
+        case FMT_AUIPC:
+            w.xreg(rd); w.comma(); w.hex(instr >> 12);
+            w.put(" <"); w.hex(pc + (instr & 0xFFFFF000)); w.put('>');
+            break;
+        case FMT_LOAD:
+            w.xreg(rd); w.comma(); w.dec(Iimm); w.put('('); w.xreg(rs1); w.put(')');
+            break;
+        case FMT_STORE:
+            w.xreg(rs2); w.comma(); w.dec(Simm); w.put('('); w.xreg(rs1); w.put(')');
+            break;
+        case FMT_BRANCH:
+            w.xreg(rs1); w.comma(); w.xreg(rs2); w.comma(); w.hex(pc + uint32_t(Bimm));
+            break;
+        case FMT_JAL:
+            w.xreg(rd); w.comma(); w.hex(pc + uint32_t(Jimm));
+            break;
+        case FMT_CSR:
+            w.xreg(rd); w.comma(); w.csr(instr >> 20); w.comma(); w.xreg(rs1);
+            break;
+        case FMT_CSRI:
+            w.xreg(rd); w.comma(); w.csr(instr >> 20); w.comma(); w.udec(rs1);
+            break;
+        case FMT_FLOAD:
+            w.freg(rd); w.comma(); w.dec(Iimm); w.put('('); w.xreg(rs1); w.put(')');
+            break;
+        case FMT_FSTORE:
+            w.freg(rs2); w.comma(); w.dec(Simm); w.put('('); w.xreg(rs1); w.put(')');
+            break;
+        case FMT_FR:
+            w.freg(rd); w.comma(); w.freg(rs1); w.comma(); w.freg(rs2);
+            break;
+        case FMT_FR_RM:
+            w.freg(rd); w.comma(); w.freg(rs1); w.comma(); w.freg(rs2); w.rm(rm);
+            break;
+        case FMT_FR4_RM:
+            w.freg(rd); w.comma(); w.freg(rs1); w.comma(); w.freg(rs2); w.comma(); w.freg(rs3);
+            w.rm(rm);
+            break;
+        case FMT_F1_RM:
+            w.freg(rd); w.comma(); w.freg(rs1); w.rm(rm);
+            break;
+        case FMT_XF:
+            w.xreg(rd); w.comma(); w.freg(rs1);
+            break;
+        case FMT_XF_RM:
+            w.xreg(rd); w.comma(); w.freg(rs1); w.rm(rm);
+            break;
+        case FMT_XFF:
+            w.xreg(rd); w.comma(); w.freg(rs1); w.comma(); w.freg(rs2);
+            break;
+        case FMT_FX:
+            w.freg(rd); w.comma(); w.xreg(rs1);
+            break;
+        case FMT_FX_RM:
+            w.freg(rd); w.comma(); w.xreg(rs1); w.rm(rm);
+            break;
+    }
+    return w.finish();
+}
+
+int riscv_disasm_dest(uint32_t instr) {
+    const DisasmEntry* entry = lookup(instr);
+    if (entry == nullptr) {
+        return -1;
+    }
+    int rd = int(bits(instr, 11, 7));
+    switch (entry->format) {
+        case FMT_R:
+        case FMT_I:
+        case FMT_SHIFT:
+        case FMT_LUI:
+        case FMT_AUIPC:
+        case FMT_LOAD:
+        case FMT_JAL:
+        case FMT_JALR:
+        case FMT_CSR:
+        case FMT_CSRI:
+        case FMT_XF:
+        case FMT_XF_RM:
+        case FMT_XFF:
+            return (rd == 0) ? -1 : rd;
+        case FMT_FLOAD:
+        case FMT_FR:
+        case FMT_FR_RM:
+        case FMT_FR4_RM:
+        case FMT_F1_RM:
+        case FMT_FX:
+        case FMT_FX_RM:
+            return 32 + rd;
+        default:
+            return -1;
+    }
+}
@@ -0,0 +1,40 @@
+/*******************************************************************/
+// RV32IMF disassembler for the trace decoders and the profilers
+// (trace_dump, iss_run -t, the pipeline hazard report of the tutorial
+// Verilator harness, the program listings of focused_test).
+//
+// Table-driven: one entry (mask, match, mnemonic, operand format) per
+// instruction, indexed by the major opcode. The text is written into
+// a buffer of the caller, without allocation nor printf, so that
+// traces of millions of instructions print at the speed of fwrite().
+//
+// Same syntax as the Verilog disassembler of the tutorial
+// (TUTORIALS/FROM_BLINKER_TO_RISCV/riscv_disassembly.v): registers
+// x0..x31 and f0..f31, decimal immediates, absolute hexadecimal jump
+// targets, and the pseudo-instructions nop, j, ret and rdcycle[h] /
+// rdtime[h] / rdinstret[h]. The rounding mode of the F instructions
+// is printed when it is not dynamic (e.g. "fcvt.w.s x10,f0,rtz").
+// Compressed instructions are disassembled once expanded (as the ISS
+// executes them). Unknown encodings print as ".word 0x........".
+//
+// No SystemC dependency, no global state (thread-safe).
+/*******************************************************************/
+
+#ifndef RISCV_DISASM_H
+#define RISCV_DISASM_H
+
+#include <cstdint>
+#include <cstddef>
+
+// Size of the buffer of riscv_disasm(), terminating zero included
+static const size_t RISCV_DISASM_MAX = 48;
+
+// Writes the disassembly of instr, at address pc, to out (at least
+// RISCV_DISASM_MAX bytes, zero-terminated). Returns its length.
+size_t riscv_disasm(char* out, uint32_t instr, uint32_t pc);
+
+// Register written by instr: 1..31 for x1..x31, 32..63 for f0..f31,
+// -1 if none (x0 included)
+int riscv_disasm_dest(uint32_t instr);
+
+#endif // RISCV_DISASM_H
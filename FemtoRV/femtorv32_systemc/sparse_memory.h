@@ -0,0 +1,119 @@
+/*******************************************************************/
+// Sparse paged memory for the simulators.
+//
+// Covers the whole 32-bit address space (e.g. ADDR_WIDTH=24, or the
+// LiteX SDRAM at 0x40000000) with 4 KiB pages allocated on the first
+// write. Reading a page that was never written returns 0 and does not
+// allocate it. The last page accessed is kept in a one-entry TLB, so
+// that sequential accesses do not look up the page table.
+//
+// No SystemC dependency: used by the test harnesses, and can be used
+// by an instruction set simulator.
+/*******************************************************************/
+
+#ifndef SPARSE_MEMORY_H
+#define SPARSE_MEMORY_H
+
+#include <unordered_map>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+class SparseMemory {
+public:
+    static const unsigned PAGE_BITS = 12;
+    static const uint32_t PAGE_SIZE = 1u << PAGE_BITS;
+    static const uint32_t PAGE_MASK = PAGE_SIZE - 1;
+
+    // Word accesses (addr is rounded down to a multiple of 4)
+    uint32_t read_word(uint32_t addr) const {
+        const uint8_t* p = find_page(addr);
+        if (p == nullptr) {
+            return 0;
+        }
+        // Little-endian host assumed (like the RISC-V)
+        uint32_t result;
+        memcpy(&result, p + (addr & PAGE_MASK & ~3u), 4);
+        return result;
+    }
+
+    // Writes the bytes of data selected by wmask (bit i: byte i)
+    void write_word(uint32_t addr, uint32_t data, uint32_t wmask = 0xF) {
+        uint8_t* p = get_page(addr) + (addr & PAGE_MASK & ~3u);
+        if (wmask == 0xF) {
+            memcpy(p, &data, 4);
+            return;
+        }
+        for (int i = 0; i < 4; i++) {
+            if (wmask & (1u << i)) {
+                p[i] = uint8_t(data >> (i * 8));
+            }
+        }
+    }
+
+    uint8_t read_byte(uint32_t addr) const {
+        const uint8_t* p = find_page(addr);
+        return (p == nullptr) ? 0 : p[addr & PAGE_MASK];
+    }
+
+    void write_byte(uint32_t addr, uint8_t data) {
+        get_page(addr)[addr & PAGE_MASK] = data;
+    }
+
+    // Copies 32-bit words to memory, starting from address 'addr'
+    void load(const std::vector<uint32_t>& words, uint32_t addr = 0) {
+        for (size_t i = 0; i < words.size(); i++) {
+            write_word(addr + uint32_t(i) * 4, words[i]);
+        }
+    }
+
+    // Page that contains addr, allocated (zero-filled) if needed
+    uint8_t* get_page(uint32_t addr) {
+        uint32_t page_number = addr >> PAGE_BITS;
+        if (page_number == tlb_page && tlb_data != nullptr) {
+            return tlb_data;
+        }
+        std::unique_ptr<uint8_t[]>& page = pages[page_number];
+        if (!page) {
+            page.reset(new uint8_t[PAGE_SIZE]());
+        }
+        tlb_page = page_number;
+        tlb_data = page.get();
+        return tlb_data;
+    }
+
+    // Number of allocated pages
+    size_t nb_pages() const {
+        return pages.size();
+    }
+
+    void clear() {
+        pages.clear();
+        tlb_data = nullptr;
+    }
+
+private:
+    // Page that contains addr, or nullptr if it was never written
+    const uint8_t* find_page(uint32_t addr) const {
+        uint32_t page_number = addr >> PAGE_BITS;
+        if (page_number == tlb_page && tlb_data != nullptr) {
+            return tlb_data;
+        }
+        auto it = pages.find(page_number);
+        if (it == pages.end()) {
+            return nullptr;
+        }
+        tlb_page = page_number;
+        tlb_data = it->second.get();
+        return tlb_data;
+    }
+
+    std::unordered_map<uint32_t, std::unique_ptr<uint8_t[]> > pages;
+
+    // One-entry TLB: last page accessed
+    mutable uint32_t tlb_page = 0;
+    mutable uint8_t* tlb_data = nullptr;
+};
+
+#endif // SPARSE_MEMORY_H
@@ -0,0 +1,146 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../bus_arbiter.h"
+
+// Test of the shared bus of the multi-hart harness (bus_arbiter.h):
+// grant order of the round-robin and fixed priority policies, the wait
+// cycles of the masters with and without a latency model, and parsing
+// of the policies.
+//
+// Usage: arbiter_test
+
+static int failures = 0;
+
+static void check(bool ok, const std::string& what) {
+    std::cout << (ok ? "  ✅ " : "  ❌ ") << what << std::endl;
+    if (!ok) {
+        failures++;
+    }
+}
+
+static std::unique_ptr<MemoryLatency> create(const std::string& spec) {
+    std::string error;
+    std::unique_ptr<MemoryLatency> result = MemoryLatency::create(spec, error);
+    if (!result) {
+        std::cout << "  " << error << std::endl;
+    }
+    return result;
+}
+
+// All the masters issue a request in the same cycle, then wait while
+// busy. Returns the masters in the order their wait ends, and the
+// cycles each of them waited.
+static std::vector<int> simultaneous(BusArbiter& bus, std::vector<uint32_t>& waited) {
+    std::vector<int> order;
+    int n = bus.nb_masters();
+    waited.assign(size_t(n), 0);
+    for (int i = 0; i < n; i++) {
+        bus.request(i, ACCESS_LOAD, uint32_t(i) * 4);
+    }
+    std::vector<bool> done(size_t(n), false);
+    for (int cycle = 0; int(order.size()) < n && cycle < 1000; cycle++) {
+        bus.clock();
+        for (int i = 0; i < n; i++) {
+            if (done[size_t(i)]) {
+                continue;
+            }
+            if (bus.busy(i)) {
+                waited[size_t(i)]++;
+            } else {
+                done[size_t(i)] = true;
+                order.push_back(i);
+            }
+        }
+    }
+    return order;
+}
+
+int main() {
+    std::cout << "FemtoRV32 Bus Arbiter Test" << std::endl;
+    std::cout << "==========================" << std::endl;
+
+    std::cout << "🔍 Single master" << std::endl;
+    {
+        BusArbiter bus(1, ARBITER_ROUND_ROBIN, nullptr);
+        std::vector<uint32_t> waited;
+        simultaneous(bus, waited);
+        check(waited[0] == 0, "no wait cycle without a latency model");
+        BusArbiter slow(1, ARBITER_ROUND_ROBIN, create("fixed:3,1"));
+        simultaneous(slow, waited);
+        check(waited[0] == 3, "waits the 3 cycles of the model");
+        check(slow.stats(0).grants == 1 && slow.stats(0).latency_cycles == 3 &&
+              slow.stats(0).arbitration_cycles == 0, "1 access, 3 memory cycles, no arbitration");
+        check(slow.bus_cycles() == 4, "bus busy 4 cycles");
+    }
+
+    std::cout << "🔍 Round-robin" << std::endl;
+    {
+        BusArbiter bus(3, ARBITER_ROUND_ROBIN, nullptr);
+        std::vector<uint32_t> waited;
+        std::vector<int> order = simultaneous(bus, waited);
+        check(order == std::vector<int>({ 0, 1, 2 }), "first round: 0, 1, 2");
+        check(waited == std::vector<uint32_t>({ 0, 1, 2 }), "one cycle per access");
+        order = simultaneous(bus, waited);
+        check(order == std::vector<int>({ 0, 1, 2 }), "second round starts after the last granted");
+        bus.request(2, ACCESS_FETCH, 0);
+        bus.clock();
+        bus.request(0, ACCESS_FETCH, 0);
+        bus.request(1, ACCESS_FETCH, 0);
+        bus.clock();
+        check(!bus.busy(0) && bus.busy(1), "after master 2, master 0 first");
+        bus.clock();
+        check(!bus.busy(1), "then master 1");
+    }
+
+    std::cout << "🔍 Fixed priority" << std::endl;
+    {
+        BusArbiter bus(3, ARBITER_PRIORITY, create("fixed:2"));
+        std::vector<uint32_t> waited;
+        std::vector<int> order = simultaneous(bus, waited);
+        check(order == std::vector<int>({ 0, 1, 2 }), "master 0 first");
+        check(waited == std::vector<uint32_t>({ 2, 5, 8 }), "3 cycles per access");
+        check(bus.stats(2).arbitration_cycles == 6 && bus.stats(2).latency_cycles == 2,
+              "master 2: 6 cycles for the bus, 2 for the memory");
+        // Master 0 requests again as soon as it is served: master 2 starves
+        bus.request(0, ACCESS_LOAD, 0);
+        bus.request(2, ACCESS_LOAD, 0);
+        for (int i = 0; i < 3; i++) {
+            bus.clock();
+        }
+        for (int round = 0; round < 4; round++) {
+            bus.request(0, ACCESS_LOAD, 0);
+            for (int i = 0; i < 3; i++) {
+                bus.clock();
+            }
+        }
+        check(bus.busy(2), "a busy master 0 starves master 2");
+    }
+
+    std::cout << "🔍 Busy type" << std::endl;
+    {
+        BusArbiter bus(2, ARBITER_ROUND_ROBIN, nullptr);
+        bus.request(0, ACCESS_LOAD, 0);
+        bus.request(1, ACCESS_STORE, 0);
+        bus.clock();
+        check(bus.busy(1) && bus.busy_type(1) == ACCESS_STORE, "pending store: mem_wbusy");
+        bus.request(1, ACCESS_LOAD, 0);
+        check(bus.busy_type(1) == ACCESS_STORE, "requests ignored while busy");
+    }
+
+    std::cout << "🔍 Policies" << std::endl;
+    {
+        ArbiterPolicy policy = ARBITER_ROUND_ROBIN;
+        std::string error;
+        check(BusArbiter::parse_policy("prio", policy, error) && policy == ARBITER_PRIORITY, "prio parsed");
+        check(BusArbiter::parse_policy("rr", policy, error) && policy == ARBITER_ROUND_ROBIN, "rr parsed");
+        check(!BusArbiter::parse_policy("lottery", policy, error), "unknown policy rejected");
+    }
+
+    if (failures != 0) {
+        std::cout << std::endl << "❌ Some tests failed." << std::endl;
+        return 1;
+    }
+    std::cout << std::endl << "✅ All tests passed!" << std::endl;
+    return 0;
+}
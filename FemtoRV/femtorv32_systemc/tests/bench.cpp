@@ -0,0 +1,482 @@
+#include <systemc.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include "../femtorv32_quark.h"
+#include "parallel_runner.h"
+
+// Instruction-level benchmark of the pin-level FemtoRV32_Quark model:
+// runs longer programs (loop kernels) and reports simulated instructions
+// per second, simulated cycles per second and CPI per instruction class.
+//
+// Usage: bench [-f] [iterations]
+//  -f:         functional mode (FemtoRV32_Quark::functional_mode, shifts
+//              complete in one evaluation)
+//  iterations: number of loop iterations of each kernel (default 2000).
+//
+// Cycles are counted like the model's 'cycles' register: the state
+// machine advances on the rising edge of clk.
+//
+// Each kernel runs on each configuration of the model listed in
+// 'configs' (FemtoRV32_QuarkT template parameters, see femtorv32_quark.h).
+//
+// Each kernel runs in its own process (the SystemC kernel cannot be
+// elaborated again once started), one at a time so that the wall-clock
+// times are not perturbed.
+//
+// Note: the model only handles positive branch offsets (see
+// compute_immediates()), so the loops exit with a forward branch and jump
+// back with jalr. It also takes the access width of loads and stores from
+// instr[13:12] (bits 15:14 of the instruction word), so word accesses use
+// an odd base register.
+
+/*******************************************************************/
+// Minimal RV32I encoder
+
+enum {
+    OP_LOAD = 0x03, OP_ALUIMM = 0x13, OP_STORE = 0x23, OP_ALUREG = 0x33,
+    OP_BRANCH = 0x63, OP_JALR = 0x67, OP_JAL = 0x6F, OP_SYSTEM = 0x73,
+    OP_LUI = 0x37, OP_AUIPC = 0x17
+};
+
+static uint32_t enc_r(uint32_t funct7, uint32_t rs2, uint32_t rs1, uint32_t funct3, uint32_t rd) {
+    return (funct7 << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | OP_ALUREG;
+}
+
+static uint32_t enc_i(uint32_t op, int32_t imm, uint32_t rs1, uint32_t funct3, uint32_t rd) {
+    return (uint32_t(imm & 0xFFF) << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | op;
+}
+
+static uint32_t enc_s(int32_t imm, uint32_t rs2, uint32_t rs1, uint32_t funct3) {
+    uint32_t u = uint32_t(imm);
+    return ((u >> 5 & 0x7F) << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) |
+           ((u & 0x1F) << 7) | OP_STORE;
+}
+
+static uint32_t enc_b(int32_t imm, uint32_t rs2, uint32_t rs1, uint32_t funct3) {
+    uint32_t u = uint32_t(imm);
+    return ((u >> 12 & 1) << 31) | ((u >> 5 & 0x3F) << 25) | (rs2 << 20) | (rs1 << 15) |
+           (funct3 << 12) | ((u >> 1 & 0xF) << 8) | ((u >> 11 & 1) << 7) | OP_BRANCH;
+}
+
+static const uint32_t HALT = 0x0000006F; // jal x0, 0
+
+/*******************************************************************/
+// Instruction classes
+
+enum InstrClass {
+    CLASS_ALU, CLASS_SHIFT, CLASS_LOAD, CLASS_STORE, CLASS_BRANCH, CLASS_JUMP, CLASS_OTHER,
+    NB_CLASSES
+};
+
+static const char* class_names[NB_CLASSES] = {
+    "alu", "shift", "load", "store", "branch", "jump", "other"
+};
+
+static InstrClass classify(uint32_t instr) {
+    uint32_t funct3 = (instr >> 12) & 7;
+    switch (instr & 0x7F) {
+        case OP_ALUIMM:
+        case OP_ALUREG:
+            return (funct3 == ALU_SLL || funct3 == ALU_SRL_SRA) ? CLASS_SHIFT : CLASS_ALU;
+        case OP_LOAD:   return CLASS_LOAD;
+        case OP_STORE:  return CLASS_STORE;
+        case OP_BRANCH: return CLASS_BRANCH;
+        case OP_JAL:
+        case OP_JALR:   return CLASS_JUMP;
+        default:        return CLASS_OTHER;
+    }
+}
+
+/*******************************************************************/
+
+struct BenchProgram {
+    std::string name;
+    std::vector<uint32_t> instructions;
+    uint32_t data_addr = 0;               // initial data, copied at data_addr
+    std::vector<uint32_t> data;
+    // Checks the final memory and registers, returns an error message or "" if OK
+    std::string (*check)(const std::vector<uint32_t>& memory, const std::vector<uint32_t>& regs, uint32_t n) = nullptr;
+    uint32_t iterations = 0;
+    size_t config = 0;                    // index in 'configs'
+};
+
+struct BenchResult {
+    std::string name;
+    bool passed = false;
+    std::string message;
+    uint64_t instret[NB_CLASSES] = {};
+    uint64_t class_cycles[NB_CLASSES] = {};
+    uint64_t sim_cycles = 0;
+    double wall_ms = 0.0;
+    std::string log;
+
+    uint64_t total_instret() const {
+        uint64_t total = 0;
+        for (int i = 0; i < NB_CLASSES; i++) total += instret[i];
+        return total;
+    }
+
+    std::string serialize() const {
+        std::ostringstream out;
+        out << name << '\t' << passed << '\t' << sim_cycles << '\t' << wall_ms;
+        for (int i = 0; i < NB_CLASSES; i++) {
+            out << '\t' << instret[i] << '\t' << class_cycles[i];
+        }
+        out << '\t' << message;
+        return out.str();
+    }
+
+    static BenchResult deserialize(const std::string& record) {
+        BenchResult result;
+        std::istringstream in(record);
+        std::string field;
+        if (!std::getline(in, result.name, '\t')) {
+            return result;
+        }
+        std::getline(in, field, '\t'); result.passed = (field == "1");
+        std::getline(in, field, '\t'); result.sim_cycles = strtoull(field.c_str(), nullptr, 10);
+        std::getline(in, field, '\t'); result.wall_ms = atof(field.c_str());
+        for (int i = 0; i < NB_CLASSES; i++) {
+            std::getline(in, field, '\t'); result.instret[i] = strtoull(field.c_str(), nullptr, 10);
+            std::getline(in, field, '\t'); result.class_cycles[i] = strtoull(field.c_str(), nullptr, 10);
+        }
+        std::getline(in, result.message);
+        return result;
+    }
+};
+
+// Set by -f
+static bool functional_mode = false;
+
+template <class CPU>
+class BenchHarness : public sc_module {
+public:
+    sc_clock clk;
+    sc_signal<bool> reset;
+    sc_signal<bool> mem_rstrb;
+    sc_signal<sc_uint<32>> mem_addr;
+    sc_signal<sc_uint<32>> mem_rdata;
+    sc_signal<bool> mem_rbusy;
+    sc_signal<bool> mem_wbusy;
+    sc_signal<sc_uint<4>> mem_wmask;
+    sc_signal<sc_uint<32>> mem_wdata;
+
+    CPU* cpu;
+    std::vector<uint32_t> memory;
+    BenchResult* result;
+
+    static const uint32_t MEMORY_WORDS = 16384; // 64 KB
+    static const uint32_t RESET_CYCLES = 2;
+
+    BenchHarness(sc_module_name name, BenchResult* result) :
+        sc_module(name), clk("clk", 10, SC_NS), memory(MEMORY_WORDS, 0), result(result) {
+        cpu = new CPU("cpu");
+        cpu->functional_mode = functional_mode;
+        cpu->clk(clk);
+        cpu->reset(reset);
+        cpu->mem_rstrb(mem_rstrb);
+        cpu->mem_addr(mem_addr);
+        cpu->mem_rdata(mem_rdata);
+        cpu->mem_rbusy(mem_rbusy);
+        cpu->mem_wbusy(mem_wbusy);
+        cpu->mem_wmask(mem_wmask);
+        cpu->mem_wdata(mem_wdata);
+
+        SC_METHOD(memory_process);
+        sensitive << mem_rstrb << mem_addr << mem_wmask << mem_wdata;
+
+        SC_THREAD(monitor_process);
+    }
+
+    std::vector<uint32_t> registers() const {
+        std::vector<uint32_t> regs;
+        for (const auto& r : cpu->registerFile) {
+            regs.push_back(r.to_uint());
+        }
+        return regs;
+    }
+
+    ~BenchHarness() {
+        delete cpu;
+    }
+
+    // Same zero-wait-state memory as in focused_test.cpp
+    void memory_process() {
+        uint32_t word_addr = mem_addr.read().to_uint() >> 2;
+        mem_rbusy.write(false);
+        mem_wbusy.write(false);
+        if (mem_rstrb.read()) {
+            mem_rdata.write(word_addr < memory.size() ? memory[word_addr] : 0);
+        }
+        uint32_t mask = mem_wmask.read().to_uint();
+        if (mask != 0 && word_addr < memory.size()) {
+            uint32_t data = mem_wdata.read().to_uint();
+            for (int i = 0; i < 4; i++) {
+                if (mask & (1 << i)) {
+                    memory[word_addr] = (memory[word_addr] & ~(0xFFu << (i * 8))) | (data & (0xFFu << (i * 8)));
+                }
+            }
+        }
+    }
+
+    // Counts retired instructions and cycles per class. EXECUTE and the
+    // cycles after it (WAIT_ALU_OR_MEM, and the next FETCH_INSTR /
+    // WAIT_INSTR) are charged to the executed instruction. The state and
+    // the instruction register are sampled after each rising edge of clk. Cycles
+    // are read from the 'cycles' register, so that the cycles skipped by
+    // the functional mode are counted.
+    void monitor_process() {
+        for (;;) {
+            wait(clk.posedge_event());
+            wait(SC_ZERO_TIME);
+            if (reset_cnt < RESET_CYCLES) {
+                reset.write(++reset_cnt >= RESET_CYCLES);
+                last_cycles = cpu->cycles.to_uint();
+                continue;
+            }
+            if (cpu->state == EXECUTE) {
+                uint32_t instr = static_cast<uint32_t>(cpu->full_instr);
+                if (instr == HALT) {
+                    sc_stop();
+                    return;
+                }
+                current_class = classify(instr);
+                result->instret[current_class]++;
+            }
+            uint32_t cycles = cpu->cycles.to_uint();
+            result->sim_cycles += cycles - last_cycles;
+            result->class_cycles[current_class] += cycles - last_cycles;
+            last_cycles = cycles;
+        }
+    }
+
+private:
+    uint32_t reset_cnt = 0;
+    uint32_t last_cycles = 0;
+    InstrClass current_class = CLASS_OTHER;
+};
+
+/*******************************************************************/
+// Kernels
+
+// Integer ALU loop: x6 accumulates, x5 counts down
+BenchProgram create_alu_kernel(uint32_t n) {
+    BenchProgram p;
+    p.name = "alu loop";
+    p.iterations = n;
+    p.instructions = {
+        enc_i(OP_ALUIMM, int32_t(n), 0, ALU_ADD_SUB, 5),  // 0:  addi x5, x0, n
+        enc_i(OP_ALUIMM, 12, 0, ALU_ADD_SUB, 7),          // 4:  addi x7, x0, 12 (loop)
+        enc_i(OP_ALUIMM, 0, 0, ALU_ADD_SUB, 6),           // 8:  addi x6, x0, 0
+        enc_r(0x00, 5, 6, ALU_ADD_SUB, 6),                // 12: add  x6, x6, x5
+        enc_r(0x00, 5, 6, ALU_XOR, 8),                    // 16: xor  x8, x6, x5
+        enc_i(OP_ALUIMM, 255, 8, ALU_AND, 9),             // 20: andi x9, x8, 255
+        enc_r(0x00, 6, 9, ALU_OR, 10),                    // 24: or   x10, x9, x6
+        enc_r(0x00, 5, 10, ALU_SLTU, 11),                 // 28: sltu x11, x10, x5
+        enc_i(OP_ALUIMM, -1, 5, ALU_ADD_SUB, 5),          // 32: addi x5, x5, -1
+        enc_b(8, 0, 5, BRANCH_BEQ),                       // 36: beq  x5, x0, +8
+        enc_i(OP_JALR, 0, 7, 0, 0),                       // 40: jalr x0, 0(x7)
+        HALT                                              // 44
+    };
+    p.check = [](const std::vector<uint32_t>&, const std::vector<uint32_t>& regs, uint32_t n) -> std::string {
+        uint32_t expected = n * (n + 1) / 2;
+        uint32_t actual = regs[6];
+        if (actual != expected) {
+            return "x6 = " + std::to_string(actual) + ", expected " + std::to_string(expected);
+        }
+        return "";
+    };
+    return p;
+}
+
+// Word copy from 0x1000 to 0x2000 (base registers x1 and x5, see above)
+BenchProgram create_memcpy_kernel(uint32_t n) {
+    BenchProgram p;
+    p.name = "memcpy loop";
+    p.iterations = n;
+    p.instructions = {
+        enc_i(OP_ALUIMM, 1, 0, ALU_ADD_SUB, 1),           // 0:  addi x1, x0, 1
+        enc_i(OP_ALUIMM, 12, 1, ALU_SLL, 1),              // 4:  slli x1, x1, 12  (src)
+        enc_i(OP_ALUIMM, 1, 1, ALU_SLL, 5),               // 8:  slli x5, x1, 1   (dst)
+        enc_i(OP_ALUIMM, int32_t(n), 0, ALU_ADD_SUB, 3),  // 12: addi x3, x0, n
+        enc_i(OP_ALUIMM, 20, 0, ALU_ADD_SUB, 7),          // 16: addi x7, x0, 20 (loop)
+        enc_i(OP_LOAD, 0, 1, LOAD_STORE_WORD, 4),         // 20: lw   x4, 0(x1)
+        enc_s(0, 4, 5, LOAD_STORE_WORD),                  // 24: sw   x4, 0(x5)
+        enc_i(OP_ALUIMM, 4, 1, ALU_ADD_SUB, 1),           // 28: addi x1, x1, 4
+        enc_i(OP_ALUIMM, 4, 5, ALU_ADD_SUB, 5),           // 32: addi x5, x5, 4
+        enc_i(OP_ALUIMM, -1, 3, ALU_ADD_SUB, 3),          // 36: addi x3, x3, -1
+        enc_b(8, 0, 3, BRANCH_BEQ),                       // 40: beq  x3, x0, +8
+        enc_i(OP_JALR, 0, 7, 0, 0),                       // 44: jalr x0, 0(x7)
+        HALT                                              // 48
+    };
+    p.data_addr = 0x1000;
+    for (uint32_t i = 0; i < n; i++) {
+        p.data.push_back(0x9E3779B9u * (i + 1));
+    }
+    p.check = [](const std::vector<uint32_t>& memory, const std::vector<uint32_t>&, uint32_t n) -> std::string {
+        for (uint32_t i = 0; i < n; i++) {
+            if (memory[0x2000 / 4 + i] != memory[0x1000 / 4 + i]) {
+                return "word " + std::to_string(i) + " not copied";
+            }
+        }
+        return "";
+    };
+    return p;
+}
+
+// Shift-heavy loop, exercises the multi-cycle shifter (aluShamt)
+BenchProgram create_shift_kernel(uint32_t n) {
+    BenchProgram p;
+    p.name = "shift loop";
+    p.iterations = n;
+    p.instructions = {
+        enc_i(OP_ALUIMM, int32_t(n), 0, ALU_ADD_SUB, 5),  // 0:  addi x5, x0, n
+        enc_i(OP_ALUIMM, 8, 0, ALU_ADD_SUB, 7),           // 4:  addi x7, x0, 8 (loop)
+        enc_i(OP_ALUIMM, 13, 5, ALU_SLL, 8),              // 8:  slli x8, x5, 13
+        enc_i(OP_ALUIMM, 7, 8, ALU_SRL_SRA, 9),           // 12: srli x9, x8, 7
+        enc_i(OP_ALUIMM, 0x400 | 20, 8, ALU_SRL_SRA, 10), // 16: srai x10, x8, 20
+        enc_r(0x00, 5, 9, ALU_SLL, 11),                   // 20: sll  x11, x9, x5
+        enc_r(0x20, 5, 11, ALU_SRL_SRA, 12),              // 24: sra  x12, x11, x5
+        enc_i(OP_ALUIMM, -1, 5, ALU_ADD_SUB, 5),          // 28: addi x5, x5, -1
+        enc_b(8, 0, 5, BRANCH_BEQ),                       // 32: beq  x5, x0, +8
+        enc_i(OP_JALR, 0, 7, 0, 0),                       // 36: jalr x0, 0(x7)
+        HALT                                              // 40
+    };
+    p.check = [](const std::vector<uint32_t>&, const std::vector<uint32_t>& regs, uint32_t) -> std::string {
+        // Last iteration: x5 = 1
+        uint32_t x8 = 1u << 13, x9 = x8 >> 7, x11 = x9 << 1;
+        uint32_t x12 = uint32_t(int32_t(x11) >> 1);
+        if (regs[12] != x12) {
+            return "x12 = " + std::to_string(regs[12]) +
+                   ", expected " + std::to_string(x12);
+        }
+        return "";
+    };
+    return p;
+}
+
+/*******************************************************************/
+
+template <class CPU>
+BenchResult run_bench(const BenchProgram& program) {
+    BenchResult result;
+    result.name = program.name;
+
+    BenchHarness<CPU> harness("harness", &result);
+    std::copy(program.instructions.begin(), program.instructions.end(), harness.memory.begin());
+    std::copy(program.data.begin(), program.data.end(), harness.memory.begin() + program.data_addr / 4);
+
+    // Generous bound, in case the program does not reach HALT
+    sc_time max_time = harness.clk.period() * (1000.0 + 200.0 * program.iterations);
+
+    auto wall_start = std::chrono::steady_clock::now();
+    sc_start(max_time);
+    result.wall_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - wall_start
+    ).count();
+
+    if (sc_get_status() != SC_STOPPED) {
+        result.message = "did not reach HALT";
+    } else {
+        result.message = program.check(harness.memory, harness.registers(), program.iterations);
+    }
+    result.passed = result.message.empty();
+    return result;
+}
+
+// Configurations of the model benchmarked side by side
+struct BenchConfig {
+    const char* name;
+    BenchResult (*run)(const BenchProgram&);
+};
+
+static const BenchConfig configs[] = {
+    { "one-level shifter", run_bench<FemtoRV32_Quark_OneLevelShifter> },
+    { "two-level shifter", run_bench<FemtoRV32_Quark_TwoLevelShifter> }
+};
+
+int sc_main(int argc, char* argv[]) {
+    std::cout << "FemtoRV32 Quark SystemC Benchmark" << std::endl;
+    std::cout << "=================================" << std::endl;
+#ifdef NRV_NATIVE_MODEL
+    std::cout << "Model: native (uint32_t)" << std::endl;
+#else
+    std::cout << "Model: sc_uint" << std::endl;
+#endif
+
+    uint32_t iterations = 2000;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-f")) {
+            functional_mode = true;
+        } else {
+            iterations = uint32_t(atoi(argv[i]));
+        }
+    }
+    if (functional_mode) {
+        std::cout << "Functional mode (shifts in one evaluation)" << std::endl;
+    }
+    if (iterations < 1 || iterations > 2047) {
+        std::cerr << "iterations must be in [1, 2047] (addi immediate)" << std::endl;
+        return 1;
+    }
+    std::cout << "Iterations: " << iterations << std::endl << std::endl;
+
+    std::vector<BenchProgram> kernels = {
+        create_alu_kernel(iterations),
+        create_memcpy_kernel(iterations),
+        create_shift_kernel(iterations)
+    };
+
+    std::vector<BenchProgram> programs;
+    for (const BenchProgram& kernel : kernels) {
+        for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+            BenchProgram p = kernel;
+            p.name += std::string(" (") + configs[c].name + ")";
+            p.config = c;
+            programs.push_back(p);
+        }
+    }
+
+    std::vector<BenchResult> results =
+        run_tests_forked<BenchProgram, BenchResult>(programs, 1, [](const BenchProgram& p) {
+            return configs[p.config].run(p);
+        });
+
+    int failed = 0;
+    for (const BenchResult& r : results) {
+        uint64_t instret = r.total_instret();
+        double seconds = r.wall_ms / 1000.0;
+        std::cout << (r.passed ? "✅ " : "❌ ") << r.name;
+        if (!r.passed) {
+            std::cout << " (" << r.message << ")";
+            failed++;
+        }
+        std::cout << std::endl;
+        std::cout << std::fixed << std::setprecision(3)
+                  << "  instructions " << instret << ", cycles " << r.sim_cycles
+                  << ", CPI " << (instret ? double(r.sim_cycles) / double(instret) : 0.0) << std::endl
+                  << "  wall " << std::setprecision(2) << r.wall_ms << " ms, "
+                  << std::setprecision(3) << (seconds > 0 ? instret / seconds / 1e6 : 0.0) << " MIPS, "
+                  << (seconds > 0 ? r.sim_cycles / seconds / 1e6 : 0.0) << " Mcycles/s" << std::endl;
+        for (int c = 0; c < NB_CLASSES; c++) {
+            if (r.instret[c] == 0) continue;
+            std::cout << "    " << std::left << std::setw(7) << class_names[c] << std::right
+                      << std::setw(8) << r.instret[c] << " instr, CPI "
+                      << double(r.class_cycles[c]) / double(r.instret[c]) << std::endl;
+        }
+        std::cout << std::defaultfloat;
+    }
+
+    if (failed > 0) {
+        std::cout << std::endl << "❌ Some benchmarks failed." << std::endl;
+        return 1;
+    }
+    std::cout << std::endl << "✅ All benchmarks passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include "../branch_trace.h"
+#include "../branch_predictor.h"
+
+// Trace-driven branch predictor simulator: replays the control-flow
+// traces of benchmarks (iss_run -b, or the instruction traces of the
+// SystemC models) through a library of predictor configurations
+// (branch_predictor.h), in parallel threads, and reports the
+// misprediction rates and the predicted CPI of each (benchmark,
+// predictor) pair.
+//
+// Usage: branch_sim [-j threads] [-base CPI] [-p predictor]... file.btrace...
+//  -j threads:   number of threads (default: number of cores)
+//  -base CPI:    CPI of the pipeline without the flushes (default 1.0,
+//                add the load-use and memory stalls measured on the
+//                pipelined model to compare with it)
+//  -p predictor: predictor specification (branch_predictor.h), can be
+//                repeated (default: the predictors of the tutorial and
+//                a few larger gshare tables)
+//
+// Example:
+//  ./tests/iss_run -b coremark.btrace coremark.elf
+//  ./tests/iss_run -b dhrystone.btrace dhrystone.elf
+//  ./tests/branch_sim coremark.btrace dhrystone.btrace
+
+static const char* DEFAULT_PREDICTORS[] = {
+    "none", "btfnt", "btfnt+ras:4", "bimodal:12+ras:4", "gshare:12:9",
+    "gshare:12:9+ras:4", "gshare:10:8+ras:4", "gshare:14:12+ras:8"
+};
+
+static double percent(uint64_t x, uint64_t total) {
+    return total == 0 ? 0.0 : 100.0 * double(x) / double(total);
+}
+
+int main(int argc, char* argv[]) {
+    unsigned nb_threads = std::thread::hardware_concurrency();
+    double base_cpi = 1.0;
+    std::vector<PredictorConfig> predictors;
+    std::string error;
+    while (argc > 1 && argv[1][0] == '-') {
+        if (!strcmp(argv[1], "-j") && argc > 2) {
+            nb_threads = unsigned(strtoul(argv[2], nullptr, 0));
+        } else if (!strcmp(argv[1], "-base") && argc > 2) {
+            base_cpi = strtod(argv[2], nullptr);
+        } else if (!strcmp(argv[1], "-p") && argc > 2) {
+            PredictorConfig config;
+            if (!config.parse(argv[2], error)) {
+                std::cerr << "❌ " << error << std::endl;
+                return 1;
+            }
+            predictors.push_back(config);
+        } else {
+            break;
+        }
+        argv += 2;
+        argc -= 2;
+    }
+    if (argc < 2) {
+        std::cerr << "Usage: branch_sim [-j threads] [-base CPI] [-p predictor]... file.btrace..."
+                  << std::endl;
+        return 1;
+    }
+    if (predictors.empty()) {
+        for (const char* spec : DEFAULT_PREDICTORS) {
+            PredictorConfig config;
+            config.parse(spec, error);
+            predictors.push_back(config);
+        }
+    }
+    if (nb_threads == 0) {
+        nb_threads = 1;
+    }
+
+    std::vector<BranchTrace> traces(size_t(argc - 1));
+    for (size_t i = 0; i < traces.size(); i++) {
+        if (!read_branch_trace(argv[i + 1], traces[i], error)) {
+            std::cerr << "❌ " << error << std::endl;
+            return 1;
+        }
+        std::cerr << "📄 " << traces[i].name << ": " << traces[i].records.size()
+                  << " branches and jumps, " << traces[i].instret << " instructions" << std::endl;
+    }
+
+    // One job per (trace, predictor), the traces are shared read-only
+    size_t nb_jobs = traces.size() * predictors.size();
+    std::vector<PredictorStats> results(nb_jobs);
+    std::atomic<size_t> next_job(0);
+    auto wall_start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < nb_threads && t < nb_jobs; t++) {
+        threads.emplace_back([&]() {
+            for (size_t job = next_job++; job < nb_jobs; job = next_job++) {
+                results[job] = simulate_predictor(predictors[job % predictors.size()],
+                                                  traces[job / predictors.size()]);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    double wall_s = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - wall_start
+    ).count();
+
+    std::cout << std::fixed;
+    for (size_t i = 0; i < traces.size(); i++) {
+        std::cout << std::endl << "🏁 " << traces[i].name << std::endl;
+        std::cout << std::left << std::setw(22) << "predictor" << std::right
+                  << std::setw(12) << "branches" << std::setw(9) << "miss%"
+                  << std::setw(10) << "JALRs" << std::setw(9) << "miss%"
+                  << std::setw(12) << "flushes" << std::setw(8) << "CPI" << std::endl;
+        for (size_t p = 0; p < predictors.size(); p++) {
+            const PredictorStats& s = results[i * predictors.size() + p];
+            std::cout << std::left << std::setw(22) << predictors[p].spec << std::right
+                      << std::setw(12) << s.branches
+                      << std::setw(9) << std::setprecision(2) << percent(s.branch_misses, s.branches)
+                      << std::setw(10) << s.jalrs
+                      << std::setw(9) << std::setprecision(2) << percent(s.jalr_misses, s.jalrs)
+                      << std::setw(12) << s.flushes()
+                      << std::setw(8) << std::setprecision(3) << s.cpi(base_cpi) << std::endl;
+        }
+    }
+    std::cerr << std::endl << "⏱  " << nb_jobs << " simulations, " << threads.size()
+              << " threads, wall " << std::setprecision(3) << wall_s << " s" << std::endl;
+    return 0;
+}
@@ -0,0 +1,155 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cmath>
+#include "../femtorv32_iss.h"
+#include "../harness_memory.h"
+#include "../branch_trace.h"
+#include "../branch_predictor.h"
+#include "../quark_trace.h"
+
+// Test of the branch predictor simulator: parsing of the predictor
+// specifications, control-flow traces written by the ISS (both
+// execution engines), branch trace files and instruction traces of the
+// SystemC models, and the mispredictions of each predictor on a loop
+// that calls a function.
+//
+// Usage: branch_test
+
+static int failures = 0;
+
+static void check(bool ok, const std::string& what) {
+    std::cout << (ok ? "  ✅ " : "  ❌ ") << what << std::endl;
+    if (!ok) {
+        failures++;
+    }
+}
+
+// Calls 'func' 10 times
+static const std::vector<uint32_t> CALL_LOOP = {
+    0x00A00293,  // addi x5, x0, 10
+    0x010000EF,  // loop: jal x1, func
+    0xFFF28293,  // addi x5, x5, -1
+    0xFE029CE3,  // bne x5, x0, loop
+    0x0000006F,  // halt
+    0x00130313,  // func: addi x6, x6, 1
+    0x00008067   // ret
+};
+
+static bool run_iss(bool use_blocks, const char* filename, BranchTrace& trace) {
+    HarnessMemory memory(4096);
+    memory.load(CALL_LOOP);
+    FemtoRV32_ISS iss(memory);
+    iss.use_blocks = use_blocks;
+    std::string error;
+    BranchTraceWriter writer;
+    if (!writer.open(filename, error)) {
+        std::cout << "  " << error << std::endl;
+        return false;
+    }
+    iss.branch_trace = &writer;
+    bool ok = iss.run(10000) == FemtoRV32_ISS::HALTED && writer.close(iss.instret);
+    ok = ok && read_branch_trace(filename, trace, error);
+    if (!error.empty()) {
+        std::cout << "  " << error << std::endl;
+    }
+    remove(filename);
+    return ok;
+}
+
+static PredictorStats simulate(const std::string& spec, const BranchTrace& trace) {
+    PredictorConfig config;
+    std::string error;
+    if (!config.parse(spec, error)) {
+        std::cout << "  " << error << std::endl;
+    }
+    return simulate_predictor(config, trace);
+}
+
+int main() {
+    std::cout << "FemtoRV32 Branch Predictor Simulator Test" << std::endl;
+    std::cout << "=========================================" << std::endl;
+
+    std::cout << "🔍 Specifications" << std::endl;
+    {
+        PredictorConfig c;
+        std::string error;
+        check(c.parse("gshare:12:9+ras:4", error) && c.scheme == SCHEME_GSHARE &&
+              c.index_bits == 12 && c.history_bits == 9 && c.ras_depth == 4, "gshare with a RAS");
+        check(c.parse("bimodal:10", error) && c.scheme == SCHEME_BIMODAL &&
+              c.index_bits == 10 && c.ras_depth == 0, "bimodal");
+        check(c.parse("btfnt", error) && c.scheme == SCHEME_BTFNT, "btfnt");
+        check(!c.parse("gshare:8:9", error), "history longer than the index rejected");
+        check(!c.parse("none+ras:4", error), "RAS without prediction rejected");
+        check(!c.parse("btfnt+ras:0", error), "empty RAS rejected");
+        check(!c.parse("perceptron", error), "unknown scheme rejected");
+    }
+
+    std::cout << "🔀 Traces" << std::endl;
+    BranchTrace blocks, interpreter;
+    check(run_iss(true, "branch_test_blocks.btrace", blocks), "ISS with block translation");
+    check(run_iss(false, "branch_test_interpreter.btrace", interpreter), "ISS interpreter");
+    check(blocks.records.size() == 30 && blocks.instret == 51,
+          "30 branches and jumps, 51 instructions (" + std::to_string(blocks.records.size()) + ", " +
+          std::to_string(blocks.instret) + ")");
+    bool same = blocks.records.size() == interpreter.records.size() &&
+                blocks.instret == interpreter.instret;
+    for (size_t i = 0; same && i < blocks.records.size(); i++) {
+        const BranchRecord& a = blocks.records[i];
+        const BranchRecord& b = interpreter.records[i];
+        same = a.pc == b.pc && a.target == b.target && a.kind == b.kind && a.flags == b.flags &&
+               a.rd == b.rd && a.rs1 == b.rs1;
+    }
+    check(same, "same trace with both execution engines");
+    if (blocks.records.size() >= 30) {
+        const BranchRecord& last = blocks.records[29];
+        check(last.kind == KIND_BRANCH && last.pc == 0x0C && last.target == 0x04 && !last.taken(),
+              "branch record: target and outcome of the loop exit");
+    }
+
+    // Same program, as an instruction trace of the SystemC models
+    {
+        TraceSink<true> sink;
+        for (int i = 0; i < 10; i++) {
+            sink.record(0, 0x0C, 0xFE029CE3, 0, 0);     // bne x5, x0, loop
+            uint32_t pc = (i < 9) ? 0x04 : 0x10;
+            sink.record(0, pc, (pc == 0x04) ? 0x010000EF : 0x0000006F, 0, 0);
+        }
+        BranchTrace converted;
+        std::string error;
+        bool ok = sink.dump("branch_test.trace") && read_branch_trace("branch_test.trace", converted, error);
+        remove("branch_test.trace");
+        // The jal x1 after each taken branch is also a record, not the halt (last one)
+        check(ok && converted.records.size() == 19 && converted.instret == 19 &&
+              converted.records[0].taken() && converted.records[0].target == 0x04 &&
+              !converted.records[18].taken(), "instruction trace converted");
+    }
+
+    std::cout << "🎯 Predictors" << std::endl;
+    {
+        PredictorStats none = simulate("none", blocks);
+        check(none.branches == 10 && none.branch_misses == 9 && none.jal_flushes == 10 &&
+              none.jalr_misses == 10 && none.flushes() == 29, "none: every taken jump flushes");
+        PredictorStats btfnt = simulate("btfnt", blocks);
+        check(btfnt.branch_misses == 1 && btfnt.jal_flushes == 0 && btfnt.jalr_misses == 10,
+              "btfnt: loop exit, and every return");
+        PredictorStats ras = simulate("btfnt+ras:4", blocks);
+        check(ras.flushes() == 1 && ras.jalrs == 10, "btfnt+ras:4: returns predicted");
+        PredictorStats bimodal = simulate("bimodal:4+ras:1", blocks);
+        check(bimodal.branch_misses == 2 && bimodal.jalr_misses == 0,
+              "bimodal: first iteration and loop exit");
+        PredictorStats gshare = simulate("gshare:4:2+ras:4", blocks);
+        check(gshare.branch_misses >= 2 && gshare.branch_misses <= 4,
+              "gshare: trained after a few iterations (" + std::to_string(gshare.branch_misses) + " misses)");
+        check(std::fabs(ras.cpi(1.0) - (1.0 + 2.0 / 51.0)) < 1e-9, "predicted CPI");
+    }
+
+    std::cout << std::endl;
+    if (failures == 0) {
+        std::cout << "🎉 All branch predictor tests passed" << std::endl;
+        return 0;
+    }
+    std::cout << "❌ " << failures << " check(s) failed" << std::endl;
+    return 1;
+}
@@ -0,0 +1,209 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include "../femtorv32_iss.h"
+#include "../harness_memory.h"
+#include "../memory_latency.h"
+
+// Cache sweep: runs benchmarks (firmware ELFs) on the host ISS with
+// each (instruction memory, data memory) pair of a library of latency
+// models (memory_latency.h: caches, SPI flash line buffer), in parallel
+// threads, and reports the hit rates and the estimated cycles of each
+// configuration, to size the caches of a core before synthesis (an
+// IceStick femtosoc executing from the SPI flash, the I$ / D$ of a
+// LiteX VexRiscv).
+//
+// Usage: cache_sweep [-j threads] [-n max_instructions] [-I spec]... [-D spec]... file.elf...
+//  -j threads:          number of threads (default: number of cores)
+//  -n max_instructions: instructions per run (default 10000000000), or
+//                       until the firmware halts
+//  -I spec:             model of the instruction fetches, can be
+//                       repeated ('none': no wait cycle)
+//  -D spec:             model of the RAM loads and stores, can be
+//                       repeated ('none': no wait cycle)
+// Every -I model is combined with every -D model (default: the
+// libraries below). The estimated cycles assume one instruction per
+// cycle plus the wait cycles (the ISS does not model the pipeline).
+//
+// Example:
+//  ./tests/cache_sweep -I flash:28,16 -I flash:28,16,32 -I cache:4096,1,32,44 dhrystone.elf
+
+static const char* DEFAULT_IMODELS[] = {
+    "none", "flash:28,16", "flash:28,16,16", "flash:28,16,32",
+    "cache:1024,1,16,20", "cache:2048,1,32,20", "cache:4096,1,32,20",
+    "cache:4096,2,32,20", "cache:8192,2,32,20"
+};
+
+static const char* DEFAULT_DMODELS[] = {
+    "none", "cache:1024,1,16,20", "cache:4096,1,32,20", "cache:4096,2,32,20"
+};
+
+struct SweepResult {
+    bool loaded = false;
+    bool ok = false;
+    FemtoRV32_ISS::StopReason stop = FemtoRV32_ISS::RUNNING;
+    uint64_t instret = 0;
+    uint64_t wait_cycles = 0;
+    uint64_t ihits = 0, imisses = 0;
+    uint64_t dhits = 0, dmisses = 0;
+};
+
+// Null for 'none'
+static std::unique_ptr<MemoryLatency> create_model(const std::string& spec, std::string& error) {
+    if (spec == "none") {
+        return nullptr;
+    }
+    return MemoryLatency::create(spec, error);
+}
+
+static SweepResult run(const char* filename, const std::string& ispec, const std::string& dspec,
+                       uint64_t max_instructions) {
+    SweepResult result;
+    std::string error;
+    HarnessMemory memory(4u * 1024 * 1024);
+    if (!memory.load_elf(filename, error)) {
+        return result;
+    }
+    result.loaded = true;
+    std::unique_ptr<MemoryLatency> icache = create_model(ispec, error);
+    std::unique_ptr<MemoryLatency> dcache = create_model(dspec, error);
+    FemtoRV32_ISS iss(memory);
+    iss.quiet_uart = true;
+    iss.icache = icache.get();
+    iss.dcache = dcache.get();
+    result.stop = iss.run(max_instructions);
+    result.ok = (result.stop == FemtoRV32_ISS::RUNNING || result.stop == FemtoRV32_ISS::HALTED ||
+                 result.stop == FemtoRV32_ISS::EBREAK || result.stop == FemtoRV32_ISS::ECALL);
+    result.instret = iss.instret;
+    result.wait_cycles = iss.memory_wait_cycles;
+    if (icache) {
+        result.ihits = icache->hits();
+        result.imisses = icache->misses();
+    }
+    if (dcache) {
+        result.dhits = dcache->hits();
+        result.dmisses = dcache->misses();
+    }
+    return result;
+}
+
+static std::string hit_rate(const std::string& spec, uint64_t hits, uint64_t misses) {
+    if (spec == "none" || hits + misses == 0) {
+        return "-";
+    }
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2) << 100.0 * double(hits) / double(hits + misses);
+    return out.str();
+}
+
+static bool add_model(std::vector<std::string>& models, const char* spec) {
+    std::string error;
+    if (strcmp(spec, "none") != 0 && !MemoryLatency::create(spec, error)) {
+        std::cerr << "❌ " << error << std::endl;
+        return false;
+    }
+    models.push_back(spec);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned nb_threads = std::thread::hardware_concurrency();
+    uint64_t max_instructions = 10000000000ull;
+    std::vector<std::string> imodels, dmodels;
+    while (argc > 1 && argv[1][0] == '-') {
+        if (!strcmp(argv[1], "-j") && argc > 2) {
+            nb_threads = unsigned(strtoul(argv[2], nullptr, 0));
+        } else if (!strcmp(argv[1], "-n") && argc > 2) {
+            max_instructions = strtoull(argv[2], nullptr, 0);
+        } else if (!strcmp(argv[1], "-I") && argc > 2) {
+            if (!add_model(imodels, argv[2])) {
+                return 1;
+            }
+        } else if (!strcmp(argv[1], "-D") && argc > 2) {
+            if (!add_model(dmodels, argv[2])) {
+                return 1;
+            }
+        } else {
+            break;
+        }
+        argv += 2;
+        argc -= 2;
+    }
+    if (argc < 2) {
+        std::cerr << "Usage: cache_sweep [-j threads] [-n max_instructions] [-I spec]... [-D spec]... file.elf..."
+                  << std::endl;
+        return 1;
+    }
+    if (imodels.empty()) {
+        imodels.assign(std::begin(DEFAULT_IMODELS), std::end(DEFAULT_IMODELS));
+    }
+    if (dmodels.empty()) {
+        dmodels.assign(std::begin(DEFAULT_DMODELS), std::end(DEFAULT_DMODELS));
+    }
+    if (nb_threads == 0) {
+        nb_threads = 1;
+    }
+
+    // One job per (benchmark, I model, D model), each with its own
+    // memory and ISS
+    std::vector<const char*> benchmarks(argv + 1, argv + argc);
+    size_t nb_configs = imodels.size() * dmodels.size();
+    size_t nb_jobs = benchmarks.size() * nb_configs;
+    std::vector<SweepResult> results(nb_jobs);
+    std::atomic<size_t> next_job(0);
+    auto wall_start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < nb_threads && t < nb_jobs; t++) {
+        threads.emplace_back([&]() {
+            for (size_t job = next_job++; job < nb_jobs; job = next_job++) {
+                size_t config = job % nb_configs;
+                results[job] = run(benchmarks[job / nb_configs], imodels[config / dmodels.size()],
+                                   dmodels[config % dmodels.size()], max_instructions);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    double wall_s = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - wall_start
+    ).count();
+
+    int status = 0;
+    for (size_t b = 0; b < benchmarks.size(); b++) {
+        std::cout << std::endl << "🏁 " << benchmarks[b] << std::endl;
+        std::cout << std::left << std::setw(22) << "I model" << std::setw(22) << "D model" << std::right
+                  << std::setw(9) << "I hit%" << std::setw(9) << "D hit%"
+                  << std::setw(14) << "wait cycles" << std::setw(14) << "cycles" << std::setw(8) << "CPI"
+                  << std::endl;
+        for (size_t config = 0; config < nb_configs; config++) {
+            const SweepResult& r = results[b * nb_configs + config];
+            const std::string& ispec = imodels[config / dmodels.size()];
+            const std::string& dspec = dmodels[config % dmodels.size()];
+            std::cout << std::left << std::setw(22) << ispec << std::setw(22) << dspec << std::right;
+            if (!r.ok) {
+                std::cout << "  ❌ " << (!r.loaded ? "cannot load the ELF" :
+                                         FemtoRV32_ISS::stop_reason_name(r.stop)) << std::endl;
+                status = 2;
+                continue;
+            }
+            uint64_t cycles = r.instret + r.wait_cycles;
+            std::cout << std::setw(9) << hit_rate(ispec, r.ihits, r.imisses)
+                      << std::setw(9) << hit_rate(dspec, r.dhits, r.dmisses)
+                      << std::setw(14) << r.wait_cycles << std::setw(14) << cycles
+                      << std::setw(8) << std::fixed << std::setprecision(3)
+                      << (r.instret == 0 ? 0.0 : double(cycles) / double(r.instret)) << std::endl;
+        }
+    }
+    std::cerr << std::endl << "⏱  " << nb_jobs << " runs, " << threads.size()
+              << " threads, wall " << std::fixed << std::setprecision(3) << wall_s << " s" << std::endl;
+    return status;
+}
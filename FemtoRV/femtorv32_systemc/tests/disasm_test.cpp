@@ -0,0 +1,116 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "../riscv_disasm.h"
+
+// Test of the RV32IMF disassembler (riscv_disasm.h): the text of known
+// encodings (RV32I, M, F, CSRs, pseudo-instructions, unknown words),
+// the destination registers, then measures the disassembly speed.
+//
+// Usage: disasm_test [nb_instructions]
+
+struct DisasmCase {
+    uint32_t instr;
+    uint32_t pc;
+    const char* text;
+};
+
+static const DisasmCase CASES[] = {
+    { 0x00500093, 0x0,    "addi    x1,x0,5" },
+    { 0xFFF10513, 0x0,    "addi    x10,x2,-1" },
+    { 0x403100B3, 0x0,    "sub     x1,x2,x3" },
+    { 0x40735293, 0x0,    "srai    x5,x6,7" },
+    { 0x02C5C533, 0x0,    "div     x10,x11,x12" },
+    { 0xFFC12403, 0x0,    "lw      x8,-4(x2)" },
+    { 0x7E950FA3, 0x0,    "sb      x9,2047(x10)" },
+    { 0xFE115CE3, 0x100,  "bge     x2,x1,0xf8" },
+    { 0x001000EF, 0x1000, "jal     x1,0x1800" },
+    { 0x0000006F, 0x40,   "j       0x40" },
+    { 0x00C280E7, 0x0,    "jalr    x1,x5,12" },
+    { 0x12345037, 0x0,    "lui     x0,0x12345" },
+    { 0xFFFFF517, 0x2000, "auipc   x10,0xfffff <0x1000>" },
+    { 0x00008067, 0x0,    "ret" },
+    { 0x00000013, 0x0,    "nop" },
+    { 0x00100073, 0x0,    "ebreak" },
+    { 0x30200073, 0x0,    "mret" },
+    { 0xC00022F3, 0x0,    "rdcycle x5" },
+    { 0xC8202373, 0x0,    "rdinstreth x6" },
+    { 0x30041073, 0x0,    "csrrw   x0,mstatus,x8" },
+    { 0x7C01E273, 0x0,    "csrrsi  x4,0x7c0,3" },
+    { 0x00852087, 0x0,    "flw     f1,8(x10)" },
+    { 0xFE312827, 0x0,    "fsw     f3,-16(x2)" },
+    { 0x003170D3, 0x0,    "fadd.s  f1,f2,f3" },
+    { 0x183110D3, 0x0,    "fdiv.s  f1,f2,f3,rtz" },
+    { 0x203170CB, 0x0,    "fnmsub.s f1,f2,f3,f4" },
+    { 0xC0001553, 0x0,    "fcvt.w.s x10,f0,rtz" },
+    { 0xA0209553, 0x0,    "flt.s   x10,f1,f2" },
+    { 0xF0058153, 0x0,    "fmv.w.x f2,x11" },
+    { 0xD015F153, 0x0,    "fcvt.s.wu f2,x11" },
+    { 0xFFFFFFFF, 0x0,    ".word   0xffffffff" },
+    { 0x00000000, 0x0,    ".word   0x00000000" }
+};
+
+static int failures = 0;
+
+static void check(bool ok, const std::string& what) {
+    std::cout << (ok ? "  ✅ " : "  ❌ ") << what << std::endl;
+    if (!ok) {
+        failures++;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t nb_instructions = (argc > 1) ? strtoull(argv[1], nullptr, 0) : 10000000;
+
+    std::cout << "FemtoRV32 Disassembler Test" << std::endl;
+    std::cout << "===========================" << std::endl;
+
+    std::cout << "🔍 Instructions" << std::endl;
+    char text[RISCV_DISASM_MAX];
+    for (const DisasmCase& c : CASES) {
+        size_t length = riscv_disasm(text, c.instr, c.pc);
+        bool ok = std::string(text) == c.text && length == std::string(c.text).size();
+        std::ostringstream what;
+        what << std::hex << std::setw(8) << std::setfill('0') << c.instr << "  " << text;
+        if (!ok) {
+            what << "  (expected \"" << c.text << "\")";
+        }
+        check(ok, what.str());
+    }
+
+    std::cout << "🔍 Destination registers" << std::endl;
+    check(riscv_disasm_dest(0x00500093) == 1, "addi x1 writes x1");
+    check(riscv_disasm_dest(0x12345037) == -1, "lui x0 writes nothing");
+    check(riscv_disasm_dest(0x7E950FA3) == -1, "sb writes nothing");
+    check(riscv_disasm_dest(0xFE115CE3) == -1, "bge writes nothing");
+    check(riscv_disasm_dest(0x00852087) == 33, "flw f1 writes f1");
+    check(riscv_disasm_dest(0xA0209553) == 10, "flt.s x10 writes x10");
+    check(riscv_disasm_dest(0xD015F153) == 34, "fcvt.s.wu f2 writes f2");
+    check(riscv_disasm_dest(0xFFFFFFFF) == -1, "unknown writes nothing");
+
+    // Speed: the cases in a loop, the text summed so that it is not
+    // optimized away
+    const size_t nb_cases = sizeof(CASES) / sizeof(CASES[0]);
+    uint64_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t n = 0; n < nb_instructions; n++) {
+        const DisasmCase& c = CASES[n % nb_cases];
+        checksum += riscv_disasm(text, c.instr, uint32_t(n) * 4) + uint8_t(text[8]);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "⏱  " << nb_instructions << " instructions in " << std::fixed << std::setprecision(3)
+              << seconds << " s: " << std::setprecision(1)
+              << (seconds > 0.0 ? double(nb_instructions) / seconds / 1e6 : 0.0)
+              << " M instructions/s (checksum " << checksum << ")" << std::endl;
+
+    if (failures != 0) {
+        std::cout << std::endl << "❌ Some tests failed." << std::endl;
+        return 1;
+    }
+    std::cout << std::endl << "✅ All tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,354 @@
+#include <systemc.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include "../femtorv32_quark.h"
+#include "../harness_memory.h"
+#include "../pc_profile.h"
+#include "../memory_latency.h"
+#include "../wave_trace.h"
+
+// Runs a statically linked firmware ELF (e.g. from FemtoRV/FIRMWARE,
+// linked with CRT/baremetal.ld) on the pin-level FemtoRV32_Quark model.
+//
+// Usage: elf_run [-f] [-p period] [-m model] [-w window] file.elf [max_cycles] [ram_bytes]
+//  -f:         functional mode (FemtoRV32_Quark::functional_mode, shifts
+//              complete in one evaluation, for validation runs)
+//  -p period:  samples the PC every 'period' cycles (pc_profile.h), and
+//              writes a flat profile to file.elf.prof and a folded-stack
+//              file (for flamegraph.pl) to file.elf.folded
+//  -m model:   memory latency model (memory_latency.h), for instance
+//              flash:28,16 (IceStick) or sdram:4,8 (ULX3S), drives
+//              mem_rbusy / mem_wbusy and reports the wait cycles
+//              per access type (default: no wait cycle)
+//  -w window:  VCD waveform of a window of the run (wave_trace.h), for
+//              instance out.vcd,pc=0x1234,cycles=2000,signals=pc+mem_*
+//              (one sample per cycle: pc, state, instr, the memory
+//              interface, x1 ... x31)
+//  max_cycles: simulation stops after max_cycles (default 10000000),
+//              or when the processor reaches a 'jal x0, 0' loop.
+//  ram_bytes:  size of the RAM (default 4 MB, the IO page starts at 0x400000).
+//
+// Memory-mapped IO (same addresses as the femtosoc, see
+// FIRMWARE/LIBFEMTORV32/femtorv32.h) implements the UART (written
+// characters go to stdout, never busy, no input) and the RAM size
+// hardware config register read by the CRT to initialize sp.
+
+static const uint32_t IO_BASE          = 0x400000;
+static const uint32_t IO_UART_DAT      = 1u << (2 + 1);
+static const uint32_t IO_HW_CONFIG_RAM = 1u << (2 + 17);
+static const uint32_t HALT             = 0x0000006F; // jal x0, 0
+
+class ElfHarness : public sc_module {
+public:
+    sc_clock clk;
+    sc_signal<bool> reset;
+    sc_signal<bool> mem_rstrb;
+    sc_signal<sc_uint<32>> mem_addr;
+    sc_signal<sc_uint<32>> mem_rdata;
+    sc_signal<bool> mem_rbusy;
+    sc_signal<bool> mem_wbusy;
+    sc_signal<sc_uint<4>> mem_wmask;
+    sc_signal<sc_uint<32>> mem_wdata;
+
+    FemtoRV32_Quark* cpu;
+    HarnessMemory memory;
+    uint64_t max_cycles;
+    uint64_t nb_cycles = 0;
+    uint64_t instret = 0;
+    bool halted = false;
+
+    PCProfile profile;
+    uint64_t profile_period = 0; // 0: no profiling
+    uint32_t fetch_pc = 0;       // PC of the instruction being fetched
+
+    std::unique_ptr<MemoryLatency> latency; // null: no wait cycle
+    bool fetch_request = false;  // mem_rstrb is an instruction fetch
+
+    std::unique_ptr<WaveWindow> wave_window; // null: no waveform
+    VCDWriter wave;
+    std::vector<std::pair<int, int>> wave_probes; // VCD id, probe index
+
+    ElfHarness(sc_module_name name, size_t ram_bytes, uint64_t max_cycles) :
+        sc_module(name), clk("clk", 10, SC_NS), memory(ram_bytes), max_cycles(max_cycles) {
+        cpu = new FemtoRV32_Quark("cpu");
+        cpu->clk(clk);
+        cpu->reset(reset);
+        cpu->mem_rstrb(mem_rstrb);
+        cpu->mem_addr(mem_addr);
+        cpu->mem_rdata(mem_rdata);
+        cpu->mem_rbusy(mem_rbusy);
+        cpu->mem_wbusy(mem_wbusy);
+        cpu->mem_wmask(mem_wmask);
+        cpu->mem_wdata(mem_wdata);
+
+        SC_METHOD(memory_process);
+        sensitive << mem_rstrb << mem_addr << mem_wmask << mem_wdata;
+
+        SC_METHOD(latency_process);
+        sensitive << clk.posedge_event(); // same edge as the state machine
+
+        SC_THREAD(monitor_process);
+    }
+
+    ~ElfHarness() {
+        delete cpu;
+    }
+
+    static bool is_io(uint32_t addr) {
+        return (addr & (3u << 22)) != 0; // NRV_IS_IO_ADDR
+    }
+
+    void memory_process() {
+        uint32_t addr = mem_addr.read().to_uint();
+        bool io = is_io(addr);
+        if (mem_rstrb.read()) {
+            fetch_request = (cpu->state == FETCH_INSTR);
+            if (!io) {
+                mem_rdata.write(memory.read_word(addr));
+            } else if ((addr - IO_BASE) == IO_HW_CONFIG_RAM) {
+                mem_rdata.write(uint32_t(memory.size()));
+            } else {
+                mem_rdata.write(0); // UART: not busy, no data
+            }
+        }
+        uint32_t wmask = mem_wmask.read().to_uint();
+        if (wmask != 0) {
+            uint32_t data = mem_wdata.read().to_uint();
+            if (!io) {
+                memory.write_word(addr, data, wmask);
+            } else if ((addr - IO_BASE) == IO_UART_DAT) {
+                putchar(int(data & 0xFF));
+                fflush(stdout);
+            }
+        }
+    }
+
+    // Signal values at the clock edge are the request of the cycle that
+    // ends: starts the access, or counts down the wait cycles.
+    void latency_process() {
+        if (!latency) {
+            return;
+        }
+        uint32_t addr = mem_addr.read().to_uint();
+        bool write = mem_wmask.read().to_uint() != 0;
+        bool request = (mem_rstrb.read() || write) && !is_io(addr);
+        MemoryAccessType type = write ? ACCESS_STORE : (fetch_request ? ACCESS_FETCH : ACCESS_LOAD);
+        bool busy = latency->clock(request, type, addr);
+        bool store = (latency->busy_type() == ACCESS_STORE);
+        mem_rbusy.write(busy && !store);
+        mem_wbusy.write(busy && store);
+    }
+
+    // Signals of the waveform, sampled by the monitor after each edge
+    uint64_t probe(int index) const {
+        switch (index) {
+            case 0: return cpu->PC.to_uint();
+            case 1: return uint64_t(cpu->state);
+            case 2: return cpu->full_instr.to_uint();
+            case 3: return mem_addr.read().to_uint();
+            case 4: return mem_rdata.read().to_uint();
+            case 5: return mem_wdata.read().to_uint();
+            case 6: return mem_wmask.read().to_uint();
+            case 7: return mem_rstrb.read();
+            case 8: return mem_rbusy.read();
+            case 9: return mem_wbusy.read();
+            default: return cpu->registerFile[index - 9].to_uint();
+        }
+    }
+
+    // Declares the selected signals and creates the VCD file (one time
+    // unit per cycle)
+    bool open_wave(std::string& error) {
+        static const char* names[] = {
+            "pc", "state", "instr", "mem_addr", "mem_rdata", "mem_wdata",
+            "mem_wmask", "mem_rstrb", "mem_rbusy", "mem_wbusy"
+        };
+        static const int widths[] = { 32, 2, 32, 32, 32, 32, 4, 1, 1, 1 };
+        for (int i = 0; i < 10 + 31; i++) {
+            std::string name = (i < 10) ? names[i] : "x" + std::to_string(i - 9);
+            if (wave_window->selected(name)) {
+                wave_probes.push_back({ wave.add(name, i < 10 ? widths[i] : 32), i });
+            }
+        }
+        if (wave_probes.empty()) {
+            error = "trace window: no signal selected";
+            return false;
+        }
+        return wave.open(wave_window->file, "10 ns", error);
+    }
+
+    void trace_wave() {
+        if (wave_window->update(nb_cycles, fetch_pc)) {
+            for (const auto& p : wave_probes) {
+                wave.set(p.first, probe(p.second));
+            }
+            wave.dump(nb_cycles);
+        } else if (wave_window->done() && wave.is_open()) {
+            wave.close();
+        }
+    }
+
+    // Releases reset, counts cycles and instructions, stops on HALT
+    // or after max_cycles (the state machine advances on the rising edge).
+    void monitor_process() {
+        reset.write(false);
+        wait(clk.posedge_event());
+        reset.write(true);
+        for (;;) {
+            wait(clk.posedge_event());
+            wait(SC_ZERO_TIME);
+            if (cpu->state == FETCH_INSTR || cpu->state == WAIT_INSTR) {
+                fetch_pc = cpu->PC.to_uint();
+            }
+            if (wave_window) {
+                trace_wave();
+            }
+            if (cpu->state == EXECUTE) {
+                uint32_t instr = static_cast<uint32_t>(cpu->full_instr);
+                if (instr == HALT) {
+                    halted = true;
+                    sc_stop();
+                    return;
+                }
+                ++instret;
+                if (profile_period != 0) {
+                    profile.retire(fetch_pc, instr);
+                }
+            }
+            if (profile_period != 0 && (nb_cycles % profile_period) == 0) {
+                profile.sample(fetch_pc);
+            }
+            if (++nb_cycles >= max_cycles) {
+                sc_stop();
+                return;
+            }
+        }
+    }
+};
+
+int sc_main(int argc, char* argv[]) {
+    bool functional_mode = false;
+    uint64_t profile_period = 0;
+    const char* latency_spec = nullptr;
+    const char* wave_spec = nullptr;
+    while (argc > 1 && argv[1][0] == '-') {
+        if (!strcmp(argv[1], "-f")) {
+            functional_mode = true;
+        } else if (!strcmp(argv[1], "-p") && argc > 2) {
+            profile_period = strtoull(argv[2], nullptr, 0);
+            argv++;
+            argc--;
+        } else if (!strcmp(argv[1], "-m") && argc > 2) {
+            latency_spec = argv[2];
+            argv++;
+            argc--;
+        } else if (!strcmp(argv[1], "-w") && argc > 2) {
+            wave_spec = argv[2];
+            argv++;
+            argc--;
+        } else {
+            break;
+        }
+        argv++;
+        argc--;
+    }
+    if (argc < 2) {
+        std::cerr << "Usage: elf_run [-f] [-p period] [-m model] [-w window] file.elf [max_cycles] [ram_bytes]" << std::endl;
+        return 1;
+    }
+    const char* filename = argv[1];
+    uint64_t max_cycles = (argc > 2) ? strtoull(argv[2], nullptr, 0) : 10000000;
+    size_t ram_bytes = (argc > 3) ? size_t(strtoull(argv[3], nullptr, 0)) : 4u * 1024 * 1024;
+
+    ElfHarness harness("harness", ram_bytes, max_cycles);
+    harness.cpu->functional_mode = functional_mode;
+    harness.profile_period = profile_period;
+
+    std::string error;
+    if (latency_spec != nullptr) {
+        harness.latency = MemoryLatency::create(latency_spec, error);
+        if (!harness.latency) {
+            std::cerr << "❌ " << error << std::endl;
+            return 1;
+        }
+    }
+    if (wave_spec != nullptr) {
+        harness.wave_window = std::make_unique<WaveWindow>();
+        if (!harness.wave_window->parse(wave_spec, error) || !harness.open_wave(error)) {
+            std::cerr << "❌ " << error << std::endl;
+            return 1;
+        }
+    }
+    uint32_t text_address = 0;
+    uint32_t max_address = 0;
+    auto load_start = std::chrono::steady_clock::now();
+    if (!harness.memory.load_elf(filename, error, &text_address, &max_address)) {
+        std::cerr << "❌ " << error << std::endl;
+        return 1;
+    }
+    double load_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - load_start
+    ).count();
+    std::cerr << "📄 " << filename << ": text at 0x" << std::hex << text_address
+              << ", segments end at 0x" << max_address << std::dec
+              << " (loaded in " << std::fixed << std::setprecision(2) << load_ms << " ms)"
+              << std::defaultfloat << std::endl;
+    if (text_address != DEFAULT_RESET_ADDR) {
+        std::cerr << "⚠️  text segment is not at the reset address (0x" << std::hex
+                  << DEFAULT_RESET_ADDR << std::dec << ")" << std::endl;
+    }
+    if (profile_period != 0 && !harness.profile.load_symbols(filename, error)) {
+        std::cerr << "❌ " << error << std::endl;
+        return 1;
+    }
+
+    auto wall_start = std::chrono::steady_clock::now();
+    sc_start();
+    double wall_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - wall_start
+    ).count();
+
+    std::cerr << std::endl
+              << (harness.halted ? "✅ halted" : "⏹  max cycles reached")
+              << " at PC=0x" << std::hex << harness.cpu->PC.to_uint() << std::dec
+              << ", " << harness.instret << " instructions, " << harness.cpu->cycles.to_uint() << " cycles"
+              << ", wall " << std::fixed << std::setprecision(2) << wall_ms << " ms"
+              << std::defaultfloat << std::endl;
+
+    if (harness.latency) {
+        uint64_t cycles = harness.cpu->perf.cycles;
+        harness.latency->print_stats(std::cerr);
+        std::cerr << "  " << harness.latency->total_wait_cycles() << " wait cycles, "
+                  << std::fixed << std::setprecision(1)
+                  << (cycles ? 100.0 * double(harness.latency->total_wait_cycles()) / double(cycles) : 0.0)
+                  << std::defaultfloat << "% of the cycles" << std::endl;
+    }
+
+    if (harness.wave_window) {
+        harness.wave.close();
+        if (harness.wave_window->started()) {
+            std::cerr << "🌊 " << harness.wave.nb_dumps() << " cycles from cycle "
+                      << harness.wave_window->start_cycle() << " in " << harness.wave_window->file << std::endl;
+        } else {
+            std::cerr << "🌊 trace window not reached, " << harness.wave_window->file << " is empty" << std::endl;
+        }
+    }
+
+    if (profile_period != 0) {
+        std::string flat_file = std::string(filename) + ".prof";
+        std::string folded_file = std::string(filename) + ".folded";
+        if (!harness.profile.write_flat(flat_file.c_str()) ||
+            !harness.profile.write_folded(folded_file.c_str())) {
+            std::cerr << "❌ could not write the profile" << std::endl;
+            return 1;
+        }
+        std::cerr << "📊 " << harness.profile.size() << " samples, profile in "
+                  << flat_file << " and " << folded_file << std::endl;
+    }
+    return 0;
+}
@@ -2,7 +2,14 @@
 #include <iostream>
 #include <vector>
 #include <iomanip>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <cstring>
 #include "../femtorv32_quark.h"
+#include "parallel_runner.h"
+#include "../sparse_memory.h"
+#include "../riscv_disasm.h"
 
 struct InstructionValidation {
     std::string instruction_name;
@@ -24,10 +31,42 @@ struct SimpleTestProgram {
 
 struct SimpleTestResult {
     std::string name;
-    bool passed;
+    bool passed = false;
     std::string message;
     int commands_passed = 0;
     int commands_total = 0;
+    uint64_t sim_cycles = 0;   // simulated clock cycles
+    double wall_ms = 0.0;      // wall-clock time of the simulation
+    std::string log;           // output of the test (when run in a child process)
+
+    // Single-line, tab-separated record, sent back by the child processes
+    // of run_tests_forked()
+    std::string serialize() const {
+        std::string msg = message;
+        for (char& c : msg) {
+            if (c == '\t' || c == '\n') c = ' ';
+        }
+        std::ostringstream out;
+        out << name << '\t' << passed << '\t' << commands_passed << '\t'
+            << commands_total << '\t' << sim_cycles << '\t' << wall_ms << '\t' << msg;
+        return out.str();
+    }
+
+    static SimpleTestResult deserialize(const std::string& record) {
+        SimpleTestResult result;
+        std::istringstream in(record);
+        std::string field;
+        if (!std::getline(in, result.name, '\t')) {
+            return result;
+        }
+        std::getline(in, field, '\t'); result.passed = (field == "1");
+        std::getline(in, field, '\t'); result.commands_passed = atoi(field.c_str());
+        std::getline(in, field, '\t'); result.commands_total = atoi(field.c_str());
+        std::getline(in, field, '\t'); result.sim_cycles = strtoull(field.c_str(), nullptr, 10);
+        std::getline(in, field, '\t'); result.wall_ms = atof(field.c_str());
+        std::getline(in, result.message);
+        return result;
+    }
 };
 
 class SimpleTestHarness : public sc_module {
@@ -43,13 +82,23 @@ public:
     sc_signal<sc_uint<32>> mem_wdata;
 
     FemtoRV32_Quark* cpu;
-    std::vector<uint32_t>* memory;
+    SparseMemory* memory;
     uint32_t reset_cnt;
+    bool stepped;               // cpu driven by step(), see -step
+    uint64_t stepped_cycles = 0;
 
-    SimpleTestHarness(sc_module_name name) : sc_module(name), clk("clk", 10, SC_NS) {
+    SimpleTestHarness(sc_module_name name, bool step_api = false) :
+        sc_module(name), clk("clk", 10, SC_NS) {
         cpu = new FemtoRV32_Quark("cpu");
-        memory = new std::vector<uint32_t>(1024, 0);
+        memory = new SparseMemory();
         reset_cnt = 0;
+        stepped = step_api;
+
+        if (stepped) {
+            // No signal, no process: the memory is called by cpu->step()
+            cpu->set_memory([this](FemtoRV32_Pins& pins) { memory_step(pins); });
+            return;
+        }
 
         // Connect CPU to test harness
         cpu->clk(clk);
@@ -72,63 +121,64 @@ public:
     void memory_process() {
         if (mem_rstrb.read()) {
             uint32_t addr = mem_addr.read().to_uint();
-            uint32_t word_addr = addr >> 2;
-            if (word_addr < memory->size()) {
-                uint32_t data = (*memory)[word_addr];
-                mem_rdata.write(data);
-                mem_rbusy.write(false);
-            mem_wbusy.write(false);
-                #ifdef DEBUG
-                std::cout << "  📖 Memory read: addr=0x" << std::hex << addr << std::dec 
-                          << " (word=" << word_addr << "), data=0x" << std::hex << data << std::dec << std::endl;
-                #endif
-            } else {
-                mem_rdata.write(0);
-                mem_rbusy.write(false);
-            mem_wbusy.write(false);
-            }
-        } else {
-            mem_rbusy.write(false);
-            mem_wbusy.write(false);
+            uint32_t data = memory->read_word(addr);
+            mem_rdata.write(data);
+            #ifdef DEBUG
+            std::cout << "  📖 Memory read: addr=0x" << std::hex << addr << std::dec 
+                      << " (word=" << (addr >> 2) << "), data=0x" << std::hex << data << std::dec << std::endl;
+            #endif
         }
+        mem_rbusy.write(false);
+        mem_wbusy.write(false);
 
         if (mem_wmask.read().to_uint() != 0) {
-            uint32_t addr = mem_addr.read().to_uint();
-            uint32_t word_addr = addr >> 2;
-            if (word_addr < memory->size()) {
-                uint32_t data = mem_wdata.read().to_uint();
-                uint32_t mask = mem_wmask.read().to_uint();
-                
-                uint32_t old_data = (*memory)[word_addr];
-                uint32_t new_data = old_data;
-                
-                for (int i = 0; i < 4; i++) {
-                    if (mask & (1 << i)) {
-                        new_data = (new_data & ~(0xFF << (i * 8))) | ((data & (0xFF << (i * 8))));
-                    }
-                }
-                
-                (*memory)[word_addr] = new_data;
-            }
+            memory->write_word(
+                mem_addr.read().to_uint(), mem_wdata.read().to_uint(), mem_wmask.read().to_uint()
+            );
+        }
+    }
+
+    // memory_process() for the stepping API
+    void memory_step(FemtoRV32_Pins& pins) {
+        if (pins.mem_rstrb) {
+            pins.mem_rdata = memory->read_word(pins.mem_addr);
+        }
+        pins.mem_rbusy = false;
+        pins.mem_wbusy = false;
+
+        if (pins.mem_wmask != 0) {
+            memory->write_word(pins.mem_addr, pins.mem_wdata, pins.mem_wmask);
         }
     }
 
     void reset_counter_process() {
+        reset.write(reset_counter(reset.read()));
+    }
+
+    // Value of reset for the next rising edge
+    bool reset_counter(bool current) {
+        bool next = current;
         if (reset_cnt < 1000) {
             reset_cnt++;
-            reset.write(reset_cnt < 900);  // Keep reset high for 900 cycles to allow more instructions
+            next = reset_cnt < 900;  // Keep reset high for 900 cycles to allow more instructions
         }
         
         // Debug output to track reset signal
         if (reset_cnt % 1000 == 0 || reset_cnt < 910) {
-            std::cout << "  🔄 RESET: cycle=" << reset_cnt << ", reset=" << reset.read() << std::endl;
+            std::cout << "  🔄 RESET: cycle=" << reset_cnt << ", reset=" << current << std::endl;
         }
+        return next;
+    }
+
+    // One rising edge of clk, with the stepping API
+    void step_cycle() {
+        cpu->pins.reset = reset_counter(cpu->pins.reset);
+        cpu->step();
+        stepped_cycles++;
     }
 
     void load_program(const std::vector<uint32_t>& instructions) {
-        for (size_t i = 0; i < instructions.size(); i++) {
-            (*memory)[i] = instructions[i];
-        }
+        memory->load(instructions);
     }
 
     uint32_t get_register_value(uint32_t reg_num) const {
@@ -175,8 +225,15 @@ public:
         size_t instruction_index = 0;
         int passed_validations = 0;
         
-        for (uint32_t cycle = 0; cycle < test.max_cycles; cycle += 10) {
-            sc_start(1, SC_NS);
+        // The scheduler samples the state every ns (10 per clock
+        // cycle), the stepping API after each rising edge
+        uint32_t cycle_inc = stepped ? 100 : 10;
+        for (uint32_t cycle = 0; cycle < test.max_cycles; cycle += cycle_inc) {
+            if (stepped) {
+                step_cycle();
+            } else {
+                sc_start(1, SC_NS);
+            }
             
             uint32_t current_pc = cpu->PC.to_uint();
             int current_state = cpu->state;
@@ -378,6 +435,34 @@ SimpleTestProgram create_focused_validation_test() {
     return test;
 }
 
+SimpleTestProgram create_shift_validation_test() {
+    SimpleTestProgram test;
+    test.name = "Shift Validation Test";
+    test.description = "Long shifts through the multi-cycle shifter (aluShamt)";
+    test.max_cycles = 8000;
+    test.validate_during_execution = true;
+
+    test.instructions = {
+        0x00100093,  // addi x1, x0, 1        -> x1 = 1
+        0x00509113,  // slli x2, x1, 5        -> x2 = 32
+        0x01F09193,  // slli x3, x1, 31       -> x3 = 0x80000000
+        0x4041D213,  // srai x4, x3, 4        -> x4 = 0xF8000000
+        0x0041D293,  // srli x5, x3, 4        -> x5 = 0x08000000
+        0x0000006F   // jal x0, 0             -> halt
+    };
+
+    test.validations = {
+        {"ADDI", 1, 1, "addi x1, x0, 1 -> x1 = 1"},
+        {"SLLI", 2, 32, "slli x2, x1, 5 -> x2 = 32"},
+        {"SLLI", 3, 0x80000000, "slli x3, x1, 31 -> x3 = 0x80000000"},
+        {"SRAI", 4, 0xF8000000, "srai x4, x3, 4 -> x4 = 0xF8000000"},
+        {"SRLI", 5, 0x08000000, "srli x5, x3, 4 -> x5 = 0x08000000"},
+        {"JAL", 0, 0, "jal x0, 0 -> jump to PC+0 (infinite loop)"}
+    };
+
+    return test;
+}
+
 bool validate_instruction(const SimpleTestHarness& harness, const InstructionValidation& validation) {
     uint32_t actual_value = harness.get_register_value(validation.register_id);
     bool passed = (actual_value == validation.expected_value);
@@ -392,7 +477,7 @@ bool validate_instruction(const SimpleTestHarness& harness, const InstructionVal
     return passed;
 }
 
-SimpleTestResult run_test(const SimpleTestProgram& test) {
+SimpleTestResult run_test(const SimpleTestProgram& test, bool stepped) {
     SimpleTestResult result;
     result.name = test.name;
     result.passed = false;
@@ -401,12 +486,15 @@ SimpleTestResult run_test(const SimpleTestProgram& test) {
     std::cout << "📝 Description: " << test.description << std::endl;
     
     // Create test harness
-    SimpleTestHarness harness("harness");
+    SimpleTestHarness harness("harness", stepped);
     
     // Load program
     std::cout << "📝 Loading program into memory:" << std::endl;
+    char text[RISCV_DISASM_MAX];
     for (size_t i = 0; i < test.instructions.size(); i++) {
-        std::cout << "  Address 0x" << std::hex << (i * 4) << ": 0x" << test.instructions[i] << std::dec << std::endl;
+        riscv_disasm(text, test.instructions[i], uint32_t(i * 4));
+        std::cout << "  Address 0x" << std::hex << (i * 4) << ": 0x" << std::setw(8) << std::setfill('0')
+                  << test.instructions[i] << std::setfill(' ') << std::dec << "  " << text << std::endl;
     }
     harness.load_program(test.instructions);
     
@@ -418,13 +506,40 @@ SimpleTestResult run_test(const SimpleTestProgram& test) {
     std::cout << "🔄 Starting simulation with real-time validation for " << test.max_cycles << " cycles..." << std::endl;
     
     if (test.validate_during_execution) {
+        auto wall_start = std::chrono::steady_clock::now();
         result = harness.run_simulation_with_validation(test);
+        double wall_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - wall_start
+        ).count();
+        result.wall_ms = wall_ms;
+        result.sim_cycles = stepped ? harness.stepped_cycles :
+                            sc_time_stamp().value() / harness.clk.period().value();
         std::cout << "✅ Simulation completed" << std::endl;
+        std::cout << "⏱  Wall time: " << std::fixed << std::setprecision(2) << wall_ms
+                  << " ms" << std::defaultfloat << std::endl;
+#ifdef NRV_TRACE
+        std::string trace_file = test.name + ".trace";
+        for (char& c : trace_file) {
+            if (c == ' ') c = '_';
+        }
+        if (harness.cpu->trace.dump(trace_file.c_str())) {
+            std::cout << "📝 Trace (" << harness.cpu->trace.size() << " instructions): "
+                      << trace_file << " (see trace_dump)" << std::endl;
+        }
+#endif
     }
     
     // Print final state
     std::cout << "🏁 Final CPU State (after " << test.max_cycles << " cycles):" << std::endl;
     harness.print_cpu_state();
+
+#if defined(NRV_NATIVE_MODEL) && defined(NRV_DECODE_CACHE)
+    std::cout << "📈 Decode cache: " << harness.cpu->decode_cache_hits << " hits, "
+              << harness.cpu->decode_cache_misses << " misses ("
+              << std::fixed << std::setprecision(1)
+              << 100.0 * harness.cpu->decode_cache_hit_rate() << "% hit rate)"
+              << std::defaultfloat << std::endl;
+#endif
     
     // The real-time validation results are the authoritative results
     // No need for additional final validation since we already validated each instruction
@@ -432,23 +547,49 @@ SimpleTestResult run_test(const SimpleTestProgram& test) {
     return result;
 }
 
-int sc_main(int /* argc */, char* /* argv */[]) {
+// Usage: focused_test [-j N] [-step]
+//  Each test program runs in its own process (the SystemC kernel cannot
+//  be elaborated again once started), at most N at a time (default: the
+//  number of cores).
+//  -step drives the processor with its cycle-stepping API (cpu->step(),
+//  direct calls to a memory callback) instead of sc_start().
+int sc_main(int argc, char* argv[]) {
     std::cout << "FemtoRV32 Quark SystemC Focused Validation Test Suite" << std::endl;
     std::cout << "====================================================" << std::endl;
+
+    int jobs = int(std::thread::hardware_concurrency());
+    bool stepped = false;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-step")) {
+            stepped = true;
+        } else if (!strcmp(argv[i], "-j") && i + 1 < argc) {
+            jobs = atoi(argv[++i]);
+        } else if (!strncmp(argv[i], "-j", 2) && argv[i][2] != '\0') {
+            jobs = atoi(argv[i] + 2);
+        }
+    }
     
     // Create focused test program - only failing instructions
     std::vector<SimpleTestProgram> tests = {
-        create_focused_validation_test()
+        create_focused_validation_test(),
+        create_shift_validation_test()
     };
     
-    // Run all tests
-    std::vector<SimpleTestResult> results;
+    // Run all tests, one process per test
+    auto wall_start = std::chrono::steady_clock::now();
+    std::vector<SimpleTestResult> results =
+        run_tests_forked<SimpleTestProgram, SimpleTestResult>(
+            tests, jobs, [stepped](const SimpleTestProgram& test) { return run_test(test, stepped); }
+        );
+    double wall_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - wall_start
+    ).count();
+
     int passed = 0;
     int failed = 0;
     
-    for (const auto& test : tests) {
-        SimpleTestResult result = run_test(test);
-        results.push_back(result);
+    for (const auto& result : results) {
+        std::cout << result.log;
         
         if (result.passed) {
             passed++;
@@ -458,6 +599,24 @@ int sc_main(int /* argc */, char* /* argv */[]) {
         
         std::cout << std::endl;
     }
+
+    // Merged report
+    std::cout << "=== Test Report ===" << std::endl;
+    for (const auto& result : results) {
+        std::cout << (result.passed ? "✅ PASS " : "❌ FAIL ") << std::left << std::setw(28) << result.name
+                  << std::right << " commands " << std::setw(3) << result.commands_passed << "/" 
+                  << std::setw(3) << result.commands_total
+                  << "  sim cycles " << std::setw(8) << result.sim_cycles
+                  << "  wall " << std::fixed << std::setprecision(2) << std::setw(8) << result.wall_ms
+                  << " ms" << std::defaultfloat;
+        if (!result.passed) {
+            std::cout << "  (" << result.message << ")";
+        }
+        std::cout << std::endl;
+    }
+    std::cout << "Jobs: " << jobs << (stepped ? ", step API" : ", sc_start")
+              << ", total wall time: " << std::fixed << std::setprecision(2)
+              << wall_ms << " ms" << std::defaultfloat << std::endl << std::endl;
     
     // Print summary
     std::cout << "=== Test Suite Summary ===" << std::endl;
@@ -0,0 +1,317 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include "../femtorv32_iss.h"
+#include "../harness_memory.h"
+
+// Firmware test matrix: runs a list of ELFs on the host ISS
+// (libfemtorv32_iss.a), one ISS per job in a pool of threads, with the
+// UART captured, and compares the UART output, the LEDs and the OLED
+// frame buffer with the expected ones.
+//
+// Usage: iss_matrix [-j threads] [-w dir] manifest...
+//  -j threads: number of threads (default: number of cores)
+//  -w dir:     writes the UART output of each test to dir/<elf name>.uart
+//              (to create the expected outputs)
+//
+// Manifest: one test per line, '#' starts a comment, the paths are
+// relative to the directory of the manifest:
+//   file.elf [key=value]...
+//  uart=file    expected UART output (exact)
+//  input=file   characters typed on the UART
+//  leds=N       expected value of the LEDs at the end
+//  oled=HASH    expected FemtoRV32_ISS::oled_hash() (hexadecimal)
+//  stop=text    stops when the UART output ends with text (\n for a newline)
+//  max=N        maximum number of instructions (default 10000000000)
+//  timeout=S    maximum wall time in seconds (default 60)
+//  ram=N        size of the RAM in bytes (default 4 MB)
+// A test passes if the firmware halts, stops on the stop text or reaches
+// max instructions, and has the expected outputs.
+//
+// Example (a failed check prints the actual LEDs or OLED hash):
+//   EXAMPLES/hello.elf uart=EXAMPLES/hello.uart
+//   EXAMPLES/mandelbrot_OLED.elf oled=3a94c1f0d2b8e657 max=50000000
+//   EXAMPLES/blinker.elf leds=15 max=1000000
+//   EXAMPLES/shell.elf input=shell.keys stop=\n$\s
+
+struct MatrixTest {
+    std::string name;           // as written in the manifest
+    std::string elf;
+    std::string uart_file, input_file;
+    std::string stop_text;
+    bool check_leds = false;
+    uint32_t leds = 0;
+    bool check_oled = false;
+    uint64_t oled = 0;
+    uint64_t max_instructions = 10000000000ull;
+    double timeout_s = 60.0;
+    size_t ram_bytes = 4u * 1024 * 1024;
+};
+
+struct MatrixResult {
+    bool passed = false;
+    std::string message;
+    std::string uart;
+    uint64_t instret = 0;
+    double wall_s = 0.0;
+};
+
+// Captures the UART, types the input, and stops on the stop text
+class CaptureIO : public ISSHostIO {
+public:
+    CaptureIO(FemtoRV32_ISS& iss, const std::string& input, const std::string& stop_text) :
+        iss_(iss), input_(input), stop_text_(stop_text) {}
+
+    void uart_output(uint8_t c) override {
+        output += char(c);
+        if (!stop_text_.empty() && output.size() >= stop_text_.size() &&
+            output.compare(output.size() - stop_text_.size(), stop_text_.size(), stop_text_) == 0) {
+            stopped = true;
+            iss_.request_stop();
+        }
+    }
+
+    int uart_input() override {
+        return (pos_ < input_.size()) ? uint8_t(input_[pos_++]) : -1;
+    }
+
+    std::string output;
+    bool stopped = false;
+
+private:
+    FemtoRV32_ISS& iss_;
+    std::string input_;
+    size_t pos_ = 0;
+    std::string stop_text_;
+};
+
+static bool read_file(const std::string& filename, std::string& contents) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::ostringstream out;
+    out << in.rdbuf();
+    contents = out.str();
+    return true;
+}
+
+static std::string unescape(const std::string& text) {
+    std::string result;
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '\\' && i + 1 < text.size()) {
+            char c = text[++i];
+            result += (c == 'n') ? '\n' : (c == 'r') ? '\r' : (c == 't') ? '\t' :
+                      (c == 's') ? ' ' : c;
+        } else {
+            result += text[i];
+        }
+    }
+    return result;
+}
+
+// Reads the tests of a manifest. Returns false and sets 'error' on failure.
+static bool read_manifest(const char* filename, std::vector<MatrixTest>& tests, std::string& error) {
+    std::ifstream in(filename);
+    if (!in) {
+        error = std::string("cannot open ") + filename;
+        return false;
+    }
+    std::string dir(filename);
+    size_t slash = dir.rfind('/');
+    dir = (slash == std::string::npos) ? "" : dir.substr(0, slash + 1);
+    std::string line;
+    for (int line_number = 1; std::getline(in, line); line_number++) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        MatrixTest test;
+        if (!(words >> test.name)) {
+            continue;
+        }
+        test.elf = dir + test.name;
+        std::string word;
+        while (words >> word) {
+            size_t equal = word.find('=');
+            std::string key = word.substr(0, equal);
+            std::string value = (equal == std::string::npos) ? "" : word.substr(equal + 1);
+            char* end = nullptr;
+            bool ok = true;
+            if (equal == std::string::npos || value.empty()) {
+                ok = false;
+            } else if (key == "uart") {
+                test.uart_file = dir + value;
+            } else if (key == "input") {
+                test.input_file = dir + value;
+            } else if (key == "stop") {
+                test.stop_text = unescape(value);
+            } else if (key == "leds") {
+                test.check_leds = true;
+                test.leds = uint32_t(strtoul(value.c_str(), &end, 0));
+            } else if (key == "oled") {
+                test.check_oled = true;
+                test.oled = strtoull(value.c_str(), &end, 16);
+            } else if (key == "max") {
+                test.max_instructions = strtoull(value.c_str(), &end, 0);
+            } else if (key == "timeout") {
+                test.timeout_s = strtod(value.c_str(), &end);
+            } else if (key == "ram") {
+                test.ram_bytes = size_t(strtoull(value.c_str(), &end, 0));
+            } else {
+                ok = false;
+            }
+            if (!ok || (end != nullptr && *end != '\0')) {
+                error = std::string(filename) + ":" + std::to_string(line_number) +
+                        ": invalid option " + word;
+                return false;
+            }
+        }
+        tests.push_back(test);
+    }
+    return true;
+}
+
+// Slice of instructions between two checks of the timeout
+static const uint64_t TIMEOUT_SLICE = 1u << 22;
+
+static MatrixResult run_test(const MatrixTest& test) {
+    MatrixResult result;
+    std::string input, expected_uart, error;
+    if (!test.input_file.empty() && !read_file(test.input_file, input)) {
+        result.message = "cannot read " + test.input_file;
+        return result;
+    }
+    if (!test.uart_file.empty() && !read_file(test.uart_file, expected_uart)) {
+        result.message = "cannot read " + test.uart_file;
+        return result;
+    }
+    HarnessMemory memory(test.ram_bytes);
+    if (!memory.load_elf(test.elf.c_str(), error)) {
+        result.message = error;
+        return result;
+    }
+
+    FemtoRV32_ISS iss(memory);
+    CaptureIO io(iss, input, test.stop_text);
+    iss.host_io = &io;
+    auto wall_start = std::chrono::steady_clock::now();
+    FemtoRV32_ISS::StopReason stop = FemtoRV32_ISS::RUNNING;
+    bool timed_out = false;
+    while (stop == FemtoRV32_ISS::RUNNING && iss.instret < test.max_instructions) {
+        stop = iss.run(std::min(TIMEOUT_SLICE, test.max_instructions - iss.instret));
+        result.wall_s = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - wall_start
+        ).count();
+        if (stop == FemtoRV32_ISS::RUNNING && result.wall_s > test.timeout_s) {
+            timed_out = true;
+            break;
+        }
+    }
+    result.uart = io.output;
+    result.instret = iss.instret;
+
+    std::ostringstream message;
+    if (timed_out) {
+        message << "timeout after " << test.timeout_s << " s";
+    } else if (stop != FemtoRV32_ISS::RUNNING && stop != FemtoRV32_ISS::HALTED &&
+               stop != FemtoRV32_ISS::EBREAK && stop != FemtoRV32_ISS::ECALL &&
+               !(stop == FemtoRV32_ISS::STOPPED && io.stopped)) {
+        message << FemtoRV32_ISS::stop_reason_name(stop) << " at PC=0x" << std::hex << iss.pc;
+    } else if (!test.uart_file.empty() && result.uart != expected_uart) {
+        size_t i = 0;
+        while (i < result.uart.size() && i < expected_uart.size() && result.uart[i] == expected_uart[i]) {
+            i++;
+        }
+        message << "UART output differs at byte " << i << " (" << result.uart.size() << " bytes, "
+                << expected_uart.size() << " expected)";
+    } else if (test.check_leds && iss.leds != test.leds) {
+        message << "LEDs 0x" << std::hex << iss.leds << ", 0x" << test.leds << " expected";
+    } else if (test.check_oled && iss.oled_hash() != test.oled) {
+        message << "OLED hash " << std::hex << std::setw(16) << std::setfill('0') << iss.oled_hash()
+                << ", " << std::setw(16) << test.oled << " expected";
+    } else {
+        result.passed = true;
+        message << FemtoRV32_ISS::stop_reason_name(stop);
+    }
+    result.message = message.str();
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned nb_threads = std::thread::hardware_concurrency();
+    const char* output_dir = nullptr;
+    while (argc > 1 && argv[1][0] == '-') {
+        if (!strcmp(argv[1], "-j") && argc > 2) {
+            nb_threads = unsigned(strtoul(argv[2], nullptr, 0));
+        } else if (!strcmp(argv[1], "-w") && argc > 2) {
+            output_dir = argv[2];
+        } else {
+            break;
+        }
+        argv += 2;
+        argc -= 2;
+    }
+    if (argc < 2) {
+        std::cerr << "Usage: iss_matrix [-j threads] [-w dir] manifest..." << std::endl;
+        return 1;
+    }
+    if (nb_threads == 0) {
+        nb_threads = 1;
+    }
+
+    std::vector<MatrixTest> tests;
+    std::string error;
+    for (int i = 1; i < argc; i++) {
+        if (!read_manifest(argv[i], tests, error)) {
+            std::cerr << "❌ " << error << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<MatrixResult> results(tests.size());
+    std::atomic<size_t> next_test(0);
+    auto wall_start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < nb_threads && t < tests.size(); t++) {
+        threads.emplace_back([&]() {
+            for (size_t i = next_test++; i < tests.size(); i = next_test++) {
+                results[i] = run_test(tests[i]);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    double wall_s = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - wall_start
+    ).count();
+
+    size_t nb_failed = 0;
+    double cpu_s = 0.0;
+    for (size_t i = 0; i < tests.size(); i++) {
+        const MatrixResult& r = results[i];
+        std::cout << (r.passed ? "✅ " : "❌ ") << tests[i].name << ": " << r.message << ", "
+                  << r.instret << " instructions, " << std::fixed << std::setprecision(3)
+                  << r.wall_s << " s" << std::defaultfloat << std::endl;
+        nb_failed += r.passed ? 0 : 1;
+        cpu_s += r.wall_s;
+        if (output_dir != nullptr) {
+            std::string name = tests[i].name.substr(tests[i].name.rfind('/') + 1);
+            std::ofstream out(std::string(output_dir) + "/" + name + ".uart", std::ios::binary);
+            out << r.uart;
+        }
+    }
+    std::cout << std::endl << (nb_failed == 0 ? "✅ " : "❌ ") << tests.size() - nb_failed << "/"
+              << tests.size() << " tests passed, " << threads.size() << " threads, wall "
+              << std::fixed << std::setprecision(3) << wall_s << " s (" << cpu_s << " s of runs)"
+              << std::endl;
+    return nb_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,173 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "../femtorv32_iss.h"
+#include "../harness_memory.h"
+#include "../branch_trace.h"
+
+// Runs a statically linked firmware ELF (e.g. from FemtoRV/FIRMWARE,
+// linked with CRT/baremetal.ld) on the host instruction-set simulator
+// (femtorv32_iss.h), for fast functional runs (firmware test suites).
+//
+// Usage: iss_run [-i] [-l] [-o file.rgb565] [-b file.btrace] [-t file.txt] [-freq MHz] file.elf [max_instructions] [ram_bytes]
+//  -i:               switch interpreter only (no block translation)
+//  -l:               prints the LEDs on stderr when they change
+//  -b file.btrace:   writes the executed branches, JAL and JALR to a
+//                    control-flow trace (branch_trace.h), for branch_sim
+//  -t file.txt:      writes an annotated instruction trace, one line per
+//                    instruction (PC, instruction, disassembly, value of
+//                    the register written), switch interpreter only
+//  -o file.rgb565:   writes the OLED frame buffer at the end (raw RGB565,
+//                    128x128, top row first)
+//  -freq MHz:        frequency reported to the firmware (default 50)
+//  max_instructions: simulation stops after max_instructions (default
+//                    10000000000), or when the firmware reaches a
+//                    'jal x0, 0' loop, ebreak or ecall.
+//  ram_bytes:        size of the RAM (default 4 MB, the IO page starts at 0x400000).
+//
+// The exit status is 0 if the firmware halted or reached max_instructions,
+// 2 on an invalid instruction or memory access.
+
+int main(int argc, char* argv[]) {
+    bool use_blocks = true;
+    bool print_leds = false;
+    const char* oled_file = nullptr;
+    const char* branch_file = nullptr;
+    const char* instr_trace_file = nullptr;
+    uint32_t freq_MHz = 50;
+    while (argc > 1 && argv[1][0] == '-') {
+        if (!strcmp(argv[1], "-i")) {
+            use_blocks = false;
+        } else if (!strcmp(argv[1], "-l")) {
+            print_leds = true;
+        } else if (!strcmp(argv[1], "-o") && argc > 2) {
+            oled_file = argv[2];
+            argv++;
+            argc--;
+        } else if (!strcmp(argv[1], "-b") && argc > 2) {
+            branch_file = argv[2];
+            argv++;
+            argc--;
+        } else if (!strcmp(argv[1], "-t") && argc > 2) {
+            instr_trace_file = argv[2];
+            argv++;
+            argc--;
+        } else if (!strcmp(argv[1], "-freq") && argc > 2) {
+            freq_MHz = uint32_t(strtoul(argv[2], nullptr, 0));
+            argv++;
+            argc--;
+        } else {
+            break;
+        }
+        argv++;
+        argc--;
+    }
+    if (argc < 2) {
+        std::cerr << "Usage: iss_run [-i] [-l] [-o file.rgb565] [-b file.btrace] [-t file.txt] [-freq MHz] file.elf [max_instructions] [ram_bytes]"
+                  << std::endl;
+        return 1;
+    }
+    const char* filename = argv[1];
+    uint64_t max_instructions = (argc > 2) ? strtoull(argv[2], nullptr, 0) : 10000000000ull;
+    size_t ram_bytes = (argc > 3) ? size_t(strtoull(argv[3], nullptr, 0)) : 4u * 1024 * 1024;
+
+    HarnessMemory memory(ram_bytes);
+    std::string error;
+    uint32_t text_address = 0;
+    uint32_t max_address = 0;
+    if (!memory.load_elf(filename, error, &text_address, &max_address)) {
+        std::cerr << "❌ " << error << std::endl;
+        return 1;
+    }
+    std::cerr << "📄 " << filename << ": text at 0x" << std::hex << text_address
+              << ", segments end at 0x" << max_address << std::dec << std::endl;
+    if (text_address != DEFAULT_RESET_ADDR) {
+        std::cerr << "⚠️  text segment is not at the reset address (0x" << std::hex
+                  << DEFAULT_RESET_ADDR << std::dec << ")" << std::endl;
+    }
+
+    FemtoRV32_ISS iss(memory);
+    iss.use_blocks = use_blocks;
+    iss.print_leds = print_leds;
+    iss.freq_MHz = freq_MHz;
+
+    BranchTraceWriter branch_trace;
+    if (branch_file != nullptr) {
+        if (!branch_trace.open(branch_file, error)) {
+            std::cerr << "❌ " << error << std::endl;
+            return 1;
+        }
+        iss.branch_trace = &branch_trace;
+    }
+
+    FILE* instr_trace = nullptr;
+    if (instr_trace_file != nullptr) {
+        instr_trace = fopen(instr_trace_file, "w");
+        if (instr_trace == nullptr) {
+            std::cerr << "❌ " << instr_trace_file << ": cannot be written" << std::endl;
+            return 1;
+        }
+        // Large stdio buffer: one fwrite() per instruction
+        setvbuf(instr_trace, nullptr, _IOFBF, 1 << 20);
+        iss.instr_trace = instr_trace;
+    }
+
+    auto wall_start = std::chrono::steady_clock::now();
+    FemtoRV32_ISS::StopReason stop = iss.run(max_instructions);
+    double wall_s = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - wall_start
+    ).count();
+    iss.flush_uart();
+
+    bool ok = (stop == FemtoRV32_ISS::RUNNING || stop == FemtoRV32_ISS::HALTED ||
+               stop == FemtoRV32_ISS::EBREAK || stop == FemtoRV32_ISS::ECALL);
+    std::cerr << std::endl
+              << (ok ? "✅ " : "❌ ") << FemtoRV32_ISS::stop_reason_name(stop)
+              << " at PC=0x" << std::hex << iss.pc;
+    if (stop == FemtoRV32_ISS::INVALID_INSTRUCTION) {
+        std::cerr << " (instr 0x" << std::setw(8) << std::setfill('0') << iss.fault_instr << ")";
+    } else if (stop == FemtoRV32_ISS::INVALID_ACCESS) {
+        std::cerr << " (address 0x" << iss.fault_addr << ")";
+    }
+    std::cerr << std::dec << ", " << iss.instret << " instructions"
+              << ", wall " << std::fixed << std::setprecision(3) << wall_s << " s, "
+              << std::setprecision(1) << (wall_s > 0.0 ? double(iss.instret) / wall_s / 1e6 : 0.0)
+              << " MIPS" << std::defaultfloat << std::endl;
+    if (use_blocks && instr_trace == nullptr) {
+        std::cerr << "   " << iss.nb_translated_blocks << " blocks translated, "
+                  << iss.nb_invalidations << " invalidations" << std::endl;
+    }
+    if (iss.fga_writes != 0) {
+        std::cerr << "   " << iss.fga_writes << " FGA writes (not displayed)" << std::endl;
+    }
+
+    if (branch_file != nullptr) {
+        uint64_t nb_branches = branch_trace.count();
+        if (!branch_trace.close(iss.instret)) {
+            std::cerr << "❌ could not write " << branch_file << std::endl;
+            return 1;
+        }
+        std::cerr << "🔀 " << nb_branches << " branches and jumps in " << branch_file << std::endl;
+    }
+
+    if (instr_trace != nullptr) {
+        if (fclose(instr_trace) != 0) {
+            std::cerr << "❌ could not write " << instr_trace_file << std::endl;
+            return 1;
+        }
+        std::cerr << "📝 " << iss.instret << " instructions traced in " << instr_trace_file << std::endl;
+    }
+
+    if (oled_file != nullptr) {
+        if (!iss.write_oled(oled_file)) {
+            std::cerr << "❌ could not write " << oled_file << std::endl;
+            return 1;
+        }
+        std::cerr << "🖼  OLED frame buffer in " << oled_file << std::endl;
+    }
+    return ok ? 0 : 2;
+}
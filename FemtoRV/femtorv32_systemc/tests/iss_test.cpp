@@ -0,0 +1,414 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <iomanip>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "../femtorv32_iss.h"
+#include "../harness_memory.h"
+#include "../memory_latency.h"
+
+// Test of the host instruction-set simulator: runs small programs with
+// both execution engines (switch interpreter, block translation) and
+// checks the final register values, the memory timing (instruction and
+// data caches), the host IO callbacks and the instruction trace, then
+// measures the simulation speed of both engines on a loop.
+//
+// Usage: iss_test [loop_iterations]
+//  loop_iterations: iterations of the speed test (default 20000000)
+
+struct ISSTestProgram {
+    std::string name;
+    std::vector<uint32_t> instructions;
+    std::vector<std::pair<uint32_t, uint32_t> > expected; // (register, value)
+};
+
+std::vector<ISSTestProgram> create_iss_tests() {
+    std::vector<ISSTestProgram> tests;
+
+    // Same programs as in lt_test.cpp
+    tests.push_back({
+        "Focused program",
+        {
+            0x00500093, 0x00300113, 0x00A00193, 0x00F00213, // addi x1..x4
+            0x00708093, 0xFFF10113, 0x00118193,             // addi
+            0x00C0F213, 0x00C0E213, 0x00C0C213,             // andi, ori, xori
+            0x00109193, 0x0010D193, 0x002091B3, 0x0020D1B3, 0x4020D1B3, // shifts
+            0x002081B3, 0x402081B3, 0x0020A1B3, 0x0020B1B3,  // add, sub, slt, sltu
+            0x0020C1B3, 0x0020E1B3, 0x0020F1B3,              // xor, or, and
+            0x0020A193, 0x00D0A193, 0x0020B193, 0x00D0B193,  // slti, sltiu
+            0x002081B3, 0x402081B3, 0x002081B3, 0x402081B3,  // add, sub
+            0x0020C1B3, 0x0020E1B3, 0x0020F1B3,              // xor, or, and
+            0x0000A023, 0x0000A103, 0x0040A223, 0x0040A183,  // sw, lw
+            0x00001117, 0x00002197,                          // auipc
+            0x0000006F                                       // jal x0, 0 (halt)
+        },
+        { {1, 12}, {2, 0x1094}, {3, 0x2098}, {4, 0} }
+    });
+
+    tests.push_back({
+        "Conditional branches",
+        {
+            0x00500093, 0x00300113, 0x00500193, 0x00800213,
+            0x00308463, 0x00100113, 0x00200113,  // beq
+            0x00209463, 0x00300113, 0x00400113,  // bne
+            0x00114463, 0x00500113, 0x00600113,  // blt
+            0x00125463, 0x00700113, 0x00800113,  // bge
+            0x00116463, 0x00900113, 0x00A00113,  // bltu
+            0x00117463, 0x00B00113, 0x00C00113,  // bgeu
+            0x0000006F
+        },
+        { {2, 12} }
+    });
+
+    tests.push_back({
+        "Loop and sub-word memory accesses",
+        {
+            0x00A00293,  // addi x5, x0, 10
+            0x00000313,  // addi x6, x0, 0
+            0x00530333,  // loop: add x6, x6, x5
+            0xFFF28293,  // addi x5, x5, -1
+            0xFE029CE3,  // bne x5, x0, loop
+            0x40000393,  // addi x7, x0, 1024
+            0xF8000413,  // addi x8, x0, -128
+            0x00838123,  // sb x8, 2(x7)
+            0x00238483,  // lb x9, 2(x7)
+            0x0023C503,  // lbu x10, 2(x7)
+            0x00839223,  // sh x8, 4(x7)
+            0x00439583,  // lh x11, 4(x7)
+            0x0043D603,  // lhu x12, 4(x7)
+            0x008006EF,  // jal x13, 8
+            0x00100713,  // addi x14, x0, 1 (skipped)
+            0x0000006F   // halt
+        },
+        { {5, 0}, {6, 55}, {9, 0xFFFFFF80}, {10, 0x80}, {11, 0xFFFFFF80}, {12, 0xFF80},
+          {13, 0x38}, {14, 0} }
+    });
+
+    tests.push_back({
+        "M extension",
+        {
+            0xFF900093,  // addi x1, x0, -7
+            0x00300113,  // addi x2, x0, 3
+            0x022081B3,  // mul x3, x1, x2
+            0x02209233,  // mulh x4, x1, x2
+            0x0220A5B3,  // mulhsu x11, x1, x2
+            0x0220B2B3,  // mulhu x5, x1, x2
+            0x0220C333,  // div x6, x1, x2
+            0x0220E3B3,  // rem x7, x1, x2
+            0x0220D433,  // divu x8, x1, x2
+            0x0200C4B3,  // div x9, x1, x0
+            0x0200F533,  // remu x10, x1, x0
+            0x0000006F   // halt
+        },
+        { {3, 0xFFFFFFEB}, {4, 0xFFFFFFFF}, {11, 0xFFFFFFFF}, {5, 2}, {6, 0xFFFFFFFE},
+          {7, 0xFFFFFFFF}, {8, 0x55555553}, {9, 0xFFFFFFFF}, {10, 0xFFFFFFF9} }
+    });
+
+    tests.push_back({
+        "F extension",
+        {
+            0x00300093,  // addi x1, x0, 3
+            0xD00080D3,  // fcvt.s.w f1, x1
+            0x00400113,  // addi x2, x0, 4
+            0xD0010153,  // fcvt.s.w f2, x2
+            0x002081D3,  // fadd.s f3, f1, f2
+            0x10208253,  // fmul.s f4, f1, f2
+            0x182202D3,  // fdiv.s f5, f4, f2
+            0x102103D3,  // fmul.s f7, f2, f2
+            0x58038353,  // fsqrt.s f6, f7
+            0x20109453,  // fsgnjn.s f8, f1, f1
+            0x208084D3,  // fsgnj.s f9, f1, f8
+            0xC00411D3,  // fcvt.w.s x3, f8
+            0xE0018253,  // fmv.x.w x4, f3
+            0xA01412D3,  // flt.s x5, f8, f1
+            0xE0041353,  // fclass.s x6, f8
+            0xE00483D3,  // fmv.x.w x7, f9
+            0x18208543,  // fmadd.s f10, f1, f2, f3
+            0x10A02027,  // fsw f10, 0x100(x0)
+            0x10002587,  // flw f11, 0x100(x0)
+            0xE0058453,  // fmv.x.w x8, f11
+            0xA062A4D3,  // feq.s x9, f5, f6
+            0xE0028553,  // fmv.x.w x10, f5
+            0xE0030653,  // fmv.x.w x12, f6
+            0x0000006F   // halt
+        },
+        { {3, 0xFFFFFFFD}, {4, 0x40E00000}, {5, 1}, {6, 2}, {7, 0xC0400000},
+          {8, 0x41980000}, {9, 0}, {10, 0x40400000}, {12, 0x40800000} }
+    });
+
+    tests.push_back({
+        "Counters and CSRs",
+        {
+            0x00100093,  // addi x1, x0, 1
+            0xC0202173,  // csrrs x2, instret, x0
+            0x05500193,  // addi x3, x0, 0x55
+            0x34019073,  // csrrw x0, mscratch, x3
+            0x34002273,  // csrrs x4, mscratch, x0
+            0x340162F3,  // csrrsi x5, mscratch, 2
+            0x3400F073,  // csrrci x0, mscratch, 1
+            0x34002373,  // csrrs x6, mscratch, x0
+            0xC00023F3,  // csrrs x7, cycle, x0
+            0xC8002473,  // csrrs x8, cycleh, x0
+            0x0000006F   // halt
+        },
+        { {2, 1}, {4, 0x55}, {5, 0x55}, {6, 0x56}, {7, 8}, {8, 0} }
+    });
+
+    tests.push_back({
+        "IO page",
+        {
+            0x004000B7,  // lui x1, 0x400 (IO page)
+            0x00500113,  // addi x2, x0, 5
+            0x0020A223,  // sw x2, IO_LEDS(x1)
+            0x0040A183,  // lw x3, IO_LEDS(x1)
+            0x004802B7,  // lui x5, 0x480 (IO_HW_CONFIG_RAM)
+            0x0002A203,  // lw x4, 0(x5)
+            0x0100A303,  // lw x6, IO_UART_DAT(x1) (no data)
+            0x0000006F   // halt
+        },
+        { {3, 5}, {4, 4096}, {6, 0} }
+    });
+
+    // Two compressed instructions per word, little-endian
+    tests.push_back({
+        "C extension",
+        {
+            0x147D4415,  // c.li x8, 5;  c.addi x8, -1
+            0x94A284A2,  // c.mv x9, x8;  c.add x9, x8
+            0x8085048A,  // c.slli x9, 2;  c.srli x9, 1
+            0x8C0588E1,  // c.andi x9, 0x18;  c.sub x8, x9
+            0x65058405,  // c.srai x8, 1;  c.lui x10, 1
+            0x080C6121,  // c.addi16sp 64;  c.addi4spn x11, 16
+            0x41D0C1C4,  // c.sw x9, 4(x11);  c.lw x12, 4(x11)
+            0x46A2C422,  // c.swsp x8, 8;  c.lwsp x13, 8
+            0xE211C211,  // c.beqz x12, +4 (not taken);  c.bnez x12, +4
+            0x20114705,  // c.li x14, 1 (skipped);  c.jal +4
+            0xA0114785,  // c.li x15, 1 (skipped);  c.j +4
+            0x08134789,  // c.li x15, 2 (skipped);  addi x16, x0, 9 (unaligned)...
+            0xA0010090   // ...addi;  c.j 0 (halt)
+        },
+        { {8, 0xFFFFFFFA}, {9, 16}, {10, 0x1000}, {2, 64}, {11, 80}, {12, 16},
+          {13, 0xFFFFFFFA}, {14, 0}, {1, 40}, {15, 0}, {16, 9} }
+    });
+
+    // The first iteration patches the loop body (already translated)
+    tests.push_back({
+        "Self-modifying code",
+        {
+            0x00200113,  // addi x2, x0, 2
+            0x064281B7,  // lui x3, 0x06428
+            0x29318193,  // addi x3, x3, 0x293 (x3 = addi x5, x5, 100)
+            0x00128293,  // loop: addi x5, x5, 1 (patched)
+            0x00302623,  // sw x3, 12(x0)
+            0xFFF10113,  // addi x2, x2, -1
+            0xFE011AE3,  // bne x2, x0, loop
+            0x0000006F   // halt
+        },
+        { {5, 101} }
+    });
+
+    return tests;
+}
+
+// Runs a program until it halts, with the switch interpreter or with
+// the block translation engine
+static bool run_test(const ISSTestProgram& test, bool use_blocks) {
+    HarnessMemory memory(4096);
+    memory.load(test.instructions);
+    FemtoRV32_ISS iss(memory);
+    iss.use_blocks = use_blocks;
+    const char* engine = use_blocks ? "blocks" : "interpreter";
+    FemtoRV32_ISS::StopReason stop = iss.run(10000);
+    bool passed = (stop == FemtoRV32_ISS::HALTED);
+    if (!passed) {
+        std::cout << "  ❌ [" << engine << "] " << FemtoRV32_ISS::stop_reason_name(stop)
+                  << " at PC=0x" << std::hex << iss.pc << std::dec << std::endl;
+    }
+    for (const auto& e : test.expected) {
+        uint32_t actual = iss.x[e.first];
+        if (actual != e.second) {
+            std::cout << "  ❌ [" << engine << "] x" << e.first << ": expected 0x" << std::hex
+                      << e.second << ", got 0x" << actual << std::dec << std::endl;
+            passed = false;
+        }
+    }
+    std::cout << "  " << (passed ? "✅" : "❌") << " [" << engine << "] instret=" << iss.instret;
+    if (use_blocks) {
+        std::cout << " blocks=" << iss.nb_translated_blocks << " invalidations=" << iss.nb_invalidations;
+    }
+    std::cout << std::endl;
+    return passed;
+}
+
+// Captures the UART, and stops the ISS when the LEDs reach 100
+class TestHostIO : public ISSHostIO {
+public:
+    explicit TestHostIO(FemtoRV32_ISS& iss) : iss(iss) {}
+    void uart_output(uint8_t c) override { uart += char(c); }
+    void leds_output(uint32_t value) override {
+        if (value == 100) {
+            iss.request_stop();
+        }
+    }
+    FemtoRV32_ISS& iss;
+    std::string uart;
+};
+
+int main(int argc, char* argv[]) {
+    std::cout << "FemtoRV32 ISS Test Suite" << std::endl;
+    std::cout << "========================" << std::endl;
+
+    uint32_t loop_iterations = (argc > 1) ? uint32_t(strtoul(argv[1], nullptr, 0)) : 20000000;
+
+    int failed = 0;
+    for (const ISSTestProgram& test : create_iss_tests()) {
+        std::cout << "🔍 " << test.name << std::endl;
+        if (!run_test(test, false) || !run_test(test, true)) {
+            failed++;
+        }
+    }
+
+    // Memory timing: 2 instruction cache lines, the first load misses
+    // (stores do not allocate), 10 iterations
+    {
+        std::cout << "🔍 Memory timing" << std::endl;
+        HarnessMemory memory(4096);
+        memory.load({
+            0x00A00313,  // addi x6, x0, 10
+            0x40000393,  // addi x7, x0, 1024
+            0x0063A023,  // loop: sw x6, 0(x7)
+            0x0003A483,  // lw x9, 0(x7)
+            0xFFF30313,  // addi x6, x6, -1
+            0xFE031AE3,  // bne x6, x0, loop
+            0x0000006F   // halt
+        });
+        std::string error;
+        std::unique_ptr<MemoryLatency> icache = MemoryLatency::create("cache:64,1,16,5", error);
+        std::unique_ptr<MemoryLatency> dcache = MemoryLatency::create("cache:64,1,16,10", error);
+        FemtoRV32_ISS iss(memory);
+        iss.icache = icache.get();
+        iss.dcache = dcache.get();
+        FemtoRV32_ISS::StopReason stop = iss.run(10000);
+        bool passed = stop == FemtoRV32_ISS::HALTED && iss.instret == 42 &&
+                      iss.nb_translated_blocks == 0 && iss.memory_wait_cycles == 20 &&
+                      icache->misses() == 2 && dcache->misses() == 1 && dcache->hits() == 9 &&
+                      dcache->accesses[ACCESS_STORE] == 10;
+        std::cout << "  " << (passed ? "✅" : "❌") << " instret=" << iss.instret
+                  << " wait cycles=" << iss.memory_wait_cycles << " I-cache misses=" << icache->misses()
+                  << " D-cache hits=" << dcache->hits() << " misses=" << dcache->misses() << std::endl;
+        if (!passed) {
+            failed++;
+        }
+    }
+
+    // Host IO: "hi" on the UART, a pixel on the OLED, then counts on the
+    // LEDs until the host stops the ISS
+    std::cout << "🔍 Host IO" << std::endl;
+    for (bool use_blocks : { false, true }) {
+        HarnessMemory memory(4096);
+        memory.load({
+            0x00400537,  // lui x10, 0x400 (IO page)
+            0x06800593,  // addi x11, x0, 'h'
+            0x00B52423,  // sw x11, 8(x10) (UART_DAT)
+            0x06900593,  // addi x11, x0, 'i'
+            0x00B52423,  // sw x11, 8(x10)
+            0x10B52023,  // sw x11, 256(x10) (SSD1351_DAT16)
+            0x00160613,  // loop: addi x12, x12, 1
+            0x00C52223,  // sw x12, 4(x10) (LEDS)
+            0xFF9FF06F   // j loop
+        });
+        FemtoRV32_ISS iss(memory);
+        TestHostIO io(iss);
+        iss.host_io = &io;
+        iss.use_blocks = use_blocks;
+        uint64_t blank = iss.oled_hash();
+        FemtoRV32_ISS::StopReason stop = iss.run(10000);
+        bool passed = stop == FemtoRV32_ISS::STOPPED && io.uart == "hi" && iss.leds == 100 &&
+                      iss.oled_hash() != blank;
+        // The request is consumed: the next run goes on
+        passed = passed && iss.run(30) == FemtoRV32_ISS::RUNNING && iss.leds == 110;
+        std::cout << "  " << (passed ? "✅" : "❌") << " [" << (use_blocks ? "blocks" : "interpreter")
+                  << "] uart=\"" << io.uart << "\" leds=" << iss.leds << " instret=" << iss.instret
+                  << std::endl;
+        if (!passed) {
+            failed++;
+        }
+    }
+
+    // Instruction trace: one disassembled line per instruction, with the
+    // value of the register written
+    std::cout << "🔍 Instruction trace" << std::endl;
+    {
+        HarnessMemory memory(4096);
+        memory.load({
+            0x00500093,  // addi x1, x0, 5
+            0x00102623,  // sw x1, 12(x0)
+            0x0000006F   // jal x0, 0
+        });
+        FemtoRV32_ISS iss(memory);
+        FILE* trace = tmpfile();
+        iss.instr_trace = trace;
+        FemtoRV32_ISS::StopReason stop = iss.run(100);
+        std::string text;
+        rewind(trace);
+        for (int c = fgetc(trace); c != EOF; c = fgetc(trace)) {
+            text += char(c);
+        }
+        fclose(trace);
+        std::string expected =
+            "00000000  00500093  addi    x1,x0,5               x1 <- 0x00000005\n"
+            "00000004  00102623  sw      x1,12(x0)\n"
+            "00000008  0000006f  j       0x8\n";
+        bool passed = stop == FemtoRV32_ISS::HALTED && text == expected;
+        std::cout << "  " << (passed ? "✅" : "❌") << " " << iss.instret << " instructions traced"
+                  << std::endl;
+        if (!passed) {
+            std::cout << text;
+            failed++;
+        }
+    }
+
+    // Speed: ALU, load/store and branch mix (7 instructions per iteration)
+    std::vector<uint32_t> loop = {
+        0x00000337 | ((loop_iterations + 0x800) & 0xFFFFF000), // lui x6, %hi(n)
+        0x00030313 | ((loop_iterations & 0xFFF) << 20),       // addi x6, x6, %lo(n)
+        0x40000393,  // addi x7, x0, 1024
+        0x00128293,  // loop: addi x5, x5, 1
+        0x0053C433,  // xor x8, x7, x5
+        0x0083A023,  // sw x8, 0(x7)
+        0x0003A483,  // lw x9, 0(x7)
+        0x009282B3,  // add x5, x5, x9
+        0xFFF30313,  // addi x6, x6, -1
+        0xFE0314E3,  // bne x6, x0, loop
+        0x0000006F   // halt
+    };
+    for (bool use_blocks : { false, true }) {
+        HarnessMemory memory(4096);
+        memory.load(loop);
+        FemtoRV32_ISS iss(memory);
+        iss.use_blocks = use_blocks;
+        auto wall_start = std::chrono::steady_clock::now();
+        FemtoRV32_ISS::StopReason stop = iss.run(~0ull);
+        double wall_s = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - wall_start
+        ).count();
+        if (stop != FemtoRV32_ISS::HALTED || iss.instret != 3 + 7ull * loop_iterations) {
+            std::cout << "❌ speed loop: " << FemtoRV32_ISS::stop_reason_name(stop)
+                      << ", instret=" << iss.instret << std::endl;
+            failed++;
+        }
+        std::cout << "⏱  " << (use_blocks ? "blocks:      " : "interpreter: ") << iss.instret
+                  << " instructions in " << std::fixed << std::setprecision(3) << wall_s << " s: "
+                  << std::setprecision(1) << (wall_s > 0.0 ? double(iss.instret) / wall_s / 1e6 : 0.0)
+                  << " MIPS" << std::defaultfloat << std::endl;
+    }
+
+    if (failed > 0) {
+        std::cout << std::endl << "❌ Some tests failed." << std::endl;
+        return 1;
+    }
+    std::cout << std::endl << "✅ All tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../memory_latency.h"
+
+// Test of the memory latency models (memory_latency.h): wait cycles of
+// each model for known access sequences, parsing of the specifications,
+// and the busy handshake seen by a core that issues a request, then
+// waits while busy (like the WAIT_INSTR / WAIT_ALU_OR_MEM states of the
+// Quark).
+//
+// Usage: latency_test
+
+static int failures = 0;
+
+static void check(bool ok, const std::string& what) {
+    std::cout << (ok ? "  ✅ " : "  ❌ ") << what << std::endl;
+    if (!ok) {
+        failures++;
+    }
+}
+
+static std::unique_ptr<MemoryLatency> create(const std::string& spec) {
+    std::string error;
+    std::unique_ptr<MemoryLatency> result = MemoryLatency::create(spec, error);
+    if (!result) {
+        std::cout << "  " << error << std::endl;
+    }
+    return result;
+}
+
+// Cycles the core waits for one access: the request is issued in the
+// first cycle, the core tests busy from the next one.
+static uint32_t handshake(MemoryLatency& memory, MemoryAccessType type, uint32_t addr) {
+    uint32_t waited = 0;
+    bool busy = memory.clock(true, type, addr);
+    while (busy) {
+        waited++;
+        busy = memory.clock(false, type, addr);
+    }
+    return waited;
+}
+
+int main() {
+    std::cout << "FemtoRV32 Memory Latency Test" << std::endl;
+    std::cout << "=============================" << std::endl;
+
+    std::cout << "🔍 Fixed latency" << std::endl;
+    {
+        std::unique_ptr<MemoryLatency> m = create("fixed:3,1");
+        check(m != nullptr, "fixed:3,1 parsed");
+        if (m) {
+            check(handshake(*m, ACCESS_FETCH, 0) == 3, "fetch waits 3 cycles");
+            check(handshake(*m, ACCESS_LOAD, 0x100) == 3, "load waits 3 cycles");
+            check(handshake(*m, ACCESS_STORE, 0x100) == 1, "store waits 1 cycle");
+            check(!m->clock(false, ACCESS_FETCH, 0), "idle without request");
+            check(m->accesses[ACCESS_FETCH] == 1 && m->accesses[ACCESS_LOAD] == 1 &&
+                  m->accesses[ACCESS_STORE] == 1, "one access per type");
+            check(m->total_wait_cycles() == 7, "7 wait cycles");
+        }
+        std::unique_ptr<MemoryLatency> zero = create("fixed:0");
+        check(zero && handshake(*zero, ACCESS_LOAD, 0) == 0 && zero->accesses[ACCESS_LOAD] == 1,
+              "fixed:0 answers in the cycle");
+    }
+
+    std::cout << "🔍 SDRAM" << std::endl;
+    {
+        std::unique_ptr<MemoryLatency> m = create("sdram:4,8");
+        check(m != nullptr, "sdram:4,8 parsed (1024 bytes rows, 4 banks)");
+        if (m) {
+            SDRAMLatency& sdram = static_cast<SDRAMLatency&>(*m);
+            check(handshake(sdram, ACCESS_FETCH, 0x0000) == 8, "first access opens the row");
+            check(handshake(sdram, ACCESS_FETCH, 0x0004) == 4, "same row: hit");
+            check(handshake(sdram, ACCESS_LOAD, 0x03FC) == 4, "end of the row: hit");
+            check(handshake(sdram, ACCESS_LOAD, 0x0400) == 8, "next row, in bank 1: miss");
+            check(handshake(sdram, ACCESS_FETCH, 0x0008) == 4, "bank 0 row still open");
+            check(handshake(sdram, ACCESS_STORE, 0x1000) == 8, "other row of bank 0: miss");
+            check(handshake(sdram, ACCESS_FETCH, 0x000C) == 8, "bank 0 row closed");
+            check(sdram.row_hits == 3 && sdram.row_misses == 4, "3 hits, 4 misses");
+            sdram.clear();
+            check(sdram.total_wait_cycles() == 0 && handshake(sdram, ACCESS_FETCH, 0x000C) == 8,
+                  "clear() closes the rows");
+        }
+        check(create("sdram:4,8,1000") == nullptr, "row size must be a power of two");
+    }
+
+    std::cout << "🔍 SPI flash" << std::endl;
+    {
+        std::unique_ptr<MemoryLatency> m = create("flash:28,16");
+        check(m != nullptr, "flash:28,16 parsed (one word per transfer)");
+        if (m) {
+            check(handshake(*m, ACCESS_FETCH, 0x0000) == 44, "word read: 44 cycles");
+            check(handshake(*m, ACCESS_FETCH, 0x0004) == 44, "next word: 44 cycles");
+            check(handshake(*m, ACCESS_LOAD, 0x0004) == 0, "same word: line buffer hit");
+            check(handshake(*m, ACCESS_STORE, 0x0100) == 0, "stores are not timed");
+        }
+        m = create("flash:28,16,32,0x800000,0x400000");
+        check(m != nullptr, "flash with a 32 bytes line and a window parsed");
+        if (m) {
+            SPIFlashLatency& flash = static_cast<SPIFlashLatency&>(*m);
+            uint32_t waited = 0;
+            for (uint32_t addr = 0x820000; addr < 0x820040; addr += 4) {
+                waited += handshake(flash, ACCESS_FETCH, addr);
+            }
+            check(waited == 2 * (28 + 8 * 16), "16 words: 2 line fills");
+            check(flash.line_hits == 14 && flash.line_misses == 2, "14 hits, 2 misses");
+            check(handshake(flash, ACCESS_LOAD, 0x1000) == 0, "RAM outside the window");
+            check(flash.accesses[ACCESS_FETCH] == 16 && flash.accesses[ACCESS_LOAD] == 1,
+                  "accesses per type");
+        }
+        check(create("flash:28,16,6") == nullptr, "line size must be a power of two");
+    }
+
+    std::cout << "🔍 Cache" << std::endl;
+    {
+        // 2 sets of 2 ways, 16 bytes lines
+        std::unique_ptr<MemoryLatency> m = create("cache:64,2,16,10");
+        check(m != nullptr, "cache:64,2,16,10 parsed (2 sets of 2 ways)");
+        if (m) {
+            CacheLatency& cache = static_cast<CacheLatency&>(*m);
+            check(handshake(cache, ACCESS_FETCH, 0x0000) == 10, "cold miss");
+            check(handshake(cache, ACCESS_FETCH, 0x000C) == 0, "same line: hit");
+            check(handshake(cache, ACCESS_LOAD, 0x0020) == 10, "set 0, second way: miss");
+            check(handshake(cache, ACCESS_FETCH, 0x0000) == 0, "first line still cached");
+            check(handshake(cache, ACCESS_LOAD, 0x0040) == 10, "set 0, third line: miss");
+            check(handshake(cache, ACCESS_LOAD, 0x0024) == 10, "least recently used line evicted");
+            check(handshake(cache, ACCESS_FETCH, 0x0010) == 10, "set 1 is independent");
+            check(handshake(cache, ACCESS_STORE, 0x0080) == 0 && handshake(cache, ACCESS_LOAD, 0x0080) == 10,
+                  "writes do not allocate");
+            check(cache.read_hits == 2 && cache.read_misses == 6 && cache.hits() == 2,
+                  "2 hits, 6 misses");
+            cache.clear();
+            check(cache.total_wait_cycles() == 0 && handshake(cache, ACCESS_FETCH, 0x0000) == 10,
+                  "clear() invalidates the lines");
+        }
+        std::unique_ptr<MemoryLatency> direct = create("cache:32,1,16,5");
+        check(direct && handshake(*direct, ACCESS_FETCH, 0x00) == 5 &&
+              handshake(*direct, ACCESS_FETCH, 0x20) == 5 && handshake(*direct, ACCESS_FETCH, 0x00) == 5,
+              "direct mapped: conflict misses");
+        check(create("cache:64,4,32,10") == nullptr, "fewer than one set rejected");
+        check(create("cache:96,2,16,10") == nullptr, "size must be a power of two");
+    }
+
+    std::cout << "🔍 Specifications" << std::endl;
+    check(create("dram:1") == nullptr, "unknown model rejected");
+    check(create("fixed") == nullptr, "missing arguments rejected");
+    check(create("fixed:x") == nullptr, "invalid number rejected");
+    check(create("fixed:1,2,3") == nullptr, "too many arguments rejected");
+
+    if (failures != 0) {
+        std::cout << std::endl << "❌ Some tests failed." << std::endl;
+        return 1;
+    }
+    std::cout << std::endl << "✅ All tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,173 @@
+#include <systemc.h>
+#include <iostream>
+#include <vector>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include "../femtorv32_quark_lt.h"
+#include "../tlm_memory.h"
+
+// Test of the TLM-2.0 loosely-timed model: runs small programs and
+// checks the final register values.
+//
+// Usage: lt_test [quantum_ns]
+//  quantum_ns: maximum time the processors run ahead of SystemC time
+//  (default 1000 ns, 0 synchronizes after each instruction). The
+//  wall-clock time of the simulation is reported, so that running
+//  with different quanta shows what temporal decoupling saves
+//  (see 'make lt-quantum').
+
+struct LTTestProgram {
+    std::string name;
+    std::vector<uint32_t> instructions;
+    std::vector<std::pair<uint32_t, uint32_t> > expected; // (register, value)
+};
+
+class LTTestHarness : public sc_module {
+public:
+    FemtoRV32_Quark_LT* cpu;
+    TLM_Memory* memory;
+
+    LTTestHarness(sc_module_name name) : sc_module(name) {
+        cpu = new FemtoRV32_Quark_LT("cpu");
+        memory = new TLM_Memory("memory", 4096);
+        cpu->socket.bind(memory->socket);
+    }
+
+    ~LTTestHarness() {
+        delete cpu;
+        delete memory;
+    }
+};
+
+std::vector<LTTestProgram> create_lt_tests() {
+    std::vector<LTTestProgram> tests;
+
+    // Same program as in focused_test.cpp, without the final jalr
+    // (that jumps back into the program)
+    tests.push_back({
+        "Focused program",
+        {
+            0x00500093, 0x00300113, 0x00A00193, 0x00F00213, // addi x1..x4
+            0x00708093, 0xFFF10113, 0x00118193,             // addi
+            0x00C0F213, 0x00C0E213, 0x00C0C213,             // andi, ori, xori
+            0x00109193, 0x0010D193, 0x002091B3, 0x0020D1B3, 0x4020D1B3, // shifts
+            0x002081B3, 0x402081B3, 0x0020A1B3, 0x0020B1B3,  // add, sub, slt, sltu
+            0x0020C1B3, 0x0020E1B3, 0x0020F1B3,              // xor, or, and
+            0x0020A193, 0x00D0A193, 0x0020B193, 0x00D0B193,  // slti, sltiu
+            0x002081B3, 0x402081B3, 0x002081B3, 0x402081B3,  // add, sub
+            0x0020C1B3, 0x0020E1B3, 0x0020F1B3,              // xor, or, and
+            0x0000A023, 0x0000A103, 0x0040A223, 0x0040A183,  // sw, lw
+            0x00001117, 0x00002197,                          // auipc
+            0x0000006F                                       // jal x0, 0 (halt)
+        },
+        { {1, 12}, {2, 0x1094}, {3, 0x2098}, {4, 0} }
+    });
+
+    // Same program as in simple_branch_test.cpp, with the branch offsets
+    // encoded in bytes (+8 skips one instruction)
+    tests.push_back({
+        "Conditional branches",
+        {
+            0x00500093, 0x00300113, 0x00500193, 0x00800213,
+            0x00308463, 0x00100113, 0x00200113,  // beq
+            0x00209463, 0x00300113, 0x00400113,  // bne
+            0x00114463, 0x00500113, 0x00600113,  // blt
+            0x00125463, 0x00700113, 0x00800113,  // bge
+            0x00116463, 0x00900113, 0x00A00113,  // bltu
+            0x00117463, 0x00B00113, 0x00C00113,  // bgeu
+            0x0000006F
+        },
+        { {2, 12} }
+    });
+
+    // Backward branch, negative immediates, byte/halfword loads and stores, jal
+    tests.push_back({
+        "Loop and sub-word memory accesses",
+        {
+            0x00A00293,  // addi x5, x0, 10
+            0x00000313,  // addi x6, x0, 0
+            0x00530333,  // loop: add x6, x6, x5
+            0xFFF28293,  // addi x5, x5, -1
+            0xFE029CE3,  // bne x5, x0, loop
+            0x40000393,  // addi x7, x0, 1024
+            0xF8000413,  // addi x8, x0, -128
+            0x00838123,  // sb x8, 2(x7)
+            0x00238483,  // lb x9, 2(x7)
+            0x0023C503,  // lbu x10, 2(x7)
+            0x00839223,  // sh x8, 4(x7)
+            0x00439583,  // lh x11, 4(x7)
+            0x0043D603,  // lhu x12, 4(x7)
+            0x008006EF,  // jal x13, 8
+            0x00100713,  // addi x14, x0, 1 (skipped)
+            0x0000006F   // halt
+        },
+        { {5, 0}, {6, 55}, {9, 0xFFFFFF80}, {10, 0x80}, {11, 0xFFFFFF80}, {12, 0xFF80},
+          {13, 0x38}, {14, 0} }
+    });
+
+    return tests;
+}
+
+int sc_main(int argc, char* argv[]) {
+    std::cout << "FemtoRV32 Quark SystemC TLM-2.0 LT Test Suite" << std::endl;
+    std::cout << "=============================================" << std::endl;
+
+    double quantum_ns = (argc > 1) ? atof(argv[1]) : 1000.0;
+    FemtoRV32_Quark_LT::set_quantum(sc_time(quantum_ns, SC_NS));
+    std::cout << "Quantum: " << quantum_ns << " ns" << std::endl;
+
+    std::vector<LTTestProgram> tests = create_lt_tests();
+
+    // One harness per program (elaboration must be done before sc_start())
+    std::vector<LTTestHarness*> harnesses;
+    for (size_t i = 0; i < tests.size(); i++) {
+        LTTestHarness* harness = new LTTestHarness(sc_gen_unique_name("harness"));
+        harness->memory->load(tests[i].instructions);
+        harnesses.push_back(harness);
+    }
+
+    auto wall_start = std::chrono::steady_clock::now();
+    sc_start(100, SC_US);
+    double wall_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - wall_start
+    ).count();
+
+    int failed = 0;
+    for (size_t i = 0; i < tests.size(); i++) {
+        const LTTestProgram& test = tests[i];
+        FemtoRV32_Quark_LT* cpu = harnesses[i]->cpu;
+        bool passed = true;
+        std::cout << "🔍 " << test.name << std::endl;
+        for (const auto& e : test.expected) {
+            uint32_t actual = cpu->registerFile[e.first];
+            if (actual != e.second) {
+                std::cout << "  ❌ x" << e.first << ": expected 0x" << std::hex << e.second
+                          << ", got 0x" << actual << std::dec << std::endl;
+                passed = false;
+            }
+        }
+        std::cout << "  " << (passed ? "✅" : "❌") << " instret=" << cpu->instret
+                  << " cycles=" << cpu->cycles
+                  << " DMI accesses=" << cpu->dmi_accesses
+                  << " b_transport accesses=" << cpu->transport_accesses
+                  << " syncs=" << cpu->syncs << std::endl;
+        if (!passed) {
+            failed++;
+        }
+    }
+
+    std::cout << "⏱  Wall time: " << std::fixed << std::setprecision(2) << wall_ms
+              << " ms (quantum " << quantum_ns << " ns)" << std::defaultfloat << std::endl;
+
+    for (LTTestHarness* harness : harnesses) {
+        delete harness;
+    }
+
+    if (failed > 0) {
+        std::cout << std::endl << "❌ Some tests failed." << std::endl;
+        return 1;
+    }
+    std::cout << std::endl << "✅ All tests passed!" << std::endl;
+    return 0;
+}
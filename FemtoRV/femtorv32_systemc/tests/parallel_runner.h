@@ -0,0 +1,140 @@
+// Runs test programs in forked processes, so that a test suite can use
+// more than one core (the SystemC kernel is single-threaded, and cannot
+// be elaborated again once started, so each test needs a fresh process).
+//
+// Each child process runs one test, with std::cout captured, and sends
+// back the serialized result followed by its log through a pipe. The
+// parent keeps at most 'jobs' children running, and returns the results
+// in the order of the tests.
+//
+// Test must have a 'name' member, Result must provide:
+//   std::string serialize() const;      (single line, no '\n')
+//   static Result deserialize(const std::string&);
+//   std::string name, message;
+//   std::string log;                    (filled with the child's output)
+// Result::deserialize("") must return a failed result.
+//
+// Linux / POSIX only (fork, pipe, poll).
+
+#ifndef PARALLEL_RUNNER_H
+#define PARALLEL_RUNNER_H
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/wait.h>
+
+template <class Test, class Result, class RunFunc>
+std::vector<Result> run_tests_forked(const std::vector<Test>& tests, int jobs, RunFunc run) {
+    struct Child {
+        pid_t pid;
+        int fd;
+        size_t index;
+        std::string output;
+    };
+
+    std::vector<Result> results(tests.size());
+    std::vector<Child> running;
+    size_t next = 0;
+
+    if (jobs < 1) {
+        jobs = 1;
+    }
+
+    std::cout.flush();
+    fflush(stdout);
+
+    while (next < tests.size() || !running.empty()) {
+        // Start new children
+        while (next < tests.size() && int(running.size()) < jobs) {
+            int fds[2];
+            if (pipe(fds) != 0) {
+                perror("pipe");
+                exit(1);
+            }
+            pid_t pid = fork();
+            if (pid < 0) {
+                perror("fork");
+                exit(1);
+            }
+            if (pid == 0) {
+                // Child: run the test with std::cout captured
+                close(fds[0]);
+                std::ostringstream log;
+                std::streambuf* old_buf = std::cout.rdbuf(log.rdbuf());
+                Result result;
+                try {
+                    result = run(tests[next]);
+                } catch (...) {
+                    std::cout.rdbuf(old_buf);
+                    std::cerr << log.str() << "uncaught exception in test" << std::endl;
+                    _exit(2);
+                }
+                std::cout.rdbuf(old_buf);
+                std::string msg = result.serialize() + "\n" + log.str();
+                const char* p = msg.data();
+                size_t left = msg.size();
+                while (left > 0) {
+                    ssize_t n = write(fds[1], p, left);
+                    if (n <= 0) {
+                        break;
+                    }
+                    p += n;
+                    left -= size_t(n);
+                }
+                close(fds[1]);
+                _exit(0);
+            }
+            close(fds[1]);
+            running.push_back(Child{pid, fds[0], next, std::string()});
+            ++next;
+        }
+
+        // Read from all running children (so that none blocks on a full pipe)
+        std::vector<pollfd> pfds;
+        for (const Child& c : running) {
+            pfds.push_back(pollfd{c.fd, POLLIN, 0});
+        }
+        if (poll(pfds.data(), pfds.size(), -1) < 0) {
+            perror("poll");
+            exit(1);
+        }
+        for (size_t i = running.size(); i-- > 0;) {
+            if (!(pfds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            Child& c = running[i];
+            char buf[4096];
+            ssize_t n = read(c.fd, buf, sizeof(buf));
+            if (n > 0) {
+                c.output.append(buf, size_t(n));
+                continue;
+            }
+            // EOF: child is done
+            close(c.fd);
+            int status = 0;
+            waitpid(c.pid, &status, 0);
+            size_t eol = c.output.find('\n');
+            Result& result = results[c.index];
+            if (eol != std::string::npos && WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+                result = Result::deserialize(c.output.substr(0, eol));
+                result.log = c.output.substr(eol + 1);
+            } else {
+                result = Result::deserialize("");
+                result.name = tests[c.index].name;
+                result.log = c.output;
+                result.message = "test process crashed (status " + std::to_string(status) + ")";
+            }
+            running.erase(running.begin() + long(i));
+        }
+    }
+
+    return results;
+}
+
+#endif // PARALLEL_RUNNER_H
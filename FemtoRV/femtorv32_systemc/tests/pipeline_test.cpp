@@ -0,0 +1,330 @@
+#include <systemc.h>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <iomanip>
+#include <functional>
+#include "../femtorv32_pipeline.h"
+#include "../sparse_memory.h"
+
+// Test of the 5-stages pipelined model: runs small programs with each
+// branch prediction setting (and with a slow instruction memory), checks
+// the final register values, the counters whose value is known for the
+// program, and prints the CPI, stalls and flushes of each run.
+
+struct PipelineConfig {
+    std::string name;
+    BranchPrediction prediction;
+    bool return_address_stack;
+    bool slow_fetch;  // imem_rbusy every other cycle
+};
+
+struct PipelineTestProgram {
+    std::string name;
+    std::vector<uint32_t> instructions;
+    std::vector<std::pair<uint32_t, uint32_t> > expected; // (register, value)
+    uint64_t instret;  // retired instructions, without the ebreak
+    // Checks the counters, returns an error message or ""
+    std::function<std::string(const PipelineConfig&, const FemtoRV32_Pipeline&)> check;
+};
+
+class PipelineTestHarness : public sc_module {
+public:
+    sc_clock clk;
+    sc_signal<bool> reset;
+    sc_signal<sc_uint<32>> imem_addr;
+    sc_signal<sc_uint<32>> imem_rdata;
+    sc_signal<bool> imem_rbusy;
+    sc_signal<bool> mem_rstrb;
+    sc_signal<sc_uint<32>> mem_addr;
+    sc_signal<sc_uint<32>> mem_rdata;
+    sc_signal<bool> mem_rbusy;
+    sc_signal<bool> mem_wbusy;
+    sc_signal<sc_uint<4>> mem_wmask;
+    sc_signal<sc_uint<32>> mem_wdata;
+
+    FemtoRV32_Pipeline* cpu;
+    SparseMemory memory;
+    bool slow_fetch = false;
+    uint32_t reset_cnt = 0;
+
+    PipelineTestHarness(sc_module_name name) : sc_module(name), clk("clk", 10, SC_NS) {
+        cpu = new FemtoRV32_Pipeline("cpu");
+
+        cpu->clk(clk);
+        cpu->reset(reset);
+        cpu->imem_addr(imem_addr);
+        cpu->imem_rdata(imem_rdata);
+        cpu->imem_rbusy(imem_rbusy);
+        cpu->mem_rstrb(mem_rstrb);
+        cpu->mem_addr(mem_addr);
+        cpu->mem_rdata(mem_rdata);
+        cpu->mem_rbusy(mem_rbusy);
+        cpu->mem_wbusy(mem_wbusy);
+        cpu->mem_wmask(mem_wmask);
+        cpu->mem_wdata(mem_wdata);
+
+        SC_METHOD(memory_process);
+        sensitive << imem_addr << mem_rstrb << mem_addr << mem_wmask << mem_wdata;
+
+        SC_METHOD(control_process);
+        sensitive << clk.negedge_event();
+    }
+
+    ~PipelineTestHarness() {
+        delete cpu;
+    }
+
+    void memory_process() {
+        imem_rdata.write(memory.read_word(imem_addr.read().to_uint()));
+        if (mem_rstrb.read()) {
+            mem_rdata.write(memory.read_word(mem_addr.read().to_uint()));
+        }
+        if (mem_wmask.read().to_uint() != 0) {
+            memory.write_word(
+                mem_addr.read().to_uint(), mem_wdata.read().to_uint(), mem_wmask.read().to_uint()
+            );
+        }
+    }
+
+    // Reset (active low) for the first cycles, slow instruction memory
+    void control_process() {
+        reset_cnt++;
+        reset.write(reset_cnt > 2);
+        imem_rbusy.write(slow_fetch && (reset_cnt & 1));
+    }
+};
+
+std::vector<PipelineTestProgram> create_pipeline_tests() {
+    std::vector<PipelineTestProgram> tests;
+
+    // Same programs as in lt_test.cpp, ending with ebreak
+    tests.push_back({
+        "Focused program (forwarding)",
+        {
+            0x00500093, 0x00300113, 0x00A00193, 0x00F00213, // addi x1..x4
+            0x00708093, 0xFFF10113, 0x00118193,             // addi
+            0x00C0F213, 0x00C0E213, 0x00C0C213,             // andi, ori, xori
+            0x00109193, 0x0010D193, 0x002091B3, 0x0020D1B3, 0x4020D1B3, // shifts
+            0x002081B3, 0x402081B3, 0x0020A1B3, 0x0020B1B3,  // add, sub, slt, sltu
+            0x0020C1B3, 0x0020E1B3, 0x0020F1B3,              // xor, or, and
+            0x0020A193, 0x00D0A193, 0x0020B193, 0x00D0B193,  // slti, sltiu
+            0x002081B3, 0x402081B3, 0x002081B3, 0x402081B3,  // add, sub
+            0x0020C1B3, 0x0020E1B3, 0x0020F1B3,              // xor, or, and
+            0x0000A023, 0x0000A103, 0x0040A223, 0x0040A183,  // sw, lw
+            0x00001117, 0x00002197,                          // auipc
+            0x00100073                                       // ebreak
+        },
+        { {1, 12}, {2, 0x1094}, {3, 0x2098}, {4, 0} },
+        39,
+        [](const PipelineConfig&, const FemtoRV32_Pipeline& cpu) -> std::string {
+            // sw x0 / lw x2, sw x4 / lw x3: two loads right after a store
+            if (cpu.load_store_stalls != 2) return "expected 2 load after store stalls";
+            if (cpu.load_use_stalls != 0) return "expected no load-use stall";
+            if (cpu.perf.flushes != 0) return "expected no flush";
+            return "";
+        }
+    });
+
+    tests.push_back({
+        "Conditional branches",
+        {
+            0x00500093, 0x00300113, 0x00500193, 0x00800213,
+            0x00308463, 0x00100113, 0x00200113,  // beq
+            0x00209463, 0x00300113, 0x00400113,  // bne
+            0x00114463, 0x00500113, 0x00600113,  // blt
+            0x00125463, 0x00700113, 0x00800113,  // bge
+            0x00116463, 0x00900113, 0x00A00113,  // bltu
+            0x00117463, 0x00B00113, 0x00C00113,  // bgeu
+            0x00100073
+        },
+        { {2, 12} },
+        17,
+        [](const PipelineConfig& config, const FemtoRV32_Pipeline& cpu) -> std::string {
+            // 6 forward branches, 5 of them taken
+            if (cpu.branches != 6) return "expected 6 branches";
+            if (config.prediction == PREDICT_NONE || config.prediction == PREDICT_BTFNT) {
+                if (cpu.branch_mispredictions != 5) return "expected 5 mispredictions";
+            }
+            return "";
+        }
+    });
+
+    tests.push_back({
+        "Loop and sub-word memory accesses",
+        {
+            0x00A00293,  // addi x5, x0, 10
+            0x00000313,  // addi x6, x0, 0
+            0x00530333,  // loop: add x6, x6, x5
+            0xFFF28293,  // addi x5, x5, -1
+            0xFE029CE3,  // bne x5, x0, loop
+            0x40000393,  // addi x7, x0, 1024
+            0xF8000413,  // addi x8, x0, -128
+            0x00838123,  // sb x8, 2(x7)
+            0x00238483,  // lb x9, 2(x7)
+            0x0023C503,  // lbu x10, 2(x7)
+            0x00839223,  // sh x8, 4(x7)
+            0x00439583,  // lh x11, 4(x7)
+            0x0043D603,  // lhu x12, 4(x7)
+            0x008006EF,  // jal x13, 8
+            0x00100713,  // addi x14, x0, 1 (skipped)
+            0x00100073   // ebreak
+        },
+        { {5, 0}, {6, 55}, {9, 0xFFFFFF80}, {10, 0x80}, {11, 0xFFFFFF80}, {12, 0xFF80},
+          {13, 0x38}, {14, 0} },
+        41,
+        [](const PipelineConfig& config, const FemtoRV32_Pipeline& cpu) -> std::string {
+            if (cpu.load_store_stalls != 2) return "expected 2 load after store stalls";
+            // backward branch: taken 9 times, then falls through
+            if (config.prediction == PREDICT_BTFNT && cpu.branch_mispredictions != 1) {
+                return "expected 1 misprediction (loop exit)";
+            }
+            if (config.prediction == PREDICT_NONE && cpu.perf.flushes != 10) {
+                return "expected 10 flushes (9 taken branches, 1 jal)";
+            }
+            return "";
+        }
+    });
+
+    // Calls and returns (return address stack), load-use and CSR-use
+    // bubbles
+    tests.push_back({
+        "Calls, load-use and CSR-use",
+        {
+            0x40000513,  //       li   a0, 1024
+            0x00500593,  //       li   a1, 5
+            0x00B52023,  //       sw   a1, 0(a0)
+            0x00052603,  //       lw   a2, 0(a0)
+            0x00160693,  //       addi a3, a2, 1
+            0x00000413,  //       li   s0, 0
+            0x00A00493,  //       li   s1, 10
+            0x01C000EF,  // loop: jal  ra, func
+            0x00E40433,  //       add  s0, s0, a4
+            0xFFF48493,  //       addi s1, s1, -1
+            0xFE049AE3,  //       bnez s1, loop
+            0xC00022F3,  //       rdcycle t0
+            0x00503333,  //       snez t1, t0
+            0x00100073,  //       ebreak
+            0x00048713,  // func: mv   a4, s1
+            0x00008067   //       ret
+        },
+        { {8, 55}, {9, 0}, {12, 5}, {13, 6}, {6, 1} },
+        69,
+        [](const PipelineConfig& config, const FemtoRV32_Pipeline& cpu) -> std::string {
+            if (cpu.load_store_stalls != 1) return "expected 1 load after store stall";
+            if (cpu.load_use_stalls != 2) return "expected 2 load-use stalls (lw, rdcycle)";
+            if (cpu.jalrs != 10) return "expected 10 jalr";
+            bool ras = config.prediction != PREDICT_NONE && config.return_address_stack;
+            if (ras && cpu.jalr_mispredictions != 0) return "expected all returns predicted";
+            if (!ras && cpu.jalr_mispredictions != 10) return "expected 10 jalr mispredictions";
+            if (config.prediction == PREDICT_NONE && cpu.jal_flushes != 10) {
+                return "expected 10 jal flushes";
+            }
+            return "";
+        }
+    });
+
+    return tests;
+}
+
+std::vector<PipelineConfig> create_pipeline_configs() {
+    return {
+        { "no prediction",  PREDICT_NONE,   false, false },
+        { "BTFNT",          PREDICT_BTFNT,  false, false },
+        { "BTFNT + RAS",    PREDICT_BTFNT,  true,  false },
+        { "gshare",         PREDICT_GSHARE, false, false },
+        { "gshare + RAS",   PREDICT_GSHARE, true,  false },
+        { "gshare + RAS, slow fetch", PREDICT_GSHARE, true, true }
+    };
+}
+
+int sc_main(int, char*[]) {
+    std::cout << "FemtoRV32 Pipeline SystemC Test Suite" << std::endl;
+    std::cout << "=====================================" << std::endl;
+
+    std::vector<PipelineTestProgram> tests = create_pipeline_tests();
+    std::vector<PipelineConfig> configs = create_pipeline_configs();
+
+    // One harness per program and configuration (elaboration must be
+    // done before sc_start())
+    std::vector<PipelineTestHarness*> harnesses;
+    for (size_t i = 0; i < tests.size(); i++) {
+        for (size_t j = 0; j < configs.size(); j++) {
+            PipelineTestHarness* harness = new PipelineTestHarness(sc_gen_unique_name("harness"));
+            harness->memory.load(tests[i].instructions);
+            harness->cpu->prediction = configs[j].prediction;
+            harness->cpu->return_address_stack = configs[j].return_address_stack;
+            harness->slow_fetch = configs[j].slow_fetch;
+            harnesses.push_back(harness);
+        }
+    }
+
+    sc_start(20, SC_US);
+
+    int failed = 0;
+    for (size_t i = 0; i < tests.size(); i++) {
+        const PipelineTestProgram& test = tests[i];
+        std::cout << "🔍 " << test.name << std::endl;
+        for (size_t j = 0; j < configs.size(); j++) {
+            const PipelineConfig& config = configs[j];
+            const FemtoRV32_Pipeline* cpu = harnesses[i * configs.size() + j]->cpu;
+            std::string error;
+            if (!cpu->halted()) {
+                error = "did not reach ebreak";
+            }
+            for (const auto& e : test.expected) {
+                uint32_t actual = cpu->registerFile[e.first];
+                if (error.empty() && actual != e.second) {
+                    std::ostringstream out;
+                    out << "x" << e.first << ": expected 0x" << std::hex << e.second
+                        << ", got 0x" << actual;
+                    error = out.str();
+                }
+            }
+            // ebreak retires too
+            if (error.empty() && cpu->perf.instret != test.instret + 1) {
+                error = "expected " + std::to_string(test.instret + 1) +
+                        " retired instructions, got " + std::to_string(cpu->perf.instret);
+            }
+            if (error.empty() && cpu->perf.stalls !=
+                cpu->load_use_stalls + cpu->load_store_stalls + cpu->memory_stalls) {
+                error = "perf.stalls is not the sum of the stall causes";
+            }
+            if (error.empty() && cpu->perf.flushes !=
+                cpu->branch_mispredictions + cpu->jalr_mispredictions + cpu->jal_flushes) {
+                error = "perf.flushes is not the sum of the flush causes";
+            }
+            if (error.empty()) {
+                error = test.check(config, *cpu);
+            }
+            std::cout << "  " << (error.empty() ? "✅ " : "❌ ")
+                      << std::left << std::setw(26) << config.name << std::right
+                      << " cycles=" << std::setw(4) << cpu->perf.cycles
+                      << " CPI=" << std::fixed << std::setprecision(2) << cpu->perf.CPI()
+                      << std::defaultfloat
+                      << " stalls=" << cpu->perf.stalls
+                      << " (load-use " << cpu->load_use_stalls
+                      << ", load-store " << cpu->load_store_stalls
+                      << ", memory " << cpu->memory_stalls << ")"
+                      << " flushes=" << cpu->perf.flushes
+                      << " (branch " << cpu->branch_mispredictions << "/" << cpu->branches
+                      << ", jalr " << cpu->jalr_mispredictions << "/" << cpu->jalrs
+                      << ", jal " << cpu->jal_flushes << ")" << std::endl;
+            if (!error.empty()) {
+                std::cout << "     " << error << std::endl;
+                failed++;
+            }
+        }
+    }
+
+    for (PipelineTestHarness* harness : harnesses) {
+        delete harness;
+    }
+
+    if (failed > 0) {
+        std::cout << std::endl << "❌ Some tests failed." << std::endl;
+        return 1;
+    }
+    std::cout << std::endl << "✅ All tests passed!" << std::endl;
+    return 0;
+}
@@ -3,6 +3,7 @@
 #include <vector>
 #include <iomanip>
 #include "../femtorv32_quark.h"
+#include "../sparse_memory.h"
 
 class SimpleBranchTestHarness : public sc_module {
 public:
@@ -17,12 +18,12 @@ public:
     sc_signal<sc_uint<32>> mem_wdata;
 
     FemtoRV32_Quark* cpu;
-    std::vector<uint32_t>* memory;
+    SparseMemory* memory;
     uint32_t reset_cnt;
 
     SimpleBranchTestHarness(sc_module_name name) : sc_module(name), clk("clk", 10, SC_NS) {
         cpu = new FemtoRV32_Quark("cpu");
-        memory = new std::vector<uint32_t>(1024, 0);
+        memory = new SparseMemory();
         reset_cnt = 0;
 
         // Connect CPU signals
@@ -47,19 +48,9 @@ public:
 
     void memory_process() {
         if (mem_rstrb.read()) {
-            uint32_t addr = mem_addr.read().to_uint();
-            uint32_t word_addr = addr >> 2;
-            if (word_addr < memory->size()) {
-                uint32_t data = (*memory)[word_addr];
-                mem_rdata.write(data);
-                mem_rbusy.write(false);
-            } else {
-                mem_rdata.write(0);
-                mem_rbusy.write(false);
-            }
-        } else {
-            mem_rbusy.write(false);
+            mem_rdata.write(memory->read_word(mem_addr.read().to_uint()));
         }
+        mem_rbusy.write(false);
     }
 
     void reset_process() {
@@ -126,7 +117,7 @@ int sc_main(int /* argc */, char* /* argv */[]) {
     
     // Load program
     for (size_t i = 0; i < instructions.size(); i++) {
-        (*harness.memory)[i] = instructions[i];
+        harness.memory->write_word(uint32_t(i) * 4, instructions[i]);
         std::cout << "Address 0x" << std::hex << (i * 4) << ": 0x" << instructions[i] << std::dec << std::endl;
     }
     
@@ -0,0 +1,436 @@
+#include <systemc.h>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include "../femtorv32_quark.h"
+#include "../harness_memory.h"
+#include "../memory_latency.h"
+#include "../bus_arbiter.h"
+#include "parallel_runner.h"
+
+// Runs the same firmware ELF on 1, 2, ... N pin-level FemtoRV32_Quark
+// cores that share one memory bus (bus_arbiter.h), and reports how the
+// CPI of each core degrades as N grows, to size the memory system of a
+// multi-core SoC.
+//
+// Usage: smp_run [-f] [-a policy] [-m model] [-n harts] [-j jobs] file.elf [max_cycles] [ram_bytes]
+//  -f:         functional mode (FemtoRV32_Quark::functional_mode)
+//  -a policy:  arbitration, rr (round-robin, default) or prio (hart 0 first)
+//  -m model:   memory latency model of the bus (memory_latency.h), for
+//              instance fixed:2 or sdram:4,8 (default: no wait cycle,
+//              the bus serves one access per cycle)
+//  -n harts:   runs with 1 to 'harts' cores (default 4)
+//  -j jobs:    number of runs in parallel (default 1, so that the wall
+//              clock times are comparable)
+//  max_cycles: each run stops after max_cycles (default 10000000), or
+//              when all the cores reached a 'jal x0, 0' loop.
+//  ram_bytes:  size of the RAM (default 4 MB, the IO page starts at 0x400000).
+//
+// Each core has its own copy of the ELF image in its own RAM (so that
+// the firmware needs no hart id and no locking), but all of their RAM
+// accesses go through the same bus, timed by one latency model: this
+// models the bandwidth shared by the cores, not the coherency of their
+// data. The IO page is not on the bus. The UART output is discarded and
+// reads of the UART return 0 (not busy, no data), the RAM size hardware
+// config register is implemented. A core that halts is held in reset,
+// so that it leaves the bus to the others.
+
+static const uint32_t IO_BASE          = 0x400000;
+static const uint32_t IO_HW_CONFIG_RAM = 1u << (2 + 17);
+static const uint32_t HALT             = 0x0000006F; // jal x0, 0
+
+struct Hart {
+    sc_signal<bool> reset;
+    sc_signal<bool> mem_rstrb;
+    sc_signal<sc_uint<32>> mem_addr;
+    sc_signal<sc_uint<32>> mem_rdata;
+    sc_signal<bool> mem_rbusy;
+    sc_signal<bool> mem_wbusy;
+    sc_signal<sc_uint<4>> mem_wmask;
+    sc_signal<sc_uint<32>> mem_wdata;
+
+    std::unique_ptr<FemtoRV32_Quark> cpu;
+    HarnessMemory memory;
+    bool fetch_request = false;  // mem_rstrb is an instruction fetch
+    bool halted = false;
+    uint64_t cycles = 0;         // cycles until HALT
+    uint64_t instret = 0;
+
+    Hart(const std::string& name, size_t ram_bytes) :
+        reset((name + "_reset").c_str()),
+        mem_rstrb((name + "_mem_rstrb").c_str()),
+        mem_addr((name + "_mem_addr").c_str()),
+        mem_rdata((name + "_mem_rdata").c_str()),
+        mem_rbusy((name + "_mem_rbusy").c_str()),
+        mem_wbusy((name + "_mem_wbusy").c_str()),
+        mem_wmask((name + "_mem_wmask").c_str()),
+        mem_wdata((name + "_mem_wdata").c_str()),
+        cpu(new FemtoRV32_Quark(name.c_str())),
+        memory(ram_bytes) {
+    }
+};
+
+class SmpHarness : public sc_module {
+public:
+    sc_clock clk;
+    std::vector<std::unique_ptr<Hart>> harts;
+    BusArbiter bus;
+    uint64_t max_cycles;
+    uint64_t nb_cycles = 0;
+
+    SmpHarness(sc_module_name name, int nb_harts, size_t ram_bytes, uint64_t max_cycles,
+               ArbiterPolicy policy, std::unique_ptr<MemoryLatency> latency) :
+        sc_module(name), clk("clk", 10, SC_NS),
+        bus(nb_harts, policy, std::move(latency)), max_cycles(max_cycles) {
+        for (int i = 0; i < nb_harts; i++) {
+            harts.emplace_back(new Hart("hart" + std::to_string(i), ram_bytes));
+            Hart& h = *harts.back();
+            h.cpu->clk(clk);
+            h.cpu->reset(h.reset);
+            h.cpu->mem_rstrb(h.mem_rstrb);
+            h.cpu->mem_addr(h.mem_addr);
+            h.cpu->mem_rdata(h.mem_rdata);
+            h.cpu->mem_rbusy(h.mem_rbusy);
+            h.cpu->mem_wbusy(h.mem_wbusy);
+            h.cpu->mem_wmask(h.mem_wmask);
+            h.cpu->mem_wdata(h.mem_wdata);
+        }
+
+        SC_METHOD(memory_process);
+        for (auto& h : harts) {
+            sensitive << h->mem_rstrb << h->mem_addr << h->mem_wmask << h->mem_wdata;
+        }
+
+        SC_METHOD(bus_process);
+        sensitive << clk.posedge_event(); // same edge as the state machines
+
+        SC_THREAD(monitor_process);
+    }
+
+    static bool is_io(uint32_t addr) {
+        return (addr & (3u << 22)) != 0; // NRV_IS_IO_ADDR
+    }
+
+    // Private RAM of each core, answered in the cycle (the bus only
+    // decides when the core may use the data)
+    void memory_process() {
+        for (auto& hp : harts) {
+            Hart& h = *hp;
+            uint32_t addr = h.mem_addr.read().to_uint();
+            bool io = is_io(addr);
+            if (h.mem_rstrb.read()) {
+                h.fetch_request = (h.cpu->state == FETCH_INSTR);
+                if (!io) {
+                    h.mem_rdata.write(h.memory.read_word(addr));
+                } else if ((addr - IO_BASE) == IO_HW_CONFIG_RAM) {
+                    h.mem_rdata.write(uint32_t(h.memory.size()));
+                } else {
+                    h.mem_rdata.write(0);
+                }
+            }
+            uint32_t wmask = h.mem_wmask.read().to_uint();
+            if (wmask != 0 && !io) {
+                h.memory.write_word(addr, h.mem_wdata.read().to_uint(), wmask);
+            }
+        }
+    }
+
+    // Signal values at the clock edge are the requests of the cycle that
+    // ends: queued on the bus, then arbitrated.
+    void bus_process() {
+        for (int i = 0; i < int(harts.size()); i++) {
+            Hart& h = *harts[size_t(i)];
+            uint32_t addr = h.mem_addr.read().to_uint();
+            bool write = h.mem_wmask.read().to_uint() != 0;
+            if ((h.mem_rstrb.read() || write) && !is_io(addr)) {
+                MemoryAccessType type = write ? ACCESS_STORE : (h.fetch_request ? ACCESS_FETCH : ACCESS_LOAD);
+                bus.request(i, type, addr);
+            }
+        }
+        bus.clock();
+        for (int i = 0; i < int(harts.size()); i++) {
+            Hart& h = *harts[size_t(i)];
+            bool busy = bus.busy(i);
+            bool store = (bus.busy_type(i) == ACCESS_STORE);
+            h.mem_rbusy.write(busy && !store);
+            h.mem_wbusy.write(busy && store);
+        }
+    }
+
+    // Releases reset, counts cycles and instructions per core, holds the
+    // cores that reach HALT in reset, stops when all of them halted or
+    // after max_cycles.
+    void monitor_process() {
+        for (auto& h : harts) {
+            h->reset.write(false);
+        }
+        wait(clk.posedge_event());
+        for (auto& h : harts) {
+            h->reset.write(true);
+        }
+        for (;;) {
+            wait(clk.posedge_event());
+            wait(SC_ZERO_TIME);
+            ++nb_cycles;
+            bool running = false;
+            for (auto& hp : harts) {
+                Hart& h = *hp;
+                if (h.halted) {
+                    continue;
+                }
+                h.cycles = nb_cycles;
+                if (h.cpu->state == EXECUTE) {
+                    if (static_cast<uint32_t>(h.cpu->full_instr) == HALT) {
+                        h.halted = true;
+                        h.reset.write(false);
+                        continue;
+                    }
+                    ++h.instret;
+                }
+                running = true;
+            }
+            if (!running || nb_cycles >= max_cycles) {
+                sc_stop();
+                return;
+            }
+        }
+    }
+};
+
+/*******************************************************************/
+
+struct SmpConfig {
+    std::string name;
+    int nb_harts = 1;
+};
+
+struct HartResult {
+    bool halted = false;
+    uint64_t cycles = 0;
+    uint64_t instret = 0;
+    uint64_t grants = 0;
+    uint64_t arbitration_cycles = 0;
+    uint64_t latency_cycles = 0;
+
+    double CPI() const {
+        return instret ? double(cycles) / double(instret) : 0.0;
+    }
+};
+
+struct SmpResult {
+    std::string name;
+    bool passed = false;
+    std::string message;
+    std::vector<HartResult> harts;
+    uint64_t cycles = 0;
+    uint64_t bus_cycles = 0;
+    double wall_ms = 0.0;
+    std::string log;
+
+    std::string serialize() const {
+        std::ostringstream out;
+        out << name << '\t' << passed << '\t' << cycles << '\t' << bus_cycles << '\t'
+            << wall_ms << '\t' << harts.size();
+        for (const HartResult& h : harts) {
+            out << '\t' << h.halted << '\t' << h.cycles << '\t' << h.instret << '\t' << h.grants
+                << '\t' << h.arbitration_cycles << '\t' << h.latency_cycles;
+        }
+        out << '\t' << message;
+        return out.str();
+    }
+
+    static SmpResult deserialize(const std::string& record) {
+        SmpResult result;
+        std::istringstream in(record);
+        std::string field;
+        if (!std::getline(in, result.name, '\t')) {
+            return result;
+        }
+        std::getline(in, field, '\t'); result.passed = (field == "1");
+        std::getline(in, field, '\t'); result.cycles = strtoull(field.c_str(), nullptr, 10);
+        std::getline(in, field, '\t'); result.bus_cycles = strtoull(field.c_str(), nullptr, 10);
+        std::getline(in, field, '\t'); result.wall_ms = atof(field.c_str());
+        std::getline(in, field, '\t');
+        size_t nb_harts = size_t(strtoul(field.c_str(), nullptr, 10));
+        for (size_t i = 0; i < nb_harts; i++) {
+            HartResult h;
+            std::getline(in, field, '\t'); h.halted = (field == "1");
+            std::getline(in, field, '\t'); h.cycles = strtoull(field.c_str(), nullptr, 10);
+            std::getline(in, field, '\t'); h.instret = strtoull(field.c_str(), nullptr, 10);
+            std::getline(in, field, '\t'); h.grants = strtoull(field.c_str(), nullptr, 10);
+            std::getline(in, field, '\t'); h.arbitration_cycles = strtoull(field.c_str(), nullptr, 10);
+            std::getline(in, field, '\t'); h.latency_cycles = strtoull(field.c_str(), nullptr, 10);
+            result.harts.push_back(h);
+        }
+        std::getline(in, result.message);
+        return result;
+    }
+};
+
+struct SmpOptions {
+    const char* filename = nullptr;
+    bool functional_mode = false;
+    ArbiterPolicy policy = ARBITER_ROUND_ROBIN;
+    std::string latency_spec;
+    uint64_t max_cycles = 10000000;
+    size_t ram_bytes = 4u * 1024 * 1024;
+};
+
+static SmpOptions options;
+
+static SmpResult run_smp(const SmpConfig& config) {
+    SmpResult result;
+    result.name = config.name;
+
+    std::string error;
+    std::unique_ptr<MemoryLatency> latency;
+    if (!options.latency_spec.empty()) {
+        latency = MemoryLatency::create(options.latency_spec, error);
+    }
+    SmpHarness harness("harness", config.nb_harts, options.ram_bytes, options.max_cycles,
+                       options.policy, std::move(latency));
+    for (auto& h : harness.harts) {
+        h->cpu->functional_mode = options.functional_mode;
+        if (!h->memory.load_elf(options.filename, error)) {
+            result.message = error;
+            return result;
+        }
+    }
+
+    auto wall_start = std::chrono::steady_clock::now();
+    sc_start();
+    result.wall_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - wall_start
+    ).count();
+
+    result.cycles = harness.nb_cycles;
+    result.bus_cycles = harness.bus.bus_cycles();
+    bool all_halted = true;
+    for (int i = 0; i < config.nb_harts; i++) {
+        const Hart& h = *harness.harts[size_t(i)];
+        const BusArbiter::MasterStats& s = harness.bus.stats(i);
+        HartResult r;
+        r.halted = h.halted;
+        r.cycles = h.cycles;
+        r.instret = h.instret;
+        r.grants = s.grants;
+        r.arbitration_cycles = s.arbitration_cycles;
+        r.latency_cycles = s.latency_cycles;
+        result.harts.push_back(r);
+        all_halted = all_halted && h.halted;
+    }
+    if (!all_halted) {
+        result.message = "max cycles reached";
+    }
+    result.passed = true;
+    return result;
+}
+
+int sc_main(int argc, char* argv[]) {
+    int max_harts = 4;
+    int jobs = 1;
+    std::string error;
+    while (argc > 1 && argv[1][0] == '-') {
+        if (!strcmp(argv[1], "-f")) {
+            options.functional_mode = true;
+        } else if (!strcmp(argv[1], "-a") && argc > 2) {
+            if (!BusArbiter::parse_policy(argv[2], options.policy, error)) {
+                std::cerr << "❌ " << error << std::endl;
+                return 1;
+            }
+            argv++;
+            argc--;
+        } else if (!strcmp(argv[1], "-m") && argc > 2) {
+            options.latency_spec = argv[2];
+            if (!MemoryLatency::create(options.latency_spec, error)) {
+                std::cerr << "❌ " << error << std::endl;
+                return 1;
+            }
+            argv++;
+            argc--;
+        } else if (!strcmp(argv[1], "-n") && argc > 2) {
+            max_harts = atoi(argv[2]);
+            argv++;
+            argc--;
+        } else if (!strcmp(argv[1], "-j") && argc > 2) {
+            jobs = atoi(argv[2]);
+            argv++;
+            argc--;
+        } else {
+            break;
+        }
+        argv++;
+        argc--;
+    }
+    if (argc < 2 || max_harts < 1) {
+        std::cerr << "Usage: smp_run [-f] [-a rr|prio] [-m model] [-n harts] [-j jobs] file.elf [max_cycles] [ram_bytes]" << std::endl;
+        return 1;
+    }
+    options.filename = argv[1];
+    if (argc > 2) {
+        options.max_cycles = strtoull(argv[2], nullptr, 0);
+    }
+    if (argc > 3) {
+        options.ram_bytes = size_t(strtoull(argv[3], nullptr, 0));
+    }
+
+    std::cout << "FemtoRV32 Quark shared bus" << std::endl;
+    std::cout << "==========================" << std::endl;
+    std::cout << options.filename << ", " << BusArbiter::policy_name(options.policy) << ", "
+              << (options.latency_spec.empty() ? "no wait cycle" : options.latency_spec)
+              << std::endl << std::endl;
+
+    std::vector<SmpConfig> configs;
+    for (int n = 1; n <= max_harts; n++) {
+        SmpConfig config;
+        config.nb_harts = n;
+        config.name = std::to_string(n) + (n == 1 ? " hart" : " harts");
+        configs.push_back(config);
+    }
+
+    std::vector<SmpResult> results =
+        run_tests_forked<SmpConfig, SmpResult>(configs, jobs, run_smp);
+
+    // Reference: the CPI of the core alone on the bus
+    double alone_CPI = (!results.empty() && !results[0].harts.empty()) ? results[0].harts[0].CPI() : 0.0;
+
+    int failed = 0;
+    for (const SmpResult& r : results) {
+        if (!r.passed) {
+            std::cout << "❌ " << r.name << " (" << r.message << ")" << std::endl;
+            failed++;
+            continue;
+        }
+        std::cout << (r.message.empty() ? "✅ " : "⏹  ") << r.name;
+        if (!r.message.empty()) {
+            std::cout << " (" << r.message << ")";
+        }
+        std::cout << std::fixed << std::setprecision(1)
+                  << ": " << r.cycles << " cycles, bus busy "
+                  << (r.cycles ? 100.0 * double(r.bus_cycles) / double(r.cycles) : 0.0)
+                  << "% of the cycles, wall " << std::setprecision(2) << r.wall_ms << " ms"
+                  << std::defaultfloat << std::endl;
+        for (size_t i = 0; i < r.harts.size(); i++) {
+            const HartResult& h = r.harts[i];
+            double CPI = h.CPI();
+            std::cout << "  hart " << i << ": " << std::setw(12) << h.instret << " instructions, CPI "
+                      << std::fixed << std::setprecision(3) << CPI << " ("
+                      << std::showpos << std::setprecision(1)
+                      << (alone_CPI > 0.0 ? 100.0 * (CPI / alone_CPI - 1.0) : 0.0)
+                      << std::noshowpos << "%), " << h.arbitration_cycles << " cycles waiting for the bus, "
+                      << h.latency_cycles << " for the memory" << std::defaultfloat << std::endl;
+        }
+    }
+
+    if (failed > 0) {
+        std::cout << std::endl << "❌ Some runs failed." << std::endl;
+        return 1;
+    }
+    return 0;
+}
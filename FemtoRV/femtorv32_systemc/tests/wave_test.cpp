@@ -0,0 +1,125 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstdio>
+#include "../wave_trace.h"
+
+// Test of the windowed waveform tracing (wave_trace.h): parsing of the
+// window specifications, cycles selected by the cycle and PC triggers,
+// signal subsets, and the value changes written to the VCD file.
+//
+// Usage: wave_test
+
+static int failures = 0;
+
+static void check(bool ok, const std::string& what) {
+    std::cout << (ok ? "  ✅ " : "  ❌ ") << what << std::endl;
+    if (!ok) {
+        failures++;
+    }
+}
+
+static bool parse(WaveWindow& window, const std::string& spec) {
+    std::string error;
+    bool ok = window.parse(spec, error);
+    if (!ok) {
+        std::cout << "  " << error << std::endl;
+    }
+    return ok;
+}
+
+// Runs 'n' cycles, the PC advances by 4 per cycle, returns the cycles in the window
+static std::string run(WaveWindow& window, uint64_t n) {
+    std::string result;
+    for (uint64_t cycle = 0; cycle < n; cycle++) {
+        if (window.update(cycle, uint32_t(cycle * 4))) {
+            result += (result.empty() ? "" : ",") + std::to_string(cycle);
+        }
+    }
+    return result;
+}
+
+int main() {
+    std::cout << "FemtoRV32 Waveform Window Test" << std::endl;
+    std::cout << "==============================" << std::endl;
+
+    std::cout << "🔍 Specifications" << std::endl;
+    {
+        WaveWindow w;
+        check(parse(w, "out.vcd,from=100,pc=0x40,cycles=8,signals=pc+mem_*") &&
+              w.file == "out.vcd" && w.from_cycle == 100 && w.has_pc && w.start_pc == 0x40 &&
+              w.nb_cycles == 8 && w.signals.size() == 2, "all the arguments");
+        WaveWindow all;
+        check(parse(all, "out.vcd") && all.from_cycle == 0 && !all.has_pc &&
+              all.nb_cycles == 0 && all.signals.empty(), "file only");
+        std::string error;
+        WaveWindow bad;
+        check(!bad.parse("", error), "missing file rejected");
+        check(!bad.parse("cycles=8", error), "missing file before the arguments rejected");
+        check(!bad.parse("out.vcd,cycles=x", error), "invalid number rejected");
+        check(!bad.parse("out.vcd,depth=2", error), "unknown argument rejected");
+    }
+
+    std::cout << "🔍 Triggers" << std::endl;
+    {
+        WaveWindow w;
+        parse(w, "out.vcd,from=3,cycles=2");
+        check(run(w, 10) == "3,4" && w.done() && w.start_cycle() == 3, "from cycle 3, 2 cycles");
+        WaveWindow pc;
+        parse(pc, "out.vcd,pc=0x14,cycles=3");
+        check(run(pc, 10) == "5,6,7", "from PC 0x14, 3 cycles");
+        WaveWindow both;
+        parse(both, "out.vcd,from=6,pc=0x14");
+        check(run(both, 10).empty() && !both.started(), "PC reached before the start cycle");
+        WaveWindow end;
+        parse(end, "out.vcd,from=8");
+        check(run(end, 10) == "8,9" && !end.done(), "until the end");
+    }
+
+    std::cout << "🔍 Signal subsets" << std::endl;
+    {
+        WaveWindow w;
+        parse(w, "out.vcd,signals=pc+mem_*");
+        check(w.selected("pc") && w.selected("mem_addr") && w.selected("mem_rdata"), "selected signals");
+        check(!w.selected("pc2") && !w.selected("x1") && !w.selected("me"), "other signals");
+        WaveWindow all;
+        parse(all, "out.vcd");
+        check(all.selected("x31"), "all signals by default");
+    }
+
+    std::cout << "🔍 VCD file" << std::endl;
+    {
+        std::string filename = "wave_test.vcd";
+        std::string error;
+        {
+            VCDWriter vcd;
+            int pc = vcd.add("pc", 8);
+            int busy = vcd.add("busy", 1);
+            check(vcd.open(filename, "10 ns", error), "file created");
+            vcd.set(pc, 0x12); vcd.set(busy, 0); vcd.dump(5);
+            vcd.set(pc, 0x12); vcd.set(busy, 1); vcd.dump(6);
+            vcd.set(pc, 0x80); vcd.set(busy, 1); vcd.dump(7);
+            check(vcd.nb_dumps() == 3, "3 dumps");
+        }
+        std::ifstream in(filename);
+        std::stringstream content;
+        content << in.rdbuf();
+        std::string vcd = content.str();
+        check(vcd.find("$timescale 10 ns $end") != std::string::npos, "timescale");
+        check(vcd.find("$var wire 8 ! pc $end") != std::string::npos &&
+              vcd.find("$var wire 1 \" busy $end") != std::string::npos, "declarations");
+        check(vcd.find("#5\n$dumpvars\nb00010010 !\n0\"\n$end\n") != std::string::npos, "initial values");
+        check(vcd.find("#6\n1\"\n#7\nb10000000 !\n") != std::string::npos, "only the changes");
+        remove(filename.c_str());
+        VCDWriter unwritable;
+        check(!unwritable.open("/nonexistent/wave.vcd", "1 ns", error), "unwritable file rejected");
+    }
+
+    if (failures != 0) {
+        std::cout << std::endl << "❌ Some tests failed." << std::endl;
+        return 1;
+    }
+    std::cout << std::endl << "✅ All tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,86 @@
+/*******************************************************************/
+// TLM-2.0 RAM target for the loosely-timed FemtoRV32 models.
+//
+// Blocking transport and DMI, with configurable read/write
+// latencies. Addresses are relative to the base address given
+// to the constructor.
+/*******************************************************************/
+
+#ifndef TLM_MEMORY_H
+#define TLM_MEMORY_H
+
+#include <systemc.h>
+#include <tlm.h>
+#include <tlm_utils/simple_target_socket.h>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+
+SC_MODULE(TLM_Memory) {
+    tlm_utils::simple_target_socket<TLM_Memory> socket;
+
+    TLM_Memory(sc_module_name name, size_t size_in_bytes, uint64_t base = 0,
+               sc_time read_latency = SC_ZERO_TIME,
+               sc_time write_latency = SC_ZERO_TIME) :
+        sc_module(name),
+        socket("socket"),
+        base_addr(base),
+        read_latency(read_latency),
+        write_latency(write_latency),
+        data(size_in_bytes, 0) {
+        socket.register_b_transport(this, &TLM_Memory::b_transport);
+        socket.register_get_direct_mem_ptr(this, &TLM_Memory::get_direct_mem_ptr);
+    }
+
+    const uint64_t base_addr;
+    sc_time read_latency;
+    sc_time write_latency;
+    std::vector<uint8_t> data;
+
+    // Copies 32-bit words to memory, starting from byte offset 'offset'
+    // (little-endian host assumed).
+    void load(const std::vector<uint32_t>& words, size_t offset = 0) {
+        sc_assert(offset + words.size() * 4 <= data.size());
+        memcpy(&data[offset], words.data(), words.size() * 4);
+    }
+
+    uint32_t read_word(size_t offset) const {
+        uint32_t result;
+        memcpy(&result, &data[offset], 4);
+        return result;
+    }
+
+    void b_transport(tlm::tlm_generic_payload& trans, sc_time& delay) {
+        uint64_t addr = trans.get_address() - base_addr;
+        unsigned int len = trans.get_data_length();
+        if (trans.get_address() < base_addr || addr + len > data.size()) {
+            trans.set_response_status(tlm::TLM_ADDRESS_ERROR_RESPONSE);
+            return;
+        }
+        if (trans.get_byte_enable_ptr() != nullptr || trans.get_streaming_width() < len) {
+            trans.set_response_status(tlm::TLM_BYTE_ENABLE_ERROR_RESPONSE);
+            return;
+        }
+        if (trans.is_read()) {
+            memcpy(trans.get_data_ptr(), &data[addr], len);
+            delay += read_latency;
+        } else if (trans.is_write()) {
+            memcpy(&data[addr], trans.get_data_ptr(), len);
+            delay += write_latency;
+        }
+        trans.set_dmi_allowed(true);
+        trans.set_response_status(tlm::TLM_OK_RESPONSE);
+    }
+
+    bool get_direct_mem_ptr(tlm::tlm_generic_payload& /* trans */, tlm::tlm_dmi& dmi) {
+        dmi.set_dmi_ptr(data.data());
+        dmi.set_start_address(base_addr);
+        dmi.set_end_address(base_addr + data.size() - 1);
+        dmi.set_read_latency(read_latency);
+        dmi.set_write_latency(write_latency);
+        dmi.allow_read_write();
+        return true;
+    }
+};
+
+#endif // TLM_MEMORY_H
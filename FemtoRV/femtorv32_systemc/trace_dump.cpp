@@ -0,0 +1,64 @@
+/*******************************************************************/
+// trace_dump: pretty-prints an instruction trace written by
+// QuarkTraceSink::dump() (models compiled with -DNRV_TRACE), with the
+// disassembly of each instruction (riscv_disasm.h).
+//
+// Usage: trace_dump file.trace [last_n]
+//  last_n: only prints the last last_n records
+/*******************************************************************/
+
+#include "quark_trace.h"
+#include "riscv_disasm.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s file.trace [last_n]\n", argv[0]);
+        return 1;
+    }
+    FILE* f = fopen(argv[1], "rb");
+    if (f == nullptr) {
+        perror(argv[1]);
+        return 1;
+    }
+    TraceFileHeader header;
+    if (fread(&header, sizeof(header), 1, f) != 1 ||
+        memcmp(header.magic, "NRVTRACE", 8) != 0) {
+        fprintf(stderr, "%s: not a trace file\n", argv[1]);
+        return 1;
+    }
+    if (header.version != TRACE_VERSION) {
+        fprintf(stderr, "%s: trace version %u, expected %u\n", argv[1], header.version, TRACE_VERSION);
+        return 1;
+    }
+    std::vector<TraceRecord> records(header.count);
+    if (fread(records.data(), sizeof(TraceRecord), header.count, f) != header.count) {
+        fprintf(stderr, "%s: truncated file\n", argv[1]);
+        return 1;
+    }
+    fclose(f);
+
+    size_t first = 0;
+    if (argc > 2) {
+        size_t last_n = size_t(strtoul(argv[2], nullptr, 0));
+        first = (last_n < records.size()) ? records.size() - last_n : 0;
+    }
+
+    printf("# %llu instructions traced, %u in file\n",
+           (unsigned long long)header.total, header.count);
+    printf("#      cycle        pc     instr\n");
+    char text[RISCV_DISASM_MAX];
+    for (size_t i = first; i < records.size(); i++) {
+        const TraceRecord& r = records[i];
+        riscv_disasm(text, r.instr, r.pc);
+        printf("%12u  %08x  %08x  %-28s", r.cycle, r.pc, r.instr, text);
+        if (r.rd != 0) {
+            printf("  x%-2u <- 0x%08x", r.rd, r.value);
+        }
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,143 @@
+/*******************************************************************/
+// Windowed waveform tracing for the simulators.
+/*******************************************************************/
+
+#include "wave_trace.h"
+#include <sstream>
+#include <cstdlib>
+
+static bool parse_number(const std::string& text, uint64_t& value) {
+    char* end = nullptr;
+    value = strtoull(text.c_str(), &end, 0);
+    return !text.empty() && *end == '\0';
+}
+
+bool WaveWindow::parse(const std::string& spec, std::string& error) {
+    std::istringstream in(spec);
+    std::string item;
+    if (!std::getline(in, file, ',') || file.empty() || file.find('=') != std::string::npos) {
+        error = "invalid trace window: " + spec
+              + " (file[,from=N][,pc=ADDR][,cycles=M][,signals=a+b+...])";
+        return false;
+    }
+    while (std::getline(in, item, ',')) {
+        size_t eq = item.find('=');
+        std::string key = item.substr(0, eq);
+        std::string value = (eq == std::string::npos) ? "" : item.substr(eq + 1);
+        uint64_t number = 0;
+        if (key == "signals" && !value.empty()) {
+            std::istringstream names(value);
+            std::string name;
+            while (std::getline(names, name, '+')) {
+                if (!name.empty()) {
+                    signals.push_back(name);
+                }
+            }
+        } else if (!parse_number(value, number)) {
+            error = "invalid trace window argument: " + item;
+            return false;
+        } else if (key == "from") {
+            from_cycle = number;
+        } else if (key == "pc" && number <= 0xFFFFFFFFull) {
+            has_pc = true;
+            start_pc = uint32_t(number);
+        } else if (key == "cycles") {
+            nb_cycles = number;
+        } else {
+            error = "invalid trace window argument: " + item;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool WaveWindow::selected(const std::string& name) const {
+    if (signals.empty()) {
+        return true;
+    }
+    for (const std::string& pattern : signals) {
+        if (!pattern.empty() && pattern.back() == '*') {
+            if (name.compare(0, pattern.size() - 1, pattern, 0, pattern.size() - 1) == 0) {
+                return true;
+            }
+        } else if (name == pattern) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*******************************************************************/
+
+int VCDWriter::add(const std::string& name, int width) {
+    // Identifiers: base 94 numbers written with the printable characters
+    std::string code;
+    size_t n = signals_.size();
+    do {
+        code += char('!' + n % 94);
+        n /= 94;
+    } while (n != 0);
+    Signal s;
+    s.name = name;
+    s.code = code;
+    s.width = width;
+    signals_.push_back(s);
+    return int(signals_.size()) - 1;
+}
+
+bool VCDWriter::open(const std::string& filename, const char* timescale, std::string& error) {
+    file_ = fopen(filename.c_str(), "w");
+    if (file_ == nullptr) {
+        error = filename + ": cannot be written";
+        return false;
+    }
+    fprintf(file_, "$timescale %s $end\n$scope module top $end\n", timescale);
+    for (const Signal& s : signals_) {
+        fprintf(file_, "$var wire %d %s %s $end\n", s.width, s.code.c_str(), s.name.c_str());
+    }
+    fprintf(file_, "$upscope $end\n$enddefinitions $end\n");
+    first_dump_ = true;
+    return true;
+}
+
+void VCDWriter::close() {
+    if (file_ != nullptr) {
+        fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+void VCDWriter::write_value(const Signal& s) {
+    if (s.width == 1) {
+        fprintf(file_, "%c%s\n", (s.value & 1) ? '1' : '0', s.code.c_str());
+        return;
+    }
+    char bits[65];
+    int n = 0;
+    for (int i = s.width - 1; i >= 0; i--) {
+        bits[n++] = ((s.value >> i) & 1) ? '1' : '0';
+    }
+    bits[n] = '\0';
+    fprintf(file_, "b%s %s\n", bits, s.code.c_str());
+}
+
+void VCDWriter::dump(uint64_t time) {
+    if (file_ == nullptr) {
+        return;
+    }
+    fprintf(file_, "#%llu\n", (unsigned long long)time);
+    if (first_dump_) {
+        fprintf(file_, "$dumpvars\n");
+    }
+    for (Signal& s : signals_) {
+        if (first_dump_ || s.value != s.dumped) {
+            write_value(s);
+            s.dumped = s.value;
+        }
+    }
+    if (first_dump_) {
+        fprintf(file_, "$end\n");
+        first_dump_ = false;
+    }
+    ++nb_dumps_;
+}
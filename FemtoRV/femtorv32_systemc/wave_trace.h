@@ -0,0 +1,111 @@
+/*******************************************************************/
+// Windowed waveform tracing for the simulators.
+//
+// A full-run waveform of a long simulation is slow to write and takes
+// gigabytes. A trace window only dumps the cycles around the problem:
+//
+//  file[,from=N][,pc=ADDR][,cycles=M][,signals=a+b+...]
+//
+//  - from=N:     starts at cycle N (default 0);
+//  - pc=ADDR:    starts when the instruction at ADDR executes (after
+//                cycle N if both are given);
+//  - cycles=M:   stops after M cycles (default: until the end);
+//  - signals=:   only the signals whose name matches one of the
+//                patterns ('*' at the end matches any suffix), default
+//                all of them. For the Verilator harness, the patterns
+//                are scopes (VerilatedFstC::dumpvars()).
+//
+// WaveWindow is the trigger, updated once per cycle by the harness.
+// VCDWriter writes the signals sampled by the SystemC harnesses (the
+// files of sc_trace() cannot be started late or stopped), only the
+// values that changed since the last cycle are written.
+//
+// No SystemC dependency: can be used by the Verilator harnesses.
+/*******************************************************************/
+
+#ifndef WAVE_TRACE_H
+#define WAVE_TRACE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class WaveWindow {
+public:
+    std::string file;
+    uint64_t from_cycle = 0;
+    bool has_pc = false;
+    uint32_t start_pc = 0;
+    uint64_t nb_cycles = 0;            // 0: until the end
+    std::vector<std::string> signals;  // empty: all
+
+    // Reads a specification (see above). Returns false and sets
+    // 'error' if it is invalid.
+    bool parse(const std::string& spec, std::string& error);
+
+    // True if the signal is in the subset
+    bool selected(const std::string& name) const;
+
+    // Called once per cycle with the PC of the current instruction,
+    // returns true if the cycle is in the window
+    bool update(uint64_t cycle, uint32_t pc) {
+        if (state_ == WAITING && cycle >= from_cycle && (!has_pc || pc == start_pc)) {
+            state_ = ACTIVE;
+            start_cycle_ = cycle;
+        }
+        if (state_ == ACTIVE && nb_cycles != 0 && cycle - start_cycle_ >= nb_cycles) {
+            state_ = DONE;
+        }
+        return state_ == ACTIVE;
+    }
+
+    bool started() const { return state_ != WAITING; }
+    bool done() const { return state_ == DONE; }
+    uint64_t start_cycle() const { return start_cycle_; }
+
+private:
+    enum State { WAITING, ACTIVE, DONE };
+    State state_ = WAITING;
+    uint64_t start_cycle_ = 0;
+};
+
+class VCDWriter {
+public:
+    ~VCDWriter() { close(); }
+
+    // Signals are declared before open()
+    int add(const std::string& name, int width);
+
+    // Writes the header, 'timescale' is the duration of one time unit
+    // (e.g. "10 ns", one cycle of the harness). Returns false and sets
+    // 'error' if the file cannot be written.
+    bool open(const std::string& filename, const char* timescale, std::string& error);
+    void close();
+    bool is_open() const { return file_ != nullptr; }
+
+    void set(int id, uint64_t value) { signals_[id].value = value; }
+
+    // Writes the values that changed since the last dump
+    void dump(uint64_t time);
+
+    uint64_t nb_dumps() const { return nb_dumps_; }
+
+private:
+    struct Signal {
+        std::string name;
+        std::string code;   // VCD identifier
+        int width;
+        uint64_t value = 0;
+        uint64_t dumped = 0;
+    };
+
+    void write_value(const Signal& s);
+
+    std::vector<Signal> signals_;
+    FILE* file_ = nullptr;
+    bool first_dump_ = true;
+    uint64_t nb_dumps_ = 0;
+};
+
+#endif // WAVE_TRACE_H
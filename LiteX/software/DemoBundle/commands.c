@@ -1,4 +1,5 @@
 #include "command.h"
+#include "demos/demos.h"
 
 #include <lite_elf.h>
 
@@ -7,6 +8,7 @@
 #include <libfatfs/ff.h>
 
 #include <generated/csr.h>
+#include <generated/soc.h>
 
 #include <stdio.h>
 #include <string.h>
@@ -53,6 +55,86 @@ static void esp32(int nb_args, char** args) {
 define_command(esp32, esp32, "turn ESP32 on/off", 0);
 #endif
 
+#ifdef CSR_TIMER0_BASE
+
+#define BENCH_FRAMES 16
+
+typedef struct {
+   const char* name;
+   int  (*init)(void);  // returns the number of steps of a frame
+   void (*step)(int i);
+   int  nb_frames;
+} DemoBench;
+
+static DemoBench demo_benchs[] = {
+   { "mandelbrot",      mandelbrot_bench_init,      mandelbrot_bench_step,      BENCH_FRAMES },
+#ifdef CSR_OLED_SPI_BASE
+   { "oled_julia",      oled_julia_bench_init,      oled_julia_bench_step,      BENCH_FRAMES },
+   { "oled_riscv_logo", oled_riscv_logo_bench_init, oled_riscv_logo_bench_step, BENCH_FRAMES },
+#endif
+   { "pi",              pi_bench_init,              pi_bench_step,              BENCH_FRAMES },
+   { "raystones",       tinyraytracer_bench_init,   tinyraytracer_bench_step,   1 },
+};
+
+#define NB_DEMO_BENCHS (sizeof(demo_benchs)/sizeof(demo_benchs[0]))
+
+// Runs the frames of a demo and prints one line with the result.
+// timer0 is restarted for each step, so that it does not wrap.
+static void run_demo_bench(DemoBench* bench) {
+   uint64_t ticks = 0;
+   int nb_steps = bench->init();
+   int nb_frames = bench->nb_frames;
+   for(int i=0; i<nb_frames * nb_steps; ++i) {
+      timer0_en_write(0);
+      timer0_reload_write(0);
+      timer0_load_write(0xffffffff);
+      timer0_en_write(1);
+      timer0_update_value_write(1);
+      uint32_t start = timer0_value_read();
+      bench->step(i);
+      timer0_update_value_write(1);
+      ticks += start - timer0_value_read();
+   }
+   // printf() does not do 64 bits nor floats.
+   uint64_t frame_ticks = ticks / nb_frames;
+   uint32_t centi_fps = frame_ticks ?
+      (uint32_t)((uint64_t)CONFIG_CLOCK_FREQUENCY * 100 / frame_ticks) : 0;
+   uint32_t frame_ticks_hi = (uint32_t)(frame_ticks / 1000000000);
+   uint32_t frame_ticks_lo = (uint32_t)(frame_ticks % 1000000000);
+   printf("bench %s: %d frames, ", bench->name, nb_frames);
+   if(frame_ticks_hi) {
+      printf("%lu%09lu", (unsigned long)frame_ticks_hi, (unsigned long)frame_ticks_lo);
+   } else {
+      printf("%lu", (unsigned long)frame_ticks_lo);
+   }
+   printf(" cycles/frame, %lu.%02lu fps\n",
+	  (unsigned long)(centi_fps / 100), (unsigned long)(centi_fps % 100));
+}
+
+static void bench(int nb_args, char** args) {
+   if (nb_args < 1) {
+      printf("bench <demo>|all, with <demo> one of:");
+      for(int i=0; i<NB_DEMO_BENCHS; ++i) {
+	 printf(" %s", demo_benchs[i].name);
+      }
+      printf("\n");
+      return;
+   }
+   int all = !strcmp(args[0],"all");
+   int found = 0;
+   for(int i=0; i<NB_DEMO_BENCHS; ++i) {
+      if(all || !strcmp(args[0],demo_benchs[i].name)) {
+	 run_demo_bench(&demo_benchs[i]);
+	 found = 1;
+      }
+   }
+   if(!found) {
+      printf("bench: no demo %s\n", args[0]);
+   }
+}
+define_command(bench, bench, "frames per second of the demos (bench <demo>|all)", 0);
+#endif
+
 
 #if defined(CSR_SPISDCARD_BASE) || defined(CSR_SDCORE_BASE)
 static void catalog(int nb_args, char** args) {
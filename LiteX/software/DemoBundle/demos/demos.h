@@ -6,5 +6,22 @@
 
 #define define_demo(demo,description) define_command(demo,demo,description,1)
 
+/*
+ * Benchmark entry points of the demos, used by the bench command
+ * (commands.c). xxx_bench_init() prepares the demo and returns the number
+ * of steps of a frame, xxx_bench_step(i) computes the i-th step (counted
+ * from the first frame), without waiting for a key and without printing.
+ */
+int  mandelbrot_bench_init(void);
+void mandelbrot_bench_step(int i);
+int  oled_julia_bench_init(void);
+void oled_julia_bench_step(int i);
+int  oled_riscv_logo_bench_init(void);
+void oled_riscv_logo_bench_step(int i);
+int  pi_bench_init(void);
+void pi_bench_step(int i);
+int  tinyraytracer_bench_init(void);
+void tinyraytracer_bench_step(int i);
+
 #endif
 
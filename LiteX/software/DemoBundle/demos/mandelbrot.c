@@ -16,8 +16,8 @@
 #define dy (ymax-ymin)/OLED_HEIGHT
 #define norm_max (4 << mandel_shift)
 
-static void mandelbrot(int nb_args, char** args) {
-   oled_init();
+// Draws the set on the OLED screen, and in the terminal if tty is set.
+static void mandelbrot_draw(int tty) {
    oled_write_window(0,0,OLED_WIDTH-1,OLED_HEIGHT-1);
    int Ci = ymin;
    for(int Y=0; Y<OLED_HEIGHT; ++Y) {
@@ -38,14 +38,33 @@ static void mandelbrot(int nb_args, char** args) {
 	    --iter;
 	 }
 	 oled_data_uint16((iter << 19)|(iter << 2));
-	 printf("\033[48;2;0;0;%dm ",iter << 4);
+	 if(tty) {
+	    printf("\033[48;2;0;0;%dm ",iter << 4);
+	 }
 	 Cr += dx;
       }
-      puts("\033[48;2;0;0;0m");      
+      if(tty) {
+	 puts("\033[48;2;0;0;0m");      
+      }
       Ci += dy;
    }
 }
 
+static void mandelbrot(int nb_args, char** args) {
+   oled_init();
+   mandelbrot_draw(1);
+}
+
+// One step is one frame (on the OLED screen only).
+int mandelbrot_bench_init(void) {
+   oled_init();
+   return 1;
+}
+
+void mandelbrot_bench_step(int i) {
+   mandelbrot_draw(0);
+}
+
 define_demo(mandelbrot, "Draws Mandelbrot set");
 
 
@@ -46,8 +46,6 @@ unsigned short sq[] = {
  115,112,110,107,105,102,100,97,95,92,90,87,85,83,81,78,76,74,72,70,68,66,64,62,60,58,56,54,52,50,49,47,45,43,42,40,39,37,36,34,33,31,30,28,27,26,25,23,
  22,21,20,19,18,17,16,15,14,13,12,11,10,9,9,8,7,6,6,5,5,4,4,3,3,2,2,1,1,1,1,0,0,0,0,0,0,0,0};
 
-static void oled_julia(int nb_args, char** args) {
-   
 #define MASK   ((1<<(IP+1))-1)
 #define CLAMP  ((1<<(IP-1))-1)
 #define NEG    ((1<<(IP+1))  )
@@ -57,13 +55,16 @@ static void oled_julia(int nb_args, char** args) {
 #define YCmin  10
 #define YCmax  (YCmin+40)
 
-  int x_c = (XCmin+XCmax)>>1; int x_c_i = 1;
-  int y_c = (YCmin+YCmax)>>1; int y_c_i = 3;
+static int x_c, x_c_i;
+static int y_c, y_c_i;
 
-  oled_init();
-  puts("Press any key to exit");
-   
-  while (1) {
+static void julia_start(void) {
+  x_c = (XCmin+XCmax)>>1; x_c_i = 1;
+  y_c = (YCmin+YCmax)>>1; y_c_i = 3;
+}
+
+// Draws a frame and moves the constant for the next one.
+static void julia_frame(void) {
     oled_write_window(0,0,OLED_WIDTH-1,OLED_HEIGHT-1);
     int j_f = -OLED_HEIGHT/2;
     int pix = 0;
@@ -99,7 +100,15 @@ static void oled_julia(int nb_args, char** args) {
     if (x_c < XCmin || x_c > XCmax) { x_c_i = - x_c_i; }
     y_c += y_c_i;
     if (y_c < YCmin || y_c > YCmax) { y_c_i = - y_c_i; }
-     
+}
+
+static void oled_julia(int nb_args, char** args) {
+  julia_start();
+  oled_init();
+  puts("Press any key to exit");
+   
+  while (1) {
+    julia_frame();
     if (readchar_nonblock()) {
       getchar();
       break;
@@ -108,6 +117,17 @@ static void oled_julia(int nb_args, char** args) {
   oled_off();
 }
 
+// One step is one frame.
+int oled_julia_bench_init(void) {
+  julia_start();
+  oled_init();
+  return 1;
+}
+
+void oled_julia_bench_step(int i) {
+  julia_frame();
+}
+
 #ifdef CSR_OLED_SPI_BASE
 define_demo(oled_julia, "Animated Juia set on OLED screen (by Sylvain Lefebvre)");
 #endif
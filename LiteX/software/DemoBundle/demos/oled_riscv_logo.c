@@ -66,11 +66,7 @@ int sintab[64] = {
 };
 
 
-static void oled_riscv_logo(int nb_args, char** args) {
-    oled_init();
-    puts("Press any key to exit");
-    int frame = 0;
-    for(;;) {
+static void riscv_logo_frame(int frame) {
 	oled_write_window(0,0,OLED_WIDTH-1,OLED_HEIGHT-1);
        
         int scaling = sintab[frame&63]+400;
@@ -94,6 +90,14 @@ static void oled_riscv_logo(int nb_args, char** args) {
 	    X0 += Vx;
 	    Y0 += Vy;
 	}
+}
+
+static void oled_riscv_logo(int nb_args, char** args) {
+    oled_init();
+    puts("Press any key to exit");
+    int frame = 0;
+    for(;;) {
+       riscv_logo_frame(frame);
        if (readchar_nonblock()) {
 	  getchar();
 	  break;
@@ -103,6 +107,16 @@ static void oled_riscv_logo(int nb_args, char** args) {
     oled_off();
 }
 
+// One step is one frame.
+int oled_riscv_logo_bench_init(void) {
+    oled_init();
+    return 1;
+}
+
+void oled_riscv_logo_bench_step(int i) {
+    riscv_logo_frame(i);
+}
+
 #ifdef CSR_OLED_SPI_BASE
 define_demo(oled_riscv_logo, "Animated RISC-V logo on OLED screen");
 #endif
@@ -191,3 +191,13 @@ static void pi(int nb_args, char** args) {
 
 define_demo(pi,"compute PI decimals (by Fabrice Beillard)");
 
+// One step (and one frame) is 9 decimals, the same ones as the demo.
+int pi_bench_init(void) {
+    return 1;
+}
+
+void pi_bench_step(int i) {
+    volatile int d = digits(1 + 9*i);
+    (void)d;
+}
+
@@ -430,20 +430,24 @@ static vec3 cast_ray(
 }
 
 
-static void render(Sphere* spheres, int nb_spheres, Light* lights, int nb_lights) {
+static void render_pixel(int i, int j, Sphere* spheres, int nb_spheres, Light* lights, int nb_lights) {
    const float fov  = M_PI/3.;
+   float dir_x =  (i + 0.5) - graphics_width/2.;
+   float dir_y = -(j + 0.5) + graphics_height/2.; // this flips the image.
+   float dir_z = -graphics_height/(2.*tan(fov/2.));
+   vec3 C = cast_ray(
+      make_vec3(0,0,0), vec3_normalize(make_vec3(dir_x, dir_y, dir_z)),
+      spheres, nb_spheres, lights, nb_lights, 0
+   );
+   graphics_set_pixel(i,j,C.x,C.y,C.z);
+}
+
+static void render(Sphere* spheres, int nb_spheres, Light* lights, int nb_lights) {
    stats_begin_frame();
    for (int j = 0; j<graphics_height; j++) { // actual rendering loop
       for (int i = 0; i<graphics_width; i++) {
 	stats_begin_pixel();
-	float dir_x =  (i + 0.5) - graphics_width/2.;
-	float dir_y = -(j + 0.5) + graphics_height/2.; // this flips the image.
-	float dir_z = -graphics_height/(2.*tan(fov/2.));
-	vec3 C = cast_ray(
-	   make_vec3(0,0,0), vec3_normalize(make_vec3(dir_x, dir_y, dir_z)),
-	   spheres, nb_spheres, lights, nb_lights, 0
-	);
-	graphics_set_pixel(i,j,C.x,C.y,C.z);
+	render_pixel(i, j, spheres, nb_spheres, lights, nb_lights);
 	stats_end_pixel();
       }
       flush_l2_cache(); // needed for femtorv32 + LiteX (L2 cache -> framebuffer transfer)
@@ -506,5 +510,22 @@ static void raystones(int nb_args, char** args) {
 }
 define_demo(raystones, "raystones (uses tinyraytracer by Dmitry Sokolov)");
 
+// Same image as raystones, one step is one row (a frame may take longer
+// than the 32 bits of timer0 on the slow cores).
+int tinyraytracer_bench_init(void) {
+   benchmark = 1;
+   init_scene();
+   graphics_init();
+   return graphics_height;
+}
+
+void tinyraytracer_bench_step(int i) {
+   int j = i % graphics_height;
+   for (int x = 0; x<graphics_width; x++) {
+      render_pixel(x, j, spheres, nb_spheres, lights, nb_lights);
+   }
+   flush_l2_cache();
+}
+
 
 
@@ -0,0 +1,21 @@
+/*
+ * Host replacement of lite_heap.h (see mc1-doom/src/CMakeLists.txt):
+ * the zone is allocated with malloc().
+ */
+
+#ifndef LITE_HEAP
+#define LITE_HEAP
+
+#include <stdlib.h>
+
+static inline void* lite_heap_reserve(size_t* size, size_t keep)
+{
+    (void)keep;
+    return malloc(*size);
+}
+
+static inline void lite_heap_print_stats(void)
+{
+}
+
+#endif
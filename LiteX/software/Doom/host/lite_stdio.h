@@ -0,0 +1,25 @@
+/*
+ * Host replacement of lite_stdio.h (see mc1-doom/src/CMakeLists.txt):
+ * LX_STDIO_OVERRIDE has no effect, the files are opened directly.
+ */
+
+#ifndef LITE_STDIO
+#define LITE_STDIO
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+// doomstat.h defines FILE as int when it is not a macro.
+#define FILE FILE
+
+#endif
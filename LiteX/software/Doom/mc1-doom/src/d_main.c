@@ -49,6 +49,7 @@
 #include "m_argv.h"
 #include "m_menu.h"
 #include "m_misc.h"
+#include "m_profile.h"
 
 #include "i_system.h"
 #include "i_sound.h"
@@ -87,6 +88,7 @@ boolean         fastparm;       // checkparm of -fast
 boolean         drone;
 
 boolean         singletics = true; // debug flag to cancel adaptiveness
+int             displayframes;     // frames sent to the screen, for -timedemo
 
 //extern int soundVolume;
 //extern  int   sfxVolume;
@@ -295,7 +297,12 @@ void D_Display (void)
     // normal update
     if (!wipe)
     {
-        I_FinishUpdate ();              // page flip or blit buffer
+        M_ProfileBegin (prof_blit);
+        if (!noblit)
+            I_FinishUpdate ();          // page flip or blit buffer
+        M_ProfileEnd (prof_blit);
+        M_ProfileFrame ();
+        displayframes++;
         return;
     }
 
@@ -317,6 +324,7 @@ void D_Display (void)
         I_UpdateNoBlit ();
         M_Drawer ();                            // menu is drawn even on top of wipes
         I_FinishUpdate ();                      // page flip or blit buffer
+        displayframes++;
     } while (!done);
 }
 
@@ -763,6 +771,10 @@ void D_DoomMain (void)
     respawnparm = M_CheckParm ("-respawn");
     fastparm = M_CheckParm ("-fast");
     devparm = M_CheckParm ("-devparm");
+    M_ProfileInit ();
+#ifdef M_FIXED_BENCH
+    M_FixedBench ();
+#endif
     if (M_CheckParm ("-altdeath"))
         deathmatch = 2;
     else if (M_CheckParm ("-deathmatch"))
@@ -28,6 +28,9 @@ extern char*            wadfiles[MAXWADFILES];
 
 void D_AddFile (const char *file);
 
+// Number of frames sent to the screen so far.
+extern int              displayframes;
+
 //
 // D_DoomMain()
 // Not a globally visible function, just included for source reference,
@@ -34,6 +34,24 @@
 #define NO_SANITIZE_UNDEFINED
 #endif
 
+// Hot lookup tables that go to the on-chip RAM of the target, when it
+// has one (FASTDATA_TABLES, see the .fastdata.tables section in
+// LiteX/software/Doom/linker.ld).
+#ifdef FASTDATA_TABLES
+#define FASTDATA __attribute__ ((section (".fastdata.tables")))
+#else
+#define FASTDATA
+#endif
+
+// Copy of the flat being drawn by R_DrawPlanes (4 KB), in the on-chip
+// RAM when FASTDATA_FLAT is defined. It only fits if some of the
+// FASTDATA tables are moved back to main RAM.
+#ifdef FASTDATA_FLAT
+#define FASTFLAT __attribute__ ((section (".fastdata.flat")))
+#else
+#define FASTFLAT
+#endif
+
 //
 // Global parameters/defines.
 //
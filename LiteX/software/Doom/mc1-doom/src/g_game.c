@@ -30,6 +30,7 @@
 #include "m_misc.h"
 #include "m_menu.h"
 #include "m_random.h"
+#include "m_profile.h"
 #include "i_system.h"
 
 #include "p_setup.h"
@@ -98,6 +99,9 @@ boolean         timingdemo;             // if true, exit with report on completi
 boolean         nodrawers;              // for comparative timing purposes
 boolean         noblit;                 // for comparative timing purposes
 int             starttime;              // for comparative timing purposes
+static unsigned long long startcycles;  // for -timedemo
+static int      startframes;            // for -timedemo
+static int      starttic;               // for -timedemo
 
 boolean         viewactive;
 
@@ -467,6 +471,10 @@ void G_DoLoadLevel (void)
     P_SetupLevel (gameepisode, gamemap, 0, gameskill);
     displayplayer = consoleplayer;              // view the guy you are playing
     starttime = I_GetTime ();
+    startcycles = M_ProfileCycles64 ();
+    startframes = displayframes;
+    starttic = gametic;
+    M_ProfileResetTotals ();
     gameaction = ga_nothing;
     Z_CheckHeap ();
 
@@ -588,6 +596,8 @@ void G_Ticker (void)
     int         buf;
     ticcmd_t*   cmd;
 
+    M_ProfileBegin (prof_ticker);
+
     // do player reborns if needed
     for (i=0 ; i<MAXPLAYERS ; i++)
         if (playeringame[i] && players[i].playerstate == PST_REBORN)
@@ -725,6 +735,8 @@ void G_Ticker (void)
         D_PageTicker ();
         break;
     }
+
+    M_ProfileEnd (prof_ticker);
 }
 
 //
@@ -1599,9 +1611,20 @@ boolean G_CheckDemoStatus (void)
 
     if (timingdemo)
     {
+        unsigned long long cycles = M_ProfileCycles64 () - startcycles;
+        int frames = displayframes - startframes;
+        int fps10;
+
         endtime = I_GetTime ();
-        I_Error ("timed %i gametics in %i realtics",gametic
-                 , endtime-starttime);
+        fps10 = cycles ? (int)(10ULL * frames * M_ProfileFrequency () / cycles) : 0;
+        printf ("timed %i gametics in %i realtics\n", gametic-starttic,
+                endtime-starttime);
+        printf ("%i frames, %u kcycles, %u kcycles/frame, %i.%i fps\n",
+                frames, (unsigned)(cycles / 1000),
+                frames ? (unsigned)(cycles / 1000 / frames) : 0,
+                fps10 / 10, fps10 % 10);
+        M_ProfileReport ();
+        I_Quit ();
     }
 
     if (demoplayback)
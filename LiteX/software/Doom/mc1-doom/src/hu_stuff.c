@@ -18,12 +18,14 @@
 //-----------------------------------------------------------------------------
 
 #include <ctype.h>
+#include <stdio.h>
 
 #include "doomdef.h"
 
 #include "z_zone.h"
 
 #include "m_swap.h"
+#include "m_profile.h"
 
 #include "hu_stuff.h"
 #include "hu_lib.h"
@@ -54,6 +56,9 @@
 #define HU_INPUTWIDTH   64
 #define HU_INPUTHEIGHT  1
 
+#define HU_PROFX        0
+#define HU_PROFY        (HU_INPUTY + 2*(SHORT(hu_font[0]->height) +1))
+
 char*   chat_macros[] =
 {
     HUSTR_CHATMACRO0,
@@ -91,6 +96,7 @@ boolean                 message_dontfuckwithme;
 static boolean          message_nottobefuckedwith;
 
 static hu_stext_t       w_message;
+static hu_textline_t    w_profile[NUMPROFPHASES];
 static int              message_counter;
 
 extern int              showMessages;
@@ -467,10 +473,41 @@ void HU_Start(void)
     for (i=0 ; i<MAXPLAYERS ; i++)
         HUlib_initIText(&w_inputbuffer[i], 0, 0, 0, 0, &always_off);
 
+    // create the profiler widgets, one line per phase
+    for (i=0 ; i<NUMPROFPHASES ; i++)
+        HUlib_initTextLine(&w_profile[i],
+                           HU_PROFX,
+                           HU_PROFY + i*(SHORT(hu_font[0]->height) +1),
+                           hu_font,
+                           HU_FONTSTART);
+
     headsupactive = true;
 
 }
 
+//
+// HU_DrawProfile
+// Kilocycles per frame of each phase, and percentage of the frame.
+//
+static void HU_DrawProfile(void)
+{
+    int         i;
+    char        buffer[32];
+    char*       s;
+    unsigned    frame = profileaverage[prof_frame];
+
+    for (i=0 ; i<NUMPROFPHASES ; i++)
+    {
+        sprintf(buffer, "%-7s %6uK %3u%%", profilenames[i],
+                profileaverage[i] / 1000,
+                frame >= 100 ? profileaverage[i] / (frame / 100) : 0);
+        HUlib_clearTextLine(&w_profile[i]);
+        for (s = buffer ; *s ; s++)
+            HUlib_addCharToTextLine(&w_profile[i], *s);
+        HUlib_drawTextLine(&w_profile[i], false);
+    }
+}
+
 void HU_Drawer(void)
 {
 
@@ -478,6 +515,8 @@ void HU_Drawer(void)
     HUlib_drawIText(&w_chat);
     if (automapactive)
         HUlib_drawTextLine(&w_title, false);
+    if (profileactive)
+        HU_DrawProfile();
 
 }
 
@@ -487,6 +526,12 @@ void HU_Erase(void)
     HUlib_eraseSText(&w_message);
     HUlib_eraseIText(&w_chat);
     HUlib_eraseTextLine(&w_title);
+    if (profileactive)
+    {
+        int i;
+        for (i=0 ; i<NUMPROFPHASES ; i++)
+            HUlib_eraseTextLine(&w_profile[i]);
+    }
 
 }
 
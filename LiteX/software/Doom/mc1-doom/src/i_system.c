@@ -21,6 +21,7 @@
 #include <lite_stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <lite_heap.h>
 
 #include <stdarg.h>
 // #include <sys/time.h>
@@ -33,6 +34,7 @@
 
 #include "d_net.h"
 #include "g_game.h"
+#include "r_plane.h"
 
 #include "i_system.h"
 
@@ -61,10 +63,20 @@ int  I_GetHeapSize (void)
     return mb_used*1024*1024;
 }
 
+// The zone is taken directly from the heap (lite_heap.h), smaller than
+// mb_used MB if the heap does not have them, and the remaining memory
+// stays for malloc().
+#define ZONE_KEEP_FOR_MALLOC (1024*1024)
+
 byte* I_ZoneBase (int*  size)
 {
-    *size = mb_used*1024*1024;
-    return (byte *) malloc (*size);
+    size_t zone_size = mb_used*1024*1024;
+    byte* zone = (byte *) lite_heap_reserve (&zone_size, ZONE_KEEP_FOR_MALLOC);
+    if (zone != NULL && zone_size < mb_used*1024*1024)
+        printf ("I_ZoneBase: zone reduced to %d KB\n", (int)(zone_size/1024));
+    lite_heap_print_stats ();
+    *size = zone_size;
+    return zone;
 }
 
 //
@@ -98,6 +110,7 @@ void I_Init (void)
 //
 void I_Quit (void)
 {
+    R_ReportPools ();
     D_QuitNetGame ();
     I_ShutdownSound();
     I_ShutdownMusic();
@@ -36,6 +36,11 @@ void I_SetPalette (byte* palette);
 
 void I_UpdateNoBlit (void); 
 
+// Called often while the next frame is computed (for each
+// column and span drawn), by drivers that send the previous
+// frame to the display in the background. Can be empty.
+void I_PollUpdate (void);
+
 void I_FinishUpdate (void) __attribute((section(".fastcode")));
 
 // Wait for vertical retrace or pause a bit.
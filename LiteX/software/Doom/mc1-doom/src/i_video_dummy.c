@@ -16,18 +16,32 @@
 //
 // DESCRIPTION:
 //      Dummy system interface for video.
+//      With -framehash, prints a hash of each frame (and of all of
+//      them at the end), to check that the renderer is pixel-exact.
 //
 //-----------------------------------------------------------------------------
 
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "doomdef.h"
+#include "m_argv.h"
 #include "i_system.h"
 #include "i_video.h"
 #include "v_video.h"
 
+#define FNV_BASIS   2166136261u
+#define FNV_PRIME   16777619u
+
+static boolean  framehash;
+static int      framecount;
+static unsigned framehashall = FNV_BASIS;
+
 void I_InitGraphics (void)
 {
+    framehash = M_CheckParm ("-framehash") != 0;
+
     // Allocate regular memory for the Doom screen.
     screens[0] = (unsigned char*)malloc (SCREENWIDTH * SCREENHEIGHT);
     if (screens[0] == NULL)
@@ -36,6 +50,8 @@ void I_InitGraphics (void)
 
 void I_ShutdownGraphics (void)
 {
+    if (framehash)
+        printf ("I_FrameHash: %i frames, %08x\n", framecount, framehashall);
     free (screens[0]);
 }
 
@@ -58,8 +74,25 @@ void I_UpdateNoBlit (void)
 {
 }
 
+void I_PollUpdate (void)
+{
+}
+
 void I_FinishUpdate (void)
 {
+    const byte* pixel = screens[0];
+    unsigned    hash = FNV_BASIS;
+    int         i;
+
+    if (!framehash)
+        return;
+
+    // FNV-1a
+    for (i=0 ; i<SCREENWIDTH*SCREENHEIGHT ; i++)
+        hash = (hash ^ pixel[i]) * FNV_PRIME;
+    printf ("I_FrameHash: %i %08x\n", framecount, hash);
+    framehashall = (framehashall ^ hash) * FNV_PRIME;
+    framecount++;
 }
 
 void I_WaitVBL (int count)
@@ -17,6 +17,7 @@
 
 
 static uint32_t s_palette[256] __attribute((section(".fastdata")));
+static int s_double = 0;
 
 static inline uint32_t color_to_argb8888 (
    unsigned int r,
@@ -35,7 +36,11 @@ void I_InitGraphics (void) {
    initialized = 1;
    
    fb_init();
-   fb_set_dual_buffering(1);
+   fb_set_triple_buffering(1);
+
+   // -2x: 640x400 display (if the screen is small enough).
+   s_double = M_CheckParm ("-2x") &&
+              2*SCREENWIDTH <= FB_WIDTH && 2*SCREENHEIGHT <= FB_HEIGHT;
 }
 
 void I_ShutdownGraphics (void) {
@@ -58,41 +63,62 @@ void I_UpdateNoBlit (void) {
     // what is this?
 }
 
-void I_FinishUpdate (void) {
-    // Copy the internal screen to the framebuffer,
-    // 8-bit indexed pixels to 32-bit ARGB.
-
-    // "no conversion" blitting, for testing speed
-    /*
-    const uint32_t* src = (const uint32_t*)screens[0];
-    uint32_t* row_dst = fb_base;
-    for (int y = 0; y < SCREENHEIGHT; ++y)     {
-	uint32_t* dst = row_dst;
-        for (int x = 0; x < SCREENWIDTH/4; ++x) {
-	    *dst++ =*src++;
-	}
-	row_dst += FB_WIDTH;
-    }
-    */
+void I_PollUpdate (void) {
+}
 
+// Copy the internal screen to the framebuffer,
+// 8-bit indexed pixels to 32-bit ARGB. The source
+// pixels are read 4 at a time (one word, little endian).
 
-    const unsigned char* row_src = (const unsigned char*)screens[0];
-    const unsigned char* row_src_end = row_src + SCREENWIDTH;
-   
+// 1:1, centered.
+static void I_Blit1x (void) {
+    const uint32_t* src = (const uint32_t*)screens[0];
     uint32_t* row_dst = fb_base + (FB_WIDTH-SCREENWIDTH)/2 +
                                   (FB_HEIGHT-SCREENHEIGHT)*FB_WIDTH/2;    
-   
     for (int y = 0; y < SCREENHEIGHT; ++y) {
        uint32_t* dst = row_dst;
-       for(const unsigned char* src = row_src; src < row_src_end; src++,dst++) {
-	  *dst = s_palette[*src];
+       for (int x = 0; x < SCREENWIDTH/4; ++x) {
+	  uint32_t pixels = *src++;
+	  dst[0] = s_palette[pixels & 255];
+	  dst[1] = s_palette[(pixels >> 8) & 255];
+	  dst[2] = s_palette[(pixels >> 16) & 255];
+	  dst[3] = s_palette[pixels >> 24];
+	  dst += 4;
        }
-       row_src = row_src_end;
-       row_src_end += SCREENWIDTH;
        row_dst += FB_WIDTH;
     }
-   
-   
+}
+
+// Each pixel becomes 2x2 pixels, centered. Both rows are 
+// written in the same pass (no read back from SDRAM).
+static void I_Blit2x (void) {
+    const uint32_t* src = (const uint32_t*)screens[0];
+    uint32_t* row_dst = fb_base + (FB_WIDTH-2*SCREENWIDTH)/2 +
+                                  (FB_HEIGHT-2*SCREENHEIGHT)*FB_WIDTH/2;    
+    for (int y = 0; y < SCREENHEIGHT; ++y) {
+       uint32_t* dst = row_dst;
+       for (int x = 0; x < SCREENWIDTH/4; ++x) {
+	  uint32_t pixels = *src++;
+	  for (int i = 0; i < 4; ++i) {
+	     uint32_t c = s_palette[pixels & 255];
+	     dst[0] = c;
+	     dst[1] = c;
+	     dst[FB_WIDTH] = c;
+	     dst[FB_WIDTH+1] = c;
+	     dst += 2;
+	     pixels >>= 8;
+	  }
+       }
+       row_dst += 2*FB_WIDTH;
+    }
+}
+
+void I_FinishUpdate (void) {
+    if (s_double) {
+       I_Blit2x();
+    } else {
+       I_Blit1x();
+    }
     fb_swap_buffers();
 }
 
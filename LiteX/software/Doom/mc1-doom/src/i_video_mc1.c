@@ -345,6 +345,10 @@ void I_UpdateNoBlit (void)
 {
 }
 
+void I_PollUpdate (void)
+{
+}
+
 void I_FinishUpdate (void)
 {
     memcpy (s_framebuffer, screens[0], SCREENWIDTH * SCREENHEIGHT);
@@ -19,13 +19,17 @@
 //
 //-----------------------------------------------------------------------------
 
-#include <ncurses.h>
 #include <stdlib.h>
 
 #include "i_video.h"
+#include "m_argv.h"
 #include "v_video.h"
 #include "doomdef.h"
 
+// After the Doom headers: <ncurses.h> brings stdbool.h, whose
+// false and true would clash with the boolean enum of doomtype.h.
+#include <ncurses.h>
+
 static const char COL_TO_CHAR[] = " .-~=+cuoaqO0X8@#";
 #define NUM_CHAR_LEVELS ((sizeof (COL_TO_CHAR) / sizeof (COL_TO_CHAR[0])) - 1)
 
@@ -34,6 +38,34 @@ static int num_colors;
 static byte palette_lut[256];
 static byte short_palette[257 * 3];  // Actually (num_colors+1) * 3 entries.
 
+// What the terminal shows: one entry per cell, the character (or the
+// palette index in color mode). Only the cells that differ are sent,
+// which matters when the terminal is at the other end of a serial line.
+#define CELL_UNKNOWN 0xffff
+static unsigned short* shadow_cells;
+static int shadow_width;
+static int shadow_height;
+
+// In color mode, a cell keeps its color when the new one is that close
+// (squared RGB distance): fewer cells and color changes to send.
+#define CELL_TOLERANCE (3 * 12 * 12)
+
+// -cells <n>: at most n cells sent per frame (0: no limit). The
+// next frame starts with the row where the budget ran out.
+static int cell_budget;
+static int cell_next_row;
+
+// The frame is sent as ANSI/xterm sequences written by us (ncurses only
+// sets the terminal modes and the palette): the background color is
+// only set when it changes, and the cursor only moved between runs of
+// changed cells, short gaps of the current color being written over.
+#define GAP_OVERWRITE 4
+static char* term_buf;
+static int term_len;
+static int term_x;
+static int term_y;
+static int term_color;
+
 static int sqr_diff (int a, int b)
 {
     int diff = a - b;
@@ -47,14 +79,23 @@ static int color_diff (int r1, int g1, int b1, int r2, int g2, int b2)
 
 void I_InitGraphics (void)
 {
+    int p;
+
     // Allocate memory for the framebuffer.
     screens[0] = (byte*)malloc (SCREENWIDTH * SCREENHEIGHT);
 
+    p = M_CheckParm ("-cells");
+    if (p && p < myargc-1)
+        cell_budget = atoi (myargv[p+1]);
+
     initscr ();
     cbreak ();
     noecho ();
     intrflush (stdscr, FALSE);
     keypad (stdscr, TRUE);
+    leaveok (stdscr, TRUE);
+    curs_set (0);
+    refresh ();
 
     // Detect color capabilities.
     do_color = false;
@@ -68,12 +109,6 @@ void I_InitGraphics (void)
 
         if (num_colors > 100 && can_change_color () == TRUE)
         {
-            for (int i = 0; i < num_colors; ++i)
-            {
-                // Generate a curses pair.
-                init_pair (i + 1, i, i);
-            }
-
             // Let the short palette wrap by appending the first element last.
             short_palette[num_colors * 3 + 0] = short_palette[0];
             short_palette[num_colors * 3 + 1] = short_palette[1];
@@ -96,6 +131,8 @@ void I_InitGraphics (void)
 void I_ShutdownGraphics (void)
 {
     endwin ();
+    free (shadow_cells);
+    free (term_buf);
     free (screens[0]);
 }
 
@@ -143,9 +180,9 @@ void I_SetPalette (byte* palette)
             b = 0;
             for (j = pal_idx; j < next_pal_idx; ++j)
             {
-                r += (int)*palette++;
-                g += (int)*palette++;
-                b += (int)*palette++;
+                r += (int)palette[j * 3 + 0];
+                g += (int)palette[j * 3 + 1];
+                b += (int)palette[j * 3 + 2];
             }
             col_div = next_pal_idx - pal_idx;
             r = (r + (col_div >> 1)) / col_div;
@@ -164,6 +201,9 @@ void I_SetPalette (byte* palette)
             init_color ((short)i, rs, gs, bs);
         }
 
+        // Send the colors before the next frame (see I_FinishUpdate).
+        refresh ();
+
         // Define the optimal palette -> short_palette LUT.
         for (i = 0; i < 256; ++i)
         {
@@ -215,10 +255,89 @@ void I_UpdateNoBlit (void)
 {
 }
 
+void I_PollUpdate (void)
+{
+}
+
+static boolean I_SameCell (unsigned short shown, unsigned short cell)
+{
+    const byte* c1;
+    const byte* c2;
+
+    if (shown == cell)
+        return true;
+    if (!do_color || shown == CELL_UNKNOWN)
+        return false;
+
+    c1 = &short_palette[shown * 3];
+    c2 = &short_palette[cell * 3];
+    return color_diff (c1[0], c1[1], c1[2], c2[0], c2[1], c2[2]) < CELL_TOLERANCE;
+}
+
+static void I_TermPrint (const char* fmt, int a, int b)
+{
+    term_len += sprintf (&term_buf[term_len], fmt, a, b);
+}
+
+static void I_TermFlush (void)
+{
+    fwrite (term_buf, 1, term_len, stdout);
+    fflush (stdout);
+    term_len = 0;
+}
+
+// Sends one cell, the cursor is left after it.
+static void I_TermCell (int x, int y, const unsigned short* cells, unsigned short cell)
+{
+    int gap = x - term_x;
+
+    if (y != term_y || gap < 0)
+        I_TermPrint ("\033[%d;%dH", y + 1, x + 1);
+    else if (gap > 0)
+    {
+        // Overwrite a short gap if it has the current color, it is
+        // shorter than a cursor move.
+        boolean same = do_color && gap <= GAP_OVERWRITE;
+        int i;
+
+        for (i = term_x; same && i < x; ++i)
+            same = cells[i] == term_color;
+        if (same)
+        {
+            for (i = term_x; i < x; ++i)
+                term_buf[term_len++] = ' ';
+        }
+        else
+            I_TermPrint ("\033[%dC", gap, 0);
+    }
+
+    if (do_color)
+    {
+        if (cell != term_color)
+        {
+            I_TermPrint ("\033[48;5;%dm", cell, 0);
+            term_color = cell;
+        }
+        term_buf[term_len++] = ' ';
+    }
+    else
+        term_buf[term_len++] = (char)cell;
+
+    // After the last column, the cursor position depends on the terminal.
+    term_x = x + 1 < shadow_width ? x + 1 : -1;
+    term_y = term_x < 0 ? -1 : y;
+
+    // Worst case for the next cell: a move, a color and GAP_OVERWRITE.
+    if (term_len > shadow_width * 64)
+        I_TermFlush ();
+}
+
 void I_FinishUpdate (void)
 {
     int text_width;
     int text_height;
+    int budget;
+    int row;
     int x;
     int y;
 
@@ -226,40 +345,57 @@ void I_FinishUpdate (void)
     text_width = COLS;
     text_height = LINES;
 
+    // New size: everything is sent again.
+    if (text_width != shadow_width || text_height != shadow_height)
+    {
+        free (shadow_cells);
+        free (term_buf);
+        shadow_cells = (unsigned short*)malloc (
+            text_width * text_height * sizeof (unsigned short));
+        term_buf = (char*)malloc (text_width * 128);
+        for (x = 0; x < text_width * text_height; ++x)
+            shadow_cells[x] = CELL_UNKNOWN;
+        shadow_width = text_width;
+        shadow_height = text_height;
+        cell_next_row = 0;
+        term_len = 0;
+        I_TermPrint ("\033[0m\033[2J", 0, 0);
+    }
+
+    // ncurses may have moved the cursor and changed the colors since.
+    term_x = -1;
+    term_y = -1;
+    term_color = -1;
+
+    budget = cell_budget > 0 ? cell_budget : text_width * text_height;
+
     // We just do nearest neigbour sampling.
-    for (y = 0; y < text_height; ++y)
+    for (row = 0; row < text_height && budget > 0; ++row)
     {
+        y = (cell_next_row + row) % text_height;
+
         int v = (y * SCREENHEIGHT) / text_height;
-        byte* row = &screens[0][v * SCREENWIDTH];
-        if (do_color)
-        {
-            int last_pair = 1;
-            attron (COLOR_PAIR (last_pair));
-            for (x = 0; x < text_width; ++x)
-            {
-                int u = (x * SCREENWIDTH) / text_width;
-                int pair = 1 + (int)palette_lut[row[u]];
-                if (pair != last_pair)
-                {
-                    attroff (COLOR_PAIR (last_pair));
-                    attron (COLOR_PAIR (pair));
-                    last_pair = pair;
-                }
-                mvaddch (y, x, ' ');
-            }
-            attroff (COLOR_PAIR (last_pair));
-        }
-        else
+        const byte* src = &screens[0][v * SCREENWIDTH];
+        unsigned short* cells = &shadow_cells[y * text_width];
+
+        for (x = 0; x < text_width && budget > 0; ++x)
         {
-            for (x = 0; x < text_width; ++x)
-            {
-                int u = (x * SCREENWIDTH) / text_width;
-                mvaddch (y, x, (chtype)palette_lut[row[u]]);
-            }
+            int u = (x * SCREENWIDTH) / text_width;
+            unsigned short cell = palette_lut[src[u]];
+
+            if (I_SameCell (cells[x], cell))
+                continue;
+
+            I_TermCell (x, y, cells, cell);
+            cells[x] = cell;
+            --budget;
         }
+
+        if (budget == 0)
+            cell_next_row = y;
     }
 
-    refresh ();
+    I_TermFlush ();
 }
 
 void I_WaitVBL (int count)
@@ -13,22 +13,44 @@
 #include "d_main.h"
 #include "i_system.h"
 #include "m_argv.h"
+#include "r_main.h"
+#include "r_draw.h"
 #include "v_video.h"
 
+extern boolean setsizeneeded;
+
 static uint16_t s_palette[256] __attribute((section(".fastdata")));
 
 /*
-   320x200 -> OLED_WIDTH x OLED_HEIGHT:
+   During the game, the 3D view is rendered directly in OLED pixels, at
+   the OLED resolution (see R_SetDirectColor()), and sent as is.
+   The other screens (menus, automap, intermission) are made for 320x200
+   and decimated, the 3D view is then rendered at twice the OLED
+   resolution (see maxviewwidth).
+*/
+#define OLED_VIEW_WIDTH  (2*OLED_WIDTH)
+#define OLED_VIEW_HEIGHT (2*OLED_HEIGHT)
+
+/*
+   source rectangle -> OLED_WIDTH x OLED_HEIGHT:
    framebuffer pointer increment for next pixel
 */
 static uint8_t oled_map_dx[OLED_WIDTH]   __attribute((section(".fastdata")));
 
 /*
-    320x200 -> OLED_WIDTH x OLED_HEIGHT:
+    source rectangle -> OLED_WIDTH x OLED_HEIGHT:
     framebuffer pointer increment for next line divided by 8 (shifted >> 3)
 */
 static uint8_t oled_map_dy[OLED_HEIGHT]  __attribute((section(".fastdata")));
 
+/* 
+    source rectangle in screens[0] the maps correspond to 
+*/
+static int oled_src_x = -1;
+static int oled_src_y = -1;
+static int oled_src_w = -1;
+static int oled_src_h = -1;
+
 static inline int map(int x, int in_max, int out_max) {
     return x * in_max / out_max;
 }
@@ -40,6 +62,22 @@ static inline int map_delta(int x, int in_max, int out_max) {
     return map(x, in_max, out_max) - map(x-1, in_max, out_max);
 }
 
+static void oled_set_source(int x0, int y0, int w, int h) {
+   if(x0 == oled_src_x && y0 == oled_src_y && w == oled_src_w && h == oled_src_h) {
+      return;
+   }
+   oled_src_x = x0;
+   oled_src_y = y0;
+   oled_src_w = w;
+   oled_src_h = h;
+   for(int x=0; x<OLED_WIDTH; ++x) {
+      oled_map_dx[x] = (uint8_t)(map_delta(x, w, OLED_WIDTH));
+   }
+   for(int y=0; y<OLED_HEIGHT; ++y) {
+      oled_map_dy[y] = (uint8_t)((map_delta(y, h, OLED_HEIGHT)*SCREENWIDTH)>>3);
+   }
+}
+
 void I_InitGraphics (void) {
    // Only initialize once.
    static int initialized = 0;
@@ -49,17 +87,20 @@ void I_InitGraphics (void) {
    screens[0] = (unsigned char*)malloc (SCREENWIDTH * SCREENHEIGHT);
    if (screens[0] == NULL)
      I_Error ("Couldn't allocate screen memory");
-   for(int x=0; x<OLED_WIDTH; ++x) {
-      oled_map_dx[x] = (uint8_t)(map_delta(x, 320, OLED_WIDTH));
-   }
-   for(int y=0; y<OLED_HEIGHT; ++y) {
-      oled_map_dy[y] = (uint8_t)((map_delta(y, 200, OLED_HEIGHT)*320)>>3);
-   }
+   oled_set_source(0, 0, SCREENWIDTH, SCREENHEIGHT);
+
+   // Render the 3D view at OLED_VIEW_WIDTH x OLED_VIEW_HEIGHT instead of
+   // rendering it at 320x200 and throwing away 90% of the pixels
+   // (until the game starts, see oled_select_view()).
+   maxviewwidth  = OLED_VIEW_WIDTH;
+   maxviewheight = OLED_VIEW_HEIGHT;
+   setsizeneeded = true;
    
    oled_init();
 }
 
 void I_ShutdownGraphics (void) {
+   oled_stream_finish();
    free (screens[0]);
    oled_off();
 }
@@ -71,68 +112,88 @@ void I_StartFrame (void) {
 }
 
 void I_StartTic (void) {
+   oled_stream_poll();
 }
 
 void I_UpdateNoBlit (void) {
 }
 
-
 //------------------------
 
-#ifdef CSR_OLED_SPI_BASE    
-
-// Wait for SPI driver to have finished sending data
-static inline void oled_wait(void) {
-   while(oled_spi_status_read() != OLED_SPI_DONE);
-}
+/*
+   The frames, in OLED pixels. The previous one is sent in the
+   background (oled_stream_poll() in I_PollUpdate(), called by the 
+   renderer for each column and span) while the next one is computed.
+*/
+static uint16_t oled_frame[2][OLED_WIDTH*OLED_HEIGHT];
+static int      oled_back;        /* the one being computed */
+static boolean  oled_direct;      /* the 3D view is rendered in it */
+static int      oled_window_w = -1;
+static int      oled_window_h = -1;
 
-// Same as in lite_oled, but does not change CS and CMD/DAT
-// and does not wait for SPI to have finished sending data
-static inline void oled_byte_raw(uint8_t b) {
-   oled_spi_mosi_write(b);
-   oled_spi_control_write(8*OLED_SPI_LENGTH | OLED_SPI_START);
+/*
+   Direct rendering during the game, 320x200 screens otherwise. The
+   change of view size happens at the beginning of the next D_Display(),
+   before anything is rendered with the new mode.
+*/
+static void oled_select_view(void) {
+   boolean direct = gamestate == GS_LEVEL && !automapactive && !menuactive;
+   if (direct != oled_direct) {
+      oled_direct   = direct;
+      maxviewwidth  = direct ? OLED_WIDTH  : OLED_VIEW_WIDTH;
+      maxviewheight = direct ? OLED_HEIGHT : OLED_VIEW_HEIGHT;
+      setsizeneeded = true;
+   }
+   R_SetDirectColor(direct ? oled_frame[oled_back] : NULL);
 }
 
-// Same as in lite_oled, but does not change CS and CMD/DAT
-// and does not wait for SPI to have finished sending data
-static inline void oled_data_uint16_raw(uint16_t RGB) {
-   // Unfortunately, in LiteX, the SPI driver can only send
-   // 8 bits at a time (the shifter is only 8 bits wide)
-   oled_byte_raw((uint8_t)(RGB>>8));
-   oled_wait();
-   oled_byte_raw((uint8_t)(RGB));
+void I_PollUpdate (void) {
+   oled_stream_poll();
 }
 
-#endif
-
-//------------------------
-
 void I_FinishUpdate (void) {
 
 #ifdef CSR_OLED_SPI_BASE    
-    const unsigned char* src = (const unsigned char*)screens[0];
-    oled_write_window(0,0,OLED_WIDTH-1,OLED_HEIGHT-1);
-    const unsigned char* line_ptr = src;
-
-    // sending DATA to the SPI
-    oled_ctl_out_write(OLED_SPI_DAT);
-    // chip select ON (LOW)
-    oled_spi_cs_write(OLED_SPI_CS_LOW);
-    for(int y=0; y<OLED_HEIGHT; ++y) {
-        const unsigned char* pixel_ptr = line_ptr;
-        for(int x=0; x<OLED_WIDTH; ++x) {
-            uint16_t pixelvalue = s_palette[*pixel_ptr];
-	    // send pixel data to the SPI
-            oled_data_uint16_raw(pixelvalue);
-	    // increment framebuffer pointer 
-            pixel_ptr += oled_map_dx[x];
-	    // wait for SPI write dat to be finished
-            oled_wait();
+    uint16_t* frame = oled_frame[oled_back];
+    int w = OLED_WIDTH;
+    int h = OLED_HEIGHT;
+
+    // the end of the previous frame, if the renderer did not send all of it
+    oled_stream_finish();
+
+    if (oled_direct && gamestate == GS_LEVEL && !automapactive && !menuactive &&
+        viewwidth <= OLED_WIDTH && viewheight <= OLED_HEIGHT) {
+        // the renderer wrote the 3D view in frame, nothing to convert
+        w = viewwidth;
+        h = viewheight;
+    } else {
+        oled_set_source(0, 0, SCREENWIDTH, SCREENHEIGHT);
+        const unsigned char* line_ptr = (const unsigned char*)screens[0];
+        uint16_t* dst = frame;
+        for(int y=0; y<OLED_HEIGHT; ++y) {
+            const unsigned char* pixel_ptr = line_ptr;
+            for(int x=0; x<OLED_WIDTH; ++x) {
+                *dst++ = s_palette[*pixel_ptr];
+                // increment framebuffer pointer 
+                pixel_ptr += oled_map_dx[x];
+            }
+            line_ptr += (oled_map_dy[y]<<3);
         }
-        line_ptr += (oled_map_dy[y]<<3);
     }
-    // chip select OFF (HIGH)
-    oled_spi_cs_write(OLED_SPI_CS_HIGH);
+
+    // a smaller view is centered, clear what is around once
+    if (w != oled_window_w || h != oled_window_h) {
+        oled_clear();
+        oled_window_w = w;
+        oled_window_h = h;
+    }
+    int x0 = (OLED_WIDTH - w) / 2;
+    int y0 = (OLED_HEIGHT - h) / 2;
+    oled_write_window(x0, y0, x0 + w - 1, y0 + h - 1);
+    oled_stream_start(frame, w * h);
+
+    oled_back ^= 1;
+    oled_select_view();
 #endif
 }
 
@@ -147,4 +208,5 @@ void I_SetPalette (byte* palette) {
         uint16_t b = (uint16_t)gammatable[usegamma][*palette++];
         s_palette[i] = oled_RGB_to_uint16(r,g,b);
     }
+    R_SetDirectPalette(s_palette);
 }
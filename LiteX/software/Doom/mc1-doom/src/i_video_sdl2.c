@@ -298,6 +298,10 @@ void I_UpdateNoBlit (void)
     // what is this?
 }
 
+void I_PollUpdate (void)
+{
+}
+
 void I_FinishUpdate (void)
 {
     // Copy the internal screen to the SDL texture, converting the
@@ -31,11 +31,110 @@
 //   1: long long (slow on most 32-bit machines, accurate)
 //   2: float (fast on MRISC32 with an FPU, but inaccurate - demos go wrong)
 //   3: double (slow on MRISC32, accurate)
+//   4: reciprocal (RV32: the long long division is a __divdi3 call),
+//      same results as 1
 //
+#if defined(__riscv) && __riscv_xlen == 32
+#define DIV_METHOD 4
+#else
 #define DIV_METHOD 1
+#endif
+
+#if DIV_METHOD == 4
+//
+// 1/d in Q15 at the middle of [0.5 + i/512, 0.5 + (i+1)/512).
+// Two Newton steps take it from 9 to 30 bits, then the quotient is
+// corrected with its remainder, so that it is exact.
+//
+static const unsigned short fixeddivtab[256] =
+{
+    65408,65154,64902,64652,64404,64158,63913,63671,
+    63430,63191,62954,62719,62485,62253,62023,61795,
+    61568,61343,61119,60897,60677,60458,60241,60026,
+    59812,59599,59388,59179,58971,58764,58559,58356,
+    58153,57952,57753,57555,57358,57163,56968,56776,
+    56584,56394,56205,56017,55831,55646,55462,55279,
+    55098,54917,54738,54560,54383,54207,54033,53859,
+    53687,53516,53346,53177,53009,52842,52676,52511,
+    52347,52184,52022,51862,51702,51543,51385,51228,
+    51072,50917,50763,50610,50458,50306,50156,50007,
+    49858,49710,49563,49417,49272,49128,48985,48842,
+    48700,48559,48419,48280,48141,48003,47867,47730,
+    47595,47460,47326,47193,47061,46929,46798,46668,
+    46539,46410,46282,46155,46028,45902,45777,45652,
+    45528,45405,45283,45161,45040,44919,44799,44680,
+    44561,44443,44326,44209,44093,43977,43862,43748,
+    43634,43521,43408,43296,43185,43074,42963,42854,
+    42744,42636,42528,42420,42313,42207,42101,41996,
+    41891,41786,41683,41579,41476,41374,41272,41171,
+    41070,40970,40870,40771,40672,40574,40476,40378,
+    40281,40185,40089,39993,39898,39804,39709,39616,
+    39522,39429,39337,39245,39153,39062,38971,38881,
+    38791,38702,38613,38524,38436,38348,38260,38173,
+    38087,38000,37915,37829,37744,37659,37575,37491,
+    37407,37324,37241,37159,37077,36995,36914,36833,
+    36752,36672,36592,36512,36433,36354,36275,36197,
+    36119,36041,35964,35887,35810,35734,35658,35583,
+    35507,35432,35358,35283,35209,35136,35062,34989,
+    34916,34844,34771,34700,34628,34557,34486,34415,
+    34344,34274,34204,34135,34065,33996,33928,33859,
+    33791,33723,33655,33588,33521,33454,33387,33321,
+    33255,33189,33124,33059,32994,32929,32864,32800
+};
+
+static fixed_t FixedDivReciprocal (fixed_t a, fixed_t b)
+{
+    unsigned            ua, ub, d, x, q;
+    unsigned long long  n;
+    long long           r;
+    int                 shift;
+    int                 e;
+
+    ua = a < 0 ? -(unsigned)a : (unsigned)a;
+    ub = b < 0 ? -(unsigned)b : (unsigned)b;
+
+    // d = ub normalized in [2^31, 2^32), 0 < ub < 2^31 (see FixedDiv)
+    shift = __builtin_clz (ub);
+    d = ub << shift;
+
+    // x ~ 2^62 / d, in [2^30, 2^31]
+    x = (unsigned)fixeddivtab[(d >> 23) & 255] << 15;
+    e = (1 << 30) - (int)(((unsigned long long)d * x) >> 32);
+    x += (int)(((long long)x * e) >> 30);
+    e = (1 << 30) - (int)(((unsigned long long)d * x) >> 32);
+    x += (int)(((long long)x * e) >> 30);
+
+    // (ua << 16) / ub = ua * x / 2^(46 - shift), within a few units
+    q = (unsigned)(((unsigned long long)ua * x) >> (46 - shift));
+    n = (unsigned long long)ua << 16;
+    r = (long long)(n - (unsigned long long)q * ub);
+    while (r < 0)
+    {
+        q--;
+        r += ub;
+    }
+    while (r >= ub)
+    {
+        q++;
+        r -= ub;
+    }
+
+    return (a ^ b) < 0 ? -(fixed_t)q : (fixed_t)q;
+}
+#endif  // DIV_METHOD == 4
 
 fixed_t FixedDiv (fixed_t a, fixed_t b)
 {
+#if DIV_METHOD == 4
+    // abs (MININT) is negative (and undefined for the compiler, that may
+    // optimize the check below assuming it is not): do as if it wrapped.
+    // With a == MININT, the quotient does not fit in 32 bits.
+    if (b == MININT)
+        return (a ^ b) < 0 ? MININT : MAXINT;
+    if (a == MININT)
+        return (fixed_t) ((((long long)a) << 16) / ((long long)b));
+#endif
+
     // Check for overflow/underflow.
     if ((abs (a) >> 14) >= abs (b))
         return (a ^ b) < 0 ? MININT : MAXINT;
@@ -50,5 +149,90 @@ fixed_t FixedDiv (fixed_t a, fixed_t b)
 #endif
 #elif DIV_METHOD == 3
     return (fixed_t) ((((double)a * (float)FRACUNIT) / (double)b));
-#endif  // DIV_METHOD == 3
+#elif DIV_METHOD == 4
+    return FixedDivReciprocal (a, b);
+#endif  // DIV_METHOD == 4
+}
+
+//
+// Microbenchmark (build with -DM_FIXED_BENCH, runs at startup):
+//  cycles per call of FixedMul and FixedDiv, and of the long long
+//  versions, on the same pseudo-random operands. Also checks that
+//  FixedDiv gives the same results as the long long division.
+//
+#ifdef M_FIXED_BENCH
+#include <stdio.h>
+
+#include "m_profile.h"
+
+#define BENCH_N 1024
+
+static fixed_t  bencha[BENCH_N];
+static fixed_t  benchb[BENCH_N];
+
+static fixed_t __attribute__((noinline)) FixedMulLongLong (fixed_t a, fixed_t b)
+{
+    return ((long long) a * (long long) b) >> FRACBITS;
+}
+
+static fixed_t __attribute__((noinline)) FixedDivLongLong (fixed_t a, fixed_t b)
+{
+    if ((abs (a) >> 14) >= abs (b))
+        return (a ^ b) < 0 ? MININT : MAXINT;
+    return (fixed_t) ((((long long)a) << 16) / ((long long)b));
+}
+
+static void M_FixedBenchPrint (const char* name, unsigned cycles)
+{
+    printf ("  %-20s %u.%02u cycles/call\n", name,
+            cycles / BENCH_N, (100 * (cycles % BENCH_N) / BENCH_N));
+}
+
+void M_FixedBench (void)
+{
+    unsigned    seed = 1;
+    unsigned    cycles;
+    fixed_t     sum = 0;
+    int         errors = 0;
+    int         i;
+
+    // operands of all magnitudes, as in the renderer
+    for (i = 0; i < BENCH_N; i++)
+    {
+        seed = seed * 1664525 + 1013904223;
+        bencha[i] = (fixed_t)seed >> (seed & 15);
+        seed = seed * 1664525 + 1013904223;
+        benchb[i] = (fixed_t)seed >> (8 + (seed & 15));
+    }
+
+    printf ("M_FixedBench:\n");
+
+    cycles = M_ProfileCycles ();
+    for (i = 0; i < BENCH_N; i++)
+        sum += FixedMul (bencha[i], benchb[i]);
+    M_FixedBenchPrint ("FixedMul", M_ProfileCycles () - cycles);
+
+    cycles = M_ProfileCycles ();
+    for (i = 0; i < BENCH_N; i++)
+        sum -= FixedMulLongLong (bencha[i], benchb[i]);
+    M_FixedBenchPrint ("FixedMul (long long)", M_ProfileCycles () - cycles);
+
+    cycles = M_ProfileCycles ();
+    for (i = 0; i < BENCH_N; i++)
+        sum += FixedDiv (bencha[i], benchb[i]);
+    M_FixedBenchPrint ("FixedDiv", M_ProfileCycles () - cycles);
+
+    cycles = M_ProfileCycles ();
+    for (i = 0; i < BENCH_N; i++)
+        sum -= FixedDivLongLong (bencha[i], benchb[i]);
+    M_FixedBenchPrint ("FixedDiv (long long)", M_ProfileCycles () - cycles);
+
+    for (i = 0; i < BENCH_N; i++)
+    {
+        if (FixedDiv (bencha[i], benchb[i])
+            != FixedDivLongLong (bencha[i], benchb[i]))
+            errors++;
+    }
+    printf ("  %i differences (checksum %i)\n", errors, sum);
 }
+#endif  // M_FIXED_BENCH
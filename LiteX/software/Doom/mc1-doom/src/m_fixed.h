@@ -46,6 +46,14 @@ static inline fixed_t FixedMul (fixed_t a, fixed_t b)
     fixed_t hi = _mr32_mulhi (a, b);
     fixed_t lo = ((unsigned)(a * b)) >> 16;
     return _mr32_pack (hi, lo);
+#elif defined(__riscv) && defined(__riscv_mul) && __riscv_xlen == 32
+    // Bits 16..47 of the 64 bits product, from mul and mulh (same result
+    // as the long long version, without relying on the compiler to spot
+    // the widening multiply).
+    fixed_t lo, hi;
+    __asm__ ("mul  %0, %1, %2" : "=r"(lo) : "r"(a), "r"(b));
+    __asm__ ("mulh %0, %1, %2" : "=r"(hi) : "r"(a), "r"(b));
+    return (fixed_t) (((unsigned)hi << 16) | ((unsigned)lo >> 16));
 #else
     return ((long long) a * (long long) b) >> FRACBITS;
 #endif
@@ -57,6 +65,11 @@ static inline fixed_t FixedMul (fixed_t a, fixed_t b)
 
 fixed_t FixedDiv (fixed_t a, fixed_t b);
 
+#ifdef M_FIXED_BENCH
+// Prints the cycles per call of FixedMul and FixedDiv.
+void M_FixedBench (void);
+#endif
+
 //
 // INT_TO_FIXED - Convert an integer to fixed point.
 //
@@ -0,0 +1,149 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Frame profiler.
+//
+//-----------------------------------------------------------------------------
+
+#include <stdio.h>
+
+#if defined(__riscv)
+#include <generated/soc.h>
+#define PROFILE_FREQUENCY CONFIG_CLOCK_FREQUENCY
+#else
+#define PROFILE_FREQUENCY CLOCKS_PER_SEC
+#endif
+
+#include "doomdef.h"
+#include "m_argv.h"
+#include "m_profile.h"
+
+// The averages move by 1/2^PROFILE_SHIFT of the difference
+// with the last frame (about 16 frames to settle).
+#define PROFILE_SHIFT   4
+
+boolean         profileactive;
+static boolean  profileprint;
+
+unsigned        profileaverage[NUMPROFPHASES];
+
+const char*     profilenames[NUMPROFPHASES] =
+{
+    "TICKER", "BSP", "PLANES", "MASKED", "SPRSORT", "BLIT", "FRAME"
+};
+
+static unsigned profilestart[NUMPROFPHASES];
+static unsigned profilesum[NUMPROFPHASES];
+static int      profileframes;
+
+static unsigned long long profiletotal[NUMPROFPHASES];
+static int      profiletotalframes;
+
+unsigned long long M_ProfileCycles64 (void)
+{
+#if defined(__riscv) && __riscv_xlen == 32
+    unsigned hi, lo, hi2;
+
+    // re-read if the low word wrapped between the two reads
+    do
+    {
+        __asm__ volatile ("rdcycleh %0" : "=r"(hi));
+        __asm__ volatile ("rdcycle %0" : "=r"(lo));
+        __asm__ volatile ("rdcycleh %0" : "=r"(hi2));
+    } while (hi != hi2);
+    return ((unsigned long long) hi << 32) | lo;
+#elif defined(__riscv)
+    unsigned long long cycles;
+    __asm__ volatile ("rdcycle %0" : "=r"(cycles));
+    return cycles;
+#else
+    return (unsigned long long) clock ();
+#endif
+}
+
+unsigned M_ProfileFrequency (void)
+{
+    return PROFILE_FREQUENCY;
+}
+
+void M_ProfileInit (void)
+{
+    profileprint = M_CheckParm ("-profileprint") != 0;
+    profileactive = profileprint || M_CheckParm ("-profile");
+    profilestart[prof_frame] = M_ProfileCycles ();
+}
+
+void M_ProfileBegin (profphase_t phase)
+{
+    if (profileactive)
+        profilestart[phase] = M_ProfileCycles ();
+}
+
+void M_ProfileEnd (profphase_t phase)
+{
+    if (profileactive)
+        profilesum[phase] += M_ProfileCycles () - profilestart[phase];
+}
+
+void M_ProfileFrame (void)
+{
+    int         i;
+
+    if (!profileactive)
+        return;
+
+    M_ProfileEnd (prof_frame);
+    M_ProfileBegin (prof_frame);
+
+    for (i=0 ; i<NUMPROFPHASES ; i++)
+    {
+        int delta = (int)(profilesum[i] - profileaverage[i]);
+        profileaverage[i] += delta >> PROFILE_SHIFT;
+        profiletotal[i] += profilesum[i];
+        profilesum[i] = 0;
+    }
+    profiletotalframes++;
+
+    if (profileprint && ++profileframes == TICRATE)
+    {
+        profileframes = 0;
+        printf ("M_Profile:");
+        for (i=0 ; i<NUMPROFPHASES ; i++)
+            printf (" %s %u", profilenames[i], profileaverage[i]);
+        printf ("\n");
+    }
+}
+
+void M_ProfileResetTotals (void)
+{
+    int         i;
+
+    for (i=0 ; i<NUMPROFPHASES ; i++)
+        profiletotal[i] = 0;
+    profiletotalframes = 0;
+}
+
+void M_ProfileReport (void)
+{
+    int         i;
+
+    if (!profileactive || profiletotalframes == 0)
+        return;
+
+    printf ("M_Profile: %i frames, cycles per frame:", profiletotalframes);
+    for (i=0 ; i<NUMPROFPHASES ; i++)
+        printf (" %s %u", profilenames[i],
+                (unsigned)(profiletotal[i] / profiletotalframes));
+    printf ("\n");
+}
@@ -0,0 +1,78 @@
+// Emacs style mode select   -*- C++ -*-
+//-----------------------------------------------------------------------------
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation; either version 2
+// of the License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// DESCRIPTION:
+//      Frame profiler: cycles spent in each phase of a frame,
+//      as a rolling average drawn by HU_Drawer (-profile)
+//      and/or printed once per second (-profileprint).
+//
+//-----------------------------------------------------------------------------
+
+#ifndef __M_PROFILE__
+#define __M_PROFILE__
+
+#include <time.h>
+
+#include "doomtype.h"
+
+typedef enum
+{
+    prof_ticker,        // G_Ticker
+    prof_bsp,           // R_RenderBSPNode
+    prof_planes,        // R_DrawPlanes
+    prof_masked,        // R_DrawMasked
+    prof_sprsort,       // R_SortVisSprites (inside R_DrawMasked)
+    prof_blit,          // I_FinishUpdate
+    prof_frame,         // whole frame, from one M_ProfileFrame to the next
+    NUMPROFPHASES
+} profphase_t;
+
+extern boolean          profileactive;
+
+// Rolling averages, in cycles per frame.
+extern unsigned         profileaverage[NUMPROFPHASES];
+extern const char*      profilenames[NUMPROFPHASES];
+
+// Cycle counter (clock() ticks when there is none).
+static inline unsigned M_ProfileCycles (void)
+{
+#if defined(__riscv)
+    unsigned cycles;
+    __asm__ volatile ("rdcycle %0" : "=r"(cycles));
+    return cycles;
+#else
+    return (unsigned) clock ();
+#endif
+}
+
+// 64 bits cycle counter, for measures longer than a few seconds.
+unsigned long long M_ProfileCycles64 (void);
+
+// Frequency of the cycle counter.
+unsigned M_ProfileFrequency (void);
+
+// Checks the -profile and -profileprint options.
+void M_ProfileInit (void);
+
+void M_ProfileBegin (profphase_t phase);
+void M_ProfileEnd (profphase_t phase);
+
+// Called once per displayed frame, updates the averages.
+void M_ProfileFrame (void);
+
+// Totals of each phase since the last M_ProfileResetTotals, printed
+// as cycles per frame by M_ProfileReport (at the end of -timedemo).
+void M_ProfileResetTotals (void);
+void M_ProfileReport (void);
+
+#endif  // __M_PROFILE__
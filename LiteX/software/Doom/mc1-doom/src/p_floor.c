@@ -49,6 +49,9 @@ T_MovePlane
     boolean     flag;
     fixed_t     lastpos;
 
+    // the lines of sight through this sector may change
+    P_ClearSightCache ();
+
     switch(floorOrCeiling)
     {
       case 0:
@@ -197,6 +197,7 @@ boolean P_TryMove (mobj_t* thing, fixed_t x, fixed_t y);
 boolean P_TeleportMove (mobj_t* thing, fixed_t x, fixed_t y);
 void    P_SlideMove (mobj_t* mo);
 boolean P_CheckSight (mobj_t* t1, mobj_t* t2);
+void    P_ClearSightCache (void);
 void    P_UseLines (player_t* player);
 
 boolean P_ChangeSector (sector_t* sector, boolean crunch);
@@ -98,39 +98,63 @@ mapthing_t      deathmatchstarts[MAX_DEATHMATCH_STARTS];
 mapthing_t*     deathmatch_p;
 mapthing_t      playerstarts[MAXPLAYERS];
 
+//
+// P_LoadLumpInPlace
+// Allocates the PU_LEVEL array of a map lump: *count elements of size
+//  bytes, for records of disksize bytes (size >= disksize). The lump is
+//  read at the end of the array, returned in *records, and the loaders
+//  convert the records from the first one, each element ending before
+//  the next record: the lump is not cached in the zone next to the
+//  array (less memory at the peak, and no hole left between the
+//  arrays of the level).
+//
+static void*
+P_LoadLumpInPlace
+( int           lump,
+  int           disksize,
+  int           size,
+  int*          count,
+  void**        records )
+{
+    int         length;
+    byte*       array;
+
+    if (size < disksize)
+        I_Error ("P_LoadLumpInPlace: %i < %i", size, disksize);
+
+    length = W_LumpLength (lump);
+    *count = length / disksize;
+
+    // the lump may end with a partial record
+    array = Z_Malloc (*count*size + length - *count*disksize, PU_LEVEL, 0);
+    *records = array + *count*(size - disksize);
+    W_ReadLump (lump, *records);
+
+    return array;
+}
+
 //
 // P_LoadVertexes
 //
 void P_LoadVertexes (int lump)
 {
-    byte*               data;
     int                 i;
     mapvertex_t*        ml;
+    mapvertex_t         mv;
     vertex_t*           li;
 
-    // Determine number of lumps:
-    //  total lump length / vertex record length.
-    numvertexes = W_LumpLength (lump) / sizeof(mapvertex_t);
-
-    // Allocate zone memory for buffer.
-    vertexes = Z_Malloc (numvertexes*sizeof(vertex_t),PU_LEVEL,0);
-
-    // Load data into cache.
-    data = W_CacheLumpNum (lump,PU_STATIC);
-
-    ml = (mapvertex_t *)data;
+    vertexes = P_LoadLumpInPlace (lump, sizeof(mapvertex_t), sizeof(vertex_t),
+                                  &numvertexes, (void**)&ml);
     li = vertexes;
 
-    // Copy and convert vertex coordinates,
+    // Convert vertex coordinates,
     // internal representation as fixed.
     for (i=0 ; i<numvertexes ; i++, li++, ml++)
     {
-        li->x = INT_TO_FIXED (SHORT (ml->x));
-        li->y = INT_TO_FIXED (SHORT (ml->y));
+        mv = *ml;
+        li->x = INT_TO_FIXED (SHORT (mv.x));
+        li->y = INT_TO_FIXED (SHORT (mv.y));
     }
-
-    // Free buffer memory.
-    Z_Free (data);
 }
 
 //
@@ -138,32 +162,31 @@ void P_LoadVertexes (int lump)
 //
 void P_LoadSegs (int lump)
 {
-    byte*               data;
     int                 i;
     mapseg_t*           ml;
+    mapseg_t            ms;
     seg_t*              li;
     line_t*             ldef;
     int                 linedef;
     int                 side;
 
-    numsegs = W_LumpLength (lump) / sizeof(mapseg_t);
-    segs = Z_Malloc (numsegs*sizeof(seg_t),PU_LEVEL,0);
-    memset (segs, 0, numsegs*sizeof(seg_t));
-    data = W_CacheLumpNum (lump,PU_STATIC);
-
-    ml = (mapseg_t *)data;
+    segs = P_LoadLumpInPlace (lump, sizeof(mapseg_t), sizeof(seg_t),
+                              &numsegs, (void**)&ml);
     li = segs;
     for (i=0 ; i<numsegs ; i++, li++, ml++)
     {
-        li->v1 = &vertexes[SHORT(ml->v1)];
-        li->v2 = &vertexes[SHORT(ml->v2)];
+        ms = *ml;
+        memset (li, 0, sizeof(*li));
+
+        li->v1 = &vertexes[SHORT(ms.v1)];
+        li->v2 = &vertexes[SHORT(ms.v2)];
 
-        li->angle = ((unsigned)(int)SHORT(ml->angle))<<16;
-        li->offset = ((unsigned)(int)SHORT(ml->offset))<<16;
-        linedef = SHORT(ml->linedef);
+        li->angle = ((unsigned)(int)SHORT(ms.angle))<<16;
+        li->offset = ((unsigned)(int)SHORT(ms.offset))<<16;
+        linedef = SHORT(ms.linedef);
         ldef = &lines[linedef];
         li->linedef = ldef;
-        side = SHORT(ml->side);
+        side = SHORT(ms.side);
         li->sidedef = &sides[ldef->sidenum[side]];
         li->frontsector = sides[ldef->sidenum[side]].sector;
         if (ldef-> flags & ML_TWOSIDED)
@@ -171,8 +194,6 @@ void P_LoadSegs (int lump)
         else
             li->backsector = 0;
     }
-
-    Z_Free (data);
 }
 
 //
@@ -180,26 +201,23 @@ void P_LoadSegs (int lump)
 //
 void P_LoadSubsectors (int lump)
 {
-    byte*               data;
     int                 i;
     mapsubsector_t*     ms;
+    mapsubsector_t      mss;
     subsector_t*        ss;
 
-    numsubsectors = W_LumpLength (lump) / sizeof(mapsubsector_t);
-    subsectors = Z_Malloc (numsubsectors*sizeof(subsector_t),PU_LEVEL,0);
-    data = W_CacheLumpNum (lump,PU_STATIC);
-
-    ms = (mapsubsector_t *)data;
-    memset (subsectors,0, numsubsectors*sizeof(subsector_t));
+    subsectors = P_LoadLumpInPlace (lump, sizeof(mapsubsector_t),
+                                    sizeof(subsector_t),
+                                    &numsubsectors, (void**)&ms);
     ss = subsectors;
 
     for (i=0 ; i<numsubsectors ; i++, ss++, ms++)
     {
-        ss->numlines = SHORT(ms->numsegs);
-        ss->firstline = SHORT(ms->firstseg);
+        mss = *ms;
+        memset (ss, 0, sizeof(*ss));
+        ss->numlines = SHORT(mss.numsegs);
+        ss->firstline = SHORT(mss.firstseg);
     }
-
-    Z_Free (data);
 }
 
 //
@@ -207,31 +225,27 @@ void P_LoadSubsectors (int lump)
 //
 void P_LoadSectors (int lump)
 {
-    byte*               data;
     int                 i;
     mapsector_t*        ms;
+    mapsector_t         msec;
     sector_t*           ss;
 
-    numsectors = W_LumpLength (lump) / sizeof(mapsector_t);
-    sectors = Z_Malloc (numsectors*sizeof(sector_t),PU_LEVEL,0);
-    memset (sectors, 0, numsectors*sizeof(sector_t));
-    data = W_CacheLumpNum (lump,PU_STATIC);
-
-    ms = (mapsector_t *)data;
+    sectors = P_LoadLumpInPlace (lump, sizeof(mapsector_t), sizeof(sector_t),
+                                 &numsectors, (void**)&ms);
     ss = sectors;
     for (i=0 ; i<numsectors ; i++, ss++, ms++)
     {
-        ss->floorheight = INT_TO_FIXED (SHORT (ms->floorheight));
-        ss->ceilingheight = INT_TO_FIXED (SHORT (ms->ceilingheight));
-        ss->floorpic = R_FlatNumForName(ms->floorpic);
-        ss->ceilingpic = R_FlatNumForName(ms->ceilingpic);
-        ss->lightlevel = SHORT(ms->lightlevel);
-        ss->special = SHORT(ms->special);
-        ss->tag = SHORT(ms->tag);
+        msec = *ms;
+        memset (ss, 0, sizeof(*ss));
+        ss->floorheight = INT_TO_FIXED (SHORT (msec.floorheight));
+        ss->ceilingheight = INT_TO_FIXED (SHORT (msec.ceilingheight));
+        ss->floorpic = R_FlatNumForName(msec.floorpic);
+        ss->ceilingpic = R_FlatNumForName(msec.ceilingpic);
+        ss->lightlevel = SHORT(msec.lightlevel);
+        ss->special = SHORT(msec.special);
+        ss->tag = SHORT(msec.tag);
         ss->thinglist = NULL;
     }
-
-    Z_Free (data);
 }
 
 //
@@ -239,35 +253,31 @@ void P_LoadSectors (int lump)
 //
 void P_LoadNodes (int lump)
 {
-    byte*       data;
     int         i;
     int         j;
     int         k;
     mapnode_t*  mn;
+    mapnode_t   mnode;
     node_t*     no;
 
-    numnodes = W_LumpLength (lump) / sizeof(mapnode_t);
-    nodes = Z_Malloc (numnodes*sizeof(node_t),PU_LEVEL,0);
-    data = W_CacheLumpNum (lump,PU_STATIC);
-
-    mn = (mapnode_t *)data;
+    nodes = P_LoadLumpInPlace (lump, sizeof(mapnode_t), sizeof(node_t),
+                               &numnodes, (void**)&mn);
     no = nodes;
 
     for (i = 0; i < numnodes; i++, no++, mn++)
     {
-        no->x = INT_TO_FIXED (SHORT (mn->x));
-        no->y = INT_TO_FIXED (SHORT (mn->y));
-        no->dx = INT_TO_FIXED (SHORT (mn->dx));
-        no->dy = INT_TO_FIXED (SHORT (mn->dy));
+        mnode = *mn;
+        no->x = INT_TO_FIXED (SHORT (mnode.x));
+        no->y = INT_TO_FIXED (SHORT (mnode.y));
+        no->dx = INT_TO_FIXED (SHORT (mnode.dx));
+        no->dy = INT_TO_FIXED (SHORT (mnode.dy));
         for (j = 0; j < 2; j++)
         {
-            no->children[j] = SHORT (mn->children[j]);
+            no->children[j] = SHORT (mnode.children[j]);
             for (k = 0; k < 4; k++)
-                no->bbox[j][k] = INT_TO_FIXED (SHORT (mn->bbox[j][k]));
+                no->bbox[j][k] = INT_TO_FIXED (SHORT (mnode.bbox[j][k]));
         }
     }
-
-    Z_Free (data);
 }
 
 //
@@ -312,11 +322,13 @@ void P_LoadThings (int lump)
             break;
 
         // Do spawn all other stuff.
+#ifdef __BIG_ENDIAN__
         mt->x = SHORT(mt->x);
         mt->y = SHORT(mt->y);
         mt->angle = SHORT(mt->angle);
         mt->type = SHORT(mt->type);
         mt->options = SHORT(mt->options);
+#endif
 
         P_SpawnMapThing (mt);
     }
@@ -330,27 +342,26 @@ void P_LoadThings (int lump)
 //
 void P_LoadLineDefs (int lump)
 {
-    byte*               data;
     int                 i;
     maplinedef_t*       mld;
+    maplinedef_t        ml;
     line_t*             ld;
     vertex_t*           v1;
     vertex_t*           v2;
 
-    numlines = W_LumpLength (lump) / sizeof(maplinedef_t);
-    lines = Z_Malloc (numlines*sizeof(line_t),PU_LEVEL,0);
-    memset (lines, 0, numlines*sizeof(line_t));
-    data = W_CacheLumpNum (lump,PU_STATIC);
-
-    mld = (maplinedef_t *)data;
+    lines = P_LoadLumpInPlace (lump, sizeof(maplinedef_t), sizeof(line_t),
+                               &numlines, (void**)&mld);
     ld = lines;
     for (i=0 ; i<numlines ; i++, mld++, ld++)
     {
-        ld->flags = SHORT(mld->flags);
-        ld->special = SHORT(mld->special);
-        ld->tag = SHORT(mld->tag);
-        v1 = ld->v1 = &vertexes[SHORT(mld->v1)];
-        v2 = ld->v2 = &vertexes[SHORT(mld->v2)];
+        ml = *mld;
+        memset (ld, 0, sizeof(*ld));
+
+        ld->flags = SHORT(ml.flags);
+        ld->special = SHORT(ml.special);
+        ld->tag = SHORT(ml.tag);
+        v1 = ld->v1 = &vertexes[SHORT(ml.v1)];
+        v2 = ld->v2 = &vertexes[SHORT(ml.v2)];
         ld->dx = v2->x - v1->x;
         ld->dy = v2->y - v1->y;
 
@@ -388,8 +399,8 @@ void P_LoadLineDefs (int lump)
             ld->bbox[BOXTOP] = v1->y;
         }
 
-        ld->sidenum[0] = SHORT(mld->sidenum[0]);
-        ld->sidenum[1] = SHORT(mld->sidenum[1]);
+        ld->sidenum[0] = SHORT(ml.sidenum[0]);
+        ld->sidenum[1] = SHORT(ml.sidenum[1]);
 
         if (ld->sidenum[0] != -1)
             ld->frontsector = sides[ld->sidenum[0]].sector;
@@ -401,8 +412,6 @@ void P_LoadLineDefs (int lump)
         else
             ld->backsector = 0;
     }
-
-    Z_Free (data);
 }
 
 //
@@ -440,15 +449,21 @@ void P_LoadSideDefs (int lump)
 //
 void P_LoadBlockMap (int lump)
 {
-    int         i;
     int         count;
+#ifdef __BIG_ENDIAN__
+    int         i;
+#endif
 
     blockmaplump = W_CacheLumpNum (lump,PU_LEVEL);
     blockmap = blockmaplump+4;
+
+    // Used in place, swapped on big endian machines only.
+#ifdef __BIG_ENDIAN__
     count = W_LumpLength (lump)/2;
 
     for (i=0 ; i<count ; i++)
         blockmaplump[i] = SHORT(blockmaplump[i]);
+#endif
 
     bmaporgx = INT_TO_FIXED (blockmaplump[0]);
     bmaporgy = INT_TO_FIXED (blockmaplump[1]);
@@ -461,6 +476,31 @@ void P_LoadBlockMap (int lump)
     memset (blocklinks, 0, count);
 }
 
+//
+// P_LoadReject
+// The REJECT lump is a numsectors x numsectors bit matrix. Some PWADs
+// have a shorter (or empty) one: the missing bits are zeros (no
+// rejection), instead of reading past the end of the lump.
+//
+void P_LoadReject (int lump)
+{
+    int         length;
+    int         minlength;
+
+    minlength = (numsectors*numsectors+7)/8;
+    length = W_LumpLength (lump);
+    if (length >= minlength)
+    {
+        rejectmatrix = W_CacheLumpNum (lump,PU_LEVEL);
+        return;
+    }
+
+    rejectmatrix = Z_Malloc (minlength,PU_LEVEL,0);
+    memset (rejectmatrix,0,minlength);
+    if (length > 0)
+        W_ReadLump (lump,rejectmatrix);
+}
+
 //
 // P_GroupLines
 // Builds sector line lists and subsector sector numbers.
@@ -616,6 +656,9 @@ P_SetupLevel
 
     lumpnum = W_GetNumForName (lumpname);
 
+    // all the lumps of the map in one read
+    W_PreloadLumps (lumpnum+ML_THINGS, ML_BLOCKMAP-ML_THINGS+1);
+
     leveltime = 0;
 
     // note: most of this ordering is important
@@ -629,7 +672,7 @@ P_SetupLevel
     P_LoadNodes (lumpnum+ML_NODES);
     P_LoadSegs (lumpnum+ML_SEGS);
 
-    rejectmatrix = W_CacheLumpNum (lumpnum+ML_REJECT,PU_LEVEL);
+    P_LoadReject (lumpnum+ML_REJECT);
     P_GroupLines ();
 
     bodyqueslot = 0;
@@ -661,6 +704,9 @@ P_SetupLevel
     if (precache)
         R_PrecacheLevel ();
 
+    // build the wall textures (-precompose)
+    R_PrecomposeLevel ();
+
     //printf ("free memory: 0x%x\n", Z_FreeMemory());
 
 }
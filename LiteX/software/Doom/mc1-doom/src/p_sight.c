@@ -18,6 +18,8 @@
 //
 //-----------------------------------------------------------------------------
 
+#include <stdint.h>
+
 #include "doomdef.h"
 
 #include "i_system.h"
@@ -37,7 +39,39 @@ divline_t       strace;                 // from t1 to t2
 fixed_t         t2x;
 fixed_t         t2y;
 
-int             sightcounts[2];
+// rejected, BSP walks, same subsector, from the cache
+int             sightcounts[4];
+
+//
+// Sight cache: the results of P_CheckSight since the start of the tic,
+// for the checks that are repeated (A_Look, A_Chase, the missile range
+// check...). The positions and heights of both mobjs are part of the key,
+// and a floor or ceiling move (T_MovePlane) empties the cache, so that
+// the result is the one of the BSP walk (demos stay in sync).
+//
+#define SIGHTCACHE_SIZE 128     // power of two
+
+typedef struct
+{
+    mobj_t*     t1;
+    mobj_t*     t2;
+    fixed_t     x1, y1, z1, h1;
+    fixed_t     x2, y2, z2, h2;
+    unsigned    gen;            // entry is empty if not sightcachegen
+    boolean     result;
+} sightcache_t;
+
+static sightcache_t     sightcache[SIGHTCACHE_SIZE];
+static unsigned         sightcachegen = 1;
+
+//
+// P_ClearSightCache
+// Called at the start of each tic, and when a sector height changes.
+//
+void P_ClearSightCache (void)
+{
+    sightcachegen++;
+}
 
 //
 // P_DivlineSide
@@ -294,6 +328,7 @@ P_CheckSight
     int         pnum;
     int         bytenum;
     int         bitnum;
+    sightcache_t* entry;
 
     // First check for trivial rejection.
 
@@ -313,6 +348,26 @@ P_CheckSight
         return false;
     }
 
+    // A subsector is convex, there is nothing between two of its points.
+    if (t1->subsector == t2->subsector)
+    {
+        sightcounts[2]++;
+        return true;
+    }
+
+    entry = &sightcache[(((uintptr_t)t1 >> 4) * 31 + ((uintptr_t)t2 >> 4))
+                        & (SIGHTCACHE_SIZE-1)];
+    if (entry->gen == sightcachegen
+        && entry->t1 == t1 && entry->t2 == t2
+        && entry->x1 == t1->x && entry->y1 == t1->y
+        && entry->z1 == t1->z && entry->h1 == t1->height
+        && entry->x2 == t2->x && entry->y2 == t2->y
+        && entry->z2 == t2->z && entry->h2 == t2->height)
+    {
+        sightcounts[3]++;
+        return entry->result;
+    }
+
     // An unobstructed LOS is possible.
     // Now look from eyes of t1 to any part of t2.
     sightcounts[1]++;
@@ -331,6 +386,18 @@ P_CheckSight
     strace.dy = t2->y - t1->y;
 
     // the head node is the last node output
-    return P_CrossBSPNode (numnodes-1);
+    entry->t1 = t1;
+    entry->t2 = t2;
+    entry->x1 = t1->x;
+    entry->y1 = t1->y;
+    entry->z1 = t1->z;
+    entry->h1 = t1->height;
+    entry->x2 = t2->x;
+    entry->y2 = t2->y;
+    entry->z2 = t2->z;
+    entry->h2 = t2->height;
+    entry->gen = sightcachegen;
+    entry->result = P_CrossBSPNode (numnodes-1);
+    return entry->result;
 }
 
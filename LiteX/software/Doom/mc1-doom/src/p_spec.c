@@ -173,6 +173,39 @@ void P_InitPicAnims (void)
 
 }
 
+//
+// P_MarkAnimatedTextures
+// All the frames of an animation are marked when one is,
+//  and both textures of a switch.
+//
+extern int      switchlist[MAXSWITCHES * 2];
+extern int      numswitches;
+
+void P_MarkAnimatedTextures (char* texturepresent)
+{
+    anim_t*     anim;
+    int         i;
+
+    for (anim = anims ; anim < lastanim ; anim++)
+    {
+        if (!anim->istexture)
+            continue;
+
+        for (i=anim->basepic ; i<=anim->picnum ; i++)
+            if (texturepresent[i])
+                break;
+        if (i > anim->picnum)
+            continue;
+
+        for (i=anim->basepic ; i<=anim->picnum ; i++)
+            texturepresent[i] = 1;
+    }
+
+    for (i=0 ; i<numswitches*2 ; i++)
+        if (texturepresent[switchlist[i]])
+            texturepresent[switchlist[i^1]] = 1;
+}
+
 //
 // UTILITIES
 //
@@ -36,6 +36,10 @@ extern  int     levelTimeCount;
 // at game start
 void    P_InitPicAnims (void);
 
+// marks the frames of the animations and the switches
+// of the marked textures (R_PrecomposeLevel)
+void    P_MarkAnimatedTextures (char* texturepresent);
+
 // at map load
 void    P_SpawnSpecials (void);
 
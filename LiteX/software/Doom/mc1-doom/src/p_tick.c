@@ -125,6 +125,8 @@ void P_Ticker (void)
         return;
     }
 
+    P_ClearSightCache ();
+
     for (i=0 ; i<MAXPLAYERS ; i++)
         if (playeringame[i])
             P_PlayerThink (&players[i]);
@@ -40,7 +40,8 @@ line_t*         linedef;
 sector_t*       frontsector;
 sector_t*       backsector;
 
-drawseg_t       drawsegs[MAXDRAWSEGS];
+drawseg_t*      drawsegs;       // maxdrawsegs, allocated by R_InitPlanes
+int             maxdrawsegs;
 drawseg_t*      ds_p;
 
 void
@@ -220,8 +221,8 @@ R_ClipPassWallSegment
 void R_ClearClipSegs (void)
 {
     solidsegs[0].first = -0x7fffffff;
-    solidsegs[0].last = -1;
-    solidsegs[1].first = viewwidth;
+    solidsegs[0].last = r_stripx1-1;
+    solidsegs[1].first = r_stripx2+1;
     solidsegs[1].last = 0x7fffffff;
     newend = solidsegs+2;
 }
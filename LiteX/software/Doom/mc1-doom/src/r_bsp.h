@@ -38,7 +38,8 @@ extern boolean          markceiling;
 
 extern boolean          skymap;
 
-extern drawseg_t        drawsegs[MAXDRAWSEGS];
+extern drawseg_t*       drawsegs;
+extern int              maxdrawsegs;
 extern drawseg_t*       ds_p;
 
 extern lighttable_t**   hscalelight;
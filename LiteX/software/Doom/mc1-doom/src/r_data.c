@@ -37,6 +37,9 @@
 
 #include <stddef.h>  // For size_t
 #include <stdlib.h>
+#include <string.h>
+
+#include "m_argv.h"
 
 #include "r_data.h"
 
@@ -136,6 +139,12 @@ short**                 texturecolumnlump;
 unsigned short**        texturecolumnofs;
 byte**                  texturecomposite;
 
+// -precompose: the wall textures of the level, with all their
+// columns (texture height bytes each) one after the other,
+// built by R_PrecomposeLevel (PU_LEVEL).
+boolean                 precompose;
+byte**                  textureprecomposed;
+
 // for global animation
 int*            flattranslation;
 int*            texturetranslation;
@@ -357,6 +366,24 @@ void R_GenerateLookup (int texnum)
 //
 byte*
 R_GetColumn
+( int           tex,
+  int           col )
+{
+    col &= texturewidthmask[tex];
+
+    if (textureprecomposed[tex])
+        return textureprecomposed[tex] + col*(textureheight[tex]>>FRACBITS);
+
+    return R_GetMaskedColumn (tex, col);
+}
+
+//
+// R_GetMaskedColumn
+// The column in the patch (with its posts) when there is only
+//  one, never from the precomposed textures.
+//
+byte*
+R_GetMaskedColumn
 ( int           tex,
   int           col )
 {
@@ -456,6 +483,8 @@ void R_InitTextures (void)
     texturecolumnofs = Z_Malloc (numtextures*sizeof(*texturecolumnofs), PU_STATIC, 0);
     texturecomposite = Z_Malloc (numtextures*sizeof(*texturecomposite), PU_STATIC, 0);
     texturecompositesize = Z_Malloc (numtextures*sizeof(*texturecompositesize), PU_STATIC, 0);
+    textureprecomposed = Z_Malloc (numtextures*sizeof(*textureprecomposed), PU_STATIC, 0);
+    memset (textureprecomposed, 0, numtextures*sizeof(*textureprecomposed));
     texturewidthmask = Z_Malloc (numtextures*sizeof(*texturewidthmask), PU_STATIC, 0);
     textureheight = Z_Malloc (numtextures*sizeof(*textureheight), PU_STATIC, 0);
 
@@ -624,6 +653,7 @@ void R_InitColormaps (void)
 //
 void R_InitData (void)
 {
+    precompose = M_CheckParm ("-precompose") != 0;
     R_InitTextures ();
     printf ("\nInitTextures");
     R_InitFlats ();
@@ -809,3 +839,150 @@ void R_PrecacheLevel (void)
     free(flatpresent);
 }
 
+//
+// R_PrecomposeTexture
+// The columns with one patch are copied from the patch (the bytes
+//  that R_GetMaskedColumn points to), the other ones are composed
+//  like in R_GenerateComposite.
+//
+static void R_PrecomposeTexture (int texnum, int size)
+{
+    byte*               block;
+    texture_t*          texture;
+    texpatch_t*         patch;
+    patch_t*            realpatch;
+    column_t*           patchcol;
+    short*              collump;
+    unsigned short*     colofs;
+    int                 height;
+    int                 count;
+    int                 x;
+    int                 x1;
+    int                 x2;
+    int                 i;
+
+    texture = textures[texnum];
+    height = texture->height;
+    collump = texturecolumnlump[texnum];
+    colofs = texturecolumnofs[texnum];
+
+    block = Z_Malloc (size, PU_LEVEL, &textureprecomposed[texnum]);
+    memset (block, 0, size);
+
+    for (x=0 ; x<texture->width ; x++)
+    {
+        if (collump[x] <= 0 || collump[x] >= numlumps)
+            continue;
+        count = W_LumpLength (collump[x]) - colofs[x];
+        if (count > height)
+            count = height;
+        if (count > 0)
+            memcpy (block + x*height,
+                    (byte *)W_CacheLumpNum (collump[x], PU_CACHE) + colofs[x],
+                    count);
+    }
+
+    for (i=0 , patch = texture->patches;
+         i<texture->patchcount;
+         i++, patch++)
+    {
+        realpatch = W_CacheLumpNum (patch->patch, PU_CACHE);
+        x1 = patch->originx;
+        x2 = x1 + SHORT(realpatch->width);
+
+        if (x1<0)
+            x = 0;
+        else
+            x = x1;
+
+        if (x2 > texture->width)
+            x2 = texture->width;
+
+        for ( ; x<x2 ; x++)
+        {
+            if (collump[x] != -1)
+                continue;
+
+            patchcol = (column_t *)((byte *)realpatch
+                                    + LONG(realpatch->columnofs[x-x1]));
+            R_DrawColumnInCache (patchcol,
+                                 block + x*height,
+                                 patch->originy,
+                                 height);
+        }
+    }
+}
+
+//
+// R_PrecomposeLevel
+// With -precompose, builds the textures of the walls of the level
+//  (with their animations and switches) in the zone, so that
+//  R_GetColumn is one pointer and an offset, and there is no
+//  R_GenerateComposite during the game. The midtextures of the two
+//  sided lines are drawn with their posts, they are left out.
+//  Called by P_SetupLevel, once the PU_LEVEL blocks are freed.
+//
+#define PRECOMPOSE_KEEP         (512*1024)      // for the lumps of the level
+
+void R_PrecomposeLevel (void)
+{
+    char*               texturepresent;
+    line_t*             line;
+    side_t*             side;
+    int                 budget;
+    int                 size;
+    int                 count;
+    int                 total;
+    int                 i;
+
+    if (!precompose)
+        return;
+
+    texturepresent = malloc (numtextures);
+    memset (texturepresent, 0, numtextures);
+
+    for (i=0, line=lines ; i<numlines ; i++, line++)
+    {
+        side = &sides[line->sidenum[0]];
+        if (line->sidenum[1] == -1)
+        {
+            texturepresent[side->midtexture] = 1;
+            continue;
+        }
+        texturepresent[side->toptexture] = 1;
+        texturepresent[side->bottomtexture] = 1;
+        side = &sides[line->sidenum[1]];
+        texturepresent[side->toptexture] = 1;
+        texturepresent[side->bottomtexture] = 1;
+    }
+    texturepresent[skytexture] = 1;
+    P_MarkAnimatedTextures (texturepresent);
+
+    // Texture 0 is never drawn.
+    texturepresent[0] = 0;
+
+    budget = Z_FreeMemory () - PRECOMPOSE_KEEP;
+    count = 0;
+    total = 0;
+
+    for (i=0 ; i<numtextures ; i++)
+    {
+        if (!texturepresent[i])
+            continue;
+
+        // R_GetColumn masks the column with texturewidthmask, and
+        //  the column kernels read up to 128 bytes of it.
+        if (texturewidthmask[i]+1 != textures[i]->width)
+            continue;
+        size = textures[i]->width * textures[i]->height + 128;
+        if (total + size > budget)
+            break;
+
+        R_PrecomposeTexture (i, size);
+        count++;
+        total += size;
+    }
+
+    printf ("R_PrecomposeLevel: %i textures, %i KB\n", count, total/1024);
+    free (texturepresent);
+}
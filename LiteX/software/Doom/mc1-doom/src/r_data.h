@@ -31,10 +31,19 @@ R_GetColumn
 ( int           tex,
   int           col );
 
+// Same, with the posts of the patch (for the masked midtextures).
+byte*
+R_GetMaskedColumn
+( int           tex,
+  int           col );
+
 // I/O, setting up the stuff.
 void R_InitData (void);
 void R_PrecacheLevel (void);
 
+// Builds the textures of the level in the zone (-precompose).
+void R_PrecomposeLevel (void);
+
 // Retrieval.
 // Floor/ceiling opaque texture tiles,
 // lookup by name. For animation?
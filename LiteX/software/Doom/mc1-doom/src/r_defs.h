@@ -41,6 +41,7 @@
 #define SIL_TOP                 2
 #define SIL_BOTH                3
 
+// Default size of the drawsegs pool (scaled by R_InitPlanes).
 #define MAXDRAWSEGS             256
 
 //
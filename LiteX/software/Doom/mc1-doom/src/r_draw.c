@@ -20,9 +20,14 @@
 //
 //-----------------------------------------------------------------------------
 
+#include <stdint.h>
+#include <stdio.h>
+
 #include "doomdef.h"
 
 #include "i_system.h"
+#include "i_video.h"
+#include "m_profile.h"
 #include "z_zone.h"
 #include "w_wad.h"
 
@@ -52,8 +57,8 @@ int             scaledviewwidth;
 int             viewheight;
 int             viewwindowx;
 int             viewwindowy;
-byte*           ylookup[SCREENHEIGHT];
-int             columnofs[SCREENWIDTH];
+byte*           ylookup[SCREENHEIGHT] FASTDATA;
+int             columnofs[SCREENWIDTH] FASTDATA;
 
 // Color tables for different players,
 //  translate a limited part to another
@@ -130,6 +135,33 @@ static void R_DrawColumnKernel (byte* dst,
           [stride] "r"(stride)
         : "vl", "v1", "v2"
     );
+#elif defined(__riscv)
+    // RV32IM (no vector unit): unrolled by 4, the four texels are
+    // loaded before the four stores (that may alias src / colormap).
+    int n = count + 1;
+    while (n >= 4)
+    {
+        const byte p0 = colormap[src[(frac >> FRACBITS) & 127]];
+        frac += fracstep;
+        const byte p1 = colormap[src[(frac >> FRACBITS) & 127]];
+        frac += fracstep;
+        const byte p2 = colormap[src[(frac >> FRACBITS) & 127]];
+        frac += fracstep;
+        const byte p3 = colormap[src[(frac >> FRACBITS) & 127]];
+        frac += fracstep;
+        dst[0] = p0;
+        dst[SCREENWIDTH] = p1;
+        dst[2*SCREENWIDTH] = p2;
+        dst[3*SCREENWIDTH] = p3;
+        dst += 4*SCREENWIDTH;
+        n -= 4;
+    }
+    while (n-- > 0)
+    {
+        *dst = colormap[src[(frac >> FRACBITS) & 127]];
+        dst += SCREENWIDTH;
+        frac += fracstep;
+    }
 #else
     for (int i = count; i >= 0; --i)
     {
@@ -243,6 +275,16 @@ static void R_DrawTranslatedColumnKernel (byte* dst,
 // R_DrawSpanKernel - Implementation of the core span drawing loop.
 //
 
+#if defined(__riscv)
+static inline byte R_SpanPixel (const byte* const src,
+                                const lighttable_t* const colormap,
+                                const fixed_t xfrac,
+                                const fixed_t yfrac)
+{
+    return colormap[src[((yfrac >> (16 - 6)) & (63 * 64)) + ((xfrac >> 16) & 63)]];
+}
+#endif
+
 static void R_DrawSpanKernel (byte* dst,
                               const byte* const src,
                               const lighttable_t* const colormap,
@@ -293,6 +335,42 @@ static void R_DrawSpanKernel (byte* dst,
           [count] "r"(count)
         : "vl", "v1", "v2", "v3", "v4"
         );
+#elif defined(__riscv)
+    // RV32IM (no vector unit): unrolled by 4, the four pixels are
+    // packed in a word (little endian) and written with one store.
+    int n = count + 1;
+    while (n > 0 && ((uintptr_t)dst & 3))
+    {
+        *dst++ = R_SpanPixel (src, colormap, xfrac, yfrac);
+        xfrac += xfracstep;
+        yfrac += yfracstep;
+        --n;
+    }
+    uint32_t* dst32 = (uint32_t*)dst;
+    while (n >= 4)
+    {
+        const uint32_t p0 = R_SpanPixel (src, colormap, xfrac, yfrac);
+        xfrac += xfracstep;
+        yfrac += yfracstep;
+        const uint32_t p1 = R_SpanPixel (src, colormap, xfrac, yfrac);
+        xfrac += xfracstep;
+        yfrac += yfracstep;
+        const uint32_t p2 = R_SpanPixel (src, colormap, xfrac, yfrac);
+        xfrac += xfracstep;
+        yfrac += yfracstep;
+        const uint32_t p3 = R_SpanPixel (src, colormap, xfrac, yfrac);
+        xfrac += xfracstep;
+        yfrac += yfracstep;
+        *dst32++ = p0 | (p1 << 8) | (p2 << 16) | (p3 << 24);
+        n -= 4;
+    }
+    dst = (byte*)dst32;
+    while (n-- > 0)
+    {
+        *dst++ = R_SpanPixel (src, colormap, xfrac, yfrac);
+        xfrac += xfracstep;
+        yfrac += yfracstep;
+    }
 #else
     for (int i = count; i >= 0; --i)
     {
@@ -309,6 +387,191 @@ static void R_DrawSpanKernel (byte* dst,
 #endif
 }
 
+//
+// Direct color rendering of the view (R_SetDirectColor), for displays
+//  that take RGB565 pixels. The view buffer has viewwidth pixels per
+//  line, the colormaps are pre-combined with the palette in colormaps16
+//  (same layout as colormaps), so that there is no conversion left
+//  for I_FinishUpdate.
+//
+uint16_t*               viewimage16;
+static uint16_t*        colormaps16;
+static int              colormaps16size;
+
+static inline const uint16_t* R_Colormap16 (const lighttable_t* colormap)
+{
+    return colormaps16 + (colormap - colormaps);
+}
+
+static void R_DrawColumnKernel16 (uint16_t* dst,
+                                  const byte* const src,
+                                  const uint16_t* const colormap,
+                                  fixed_t frac,
+                                  const fixed_t fracstep,
+                                  const int count,
+                                  const int stride)
+{
+    int n = count + 1;
+#if defined(__riscv)
+    // Same as R_DrawColumnKernel.
+    while (n >= 4)
+    {
+        const uint16_t p0 = colormap[src[(frac >> FRACBITS) & 127]];
+        frac += fracstep;
+        const uint16_t p1 = colormap[src[(frac >> FRACBITS) & 127]];
+        frac += fracstep;
+        const uint16_t p2 = colormap[src[(frac >> FRACBITS) & 127]];
+        frac += fracstep;
+        const uint16_t p3 = colormap[src[(frac >> FRACBITS) & 127]];
+        frac += fracstep;
+        dst[0] = p0;
+        dst[stride] = p1;
+        dst[2*stride] = p2;
+        dst[3*stride] = p3;
+        dst += 4*stride;
+        n -= 4;
+    }
+#endif
+    while (n-- > 0)
+    {
+        *dst = colormap[src[(frac >> FRACBITS) & 127]];
+        dst += stride;
+        frac += fracstep;
+    }
+}
+
+// The fuzz colormap (6) darkens by about a fifth, the RGB565 version
+//  takes a quarter off each component.
+static int R_DrawFuzzColumnKernel16 (uint16_t* dst,
+                                     int fuzz,
+                                     const int count,
+                                     const int stride)
+{
+    for (int i = count; i >= 0; --i)
+    {
+        const uint16_t p = dst[fuzzoffset[fuzz] > 0 ? stride : -stride];
+        *dst = p - ((p >> 2) & 0x39e7);
+        dst += stride;
+
+        if (++fuzz == FUZZTABLE)
+            fuzz = 0;
+    }
+    return fuzz;
+}
+
+static void R_DrawTranslatedColumnKernel16 (uint16_t* dst,
+                                            const byte* const src,
+                                            const byte* const translation,
+                                            const uint16_t* const colormap,
+                                            fixed_t frac,
+                                            const fixed_t fracstep,
+                                            const int count,
+                                            const int stride)
+{
+    for (int i = count; i >= 0; --i)
+    {
+        *dst = colormap[translation[src[frac >> FRACBITS]]];
+        dst += stride;
+        frac += fracstep;
+    }
+}
+
+static void R_DrawSpanKernel16 (uint16_t* dst,
+                                const byte* const src,
+                                const uint16_t* const colormap,
+                                fixed_t xfrac,
+                                const fixed_t xfracstep,
+                                fixed_t yfrac,
+                                const fixed_t yfracstep,
+                                const int count)
+{
+    int n = count + 1;
+#if defined(__riscv)
+    // Two pixels per store (little endian).
+    if (n > 0 && ((uintptr_t)dst & 2))
+    {
+        *dst++ = colormap[src[((yfrac >> (16 - 6)) & (63 * 64)) + ((xfrac >> 16) & 63)]];
+        xfrac += xfracstep;
+        yfrac += yfracstep;
+        --n;
+    }
+    uint32_t* dst32 = (uint32_t*)dst;
+    while (n >= 2)
+    {
+        const uint32_t p0 = colormap[src[((yfrac >> (16 - 6)) & (63 * 64)) + ((xfrac >> 16) & 63)]];
+        xfrac += xfracstep;
+        yfrac += yfracstep;
+        const uint32_t p1 = colormap[src[((yfrac >> (16 - 6)) & (63 * 64)) + ((xfrac >> 16) & 63)]];
+        xfrac += xfracstep;
+        yfrac += yfracstep;
+        *dst32++ = p0 | (p1 << 16);
+        n -= 2;
+    }
+    dst = (uint16_t*)dst32;
+#endif
+    while (n-- > 0)
+    {
+        *dst++ = colormap[src[((yfrac >> (16 - 6)) & (63 * 64)) + ((xfrac >> 16) & 63)]];
+        xfrac += xfracstep;
+        yfrac += yfracstep;
+    }
+}
+
+//
+// R_SetDirectColor
+// Renders the view into buffer (at least viewwidth*viewheight
+//  pixels) instead of screens[0], or back into screens[0] if NULL.
+//
+void R_SetDirectColor (uint16_t* buffer)
+{
+    viewimage16 = buffer;
+}
+
+//
+// R_SetDirectPalette
+// Combines the colormaps with palette (RGB565), to be called after
+//  R_Init and each time the palette changes.
+//
+void R_SetDirectPalette (const uint16_t* palette)
+{
+    int         i;
+
+    if (!colormaps16)
+    {
+        colormaps16size = W_LumpLength (W_GetNumForName ("COLORMAP"));
+        colormaps16 = Z_Malloc (colormaps16size * sizeof(uint16_t), PU_STATIC, 0);
+    }
+
+    for (i=0 ; i<colormaps16size ; i++)
+        colormaps16[i] = palette[colormaps[i]];
+}
+
+//
+// Kernel profiling (build with -DR_PROFILE_KERNELS):
+//  cycles spent in R_DrawColumnKernel and R_DrawSpanKernel,
+//  printed and reset by R_PrintKernelProfile.
+//
+#ifdef R_PROFILE_KERNELS
+static unsigned         columncycles;
+static unsigned         columnpixels;
+static unsigned         spancycles;
+static unsigned         spanpixels;
+
+void R_PrintKernelProfile (void)
+{
+    printf ("R_DrawColumn: %u pixels, %u.%u cycles/pixel\n",
+            columnpixels,
+            columnpixels ? columncycles / columnpixels : 0,
+            columnpixels ? (10 * columncycles / columnpixels) % 10 : 0);
+    printf ("R_DrawSpan:   %u pixels, %u.%u cycles/pixel\n",
+            spanpixels,
+            spanpixels ? spancycles / spanpixels : 0,
+            spanpixels ? (10 * spancycles / spanpixels) % 10 : 0);
+    columncycles = columnpixels = 0;
+    spancycles = spanpixels = 0;
+}
+#endif
+
 //
 // R_DrawColumn
 // Source is the top of the column to scale.
@@ -351,17 +614,35 @@ void R_DrawColumn (void)
         I_Error ("R_DrawColumn: %i to %i at %i", dc_yl, dc_yh, dc_x);
 #endif
 
-    // Framebuffer destination address.
-    // Use ylookup LUT to avoid multiply with ScreenWidth.
-    // Use columnofs LUT for subwindows?
-    dest = ylookup[dc_yl] + columnofs[dc_x];
-
     // Determine scaling,
     //  which is the only mapping to be done.
     fracstep = dc_iscale;
     frac = dc_texturemid + (dc_yl-centery)*fracstep;
 
-    R_DrawColumnKernel (dest, dc_source, dc_colormap, frac, fracstep, count);
+#ifdef R_PROFILE_KERNELS
+    unsigned cycles = M_ProfileCycles ();
+#endif
+    if (viewimage16)
+    {
+        R_DrawColumnKernel16 (viewimage16 + dc_yl*viewwidth + dc_x, dc_source,
+                              R_Colormap16 (dc_colormap), frac, fracstep,
+                              count, viewwidth);
+    }
+    else
+    {
+        // Framebuffer destination address.
+        // Use ylookup LUT to avoid multiply with ScreenWidth.
+        // Use columnofs LUT for subwindows?
+        dest = ylookup[dc_yl] + columnofs[dc_x];
+
+        R_DrawColumnKernel (dest, dc_source, dc_colormap, frac, fracstep, count);
+    }
+#ifdef R_PROFILE_KERNELS
+    columncycles += M_ProfileCycles () - cycles;
+    columnpixels += count + 1;
+#endif
+
+    I_PollUpdate ();
 }
 
 //
@@ -403,6 +684,13 @@ void R_DrawFuzzColumn (void)
     }
 #endif
 
+    if (viewimage16)
+    {
+        fuzzpos = R_DrawFuzzColumnKernel16 (
+            viewimage16 + dc_yl*viewwidth + dc_x, fuzzpos, count, viewwidth);
+        return;
+    }
+
     // Does not work with blocky mode.
     dest = ylookup[dc_yl] + columnofs[dc_x];
 
@@ -442,13 +730,21 @@ void R_DrawTranslatedColumn (void)
     }
 #endif
 
-    // FIXME. As above.
-    dest = ylookup[dc_yl] + columnofs[dc_x];
-
     // Looks familiar.
     fracstep = dc_iscale;
     frac = dc_texturemid + (dc_yl-centery)*fracstep;
 
+    if (viewimage16)
+    {
+        R_DrawTranslatedColumnKernel16 (
+            viewimage16 + dc_yl*viewwidth + dc_x, dc_source, dc_translation,
+            R_Colormap16 (dc_colormap), frac, fracstep, count, viewwidth);
+        return;
+    }
+
+    // FIXME. As above.
+    dest = ylookup[dc_yl] + columnofs[dc_x];
+
     R_DrawTranslatedColumnKernel (
         dest, dc_source, dc_translation, dc_colormap, frac, fracstep, count);
 }
@@ -545,10 +841,28 @@ void R_DrawSpan (void)
     xfrac = ds_xfrac;
     yfrac = ds_yfrac;
 
-    dest = ylookup[ds_y] + columnofs[ds_x1];
+#ifdef R_PROFILE_KERNELS
+    unsigned cycles = M_ProfileCycles ();
+#endif
+    if (viewimage16)
+    {
+        R_DrawSpanKernel16 (
+            viewimage16 + ds_y*viewwidth + ds_x1, ds_source,
+            R_Colormap16 (ds_colormap), xfrac, ds_xstep, yfrac, ds_ystep, count);
+    }
+    else
+    {
+        dest = ylookup[ds_y] + columnofs[ds_x1];
+
+        R_DrawSpanKernel (
+            dest, ds_source, ds_colormap, xfrac, ds_xstep, yfrac, ds_ystep, count);
+    }
+#ifdef R_PROFILE_KERNELS
+    spancycles += M_ProfileCycles () - cycles;
+    spanpixels += count + 1;
+#endif
 
-    R_DrawSpanKernel (
-        dest, ds_source, ds_colormap, xfrac, ds_xstep, yfrac, ds_ystep, count);
+    I_PollUpdate ();
 }
 
 //
@@ -21,6 +21,8 @@
 #ifndef __R_DRAW__
 #define __R_DRAW__
 
+#include <stdint.h>
+
 extern lighttable_t*    dc_colormap;
 extern int              dc_x;
 extern int              dc_yl;
@@ -31,6 +33,10 @@ extern fixed_t          dc_texturemid;
 // first pixel in a column
 extern byte*            dc_source;
 
+// row and column offsets in the view buffer
+extern byte*            ylookup[SCREENHEIGHT];
+extern int              columnofs[SCREENWIDTH];
+
 // The span blitting interface.
 // Hook in assembler or system specific BLT
 //  here.
@@ -70,6 +76,22 @@ extern byte*            dc_translation;
 // No Sepctre effect needed.
 void    R_DrawSpan (void);
 
+// Direct color (RGB565) view buffer, NULL when the view
+//  is rendered in screens[0].
+extern uint16_t*        viewimage16;
+
+// Renders the view into buffer (viewwidth pixels per line)
+//  instead of screens[0], NULL switches back to screens[0].
+void    R_SetDirectColor (uint16_t* buffer);
+
+// Builds the RGB565 light tables from the colormaps and palette.
+void    R_SetDirectPalette (const uint16_t* palette);
+
+#ifdef R_PROFILE_KERNELS
+// Prints the cycles per pixel of the column and span kernels.
+void    R_PrintKernelProfile (void);
+#endif
+
 void
 R_InitBuffer
 ( int           width,
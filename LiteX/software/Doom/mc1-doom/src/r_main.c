@@ -25,12 +25,15 @@
 #include "doomdef.h"
 #include "d_net.h"
 
+#include "m_argv.h"
 #include "m_bbox.h"
+#include "m_profile.h"
 
 #include "r_local.h"
 #include "r_sky.h"
 
 #include "st_stuff.h"
+#include "w_wad.h"
 
 // Fineangles in the SCREENWIDTH wide window.
 #define FIELDOFVIEW             2048
@@ -82,7 +85,7 @@ int                     viewangletox[FINEANGLES/2];
 // The xtoviewangleangle[] table maps a screen pixel
 // to the lowest viewangle that maps back to x ranges
 // from clipangle to -clipangle.
-angle_t                 xtoviewangle[SCREENWIDTH+1];
+angle_t                 xtoviewangle[SCREENWIDTH+1] FASTDATA;
 
 // UNUSED.
 // The finetangentgent[angle+FINEANGLES/4] table
@@ -547,6 +550,12 @@ void R_InitLightTables (void)
 //
 boolean         setsizeneeded;
 int             setblocks;
+int             maxviewwidth;
+int             maxviewheight;
+
+int             r_numstrips = 1;
+int             r_stripx1;
+int             r_stripx2;
 
 void
 R_SetViewSize
@@ -590,6 +599,13 @@ void R_ExecuteSetViewSize (void)
         viewheight &= ~7;
     }
 
+    // Do not render more pixels than the display shows
+    //  (the bounds are multiples of 8 too).
+    if (maxviewwidth && scaledviewwidth > maxviewwidth)
+        scaledviewwidth = maxviewwidth;
+    if (maxviewheight && viewheight > maxviewheight)
+        viewheight = maxviewheight;
+
     viewwidth = scaledviewwidth;
 
     centery = viewheight/2;
@@ -646,6 +662,40 @@ void R_ExecuteSetViewSize (void)
     }
 }
 
+#ifdef FASTDATA_TABLES
+//
+// R_ReportFastData
+// Tells which lookup tables the linker put in the on-chip
+// RAM (FASTDATA), and how much of it is left.
+//
+extern byte     _efastram[], _fsram[], _esram[];
+
+static void R_ReportFastTable (const char* name, const void* table, int size)
+{
+    const byte* p = table;
+
+    printf ("\n  %-13s %6d bytes  %s", name, size,
+            (p >= _fsram && p < _esram) ? "fast RAM" : "main RAM");
+}
+
+static void R_ReportFastData (void)
+{
+    printf ("\nR_ReportFastData: %d bytes of fast RAM free",
+            (int)(_esram - _efastram));
+    R_ReportFastTable ("ylookup", ylookup, sizeof(ylookup));
+    R_ReportFastTable ("columnofs", columnofs, sizeof(columnofs));
+    R_ReportFastTable ("xtoviewangle", xtoviewangle, sizeof(xtoviewangle));
+    R_ReportFastTable ("viewangletox", viewangletox, sizeof(viewangletox));
+    R_ReportFastTable ("finetangent", finetangent, sizeof(finetangent));
+    R_ReportFastTable ("finesine", finesine, sizeof(finesine));
+    R_ReportFastTable ("colormaps", colormaps,
+                       W_LumpLength (W_GetNumForName ("COLORMAP")));
+#ifdef FASTDATA_FLAT
+    R_ReportFastTable ("planeflat", planeflat, sizeof(planeflat));
+#endif
+}
+#endif
+
 //
 // R_Init
 //
@@ -653,6 +703,8 @@ extern int      screenblocks;
 
 void R_Init (void)
 {
+    int         p;
+
     R_InitData ();
     printf ("\nR_InitData");
     R_InitPointToAngle ();
@@ -671,6 +723,19 @@ void R_Init (void)
     R_InitTranslationTables ();
     printf ("\nR_InitTranslationsTables");
 
+    p = M_CheckParm ("-viewstrips");
+    if (p && p < myargc-1)
+    {
+        r_numstrips = atoi (myargv[p+1]);
+        if (r_numstrips < 1)
+            r_numstrips = 1;
+        if (r_numstrips > MAXVIEWSTRIPS)
+            r_numstrips = MAXVIEWSTRIPS;
+    }
+#ifdef FASTDATA_TABLES
+    R_ReportFastData ();
+#endif
+
     framecount = 0;
 }
 
@@ -741,12 +806,11 @@ void R_SetupFrame (player_t* player)
 }
 
 //
-// R_RenderView
+// R_RenderStrip
+// Renders columns r_stripx1 to r_stripx2 of the view.
 //
-void R_RenderPlayerView (player_t* player)
+static void R_RenderStrip (void)
 {
-    R_SetupFrame (player);
-
     // Clear buffers.
     R_ClearClipSegs ();
     R_ClearDrawSegs ();
@@ -757,18 +821,55 @@ void R_RenderPlayerView (player_t* player)
     NetUpdate ();
 
     // The head node is the last node output.
+    M_ProfileBegin (prof_bsp);
     R_RenderBSPNode (numnodes-1);
+    M_ProfileEnd (prof_bsp);
 
     // Check for new console commands.
     NetUpdate ();
 
+    M_ProfileBegin (prof_planes);
     R_DrawPlanes ();
+    M_ProfileEnd (prof_planes);
 
     // Check for new console commands.
     NetUpdate ();
 
+    M_ProfileBegin (prof_masked);
     R_DrawMasked ();
+    M_ProfileEnd (prof_masked);
 
     // Check for new console commands.
     NetUpdate ();
 }
+
+//
+// R_RenderView
+//
+void R_RenderPlayerView (player_t* player)
+{
+    int         strip;
+
+    R_SetupFrame (player);
+
+    for (strip = 0; strip < r_numstrips; strip++)
+    {
+        r_stripx1 = strip * viewwidth / r_numstrips;
+        r_stripx2 = (strip+1) * viewwidth / r_numstrips - 1;
+
+        // Each strip adds the things of the sectors it sees.
+        if (strip)
+            validcount++;
+
+        R_RenderStrip ();
+    }
+
+#ifdef R_PROFILE_KERNELS
+    static int profileframes;
+    if (++profileframes == TICRATE)
+    {
+        profileframes = 0;
+        R_PrintKernelProfile ();
+    }
+#endif
+}
@@ -35,6 +35,21 @@ extern int              viewheight;
 extern int              viewwindowx;
 extern int              viewwindowy;
 
+// Upper bound of the view size (0 = no bound), set by the video
+// driver of small displays before the first frame.
+extern int              maxviewwidth;
+extern int              maxviewheight;
+
+// Columns of the view rendered by the current pass (inclusive). The
+// view is rendered as r_numstrips vertical strips, each one with its own
+// BSP traversal, planes and sprites (-viewstrips n, default 1: the whole
+// view in one pass). The strips share nothing but the frame buffer, this
+// is the split a renderer running one strip per hart would use.
+#define MAXVIEWSTRIPS           4
+extern int              r_numstrips;
+extern int              r_stripx1;
+extern int              r_stripx2;
+
 extern int              centerx;
 extern int              centery;
 
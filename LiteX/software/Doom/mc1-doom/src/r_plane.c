@@ -25,6 +25,7 @@
 #include "i_system.h"
 #include "z_zone.h"
 #include "w_wad.h"
+#include "m_argv.h"
 
 #include "doomdef.h"
 #include "doomstat.h"
@@ -40,17 +41,31 @@ planefunction_t         ceilingfunc;
 //
 
 // Here comes the obnoxious "visplane".
+// The pools are allocated in the zone by R_InitPlanes, the MAX* are the
+// default sizes.
 #define MAXVISPLANES    128
-visplane_t              visplanes[MAXVISPLANES];
+visplane_t*             visplanes;
+int                     maxvisplanes;
 visplane_t*             lastvisplane;
 visplane_t*             floorplane;
 visplane_t*             ceilingplane;
 
+// The visplanes in drawing order (R_SortPlanes).
+static visplane_t**     sortedplanes;
+
 // ?
 #define MAXOPENINGS     SCREENWIDTH*64
-short                   openings[MAXOPENINGS];
+short*                  openings;
+int                     maxopenings;
 short*                  lastopening;
 
+// High water marks of the pools, and number of frames that filled them
+// (R_ReportPools).
+static int              maxusedvisplanes, maxuseddrawsegs;
+static int              maxusedopenings, maxusedvissprites;
+static int              fullvisplanes, fulldrawsegs;
+static int              fullopenings, fullvissprites;
+
 //
 // Clip values are the solid pixel bounding the range.
 //  floorclip starts out SCREENHEIGHT
@@ -82,13 +97,84 @@ fixed_t                 cacheddistance[SCREENHEIGHT];
 fixed_t                 cachedxstep[SCREENHEIGHT];
 fixed_t                 cachedystep[SCREENHEIGHT];
 
+//
+// The flat being drawn, copied to the on-chip RAM (FASTDATA_FLAT).
+// It stays there from one frame to the next, planeflatlump tells
+// which one it is.
+//
+#ifdef FASTDATA_FLAT
+byte                    planeflat[64*64] FASTFLAT;
+static int              planeflatlump = -1;
+#endif
+
 //
 // R_InitPlanes
 // Only at game startup.
+// Allocates the visplanes, openings, drawsegs and vissprites pools.
+// They have the default sizes (MAXVISPLANES, MAXOPENINGS, MAXDRAWSEGS,
+// MAXVISSPRITES, for the render resolution) multiplied by the same
+// factor, so that they take 1/R_POOLS_ZONE_PART of the zone, between
+// 1/2 and R_POOLS_MAXSCALE/4 times the default sizes.
+// -poolscale n (in quarters) overrides it.
 //
+#define R_POOLS_ZONE_PART   8
+#define R_POOLS_MAXSCALE    16
+
+#define R_POOLS_DEFAULT_SIZE                                    \
+    (MAXVISPLANES * sizeof(visplane_t)                          \
+     + MAXOPENINGS * sizeof(short)                              \
+     + MAXDRAWSEGS * sizeof(drawseg_t)                          \
+     + MAXVISSPRITES * sizeof(vissprite_t))
+
 void R_InitPlanes (void)
 {
-  // Doh!
+    int         scale;
+    int         p;
+
+    scale = (int)(4ULL * Z_ZoneSize () / R_POOLS_ZONE_PART
+                  / R_POOLS_DEFAULT_SIZE);
+    if (scale > R_POOLS_MAXSCALE)
+        scale = R_POOLS_MAXSCALE;
+    if (scale < 2)
+        scale = 2;
+
+    p = M_CheckParm ("-poolscale");
+    if (p && p < myargc-1)
+        scale = atoi (myargv[p+1]) > 0 ? atoi (myargv[p+1]) : scale;
+
+    maxvisplanes = MAXVISPLANES * scale / 4;
+    maxopenings = MAXOPENINGS * scale / 4;
+    maxdrawsegs = MAXDRAWSEGS * scale / 4;
+    maxvissprites = MAXVISSPRITES * scale / 4;
+
+    visplanes = Z_Malloc (maxvisplanes * sizeof(visplane_t), PU_STATIC, NULL);
+    openings = Z_Malloc (maxopenings * sizeof(short), PU_STATIC, NULL);
+    drawsegs = Z_Malloc (maxdrawsegs * sizeof(drawseg_t), PU_STATIC, NULL);
+    vissprites = Z_Malloc (maxvissprites * sizeof(vissprite_t), PU_STATIC, NULL);
+    sortedplanes = Z_Malloc (maxvisplanes * sizeof(visplane_t*),
+                             PU_STATIC, NULL);
+
+    printf ("\nR_InitPlanes: %i visplanes, %i openings, %i drawsegs, "
+            "%i vissprites (%i KB)",
+            maxvisplanes, maxopenings, maxdrawsegs, maxvissprites,
+            (int)(R_POOLS_DEFAULT_SIZE * scale / 4 / 1024));
+}
+
+//
+// R_ReportPools
+// Prints the high water marks of the pools.
+//
+void R_ReportPools (void)
+{
+    printf ("R_ReportPools: used/size (frames at the limit)\n");
+    printf ("  visplanes  %6i/%-6i (%i)\n",
+            maxusedvisplanes, maxvisplanes, fullvisplanes);
+    printf ("  openings   %6i/%-6i (%i)\n",
+            maxusedopenings, maxopenings, fullopenings);
+    printf ("  drawsegs   %6i/%-6i (%i)\n",
+            maxuseddrawsegs, maxdrawsegs, fulldrawsegs);
+    printf ("  vissprites %6i/%-6i (%i)\n",
+            maxusedvissprites, maxvissprites, fullvissprites);
 }
 
 //
@@ -224,8 +310,9 @@ R_FindPlane
     if (check < lastvisplane)
         return check;
 
-    if (lastvisplane - visplanes == MAXVISPLANES)
-        I_Error ("R_FindPlane: no more visplanes");
+    if (lastvisplane - visplanes == maxvisplanes)
+        I_Error ("R_FindPlane: no more visplanes (%i, see -poolscale)",
+                 maxvisplanes);
 
     lastvisplane++;
 
@@ -338,6 +425,111 @@ R_MakeSpans
     }
 }
 
+//
+// R_PlaneBefore
+// Drawing order of the visplanes: by flat, then height, then light.
+// The planes of a flat are drawn one after the other (it is loaded
+// once), and so are the ones at the same height (the per row
+// distances and steps of R_MapPlane are computed once).
+//
+static boolean R_PlaneBefore (const visplane_t* a, const visplane_t* b)
+{
+    if (a->picnum != b->picnum)
+        return a->picnum < b->picnum;
+    if (a->height != b->height)
+        return a->height < b->height;
+    return a->lightlevel < b->lightlevel;
+}
+
+//
+// R_SortPlanes
+// Insertion sort of the non-empty visplanes in sortedplanes,
+// returns their number.
+//
+static int R_SortPlanes (void)
+{
+    visplane_t*         pl;
+    int                 count;
+    int                 i;
+
+    count = 0;
+    for (pl = visplanes ; pl < lastvisplane ; pl++)
+    {
+        if (pl->minx > pl->maxx)
+            continue;
+
+        for (i = count ; i > 0 && R_PlaneBefore (pl, sortedplanes[i-1]) ; i--)
+            sortedplanes[i] = sortedplanes[i-1];
+        sortedplanes[i] = pl;
+        count++;
+    }
+    return count;
+}
+
+//
+// R_MergePlanes
+// R_CheckPlane starts a new visplane with the same flat, height and
+// light when the columns of a seg are already used. The ones that do
+// not share a column with a previous one (next to it, or split from
+// another one) are merged back into it, so that the spans that cross
+// the boundary between them are drawn as one.
+// Merged planes are left empty (minx > maxx).
+//
+static void R_MergePlanes (int count)
+{
+    visplane_t*         pl;
+    visplane_t*         check;
+    int                 i;
+    int                 j;
+    int                 x;
+    int                 x1;
+    int                 x2;
+
+    for (i = 0 ; i < count ; i++)
+    {
+        pl = sortedplanes[i];
+        if (pl->minx > pl->maxx)
+            continue;
+
+        for (j = i+1 ; j < count ; j++)
+        {
+            check = sortedplanes[j];
+            if (check->picnum != pl->picnum
+                || check->height != pl->height
+                || check->lightlevel != pl->lightlevel)
+                break;
+
+            if (check->minx > check->maxx)
+                continue;
+
+            x1 = check->minx > pl->minx ? check->minx : pl->minx;
+            x2 = check->maxx < pl->maxx ? check->maxx : pl->maxx;
+            for (x = x1 ; x <= x2 ; x++)
+                if (pl->top[x] != 0xffffu && check->top[x] != 0xffffu)
+                    break;
+
+            if (x <= x2)
+                continue;
+
+            for (x = check->minx ; x <= check->maxx ; x++)
+            {
+                if (check->top[x] != 0xffffu)
+                {
+                    pl->top[x] = check->top[x];
+                    pl->bottom[x] = check->bottom[x];
+                }
+            }
+            if (check->minx < pl->minx)
+                pl->minx = check->minx;
+            if (check->maxx > pl->maxx)
+                pl->maxx = check->maxx;
+
+            check->minx = SCREENWIDTH;
+            check->maxx = -1;
+        }
+    }
+}
+
 //
 // R_DrawPlanes
 // At the end of each frame.
@@ -351,23 +543,58 @@ void R_DrawPlanes (void)
     int                 x;
     int                 stop;
     int                 angle;
+    int                 used;
+    int                 count;
+    int                 i;
+    int                 lump;
+    int                 planelump;
 
 #ifdef RANGECHECK
-    if (ds_p - drawsegs > MAXDRAWSEGS)
+    if (ds_p - drawsegs > maxdrawsegs)
         I_Error ("R_DrawPlanes: drawsegs overflow (%i)",
                  ds_p - drawsegs);
 
-    if (lastvisplane - visplanes > MAXVISPLANES)
+    if (lastvisplane - visplanes > maxvisplanes)
         I_Error ("R_DrawPlanes: visplane overflow (%i)",
                  lastvisplane - visplanes);
 
-    if (lastopening - openings > MAXOPENINGS)
+    if (lastopening - openings > maxopenings)
         I_Error ("R_DrawPlanes: opening overflow (%i)",
                  lastopening - openings);
 #endif
 
-    for (pl = visplanes ; pl < lastvisplane ; pl++)
+    // high water marks (the BSP traversal is finished, all the
+    // drawsegs, openings and vissprites of the frame are there)
+    used = lastvisplane - visplanes;
+    if (used > maxusedvisplanes)
+        maxusedvisplanes = used;
+    if (used == maxvisplanes)
+        fullvisplanes++;
+    used = lastopening - openings;
+    if (used > maxusedopenings)
+        maxusedopenings = used;
+    if (used > maxopenings - 3*viewwidth)
+        fullopenings++;
+    used = ds_p - drawsegs;
+    if (used > maxuseddrawsegs)
+        maxuseddrawsegs = used;
+    if (used == maxdrawsegs)
+        fulldrawsegs++;
+    used = vissprite_p - vissprites;
+    if (used > maxusedvissprites)
+        maxusedvissprites = used;
+    if (used == maxvissprites)
+        fullvissprites++;
+
+    count = R_SortPlanes ();
+    R_MergePlanes (count);
+
+    // flat of the previous plane, still cached (PU_STATIC)
+    lump = -1;
+
+    for (i = 0 ; i < count ; i++)
     {
+        pl = sortedplanes[i];
         if (pl->minx > pl->maxx)
             continue;
 
@@ -399,9 +626,24 @@ void R_DrawPlanes (void)
         }
 
         // regular flat
-        ds_source = W_CacheLumpNum(firstflat +
-                                   flattranslation[pl->picnum],
-                                   PU_STATIC);
+        planelump = firstflat + flattranslation[pl->picnum];
+        if (planelump != lump)
+        {
+#ifdef FASTDATA_FLAT
+            if (planelump != planeflatlump)
+            {
+                memcpy (planeflat, W_CacheLumpNum (planelump, PU_CACHE),
+                        sizeof(planeflat));
+                planeflatlump = planelump;
+            }
+            ds_source = planeflat;
+#else
+            if (lump != -1)
+                Z_ChangeTag (ds_source, PU_CACHE);
+            ds_source = W_CacheLumpNum (planelump, PU_STATIC);
+#endif
+            lump = planelump;
+        }
 
         planeheight = abs(pl->height-viewz);
         light = (pl->lightlevel >> LIGHTSEGSHIFT)+extralight;
@@ -426,7 +668,10 @@ void R_DrawPlanes (void)
                         pl->top[x],
                         pl->bottom[x]);
         }
+    }
 
+#ifndef FASTDATA_FLAT
+    if (lump != -1)
         Z_ChangeTag (ds_source, PU_CACHE);
-    }
+#endif
 }
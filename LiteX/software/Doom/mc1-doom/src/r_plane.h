@@ -24,6 +24,8 @@
 #include "r_data.h"
 
 // Visplane related.
+extern  short*          openings;
+extern  int             maxopenings;
 extern  short*          lastopening;
 
 typedef void (*planefunction_t) (int top, int bottom);
@@ -37,7 +39,12 @@ extern short            ceilingclip[SCREENWIDTH];
 extern fixed_t          yslope[SCREENHEIGHT];
 extern fixed_t          distscale[SCREENWIDTH];
 
+#ifdef FASTDATA_FLAT
+extern byte             planeflat[64*64];
+#endif
+
 void R_InitPlanes (void);
+void R_ReportPools (void);
 void R_ClearPlanes (void);
 
 void
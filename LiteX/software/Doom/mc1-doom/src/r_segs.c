@@ -163,7 +163,7 @@ R_RenderMaskedSegRange
 
             // draw the texture
             col = (column_t *)(
-                (byte *)R_GetColumn(texnum,maskedtexturecol[dc_x]) -3);
+                (byte *)R_GetMaskedColumn(texnum,maskedtexturecol[dc_x]) -3);
 
             R_DrawMaskedColumn (col);
             maskedtexturecol[dc_x] = MAXSHORT;
@@ -360,8 +360,10 @@ R_StoreWallRange
     fixed_t             vtop;
     int                 lightnum;
 
-    // don't overflow and crash
-    if (ds_p == &drawsegs[MAXDRAWSEGS])
+    // don't overflow and crash (a wall range takes up to three
+    // openings per column: masked texture, top and bottom clips)
+    if (ds_p == drawsegs + maxdrawsegs
+        || lastopening - openings + 3*(stop-start+1) > maxopenings)
         return;
 
 #ifdef RANGECHECK
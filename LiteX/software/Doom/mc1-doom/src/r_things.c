@@ -20,11 +20,13 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "doomdef.h"
 #include "m_swap.h"
 
 #include "i_system.h"
+#include "m_profile.h"
 #include "z_zone.h"
 #include "w_wad.h"
 
@@ -263,7 +265,8 @@ void R_InitSpriteDefs (char** namelist)
 //
 // GAME FUNCTIONS
 //
-vissprite_t     vissprites[MAXVISSPRITES];
+vissprite_t*    vissprites;     // maxvissprites, allocated by R_InitPlanes
+int             maxvissprites;
 vissprite_t*    vissprite_p;
 int             newvissprite;
 
@@ -299,7 +302,7 @@ vissprite_t     overflowsprite;
 
 vissprite_t* R_NewVisSprite (void)
 {
-    if (vissprite_p == &vissprites[MAXVISSPRITES])
+    if (vissprite_p == vissprites + maxvissprites)
         return &overflowsprite;
 
     vissprite_p++;
@@ -505,14 +508,14 @@ void R_ProjectSprite (mobj_t* thing)
     x1 = (centerxfrac + FixedMul (tx,xscale) ) >>FRACBITS;
 
     // off the right side?
-    if (x1 > viewwidth)
+    if (x1 > r_stripx2)
         return;
 
     tx +=  spritewidth[lump];
     x2 = ((centerxfrac + FixedMul (tx,xscale) ) >>FRACBITS) - 1;
 
     // off the left side
-    if (x2 < 0)
+    if (x2 < r_stripx1)
         return;
 
     // store information in a vissprite
@@ -524,8 +527,8 @@ void R_ProjectSprite (mobj_t* thing)
     vis->gz = thing->z;
     vis->gzt = thing->z + spritetopoffset[lump];
     vis->texturemid = vis->gzt - viewz;
-    vis->x1 = x1 < 0 ? 0 : x1;
-    vis->x2 = x2 >= viewwidth ? viewwidth-1 : x2;
+    vis->x1 = x1 < r_stripx1 ? r_stripx1 : x1;
+    vis->x2 = x2 > r_stripx2 ? r_stripx2 : x2;
     iscale = FixedDiv (FRACUNIT, xscale);
 
     if (flip)
@@ -644,22 +647,22 @@ void R_DrawPSprite (pspdef_t* psp)
     x1 = (centerxfrac + FixedMul (tx,pspritescale) ) >>FRACBITS;
 
     // off the right side
-    if (x1 > viewwidth)
+    if (x1 > r_stripx2)
         return;
 
     tx +=  spritewidth[lump];
     x2 = ((centerxfrac + FixedMul (tx, pspritescale) ) >>FRACBITS) - 1;
 
     // off the left side
-    if (x2 < 0)
+    if (x2 < r_stripx1)
         return;
 
     // store information in a vissprite
     vis = &avis;
     vis->mobjflags = 0;
     vis->texturemid = (BASEYCENTER*FRACUNIT)+FRACUNIT/2-(psp->sy-spritetopoffset[lump]);
-    vis->x1 = x1 < 0 ? 0 : x1;
-    vis->x2 = x2 >= viewwidth ? viewwidth-1 : x2;
+    vis->x1 = x1 < r_stripx1 ? r_stripx1 : x1;
+    vis->x2 = x2 > r_stripx2 ? r_stripx2 : x2;
     vis->scale = pspritescale;
 
     if (flip)
@@ -743,54 +746,104 @@ void R_DrawPlayerSprites (void)
 //
 vissprite_t     vsprsortedhead;
 
+// Below that, insertion sort instead of the radix sort.
+#define SORT_INSERTION_MAX      16
+
+// R_SortVisSprites buffers, two times maxvissprites.
+static vissprite_t**    sortbuf;
+
+//
+// Back to front (increasing scale), and in the order of the vissprites
+// array for the same scale, as the selection sort of the original
+// code. Radix sort on the scale, 8 bits per pass, the passes where
+// all the scales have the same byte are skipped.
+//
 void R_SortVisSprites (void)
 {
     int                 i;
     int                 count;
-    vissprite_t*        ds;
-    vissprite_t*        best;
-    vissprite_t         unsorted;
-    fixed_t             bestscale;
+    int                 shift;
+    vissprite_t**       src;
+    vissprite_t**       dst;
+    vissprite_t**       tmp;
+    vissprite_t*        prev;
+    int                 bucket[256];
 
     count = vissprite_p - vissprites;
 
-    unsorted.next = unsorted.prev = &unsorted;
+    vsprsortedhead.next = vsprsortedhead.prev = &vsprsortedhead;
 
     if (!count)
         return;
 
-    for (ds=vissprites ; ds<vissprite_p ; ds++)
-    {
-        ds->next = ds+1;
-        ds->prev = ds-1;
-    }
+    M_ProfileBegin (prof_sprsort);
 
-    vissprites[0].prev = &unsorted;
-    unsorted.next = &vissprites[0];
-    (vissprite_p-1)->next = &unsorted;
-    unsorted.prev = vissprite_p-1;
+    if (!sortbuf)
+        sortbuf = Z_Malloc (2 * maxvissprites * sizeof(*sortbuf), PU_STATIC, NULL);
 
-    // pull the vissprites out by scale
-    best = 0;           // shut up the compiler warning
-    vsprsortedhead.next = vsprsortedhead.prev = &vsprsortedhead;
+    src = sortbuf;
+    dst = sortbuf + maxvissprites;
     for (i=0 ; i<count ; i++)
+        src[i] = vissprites + i;
+
+    if (count <= SORT_INSERTION_MAX)
     {
-        bestscale = MAXINT;
-        for (ds=unsorted.next ; ds!= &unsorted ; ds=ds->next)
+        for (i=1 ; i<count ; i++)
         {
-            if (ds->scale < bestscale)
+            vissprite_t*    spr = src[i];
+            int             j = i;
+
+            while (j > 0 && src[j-1]->scale > spr->scale)
             {
-                bestscale = ds->scale;
-                best = ds;
+                src[j] = src[j-1];
+                j--;
             }
+            src[j] = spr;
         }
-        best->next->prev = best->prev;
-        best->prev->next = best->next;
-        best->next = &vsprsortedhead;
-        best->prev = vsprsortedhead.prev;
-        vsprsortedhead.prev->next = best;
-        vsprsortedhead.prev = best;
     }
+    else
+    {
+        // the scales are compared as signed numbers
+        for (shift=0 ; shift<32 ; shift+=8)
+        {
+            unsigned    flip = shift == 24 ? 0x80 : 0;
+            int         sum;
+
+            memset (bucket, 0, sizeof(bucket));
+            for (i=0 ; i<count ; i++)
+                bucket[((src[i]->scale >> shift) & 255) ^ flip]++;
+
+            if (bucket[((src[0]->scale >> shift) & 255) ^ flip] == count)
+                continue;
+
+            sum = 0;
+            for (i=0 ; i<256 ; i++)
+            {
+                int n = bucket[i];
+                bucket[i] = sum;
+                sum += n;
+            }
+
+            for (i=0 ; i<count ; i++)
+                dst[bucket[((src[i]->scale >> shift) & 255) ^ flip]++] = src[i];
+
+            tmp = src;
+            src = dst;
+            dst = tmp;
+        }
+    }
+
+    prev = &vsprsortedhead;
+    for (i=0 ; i<count ; i++)
+    {
+        prev->next = src[i];
+        src[i]->prev = prev;
+        prev = src[i];
+    }
+    prev->next = &vsprsortedhead;
+    vsprsortedhead.prev = prev;
+
+    M_ProfileEnd (prof_sprsort);
 }
 
 //
@@ -21,9 +21,11 @@
 #ifndef __R_THINGS__
 #define __R_THINGS__
 
+// Default size of the vissprites pool (scaled by R_InitPlanes).
 #define MAXVISSPRITES   128
 
-extern vissprite_t      vissprites[MAXVISSPRITES];
+extern vissprite_t*     vissprites;
+extern int              maxvissprites;
 extern vissprite_t*     vissprite_p;
 extern vissprite_t      vsprsortedhead;
 
@@ -49,6 +49,15 @@ int                     numlumps;
 
 void**                  lumpcache;
 
+// Hash index of the lump names, built by W_InitMultipleFiles:
+//  lumphash[hash & lumphashmask] is the first lump of a chain,
+//  lumpnext[lump] the next one, -1 at the end. The chains are in
+//  decreasing lump order, so that later files take precedence
+//  (as with the backwards linear scan).
+static int*             lumphash;
+static int*             lumpnext;
+static unsigned         lumphashmask;
+
 static void strtoupper (char* s)
 {
     while (*s) { *s = toupper(*s); s++; }
@@ -271,6 +280,50 @@ void W_Reload (void)
     close (handle);
 }
 
+//
+// W_LumpNameHash
+// Hash of a lump name, packed in two integers.
+//
+static unsigned W_LumpNameHash (int v1, int v2)
+{
+    unsigned h = (unsigned)v1 ^ ((unsigned)v2 << 7 | (unsigned)v2 >> 25);
+    h ^= h >> 16;
+    h ^= h >> 8;
+    return h;
+}
+
+//
+// W_InitLumpHash
+//
+static void W_InitLumpHash (void)
+{
+    int         i;
+    unsigned    size;
+
+    for (size = 1 ; size < (unsigned)numlumps ; size <<= 1)
+        ;
+
+    free (lumphash);
+    free (lumpnext);
+    lumphash = malloc (size * sizeof(*lumphash));
+    lumpnext = malloc (numlumps * sizeof(*lumpnext));
+
+    if (!lumphash || !lumpnext)
+        I_Error ("Couldn't allocate lump hash");
+
+    lumphashmask = size - 1;
+    memset (lumphash, -1, size * sizeof(*lumphash));
+
+    for (i=0 ; i<numlumps ; i++)
+    {
+        unsigned h = W_LumpNameHash (*(int *)lumpinfo[i].name,
+                                     *(int *)&lumpinfo[i].name[4])
+                     & lumphashmask;
+        lumpnext[i] = lumphash[h];
+        lumphash[h] = i;
+    }
+}
+
 //
 // W_InitMultipleFiles
 // Pass a null terminated list of files to use.
@@ -308,6 +361,8 @@ void W_InitMultipleFiles (char** filenames)
         I_Error ("Couldn't allocate lumpcache");
 
     memset (lumpcache,0, size);
+
+    W_InitLumpHash ();
 }
 
 //
@@ -346,6 +401,7 @@ int W_CheckNumForName (const char* name)
 
     int         v1;
     int         v2;
+    int         i;
     lumpinfo_t* lump_p;
 
     // make the name into two integers for easy compares
@@ -360,15 +416,17 @@ int W_CheckNumForName (const char* name)
     v1 = name8.x[0];
     v2 = name8.x[1];
 
-    // scan backwards so patch lump files take precedence
-    lump_p = lumpinfo + numlumps;
-
-    while (lump_p-- != lumpinfo)
+    // the chain is in decreasing lump order,
+    //  so patch lump files take precedence
+    for (i = lumphash[W_LumpNameHash (v1, v2) & lumphashmask] ;
+         i != -1 ;
+         i = lumpnext[i])
     {
+        lump_p = lumpinfo + i;
         if ( *(int *)lump_p->name == v1
              && *(int *)&lump_p->name[4] == v2)
         {
-            return lump_p - lumpinfo;
+            return i;
         }
     }
 
@@ -475,6 +533,78 @@ W_CacheLumpNum
     return lumpcache[lump];
 }
 
+//
+// W_PreloadLumps
+// One read instead of a seek and a read per lump (each one is a
+//  command round trip on an SD card). The read is aligned on 512
+//  bytes sectors. Nothing is done if the lumps are not from the
+//  same file, or not (almost) contiguous in it: W_CacheLumpNum
+//  will read them one by one.
+//
+#define WAD_SECTOR      512
+
+void W_PreloadLumps (int first, int count)
+{
+    int         i;
+    int         start;
+    int         end;
+    int         total;
+    int         c;
+    int         handle;
+    byte*       buffer;
+    lumpinfo_t* l;
+
+    if (first < 0 || first+count > numlumps)
+        I_Error ("W_PreloadLumps: %i+%i > numlumps",first,count);
+
+    handle = lumpinfo[first].handle;
+    start = INT_MAX;
+    end = 0;
+    total = 0;
+
+    for (i=first ; i<first+count ; i++)
+    {
+        l = lumpinfo+i;
+        if (l->handle != handle || handle == -1)
+            return;
+        if (lumpcache[i] || !l->size)
+            continue;
+        if (l->position < start)
+            start = l->position;
+        if (l->position + l->size > end)
+            end = l->position + l->size;
+        total += l->size;
+    }
+
+    if (!total || end - start > 2*total)
+        return;
+
+    start &= ~(WAD_SECTOR-1);
+    end = (end + WAD_SECTOR-1) & ~(WAD_SECTOR-1);
+
+    buffer = Z_Malloc (end - start, PU_STATIC, NULL);
+
+    lseek (handle, start, SEEK_SET);
+    c = read (handle, buffer, end - start);
+
+    for (i=first ; i<first+count ; i++)
+    {
+        l = lumpinfo+i;
+        if (lumpcache[i] || !l->size)
+            continue;
+
+        // the last sector may be cut by the end of the file
+        if (l->position + l->size > start + c)
+            I_Error ("W_PreloadLumps: only read %i of %i bytes",
+                     c,end-start);
+
+        Z_Malloc (l->size, PU_CACHE, &lumpcache[i]);
+        memcpy (lumpcache[i], buffer + l->position - start, l->size);
+    }
+
+    Z_Free (buffer);
+}
+
 //
 // W_CacheLumpName
 //
@@ -66,6 +66,10 @@ int     W_LumpLength (int lump);
 void    W_ReadLump (int lump, void *dest);
 
 void*   W_CacheLumpNum (int lump, int tag);
+
+// Reads lumps first..first+count-1 into the cache (PU_CACHE)
+//  with a single read, if they are contiguous in the same file.
+void    W_PreloadLumps (int first, int count);
 void*   W_CacheLumpName (const char *name, int tag);
 
 #endif  // __W_WAD__
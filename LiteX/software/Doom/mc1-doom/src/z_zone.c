@@ -34,10 +34,30 @@
 // It is of no value to free a cachable block,
 //  because it will get overwritten automatically if needed.
 //
+// Small blocks (up to ZONE_CLASS_MAX bytes of user data) that are
+//  freed by Z_Free go to a free list per size class instead, where
+//  Z_Malloc takes them back in O(1). Blocks on a free list stay in
+//  the block list (tag PU_FREELIST, unowned), and being purgable,
+//  the rover frees them for real when it needs the memory.
+//
 
 #define ZONEID    0x1d4a11
 #define ZONEGUARD 0xc001beef
 
+#define ZONE_CLASS_SHIFT  5     // 32 bytes per size class
+#define ZONE_CLASSES      16
+#define ZONE_CLASS_MAX    (ZONE_CLASSES << ZONE_CLASS_SHIFT)
+#define PU_FREELIST       (PU_CACHE+1)
+
+// Links of a block on a free list, stored in the user data.
+typedef struct
+{
+    memblock_t* next;
+    memblock_t* prev;
+} freelink_t;
+
+#define FREELINK(block) ((freelink_t*)((byte*)(block) + sizeof(memblock_t)))
+
 typedef struct
 {
     // total bytes malloced, including header
@@ -52,6 +72,14 @@ typedef struct
 
 memzone_t*      mainzone;
 
+static memblock_t*      freelists[ZONE_CLASSES];
+
+// Allocation statistics, see Z_FreeMemory.
+static unsigned         nbmallocs;
+static unsigned         nbfreelistmallocs;
+static unsigned         nbfreelistfrees;
+static unsigned         nbroversteps;
+
 #ifdef ZONE_DEBUG
 static void
 Z_CheckBlockIntegrity (const memblock_t* block)
@@ -87,6 +115,44 @@ void Z_ClearZone (memzone_t* zone)
     block->user = NULL;
 
     block->size = zone->size - sizeof(memzone_t);
+
+    memset (freelists, 0, sizeof(freelists));
+}
+
+//
+// Z_SizeClass
+// The free list that takes a block, -1 if too large.
+//
+static int Z_SizeClass (const memblock_t* block)
+{
+    int c = ((block->size - (int)sizeof(memblock_t)) >> ZONE_CLASS_SHIFT) - 1;
+    return c < ZONE_CLASSES ? c : -1;
+}
+
+static void Z_FreeListRemove (memblock_t* block)
+{
+    freelink_t* link = FREELINK (block);
+    if (link->prev)
+        FREELINK (link->prev)->next = link->next;
+    else
+        freelists[Z_SizeClass (block)] = link->next;
+    if (link->next)
+        FREELINK (link->next)->prev = link->prev;
+}
+
+static void Z_FreeListPush (memblock_t* block)
+{
+    int c = Z_SizeClass (block);
+    freelink_t* link = FREELINK (block);
+    link->prev = NULL;
+    link->next = freelists[c];
+    if (link->next)
+        FREELINK (link->next)->prev = block;
+    freelists[c] = block;
+
+    // in use (for the block list), unowned and purgable
+    block->user = (void *)1;
+    block->tag = PU_FREELIST;
 }
 
 //
@@ -100,12 +166,12 @@ void Z_Init (void)
     mainzone = (memzone_t *)I_ZoneBase (&size);
     if (mainzone == NULL)
         I_Error ("Z_Init: Out of memory (tried to allocate %d bytes", size);
-    mainzone->size = size;
-
 #ifdef ZONE_DEBUG
     memset (mainzone, 0x55, size);
 #endif
 
+    mainzone->size = size;
+
     // set the entire zone to one free block
     mainzone->blocklist.next =
         mainzone->blocklist.prev =
@@ -124,21 +190,20 @@ void Z_Init (void)
 #ifdef ZONE_DEBUG
     block->guard1 = block->guard2 = ZONEGUARD;
 #endif
+
+    memset (freelists, 0, sizeof(freelists));
 }
 
 //
-// Z_Free
+// Z_FreeBlock
+// Returns the block to the zone (merged with its free neighbours).
 //
-void Z_Free (void* ptr)
+static void Z_FreeBlock (memblock_t* block)
 {
-    memblock_t*         block;
     memblock_t*         other;
 
-    block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
-    Z_CheckBlockIntegrity (block);
-
-    if (block->id != ZONEID)
-        I_Error ("Z_Free: freed a pointer without ZONEID");
+    if (block->tag == PU_FREELIST)
+        Z_FreeListRemove (block);
 
     if (block->user > (void **)0x100)
     {
@@ -182,6 +247,35 @@ void Z_Free (void* ptr)
     }
 }
 
+//
+// Z_Free
+//
+void Z_Free (void* ptr)
+{
+    memblock_t*         block;
+
+    block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
+    Z_CheckBlockIntegrity (block);
+
+    if (block->id != ZONEID)
+        I_Error ("Z_Free: freed a pointer without ZONEID");
+
+    if (block->tag == PU_FREELIST)
+        I_Error ("Z_Free: freed a block twice");
+
+    if (Z_SizeClass (block) < 0)
+    {
+        Z_FreeBlock (block);
+        return;
+    }
+
+    if (block->user > (void **)0x100)
+        *block->user = 0;
+
+    Z_FreeListPush (block);
+    ++nbfreelistfrees;
+}
+
 //
 // Z_Malloc
 // You can pass a NULL user if the tag is < PU_PURGELEVEL.
@@ -202,6 +296,24 @@ Z_Malloc
 
     size = (size + (int)sizeof(size_t) - 1) & ~((int)sizeof(size_t) - 1);
 
+    ++nbmallocs;
+
+    // small blocks: rounded to their size class, so that
+    //  they get back to the right free list when freed
+    if (size <= ZONE_CLASS_MAX)
+    {
+        if (size == 0)
+            size = 1;
+        size = (size + (1 << ZONE_CLASS_SHIFT) - 1) & ~((1 << ZONE_CLASS_SHIFT) - 1);
+        base = freelists[(size >> ZONE_CLASS_SHIFT) - 1];
+        if (base)
+        {
+            Z_FreeListRemove (base);
+            ++nbfreelistmallocs;
+            goto found;
+        }
+    }
+
     // scan through the block list,
     // looking for the first free block
     // of sufficient size,
@@ -222,6 +334,8 @@ Z_Malloc
 
     do
     {
+        ++nbroversteps;
+
         if (rover == start)
         {
             // scanned all the way around the list
@@ -242,7 +356,7 @@ Z_Malloc
 
                 // the rover can be the base block
                 base = base->prev;
-                Z_Free ((byte *)rover+sizeof(memblock_t));
+                Z_FreeBlock (rover);
                 base = base->next;
                 rover = base->next;
             }
@@ -275,6 +389,10 @@ Z_Malloc
         base->size = size;
     }
 
+    // next allocation will start looking here
+    mainzone->rover = base->next;
+
+  found:
     if (user)
     {
         // mark as an in use block
@@ -291,9 +409,6 @@ Z_Malloc
     }
     base->tag = tag;
 
-    // next allocation will start looking here
-    mainzone->rover = base->next;
-
     base->id = ZONEID;
 
 #ifdef ZONE_DEBUG
@@ -327,8 +442,9 @@ Z_FreeTags
         if (!block->user)
             continue;
 
+        // (for real: merges the blocks of the level, for the next one)
         if (block->tag >= lowtag && block->tag <= hightag)
-            Z_Free ( (byte *)block+sizeof(memblock_t));
+            Z_FreeBlock (block);
     }
 }
 
@@ -376,6 +492,27 @@ Z_DumpHeap
     }
 }
 
+//
+// Z_FreeListLength
+//
+static int Z_FreeListLength (int c)
+{
+    int         length = 0;
+    memblock_t* prev = NULL;
+
+    for (memblock_t* block = freelists[c] ; block ; block = FREELINK (block)->next)
+    {
+        if (block->tag != PU_FREELIST || Z_SizeClass (block) != c)
+            I_Error ("Z_FreeListLength: block %p in wrong free list %d",
+                     (void*)block, c);
+        if (FREELINK (block)->prev != prev)
+            I_Error ("Z_FreeListLength: free list %d has bad back link", c);
+        prev = block;
+        ++length;
+    }
+    return length;
+}
+
 //
 // Z_FileDumpHeap
 //
@@ -412,6 +549,10 @@ void Z_FileDumpHeap (FILE* f)
         if (!block->user && !block->next->user)
             fprintf (f,"ERROR: two consecutive free blocks\n");
     }
+
+    for (int c = 0 ; c < ZONE_CLASSES ; c++)
+        fprintf (f, "free list %3i bytes: %i blocks\n",
+                 (c+1) << ZONE_CLASS_SHIFT, Z_FreeListLength (c));
 }
 
 //
@@ -420,11 +561,15 @@ void Z_FileDumpHeap (FILE* f)
 void Z_CheckHeap (void)
 {
     memblock_t* block;
+    int         freelistblocks = 0;
 
     for (block = mainzone->blocklist.next ; ; block = block->next)
     {
         Z_CheckBlockIntegrity (block);
 
+        if (block->tag == PU_FREELIST)
+            freelistblocks++;
+
         if (block->next == &mainzone->blocklist)
         {
             // all blocks have been hit
@@ -440,6 +585,12 @@ void Z_CheckHeap (void)
         if (!block->user && !block->next->user)
             I_Error ("Z_CheckHeap: two consecutive free blocks\n");
     }
+
+    for (int c = 0 ; c < ZONE_CLASSES ; c++)
+        freelistblocks -= Z_FreeListLength (c);
+
+    if (freelistblocks != 0)
+        I_Error ("Z_CheckHeap: free lists do not match the block list\n");
 }
 
 //
@@ -464,8 +615,18 @@ Z_ChangeTag2
     block->tag = tag;
 }
 
+//
+// Z_ZoneSize
+// Total size of the zone, in bytes.
+//
+int Z_ZoneSize (void)
+{
+    return mainzone->size;
+}
+
 //
 // Z_FreeMemory
+// Also prints the allocation statistics since the last call.
 //
 int Z_FreeMemory (void)
 {
@@ -483,6 +644,16 @@ int Z_FreeMemory (void)
         if (!block->user || block->tag >= PU_PURGELEVEL)
             free += block->size;
     }
+
+    printf ("Z_Malloc: %u allocations, %u from the free lists, "
+            "%u rover steps (%u.%02u per allocation)\n",
+            nbmallocs, nbfreelistmallocs, nbroversteps,
+            nbmallocs ? nbroversteps / nbmallocs : 0,
+            nbmallocs ? (100 * nbroversteps / nbmallocs) % 100 : 0);
+    printf ("Z_Free: %u blocks to the free lists, %i bytes free\n",
+            nbfreelistfrees, free);
+    nbmallocs = nbfreelistmallocs = nbfreelistfrees = nbroversteps = 0;
+
     return free;
 }
 
@@ -55,6 +55,7 @@ void    Z_FileDumpHeap (FILE *f);
 void    Z_CheckHeap (void);
 void    Z_ChangeTag2 (void *ptr, int tag);
 int     Z_FreeMemory (void);
+int     Z_ZoneSize (void);
 
 typedef struct memblock_s
 {
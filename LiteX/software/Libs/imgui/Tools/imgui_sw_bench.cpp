@@ -0,0 +1,303 @@
+/**
+ * Host benchmark of imgui_sw: replays captured ImDrawData (see
+ * imgui_sw::dump_draw_data()) through the painter, and reports the pixels
+ * per second of each kind of primitive. Each painted frame is hashed, so
+ * that an optimization can be checked against reference hashes.
+ *   imgui_sw_bench [options] [capture files]
+ *     -n frames   ShowDemoWindow() frames painted when no file is given (60)
+ *     -r repeats  number of times each frame is painted (10)
+ *     -d          prints the captures of the demo frames instead (to stdout)
+ *     -w file     writes the hashes of the frames to file
+ *     -c file     checks the hashes of the frames against file
+ *   Built by 'make imgui_sw_bench' in LiteX/software/Libs/imgui/Tools.
+ */
+
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include "imgui.h"
+#include "imgui_sw.h"
+
+/*********************************************************************/
+
+/**
+ * \brief A captured frame, with the draw lists it owns.
+ */
+struct Capture {
+    ImVec2 display_size;
+    std::vector<ImDrawList*> lists;
+    ImDrawData draw_data;
+
+    ~Capture() {
+        for (ImDrawList* list : lists) {
+            IM_DELETE(list);
+        }
+    }
+};
+
+static float bits_float(uint32_t bits) {
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+static bool read_hex(FILE* f, uint32_t& result) {
+    unsigned int x;
+    if (fscanf(f, "%x", &x) != 1) {
+        return false;
+    }
+    result = x;
+    return true;
+}
+
+static bool read_float(FILE* f, float& result) {
+    uint32_t bits;
+    if (!read_hex(f, bits)) {
+        return false;
+    }
+    result = bits_float(bits);
+    return true;
+}
+
+static bool expect(FILE* f, const char* keyword) {
+    char token[32];
+    return fscanf(f, "%31s", token) == 1 && !strcmp(token, keyword);
+}
+
+/**
+ * \brief Reads the next capture of a file
+ * \param[in] f the file
+ * \param[in] texture the font texture of the context, used by all the commands
+ * \param[out] capture the frame
+ * \retval true if a capture could be read
+ * \retval false at the end of the file or on error
+ */
+static bool read_capture(FILE* f, ImTextureID texture, Capture& capture) {
+    uint32_t version, num_lists;
+    if (!expect(f, "imgui_sw_capture") || !read_hex(f, version) || version != 1 ||
+        !read_float(f, capture.display_size.x) || !read_float(f, capture.display_size.y) ||
+        !read_hex(f, num_lists)) {
+        return false;
+    }
+    for (uint32_t l = 0; l < num_lists; ++l) {
+        uint32_t num_vtx, num_idx, num_cmd;
+        if (!expect(f, "list") || !read_hex(f, num_vtx) || !read_hex(f, num_idx) || !read_hex(f, num_cmd)) {
+            return false;
+        }
+        ImDrawList* list = IM_NEW(ImDrawList)(nullptr);
+        capture.lists.push_back(list);
+        list->VtxBuffer.resize(num_vtx);
+        list->IdxBuffer.resize(num_idx);
+        for (uint32_t v = 0; v < num_vtx; ++v) {
+            ImDrawVert& vtx = list->VtxBuffer[v];
+            if (!expect(f, "v") ||
+                !read_float(f, vtx.pos.x) || !read_float(f, vtx.pos.y) ||
+                !read_float(f, vtx.uv.x) || !read_float(f, vtx.uv.y) || !read_hex(f, vtx.col)) {
+                return false;
+            }
+        }
+        for (uint32_t i = 0; i < num_idx; ++i) {
+            uint32_t idx;
+            if ((i % 16 == 0 && !expect(f, "i")) || !read_hex(f, idx) || idx >= num_vtx) {
+                return false;
+            }
+            list->IdxBuffer[i] = static_cast<ImDrawIdx>(idx);
+        }
+        uint32_t idx_offset = 0;
+        for (uint32_t c = 0; c < num_cmd; ++c) {
+            ImDrawCmd cmd;
+            if (!expect(f, "c") ||
+                !read_float(f, cmd.ClipRect.x) || !read_float(f, cmd.ClipRect.y) ||
+                !read_float(f, cmd.ClipRect.z) || !read_float(f, cmd.ClipRect.w) ||
+                !read_hex(f, cmd.ElemCount) || idx_offset + cmd.ElemCount > num_idx) {
+                return false;
+            }
+            cmd.TextureId = texture;
+            cmd.IdxOffset = idx_offset;
+            idx_offset += cmd.ElemCount;
+            list->CmdBuffer.push_back(cmd);
+        }
+    }
+    if (!expect(f, "end")) {
+        return false;
+    }
+    capture.draw_data.Valid = true;
+    capture.draw_data.CmdListsCount = int(capture.lists.size());
+    capture.draw_data.CmdLists = capture.lists.data();
+    capture.draw_data.DisplaySize = capture.display_size;
+    capture.draw_data.FramebufferScale = ImVec2(1.0f, 1.0f);
+    return true;
+}
+
+/**
+ * \brief FNV-1a hash of a painted frame.
+ */
+static uint64_t hash_pixels(const std::vector<uint32_t>& pixels) {
+    uint64_t h = 14695981039346656037ull;
+    for (uint32_t p : pixels) {
+        for (int b = 0; b < 32; b += 8) {
+            h = (h ^ ((p >> b) & 0xFFu)) * 1099511628211ull;
+        }
+    }
+    return h;
+}
+
+/*********************************************************************/
+
+struct Totals {
+    double pixels[3] = {0, 0, 0};
+    double seconds[3] = {0, 0, 0};
+};
+
+static const char* const kind_names[3] = { "text", "rectangles", "triangles" };
+
+/**
+ * \brief Paints a frame repeats times, accumulates the pixels and times
+ * \return the hash of the painted frame
+ */
+static uint64_t bench_frame(const ImDrawData* draw_data, int repeats, Totals& totals) {
+    const int width = int(draw_data->DisplaySize.x);
+    const int height = int(draw_data->DisplaySize.y);
+    std::vector<uint32_t> pixels(size_t(width) * height);
+    for (int r = 0; r < repeats; ++r) {
+        std::fill(pixels.begin(), pixels.end(), 0u);
+        imgui_sw::paint_draw_data(draw_data, pixels.data(), width, height);
+        const imgui_sw::PaintStats ps = imgui_sw::get_paint_stats();
+        totals.pixels[0] += ps.text_pixels;
+        totals.pixels[1] += ps.rectangle_pixels;
+        totals.pixels[2] += ps.triangle_pixels;
+        totals.seconds[0] += ps.text_time * 1e-9;      // host timing_now() is in nanoseconds
+        totals.seconds[1] += ps.rectangle_time * 1e-9;
+        totals.seconds[2] += ps.triangle_time * 1e-9;
+    }
+    return hash_pixels(pixels);
+}
+
+static void new_demo_frame() {
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2(640, 480);
+    io.DeltaTime = 1.0f / 60.0f;
+    ImGui::NewFrame();
+    ImGui::ShowDemoWindow(NULL);
+    ImGui::Render();
+}
+
+int main(int argc, char** argv) {
+    int num_frames = 60;
+    int repeats = 10;
+    bool dump = false;
+    const char* write_file = nullptr;
+    const char* check_file = nullptr;
+    std::vector<const char*> files;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            num_frames = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+            repeats = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "-d")) {
+            dump = true;
+        } else if (!strcmp(argv[i], "-w") && i + 1 < argc) {
+            write_file = argv[++i];
+        } else if (!strcmp(argv[i], "-c") && i + 1 < argc) {
+            check_file = argv[++i];
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "usage: %s [-n frames] [-r repeats] [-d] [-w file] [-c file] [captures]\n", argv[0]);
+            return 1;
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+
+    ImGui::CreateContext();
+    imgui_sw::bind_imgui_painting();
+    imgui_sw::make_style_fast();
+    const ImTextureID texture = ImGui::GetIO().Fonts->TexID;
+
+    std::vector<uint64_t> hashes;
+    Totals totals;
+    if (files.empty()) {
+        for (int n = 0; n < num_frames; ++n) {
+            new_demo_frame();
+            if (dump) {
+                imgui_sw::dump_draw_data();
+            } else {
+                hashes.push_back(bench_frame(ImGui::GetDrawData(), repeats, totals));
+            }
+        }
+    } else {
+        for (const char* filename : files) {
+            FILE* f = fopen(filename, "r");
+            if (!f) {
+                fprintf(stderr, "%s: could not open\n", filename);
+                return 1;
+            }
+            for (;;) {
+                Capture capture;
+                if (!read_capture(f, texture, capture)) {
+                    break;
+                }
+                hashes.push_back(bench_frame(&capture.draw_data, repeats, totals));
+            }
+            if (!feof(f)) {
+                fprintf(stderr, "%s: invalid capture after frame %d\n", filename, int(hashes.size()));
+            }
+            fclose(f);
+        }
+    }
+    if (dump) {
+        return 0;
+    }
+
+    printf("%d frames, painted %d times each\n", int(hashes.size()), repeats);
+    printf("%-10s %12s %10s %10s\n", "", "pixels", "ms", "Mpixels/s");
+    for (int k = 0; k < 3; ++k) {
+        printf("%-10s %12.0f %10.2f %10.2f\n", kind_names[k], totals.pixels[k] / repeats,
+               totals.seconds[k] * 1e3 / repeats,
+               totals.seconds[k] > 0 ? totals.pixels[k] / totals.seconds[k] * 1e-6 : 0.0);
+    }
+
+    int result = 0;
+    if (write_file) {
+        FILE* f = fopen(write_file, "w");
+        if (!f) {
+            fprintf(stderr, "%s: could not open\n", write_file);
+            return 1;
+        }
+        for (uint64_t h : hashes) {
+            fprintf(f, "%016llx\n", (unsigned long long)h);
+        }
+        fclose(f);
+    }
+    if (check_file) {
+        FILE* f = fopen(check_file, "r");
+        if (!f) {
+            fprintf(stderr, "%s: could not open\n", check_file);
+            return 1;
+        }
+        int mismatches = 0;
+        size_t n = 0;
+        unsigned long long expected;
+        while (fscanf(f, "%llx", &expected) == 1) {
+            if (n < hashes.size() && hashes[n] != expected) {
+                printf("frame %d differs from the reference\n", int(n));
+                ++mismatches;
+            }
+            ++n;
+        }
+        fclose(f);
+        if (n != hashes.size()) {
+            printf("%d reference frames, %d painted\n", int(n), int(hashes.size()));
+            ++mismatches;
+        }
+        printf(mismatches ? "check FAILED\n" : "check OK (pixel exact)\n");
+        result = mismatches ? 1 : 0;
+    }
+
+    imgui_sw::unbind_imgui_painting();
+    ImGui::DestroyContext();
+    return result;
+}
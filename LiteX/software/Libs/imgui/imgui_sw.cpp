@@ -4,9 +4,17 @@
 //   license: you are granted a perpetual, irrevocable license to copy, modify,
 //   publish, and distribute this file as you see fit.
 
+#ifdef IMGUI_SW_HOST
+// Host build (Tools/imgui_sw_bench): no frame buffer, the standard library.
+#include <stdint.h>
+#include <assert.h>
+#include <algorithm>
+#include <cmath>
+#else
 extern "C" {
 #include "lite_fb.h"
 }
+#endif
 
 #include <stdlib.h>
 
@@ -18,18 +26,26 @@ extern "C" {
 #undef max
 #endif
 
+#include "imgui_sw.h"
+#include "imgui.h"
+
+#ifndef IMGUI_SW_HOST
+// Goes with the operator new of the program, that calls ImGui::MemAlloc()
+// (the allocator may be replaced, see ImGui::SetAllocatorFunctions()).
 void operator delete(void* p);
 void operator delete(void* p) {
-    free(p);
+    ImGui::MemFree(p);
 }
-
-
-#include "imgui_sw.h"
-#include "imgui.h"
+#endif
 
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
+#ifndef __riscv
+#include <time.h>
+#endif
 
+#ifndef IMGUI_SW_HOST
 namespace std {
    template <class T> inline T min(T x, T y) {
       return x<y?x:y;
@@ -50,8 +66,23 @@ namespace std {
    }
    
 }
+#endif
 
 namespace imgui_sw {
+
+uint32_t timing_now()
+{
+#ifdef __riscv
+	uint32_t cycles;
+	__asm__ volatile ("rdcycle %0" : "=r"(cycles));
+	return cycles;
+#else
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<uint32_t>(ts.tv_sec * 1000000000ull + ts.tv_nsec);
+#endif
+}
+
 namespace {
 
 struct Stats
@@ -64,6 +95,31 @@ struct Stats
 	double textured_rectangle_pixels          = 0;
 	double gradient_rectangle_pixels          = 0;
 	double gradient_textured_rectangle_pixels = 0;
+	// Time spent painting each kind of primitive, see timing_now():
+	uint32_t text_cycles                      = 0;
+	uint32_t rectangle_cycles                 = 0;
+	uint32_t triangle_cycles                  = 0;
+};
+
+// The glyphs of the font atlas, repacked one after the other (the rows of a
+// glyph contiguous, each glyph starting on a cache line), so that painting a
+// glyph reads a few consecutive cache lines instead of one line per row of the
+// wide atlas. A glyph is found by its top-left texel in the atlas.
+const int kGlyphAlign = 32; // D-cache line of the VexRiscv.
+
+struct PackedGlyph
+{
+	uint16_t x, y;          // Top-left texel in the atlas.
+	uint16_t width, height; // width == 0: empty slot.
+	uint32_t offset;        // In GlyphCache::pixels.
+};
+
+struct GlyphCache
+{
+	PackedGlyph* slots     = nullptr; // Open addressing, at most half full.
+	int          num_slots = 0;       // Power of two.
+	uint8_t*     pixels    = nullptr; // Aligned on kGlyphAlign, in memory.
+	void*        memory    = nullptr;
 };
 
 struct Texture
@@ -71,14 +127,7 @@ struct Texture
 	const uint8_t* pixels; // 8-bit.
 	int            width;
 	int            height;
-};
-
-struct PaintTarget
-{
-	uint32_t* pixels;
-	int       width;
-	int       height;
-	ImVec2    scale; // Multiply ImGui (point) coordinates with this to get pixel coordinates.
+	GlyphCache     glyphs;
 };
 
 // ----------------------------------------------------------------------------
@@ -113,6 +162,106 @@ ColorInt blend(ColorInt target, ColorInt source)
 	return result;
 }
 
+// ----------------------------------------------------------------------------
+// Pixel formats of the render target: encode() converts an ImGui color (ImU32),
+// decode() converts a pixel back (alpha is ignored).
+
+struct FormatRGBA8888
+{
+	using Pixel = uint32_t;
+#ifdef IMGUI_SW_HOST
+	static const bool kHasBlitter = false;
+#else
+	static const bool kHasBlitter = true; // The LiteX frame buffer, see fb_fillrect().
+#endif
+	static Pixel encode(uint32_t c) { return c; }
+	static uint32_t decode(Pixel p) { return p; }
+};
+
+// For painting from several cores at the same time (one blitter).
+struct FormatRGBA8888NoBlitter : FormatRGBA8888
+{
+	static const bool kHasBlitter = false;
+};
+
+// Same encoding as the SSD1351 OLED (GL_RGB() in femtoGL) and the FGA in 16bpp mode.
+struct FormatRGB565
+{
+	using Pixel = uint16_t;
+	static const bool kHasBlitter = false;
+	static Pixel encode(uint32_t c)
+	{
+		const ColorInt ci(c);
+		return static_cast<Pixel>(((ci.r & 0xF8u) << 8) | ((ci.g & 0xFCu) << 3) | (ci.b >> 3));
+	}
+	static uint32_t decode(Pixel p)
+	{
+		ColorInt ci;
+		ci.r = ((p >> 8) & 0xF8u) | (p >> 13);
+		ci.g = ((p >> 3) & 0xFCu) | ((p >> 9) & 0x03u);
+		ci.b = ((p << 3) & 0xF8u) | ((p >> 2) & 0x07u);
+		ci.a = 255;
+		return ci.toUint32();
+	}
+};
+
+// Palette index, for 8bpp modes with the RGB332 palette (entry i has
+// R = i & 0xE0, G = (i << 3) & 0xE0, B = (i << 6) & 0xC0).
+struct FormatRGB332
+{
+	using Pixel = uint8_t;
+	static const bool kHasBlitter = false;
+	static Pixel encode(uint32_t c)
+	{
+		const ColorInt ci(c);
+		return static_cast<Pixel>((ci.r & 0xE0u) | ((ci.g >> 3) & 0x1Cu) | (ci.b >> 6));
+	}
+	static uint32_t decode(Pixel p)
+	{
+		ColorInt ci;
+		ci.r = (p & 0xE0u) | ((p >> 3) & 0x1Cu) | (p >> 6);
+		ci.g = ((p << 3) & 0xE0u) | (p & 0x1Cu) | ((p >> 3) & 0x03u);
+		ci.b = (p & 0x03u) * 0x55u;
+		ci.a = 255;
+		return ci.toUint32();
+	}
+};
+
+template <class Format>
+struct PaintTarget
+{
+	using Pixel = typename Format::Pixel;
+	Pixel*    pixels;
+	int       width;
+	int       height;
+	ImVec2    scale; // Multiply ImGui (point) coordinates with this to get pixel coordinates.
+};
+
+template <class Format>
+typename Format::Pixel blend_pixel(typename Format::Pixel target, ColorInt source)
+{
+	return Format::encode(blend(ColorInt(Format::decode(target)), source).toUint32());
+}
+
+// Fills [min_x, max_x) x [min_y, max_y) with an ImGui color, no clipping.
+template <class Format>
+void fill_rect(const PaintTarget<Format>& target, int min_x, int min_y, int max_x, int max_y, uint32_t c)
+{
+#ifndef IMGUI_SW_HOST
+	if (Format::kHasBlitter) {
+		fb_fillrect(min_x, min_y, max_x - 1, max_y - 1, c);
+		return;
+	}
+#endif
+	const typename Format::Pixel p = Format::encode(c);
+	for (int y = min_y; y < max_y; ++y) {
+		typename Format::Pixel* row = target.pixels + y * target.width;
+		for (int x = min_x; x < max_x; ++x) {
+			row[x] = p;
+		}
+	}
+}
+
 // ----------------------------------------------------------------------------
 // Used for interpolating vertex attributes (color and texture coordinates) in a triangle.
 
@@ -259,8 +408,9 @@ inline uint8_t sample_texture(const Texture& texture, const ImVec2& uv)
 	return texture.pixels[ty * texture.width + tx];
 }
 
+template <class Format>
 void paint_uniform_rectangle(
-	const PaintTarget& target,
+	const PaintTarget<Format>& target,
 	const ImVec2&      min_f,
 	const ImVec2&      max_f,
 	const ColorInt&    color,
@@ -283,7 +433,7 @@ void paint_uniform_rectangle(
         // [BL] no transparency -> fast fillrect 
 	if(color.a == 255) {
 	   uint32_t  c = color.toUint32();
-	   fb_fillrect(min_x_i, min_y_i, max_x_i-1, max_y_i-1, c);
+	   fill_rect(target, min_x_i, min_y_i, max_x_i, max_y_i, c);
 	   /*
 	   uint32_t* p_line = target.pixels + min_y_i*target.width + min_x_i;
 	   for (int y = min_y_i; y < max_y_i; ++y) {
@@ -299,25 +449,27 @@ void paint_uniform_rectangle(
 	}
       
 	// We often blend the same colors over and over again, so optimize for this (saves 25% total cpu):
-	uint32_t last_target_pixel = target.pixels[min_y_i * target.width + min_x_i];
-	uint32_t last_output = blend(ColorInt(last_target_pixel), color).toUint32();
+	using Pixel = typename Format::Pixel;
+	Pixel last_target_pixel = target.pixels[min_y_i * target.width + min_x_i];
+	Pixel last_output = blend_pixel<Format>(last_target_pixel, color);
 
 	for (int y = min_y_i; y < max_y_i; ++y) {
 		for (int x = min_x_i; x < max_x_i; ++x) {
-			uint32_t& target_pixel = target.pixels[y * target.width + x];
+			Pixel& target_pixel = target.pixels[y * target.width + x];
 			if (target_pixel == last_target_pixel) {
 				target_pixel = last_output;
 				continue;
 			}
 			last_target_pixel = target_pixel;
-			target_pixel = blend(ColorInt(target_pixel), color).toUint32();
+			target_pixel = blend_pixel<Format>(target_pixel, color);
 			last_output = target_pixel;
 		}
 	}
 }
 
+template <class Format>
 void paint_uniform_textured_rectangle(
-	const PaintTarget& target,
+	const PaintTarget<Format>& target,
 	const Texture&     texture,
 	const ImVec4&      clip_rect,
 	const ImDrawVert&  min_v,
@@ -327,29 +479,23 @@ void paint_uniform_textured_rectangle(
 	const ImVec2 min_p = ImVec2(target.scale.x * min_v.pos.x, target.scale.y * min_v.pos.y);
 	const ImVec2 max_p = ImVec2(target.scale.x * max_v.pos.x, target.scale.y * max_v.pos.y);
 
-	// Find bounding box:
-	float min_x_f = min_p.x;
-	float min_y_f = min_p.y;
-	float max_x_f = max_p.x;
-	float max_y_f = max_p.y;
-
-	// Clip against clip_rect:
-	min_x_f = std::max(min_x_f, target.scale.x * clip_rect.x);
-	min_y_f = std::max(min_y_f, target.scale.y * clip_rect.y);
-	max_x_f = std::min(max_x_f, target.scale.x * clip_rect.z - 0.5f);
-	max_y_f = std::min(max_y_f, target.scale.y * clip_rect.w - 0.5f);
-
 	// Integer bounding box [min, max):
-	int min_x_i = static_cast<int>(min_x_f);
-	int min_y_i = static_cast<int>(min_y_f);
-	int max_x_i = static_cast<int>(max_x_f + 1.0f);
-	int max_y_i = static_cast<int>(max_y_f + 1.0f);
+	int min_x_i = static_cast<int>(min_p.x);
+	int min_y_i = static_cast<int>(min_p.y);
+	int max_x_i = static_cast<int>(max_p.x + 1.0f);
+	int max_y_i = static_cast<int>(max_p.y + 1.0f);
 
-        // [BL]
+        // [BL] (before clipping, else a clipped rectangle would be "unclipped")
         if(min_x_i > max_x_i) std::swap(min_x_i, max_x_i);
         if(min_y_i > max_y_i) std::swap(min_y_i, max_y_i);
         if(max_x_i == min_x_i) ++max_x_i; 
         if(max_y_i == min_y_i) ++max_y_i; 
+
+	// Clip against clip_rect (same rounding as paint_triangle):
+	min_x_i = std::max(min_x_i, static_cast<int>(target.scale.x * clip_rect.x));
+	min_y_i = std::max(min_y_i, static_cast<int>(target.scale.y * clip_rect.y));
+	max_x_i = std::min(max_x_i, static_cast<int>(target.scale.x * clip_rect.z + 0.5f));
+	max_y_i = std::min(max_y_i, static_cast<int>(target.scale.y * clip_rect.w + 0.5f));
    
 	// Clip against render target:
 	min_x_i = std::max(min_x_i, 0);
@@ -357,6 +503,8 @@ void paint_uniform_textured_rectangle(
 	max_x_i = std::min(max_x_i, target.width);
 	max_y_i = std::min(max_y_i, target.height);
 
+	if (min_x_i >= max_x_i || min_y_i >= max_y_i) { return; }
+
 	stats->font_pixels += (max_x_i - min_x_i) * (max_y_i - min_y_i);
 
         // [BL] optimization if single uv texture coord, lookup texture
@@ -365,7 +513,7 @@ void paint_uniform_textured_rectangle(
 	   const uint8_t texel = sample_texture(texture, min_v.uv);
 	   if(texel == 0) { return; }
 	   uint32_t  c = min_v.col;
-	   fb_fillrect(min_x_i, min_y_i, max_x_i-1,max_y_i-1,c); 
+	   fill_rect(target, min_x_i, min_y_i, max_x_i, max_y_i, c);
 	   /*
 	   uint32_t* p_line = target.pixels + min_y_i*target.width + min_x_i;
 	   for (int y = min_y_i; y < max_y_i; ++y) {
@@ -392,28 +540,204 @@ void paint_uniform_textured_rectangle(
 		min_v.uv.y + (topleft.y - min_v.pos.y) * delta_uv_per_pixel.y,
 	};
 	ImVec2 current_uv = uv_topleft;
+	const typename Format::Pixel min_v_px = Format::encode(min_v.col);
 
 	for (int y = min_y_i; y < max_y_i; ++y, current_uv.y += delta_uv_per_pixel.y) {
 		current_uv.x = uv_topleft.x;
 		for (int x = min_x_i; x < max_x_i; ++x, current_uv.x += delta_uv_per_pixel.x) {
-			uint32_t& target_pixel = target.pixels[y * target.width + x];
+			typename Format::Pixel& target_pixel = target.pixels[y * target.width + x];
 			const uint8_t texel = sample_texture(texture, current_uv);
 
 			// The font texture is all black or all white, so optimize for this:
 			if (texel == 0) { continue; }
 			if (texel == 255) {
-				target_pixel = min_v.col;
+				target_pixel = min_v_px;
 				continue;
 			}
 
 			// Other textured rectangles
 			ColorInt source_color = ColorInt(min_v.col);
 			source_color.a = source_color.a * texel / 255;
-			target_pixel = blend(ColorInt(target_pixel), source_color).toUint32();
+			target_pixel = blend_pixel<Format>(target_pixel, source_color);
 		}
 	}
 }
 
+// Is the quad at index i a glyph: an axis aligned textured rectangle with a uniform color?
+// This assumes the ImGui way to layout text does not change.
+bool is_glyph_quad(
+	const ImDrawVert* vertices,
+	const ImDrawIdx*  idx_buffer,
+	unsigned int      i,
+	unsigned int      elem_count,
+	const ImVec2&     white_uv)
+{
+	if (i + 6 > elem_count ||
+	    idx_buffer[i + 3] != idx_buffer[i + 0] || idx_buffer[i + 4] != idx_buffer[i + 2]) {
+		return false;
+	}
+
+	const ImDrawVert& v0 = vertices[idx_buffer[i + 0]];
+	const ImDrawVert& v1 = vertices[idx_buffer[i + 1]];
+	const ImDrawVert& v2 = vertices[idx_buffer[i + 2]];
+	const ImDrawVert& v3 = vertices[idx_buffer[i + 5]];
+
+	return v0.pos.x == v3.pos.x &&
+	       v1.pos.x == v2.pos.x &&
+	       v0.pos.y == v1.pos.y &&
+	       v2.pos.y == v3.pos.y &&
+	       v0.uv.x == v3.uv.x &&
+	       v1.uv.x == v2.uv.x &&
+	       v0.uv.y == v1.uv.y &&
+	       v2.uv.y == v3.uv.y &&
+	       v0.col == v1.col &&
+	       v0.col == v2.col &&
+	       v0.col == v3.col &&
+	       (v0.uv != white_uv || v1.uv != white_uv || v2.uv != white_uv || v3.uv != white_uv);
+}
+
+// Paints the consecutive glyph quads from index i, returns the index after the last one.
+// A glyph drawn texel to pixel (the usual case, no scaling) is copied from the alpha atlas
+// (the font texture, one byte per texel) 4 pixels at a time: the 4 coverages are read as
+// one word, so that empty and full groups need no per-pixel test. Other glyphs go through
+// paint_uniform_textured_rectangle.
+uint32_t glyph_slot(const GlyphCache& cache, int x, int y)
+{
+	return (static_cast<uint32_t>(x) * 73856093u ^ static_cast<uint32_t>(y) * 19349663u) &
+	       static_cast<uint32_t>(cache.num_slots - 1);
+}
+
+// The glyph whose top-left texel is (x, y), or nullptr.
+const PackedGlyph* find_glyph(const GlyphCache& cache, int x, int y)
+{
+	if (cache.num_slots == 0) { return nullptr; }
+	for (uint32_t s = glyph_slot(cache, x, y); ; s = (s + 1) & (cache.num_slots - 1)) {
+		const PackedGlyph& glyph = cache.slots[s];
+		if (glyph.width == 0) { return nullptr; }
+		if (glyph.x == x && glyph.y == y) { return &glyph; }
+	}
+}
+
+template <class Format>
+unsigned int paint_glyph_run(
+	const PaintTarget<Format>& target,
+	const Texture&     texture,
+	const ImVec4&      clip_rect,
+	const ImDrawVert*  vertices,
+	const ImDrawIdx*   idx_buffer,
+	unsigned int       i,
+	unsigned int       elem_count,
+	const ImVec2&      white_uv,
+	Stats*             stats)
+{
+	using Pixel = typename Format::Pixel;
+
+	// Same rounding as paint_uniform_textured_rectangle.
+	const int clip_x1 = std::max(0, static_cast<int>(target.scale.x * clip_rect.x));
+	const int clip_y1 = std::max(0, static_cast<int>(target.scale.y * clip_rect.y));
+	const int clip_x2 = std::min(target.width,  static_cast<int>(target.scale.x * clip_rect.z + 0.5f));
+	const int clip_y2 = std::min(target.height, static_cast<int>(target.scale.y * clip_rect.w + 0.5f));
+
+	uint32_t col     = 0;
+	ColorInt color   = ColorInt(col);
+	Pixel    full_px = Format::encode(col);
+
+	for (; is_glyph_quad(vertices, idx_buffer, i, elem_count, white_uv); i += 6) {
+		const ImDrawVert& min_v = vertices[idx_buffer[i + 0]];
+		const ImDrawVert& max_v = vertices[idx_buffer[i + 2]];
+
+		const float x0 = target.scale.x * min_v.pos.x;
+		const float y0 = target.scale.y * min_v.pos.y;
+		const float w  = target.scale.x * max_v.pos.x - x0;
+		const float h  = target.scale.y * max_v.pos.y - y0;
+		const float tx0 = min_v.uv.x * texture.width;
+		const float ty0 = min_v.uv.y * texture.height;
+		const float tw  = max_v.uv.x * texture.width  - tx0;
+		const float th  = max_v.uv.y * texture.height - ty0;
+
+		if (w <= 0.0f || h <= 0.0f || fabsf(w - tw) > 0.01f || fabsf(h - th) > 0.01f) {
+			paint_uniform_textured_rectangle(target, texture, clip_rect, min_v, max_v, stats);
+			continue;
+		}
+
+		// Pixel (x, y) shows texel (x + dtx, y + dty).
+		const int x_i = static_cast<int>(floorf(x0 + 0.5f));
+		const int y_i = static_cast<int>(floorf(y0 + 0.5f));
+		const int dtx = static_cast<int>(floorf(tx0 + 0.5f)) - x_i;
+		const int dty = static_cast<int>(floorf(ty0 + 0.5f)) - y_i;
+
+		const int min_x_i = std::max(x_i, clip_x1);
+		const int min_y_i = std::max(y_i, clip_y1);
+		const int max_x_i = std::min(x_i + static_cast<int>(w + 0.5f), clip_x2);
+		const int max_y_i = std::min(y_i + static_cast<int>(h + 0.5f), clip_y2);
+		if (min_x_i >= max_x_i || min_y_i >= max_y_i) { continue; }
+
+		// The texels that are read have to be in the atlas.
+		if (min_x_i + dtx < 0 || max_x_i + dtx > texture.width ||
+		    min_y_i + dty < 0 || max_y_i + dty > texture.height) {
+			paint_uniform_textured_rectangle(target, texture, clip_rect, min_v, max_v, stats);
+			continue;
+		}
+
+		if (min_v.col != col) {
+			col     = min_v.col;
+			color   = ColorInt(col);
+			full_px = Format::encode(col);
+		}
+
+		stats->font_pixels += (max_x_i - min_x_i) * (max_y_i - min_y_i);
+
+		// The texel of pixel (min_x_i, min_y_i), and the distance between two rows:
+		// in the glyph cache when the quad is a whole glyph, else in the atlas.
+		const uint8_t* tex_row = texture.pixels + (min_y_i + dty) * texture.width + min_x_i + dtx;
+		int            tex_stride = texture.width;
+		const PackedGlyph* glyph = find_glyph(texture.glyphs, x_i + dtx, y_i + dty);
+		if (glyph && max_x_i - x_i <= glyph->width && max_y_i - y_i <= glyph->height) {
+			tex_stride = glyph->width;
+			tex_row = texture.glyphs.pixels + glyph->offset +
+			          (min_y_i - y_i) * tex_stride + (min_x_i - x_i);
+		}
+
+		for (int y = min_y_i; y < max_y_i; ++y, tex_row += tex_stride) {
+			Pixel*         row = target.pixels + y * target.width;
+			const uint8_t* tex = tex_row - min_x_i; // tex[x] is the texel of pixel x.
+			int x = min_x_i;
+			for (; x + 4 <= max_x_i; x += 4) {
+				uint32_t coverage;
+				memcpy(&coverage, tex + x, 4);
+				if (coverage == 0) { continue; }
+				if (coverage == 0xFFFFFFFFu && color.a == 255) {
+					row[x] = row[x + 1] = row[x + 2] = row[x + 3] = full_px;
+					continue;
+				}
+				for (int k = 0; k < 4; ++k) {
+					const uint32_t texel = tex[x + k];
+					if (texel == 0) { continue; }
+					if (texel == 255 && color.a == 255) {
+						row[x + k] = full_px;
+						continue;
+					}
+					ColorInt source_color = color;
+					source_color.a = color.a * texel / 255;
+					row[x + k] = blend_pixel<Format>(row[x + k], source_color);
+				}
+			}
+			for (; x < max_x_i; ++x) {
+				const uint32_t texel = tex[x];
+				if (texel == 0) { continue; }
+				if (texel == 255 && color.a == 255) {
+					row[x] = full_px;
+					continue;
+				}
+				ColorInt source_color = color;
+				source_color.a = color.a * texel / 255;
+				row[x] = blend_pixel<Format>(row[x], source_color);
+			}
+		}
+	}
+	return i;
+}
+
 // When two triangles share an edge, we want to draw the pixels on that edge exactly once.
 // The edge will be the same, but the direction will be the opposite
 // (assuming the two triangles have the same winding order).
@@ -425,8 +749,9 @@ bool is_dominant_edge(ImVec2 edge)
 }
 
 // Handles triangles in any winding order (CW/CCW)
+template <class Format>
 void paint_triangle(
-	const PaintTarget& target,
+	const PaintTarget<Format>& target,
 	const Texture*     texture,
 	const ImVec4&      clip_rect,
 	const ImDrawVert&  v0,
@@ -519,8 +844,9 @@ void paint_triangle(
 	const ImVec4 c2 = color_convert_u32_to_float4(v2.col);
 
 	// We often blend the same colors over and over again, so optimize for this (saves 10% total cpu):
-	uint32_t last_target_pixel = 0;
-	uint32_t last_output = blend(ColorInt(last_target_pixel), ColorInt(v0.col)).toUint32();
+	using Pixel = typename Format::Pixel;
+	Pixel last_target_pixel = 0;
+	Pixel last_output = blend_pixel<Format>(last_target_pixel, ColorInt(v0.col));
 
 	for (int y = min_y_i; y < max_y_i; ++y) {
 		auto bary = bary_current_row;
@@ -549,7 +875,7 @@ void paint_triangle(
 			}
 			has_been_inside_this_row = true;
 
-			uint32_t& target_pixel = target.pixels[y * target.width + x];
+			Pixel& target_pixel = target.pixels[y * target.width + x];
 
 			if (has_uniform_color && !texture) {
 				stats->uniform_triangle_pixels += 1;
@@ -558,7 +884,7 @@ void paint_triangle(
 					continue;
 				}
 				last_target_pixel = target_pixel;
-				target_pixel = blend(ColorInt(target_pixel), ColorInt(v0.col)).toUint32();
+				target_pixel = blend_pixel<Format>(target_pixel, ColorInt(v0.col));
 				last_output = target_pixel;
 				continue;
 			}
@@ -581,21 +907,181 @@ void paint_triangle(
 			if (src_color.w <= 0.0f) { continue; } // Transparent.
 			if (src_color.w >= 1.0f) {
 				// Opaque, no blending needed:
-				target_pixel = color_convert_float4_to_u32(src_color);
+				target_pixel = Format::encode(color_convert_float4_to_u32(src_color));
 				continue;
 			}
 
-			ImVec4 target_color = color_convert_u32_to_float4(target_pixel);
+			ImVec4 target_color = color_convert_u32_to_float4(Format::decode(target_pixel));
 			const auto blended_color = src_color.w * src_color + (1.0f - src_color.w) * target_color;
-			target_pixel = color_convert_float4_to_u32(blended_color);
+			target_pixel = Format::encode(color_convert_float4_to_u32(blended_color));
 		}
 
 		bary_current_row += bary_dy;
 	}
 }
 
+// ----------------------------------------------------------------------------
+// Integer rasterizer for the uniformly colored untextured triangles (most of the
+// window chrome), so that there is no (soft) float per pixel. The vertices have
+// kSubPixelBits bits of subpixel precision and everything is in 32 bits, which
+// is enough for render targets up to 2048 pixels wide / high. The edge functions
+// are stepped incrementally, kBlockSize pixels at a time: the functions are linear,
+// so a block whose first and last pixels are inside the triangle is inside.
+
+const int kSubPixelBits = 4;
+const int kBlockSize    = 4;
+
+struct PointI
+{
+	int32_t x, y;
+};
+
+PointI as_point_i(ImVec2 v)
+{
+	return PointI{
+		static_cast<int32_t>(std::floor(v.x * (1 << kSubPixelBits))),
+		static_cast<int32_t>(std::floor(v.y * (1 << kSubPixelBits)))
+	};
+}
+
+struct EdgeI
+{
+	int32_t w_row;  // At the first pixel of the current row.
+	int32_t dx, dy; // Per pixel.
+};
+
+// Edge function of a->b, positive inside, at the center of pixel (x,y).
+EdgeI edge_i(const PointI& a, const PointI& b, int x, int y, int sign)
+{
+	const int32_t px = (x << kSubPixelBits) + (1 << (kSubPixelBits - 1));
+	const int32_t py = (y << kSubPixelBits) + (1 << (kSubPixelBits - 1));
+	const int32_t ex = b.x - a.x;
+	const int32_t ey = b.y - a.y;
+	const bool dominant = ey > 0 || (ey == 0 && ex < 0); // See is_dominant_edge.
+	EdgeI e;
+	e.w_row = sign * (ex * (py - a.y) - ey * (px - a.x)) + (dominant ? 0 : -1);
+	e.dx    = -sign * ey * (1 << kSubPixelBits);
+	e.dy    =  sign * ex * (1 << kSubPixelBits);
+	return e;
+}
+
+template <class Format>
+void paint_uniform_triangle_fixed(
+	const PaintTarget<Format>& target,
+	const ImVec4&      clip_rect,
+	const ImDrawVert&  v0,
+	const ImDrawVert&  v1,
+	const ImDrawVert&  v2,
+	Stats*             stats)
+{
+	const auto p0 = as_point_i(ImVec2(target.scale.x * v0.pos.x, target.scale.y * v0.pos.y));
+	const auto p1 = as_point_i(ImVec2(target.scale.x * v1.pos.x, target.scale.y * v1.pos.y));
+	const auto p2 = as_point_i(ImVec2(target.scale.x * v2.pos.x, target.scale.y * v2.pos.y));
+
+	const int32_t area = (p1.x - p0.x) * (p2.y - p0.y) - (p1.y - p0.y) * (p2.x - p0.x);
+	if (area == 0) { return; }
+	const int sign = area > 0 ? 1 : -1; // winding order?
+
+	// Integer bounding box [min, max), clipped against clip_rect and render target:
+	int min_x_i = std::min(p0.x, std::min(p1.x, p2.x)) >> kSubPixelBits;
+	int min_y_i = std::min(p0.y, std::min(p1.y, p2.y)) >> kSubPixelBits;
+	int max_x_i = (std::max(p0.x, std::max(p1.x, p2.x)) >> kSubPixelBits) + 1;
+	int max_y_i = (std::max(p0.y, std::max(p1.y, p2.y)) >> kSubPixelBits) + 1;
+
+	min_x_i = std::max(min_x_i, static_cast<int>(target.scale.x * clip_rect.x));
+	min_y_i = std::max(min_y_i, static_cast<int>(target.scale.y * clip_rect.y));
+	max_x_i = std::min(max_x_i, static_cast<int>(target.scale.x * clip_rect.z + 0.5f));
+	max_y_i = std::min(max_y_i, static_cast<int>(target.scale.y * clip_rect.w + 0.5f));
+
+	min_x_i = std::max(min_x_i, 0);
+	min_y_i = std::max(min_y_i, 0);
+	max_x_i = std::min(max_x_i, target.width);
+	max_y_i = std::min(max_y_i, target.height);
+
+	if (min_x_i >= max_x_i || min_y_i >= max_y_i) { return; }
+
+	EdgeI e0 = edge_i(p1, p2, min_x_i, min_y_i, sign);
+	EdgeI e1 = edge_i(p2, p0, min_x_i, min_y_i, sign);
+	EdgeI e2 = edge_i(p0, p1, min_x_i, min_y_i, sign);
+
+	using Pixel = typename Format::Pixel;
+	const ColorInt color     = ColorInt(v0.col);
+	const bool     opaque    = color.a == 255;
+	const Pixel    opaque_px = Format::encode(v0.col);
+
+	// We often blend the same colors over and over again, so optimize for this:
+	Pixel last_target_pixel = 0;
+	Pixel last_output = blend_pixel<Format>(last_target_pixel, color);
+
+	auto paint = [&](Pixel& target_pixel) {
+		if (opaque) {
+			target_pixel = opaque_px;
+			return;
+		}
+		if (target_pixel == last_target_pixel) {
+			target_pixel = last_output;
+			return;
+		}
+		last_target_pixel = target_pixel;
+		target_pixel = blend_pixel<Format>(target_pixel, color);
+		last_output = target_pixel;
+	};
+
+	int pixels = 0;
+
+	for (int y = min_y_i; y < max_y_i; ++y) {
+		Pixel* row = target.pixels + y * target.width;
+		int32_t w0 = e0.w_row;
+		int32_t w1 = e1.w_row;
+		int32_t w2 = e2.w_row;
+		bool has_been_inside_this_row = false;
+
+		for (int x = min_x_i; x < max_x_i; ) {
+			const int n = std::min(kBlockSize, max_x_i - x);
+			const int32_t l0 = w0 + (n - 1) * e0.dx;
+			const int32_t l1 = w1 + (n - 1) * e1.dx;
+			const int32_t l2 = w2 + (n - 1) * e2.dx;
+
+			if ((w0 | w1 | w2 | l0 | l1 | l2) >= 0) {
+				// Whole block inside.
+				for (int k = 0; k < n; ++k) { paint(row[x + k]); }
+				pixels += n;
+				has_been_inside_this_row = true;
+			} else {
+				int32_t a0 = w0, a1 = w1, a2 = w2;
+				for (int k = 0; k < n; ++k) {
+					if ((a0 | a1 | a2) >= 0) {
+						paint(row[x + k]);
+						++pixels;
+						has_been_inside_this_row = true;
+					} else if (has_been_inside_this_row) {
+						break;
+					}
+					a0 += e0.dx;
+					a1 += e1.dx;
+					a2 += e2.dx;
+				}
+				// Convex: once outside after being inside, the rest of the row is outside.
+				if (has_been_inside_this_row && (l0 | l1 | l2) < 0) { break; }
+			}
+
+			w0 += n * e0.dx;
+			w1 += n * e1.dx;
+			w2 += n * e2.dx;
+			x += n;
+		}
+
+		e0.w_row += e0.dy;
+		e1.w_row += e1.dy;
+		e2.w_row += e2.dy;
+	}
+
+	stats->uniform_triangle_pixels += pixels;
+}
+
+template <class Format>
 void paint_draw_cmd(
-	const PaintTarget& target,
+	const PaintTarget<Format>& target,
 	const ImDrawVert*  vertices,
 	const ImDrawIdx*   idx_buffer,
 	const ImDrawCmd&   pcmd,
@@ -612,40 +1098,15 @@ void paint_draw_cmd(
 		const ImDrawVert& v0 = vertices[idx_buffer[i + 0]];
 		const ImDrawVert& v1 = vertices[idx_buffer[i + 1]];
 		const ImDrawVert& v2 = vertices[idx_buffer[i + 2]];
-
-		// Text is common, and is made of textured rectangles. So let's optimize for it.
-		// This assumes the ImGui way to layout text does not change.
-		if (options.optimize_text && i + 6 <= pcmd.ElemCount &&
-		    idx_buffer[i + 3] == idx_buffer[i + 0] && idx_buffer[i + 4] == idx_buffer[i + 2]) {
-			const ImDrawVert& v3 = vertices[idx_buffer[i + 5]];
-
-			if (v0.pos.x == v3.pos.x &&
-			    v1.pos.x == v2.pos.x &&
-			    v0.pos.y == v1.pos.y &&
-			    v2.pos.y == v3.pos.y &&
-			    v0.uv.x == v3.uv.x &&
-			    v1.uv.x == v2.uv.x &&
-			    v0.uv.y == v1.uv.y &&
-			    v2.uv.y == v3.uv.y)
-			{
-				const bool has_uniform_color =
-					v0.col == v1.col &&
-					v0.col == v2.col &&
-					v0.col == v3.col;
-
-			        const bool has_texture =
-					v0.uv != white_uv ||
-					v1.uv != white_uv ||
-					v2.uv != white_uv ||
-					v3.uv != white_uv;
-
-				if (has_uniform_color && has_texture) // HERE
-				{
-				   paint_uniform_textured_rectangle(target, *texture, pcmd.ClipRect, v0, v2, stats);
-				   i += 6;
-				   continue;
-				}
-			}
+		const uint32_t start = timing_now();
+
+		// Text is common, and is made of textured rectangles. So let's optimize for it,
+		// a run of consecutive glyphs at a time.
+		if (options.optimize_text && is_glyph_quad(vertices, idx_buffer, i, pcmd.ElemCount, white_uv)) {
+			i = paint_glyph_run(target, *texture, pcmd.ClipRect, vertices, idx_buffer, i, pcmd.ElemCount,
+			                    white_uv, stats);
+			stats->text_cycles += timing_now() - start;
+			continue;
 		}
 
 		// A lot of the big stuff are uniformly colored rectangles,
@@ -697,7 +1158,11 @@ void paint_draw_cmd(
 				max.x = std::min(max.x, pcmd.ClipRect.z - 0.5f);
 				max.y = std::min(max.y, pcmd.ClipRect.w - 0.5f);
 
-				if (max.x < min.x || max.y < min.y) { i+=6; continue; } // Completely clipped
+				if (max.x < min.x || max.y < min.y) { // Completely clipped
+					i += 6;
+					stats->rectangle_cycles += timing_now() - start;
+					continue;
+				}
 
 				const auto num_pixels = (max.x - min.x) * (max.y - min.y) * target.scale.x * target.scale.y;
 
@@ -707,6 +1172,7 @@ void paint_draw_cmd(
 					} else {
 						paint_uniform_rectangle(target, min, max, ColorInt(v0.col), stats);
 						i += 6;
+						stats->rectangle_cycles += timing_now() - start;
 						continue;
 					}
 				} else {
@@ -722,12 +1188,42 @@ void paint_draw_cmd(
 		}
 
 		const bool has_texture = (v0.uv != white_uv || v1.uv != white_uv || v2.uv != white_uv);
+		if (options.fixed_point_triangles && !has_texture && v0.col == v1.col && v0.col == v2.col) {
+			paint_uniform_triangle_fixed(target, pcmd.ClipRect, v0, v1, v2, stats);
+			i += 3;
+			stats->triangle_cycles += timing_now() - start;
+			continue;
+		}
 		paint_triangle(target, has_texture ? texture : nullptr, pcmd.ClipRect, v0, v1, v2, stats);
 		i += 3;
+		stats->triangle_cycles += timing_now() - start;
 	}
 }
 
-void paint_draw_list(const PaintTarget& target, const ImDrawList* cmd_list, const SwOptions& options, Stats* stats)
+// ----------------------------------------------------------------------------
+// Rectangles (x1, y1, x2, y2), in ImGui coordinates, empty if x1 >= x2 or y1 >= y2.
+
+bool is_empty(const ImVec4& r)
+{
+	return r.x >= r.z || r.y >= r.w;
+}
+
+ImVec4 rect_union(const ImVec4& a, const ImVec4& b)
+{
+	if (is_empty(a)) { return b; }
+	if (is_empty(b)) { return a; }
+	return ImVec4(std::min(a.x, b.x), std::min(a.y, b.y), std::max(a.z, b.z), std::max(a.w, b.w));
+}
+
+ImVec4 rect_intersection(const ImVec4& a, const ImVec4& b)
+{
+	return ImVec4(std::max(a.x, b.x), std::max(a.y, b.y), std::min(a.z, b.z), std::min(a.w, b.w));
+}
+
+// If damage is given, only paints inside it.
+template <class Format>
+void paint_draw_list(const PaintTarget<Format>& target, const ImDrawList* cmd_list, const SwOptions& options, Stats* stats,
+                     const ImVec4* damage = nullptr)
 {
 	const ImDrawIdx* idx_buffer = &cmd_list->IdxBuffer[0];
 	const ImDrawVert* vertices = cmd_list->VtxBuffer.Data;
@@ -737,6 +1233,12 @@ void paint_draw_list(const PaintTarget& target, const ImDrawList* cmd_list, cons
 		const ImDrawCmd& pcmd = cmd_list->CmdBuffer[cmd_i];
 		if (pcmd.UserCallback) {
 			pcmd.UserCallback(cmd_list, &pcmd);
+		} else if (damage) {
+			ImDrawCmd clipped_cmd = pcmd;
+			clipped_cmd.ClipRect = rect_intersection(pcmd.ClipRect, *damage);
+			if (!is_empty(clipped_cmd.ClipRect)) {
+				paint_draw_cmd(target, vertices, idx_buffer, clipped_cmd, options, stats);
+			}
 		} else {
 			paint_draw_cmd(target, vertices, idx_buffer, pcmd, options, stats);
 		}
@@ -744,6 +1246,83 @@ void paint_draw_list(const PaintTarget& target, const ImDrawList* cmd_list, cons
 	}
 }
 
+// ----------------------------------------------------------------------------
+// Damage tracking for paint_imgui_incremental: a hash and a bounding rectangle
+// (the union of the clip rects) per draw list, compared with the previous frame.
+
+const int kMaxBuffers = 3;
+
+struct DamageTracker
+{
+	ImVector<uint32_t> list_hashes;
+	ImVector<ImVec4>   list_rects;
+	ImVec4             damage[kMaxBuffers]; // Of the last painted frames (ring).
+	int                frame       = 0;
+	int                width       = 0;
+	int                height      = 0;
+	bool               valid       = false;
+};
+
+DamageTracker s_damage_tracker;
+
+// FNV-1a, one 32 bits word at a time.
+uint32_t hash_data(uint32_t h, const void* data, size_t bytes)
+{
+	const uint8_t* p = static_cast<const uint8_t*>(data);
+	for (; bytes >= 4; bytes -= 4, p += 4) {
+		uint32_t w;
+		memcpy(&w, p, 4);
+		h = (h ^ w) * 16777619u;
+	}
+	for (; bytes > 0; --bytes, ++p) {
+		h = (h ^ *p) * 16777619u;
+	}
+	return h;
+}
+
+uint32_t hash_draw_list(const ImDrawList* cmd_list, ImVec4* rect)
+{
+	uint32_t h = 2166136261u;
+	*rect = ImVec4(0, 0, 0, 0);
+	for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.size(); cmd_i++) {
+		const ImDrawCmd& pcmd = cmd_list->CmdBuffer[cmd_i];
+		h = hash_data(h, &pcmd.ClipRect, sizeof(pcmd.ClipRect));
+		h = hash_data(h, &pcmd.TextureId, sizeof(pcmd.TextureId));
+		h = hash_data(h, &pcmd.ElemCount, sizeof(pcmd.ElemCount));
+		*rect = rect_union(*rect, pcmd.ClipRect);
+	}
+	h = hash_data(h, cmd_list->IdxBuffer.Data, cmd_list->IdxBuffer.size() * sizeof(ImDrawIdx));
+	h = hash_data(h, cmd_list->VtxBuffer.Data, cmd_list->VtxBuffer.size() * sizeof(ImDrawVert));
+	return h;
+}
+
+// Returns the part of the screen that changed since the previous frame.
+ImVec4 update_damage(const ImDrawData* draw_data, const ImVec4& screen)
+{
+	DamageTracker& t = s_damage_tracker;
+	ImVec4 damage(0, 0, 0, 0);
+
+	const bool same_lists = t.valid && t.list_hashes.size() == draw_data->CmdListsCount;
+	if (!same_lists) {
+		damage = screen;
+		t.list_hashes.resize(draw_data->CmdListsCount);
+		t.list_rects.resize(draw_data->CmdListsCount);
+	}
+
+	for (int i = 0; i < draw_data->CmdListsCount; ++i) {
+		ImVec4 rect;
+		const uint32_t h = hash_draw_list(draw_data->CmdLists[i], &rect);
+		if (same_lists && h != t.list_hashes[i]) {
+			damage = rect_union(damage, rect_union(t.list_rects[i], rect));
+		}
+		t.list_hashes[i] = h;
+		t.list_rects[i] = rect;
+	}
+
+	t.valid = true;
+	return rect_intersection(damage, screen);
+}
+
 } // namespace
 
 void make_style_fast()
@@ -764,6 +1343,47 @@ void restore_style()
 	style.WindowRounding = default_style.WindowRounding;
 }
 
+// Repacks the glyphs of the fonts of the atlas, see GlyphCache.
+static void build_glyph_cache(const ImFontAtlas* atlas, Texture* texture)
+{
+	GlyphCache& cache = texture->glyphs;
+	int num_glyphs = 0;
+	for (int f = 0; f < atlas->Fonts.Size; ++f) { num_glyphs += atlas->Fonts[f]->Glyphs.Size; }
+	if (num_glyphs == 0) { return; }
+
+	cache.num_slots = 1;
+	while (cache.num_slots < 2 * num_glyphs) { cache.num_slots *= 2; }
+	cache.slots = static_cast<PackedGlyph*>(ImGui::MemAlloc(cache.num_slots * sizeof(PackedGlyph)));
+	memset(cache.slots, 0, cache.num_slots * sizeof(PackedGlyph));
+
+	// Places the glyphs (twice the same rectangle is stored once), then copies them.
+	uint32_t size = 0;
+	for (int f = 0; f < atlas->Fonts.Size; ++f) {
+		for (const ImFontGlyph& g : atlas->Fonts[f]->Glyphs) {
+			const int x = static_cast<int>(g.U0 * texture->width  + 0.5f);
+			const int y = static_cast<int>(g.V0 * texture->height + 0.5f);
+			const int w = static_cast<int>(g.U1 * texture->width  + 0.5f) - x;
+			const int h = static_cast<int>(g.V1 * texture->height + 0.5f) - y;
+			if (w <= 0 || h <= 0 || find_glyph(cache, x, y)) { continue; }
+			uint32_t s = glyph_slot(cache, x, y);
+			while (cache.slots[s].width != 0) { s = (s + 1) & (cache.num_slots - 1); }
+			cache.slots[s] = PackedGlyph{uint16_t(x), uint16_t(y), uint16_t(w), uint16_t(h), size};
+			size += (w * h + kGlyphAlign - 1) & ~(kGlyphAlign - 1);
+		}
+	}
+	cache.memory = ImGui::MemAlloc(size + kGlyphAlign);
+	cache.pixels = reinterpret_cast<uint8_t*>(
+		(reinterpret_cast<uintptr_t>(cache.memory) + kGlyphAlign - 1) & ~uintptr_t(kGlyphAlign - 1));
+	memset(cache.pixels, 0, size);
+	for (int s = 0; s < cache.num_slots; ++s) {
+		const PackedGlyph& g = cache.slots[s];
+		for (int row = 0; row < g.height; ++row) {
+			memcpy(cache.pixels + g.offset + row * g.width,
+			       texture->pixels + (g.y + row) * texture->width + g.x, g.width);
+		}
+	}
+}
+
 void bind_imgui_painting()
 {
 	ImGuiIO& io = ImGui::GetIO();
@@ -773,29 +1393,332 @@ void bind_imgui_painting()
 	int font_width, font_height;
 	io.Fonts->GetTexDataAsAlpha8(&tex_data, &font_width, &font_height);
         const auto texture = new Texture{tex_data, font_width, font_height};
+	build_glyph_cache(io.Fonts, texture);
 	io.Fonts->TexID = texture;
 }
 
 static Stats s_stats; // TODO: pass as an argument?
 
+template <class Format>
+static void paint_imgui_in(const ImDrawData* draw_data, typename Format::Pixel* pixels, int width_pixels, int height_pixels,
+                           const SwOptions& options)
+{
+	const float width_points = draw_data->DisplaySize.x;
+	const float height_points = draw_data->DisplaySize.y;
+	const ImVec2 scale{width_pixels / width_points, height_pixels / height_points};
+	PaintTarget<Format> target{pixels, width_pixels, height_pixels, scale};
+
+	s_stats = Stats{};
+	for (int i = 0; i < draw_data->CmdListsCount; ++i) {
+		paint_draw_list(target, draw_data->CmdLists[i], options, &s_stats);
+	}
+}
+
 void paint_imgui(uint32_t* pixels, int width_pixels, int height_pixels, const SwOptions& options)
 {
+	paint_imgui_in<FormatRGBA8888>(ImGui::GetDrawData(), pixels, width_pixels, height_pixels, options);
+}
+
+void paint_imgui(uint16_t* pixels, int width_pixels, int height_pixels, const SwOptions& options)
+{
+	paint_imgui_in<FormatRGB565>(ImGui::GetDrawData(), pixels, width_pixels, height_pixels, options);
+}
+
+void paint_imgui(uint8_t* pixels, int width_pixels, int height_pixels, const SwOptions& options)
+{
+	paint_imgui_in<FormatRGB332>(ImGui::GetDrawData(), pixels, width_pixels, height_pixels, options);
+}
+
+void paint_draw_data(const ImDrawData* draw_data, uint32_t* pixels, int width_pixels, int height_pixels,
+                     const SwOptions& options)
+{
+	paint_imgui_in<FormatRGBA8888>(draw_data, pixels, width_pixels, height_pixels, options);
+}
+
+bool paint_imgui_incremental(uint32_t* pixels, int width_pixels, int height_pixels,
+                             int num_buffers, uint32_t clear_color, const SwOptions& options)
+{
+	DamageTracker& t = s_damage_tracker;
+	num_buffers = std::max(1, std::min(num_buffers, kMaxBuffers));
+	s_stats = Stats{};
+
 	const float width_points = ImGui::GetIO().DisplaySize.x;
 	const float height_points = ImGui::GetIO().DisplaySize.y;
 	const ImVec2 scale{width_pixels / width_points, height_pixels / height_points};
-	PaintTarget target{pixels, width_pixels, height_pixels, scale};
+	PaintTarget<FormatRGBA8888> target{pixels, width_pixels, height_pixels, scale};
 	const ImDrawData* draw_data = ImGui::GetDrawData();
+	const ImVec4 screen(0, 0, width_points, height_points);
+
+	if (width_pixels != t.width || height_pixels != t.height) {
+		t.width = width_pixels;
+		t.height = height_pixels;
+		t.valid = false;
+	}
+	if (!t.valid) {
+		for (int i = 0; i < kMaxBuffers; ++i) { t.damage[i] = screen; }
+	}
+
+	// The buffer has the frame painted num_buffers frames ago: repaint what
+	// changed in this frame and in the num_buffers - 1 previous ones.
+	ImVec4 damage = update_damage(draw_data, screen);
+	ImVec4 repaint = damage;
+	for (int i = 1; i < num_buffers; ++i) {
+		repaint = rect_union(repaint, t.damage[(t.frame + kMaxBuffers - i) % kMaxBuffers]);
+	}
+	if (is_empty(repaint)) { return false; }
+
+	t.damage[t.frame] = damage;
+	t.frame = (t.frame + 1) % kMaxBuffers;
+
+	// Whole pixels, and the same rectangle in ImGui coordinates for clipping:
+	const int x1 = std::max(0, static_cast<int>(repaint.x * scale.x));
+	const int y1 = std::max(0, static_cast<int>(repaint.y * scale.y));
+	const int x2 = std::min(width_pixels,  static_cast<int>(repaint.z * scale.x + 0.999f));
+	const int y2 = std::min(height_pixels, static_cast<int>(repaint.w * scale.y + 0.999f));
+	if (x1 >= x2 || y1 >= y2) { return false; }
+	const ImVec4 clip(x1 / scale.x, y1 / scale.y, x2 / scale.x, y2 / scale.y);
+
+	fill_rect(target, x1, y1, x2, y2, clear_color);
 
-	s_stats = Stats{};
 	for (int i = 0; i < draw_data->CmdListsCount; ++i) {
-		paint_draw_list(target, draw_data->CmdLists[i], options, &s_stats);
+		paint_draw_list(target, draw_data->CmdLists[i], options, &s_stats, &clip);
+	}
+	return true;
+}
+
+void invalidate_imgui_painting()
+{
+	s_damage_tracker.valid = false;
+}
+
+// Paints with its own stats, so that bands can be painted in parallel.
+static void paint_band(uint32_t* pixels, int width_pixels, int height_pixels,
+                       int band_index, int num_bands, const SwOptions& options, Stats* stats)
+{
+	const float width_points = ImGui::GetIO().DisplaySize.x;
+	const float height_points = ImGui::GetIO().DisplaySize.y;
+	const ImVec2 scale{width_pixels / width_points, height_pixels / height_points};
+	PaintTarget<FormatRGBA8888NoBlitter> target{pixels, width_pixels, height_pixels, scale};
+	const ImDrawData* draw_data = ImGui::GetDrawData();
+
+	const int y1 = height_pixels * band_index / num_bands;
+	const int y2 = height_pixels * (band_index + 1) / num_bands;
+	if (y1 >= y2) { return; }
+	const ImVec4 band(0, y1 / scale.y, width_points, y2 / scale.y);
+
+	for (int i = 0; i < draw_data->CmdListsCount; ++i) {
+		paint_draw_list(target, draw_data->CmdLists[i], options, stats, &band);
+	}
+}
+
+void paint_imgui_band(uint32_t* pixels, int width_pixels, int height_pixels,
+                      int band_index, int num_bands, const SwOptions& options)
+{
+	s_stats = Stats{};
+	paint_band(pixels, width_pixels, height_pixels, band_index, num_bands, options, &s_stats);
+}
+
+#ifdef IMGUI_SW_SMP
+
+// Sense reversing spin barrier.
+struct SpinBarrier
+{
+	volatile int count = 0;
+	volatile int sense = 0;
+};
+
+static void spin_barrier_wait(SpinBarrier* barrier, int num_cores, int* local_sense)
+{
+	*local_sense = !*local_sense;
+	if (__atomic_add_fetch(&barrier->count, 1, __ATOMIC_ACQ_REL) == num_cores) {
+		barrier->count = 0;
+		__atomic_store_n(&barrier->sense, *local_sense, __ATOMIC_RELEASE);
+	} else {
+		while (__atomic_load_n(&barrier->sense, __ATOMIC_ACQUIRE) != *local_sense) { }
+	}
+}
+
+// The frame being painted, written by core 0 before the start barrier.
+struct SmpFrame
+{
+	uint32_t*        pixels;
+	int              width;
+	int              height;
+	const SwOptions* options;
+};
+
+// Used twice per frame, before and after painting.
+static SmpFrame    s_smp_frame;
+static SpinBarrier s_smp_barrier;
+static Stats       s_smp_stats[kMaxCores];
+static int         s_smp_sense[kMaxCores]; // Each core only uses its own.
+
+void paint_imgui_smp(uint32_t* pixels, int width_pixels, int height_pixels,
+                     int num_cores, const SwOptions& options)
+{
+	num_cores = std::max(1, std::min(num_cores, kMaxCores));
+	s_smp_frame = SmpFrame{pixels, width_pixels, height_pixels, &options};
+
+	spin_barrier_wait(&s_smp_barrier, num_cores, &s_smp_sense[0]);
+	s_smp_stats[0] = Stats{};
+	paint_band(pixels, width_pixels, height_pixels, 0, num_cores, options, &s_smp_stats[0]);
+	spin_barrier_wait(&s_smp_barrier, num_cores, &s_smp_sense[0]);
+
+	s_stats = Stats{};
+	for (int i = 0; i < num_cores; ++i) {
+		const Stats& st = s_smp_stats[i];
+		s_stats.uniform_triangle_pixels            += st.uniform_triangle_pixels;
+		s_stats.textured_triangle_pixels           += st.textured_triangle_pixels;
+		s_stats.gradient_triangle_pixels           += st.gradient_triangle_pixels;
+		s_stats.font_pixels                        += st.font_pixels;
+		s_stats.uniform_rectangle_pixels           += st.uniform_rectangle_pixels;
+		s_stats.textured_rectangle_pixels          += st.textured_rectangle_pixels;
+		s_stats.gradient_rectangle_pixels          += st.gradient_rectangle_pixels;
+		s_stats.gradient_textured_rectangle_pixels += st.gradient_textured_rectangle_pixels;
+		s_stats.text_cycles                        += st.text_cycles;
+		s_stats.rectangle_cycles                   += st.rectangle_cycles;
+		s_stats.triangle_cycles                    += st.triangle_cycles;
+	}
+}
+
+void smp_paint_worker(int core_index, int num_cores)
+{
+	num_cores = std::max(1, std::min(num_cores, kMaxCores));
+	for (;;) {
+		spin_barrier_wait(&s_smp_barrier, num_cores, &s_smp_sense[core_index]);
+		const SmpFrame frame = s_smp_frame;
+		s_smp_stats[core_index] = Stats{};
+		paint_band(frame.pixels, frame.width, frame.height, core_index, num_cores,
+		           *frame.options, &s_smp_stats[core_index]);
+		spin_barrier_wait(&s_smp_barrier, num_cores, &s_smp_sense[core_index]);
+	}
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// Frame timing
+
+// One frame: the phases, then the paint phase split by kind of primitive.
+struct FrameTiming
+{
+	uint32_t phase[kNumPhases];
+	uint32_t text;
+	uint32_t rectangles;
+	uint32_t triangles;
+};
+
+// Rolling window of the last kTimingWindow frames.
+struct TimingWindow
+{
+	FrameTiming frames[kTimingWindow];
+	FrameTiming current;
+	uint32_t    last_mark = 0;
+	int         next = 0;      // Where the next frame goes.
+	int         count = 0;     // Number of valid frames.
+	uint32_t    num_frames = 0; // Number of frames since the start.
+};
+
+static TimingWindow s_timing;
+
+void timing_begin_frame()
+{
+	s_timing.current = FrameTiming{};
+	s_timing.last_mark = timing_now();
+}
+
+void timing_mark(TimingPhase phase)
+{
+	const uint32_t now = timing_now();
+	s_timing.current.phase[phase] += now - s_timing.last_mark;
+	s_timing.last_mark = now;
+}
+
+void timing_end_frame()
+{
+	FrameTiming& frame = s_timing.current;
+	frame.text       = s_stats.text_cycles;
+	frame.rectangles = s_stats.rectangle_cycles;
+	frame.triangles  = s_stats.triangle_cycles;
+	s_timing.frames[s_timing.next] = frame;
+	s_timing.next = (s_timing.next + 1) % kTimingWindow;
+	s_timing.count = std::min(s_timing.count + 1, kTimingWindow);
+	++s_timing.num_frames;
+}
+
+static const char* const s_timing_names[] = {
+	"logic", "render", "paint", "swap", "text", "rectangles", "triangles"
+};
+static const int kNumTimingColumns = kNumPhases + 3;
+
+static uint32_t timing_column(const FrameTiming& frame, int column)
+{
+	switch (column - kNumPhases) {
+	case 0:  return frame.text;
+	case 1:  return frame.rectangles;
+	case 2:  return frame.triangles;
+	default: return frame.phase[column];
+	}
+}
+
+// Min, average and max of a column over the window.
+static void timing_summary(int column, uint32_t* min, uint32_t* avg, uint32_t* max)
+{
+	uint64_t sum = 0;
+	*min = s_timing.count ? ~0u : 0u;
+	*max = 0;
+	for (int i = 0; i < s_timing.count; ++i) {
+		const uint32_t t = timing_column(s_timing.frames[i], column);
+		*min = std::min(*min, t);
+		*max = std::max(*max, t);
+		sum += t;
+	}
+	*avg = s_timing.count ? static_cast<uint32_t>(sum / s_timing.count) : 0u;
+}
+
+void show_timing()
+{
+	ImGui::Text("%-10s %10s %10s %10s", "", "min", "avg", "max");
+	for (int c = 0; c < kNumTimingColumns; ++c) {
+		uint32_t min, avg, max;
+		timing_summary(c, &min, &avg, &max);
+		ImGui::Text("%-10s %10u %10u %10u", s_timing_names[c], min, avg, max);
+	}
+}
+
+void show_timing_in_terminal()
+{
+	printf("%-10s %10s %10s %10s (%d frames)\n", "", "min", "avg", "max", s_timing.count);
+	for (int c = 0; c < kNumTimingColumns; ++c) {
+		uint32_t min, avg, max;
+		timing_summary(c, &min, &avg, &max);
+		printf("%-10s %10u %10u %10u\n", s_timing_names[c], min, avg, max);
+	}
+}
+
+void dump_timing_csv()
+{
+	printf("frame");
+	for (int c = 0; c < kNumTimingColumns; ++c) { printf(",%s", s_timing_names[c]); }
+	printf("\n");
+	// Oldest frame first.
+	for (int i = 0; i < s_timing.count; ++i) {
+		const int k = (s_timing.next - s_timing.count + i + kTimingWindow) % kTimingWindow;
+		printf("%u", s_timing.num_frames - s_timing.count + i);
+		for (int c = 0; c < kNumTimingColumns; ++c) {
+			printf(",%u", timing_column(s_timing.frames[k], c));
+		}
+		printf("\n");
 	}
 }
 
 void unbind_imgui_painting()
 {
 	ImGuiIO& io = ImGui::GetIO();
-	delete reinterpret_cast<Texture*>(io.Fonts->TexID);
+	Texture* texture = reinterpret_cast<Texture*>(io.Fonts->TexID);
+	ImGui::MemFree(texture->glyphs.slots);
+	ImGui::MemFree(texture->glyphs.memory);
+	delete texture;
 	io.Fonts = nullptr;
 }
 
@@ -805,6 +1728,7 @@ bool show_options(SwOptions* io_options)
 	bool changed = false;
 	changed |= ImGui::Checkbox("optimize_text", &io_options->optimize_text);
 	changed |= ImGui::Checkbox("optimize_rectangles", &io_options->optimize_rectangles);
+	changed |= ImGui::Checkbox("fixed_point_triangles", &io_options->fixed_point_triangles);
 	return changed;
 }
 
@@ -829,6 +1753,19 @@ void show_stats()
 
 }
 
+PaintStats get_paint_stats()
+{
+	PaintStats ps;
+	ps.text_pixels      = s_stats.font_pixels;
+	ps.rectangle_pixels = s_stats.uniform_rectangle_pixels;
+	ps.triangle_pixels  = double(s_stats.uniform_triangle_pixels) + s_stats.textured_triangle_pixels +
+	                      s_stats.gradient_triangle_pixels;
+	ps.text_time        = s_stats.text_cycles;
+	ps.rectangle_time   = s_stats.rectangle_cycles;
+	ps.triangle_time    = s_stats.triangle_cycles;
+	return ps;
+}
+
 void show_stats_in_terminal()
 {
 	printf("uniform_triangle_pixels:            %7d\n",   s_stats.uniform_triangle_pixels);
@@ -840,6 +1777,73 @@ void show_stats_in_terminal()
 	printf("gradient_rectangle_pixels:          %7d\n", int(s_stats.gradient_rectangle_pixels));
 	printf("gradient_textured_rectangle_pixels: %7d\n", int(s_stats.gradient_textured_rectangle_pixels));
 }
-   
-   
+
+// ----------------------------------------------------------------------------
+// Captures, replayed by Tools/imgui_sw_bench. Text, all the numbers in hex
+// (floats as their bits, so that the replay is exact):
+//   imgui_sw_capture 1 <display width> <display height> <number of lists>
+//   then for each list:
+//     list <number of vertices> <number of indices> <number of commands>
+//     v <pos.x> <pos.y> <uv.x> <uv.y> <col>          (one per vertex)
+//     i <index> ...                                  (up to 16 per line)
+//     c <clip x1> <clip y1> <clip x2> <clip y2> <elem count> (one per command)
+//   end
+// User callbacks are not captured, their indices are skipped.
+
+static uint32_t float_bits(float f)
+{
+	uint32_t result;
+	memcpy(&result, &f, sizeof(result));
+	return result;
+}
+
+void dump_draw_data(const ImDrawData* draw_data)
+{
+	if (!draw_data) { draw_data = ImGui::GetDrawData(); }
+	printf("imgui_sw_capture 1 %08x %08x %x\n",
+	       (unsigned)float_bits(draw_data->DisplaySize.x), (unsigned)float_bits(draw_data->DisplaySize.y),
+	       draw_data->CmdListsCount);
+	for (int l = 0; l < draw_data->CmdListsCount; ++l) {
+		const ImDrawList* cmd_list = draw_data->CmdLists[l];
+		int num_idx = 0, num_cmd = 0;
+		for (int c = 0; c < cmd_list->CmdBuffer.Size; ++c) {
+			if (!cmd_list->CmdBuffer[c].UserCallback) {
+				num_idx += cmd_list->CmdBuffer[c].ElemCount;
+				++num_cmd;
+			}
+		}
+		printf("list %x %x %x\n", cmd_list->VtxBuffer.Size, num_idx, num_cmd);
+		for (int v = 0; v < cmd_list->VtxBuffer.Size; ++v) {
+			const ImDrawVert& vtx = cmd_list->VtxBuffer[v];
+			printf("v %08x %08x %08x %08x %08x\n",
+			       (unsigned)float_bits(vtx.pos.x), (unsigned)float_bits(vtx.pos.y),
+			       (unsigned)float_bits(vtx.uv.x), (unsigned)float_bits(vtx.uv.y), (unsigned)vtx.col);
+		}
+		const ImDrawIdx* idx_buffer = cmd_list->IdxBuffer.Data;
+		int on_line = 0;
+		for (int c = 0; c < cmd_list->CmdBuffer.Size; ++c) {
+			const ImDrawCmd& pcmd = cmd_list->CmdBuffer[c];
+			if (!pcmd.UserCallback) {
+				for (unsigned int i = 0; i < pcmd.ElemCount; ++i) {
+					printf(on_line ? " %x" : "i %x", (unsigned)idx_buffer[i]);
+					if (++on_line == 16) {
+						printf("\n");
+						on_line = 0;
+					}
+				}
+			}
+			idx_buffer += pcmd.ElemCount;
+		}
+		if (on_line) { printf("\n"); }
+		for (int c = 0; c < cmd_list->CmdBuffer.Size; ++c) {
+			const ImDrawCmd& pcmd = cmd_list->CmdBuffer[c];
+			if (pcmd.UserCallback) { continue; }
+			printf("c %08x %08x %08x %08x %x\n",
+			       (unsigned)float_bits(pcmd.ClipRect.x), (unsigned)float_bits(pcmd.ClipRect.y),
+			       (unsigned)float_bits(pcmd.ClipRect.z), (unsigned)float_bits(pcmd.ClipRect.w), pcmd.ElemCount);
+		}
+	}
+	printf("end\n");
+}
+
 } // namespace imgui_sw
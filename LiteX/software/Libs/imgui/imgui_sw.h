@@ -14,12 +14,15 @@
 
 #include <stdint.h>
 
+struct ImDrawData;
+
 namespace imgui_sw {
 
 struct SwOptions
 {
 	bool optimize_text = true;  // No reason to turn this off.
 	bool optimize_rectangles = true; // No reason to turn this off.
+	bool fixed_point_triangles = true; // Integer rasterizer for uniformly colored untextured triangles (no float per pixel).
 };
 
 /// Optional: tweak ImGui style to make it render faster.
@@ -37,6 +40,53 @@ void bind_imgui_painting();
 /// the function scales the UI to fit the given pixel buffer.
 void paint_imgui(uint32_t* pixels, int width_pixels, int height_pixels, const SwOptions& options = {});
 
+/// Paints directly into a 16 bits RGB565 buffer (SSD1351 OLED, FGA 16bpp).
+void paint_imgui(uint16_t* pixels, int width_pixels, int height_pixels, const SwOptions& options = {});
+
+/// Paints directly into an 8 bits buffer of palette indices, the palette being
+/// RGB332: entry i has R = i & 0xE0, G = (i << 3) & 0xE0, B = (i << 6) & 0xC0.
+void paint_imgui(uint8_t* pixels, int width_pixels, int height_pixels, const SwOptions& options = {});
+
+/// Paints draw_data instead of ImGui::GetDrawData(), scaled from its DisplaySize
+/// (for replaying captures, see dump_draw_data()).
+void paint_draw_data(const ImDrawData* draw_data, uint32_t* pixels, int width_pixels, int height_pixels,
+                     const SwOptions& options = {});
+
+/// Like paint_imgui, but only repaints where the draw lists changed since the
+/// frame that was painted last in this buffer. It clears these parts with
+/// clear_color first, so the buffer must not be cleared by the caller.
+/// num_buffers is the number of buffers painted in turn (2 with double
+/// buffering, at most 3). Returns false if nothing changed: the buffer was
+/// not touched and does not need to be swapped.
+bool paint_imgui_incremental(uint32_t* pixels, int width_pixels, int height_pixels,
+                             int num_buffers = 2, uint32_t clear_color = 0,
+                             const SwOptions& options = {});
+
+/// Forces the next paint_imgui_incremental to repaint everything.
+void invalidate_imgui_painting();
+
+/// Paints the horizontal band band_index of num_bands bands of equal height
+/// (all the draw commands, clipped to the band). Does not use the blitter,
+/// so that several cores can paint their bands at the same time.
+void paint_imgui_band(uint32_t* pixels, int width_pixels, int height_pixels,
+                      int band_index, int num_bands, const SwOptions& options = {});
+
+#ifdef IMGUI_SW_SMP
+// Multi-core painting (LiteX SMP builds, compile with -DIMGUI_SW_SMP, needs
+// the RISC-V A extension). Each secondary core calls smp_paint_worker() with
+// its index (1 .. num_cores-1) once started. paint_imgui_smp() is called by
+// core 0 with the same num_cores: each core paints one band, and it returns
+// when all the bands are painted (spin barrier), before fb_swap_buffers().
+const int kMaxCores = 8;
+
+/// Paints with num_cores cores (at most kMaxCores), core 0 being the caller.
+void paint_imgui_smp(uint32_t* pixels, int width_pixels, int height_pixels,
+                     int num_cores, const SwOptions& options = {});
+
+/// Main loop of secondary core core_index, never returns.
+void smp_paint_worker(int core_index, int num_cores);
+#endif
+
 /// Free the resources allocated by bind_imgui_painting.
 void unbind_imgui_painting();
 
@@ -47,5 +97,56 @@ bool show_options(SwOptions* io_options);
 void show_stats();
 
 void show_stats_in_terminal();
+
+/// What the last paint did, per kind of primitive: pixels, and time in timing_now() units.
+struct PaintStats
+{
+	double   text_pixels;
+	double   rectangle_pixels;
+	double   triangle_pixels;
+	uint32_t text_time;
+	uint32_t rectangle_time;
+	uint32_t triangle_time;
+};
+
+PaintStats get_paint_stats();
+
+/// Prints draw_data (ImGui::GetDrawData() if null) as text, over the UART on
+/// the board, so that it can be replayed on the host (Tools/imgui_sw_bench).
+void dump_draw_data(const ImDrawData* draw_data = nullptr);
+
+// Frame timing, in cycles (rdcycle) on RISC-V and in nanoseconds
+// (monotonic clock) on the host. A frame is timed like this:
+//   timing_begin_frame();
+//   ImGui::NewFrame(); ... UI code ...  timing_mark(kPhaseLogic);
+//   ImGui::Render();                    timing_mark(kPhaseRender);
+//   paint_imgui(...);                   timing_mark(kPhasePaint);
+//   fb_swap_buffers();                  timing_mark(kPhaseSwap);
+//   timing_end_frame();
+// The paint phase is also split by kind of primitive (text, rectangles,
+// triangles; with paint_imgui_smp, the sum over the cores). The last
+// kTimingWindow frames are kept.
+enum TimingPhase { kPhaseLogic, kPhaseRender, kPhasePaint, kPhaseSwap, kNumPhases };
+const int kTimingWindow = 64;
+
+/// The cycle counter (wraps around, only differences are meaningful).
+uint32_t timing_now();
+
+/// Starts timing a frame.
+void timing_begin_frame();
+
+/// Adds the time since the previous mark (or timing_begin_frame) to phase.
+void timing_mark(TimingPhase phase);
+
+/// Adds the frame to the window.
+void timing_end_frame();
+
+/// Show min/avg/max of each phase over the window in an ImGui window.
+void show_timing();
+
+void show_timing_in_terminal();
+
+/// Prints the frames of the window as CSV (one line per frame, over the UART on the board).
+void dump_timing_csv();
    
 } // namespace imgui_sw
@@ -0,0 +1,131 @@
+#include <lite_arena.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/*
+ * Each block starts with an 8 bytes header that stores its size class:
+ * a block of class c is (1 << c) bytes long, header included. Blocks
+ * allocated with malloc() when the arena is full have class
+ * ARENA_MALLOC_CLASS.
+ */
+#define ARENA_HEADER_SIZE   8
+#define ARENA_MIN_CLASS     4   /* 16 bytes */
+#define ARENA_NB_CLASSES    32
+#define ARENA_MALLOC_CLASS  0xFF
+
+typedef struct {
+    uint32_t size_class;
+    uint32_t unused;
+} ArenaHeader;
+
+typedef struct FreeBlock {
+    struct FreeBlock* next;
+} FreeBlock;
+
+static uint8_t*       arena_base = NULL;
+static uint8_t*       arena_top  = NULL;  /* first byte not carved yet */
+static uint8_t*       arena_end  = NULL;
+static FreeBlock*     free_lists[ARENA_NB_CLASSES];
+static LiteArenaStats arena_stats;
+
+void lite_arena_init(void* mem, size_t size) {
+    int c;
+    arena_base = (uint8_t*)mem;
+    arena_top  = arena_base;
+    arena_end  = arena_base + (size & ~(size_t)7);
+    for(c=0; c<ARENA_NB_CLASSES; ++c) {
+	free_lists[c] = NULL;
+    }
+    arena_stats = (LiteArenaStats){0};
+    arena_stats.arena_size = arena_end - arena_base;
+}
+
+static inline uint32_t size_class(size_t size) {
+    uint32_t c = ARENA_MIN_CLASS;
+    size += ARENA_HEADER_SIZE;
+    while(((size_t)1 << c) < size) {
+	++c;
+    }
+    return c;
+}
+
+void* lite_arena_alloc(size_t size) {
+    uint32_t c = size_class(size);
+    ArenaHeader* header = NULL;
+    ++arena_stats.allocs;
+    if(c < ARENA_NB_CLASSES && free_lists[c] != NULL) {
+	header = (ArenaHeader*)free_lists[c];
+	free_lists[c] = free_lists[c]->next;
+    } else if(c < ARENA_NB_CLASSES && ((size_t)1 << c) <= (size_t)(arena_end - arena_top)) {
+	header = (ArenaHeader*)arena_top;
+	arena_top += (size_t)1 << c;
+	arena_stats.high_water = arena_top - arena_base;
+	++arena_stats.carved;
+    } else {
+	header = (ArenaHeader*)malloc(size + ARENA_HEADER_SIZE);
+	if(header == NULL) {
+	    return NULL;
+	}
+	header->size_class = ARENA_MALLOC_CLASS;
+	++arena_stats.fallbacks;
+	return (uint8_t*)header + ARENA_HEADER_SIZE;
+    }
+    header->size_class = c;
+    arena_stats.in_use += (size_t)1 << c;
+    if(arena_stats.in_use > arena_stats.peak_in_use) {
+	arena_stats.peak_in_use = arena_stats.in_use;
+    }
+    return (uint8_t*)header + ARENA_HEADER_SIZE;
+}
+
+void lite_arena_free(void* ptr) {
+    ArenaHeader* header;
+    FreeBlock* block;
+    uint32_t c;
+    if(ptr == NULL) {
+	return;
+    }
+    header = (ArenaHeader*)((uint8_t*)ptr - ARENA_HEADER_SIZE);
+    ++arena_stats.frees;
+    c = header->size_class;
+    if(c == ARENA_MALLOC_CLASS) {
+	free(header);
+	return;
+    }
+    arena_stats.in_use -= (size_t)1 << c;
+    block = (FreeBlock*)header;
+    block->next = free_lists[c];
+    free_lists[c] = block;
+}
+
+void* lite_arena_imgui_alloc(size_t size, void* user_data) {
+    (void)user_data;
+    return lite_arena_alloc(size);
+}
+
+void lite_arena_imgui_free(void* ptr, void* user_data) {
+    (void)user_data;
+    lite_arena_free(ptr);
+}
+
+void lite_arena_get_stats(LiteArenaStats* stats) {
+    *stats = arena_stats;
+}
+
+void lite_arena_reset_counters(void) {
+    arena_stats.allocs    = 0;
+    arena_stats.frees     = 0;
+    arena_stats.carved    = 0;
+    arena_stats.fallbacks = 0;
+}
+
+void lite_arena_print_stats(void) {
+    printf("arena: %u KB, high water %u KB, in use %u KB (peak %u KB)\n",
+	   (unsigned)(arena_stats.arena_size  >> 10),
+	   (unsigned)(arena_stats.high_water  >> 10),
+	   (unsigned)(arena_stats.in_use      >> 10),
+	   (unsigned)(arena_stats.peak_in_use >> 10));
+    printf("arena: %u allocs, %u frees, %u carved, %u malloc fallbacks\n",
+	   (unsigned)arena_stats.allocs, (unsigned)arena_stats.frees,
+	   (unsigned)arena_stats.carved, (unsigned)arena_stats.fallbacks);
+}
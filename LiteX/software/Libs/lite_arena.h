@@ -0,0 +1,88 @@
+// Pool allocator over a fixed arena, for programs that allocate and free
+// all the time (Dear ImGui vectors grow and shrink every frame).
+//
+// The arena is carved into blocks of power-of-two sizes, and freed blocks
+// go to the free list of their size, never back to malloc(). Once the
+// program has reached its peak usage, allocations are served from the free
+// lists without touching the heap (no fragmentation, constant time).
+
+#ifndef LITE_ARENA
+#define LITE_ARENA
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Counters of the arena.
+ * \see lite_arena_get_stats(), lite_arena_reset_counters()
+ */
+typedef struct {
+    size_t   arena_size;    /**< size of the arena, in bytes                  */
+    size_t   high_water;    /**< bytes of the arena carved into blocks         */
+    size_t   in_use;        /**< bytes of the blocks currently allocated       */
+    size_t   peak_in_use;   /**< maximum of in_use                             */
+    uint32_t allocs;        /**< allocations since the last reset              */
+    uint32_t frees;         /**< frees since the last reset                    */
+    uint32_t carved;        /**< allocations that carved a new block           */
+    uint32_t fallbacks;     /**< allocations that did not fit (used malloc())  */
+} LiteArenaStats;
+
+/**
+ * \brief Uses a zone of memory as the arena.
+ * \param[in] mem the zone, aligned on 8 bytes
+ * \param[in] size the size of the zone, in bytes
+ */
+void lite_arena_init(void* mem, size_t size);
+
+/**
+ * \brief Allocates a block, 8 bytes aligned.
+ * \details Uses malloc() when the arena is full.
+ * \param[in] size the size, in bytes
+ * \return the block, or NULL if out of memory
+ */
+void* lite_arena_alloc(size_t size);
+
+/**
+ * \brief Frees a block allocated by lite_arena_alloc().
+ * \param[in] ptr the block, or NULL (does nothing)
+ */
+void lite_arena_free(void* ptr);
+
+/**
+ * \brief Same as lite_arena_alloc(), with the signature of
+ *  ImGui::SetAllocatorFunctions().
+ */
+void* lite_arena_imgui_alloc(size_t size, void* user_data);
+
+/**
+ * \brief Same as lite_arena_free(), with the signature of
+ *  ImGui::SetAllocatorFunctions().
+ */
+void lite_arena_imgui_free(void* ptr, void* user_data);
+
+/**
+ * \brief Gets the counters.
+ * \param[out] stats the counters
+ */
+void lite_arena_get_stats(LiteArenaStats* stats);
+
+/**
+ * \brief Resets the allocs, frees, carved and fallbacks counters.
+ * \details Called once per frame, gives the heap traffic of a frame.
+ */
+void lite_arena_reset_counters(void);
+
+/**
+ * \brief Prints the counters.
+ */
+void lite_arena_print_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
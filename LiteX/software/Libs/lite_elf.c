@@ -1,6 +1,7 @@
 #include <lite_elf.h>
 #include <libfatfs/ff.h>
 #include <generated/csr.h>
+#include <libbase/crc.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -105,25 +106,229 @@ typedef struct
 
 /****************************************************************************/
 
-int elf32_parse(const char* filename, Elf32Info* info) {
+/*
+ * Reads the compressed data through a sector buffer (f_read() for
+ * each byte of the LZ4 tokens would be far too slow).
+ */
+typedef struct {
+  FIL*     fp;
+  uint8_t* ptr;
+  UINT     count;
+  uint8_t  buffer[512];
+} ElzReader;
+
+static int elz_getc(ElzReader* r) {
+  if(r->count == 0) {
+    if(f_read(r->fp, r->buffer, sizeof(r->buffer), &r->count) != FR_OK || r->count == 0) {
+      return -1;
+    }
+    r->ptr = r->buffer;
+  }
+  --r->count;
+  return *r->ptr++;
+}
+
+static int elz_read(ElzReader* r, uint8_t* dst, UINT len) {
+  UINT n = (len < r->count) ? len : r->count;
+  UINT br;
+  memcpy(dst, r->ptr, n);
+  r->ptr   += n;
+  r->count -= n;
+  if(n < len) {
+    /* the rest goes straight to the destination */
+    if(f_read(r->fp, dst + n, len - n, &br) != FR_OK || br != len - n) {
+      return ELF32_READ_ERROR;
+    }
+  }
+  return ELF32_OK;
+}
+
+static int elz_get_length(ElzReader* r, uint32_t* len, uint32_t* in) {
+  int b;
+  do {
+    b = elz_getc(r);
+    if(b < 0) {
+      return ELF32_READ_ERROR;
+    }
+    ++(*in);
+    *len += b;
+  } while(b == 255);
+  return ELF32_OK;
+}
+
+/*
+ * Decompresses an LZ4 block of csize bytes to dst (size bytes once
+ * decompressed). Literals are read straight to dst, matches are copied
+ * from the data already decompressed.
+ */
+static int elz_decompress(ElzReader* r, uint8_t* dst, uint32_t size, uint32_t csize) {
+  uint8_t* out = dst;
+  uint8_t* end = dst + size;
+  uint32_t in = 0;
+  while(in < csize) {
+    int token = elz_getc(r);
+    uint32_t len;
+    uint32_t offset;
+    uint8_t* match;
+    int lo, hi;
+    if(token < 0) {
+      return ELF32_READ_ERROR;
+    }
+    ++in;
+
+    /* literals */
+    len = (uint32_t)token >> 4;
+    if(len == 15 && elz_get_length(r, &len, &in) != ELF32_OK) {
+      return ELF32_READ_ERROR;
+    }
+    if(len > (uint32_t)(end - out)) {
+      return ELF32_DECOMPRESS_ERROR;
+    }
+    if(len != 0) {
+      if(elz_read(r, out, len) != ELF32_OK) {
+	return ELF32_READ_ERROR;
+      }
+      out += len;
+      in  += len;
+    }
+
+    /* the last sequence has no match */
+    if(in >= csize) {
+      break;
+    }
+
+    /* match */
+    lo = elz_getc(r);
+    hi = elz_getc(r);
+    if(lo < 0 || hi < 0) {
+      return ELF32_READ_ERROR;
+    }
+    offset = (uint32_t)lo | ((uint32_t)hi << 8);
+    in += 2;
+    len = (uint32_t)token & 15;
+    if(len == 15 && elz_get_length(r, &len, &in) != ELF32_OK) {
+      return ELF32_READ_ERROR;
+    }
+    len += 4;
+    if(offset == 0 || offset > (uint32_t)(out - dst) || len > (uint32_t)(end - out)) {
+      return ELF32_DECOMPRESS_ERROR;
+    }
+    match = out - offset;
+    if(offset >= len) {
+      memcpy(out, match, len);
+      out += len;
+    } else {
+      /* overlapping match (repeated pattern) */
+      while(len--) {
+	*out++ = *match++;
+      }
+    }
+  }
+  return (out == end) ? ELF32_OK : ELF32_DECOMPRESS_ERROR;
+}
+
+/*
+ * Loads a compressed executable (see Elz_Header in lite_elf.h).
+ */
+static int elz_parse_file(FIL* fp, Elf32Info* info) {
+  static ElzReader reader; /* not on the stack (512 bytes buffer) */
+  Elz_Header header;
+  Elz_Segment segment;
+  uint8_t* base_mem = (uint8_t*)(info->base_address);
+  int status;
+
+  reader.fp = fp;
+  reader.ptr = reader.buffer;
+  reader.count = 0;
+
+  if(elz_read(&reader, (uint8_t*)&header, sizeof(header)) != ELF32_OK) {
+    return ELF32_READ_ERROR;
+  }
+  info->text_address = header.text_address;
+  info->max_address  = header.max_address;
+
+  if(info->base_address == NO_ADDRESS) {
+    return ELF32_OK;
+  }
+
+  for(uint32_t i=0; i<header.nb_segments; ++i) {
+    LEDS(i);
+    if(elz_read(&reader, (uint8_t*)&segment, sizeof(segment)) != ELF32_OK) {
+      return ELF32_READ_ERROR;
+    }
+    if(segment.filesz > segment.memsz) {
+      return ELF32_DECOMPRESS_ERROR;
+    }
+    status = elz_decompress(
+       &reader, base_mem + segment.vaddr, segment.filesz, segment.csize
+    );
+    if(status != ELF32_OK) {
+      return status;
+    }
+    if(segment.memsz > segment.filesz) {
+      memset(
+	 base_mem + segment.vaddr + segment.filesz, 0,
+	 segment.memsz - segment.filesz
+      );
+    }
+  }
+  return ELF32_OK;
+}
+
+/****************************************************************************/
+
+/*
+ * Loads a flat executable (see Fxe_Header in lite_elf.h): one read
+ * straight to the load address, then the BSS is cleared.
+ */
+static int fxe_parse_file(FIL* fp, Elf32Info* info) {
+  Fxe_Header header;
+  uint8_t* base_mem = (uint8_t*)(info->base_address);
+  UINT br;
+
+  if(
+     f_read(fp, &header, sizeof(header), &br) != FR_OK ||
+     br != sizeof(header)
+  ) {
+    return ELF32_READ_ERROR;
+  }
+  info->text_address = header.load_address;
+  info->max_address  = header.load_address + header.size + header.bss_size;
+
+  if(info->base_address == NO_ADDRESS) {
+    return ELF32_OK;
+  }
+
+  if(
+     f_lseek(fp, FXE_PAYLOAD_OFFSET) != FR_OK ||
+     f_read(fp, base_mem + header.load_address, header.size, &br) != FR_OK ||
+     br != header.size
+  ) {
+    return ELF32_READ_ERROR;
+  }
+  if(
+     header.crc != 0 &&
+     crc32(base_mem + header.load_address, header.size) != header.crc
+  ) {
+    return ELF32_CHECKSUM_ERROR;
+  }
+  memset(base_mem + header.load_address + header.size, 0, header.bss_size);
+  return ELF32_OK;
+}
+
+/****************************************************************************/
+
+static int elf32_parse_file(FIL* fp, Elf32Info* info) {
   Elf32_Ehdr elf_header;
   Elf32_Shdr sec_header;
-  FIL fp;
-  FRESULT res;
   UINT br;
-   
-  res = f_open(&fp, filename, FA_READ);
   uint8_t* base_mem = (uint8_t*)(info->base_address);
   
   info->text_address = 0;
 
-  if(res != FR_OK) {
-    return ELF32_FILE_NOT_FOUND;
-  }
-
   /* read elf header */
   if(
-     f_read(&fp, &elf_header, sizeof(elf_header), &br) != FR_OK || 
+     f_read(fp, &elf_header, sizeof(elf_header), &br) != FR_OK || 
      br != sizeof(elf_header)
   ) {
      return ELF32_READ_ERROR;
@@ -144,12 +349,12 @@ int elf32_parse(const char* filename, Elf32Info* info) {
   /* read all section headers */  
   for(int i=0; i<elf_header.e_shnum; ++i) {
     
-     if(f_lseek(&fp,elf_header.e_shoff + i*sizeof(sec_header)) != FR_OK) {
+     if(f_lseek(fp,elf_header.e_shoff + i*sizeof(sec_header)) != FR_OK) {
 	return ELF32_READ_ERROR;	  
      }
      
      if(
-	f_read(&fp,&sec_header,sizeof(sec_header), &br) != FR_OK ||
+	f_read(fp,&sec_header,sizeof(sec_header), &br) != FR_OK ||
 	br != sizeof(sec_header)
      ) {
 	return ELF32_READ_ERROR;
@@ -182,13 +387,13 @@ int elf32_parse(const char* filename, Elf32Info* info) {
 	sec_header.sh_type == SHT_FINI_ARRAY
      ) {
 	if(info->base_address != NO_ADDRESS) {
-	   if(f_lseek(&fp,sec_header.sh_offset) != FR_OK) {
+	   if(f_lseek(fp,sec_header.sh_offset) != FR_OK) {
 	      return ELF32_READ_ERROR;
 	   }
 	   
 	   if(
 	     f_read(
-		   &fp,
+		   fp,
 		   base_mem + sec_header.sh_addr, 
 		   sec_header.sh_size,
 		   &br
@@ -204,7 +409,36 @@ int elf32_parse(const char* filename, Elf32Info* info) {
 	memset(base_mem + sec_header.sh_addr, 0, sec_header.sh_size);
      }
   }  
-  f_close(&fp);
   
   return ELF32_OK;
 }
+
+int elf32_parse(const char* filename, Elf32Info* info) {
+  FIL fp;
+  UINT br;
+  uint32_t magic;
+  int status;
+
+  if(f_open(&fp, filename, FA_READ) != FR_OK) {
+    return ELF32_FILE_NOT_FOUND;
+  }
+
+  /* Flat executable, compressed executable or ELF file ? */
+  if(
+     f_read(&fp, &magic, sizeof(magic), &br) != FR_OK ||
+     br != sizeof(magic) ||
+     f_lseek(&fp, 0) != FR_OK
+  ) {
+    f_close(&fp);
+    return ELF32_READ_ERROR;
+  }
+  if(magic == FXE_MAGIC) {
+    status = fxe_parse_file(&fp, info);
+  } else if(magic == ELZ_MAGIC) {
+    status = elz_parse_file(&fp, info);
+  } else {
+    status = elf32_parse_file(&fp, info);
+  }
+  f_close(&fp);
+  return status;
+}
@@ -18,6 +18,54 @@ typedef struct {
 #define ELF32_FILE_NOT_FOUND       1
 #define ELF32_HEADER_SIZE_MISMATCH 2
 #define ELF32_READ_ERROR           3
+#define ELF32_DECOMPRESS_ERROR     4
+#define ELF32_CHECKSUM_ERROR       5
+
+/*
+ * Compressed executables (.elz, made from ELF files by
+ * FemtoRV/FIRMWARE/TOOLS/elz_pack, same format as femto_elf.h):
+ * an Elz_Header, then for each PT_LOAD segment an Elz_Segment followed
+ * by the csize bytes of the segment data, compressed as one LZ4 block
+ * (filesz bytes once decompressed, then cleared up to memsz).
+ * The functions below recognize them by their magic number.
+ */
+#define ELZ_MAGIC 0x315A4C45 /* "ELZ1" */
+
+typedef struct {
+  uint32_t magic;
+  uint32_t entry_address;
+  uint32_t text_address;
+  uint32_t max_address;
+  uint32_t nb_segments;
+} Elz_Header;
+
+typedef struct {
+  uint32_t vaddr;  /* Segment address                               */
+  uint32_t filesz; /* Size of the data (once decompressed)          */
+  uint32_t memsz;  /* Size in memory (filesz + bss)                 */
+  uint32_t csize;  /* Size of the compressed data, after the header */
+} Elz_Segment;
+
+/*
+ * Flat executables (.fxe, made from ELF files by
+ * FemtoRV/FIRMWARE/TOOLS/fxe_pack, same format as femto_elf.h): a
+ * Fxe_Header, padded to FXE_PAYLOAD_OFFSET bytes, then the size bytes
+ * of the program, already relocated at load_address, followed in memory
+ * by bss_size bytes cleared by the loader. Loading is one f_read()
+ * straight to load_address (whole sectors, read directly by FatFs) and
+ * one memset(). The CRC-32 of the payload is checked unless it is 0.
+ */
+#define FXE_MAGIC 0x31455846 /* "FXE1" */
+#define FXE_PAYLOAD_OFFSET 512
+
+typedef struct {
+  uint32_t magic;
+  uint32_t load_address;  /* Address of the payload (text address)   */
+  uint32_t entry_address; /* Entry point                              */
+  uint32_t size;          /* Size of the payload                      */
+  uint32_t bss_size;      /* Bytes cleared after the payload          */
+  uint32_t crc;           /* CRC-32 of the payload, 0: not checked    */
+} Fxe_Header;
 
 /**
  * \brief Loads an ELF executable to RAM.
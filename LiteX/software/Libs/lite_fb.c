@@ -1,4 +1,6 @@
 #include "lite_fb.h"
+#include "lite_services.h"
+#include <poly_raster.h>
 #include <string.h>
 
 
@@ -38,10 +40,106 @@
 
 #define FB_MIN(x,y) ((x) < (y) ? (x) : (y))
 #define FB_MAX(x,y) ((x) > (y) ? (x) : (y))
-#define FB_SGN(x)   (((x) > (0)) ? 1 : ((x) ? -1 : 0))
 
 uint32_t* fb_base = (uint32_t*)FB_PAGE1;
 
+/******************************************************************************/
+
+/*
+ * The blitter has a single DMA channel, and blitter_value feeds the
+ * running transfer: a new transfer first waits for the previous one.
+ * Transfers are started by fb_hline_no_wait_dma(), and the CPU computes
+ * the next span (or in pipelined fill mode, everything up to the next
+ * blitter call) while the blitter writes the current one.
+ */
+
+static int fb_dma_pending = 0;
+static int fb_pipelined_fill = 0;
+
+/**
+ * \brief Waits for DMA transfer completion.
+ * \see fb_hline_no_wait_dma()
+ * \details With fb_hline_no_wait_dma(), can be
+ *   used to overlap computations between 
+ *   initiation of DMA transfer and its completion.
+ */ 
+static inline void fb_hline_wait_dma(void) {
+#ifdef CSR_BLITTER_BASE   
+    if(fb_dma_pending) {
+	while(!blitter_dma_writer_done_read());
+	blitter_dma_writer_enable_write(0);    
+	fb_dma_pending = 0;
+    }
+#endif
+}
+
+/**
+ * \brief Draws a line using DMA transfer.
+ * \details Waits for the previous transfer, does not wait for this one.
+ * \param[in] pix_start address of the first pixel
+ * \param[in] len number of pixels
+ * \param[in] RGB color
+ */ 
+static inline void fb_hline_no_wait_dma(uint32_t* pix_start, uint32_t len, uint32_t RGB) {
+#ifdef CSR_BLITTER_BASE
+    fb_hline_wait_dma();
+    blitter_value_write(RGB);
+    blitter_dma_writer_base_write((uint32_t)(pix_start));
+    blitter_dma_writer_length_write(len*4);
+    blitter_dma_writer_enable_write(1);
+    fb_dma_pending = 1;
+#else
+    for(uint32_t i=0; i<len; ++i) {
+	*pix_start = RGB;
+	++pix_start;
+    }
+#endif    
+}
+
+/**
+ * \brief Called at the end of the fill functions.
+ * \details Waits for the last transfer, unless pipelined fill is
+ *  activated (then the next blitter call or fb_sync() waits for it).
+ */ 
+static inline void fb_fill_end(void) {
+    if(!fb_pipelined_fill) {
+	fb_hline_wait_dma();
+    }
+}
+
+void fb_set_pipelined_fill(int doit) {
+    fb_pipelined_fill = doit;
+    if(!doit) {
+	fb_hline_wait_dma();
+    }
+}
+
+void fb_sync(void) {
+    fb_hline_wait_dma();
+}
+
+void fb_dma_fill(uint32_t* dst, uint32_t nb_words, uint32_t value) {
+    fb_hline_no_wait_dma(dst, nb_words, value);
+    fb_fill_end();
+}
+
+void fb_dma_fill_rect(
+    uint32_t* dst, uint32_t width, uint32_t height, uint32_t stride,
+    uint32_t value
+) {
+    if(width == stride) {
+	/* contiguous rows: a single transfer */
+	fb_dma_fill(dst, width*height, value);
+	return;
+    }
+    for(uint32_t y=0; y<height; ++y) {
+	fb_hline_no_wait_dma(dst, width, value);
+	dst += stride;
+    }
+    fb_fill_end();
+}
+
+
 #ifdef CSR_VIDEO_FRAMEBUFFER_BASE
 
 void fb_set_read_page(uint32_t addr) {
@@ -65,11 +163,22 @@ void fb_off(void) {
 
 
 int fb_init(void) {
-    fb_off();
+    /* 
+     * Started by LiteOS that already displays FB_PAGE1: no need to
+     * stop and restart the video (that makes the screen flicker).
+     */
+    int displayed = (lite_services != NULL && lite_services->fb_page == FB_PAGE1);
+    if(!displayed) {
+	fb_off();
+    }
     fb_set_read_page(FB_PAGE1);
     fb_set_write_page(FB_PAGE1);
     fb_clear();
-    fb_on();
+    if(displayed) {
+	flush_l2_cache();
+    } else {
+	fb_on();
+    }
     fb_set_cliprect(0,0,FB_WIDTH-1,FB_HEIGHT-1);
     fb_set_poly_mode(FB_POLY_FILL);
     fb_set_poly_culling(FB_POLY_NO_CULLING);
@@ -82,12 +191,7 @@ void fb_clear(void) {
      * If blitter is available, clear screen using DMA
      * transfer (much much faster !) 
      */ 
-    blitter_value_write(0x000000);
-    blitter_dma_writer_base_write((uint32_t)(fb_base));
-    blitter_dma_writer_length_write(FB_WIDTH*FB_HEIGHT*4);
-    blitter_dma_writer_enable_write(1);
-    while(!blitter_dma_writer_done_read());
-    blitter_dma_writer_enable_write(0);    
+    fb_dma_fill(fb_base, FB_WIDTH*FB_HEIGHT, 0x000000);
 #else
     memset((void*)fb_base, 0, FB_WIDTH*FB_HEIGHT*4);
 #endif    
@@ -106,25 +210,49 @@ void     fb_clear(void) {}
 
 /*****************************************************************************/
 
-void fb_set_dual_buffering(int doit) {
-   if(doit) {
-      fb_set_write_page(FB_PAGE2);
+/*
+ * The framebuffer DMA takes the new read page at the beginning of the
+ * next frame, so after fb_swap_buffers() the page that was displayed
+ * stays on screen until then. With two pages, drawing restarts in that
+ * page (tearing if the CPU gets ahead of the beam). With three pages,
+ * drawing goes to the page that was displayed two swaps ago, which is
+ * no longer on screen unless two swaps happen within the same frame.
+ * The pages are used round-robin.
+ */
+
+static uint32_t fb_pages[3] = { FB_PAGE1, FB_PAGE2, FB_PAGE3 };
+static int fb_nb_pages = 1;
+static int fb_write_index = 0;
+
+static void fb_set_nb_pages(int nb_pages) {
+   fb_sync();
+   fb_nb_pages = nb_pages;
+   fb_write_index = (nb_pages == 1) ? 0 : 1;
+   fb_set_read_page(fb_pages[0]);
+   for(int i=nb_pages-1; i>0; --i) {
+      fb_set_write_page(fb_pages[i]);
       fb_clear();
-   } else {
-      fb_set_read_page(FB_PAGE1);
-      fb_set_write_page(FB_PAGE1);
    }
+   fb_set_write_page(fb_pages[fb_write_index]);
+}
+
+void fb_set_dual_buffering(int doit) {
+   fb_set_nb_pages(doit ? 2 : 1);
+}
+
+void fb_set_triple_buffering(int doit) {
+   fb_set_nb_pages(doit ? 3 : 1);
 }
 
 void fb_swap_buffers(void) {
-   flush_l2_cache(); // There may be some pixels still in l2 and not in SDRAM.
-   if((uint32_t)fb_base == FB_PAGE1) {
-      fb_set_read_page(FB_PAGE1);
-      fb_set_write_page(FB_PAGE2);
-   } else {
-      fb_set_read_page(FB_PAGE2);
-      fb_set_write_page(FB_PAGE1);
+   if(fb_nb_pages == 1) {
+      return;
    }
+   fb_sync();        // The last polygons may still be being filled.
+   flush_l2_cache(); // There may be some pixels still in l2 and not in SDRAM.
+   fb_set_read_page(fb_pages[fb_write_index]);
+   fb_write_index = (fb_write_index + 1) % fb_nb_pages;
+   fb_set_write_page(fb_pages[fb_write_index]);
 }
 
 /******************************************************************************/
@@ -143,62 +271,10 @@ void fb_set_cliprect(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2) {
 
 /******************************************************************************/
 
-/**
- * \brief Draws a line using DMA transfer.
- * \details Does not wait for DMA transfer completion.
- * \param[in] pix_start address of the first pixel
- * \param[in] len number of pixels
- * \param[in] RGB color
- */ 
-static inline void fb_hline_no_wait_dma(uint32_t* pix_start, uint32_t len, uint32_t RGB) {
-#ifdef CSR_BLITTER_BASE
-    blitter_value_write(RGB);
-    blitter_dma_writer_base_write((uint32_t)(pix_start));
-    blitter_dma_writer_length_write(len*4);
-    blitter_dma_writer_enable_write(1);
-#else
-    for(uint32_t i=0; i<len; ++i) {
-	*pix_start = RGB;
-	++pix_start;
-    }
-#endif    
-}
-
-/**
- * \brief Waits for DMA transfer completion.
- * \see fb_hline_no_wait_dma()
- * \details With fb_hline_no_wait_dma(), can be
- *   used to overlap computations between 
- *   initiation of DMA transfer and its completion.
- */ 
-static inline void fb_hline_wait_dma(void) {
-#ifdef CSR_BLITTER_BASE   
-    while(!blitter_dma_writer_done_read());
-    blitter_dma_writer_enable_write(0);    
-#endif
-}
-
-/**
- * \brief Draws a line using DMA transfer.
- * \details Waits for DMA transfer completion
- * \param[in] pix_start address of the first pixel
- * \param[in] len number of pixels
- * \param[in] RGB color
- */ 
-static inline void fb_hline(uint32_t* pix_start, uint32_t len, uint32_t RGB) {
-   fb_hline_no_wait_dma(pix_start, len, RGB);
-   fb_hline_wait_dma();
-}
-
 void fb_fillrect(
     uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, uint32_t RGB
 ) {
-    uint32_t w = x2-x1+1;
-    uint32_t* line_ptr = fb_pixel_address(x1,y1);
-    for(int y=y1; y<=y2; ++y) {
-	fb_hline(line_ptr,w,RGB);
-	line_ptr += FB_WIDTH;
-    }
+    fb_dma_fill_rect(fb_pixel_address(x1,y1), x2-x1+1, y2-y1+1, FB_WIDTH, RGB);
 }
 
 /******************************************************************************/
@@ -209,6 +285,30 @@ void fb_fillrect(
 #define BOTTOM 4
 #define TOP    8
 
+/*
+ * Spans shorter than that are written by the CPU
+ * (faster than programming the blitter).
+ */
+#define FB_LINE_DMA_MIN_RUN 16
+
+/**
+ * \brief Draws the pixels of a line between two pixel addresses
+ *  of the same row (included), sx is the direction of the line.
+ */
+static inline void fb_line_run(uint8_t* from, uint8_t* to, int sx, uint32_t RGB) {
+    uint32_t* start = (uint32_t*)(sx > 0 ? from : to);
+    uint32_t  len = (uint32_t)(sx > 0 ? to - from : from - to)/sizeof(uint32_t) + 1;
+#ifdef CSR_BLITTER_BASE
+    if(len >= FB_LINE_DMA_MIN_RUN) {
+	fb_hline_no_wait_dma(start, len, RGB);
+	return;
+    }
+#endif
+    for(uint32_t i=0; i<len; ++i) {
+	start[i] = RGB;
+    }
+}
+
 #define code(X,Y) ((X) < fb_clip_x1) | (((X) > fb_clip_x2)<<1) | (((Y) < fb_clip_y1)<<2) | (((Y) > fb_clip_y2)<<3) 
 
 void fb_line(int x1, int y1, int x2, int y2, uint32_t RGB) {
@@ -223,6 +323,9 @@ void fb_line(int x1, int y1, int x2, int y2, uint32_t RGB) {
     uint8_t* pix_ptr;
     int sx_ptr;
     int sy_ptr;
+
+    /* The pixels of a pending fill could be written after ours. */
+    fb_sync();
     
     for(;;) {
         int x,y;
@@ -319,25 +422,48 @@ void fb_line(int x1, int y1, int x2, int y2, uint32_t RGB) {
 	    ex += dx << 1;
 	}
     } else {
+	// Flat lines: the pixels on the same row are drawn as a 
+	// single span (by the blitter if it is long enough).
 	int ey = (dy << 1) - dx;
+	uint8_t* run_ptr = pix_ptr;
 	for(int u=0; u<dx; u++) {
-	   
-	    // Next two lines equivalent to:
-	    //  fb_setpixel(x,y,RGB);
-	    //  x += sx;
-	    *(uint32_t*)pix_ptr = RGB;
 	    pix_ptr += sx_ptr;
-	   
 	    while(ey >= 0) {
-	        // Next two lines equivalent to:
-		//   fb_setpixel(x,y,RGB);
-		//   y += sy;
-		*(uint32_t*)pix_ptr = RGB;
+		fb_line_run(run_ptr, pix_ptr, sx, RGB);
 		pix_ptr += sy_ptr;
+		run_ptr = pix_ptr;
 		ey -= dx << 1;
 	    }
 	    ey += dy << 1;
 	}
+	if(run_ptr != pix_ptr) {
+	    fb_line_run(run_ptr, pix_ptr - sx_ptr, sx, RGB);
+	}
+	fb_fill_end();
+    }
+}
+
+void fb_hline(int x1, int x2, int y, uint32_t RGB) {
+    int xmin = FB_MAX(FB_MIN(x1,x2),fb_clip_x1);
+    int xmax = FB_MIN(FB_MAX(x1,x2),fb_clip_x2);
+    if(y < fb_clip_y1 || y > fb_clip_y2 || xmin > xmax) {
+	return;
+    }
+    fb_hline_no_wait_dma(fb_pixel_address(xmin,y), xmax-xmin+1, RGB);
+    fb_fill_end();
+}
+
+void fb_vline(int x, int y1, int y2, uint32_t RGB) {
+    int ymin = FB_MAX(FB_MIN(y1,y2),fb_clip_y1);
+    int ymax = FB_MIN(FB_MAX(y1,y2),fb_clip_y2);
+    if(x < fb_clip_x1 || x > fb_clip_x2 || ymin > ymax) {
+	return;
+    }
+    fb_sync();
+    uint32_t* pix_ptr = fb_pixel_address(x,ymin);
+    for(int y=ymin; y<=ymax; ++y) {
+	*pix_ptr = RGB;
+	pix_ptr += FB_WIDTH;
     }
 }
 
@@ -352,144 +478,19 @@ void fb_set_poly_culling(PolyCulling culling) { fb_poly_culling = culling; }
 /************************************************************************************/
 
 
-/** 
- * \brief Clips a polygon by a half-plane.
- * \param[in] number of vertices of the input polygon.
- * \param[in] buff1 vertices of the input polygon.
- * \param[out] buff2 vertices of the resulting polygon.
- * \param[in] a , b , c equation of the half-plane: ax + by + c >= 0
- * \return number of vertices in resulting polygon.
- */
-static int clip_H(
-    int nb_pts, int* buff1, int* buff2, int a, int b, int c
-) {
-    if(nb_pts == 0) {
-	return 0;
-    }
-
-    if(nb_pts == 1) {
-	if(a*buff1[0] + b*buff1[1] + c >= 0) {
-	    buff2[0] = buff1[0];
-	    buff2[1] = buff1[1];
-	    return 1;
-	} else {
-	    return 0;
-	}
-    }
-
-    int nb_result = 0;
-    int prev_x = buff1[2*(nb_pts-1)];
-    int prev_y = buff1[2*(nb_pts-1)+1];
-    int prev_status = FB_SGN(a*prev_x + b*prev_y +c);
-
-    for(int i=0; i<nb_pts; ++i) {
-	int x = buff1[2*i];
-	int y = buff1[2*i+1];
-	int status = FB_SGN(a*x + b*y + c);
-	if(status != prev_status && status != 0 && prev_status != 0) {
-
-	    /*
-	     * Remember, femtorv32 does not always have hardware mul,
-	     * so we replace the following code with two switches
-	     * (a and b take values in -1,0,1, no need to mul).
-	     * int t_num   = -a*prev_x-b*prev_y-c;
-	     * int t_denom = a*(x - prev_x) + b*(y - prev_y);
-	     */
-
-	    int t_num = -c;
-	    int t_denom = 0;
-	    
-	    switch(a) {
-	    case -1:
-		t_num += prev_x;
-		t_denom -= (x - prev_x);
-		break;
-	    case  1:
-		t_num -= prev_x;
-		t_denom += (x - prev_x);
-		break;
-	    }
-
-	    switch(b) {
-	    case -1:
-		t_num += prev_y;
-		t_denom -= (y - prev_y);
-		break;
-	    case  1:
-		t_num -= prev_y;
-		t_denom += (y - prev_y);
-		break;
-	    }
-	    
-	    int Ix = prev_x + t_num * (x - prev_x) / t_denom;
-	    int Iy = prev_y + t_num * (y - prev_y) / t_denom;
-	    buff2[2*nb_result]   = Ix;
-	    buff2[2*nb_result+1] = Iy;
-	    ++nb_result;
-	}
-	if(status >= 0) {
-	    buff2[2*nb_result]   = x;
-	    buff2[2*nb_result+1] = y;
-	    ++nb_result;
-	}
-	prev_x = x;
-	prev_y = y;
-	prev_status = status;
-    }
-
-    return nb_result;
-}
-
-/**
- * \brief Clips a polygon by the screen.
- * \param[in] number of vertices of the input polygon.
- * \param[in,out] poly vertices of the polygon.
- * \return number of vertices in the result polygon.
+/*
+ * Polygons are rasterized by poly_raster() (FemtoRV/FIRMWARE/LIBFEMTOGL,
+ * shared with femtoGL), that sends their spans to fb_fill_span(): the
+ * next span is computed while the blitter fills this one.
  */
-static int fb_clip(int nb_pts, int** poly) {
-    static int  buff1[20];    
-    int  buff2[20];
-    nb_pts = clip_H(nb_pts, *poly, buff2, 1, 0, fb_clip_x1);
-    nb_pts = clip_H(nb_pts, buff2, buff1,-1, 0, fb_clip_x2);
-    nb_pts = clip_H(nb_pts, buff1, buff2, 0, 1, fb_clip_y1);
-    nb_pts = clip_H(nb_pts, buff2, buff1, 0,-1, fb_clip_y2);
-    *poly = buff1;
-    return nb_pts;
+static void fb_fill_span(int y, int x1, int x2, void* data) {
+    fb_hline_no_wait_dma(fb_pixel_address(x1,y), x2-x1+1, *(uint32_t*)data);
 }
 
 void fb_fill_poly(uint32_t nb_pts, int* points, uint32_t RGB) {
-    static uint32_t x_left[FB_HEIGHT];
-    static uint32_t x_right[FB_HEIGHT];
-
-    /* determine miny, maxy */
-    int clockwise = 0;
-    int minx =  10000;
-    int maxx = -10000;
-    int miny =  10000;
-    int maxy = -10000;
-   
-    for(int i=0; i<nb_pts; ++i) {
-	int x = points[2*i];
-	int y = points[2*i+1];
-	minx = FB_MIN(minx,x);
-	maxx = FB_MAX(maxx,x);
-	miny = FB_MIN(miny,y);
-	maxy = FB_MAX(maxy,y);
-    }
-
     /* Culling */
     if(fb_poly_culling != FB_POLY_NO_CULLING) {
-       for(int i1=0; i1<nb_pts; ++i1) {
-	  int i2=(i1==nb_pts-1) ? 0 : i1+1;
-	  int i3=(i2==nb_pts-1) ? 0 : i2+1;
-	  int x1 = points[2*i1];
-	  int y1 = points[2*i1+1];
-	  int dx1 = points[2*i2]   - x1;
-	  int dy1 = points[2*i2+1] - y1;
-	  int dx2 = points[2*i3]   - x1;
-	  int dy2 = points[2*i3+1] - y1;
-	  clockwise += dx1 * dy2 - dx2 * dy1;
-       }
+       int clockwise = poly_orientation(nb_pts, points);
        if((fb_poly_culling == FB_POLY_CW) && (clockwise < 0)) {
 	  return;
        }
@@ -497,112 +498,25 @@ void fb_fill_poly(uint32_t nb_pts, int* points, uint32_t RGB) {
 	  return;
        }
     }
-   
-    /* Clipping */
-    if((minx < fb_clip_x1) || (miny < fb_clip_y1) || (maxx > fb_clip_x2) || (maxy > fb_clip_y2)) {
-	nb_pts = fb_clip(nb_pts, (int**)&points);
-	miny =  10000;
-	maxy = -10000;
-	for(int i1=0; i1<nb_pts; ++i1) {
-	    int y1 = points[2*i1+1];
-	    miny = FB_MIN(miny,y1);
-	    maxy = FB_MAX(maxy,y1);
-	}
-    }
-
-    /* Determine x_left and x_right for each scaline */
-    // Note: x_left and x_right may be swapped depending
-    // on polygon orientation (we no longer compute orientation
-    // systematically, and swap line extremities instead). 
-    // Extremities test and swapping is overlapped with previous
-    // line's DMA transfer (costs nothing).
-    for(int i1=0; i1<nb_pts; ++i1) {
-	int i2=(i1==nb_pts-1) ? 0 : i1+1;
-
-	int x1 = points[2*i1];
-	int y1 = points[2*i1+1];
-	int x2 = points[2*i2];
-	int y2 = points[2*i2+1];
-
-	if(fb_poly_mode == FB_POLY_LINES) {
-	    fb_line(x1,y1,x2,y2,RGB);
-	    continue;
-	}
-
-        // uint32_t* x_buffer = ((clockwise > 0) ^ (y2 > y1)) ? x_left : x_right;
-	// No need to consult clockwise: we swap extremities in the end if needed
-	//  (need the test anyway in the case there is a non-convex polygon)
-        uint32_t* x_buffer = (y2 > y1) ? x_left : x_right;
-       
-	int dx = x2 - x1;
-	int sx = 1;
-	int dy = y2 - y1;
-	int sy = 1;
-	int x = x1;
-	int y = y1;
-	int ex;
-	
-	if(dx < 0) {
-	    sx = -1;
-	    dx = -dx;
-	}
-	
-	if(dy < 0) {
-	    sy = -1;
-	    dy = -dy;
-	}
-
-	if(y1 == y2) {
-	  x_left[y1]  = FB_MIN(x1,x2);
-	  x_right[y1] = FB_MAX(x1,x2);
-	  continue;
-	}
 
-	ex = (dx << 1) - dy;
-
-	for(int u=0; u <= dy; ++u) {
-    	    x_buffer[y] = x; 
-	    y += sy;
-	    while(ex >= 0) {
-		x += sx;
-		ex -= dy << 1;
-	    }
-	    ex += dx << 1;
+    if(fb_poly_mode == FB_POLY_LINES) {
+	for(int i1=0; i1<nb_pts; ++i1) {
+	    int i2=(i1==nb_pts-1) ? 0 : i1+1;
+	    fb_line(points[2*i1],points[2*i1+1],points[2*i2],points[2*i2+1],RGB);
 	}
-    }
-
-    if(fb_poly_mode == FB_POLY_LINES) {    
 	return;
     }
 
-    uint32_t* line_ptr = (uint32_t*)(fb_base) + miny * FB_WIDTH;
-    for(int y = miny; y <= maxy; ++y) {
-	int x1 = x_left[y];
-	int x2 = x_right[y];
-       
-        /* swap x1,x2 (may happen with non-convex polygons) */
-        if(x2 < x1) { 
-	   x1 = x1 ^ x2;
-	   x2 = x2 ^ x1;
-	   x1 = x1 ^ x2;
-	}
-       
-        /* wait end of DMA transfer for previous line */
-        if(y != miny) {
-	   fb_hline_wait_dma();
-	}
-       
-        /* 
-	 * Initiate DMA transfer for current line. Next 
-	 * line fetch and x1,x2 swap are overlapped with
-	 * DMA transfer.
-	 */ 
-        fb_hline_no_wait_dma(line_ptr+x1, x2-x1+1, RGB);
-	line_ptr += FB_WIDTH;
-    }
+    poly_raster(
+	nb_pts, points, fb_clip_x1, fb_clip_y1, fb_clip_x2, fb_clip_y2,
+	fb_fill_span, &RGB
+    );
    
-    /* Wait end of DMA transfer for last line. */
-    fb_hline_wait_dma();
+    /* 
+     * Wait end of DMA transfer for last line (in pipelined
+     * mode, the next polygon is prepared during the transfer).
+     */
+    fb_fill_end();
 }
 
 /******************************************************************************/
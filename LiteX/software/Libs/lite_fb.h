@@ -14,6 +14,7 @@
 extern uint32_t* fb_base;
 #define FB_PAGE1 0x40c00000
 #define FB_PAGE2 0x40d2c000
+#define FB_PAGE3 0x40e58000
 
 
 /**
@@ -32,20 +33,31 @@ int fb_init(void);
 void fb_set_dual_buffering(int doit);
 
 /**
- * \brief if dual buffering is activated, swaps the buffers.
- * \see fb_set_dualbuffering()
+ * \brief activates or deactivates triple buffering.
+ * \details With three pages, the page drawn after fb_swap_buffers() is
+ *  not the one that stays on screen until the next frame, so that drawing
+ *  can start immediately without tearing.
+ * \param[in] doit true if triple buffering should be activated.
+ */ 
+void fb_set_triple_buffering(int doit);
+
+/**
+ * \brief if dual or triple buffering is activated, swaps the buffers.
+ * \details Does not wait: the displayed page changes at the beginning 
+ *  of the next frame.
+ * \see fb_set_dual_buffering(), fb_set_triple_buffering()
  */ 
 void fb_swap_buffers(void);
 
 /**
  * \brief Sets the page displayed by the screen.
- * \param[in] addr one of FB_PAGE1 , FB_PAGE2
+ * \param[in] addr one of FB_PAGE1 , FB_PAGE2 , FB_PAGE3
  */ 
 void fb_set_read_page(uint32_t addr);
 
 /**
  * \brief Sets the page written by graphic commands.
- * \param[in] addr one of FB_PAGE1 , FB_PAGE2
+ * \param[in] addr one of FB_PAGE1 , FB_PAGE2 , FB_PAGE3
  */ 
 void fb_set_write_page(uint32_t addr);
 
@@ -130,6 +142,55 @@ void fb_set_cliprect(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2);
  */ 
 void fb_fillrect(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, uint32_t RGB);
 
+/**
+ * \brief Activates or deactivates pipelined fill mode.
+ * \details In pipelined fill mode, fb_clear(), fb_fillrect() and 
+ *  fb_fill_poly() return while the blitter still writes their last
+ *  span, so that the CPU prepares the next polygon during the transfer
+ *  (no effect without the blitter). The next blitter call, fb_line(),
+ *  fb_swap_buffers() and fb_sync() wait for it. Deactivated by default.
+ * \param[in] doit true if pipelined fill should be activated.
+ * \see fb_sync()
+ */ 
+void fb_set_pipelined_fill(int doit);
+
+/**
+ * \brief Waits for the pending blitter transfer.
+ * \details In pipelined fill mode, needs to be called before writing
+ *  pixels directly (fb_setpixel(), fb_base), else a pending fill may
+ *  overwrite them.
+ * \see fb_set_pipelined_fill()
+ */ 
+void fb_sync(void);
+
+/**
+ * \brief Fills a zone of memory with a 32 bits value.
+ * \details Uses the blitter if available, else the CPU. Works on any
+ *  memory (for instance a depth buffer), not only on the framebuffer.
+ *  Like the other fill functions, returns before the transfer is
+ *  done in pipelined fill mode.
+ * \param[in] dst address of the first word, aligned on 32 bits
+ * \param[in] nb_words number of 32 bits words to be written
+ * \param[in] value the value written in each word
+ * \see fb_set_pipelined_fill(), fb_sync()
+ */ 
+void fb_dma_fill(uint32_t* dst, uint32_t nb_words, uint32_t value);
+
+/**
+ * \brief Fills a rectangle of 32 bits words with a value.
+ * \details One transfer per row, or a single one if the rows are
+ *  contiguous (\p width = \p stride). No clipping !
+ * \param[in] dst address of the first word of the first row
+ * \param[in] width , height size of the rectangle, in words
+ * \param[in] stride distance between two rows, in words
+ * \param[in] value the value written in each word
+ * \see fb_dma_fill()
+ */ 
+void fb_dma_fill_rect(
+    uint32_t* dst, uint32_t width, uint32_t height, uint32_t stride,
+    uint32_t value
+);
+
 /**
  * \brief Draws a line with a specified color.
  * \param[in] x1 , y1 , x2 , y2 coordinates of the extremities of the line.
@@ -139,6 +200,23 @@ void fb_fillrect(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, uint32_t RG
  */ 
 void fb_line(int x1, int y1, int x2, int y2, uint32_t RGB);
 
+/**
+ * \brief Draws a horizontal line with a specified color.
+ * \details Uses the blitter if available.
+ * \param[in] x1 , x2 the extremities of the line (included), clipped
+ * \param[in] y the row of the line
+ * \param[in] RGB pixel color
+ */ 
+void fb_hline(int x1, int x2, int y, uint32_t RGB);
+
+/**
+ * \brief Draws a vertical line with a specified color.
+ * \param[in] x the column of the line
+ * \param[in] y1 , y2 the extremities of the line (included), clipped
+ * \param[in] RGB pixel color
+ */ 
+void fb_vline(int x, int y1, int y2, uint32_t RGB);
+
 
 /**
  * \brief Polygon mode constants.
@@ -0,0 +1,104 @@
+/* sbrk() taken from Claire Wolf's picorv32 libraries */
+#include <lite_heap.h>
+#include <lite_services.h>
+#include <generated/mem.h>
+#include <stdio.h>
+
+static LiteHeapStats heap;
+
+static void heap_init(void) {
+    extern unsigned char _end[];   // Defined by linker
+    uint32_t start = ((uint32_t)_end + 7) & ~7;
+    uint32_t limit = 0xffffffff;
+    if(lite_services != NULL && lite_services->heap_end != NULL &&
+       (uint32_t)lite_services->heap_start >= start) {
+	start = (uint32_t)lite_services->heap_start;
+	limit = (uint32_t)lite_services->heap_end;
+    } else {
+#ifdef MAIN_RAM_BASE
+	limit = MAIN_RAM_BASE + MAIN_RAM_SIZE;
+#endif
+	uint32_t sp = (uint32_t)&start;
+	if(sp > start && sp <= limit) {
+	    limit = (sp - start > LITE_HEAP_STACK_SIZE) ?
+		     sp - LITE_HEAP_STACK_SIZE : start;
+	}
+    }
+    heap.start = (uint8_t*)start;
+    heap.limit = (uint8_t*)limit;
+    heap.brk   = (uint8_t*)start;
+}
+
+void* sbrk(ptrdiff_t incr) {
+    if(heap.start == NULL) {
+	heap_init();
+    }
+    if((incr > 0 && (size_t)incr > (size_t)(heap.limit - heap.brk)) ||
+       (incr < 0 && (size_t)(-incr) > (size_t)(heap.brk - heap.start))) {
+	heap.failures++;
+	return (void*)-1;
+    }
+    uint8_t* result = heap.brk;
+    heap.brk += incr;
+    if((size_t)(heap.brk - heap.start) > heap.high_water) {
+	heap.high_water = heap.brk - heap.start;
+    }
+    return result;
+}
+
+size_t lite_heap_free(void) {
+    if(heap.start == NULL) {
+	heap_init();
+    }
+    return heap.limit - heap.brk;
+}
+
+void* lite_heap_reserve(size_t* size, size_t keep) {
+    if(heap.start == NULL) {
+	heap_init();
+    }
+    /* align the zone (malloc() may have left brk unaligned) */
+    size_t align = (8 - ((uint32_t)heap.brk & 7)) & 7;
+    size_t available = lite_heap_free();
+    if(available < align + keep) {
+	*size = 0;
+	return NULL;
+    }
+    available -= align + keep;
+    if(*size > available) {
+	*size = available;
+    }
+    *size &= ~7;
+    if(sbrk(align) == (void*)-1) {
+	return NULL;
+    }
+    void* result = sbrk(*size);
+    if(result == (void*)-1) {
+	return NULL;
+    }
+    heap.reserved += *size;
+    return result;
+}
+
+void lite_heap_get_stats(LiteHeapStats* stats) {
+    if(heap.start == NULL) {
+	heap_init();
+    }
+    *stats = heap;
+}
+
+void lite_heap_print_stats(void) {
+    LiteHeapStats stats;
+    lite_heap_get_stats(&stats);
+    printf("heap: 0x%08x-0x%08x (%u KB)\n",
+	   (unsigned)stats.start, (unsigned)stats.limit,
+	   (unsigned)(stats.limit - stats.start) / 1024);
+    printf("heap: used %u KB (high water %u KB, reserved %u KB), free %u KB\n",
+	   (unsigned)(stats.brk - stats.start) / 1024,
+	   (unsigned)stats.high_water / 1024,
+	   (unsigned)stats.reserved / 1024,
+	   (unsigned)(stats.limit - stats.brk) / 1024);
+    if(stats.failures != 0) {
+	printf("heap: %u sbrk() failed\n", (unsigned)stats.failures);
+    }
+}
@@ -0,0 +1,82 @@
+// The heap of the programs (sbrk(), used by malloc()), shared by Programs,
+// Tagl and Doom.
+//
+// Started by LiteOS, the heap is the zone it gives (lite_services). Else it
+// goes from _end to the end of the SDRAM (generated/mem.h), or to the stack
+// (minus LITE_HEAP_STACK_SIZE) when the stack is in the SDRAM above it.
+// sbrk() fails instead of growing beyond, and the heap keeps track of its
+// high-water mark, so that a program can see how much memory it really uses,
+// and size its caches to what is free.
+//
+// It is linked as an object (lite_heap.o, not in libliteos.a), so that it
+// is there when the libc looks for sbrk().
+
+#ifndef LITE_HEAP
+#define LITE_HEAP
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief What is kept for the stack when the heap is not given by LiteOS.
+ */
+#ifndef LITE_HEAP_STACK_SIZE
+#define LITE_HEAP_STACK_SIZE (64*1024)
+#endif
+
+/**
+ * \brief The state of the heap.
+ * \see lite_heap_get_stats()
+ */
+typedef struct {
+    uint8_t* start;         /**< first byte of the heap                      */
+    uint8_t* limit;         /**< first byte the heap cannot use              */
+    uint8_t* brk;           /**< current end of the heap                     */
+    size_t   high_water;    /**< maximum of brk - start                      */
+    size_t   reserved;      /**< bytes taken by lite_heap_reserve()          */
+    uint32_t failures;      /**< sbrk() calls that did not fit               */
+} LiteHeapStats;
+
+/**
+ * \brief Grows (or shrinks) the heap, what malloc() calls.
+ * \return the previous end of the heap, or (void*)-1 if it does not fit
+ */
+void* sbrk(ptrdiff_t incr);
+
+/**
+ * \brief Gets the number of bytes that the heap can still grow.
+ */
+size_t lite_heap_free(void);
+
+/**
+ * \brief Takes a big zone from the heap, for zone-style allocators
+ *  (Doom's I_ZoneBase()).
+ * \details To be called early, before malloc() has fragmented the heap.
+ * \param[in,out] size the wanted size in bytes, replaced with the size of
+ *  the zone (smaller when the heap does not have enough free memory)
+ * \param[in] keep the number of bytes that stay free for malloc()
+ * \return the zone, 8 bytes aligned, or NULL if less than keep bytes
+ *  are free
+ */
+void* lite_heap_reserve(size_t* size, size_t keep);
+
+/**
+ * \brief Gets the state of the heap.
+ * \param[out] stats the state
+ */
+void lite_heap_get_stats(LiteHeapStats* stats);
+
+/**
+ * \brief Prints the state of the heap.
+ */
+void lite_heap_print_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
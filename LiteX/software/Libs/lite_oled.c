@@ -36,6 +36,44 @@ void oled_init(void) {
    oled0(0xaf);       // display on
 }
 
+/*
+ * Sends nb_pixels pixels in a single burst, pixels advances by step
+ * (0 to send the same pixel, for oled_fillrect_uint16()). The next
+ * byte is fetched while the SPI core shifts the previous one (MOSI is
+ * not latched by the core, it is written only when the shift is done),
+ * then the loop only waits, writes MOSI and starts.
+ */
+static void oled_burst(const uint16_t* pixels, uint32_t nb_pixels, int step) {
+#ifdef CSR_OLED_SPI_BASE
+   oled_stream_finish();
+   oled_ctl_out_write(OLED_SPI_DAT);
+   oled_spi_cs_write(OLED_SPI_CS_LOW);
+   for(uint32_t i=0; i<nb_pixels; ++i) {
+      uint16_t RGB = *pixels;
+      pixels += step;
+#if OLED_SPI_DATA_WIDTH >= 16
+      while(oled_spi_status_read() != OLED_SPI_DONE);
+      oled_spi_mosi_write(RGB);
+      oled_spi_control_write(16*OLED_SPI_LENGTH | OLED_SPI_START);
+#else
+      uint8_t lo = (uint8_t)RGB;
+      while(oled_spi_status_read() != OLED_SPI_DONE);
+      oled_spi_mosi_write((uint8_t)(RGB >> 8));
+      oled_spi_control_write(8*OLED_SPI_LENGTH | OLED_SPI_START);
+      while(oled_spi_status_read() != OLED_SPI_DONE);
+      oled_spi_mosi_write(lo);
+      oled_spi_control_write(8*OLED_SPI_LENGTH | OLED_SPI_START);
+#endif
+   }
+   while(oled_spi_status_read() != OLED_SPI_DONE);
+   oled_spi_cs_write(OLED_SPI_CS_HIGH);
+#endif
+}
+
+void oled_write_pixels(const uint16_t* pixels, uint32_t nb_pixels) {
+   oled_burst(pixels, nb_pixels, 1);
+}
+
 void oled_fillrect_uint16(
    uint8_t x1, uint8_t y1,
    uint8_t x2, uint8_t y2,
@@ -43,11 +81,26 @@ void oled_fillrect_uint16(
 ) {
    uint32_t nb_pixels = (uint32_t)(x2-x1+1)*(uint32_t)(y2-y1+1);
    oled_write_window(x1,y1,x2,y2);
-   for(uint32_t i=0; i<nb_pixels; ++i) {
-      oled_data_uint16(rgb);
-   }
+   oled_burst(&rgb, nb_pixels, 0);
 }
 
 void oled_clear(void) {
    oled_fillrect_uint16(0,0,OLED_WIDTH-1,OLED_HEIGHT-1,0);
 }
+
+const uint8_t* oled_stream_bytes = 0;
+uint32_t oled_stream_pos = 0;
+uint32_t oled_stream_len = 0;
+int      oled_stream_active = 0;
+
+void oled_stream_start(const uint16_t* pixels, uint32_t nb_pixels) {
+   oled_stream_finish();
+#ifdef CSR_OLED_SPI_BASE
+   oled_stream_bytes = (const uint8_t*)pixels;
+   oled_stream_pos = 0;
+   oled_stream_len = 2*nb_pixels;
+   oled_ctl_out_write(OLED_SPI_DAT);
+   oled_spi_cs_write(OLED_SPI_CS_LOW);
+   oled_stream_active = 1;
+#endif
+}
@@ -20,6 +20,13 @@
 #define OLED_SPI_CMD 2
 #define OLED_SPI_DAT 3
 
+// Width of the shift register of the OLED SPI core (the data_width of
+// the LiteX SPIMaster). With 16 (or more), a pixel is sent in a single
+// transfer. Define it when LiteX is synthesized with a wider shifter.
+#ifndef OLED_SPI_DATA_WIDTH
+#define OLED_SPI_DATA_WIDTH 8
+#endif
+
 /**
  * \brief Sends one byte to the SSD1331 OLED display using SPI protocol.
  * \param[in] cmd_or_dat one of OLED_SPI_CMD, OLED_SPI_DAT
@@ -106,18 +113,37 @@ static inline void oled_write_window(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t
  * \see oled_write_window().
  */ 
 static inline void oled_data_uint16(uint16_t RGB) {
-   // Note: is it possible to send 16 bits in one go ?
-   // Probably yes, using something like:
-   //  oled_spi_control_write(16*OLED_SPI_LENGTH | OLED_SPI_START);
-   // But OLED spi is configured to have a 8-bits shift register only.
-   // Tryed to extend it to 16 bits, with no success
-   // (for now, keeping two 8-bit sends).
-   // Note: could save two calls to oled_spi_cs_write() (but not worth it).
-   
+#if OLED_SPI_DATA_WIDTH >= 16
+#ifdef CSR_OLED_SPI_BASE
+   oled_ctl_out_write(OLED_SPI_DAT);
+   oled_spi_cs_write(OLED_SPI_CS_LOW);
+   oled_spi_mosi_write(RGB);
+   oled_spi_control_write(16*OLED_SPI_LENGTH | OLED_SPI_START);
+   while(oled_spi_status_read() != OLED_SPI_DONE);
+   oled_spi_cs_write(OLED_SPI_CS_HIGH);
+#endif
+#else
+   // With the default 8-bits shift register, two 8-bit sends
+   // (see oled_write_pixels() to send many pixels).
    oled_byte(OLED_SPI_DAT,(uint8_t)(RGB>>8));
    oled_byte(OLED_SPI_DAT,(uint8_t)(RGB));
+#endif
 }
 
+/**
+ * \brief Writes pixel data in a single burst.
+ * \details Much faster than calling oled_data_uint16() for each pixel:
+ *  CS and DC are written once for the whole burst, and the next pixel
+ *  is fetched while the previous byte is shifted out, so that only the
+ *  write of MOSI and the start remain between two transfers. With
+ *  OLED_SPI_DATA_WIDTH >= 16, a pixel is a single transfer. Waits for
+ *  the background transfer (oled_stream_start()) first.
+ * \param[in] pixels the pixel data, encoded as RRRRR GGGGG 0 BBBBB
+ * \param[in] nb_pixels the number of pixels
+ * \see oled_write_window(), oled_stream_start()
+ */
+void oled_write_pixels(const uint16_t* pixels, uint32_t nb_pixels);
+
 /**
  * \brief Converts three components into a 16 bits pixel value.
  * \param[in]  R , G , B the three components, between 0 and 255.
@@ -189,6 +215,73 @@ static inline void oled_fillrect_RGB(
  * \brief Clears the screen.
  */ 
 void oled_clear(void);
+
+/*
+ * Background transfer: the SPI shifter has no FIFO, no DMA and no
+ * interrupt, so the bytes of a transfer are sent one by one by
+ * oled_stream_poll(), that returns immediately if the shifter is
+ * still busy. Calling it often from the main loop of the program
+ * overlaps the transfer with the computations.
+ */
+extern const uint8_t* oled_stream_bytes;
+extern uint32_t oled_stream_pos;
+extern uint32_t oled_stream_len;
+extern int      oled_stream_active;
+
+/**
+ * \brief Starts sending pixel data in the background.
+ * \details Waits for the previous transfer. The pixels are sent to the
+ *  current window, the buffer needs to stay unchanged until the end of 
+ *  the transfer, and no other OLED function can be called before.
+ * \param[in] pixels the pixel data, encoded as RRRRR GGGGG 0 BBBBB
+ * \param[in] nb_pixels the number of pixels
+ * \see oled_write_window(), oled_stream_poll(), oled_stream_finish()
+ */ 
+void oled_stream_start(const uint16_t* pixels, uint32_t nb_pixels);
+
+/**
+ * \brief Sends the next byte of the background transfer if the SPI
+ *  shifter is ready.
+ * \details Never waits.
+ * \retval 1 if the transfer is not finished.
+ * \retval 0 otherwise.
+ */ 
+static inline int oled_stream_poll(void) {
+#ifdef CSR_OLED_SPI_BASE
+   if(!oled_stream_active) {
+      return 0;
+   }
+   if(oled_spi_status_read() != OLED_SPI_DONE) {
+      return 1;
+   }
+   if(oled_stream_pos == oled_stream_len) {
+      oled_spi_cs_write(OLED_SPI_CS_HIGH);
+      oled_stream_active = 0;
+      return 0;
+   }
+#if OLED_SPI_DATA_WIDTH >= 16
+   oled_spi_mosi_write(*(const uint16_t*)(oled_stream_bytes + oled_stream_pos));
+   oled_spi_control_write(16*OLED_SPI_LENGTH | OLED_SPI_START);
+   oled_stream_pos += 2;
+#else
+   // Pixels are in memory as little-endian 16 bits words,
+   // the SSD1331 wants the most significant byte first.
+   oled_spi_mosi_write(oled_stream_bytes[oled_stream_pos ^ 1]);
+   oled_spi_control_write(8*OLED_SPI_LENGTH | OLED_SPI_START);
+   ++oled_stream_pos;
+#endif
+   return 1;
+#else
+   return 0;
+#endif
+}
+
+/**
+ * \brief Waits for the end of the background transfer.
+ */ 
+static inline void oled_stream_finish(void) {
+   while(oled_stream_poll());
+}
    
 #endif
 
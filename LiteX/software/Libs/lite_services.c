@@ -0,0 +1,85 @@
+#include <lite_services.h>
+#include <libbase/console.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+LiteServices* lite_services = NULL;
+
+void lite_services_init(LiteServices* services) {
+    if(
+	services != NULL &&
+	services->magic == LITE_SERVICES_MAGIC &&
+	services->version >= LITE_SERVICES_VERSION
+    ) {
+	services->program_version = LITE_SERVICES_VERSION;
+	lite_services = services;
+    } else {
+	lite_services = NULL;
+    }
+}
+
+/* The filesystem of LiteOS, if it has one */
+static inline int liteos_fs(void) {
+    return lite_services != NULL && lite_services->f_open != NULL;
+}
+
+FRESULT lite_f_mount(FATFS* fs, const TCHAR* path, BYTE opt) {
+    return liteos_fs() ? FR_OK : f_mount(fs, path, opt);
+}
+
+FRESULT lite_f_open(FIL* fp, const TCHAR* path, BYTE mode) {
+    return liteos_fs() ? lite_services->f_open(fp, path, mode)
+	               : f_open(fp, path, mode);
+}
+
+FRESULT lite_f_close(FIL* fp) {
+    return liteos_fs() ? lite_services->f_close(fp) : f_close(fp);
+}
+
+FRESULT lite_f_read(FIL* fp, void* buff, UINT btr, UINT* br) {
+    return liteos_fs() ? lite_services->f_read(fp, buff, btr, br)
+	               : f_read(fp, buff, btr, br);
+}
+
+FRESULT lite_f_lseek(FIL* fp, FSIZE_t ofs) {
+    return liteos_fs() ? lite_services->f_lseek(fp, ofs) : f_lseek(fp, ofs);
+}
+
+FRESULT lite_f_stat(const TCHAR* path, FILINFO* fno) {
+    return liteos_fs() ? lite_services->f_stat(path, fno) : f_stat(path, fno);
+}
+
+int lite_console_write_nonblock(const char* s, int len) {
+    int i;
+    if(lite_services != NULL && lite_services->write_nonblock != NULL) {
+	return lite_services->write_nonblock(s, len);
+    }
+    for(i=0; i<len; ++i) {
+	putchar(s[i]);
+    }
+    return len;
+}
+
+int lite_printf_nonblock(const char* fmt, ...) {
+    char buffer[256];
+    va_list args;
+    int len;
+    va_start(args, fmt);
+    len = vsnprintf(buffer, sizeof(buffer), fmt, args);
+    va_end(args);
+    if(len < 0) {
+	return len;
+    }
+    if(len > (int)sizeof(buffer) - 1) {
+	len = sizeof(buffer) - 1;
+    }
+    return lite_console_write_nonblock(buffer, len);
+}
+
+int lite_console_getchar_nonblock(void) {
+    if(lite_services != NULL && lite_services->getchar_nonblock != NULL) {
+	return lite_services->getchar_nonblock();
+    }
+    return readchar_nonblock() ? (unsigned char)readchar() : -1;
+}
@@ -0,0 +1,131 @@
+// Services that LiteOS passes to the programs it runs.
+//
+// LiteOS calls the entry point of a program with a third argument,
+// main(argc, argv, services), that crt0.S gives to lite_services_init().
+// The table has LiteOS console and mounted filesystem, the state of the
+// framebuffer and the zone of the SDRAM that the program can use as a heap
+// (sbrk()). A program started without it (by another loader) gets
+// lite_services == NULL, and everything falls back to the libraries.
+//
+// With LITE_SERVICES_OVERRIDE defined before including this file, the FatFs
+// functions used by the programs (f_mount(), f_open() ...) go through the
+// filesystem of LiteOS: the SDCard is neither re-initialized nor re-mounted
+// at each run, and the FatFs state of LiteOS stays coherent (so that it can
+// keep it mounted when the program returns).
+
+#ifndef LITE_SERVICES
+#define LITE_SERVICES
+
+#include <stdint.h>
+#include <libfatfs/ff.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LITE_SERVICES_MAGIC   0x534F544C /* "LTOS" */
+#define LITE_SERVICES_VERSION 2
+
+/**
+ * \brief What LiteOS gives to a program.
+ * \details Filled by LiteOS. The program only writes program_version.
+ */
+typedef struct {
+    uint32_t magic;              /**< LITE_SERVICES_MAGIC                     */
+    uint32_t version;            /**< LITE_SERVICES_VERSION of LiteOS (new
+                                      versions only add fields at the end)   */
+    uint32_t program_version;    /**< set by lite_services_init(), 0 if the
+                                      program does not know the table        */
+
+    /* console */
+    int  (*putchar)(int c);
+    char (*readchar)(void);
+    int  (*readchar_nonblock)(void);
+
+    /* files (read-only), on the filesystem mounted by LiteOS (NULL if none) */
+    FRESULT (*f_open)(FIL* fp, const TCHAR* path, BYTE mode);
+    FRESULT (*f_close)(FIL* fp);
+    FRESULT (*f_read)(FIL* fp, void* buff, UINT btr, UINT* br);
+    FRESULT (*f_lseek)(FIL* fp, FSIZE_t ofs);
+    FRESULT (*f_stat)(const TCHAR* path, FILINFO* fno);
+
+    /* framebuffer */
+    uint32_t fb_page;            /**< displayed page, 0 if off (or none)      */
+
+    /* heap */
+    uint8_t* heap_start;         /**< first byte after the program            */
+    uint8_t* heap_end;           /**< first byte the heap cannot use          */
+
+    /* version 2: console rings of LiteOS (see lite_uart.h), NULL if none */
+    int  (*write_nonblock)(const char* s, int len);
+    int  (*getchar_nonblock)(void);
+} LiteServices;
+
+/**
+ * \brief The table given by LiteOS, or NULL.
+ */
+extern LiteServices* lite_services;
+
+/**
+ * \brief Called by crt0.S before main().
+ * \param[in] services the third argument of the entry point, ignored
+ *  if it is not a table of a LiteOS that has this version (or a newer one)
+ */
+void lite_services_init(LiteServices* services);
+
+/**
+ * \brief Returns to LiteOS (what exit() does in the programs).
+ * \details Defined in crt0.S, restores the stack of the entry point.
+ */
+void lite_exit(int status) __attribute__((noreturn));
+
+/**
+ * \brief Same as the FatFs functions, on the filesystem of LiteOS
+ *  if it has one.
+ * \details lite_f_mount() does nothing if LiteOS has mounted the
+ *  filesystem.
+ */
+FRESULT lite_f_mount(FATFS* fs, const TCHAR* path, BYTE opt);
+FRESULT lite_f_open(FIL* fp, const TCHAR* path, BYTE mode);
+FRESULT lite_f_close(FIL* fp);
+FRESULT lite_f_read(FIL* fp, void* buff, UINT btr, UINT* br);
+FRESULT lite_f_lseek(FIL* fp, FSIZE_t ofs);
+FRESULT lite_f_stat(const TCHAR* path, FILINFO* fno);
+
+/**
+ * \brief Sends characters to the console without waiting for the UART.
+ * \details Uses the transmit ring of LiteOS. Without it, waits.
+ * \return the number of characters sent, the ones that do not fit
+ *  in the ring are dropped.
+ */
+int lite_console_write_nonblock(const char* s, int len);
+
+/**
+ * \brief Same as printf(), without waiting for the UART
+ * \details Uses lite_console_write_nonblock(), at most 256 characters.
+ */
+int lite_printf_nonblock(const char* fmt, ...)
+    __attribute__((format(printf, 1, 2)));
+
+/**
+ * \brief Gets a character from the console without waiting.
+ * \details Uses the receive ring of LiteOS (that gets the characters
+ *  when it has interrupts). Without it, uses readchar_nonblock().
+ * \return the character, or -1 if there is none
+ */
+int lite_console_getchar_nonblock(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef LITE_SERVICES_OVERRIDE
+#define f_mount lite_f_mount
+#define f_open  lite_f_open
+#define f_close lite_f_close
+#define f_read  lite_f_read
+#define f_lseek lite_f_lseek
+#define f_stat  lite_f_stat
+#endif
+
+#endif
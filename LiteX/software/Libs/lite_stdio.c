@@ -1,5 +1,7 @@
 #include <lite_stdio.h>
 #include <libfatfs/ff.h>
+#define LITE_SERVICES_OVERRIDE
+#include <lite_services.h>
 #include <libfatfs/diskio.h>
 #include <liblitesdcard/spisdcard.h>
 #include <string.h>
@@ -7,6 +9,24 @@
 
 #include <generated/csr.h>
 
+#ifdef CSR_SDBLOCK2MEM_BASE
+#include <liblitesdcard/sdcard.h>
+#endif
+
+/*
+ * With the LiteX sdcard core (CSR_SDBLOCK2MEM_BASE), the SDCard is read
+ * by DMA. For the whole sectors of a request, f_read() calls disk_read()
+ * with the caller's buffer (it only goes through its sector buffer for
+ * the partial sectors at both ends), so that sector-aligned reads are
+ * transferred straight to the destination, without any copy. The DMA
+ * needs an aligned destination: the other requests go through lx_bounce.
+ */
+#ifndef LX_DMA_ALIGN
+#define LX_DMA_ALIGN 4
+#endif
+#define LX_SECTOR_SIZE  512
+#define LX_BOUNCE_SIZE  (4*LX_SECTOR_SIZE)
+
 static int filesystem_init = 0;
 #define FILDES_NB 4
 static int fildes_used[FILDES_NB] = { -1, -1, -1, -1 };
@@ -31,7 +51,6 @@ LX_FILE* lx_fopen(const char* pathname, const char* mode) {
 }
 
 size_t lx_fread(void *ptr, size_t size, size_t nmemb, LX_FILE *stream) {
-   printf("fread\n");
    size_t result = lx_read(*stream, ptr, size*nmemb);
    return (result / size);
 }
@@ -59,18 +78,15 @@ int lx_fscanf(LX_FILE* stream, const char *format, ...) {
 }
 
 int lx_fseek(LX_FILE *stream, long offset, int whence) {
-   printf("fseek %d\n",whence);
-   return 0;
+   return (lx_lseek(*stream, offset, whence) == -1) ? -1 : 0;
 }
 
 long lx_ftell(LX_FILE *stream) {
-   printf("ftell\n");
-   return 0;
+   return f_tell(&fildes[*stream]);
 }
 
 int lx_feof(LX_FILE* stream) {
-   printf("feof\n");
-   return 0;
+   return f_eof(&fildes[*stream]);
 }
 
 /*****************************************************************************/
@@ -79,7 +95,11 @@ static void lx_mount(void) {
     static FATFS fs;
     if(!filesystem_init) {
 	filesystem_init = 1;
+#ifdef CSR_SDBLOCK2MEM_BASE
+        fatfs_set_ops_sdcard();
+#else
         fatfs_set_ops_spisdcard();
+#endif
 	printf("Mounting filesystem\n");
 	if(f_mount(&fs,"",1) != FR_OK) {
 	    printf("Could not mount filesystem\n");
@@ -126,6 +146,35 @@ int lx_open(const char *pathname, int flags, ...) {
 ssize_t lx_read(int fd, void *buf, size_t count) {
    UINT res;
 // printf("read\n");   
+#ifdef CSR_SDBLOCK2MEM_BASE
+   /*
+    * The whole sectors land at buf + (bytes to the next sector
+    * boundary): the DMA destination is aligned if buf and the file
+    * position are aligned the same way.
+    */
+   if(
+      (((uintptr_t)buf - f_tell(&fildes[fd])) & (LX_DMA_ALIGN-1)) &&
+      count >= LX_SECTOR_SIZE
+   ) {
+      static uint8_t lx_bounce[LX_BOUNCE_SIZE + LX_DMA_ALIGN]
+                     __attribute__((aligned(LX_DMA_ALIGN)));
+      uint8_t* dst = (uint8_t*)buf;
+      size_t total = 0;
+      while(total < count) {
+	 UINT n = (count - total < LX_BOUNCE_SIZE) ? count - total : LX_BOUNCE_SIZE;
+	 uint8_t* bounce = lx_bounce + (f_tell(&fildes[fd]) & (LX_DMA_ALIGN-1));
+	 if(f_read(&fildes[fd], bounce, n, &res) != FR_OK) {
+	    break;
+	 }
+	 memcpy(dst + total, bounce, res);
+	 total += res;
+	 if(res < n) {
+	    break;
+	 }
+      }
+      return total;
+   }
+#endif
    f_read(&fildes[fd], buf, count, &res);
    return res;
 }
@@ -145,7 +194,14 @@ int lx_close(int fd) {
 
 off_t lx_lseek(int fd, off_t offset, int whence) {
 //  printf("lseek %d\n",whence);
-    f_lseek(&fildes[fd], offset);
+    if(whence == SEEK_CUR) {
+	offset += f_tell(&fildes[fd]);
+    } else if(whence == SEEK_END) {
+	offset += f_size(&fildes[fd]);
+    }
+    if(f_lseek(&fildes[fd], offset) != FR_OK) {
+	return -1;
+    }
     return offset;
 }
 
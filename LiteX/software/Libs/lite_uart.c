@@ -0,0 +1,192 @@
+#include "lite_uart.h"
+
+#include <generated/csr.h>
+#include <generated/soc.h>
+#include <irq.h>
+#include <libbase/uart.h>
+
+#ifdef CSR_UART_BASE
+
+/*
+ * Same rings as in libbase/uart.c (power-of-two sizes, produce/consume
+ * indices), the transmit ring is larger: it is what a program can print
+ * without waiting.
+ */
+#ifndef LITE_UART_RX_SIZE
+#define LITE_UART_RX_SIZE 256
+#endif
+
+#ifndef LITE_UART_TX_SIZE
+#define LITE_UART_TX_SIZE 8192
+#endif
+
+#define RX_MASK (LITE_UART_RX_SIZE-1)
+#define TX_MASK (LITE_UART_TX_SIZE-1)
+
+static char rx_buf[LITE_UART_RX_SIZE];
+static volatile unsigned int rx_produce;
+static unsigned int rx_consume;
+
+static char tx_buf[LITE_UART_TX_SIZE];
+static unsigned int tx_produce;
+static volatile unsigned int tx_consume;
+
+#if defined(CONFIG_CPU_HAS_INTERRUPT) && !defined(UART_POLLING)
+#define LITE_UART_IRQ
+#endif
+
+/*
+ * Moves the received bytes to rx_buf (drops them if it is full, else the RX
+ * event would stay pending) and the bytes of tx_buf to the UART (as many as
+ * it takes). Called by uart_isr(), or with the UART interrupt masked.
+ */
+static void uart_transfer(void) {
+    while(!uart_rxempty_read()) {
+	unsigned int rx_produce_next = (rx_produce + 1) & RX_MASK;
+	char c = uart_rxtx_read();
+	uart_ev_pending_write(UART_EV_RX);
+	if(rx_produce_next != rx_consume) {
+	    rx_buf[rx_produce] = c;
+	    rx_produce = rx_produce_next;
+	}
+    }
+    while(tx_consume != tx_produce && !uart_txfull_read()) {
+	uart_rxtx_write(tx_buf[tx_consume]);
+	tx_consume = (tx_consume + 1) & TX_MASK;
+    }
+}
+
+#ifdef LITE_UART_IRQ
+
+static inline unsigned int uart_lock(void) {
+    unsigned int oldmask = irq_getmask();
+    irq_setmask(oldmask & ~(1 << UART_INTERRUPT));
+    return oldmask;
+}
+
+static inline void uart_unlock(unsigned int oldmask) {
+    irq_setmask(oldmask);
+}
+
+void uart_isr(void) {
+    uart_ev_pending_write(uart_ev_pending_read() & UART_EV_TX);
+    uart_transfer();
+}
+
+#else
+
+/* No interrupts: the transfers are done by the calls */
+
+static inline unsigned int uart_lock(void) {
+    uart_transfer();
+    return 0;
+}
+
+static inline void uart_unlock(unsigned int oldmask) {
+    (void)oldmask;
+}
+
+void uart_isr(void) {
+    uart_transfer();
+}
+
+#endif
+
+/*
+ * Queues c, writes it directly if nothing is queued and the UART has room
+ * (a TX event only comes when the UART has sent something).
+ * Called with the UART interrupt masked.
+ */
+static int uart_put(char c) {
+    unsigned int tx_produce_next = (tx_produce + 1) & TX_MASK;
+    if(tx_consume == tx_produce && !uart_txfull_read()) {
+	uart_rxtx_write(c);
+	return 1;
+    }
+    if(tx_produce_next == tx_consume) {
+	return 0;
+    }
+    tx_buf[tx_produce] = c;
+    tx_produce = tx_produce_next;
+    return 1;
+}
+
+int lite_uart_putchar_nonblock(char c) {
+    unsigned int oldmask = uart_lock();
+    int result = uart_put(c);
+    uart_unlock(oldmask);
+    return result;
+}
+
+int lite_uart_write_nonblock(const char* s, int len) {
+    unsigned int oldmask = uart_lock();
+    int i;
+    for(i=0; i<len && uart_put(s[i]); ++i);
+    uart_unlock(oldmask);
+    return i;
+}
+
+int lite_uart_getchar_nonblock(void) {
+    unsigned int oldmask = uart_lock();
+    int result = -1;
+    if(rx_consume != rx_produce) {
+	result = (unsigned char)rx_buf[rx_consume];
+	rx_consume = (rx_consume + 1) & RX_MASK;
+    }
+    uart_unlock(oldmask);
+    return result;
+}
+
+int lite_uart_tx_free(void) {
+    return (int)((tx_consume - tx_produce - 1) & TX_MASK);
+}
+
+void lite_uart_poll(void) {
+    unsigned int oldmask = uart_lock();
+    uart_transfer();
+    uart_unlock(oldmask);
+}
+
+/*********** The functions of libbase/uart.c *********************************/
+
+char uart_read(void) {
+    int c;
+    /* polls, in case interrupts are disabled */
+    while((c = lite_uart_getchar_nonblock()) == -1) {
+	lite_uart_poll();
+    }
+    return (char)c;
+}
+
+int uart_read_nonblock(void) {
+    unsigned int oldmask = uart_lock();
+    int result = (rx_consume != rx_produce);
+    uart_unlock(oldmask);
+    return result;
+}
+
+void uart_write(char c) {
+    while(!lite_uart_putchar_nonblock(c)) {
+	lite_uart_poll();
+    }
+}
+
+void uart_sync(void) {
+    while(tx_consume != tx_produce) {
+	lite_uart_poll();
+    }
+}
+
+void uart_init(void) {
+    rx_produce = 0;
+    rx_consume = 0;
+    tx_produce = 0;
+    tx_consume = 0;
+    uart_ev_pending_write(uart_ev_pending_read());
+#ifdef LITE_UART_IRQ
+    uart_ev_enable_write(UART_EV_TX | UART_EV_RX);
+    irq_setmask(irq_getmask() | (1 << UART_INTERRUPT));
+#endif
+}
+
+#endif
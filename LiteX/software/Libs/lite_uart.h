@@ -0,0 +1,61 @@
+// UART driver with ring buffers, that replaces the one of LiteX libbase
+// (it defines uart_init(), uart_isr(), uart_read(), uart_read_nonblock(),
+// uart_write() and uart_sync(), so that libbase/uart.o is not linked).
+// It has a larger transmit ring and non-blocking variants, so that a
+// render loop can print statistics without waiting for the serial line.
+//
+// With interrupts (CONFIG_CPU_HAS_INTERRUPT, not UART_POLLING), uart_isr()
+// (called by isr.c) moves the bytes between the rings and the UART. Without
+// them, each call to a function of this file does it (lite_uart_poll() to
+// do it without reading or writing).
+//
+// It needs to be linked as an object (before libbase), not from libliteos.a
+// (LiteOS and DemoBundle have lite_uart.o in OBJECTS).
+
+#ifndef LITE_UART
+#define LITE_UART
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief Queues a character to be sent, without waiting.
+ * \param[in] c the character ('\n' is not translated)
+ * \retval 1 if it was queued
+ * \retval 0 if the transmit ring is full (the character is dropped)
+ */
+int lite_uart_putchar_nonblock(char c);
+
+/**
+ * \brief Queues characters to be sent, without waiting.
+ * \param[in] s the characters
+ * \param[in] len the number of characters
+ * \return the number of queued characters, the ones that do not fit
+ *  in the transmit ring are dropped
+ */
+int lite_uart_write_nonblock(const char* s, int len);
+
+/**
+ * \brief Gets a received character, without waiting.
+ * \return the character, or -1 if there is none
+ */
+int lite_uart_getchar_nonblock(void);
+
+/**
+ * \brief Gets the number of characters that can be queued.
+ */
+int lite_uart_tx_free(void);
+
+/**
+ * \brief Moves the bytes between the rings and the UART.
+ * \details Only needed without interrupts, by a program that queued
+ *  characters and does not call the other functions for a while.
+ */
+void lite_uart_poll(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
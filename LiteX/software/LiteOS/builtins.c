@@ -1,6 +1,10 @@
 #include "command.h"
 
 #include <lite_elf.h>
+#include <lite_services.h>
+#include <lite_fb.h>
+#include <lite_uart.h>
+#include "image_cache.h"
 
 #include <liblitesdcard/sdcard.h>
 #include <liblitesdcard/spisdcard.h>
@@ -8,6 +12,8 @@
 
 #include <generated/csr.h>
 
+#include <libbase/console.h>
+
 #include <stdio.h>
 #include <string.h>
 
@@ -39,6 +45,44 @@ static void framebuffer(int nb_args, char** args) {
 define_command(framebuffer, framebuffer, "turn framebuffer on/off", 0);
 #endif
 
+#if defined(CSR_SPISDCARD_BASE) || defined(CSR_SDCORE_BASE)
+/*
+ * The filesystem stays mounted across commands. It is mounted again after
+ * anything that may have changed the SDCard or its state behind our back
+ * (ESP32 on the SPI bus, a program that returned, an error).
+ */
+static FATFS fs;
+static int fs_mounted = 0;
+
+static int mount_sdcard(void) {
+    if(fs_mounted) {
+	return 1;
+    }
+#ifdef CSR_SDBLOCK2MEM_BASE
+    /* LiteX sdcard core: 4-bit bus, DMA block reads */
+    fatfs_set_ops_sdcard();
+#else
+    fatfs_set_ops_spisdcard();
+#endif
+    if(f_mount(&fs,"",1) != FR_OK) {
+	printf("Could not mount filesystem\n");
+	return 0;
+    }
+    fs_mounted = 1;
+    return 1;
+}
+
+static void unmount_sdcard(void) {
+    if(fs_mounted) {
+	f_mount(NULL,"",0);
+	fs_mounted = 0;
+    }
+}
+#else
+static inline void unmount_sdcard(void) {
+}
+#endif
+
 #ifdef CSR_ESP32_BASE
 static void esp32(int nb_args, char** args) {
    if (nb_args == 0) {
@@ -46,6 +90,7 @@ static void esp32(int nb_args, char** args) {
        return;
    }
    if(!strcmp(args[0],"on")) {
+       unmount_sdcard();
        esp32_enable_write(1);
    } else if(!strcmp(args[0],"off")) {
        esp32_enable_write(0);
@@ -79,23 +124,22 @@ static void esp32_off(void) {
 #if defined(CSR_SPISDCARD_BASE) || defined(CSR_SDCORE_BASE)
 static void catalog(int nb_args, char** args) {
     FRESULT fr;
-    FATFS fs;
     DIR dir;
     FILINFO filinfo;
 
     printf("switching ESP32 off\n");
     esp32_off();
    
-    fatfs_set_ops_spisdcard(); 
-    fr = f_mount(&fs,"",1);
-    if(fr != FR_OK) {
-	printf("Could not mount filesystem\n");
+    if(!mount_sdcard()) {
 	return;
     }
 
     fr = f_opendir(&dir,nb_args == 0 ? "/" : args[0]);
     if(fr != FR_OK) {
 	printf("opendir error\n");
+	if(fr != FR_NO_PATH && fr != FR_INVALID_NAME) {
+	    unmount_sdcard();
+	}
 	return;
     }
 
@@ -107,11 +151,57 @@ static void catalog(int nb_args, char** args) {
 }
 define_command(catalog, catalog, "list files on SDCard", 0);
 
-typedef void(*main_fptr)(int argc, char** argv);
+typedef void(*main_fptr)(int argc, char** argv, LiteServices* services);
+
+/* What the program can leave to LiteOS below its heap */
+#define RUN_STACK_SIZE (256*1024)
+
+static void clip_heap(uint32_t* end, uint32_t start, uint32_t zone) {
+   if(zone >= start && zone < *end) {
+      *end = zone;
+   }
+}
+
+/*
+ * The services of LiteOS for a program (see lite_services.h). Its heap goes
+ * from its end to the first zone above it that is used by someone else
+ * (the framebuffer pages, the image cache, the stack).
+ */
+static void init_services(LiteServices* services, const Elf32Info* info) {
+   uint32_t start = (info->max_address + 7) & ~7;
+   uint32_t end = (uint32_t)&start - RUN_STACK_SIZE;
+#ifdef CSR_VIDEO_FRAMEBUFFER_BASE
+   clip_heap(&end, start, FB_PAGE1);
+#endif
+   clip_heap(&end, start, image_cache_base());
+   
+   memset(services, 0, sizeof(LiteServices));
+   services->magic             = LITE_SERVICES_MAGIC;
+   services->version           = LITE_SERVICES_VERSION;
+   services->putchar           = putchar;
+   services->readchar          = readchar;
+   services->readchar_nonblock = readchar_nonblock;
+   services->f_open            = f_open;
+   services->f_close           = f_close;
+   services->f_read            = f_read;
+   services->f_lseek           = f_lseek;
+   services->f_stat            = f_stat;
+#ifdef CSR_VIDEO_FRAMEBUFFER_BASE
+   if(video_framebuffer_dma_enable_read()) {
+      services->fb_page = video_framebuffer_dma_base_read();
+   }
+#endif
+   if(end > start) {
+      services->heap_start = (uint8_t*)start;
+      services->heap_end   = (uint8_t*)end;
+   }
+#ifdef CSR_UART_BASE
+   services->write_nonblock    = lite_uart_write_nonblock;
+   services->getchar_nonblock  = lite_uart_getchar_nonblock;
+#endif
+}
 
 static void run(int nb_args, char** args) {
-   FRESULT fr;
-   FATFS fs;
    Elf32Info info;
 
    esp32_off();
@@ -121,20 +211,39 @@ static void run(int nb_args, char** args) {
       return;
    }
    
-   fatfs_set_ops_spisdcard();
-   fr = f_mount(&fs,"",1);
-   if(fr != FR_OK) {
-      printf("Could not mount filesystem\n");
+   if(!mount_sdcard()) {
       return;
    }
 
-   if(elf32_load(args[0],&info) != ELF32_OK) {
+   int err = image_cache_load(args[0],&info);
+   if(err != ELF32_OK) {
       printf("could not load %s\n",args[0]);
+      if(err == ELF32_READ_ERROR) {
+	 unmount_sdcard();
+      }
+      return;
+   }
+   static LiteServices services;
+   init_services(&services, &info);
+   (*(main_fptr)(info.text_address))(nb_args, args, &services);
+   /*
+    * A program that did not take the services may have written to the
+    * SDCard (or re-initialized it), the others used our filesystem.
+    */
+   if(services.program_version == 0) {
+      unmount_sdcard();
+   }
+}
+define_command(run, run, "run an ELF (or .elz, .fxe) file", 0);
+
+static void cache(int nb_args, char** args) {
+   if(nb_args == 1 && !strcmp(args[0],"clear")) {
+      image_cache_clear();
       return;
    }
-   (*(main_fptr)(info.text_address))(nb_args, args);
+   image_cache_print();
 }
-define_command(run, run, "run an ELF file", 0);
+define_command(cache, cache, "list (or clear) the programs cached by run", 0);
 
 
 #endif
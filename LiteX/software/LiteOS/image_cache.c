@@ -0,0 +1,210 @@
+#include "image_cache.h"
+
+#include <libfatfs/ff.h>
+#include <libbase/crc.h>
+
+#include <generated/mem.h>
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * The cache zone starts with a header (the table of the cached images,
+ * protected by a CRC, so that it survives a reboot), followed by the
+ * images, one after the other. An image is the memory of a loaded program,
+ * text_address ... max_address-1 (bss included), copied right after
+ * elf32_load(), before the program runs. When the zone or the table is full,
+ * the cache is cleared. A program that uses the memory of the zone (or an
+ * image that does not fit) is simply not cached, and a cached image that a
+ * program overwrote is detected by its CRC.
+ *
+ * Copying from the cache is faster than checking whether the segments of the
+ * last program are still intact in place (it has run, so its data changed),
+ * so a cached program is always copied.
+ */
+
+#ifdef MAIN_RAM_BASE
+
+#ifndef IMAGE_CACHE_BASE
+#define IMAGE_CACHE_BASE (MAIN_RAM_BASE + MAIN_RAM_SIZE/2)
+#endif
+
+#ifndef IMAGE_CACHE_SIZE
+#define IMAGE_CACHE_SIZE (MAIN_RAM_SIZE/4)
+#endif
+
+#define IMAGE_CACHE_MAGIC   0x48434D49 /* "IMCH" */
+#define IMAGE_CACHE_ENTRIES 8
+#define IMAGE_CACHE_NAME    32
+
+typedef struct {
+   char     name[IMAGE_CACHE_NAME]; /* empty if the entry is free */
+   uint32_t file_size;
+   uint32_t file_time;   /* FAT date << 16 | FAT time */
+   uint32_t text_address;
+   uint32_t max_address;
+   uint32_t offset;      /* of the image, from the end of the header */
+   uint32_t crc;         /* of the image */
+} ImageCacheEntry;
+
+typedef struct {
+   uint32_t        magic;
+   uint32_t        used;  /* bytes used after the header */
+   uint32_t        nb_entries;
+   ImageCacheEntry entries[IMAGE_CACHE_ENTRIES];
+   uint32_t        crc;   /* of all the above */
+} ImageCacheHeader;
+
+#define cache_header ((ImageCacheHeader*)(IMAGE_CACHE_BASE))
+#define cache_data   ((uint8_t*)(IMAGE_CACHE_BASE + sizeof(ImageCacheHeader)))
+#define cache_data_size (IMAGE_CACHE_SIZE - sizeof(ImageCacheHeader))
+
+static uint32_t header_crc(void) {
+   return crc32(
+      (const unsigned char*)cache_header, offsetof(ImageCacheHeader, crc)
+   );
+}
+
+static void update_header(void) {
+   cache_header->crc = header_crc();
+}
+
+void image_cache_clear(void) {
+   memset(cache_header, 0, sizeof(ImageCacheHeader));
+   cache_header->magic = IMAGE_CACHE_MAGIC;
+   update_header();
+}
+
+static int header_valid(void) {
+   return cache_header->magic == IMAGE_CACHE_MAGIC &&
+          cache_header->crc == header_crc() &&
+          cache_header->used <= cache_data_size &&
+          cache_header->nb_entries <= IMAGE_CACHE_ENTRIES;
+}
+
+static uint32_t image_crc(const ImageCacheEntry* entry) {
+   return crc32(
+      cache_data + entry->offset, entry->max_address - entry->text_address
+   );
+}
+
+/*
+ * Puts the program that was just loaded in the cache (if it does not use
+ * the memory of the cache and if it fits).
+ */
+static void cache_image(const char* filename, const FILINFO* fi, const Elf32Info* info) {
+   uint32_t size = info->max_address - info->text_address;
+   ImageCacheEntry* entry;
+
+   if(strlen(filename) >= IMAGE_CACHE_NAME ||
+      info->max_address <= info->text_address ||
+      size > cache_data_size ||
+      (info->text_address < IMAGE_CACHE_BASE + IMAGE_CACHE_SIZE &&
+       info->max_address > IMAGE_CACHE_BASE)) {
+      return;
+   }
+
+   if(cache_header->nb_entries == IMAGE_CACHE_ENTRIES ||
+      cache_header->used + size > cache_data_size) {
+      image_cache_clear();
+   }
+
+   entry = &cache_header->entries[cache_header->nb_entries];
+   strcpy(entry->name, filename);
+   entry->file_size = fi->fsize;
+   entry->file_time = ((uint32_t)fi->fdate << 16) | fi->ftime;
+   entry->text_address = info->text_address;
+   entry->max_address = info->max_address;
+   entry->offset = cache_header->used;
+   memcpy(cache_data + entry->offset, (void*)info->text_address, size);
+   entry->crc = image_crc(entry);
+
+   /* next image aligned on 8 bytes */
+   cache_header->used += (size + 7) & ~7;
+   ++cache_header->nb_entries;
+   update_header();
+}
+
+int image_cache_load(const char* filename, Elf32Info* info) {
+   FILINFO fi;
+   int status;
+
+   if(f_stat(filename, &fi) != FR_OK) {
+      return ELF32_FILE_NOT_FOUND;
+   }
+
+   if(!header_valid()) {
+      image_cache_clear();
+   }
+
+   for(uint32_t i=0; i<cache_header->nb_entries; ++i) {
+      ImageCacheEntry* entry = &cache_header->entries[i];
+      if(strcmp(entry->name, filename)) {
+	 continue;
+      }
+      if(entry->file_size == fi.fsize &&
+	 entry->file_time == (((uint32_t)fi.fdate << 16) | fi.ftime) &&
+	 entry->crc == image_crc(entry)) {
+	 memcpy(
+	    (void*)entry->text_address, cache_data + entry->offset,
+	    entry->max_address - entry->text_address
+	 );
+	 info->base_address = NULL;
+	 info->text_address = entry->text_address;
+	 info->max_address = entry->max_address;
+	 return ELF32_OK;
+      }
+      /* The file changed (or the image was overwritten): forget it */
+      entry->name[0] = '\0';
+      update_header();
+   }
+
+   status = elf32_load(filename, info);
+   if(status == ELF32_OK) {
+      cache_image(filename, &fi, info);
+   }
+   return status;
+}
+
+uint32_t image_cache_base(void) {
+   return IMAGE_CACHE_BASE;
+}
+
+void image_cache_print(void) {
+   if(!header_valid()) {
+      image_cache_clear();
+   }
+   printf("image cache: %d KB used of %d KB at 0x%08x\n",
+	  (int)(cache_header->used >> 10), (int)(cache_data_size >> 10),
+	  (unsigned)IMAGE_CACHE_BASE);
+   for(uint32_t i=0; i<cache_header->nb_entries; ++i) {
+      const ImageCacheEntry* entry = &cache_header->entries[i];
+      if(entry->name[0] != '\0') {
+	 printf("%s %d KB at 0x%08x\n", entry->name,
+		(int)((entry->max_address - entry->text_address) >> 10),
+		(unsigned)entry->text_address);
+      }
+   }
+}
+
+#else
+
+/* No SDRAM (or unknown size): no cache */
+
+int image_cache_load(const char* filename, Elf32Info* info) {
+   return elf32_load(filename, info);
+}
+
+void image_cache_clear(void) {
+}
+
+void image_cache_print(void) {
+   printf("no image cache\n");
+}
+
+uint32_t image_cache_base(void) {
+   return 0;
+}
+
+#endif
@@ -0,0 +1,39 @@
+/*
+ * Cache of the programs loaded by 'run', in a reserved zone of the SDRAM,
+ * so that launching the same program again does not read the SDCard.
+ */
+
+#ifndef IMAGE_CACHE_H
+#define IMAGE_CACHE_H
+
+#include <lite_elf.h>
+
+/**
+ * \brief Loads a program, from the cache if it has it, else from the
+ *  SDCard (and then puts it in the cache).
+ * \details The cached image is used if the file has the same name, size
+ *  and modification time, and if the image has the same CRC as when it
+ *  was cached.
+ * \param[in] filename the ELF (or .elz, .fxe) file
+ * \param[out] info text_address and max_address of the program
+ * \return ELF32_OK or an error code of elf32_load().
+ */
+int image_cache_load(const char* filename, Elf32Info* info);
+
+/**
+ * \brief Forgets all the cached images.
+ */
+void image_cache_clear(void);
+
+/**
+ * \brief Prints the cached images.
+ */
+void image_cache_print(void);
+
+/**
+ * \brief Gets the start of the cache zone (that programs should not use).
+ * \return the address of the zone, or 0 if there is no cache
+ */
+uint32_t image_cache_base(void);
+
+#endif
@@ -53,20 +53,79 @@ static uint32_t pattern[4][4] = {
 };
 
 
-/* X11 memories :-) */
+/*
+ * X11 memories :-) There is one white pixel out of 4 in each row: the
+ * blitter clears the page, then the CPU only writes the white pixels.
+ */
 #ifdef CSR_VIDEO_FRAMEBUFFER_BASE
 static void init_framebuffer(void) {
-   uint32_t* ptr = fb_base;
    fb_off();
-   for(int y=0; y<FB_HEIGHT; ++y) {   
-      for(int x=0; x<FB_WIDTH; ++x) {
-	 *ptr++ = pattern[x&3][y&3];
+   fb_clear();
+   fb_sync();
+   for(int y=0; y<FB_HEIGHT; ++y) {
+      uint32_t* row = fb_base + y*FB_WIDTH;
+      int x = 0;
+      while(pattern[x][y&3] != I) {
+	 ++x;
+      }
+      for(; x<FB_WIDTH; x+=4) {
+	 row[x] = I;
       }
    }
    fb_on();   
 }
 #endif
 
+/*
+ * Boot phases timing, with timer0 counting down from 0xffffffff since the
+ * beginning of main(). The SDCard is only mounted by the first command
+ * that needs it (catalog, run), it is not part of the boot.
+ */
+#ifdef CSR_TIMER0_BASE
+#define BOOT_MAX_PHASES 4
+
+static const char* boot_phase_names[BOOT_MAX_PHASES];
+static uint32_t    boot_phase_ticks[BOOT_MAX_PHASES];
+static int         boot_nb_phases = 0;
+
+static uint32_t boot_ticks(void) {
+   timer0_update_value_write(1);
+   return 0xffffffff - timer0_value_read();
+}
+
+static void boot_timer_start(void) {
+   timer0_en_write(0);
+   timer0_reload_write(0);
+   timer0_load_write(0xffffffff);
+   timer0_en_write(1);
+}
+
+/* Records the end of a phase (printed by boot_print_phases()) */
+static void boot_phase(const char* name) {
+   if(boot_nb_phases < BOOT_MAX_PHASES) {
+      boot_phase_names[boot_nb_phases] = name;
+      boot_phase_ticks[boot_nb_phases] = boot_ticks();
+      ++boot_nb_phases;
+   }
+}
+
+static void boot_print_phases(void) {
+   uint32_t ticks_per_us = CONFIG_CLOCK_FREQUENCY/1000000;
+   uint32_t prev = 0;
+   printf("boot:");
+   for(int i=0; i<boot_nb_phases; ++i) {
+      printf(" %s %dus", boot_phase_names[i],
+	     (int)((boot_phase_ticks[i] - prev) / ticks_per_us));
+      prev = boot_phase_ticks[i];
+   }
+   printf(", prompt at %dus\n", (int)(prev / ticks_per_us));
+}
+#else
+static inline void boot_timer_start(void) {}
+static inline void boot_phase(const char* name) {}
+static inline void boot_print_phases(void) {}
+#endif
+
 int main(int i, char **c)
 {
 	char buffer[CMD_LINE_BUFFER_SIZE];
@@ -75,6 +134,8 @@ int main(int i, char **c)
 	struct command_struct *cmd;
 	int nb_params;
 
+	boot_timer_start();
+
 #ifdef CONFIG_CPU_HAS_INTERRUPT
 	irq_setmask(0);
 	irq_setie(1);
@@ -136,18 +197,22 @@ int main(int i, char **c)
 #endif
 #endif
 	printf("\n");
-
+	boot_phase("banner");
 
 #ifdef CSR_VIDEO_FRAMEBUFFER_BASE
         init_framebuffer();
+	boot_phase("framebuffer");
 #endif   
    
 	init_dispatcher();
 
-	printf("--============= \e[1mConsole\e[0m ================--\n");
 #if !defined(TERM_MINI) && !defined(TERM_NO_HIST)
 	hist_init();
 #endif
+	boot_phase("console");
+
+	printf("--============= \e[1mConsole\e[0m ================--\n");
+	boot_print_phases();
 	printf("\n%s", PROMPT);
 	while(1) {
 		readline(buffer, CMD_LINE_BUFFER_SIZE);
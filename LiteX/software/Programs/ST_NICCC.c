@@ -12,6 +12,8 @@
 
 #include "lite_fb.h"
 #include <libfatfs/ff.h>
+#define LITE_SERVICES_OVERRIDE
+#include <lite_services.h>
 #include <libbase/uart.h>
 #include <libbase/console.h>
 #include <liblitesdcard/spisdcard.h>
@@ -198,6 +200,7 @@ int main(int argc, char** argv) {
    int run = 1;
    fb_init();
    fb_set_dual_buffering(1);
+   fb_set_pipelined_fill(1);
    wireframe = 0;
 
    
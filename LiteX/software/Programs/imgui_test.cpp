@@ -7,8 +7,10 @@
 extern "C" {
 #include "lite_fb.h"
 }
+#include "lite_arena.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 
 #include <libbase/uart.h>
 #include <libbase/console.h>
@@ -20,6 +22,10 @@ void* operator new(size_t size) {
 }
 
 
+// All ImGui allocations (and operator new) go to this arena, allocated
+// once: after the first frames, the frames no longer touch the heap.
+#define IMGUI_ARENA_SIZE (1024*1024)
+
 int main(int, char**)
 {
     printf("Initializing framebuffer...\n");
@@ -27,6 +33,8 @@ int main(int, char**)
     fb_set_dual_buffering(1);
    
     printf("Initializing ImGui...\n");
+    lite_arena_init(malloc(IMGUI_ARENA_SIZE), IMGUI_ARENA_SIZE);
+    ImGui::SetAllocatorFunctions(lite_arena_imgui_alloc, lite_arena_imgui_free);
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO();
@@ -35,10 +43,14 @@ int main(int, char**)
     imgui_sw::make_style_fast();
    
     printf("Starting ImGui...\n");
+    printf("Press 'c' to dump frame timings (CSV), 'm' for the arena statistics\n");
+    printf("(of the last frame), any other key to quit\n");
    
     int n = 0;
     for (;;) {
         ++n;
+        lite_arena_reset_counters();
+        imgui_sw::timing_begin_frame();
         io.DisplaySize = ImVec2(640, 480);
         io.DeltaTime = 1.0f / 60.0f;
         ImGui::NewFrame();
@@ -58,13 +70,29 @@ int main(int, char**)
         ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / io.Framerate, io.Framerate);
         */
 
+        imgui_sw::timing_mark(imgui_sw::kPhaseLogic);
         ImGui::Render();
-        imgui_sw::paint_imgui((uint32_t*)fb_base,640,480);
-        fb_swap_buffers();
-        fb_clear();
+        imgui_sw::timing_mark(imgui_sw::kPhaseRender);
+        // Only repaints what changed in the two buffers (dual buffering)
+        bool painted = imgui_sw::paint_imgui_incremental((uint32_t*)fb_base,640,480,2);
+        imgui_sw::timing_mark(imgui_sw::kPhasePaint);
+        if (painted) {
+            fb_swap_buffers();
+        }
+        imgui_sw::timing_mark(imgui_sw::kPhaseSwap);
+        imgui_sw::timing_end_frame();
 
         if (readchar_nonblock()) {
-	   getchar();
+	   char c = getchar();
+	   if (c == 'c') {
+	      imgui_sw::show_timing_in_terminal();
+	      imgui_sw::dump_timing_csv();
+	      continue;
+	   }
+	   if (c == 'm') {
+	      lite_arena_print_stats();
+	      continue;
+	   }
 	   break;;
         }
     }
@@ -22,6 +22,7 @@ int sintab[64] = {
 
 int main(void) {
     fb_init();
+    fb_set_pipelined_fill(1);
     int frame = 0;
     int comp = 0;
    
@@ -32,10 +32,18 @@ extern "C" {
 }
 #include <libbase/uart.h>
 #include <libbase/console.h>
+#include <lite_services.h>
 #include <stdlib.h>
 
 OpCode LiteXGraphicPort::ISXGPORT     = 100;
 
+int LiteXGraphicPort::_format_indexed = 0;
+
+void LiteXGraphicPort::SetIndexed(int yes)
+{
+  _format_indexed = yes;
+}
+
 long LiteXGraphicPort::Cntl(OpCode op, int arg) {
   if(op == ISXGPORT)
     {
@@ -48,14 +56,41 @@ LiteXGraphicPort::LiteXGraphicPort(const char *name, int verbose_level)
     :GraphicPort(name, 640, 480, verbose_level)
 {
    fb_init();
-   fb_set_dual_buffering(1);
-   _graph_mem = (ColorIndex*)fb_base;
-   _bits_per_pixel = 24;
-   _bytes_per_pixel = 4;
+   fb_set_triple_buffering(1);
+   _indexed = (_format_indexed != 0);
+   if(_indexed)
+     {
+       // The format of peng_8. Pixels are colormap indices (the
+       // colormaps are the identity), _palette gives their colors.
+       if(!(_graph_mem = new ColorIndex[FB_WIDTH * FB_HEIGHT]))
+	 {
+	   (*this)[MSG_ERROR] << "could not alloc indexed buffer\n";
+	   _error_code = XGPE_MALLOC;
+	   return;
+	 }
+       _resources.Set(XGPR_GRAPHMEM);
+       _bits_per_pixel  = 8;
+       _bytes_per_pixel = 1;
+       _R_mask = ((UColorCode)3) << 4;
+       _G_mask = ((UColorCode)3) << 2;
+       _B_mask = ((UColorCode)3);
+       for(int i=0; i<GP_COLORMAP_SZ; i++)
+	 {
+	   _colormap[i]     = (ColorIndex)i;
+	   _truecolormap[i] = (UColorCode)i;
+	   _palette[i]      = 0;
+	 }
+     }
+   else
+     {
+       _graph_mem = (ColorIndex*)fb_base;
+       _bits_per_pixel  = 24;
+       _bytes_per_pixel = 4;
+       _R_mask = ((UColorCode)255) << 16;
+       _G_mask = ((UColorCode)255) << 8;
+       _B_mask = ((UColorCode)255);
+     }
    _bytes_per_line  = _bytes_per_pixel * 640;
-   _R_mask = ((UColorCode)255) << 16;
-   _G_mask = ((UColorCode)255) << 8;
-   _B_mask = ((UColorCode)255);
    Attributes().Set(GPA_DBUFF);
    _clip.Set(0,0,_width-1,_height-1);
    SaveContext();
@@ -75,24 +110,22 @@ LiteXGraphicPort::~LiteXGraphicPort(void)
 {
 
   // Deletion (colorcell deallocation) requires
-  // a SetContext(). Before setting context, get
-  // a copy of current context.
-
-  RenderContext* current             = RenderContext::_current;   
-  RenderContext  this_graphic_bus    = _tgc;          
-  SaveContext();                                      
-  RenderContext  current_graphic_bus = _tgc;          
-  _tgc = this_graphic_bus;                            
+  // a SetContext(). The current context is
+  // restored afterwards.
+
+  RenderContext* current = RenderContext::_current;
   SetContext();
 
 
   if(_resources.Get(XGPR_ZBUFFER))
     FreeZBuffer();
 
+  if(_resources.Get(XGPR_GRAPHMEM))
+    delete[] _graph_mem;
+
 // Restore current rendering context.
-  _tgc = current_graphic_bus;
-  RenderContext::_current = current;
-  SetContext();
+  if(current != NULL && current != &_tgc)
+    SwitchContext(current);
 }
 
 void LiteXGraphicPort::CommitAttributes(void)
@@ -132,6 +165,9 @@ int LiteXGraphicPort::AllocateZBuffer(void)
 
   _resources.Set(XGPR_ZBUFFER);
 
+  // Not fatal: without it, the fill routines test all the pixels.
+  AllocateZTiles();
+
   (*this)[MSG_RESOURCE] << "ZBuffer allocated\n";
   return 1;
 }
@@ -142,6 +178,7 @@ void LiteXGraphicPort::FreeZBuffer(void)
 
   if(_resources.Get(XGPR_ZBUFFER))
     delete[] _z_mem;
+  FreeZTiles();
 
   _resources.Reset(XGPR_ZBUFFER);
 }
@@ -161,7 +198,10 @@ void LiteXGraphicPort::MapColor(const ColorIndex idx,
 {
   _colortable[idx].Set(r,g,b);
   _colortable[idx].Stat().Set(CC_USED);
-  _truecolormap[idx] = (r << 16) | (g << 8) | (b);
+  if(!_indexed)
+    _truecolormap[idx] = (r << 16) | (g << 8) | (b);
+  else if(!Attributes().Get(GPA_RGB))
+    _palette[idx] = (r << 16) | (g << 8) | (b);
 }  
 
 void LiteXGraphicPort::RGBMode(void)
@@ -170,6 +210,12 @@ void LiteXGraphicPort::RGBMode(void)
 
   Attributes().Set(GPA_RGB);
   Attributes().Reset(GPA_CMAP);
+
+  // peng_8 writes 2-2-2 RGB pixels
+  if(_indexed)
+    for(int i=0; i<64; i++)
+      _palette[i] = (((i >> 4) & 3) * 85 << 16) | (((i >> 2) & 3) * 85 << 8) |
+	             ((i & 3) * 85);
 }
 
 void LiteXGraphicPort::ColormapMode(void)
@@ -190,6 +236,14 @@ void LiteXGraphicPort::ColormapMode(void)
 
   Attributes().Set(GPA_CMAP);
   Attributes().Reset(GPA_RGB);
+
+  if(_indexed)
+    for(int i=0; i<GP_COLORMAP_SZ; i++)
+      {
+	ColorComponent r,g,b;
+	_colortable[i].Get(&r,&g,&b);
+	_palette[i] = (r << 16) | (g << 8) | (b);
+      }
 }
 
 int LiteXGraphicPort::SingleBuffer(void)
@@ -201,23 +255,46 @@ int LiteXGraphicPort::SingleBuffer(void)
 
 int LiteXGraphicPort::DoubleBuffer(void)
 {
-  fb_set_dual_buffering(1);
+  fb_set_triple_buffering(1);
   _double_buffer = true;   
   return 1;
 }
 
 int LiteXGraphicPort::SwapBuffers(void)
 {
+   if(_indexed) {
+      fb_sync();  // the clear of the indexed buffer may be pending
+      Expand();
+   }
    if(_double_buffer) {
       fb_swap_buffers();
    }
-   _graph_mem = (ColorIndex*)fb_base;   
+   if(!_indexed) {
+      _graph_mem = (ColorIndex*)fb_base;   
+   }
    return 1;
 }
 
+// Indexed buffer -> framebuffer page, 4 pixels per load (little endian).
+
+void LiteXGraphicPort::Expand(void)
+{
+   const uint32* src = (const uint32*)_graph_mem;
+   uint32*       dst = (uint32*)fb_base;
+   for(int i=0; i<FB_WIDTH*FB_HEIGHT/4; i++) {
+      uint32 p = *(src++);
+      dst[0] = _palette[p & 255];
+      dst[1] = _palette[(p >> 8) & 255];
+      dst[2] = _palette[(p >> 16) & 255];
+      dst[3] = _palette[p >> 24];
+      dst += 4;
+   }
+}
+
 int  LiteXGraphicPort::WaitEvent(void) {
-   if (readchar_nonblock()) {
-       _key=getchar();
+   int c = lite_console_getchar_nonblock();
+   if (c != -1) {
+       _key=(char)c;
    }
    return (_key != 0);
 }
@@ -229,8 +306,9 @@ char LiteXGraphicPort::GetKey(void)
 	_key = 0;
 	return result;
     }
-   if (readchar_nonblock()) {
-       result=getchar();
+   int c = lite_console_getchar_nonblock();
+   if (c != -1) {
+       result=(char)c;
    }
    return result;
 }
@@ -277,24 +355,23 @@ void LiteXGraphicPort::ZClear(ZCoord z) {
     };
     zz[0] = z;
     zz[1] = z;
-    blitter_value_write(val);
-    blitter_dma_writer_base_write((uint32_t)(_z_mem));
-    blitter_dma_writer_length_write(FB_WIDTH*FB_HEIGHT*sizeof(ZCoord));
-    blitter_dma_writer_enable_write(1);
-    while(!blitter_dma_writer_done_read());
-    blitter_dma_writer_enable_write(0);    
+    fb_dma_fill(
+	(uint32_t*)_z_mem, FB_WIDTH*FB_HEIGHT*sizeof(ZCoord)/4, val
+    );
+    ZTileReset(z);
 }
 
 
 void 
 LiteXGraphicPort::Clear(UColorCode c)
 {
-    blitter_value_write(c);
-    blitter_dma_writer_base_write((uint32_t)(fb_base));
-    blitter_dma_writer_length_write(FB_WIDTH*FB_HEIGHT*4);
-    blitter_dma_writer_enable_write(1);
-    while(!blitter_dma_writer_done_read());
-    blitter_dma_writer_enable_write(0);    
+    if(_indexed) {
+	fb_dma_fill(
+	    (uint32_t*)_graph_mem, FB_WIDTH*FB_HEIGHT/4, (c & 255) * 0x01010101u
+	);
+    } else {
+	fb_dma_fill(fb_base, FB_WIDTH*FB_HEIGHT, c);
+    }
 }
 
 
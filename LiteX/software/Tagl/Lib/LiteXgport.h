@@ -35,6 +35,7 @@
 
 const Flag XGPR_NONE            = 0;
 const Flag XGPR_ZBUFFER         = 10;
+const Flag XGPR_GRAPHMEM        = 11;
 
 const Flag XGPE_MALLOC  = 5;
 
@@ -77,10 +78,21 @@ class LiteXGraphicPort : public GraphicPort
   static OpCode ISXGPORT;
   virtual long Cntl(OpCode op, int arg);
 
+   // Specific interface
+ public:
+
+  // Pixel format of the next ports. Indexed: the frames are drawn
+  // (by peng_8) in a buffer of 8 bits colormap indices in memory, a
+  // quarter of the framebuffer page, and SwapBuffers() expands it into
+  // the 32 bits page through the palette (the colormap in colormap
+  // mode, 2-2-2 RGB in RGB mode). The video core has no palette mode.
+  static void SetIndexed(int yes);
+
  protected: 
 
   // internal machinery
   virtual void Clear(UColorCode c);
+  void Expand(void);
 
     
   int  AllocateZBuffer(void);
@@ -90,6 +102,11 @@ class LiteXGraphicPort : public GraphicPort
 
   char _key;
   bool _double_buffer;
+
+  bool   _indexed;
+  uint32 _palette[GP_COLORMAP_SZ];   // framebuffer pixel of each index
+
+  static int _format_indexed;
    
   // virtual constructor stuff
 
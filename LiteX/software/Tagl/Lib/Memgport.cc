@@ -0,0 +1,347 @@
+/*
+ * This software is copyrighted as noted below.  It may be freely copied,
+ * modified, and redistributed, provided that the copyright notice is
+ * preserved on all copies.
+ *
+ * There is no warranty or other guarantee of fitness for this software,
+ * it is provided solely "as is".  Bug reports or fixes may be sent
+ * to the author, who may or may not act on them as he desires.
+ *
+ * You may not include this software in a program or other software product
+ * without supplying the source, or without informing the end-user that the
+ * source is available for no extra charge.
+ *
+ * If you modify this software, you should include a notice giving the
+ * name of the person performing the modification, the date of modification,
+ * and the reason for such modification.
+ *
+ * Author:      Bruno Levy
+ *
+ * Copyright (c) 1996-2021 Bruno Levy.
+ *
+ */
+/*
+ *
+ * Memgport.C
+ *
+ */
+
+#include "Memgport.h"
+#include <string.h>
+
+OpCode MemGraphicPort::ISMEMGPORT = 101;
+
+int        MemGraphicPort::_format_bytes_per_pixel = 4;
+UColorCode MemGraphicPort::_format_R_mask = ((UColorCode)255) << 16;
+UColorCode MemGraphicPort::_format_G_mask = ((UColorCode)255) << 8;
+UColorCode MemGraphicPort::_format_B_mask = ((UColorCode)255);
+
+long MemGraphicPort::Cntl(OpCode op, int arg)
+{
+  if(op == ISMEMGPORT)
+    {
+      return 1;
+    }
+  return 0;
+}
+
+void MemGraphicPort::SetFormat(int bytes_per_pixel,
+			       UColorCode R_mask,
+			       UColorCode G_mask,
+			       UColorCode B_mask)
+{
+  _format_bytes_per_pixel = bytes_per_pixel;
+  _format_R_mask = R_mask;
+  _format_G_mask = G_mask;
+  _format_B_mask = B_mask;
+}
+
+MemGraphicPort::MemGraphicPort(const char *name, ScrCoord width, ScrCoord height,
+			       int verbose_level)
+    :GraphicPort(name, width, height, verbose_level)
+{
+  _keys   = NULL;
+  _frames = 0;
+  _bytes_per_pixel = _format_bytes_per_pixel;
+  _bits_per_pixel  = 8 * _bytes_per_pixel;
+  _bytes_per_line  = _bytes_per_pixel * _width;
+  _R_mask = _format_R_mask;
+  _G_mask = _format_G_mask;
+  _B_mask = _format_B_mask;
+
+  // Pixels are colormap indices in 8 bits mode.
+  for(int i=0; i<GP_COLORMAP_SZ; i++)
+    _colormap[i] = (ColorIndex)i;
+
+  if(!AllocateGraphMem())
+    return;
+
+  Attributes().Set(GPA_DBUFF);
+  _clip.Set(0,0,_width-1,_height-1);
+  SaveContext();
+  _tgc.Activate();
+  Clear((UColorCode)0);
+}
+
+////
+////
+//
+//   Attributes handling & destructor
+//
+////
+////
+
+MemGraphicPort::~MemGraphicPort(void)
+{
+
+  // Deletion (colorcell deallocation) requires
+  // a SetContext(). The current context is
+  // restored afterwards.
+
+  RenderContext* current = RenderContext::_current;
+  SetContext();
+
+  if(_resources.Get(MGPR_ZBUFFER))
+    FreeZBuffer();
+
+  FreeGraphMem();
+
+// Restore current rendering context.
+  if(current != NULL && current != &_tgc)
+    SwitchContext(current);
+}
+
+void MemGraphicPort::CommitAttributes(void)
+{
+  Flags changed;
+
+  changed.SetAll(_last_attributes.GetAll() ^ Attributes().GetAll());
+
+  if(changed.Get(GPA_ZBUFF))
+    ZBuffer(Attributes().Get(GPA_ZBUFF));
+}
+
+////
+////
+//
+// Graphic memory and ZBuffer
+//
+////
+////
+
+int MemGraphicPort::AllocateGraphMem(void)
+{
+  if(!(_graph_mem = new ColorIndex[_bytes_per_line * _height]))
+    {
+      (*this)[MSG_ERROR] << "could not alloc graphic memory\n";
+      _error_code = MGPE_MALLOC;
+      return 0;
+    }
+  _resources.Set(MGPR_GRAPHMEM);
+  (*this)[MSG_RESOURCE] << "Graphic memory allocated\n";
+  return 1;
+}
+
+void MemGraphicPort::FreeGraphMem(void)
+{
+  if(_resources.Get(MGPR_GRAPHMEM))
+    delete[] _graph_mem;
+  _graph_mem = NULL;
+  _resources.Reset(MGPR_GRAPHMEM);
+}
+
+int MemGraphicPort::AllocateZBuffer(void)
+{
+
+  if(_resources.Get(MGPR_ZBUFFER))
+    {
+      (*this)[MSG_WARNING] << "ZBuffer already allocated\n";
+      return 1;
+    }
+
+  if(!(_z_mem = new ZCoord[_width * _height]))
+    {
+      (*this)[MSG_ERROR] << "could not alloc ZBuffer\n";
+      _error_code = MGPE_MALLOC;
+      return 0;
+    }
+
+  _resources.Set(MGPR_ZBUFFER);
+
+  // Not fatal: without it, the fill routines test all the pixels.
+  AllocateZTiles();
+
+  (*this)[MSG_RESOURCE] << "ZBuffer allocated\n";
+  return 1;
+}
+
+void MemGraphicPort::FreeZBuffer(void)
+{
+  (*this)[MSG_RESOURCE] << "Freeing ZBuffer\n";
+
+  if(_resources.Get(MGPR_ZBUFFER))
+    delete[] _z_mem;
+  FreeZTiles();
+
+  _resources.Reset(MGPR_ZBUFFER);
+}
+
+////
+////
+//
+// High level functions
+//
+////
+////
+
+void MemGraphicPort::MapColor(const ColorIndex idx,
+			      const ColorComponent r,
+			      const ColorComponent g,
+			      const ColorComponent b )
+{
+  _colortable[idx].Set(r,g,b);
+  _colortable[idx].Stat().Set(CC_USED);
+  _truecolormap[idx] = RGB2ColorCode(r,g,b);
+}
+
+void MemGraphicPort::RGBMode(void)
+{
+  (*this)[MSG_INFO] << "Switching to RGB mode\n";
+
+  Attributes().Set(GPA_RGB);
+  Attributes().Reset(GPA_CMAP);
+}
+
+void MemGraphicPort::ColormapMode(void)
+{
+
+  (*this)[MSG_INFO] << "Switching to colormap mode\n";
+
+// default colors
+
+  MapColor(BLACK,   0,   0,   0   );
+  MapColor(RED,     255, 0,   0   );
+  MapColor(GREEN,   0,   255, 0   );
+  MapColor(YELLOW,  255, 255, 0   );
+  MapColor(BLUE,    0,   0,   255 );
+  MapColor(MAGENTA, 255, 0,   255 );
+  MapColor(CYAN,    0,   255, 255 );
+  MapColor(WHITE,   255, 255, 255 );
+
+  Attributes().Set(GPA_CMAP);
+  Attributes().Reset(GPA_RGB);
+}
+
+// A single buffer in memory, nothing to swap.
+
+int MemGraphicPort::SingleBuffer(void)
+{
+  return 1;
+}
+
+int MemGraphicPort::DoubleBuffer(void)
+{
+  return 1;
+}
+
+int MemGraphicPort::SwapBuffers(void)
+{
+  _frames++;
+  return 1;
+}
+
+void MemGraphicPort::SetKeys(const char* keys)
+{
+  _keys = keys;
+}
+
+int  MemGraphicPort::WaitEvent(void)
+{
+  return (_keys != NULL && *_keys != '\0');
+}
+
+char MemGraphicPort::GetKey(void)
+{
+  if(_keys == NULL || *_keys == '\0')
+    return 0;
+  return *(_keys++);
+}
+
+int  MemGraphicPort::GetMouse(ScrCoord *x, ScrCoord *y)
+{
+  *x = 0;
+  *y = 0;
+  return 0;
+}
+
+int MemGraphicPort::ZBuffer(const int yes)
+{
+  int result;
+  if(yes)
+    {
+	if((result = AllocateZBuffer()))
+	Attributes().Set(GPA_ZBUFF);
+    }
+  else
+    {
+      result = 1;
+      FreeZBuffer();
+      Attributes().Reset(GPA_ZBUFF);
+    }
+  return result;
+}
+
+
+int MemGraphicPort::SetGeometry(const ScrCoord width, const ScrCoord height)
+{
+  return 0;
+}
+
+uint32 MemGraphicPort::Checksum(void) const
+{
+  uint32 hash = 2166136261u;
+  const unsigned char* line_ptr = (const unsigned char*)_graph_mem;
+  int row_bytes = _width * _bytes_per_pixel;
+  for(int y=0; y<_height; y++)
+    {
+      for(int x=0; x<row_bytes; x++)
+	{
+	  hash ^= line_ptr[x];
+	  hash *= 16777619u;
+	}
+      line_ptr += _bytes_per_line;
+    }
+  return hash;
+}
+
+////
+////
+//
+// Virtual constructor stuff
+//
+////
+////
+
+
+GraphicPort* MemGraphicPort::Make(const char *name, ScrCoord width, ScrCoord height,
+				  int verb)
+{
+  MemGraphicPort *GP = new MemGraphicPort(name, width, height, verb);
+  if(GP->ErrorCode())
+    {
+      delete GP;
+      return NULL;
+    }
+  return GP;
+}
+
+// Registers MemGraphicPort::Make to the virtual constructor
+// (like init_gport_X() and init_gport_LiteX()).
+
+extern "C" {
+    void init_gport_Mem() ;
+}
+
+void init_gport_Mem() {
+    GraphicPort::Register(MemGraphicPort::Make,GP_VC_NORMAL) ;
+}
@@ -0,0 +1,128 @@
+/*
+ * This software is copyrighted as noted below.  It may be freely copied,
+ * modified, and redistributed, provided that the copyright notice is
+ * preserved on all copies.
+ *
+ * There is no warranty or other guarantee of fitness for this software,
+ * it is provided solely "as is".  Bug reports or fixes may be sent
+ * to the author, who may or may not act on them as he desires.
+ *
+ * You may not include this software in a program or other software product
+ * without supplying the source, or without informing the end-user that the
+ * source is available for no extra charge.
+ *
+ * If you modify this software, you should include a notice giving the
+ * name of the person performing the modification, the date of modification,
+ * and the reason for such modification.
+ *
+ * Author:      Bruno Levy
+ *
+ * Copyright (c) 1996-2021 Bruno Levy.
+ *
+ */
+/*
+ *
+ * Memgport.h
+ * A headless GraphicPort, that renders in memory only (no display).
+ * Used on the host to run the polygon engines without X, for
+ * regression tests and benchmarks: the pixel format is chosen with
+ * SetFormat() (any PolygonEngine can be tested), the keys with
+ * SetKeys(), and Checksum() summarizes the frame.
+ *
+ */
+
+
+#ifndef MEM_GPORT_H
+#define MEM_GPORT_H
+
+#include "gport.h"
+
+const Flag MGPR_NONE     = 0;
+const Flag MGPR_GRAPHMEM = 1;
+const Flag MGPR_ZBUFFER  = 2;
+
+const Flag MGPE_MALLOC   = 5;
+
+#include <stdlib.h>
+#include <stdio.h>
+
+class MemGraphicPort : public GraphicPort
+{
+ public:
+
+  MemGraphicPort(const char *name, ScrCoord width, ScrCoord height,
+		 int verbose_level = MSG_ENV);
+
+  virtual ~MemGraphicPort(void);
+  virtual void CommitAttributes(void);
+
+  virtual void RGBMode(void);
+  virtual void ColormapMode(void);
+
+  virtual int SingleBuffer(void);
+  virtual int DoubleBuffer(void);
+  virtual int SwapBuffers(void);
+  virtual int ZBuffer(const int yes);
+
+  virtual void MapColor(const ColorIndex i,
+			const ColorComponent r,
+			const ColorComponent g,
+			const ColorComponent b );
+
+  virtual int SetGeometry(const ScrCoord width, const ScrCoord height);
+
+  virtual char GetKey(void);
+  virtual int  GetMouse(ScrCoord *x, ScrCoord *y);
+  virtual int  WaitEvent(void);
+
+   // Cntl codes and function.
+ public:
+  static OpCode ISMEMGPORT;
+  virtual long Cntl(OpCode op, int arg);
+
+   // Specific interface
+ public:
+
+  // Pixel format of the next ports (default: 4 bytes, 0x00RRGGBB,
+  // drawn by peng_x32). With 1 byte per pixel, the colormap is the
+  // identity (pixels are colormap indices, peng_8 uses 2-2-2 RGB).
+  static void SetFormat(int bytes_per_pixel,
+			UColorCode R_mask, UColorCode G_mask, UColorCode B_mask);
+
+  // GetKey() returns the characters of keys, one per call, then 0.
+  // keys is not copied.
+  void SetKeys(const char* keys);
+
+  // Number of calls to SwapBuffers()
+  int Frames(void) const { return _frames; }
+
+  // FNV-1a hash of the pixels of the frame
+  uint32 Checksum(void) const;
+
+ protected:
+
+  // internal machinery
+  int  AllocateGraphMem(void);
+  void FreeGraphMem(void);
+
+  int  AllocateZBuffer(void);
+  void FreeZBuffer(void);
+
+  Flags       _resources;
+  const char* _keys;
+  int         _frames;
+
+  static int        _format_bytes_per_pixel;
+  static UColorCode _format_R_mask;
+  static UColorCode _format_G_mask;
+  static UColorCode _format_B_mask;
+
+  // virtual constructor stuff
+
+ public:
+  static GraphicPort* Make(const char *name, ScrCoord width, ScrCoord height,
+			   int verb = MSG_NONE);
+};
+
+
+#endif
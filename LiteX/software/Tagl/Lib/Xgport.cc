@@ -313,14 +313,10 @@ XGraphicPort::~XGraphicPort(void)
 {
 
   // Deletion (colorcell deallocation) requires
-  // a SetContext(). Before setting context, get
-  // a copy of current context.
-
-  RenderContext* current             = RenderContext::_current;   
-  RenderContext  this_graphic_bus    = _tgc;          
-  SaveContext();                                      
-  RenderContext  current_graphic_bus = _tgc;          
-  _tgc = this_graphic_bus;                            
+  // a SetContext(). The current context is
+  // restored afterwards.
+
+  RenderContext* current = RenderContext::_current;
   SetContext();
 
 
@@ -348,9 +344,8 @@ XGraphicPort::~XGraphicPort(void)
 
 
 // Restore current rendering context.
-  _tgc = current_graphic_bus;
-  RenderContext::_current = current;
-  SetContext();
+  if(current != NULL && current != &_tgc)
+    SwitchContext(current);
 }
 
 void XGraphicPort::CommitAttributes(void)
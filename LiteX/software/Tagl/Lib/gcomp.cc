@@ -62,8 +62,9 @@ ScrCoord     GraphicComponent::_width;
 ScrCoord     GraphicComponent::_height;
 ColorIndex * GraphicComponent::_graph_mem;
 ZCoord *     GraphicComponent::_z_mem;
-ColorIndex   GraphicComponent::_colormap[GP_COLORMAP_SZ];
-UColorCode   GraphicComponent::_truecolormap[GP_COLORMAP_SZ];
+ZCoord *     GraphicComponent::_z_tile;
+ColorIndex * GraphicComponent::_colormap     = NULL; // set by the
+UColorCode * GraphicComponent::_truecolormap = NULL; // GraphicPorts
 int          GraphicComponent::_bytes_per_line;
 int          GraphicComponent::_bits_per_pixel;
 int          GraphicComponent::_bytes_per_pixel;
@@ -72,6 +73,8 @@ UColorCode   GraphicComponent::_R_mask;
 UColorCode   GraphicComponent::_G_mask;
 UColorCode   GraphicComponent::_B_mask;
 ColorIndex*  GraphicComponent::_tex_mem;
+ColorIndex*  GraphicComponent::_tex_levels[G_TEX_MAX_LEVELS];
+int          GraphicComponent::_tex_nb_levels = 0;
 ColorIndex*  GraphicComponent::_tex_cmap;
 ScrCoord     GraphicComponent::_tex_size;
 UScrCoord    GraphicComponent::_tex_mask;
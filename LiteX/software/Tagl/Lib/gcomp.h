@@ -51,9 +51,13 @@ typedef int OpCode;
 
 const int G_TEXTURE_SHADES  = 32;
 const int G_TEX_SHADE_SHIFT = 3; 
+const int G_TEX_MAX_LEVELS  = 16;   // mipmap levels, up to 32768x32768
 
 // This class represents a rendering context.
 // It is used by SaveContext() and SetContext() functions.
+// The colormaps are not copied when switching: they live here, and
+// GraphicComponent::_colormap/_truecolormap point to the ones of the
+// active context.
 
 class RenderContext
 {
@@ -68,6 +72,7 @@ class RenderContext
   ScrCoord    _width, _height;
   ColorIndex *_graph_mem;
   ZCoord     *_z_mem;
+  ZCoord     *_z_tile;
   ColorIndex  _colormap[GP_COLORMAP_SZ];
   UColorCode  _truecolormap[GP_COLORMAP_SZ];
   int         _bytes_per_line;
@@ -79,6 +84,8 @@ class RenderContext
   Rect        _clip;
   int         _active;
   ColorIndex *_tex_mem;
+  ColorIndex *_tex_levels[G_TEX_MAX_LEVELS];
+  int         _tex_nb_levels;
   ColorIndex *_tex_cmap;
   ScrCoord    _tex_size;
   UScrCoord   _tex_mask;
@@ -89,6 +96,7 @@ class RenderContext
   friend class GraphicPort;
   friend class XGraphicPort;
   friend class LiteXGraphicPort;     
+  friend class MemGraphicPort;
 };
 
 
@@ -111,8 +119,9 @@ class GraphicComponent
   static ScrCoord      _width, _height;
   static ColorIndex   *_graph_mem;
   static ZCoord       *_z_mem;
-  static ColorIndex    _colormap[GP_COLORMAP_SZ];
-  static UColorCode    _truecolormap[GP_COLORMAP_SZ];
+  static ZCoord       *_z_tile;      // coarse ZBuffer, or NULL
+  static ColorIndex   *_colormap;     // [GP_COLORMAP_SZ], of the active
+  static UColorCode   *_truecolormap; // RenderContext
   static int           _bytes_per_line;
   static int           _bits_per_pixel;
   static int           _bytes_per_pixel;
@@ -121,6 +130,8 @@ class GraphicComponent
   static UColorCode    _B_mask;
   static Rect          _clip;
   static ColorIndex*   _tex_mem;
+  static ColorIndex*   _tex_levels[G_TEX_MAX_LEVELS]; // mipmaps, [0] = _tex_mem
+  static int           _tex_nb_levels;
   static ColorIndex*   _tex_cmap;
          ColorIndex    _local_tex_cmap[GP_COLORMAP_SZ * G_TEXTURE_SHADES];
   static ScrCoord      _tex_size;
@@ -48,6 +48,11 @@ typedef int32  TexCoord;       // coordinates in texture space
 typedef int32  ColorComponent; // value of R, G, or B
 typedef int32  HCoord;         // Homogenous factor
 
+// The coarse ZBuffer has one cell per ZTILE_SIZE pixels of a row, that
+// holds an upper bound of their Z values.
+const int ZTILE_SHIFT = 3;
+const int ZTILE_SIZE  = 1 << ZTILE_SHIFT;
+
 const Flag VF_NONE = 0;
 const Flag VF_CLIP = 1;
 const Flag VF_WDIV = 2;
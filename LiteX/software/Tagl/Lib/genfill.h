@@ -45,6 +45,7 @@
  * o GENFILL_PIXEL
  * o GENFILL_TEXEL
  * o GENFILL_HEAD
+ * o GENFILL_LINE             (start of each scanline, y is set)
  * o GENFILL_SCAN
  *
  * ---------- C   -----------
@@ -56,6 +57,8 @@
  *
  * o GENFILL_RGB_SHIFT
  * o GENFILL_RGB_MAX
+ * o GENFILL_RGB_PACKED       (spans: r and b in rb, g in gw, see below)
+ * o GENFILL_RGB_FRAC         | if GENFILL_RGB_PACKED
  * o GENFILL_RGB_COMBINE 
  * o GENFILL_R_SHIFT |
  * o GENFILL_G_SHIFT | if GENFILL_RGB_COMBINE
@@ -89,17 +92,37 @@ void GENFILL_NAME(GVertexAttributes *VA)
   unsigned int cw;
 #endif
 
+  // Packed spans: r in the high half of rb, b in the low half, g in gw,
+  // each with GENFILL_RGB_FRAC bits of fraction (the components, after
+  // GENFILL_RGB_SHIFT, need 16 - GENFILL_RGB_FRAC bits). One add per
+  // word and per pixel steps them, like the Bresenham steps of the 
+  // other components (dx steps from left to right). The steps are 
+  // rounded toward 0, so that each half stays between its two ends, 
+  // and never borrows from or carries into the other one.
+#ifdef GENFILL_RGB_PACKED
+  uint32 rb, gw, srb, sgw;
+#endif
+
 #ifdef GENFILL_Z
   ZCoord *z_ptr, *z_ptr0;
+  ZCoord *zt_ptr, *zt_ptr0;   // coarse ZBuffer (see ZTILE_SIZE)
+  int     zt_width = (_width + ZTILE_SIZE - 1) >> ZTILE_SHIFT;
+  int     zhidden;
+  SZCoord zstep, zmax;
+  ScrCoord xs;
 #endif
 
 #ifdef GENFILL_HEAD
   GENFILL_HEAD
 #endif
 
+  // The polygon: _p1, or the one taken from the queue by 
+  // PolygonEngine::DrainQueue()
+  GPolygon& P = *_fill_poly;
+
   // geometric attributes (always used)
   ScrCoord y,y1,y2,dy,sy;
-  ScrCoord x,x1,x2,dx,sx,ex;
+  ScrCoord x,x1,x2,dx,sx,ex,xe;
 
   // color attribute (colormap mode)       
 #ifdef GENFILL_C
@@ -128,38 +151,64 @@ void GENFILL_NAME(GVertexAttributes *VA)
   TexCoord       X,X1,X2,dX,sX,eX;
   TexCoord       Y,Y1,Y2,dY,sY,eY;
   GENFILL_TEXEL* tex_ptr; 
+
+  // Perspective correction (see PEA_PERSPECTIVE): edges and spans
+  // interpolate S = X.Q, T = Y.Q (X and Y relative to Xbase and Ybase)
+  // and Q = wmin/w (16.16) in aS, aT, aQ (<< 16). X and Y are computed
+  // every PE_PERSP_SPAN pixels (at xp) and are affine in between.
+  int            persp = _tex_persp;
+  HCoord         wmin  = 0;
+  TexCoord       Xbase, Ybase, Xn, Yn, S1, S2, T1, T2, Q1, Q2;
+  int64          aS, aT, aQ, stS, stT, stQ;
+  ScrCoord       xp, dxy;
+
+  // Mipmap level of the polygon (see GraphicPort::TextureBind()), X and
+  // Y stay in texels of the first level and are shifted by lod.
+  int            lod = 0;
+  ColorIndex*    tex_mem;
+  UScrCoord      tex_mask, tex_shift;
 #endif
 
 
-  if(_p1.Size() < 2)
+  if(P.Size() < 2)
     return;
 
    /* Get clockwise, min and max y */
 
-  for(i=0; i<_p1.Size(); i++)
+  for(i=0; i<P.Size(); i++)
      {
        int j = i+1;
-       if(j == _p1.Size())
+       if(j == P.Size())
 	 j = 0;
 
        int k = j+1;
-       if(k == _p1.Size())
+       if(k == P.Size())
 	 k = 0;
 
-       int dx1 = _p1[i]->x - _p1[j]->x;
-       int dy1 = _p1[i]->y - _p1[j]->y;
-       int dx2 = _p1[k]->x - _p1[j]->x;
-       int dy2 = _p1[k]->y - _p1[j]->y;
+       int dx1 = P[i]->x - P[j]->x;
+       int dy1 = P[i]->y - P[j]->y;
+       int dx2 = P[k]->x - P[j]->x;
+       int dy2 = P[k]->y - P[j]->y;
 	
        clock_wise += dx1 * dy2 - dx2 * dy1;
 
-       miny = MIN(miny,_p1[i]->y);
-       maxy = MAX(maxy,_p1[i]->y);
+       miny = MIN(miny,P[i]->y);
+       maxy = MAX(maxy,P[i]->y);
+
+#ifdef GENFILL_XY
+       if(persp)
+	 {
+	   if(P[i]->w <= 0)
+	     persp = 0;
+	   else if(!wmin || P[i]->w < wmin)
+	     wmin = P[i]->w;
+	 }
+#endif
 
 /*	
 #ifdef GENFILL_XY
-       _p1[i]->X &= _tex_mask;
-       _p1[i]->Y &= _tex_mask;
+       P[i]->X &= _tex_mask;
+       P[i]->Y &= _tex_mask;
 #endif
  */ 
      }
@@ -168,29 +217,57 @@ void GENFILL_NAME(GVertexAttributes *VA)
 
   if(miny == maxy)
     return;
+
+#ifdef GENFILL_XY
+  // Multiples of the texture size, so that S and T stay small
+  Xbase = P[0]->X & ~_tex_mask;
+  Ybase = P[0]->Y & ~_tex_mask;
+
+  // Level: log2 of the texels per pixel along an axis, that is half
+  // the log2 of the ratio of the areas in the texture and on the screen
+  if(_tex_nb_levels > 1)
+    {
+      int64 sarea = 0, tarea = 0;
+      for(i=0; i<P.Size(); i++)
+	{
+	  j = (i+1 == P.Size()) ? 0 : i+1;
+	  sarea += (int64)P[i]->x * P[j]->y - (int64)P[j]->x * P[i]->y;
+	  tarea += (int64)(P[i]->X - Xbase) * (P[j]->Y - Ybase) - 
+	           (int64)(P[j]->X - Xbase) * (P[i]->Y - Ybase);
+	}
+      sarea = (sarea < 0) ? -sarea : sarea;
+      tarea = (tarea < 0) ? -tarea : tarea;
+      if(sarea > 0)
+	while(lod < _tex_nb_levels - 1 && tarea >= (sarea << (2*lod + 2)))
+	  lod++;
+    }
+  tex_mem   = lod ? _tex_levels[lod] : _tex_mem;
+  tex_mask  = _tex_mask >> lod;
+  tex_shift = _tex_shift - lod;
+#endif
   
-  for(i=0; i<_p1.Size(); i++)
+  for(i=0; i<P.Size(); i++)
     {
       j = i+1;
 
-      if(j==_p1.Size())
+      if(j==P.Size())
 	j = 0;
 
 
-      if(_p1[i]->y == _p1[j]->y)
+      if(P[i]->y == P[j]->y)
 	continue;
       
       
-      y1 = _p1[i]->y;
-      y2 = _p1[j]->y;
+      y1 = P[i]->y;
+      y2 = P[j]->y;
       dy = y2 - y1;
       sy = SGN(dy);
       dy *= sy;
       y  = y1;
 
 
-      x1 = _p1[i]->x;
-      x2 = _p1[j]->x;
+      x1 = P[i]->x;
+      x2 = P[j]->x;
       dx = x2 - x1;
       sx = SGN(dx);
       dx *= sx;
@@ -199,8 +276,8 @@ void GENFILL_NAME(GVertexAttributes *VA)
 
 #ifdef GENFILL_C
 
-      c1 = MIN(_p1[i]->c,GENFILL_C_MAX) >> GENFILL_C_SHIFT;
-      c2 = MIN(_p1[j]->c,GENFILL_C_MAX) >> GENFILL_C_SHIFT;
+      c1 = MIN(P[i]->c,GENFILL_C_MAX) >> GENFILL_C_SHIFT;
+      c2 = MIN(P[j]->c,GENFILL_C_MAX) >> GENFILL_C_SHIFT;
       dc = c2 - c1;
       sc = SGN(dc);
       dc *= sc;
@@ -211,14 +288,14 @@ void GENFILL_NAME(GVertexAttributes *VA)
 
 #ifdef GENFILL_RGB
 
-      r1 = _p1[i]->r;
-      r2 = _p1[j]->r;
+      r1 = P[i]->r;
+      r2 = P[j]->r;
 
-      g1 = _p1[i]->g;
-      g2 = _p1[j]->g;
+      g1 = P[i]->g;
+      g2 = P[j]->g;
 
-      b1 = _p1[i]->b;
-      b2 = _p1[j]->b;
+      b1 = P[i]->b;
+      b2 = P[j]->b;
 
 #ifndef  GENFILL_PRECISION_OVERRIDE
 
@@ -266,8 +343,8 @@ void GENFILL_NAME(GVertexAttributes *VA)
 
 #ifdef GENFILL_A
 
-      a1 = _p1[i]->a;
-      a2 = _p1[j]->a;
+      a1 = P[i]->a;
+      a2 = P[j]->a;
       da = a2 - a1;
       sa = SGN(da);
       da *= sa;
@@ -278,8 +355,8 @@ void GENFILL_NAME(GVertexAttributes *VA)
 
 #ifdef GENFILL_Z
 
-      z1 = _p1[i]->z;
-      z2 = _p1[j]->z;
+      z1 = P[i]->z;
+      z2 = P[j]->z;
       dz = z2 - z1;
       sz = SGN(dz);
       dz *= sz;
@@ -290,16 +367,32 @@ void GENFILL_NAME(GVertexAttributes *VA)
 
 #ifdef GENFILL_XY
 
-      X1 = _p1[i]->X;
-      X2 = _p1[j]->X;
+      if(persp)
+	{
+	  Q1 = PerspQ(wmin, P[i]->w);
+	  Q2 = PerspQ(wmin, P[j]->w);
+	  S1 = ((int64)(P[i]->X - Xbase) * Q1) >> 16;
+	  S2 = ((int64)(P[j]->X - Xbase) * Q2) >> 16;
+	  T1 = ((int64)(P[i]->Y - Ybase) * Q1) >> 16;
+	  T2 = ((int64)(P[j]->Y - Ybase) * Q2) >> 16;
+	  aS  = (int64)S1 << 16;
+	  aT  = (int64)T1 << 16;
+	  aQ  = (int64)Q1 << 16;
+	  stS = ((int64)(S2 - S1) * _recip[dy]) >> (PE_RECIP_SHIFT - 16);
+	  stT = ((int64)(T2 - T1) * _recip[dy]) >> (PE_RECIP_SHIFT - 16);
+	  stQ = ((int64)(Q2 - Q1) * _recip[dy]) >> (PE_RECIP_SHIFT - 16);
+	}
+
+      X1 = P[i]->X;
+      X2 = P[j]->X;
       dX = X2 - X1;
       sX = SGN(dX);
       dX *= sX;
       eX = (dX << 1) - dy;
       X  = X1;
 
-      Y1 = _p1[i]->Y;
-      Y2 = _p1[j]->Y;
+      Y1 = P[i]->Y;
+      Y2 = P[j]->Y;
       dY = Y2 - Y1;
       sY = SGN(dY);
       dY *= sY;
@@ -330,6 +423,12 @@ void GENFILL_NAME(GVertexAttributes *VA)
 		  _mug[y]._right.z = z;
 #endif
 #ifdef GENFILL_XY
+		  if(persp)
+		    {
+		      X = (TexCoord)(aS >> 16);
+		      Y = (TexCoord)(aT >> 16);
+		      _mug[y]._right.w = (HCoord)(aQ >> 16);
+		    }
 		  _mug[y]._right.X = X;
 		  _mug[y]._right.Y = Y;
 #endif
@@ -411,6 +510,14 @@ void GENFILL_NAME(GVertexAttributes *VA)
 
 #ifdef GENFILL_XY
 
+		 if(persp)
+		   {
+		      aS += stS;
+		      aT += stT;
+		      aQ += stQ;
+		   }
+		 else
+		   {
 		 while(eX >= 0)
 		   {
 		      X += sX;
@@ -426,6 +533,7 @@ void GENFILL_NAME(GVertexAttributes *VA)
 		   }
 
 		 eY += dY << 1;
+		   }
 
 #endif
 	      }
@@ -453,6 +561,12 @@ void GENFILL_NAME(GVertexAttributes *VA)
 		 _mug[y]._left.z = z;
 #endif
 #ifdef GENFILL_XY
+		  if(persp)
+		    {
+		      X = (TexCoord)(aS >> 16);
+		      Y = (TexCoord)(aT >> 16);
+		      _mug[y]._left.w = (HCoord)(aQ >> 16);
+		    }
 		 _mug[y]._left.X = X;
 		 _mug[y]._left.Y = Y;
 #endif
@@ -534,6 +648,14 @@ void GENFILL_NAME(GVertexAttributes *VA)
 
 #ifdef GENFILL_XY
 
+		 if(persp)
+		   {
+		      aS += stS;
+		      aT += stT;
+		      aQ += stQ;
+		   }
+		 else
+		   {
 		 while(eX >= 0)
 		   {
 		      X += sX;
@@ -549,6 +671,7 @@ void GENFILL_NAME(GVertexAttributes *VA)
 		   }
 
 		 eY += dY << 1;
+		   }
 
 #endif
 	      }
@@ -561,7 +684,8 @@ void GENFILL_NAME(GVertexAttributes *VA)
   graph_ptr0 = (GENFILL_PIXEL *)(_graph_mem + miny * _bytes_per_line);
   
 #ifdef GENFILL_Z
-  z_ptr0 = _z_mem + miny * _width;
+  z_ptr0  = _z_mem + miny * _width;
+  zt_ptr0 = _z_tile ? _z_tile + miny * zt_width : NULL;
 #endif
 
   for(y=miny; y<=maxy; y++)
@@ -571,6 +695,10 @@ void GENFILL_NAME(GVertexAttributes *VA)
       dx = x2 - x1 + 1;
       x  = x1;
 
+#ifdef GENFILL_LINE
+GENFILL_LINE
+#endif
+
 #ifdef GENFILL_SCAN
 
       graph_ptr = graph_ptr0 + x1;
@@ -589,6 +717,20 @@ GENFILL_SCAN
 #endif
 
 #ifdef GENFILL_RGB
+#ifdef GENFILL_RGB_PACKED
+      // (plus one half, so that the components are rounded)
+      rb  = ((uint32)_mug[y]._left.r << (16 + GENFILL_RGB_FRAC)) |
+	    ((uint32)_mug[y]._left.b << GENFILL_RGB_FRAC);
+      rb += (1 << (16 + GENFILL_RGB_FRAC - 1)) | (1 << (GENFILL_RGB_FRAC - 1));
+      gw  = ((uint32)_mug[y]._left.g << GENFILL_RGB_FRAC) | 
+	     (1 << (GENFILL_RGB_FRAC - 1));
+      srb = ((uint32)PackedStep(_mug[y]._right.r - _mug[y]._left.r, dx, 
+				GENFILL_RGB_FRAC) << 16) +
+	     (uint32)PackedStep(_mug[y]._right.b - _mug[y]._left.b, dx, 
+				GENFILL_RGB_FRAC);
+      sgw =  (uint32)PackedStep(_mug[y]._right.g - _mug[y]._left.g, dx, 
+				GENFILL_RGB_FRAC);
+#else
       r1 = _mug[y]._left.r;
       r2 = _mug[y]._right.r;
       dr = r2 - r1;
@@ -623,6 +765,7 @@ GENFILL_SCAN
 	   (b << GENFILL_B_SHIFT);
 #endif
 
+#endif      
 #endif      
 
 #ifdef GENFILL_A
@@ -646,6 +789,26 @@ GENFILL_SCAN
 #endif
 
 #ifdef GENFILL_XY
+      if(persp)
+	{
+	  S1 = _mug[y]._left.X;
+	  S2 = _mug[y]._right.X;
+	  T1 = _mug[y]._left.Y;
+	  T2 = _mug[y]._right.Y;
+	  Q1 = _mug[y]._left.w;
+	  Q2 = _mug[y]._right.w;
+	  aS  = (int64)S1 << 16;
+	  aT  = (int64)T1 << 16;
+	  aQ  = (int64)Q1 << 16;
+	  stS = ((int64)(S2 - S1) * _recip[dx - 1]) >> (PE_RECIP_SHIFT - 16);
+	  stT = ((int64)(T2 - T1) * _recip[dx - 1]) >> (PE_RECIP_SHIFT - 16);
+	  stQ = ((int64)(Q2 - Q1) * _recip[dx - 1]) >> (PE_RECIP_SHIFT - 16);
+	  Xn  = PerspDiv(S1, Q1);
+	  Yn  = PerspDiv(T1, Q1);
+	  xp  = x1;
+	}
+      else
+	{
       X1 = _mug[y]._left.X;
       X2 = _mug[y]._right.X;
       dX = X2 - X1;
@@ -662,24 +825,80 @@ GENFILL_SCAN
       eY = (dY << 1) - dx;
       Y  = Y1; 
 /*      tex_ptr = (GENFILL_TEXEL *)_tex_mem + (Y1 << _tex_shift) + X1; */
+      dxy = dx;
+      xp  = x2 + 1;
+	}
 #endif
 
       graph_ptr = graph_ptr0 + x1;
 
 #ifdef GENFILL_Z
       z_ptr     = z_ptr0 + x1;
+      zt_ptr    = zt_ptr0 ? zt_ptr0 + (x1 >> ZTILE_SHIFT) : NULL;
+      // bounds the change of z from one pixel to the next one
+      zstep     = (zt_ptr && sz < 0 && dx > 0) ? dz / dx + 1 : 0;
 #endif
 
+      for(x=x1; x <= x2; )
+	{
 
-      for(x=x1; x <= x2; x++)
+#ifdef GENFILL_Z
+	  // The part of the span in the current cell of the coarse 
+	  // ZBuffer is hidden if its smallest z is not smaller than 
+	  // the bound of the cell (z is monotonic along the span).
+	  xs = x;
+	  xe = MIN(x | (ZTILE_SIZE - 1), x2);
+	  zhidden = zt_ptr && 
+	    (((sz < 0) ? z - (xe - x) * zstep : z) >= *zt_ptr);
+	  zmax = 0;
+#else
+	  xe = x2;
+#endif
+
+      for(; x <= xe; x++)
 	{
 
 #ifdef GENFILL_XY
-	   tex_ptr = (GENFILL_TEXEL *)_tex_mem + (( Y & _tex_mask) << _tex_shift) + ( X & _tex_mask );
+	  if(x == xp)
+	    {
+	      // Next subdivision point, affine interpolation until there
+	      dxy = MIN(PE_PERSP_SPAN, x2 - x);
+	      X   = Xn;
+	      Y   = Yn;
+	      aS += stS * dxy;
+	      aT += stT * dxy;
+	      aQ += stQ * dxy;
+	      Xn  = PerspDiv((TexCoord)(aS >> 16), (HCoord)(aQ >> 16));
+	      Yn  = PerspDiv((TexCoord)(aT >> 16), (HCoord)(aQ >> 16));
+	      dxy = MAX(dxy, 1);
+	      xp  = x + dxy;
+	      dX  = Xn - X;
+	      sX  = SGN(dX);
+	      dX *= sX;
+	      eX  = (dX << 1) - dxy;
+	      dY  = Yn - Y;
+	      sY  = SGN(dY);
+	      dY *= sY;
+	      eY  = (dY << 1) - dxy;
+	    }
+#endif
+
+#ifdef GENFILL_Z
+	  if(!zhidden)
+	    {
+#endif
+
+#ifdef GENFILL_XY
+	   tex_ptr = (GENFILL_TEXEL *)tex_mem + (((Y >> lod) & tex_mask) << tex_shift) + ((X >> lod) & tex_mask);
 #endif	   
 	   
 	  GENFILL_DO_PIXEL
 
+#ifdef GENFILL_Z
+	  zmax = MAX(zmax, *z_ptr);
+	    }
+#endif
+
 #ifdef GENFILL_C
 
 	  while(ec >= 0)
@@ -694,7 +913,12 @@ GENFILL_SCAN
 
 #ifdef GENFILL_RGB
 
-#ifdef GENFILL_RGB_COMBINE
+#if defined(GENFILL_RGB_PACKED)
+
+	  rb += srb;
+	  gw += sgw;
+
+#elif defined(GENFILL_RGB_COMBINE)
 
 	  while(er >= 0)
 	    {
@@ -776,7 +1000,7 @@ GENFILL_SCAN
 	    {
 	      X += sX; 
 /*	      tex_ptr += sX; */
-	      eX -= dx << 1;
+	      eX -= dxy << 1;
 	    }
 
 	  eX += dX << 1;
@@ -785,7 +1009,7 @@ GENFILL_SCAN
 	    {
 	      Y += sY; 
 /*	      tex_ptr += (sY << _tex_shift); */
-	      eY -= dx << 1;
+	      eY -= dxy << 1;
 	    }
 
 	  eY += dY << 1;
@@ -798,10 +1022,25 @@ GENFILL_SCAN
 #endif
 
 	}
+
+#ifdef GENFILL_Z
+	  // If all the pixels of the cell were tested, zmax is the new
+	  // bound (else the old one remains valid, Z values only decrease).
+	  if(zt_ptr)
+	    {
+	      if(!zhidden && !(xs & (ZTILE_SIZE - 1)) && 
+		 ((xe & (ZTILE_SIZE - 1)) == ZTILE_SIZE - 1))
+		*zt_ptr = zmax;
+	      zt_ptr++;
+	    }
+#endif
+	}
 #endif
       graph_ptr0 = (GENFILL_PIXEL *)(((char *)graph_ptr0) + _bytes_per_line);
 #ifdef GENFILL_Z
       z_ptr0     += _width;
+      if(zt_ptr0)
+	zt_ptr0  += zt_width;
 #endif
     }
 
@@ -843,6 +1082,14 @@ GENFILL_SCAN
 #undef GENFILL_RGB_COMBINE
 #endif
 
+#ifdef GENFILL_RGB_PACKED
+#undef GENFILL_RGB_PACKED
+#endif
+
+#ifdef GENFILL_RGB_FRAC
+#undef GENFILL_RGB_FRAC
+#endif
+
 #ifdef GENFILL_R_SHIFT
 #undef GENFILL_R_SHIFT
 #endif
@@ -879,6 +1126,10 @@ GENFILL_SCAN
 #undef GENFILL_HEAD
 #endif
 
+#ifdef GENFILL_LINE
+#undef GENFILL_LINE
+#endif
+
 #ifdef GENFILL_SCAN
 #undef GENFILL_SCAN
 #endif
@@ -95,6 +95,14 @@
 
 #define STD_RGB2W(r,g,b) RGB2W((r >> GENPE_RGB_SHIFT),(g >> GENPE_RGB_SHIFT),(b >> GENPE_RGB_SHIFT))
 
+// components of the packed Gouraud spans (see GENFILL_RGB_PACKED), with
+// 16 bits per component: 8 - GENPE_RGB_SHIFT bits of integer part.
+
+#define GENPE_RGB_FRAC   (8 + GENPE_RGB_SHIFT)
+#define PACKED_RGB2W(rb,gw) RGB2W(((rb) >> (16 + GENPE_RGB_FRAC)),          \
+                                  ((gw) >> GENPE_RGB_FRAC),                  \
+                                  (((rb) >> GENPE_RGB_FRAC) & GENPE_RGB_MASK))
+
 // get dithering treshold from x,y. 
 
 #define TRESHOLD(x,y) (D4[((x) & D_PMASK) + (((y) & D_PMASK) << D_PSHIFT)])
@@ -310,8 +318,10 @@ PolyFun GENPE_CLASS::_fillpoly_array[32] =
    
 //  ALPHA TEXTURE ZBUFFER DITHER GOURAUD RGB
 //
+// Textures are RGB: in colormap mode, the polygons are not textured.
+//
 //     0      1      0      0      0      0
-  GENPE_CLASS::FillPoly_NOP,
+  GENPE_CLASS::FillPoly_c,
 //     0      1      0      0      0      1
 #ifdef GENPE_RGB_DFORCE   
   GENPE_CLASS::FillPoly_rgb_XY_D,
@@ -319,7 +329,7 @@ PolyFun GENPE_CLASS::_fillpoly_array[32] =
   GENPE_CLASS::FillPoly_rgb_XY,   
 #endif   
 //     0      1      0      0      1      0
-  GENPE_CLASS::FillPoly_NOP,   
+  GENPE_CLASS::FillPoly_C,   
 //     0      1      0      0      1      1
 #ifdef GENPE_RGB_DFORCE   
   GENPE_CLASS::FillPoly_RGB_XY_D,
@@ -327,7 +337,7 @@ PolyFun GENPE_CLASS::_fillpoly_array[32] =
   GENPE_CLASS::FillPoly_RGB_XY,   
 #endif   
 //     0      1      0      1      0      0
-  GENPE_CLASS::FillPoly_NOP,
+  GENPE_CLASS::FillPoly_c_D,
 //     0      1      0      1      0      1
 #ifdef GENPE_RGB_DITHER
   GENPE_CLASS::FillPoly_rgb_XY_D,
@@ -335,7 +345,7 @@ PolyFun GENPE_CLASS::_fillpoly_array[32] =
   GENPE_CLASS::FillPoly_rgb_XY,   
 #endif   
 //     0      1      0      1      1      0
-  GENPE_CLASS::FillPoly_NOP,   
+  GENPE_CLASS::FillPoly_C_D,   
 //     0      1      0      1      1      1
 #ifdef GENPE_RGB_DITHER   
   GENPE_CLASS::FillPoly_RGB_XY_D,
@@ -347,7 +357,7 @@ PolyFun GENPE_CLASS::_fillpoly_array[32] =
 //  ALPHA TEXTURE ZBUFFER DITHER GOURAUD RGB
 //
 //     0      1      1      0      0      0
-  GENPE_CLASS::FillPoly_NOP,   
+  GENPE_CLASS::FillPoly_c_Z,   
 //     0      1      1      0      0      1
 #ifdef GENPE_RGB_DFORCE   
   GENPE_CLASS::FillPoly_rgb_XY_Z_D,
@@ -355,7 +365,7 @@ PolyFun GENPE_CLASS::_fillpoly_array[32] =
   GENPE_CLASS::FillPoly_rgb_XY_Z,   
 #endif   
 //     0      1      1      0      1      0
-  GENPE_CLASS::FillPoly_NOP,
+  GENPE_CLASS::FillPoly_C_Z,
 //     0      1      1      0      1      1
 #ifdef GENPE_RGB_DFORCE   
   GENPE_CLASS::FillPoly_RGB_XY_Z_D,
@@ -363,7 +373,7 @@ PolyFun GENPE_CLASS::_fillpoly_array[32] =
   GENPE_CLASS::FillPoly_RGB_XY_Z,   
 #endif   
 //     0      1      1      1      0      0
-  GENPE_CLASS::FillPoly_NOP,   
+  GENPE_CLASS::FillPoly_c_Z_D,   
 //     0      1      1      1      0      1
 #ifdef GENPE_RGB_DITHER
   GENPE_CLASS::FillPoly_rgb_XY_Z_D,
@@ -371,7 +381,7 @@ PolyFun GENPE_CLASS::_fillpoly_array[32] =
   GENPE_CLASS::FillPoly_rgb_XY_Z,   
 #endif   
 //     0      1      1      1      1      0
-  GENPE_CLASS::FillPoly_NOP,   
+  GENPE_CLASS::FillPoly_C_Z_D,   
 //     0      1      1      1      1      1
 #ifdef GENPE_RGB_DITHER   
   GENPE_CLASS::FillPoly_RGB_XY_Z_D
@@ -609,11 +619,13 @@ GENPE_CLASS::FillPoly_NOP(GVertexAttributes* attr)
 #ifndef GENPE_RGB_DFORCE
 
 #define GENFILL_RGB
+#define GENFILL_RGB_PACKED
+#define GENFILL_RGB_FRAC   GENPE_RGB_FRAC
 #define GENFILL_RGB_MAX    255
 #define GENFILL_RGB_SHIFT  GENPE_RGB_SHIFT
 #define GENFILL_NAME       GENPE_CLASS::FillPoly_RGB
 #define GENFILL_PIXEL      PixelValue
-#define GENFILL_DO_PIXEL   UColorCode cw = RGB2W(r,g,b); \
+#define GENFILL_DO_PIXEL   UColorCode cw = PACKED_RGB2W(rb,gw); \
                            *graph_ptr = GCAST(cw);
 #include "genfill.h"
 
@@ -623,15 +635,17 @@ GENPE_CLASS::FillPoly_NOP(GVertexAttributes* attr)
 
 #define GENFILL_Z
 #define GENFILL_RGB
+#define GENFILL_RGB_PACKED
+#define GENFILL_RGB_FRAC   GENPE_RGB_FRAC
 #define GENFILL_RGB_MAX    255
 #define GENFILL_RGB_SHIFT  GENPE_RGB_SHIFT
 #define GENFILL_NAME       GENPE_CLASS::FillPoly_RGB_Z
 #define GENFILL_PIXEL      PixelValue
-#define GENFILL_DO_PIXEL   if(z < *z_ptr)                      \
-                               {                               \
-                                 UColorCode cw = RGB2W(r,g,b); \
-                                 *z_ptr = z;                   \
-                                 *graph_ptr = GCAST(cw);       \
+#define GENFILL_DO_PIXEL   if(z < *z_ptr)                             \
+                               {                                      \
+                                 UColorCode cw = PACKED_RGB2W(rb,gw); \
+                                 *z_ptr = z;                          \
+                                 *graph_ptr = GCAST(cw);              \
 			       }
 #include "genfill.h"
 
@@ -683,16 +697,30 @@ GENPE_CLASS::FillPoly_NOP(GVertexAttributes* attr)
 #include "genfill.h"
 
 
+// Ordered dither, colormap modes: at the start of each scanline, the
+// row y of the dithering matrix is turned into the values used along
+// the span. For the smooth fills, drow[] holds D_MASK - treshold, so that
+// (c + drow[x & D_PMASK]) >> D_SHIFT is rounded up exactly when 
+// (c & D_MASK) > TRESHOLD(x,y), without any test. For the flat fills,
+// prow[] holds the final pixels: a single load per pixel.
+
+#define GENPE_DITHER_ROW     for(int k=0; k<=D_PMASK; k++)                     \
+                                drow[k] = D_MASK - TRESHOLD(k,y);
+
+#define GENPE_DITHER_PIXELS  for(int k=0; k<=D_PMASK; k++)                     \
+                                prow[k] = (cm > TRESHOLD(k,y)) ?               \
+                                   GCAST(_truecolormap[cw+1]) :                \
+                                   GCAST(_truecolormap[cw]);
+
 #define GENFILL_C
 #define GENFILL_C_MAX    (255 << D_SHIFT)
 #define GENFILL_C_SHIFT  0
 #define GENFILL_NAME     GENPE_CLASS::FillPoly_C_D
 #define GENFILL_PIXEL    PixelValue
-#define GENFILL_HEAD     ColorCode cw;
-#define GENFILL_DO_PIXEL cw = c >> D_SHIFT;                   \
-                         if((c & D_MASK) > TRESHOLD(x,y))     \
-                            cw++;                             \
-			 *graph_ptr = GCAST(_truecolormap[cw]);
+#define GENFILL_HEAD     ColorCode drow[D_PMASK+1];
+#define GENFILL_LINE     GENPE_DITHER_ROW
+#define GENFILL_DO_PIXEL *graph_ptr = GCAST(_truecolormap[                     \
+                            (c + drow[x & D_PMASK]) >> D_SHIFT]);
 #include "genfill.h"			 
 
 
@@ -701,12 +729,10 @@ GENPE_CLASS::FillPoly_NOP(GVertexAttributes* attr)
 #define GENFILL_HEAD     ColorCode c = VA->c;                                                \
                          c = (c > (255 << D_SHIFT)) ? (255 << D_SHIFT) : c;                  \
 			 ColorCode cw = c >> D_SHIFT;                                        \
-                         ColorCode cm = c & D_MASK;
-
-#define GENFILL_DO_PIXEL if(cm > TRESHOLD(x,y) )                     \
-			    *graph_ptr = GCAST(_truecolormap[cw+1]); \
-                         else                                        \
-			    *graph_ptr = GCAST(_truecolormap[cw]);
+                         ColorCode cm = c & D_MASK;                                          \
+                         PixelValue prow[D_PMASK+1];
+#define GENFILL_LINE     GENPE_DITHER_PIXELS
+#define GENFILL_SCAN     for(x=x1; x<=x2; x++,*(graph_ptr++) = prow[x & D_PMASK]);
 #include "genfill.h"
 
 
@@ -717,14 +743,13 @@ GENPE_CLASS::FillPoly_NOP(GVertexAttributes* attr)
 #define GENFILL_C_SHIFT  0
 #define GENFILL_NAME     GENPE_CLASS::FillPoly_C_Z_D
 #define GENFILL_PIXEL    PixelValue
-#define GENFILL_HEAD     ColorCode cw;
+#define GENFILL_HEAD     ColorCode drow[D_PMASK+1];
+#define GENFILL_LINE     GENPE_DITHER_ROW
 #define GENFILL_DO_PIXEL if(z < *z_ptr)                              \
                             {                                        \
 			      *z_ptr = z;                            \
-			      cw = c >> D_SHIFT;                     \
-                           if((c & D_MASK) > TRESHOLD(x,y) )         \
-                              cw++;                                  \
-			      *graph_ptr = GCAST(_truecolormap[cw]); \
+			      *graph_ptr = GCAST(_truecolormap[      \
+                                 (c + drow[x & D_PMASK]) >> D_SHIFT]); \
 			    }
 #include "genfill.h"
 
@@ -736,18 +761,19 @@ GENPE_CLASS::FillPoly_NOP(GVertexAttributes* attr)
 #define GENFILL_HEAD     ColorCode c = VA->c;                                \
                          c = (c > (255 << D_SHIFT)) ? (255 << D_SHIFT) : c;  \
 			 ColorCode cw = c >> D_SHIFT;                        \
-                         ColorCode cm = c & D_MASK;
-
+                         ColorCode cm = c & D_MASK;                          \
+                         PixelValue prow[D_PMASK+1];
+#define GENFILL_LINE     GENPE_DITHER_PIXELS
 #define GENFILL_DO_PIXEL if(z < *z_ptr)                               \
                          {                                            \
 			   *z_ptr = z;                                \
-                         if(cm > TRESHOLD(x,y))                       \
-			    *graph_ptr = GCAST(_truecolormap[cw+1]);  \
-                         else                                         \
-			    *graph_ptr = GCAST(_truecolormap[cw]);    \
+			   *graph_ptr = prow[x & D_PMASK];            \
 		         }
 #include "genfill.h"
 
+#undef GENPE_DITHER_ROW
+#undef GENPE_DITHER_PIXELS
+
 
 #ifdef GENPE_RGB_DITHER
 
@@ -132,6 +132,7 @@ class GeometryManager : public GraphicProcessor
   virtual void Viewport(ScrCoord left, ScrCoord right, 
 			ScrCoord bottom, ScrCoord top) = 0;
 
+  // PopViewport() restores the viewport and the ScreenMask.
   virtual void PushViewport(void) = 0;
   virtual void PopViewport(void)  = 0;
 
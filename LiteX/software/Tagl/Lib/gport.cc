@@ -37,6 +37,11 @@
 
 GraphicPort::~GraphicPort(void)
 {
+  if(ContextIsActive())
+    {
+      _colormap     = NULL;
+      _truecolormap = NULL;
+    }
 }
 
 
@@ -129,7 +134,10 @@ void GraphicPort::Clear(UColorCode x)
 void GraphicPort::ZClear(void)
 {
   if(Attributes().Get(GPA_ZBUFF))
-    memset(_z_mem, 255, _width * _height * sizeof(ZCoord));
+    {
+      memset(_z_mem, 255, _width * _height * sizeof(ZCoord));
+      ZTileReset(0xffff);
+    }
 }
 
 void GraphicPort::ZClear(ZCoord z)
@@ -138,6 +146,39 @@ void GraphicPort::ZClear(ZCoord z)
   int size = _width * _height;
   for(z_ptr = _z_mem; size > 0; size--)
     *(z_ptr++) = z;
+  ZTileReset(z);
+}
+
+int GraphicPort::AllocateZTiles(void)
+{
+  if(_z_tile)
+    return 1;
+
+  int size = ((_width + ZTILE_SIZE - 1) >> ZTILE_SHIFT) * _height;
+  if(!(_z_tile = new ZCoord[size]))
+    {
+      (*this)[MSG_WARNING] << "could not alloc coarse ZBuffer\n";
+      return 0;
+    }
+  ZTileReset(0xffff);
+  return 1;
+}
+
+void GraphicPort::FreeZTiles(void)
+{
+  delete[] _z_tile;
+  _z_tile = NULL;
+}
+
+void GraphicPort::ZTileReset(ZCoord z)
+{
+  if(!_z_tile)
+    return;
+
+  ZCoord *z_ptr;
+  int size = ((_width + ZTILE_SIZE - 1) >> ZTILE_SHIFT) * _height;
+  for(z_ptr = _z_tile; size > 0; size--)
+    *(z_ptr++) = z;
 }
 
 
@@ -375,6 +416,25 @@ GraphicPort::TextureBind(UColorCode* texture, ScrCoord size)
    _tex_size  = size;
    _tex_shift = firstbit(size);
    _tex_mask  = size - 1;
+   _tex_levels[0] = _tex_mem;
+   _tex_nb_levels = 1;
+}
+
+void         
+GraphicPort::TextureBind(UColorCode** levels, ScrCoord size, int nb_levels)
+{
+   TextureBind(levels[0], size);
+   if(_tex_mem != (ColorIndex*)levels[0])
+     return;
+   
+   if(nb_levels > G_TEX_MAX_LEVELS)
+     nb_levels = G_TEX_MAX_LEVELS;
+   if(nb_levels > _tex_shift + 1)
+     nb_levels = _tex_shift + 1;
+   
+   for(int i=1; i<nb_levels; i++)
+     _tex_levels[i] = (ColorIndex*)levels[i];
+   _tex_nb_levels = nb_levels;
 }
 
 inline 
@@ -450,46 +510,75 @@ void
 GraphicPort::SetContext()
 {
   if(!ContextIsActive())
-    {
-      _width            = _tgc._width;
-      _height           = _tgc._height; 
-      _graph_mem        = _tgc._graph_mem;
-      _z_mem            = _tgc._z_mem;
-      memcpy(_colormap,     _tgc._colormap,     sizeof(_colormap));
-      memcpy(_truecolormap, _tgc._truecolormap, sizeof(_truecolormap));
-      _bytes_per_line   = _tgc._bytes_per_line;
-      _bytes_per_pixel  = _tgc._bytes_per_pixel;
-      _R_mask           = _tgc._R_mask;
-      _G_mask           = _tgc._G_mask;
-      _B_mask           = _tgc._B_mask;
-      _clip             = _tgc._clip;
-      _tex_mem          = _tgc._tex_mem;
-      _tex_cmap         = _tgc._tex_cmap; 
-      _tex_size         = _tgc._tex_size;
-      _tex_mask         = _tgc._tex_mask;
-      _tex_shift        = _tgc._tex_shift; 
-      _tgc.Activate();
-    }
+    SwitchContext(&_tgc);
 }
 
 void 
 GraphicPort::SaveContext()
 {
-  _tgc._width            = _width;
-  _tgc._height           = _height; 
-  _tgc._graph_mem        = _graph_mem;
-  _tgc._z_mem            = _z_mem;
-  memcpy(_tgc._colormap,     _colormap,     sizeof(_colormap));
-  memcpy(_tgc._truecolormap, _truecolormap, sizeof(_truecolormap));
-  _tgc._bytes_per_line   = _bytes_per_line;
-  _tgc._bytes_per_pixel  = _bytes_per_pixel;
-  _tgc._R_mask           = _R_mask;
-  _tgc._G_mask           = _G_mask;
-  _tgc._B_mask           = _B_mask;
-  _tgc._clip             = _clip;
-  _tgc._tex_mem          = _tex_mem;
-  _tgc._tex_cmap         = _tex_cmap;
-  _tgc._tex_size         = _tex_size;
-  _tgc._tex_mask         = _tex_mask;
-  _tgc._tex_shift        = _tex_shift;
+  StoreContext(&_tgc);
+}
+
+// Saves the state of the active context, and loads ctx. The colormaps
+// are not copied, they stay in the RenderContext.
+
+void 
+GraphicPort::SwitchContext(RenderContext* ctx)
+{
+  if(ctx == RenderContext::_current)
+    return;
+  StoreContext(RenderContext::_current);
+  _width            = ctx->_width;
+  _height           = ctx->_height; 
+  _graph_mem        = ctx->_graph_mem;
+  _z_mem            = ctx->_z_mem;
+  _z_tile           = ctx->_z_tile;
+  _colormap         = ctx->_colormap;
+  _truecolormap     = ctx->_truecolormap;
+  _bytes_per_line   = ctx->_bytes_per_line;
+  _bits_per_pixel   = ctx->_bits_per_pixel;
+  _bytes_per_pixel  = ctx->_bytes_per_pixel;
+  _R_mask           = ctx->_R_mask;
+  _G_mask           = ctx->_G_mask;
+  _B_mask           = ctx->_B_mask;
+  _clip             = ctx->_clip;
+  _tex_mem          = ctx->_tex_mem;
+  _tex_nb_levels    = ctx->_tex_nb_levels;
+  for(int i=0; i<_tex_nb_levels; i++)
+    _tex_levels[i]  = ctx->_tex_levels[i];
+  _tex_cmap         = ctx->_tex_cmap; 
+  _tex_size         = ctx->_tex_size;
+  _tex_mask         = ctx->_tex_mask;
+  _tex_shift        = ctx->_tex_shift; 
+  ctx->Activate();
+}
+
+// The statics hold the state of the active context (a GraphicPort
+// activates its context as soon as it is constructed).
+
+void 
+GraphicPort::StoreContext(RenderContext* ctx)
+{
+  if(ctx == NULL)
+    return;
+  ctx->_width            = _width;
+  ctx->_height           = _height; 
+  ctx->_graph_mem        = _graph_mem;
+  ctx->_z_mem            = _z_mem;
+  ctx->_z_tile           = _z_tile;
+  ctx->_bytes_per_line   = _bytes_per_line;
+  ctx->_bits_per_pixel   = _bits_per_pixel;
+  ctx->_bytes_per_pixel  = _bytes_per_pixel;
+  ctx->_R_mask           = _R_mask;
+  ctx->_G_mask           = _G_mask;
+  ctx->_B_mask           = _B_mask;
+  ctx->_clip             = _clip;
+  ctx->_tex_mem          = _tex_mem;
+  ctx->_tex_nb_levels    = _tex_nb_levels;
+  for(int i=0; i<_tex_nb_levels; i++)
+    ctx->_tex_levels[i]  = _tex_levels[i];
+  ctx->_tex_cmap         = _tex_cmap;
+  ctx->_tex_size         = _tex_size;
+  ctx->_tex_mask         = _tex_mask;
+  ctx->_tex_shift        = _tex_shift;
 }
@@ -138,6 +138,12 @@ class GraphicPort: public GraphicComponent
   virtual void ZClear(void);
   virtual void ZClear(ZCoord z);
 
+  //  The coarse ZBuffer (if the port has one) lets the polygon fill
+  // routines skip the parts of the spans that are hidden. It remains
+  // valid as long as Z values are only replaced by smaller ones.
+  // Code that writes in ZMem() otherwise calls ZTileReset() after.
+  void         ZTileReset(ZCoord z = 0xffff);
+
   //  These two functions convert a color from its RGB form
   // to a value that represent how it is coded in graph mem.
   //  The second form performs dithering. 
@@ -158,6 +164,11 @@ class GraphicPort: public GraphicComponent
    
 
   void         TextureBind(UColorCode* texture, ScrCoord size);
+
+  //  Mipmapped texture: levels[i] is the (size >> i) x (size >> i) 
+  // level i (levels[0] the texture). The polygon fills pick the level 
+  // of each polygon from its number of texels per pixel.
+  void         TextureBind(UColorCode** levels, ScrCoord size, int nb_levels);
    
  protected:
 
@@ -170,6 +181,9 @@ class GraphicPort: public GraphicComponent
 
   virtual void Clear(UColorCode x);
 
+  int          AllocateZTiles(void);
+  void         FreeZTiles(void);
+
   const char       *_name;
   ColorCell   _colortable[GP_COLORMAP_SZ];
   int         _error_code;
@@ -189,7 +203,11 @@ class GraphicPort: public GraphicComponent
 
   friend class Stub;
 
-// Context handling
+// Context handling.
+// SetContext() makes this port the target of the PolygonEngines (the
+// state of the previous one is saved in its context, the colormaps are
+// switched by pointer), so that several ports can be drawn in the
+// same frame.
 
  public:
   void SetContext();
@@ -197,6 +215,9 @@ class GraphicPort: public GraphicComponent
   int  ContextIsActive();
 
  protected:
+  static void SwitchContext(RenderContext* ctx);
+  static void StoreContext(RenderContext* ctx);
+
   RenderContext _tgc;
 };
 
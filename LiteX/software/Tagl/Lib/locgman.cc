@@ -241,23 +241,22 @@ LocalGeometryManager::Vertex(gfloat x, gfloat y, gfloat z)
 	v->project_position.mld(v->modelview_position,_project_viewport);
      }
 
-  if(Attributes().Get(GA_HCLIP))
-    {
+  *(GVertexAttributes *)v = VAttributes();
+
+  // Also used by perspective correct texture mapping (PEA_PERSPECTIVE)
 #ifdef GINT
-      v->w = (HCoord)(v->project_position(3).data());
+  v->w = (HCoord)(v->project_position(3).data());
 #else
-      v->w = (HCoord)(v->project_position(3).data() * (ginternal)(1 << GCOORD_SHIFT));
+  v->w = (HCoord)(v->project_position(3).data() * (ginternal)(1 << GCOORD_SHIFT));
 #endif      
-    }
-  else
+
+  if(!Attributes().Get(GA_HCLIP))
     {
       v->project_position(0).div(v->project_position(3));
       v->project_position(1).div(v->project_position(3));
       v->project_position(2).div(v->project_position(3));
     }
 
-  *(GVertexAttributes *)v = VAttributes();
-
   v->project_position(0).sto(v->x);
   v->project_position(1).sto(v->y);
   v->project_position(2).sto(v->z);
@@ -374,23 +373,22 @@ LocalGeometryManager::Vertex(GCoord x, GCoord y, GCoord z)
 	v->project_position.mld(v->modelview_position,_project_viewport);
      }
 
-  if(Attributes().Get(GA_HCLIP))
-    {
+  *(GVertexAttributes *)v = VAttributes();
+
+  // Also used by perspective correct texture mapping (PEA_PERSPECTIVE)
 #ifdef GINT
-      v->w = (HCoord)(v->project_position(3).data());
+  v->w = (HCoord)(v->project_position(3).data());
 #else
-      v->w = (HCoord)(v->project_position(3).data() * (ginternal)(1 << GCOORD_SHIFT));
+  v->w = (HCoord)(v->project_position(3).data() * (ginternal)(1 << GCOORD_SHIFT));
 #endif      
-    }
-  else
+
+  if(!Attributes().Get(GA_HCLIP))
     {
       v->project_position(0).div(v->project_position(3));
       v->project_position(1).div(v->project_position(3));
       v->project_position(2).div(v->project_position(3));
     }
 
-  *(GVertexAttributes *)v = VAttributes();
-
   v->project_position(0).sto(v->x);
   v->project_position(1).sto(v->y);
   v->project_position(2).sto(v->z);
@@ -514,6 +512,9 @@ LocalGeometryManager::CommitAttributes(void)
 
   changed.SetAll(_last_attributes.GetAll() ^ Attributes().GetAll());
 
+  if(changed.GetAll())
+    QueueFence();
+
   if(changed.Get(GA_RGB))
     {
       if(Attributes().Get(GA_RGB))
@@ -545,18 +546,21 @@ LocalGeometryManager::CommitAttributes(void)
 void 
 LocalGeometryManager::Clear()
 {
+  QueueFence();
   _graphic_port->Clear(BLACK);
 }
  
 void 
 LocalGeometryManager::ZClear(void)
 {
+  QueueFence();
   _graphic_port->ZClear();
 }
  
 void 
 LocalGeometryManager::ZClear(ZCoord z)
 {
+  QueueFence();
   _graphic_port->ZClear(z);
 }
 
@@ -575,6 +579,7 @@ LocalGeometryManager::DoubleBuffer(void)
 int  
 LocalGeometryManager::SwapBuffers(void)
 {
+  QueueFence();
   return _graphic_port->SwapBuffers();
 }
 
@@ -584,6 +589,7 @@ LocalGeometryManager::MapColor(const ColorIndex i,
 			       const ColorComponent g, 
 			       const ColorComponent b )
 {
+  QueueFence();
   _graphic_port->MapColor(i,r,g,b);
 }
 
@@ -672,6 +678,8 @@ LocalGeometryManager::Perspective(gAngle _fov, gfloat _aspect,
    GetProject().LoadPerspective(_fov, _aspect, _near, _far);
    CommitViewport();
    CommitSingle();   
+   _polygon_engine->Attributes().Set(PEA_PERSPECTIVE);
+   _polygon_engine->CommitAttributes();
 }
 
 void 
@@ -681,6 +689,9 @@ LocalGeometryManager::Ortho(gfloat _left, gfloat _right, gfloat _bottom,
    GetProject().LoadOrtho(_left, _right, _bottom, _top, _near, _far);
    CommitViewport();
    CommitSingle();   
+   // w is constant, affine texture mapping is exact
+   _polygon_engine->Attributes().Reset(PEA_PERSPECTIVE);
+   _polygon_engine->CommitAttributes();
 }
 
 
@@ -888,6 +899,7 @@ LocalGeometryManager::PushViewport(void)
 #ifdef EBUG
   assert(_stack_viewport_idx < (ATTRIB_STACK_SZ - 1));
 #endif
+  _stack_mask[_stack_viewport_idx] = _graphic_port->Clip();
   _stack_viewport_idx++;
   _stack_viewport[_stack_viewport_idx] = 
     _stack_viewport[_stack_viewport_idx - 1];
@@ -900,6 +912,7 @@ LocalGeometryManager::PopViewport(void)
   assert(_stack_viewport_idx > 0);
 #endif
   _stack_viewport_idx--;
+  _graphic_port->Clip() = _stack_mask[_stack_viewport_idx];
   CommitViewport();
   CommitSingle();   
 }
@@ -165,6 +165,14 @@ class LocalGeometryManager : public GeometryManager
   virtual void PolygonMode(gpmode mode);
   virtual void CullingMode(gcmode mode);
 
+  // Polygon queue (see PolygonEngine::BeginQueue()). Clear(), ZClear(),
+  // SwapBuffers(), MapColor() and CommitAttributes() wait for the queued
+  // polygons before they change the frame.
+
+  int  BeginQueue(void);
+  void EndQueue(void);
+  void QueueConsumer(int yes = 1);
+
  protected:
 
   GMatrix& GetModelView(void);
@@ -185,6 +193,8 @@ class LocalGeometryManager : public GeometryManager
   void DoClosedLine(void);
   void DoPolygon(void);
 
+  void QueueFence(void);
+
  private:
   
   Flags          _resources;
@@ -198,7 +208,8 @@ class LocalGeometryManager : public GeometryManager
   int            _stack_modelview_idx;
 
   Rect           _stack_viewport[ATTRIB_STACK_SZ];
-  int            _stack_viewport_idx;
+  Rect           _stack_mask[ATTRIB_STACK_SZ];  // ScreenMask, saved by
+  int            _stack_viewport_idx;           // PushViewport()
 
   GMatrix        _stack_single[ATTRIB_STACK_SZ];
   int            _stack_single_idx; 
@@ -0,0 +1,646 @@
+/*
+ * This software is copyrighted as noted below.  It may be freely copied,
+ * modified, and redistributed, provided that the copyright notice is
+ * preserved on all copies.
+ *
+ * There is no warranty or other guarantee of fitness for this software,
+ * it is provided solely "as is".  Bug reports or fixes may be sent
+ * to the author, who may or may not act on them as he desires.
+ *
+ * You may not include this software in a program or other software product
+ * without supplying the source, or without informing the end-user that the
+ * source is available for no extra charge.
+ *
+ * If you modify this software, you should include a notice giving the
+ * name of the person performing the modification, the date of modification,
+ * and the reason for such modification.
+ *
+ * Author:      Bruno Levy
+ *
+ * Copyright (c) 1996, Bruno Levy.
+ *
+ */
+/*
+ *
+ * macgman.cc
+ *
+ */
+
+#include "macgman.h"
+#include <string.h>
+
+// Opcodes, followed by their arguments in the list
+
+const gint MGC_BEGIN       = 0;   // mode
+const gint MGC_END         = 1;
+const gint MGC_VERTEX      = 2;   // x y z
+const gint MGC_NORMAL      = 3;   // x y z
+const gint MGC_COLOR_RGB   = 4;   // r g b (gfloat)
+const gint MGC_COLOR_IRGB  = 5;   // r g b (gint)
+const gint MGC_COLOR       = 6;   // c (gfloat)
+const gint MGC_COLOR_I     = 7;   // c (gint)
+const gint MGC_MATRIXMODE  = 8;   // mode
+const gint MGC_PUSHMATRIX  = 9;
+const gint MGC_POPMATRIX   = 10;
+const gint MGC_IDENTITY    = 11;
+const gint MGC_POLARVIEW   = 12;  // dist azim inc twist
+const gint MGC_LOOKAT      = 13;  // vx vy vz px py pz
+const gint MGC_LOOKAT_T    = 14;  // vx vy vz px py pz twist
+const gint MGC_TRANSLATE   = 15;  // x y z
+const gint MGC_ROTATE      = 16;  // r axis
+const gint MGC_SCALE       = 17;  // sx sy sz
+const gint MGC_LOADMATRIX  = 18;  // 16 coefficients, by rows
+const gint MGC_MULTMATRIX  = 19;  // 16 coefficients, by rows
+const gint MGC_POLYGONMODE = 20;  // mode
+const gint MGC_CULLINGMODE = 21;  // mode
+
+
+MacroGeometryManager::MacroGeometryManager(int verbose_level)
+{
+  Verbose(verbose_level);
+
+  _proc_name  = "MacroGeometryManager";
+
+  _error_code = MGE_OK;
+
+  _list       = NULL;
+  _size       = 0;
+  _max_size   = 0;
+
+  _light      = 0;
+  _has_rgb    = 0;
+  _has_c      = 0;
+
+  if(!Grow(MG_LIST_SZ))
+    (*this)[MSG_ERROR] << "could not alloc list\n";
+}
+
+MacroGeometryManager::~MacroGeometryManager(void)
+{
+  delete[] _list;
+}
+
+int
+MacroGeometryManager::Grow(int n)
+{
+  int max_size = _max_size ? 2 * _max_size : MG_LIST_SZ;
+  while(max_size < _size + n)
+    max_size *= 2;
+
+  MGWord* list = new MGWord[max_size];
+  if(!list)
+    {
+      _error_code = MGE_MALLOC;
+      return 0;
+    }
+  if(_list)
+    {
+      memcpy(list, _list, _size * sizeof(MGWord));
+      delete[] _list;
+    }
+  _list     = list;
+  _max_size = max_size;
+  return 1;
+}
+
+void
+MacroGeometryManager::Reset(void)
+{
+  _size       = 0;
+  _error_code = MGE_OK;
+  _has_rgb    = 0;
+  _has_c      = 0;
+}
+
+void
+MacroGeometryManager::NotRecorded(const char *what)
+{
+  (*this)[MSG_ERROR] << what << " -- cannot be recorded\n";
+  _error_code = MGE_RECORD;
+}
+
+Flag
+MacroGeometryManager::ErrorCode(void)
+{
+  return _error_code;
+}
+
+
+// Static lighting
+
+void
+MacroGeometryManager::Light(gfloat lx, gfloat ly, gfloat lz, 
+			    gfloat ambient, gfloat diffuse)
+{
+  gfloat l = sqrt(lx*lx + ly*ly + lz*lz);
+  if(l == 0.0)
+    {
+      LightOff();
+      return;
+    }
+  _lx = lx / l;
+  _ly = ly / l;
+  _lz = lz / l;
+  _ambient = ambient;
+  _diffuse = diffuse;
+  _light   = 1;
+}
+
+void
+MacroGeometryManager::LightOff(void)
+{
+  _light = 0;
+}
+
+gfloat
+MacroGeometryManager::Shade(gfloat x, gfloat y, gfloat z)
+{
+  gfloat l = sqrt(x*x + y*y + z*z);
+  gfloat d = (l == 0.0) ? 0.0 : (x*_lx + y*_ly + z*_lz) / l;
+  if(d < 0.0)
+    d = 0.0;
+  return _ambient + _diffuse * d;
+}
+
+
+// Playback: one pass on the list
+
+int 
+MacroGeometryManager::Playback(GeometryManager *output)
+{
+  MGWord* w   = _list;
+  MGWord* end = _list + _size;
+  GMatrix M;
+  int i,j;
+
+  while(w < end)
+    switch((w++)->i)
+      {
+      case MGC_VERTEX:
+	output->Vertex(w[0].f, w[1].f, w[2].f);
+	w += 3;
+	break;
+      case MGC_NORMAL:
+	output->Normal(w[0].f, w[1].f, w[2].f);
+	w += 3;
+	break;
+      case MGC_COLOR_RGB:
+	output->Color(w[0].f, w[1].f, w[2].f);
+	w += 3;
+	break;
+      case MGC_COLOR_IRGB:
+	output->Color(w[0].i, w[1].i, w[2].i);
+	w += 3;
+	break;
+      case MGC_COLOR:
+	output->Color(w[0].f);
+	w++;
+	break;
+      case MGC_COLOR_I:
+	output->Color(w[0].i);
+	w++;
+	break;
+      case MGC_BEGIN:
+	output->Begin(w[0].i);
+	w++;
+	break;
+      case MGC_END:
+	output->End();
+	break;
+      case MGC_MATRIXMODE:
+	output->MatrixMode(w[0].i);
+	w++;
+	break;
+      case MGC_PUSHMATRIX:
+	output->PushMatrix();
+	break;
+      case MGC_POPMATRIX:
+	output->PopMatrix();
+	break;
+      case MGC_IDENTITY:
+	output->Identity();
+	break;
+      case MGC_POLARVIEW:
+	output->PolarView(w[0].f, w[1].i, w[2].i, w[3].i);
+	w += 4;
+	break;
+      case MGC_LOOKAT:
+	output->LookAt(w[0].f, w[1].f, w[2].f, w[3].f, w[4].f, w[5].f);
+	w += 6;
+	break;
+      case MGC_LOOKAT_T:
+	output->LookAt(w[0].f, w[1].f, w[2].f, w[3].f, w[4].f, w[5].f, 
+		       w[6].i);
+	w += 7;
+	break;
+      case MGC_TRANSLATE:
+	output->Translate(w[0].f, w[1].f, w[2].f);
+	w += 3;
+	break;
+      case MGC_ROTATE:
+	output->Rotate(w[0].i, (char)w[1].i);
+	w += 2;
+	break;
+      case MGC_SCALE:
+	output->Scale(w[0].f, w[1].f, w[2].f);
+	w += 3;
+	break;
+      case MGC_LOADMATRIX:
+      case MGC_MULTMATRIX:
+	for(i=0; i<4; i++)
+	  for(j=0; j<4; j++)
+	    M(i,j).lod(w[4*i+j].f);
+	if(w[-1].i == MGC_LOADMATRIX)
+	  output->LoadMatrix(M);
+	else
+	  output->MultMatrix(M);
+	w += 16;
+	break;
+      case MGC_POLYGONMODE:
+	output->PolygonMode(w[0].i);
+	w++;
+	break;
+      case MGC_CULLINGMODE:
+	output->CullingMode(w[0].i);
+	w++;
+	break;
+      default:
+	(*this)[MSG_ERROR] << "invalid opcode\n";
+	return 0;
+      }
+
+  return 1;
+}
+
+
+// Begin-End
+
+void
+MacroGeometryManager::Begin(gbemode mode)
+{
+  MGWord* w = Record(MGC_BEGIN, 1);
+  if(w)
+    w[0].i = mode;
+}
+
+void
+MacroGeometryManager::End(void)
+{
+  Record(MGC_END, 0);
+}
+
+void 
+MacroGeometryManager::Vertex(gfloat x, gfloat y, gfloat z)
+{
+  MGWord* w = Record(MGC_VERTEX, 3);
+  if(w)
+    {
+      w[0].f = x;
+      w[1].f = y;
+      w[2].f = z;
+    }
+}
+
+void 
+MacroGeometryManager::Vertex(GCoord x, GCoord y, GCoord z)
+{
+  Vertex(x.fget(), y.fget(), z.fget());
+}
+
+void 
+MacroGeometryManager::Normal(gfloat x, gfloat y, gfloat z)
+{
+  MGWord* w;
+
+  if(!_light)
+    {
+      if((w = Record(MGC_NORMAL, 3)))
+	{
+	  w[0].f = x;
+	  w[1].f = y;
+	  w[2].f = z;
+	}
+      return;
+    }
+
+  // Static light: the lit color replaces the normal
+
+  gfloat s = Shade(x,y,z);
+
+  if(_has_rgb && (w = Record(MGC_COLOR_RGB, 3)))
+    {
+      w[0].f = _r * s;
+      w[1].f = _g * s;
+      w[2].f = _b * s;
+    }
+
+  if(_has_c && (w = Record(MGC_COLOR, 1)))
+    w[0].f = _c * s;
+}
+ 
+void 
+MacroGeometryManager::Color(gfloat r, gfloat g, gfloat b)
+{
+  MGWord* w = Record(MGC_COLOR_RGB, 3);
+  if(w)
+    {
+      w[0].f = r;
+      w[1].f = g;
+      w[2].f = b;
+    }
+  _r = r; _g = g; _b = b;
+  _has_rgb = 1;
+}
+
+void 
+MacroGeometryManager::Color(gint r, gint g, gint b)
+{
+  MGWord* w = Record(MGC_COLOR_IRGB, 3);
+  if(w)
+    {
+      w[0].i = r;
+      w[1].i = g;
+      w[2].i = b;
+    }
+  _r = (gfloat)r; _g = (gfloat)g; _b = (gfloat)b;
+  _has_rgb = 1;
+}
+
+void 
+MacroGeometryManager::Color(gfloat c)
+{
+  MGWord* w = Record(MGC_COLOR, 1);
+  if(w)
+    w[0].f = c;
+  _c = c;
+  _has_c = 1;
+}
+
+void
+MacroGeometryManager::Color(gint c)
+{
+  MGWord* w = Record(MGC_COLOR_I, 1);
+  if(w)
+    w[0].i = c;
+  _c = (gfloat)c;
+  _has_c = 1;
+}
+
+
+// Graphic Port, Viewport and Projections
+
+void 
+MacroGeometryManager::Clear()
+{
+  NotRecorded("Clear()");
+}
+ 
+void 
+MacroGeometryManager::ZClear(void)
+{
+  NotRecorded("ZClear()");
+}
+ 
+void 
+MacroGeometryManager::ZClear(ZCoord z)
+{
+  NotRecorded("ZClear()");
+}
+
+int  
+MacroGeometryManager::SingleBuffer(void)
+{
+  NotRecorded("SingleBuffer()");
+  return 0;
+}
+
+int  
+MacroGeometryManager::DoubleBuffer(void)
+{
+  NotRecorded("DoubleBuffer()");
+  return 0;
+}
+
+int  
+MacroGeometryManager::SwapBuffers(void)
+{
+  NotRecorded("SwapBuffers()");
+  return 0;
+}
+
+void 
+MacroGeometryManager::MapColor(const ColorIndex i, 
+			       const ColorComponent r, 
+			       const ColorComponent g, 
+			       const ColorComponent b )
+{
+  NotRecorded("MapColor()");
+}
+
+void 
+MacroGeometryManager::Viewport(ScrCoord left, ScrCoord right, 
+			       ScrCoord bottom, ScrCoord top)
+{
+  NotRecorded("Viewport()");
+}
+
+void 
+MacroGeometryManager::PushViewport(void)
+{
+  NotRecorded("PushViewport()");
+}
+
+void 
+MacroGeometryManager::PopViewport(void)
+{
+  NotRecorded("PopViewport()");
+}
+
+void 
+MacroGeometryManager::ScreenMask(ScrCoord left, ScrCoord right, 
+				 ScrCoord bottom, ScrCoord top)
+{
+  NotRecorded("ScreenMask()");
+}
+
+void 
+MacroGeometryManager::SetDepth(ZCoord _near, ZCoord _far)
+{
+  NotRecorded("SetDepth()");
+}
+
+void 
+MacroGeometryManager::Perspective(gAngle _fov, gfloat _aspect, 
+				  gfloat _near, gfloat _far)
+{
+  NotRecorded("Perspective()");
+}
+
+void 
+MacroGeometryManager::Ortho(gfloat _left, gfloat _right, 
+			    gfloat _bottom, gfloat _top, 
+			    gfloat _near, gfloat _far)
+{
+  NotRecorded("Ortho()");
+}
+
+
+// Matrix Management
+
+void 
+MacroGeometryManager::MatrixMode(gmmode mode)
+{
+  MGWord* w = Record(MGC_MATRIXMODE, 1);
+  if(w)
+    w[0].i = mode;
+}
+
+void 
+MacroGeometryManager::PushMatrix(void)
+{
+  Record(MGC_PUSHMATRIX, 0);
+}
+
+void 
+MacroGeometryManager::PopMatrix(void)
+{
+  Record(MGC_POPMATRIX, 0);
+}
+
+void 
+MacroGeometryManager::Identity(void)
+{
+  Record(MGC_IDENTITY, 0);
+}
+
+
+// Viewing
+
+void 
+MacroGeometryManager::PolarView(gfloat dist, gAngle azim, 
+				gAngle inc, gAngle twist)
+{
+  MGWord* w = Record(MGC_POLARVIEW, 4);
+  if(w)
+    {
+      w[0].f = dist;
+      w[1].i = azim;
+      w[2].i = inc;
+      w[3].i = twist;
+    }
+}
+
+void 
+MacroGeometryManager::LookAt(gfloat vx, gfloat vy, gfloat vz,
+			     gfloat px, gfloat py, gfloat pz)
+{
+  MGWord* w = Record(MGC_LOOKAT, 6);
+  if(w)
+    {
+      w[0].f = vx; w[1].f = vy; w[2].f = vz;
+      w[3].f = px; w[4].f = py; w[5].f = pz;
+    }
+}
+
+void 
+MacroGeometryManager::LookAt(gfloat vx, gfloat vy, gfloat vz,
+			     gfloat px, gfloat py, gfloat pz, 
+			     gAngle twist)
+{
+  MGWord* w = Record(MGC_LOOKAT_T, 7);
+  if(w)
+    {
+      w[0].f = vx; w[1].f = vy; w[2].f = vz;
+      w[3].f = px; w[4].f = py; w[5].f = pz;
+      w[6].i = twist;
+    }
+}
+
+
+// Transforming
+
+void 
+MacroGeometryManager::Translate(gfloat x, gfloat y, gfloat z)
+{
+  MGWord* w = Record(MGC_TRANSLATE, 3);
+  if(w)
+    {
+      w[0].f = x;
+      w[1].f = y;
+      w[2].f = z;
+    }
+}
+
+void 
+MacroGeometryManager::Rotate(gAngle r, char axis)
+{
+  MGWord* w = Record(MGC_ROTATE, 2);
+  if(w)
+    {
+      w[0].i = r;
+      w[1].i = axis;
+    }
+}
+
+void 
+MacroGeometryManager::Scale(gfloat sx, gfloat sy, gfloat sz)
+{
+  MGWord* w = Record(MGC_SCALE, 3);
+  if(w)
+    {
+      w[0].f = sx;
+      w[1].f = sy;
+      w[2].f = sz;
+    }
+}
+
+
+// Matrix I/O
+
+void
+MacroGeometryManager::RecordMatrix(gint opcode, GMatrix& M)
+{
+  MGWord* w = Record(opcode, 16);
+  int i,j;
+  if(w)
+    for(i=0; i<4; i++)
+      for(j=0; j<4; j++)
+	w[4*i+j].f = M(i,j).fget();
+}
+
+void 
+MacroGeometryManager::LoadMatrix(GMatrix& M)
+{
+  RecordMatrix(MGC_LOADMATRIX, M);
+}
+
+void 
+MacroGeometryManager::MultMatrix(GMatrix& M)
+{
+  RecordMatrix(MGC_MULTMATRIX, M);
+}
+
+void 
+MacroGeometryManager::GetMatrix(GMatrix& M)
+{
+  NotRecorded("GetMatrix()");
+}
+
+
+// Operating modes
+
+void 
+MacroGeometryManager::PolygonMode(gpmode mode)
+{
+  MGWord* w = Record(MGC_POLYGONMODE, 1);
+  if(w)
+    w[0].i = mode;
+}
+
+void 
+MacroGeometryManager::CullingMode(gcmode mode)
+{
+  MGWord* w = Record(MGC_CULLINGMODE, 1);
+  if(w)
+    w[0].i = mode;
+}
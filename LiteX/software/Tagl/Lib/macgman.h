@@ -0,0 +1,210 @@
+/*
+ * This software is copyrighted as noted below.  It may be freely copied,
+ * modified, and redistributed, provided that the copyright notice is
+ * preserved on all copies.
+ *
+ * There is no warranty or other guarantee of fitness for this software,
+ * it is provided solely "as is".  Bug reports or fixes may be sent
+ * to the author, who may or may not act on them as he desires.
+ *
+ * You may not include this software in a program or other software product
+ * without supplying the source, or without informing the end-user that the
+ * source is available for no extra charge.
+ *
+ * If you modify this software, you should include a notice giving the
+ * name of the person performing the modification, the date of modification,
+ * and the reason for such modification.
+ *
+ * Author:      Bruno Levy
+ *
+ * Copyright (c) 1996, Bruno Levy.
+ *
+ */
+/*
+ *
+ * macgman.h
+ *
+ */
+
+// A geometry manager that memorizes the calls (Display List), to be
+// executed later by another GeometryManager:
+//
+//    MacroGeometryManager list;
+//    list.Begin(GBE_POLYGON); ... list.End();
+//    ...
+//    *output << list;    // or list.Playback(output);
+//
+// The calls are stored in a packed buffer of words (an opcode followed
+// by its arguments), replayed by a single loop. Only the Begin-End group,
+// the transforms and the operating modes can be recorded, the other calls
+// report an error (see ErrorCode()).
+//
+// Static lighting: after Light(), each Normal() is recorded as the
+// current color scaled by ambient + diffuse * max(0, N.L), so that the
+// lighting is computed once, when the list is recorded.
+
+#ifndef MACGMAN_H
+#define MACGMAN_H
+
+#include "gman.h"
+
+const Flag MGE_OK      = 0;
+const Flag MGE_RECORD  = 1;    // a call that cannot be recorded was made
+const Flag MGE_MALLOC  = 2;    // out of memory, the list is incomplete
+
+const int  MG_LIST_SZ  = 256;  // initial size of the list, in words
+
+// A word of the list
+union MGWord
+{
+  gint   i;
+  gfloat f;
+};
+
+class MacroGeometryManager : public GeometryManager
+{
+
+ public:
+
+  // Constructor
+
+  MacroGeometryManager(int verbose_level = MSG_ENV);
+
+  // Destructor
+
+  virtual ~MacroGeometryManager(void);
+
+  // List management
+
+  void Reset(void);           // empties the list
+  int  Size(void);            // in words
+
+  // Static light. (lx,ly,lz) points to the light, ambient and diffuse
+  // are in [0,1].
+
+  void Light(gfloat lx, gfloat ly, gfloat lz, 
+	     gfloat ambient = 0.2, gfloat diffuse = 0.8);
+  void LightOff(void);
+
+  // Playback
+
+  virtual int Playback(GeometryManager *output);
+
+  // Last error
+
+  virtual Flag ErrorCode(void);
+
+  // Begin-End
+
+  virtual void Begin(gbemode mode);
+  virtual void End(void);
+  virtual void Vertex(gfloat x, gfloat y, gfloat z);
+  virtual void Vertex(GCoord x, GCoord y, GCoord z);
+  virtual void Normal(gfloat x, gfloat y, gfloat z);
+  virtual void Color (gfloat r, gfloat g, gfloat b);
+  virtual void Color (gint   r, gint   g, gint   b);
+  virtual void Color (gfloat c);
+  virtual void Color (gint   c);
+
+  // Graphic Port -- cannot be recorded
+
+  virtual void Clear();
+  virtual void ZClear(void);
+  virtual void ZClear(ZCoord z);
+
+  virtual int  SingleBuffer(void);
+  virtual int  DoubleBuffer(void);
+  virtual int  SwapBuffers(void);
+
+  virtual void MapColor(const ColorIndex i, 
+			const ColorComponent r, 
+			const ColorComponent g, 
+			const ColorComponent b );
+
+  // Viewport and ScreenMask Management -- cannot be recorded
+
+  virtual void Viewport(ScrCoord left, ScrCoord right, 
+			ScrCoord bottom, ScrCoord top);
+
+  virtual void PushViewport(void);
+  virtual void PopViewport(void);
+
+  virtual void ScreenMask(ScrCoord left, ScrCoord right, 
+			  ScrCoord bottom, ScrCoord top);
+
+  virtual void SetDepth(ZCoord _near, ZCoord _far);
+
+  // Matrix Management
+
+  virtual void MatrixMode(gmmode mode);
+  virtual void PushMatrix(void);
+  virtual void PopMatrix(void);
+
+  virtual void Identity(void);
+
+  // Projections -- cannot be recorded
+
+  virtual void Perspective(gAngle _fov, gfloat _aspect, 
+			   gfloat _near, gfloat _far);
+
+  virtual void Ortho(gfloat _left, gfloat _right, gfloat _bottom, gfloat _top, 
+		     gfloat _near, gfloat _far);
+
+  // Viewing
+
+  virtual void PolarView(gfloat dist, gAngle azim, 
+			 gAngle inc, gAngle twist);
+
+  virtual void LookAt(gfloat vx, gfloat vy, gfloat vz,
+		      gfloat px, gfloat py, gfloat pz);
+
+  virtual void LookAt(gfloat vx, gfloat vy, gfloat vz,
+		      gfloat px, gfloat py, gfloat pz, 
+		      gAngle twist);
+
+  // Transforming
+
+  virtual void Translate(gfloat x, gfloat y, gfloat z);
+  virtual void Rotate(gAngle r, char axis);
+  virtual void Scale(gfloat sx, gfloat sy, gfloat sz);
+
+  // Matrix I/O (GetMatrix() cannot be recorded)
+
+  virtual void LoadMatrix(GMatrix& M);
+  virtual void MultMatrix(GMatrix& M);
+  virtual void GetMatrix(GMatrix&  M);
+
+  // Operating modes
+
+  virtual void PolygonMode(gpmode mode);
+  virtual void CullingMode(gcmode mode);
+
+ protected:
+
+  MGWord* Record(gint opcode, int nargs);
+  int     Grow(int n);
+  void    RecordMatrix(gint opcode, GMatrix& M);
+  void    NotRecorded(const char *what);
+  gfloat  Shade(gfloat x, gfloat y, gfloat z);
+
+ private:
+
+  MGWord*  _list;
+  int      _size;
+  int      _max_size;
+
+  Flag     _error_code;
+
+  int      _light;
+  gfloat   _lx, _ly, _lz;
+  gfloat   _ambient, _diffuse;
+
+  // Last recorded colors, lit by Normal()
+  int      _has_rgb, _has_c;
+  gfloat   _r, _g, _b;
+  gfloat   _c;
+};
+
+#include "macgman.ih"
+
+#endif
@@ -32,6 +32,7 @@
 typedef char  int8;
 typedef short int16;
 typedef int   int32;
+typedef long long int64;
 
 typedef unsigned char  uint8;
 typedef unsigned short uint16;
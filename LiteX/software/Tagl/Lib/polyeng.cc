@@ -31,10 +31,23 @@
 #include "polyeng.h"
 #include <string.h>
 
+#ifndef MIN
+#define MIN(x,y) (((x) < (y)) ? (x) : (y))
+#endif
+
+#ifndef MAX
+#define MAX(x,y) (((x) > (y)) ? (x) : (y))
+#endif
+
 GVertexPool  PolygonEngine::_vpool;
 GPolygon     PolygonEngine::_p1;
 GPolygon     PolygonEngine::_p2;
 Mug          PolygonEngine::_mug[PE_MAX_HEIGHT];
+int32        PolygonEngine::_recip[PE_RECIP_SZ];
+int          PolygonEngine::_tex_persp = 0;
+GPolygon*    PolygonEngine::_fill_poly = &PolygonEngine::_p1;
+GPolygon     PolygonEngine::_pq(PE_QUEUE_VERTICES);
+GVertex      PolygonEngine::_pq_vertex[PE_QUEUE_VERTICES];
 
 // virtual constructor stuff
 
@@ -128,14 +141,531 @@ PolygonEngine::PolygonEngine(GraphicPort *gp, int verb) : GraphicProcessor(gp)
 {
   _proc_name = "unknown PolygonEngine";
   Verbose(verb);
+
+  _tiling           = 0;
+  _tile_graph_mem   = NULL;
+  _tile_z_mem       = NULL;
+  _tile_width       = 0;
+  _tile_height      = 0;
+  _tile_own_buffers = 0;
+  _npoly       = _max_poly    = 0;
+  _poly_fill   = NULL;
+  _poly_attrib = NULL;
+  _poly_va     = NULL;
+  _poly_first  = NULL;
+  _nbvertex    = _max_bvertex = 0;
+  _bvertex     = NULL;
+  _nbin        = _max_bin     = 0;
+  _bin_poly    = NULL;
+  _bin_next    = NULL;
+  _ntiles_x    = _ntiles_y    = _max_tiles = 0;
+  _tile_first  = NULL;
+  _tile_last   = NULL;
+  _tile_vertex = NULL;
+  _max_tile_vertex = 0;
+  _queuing        = 0;
+  _queue_consumer = 0;
+  _queue          = NULL;
+  _queue_head     = 0;
+  _queue_tail     = 0;
+
+  if(!_recip[1])
+    {
+      _recip[0] = 0;
+      for(int i=1; i<PE_RECIP_SZ; i++)
+	_recip[i] = (1 << PE_RECIP_SHIFT) / i;
+    }
 }
 
 PolygonEngine::~PolygonEngine(void)
 {
+  EndQueue();
+  delete[] _queue;
+  FreeTiles();
+}
+
+int PolygonEngine::Reserve(int nvertices)
+{
+  if(!_vpool.Reserve(nvertices) || 
+     !_p1.Reserve(nvertices) || 
+     !_p2.Reserve(nvertices))
+    {
+      (*this)[MSG_ERROR] << "could not reserve " << nvertices << " vertices\n";
+      return 0;
+    }
+  return 1;
+}
+
+int PolygonEngine::Overflows(void)
+{
+  return _vpool.Overflows() + _p1.Overflows() + _p2.Overflows();
+}
+
+////
+////
+//
+// Tiled rendering
+//
+////
+////
+
+// Changes the size of an array from n elements to max (keeps the
+// first n ones), returns 0 if it could not be allocated.
+
+template <class T> static int Resize(T*& a, int n, int max)
+{
+  T* b = new T[max];
+  if(!b)
+    return 0;
+  if(a)
+    {
+      memcpy(b, a, n * sizeof(T));
+      delete[] a;
+    }
+  a = b;
+  return 1;
+}
+
+void PolygonEngine::FreeTiles(void)
+{
+  if(_tile_own_buffers)
+    {
+      delete[] _tile_graph_mem;
+      delete[] _tile_z_mem;
+    }
+  _tile_graph_mem   = NULL;
+  _tile_z_mem       = NULL;
+  _tile_own_buffers = 0;
+
+  delete[] _poly_fill;
+  delete[] _poly_attrib;
+  delete[] _poly_va;
+  delete[] _poly_first;
+  delete[] _bvertex;
+  delete[] _bin_poly;
+  delete[] _bin_next;
+  delete[] _tile_first;
+  delete[] _tile_last;
+  delete[] _tile_vertex;
+  _poly_fill   = NULL;
+  _poly_attrib = NULL;
+  _poly_va     = NULL;
+  _poly_first  = NULL;
+  _bvertex     = NULL;
+  _bin_poly    = NULL;
+  _bin_next    = NULL;
+  _tile_first  = NULL;
+  _tile_last   = NULL;
+  _tile_vertex = NULL;
+  _max_poly = _max_bvertex = _max_bin = _max_tiles = _max_tile_vertex = 0;
+}
+
+void PolygonEngine::TileBuffers(ColorIndex* graph_mem, ZCoord* z_mem, 
+				ScrCoord width, ScrCoord height)
+{
+  if(_tile_own_buffers)
+    {
+      delete[] _tile_graph_mem;
+      delete[] _tile_z_mem;
+      _tile_own_buffers = 0;
+    }
+  _tile_graph_mem = graph_mem;
+  _tile_z_mem     = z_mem;
+  _tile_width     = width;
+  _tile_height    = height;
+}
+
+int PolygonEngine::BeginTiles(void)
+{
+  int i;
+
+  if(!_tile_graph_mem)
+    {
+      _tile_width     = PE_TILE_WIDTH;
+      _tile_height    = PE_TILE_HEIGHT;
+      _tile_graph_mem = new ColorIndex[_tile_width * _tile_height * _bytes_per_pixel];
+      _tile_z_mem     = new ZCoord[_tile_width * _tile_height];
+      _tile_own_buffers = 1;
+      if(!_tile_graph_mem || !_tile_z_mem)
+	{
+	  (*this)[MSG_ERROR] << "could not alloc tile buffers\n";
+	  FreeTiles();
+	  return 0;
+	}
+    }
+
+  _ntiles_x = (_width  + _tile_width  - 1) / _tile_width;
+  _ntiles_y = (_height + _tile_height - 1) / _tile_height;
+  int ntiles = _ntiles_x * _ntiles_y;
+
+  if(ntiles > _max_tiles)
+    {
+      if(!Resize(_tile_first, 0, ntiles) || !Resize(_tile_last, 0, ntiles))
+	{
+	  (*this)[MSG_ERROR] << "could not alloc tile lists\n";
+	  return 0;
+	}
+      _max_tiles = ntiles;
+    }
+
+  for(i=0; i<ntiles; i++)
+    {
+      _tile_first[i] = -1;
+      _tile_last[i]  = -1;
+    }
+
+  _npoly    = 0;
+  _nbvertex = 0;
+  _nbin     = 0;
+  _tiling   = 1;
+  return 1;
+}
+
+// Called by FillPoly() in tiled mode, with the clipped polygon in _p1.
+// Draws it directly if it cannot be recorded.
+
+void PolygonEngine::RecordPoly(void)
+{
+  int i;
+  int nv = _p1.Size();
+  ScrCoord x1 = _p1[0]->x, y1 = _p1[0]->y, x2 = x1, y2 = y1;
+
+  if(_npoly == _max_poly)
+    {
+      int max = _max_poly ? 2 * _max_poly : 256;
+      if(!Resize(_poly_fill,   _npoly, max) || 
+	 !Resize(_poly_attrib, _npoly, max) ||
+	 !Resize(_poly_va,     _npoly, max) || 
+	 !Resize(_poly_first,  _npoly, max))
+	{
+	  _fillpoly(&VAttributes());
+	  return;
+	}
+      _max_poly = max;
+    }
+
+  if(_nbvertex + nv > _max_bvertex)
+    {
+      int max = _max_bvertex ? 2 * _max_bvertex : 1024;
+      while(max < _nbvertex + nv)
+	max *= 2;
+      if(!Resize(_bvertex, _nbvertex, max))
+	{
+	  _fillpoly(&VAttributes());
+	  return;
+	}
+      _max_bvertex = max;
+    }
+
+  if(nv > _max_tile_vertex)
+    {
+      delete[] _tile_vertex;
+      if(!(_tile_vertex = new GVertex[nv]))
+	{
+	  _max_tile_vertex = 0;
+	  _fillpoly(&VAttributes());
+	  return;
+	}
+      _max_tile_vertex = nv;
+    }
+
+  for(i=0; i<nv; i++)
+    {
+      GBinVertex& B = _bvertex[_nbvertex + i];
+      (GVertexAttributes&)B = *_p1[i];
+      B.x = _p1[i]->x;
+      B.y = _p1[i]->y;
+      x1 = MIN(x1, B.x);
+      y1 = MIN(y1, B.y);
+      x2 = MAX(x2, B.x);
+      y2 = MAX(y2, B.y);
+    }
+
+  int tx1 = MAX(x1, 0) / _tile_width;
+  int ty1 = MAX(y1, 0) / _tile_height;
+  int tx2 = MIN(x2 / _tile_width,  _ntiles_x - 1);
+  int ty2 = MIN(y2 / _tile_height, _ntiles_y - 1);
+  int nbins = (tx2 - tx1 + 1) * (ty2 - ty1 + 1);
+
+  if(nbins <= 0)
+    return;
+
+  if(_nbin + nbins > _max_bin)
+    {
+      int max = _max_bin ? 2 * _max_bin : 1024;
+      while(max < _nbin + nbins)
+	max *= 2;
+      if(!Resize(_bin_poly, _nbin, max) || !Resize(_bin_next, _nbin, max))
+	{
+	  _fillpoly(&VAttributes());
+	  return;
+	}
+      _max_bin = max;
+    }
+
+  _poly_fill[_npoly]   = _fillpoly;
+  _poly_attrib[_npoly] = Attributes().GetAll();
+  _poly_va[_npoly]     = VAttributes();
+  _poly_first[_npoly]  = _nbvertex;
+  _nbvertex += nv;
+
+  // Appended at the end of the lists, to keep the order of the polygons
+  for(int ty=ty1; ty<=ty2; ty++)
+    for(int tx=tx1; tx<=tx2; tx++)
+      {
+	int t = ty * _ntiles_x + tx;
+	_bin_poly[_nbin] = _npoly;
+	_bin_next[_nbin] = -1;
+	if(_tile_last[t] < 0)
+	  _tile_first[t] = _nbin;
+	else
+	  _bin_next[_tile_last[t]] = _nbin;
+	_tile_last[t] = _nbin;
+	_nbin++;
+      }
+
+  _npoly++;
+}
+
+// Draws the polygons of a tile, the graphic bus being the one of the 
+// tile (origin in x0,y0).
+
+void PolygonEngine::DrawTile(int tile, ScrCoord x0, ScrCoord y0)
+{
+  int i,e;
+
+  for(e = _tile_first[tile]; e >= 0; e = _bin_next[e])
+    {
+      int p     = _bin_poly[e];
+      int first = _poly_first[p];
+      int nv    = ((p + 1 < _npoly) ? _poly_first[p + 1] : _nbvertex) - first;
+
+      // Clipped and divided by w when recorded.
+      Attributes().SetAll(_poly_attrib[p]);
+      Attributes().Reset(GA_HCLIP);
+      Attributes().Reset(PEA_ZCLIP);
+
+      _p1.Reset();
+      for(i=0; i<nv; i++)
+	{
+	  GBinVertex& B = _bvertex[first + i];
+	  GVertex&    V = _tile_vertex[i];
+	  (GVertexAttributes&)V = B;
+	  V.x = B.x - x0;
+	  V.y = B.y - y0;
+	  V.flags.SetAll(0);
+	  _p1.Push(&V);
+	}
+
+      ClipPoly();
+      if(_p1.Size())
+	{
+	  _tex_persp = Attributes().Get(PEA_PERSPECTIVE) && 
+	               Attributes().Get(GA_TEXTURE);
+	  _poly_fill[p](&_poly_va[p]);
+	}
+    }
+}
+
+void PolygonEngine::EndTiles(void)
+{
+  int tx,ty,j;
+
+  if(!_tiling)
+    return;
+  _tiling = 0;
+
+  ColorIndex* graph_mem      = _graph_mem;
+  ZCoord*     z_mem          = _z_mem;
+  ZCoord*     z_tile         = _z_tile;
+  ScrCoord    width          = _width;
+  ScrCoord    height         = _height;
+  int         bytes_per_line = _bytes_per_line;
+  Rect        clip           = _clip;
+
+  PushAttributes();
+
+  for(ty=0; ty<_ntiles_y; ty++)
+    for(tx=0; tx<_ntiles_x; tx++)
+      {
+	int t = ty * _ntiles_x + tx;
+	if(_tile_first[t] < 0)
+	  continue;
+
+	ScrCoord x0  = tx * _tile_width;
+	ScrCoord y0  = ty * _tile_height;
+	ScrCoord w   = MIN(_tile_width,  width  - x0);
+	ScrCoord h   = MIN(_tile_height, height - y0);
+	int      row = w * _bytes_per_pixel;
+	ColorIndex* frame = graph_mem + y0 * bytes_per_line + x0 * _bytes_per_pixel;
+
+	for(j=0; j<h; j++)
+	  memcpy(_tile_graph_mem + j * row, frame + j * bytes_per_line, row);
+	for(j=0; j<w*h; j++)
+	  _tile_z_mem[j] = 0xffff;
+
+	_graph_mem      = _tile_graph_mem;
+	_z_mem          = _tile_z_mem;
+	_z_tile         = NULL;
+	_width          = w;
+	_height         = h;
+	_bytes_per_line = row;
+	_clip.Set(0, 0, w - 1, h - 1);
+
+	DrawTile(t, x0, y0);
+
+	for(j=0; j<h; j++)
+	  memcpy(frame + j * bytes_per_line, _tile_graph_mem + j * row, row);
+      }
+
+  _graph_mem      = graph_mem;
+  _z_mem          = z_mem;
+  _z_tile         = z_tile;
+  _width          = width;
+  _height         = height;
+  _bytes_per_line = bytes_per_line;
+  _clip           = clip;
+
+  PopAttributes();
+}
+
+////
+////
+//
+// Polygon queue
+//
+////
+////
+
+int PolygonEngine::BeginQueue(void)
+{
+  if(_tiling)
+    return 0;
+
+  if(!_queue && !(_queue = new GQueuedPoly[PE_QUEUE_SZ]))
+    {
+      (*this)[MSG_ERROR] << "could not alloc polygon queue\n";
+      return 0;
+    }
+
+  _queuing = 1;
+  return 1;
+}
+
+void PolygonEngine::EndQueue(void)
+{
+  if(!_queuing)
+    return;
+  _queuing = 0;
+
+  // Frame fence
+  while(__atomic_load_n(&_queue_tail, __ATOMIC_ACQUIRE) != _queue_head)
+    if(!_queue_consumer)
+      DrainQueue();
+}
+
+// Called by FillPoly() in queue mode, with the clipped polygon in _p1
+// (producer side).
+
+void PolygonEngine::QueuePoly(void)
+{
+  int i;
+  int nv   = _p1.Size();
+  int head = _queue_head;
+  int next = (head + 1 == PE_QUEUE_SZ) ? 0 : head + 1;
+
+  if(nv > PE_QUEUE_VERTICES)
+    {
+      EndQueue();
+      FillClipped();
+      _queuing = 1;
+      return;
+    }
+
+  // Full: wait for the consumer (or make room)
+  while(__atomic_load_n(&_queue_tail, __ATOMIC_ACQUIRE) == next)
+    if(!_queue_consumer)
+      DrainQueue();
+
+  GQueuedPoly& Q = _queue[head];
+  Q.fill   = _fillpoly;
+  Q.attrib = Attributes().GetAll();
+  Q.va     = VAttributes();
+  Q.nv     = nv;
+  for(i=0; i<nv; i++)
+    {
+      (GVertexAttributes&)Q.v[i] = *_p1[i];
+      Q.v[i].x = _p1[i]->x;
+      Q.v[i].y = _p1[i]->y;
+    }
+
+  __atomic_store_n(&_queue_head, next, __ATOMIC_RELEASE);
+}
+
+// Consumer side: fills the polygons in the queue, returns their number.
+
+int PolygonEngine::DrainQueue(void)
+{
+  int i;
+  int n    = 0;
+  int tail = _queue_tail;
+
+  while(tail != __atomic_load_n(&_queue_head, __ATOMIC_ACQUIRE))
+    {
+      GQueuedPoly& Q = _queue[tail];
+      _pq.Reset();
+      for(i=0; i<Q.nv; i++)
+	{
+	  GVertex& V = _pq_vertex[i];
+	  (GVertexAttributes&)V = Q.v[i];
+	  V.x = Q.v[i].x;
+	  V.y = Q.v[i].y;
+	  _pq.Push(&V);
+	}
+
+      Flags attrib(Q.attrib);
+      _tex_persp = attrib.Get(PEA_PERSPECTIVE) && attrib.Get(GA_TEXTURE);
+      _fill_poly = &_pq;
+      Q.fill(&Q.va);
+      _fill_poly = &_p1;
+
+      tail = (tail + 1 == PE_QUEUE_SZ) ? 0 : tail + 1;
+      __atomic_store_n(&_queue_tail, tail, __ATOMIC_RELEASE);
+      n++;
+    }
+  return n;
+}
+
+// Main loop of the consumer hart, until *running is 0
+
+void PolygonEngine::QueueLoop(volatile int* running)
+{
+  while(*running)
+    DrainQueue();
+  DrainQueue();
 }
 
 // Sutherland-Hodgman Polygon clipping
 
+// Intersection I = A + num/den (B - A) of a perspective polygon in screen
+// space, where X/w, Y/w and 1/w are linear (and X, Y and w are not).
+void PolygonEngine::PerspClip(GVertex* I, GVertex* A, GVertex* B, 
+			      int num, int den)
+{
+  int64 qA = ((int64)1 << PE_RECIP_SHIFT) / MAX(A->w, 1);
+  int64 qB = ((int64)1 << PE_RECIP_SHIFT) / MAX(B->w, 1);
+  int64 qI = qA + (qB - qA) * num / den;
+  int64 sA = A->X * qA;
+  int64 sI = sA + (B->X * qB - sA) * num / den;
+  int64 tA = A->Y * qA;
+  int64 tI = tA + (B->Y * qB - tA) * num / den;
+
+  qI    = MAX(qI, 1);
+  I->X  = (TexCoord)(sI / qI);
+  I->Y  = (TexCoord)(tI / qI);
+  I->w  = (HCoord)(((int64)1 << PE_RECIP_SHIFT) / qI);
+}
+
 void PolygonEngine::ClipPoly(void)
 
 {
@@ -143,14 +673,19 @@ void PolygonEngine::ClipPoly(void)
   int flag, old_flag;
   GVertex *S, *P, *I;
   int clip_z  = Attributes().Get(GA_ZBUFFER) || Attributes().Get(PEA_ZCLIP);
+  // In homogeneous space, the texture coordinates are linear
+  int persp   = Attributes().Get(PEA_PERSPECTIVE) && !Attributes().Get(GA_HCLIP);
 
   _vpool.Reset();
 
 /* --------------- clip with x = _clip._x1 ---------------- */
 
   _p2.Reset();
-  if(!_p1.Size())
-    return;
+  if(!_p1.Size() || _p1.Truncated())
+    {
+      _p1.Reset();
+      return;
+    }
   S = _p1[0];
   old_flag = S->x < _clip._x1;
 
@@ -162,7 +697,11 @@ void PolygonEngine::ClipPoly(void)
 
       if(flag ^ old_flag)
 	{
-	  I = _vpool.New();
+	  if(!(I = _vpool.New()))
+	    {
+	      _p1.Reset();
+	      return;
+	    }
 	  I->flags.Set(VF_CLIP);
 	  I->x = _clip._x1;
 	  I->y = S->y + (_clip._x1 - S->x) * (P->y - S->y) / (P->x - S->x);
@@ -181,8 +720,13 @@ void PolygonEngine::ClipPoly(void)
 
 	  if(Attributes().Get(GA_TEXTURE))
 	    {
-	      I->X = S->X + (_clip._x1 - S->x) * (P->X - S->X) / (P->x - S->x);
-	      I->Y = S->Y + (_clip._x1 - S->x) * (P->Y - S->Y) / (P->x - S->x);
+	      if(persp)
+		PerspClip(I, S, P, _clip._x1 - S->x, P->x - S->x);
+	      else
+		{
+		  I->X = S->X + (_clip._x1 - S->x) * (P->X - S->X) / (P->x - S->x);
+		  I->Y = S->Y + (_clip._x1 - S->x) * (P->Y - S->Y) / (P->x - S->x);
+		}
 	    }
 
 	  if(clip_z)
@@ -209,8 +753,11 @@ void PolygonEngine::ClipPoly(void)
 /* --------------- clip with x = _clip._x2 ---------------- */
 
   _p1.Reset();
-  if(!_p2.Size())
-    return;
+  if(!_p2.Size() || _p2.Truncated())
+    {
+      _p1.Reset();
+      return;
+    }
   S = _p2[0];
   old_flag = S->x > _clip._x2;
 
@@ -223,7 +770,11 @@ void PolygonEngine::ClipPoly(void)
 
       if(flag ^ old_flag)
 	{
-	  I = _vpool.New();
+	  if(!(I = _vpool.New()))
+	    {
+	      _p1.Reset();
+	      return;
+	    }
 	  I->flags.Set(VF_CLIP);
 
 	  I->x = _clip._x2;
@@ -243,8 +794,13 @@ void PolygonEngine::ClipPoly(void)
 
 	  if(Attributes().Get(GA_TEXTURE))
 	    {
-	      I->X = P->X - (P->x - _clip._x2) * (P->X - S->X) / (P->x - S->x);
-	      I->Y = P->Y - (P->x - _clip._x2) * (P->Y - S->Y) / (P->x - S->x);
+	      if(persp)
+		PerspClip(I, P, S, P->x - _clip._x2, P->x - S->x);
+	      else
+		{
+		  I->X = P->X - (P->x - _clip._x2) * (P->X - S->X) / (P->x - S->x);
+		  I->Y = P->Y - (P->x - _clip._x2) * (P->Y - S->Y) / (P->x - S->x);
+		}
 	    }
 
 	  if(clip_z)
@@ -270,8 +826,11 @@ void PolygonEngine::ClipPoly(void)
 /* ---------------  clip with y = _clip._y1 ---------------- */
 
   _p2.Reset();
-  if(!_p1.Size())
-    return;
+  if(!_p1.Size() || _p1.Truncated())
+    {
+      _p1.Reset();
+      return;
+    }
   S = _p1[0];
   old_flag = S->y < _clip._y1;
 
@@ -288,7 +847,15 @@ void PolygonEngine::ClipPoly(void)
       if(flag ^ old_flag)
 	{
 	
-	  I = _vpool.New();
+	  if(!(I = _vpool.New()))
+	
+	    {
+	
+	      _p1.Reset();
+	
+	      return;
+	
+	    }
 	  I->flags.Set(VF_CLIP);
 
 	  I->y = _clip._y1;
@@ -308,8 +875,13 @@ void PolygonEngine::ClipPoly(void)
 
 	  if(Attributes().Get(GA_TEXTURE))
 	    {
-	      I->X = S->X + (_clip._y1 - S->y) * (P->X - S->X) / (P->y - S->y);
-	      I->Y = S->Y + (_clip._y1 - S->y) * (P->Y - S->Y) / (P->y - S->y);
+	      if(persp)
+		PerspClip(I, S, P, _clip._y1 - S->y, P->y - S->y);
+	      else
+		{
+		  I->X = S->X + (_clip._y1 - S->y) * (P->X - S->X) / (P->y - S->y);
+		  I->Y = S->Y + (_clip._y1 - S->y) * (P->Y - S->Y) / (P->y - S->y);
+		}
 	    }
 
 	  if(clip_z)
@@ -335,8 +907,11 @@ void PolygonEngine::ClipPoly(void)
 /* --------------- clip with y = _clip._y2 ---------------- */
 
   _p1.Reset();
-  if(!_p2.Size())
-    return;
+  if(!_p2.Size() || _p2.Truncated())
+    {
+      _p1.Reset();
+      return;
+    }
   S = _p2[0];
   old_flag = S->y > _clip._y2;
 
@@ -349,7 +924,11 @@ void PolygonEngine::ClipPoly(void)
 
       if(flag ^ old_flag)
 	{
-	  I = _vpool.New();
+	  if(!(I = _vpool.New()))
+	    {
+	      _p1.Reset();
+	      return;
+	    }
 	  I->flags.Set(VF_CLIP);
 
 	  I->y = _clip._y2;
@@ -369,8 +948,13 @@ void PolygonEngine::ClipPoly(void)
 
 	  if(Attributes().Get(GA_TEXTURE))
 	    {
-	      I->X = P->X - (P->y - _clip._y2) * (P->X - S->X) / (P->y - S->y);
-	      I->Y = P->Y - (P->y - _clip._y2) * (P->Y - S->Y) / (P->y - S->y);
+	      if(persp)
+		PerspClip(I, P, S, P->y - _clip._y2, P->y - S->y);
+	      else
+		{
+		  I->X = P->X - (P->y - _clip._y2) * (P->X - S->X) / (P->y - S->y);
+		  I->Y = P->Y - (P->y - _clip._y2) * (P->Y - S->Y) / (P->y - S->y);
+		}
 	    }
 
 	  if(clip_z)
@@ -393,6 +977,9 @@ void PolygonEngine::ClipPoly(void)
       old_flag = flag;
     }
 
+  if(_p1.Truncated())
+    _p1.Reset();
+
   if(!(Attributes().Get(PEA_ZCLIP)))
     return;
 
@@ -401,8 +988,11 @@ void PolygonEngine::ClipPoly(void)
 /* --------------- clip with z = _clip._z1 ---------------- */
 
   _p2.Reset();
-  if(!_p1.Size())
-    return;
+  if(!_p1.Size() || _p1.Truncated())
+    {
+      _p1.Reset();
+      return;
+    }
   S = _p1[0];
   old_flag = S->z < _clip._z1;
 
@@ -419,7 +1009,15 @@ void PolygonEngine::ClipPoly(void)
       if(flag ^ old_flag)
 	{
 	
-	  I = _vpool.New();
+	  if(!(I = _vpool.New()))
+	
+	    {
+	
+	      _p1.Reset();
+	
+	      return;
+	
+	    }
 	  I->flags.Set(VF_CLIP);
 
 	  I->z = _clip._z1;
@@ -443,8 +1041,13 @@ void PolygonEngine::ClipPoly(void)
 
 	  if(Attributes().Get(GA_TEXTURE))
 	    {
-	      I->X = (TexCoord)(S->X + (_clip._z1 - S->z) * (P->X - S->X) / (P->z - S->z));
-	      I->Y = (TexCoord)(S->Y + (_clip._z1 - S->z) * (P->Y - S->Y) / (P->z - S->z));
+	      if(persp)
+		PerspClip(I, S, P, _clip._z1 - S->z, P->z - S->z);
+	      else
+		{
+		  I->X = (TexCoord)(S->X + (_clip._z1 - S->z) * (P->X - S->X) / (P->z - S->z));
+		  I->Y = (TexCoord)(S->Y + (_clip._z1 - S->z) * (P->Y - S->Y) / (P->z - S->z));
+		}
 	    }
 
 	  if(Attributes().Get(GA_HCLIP))
@@ -466,8 +1069,11 @@ void PolygonEngine::ClipPoly(void)
 /* --------------- clip with z = _clip._z2 ---------------- */
 
   _p1.Reset();
-  if(!_p2.Size())
-    return;
+  if(!_p2.Size() || _p2.Truncated())
+    {
+      _p1.Reset();
+      return;
+    }
   S = _p2[0];
   old_flag = S->z > _clip._z2;
 
@@ -480,7 +1086,11 @@ void PolygonEngine::ClipPoly(void)
 
       if(flag ^ old_flag)
 	{
-	  I = _vpool.New();
+	  if(!(I = _vpool.New()))
+	    {
+	      _p1.Reset();
+	      return;
+	    }
 	  I->flags.Set(VF_CLIP);
 
 	  I->z = _clip._z2;
@@ -504,8 +1114,13 @@ void PolygonEngine::ClipPoly(void)
 
 	  if(Attributes().Get(GA_TEXTURE))
 	    {
-	      I->X = (TexCoord)(P->X - (P->z - _clip._z2) * (P->X - S->X) / (P->z - S->z));
-	      I->Y = (TexCoord)(P->Y - (P->z - _clip._z2) * (P->Y - S->Y) / (P->z - S->z));
+	      if(persp)
+		PerspClip(I, P, S, P->z - _clip._z2, P->z - S->z);
+	      else
+		{
+		  I->X = (TexCoord)(P->X - (P->z - _clip._z2) * (P->X - S->X) / (P->z - S->z));
+		  I->Y = (TexCoord)(P->Y - (P->z - _clip._z2) * (P->Y - S->Y) / (P->z - S->z));
+		}
 	    }
 
 	  if(Attributes().Get(GA_HCLIP))
@@ -523,6 +1138,9 @@ void PolygonEngine::ClipPoly(void)
       old_flag = flag;
     }
 
+  if(_p1.Truncated())
+    _p1.Reset();
+
   if(Attributes().Get(GA_HCLIP))
     for(i=0; i<_p1.Size(); i++)
       {
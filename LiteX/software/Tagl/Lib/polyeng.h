@@ -40,6 +40,17 @@ const int PE_MAX_HEIGHT = 1024;
 
 const int PEA_ZCLIP = GA_MAX + 1;
 
+//  Perspective correct texture mapping: X and Y are interpolated as X/w,
+// Y/w and 1/w, with a division every PE_PERSP_SPAN pixels (a lookup in
+// a table of PE_RECIP_SZ reciprocals) and affine in between. The 
+// vertices need their w (as given by the LocalGeometryManager).
+const int PEA_PERSPECTIVE = GA_MAX + 2;
+
+const int PE_PERSP_SPAN   = 16;
+const int PE_RECIP_SZ     = 4096;
+const int PE_RECIP_SHIFT  = 30;
+const int PE_Q_SHIFT      = 14;
+
 class Mug
 {
  public:
@@ -50,6 +61,17 @@ class Mug
 
 class PolygonEngine;
 
+// Tiled rendering (see PolygonEngine::BeginTiles())
+
+const int PE_TILE_WIDTH  = 32;
+const int PE_TILE_HEIGHT = 32;
+
+class GBinVertex : public GVertexAttributes
+{
+ public:
+  ScrCoord x,y;
+};
+
 typedef void (* PolyFun)(GVertexAttributes *);
 typedef void (* LineFun)(GVertexAttributes *, GVertex *, GVertex *);
 typedef void (* PixelFun)(GVertexAttributes *, ScrCoord, ScrCoord);
@@ -57,6 +79,22 @@ typedef void (* PixelFun)(GVertexAttributes *, ScrCoord, ScrCoord);
 
 typedef PolygonEngine *(*PolygonEngine_MakeFun)(GraphicPort*, int);
 
+// Polygon queue (see PolygonEngine::BeginQueue()): a slot holds a 
+// clipped polygon, with its fill routine and attributes.
+
+const int PE_QUEUE_SZ       = 128;
+const int PE_QUEUE_VERTICES = 12;
+
+class GQueuedPoly
+{
+ public:
+  PolyFun           fill;
+  FlagSet           attrib;
+  GVertexAttributes va;
+  int               nv;
+  GBinVertex        v[PE_QUEUE_VERTICES];
+};
+
 typedef struct
 {
   PolygonEngine_MakeFun make;
@@ -78,6 +116,15 @@ class PolygonEngine : public GraphicProcessor
   static GPolygon    _p2;
   static Mug         _mug[PE_MAX_HEIGHT];
 
+  static int32       _recip[PE_RECIP_SZ];
+  static int         _tex_persp;
+
+  // The polygon filled by the fill routines: _p1, or _pq for a polygon
+  // taken from the queue (_p1 is then the one the producer clips).
+  static GPolygon*   _fill_poly;
+  static GPolygon    _pq;
+  static GVertex     _pq_vertex[PE_QUEUE_VERTICES];
+
 
   GVertexAttributes _vattrib_stack[ATTRIB_STACK_SZ];
 
@@ -85,6 +132,44 @@ class PolygonEngine : public GraphicProcessor
   LineFun   _drawline;
   PixelFun  _setpixel;
 
+  // Tiled rendering: the recorded polygons (fill routine, attributes,
+  // first vertex), their vertices, and the list of polygons of each
+  // tile (head and tail in _tile_first and _tile_last, an entry 
+  // is a polygon in _bin_poly and the next entry in _bin_next).
+  int               _tiling;
+  ColorIndex*       _tile_graph_mem;
+  ZCoord*           _tile_z_mem;
+  ScrCoord          _tile_width, _tile_height;
+  int               _tile_own_buffers;
+
+  int               _npoly, _max_poly;
+  PolyFun*          _poly_fill;
+  FlagSet*          _poly_attrib;
+  GVertexAttributes* _poly_va;
+  int*              _poly_first;
+
+  int               _nbvertex, _max_bvertex;
+  GBinVertex*       _bvertex;
+
+  int               _nbin, _max_bin;
+  int*              _bin_poly;
+  int*              _bin_next;
+
+  int               _ntiles_x, _ntiles_y, _max_tiles;
+  int*              _tile_first;
+  int*              _tile_last;
+
+  GVertex*          _tile_vertex;
+  int               _max_tile_vertex;
+
+  // Polygon queue: a ring of PE_QUEUE_SZ slots, _queue_head is only
+  // written by the producer, _queue_tail only by the consumer.
+  int               _queuing;
+  int               _queue_consumer;
+  GQueuedPoly*      _queue;
+  int               _queue_head;
+  int               _queue_tail;
+
  public:
   PolygonEngine(GraphicPort *gp, int verbose_level = MSG_ENV);
   virtual ~PolygonEngine(void);
@@ -104,6 +189,67 @@ class PolygonEngine : public GraphicProcessor
 
   void ClipPoly(void);
 
+ protected:
+  static int32    PerspQ(HCoord wmin, HCoord w);
+  static TexCoord PerspDiv(TexCoord S, HCoord Q);
+  static int32    PackedStep(int32 d, int n, int frac);
+  static void     PerspClip(GVertex* I, GVertex* A, GVertex* B, 
+			    int num, int den);
+
+ public:
+
+  //  The vertex pool and the polygons of the clipper are shared by all
+  // the engines (like the graphic bus, the fill routines are static).
+  // A polygon that does not fit is not drawn, Overflows() counts the
+  // vertices that were dropped. Reserve() changes the capacity
+  // (VERTEXPOOL_SZ and POLYGON_SZ by default).
+  int Reserve(int nvertices);
+  int Overflows(void);
+
+  //  Between BeginTiles() and EndTiles(), FillPoly() clips and records
+  // the polygons instead of drawing them. EndTiles() draws them tile by
+  // tile, in a tile buffer and a tile ZBuffer (in fast memory if given
+  // to TileBuffers()), and reads and writes each tile of the frame
+  // buffer that has polygons once. The tile ZBuffer is cleared before
+  // each tile: the depth test only sees the polygons of the batch.
+  // DrawPoly() and SetPixel() still draw directly. 
+  void TileBuffers(ColorIndex* graph_mem, ZCoord* z_mem, 
+		   ScrCoord width, ScrCoord height);
+  int  BeginTiles(void);
+  void EndTiles(void);
+  int  Tiling(void);
+
+ protected:
+  void RecordPoly(void);
+  void DrawTile(int tile, ScrCoord x0, ScrCoord y0);
+  void FreeTiles(void);
+
+ public:
+
+  //  Between BeginQueue() and EndQueue(), FillPoly() clips the polygons
+  // and pushes them in a lock-free ring (one producer, one consumer),
+  // and DrainQueue() fills them. With QueueConsumer(1), another hart 
+  // calls DrainQueue() (see QueueLoop()) while this one transforms, 
+  // lights and clips the next polygons, else this one drains the ring
+  // when it is full and in EndQueue(). EndQueue() waits until all the
+  // polygons are filled: it is the frame fence, before SwapBuffers() 
+  // or anything that changes the frame buffer, the ZBuffer or the 
+  // texture. Polygons with more than PE_QUEUE_VERTICES vertices once
+  // clipped are filled directly, after the ring is drained. DrawPoly()
+  // and SetPixel() still draw directly. Not with tiles.
+  int  BeginQueue(void);
+  void EndQueue(void);
+  int  Queuing(void);
+  void QueueConsumer(int yes = 1);
+  int  DrainQueue(void);
+  void QueueLoop(volatile int* running);
+
+ protected:
+  void QueuePoly(void);
+  void FillClipped(void);
+
+ public:
+
   // virtual constructor stuff
 
  public:
@@ -34,17 +34,29 @@
 
 const int POLYGON_SZ = 100;
 
+// Push() drops the vertices that do not fit, Truncated() tells whether
+// it occured since the last Reset(), Overflows() counts them all.
+
 class GPolygon
 {
  protected:
   int _npv;
-  GVertex* _pv[POLYGON_SZ];
+  GVertex** _pv;
+  int _capacity;
+  int _truncated;
+  int _overflows;
  public:
-  GPolygon(void);
+  GPolygon(int capacity = POLYGON_SZ);
+  ~GPolygon(void);
   void    Push(GVertex* pv);
   GVertex* operator[](int idx);
   void    Reset(void);
   int     Size(void);
+
+  int     Reserve(int capacity);
+  int     Capacity(void);
+  int     Truncated(void);
+  int     Overflows(void);
 };
 
 #include "polygon.ih"
@@ -33,20 +33,29 @@
 
 const int VERTEXPOOL_SZ = 100;
 
+// New() returns NULL when the pool is full, and counts the overflow.
+
 class GVertexPool
 {
 
  protected:
-  GVertex _v[VERTEXPOOL_SZ];
+  GVertex* _v;
   int    _nv;
+  int    _capacity;
+  int    _overflows;
 
  public:
-  GVertexPool(void);
+  GVertexPool(int capacity = VERTEXPOOL_SZ);
+  ~GVertexPool(void);
   GVertex* New(void);
   void     Reset(void);
   GVertex& operator[](int idx);
   GVertex& Top(void);
   int      Size(void);
+
+  int      Reserve(int capacity);
+  int      Capacity(void);
+  int      Overflows(void);
   
 
 };
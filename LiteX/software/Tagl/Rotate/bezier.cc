@@ -216,6 +216,77 @@ Bezier::Normal(VectorF *b, bnumber u, bnumber v, bnumber w)
     return V2 ^ V1;
 }
 
+// The bases of the last (degree, subdivision) pairs, shared by all
+// the patches (a SmoothMesh has three patches per face, with the
+// same degree and subdivision).
+
+const int BEZIER_BASIS_CACHE_SZ = 4;
+
+static struct
+{
+  int      degree;
+  int      n;
+  bnumber* basis;
+} basis_cache[BEZIER_BASIS_CACHE_SZ];
+
+static int basis_cache_next = 0;
+
+const bnumber*
+Bezier::Basis(void)
+{
+  int c,i,j,ii,jj;
+
+  for(c=0; c<BEZIER_BASIS_CACHE_SZ; c++)
+    if(basis_cache[c].basis && 
+       basis_cache[c].degree == _degree && basis_cache[c].n == _n)
+      return basis_cache[c].basis;
+
+  int nc = (_degree+1)*(_degree+2)/2;
+  bnumber* basis = new bnumber[3 * nc * (_n*(_n+1)/2)];
+
+  for(i=0; i<_n; i++)
+    for(j=0; j<=_n-1-i; j++)
+      {
+	bnumber u = (bnumber)i/(bnumber)(_n - 1);
+	bnumber v = (bnumber)j/(bnumber)(_n - 1);
+	bnumber w = 1.0 - u - v;
+	bnumber* B  = basis + 3 * nc * TIndex(_n, i, j);
+	bnumber* V1 = B  + nc;
+	bnumber* V2 = V1 + nc;
+
+	for(c=0; c<3*nc; c++)
+	  B[c] = 0.0;
+
+	// BezierPoly()
+	for(ii=0; ii<=_degree; ii++)
+	  for(jj=0; jj<=_degree-ii; jj++)
+	    B[TIndex(_degree+1,ii,jj)] = Bernstein(ii,jj,_degree-ii-jj,u,v,w);
+
+	// DaBezier(), with (a1,a2,a3) = (-1,2,-1) and (-1,-1,2)
+	for(ii=0; ii<=_degree-1; ii++)
+	  for(jj=0; jj<=_degree-ii-1; jj++)
+	    {
+	      bnumber d = (bnumber)_degree *
+		Bernstein(_degree-1, ii, jj, _degree-1-ii-jj, u, v, w);
+	      V1[TIndex(_degree+1,ii+1,jj  )] -= d;
+	      V1[TIndex(_degree+1,ii  ,jj+1)] += 2.0 * d;
+	      V1[TIndex(_degree+1,ii  ,jj  )] -= d;
+	      V2[TIndex(_degree+1,ii+1,jj  )] -= d;
+	      V2[TIndex(_degree+1,ii  ,jj+1)] -= d;
+	      V2[TIndex(_degree+1,ii  ,jj  )] += 2.0 * d;
+	    }
+      }
+
+  c = basis_cache_next;
+  basis_cache_next = (basis_cache_next + 1) % BEZIER_BASIS_CACHE_SZ;
+  delete[] basis_cache[c].basis;
+  basis_cache[c].degree = _degree;
+  basis_cache[c].n      = _n;
+  basis_cache[c].basis  = basis;
+
+  return basis;
+}
+
 void
 Bezier::Update(VectorF *b)
 {
@@ -227,18 +298,33 @@ Bezier::Update(VectorF *b)
       return;
     }
 
-  for(i=0; i<_n; i++)
-    for(j=0; j<=_n-1-i; j++)
-      {
-	bnumber u = (bnumber)i/(bnumber)(_n - 1);
-	bnumber v = (bnumber)j/(bnumber)(_n - 1);
-	bnumber w = 1.0 - u - v;
-	VectorF V = BezierPoly(b, u, v, w);
-	_vertex[TIndex(_n, i, j)] << V;
-	VectorF N = Normal(b, u, v, w);
-	_vertex[TIndex(_n, i, j)].N << N;
-	_vertex[TIndex(_n, i, j)].N.Normalize();
-      }
+  const bnumber* basis = Basis();
+  int nc = (_degree+1)*(_degree+2)/2;
+  int c;
+
+  for(i=0; i<_nvertex; i++)
+    {
+      const bnumber* B = basis + 3 * nc * i;
+      VectorF V  = 0.0;
+      VectorF V1 = 0.0;
+      VectorF V2 = 0.0;
+      for(c=0; c<nc; c++)
+	{
+	  V.x  += B[c]        * b[c].x;
+	  V.y  += B[c]        * b[c].y;
+	  V.z  += B[c]        * b[c].z;
+	  V1.x += B[nc + c]   * b[c].x;
+	  V1.y += B[nc + c]   * b[c].y;
+	  V1.z += B[nc + c]   * b[c].z;
+	  V2.x += B[2*nc + c] * b[c].x;
+	  V2.y += B[2*nc + c] * b[c].y;
+	  V2.z += B[2*nc + c] * b[c].z;
+	}
+      _vertex[i] << V;
+      VectorF N = V2 ^ V1;
+      _vertex[i].N << N;
+      _vertex[i].N.Normalize();
+    }
 
   _resources.Set(MR_SMOOTH);
 
@@ -259,7 +345,10 @@ Bezier::Update(VectorF *b)
 void 
 Bezier::Update(bnumber* b)
 {
-  int i,j;
+  int i,j,c;
+
+  const bnumber* basis = b ? Basis() : (const bnumber*)NULL;
+  int nc = (_degree+1)*(_degree+2)/2;
 
   for(i=0; i<_n; i++)
     for(j=0; j<=_n-1-i; j++)
@@ -268,7 +357,14 @@ Bezier::Update(bnumber* b)
 	bnumber u = (bnumber)i/(bnumber)(_n - 1);
 	bnumber v = (bnumber)j/(bnumber)(_n - 1);
 	bnumber w = 1.0 - u - v;
-	TVertex(2, V, u, v, w, BezierPoly(b, u, v, w));
+	bnumber h = 0.0;
+	if(b)
+	  {
+	    const bnumber* B = basis + 3 * nc * TIndex(_n, i, j);
+	    for(c=0; c<nc; c++)
+	      h += B[c] * b[c];
+	  }
+	TVertex(2, V, u, v, w, h);
 	_vertex[TIndex(_n, i,j)] << V;
       }
 
@@ -82,6 +82,14 @@ class Bezier : public TriMesh
 		                bnumber a1, bnumber a2, bnumber a3);    
   VectorF  Normal(VectorF *b, bnumber u, bnumber v, bnumber w);
 
+  // The Bernstein polynomials (and the derivatives used by Normal())
+  // at the vertices of the patch: for each vertex TIndex(_n,i,j),
+  // 3 rows of weights of the control points TIndex(_degree+1,i,j)
+  // (position, V1 and V2 of Normal()). Computed once for all the
+  // patches with the same degree and subdivision, then Update() is a
+  // weighted sum of the control points per vertex.
+  const bnumber* Basis(void);
+
   TriMesh *_control;
 
 };
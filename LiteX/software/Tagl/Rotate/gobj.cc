@@ -33,10 +33,19 @@
 
 int GraphicObject::_gamma_ramp[GAMMA_VALUES];
 
+int GraphicObject::_shade_c[SHADE_VALUES + 1];
+int GraphicObject::_shade_d[SHADE_VALUES + 1];
+int GraphicObject::_shade_s[SHADE_VALUES + 1];
+int GraphicObject::_shade_key[5] = { -1, 0, 0, 0, 0 };
+int GraphicObject::_gamma_stamp  = 1;
+
 MVector GraphicObject::_L(0,0,-M_BIG); 
 
 GraphicObject::GraphicObject() {
    _L = MVector(0,0,-M_BIG);
+   _KD = 0;
+   _KS = 0;
+   _spec_factor = 0;
 }
 
 int GraphicObject::_Lr = 0;
@@ -47,6 +56,7 @@ int GraphicObject::_Lc = 0;
 
 int GraphicObject::_zoom      = 16;
 int GraphicObject::_zoom_step = 4;
+int GraphicObject::_lod       = 4;
 
 int GraphicObject::_width  = 0;
 int GraphicObject::_height = 0;
@@ -67,6 +77,8 @@ GraphicObject::GammaRamp(gfloat gamma)
   for(i=0; i<GAMMA_VALUES; i++)
     _gamma_ramp[i] = (int)((gfloat)M_BIG * 
 			   (1.0 - exp(-(gfloat)(i << GAMMA_SHIFT) / ((gfloat)M_BIG * gamma))));
+
+  _gamma_stamp++;
 }
 
 void 
@@ -76,6 +88,7 @@ GraphicObject::Shiny(gfloat factor, gfloat lambertian, gfloat specular)
 
   _KD = (int)(lambertian * (gfloat)M_BIG);
   _KS = (int)(specular   * (gfloat)M_BIG);
+  _spec_factor = (int)(factor * 1024.0);
 
   for(i=0; i<SPEC_VALUES; i++)
       _specular[i] = (int)((gfloat)M_BIG * 
@@ -90,3 +103,66 @@ GraphicObject::Dull(void)
   _flags.Reset(GF_SPECULAR);
 }
 
+// Same mapping as Project(), in floating point, with a margin for
+// its roundings.
+
+int
+GraphicObject::Outside(PolygonEngine *PE, int x, int y, int z, int r)
+{
+  if(_width <= 0)
+    return 0;
+
+  double k = PixelScale();
+  double R  = (double)r * k + 2.0 + (double)_zoom / 16.0;
+  double px = (double)(_width  >> 1) + (double)x * k;
+  double py = (double)(_height >> 1) + (double)y * k;
+
+  ScrCoord x1,y1,x2,y2;
+  PE->Port()->Clip().Get(&x1,&y1,&x2,&y2);
+  if(px + R < (double)x1 || px - R > (double)x2 ||
+     py + R < (double)y1 || py - R > (double)y2)
+    return 1;
+
+  if(PE->Attributes().Get(GA_ZBUFFER) || PE->Attributes().Get(PEA_ZCLIP))
+    {
+      ZCoord z1,z2;
+      PE->Port()->Clip().Get(&z1,&z2);
+      // Projection.z = (M_BIG - z) >> 5
+      double pz1 = (double)(M_BIG - z - r) / 32.0 - 1.0;
+      double pz2 = (double)(M_BIG - z + r) / 32.0 + 1.0;
+      if(pz2 < (double)z1 || pz1 > (double)z2)
+	return 1;
+    }
+
+  return 0;
+}
+
+void
+GraphicObject::UpdateShade(void)
+{
+  int i;
+  int specular = _flags.Get(GF_SPECULAR);
+
+  for(i=0; i<=SHADE_VALUES; i++)
+    {
+      int c = i << SHADE_SHIFT;
+      if(specular)
+	{
+	  _shade_d[i] = (c * _KD) >> M_SHIFT;
+	  _shade_s[i] = (Specular(c) * _KS) >> M_SHIFT;
+	}
+      else
+	{
+	  _shade_d[i] = c;
+	  _shade_s[i] = 0;
+	}
+      _shade_c[i] = Gamma(_shade_d[i] + _shade_s[i]) >> (M_SHIFT - 6 - D_SHIFT);
+    }
+
+  _shade_key[0] = specular;
+  _shade_key[1] = _KD;
+  _shade_key[2] = _KS;
+  _shade_key[3] = _spec_factor;
+  _shade_key[4] = _gamma_stamp;
+}
+
@@ -51,6 +51,9 @@ const int GAMMA_VALUES = 1024;
 const int GAMMA_SHIFT  = 8;   // 4 for M_BIG + 4 for 16 lamps.
 const int GAMMA_MAX    = GAMMA_VALUES << GAMMA_SHIFT;
 
+const int SHADE_VALUES = 1024;  // entries of the shading tables, for N.L
+const int SHADE_SHIFT  = 4;     // in 0..M_BIG (see Shade())
+
 const Flag GF_NONE     = 0;
 const Flag GF_SPECULAR = 1;
 const Flag GF_MAX      = GF_SPECULAR;
@@ -134,6 +137,12 @@ class GraphicObject
   int Specular(int x);  // x = 0..M_BIG
   int Gamma(int x);     // x = 0..M_BIG
 
+  // UseShade() makes the shading tables match the material of this
+  // object, then Shade() gives the index in the tables from N.L (both
+  // vectors of length M_BIG).
+  void UseShade(void);
+  int  Shade(int NL);
+
 // Material properties
 
   virtual void Shiny(gfloat factor, gfloat lambertian, gfloat specular);
@@ -160,10 +169,26 @@ class GraphicObject
   static void ZoomOut(void);
   static MVector& LightDirection(void);
 
+  // Pixels per unit of current space, in the mapping of Project()
+  // (0 before SetGeometry()).
+  static double PixelScale(void);
+
+  // Level of detail: the objects that have several tessellations
+  // (SmoothTriangle) draw the finest one whose triangles are not
+  // smaller than lod pixels on the screen. 0 always draws the finest.
+  static void SetLOD(int lod);
+  static int  GetLOD(void);
+
  protected:
 
   static void Project(MVertex *V);
 
+  // Tells whether a sphere (current space) is projected entirely
+  // outside of the clipping rectangle of the port, or of its z
+  // clipping planes when the engine clips in z: then the object
+  // is not transformed nor drawn.
+  static int Outside(PolygonEngine *PE, int x, int y, int z, int r);
+
   static int _width;
   static int _height;
   static MVector _L;
@@ -172,6 +197,7 @@ class GraphicObject
 
   static int _zoom;
   static int _zoom_step;
+  static int _lod;
 
   Flags _flags;
 
@@ -184,6 +210,20 @@ class GraphicObject
  
   int _KS;                    // specular factor
   int _KD;                    // diffuse factor
+  int _spec_factor;           // specular exponent, times 1024
+
+  // Shading tables, indexed by (N.L) >> SHADE_SHIFT: lighting is a
+  // table lookup per vertex (or face), in integer arithmetic only.
+  // They are shared by all the objects with the same material (for
+  // instance all the patches of a SmoothMesh) and computed again 
+  // when an object with another material uses them.
+  void UpdateShade(void);
+
+  static int _shade_c[SHADE_VALUES + 1];  // colormap code (with D_SHIFT)
+  static int _shade_d[SHADE_VALUES + 1];  // diffuse term  (M_BIG = 1.0)
+  static int _shade_s[SHADE_VALUES + 1];  // specular term (M_BIG = 1.0)
+  static int _shade_key[5];               // material of the tables
+  static int _gamma_stamp;                // changed by GammaRamp()
 
 };
 
@@ -29,19 +29,42 @@
 
 #include "mesh.h"
 #include <string.h>
+#include <math.h>
+#include <assert.h>
 #include "texture.h"
+#define LITE_SERVICES_OVERRIDE
+#include <lite_services.h>
 
 static const int verbose = 1;
 
-// I do not use MVector::RotX cause it would call Sin() and Cos() 
-// for each vertex ...
+// Fixed point matrices of the transform pass. The coordinates of the
+// vertices stay below 40000, so that the products fit in 32 bits.
+static const int MAT_SHIFT = 14;
+
+static inline int FixMat(double x)
+{
+  return (int)floor(x * (double)(1 << MAT_SHIFT) + 0.5);
+}
 
 Mesh::Mesh(void)
 {
   _vertex  = NULL;
   _face    = NULL;
+  _corner  = NULL;
   _nvertex = 0;
   _nface   = 0;
+  _model       = NULL;
+  _model_size  = 0;
+  _model_valid = 0;
+  _positions_pending = 0;
+  _normals_pending   = 0;
+  _sphere_x = _sphere_y = _sphere_z = _sphere_r = 0;
+  _face_visible   = NULL;
+  _vertex_visible = NULL;
+  _cull_valid  = 0;
+  _cull_stamp  = 0;
+  _lit_stamp   = 0;
+  _stack_idx   = 0;
   _resources  = MR_NONE;
   _error_code = ME_NONE;
   _flags      = MF_NONE;
@@ -50,123 +73,441 @@ Mesh::Mesh(void)
 
 Mesh::~Mesh(void)
 {
+  if(_resources.Get(MR_CORNERS))
+    {
+      // faces point in _corner, they do not own their vertex array
+      for(int i=0; i<_nface; i++)
+	_face[i].vertex = NULL;
+      delete[] _corner;
+    }
   if(_resources.Get(MR_FACES))
     delete[] _face;
   if(_resources.Get(MR_VERTICES))
     delete[] _vertex;
+  delete[] _model;
 }
 
+// Copies the current geometry to the model space arrays, with
+// identity matrices, if it was not done since the last Invalidate().
 
-
-void Mesh::RotX(Angle r)
+void Mesh::Capture(void)
 {
-  int i;
-  long s = Sin(r),c = Cos(r);
-  long t1, t2;
+  int i,j;
+
+  if(_model_valid)
+    return;
 
+  int size = 7 * _nvertex + 4 * _nface;
+  if(size > _model_size)
+    {
+      delete[] _model;
+      _model      = new int[size];
+      _model_size = size;
+    }
+
+  _mx  = _model;
+  _my  = _mx  + _nvertex;
+  _mz  = _my  + _nvertex;
+  _mnx = _mz  + _nvertex;
+  _mny = _mnx + _nvertex;
+  _mnz = _mny + _nvertex;
+  _mfx = _mnz + _nvertex;
+  _mfy = _mfx + _nface;
+  _mfz = _mfy + _nface;
+  _face_visible   = _mfz + _nface;
+  _vertex_visible = _face_visible + _nface;
+
+  for(i=0; i<_nvertex; i++)
+    {
+      _mx[i]  = _vertex[i].x;
+      _my[i]  = _vertex[i].y;
+      _mz[i]  = _vertex[i].z;
+      _mnx[i] = _vertex[i].N.x;
+      _mny[i] = _vertex[i].N.y;
+      _mnz[i] = _vertex[i].N.z;
+    }
 
-  for(i=0; i < _nvertex; i++)
+  for(i=0; i<_nface; i++)
     {
-      t1 = _vertex[i].y;
-      t2 = _vertex[i].z;
-      _vertex[i].y = (int)(( c * t1 + s * t2) >> SIN_SHIFT);
-      _vertex[i].z = (int)((-s * t1 + c * t2) >> SIN_SHIFT);
+      _mfx[i] = _face[i].N.x;
+      _mfy[i] = _face[i].N.y;
+      _mfz[i] = _face[i].N.z;
+    }
 
-      if(_resources.Get(MR_SMOOTH))
+  for(i=0; i<3; i++)
+    for(j=0; j<4; j++)
+      {
+	_M[i][j] = (i == j) ? 1.0 : 0.0;
+	if(j < 3)
+	  _R[i][j] = (i == j) ? 1.0 : 0.0;
+      }
+
+  // Bounding sphere: center of the bounding box, and the largest
+  // distance to a vertex (plus one, for the roundings).
+  if(_nvertex > 0)
+    {
+      int xmin = _mx[0], xmax = _mx[0];
+      int ymin = _my[0], ymax = _my[0];
+      int zmin = _mz[0], zmax = _mz[0];
+      for(i=1; i<_nvertex; i++)
 	{
-	  t1 = _vertex[i].N.y;
-	  t2 = _vertex[i].N.z;
-	  _vertex[i].N.y = (int)(( c * t1 + s * t2) >> SIN_SHIFT);
-	  _vertex[i].N.z = (int)((-s * t1 + c * t2) >> SIN_SHIFT);
+	  if(_mx[i] < xmin) xmin = _mx[i];
+	  if(_mx[i] > xmax) xmax = _mx[i];
+	  if(_my[i] < ymin) ymin = _my[i];
+	  if(_my[i] > ymax) ymax = _my[i];
+	  if(_mz[i] < zmin) zmin = _mz[i];
+	  if(_mz[i] > zmax) zmax = _mz[i];
 	}
+      _sphere_x = (xmin + xmax) / 2;
+      _sphere_y = (ymin + ymax) / 2;
+      _sphere_z = (zmin + zmax) / 2;
+      double r2 = 0.0;
+      for(i=0; i<_nvertex; i++)
+	{
+	  double dx = (double)(_mx[i] - _sphere_x);
+	  double dy = (double)(_my[i] - _sphere_y);
+	  double dz = (double)(_mz[i] - _sphere_z);
+	  double d2 = dx*dx + dy*dy + dz*dz;
+	  if(d2 > r2)
+	    r2 = d2;
+	}
+      _sphere_r = (int)ceil(sqrt(r2)) + 1;
     }
 
-  for(i=0; i < _nface; i++)
+  _model_valid = 1;
+  _cull_valid  = 0;
+}
+
+void Mesh::Invalidate(void)
+{
+  _model_valid = 0;
+  _cull_valid  = 0;
+  _positions_pending = 0;
+  _normals_pending   = 0;
+}
+
+// Sine and cosine from the tables, normalized so that the rotations
+// accumulated in the matrices do not shrink the object.
+
+static inline void SinCos(Angle r, double& s, double& c)
+{
+  s = (double)Sin(r);
+  c = (double)Cos(r);
+  double k = 1.0 / sqrt(s*s + c*c);
+  s *= k;
+  c *= k;
+}
+
+// Composes a rotation with the matrices (R is applied after them).
+
+void Mesh::Transform(const double R[3][3])
+{
+  int i,j;
+  double M[3][4];
+  double N[3][3];
+
+  Capture();
+
+  for(i=0; i<3; i++)
+    for(j=0; j<4; j++)
+      {
+	M[i][j] = R[i][0]*_M[0][j] + R[i][1]*_M[1][j] + R[i][2]*_M[2][j];
+	if(j < 3)
+	  N[i][j] = R[i][0]*_R[0][j] + R[i][1]*_R[1][j] + R[i][2]*_R[2][j];
+      }
+
+  memcpy(_M, M, sizeof(M));
+  memcpy(_R, N, sizeof(N));
+
+  _positions_pending = 1;
+  _normals_pending   = 1;
+  _cull_valid        = 0;
+}
+
+void Mesh::RotX(Angle r)
+{
+  double s, c;
+  SinCos(r, s, c);
+  const double R[3][3] = {
+    { 1.0, 0.0, 0.0 },
+    { 0.0,   c,   s },
+    { 0.0,  -s,   c }
+  };
+  Transform(R);
+}
+
+void Mesh::RotY(Angle r)
+{
+  double s, c;
+  SinCos(r, s, c);
+  const double R[3][3] = {
+    {   c, 0.0,   s },
+    { 0.0, 1.0, 0.0 },
+    {  -s, 0.0,   c }
+  };
+  Transform(R);
+}
+
+void Mesh::RotZ(Angle r)
+{
+  double s, c;
+  SinCos(r, s, c);
+  const double R[3][3] = {
+    {   c,   s, 0.0 },
+    {  -s,   c, 0.0 },
+    { 0.0, 0.0, 1.0 }
+  };
+  Transform(R);
+}
+
+void Mesh::Translate(int tx, int ty, int tz)
+{
+  Capture();
+  _M[0][3] += tx;
+  _M[1][3] += ty;
+  _M[2][3] += tz;
+  _positions_pending = 1;
+}
+
+void Mesh::Scale(double sx, double sy, double sz)
+{
+  int j;
+  Capture();
+  for(j=0; j<4; j++)
     {
-      t1 = _face[i].N.y;
-      t2 = _face[i].N.z;
-      _face[i].N.y = (int)(( c * t1 + s * t2) >> SIN_SHIFT);
-      _face[i].N.z = (int)((-s * t1 + c * t2) >> SIN_SHIFT);
+      _M[0][j] *= sx;
+      _M[1][j] *= sy;
+      _M[2][j] *= sz;
     }
+  _positions_pending = 1;
 }
 
+void Mesh::PushMatrix(void)
+{
+  assert(_stack_idx < MESH_STACK_SZ);
+  Capture();
+  memcpy(_stack_M[_stack_idx], _M, sizeof(_M));
+  memcpy(_stack_R[_stack_idx], _R, sizeof(_R));
+  _stack_idx++;
+}
 
-void Mesh::RotY(Angle r)
+void Mesh::PopMatrix(void)
+{
+  assert(_stack_idx > 0);
+  Capture();
+  _stack_idx--;
+  memcpy(_M, _stack_M[_stack_idx], sizeof(_M));
+  memcpy(_R, _stack_R[_stack_idx], sizeof(_R));
+  _positions_pending = 1;
+  _normals_pending   = 1;
+  _cull_valid        = 0;
+}
+
+void Mesh::LoadIdentity(void)
+{
+  int i,j;
+  Capture();
+  for(i=0; i<3; i++)
+    for(j=0; j<4; j++)
+      {
+	_M[i][j] = (i == j) ? 1.0 : 0.0;
+	if(j < 3)
+	  _R[i][j] = (i == j) ? 1.0 : 0.0;
+      }
+  _positions_pending = 1;
+  _normals_pending   = 1;
+  _cull_valid        = 0;
+}
+
+void Mesh::LoadMatrix(GMatrix& M)
+{
+  int i,j;
+  Capture();
+  for(i=0; i<3; i++)
+    for(j=0; j<4; j++)
+      _M[i][j] = (double)M(j,i).fget();
+
+  // The normals use the rotation, without the scaling.
+  double det = 
+    _M[0][0] * (_M[1][1]*_M[2][2] - _M[1][2]*_M[2][1]) -
+    _M[0][1] * (_M[1][0]*_M[2][2] - _M[1][2]*_M[2][0]) +
+    _M[0][2] * (_M[1][0]*_M[2][1] - _M[1][1]*_M[2][0]);
+  double k = (det != 0.0) ? 1.0 / cbrt(fabs(det)) : 1.0;
+  for(i=0; i<3; i++)
+    for(j=0; j<3; j++)
+      _R[i][j] = k * _M[i][j];
+
+  _positions_pending = 1;
+  _normals_pending   = 1;
+  _cull_valid        = 0;
+}
+
+void Mesh::GetMatrix(GMatrix& M)
+{
+  int i,j;
+  Capture();
+  M.LoadZero();
+  for(i=0; i<3; i++)
+    for(j=0; j<4; j++)
+      M(j,i).lod(_M[i][j]);
+  M(3,3).lod(1.0);
+}
+
+// Vertices, from the model space arrays, and their projection if
+// project is set (done even when the vertices did not change). With
+// cull, only the vertices selected by Cull(), the other ones are still
+// pending.
+
+void Mesh::TransformPositions(int project, int cull)
 {
   int i;
-  long s = Sin(r),c = Cos(r);
-  long t1,t2;
 
-  for(i=0; i < _nvertex; i++)
+  if(!_positions_pending)
     {
-      t1 = _vertex[i].x;
-      t2 = _vertex[i].z;
-      _vertex[i].x = (int)(( c * t1 + s * t2) >> SIN_SHIFT);
-      _vertex[i].z = (int)((-s * t1 + c * t2) >> SIN_SHIFT);
-
-      if(_resources.Get(MR_SMOOTH))
-	{
-	  t1 = _vertex[i].N.x;
-	  t2 = _vertex[i].N.z;
-	  _vertex[i].N.x = (int)(( c * t1 + s * t2) >> SIN_SHIFT);
-	  _vertex[i].N.z = (int)((-s * t1 + c * t2) >> SIN_SHIFT);
-	}
+      if(project)
+	for(i=0; i<_nvertex; i++)
+	  if(!cull || _vertex_visible[i])
+	    Project(&_vertex[i]);
+      return;
     }
 
-  for(i=0; i < _nface; i++)
+  int m00 = FixMat(_M[0][0]), m01 = FixMat(_M[0][1]), m02 = FixMat(_M[0][2]);
+  int m10 = FixMat(_M[1][0]), m11 = FixMat(_M[1][1]), m12 = FixMat(_M[1][2]);
+  int m20 = FixMat(_M[2][0]), m21 = FixMat(_M[2][1]), m22 = FixMat(_M[2][2]);
+  int tx = (int)floor(_M[0][3] + 0.5);
+  int ty = (int)floor(_M[1][3] + 0.5);
+  int tz = (int)floor(_M[2][3] + 0.5);
+
+  for(i=0; i<_nvertex; i++)
     {
-      t1 = _face[i].N.x;
-      t2 = _face[i].N.z;
-      _face[i].N.x = (int)(( c * t1 + s * t2) >> SIN_SHIFT);
-      _face[i].N.z = (int)((-s * t1 + c * t2) >> SIN_SHIFT);
+      if(cull && !_vertex_visible[i])
+	continue;
+      int x = _mx[i];
+      int y = _my[i];
+      int z = _mz[i];
+      MVertex* V = &_vertex[i];
+      V->x = ((m00 * x + m01 * y + m02 * z) >> MAT_SHIFT) + tx;
+      V->y = ((m10 * x + m11 * y + m12 * z) >> MAT_SHIFT) + ty;
+      V->z = ((m20 * x + m21 * y + m22 * z) >> MAT_SHIFT) + tz;
+      if(project)
+	Project(V);
     }
+
+  if(!cull)
+    _positions_pending = 0;
 }
 
-void Mesh::RotZ(Angle r)
+// Face normals, and vertex normals of smooth meshes (with cull, only
+// the ones selected by Cull()).
+
+void Mesh::TransformNormals(int cull)
 {
   int i;
-  long s = Sin(r),c = Cos(r);
-  long t1, t2;
 
-  for(i=0; i < _nvertex; i++)
-    {
-      t1 = _vertex[i].x;
-      t2 = _vertex[i].y;
-      _vertex[i].x = (int)(( c * t1 + s * t2) >> SIN_SHIFT);
-      _vertex[i].y = (int)((-s * t1 + c * t2) >> SIN_SHIFT);
+  if(!_normals_pending)
+    return;
 
-      if(_resources.Get(MR_SMOOTH))
-	{
-	  t1 = _vertex[i].N.x;
-	  t2 = _vertex[i].N.y;
-	  _vertex[i].N.x = (int)(( c * t1 + s * t2) >> SIN_SHIFT);
-	  _vertex[i].N.y = (int)((-s * t1 + c * t2) >> SIN_SHIFT);
-	}
-    }
+  int r00 = FixMat(_R[0][0]), r01 = FixMat(_R[0][1]), r02 = FixMat(_R[0][2]);
+  int r10 = FixMat(_R[1][0]), r11 = FixMat(_R[1][1]), r12 = FixMat(_R[1][2]);
+  int r20 = FixMat(_R[2][0]), r21 = FixMat(_R[2][1]), r22 = FixMat(_R[2][2]);
 
-  for(i=0; i < _nface; i++)
+  if(_resources.Get(MR_SMOOTH))
+    for(i=0; i<_nvertex; i++)
+      {
+	if(cull && !_vertex_visible[i])
+	  continue;
+	int x = _mnx[i];
+	int y = _mny[i];
+	int z = _mnz[i];
+	_vertex[i].N.x = (r00 * x + r01 * y + r02 * z) >> MAT_SHIFT;
+	_vertex[i].N.y = (r10 * x + r11 * y + r12 * z) >> MAT_SHIFT;
+	_vertex[i].N.z = (r20 * x + r21 * y + r22 * z) >> MAT_SHIFT;
+      }
+
+  for(i=0; i<_nface; i++)
     {
-      t1 = _face[i].N.x;
-      t2 = _face[i].N.y;
-      _face[i].N.x = (int)(( c * t1 + s * t2) >> SIN_SHIFT);
-      _face[i].N.y = (int)((-s * t1 + c * t2) >> SIN_SHIFT);
+      if(cull && !_face_visible[i])
+	continue;
+      int x = _mfx[i];
+      int y = _mfy[i];
+      int z = _mfz[i];
+      _face[i].N.x = (r00 * x + r01 * y + r02 * z) >> MAT_SHIFT;
+      _face[i].N.y = (r10 * x + r11 * y + r12 * z) >> MAT_SHIFT;
+      _face[i].N.z = (r20 * x + r21 * y + r22 * z) >> MAT_SHIFT;
     }
+
+  if(!cull)
+    _normals_pending = 0;
 }
 
-void Mesh::Translate(int tx, int ty, int tz)
+void Mesh::Transform(void)
 {
-  int i;
-  for(i=0; i<_nvertex; i++)
-    _vertex[i].Translate(tx, ty, tz);
+  TransformNormals();
+  TransformPositions(0);
 }
 
-void Mesh::Scale(double sx, double sy, double sz)
+int Mesh::Culling(void)
 {
-  int i;
-  for(i=0; i<_nvertex; i++)
-    _vertex[i].Scale(sx, sy, sz);
+  return _flags.Get(MF_CLOSED) && (_nface > 0);
 }
 
+// A face is drawn when N.z < 0 (see Draw()), N.z is computed the same
+// way as in TransformNormals(), without the x and y components.
+
+void Mesh::Cull(void)
+{
+  int i,j;
+
+  Capture();
+  if(_cull_valid)
+    return;
+
+  int r20 = FixMat(_R[2][0]), r21 = FixMat(_R[2][1]), r22 = FixMat(_R[2][2]);
+
+  memset(_vertex_visible, 0, _nvertex * sizeof(int));
+
+  for(i=0; i<_nface; i++)
+    {
+      int visible = ((r20 * _mfx[i] + r21 * _mfy[i] + r22 * _mfz[i]) >> MAT_SHIFT) < 0;
+      _face_visible[i] = visible;
+      if(visible)
+	for(j=0; j<_face[i].nvertex; j++)
+	  _vertex_visible[_face[i].vertex[j] - _vertex] = 1;
+    }
+
+  _cull_valid = 1;
+  _cull_stamp++;
+}
+
+// Upper bound of the scaling factor of the matrix (the square root
+// of a Gershgorin bound of the eigenvalues of M^t M), exact for the
+// rotations and uniform scalings.
+
+static double MaxScale(const double M[3][4])
+{
+  int i,j;
+  double B[3][3];
+  for(i=0; i<3; i++)
+    for(j=0; j<3; j++)
+      B[i][j] = M[0][i]*M[0][j] + M[1][i]*M[1][j] + M[2][i]*M[2][j];
+  double result = 0.0;
+  for(i=0; i<3; i++)
+    {
+      double row = B[i][i];
+      for(j=0; j<3; j++)
+	if(j != i)
+	  row += fabs(B[i][j]);
+      if(row > result)
+	result = row;
+    }
+  return sqrt(result);
+}
+
+int Mesh::ScreenRadius(void)
+{
+  Capture();
+  return (int)(MaxScale(_M) * (double)_sphere_r * PixelScale());
+}
 
 void Mesh::Setup(PolygonEngine *PE)
 {
@@ -200,9 +541,29 @@ void Mesh::Draw(PolygonEngine *PE)
 
   PE->CommitAttributes();
 
+  // Bounding sphere rejection, before transforming anything
+  Capture();
+  int sx = (int)floor(_M[0][0]*_sphere_x + _M[0][1]*_sphere_y + _M[0][2]*_sphere_z + _M[0][3] + 0.5);
+  int sy = (int)floor(_M[1][0]*_sphere_x + _M[1][1]*_sphere_y + _M[1][2]*_sphere_z + _M[1][3] + 0.5);
+  int sz = (int)floor(_M[2][0]*_sphere_x + _M[2][1]*_sphere_y + _M[2][2]*_sphere_z + _M[2][3] + 0.5);
+  int sr = (int)ceil(MaxScale(_M) * (double)_sphere_r) + 2;
+  if(_nvertex > 0 && Outside(PE, sx, sy, sz, sr))
+    {
+      PE->PopAttributes();
+      return;
+    }
+
+  // The colors of the faces that are drawn need to be lit (the ones
+  // of the faces culled by the last Lighting() are not).
+  int cull = Culling();
+  if(cull)
+    Cull();
+  if(_lit_stamp != 0 && (!cull || _lit_stamp != _cull_stamp))
+    Light(cull);
 
-  for(i=0; i<_nvertex; i++)
-    Project(&_vertex[i]);
+  if(!cull)
+    TransformNormals();
+  TransformPositions(1, cull);
 
 
   int kaos    = (!_flags.Get(MF_CONVEX)) && (!_flags.Get(MF_CLOSED));
@@ -232,7 +593,7 @@ void Mesh::Draw(PolygonEngine *PE)
 
   for(i=0; i<_nface; i++)
     {
-      if(kaos || (_face[i].N.z < 0))
+      if(kaos || (cull ? _face_visible[i] : (_face[i].N.z < 0)))
 	{
 	  PE->VAttributes().c = _face[i].c;
 	  PE->VAttributes().r = _face[i].r;
@@ -254,6 +615,39 @@ void Mesh::Draw(PolygonEngine *PE)
 
 }
 
+void Mesh::Record(GeometryManager *GM)
+{
+  int i,j;
+  int smooth = _flags.Get(MF_SMOOTH) || _flags.Get(MF_BLEND);
+
+  // All the faces are recorded, with their colors
+  if(_lit_stamp != 0)
+    Light(0);
+
+  Transform();
+
+  for(i=0; i<_nface; i++)
+    {
+      GM->Begin(GBE_POLYGON);
+      if(!smooth)
+	{
+	  GM->Color(_face[i].r, _face[i].g, _face[i].b);
+	  GM->Color((gfloat)_face[i].c / (gfloat)(1 << D_SHIFT));
+	}
+      for(j=0; j<_face[i].nvertex; j++)
+	{
+	  MVertex* V = _face[i].vertex[j];
+	  if(smooth)
+	    {
+	      GM->Color(V->Projection.r, V->Projection.g, V->Projection.b);
+	      GM->Color((gfloat)V->Projection.c / (gfloat)(1 << D_SHIFT));
+	    }
+	  GM->Vertex((gfloat)V->x, (gfloat)V->y, (gfloat)V->z);
+	}
+      GM->End();
+    }
+}
+
 void Mesh::Lighting(void)
 {
 
@@ -271,128 +665,63 @@ void Mesh::Lighting(void)
   // It will be easy to use this function and add ambiant lighting, fog,
   // and so on ...
 
+  Light(Culling());
+}
+
+// Lighting(), of the faces (or vertices) selected by Cull() if cull
+// is set.
+
+void Mesh::Light(int cull)
+{
   int i;
-  int specular = Mode().Get(GF_SPECULAR);
+
+  if(cull)
+    Cull();
+  TransformNormals(cull);
+  UseShade();
 
   if(_flags.Get(MF_SMOOTH))
     for(i=0; i<_nvertex; i++)
       {
-	int c = _L.x * _vertex[i].N.x +
-	        _L.y * _vertex[i].N.y +
-                _L.z * _vertex[i].N.z ;
-
-	if(c < 0)
-	  c = 0;
-	else
-          c >>= M_SHIFT;
-
-	int s = 0;
-
-	if(specular)
-	  s = Specular(c);
-
+	if(cull && !_vertex_visible[i])
+	  continue;
+	int k = Shade(_L.x * _vertex[i].N.x +
+		      _L.y * _vertex[i].N.y +
+		      _L.z * _vertex[i].N.z);
 
 	if(_flags.Get(MF_COLOR))
 	  {
-	    _vertex[i].Projection.r = (_vertex[i].r * c) >> 8;
-	    _vertex[i].Projection.g = (_vertex[i].g * c) >> 8;
-	    _vertex[i].Projection.b = (_vertex[i].b * c) >> 8;
-
-	    if(specular)
-	      {
-		s *= _KS;
-
-		_vertex[i].Projection.r *= _KD;
-		_vertex[i].Projection.g *= _KD;	    
-		_vertex[i].Projection.b *= _KD;
-
-		_vertex[i].Projection.r += s;
-		_vertex[i].Projection.g += s;
-		_vertex[i].Projection.b += s;
-
-		_vertex[i].Projection.r >>= M_SHIFT;
-		_vertex[i].Projection.g >>= M_SHIFT;
-		_vertex[i].Projection.b >>= M_SHIFT;
-	      }
-	    _vertex[i].Projection.r = Gamma(_vertex[i].Projection.r) >> (M_SHIFT - 8);
-	    _vertex[i].Projection.g = Gamma(_vertex[i].Projection.g) >> (M_SHIFT - 8);
-	    _vertex[i].Projection.b = Gamma(_vertex[i].Projection.b) >> (M_SHIFT - 8);
+	    int d = _shade_d[k];
+	    int s = _shade_s[k];
+	    _vertex[i].Projection.r = Gamma(((_vertex[i].r * d) >> 8) + s) >> (M_SHIFT - 8);
+	    _vertex[i].Projection.g = Gamma(((_vertex[i].g * d) >> 8) + s) >> (M_SHIFT - 8);
+	    _vertex[i].Projection.b = Gamma(((_vertex[i].b * d) >> 8) + s) >> (M_SHIFT - 8);
 	  }
 	else
-	  {
-	    _vertex[i].Projection.c = c;
-	    if(specular)
-	      {
-		s *= _KS;
-
-		_vertex[i].Projection.c *= _KD;
-		_vertex[i].Projection.c += s;
-		_vertex[i].Projection.c >>= M_SHIFT;
-	      }
-	    _vertex[i].Projection.c = Gamma((int)_vertex[i].Projection.c) >> (M_SHIFT - 6 - D_SHIFT);
-	  }
+	  _vertex[i].Projection.c = _shade_c[k];
       }
   else
     for(i=0; i<_nface; i++)
       {
-	int c = _L.x * _face[i].N.x +
-	        _L.y * _face[i].N.y +
-                _L.z * _face[i].N.z ;
-
-//	printf("%d    %d %d %d    %d %d %d    %d\n",i,_L.x,_L.y,_L.z,_face[i].N.x,_face[i].N.y,_face[i].N.z,c);
-	 
-	int s = 0;
-
-	if(c<0)
-	  c = 0;
-	else
-	  c >>= M_SHIFT;
-
-	if(specular)
-	  s = Specular(c);
-
+	if(cull && !_face_visible[i])
+	  continue;
+	int k = Shade(_L.x * _face[i].N.x +
+		      _L.y * _face[i].N.y +
+		      _L.z * _face[i].N.z);
 
 	if(_flags.Get(MF_COLOR))
 	  {
-	    _face[i].r = (_face[i].or_ * c) >> 8;
-	    _face[i].g = (_face[i].og * c) >> 8;
-	    _face[i].b = (_face[i].ob * c) >> 8;
-
-	    if(specular)
-	      {
-		s *= _KS;
-		
-		_face[i].r *= _KD;
-		_face[i].g *= _KD;
-		_face[i].b *= _KD;
-
-		_face[i].r += s;
-		_face[i].g += s;
-		_face[i].b += s;
-
-		_face[i].r >>= M_SHIFT;
-		_face[i].g >>= M_SHIFT;
-		_face[i].b >>= M_SHIFT;
-	      }
-
-	    _face[i].r = Gamma(_face[i].r) >> (M_SHIFT - 8);
-	    _face[i].g = Gamma(_face[i].g) >> (M_SHIFT - 8);
-	    _face[i].b = Gamma(_face[i].b) >> (M_SHIFT - 8);
+	    int d = _shade_d[k];
+	    int s = _shade_s[k];
+	    _face[i].r = Gamma(((_face[i].or_ * d) >> 8) + s) >> (M_SHIFT - 8);
+	    _face[i].g = Gamma(((_face[i].og  * d) >> 8) + s) >> (M_SHIFT - 8);
+	    _face[i].b = Gamma(((_face[i].ob  * d) >> 8) + s) >> (M_SHIFT - 8);
 	  }
 	else
-	  {
-	    _face[i].c = c;
-	    if(specular)
-	      {
-		s *= _KS;
-		_face[i].c *= _KD;
-		_face[i].c += s;
-		_face[i].c >>= M_SHIFT;
-	      }
-	    _face[i].c = Gamma((int)_face[i].c) >> (M_SHIFT - 6 - D_SHIFT);
-	  }
-	 // printf("%d     %d %d %d   %d\n",i,_face[i].r, _face[i].g, _face[i].b, _face[i].c);
+	  _face[i].c = _shade_c[k];
       }
+
+  _lit_stamp = cull ? _cull_stamp : 0;
 }
 
 void Mesh::ResetColors(void)
@@ -427,6 +756,10 @@ void Mesh::ResetColors(void)
 	    _face[i].b = Gamma(_face[i].b) >> (M_SHIFT - 8);
 	  }
       }
+
+  // All the colors are set (the culled faces too)
+  if(_flags.Get(MF_COLOR))
+    _lit_stamp = 0;
 }
 
 
@@ -434,6 +767,8 @@ void Mesh::ResetColors(void)
 void Mesh::InvertNormals(void)
 {
   int i;
+
+  Transform();
   
   for(i=0; i < _nface; i++)
     {
@@ -450,6 +785,7 @@ void Mesh::InvertNormals(void)
 	_vertex[i].N.z = -_vertex[i].N.z;
       }
 
+  Invalidate();
 }
 
 void Mesh::ComputeNormals(void)
@@ -459,6 +795,8 @@ void Mesh::ComputeNormals(void)
   double k;
   int i0, i1, i2;
 
+  Transform();
+
   for(i=0; i < _nface; i++)
     {
       
@@ -503,6 +841,8 @@ void Mesh::ComputeNormals(void)
       _face[i].N.y = (int)N.y;
       _face[i].N.z = (int)N.z;
     }
+
+  Invalidate();
 }
 
 inline int Mesh::InFace(MFace *F, MVertex *V)
@@ -517,6 +857,9 @@ inline int Mesh::InFace(MFace *F, MVertex *V)
 void Mesh::Smooth(void)
 {
   int i,j;
+
+  Transform();
+
   for(i=0; i<_nvertex; i++)
     {
       _vertex[i].N.x = 0;
@@ -536,6 +879,7 @@ void Mesh::Smooth(void)
     _vertex[i].N.Normalize();
 
   _resources.Set(MR_SMOOTH);
+  Invalidate();
 }
 
 void Mesh::Blend(void)
@@ -593,6 +937,8 @@ void
 Mesh::EnvironMap(void)
 {
   int i; 
+
+  TransformNormals();
   for(i=0; i<_nvertex; i++)
      {
 	_vertex[i].Projection.X = (M_BIG - _vertex[i].N.x) * size / (M_BIG * 2);
@@ -610,6 +956,8 @@ void
 Mesh::TextureMap(char axis, float mult)
 {
    int i;
+
+   TransformPositions(0);
    
    
    switch(axis)
@@ -726,6 +1074,18 @@ void Mesh::load_geometry(const char* filename) {
      M._error_code = ME_EOF;
      return;
   }
+
+  MeshBin_Header H;
+  UINT br;
+  if(
+     f_read(&input, &H, sizeof(H), &br) == FR_OK && 
+     br == sizeof(H) && H.magic == MESHBIN_MAGIC
+  ) {
+     load_binary(input, H);
+     f_close(&input);
+     return;
+  }
+  f_lseek(&input, 0);
    
       if(check_eof(input, M))
 	return;
@@ -876,6 +1236,124 @@ void Mesh::load_geometry(const char* filename) {
       f_close(&input);
  }
 
+void Mesh::load_binary(FIL& input, const MeshBin_Header& H) {
+  Mesh& M = *this;
+  UINT size = meshbin_size(&H) - sizeof(H);
+  UINT br;
+  int i;
+  uint32_t j;
+
+  static_assert(MESHBIN_ONE == M_BIG, "binary mesh normals scale");
+
+  if(verbose)
+     printf("loading binary object ...\n");
+
+  if(f_size(&input) != meshbin_size(&H))
+    {
+      M._error_code = ME_SNTX;
+      return;
+    }
+
+  // All the arrays in one read, then copied to the vertices and faces.
+  uint32_t* data = new uint32_t[size/4];
+  if(!data)
+    {
+      M._error_code = ME_MALLOC;
+      return;
+    }
+
+  if(f_read(&input, data, size, &br) != FR_OK || br != size)
+    {
+      delete[] data;
+      M._error_code = ME_EOF;
+      return;
+    }
+
+  const int32_t*  vertex = (const int32_t*)data;
+  const int32_t*  normal = vertex + 3 * H.nb_vertices;
+  const uint32_t* face   = (const uint32_t*)(normal + 3 * H.nb_faces);
+  const uint32_t* corner = face + H.nb_faces + 1;
+  const uint32_t* color  = corner + H.nb_corners;
+
+  if(face[0] != 0 || face[H.nb_faces] != H.nb_corners)
+    M._error_code = ME_SNTX;
+  for(i=0; i<(int)H.nb_faces; i++)
+    if(face[i+1] < face[i])
+      M._error_code = ME_SNTX;
+  for(j=0; j<H.nb_corners; j++)
+    if(corner[j] >= H.nb_vertices)
+      M._error_code = ME_SNTX;
+
+  if(M._error_code == ME_NONE)
+    {
+      M._vertex = new MVertex[H.nb_vertices];
+      M._face   = new MFace[H.nb_faces];
+      M._corner = new MVertex*[H.nb_corners];
+      if(!M._vertex || !M._face || !M._corner)
+	M._error_code = ME_MALLOC;
+    }
+
+  if(M._error_code != ME_NONE)
+    {
+      delete[] M._corner;
+      delete[] M._face;
+      delete[] M._vertex;
+      M._vertex = NULL;
+      M._face   = NULL;
+      M._corner = NULL;
+      delete[] data;
+      return;
+    }
+
+  M._nvertex = H.nb_vertices;
+  M._nface   = H.nb_faces;
+  M._resources.Set(MR_VERTICES);
+  M._resources.Set(MR_FACES);
+  M._resources.Set(MR_CORNERS);
+
+  if(verbose)
+    {
+      printf("nvertex= %d\n",M._nvertex);
+      printf("nface  = %d\n",M._nface);
+    }
+
+  for(i=0; i<M._nvertex; i++)
+    {
+      M._vertex[i].x = vertex[3*i];
+      M._vertex[i].y = vertex[3*i+1];
+      M._vertex[i].z = vertex[3*i+2];
+    }
+
+  for(j=0; j<H.nb_corners; j++)
+    M._corner[j] = &(M._vertex[corner[j]]);
+
+  for(i=0; i<M._nface; i++)
+    {
+      M._face[i].nvertex = face[i+1] - face[i];
+      M._face[i].vertex  = M._corner + face[i];
+      M._face[i].N.x = normal[3*i];
+      M._face[i].N.y = normal[3*i+1];
+      M._face[i].N.z = normal[3*i+2];
+    }
+
+  if(H.flags & MESHBIN_COLORS)
+    {
+      for(i=0; i<M._nface; i++)
+	{
+	  M._face[i].or_ = (color[i] >> 16) & 255;
+	  M._face[i].og  = (color[i] >>  8) & 255;
+	  M._face[i].ob  =  color[i]        & 255;
+	}
+      M._resources.Set(MR_COLORS);
+    }
+
+  delete[] data;
+  Invalidate();
+
+  if(verbose)
+     printf("sucessfully loaded.\n");
+}
+
 void Mesh::load_colors(const char* filename) {
     int ncolor;
     int nface;
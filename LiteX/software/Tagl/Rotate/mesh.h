@@ -33,6 +33,9 @@
 
 #include "flags.h"
 #include "gobj.h"
+#include "meshbin.h"
+#include "gmatrix.h"
+#include "gman.h"
 #include <libfatfs/ff.h>
 
 const Flag MR_NONE     = 0;
@@ -41,7 +44,10 @@ const Flag MR_FACES    = 2;
 const Flag MR_COLORS   = 3;
 const Flag MR_SMOOTH   = 4;
 const Flag MR_BLEND    = 5;
-const Flag MR_MAX      = MR_BLEND;
+const Flag MR_CORNERS  = 6;
+const Flag MR_MAX      = MR_CORNERS;
+
+const int MESH_STACK_SZ = 8;
 
 const Flag ME_NONE   = 0;
 const Flag ME_MALLOC = 1;
@@ -100,6 +106,36 @@ class Mesh : public GraphicObject
 
   void Setup(PolygonEngine *PE);
 
+  // Radius of the bounding sphere projected on the screen, in pixels
+  // (to choose a level of detail).
+  int ScreenRadius(void);
+
+  // Sends the faces to a GeometryManager, in the current space, with
+  // the current (lit) colors. With a MacroGeometryManager, this makes
+  // a Display List of a mesh that does not deform, replayed without
+  // calling the mesh again.
+  void Record(GeometryManager *GM);
+
+  // RotX() ... Scale() only change a matrix, the vertices and normals
+  // are transformed when they are needed (in one pass per frame, fused
+  // with the projection in Draw()). Transform() updates them now.
+  // Code that changes _vertex or the normals directly calls Transform()
+  // before and Invalidate() after.
+  void Transform(void);
+  void Invalidate(void);
+
+  // Model-view matrix stack, like the one of LocalGeometryManager.
+  // LoadIdentity() goes back to the model space orientation (the one
+  // of the last Invalidate()). LoadMatrix() and GetMatrix() exchange
+  // the matrix with a GeometryManager (GMatrix conventions, vectors
+  // are rows). LoadMatrix() supposes rotations, translations and
+  // uniform scalings only (the normals are not skewed).
+  void PushMatrix(void);
+  void PopMatrix(void);
+  void LoadIdentity(void);
+  void LoadMatrix(GMatrix& M);
+  void GetMatrix(GMatrix& M);
+
   void Smooth(void);
   void Blend(void);
   void White(void);
@@ -116,16 +152,64 @@ class Mesh : public GraphicObject
   MFace*&   Face(void);
   int&      NFace(void);
 
+  // Loads a text .geom file, or a binary .tgm file (see meshbin.h)
   void load_geometry(const char* filename);
   void load_colors(const char* filename);
    
  protected:
   int InFace(MFace *F, MVertex *V);
+  void load_binary(FIL& input, const MeshBin_Header& H);
+
+  void Capture(void);
+  void Transform(const double R[3][3]);
+  void TransformPositions(int project, int cull = 0);
+  void TransformNormals(int cull = 0);
+
+  // Object space culling, when the back faces are not drawn
+  // (MF_CLOSED): Cull() selects the faces that face the eye, from the
+  // model space normals (the projection is orthographic, the eye looks
+  // along z), and the vertices they use. Lighting() and Draw() only
+  // transform, light and project these ones.
+  int  Culling(void);
+  void Cull(void);
+  void Light(int cull);
 
   MVertex*   _vertex;
   int        _nvertex;
   MFace*     _face;
   int        _nface;
+  MVertex**  _corner;   // vertices of all faces, for binary meshes
+
+  // Model space geometry, one array per coordinate (see Capture())
+  int*       _model;
+  int        _model_size;
+  int        *_mx,  *_my,  *_mz;     // vertices
+  int        *_mnx, *_mny, *_mnz;    // vertex normals
+  int        *_mfx, *_mfy, *_mfz;    // face normals
+  int        _model_valid;
+
+  // Bounding sphere, in model space (see GraphicObject::Outside())
+  int        _sphere_x, _sphere_y, _sphere_z, _sphere_r;
+
+  // Faces and vertices selected by Cull(), for the current matrix if
+  // _cull_valid is set. _cull_stamp changes each time they are selected
+  // again, _lit_stamp is the _cull_stamp of the last Lighting() (0 if
+  // it lit all the faces).
+  int        *_face_visible, *_vertex_visible;
+  int        _cull_valid;
+  int        _cull_stamp;
+  int        _lit_stamp;
+
+  // Model space to current space: positions (with the translation) and
+  // normals (no scaling).
+  double     _M[3][4];
+  double     _R[3][3];
+  int        _positions_pending;
+  int        _normals_pending;
+
+  double     _stack_M[MESH_STACK_SZ][3][4];
+  double     _stack_R[MESH_STACK_SZ][3][3];
+  int        _stack_idx;
 
   Flags _resources;
   Flag  _error_code;
@@ -0,0 +1,45 @@
+/*
+ *
+ * meshbin.h
+ *
+ * Binary meshes (.tgm, made from .geom / .ipcol files by Tools/geom2tgm):
+ * a MeshBin_Header, then flat arrays of 32 bits words, ready to be used
+ * by Mesh::load_geometry() after a single read:
+ *
+ *   int32_t  vertex[nb_vertices][3]  TAGL coordinates (centered, radius 10000)
+ *   int32_t  normal[nb_faces][3]     face normals, length MESHBIN_ONE
+ *   uint32_t face[nb_faces+1]        first corner of each face (and end)
+ *   uint32_t corner[nb_corners]      vertex indices (from 0), in TAGL order
+ *   uint32_t color[nb_faces]         0x00RRGGBB, if MESHBIN_COLORS is set
+ *
+ * All fields are little endian.
+ */
+
+#ifndef MESHBIN_H
+#define MESHBIN_H
+
+#include <stdint.h>
+
+#define MESHBIN_MAGIC   0x314D4754 /* "TGM1" */
+#define MESHBIN_COLORS  1          /* flags: has a color per face */
+#define MESHBIN_ONE     16384      /* 1.0 in fixed point, same as M_BIG */
+
+typedef struct {
+  uint32_t magic;
+  uint32_t flags;
+  uint32_t nb_vertices;
+  uint32_t nb_faces;
+  uint32_t nb_corners;
+} MeshBin_Header;
+
+/* Size of a file, header included, in bytes */
+static inline uint32_t meshbin_size(const MeshBin_Header* H) {
+  uint32_t nb_words = 
+    3 * H->nb_vertices + 3 * H->nb_faces + H->nb_faces + 1 + H->nb_corners;
+  if(H->flags & MESHBIN_COLORS) {
+    nb_words += H->nb_faces;
+  }
+  return sizeof(MeshBin_Header) + 4 * nb_words;
+}
+
+#endif
@@ -46,6 +46,8 @@
 
 extern "C" {
 #include <libfatfs/ff.h>
+#define LITE_SERVICES_OVERRIDE
+#include <lite_services.h>
 #include <liblitesdcard/spisdcard.h>
 }
 
@@ -55,6 +57,7 @@ extern "C" {
    void init_peng_x32();
    void init_peng_32xi();
    void init_peng_24();   
+   void init_peng_8();
 }
 
 
@@ -89,6 +92,7 @@ void init_pengs()
    init_peng_x32() ;
 //   init_peng_32xi() ; 
 //   init_peng_24() ;
+   init_peng_8() ;
 }
 
 
@@ -122,6 +126,22 @@ int rlz = 0;
 int rlight = 0;
 int clip_plane = 300;
 
+// Tiled rendering (PolygonEngine::BeginTiles()), with the tile buffers
+// in the sram (see linker.ld).
+int tiles = 0;
+
+// Polygon queue (PolygonEngine::BeginQueue()). LiteOS does not start
+// the second hart, so that the ring is drained by this one (when it is
+// full and before SwapBuffers()).
+int queue = 0;
+
+// 8 bits indexed frames (see LiteXGraphicPort::SetIndexed())
+int indexed = 0;
+static uint32 tile_graph_mem[PE_TILE_WIDTH * PE_TILE_HEIGHT] 
+   __attribute__ ((section (".fastdata")));
+static ZCoord tile_z_mem[PE_TILE_WIDTH * PE_TILE_HEIGHT] 
+   __attribute__ ((section (".fastdata")));
+
 
 char*   geometry_filename = NULL;
 char*   color_filename    = NULL;
@@ -144,6 +164,9 @@ CmdLineArg args[] =
    "-width",   CMD_LINE_INT, 0, &camera_width,      1,
    "-height",  CMD_LINE_INT, 0, &camera_height,     1,
    "-autorot", CMD_LINE_INT, 0, &autorot_treshold,  1,
+   "-tiles",   CMD_LINE_FLG, 0, &tiles,             0,
+   "-queue",   CMD_LINE_FLG, 0, &queue,             0,
+   "-indexed", CMD_LINE_FLG, 0, &indexed,           0,
    "-title",   CMD_LINE_STR, 0, &window_title,      1,
    NULL, 0, 0, 0, 0
 };
@@ -316,6 +339,16 @@ void DoCommand(char q)
 	rx = ry = rz = 0;
       break;
 
+    case 'i':
+      printf("Reset position and orientation\n");
+      m->LoadIdentity();
+      break;
+
+    case 'b':
+      tiles = !tiles;
+      printf("Tiled rendering %s\n", tiles ? "on" : "off");
+      break;
+
     case 'o':
       clip_plane += 10;
       break;
@@ -477,6 +510,7 @@ int main(int argc, char *argv[])
 	CmdLineUsage(argv[0], args);
      }
    
+  LiteXGraphicPort::SetIndexed(indexed);
   GP = GraphicPort::Make(window_title, camera_width, camera_height);
 
   if(!GP)
@@ -495,6 +529,9 @@ int main(int argc, char *argv[])
     }
 
   PE->ColormapMode();
+  PE->TileBuffers(
+     (ColorIndex*)tile_graph_mem, tile_z_mem, PE_TILE_WIDTH, PE_TILE_HEIGHT
+  );
 
   for(i=0; i<64; i++)
     GP->MapColor(i, i << 2, i << 2, i << 2);
@@ -554,6 +591,8 @@ int main(int argc, char *argv[])
 	       printf("blending completed.\n");
 	  }
      }
+   else if(m->Resources().Get(MR_COLORS))
+      m->Blend();   // binary mesh, with its colors
    else
       m->White();  
    
@@ -684,7 +723,15 @@ int main(int argc, char *argv[])
       GP->Clip().Set(10,10,GP->Width() - 10, GP->Height() - 10);
       GP->Clip().Set(clip_plane,1024);
 
+      if(tiles)
+	PE->BeginTiles();
+      else if(queue)
+	PE->BeginQueue();
       PE << *m;
+      if(tiles)
+	PE->EndTiles();
+      else if(queue)
+	PE->EndQueue();
       GP->SwapBuffers();
       frames++;
       // printf("frame: %d\n",frames);
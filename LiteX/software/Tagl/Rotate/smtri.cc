@@ -54,6 +54,55 @@ project(VectorF& M, VectorF& M0, VectorF& N, double radius = 0.0)
   
 }
 
+// The 3 patches (P0,P1,P), (P1,P2,P), (P2,P0,P) of each level, P is
+// the center of the triangle. Only the finest level has the control
+// nets (BF_CONTROL draws it).
+
+void SmoothTriangle::Levels(VectorF& P0, VectorF& P1, VectorF& P2, int n)
+{
+  VectorF P = (1.0 / 3.0) * (P0 + P1 + P2);
+
+  _nlevels = 0;
+  _lit_level = -1;
+  for(;;)
+    {
+      _n[_nlevels] = n;
+      _T[_nlevels][0] = new Bezier(P0, P1, P, NULL, 3, n, _nlevels == 0);
+      _T[_nlevels][1] = new Bezier(P1, P2, P, NULL, 3, n, _nlevels == 0);
+      _T[_nlevels][2] = new Bezier(P2, P0, P, NULL, 3, n, _nlevels == 0);
+      _nlevels++;
+      if(n <= 2 || _nlevels == SMT_LEVELS)
+	break;
+      n = (n - 1) / 2 + 1;
+    }
+}
+
+// The finest level whose triangles are not smaller than GetLOD() pixels.
+// The patches are about as large as the bounding sphere of the coarsest
+// ones (their corners), the edges of the triangles of level l are about
+// this diameter / (n - 1).
+
+int SmoothTriangle::Level(void)
+{
+  int lod = GetLOD();
+  if(lod <= 0 || _nlevels == 1 || PixelScale() <= 0.0 ||
+     Mode().Get(BF_CONTROL))
+    return 0;
+
+  int r = 0;
+  for(int k=0; k<3; k++)
+    {
+      int rk = _T[_nlevels-1][k]->ScreenRadius();
+      if(rk > r)
+	r = rk;
+    }
+
+  int l = 0;
+  while(l < _nlevels-1 && 2*r < lod * (_n[l] - 1))
+    l++;
+  return l;
+}
+
 SmoothTriangle::SmoothTriangle(void)
 {
   VectorF P0, P1, P2;
@@ -71,14 +120,7 @@ SmoothTriangle::SmoothTriangle(void)
   P2.y =  0.0;
 
 
-  VectorF P;
-  P.x = (P0.x + P1.x + P2.x) / 3.0;
-  P.y = (P0.y + P1.y + P2.y) / 3.0;
-  P.z = (P0.z + P1.z + P2.z) / 3.0;
-  
-  _T0 = new Bezier(P0, P1, P, NULL, 3, 5);
-  _T1 = new Bezier(P1, P2, P, NULL, 3, 5);
-  _T2 = new Bezier(P2, P0, P, NULL, 3, 5);
+  Levels(P0, P1, P2, 5);
 
 
   _resources.Set(MR_COLORS);
@@ -89,15 +131,7 @@ SmoothTriangle::SmoothTriangle(void)
 
 SmoothTriangle::SmoothTriangle(VectorF P0, VectorF P1, VectorF P2)
 {
-
-  VectorF P;
-  P.x = (P0.x + P1.x + P2.x) / 3.0;
-  P.y = (P0.y + P1.y + P2.y) / 3.0;
-  P.z = (P0.z + P1.z + P2.z) / 3.0;
-  
-  _T0 = new Bezier(P0, P1, P, NULL, 3, 10);
-  _T1 = new Bezier(P1, P2, P, NULL, 3, 10);
-  _T2 = new Bezier(P2, P0, P, NULL, 3, 10);
+  Levels(P0, P1, P2, 10);
 
 
   _resources.Set(MR_COLORS);
@@ -108,11 +142,7 @@ SmoothTriangle::SmoothTriangle(VectorF P0, VectorF P1, VectorF P2)
 SmoothTriangle::SmoothTriangle(VectorF P0, VectorF P1, VectorF P2, 
 			       VectorF N0, VectorF N1, VectorF N2)
 {
-  VectorF P = (1.0 / 3.0) * (P0 + P1 + P2);
-  
-  _T0 = new Bezier(P1, P2, P, NULL, 3, 10);
-  _T1 = new Bezier(P2, P0, P, NULL, 3, 10);
-  _T2 = new Bezier(P0, P1, P, NULL, 3, 10);
+  Levels(P1, P2, P0, 10);
 
 
   _resources.Set(MR_COLORS);
@@ -162,13 +192,17 @@ void SmoothTriangle::Update(VectorF P0, VectorF P1, VectorF P2,
   l1p = (P - (P2 + P0) / 2.0).Length();
   l2p = (P - (P0 + P1) / 2.0).Length();
 
-  _T0->Update(P1, P2, P);
-  _T1->Update(P2, P0, P);
-  _T2->Update(P0, P1, P);
+  int l;
+  for(l=0; l<_nlevels; l++)
+    {
+      _T[l][0]->Update(P1, P2, P);
+      _T[l][1]->Update(P2, P0, P);
+      _T[l][2]->Update(P0, P1, P);
+    }
 
-  _T0->FlatControl(control0);
-  _T1->FlatControl(control1);
-  _T2->FlatControl(control2);
+  _T[0][0]->FlatControl(control0);
+  _T[0][1]->FlatControl(control1);
+  _T[0][2]->FlatControl(control2);
 
 // -------------------------------------------------
 // Control nodes surrounding base triangle vertice 
@@ -272,9 +306,12 @@ void SmoothTriangle::Update(VectorF P0, VectorF P1, VectorF P2,
   control1[TriMesh::TIndex(4,0,0)] = tmp;
   control2[TriMesh::TIndex(4,0,0)] = tmp;
 
-  _T0->Update(control0);
-  _T1->Update(control1);
-  _T2->Update(control2);
+  for(l=0; l<_nlevels; l++)
+    {
+      _T[l][0]->Update(control0);
+      _T[l][1]->Update(control1);
+      _T[l][2]->Update(control2);
+    }
   
 // -------------------------------------------------
 // degree 3 is not enough for G1
@@ -294,75 +331,84 @@ void SmoothTriangle::Update(VectorF P0, VectorF P1, VectorF P2,
 
 void SmoothTriangle::RotX(Angle r)
 {
-  _T0->RotX(r);
-  _T1->RotX(r);
-  _T2->RotX(r);
+  for(int l=0; l<_nlevels; l++)
+    for(int k=0; k<3; k++)
+      _T[l][k]->RotX(r);
 }
 
 void SmoothTriangle::RotY(Angle r)
 {
-  _T0->RotY(r);
-  _T1->RotY(r);
-  _T2->RotY(r);
+  for(int l=0; l<_nlevels; l++)
+    for(int k=0; k<3; k++)
+      _T[l][k]->RotY(r);
 }
 
 void SmoothTriangle::RotZ(Angle r)
 {
-  _T0->RotZ(r);
-  _T1->RotZ(r);
-  _T2->RotZ(r);
+  for(int l=0; l<_nlevels; l++)
+    for(int k=0; k<3; k++)
+      _T[l][k]->RotZ(r);
 }
 
 void SmoothTriangle::Translate(int tx, int ty, int tz)
 {
-  _T0->Translate(tx, ty, tz);  
-  _T1->Translate(tx, ty, tz);
-  _T2->Translate(tx, ty, tz);
+  for(int l=0; l<_nlevels; l++)
+    for(int k=0; k<3; k++)
+      _T[l][k]->Translate(tx, ty, tz);
 }
 
 void SmoothTriangle::Scale(double sx, double sy, double sz)
 {
-  _T0->Scale(sx, sy, sz);
-  _T1->Scale(sx, sy, sz);
-  _T2->Scale(sx, sy, sz);
+  for(int l=0; l<_nlevels; l++)
+    for(int k=0; k<3; k++)
+      _T[l][k]->Scale(sx, sy, sz);
 }
 
+// Only the level that is drawn is lit. If Draw() chooses another one
+// (the zoom or the matrix changed since Lighting()), it is lit then.
+
 void SmoothTriangle::Draw(PolygonEngine *PE)
 {
-  _T0->Mode() = Mode();
-  _T1->Mode() = Mode();
-  _T2->Mode() = Mode();
-  PE << (*_T0) << (*_T1) << (*_T2);
+  int l = Level();
+  if(_lit_level >= 0 && l != _lit_level)
+    LightLevel(l);
+
+  _T[l][0]->Mode() = Mode();
+  _T[l][1]->Mode() = Mode();
+  _T[l][2]->Mode() = Mode();
+  PE << (*_T[l][0]) << (*_T[l][1]) << (*_T[l][2]);
+}
+
+void SmoothTriangle::LightLevel(int l)
+{
+  _T[l][0]->Lighting();
+  _T[l][1]->Lighting();
+  _T[l][2]->Lighting();
+  _lit_level = l;
 }
 
 void SmoothTriangle::Lighting(void)
 {
-  if(!_T0 || !_T1 || !_T2)
-    {
-       printf("Argh, c'est zarbi !\n");
-    }
-  _T0->Lighting();
-  _T1->Lighting();
-  _T2->Lighting();
+  LightLevel(Level());
 }
 
 void SmoothTriangle::Shiny(gfloat factor, gfloat lambertian, gfloat specular)
 {
-  _T0->Shiny(factor, lambertian, specular);
-  _T1->Shiny(factor, lambertian, specular);
-  _T2->Shiny(factor, lambertian, specular);
+  for(int l=0; l<_nlevels; l++)
+    for(int k=0; k<3; k++)
+      _T[l][k]->Shiny(factor, lambertian, specular);
 }
 
 void SmoothTriangle::Dull()
 {
-  _T0->Dull();
-  _T1->Dull();
-  _T2->Dull();
+  for(int l=0; l<_nlevels; l++)
+    for(int k=0; k<3; k++)
+      _T[l][k]->Dull();
 }
 
 SmoothTriangle::~SmoothTriangle(void)
 {
-  delete _T0;
-  delete _T1;
-  delete _T2;
+  for(int l=0; l<_nlevels; l++)
+    for(int k=0; k<3; k++)
+      delete _T[l][k];
 }
@@ -31,6 +31,12 @@
 
 #include "bezier.h"
 
+// Levels of detail: the patches are tessellated with n, (n-1)/2+1, ...
+// down to 2 subdivisions (one triangle per patch), all updated with the
+// same control points, and the one drawn is chosen each frame from the
+// size of the triangle on the screen (see GraphicObject::SetLOD()).
+const int SMT_LEVELS = 4;
+
 class SmoothTriangle : public Mesh
 {
  public:
@@ -59,9 +65,14 @@ class SmoothTriangle : public Mesh
   virtual void Lighting(void);
 
  protected:
-  Bezier* _T0;
-  Bezier* _T1;
-  Bezier* _T2;
+  void Levels(VectorF& P0, VectorF& P1, VectorF& P2, int n);
+  int  Level(void);
+  void LightLevel(int l);
+
+  Bezier* _T[SMT_LEVELS][3];
+  int     _n[SMT_LEVELS];
+  int     _nlevels;
+  int     _lit_level;   // level of the last Lighting(), -1 if none
 
 };
 
@@ -31,6 +31,8 @@
 #include "polyeng.h"
 #include "texture.h"
 #include <libfatfs/ff.h>
+#define LITE_SERVICES_OVERRIDE
+#include <lite_services.h>
 
 int size;
 
@@ -64,7 +66,52 @@ unsigned char R;
 } TGA_Pixel;
 
 
-int LoadTexture(const char* filename, GraphicPort* GP)
+/*
+ * Mipmap chain: level i is (size >> i) x (size >> i), each texel the 
+ * average of a 2x2 block of level i-1, down to 1x1. The levels are
+ * allocated in a single block, after the texture.
+ */
+
+static GTexel** BuildMipmaps(GTexel* texture, int size, int* nb_levels)
+{
+   int n = 1, total = 0, s;
+   for(s = size >> 1; s > 0; s >>= 1)
+     {
+	n++;
+	total += s * s;
+     }
+
+   GTexel** levels = new GTexel*[n];
+   GTexel*  mem    = new GTexel[total > 0 ? total : 1];
+   levels[0] = texture;
+   
+   s = size;
+   for(int l = 1; l < n; l++)
+     {
+	GTexel* src = levels[l-1];
+	GTexel* dst = mem;
+	int     ds  = s >> 1;
+	for(int y=0; y<ds; y++)
+	  for(int x=0; x<ds; x++)
+	    {
+	       GTexel* t = src + (2*y)*s + 2*x;
+	       dst[y*ds+x] = GTexel(
+		  (t[0].r + t[1].r + t[s].r + t[s+1].r + 2) >> 2,
+		  (t[0].g + t[1].g + t[s].g + t[s+1].g + 2) >> 2,
+		  (t[0].b + t[1].b + t[s].b + t[s+1].b + 2) >> 2,
+		  (t[0].a + t[1].a + t[s].a + t[s+1].a + 2) >> 2
+	       );
+	    }
+	levels[l] = dst;
+	mem += ds * ds;
+	s = ds;
+     }
+
+   *nb_levels = n;
+   return levels;
+}
+
+int LoadTexture(const char* filename, GraphicPort* GP, int mipmaps)
 {
    FIL f;
    UINT br;
@@ -122,7 +169,14 @@ int LoadTexture(const char* filename, GraphicPort* GP)
    
    delete[] Line;
 
-   GP->TextureBind((uint32 *)texture, size);
+   if(mipmaps && nbrbits(size) == 1)
+     {
+	int nb_levels;
+	GTexel** levels = BuildMipmaps(texture, size, &nb_levels);
+	GP->TextureBind((uint32 **)levels, size, nb_levels);
+     }
+   else
+     GP->TextureBind((uint32 *)texture, size);
 
    f_close(&f);
 
@@ -35,7 +35,8 @@ extern int size;
 class GraphicPort;
 class PolygonEngine;
 
-int LoadTexture(const char* filename, GraphicPort* GP);
+// With mipmaps, the mipmap chain is built and bound with the texture
+int LoadTexture(const char* filename, GraphicPort* GP, int mipmaps = 1);
 void ToggleTextureMode(PolygonEngine* PE);
 
 #endif
@@ -0,0 +1,261 @@
+/**
+ * Converts a TAGL text mesh (.geom, with an optional .ipcol color file)
+ * into a binary mesh (.tgm, see Rotate/meshbin.h), loaded by Tagl Rotate
+ * with a single read. Does the same centering, scaling, axis swap and
+ * normal computation as Mesh::load_geometry().
+ *   geom2tgm object.geom [object.ipcol] object.tgm
+ */
+
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+
+#include <meshbin.h>
+
+/*********************************************************************/
+
+/**
+ * \brief Reads the next whitespace-separated token of a file
+ * \param[in] f the file
+ * \param[out] token the token
+ * \retval true if a token could be read
+ * \retval false at the end of the file
+ */
+static bool read_token(FILE* f, char token[256]) {
+    return fscanf(f, "%255s", token) == 1;
+}
+
+static bool read_int(FILE* f, int& result) {
+    char token[256];
+    if(!read_token(f, token)) {
+	return false;
+    }
+    result = atoi(token);
+    return true;
+}
+
+static bool read_float(FILE* f, double& result) {
+    char token[256];
+    if(!read_token(f, token)) {
+	return false;
+    }
+    result = float(atof(token)); // same precision as Mesh::load_geometry()
+    return true;
+}
+
+/*********************************************************************/
+
+struct Mesh {
+    std::vector<int32_t>  vertex;  // 3 per vertex
+    std::vector<int32_t>  normal;  // 3 per face
+    std::vector<uint32_t> face;    // nb_faces+1
+    std::vector<uint32_t> corner;
+    std::vector<uint32_t> color;   // empty or 1 per face
+    uint32_t nb_vertices() const { return uint32_t(vertex.size() / 3); }
+    uint32_t nb_faces() const    { return uint32_t(face.size() - 1); }
+};
+
+static bool load_geometry(const char* filename, Mesh& M) {
+    FILE* f = fopen(filename, "r");
+    if(f == nullptr) {
+	fprintf(stderr, "could not open file: %s\n", filename);
+	return false;
+    }
+
+    int nv, nf, dummy;
+    if(!read_int(f, nv) || !read_int(f, nf) || !read_int(f, dummy) || 
+       nv < 0 || nf < 0) {
+	fprintf(stderr, "%s: invalid header\n", filename);
+	fclose(f);
+	return false;
+    }
+
+    std::vector<double> P(3*size_t(nv));
+    for(size_t i=0; i<P.size(); ++i) {
+	if(!read_float(f, P[i])) {
+	    fprintf(stderr, "%s: unexpected end of file\n", filename);
+	    fclose(f);
+	    return false;
+	}
+    }
+
+    M.face.push_back(0);
+    for(int i=0; i<nf; ++i) {
+	int n;
+	if(!read_int(f, n) || n < 0) {
+	    fprintf(stderr, "%s: unexpected end of file\n", filename);
+	    fclose(f);
+	    return false;
+	}
+	size_t first = M.corner.size();
+	M.corner.resize(first + size_t(n));
+	for(int j=0; j<n; ++j) {
+	    int idx;
+	    if(!read_int(f, idx) || idx < 1 || idx > nv) {
+		fprintf(stderr, "%s: invalid vertex index\n", filename);
+		fclose(f);
+		return false;
+	    }
+	    // TAGL takes the vertices of the faces in reverse order
+	    M.corner[first + size_t(n - j - 1)] = uint32_t(idx - 1);
+	}
+	M.face.push_back(uint32_t(M.corner.size()));
+    }
+    fclose(f);
+
+    // center and scale to a radius of 10000
+    double C[3] = {0.0, 0.0, 0.0};
+    for(int i=0; i<nv; ++i) {
+	for(int c=0; c<3; ++c) {
+	    C[c] += P[3*i+c];
+	}
+    }
+    if(nv != 0) {
+	for(int c=0; c<3; ++c) {
+	    C[c] /= double(nv);
+	}
+    }
+    float r = 0.0f;
+    for(int i=0; i<nv; ++i) {
+	for(int c=0; c<3; ++c) {
+	    P[3*i+c] -= C[c];
+	}
+	float r2 = float(
+	    P[3*i]*P[3*i] + P[3*i+1]*P[3*i+1] + P[3*i+2]*P[3*i+2]
+	);
+	r = (r2 > r) ? r2 : r;
+    }
+    r = sqrtf(r);
+    double scaling_factor = (r != 0.0f) ? 10000.0 / r : 0.0;
+
+    // TAGL axes
+    M.vertex.resize(3*size_t(nv));
+    for(int i=0; i<nv; ++i) {
+	M.vertex[3*i]   =    int32_t(P[3*i+2] * scaling_factor);
+	M.vertex[3*i+1] =  - int32_t(P[3*i+1] * scaling_factor);
+	M.vertex[3*i+2] =    int32_t(P[3*i]   * scaling_factor);
+    }
+
+    // face normals, as in Mesh::ComputeNormals()
+    M.normal.resize(3*size_t(nf));
+    for(int i=0; i<nf; ++i) {
+	int n = int(M.face[i+1] - M.face[i]);
+	const uint32_t* V = &M.corner[M.face[i]];
+	double N[3] = {0.0, 0.0, 0.0};
+	for(int i0=0; i0<n; ++i0) {
+	    int i1 = (i0 + 1) % n;
+	    int i2 = (i1 + 1) % n;
+	    double A[3], B[3];
+	    for(int c=0; c<3; ++c) {
+		A[c] = M.vertex[3*V[i0]+c] - M.vertex[3*V[i1]+c];
+		B[c] = M.vertex[3*V[i2]+c] - M.vertex[3*V[i1]+c];
+	    }
+	    N[0] += A[1]*B[2] - A[2]*B[1];
+	    N[1] += A[2]*B[0] - A[0]*B[2];
+	    N[2] += A[0]*B[1] - A[1]*B[0];
+	}
+	double k = N[0]*N[0] + N[1]*N[1] + N[2]*N[2];
+	k = (k != 0.0) ? double(MESHBIN_ONE) / sqrt(k) : 0.0;
+	for(int c=0; c<3; ++c) {
+	    M.normal[3*i+c] = int32_t(N[c] * k);
+	}
+    }
+    return true;
+}
+
+static bool load_colors(const char* filename, Mesh& M) {
+    FILE* f = fopen(filename, "r");
+    if(f == nullptr) {
+	fprintf(stderr, "could not open file: %s\n", filename);
+	return false;
+    }
+    int ncolor, nface;
+    if(!read_int(f, ncolor) || !read_int(f, nface) || ncolor < 0) {
+	fprintf(stderr, "%s: invalid header\n", filename);
+	fclose(f);
+	return false;
+    }
+    if(uint32_t(nface) != M.nb_faces()) {
+	fprintf(stderr, "%s: number of faces does not match\n", filename);
+	fclose(f);
+	return false;
+    }
+    std::vector<double> RGB(3*size_t(ncolor));
+    for(int i=0; i<ncolor; ++i) {
+	// stored as b g r
+	if(!read_float(f, RGB[3*i+2]) || !read_float(f, RGB[3*i+1]) ||
+	   !read_float(f, RGB[3*i])) {
+	    fprintf(stderr, "%s: unexpected end of file\n", filename);
+	    fclose(f);
+	    return false;
+	}
+    }
+    for(int i=0; i<nface; ++i) {
+	int idx;
+	if(!read_int(f, idx) || idx < 1 || idx > ncolor) {
+	    fprintf(stderr, "%s: invalid color index\n", filename);
+	    fclose(f);
+	    return false;
+	}
+	uint32_t r = uint32_t(int(RGB[3*(idx-1)]   * 255.0)) & 255;
+	uint32_t g = uint32_t(int(RGB[3*(idx-1)+1] * 255.0)) & 255;
+	uint32_t b = uint32_t(int(RGB[3*(idx-1)+2] * 255.0)) & 255;
+	M.color.push_back((r << 16) | (g << 8) | b);
+    }
+    fclose(f);
+    return true;
+}
+
+template <class T> static void write_array(FILE* f, const std::vector<T>& A) {
+    fwrite(A.data(), sizeof(T), A.size(), f);
+}
+
+/*********************************************************************/
+
+int main(int argc, char** argv) {
+    if(argc != 3 && argc != 4) {
+	fprintf(stderr, "usage: %s object.geom [object.ipcol] object.tgm\n", argv[0]);
+	return 1;
+    }
+
+    Mesh M;
+    if(!load_geometry(argv[1], M)) {
+	return 1;
+    }
+    if(argc == 4 && !load_colors(argv[2], M)) {
+	return 1;
+    }
+
+    MeshBin_Header H;
+    H.magic       = MESHBIN_MAGIC;
+    H.flags       = M.color.empty() ? 0 : MESHBIN_COLORS;
+    H.nb_vertices = M.nb_vertices();
+    H.nb_faces    = M.nb_faces();
+    H.nb_corners  = uint32_t(M.corner.size());
+
+    const char* output = argv[argc-1];
+    FILE* f = fopen(output, "wb");
+    if(f == nullptr) {
+	fprintf(stderr, "could not create file: %s\n", output);
+	return 1;
+    }
+    fwrite(&H, sizeof(H), 1, f);
+    write_array(f, M.vertex);
+    write_array(f, M.normal);
+    write_array(f, M.face);
+    write_array(f, M.corner);
+    write_array(f, M.color);
+    bool ok = (ftell(f) == long(meshbin_size(&H)));
+    fclose(f);
+    if(!ok) {
+	fprintf(stderr, "could not write file: %s\n", output);
+	return 1;
+    }
+    printf(
+	"%s: %u vertices, %u faces, %u bytes\n",
+	output, H.nb_vertices, H.nb_faces, meshbin_size(&H)
+    );
+    return 0;
+}
@@ -0,0 +1,63 @@
+/*
+ * Host replacement of the FatFs functions used by Rotate (files opened
+ * with stdio), to build the Tagl benchmark (Tools/tagl_bench.cpp) on the
+ * host with the same mesh and texture loaders as on the board.
+ */
+
+#ifndef HOST_FF_H
+#define HOST_FF_H
+
+#include <stdio.h>
+
+typedef unsigned int  UINT;
+typedef unsigned char BYTE;
+typedef char          TCHAR;
+typedef unsigned long FSIZE_t;
+
+typedef enum { FR_OK = 0, FR_DISK_ERR, FR_NO_FILE } FRESULT;
+
+#define FA_READ 0x01
+
+typedef struct {
+    FILE*   file;
+    FSIZE_t size;
+} FIL;
+
+typedef struct {
+    int dummy;
+} FATFS;
+
+static inline FRESULT f_mount(FATFS* fs, const TCHAR* path, BYTE opt) {
+    return FR_OK;
+}
+
+static inline FRESULT f_open(FIL* fp, const TCHAR* path, BYTE mode) {
+    fp->file = fopen(path, "rb");
+    if(fp->file == NULL) {
+	return FR_NO_FILE;
+    }
+    fseek(fp->file, 0, SEEK_END);
+    fp->size = (FSIZE_t)ftell(fp->file);
+    fseek(fp->file, 0, SEEK_SET);
+    return FR_OK;
+}
+
+static inline FRESULT f_close(FIL* fp) {
+    fclose(fp->file);
+    fp->file = NULL;
+    return FR_OK;
+}
+
+static inline FRESULT f_read(FIL* fp, void* buff, UINT btr, UINT* br) {
+    *br = (UINT)fread(buff, 1, btr, fp->file);
+    return ferror(fp->file) ? FR_DISK_ERR : FR_OK;
+}
+
+static inline FRESULT f_lseek(FIL* fp, FSIZE_t ofs) {
+    return fseek(fp->file, (long)ofs, SEEK_SET) ? FR_DISK_ERR : FR_OK;
+}
+
+#define f_size(fp) ((fp)->size)
+#define f_eof(fp)  ((FSIZE_t)ftell((fp)->file) >= (fp)->size)
+
+#endif
@@ -0,0 +1,11 @@
+/*
+ * Host replacement of lite_services.h (see libfatfs/ff.h): the files
+ * are opened directly.
+ */
+
+#ifndef LITE_SERVICES
+#define LITE_SERVICES
+
+#include <libfatfs/ff.h>
+
+#endif
@@ -0,0 +1,412 @@
+/**
+ * Benchmark of the Tagl polygon engines, on the host, with the headless
+ * GraphicPort (Lib/Memgport.cc). For each model and each pixel format
+ * (PolygonEngine), plays the same scripted sequence as the keys of
+ * Rotate (smooth, dither, specular, Z-buffer, wireframe, RGB colors,
+ * texture), each phase for a fixed camera path (the same rotation at
+ * each frame from the model orientation), and reports the time per frame, the faces and
+ * the covered pixels per second, and a checksum of the frames.
+ *
+ *   tagl_bench [options] model1.geom [model2.geom|.tgm ...]
+ *    -width w, -height h: size of the frame (default: 320x200)
+ *    -frames n:           frames per phase (default: 100)
+ *    -engines e1,e2...:   the engines (default: all), among
+ *                         peng_8 peng_555 peng_565 peng_24 peng_32x
+ *                         peng_32xi peng_x32
+ *    -tex texture.tga:    adds the texture phase
+ *    -nomip:              binds the texture without its mipmaps
+ *    -w ref.txt:          saves the checksums
+ *    -c ref.txt:          checks the checksums against a saved file
+ *                         (exit status 1 if one of them differs)
+ *    -queue:              fills the polygons through the polygon queue
+ *                         (PolygonEngine::BeginQueue()), drained by the
+ *                         same thread
+ *    -queue2:             same, drained by a second thread (the second
+ *                         hart of the board)
+ *
+ * The checksums only depend on the pixels, so that a change of an engine
+ * that should not change the image (an optimization) can be checked with
+ * -c on the checksums saved before the change.
+ */
+
+#include "Memgport.h"
+#include "polyeng.h"
+#include "mesh.h"
+#include "texture.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <ctime>
+#include <thread>
+
+extern "C" {
+    void init_gport_Mem();
+    void init_peng_8();
+    void init_peng_555();
+    void init_peng_565();
+    void init_peng_24();
+    void init_peng_32x();
+    void init_peng_32xi();
+    void init_peng_x32();
+}
+
+/*********************************************************************/
+
+/**
+ * \brief A pixel format, and the engine that draws it
+ */
+struct Engine {
+    const char* name;
+    void (*init)();
+    int bytes_per_pixel;
+    UColorCode R_mask, G_mask, B_mask;
+};
+
+static Engine engines[] = {
+    { "peng_8",    init_peng_8,    1, 3u << 4,     3u << 2,     3u          },
+    { "peng_555",  init_peng_555,  2, 31u << 10,   31u << 5,    31u         },
+    { "peng_565",  init_peng_565,  2, 31u << 11,   63u << 5,    31u         },
+    { "peng_24",   init_peng_24,   3, 255u << 16,  255u << 8,   255u        },
+    { "peng_32x",  init_peng_32x,  4, 255u << 24,  255u << 16,  255u << 8   },
+    { "peng_32xi", init_peng_32xi, 4, 255u << 8,   255u << 16,  255u << 24  },
+    { "peng_x32",  init_peng_x32,  4, 255u << 16,  255u << 8,   255u        },
+};
+
+static const int nb_engines = int(sizeof(engines) / sizeof(engines[0]));
+
+/**
+ * \brief A phase of the script: the state of the toggles of Rotate
+ */
+struct Phase {
+    const char* name;
+    int smooth;    // 'w'
+    int dither;    // 'd'
+    int specular;  // 's'
+    int zbuffer;   // 'z' (off: MF_CONVEX)
+    int wireframe; // 'a'
+    int texture;   // 't' (RGB mode)
+    int color;     // ' ' (RGB mode, lit colors)
+};
+
+static const Phase phases[] = {
+    { "flat",      0, 0, 0, 1, 0, 0, 0 },
+    { "smooth",    1, 0, 0, 1, 0, 0, 0 },
+    { "dither",    1, 1, 0, 1, 0, 0, 0 },
+    { "specular",  1, 1, 1, 1, 0, 0, 0 },
+    { "no_zbuf",   1, 1, 0, 0, 0, 0, 0 },
+    { "wireframe", 0, 0, 0, 1, 1, 0, 0 },
+    { "rgb",       1, 0, 0, 1, 0, 0, 1 },
+    { "texture",   0, 0, 0, 1, 0, 1, 0 },
+};
+
+static const int nb_phases = int(sizeof(phases) / sizeof(phases[0]));
+
+// The rotation of the camera path, in Rotate units (see Mesh::Rotate())
+static const int path_rx = 3;
+static const int path_ry = 5;
+static const int path_rz = 1;
+
+/*********************************************************************/
+
+// 0: direct, 1: polygon queue, 2: polygon queue and consumer thread
+static int queue_mode = 0;
+
+static double now() {
+    timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return double(t.tv_sec) + 1e-9 * double(t.tv_nsec);
+}
+
+static void set_flag(Flags& flags, Flag f, int value) {
+    if(value) {
+	flags.Set(f);
+    } else {
+	flags.Reset(f);
+    }
+}
+
+/**
+ * \brief Counts the pixels that differ from the background
+ * \details The background is the pixel at (0,0), outside of the
+ *  clipping rectangle that Rotate uses.
+ */
+static long covered_pixels(GraphicPort* GP) {
+    const unsigned char* line_ptr = (const unsigned char*)GP->GraphMem();
+    int bpp = GP->BytesPerPixel();
+    long result = 0;
+    for(int y=0; y<GP->Height(); ++y) {
+	for(int x=0; x<GP->Width(); ++x) {
+	    if(memcmp(line_ptr + x*bpp, GP->GraphMem(), size_t(bpp))) {
+		++result;
+	    }
+	}
+	line_ptr += GP->BytesPerLine();
+    }
+    return result;
+}
+
+/**
+ * \brief Sets the state of the toggles for a phase
+ */
+static void apply_phase(const Phase& P, Mesh* m, GraphicPort* GP, PolygonEngine* PE) {
+    if(P.texture || P.color) {
+	GP->RGBMode();
+	PE->RGBMode();
+	set_flag(PE->Attributes(), GA_TEXTURE, P.texture);
+    } else {
+	GP->ColormapMode();
+	PE->ColormapMode();
+	for(int i=0; i<64; i++) {
+	    GP->MapColor(i, i << 2, i << 2, i << 2);
+	}
+	PE->Attributes().Reset(GA_TEXTURE);
+    }
+    set_flag(PE->Attributes(), GA_DITHER, P.dither);
+    PE->CommitAttributes();
+    set_flag(m->Mode(), MF_SMOOTH, P.smooth);
+    if(P.specular) {
+	m->Shiny(30.0, 0.8, 1.4);
+    }
+    set_flag(m->Mode(), GF_SPECULAR, P.specular);
+    set_flag(m->Mode(), MF_CONVEX, !P.zbuffer);
+    set_flag(m->Mode(), MF_WIREFRAME, P.wireframe);
+    set_flag(m->Mode(), MF_COLOR, P.color);
+    m->LoadIdentity();
+}
+
+struct Result {
+    double   seconds = 0.0;
+    long     faces = 0;
+    long     pixels = 0;
+    uint32_t checksum = 0;
+};
+
+/**
+ * \brief Renders the frames of a phase
+ */
+static Result run_phase(
+    const Phase& P, int nb_frames, Mesh* m, MemGraphicPort* GP, PolygonEngine* PE
+) {
+    Result R;
+    apply_phase(P, m, GP, PE);
+    R.checksum = 2166136261u;
+    for(int frame=0; frame<nb_frames; ++frame) {
+	double start = now();
+	m->Rotate(path_rx, path_ry, path_rz);
+	m->Lighting();
+	m->Setup(PE);
+	GP->Clip().Set(10,10,GP->Width() - 10, GP->Height() - 10);
+	GP->Clip().Set(300,1024);
+	if(queue_mode) {
+	    PE->BeginQueue();
+	}
+	PE << *m;
+	if(queue_mode) {
+	    PE->EndQueue();
+	}
+	GP->SwapBuffers();
+	R.seconds += now() - start;
+	R.faces += m->NFace();
+	R.pixels += covered_pixels(GP);
+	R.checksum = (R.checksum ^ GP->Checksum()) * 16777619u;
+    }
+    return R;
+}
+
+/*********************************************************************/
+
+static void usage(const char* argv0) {
+    fprintf(
+	stderr,
+	"usage: %s [-width w] [-height h] [-frames n] [-engines e1,e2...]\n"
+	"          [-tex texture.tga] [-nomip] [-w ref.txt | -c ref.txt] [-queue | -queue2]\n"
+	"          model.geom ...\n",
+	argv0
+    );
+}
+
+int main(int argc, char** argv) {
+    int width = 320;
+    int height = 200;
+    int nb_frames = 100;
+    std::string engine_list;
+    const char* texture_filename = nullptr;
+    int mipmaps = 1;
+    const char* write_filename = nullptr;
+    const char* check_filename = nullptr;
+    std::vector<const char*> models;
+
+    for(int i=1; i<argc; ++i) {
+	std::string arg = argv[i];
+	bool has_value = (i+1 < argc);
+	if(arg == "-width" && has_value) {
+	    width = atoi(argv[++i]);
+	} else if(arg == "-height" && has_value) {
+	    height = atoi(argv[++i]);
+	} else if(arg == "-frames" && has_value) {
+	    nb_frames = atoi(argv[++i]);
+	} else if(arg == "-engines" && has_value) {
+	    engine_list = std::string(",") + argv[++i] + ",";
+	} else if(arg == "-tex" && has_value) {
+	    texture_filename = argv[++i];
+	} else if(arg == "-nomip") {
+	    mipmaps = 0;
+	} else if(arg == "-w" && has_value) {
+	    write_filename = argv[++i];
+	} else if(arg == "-c" && has_value) {
+	    check_filename = argv[++i];
+	} else if(arg == "-queue") {
+	    queue_mode = 1;
+	} else if(arg == "-queue2") {
+	    queue_mode = 2;
+	} else if(arg[0] == '-') {
+	    usage(argv[0]);
+	    return 1;
+	} else {
+	    models.push_back(argv[i]);
+	}
+    }
+    if(models.empty() || width < 32 || height < 32 || nb_frames < 1) {
+	usage(argv[0]);
+	return 1;
+    }
+
+    // The saved checksums, "model engine phase checksum" lines
+    std::map<std::string, uint32_t> reference;
+    if(check_filename != nullptr) {
+	FILE* f = fopen(check_filename, "r");
+	if(f == nullptr) {
+	    fprintf(stderr, "could not open %s\n", check_filename);
+	    return 1;
+	}
+	char model[256], engine[64], phase[64];
+	unsigned int checksum;
+	while(fscanf(f, "%255s %63s %63s %x", model, engine, phase, &checksum) == 4) {
+	    reference[std::string(model) + " " + engine + " " + phase] = checksum;
+	}
+	fclose(f);
+    }
+    FILE* out = nullptr;
+    if(write_filename != nullptr) {
+	out = fopen(write_filename, "w");
+	if(out == nullptr) {
+	    fprintf(stderr, "could not create %s\n", write_filename);
+	    return 1;
+	}
+    }
+
+    init_gport_Mem();
+    for(int e=0; e<nb_engines; ++e) {
+	engines[e].init();
+    }
+    GraphicObject::GammaRamp(1.0);
+
+    int nb_errors = 0;
+    printf("%-16s %-10s %-10s %9s %9s %9s  %s\n",
+	   "model", "engine", "phase", "ms/frame", "Mfaces/s", "Mpix/s", "checksum");
+    for(const char* model_filename : models) {
+	Mesh* m = new Mesh;
+	m->load_geometry(model_filename);
+	if(m->ErrorCode()) {
+	    fprintf(stderr, "%s: error code #%d\n", model_filename, m->ErrorCode());
+	    delete m;
+	    return 1;
+	}
+	if(m->Resources().Get(MR_COLORS)) {
+	    m->Blend();
+	} else {
+	    m->White();
+	}
+	m->Smooth();
+	m->Mode().Set(MF_CLOSED);
+	m->TextureMap('x', 1.0);
+	int mapped_size = ::size; // TextureMap() scales by the size of the texture
+	const char* model_name = strrchr(model_filename, '/');
+	model_name = (model_name == nullptr) ? model_filename : model_name + 1;
+
+	for(int e=0; e<nb_engines; ++e) {
+	    const Engine& E = engines[e];
+	    if(
+		!engine_list.empty() &&
+		engine_list.find(std::string(",") + E.name + ",") == std::string::npos
+	    ) {
+		continue;
+	    }
+	    MemGraphicPort::SetFormat(E.bytes_per_pixel, E.R_mask, E.G_mask, E.B_mask);
+	    MemGraphicPort* GP = (MemGraphicPort*)GraphicPort::Make("tagl_bench", width, height, MSG_NONE);
+	    PolygonEngine* PE = (GP == nullptr) ? nullptr : PolygonEngine::Make(GP, MSG_NONE);
+	    if(PE == nullptr) {
+		fprintf(stderr, "%s: could not create the engine\n", E.name);
+		delete GP;
+		return 1;
+	    }
+	    GP->ZBuffer(1);
+	    GP->DoubleBuffer();
+	    volatile int consumer_running = 1;
+	    std::thread consumer;
+	    if(queue_mode == 2) {
+		PE->QueueConsumer(1);
+		consumer = std::thread([PE, &consumer_running]() {
+		    PE->QueueLoop(&consumer_running);
+		});
+	    }
+	    int texture_ok = (texture_filename != nullptr) && LoadTexture(texture_filename, GP, mipmaps);
+	    if(texture_filename != nullptr && !texture_ok) {
+		fprintf(stderr, "could not read texture %s\n", texture_filename);
+	    }
+	    if(texture_ok && mapped_size != ::size) {
+		m->TextureMap('x', 1.0);
+		mapped_size = ::size;
+	    }
+	    for(int p=0; p<nb_phases; ++p) {
+		const Phase& P = phases[p];
+		if(P.texture && !texture_ok) {
+		    continue;
+		}
+		Result R = run_phase(P, nb_frames, m, GP, PE);
+		printf(
+		    "%-16s %-10s %-10s %9.3f %9.3f %9.3f  %08x",
+		    model_name, E.name, P.name,
+		    1000.0 * R.seconds / nb_frames,
+		    1e-6 * double(R.faces) / R.seconds,
+		    1e-6 * double(R.pixels) / R.seconds,
+		    R.checksum
+		);
+		std::string key = std::string(model_name) + " " + E.name + " " + P.name;
+		if(check_filename != nullptr) {
+		    auto it = reference.find(key);
+		    if(it == reference.end()) {
+			printf("  (no reference)");
+		    } else if(it->second != R.checksum) {
+			printf("  MISMATCH (expected %08x)", it->second);
+			++nb_errors;
+		    }
+		}
+		printf("\n");
+		if(out != nullptr) {
+		    fprintf(out, "%s %08x\n", key.c_str(), R.checksum);
+		}
+	    }
+	    if(queue_mode == 2) {
+		consumer_running = 0;
+		consumer.join();
+	    }
+	    delete PE;
+	    delete GP;
+	}
+	delete m;
+    }
+    if(out != nullptr) {
+	fclose(out);
+    }
+    if(nb_errors != 0) {
+	printf("%d checksum(s) differ\n", nb_errors);
+	return 1;
+    }
+    return 0;
+}